@@ -98,4 +98,52 @@ TEST(BCastTest, GetArgumentBCast) {
   }
 }
 
+TEST(BCastTest, GetBinaryBCastFastPath) {
+  using Pattern = BinaryBCastFastPath::Pattern;
+
+  auto fast_path = [](const TensorShape& lhs, const TensorShape& rhs) {
+    TensorShape out = GetBroadcastedShape(lhs, rhs).get();
+    return GetBinaryBCastFastPath(GetArgumentBCast(lhs, out).get(),
+                                  GetArgumentBCast(rhs, out).get());
+  };
+
+  {
+    // BiasAdd: [N, H, C] + [C].
+    auto bcast = fast_path(TensorShape({2, 4, 8}), TensorShape({8}));
+    ASSERT_TRUE(bcast.has_value());
+    EXPECT_EQ(bcast->pattern, Pattern::kRow);
+    EXPECT_FALSE(bcast->broadcast_lhs);
+    EXPECT_EQ(bcast->middle, 8);
+    EXPECT_EQ(bcast->inner, 8);
+  }
+
+  {
+    // [N, 1] - [N, C].
+    auto bcast = fast_path(TensorShape({3, 1}), TensorShape({3, 5}));
+    ASSERT_TRUE(bcast.has_value());
+    EXPECT_EQ(bcast->pattern, Pattern::kColumn);
+    EXPECT_TRUE(bcast->broadcast_lhs);
+    EXPECT_EQ(bcast->outer, 3);
+    EXPECT_EQ(bcast->middle, 5);
+  }
+
+  {
+    // [N, H, C] * [N, 1, C], with a size 1 dimension that is skipped.
+    auto bcast =
+        fast_path(TensorShape({2, 3, 1, 4}), TensorShape({2, 1, 1, 4}));
+    ASSERT_TRUE(bcast.has_value());
+    EXPECT_EQ(bcast->pattern, Pattern::kMiddle);
+    EXPECT_FALSE(bcast->broadcast_lhs);
+    EXPECT_EQ(bcast->outer, 2);
+    EXPECT_EQ(bcast->middle, 3);
+    EXPECT_EQ(bcast->inner, 4);
+  }
+
+  // Both arguments are broadcast.
+  EXPECT_FALSE(fast_path(TensorShape({3, 1}), TensorShape({1, 3})).has_value());
+  // The broadcast argument is broadcast in two separate runs.
+  EXPECT_FALSE(
+      fast_path(TensorShape({2, 3, 4}), TensorShape({1, 3, 1})).has_value());
+}
+
 }  // namespace tfrt
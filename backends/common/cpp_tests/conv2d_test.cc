@@ -0,0 +1,298 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Unit test and benchmarks for the Conv2D kernel algorithms.
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <random>
+
+#include "../lib/compat/eigen/kernels/conv2d.h"
+#include "../lib/compat/eigen/kernels/zero_padding.h"
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+#include "tfrt/tensor/tensor_metadata.h"
+#include "tfrt/tensor/tensor_shape.h"
+
+namespace tfrt {
+namespace compat {
+namespace {
+
+using ::tfrt::compat::internal::Conv2DAlgorithm;
+
+std::unique_ptr<HostContext> CreateTestHostContext(int num_threads) {
+  return std::make_unique<HostContext>(
+      [](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+      CreateMultiThreadedWorkQueue(num_threads, num_threads));
+}
+
+ExecutionContext CreateExecutionContext(HostContext* host) {
+  Expected<RCReference<RequestContext>> req_ctx =
+      RequestContextBuilder(host, /*resource_context=*/nullptr).build();
+  assert(req_ctx);
+  return ExecutionContext(std::move(*req_ctx));
+}
+
+DenseHostTensor MakeRandomTensor(HostContext* host, const TensorShape& shape) {
+  TensorMetadata md(GetDType<float>(), shape);
+  auto tensor = DenseHostTensor::CreateUninitialized(md, host);
+  assert(tensor.has_value());
+  std::mt19937 gen(shape.GetNumElements());
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  for (float& value : MutableDHTArrayView<float>(&*tensor).Elements())
+    value = dist(gen);
+  return std::move(*tensor);
+}
+
+// Computes `output = conv2d(input, filter) + bias` with the given algorithm.
+void Conv2DBiasAdd(const DenseHostTensor& input, const DenseHostTensor& filter,
+                   const DenseHostTensor& bias, DenseHostTensor* output,
+                   string_view padding, std::array<Index, 2> strides,
+                   Conv2DAlgorithm algorithm,
+                   const ExecutionContext& exec_ctx) {
+  using OutputKernel = llvm::Expected<BiasAddOutputKernel<float>>;
+  auto output_kernel = [&bias](Conv2DParams) -> OutputKernel {
+    return BiasAddOutputKernel<float>(
+        AsEigenConstTensor(DHTIndexableView<float, 1>(&bias)));
+  };
+
+  AsyncValueRef<Chain> done = internal::Conv2DImpl<float>(
+      input, filter, output, padding, strides, std::move(output_kernel),
+      exec_ctx, algorithm);
+  exec_ctx.host()->Await(done.CopyRCRef());
+  ASSERT_FALSE(done.IsError());
+}
+
+struct Conv2DShape {
+  Index batch, height, width, in_channels;
+  Index filter_height, filter_width, out_channels;
+  Index stride;
+  const char* padding;
+};
+
+TensorShape OutputShape(const Conv2DShape& s) {
+  const bool same = string_view(s.padding) == "same";
+  auto size = [&](Index in, Index filter) {
+    return same ? (in + s.stride - 1) / s.stride
+                : (in - filter + s.stride) / s.stride;
+  };
+  return TensorShape({s.batch, size(s.height, s.filter_height),
+                      size(s.width, s.filter_width), s.out_channels});
+}
+
+void TestDirectMatchesEigen(const Conv2DShape& s) {
+  auto host = CreateTestHostContext(4);
+  ExecutionContext exec_ctx = CreateExecutionContext(host.get());
+
+  auto input = MakeRandomTensor(
+      host.get(), TensorShape({s.batch, s.height, s.width, s.in_channels}));
+  auto filter = MakeRandomTensor(
+      host.get(), TensorShape({s.filter_height, s.filter_width, s.in_channels,
+                               s.out_channels}));
+  auto bias = MakeRandomTensor(host.get(), TensorShape({s.out_channels}));
+  auto expected = MakeRandomTensor(host.get(), OutputShape(s));
+  auto actual = MakeRandomTensor(host.get(), OutputShape(s));
+
+  Conv2DBiasAdd(input, filter, bias, &expected, s.padding,
+                {s.stride, s.stride}, Conv2DAlgorithm::kEigen, exec_ctx);
+  Conv2DBiasAdd(input, filter, bias, &actual, s.padding, {s.stride, s.stride},
+                Conv2DAlgorithm::kDirect, exec_ctx);
+
+  auto expected_values = DHTArrayView<float>(&expected).Elements();
+  auto actual_values = DHTArrayView<float>(&actual).Elements();
+  for (size_t i = 0; i < expected_values.size(); ++i) {
+    ASSERT_NEAR(actual_values[i], expected_values[i],
+                1e-4f * (1.0f + std::abs(expected_values[i])))
+        << "at index " << i;
+  }
+}
+
+TEST(Conv2DTest, Direct3x3) {
+  TestDirectMatchesEigen({1, 7, 9, 3, 3, 3, 5, 1, "same"});
+  TestDirectMatchesEigen({2, 8, 8, 16, 3, 3, 40, 1, "valid"});
+  TestDirectMatchesEigen({2, 9, 8, 16, 3, 3, 72, 2, "same"});
+}
+
+TEST(Conv2DTest, Direct1x1) {
+  TestDirectMatchesEigen({1, 5, 6, 7, 1, 1, 33, 1, "valid"});
+  TestDirectMatchesEigen({2, 7, 7, 32, 1, 1, 64, 2, "same"});
+}
+
+TEST(Conv2DTest, DirectRectangularFilter) {
+  TestDirectMatchesEigen({1, 4, 5, 2, 2, 3, 17, 1, "same"});
+}
+
+TEST(Conv2DTest, FoldBatchNorm) {
+  auto host = CreateTestHostContext(4);
+  ExecutionContext exec_ctx = CreateExecutionContext(host.get());
+  const Conv2DShape s = {1, 6, 7, 8, 3, 3, 12, 1, "same"};
+  const float epsilon = 0.001f;
+
+  auto input = MakeRandomTensor(
+      host.get(), TensorShape({s.batch, s.height, s.width, s.in_channels}));
+  auto filter = MakeRandomTensor(
+      host.get(), TensorShape({s.filter_height, s.filter_width, s.in_channels,
+                               s.out_channels}));
+  auto scale = MakeRandomTensor(host.get(), TensorShape({s.out_channels}));
+  auto offset = MakeRandomTensor(host.get(), TensorShape({s.out_channels}));
+  auto mean = MakeRandomTensor(host.get(), TensorShape({s.out_channels}));
+  auto variance = MakeRandomTensor(host.get(), TensorShape({s.out_channels}));
+  for (float& value : MutableDHTArrayView<float>(&variance).Elements())
+    value = std::abs(value) + 0.5f;
+
+  auto expected = MakeRandomTensor(host.get(), OutputShape(s));
+  using OutputKernel = llvm::Expected<BatchNormOutputKernel<float>>;
+  auto output_kernel = [&](Conv2DParams) -> OutputKernel {
+    return BatchNormOutputKernel<float>(
+        AsEigenConstTensor(DHTIndexableView<float, 1>(&scale)),
+        AsEigenConstTensor(DHTIndexableView<float, 1>(&offset)),
+        AsEigenConstTensor(DHTIndexableView<float, 1>(&mean)),
+        AsEigenConstTensor(DHTIndexableView<float, 1>(&variance)), epsilon);
+  };
+  AsyncValueRef<Chain> done = internal::Conv2DImpl<float>(
+      input, filter, &expected, s.padding, {s.stride, s.stride},
+      std::move(output_kernel), exec_ctx);
+  host->Await(done.CopyRCRef());
+  ASSERT_FALSE(done.IsError());
+
+  auto folded = internal::FoldBatchNormImpl<float>(
+      filter, scale, offset, mean, variance, epsilon, host.get());
+  ASSERT_TRUE(static_cast<bool>(folded));
+  auto actual = MakeRandomTensor(host.get(), OutputShape(s));
+  Conv2DBiasAdd(input, folded->first, folded->second, &actual, s.padding,
+                {s.stride, s.stride}, Conv2DAlgorithm::kDefault, exec_ctx);
+
+  auto expected_values = DHTArrayView<float>(&expected).Elements();
+  auto actual_values = DHTArrayView<float>(&actual).Elements();
+  for (size_t i = 0; i < expected_values.size(); ++i) {
+    ASSERT_NEAR(actual_values[i], expected_values[i],
+                1e-4f * (1.0f + std::abs(expected_values[i])))
+        << "at index " << i;
+  }
+}
+
+void TestZeroPaddingMatchesPaddedInput(const Conv2DShape& s,
+                                       Index zero_padding) {
+  auto host = CreateTestHostContext(4);
+  ExecutionContext exec_ctx = CreateExecutionContext(host.get());
+
+  auto input = MakeRandomTensor(
+      host.get(), TensorShape({s.batch, s.height, s.width, s.in_channels}));
+  auto padded = MakeRandomTensor(
+      host.get(),
+      TensorShape({s.batch, s.height + 2 * zero_padding,
+                   s.width + 2 * zero_padding, s.in_channels}));
+  auto filter = MakeRandomTensor(
+      host.get(), TensorShape({s.filter_height, s.filter_width, s.in_channels,
+                               s.out_channels}));
+
+  Conv2DShape padded_shape = s;
+  padded_shape.height += 2 * zero_padding;
+  padded_shape.width += 2 * zero_padding;
+  auto expected = MakeRandomTensor(host.get(), OutputShape(padded_shape));
+  auto actual = MakeRandomTensor(host.get(), OutputShape(padded_shape));
+
+  const int32_t pad = static_cast<int32_t>(zero_padding);
+  AsyncValueRef<Chain> padded_done =
+      TfPadImpl<float>(input, pad, pad, pad, pad, &padded, exec_ctx);
+  host->Await(padded_done.CopyRCRef());
+  ASSERT_FALSE(padded_done.IsError());
+
+  using OutputKernel = llvm::Expected<Eigen::NoOpOutputKernel>;
+  auto output_kernel = [](Conv2DParams) -> OutputKernel {
+    return Eigen::NoOpOutputKernel();
+  };
+  const std::array<Index, 2> strides = {s.stride, s.stride};
+  const std::array<Index, 2> paddings = {zero_padding, zero_padding};
+
+  AsyncValueRef<Chain> done[] = {
+      internal::Conv2DImpl<float>(padded, filter, &expected, "valid", strides,
+                                  output_kernel, exec_ctx),
+      internal::Conv2DImpl<float>(input, filter, &actual, "valid", strides,
+                                  output_kernel, exec_ctx,
+                                  Conv2DAlgorithm::kDefault, paddings)};
+  for (auto& chain : done) {
+    host->Await(chain.CopyRCRef());
+    ASSERT_FALSE(chain.IsError());
+  }
+
+  auto expected_values = DHTArrayView<float>(&expected).Elements();
+  auto actual_values = DHTArrayView<float>(&actual).Elements();
+  for (size_t i = 0; i < expected_values.size(); ++i) {
+    ASSERT_NEAR(actual_values[i], expected_values[i],
+                1e-4f * (1.0f + std::abs(expected_values[i])))
+        << "at index " << i;
+  }
+}
+
+TEST(Conv2DTest, ZeroPadding) {
+  // Eigen spatial convolution with explicit paddings.
+  TestZeroPaddingMatchesPaddedInput({1, 16, 16, 3, 7, 7, 8, 2, "valid"}, 3);
+  // Direct kernel.
+  TestZeroPaddingMatchesPaddedInput({2, 8, 9, 16, 3, 3, 24, 1, "valid"}, 1);
+}
+
+// -------------------------------------------------------------------------- //
+// Conv2D benchmarks on the ResNet-50 convolution layers (batch size 1).
+// -------------------------------------------------------------------------- //
+
+void BM_Conv2D(benchmark::State& state, Conv2DShape s,
+               Conv2DAlgorithm algorithm) {
+  auto host = CreateTestHostContext(4);
+  ExecutionContext exec_ctx = CreateExecutionContext(host.get());
+
+  auto input = MakeRandomTensor(
+      host.get(), TensorShape({s.batch, s.height, s.width, s.in_channels}));
+  auto filter = MakeRandomTensor(
+      host.get(), TensorShape({s.filter_height, s.filter_width, s.in_channels,
+                               s.out_channels}));
+  auto bias = MakeRandomTensor(host.get(), TensorShape({s.out_channels}));
+  auto output = MakeRandomTensor(host.get(), OutputShape(s));
+
+  for (auto _ : state) {
+    Conv2DBiasAdd(input, filter, bias, &output, s.padding,
+                  {s.stride, s.stride}, algorithm, exec_ctx);
+  }
+}
+
+#define BENCHMARK_CONV2D(name, ...)                                        \
+  BENCHMARK_CAPTURE(BM_Conv2D, name##_Eigen, Conv2DShape{__VA_ARGS__},     \
+                    Conv2DAlgorithm::kEigen)                               \
+      ->UseRealTime();                                                     \
+  BENCHMARK_CAPTURE(BM_Conv2D, name##_Direct, Conv2DShape{__VA_ARGS__},    \
+                    Conv2DAlgorithm::kDirect)                              \
+      ->UseRealTime()
+
+BENCHMARK_CONV2D(Conv2_3x3, 1, 56, 56, 64, 3, 3, 64, 1, "same");
+BENCHMARK_CONV2D(Conv3_3x3, 1, 28, 28, 128, 3, 3, 128, 1, "same");
+BENCHMARK_CONV2D(Conv4_3x3, 1, 14, 14, 256, 3, 3, 256, 1, "same");
+BENCHMARK_CONV2D(Conv5_3x3, 1, 7, 7, 512, 3, 3, 512, 1, "same");
+BENCHMARK_CONV2D(Conv3_1x1_Stride2, 1, 56, 56, 256, 1, 1, 512, 2, "same");
+BENCHMARK_CONV2D(Conv2_1x1, 1, 56, 56, 64, 1, 1, 256, 1, "same");
+
+}  // namespace
+}  // namespace compat
+}  // namespace tfrt
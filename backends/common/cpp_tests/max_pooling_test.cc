@@ -0,0 +1,168 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Unit test and benchmarks for the MaxPool2D kernel.
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <random>
+
+#include "../lib/compat/eigen/kernels/max_pooling.h"
+#include "../lib/compat/eigen/kernels/zero_padding.h"
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+#include "tfrt/tensor/tensor_metadata.h"
+#include "tfrt/tensor/tensor_shape.h"
+
+namespace tfrt {
+namespace compat {
+namespace {
+
+std::unique_ptr<HostContext> CreateTestHostContext(int num_threads) {
+  return std::make_unique<HostContext>(
+      [](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+      CreateMultiThreadedWorkQueue(num_threads, num_threads));
+}
+
+ExecutionContext CreateExecutionContext(HostContext* host) {
+  Expected<RCReference<RequestContext>> req_ctx =
+      RequestContextBuilder(host, /*resource_context=*/nullptr).build();
+  assert(req_ctx);
+  return ExecutionContext(std::move(*req_ctx));
+}
+
+// Returns a tensor with the values in [-2, -1), so that the maximum is never
+// zero unless it comes from the zero padding.
+DenseHostTensor MakeNegativeTensor(HostContext* host,
+                                   const TensorShape& shape) {
+  TensorMetadata md(GetDType<float>(), shape);
+  auto tensor = DenseHostTensor::CreateUninitialized(md, host);
+  assert(tensor.has_value());
+  std::mt19937 gen(shape.GetNumElements());
+  std::uniform_real_distribution<float> dist(-2.0f, -1.0f);
+  for (float& value : MutableDHTArrayView<float>(&*tensor).Elements())
+    value = dist(gen);
+  return std::move(*tensor);
+}
+
+void MaxPool(const DenseHostTensor& input, DenseHostTensor* output,
+             string_view padding, Index ksize, Index stride,
+             ArrayRef<Index> zero_padding, const ExecutionContext& exec_ctx) {
+  const std::array<Index, 2> strides = {stride, stride};
+  const std::array<Index, 2> ksizes = {ksize, ksize};
+  AsyncValueRef<Chain> done = MaxPoolImpl<float>(
+      input, output, padding, strides, ksizes, exec_ctx, zero_padding);
+  exec_ctx.host()->Await(done.CopyRCRef());
+  ASSERT_FALSE(done.IsError());
+}
+
+TEST(MaxPoolingTest, SamePaddingIgnoresPadding) {
+  auto host = CreateTestHostContext(4);
+  ExecutionContext exec_ctx = CreateExecutionContext(host.get());
+
+  const Index height = 7, width = 6, channels = 37;
+  auto input = MakeNegativeTensor(host.get(),
+                                  TensorShape({2, height, width, channels}));
+  auto output =
+      MakeNegativeTensor(host.get(), TensorShape({2, 4, 3, channels}));
+  MaxPool(input, &output, "same", /*ksize=*/3, /*stride=*/2,
+          /*zero_padding=*/{}, exec_ctx);
+
+  DHTIndexableView<float, 4> in(&input);
+  DHTIndexableView<float, 4> out(&output);
+  for (Index b = 0; b < 2; ++b) {
+    for (Index y = 0; y < 4; ++y) {
+      for (Index x = 0; x < 3; ++x) {
+        for (Index c = 0; c < channels; ++c) {
+          // The "same" padding is one row on both sides and one column on
+          // the right.
+          float expected = std::numeric_limits<float>::lowest();
+          for (Index in_y = std::max(2 * y - 1, Index{0});
+               in_y < std::min(2 * y + 2, height); ++in_y) {
+            for (Index in_x = 2 * x; in_x < std::min(2 * x + 3, width);
+                 ++in_x) {
+              expected = std::max(expected, in.ElementAt(b, in_y, in_x, c));
+            }
+          }
+          ASSERT_EQ(out.ElementAt(b, y, x, c), expected);
+        }
+      }
+    }
+  }
+}
+
+TEST(MaxPoolingTest, ZeroPaddingMatchesPaddedInput) {
+  auto host = CreateTestHostContext(4);
+  ExecutionContext exec_ctx = CreateExecutionContext(host.get());
+
+  const Index channels = 70;
+  auto input = MakeNegativeTensor(host.get(), TensorShape({2, 9, 8, channels}));
+  auto padded =
+      MakeNegativeTensor(host.get(), TensorShape({2, 11, 10, channels}));
+  AsyncValueRef<Chain> padded_done =
+      TfPadImpl<float>(input, 1, 1, 1, 1, &padded, exec_ctx);
+  host->Await(padded_done.CopyRCRef());
+  ASSERT_FALSE(padded_done.IsError());
+
+  const TensorShape output_shape({2, 5, 4, channels});
+  auto expected = MakeNegativeTensor(host.get(), output_shape);
+  auto actual = MakeNegativeTensor(host.get(), output_shape);
+  MaxPool(padded, &expected, "valid", /*ksize=*/3, /*stride=*/2,
+          /*zero_padding=*/{}, exec_ctx);
+  const std::array<Index, 2> zero_padding = {1, 1};
+  MaxPool(input, &actual, "valid", /*ksize=*/3, /*stride=*/2, zero_padding,
+          exec_ctx);
+
+  auto expected_values = DHTArrayView<float>(&expected).Elements();
+  auto actual_values = DHTArrayView<float>(&actual).Elements();
+  for (size_t i = 0; i < expected_values.size(); ++i)
+    ASSERT_EQ(actual_values[i], expected_values[i]) << "at index " << i;
+}
+
+// -------------------------------------------------------------------------- //
+// MaxPool2D benchmark on the ResNet-50 pooling layer (batch size 1).
+// -------------------------------------------------------------------------- //
+
+static void BM_MaxPool2D(benchmark::State& state) {
+  auto host = CreateTestHostContext(4);
+  ExecutionContext exec_ctx = CreateExecutionContext(host.get());
+
+  auto input = MakeNegativeTensor(host.get(), TensorShape({1, 112, 112, 64}));
+  auto output = MakeNegativeTensor(host.get(), TensorShape({1, 56, 56, 64}));
+  const std::array<Index, 2> zero_padding = {1, 1};
+
+  for (auto _ : state) {
+    MaxPool(input, &output, "valid", /*ksize=*/3, /*stride=*/2, zero_padding,
+            exec_ctx);
+  }
+}
+
+BENCHMARK(BM_MaxPool2D)->UseRealTime();
+
+}  // namespace
+}  // namespace compat
+}  // namespace tfrt
@@ -0,0 +1,102 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Unit test for EigenScratchAllocator.
+
+#include "tfrt/common/compat/eigen/scratch_allocator.h"
+
+#include <cstdint>
+#include <memory>
+
+#include "gtest/gtest.h"
+#include "tfrt/common/compat/eigen/thread_pool_device.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+
+namespace tfrt {
+namespace compat {
+namespace {
+
+std::unique_ptr<HostContext> CreateTestHostContext(int num_threads) {
+  return std::make_unique<HostContext>(
+      [](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+      CreateMultiThreadedWorkQueue(num_threads, num_threads));
+}
+
+TEST(EigenScratchAllocatorTest, ReusesDeallocatedBuffers) {
+  auto host = CreateTestHostContext(1);
+  EigenScratchAllocator allocator(host.get());
+
+  void* a = allocator.allocate(1000);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(a) % EigenScratchAllocator::kAlignment,
+            0);
+  allocator.deallocate(a);
+  EXPECT_EQ(allocator.CachedBytes(), 1024);
+
+  // Sizes in the same power of two share the buffers.
+  void* b = allocator.allocate(600);
+  EXPECT_EQ(a, b);
+  EXPECT_EQ(allocator.CachedBytes(), 0);
+
+  void* c = allocator.allocate(1000);
+  EXPECT_NE(b, c);
+  EXPECT_EQ(allocator.NumHostAllocations(), 2);
+
+  allocator.deallocate(b);
+  allocator.deallocate(c);
+  EXPECT_EQ(allocator.CachedBytes(), 2048);
+}
+
+TEST(EigenScratchAllocatorTest, LimitsCachedBytes) {
+  auto host = CreateTestHostContext(1);
+  EigenScratchAllocator allocator(host.get(), /*max_cached_bytes=*/4096);
+
+  void* a = allocator.allocate(4096);
+  void* b = allocator.allocate(4096);
+  allocator.deallocate(a);
+  allocator.deallocate(b);
+  EXPECT_EQ(allocator.CachedBytes(), 4096);
+}
+
+TEST(EigenScratchAllocatorTest, EigenExpressionsDoNotAllocateInSteadyState) {
+  // With one thread the contraction does not allocate thread local buffers,
+  // so every evaluation allocates the same buffers.
+  auto host = CreateTestHostContext(1);
+  EigenHostContext ctx(host.get());
+
+  Eigen::Tensor<float, 2, Eigen::RowMajor> a(256, 128), b(128, 256);
+  Eigen::Tensor<float, 2, Eigen::RowMajor> out(256, 256);
+  a.setRandom();
+  b.setRandom();
+
+  // The contraction of a forced evaluation allocates the temporary tensor and
+  // the packing buffers through the device.
+  Eigen::array<Eigen::IndexPair<Eigen::Index>, 1> dims = {{{1, 0}}};
+  out.device(ctx.Device()) = (a * 2.0f).eval().contract(b, dims);
+  const size_t num_allocations =
+      ctx.ScratchAllocator().NumHostAllocations();
+  EXPECT_GT(num_allocations, 0);
+
+  for (int i = 0; i < 10; ++i)
+    out.device(ctx.Device()) = (a * 2.0f).eval().contract(b, dims);
+  EXPECT_EQ(ctx.ScratchAllocator().NumHostAllocations(), num_allocations);
+}
+
+}  // namespace
+}  // namespace compat
+}  // namespace tfrt
@@ -0,0 +1,132 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Unit test for EigenHostContext and AsyncEigenEvaluator.
+
+#include "tfrt/common/compat/eigen/thread_pool_device.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "tfrt/common/compat/eigen/eigen_evaluator.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/support/latch.h"
+
+namespace tfrt {
+namespace compat {
+namespace {
+
+std::unique_ptr<HostContext> CreateTestHostContext(int num_threads) {
+  return std::make_unique<HostContext>(
+      [](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+      CreateMultiThreadedWorkQueue(num_threads, num_threads));
+}
+
+TEST(EigenHostContextTest, CheapRangeRunsInCallerThread) {
+  auto host = CreateTestHostContext(4);
+  EigenHostContext ctx(host.get());
+
+  int num_blocks = 0;
+  bool done = false;
+  const std::thread::id caller = std::this_thread::get_id();
+  ctx.ParallelForAsync(
+      16, Eigen::TensorOpCost(4, 4, 1),
+      [&](Eigen::Index begin, Eigen::Index end) {
+        EXPECT_EQ(std::this_thread::get_id(), caller);
+        EXPECT_EQ(begin, 0);
+        EXPECT_EQ(end, 16);
+        ++num_blocks;
+      },
+      [&] { done = true; });
+
+  EXPECT_EQ(num_blocks, 1);
+  EXPECT_TRUE(done);
+}
+
+TEST(EigenHostContextTest, ExpensiveRangeIsComputedOnce) {
+  auto host = CreateTestHostContext(4);
+  EigenHostContext ctx(host.get());
+
+  constexpr int kSize = 1 << 16;
+  std::vector<std::atomic<int>> counts(kSize);
+  std::atomic<int> num_blocks{0};
+  latch done(1);
+  ctx.ParallelForAsync(
+      kSize, Eigen::TensorOpCost(64, 64, 1000),
+      [&](Eigen::Index begin, Eigen::Index end) {
+        ASSERT_LT(begin, end);
+        for (Eigen::Index i = begin; i < end; ++i) ++counts[i];
+        ++num_blocks;
+      },
+      [&] { done.count_down(); });
+  done.wait();
+
+  for (int i = 0; i < kSize; ++i) EXPECT_EQ(counts[i], 1) << i;
+  EXPECT_GT(num_blocks, 1);
+}
+
+TEST(EigenHostContextTest, ParallelForRunsInline) {
+  auto host = CreateTestHostContext(4);
+  EigenHostContext ctx(host.get());
+
+  EXPECT_TRUE(ctx.ParallelForRunsInline(0, Eigen::TensorOpCost(4, 4, 1)));
+  EXPECT_TRUE(ctx.ParallelForRunsInline(16, Eigen::TensorOpCost(4, 4, 1)));
+  EXPECT_FALSE(
+      ctx.ParallelForRunsInline(1 << 16, Eigen::TensorOpCost(64, 64, 1000)));
+}
+
+TEST(AsyncEigenEvaluatorTest, CheapRangeReturnsReadyChain) {
+  auto host = CreateTestHostContext(4);
+  AsyncEigenEvaluator evaluator(host.get());
+
+  int num_blocks = 0;
+  AsyncValueRef<Chain> chain = evaluator.ParallelFor(
+      16, Eigen::TensorOpCost(4, 4, 1),
+      [&](Eigen::Index, Eigen::Index) { ++num_blocks; },
+      evaluator.KeepAlive());
+
+  EXPECT_EQ(num_blocks, 1);
+  EXPECT_EQ(chain.GetAsyncValue(), GetReadyChain().GetAsyncValue());
+}
+
+TEST(AsyncEigenEvaluatorTest, ExpensiveRangeReturnsChain) {
+  auto host = CreateTestHostContext(4);
+  AsyncEigenEvaluator evaluator(host.get());
+
+  constexpr int kSize = 1 << 16;
+  std::atomic<int> num_elements{0};
+  AsyncValueRef<Chain> chain = evaluator.ParallelFor(
+      kSize, Eigen::TensorOpCost(64, 64, 1000),
+      [&](Eigen::Index begin, Eigen::Index end) {
+        num_elements += static_cast<int>(end - begin);
+      },
+      evaluator.KeepAlive());
+  host->Await({chain.CopyRCRef()});
+
+  EXPECT_TRUE(chain.IsConcrete());
+  EXPECT_EQ(num_elements, kSize);
+}
+
+}  // namespace
+}  // namespace compat
+}  // namespace tfrt
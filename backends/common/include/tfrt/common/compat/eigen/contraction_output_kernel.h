@@ -125,6 +125,53 @@ struct Elu {
   };
 };
 
+// Applies `LeakyRelu` with the slope `alpha` for the negative inputs.
+struct LeakyRelu {
+  explicit LeakyRelu(float alpha = 0.2f) : alpha(alpha) {}
+
+  template <typename XprType>
+  auto apply(XprType expr) const {
+    using Scalar = typename XprType::Scalar;
+    return (expr < static_cast<Scalar>(0))
+        .select(expr * static_cast<Scalar>(alpha), expr);
+  }
+
+  float alpha;
+};
+
+// Applies the tanh approximation of `Gelu`:
+//   0.5 * x * (1 + tanh(sqrt(2 / pi) * (x + 0.044715 * x^3)))
+struct GeluApproximate {
+  template <typename XprType>
+  static auto apply(XprType expr) {
+    using Scalar = typename XprType::Scalar;
+    const auto inner = (expr + expr.cube() * static_cast<Scalar>(0.044715)) *
+                       static_cast<Scalar>(0.7978845608028654);
+    return expr * static_cast<Scalar>(0.5) *
+           (inner.tanh() + static_cast<Scalar>(1));
+  }
+};
+
+// Applies the exact form of `Gelu`:
+//   0.5 * x * (1 + erf(x / sqrt(2)))
+struct GeluExact {
+  template <typename XprType>
+  static auto apply(XprType expr) {
+    using Scalar = typename XprType::Scalar;
+    return expr * static_cast<Scalar>(0.5) *
+           ((expr * static_cast<Scalar>(0.7071067811865476)).erf() +
+            static_cast<Scalar>(1));
+  }
+};
+
+// Applies `Swish`, also known as `SiLU`: x * sigmoid(x).
+struct Swish {
+  template <typename XprType>
+  static auto apply(XprType expr) {
+    return expr * expr.sigmoid();
+  }
+};
+
 // Adds bias to the output block inner dimension. Optionally applies activation
 // function specified by `Activation` type parameter.
 template <typename T, typename Activation = Identity>
@@ -133,8 +180,11 @@ class BiasAddOutputKernel {
   using Vec = Eigen::Tensor<T, 1, Eigen::RowMajor, Index>;
 
  public:
-  explicit BiasAddOutputKernel(const EigenConstTensor<T, 1>& bias)
-      : bias_data_(bias.data()), bias_size_(bias.size()) {}
+  explicit BiasAddOutputKernel(const EigenConstTensor<T, 1>& bias,
+                               Activation activation = Activation())
+      : bias_data_(bias.data()),
+        bias_size_(bias.size()),
+        activation_(activation) {}
 
   EIGEN_ALWAYS_INLINE void operator()(
       const internal::ContractionOutputMapper<T>& output_mapper,
@@ -156,13 +206,74 @@ class BiasAddOutputKernel {
       T* output_base = &output_mapper(0, col);
       OutputChannels output(output_base, num_rows);
       const auto expr = output + bias;
-      output = Activation::template apply<decltype(expr)>(expr);
+      output = activation_.template apply<decltype(expr)>(expr);
+    }
+  }
+
+ private:
+  const T* bias_data_;
+  const Index bias_size_;
+  Activation activation_;
+};
+
+// Adds bias to the output block inner dimension, and then the residual, which
+// has the shape of the MatMul output, e.g. the input of a transformer block.
+// Optionally applies activation function specified by `Activation` type
+// parameter. The residual may be of a narrower type that is converted to `T`.
+template <typename T, typename Activation = Identity, typename Residual = T>
+class BiasAddResidualOutputKernel {
+  using Index = Eigen::Index;
+  using Vec = Eigen::Tensor<T, 1, Eigen::RowMajor, Index>;
+  using ResidualVec = Eigen::Tensor<Residual, 1, Eigen::RowMajor, Index>;
+
+ public:
+  BiasAddResidualOutputKernel(const EigenConstTensor<T, 1>& bias,
+                              const EigenConstTensor<Residual, 2>& residual,
+                              Activation activation = Activation())
+      : bias_data_(bias.data()),
+        bias_size_(bias.size()),
+        residual_data_(residual.data()),
+        residual_rows_(residual.dimension(0)),
+        activation_(activation) {
+    assert(residual.dimension(1) == bias_size_ &&
+           "Residual inner dimension doesn't match the bias vector");
+  }
+
+  EIGEN_ALWAYS_INLINE void operator()(
+      const internal::ContractionOutputMapper<T>& output_mapper,
+      const Eigen::TensorContractionParams& params, Index i, Index j,
+      Index num_rows, Index num_cols) const {
+    using Bias = Eigen::TensorMap<const Vec, Eigen::Unaligned>;
+    using ResidualRow = Eigen::TensorMap<const ResidualVec, Eigen::Unaligned>;
+    using OutputChannels = Eigen::TensorMap<Vec, Eigen::Unaligned>;
+
+    assert(params.swapped_arguments &&
+           "Unexpected contraction output kernel parameters");
+    assert(i + num_rows <= bias_size_ &&
+           "Output block inner dimension is larger than the bias vector");
+    assert(j + num_cols <= residual_rows_ &&
+           "Output block has more rows than the residual");
+
+    const Bias bias(bias_data_ + i, num_rows);
+
+    // Every column of the output block is a slice of the MatMul output row
+    // `j + col`.
+    for (Index col = 0; col < num_cols; ++col) {
+      T* output_base = &output_mapper(0, col);
+      OutputChannels output(output_base, num_rows);
+      const ResidualRow residual(
+          residual_data_ + (j + col) * bias_size_ + i, num_rows);
+      const auto expr = output + bias + residual.template cast<T>();
+      output = activation_.template apply<decltype(expr)>(expr);
     }
   }
 
  private:
   const T* bias_data_;
   const Index bias_size_;
+  const Residual* residual_data_;
+  const Index residual_rows_;
+  Activation activation_;
 };
 
 template <typename T, typename Activation = Identity>
@@ -175,11 +286,12 @@ class BatchNormOutputKernel {
                         const EigenConstTensor<T, 1>& offset,
                         const EigenConstTensor<T, 1>& estimated_mean,
                         const EigenConstTensor<T, 1>& estimated_variance,
-                        float epsilon)
+                        float epsilon, Activation activation = Activation())
       : scale_data_(scale.data()),
         offset_data_(offset.data()),
         estimated_mean_data_(estimated_mean.data()),
-        estimated_variance_data_(estimated_variance.data()) {
+        estimated_variance_data_(estimated_variance.data()),
+        activation_(activation) {
     scaling_factor_ =
         (estimated_variance + static_cast<T>(epsilon)).rsqrt() * scale;
   }
@@ -215,7 +327,7 @@ class BatchNormOutputKernel {
       auto scaled = (output - mean) * scaling_factor;
       auto shifted = scaled + offset;
 
-      output = Activation::template apply<decltype(shifted)>(shifted);
+      output = activation_.template apply<decltype(shifted)>(shifted);
     }
   }
 
@@ -224,6 +336,7 @@ class BatchNormOutputKernel {
   const T* offset_data_;
   const T* estimated_mean_data_;
   const T* estimated_variance_data_;
+  Activation activation_;
 
   // Precomputed expression:
   //   scaling_factor = (estimated_variance + epsilon).rsqrt() * scale
@@ -21,16 +21,44 @@
 #define EIGEN_USE_THREADS
 
 #include "tfrt/dtype/dtype.h"
+#include "tfrt/support/bf16.h"
 #include "tfrt/support/fp16.h"
 #include "unsupported/Eigen/CXX11/Tensor"  // from @eigen_archive
 
 namespace tfrt {
 
 template <DType K>
-using EigenTypeForDTypeKind =
-    std::conditional_t<std::is_same<fp16, TypeForDTypeKind<K>>::value,
-                       Eigen::half, TypeForDTypeKind<K>>;
+using EigenTypeForDTypeKind = std::conditional_t<
+    std::is_same<fp16, TypeForDTypeKind<K>>::value, Eigen::half,
+    std::conditional_t<std::is_same<bf16, TypeForDTypeKind<K>>::value,
+                       Eigen::bfloat16, TypeForDTypeKind<K>>>;
 TFRT_REGISTER_DTYPE(Eigen::half, F16)
+TFRT_REGISTER_DTYPE(Eigen::bfloat16, BF16)
+
+namespace compat {
+
+// The type used to accumulate reductions and dot products of T values. The
+// 16-bit floating point types are only used for storage, and are computed in
+// float to avoid losing precision on every intermediate result.
+template <typename T>
+struct AccumulatorTypeFor {
+  using Type = T;
+};
+
+template <>
+struct AccumulatorTypeFor<Eigen::half> {
+  using Type = float;
+};
+
+template <>
+struct AccumulatorTypeFor<Eigen::bfloat16> {
+  using Type = float;
+};
+
+template <typename T>
+using AccumulatorType = typename AccumulatorTypeFor<T>::Type;
+
+}  // namespace compat
 }  // namespace tfrt
 
 namespace llvm {
@@ -46,6 +74,16 @@ struct PointerLikeTypeTraits<Eigen::half *> {
   // NOLINTNEXTLINE(readability-identifier-naming)
   static constexpr int NumLowBitsAvailable = 2;
 };
+template <>
+struct PointerLikeTypeTraits<Eigen::bfloat16 *> {
+  static inline void *getAsVoidPointer(Eigen::bfloat16 *ptr) { return ptr; }
+  static inline Eigen::bfloat16 *getFromVoidPointer(void *ptr) {
+    return static_cast<Eigen::bfloat16 *>(ptr);
+  }
+  // alignof(Eigen::bfloat16) == 2.
+  // NOLINTNEXTLINE(readability-identifier-naming)
+  static constexpr int NumLowBitsAvailable = 1;
+};
 }  // namespace llvm
 
 #endif  // TFRT_BACKENDS_COMMON_COMPAT_EIGEN_DTYPE_H_
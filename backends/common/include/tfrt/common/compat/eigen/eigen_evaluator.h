@@ -23,9 +23,12 @@
 #define TFRT_BACKENDS_COMMON_COMPAT_EIGEN_EVAULATOR_H_
 
 #include <cassert>
+#include <functional>
+#include <memory>
 #include <type_traits>
 
 #include "./thread_pool_device.h"
+#include "tfrt/host_context/chain.h"
 #include "tfrt/support/error_util.h"
 
 namespace tfrt {
@@ -69,6 +72,40 @@ class AsyncEigenEvaluator {
                        std::move(args));
   }
 
+  // Calls `compute(begin, end)` for blocks of the [0, n) range in parallel,
+  // and calls `done` when all blocks are computed. `cost` is the cost of
+  // computing one element, and decides the block sizes (see
+  // EigenHostContext::ParallelForAsync).
+  template <
+      typename Compute, typename DoneCallback,
+      typename = std::enable_if_t<internal::is_invocable<DoneCallback>::value>>
+  void ParallelFor(Eigen::Index n, const Eigen::TensorOpCost& cost,
+                   Compute compute, DoneCallback done) {
+    ctx_.ParallelForAsync(n, cost, std::move(compute), std::move(done));
+  }
+
+  // Same as above, but returns a chain that becomes available when all blocks
+  // are computed. `args` are kept alive until then. Ranges that are computed
+  // in the caller thread return the shared ready chain, and do not allocate.
+  template <typename Compute, typename ArgLifetimeExtension,
+            typename = std::enable_if_t<
+                !internal::is_invocable<ArgLifetimeExtension>::value>>
+  AsyncValueRef<Chain> ParallelFor(Eigen::Index n,
+                                   const Eigen::TensorOpCost& cost,
+                                   Compute compute, ArgLifetimeExtension args) {
+    if (ctx_.ParallelForRunsInline(n, cost)) {
+      if (n > 0) compute(0, n);
+      return GetReadyChain();
+    }
+
+    auto chain = MakeConstructedAsyncValueRef<Chain>();
+    ParallelFor(n, cost, std::move(compute),
+                [chain = chain.CopyRef(), args = std::move(args)]() {
+                  chain.SetStateConcrete();
+                });
+    return chain;
+  }
+
   template <typename... Args>
   DependencyToken MakeError(Args&&... args) {
     return MakeErrorAsyncValueRef(StrCat(std::forward<Args>(args)...));
@@ -121,6 +158,24 @@ class SyncEigenEvaluator {
     return Error::success();
   }
 
+  template <
+      typename Compute, typename DoneCallback,
+      typename = std::enable_if_t<internal::is_invocable<DoneCallback>::value>>
+  void ParallelFor(Eigen::Index n, const Eigen::TensorOpCost& cost,
+                   Compute compute, DoneCallback done) {
+    compute(0, n);
+    done();
+  }
+
+  template <typename Compute, typename ArgLifetimeExtension,
+            typename = std::enable_if_t<
+                !internal::is_invocable<ArgLifetimeExtension>::value>>
+  Error ParallelFor(Eigen::Index n, const Eigen::TensorOpCost& cost,
+                    Compute compute, ArgLifetimeExtension) {
+    compute(0, n);
+    return Error::success();
+  }
+
   template <typename... Args>
   Error MakeError(Args&&... args) {
     return MakeStringError(std::forward<Args>(args)...);
@@ -0,0 +1,89 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Scratch workspace allocator for Eigen expressions.
+//
+// Eigen allocates the temporary buffers of expression evaluation (forced evals,
+// contraction packing, partial reductions) through the device allocator on
+// every evaluation. EigenScratchAllocator keeps the deallocated buffers in
+// free lists, so that kernels evaluated repeatedly with the same shapes (e.g.
+// every step of a training loop) do not allocate in the steady state.
+
+#ifndef TFRT_BACKENDS_COMMON_COMPAT_EIGEN_SCRATCH_ALLOCATOR_H_
+#define TFRT_BACKENDS_COMMON_COMPAT_EIGEN_SCRATCH_ALLOCATOR_H_
+
+#define EIGEN_USE_THREADS
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+#include "unsupported/Eigen/CXX11/Tensor"  // from @eigen_archive
+
+namespace tfrt {
+namespace compat {
+
+class EigenScratchAllocator : public Eigen::Allocator {
+ public:
+  // The buffers are allocated from `host_context`. At most `max_cached_bytes`
+  // of deallocated buffers are kept for reuse, the rest are returned to the
+  // host allocator.
+  explicit EigenScratchAllocator(HostContext* host_context,
+                                 size_t max_cached_bytes = kMaxCachedBytes);
+  ~EigenScratchAllocator() override;
+
+  EigenScratchAllocator(const EigenScratchAllocator&) = delete;
+  void operator=(const EigenScratchAllocator&) = delete;
+
+  // Returns a buffer aligned to kAlignment bytes. Sizes are rounded up to a
+  // power of two, so that buffers of similar sizes are reused.
+  void* allocate(size_t num_bytes) const override;
+  void deallocate(void* buffer) const override;
+
+  // The number of bytes in the free lists.
+  size_t CachedBytes() const;
+  // The number of allocations that were not served from the free lists.
+  size_t NumHostAllocations() const;
+
+  // All the buffers are aligned for the widest Eigen packets.
+  static constexpr size_t kAlignment = 64;
+  static constexpr size_t kMaxCachedBytes = size_t{256} << 20;  // 256 MB
+
+ private:
+  // Size class `i` holds the buffers of (kMinSize << i) bytes.
+  static constexpr size_t kMinSize = 256;
+  static constexpr int kNumSizeClasses = 40;
+
+  static int SizeClass(size_t num_bytes);
+  static size_t ClassSize(int size_class) { return kMinSize << size_class; }
+
+  HostContext* const host_context_;
+  const size_t max_cached_bytes_;
+
+  mutable mutex mu_;
+  mutable std::array<std::vector<void*>, kNumSizeClasses> free_lists_
+      TFRT_GUARDED_BY(mu_);
+  mutable size_t cached_bytes_ TFRT_GUARDED_BY(mu_) = 0;
+  mutable size_t num_host_allocations_ TFRT_GUARDED_BY(mu_) = 0;
+};
+
+}  // namespace compat
+}  // namespace tfrt
+
+#endif  // TFRT_BACKENDS_COMMON_COMPAT_EIGEN_SCRATCH_ALLOCATOR_H_
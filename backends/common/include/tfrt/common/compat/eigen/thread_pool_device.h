@@ -22,11 +22,17 @@
 
 #define EIGEN_USE_THREADS
 
+#include <algorithm>
+#include <cstddef>
+
 #include "llvm/ADT/FunctionExtras.h"
+#include "tfrt/common/compat/eigen/scratch_allocator.h"
 #include "tfrt/host_context/async_dispatch.h"
 #include "tfrt/host_context/async_value_ref.h"
 #include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/execution_context.h"
 #include "tfrt/host_context/kernel_frame.h"
+#include "tfrt/host_context/parallel_for.h"
 #include "tfrt/host_context/shared_context.h"
 #include "tfrt/support/thread_local.h"
 #include "tfrt/tensor/dense_host_tensor.h"
@@ -41,22 +47,92 @@ namespace compat {
 
 class EigenHostContext : public SharedContext {
  public:
-  // TODO(ezhulenev): Pass a custom Eigen::Allocator that wraps HostContext
-  // AllocateBytes/DeallocateBytes.
+  // The device allocates the temporary buffers of Eigen expressions from the
+  // scratch allocator, which reuses them across kernel invocations.
   explicit EigenHostContext(HostContext* host_context)
       : host_context_(host_context),
         thread_pool_(host_context),
-        device_(&thread_pool_, thread_pool_.NumThreads()) {}
+        scratch_allocator_(host_context),
+        device_(&thread_pool_, thread_pool_.NumThreads(), &scratch_allocator_),
+        parallel_for_(ExecutionContext(
+            *RequestContextBuilder(host_context, /*resource_context=*/nullptr)
+                 .build())) {}
 
   EigenHostContext(const EigenHostContext&) = delete;
   void operator=(const EigenHostContext&) = delete;
 
   const Eigen::ThreadPoolInterface& ThreadPool() const { return thread_pool_; }
   const Eigen::ThreadPoolDevice& Device() const { return device_; }
+  const EigenScratchAllocator& ScratchAllocator() const {
+    return scratch_allocator_;
+  }
 
   HostContext* host() const { return host_context_; };
 
+  // Returns true if ParallelForAsync(n, cost, ...) computes the whole range in
+  // the caller thread, and calls `done` before returning.
+  bool ParallelForRunsInline(Eigen::Index n,
+                             const Eigen::TensorOpCost& cost) const {
+    return n <= 0 || MinBlockSize(n, cost) >= static_cast<size_t>(n);
+  }
+
+  // Calls `compute(begin, end)` for blocks of the [0, n) range and then
+  // `done`, like Eigen::ThreadPoolDevice::parallelForAsync(). `cost` is the
+  // cost of computing one element.
+  //
+  // Unlike the Eigen device, which enqueues a task for every block, blocks are
+  // claimed by the ParallelFor adaptive scheduler from at most one task per
+  // worker thread. Ranges that are too cheap to amortize a task are computed
+  // in the caller thread.
+  void ParallelForAsync(
+      Eigen::Index n, const Eigen::TensorOpCost& cost,
+      llvm::unique_function<void(Eigen::Index, Eigen::Index)> compute,
+      llvm::unique_function<void()> done) const {
+    const size_t block_size = MinBlockSize(n, cost);
+    if (block_size >= static_cast<size_t>(n)) {
+      if (n > 0) compute(0, n);
+      done();
+      return;
+    }
+    parallel_for_.Execute(
+        n, ParallelFor::BlockSizes::Adaptive(block_size),
+        [compute = std::move(compute)](size_t begin, size_t end) mutable {
+          compute(begin, end);
+        },
+        std::move(done));
+  }
+
  private:
+  // Returns the smallest block of the [0, n) range that is worth a task of its
+  // own, or `n` if the whole range should be computed in the caller thread.
+  size_t MinBlockSize(Eigen::Index n, const Eigen::TensorOpCost& cost) const {
+    using CostModel = Eigen::TensorCostModel<Eigen::ThreadPoolDevice>;
+
+    const int num_threads = thread_pool_.NumThreads();
+    if (n <= 1 || num_threads <= 1 ||
+        CostModel::numThreads(n, cost, num_threads) == 1)
+      return n;
+
+    // A block must cost at least one task in the Eigen cost model.
+    const double task_size = CostModel::taskSize(1, cost);
+    size_t block_size =
+        task_size > 0 ? static_cast<size_t>(1.0 / task_size) + 1 : 1;
+
+    // Blocks that stream through the L2 cache amortize the cost of claiming
+    // them, as long as there are still enough blocks for all worker threads.
+    const double bytes = cost.bytes_loaded() + cost.bytes_stored();
+    if (bytes > 0) {
+      const size_t l2_block_size =
+          static_cast<size_t>(Eigen::l2CacheSize() / bytes);
+      block_size = std::max(
+          block_size, std::min(l2_block_size, static_cast<size_t>(n) /
+                                                  num_threads));
+    }
+
+    return std::max<size_t>(1, block_size);
+  }
+
+
   //===--------------------------------------------------------------------===//
   // Eigen::ThreadPoolInterface implementation that wraps HostContext.
   //===--------------------------------------------------------------------===//
@@ -71,7 +147,13 @@ class EigenHostContext : public SharedContext {
     void Schedule(std::function<void()> fn) override {
       // TODO(tfrt-dev): Need to find a way to pass in ExecutionContext here for
       // the async task, so that the task can be scheduled properly.
-      EnqueueWork(host_context_, std::move(fn));
+      //
+      // Eigen splits its work across all threads, so ParallelFor calls from
+      // inside the closure must not split their work again.
+      EnqueueWork(host_context_, [fn = std::move(fn)]() {
+        ParallelFor::RegionScope scope;
+        fn();
+      });
     }
 
     // Returns the number of threads in the pool.
@@ -100,7 +182,9 @@ class EigenHostContext : public SharedContext {
 
   HostContext* host_context_;
   EigenHostContextThreadPool thread_pool_;
+  EigenScratchAllocator scratch_allocator_;
   Eigen::ThreadPoolDevice device_;
+  ParallelFor parallel_for_;
 };
 
 namespace internal {
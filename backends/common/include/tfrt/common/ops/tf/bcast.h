@@ -22,6 +22,8 @@
 #ifndef TFRT_BACKENDS_COMMON_OPS_TF_BCAST_H_
 #define TFRT_BACKENDS_COMMON_OPS_TF_BCAST_H_
 
+#include <optional>
+
 #include "tfrt/support/error_util.h"
 #include "tfrt/tensor/tensor_shape.h"
 
@@ -65,6 +67,32 @@ Expected<TensorShape> GetBroadcastedShape(const TensorShape& arg0_shape,
 Expected<ArgumentBCast> GetArgumentBCast(const TensorShape& argument_shape,
                                          const TensorShape& result_shape);
 
+// A broadcast of a binary operation that has a specialized kernel. One argument
+// has the result shape, and the other one is broadcast in one of the patterns
+// below, after collapsing adjacent dimensions that are broadcast the same way
+// and viewing the result as an [outer, middle, inner] tensor:
+//
+//   kRow:    [1, inner]           to [middle, inner]         e.g. BiasAdd
+//   kColumn: [outer, 1]           to [outer, middle]
+//   kMiddle: [outer, 1, inner]    to [outer, middle, inner]
+struct BinaryBCastFastPath {
+  enum class Pattern { kRow, kColumn, kMiddle };
+
+  Pattern pattern;
+  // True if the broadcast argument is the left hand side.
+  bool broadcast_lhs;
+  // Collapsed result dimensions. `outer` is 1 for kRow, and `inner` is 1 for
+  // kColumn.
+  Index outer;
+  Index middle;
+  Index inner;
+};
+
+// Returns the specialized broadcast of a binary operation with the given
+// argument broadcasts, or std::nullopt if it requires generic broadcasting.
+std::optional<BinaryBCastFastPath> GetBinaryBCastFastPath(
+    const ArgumentBCast& lhs_bcast, const ArgumentBCast& rhs_bcast);
+
 }  // namespace tfrt
 
 #endif  // TFRT_BACKENDS_COMMON_OPS_TF_BCAST_H_
@@ -16,17 +16,60 @@
 //
 // Batch normalization gradient kernels implemented with Eigen.
 
+#include <algorithm>
+#include <cmath>
+
 #include "llvm/Support/Errc.h"
 #include "llvm/Support/Error.h"
 #include "tfrt/common/compat/eigen/eigen_kernel.h"
 #include "tfrt/common/compat/eigen/kernels/shape_functions.h"
-#include "tfrt/common/compat/eigen/tensor_types.h"
 #include "tfrt/host_context/host_context.h"
 #include "tfrt/host_context/kernel_utils.h"
 #include "tfrt/tensor/dense_host_tensor_view.h"
 
 namespace tfrt {
 namespace compat {
+namespace {
+
+// The partial channel sums of BatchNormGrad are computed by blocks of at least
+// kMinRowsPerBlock rows, with up to kBlocksPerThread blocks per thread.
+constexpr Index kMinRowsPerBlock = 64;
+constexpr Index kBlocksPerThread = 4;
+
+// Computes the sums of `output_grad` and `output_grad * (input - mean)` over
+// the rows [begin, end) of the [rows, depth] inputs into `sums[0, depth)` and
+// `sums[depth, 2 * depth)` respectively.
+template <typename T>
+void SumChannels(const T* output_grad, const T* input, const T* mean,
+                 Index depth, Index begin, Index end, T* sums) {
+  T* output_grad_sum = sums;
+  T* output_grad_centered_sum = sums + depth;
+  std::fill(sums, sums + 2 * depth, T(0));
+  for (Index row = begin; row < end; ++row) {
+    const T* dy = output_grad + row * depth;
+    const T* x = input + row * depth;
+    for (Index c = 0; c < depth; ++c) {
+      output_grad_sum[c] += dy[c];
+      output_grad_centered_sum[c] += dy[c] * (x[c] - mean[c]);
+    }
+  }
+}
+
+// Adds up `num_blocks` consecutive vectors of `size` elements into the first
+// one, pairwise in a tree, so that the rounding error grows with the depth of
+// the tree rather than with the number of blocks.
+template <typename T>
+void TreeReduce(T* blocks, Index num_blocks, Index size) {
+  for (Index stride = 1; stride < num_blocks; stride *= 2) {
+    for (Index block = 0; block + stride < num_blocks; block += 2 * stride) {
+      T* dst = blocks + block * size;
+      const T* src = blocks + (block + stride) * size;
+      for (Index i = 0; i < size; ++i) dst[i] += src[i];
+    }
+  }
+}
+
+}  // namespace
 
 template <typename T>
 static void BatchNormGrad(
@@ -95,44 +138,25 @@ static void BatchNormGrad(
 
   // Flatten all outer dimensions of input{grad}/output_grad.
   const Index rest_size = output_grad->NumElements() / depth;
-  Eigen::DSizes<Eigen::Index, 2> rest_by_depth(rest_size, depth);
-
-  // Resize all vectors into 2d Tensors.
-  Eigen::DSizes<Eigen::Index, 2> one_by_depth(1, depth);
-
-  // Compute reductions (sum and mean) over outer dimension (after flattening).
-  Eigen::DSizes<int, 1> reduce_dims(0);
-
-  // Broadcast 1d vectors to the input/output shape.
-  Eigen::DSizes<int, 2> bcast_spec(rest_size, 1);
 
   auto& ctx = exec_ctx.host()->GetOrCreateSharedContext<EigenHostContext>();
-
-  // Reshape input/output arguments into [rest_size, depth] tensors.
-  const FixedRankShape<2> rest_by_depth_s = AsShape(rest_by_depth);
-
-  auto output_grad_t = AsEigenConstTensor(output_grad.get(), rest_by_depth_s);
-  auto input_t = AsEigenConstTensor(input.get(), rest_by_depth_s);
-  auto input_grad_t = AsEigenTensor(input_grad.get(), rest_by_depth_s);
-
-  // Reshape input vectors into [1, depth] tensors.
-  const FixedRankShape<2> one_by_depth_s = AsShape(one_by_depth);
-
-  auto gamma_t = AsEigenConstTensor<T>(&*gamma, one_by_depth_s);
-  auto mean_t = AsEigenConstTensor<T>(&*moving_mean, one_by_depth_s);
-  auto variance_t = AsEigenConstTensor<T>(&*moving_variance, one_by_depth_s);
-
-  // Output gradients of [depth] shape.
-  auto gamma_grad_t = AsEigenTensor<T>(&*gamma_grad);
-  auto beta_grad_t = AsEigenTensor<T>(&*beta_grad);
-
-  T rest_size_inv = static_cast<T>(1.0f / static_cast<T>(rest_size));
-
-  auto coef0 = (variance_t + epsilon.get()).rsqrt();            // [1, depth]
-  auto coef1 = (gamma_t * coef0).eval().broadcast(bcast_spec);  // [rest, depth]
-
-  auto input_centered = (input_t - mean_t.broadcast(bcast_spec));
-  auto input_scaled = input_centered * (coef0.eval().broadcast(bcast_spec));
+  const Eigen::ThreadPoolDevice& device = ctx.Device();
+
+  // Every block of rows computes partial channel sums into its own slice of
+  // the workspace, followed by the per-channel coefficients:
+  //   [num_blocks, 2, depth] partial sums of output_grad and
+  //                          output_grad * (x - mean(x))
+  //   [3, depth]             coefficients of the input gradient
+  const Index num_blocks = std::max<Index>(
+      1, std::min<Index>(rest_size / kMinRowsPerBlock,
+                         kBlocksPerThread * ctx.ThreadPool().NumThreads()));
+  const Index rows_per_block = (rest_size + num_blocks - 1) / num_blocks;
+  const size_t workspace_size = (2 * num_blocks + 3) * depth * sizeof(T);
+  T* workspace = static_cast<T*>(device.allocate(workspace_size));
+  if (workspace == nullptr) {
+    handler.ReportError("failed to allocate BatchNormGrad workspace");
+    return;
+  }
 
   // Allocate output chains for all results, because they must be not null
   // before we copy the kernel frame below.
@@ -140,44 +164,82 @@ static void BatchNormGrad(
   auto gamma_grad_ready = gamma_grad_chain.Allocate();
   auto beta_grad_ready = beta_grad_chain.Allocate();
 
-  //=== gamma/scale gradient ----------------------------------------------===//
-  auto gamma_grad_expr = (output_grad_t * input_scaled).sum(reduce_dims);
-
-  AsyncAssign(ctx, std::move(gamma_grad_t), std::move(gamma_grad_expr),
-              [chain = std::move(gamma_grad_ready), frame = *frame]() {
-                chain.emplace();
-              });
-
-  //=== beta/offset gradient ----------------------------------------------===//
-  auto output_grad_sum = output_grad_t.sum(reduce_dims);
-
-  AsyncAssign(ctx, std::move(beta_grad_t), output_grad_sum,
-              [chain = std::move(beta_grad_ready), frame = *frame]() {
-                chain.emplace();
-              });
+  const T* output_grad_data = output_grad->data();
+  const T* input_data = input->data();
+  T* input_grad_data = input_grad->data();
+  const T* gamma_data = static_cast<const T*>(gamma->data());
+  const T* mean_data = static_cast<const T*>(moving_mean->data());
+  const T* variance_data = static_cast<const T*>(moving_variance->data());
+  T* gamma_grad_data = static_cast<T*>(gamma_grad->data());
+  T* beta_grad_data = static_cast<T*>(beta_grad->data());
+  const T eps = static_cast<T>(epsilon.get());
+
+  //=== partial sums ------------------------------------------------------===//
+  auto sum_blocks = [=](Index begin, Index end) {
+    for (Index block = begin; block < end; ++block) {
+      const Index row_begin = block * rows_per_block;
+      const Index row_end = std::min(rest_size, row_begin + rows_per_block);
+      SumChannels(output_grad_data, input_data, mean_data, depth, row_begin,
+                  row_end, workspace + 2 * block * depth);
+    }
+  };
 
   //=== input gradient ----------------------------------------------------===//
-  auto output_grad_sum_one_by_depth =
-      output_grad_sum.eval().reshape(one_by_depth);
-  auto output_grad_mean_one_by_depth =
-      output_grad_sum_one_by_depth * rest_size_inv;
-  auto output_grad_mean = output_grad_mean_one_by_depth.broadcast(bcast_spec);
-
-  auto output_grad_centered = output_grad_t - output_grad_mean;
-
-  auto coef2 =
-      (coef0.square() *
-       (output_grad_t * input_centered).mean(reduce_dims).reshape(one_by_depth))
-          .eval()
-          .broadcast(bcast_spec);
-
-  auto input_grad_expr =
-      coef1 * (output_grad_centered - input_centered * coef2);
-
-  AsyncAssign(ctx, std::move(input_grad_t), std::move(input_grad_expr),
-              [chain = std::move(input_grad_ready), frame = *frame]() {
-                chain.emplace();
-              });
+  T* coef1 = workspace + 2 * num_blocks * depth;
+  T* output_grad_mean = coef1 + depth;
+  T* coef2 = output_grad_mean + depth;
+  auto input_grad_rows = [=](Index begin, Index end) {
+    for (Index row = begin; row < end; ++row) {
+      const T* dy = output_grad_data + row * depth;
+      const T* x = input_data + row * depth;
+      T* dx = input_grad_data + row * depth;
+      for (Index c = 0; c < depth; ++c) {
+        dx[c] = coef1[c] * (dy[c] - output_grad_mean[c] -
+                            (x[c] - mean_data[c]) * coef2[c]);
+      }
+    }
+  };
+
+  // The gamma and beta gradients, and the coefficients of the input gradient,
+  // are computed from the sums of all blocks.
+  auto reduce_blocks = [=, &ctx, &device, frame = *frame,
+                        input_grad_ready = std::move(input_grad_ready),
+                        gamma_grad_ready = std::move(gamma_grad_ready),
+                        beta_grad_ready = std::move(beta_grad_ready),
+                        input_grad_rows =
+                            std::move(input_grad_rows)]() mutable {
+    TreeReduce(workspace, num_blocks, 2 * depth);
+    const T* output_grad_sum = workspace;
+    const T* output_grad_centered_sum = workspace + depth;
+
+    const T rest_size_inv = static_cast<T>(1.0f / static_cast<T>(rest_size));
+    for (Index c = 0; c < depth; ++c) {
+      const T coef0 = T(1) / std::sqrt(variance_data[c] + eps);
+      gamma_grad_data[c] = output_grad_centered_sum[c] * coef0;
+      beta_grad_data[c] = output_grad_sum[c];
+      coef1[c] = gamma_data[c] * coef0;
+      output_grad_mean[c] = output_grad_sum[c] * rest_size_inv;
+      coef2[c] = coef0 * coef0 * output_grad_centered_sum[c] * rest_size_inv;
+    }
+    gamma_grad_ready.emplace();
+    beta_grad_ready.emplace();
+
+    const Eigen::TensorOpCost row_cost(2 * depth * sizeof(T),
+                                       depth * sizeof(T), 5 * depth);
+    ctx.ParallelForAsync(
+        rest_size, row_cost, std::move(input_grad_rows),
+        [&device, workspace, frame = std::move(frame),
+         chain = std::move(input_grad_ready)]() {
+          device.deallocate(workspace);
+          chain.emplace();
+        });
+  };
+
+  const Eigen::TensorOpCost block_cost(2 * rows_per_block * depth * sizeof(T),
+                                       2 * depth * sizeof(T),
+                                       3 * rows_per_block * depth);
+  ctx.ParallelForAsync(num_blocks, block_cost, std::move(sum_blocks),
+                       std::move(reduce_blocks));
 }
 
 }  // namespace compat
@@ -14,14 +14,17 @@
  * limitations under the License.
  */
 
-// Conv2D kernel implementation using Eigen contraction.
+// Conv2D kernel implementation using Eigen contraction, or the direct kernel
+// for small filters.
 
 #ifndef TFRT_BACKENDS_COMMON_LIB_COMPAT_EIGEN_KERNELS_CONV2D_H_
 #define TFRT_BACKENDS_COMMON_LIB_COMPAT_EIGEN_KERNELS_CONV2D_H_
 
 #include <cstdint>
+#include <utility>
 
 #include "conv2d_shape_functions.h"
+#include "direct_conv2d.h"
 #include "llvm/Support/Errc.h"
 #include "llvm/Support/Error.h"
 #include "tfrt/common/compat/eigen/contraction_output_kernel.h"
@@ -69,12 +72,19 @@ inline llvm::Error CheckBatchNormArgs(const Conv2DParams& params,
   return llvm::Error::success();
 }
 
+// Algorithms that compute Conv2D. kDefault picks the most efficient one for the
+// convolution parameters, the others are mostly useful for benchmarks. kDirect
+// falls back to Eigen if the direct kernel does not support the filter.
+enum class Conv2DAlgorithm { kDefault, kEigen, kDirect };
+
 template <typename T, typename OutputKernelBuilder>
 inline AsyncValueRef<Chain> Conv2DImpl(
     const DenseHostTensor& input, const DenseHostTensor& filter,
     DenseHostTensor* output, string_view padding, ArrayRef<Index> strides,
     OutputKernelBuilder output_kernel_builder,
-    const ExecutionContext& exec_ctx) {
+    const ExecutionContext& exec_ctx,
+    Conv2DAlgorithm algorithm = Conv2DAlgorithm::kDefault,
+    ArrayRef<Index> zero_padding = {}) {
   DHTIndexableView<T, 4> input_view(&input);
   DHTIndexableView<T, 4> filter_view(&filter);
   MutableDHTIndexableView<T, 4> output_view(output);
@@ -86,7 +96,7 @@ inline AsyncValueRef<Chain> Conv2DImpl(
   // Validate convolution parameters.
   auto params =
       ComputeConv2DParams(input_view.FixedShape(), filter_view.FixedShape(),
-                          padding, {strides[0], strides[1]});
+                          padding, {strides[0], strides[1]}, zero_padding);
   if (auto error = params.takeError()) {
     return EmitErrorAsync(exec_ctx, StrCat(error));
   }
@@ -103,11 +113,23 @@ inline AsyncValueRef<Chain> Conv2DImpl(
   }
 
   const FixedRankShape<4>& kernel_shape = filter_view.FixedShape();
-
-  // 1x1 convolution can be computed as a simple Tensor contraction.
-  if (kernel_shape[0] == 1 && kernel_shape[1] == 1 &&  // 1x1 kernel
+  const bool is_1x1_contraction =
+      kernel_shape[0] == 1 && kernel_shape[1] == 1 &&  // 1x1 kernel
       strides[0] == 1 && strides[1] == 1 &&            // 1x1 stride
-      params->padding_type != PaddingType::kExplicit) {
+      params->padding_type != PaddingType::kExplicit;
+
+  // Other small filters (e.g. 3x3, or 1x1 with strides) are computed by the
+  // direct kernel, which does not pack the input patches.
+  const bool use_direct =
+      IsDirectConv2DSupported(*params) &&
+      (algorithm == Conv2DAlgorithm::kDirect ||
+       (algorithm == Conv2DAlgorithm::kDefault && !is_1x1_contraction));
+
+  if (use_direct) {
+    return DirectConv2D<T>(input, filter, output, *params,
+                           std::move(output_kernel.get()), exec_ctx);
+  } else if (is_1x1_contraction) {
+    // 1x1 convolution can be computed as a simple Tensor contraction.
     const Index rest_size = params->output_shape[0] *  // batch
                             params->output_shape[1] *  // output height
                             params->output_shape[2];   // output width
@@ -148,14 +170,14 @@ inline AsyncValueRef<Chain> Conv2DImpl(
   }
 }
 
-template <typename T, typename Activation = Identity>
-AsyncValueRef<Chain> Conv2DBatchNorm(
+template <typename T, typename Activation>
+AsyncValueRef<Chain> Conv2DBatchNormImpl(
     const DenseHostTensor& input, const DenseHostTensor& filter,
     const DenseHostTensor& scale,   // aka gamma
     const DenseHostTensor& offset,  // aka beta
     const DenseHostTensor& mean, const DenseHostTensor& variance,
-    DenseHostTensor* output, Chain chain_in, Attribute<float> epsilon,
-    StringAttribute padding, ArrayAttribute<Index> strides,
+    DenseHostTensor* output, Attribute<float> epsilon, StringAttribute padding,
+    ArrayAttribute<Index> strides, ArrayRef<Index> zero_padding,
     const ExecutionContext& exec_ctx) {
   using OutputKernel = llvm::Expected<BatchNormOutputKernel<T, Activation>>;
 
@@ -182,7 +204,38 @@ AsyncValueRef<Chain> Conv2DBatchNorm(
   };
 
   return Conv2DImpl<T>(input, filter, output, padding.get(), strides.data(),
-                       std::move(output_kernel), exec_ctx);
+                       std::move(output_kernel), exec_ctx,
+                       Conv2DAlgorithm::kDefault, zero_padding);
+}
+
+template <typename T, typename Activation = Identity>
+AsyncValueRef<Chain> Conv2DBatchNorm(
+    const DenseHostTensor& input, const DenseHostTensor& filter,
+    const DenseHostTensor& scale,   // aka gamma
+    const DenseHostTensor& offset,  // aka beta
+    const DenseHostTensor& mean, const DenseHostTensor& variance,
+    DenseHostTensor* output, Chain chain_in, Attribute<float> epsilon,
+    StringAttribute padding, ArrayAttribute<Index> strides,
+    const ExecutionContext& exec_ctx) {
+  return Conv2DBatchNormImpl<T, Activation>(
+      input, filter, scale, offset, mean, variance, output, epsilon, padding,
+      strides, /*zero_padding=*/{}, exec_ctx);
+}
+
+// Conv2DBatchNorm of the input padded with `zero_padding` zeros, see the
+// ZeroPadding kernel. The padded input is not materialized.
+template <typename T, typename Activation = Identity>
+AsyncValueRef<Chain> ZeroPaddingConv2DBatchNorm(
+    const DenseHostTensor& input, const DenseHostTensor& filter,
+    const DenseHostTensor& scale,   // aka gamma
+    const DenseHostTensor& offset,  // aka beta
+    const DenseHostTensor& mean, const DenseHostTensor& variance,
+    DenseHostTensor* output, Chain chain_in, Attribute<float> epsilon,
+    StringAttribute padding, ArrayAttribute<Index> strides,
+    ArrayAttribute<Index> zero_padding, const ExecutionContext& exec_ctx) {
+  return Conv2DBatchNormImpl<T, Activation>(
+      input, filter, scale, offset, mean, variance, output, epsilon, padding,
+      strides, zero_padding.data(), exec_ctx);
 }
 
 template <typename T, typename Activation = Identity>
@@ -208,6 +261,86 @@ AsyncValueRef<Chain> Conv2DBias(const DenseHostTensor& input,
                        std::move(output_kernel), exec_ctx);
 }
 
+// Folds the batch normalization of the output of a convolution into its
+// filter and a bias, so that Conv2DBias with the returned {filter, bias}
+// computes the same values as Conv2DBatchNorm with the arguments:
+//
+//   factor = scale * rsqrt(variance + epsilon)
+//   folded_filter[..., c] = filter[..., c] * factor[c]
+//   bias = offset - mean * factor
+template <typename T>
+llvm::Expected<std::pair<DenseHostTensor, DenseHostTensor>> FoldBatchNormImpl(
+    const DenseHostTensor& filter, const DenseHostTensor& scale,
+    const DenseHostTensor& offset, const DenseHostTensor& mean,
+    const DenseHostTensor& variance, T epsilon, HostContext* host) {
+  DHTIndexableView<T, 4> filter_view(&filter);
+  const FixedRankShape<4>& filter_shape = filter_view.FixedShape();
+  const Index channels = filter_shape[3];
+
+  DHTIndexableView<T, 1> scale_view(&scale);
+  DHTIndexableView<T, 1> offset_view(&offset);
+  DHTIndexableView<T, 1> mean_view(&mean);
+  DHTIndexableView<T, 1> variance_view(&variance);
+  for (const auto& shape : {scale_view.FixedShape(), offset_view.FixedShape(),
+                            mean_view.FixedShape(),
+                            variance_view.FixedShape()}) {
+    if (auto err = CheckDimensionMatch("batch norm parameter size", shape[0],
+                                       "output channels size", channels))
+      return std::move(err);
+  }
+
+  auto folded_filter =
+      DenseHostTensor::CreateUninitialized<T>(filter.shape(), host);
+  auto bias =
+      DenseHostTensor::CreateUninitialized<T>(TensorShape({channels}), host);
+  if (!folded_filter.has_value() || !bias.has_value())
+    return MakeStringError("cannot allocate folded batch norm tensors");
+
+  const Eigen::Tensor<T, 1, Eigen::RowMajor> factor =
+      (AsEigenConstTensor(variance_view) + epsilon).rsqrt() *
+      AsEigenConstTensor(scale_view);
+
+  MutableDHTIndexableView<T, 1> bias_view(&*bias);
+  AsEigenTensor(bias_view) =
+      AsEigenConstTensor(offset_view) - AsEigenConstTensor(mean_view) * factor;
+
+  // The filter is a [height * width * in_channels, out_channels] matrix.
+  const Index rest_size = filter_shape[0] * filter_shape[1] * filter_shape[2];
+  const FixedRankShape<2> rest_by_depth({rest_size, channels});
+  const Eigen::array<Index, 2> one_by_depth = {1, channels};
+  const Eigen::array<Index, 2> rest_by_one = {rest_size, 1};
+
+  MutableDHTIndexableView<T, 4> folded_view(&*folded_filter);
+  AsEigenTensor(folded_view, rest_by_depth) =
+      AsEigenConstTensor(filter_view, rest_by_depth) *
+      factor.reshape(one_by_depth).broadcast(rest_by_one);
+
+  return std::make_pair(std::move(*folded_filter), std::move(*bias));
+}
+
+template <typename T>
+void FoldBatchNorm(const DenseHostTensor& filter,
+                   const DenseHostTensor& scale,   // aka gamma
+                   const DenseHostTensor& offset,  // aka beta
+                   const DenseHostTensor& mean,
+                   const DenseHostTensor& variance, Chain chain_in,
+                   Result<DenseHostTensor> folded_filter,
+                   Result<DenseHostTensor> bias, Result<Chain> chain_out,
+                   Attribute<float> epsilon, KernelErrorHandler handler,
+                   const ExecutionContext& exec_ctx) {
+  auto folded = FoldBatchNormImpl<T>(filter, scale, offset, mean, variance,
+                                     static_cast<T>(epsilon.get()),
+                                     exec_ctx.host());
+  if (!folded) {
+    handler.ReportError(StrCat(folded.takeError()));
+    return;
+  }
+
+  folded_filter.Emplace(std::move(folded->first));
+  bias.Emplace(std::move(folded->second));
+  chain_out.Set(chain_in);
+}
+
 }  // namespace internal
 }  // namespace compat
 }  // namespace tfrt
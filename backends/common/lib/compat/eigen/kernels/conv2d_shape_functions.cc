@@ -26,15 +26,40 @@
 namespace tfrt {
 namespace compat {
 
+llvm::Expected<std::array<std::optional<Padding>, 2>> ComputeZeroPadding(
+    PaddingType* padding_type, ArrayRef<Index> zero_padding) {
+  std::array<std::optional<Padding>, 2> paddings;
+  if (zero_padding.empty()) return paddings;
+
+  if (zero_padding.size() != 2) {
+    return llvm::createStringError(llvm::errc::invalid_argument,
+                                   "Zero padding must have 2 elements");
+  }
+  if (*padding_type != PaddingType::kValid) {
+    return llvm::createStringError(
+        llvm::errc::invalid_argument,
+        "Zero padding can only be fused with the valid padding");
+  }
+
+  *padding_type = PaddingType::kExplicit;
+  paddings[0] = Padding{zero_padding[0], zero_padding[0]};
+  paddings[1] = Padding{zero_padding[1], zero_padding[1]};
+  return paddings;
+}
+
 // Computes convolution parameters from the padding type and input/kernel
 // shapes. Returns error if input shapes does not match expectations.
 llvm::Expected<Conv2DParams> ComputeConv2DParams(
     const FixedRankShape<4>& input_shape, const FixedRankShape<4>& kernel_shape,
-    string_view padding, std::array<Index, 2> strides) {
+    string_view padding, std::array<Index, 2> strides,
+    ArrayRef<Index> zero_padding) {
   // Padding must be a valid string.
   auto padding_type = ParsePaddingType(padding);
   if (!padding_type) return padding_type.takeError();
 
+  auto explicit_paddings = ComputeZeroPadding(&*padding_type, zero_padding);
+  if (!explicit_paddings) return explicit_paddings.takeError();
+
   // Input channels dimension size must match kernel dimension.
   auto channels_error = CheckDimensionMatch("input channels", input_shape[3],
                                             "kernel depth", kernel_shape[2]);
@@ -45,12 +70,12 @@ llvm::Expected<Conv2DParams> ComputeConv2DParams(
 
   auto output_height = ComputeWindowedOutputDimension(
       input_shape[1], kernel_shape[0], strides[0], dilations[0], *padding_type,
-      /*explicit_padding=*/std::nullopt);
+      (*explicit_paddings)[0]);
   if (!output_height) return output_height.takeError();
 
   auto output_width = ComputeWindowedOutputDimension(
       input_shape[2], kernel_shape[1], strides[1], dilations[1], *padding_type,
-      /*explicit_padding=*/std::nullopt);
+      (*explicit_paddings)[1]);
   if (!output_width) return output_width.takeError();
 
   // Expected output shape.
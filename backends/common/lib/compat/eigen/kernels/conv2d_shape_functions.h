@@ -20,10 +20,13 @@
 #define TFRT_BACKENDS_COMMON_LIB_COMPAT_EIGEN_KERNELS_CONV2D_SHAPE_FUNCTIONS_H_
 
 #include <array>
+#include <optional>
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/Support/Errc.h"
 #include "llvm/Support/Error.h"
 #include "tfrt/common/compat/eigen/kernels/shape_functions.h"
+#include "tfrt/support/forward_decls.h"
 #include "tfrt/tensor/tensor_shape.h"
 
 namespace tfrt {
@@ -43,9 +46,21 @@ struct Conv2DParams {
 
 // Computes convolution parameters from the padding type and input/kernel
 // shapes. Returns error if input shapes does not match expectations.
+//
+// Non-empty `zero_padding` is the [height, width] number of zeros added on
+// both sides of the input, as computed by the ZeroPadding kernel. It becomes
+// an explicit padding of the convolution, so the padded input is never
+// materialized. It can only be combined with the "valid" padding.
 llvm::Expected<Conv2DParams> ComputeConv2DParams(
     const FixedRankShape<4>& input_shape, const FixedRankShape<4>& kernel_shape,
-    string_view padding, std::array<Index, 2> strides);
+    string_view padding, std::array<Index, 2> strides,
+    ArrayRef<Index> zero_padding = {});
+
+// Converts the ZeroPadding kernel padding fused into a windowed kernel with
+// the `padding_type` to the explicit paddings of its height and width
+// dimensions. Returns std::nullopt paddings if `zero_padding` is empty.
+llvm::Expected<std::array<std::optional<Padding>, 2>> ComputeZeroPadding(
+    PaddingType* padding_type, ArrayRef<Index> zero_padding);
 
 }  // namespace compat
 }  // namespace tfrt
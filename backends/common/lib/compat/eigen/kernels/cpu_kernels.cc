@@ -48,6 +48,18 @@ static AsyncValueRef<Chain> MaxPool2D(const DenseHostTensor& input,
                         ksize.data(), exec_ctx);
 }
 
+// MaxPool2D of the input padded with ZeroPadding, without materializing the
+// padded input.
+template <typename T>
+static AsyncValueRef<Chain> ZeroPaddingMaxPool2D(
+    const DenseHostTensor& input, DenseHostTensor* output, Chain chain_in,
+    StringAttribute padding, ArrayAttribute<Index> ksize,
+    ArrayAttribute<Index> strides, ArrayAttribute<Index> zero_padding,
+    const ExecutionContext& exec_ctx) {
+  return MaxPoolImpl<T>(input, output, padding.get(), strides.data(),
+                        ksize.data(), exec_ctx, zero_padding.data());
+}
+
 template <typename T>
 static AsyncValueRef<Chain> Conv2D(const DenseHostTensor& input,
                                    const DenseHostTensor& filter,
@@ -65,6 +77,25 @@ static AsyncValueRef<Chain> Conv2D(const DenseHostTensor& input,
                                  exec_ctx);
 }
 
+// Conv2D of the input padded with ZeroPadding, without materializing the
+// padded input.
+template <typename T>
+static AsyncValueRef<Chain> ZeroPaddingConv2D(
+    const DenseHostTensor& input, const DenseHostTensor& filter,
+    DenseHostTensor* output, Chain chain_in, StringAttribute padding,
+    ArrayAttribute<Index> strides, ArrayAttribute<Index> zero_padding,
+    const ExecutionContext& exec_ctx) {
+  using OutputKernel = llvm::Expected<Eigen::NoOpOutputKernel>;
+  auto output_kernel = [](Conv2DParams) -> OutputKernel {
+    return Eigen::NoOpOutputKernel();
+  };
+
+  return internal::Conv2DImpl<T>(
+      input, filter, output, padding.get(), strides.data(),
+      std::move(output_kernel), exec_ctx, internal::Conv2DAlgorithm::kDefault,
+      zero_padding.data());
+}
+
 template <typename T>
 static AsyncValueRef<Chain> FusedBatchNormV3Kernel(
     DenseHostTensor* input, const DenseHostTensor& scale,
@@ -92,6 +123,25 @@ void RegisterEigenKernels(KernelRegistry* registry) {
       TFRT_KERNEL(compat::internal::Conv2DBatchNorm<float, compat::Relu>));
   registry->AddKernel("eigen.conv2d.bias.f32",
                       TFRT_KERNEL(compat::internal::Conv2DBias<float>));
+  registry->AddKernel(
+      "eigen.conv2d.bias.relu.f32",
+      TFRT_KERNEL(compat::internal::Conv2DBias<float, compat::Relu>));
+  registry->AddKernel("eigen.fold_batch_norm.f32",
+                      TFRT_KERNEL(compat::internal::FoldBatchNorm<float>));
+
+  // Kernels fused with eigen.zero_padding.f32 by the tfrt-fuse-zero-padding
+  // pass. They take the padding of the fused kernel as `zero_padding`.
+  registry->AddKernel("eigen.zero_padding.max_pooling_2d.f32",
+                      TFRT_KERNEL(compat::ZeroPaddingMaxPool2D<float>));
+  registry->AddKernel("eigen.zero_padding.conv2d.f32",
+                      TFRT_KERNEL(compat::ZeroPaddingConv2D<float>));
+  registry->AddKernel(
+      "eigen.zero_padding.conv2d.batch_norm.f32",
+      TFRT_KERNEL(compat::internal::ZeroPaddingConv2DBatchNorm<float>));
+  registry->AddKernel(
+      "eigen.zero_padding.conv2d.batch_norm.relu.f32",
+      TFRT_KERNEL(
+          compat::internal::ZeroPaddingConv2DBatchNorm<float, compat::Relu>));
 }
 
 }  // namespace tfrt
@@ -0,0 +1,310 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Direct Conv2D kernel for small filters.
+//
+// Eigen spatial convolution packs input patches into a contraction (similar to
+// im2col), which for small filters spends most of the time and memory on the
+// packing. The direct kernel instead accumulates a block of output pixels and
+// output channels in registers, reading the NHWC input and HWIO filter in
+// place. The output kernel (e.g. bias or batch norm) is applied to each block
+// while it is still in L1 cache, the same way Eigen contractions do it (see
+// contraction_output_kernel.h).
+
+#ifndef TFRT_BACKENDS_COMMON_LIB_COMPAT_EIGEN_KERNELS_DIRECT_CONV2D_H_
+#define TFRT_BACKENDS_COMMON_LIB_COMPAT_EIGEN_KERNELS_DIRECT_CONV2D_H_
+
+#include <algorithm>
+#include <array>
+
+#include "conv2d_shape_functions.h"
+#include "tfrt/common/compat/eigen/contraction_output_kernel.h"
+#include "tfrt/common/compat/eigen/thread_pool_device.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+namespace compat {
+namespace internal {
+
+// The largest filter height and width computed by the direct kernel.
+constexpr Eigen::Index kMaxDirectConv2DFilterSize = 3;
+
+// Returns true if the direct kernel should compute the convolution.
+inline bool IsDirectConv2DSupported(const Conv2DParams& params) {
+  const FixedRankShape<4>& kernel_shape = params.kernel_shape;
+  return kernel_shape[0] <= kMaxDirectConv2DFilterSize &&
+         kernel_shape[1] <= kMaxDirectConv2DFilterSize &&
+         params.dilations[0] == 1 && params.dilations[1] == 1;
+}
+
+// Computes the output rows [begin, end) of a convolution, where the row `r` is
+// `output[r / output_height][r % output_height]`.
+template <typename T, typename OutputKernel>
+class DirectConv2DRows {
+  using Index = Eigen::Index;
+
+  using Packet = typename Eigen::internal::packet_traits<T>::type;
+  static constexpr Index kPacketSize =
+      Eigen::internal::unpacket_traits<Packet>::size;
+
+  // Every block of the output is a `kPixels x kChannels` tile of adjacent
+  // output pixels of one row, and adjacent output channels. The accumulators
+  // of a block fill 16 vector registers.
+  static constexpr Index kPixels = 4;
+  static constexpr Index kPackets = 4;
+  static constexpr Index kChannels = kPackets * kPacketSize;
+
+ public:
+  DirectConv2DRows(const Conv2DParams& params, const T* input, const T* filter,
+                   T* output, OutputKernel output_kernel)
+      : params_(params),
+        input_(input),
+        filter_(filter),
+        output_(output),
+        output_kernel_(std::move(output_kernel)) {}
+
+  void operator()(Index begin, Index end) const {
+    const Index output_height = params_.output_shape[1];
+    const Index output_width = params_.output_shape[2];
+    const Index output_channels = params_.output_shape[3];
+
+    for (Index row = begin; row < end; ++row) {
+      const Index batch = row / output_height;
+      const Index out_y = row % output_height;
+      for (Index out_x = 0; out_x < output_width; out_x += kPixels) {
+        const Index num_pixels = std::min(kPixels, output_width - out_x);
+        Index channel = 0;
+        for (; channel + kChannels <= output_channels; channel += kChannels) {
+          ComputeBlock(batch, out_y, out_x, channel, num_pixels);
+        }
+        if (channel < output_channels) {
+          ComputeTailBlock(batch, out_y, out_x, channel, num_pixels,
+                           output_channels - channel);
+        }
+      }
+    }
+  }
+
+  // Returns the cost of computing one output row.
+  Eigen::TensorOpCost RowCost() const {
+    const Index output_width = params_.output_shape[2];
+    const Index output_channels = params_.output_shape[3];
+    const Index filter_size = params_.kernel_shape[0] * params_.kernel_shape[1];
+    const Index input_channels = params_.kernel_shape[2];
+
+    const double bytes_loaded =
+        sizeof(T) * (params_.kernel_shape[0] * params_.input_shape[2] *
+                         input_channels +
+                     filter_size * input_channels * output_channels);
+    const double bytes_stored = sizeof(T) * output_width * output_channels;
+    const double compute_cycles =
+        static_cast<double>(output_width) * output_channels * filter_size *
+        input_channels / kPacketSize;
+    return Eigen::TensorOpCost(bytes_loaded, bytes_stored, compute_cycles);
+  }
+
+ private:
+  // Calls `fn(pixels, all_pixels, filter)` for every filter tap of the block
+  // of `num_pixels` output pixels starting at `output[batch][out_y][out_x]`.
+  // `pixels` are the input pixels of the tap, or nullptr for the padding, and
+  // `all_pixels` is true if none of them are. `filter` points to the filter
+  // weights of the tap for the output channel `oc`.
+  template <typename Fn>
+  EIGEN_ALWAYS_INLINE void ForEachFilterTap(Index batch, Index out_y,
+                                            Index out_x, Index oc,
+                                            Index num_pixels, Fn fn) const {
+    const Index input_height = params_.input_shape[1];
+    const Index input_width = params_.input_shape[2];
+    const Index input_channels = params_.input_shape[3];
+    const Index filter_height = params_.kernel_shape[0];
+    const Index filter_width = params_.kernel_shape[1];
+    const Index output_channels = params_.output_shape[3];
+
+    const T* batch_input =
+        input_ + batch * input_height * input_width * input_channels;
+
+    for (Index fy = 0; fy < filter_height; ++fy) {
+      const Index in_y = out_y * params_.strides[0] - params_.paddings[0] + fy;
+      if (in_y < 0 || in_y >= input_height) continue;
+      const T* input_row = batch_input + in_y * input_width * input_channels;
+
+      for (Index fx = 0; fx < filter_width; ++fx) {
+        std::array<const T*, kPixels> pixels;
+        bool all_pixels = true;
+        for (Index p = 0; p < kPixels; ++p) {
+          const Index in_x =
+              (out_x + p) * params_.strides[1] - params_.paddings[2] + fx;
+          const bool in_bounds =
+              p < num_pixels && in_x >= 0 && in_x < input_width;
+          pixels[p] = in_bounds ? input_row + in_x * input_channels : nullptr;
+          all_pixels &= in_bounds;
+        }
+
+        const T* filter = filter_ + (fy * filter_width + fx) * input_channels *
+                                        output_channels +
+                          oc;
+        fn(pixels, all_pixels, filter);
+      }
+    }
+  }
+
+  // Computes a block of `kChannels` output channels in vector registers.
+  EIGEN_ALWAYS_INLINE void ComputeBlock(Index batch, Index out_y, Index out_x,
+                                        Index oc, Index num_pixels) const {
+    using Eigen::internal::pload1;
+    using Eigen::internal::ploadu;
+    using Eigen::internal::pmadd;
+    using Eigen::internal::pset1;
+    using Eigen::internal::pstoreu;
+
+    const Index input_channels = params_.input_shape[3];
+    const Index output_channels = params_.output_shape[3];
+
+    Packet acc[kPixels][kPackets];
+    for (Index p = 0; p < kPixels; ++p)
+      for (Index v = 0; v < kPackets; ++v) acc[p][v] = pset1<Packet>(T(0));
+
+    ForEachFilterTap(
+        batch, out_y, out_x, oc, num_pixels,
+        [&](const std::array<const T*, kPixels>& pixels, bool all_pixels,
+            const T* filter) {
+          for (Index ic = 0; ic < input_channels; ++ic) {
+            const T* filter_row = filter + ic * output_channels;
+            Packet weights[kPackets];
+            for (Index v = 0; v < kPackets; ++v)
+              weights[v] = ploadu<Packet>(filter_row + v * kPacketSize);
+
+            for (Index p = 0; p < kPixels; ++p) {
+              // Pixels in the interior of the input need no bounds checks.
+              if (!all_pixels && !pixels[p]) continue;
+              const Packet value = pload1<Packet>(pixels[p] + ic);
+              for (Index v = 0; v < kPackets; ++v)
+                acc[p][v] = pmadd(value, weights[v], acc[p][v]);
+            }
+          }
+        });
+
+    T* output_base = OutputBlock(batch, out_y, out_x, oc);
+    for (Index p = 0; p < num_pixels; ++p) {
+      for (Index v = 0; v < kPackets; ++v)
+        pstoreu(output_base + p * output_channels + v * kPacketSize,
+                acc[p][v]);
+    }
+    ApplyOutputKernel(output_base, oc, kChannels, num_pixels);
+  }
+
+  // Computes a block of the remaining `num_channels < kChannels` output
+  // channels.
+  void ComputeTailBlock(Index batch, Index out_y, Index out_x, Index oc,
+                        Index num_pixels, Index num_channels) const {
+    const Index input_channels = params_.input_shape[3];
+    const Index output_channels = params_.output_shape[3];
+
+    std::array<std::array<T, kChannels>, kPixels> acc;
+    for (auto& pixel : acc) pixel.fill(T(0));
+
+    ForEachFilterTap(
+        batch, out_y, out_x, oc, num_pixels,
+        [&](const std::array<const T*, kPixels>& pixels, bool all_pixels,
+            const T* filter) {
+          for (Index ic = 0; ic < input_channels; ++ic) {
+            const T* filter_row = filter + ic * output_channels;
+            for (Index p = 0; p < kPixels; ++p) {
+              if (!pixels[p]) continue;
+              const T value = pixels[p][ic];
+              for (Index c = 0; c < num_channels; ++c)
+                acc[p][c] += value * filter_row[c];
+            }
+          }
+        });
+
+    T* output_base = OutputBlock(batch, out_y, out_x, oc);
+    for (Index p = 0; p < num_pixels; ++p) {
+      std::copy_n(acc[p].begin(), num_channels,
+                  output_base + p * output_channels);
+    }
+    ApplyOutputKernel(output_base, oc, num_channels, num_pixels);
+  }
+
+  T* OutputBlock(Index batch, Index out_y, Index out_x, Index oc) const {
+    const Index output_height = params_.output_shape[1];
+    const Index output_width = params_.output_shape[2];
+    const Index output_channels = params_.output_shape[3];
+    return output_ +
+           ((batch * output_height + out_y) * output_width + out_x) *
+               output_channels +
+           oc;
+  }
+
+  // The block is a `num_channels x num_pixels` column major matrix with a
+  // stride of `output_channels`, just like a block of the contraction in Eigen
+  // spatial convolution.
+  void ApplyOutputKernel(T* output_base, Index oc, Index num_channels,
+                         Index num_pixels) const {
+    const ContractionOutputMapper<T> output_mapper(output_base,
+                                                    params_.output_shape[3]);
+    Eigen::TensorContractionParams contraction_params;
+    contraction_params.swapped_arguments = true;
+    output_kernel_(output_mapper, contraction_params, oc, 0, num_channels,
+                   num_pixels);
+  }
+
+  const Conv2DParams params_;
+  const T* const input_;
+  const T* const filter_;
+  T* const output_;
+  const OutputKernel output_kernel_;
+};
+
+// Computes the convolution of NHWC `input` with HWIO `filter` into `output`
+// with the direct kernel, in parallel over the output rows. Returns a chain
+// that becomes available when the output is computed.
+template <typename T, typename OutputKernel>
+AsyncValueRef<Chain> DirectConv2D(const DenseHostTensor& input,
+                                  const DenseHostTensor& filter,
+                                  DenseHostTensor* output,
+                                  const Conv2DParams& params,
+                                  OutputKernel output_kernel,
+                                  const ExecutionContext& exec_ctx) {
+  assert(IsDirectConv2DSupported(params));
+
+  DirectConv2DRows<T, OutputKernel> rows(
+      params, static_cast<const T*>(input.data()),
+      static_cast<const T*>(filter.data()), static_cast<T*>(output->data()),
+      std::move(output_kernel));
+  const Eigen::TensorOpCost cost = rows.RowCost();
+
+  const EigenHostContext& ctx =
+      exec_ctx.host()->GetOrCreateSharedContext<EigenHostContext>();
+  auto chain = MakeConstructedAsyncValueRef<Chain>();
+  ctx.ParallelForAsync(
+      params.output_shape[0] * params.output_shape[1], cost, std::move(rows),
+      [chain = chain.CopyRef(),
+       buffers = KeepBuffers::alive(&input, &filter, output)]() {
+        chain.SetStateConcrete();
+      });
+  return chain;
+}
+
+}  // namespace internal
+}  // namespace compat
+}  // namespace tfrt
+
+#endif  // TFRT_BACKENDS_COMMON_LIB_COMPAT_EIGEN_KERNELS_DIRECT_CONV2D_H_
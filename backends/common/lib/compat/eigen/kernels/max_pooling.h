@@ -17,29 +17,194 @@
 #ifndef TFRT_BACKENDS_COMMON_LIB_COMPAT_EIGEN_KERNELS_MAX_POOLING_H_
 #define TFRT_BACKENDS_COMMON_LIB_COMPAT_EIGEN_KERNELS_MAX_POOLING_H_
 
+#include <algorithm>
+#include <array>
 #include <cassert>
 #include <cstdint>
+#include <limits>
 
+#include "conv2d_shape_functions.h"
+#include "llvm/ADT/SmallVector.h"
 #include "tfrt/common/compat/eigen/eigen_kernel.h"
+#include "tfrt/common/compat/eigen/kernels/shape_functions.h"
 #include "tfrt/common/compat/eigen/tensor_types.h"
+#include "tfrt/common/compat/eigen/thread_pool_device.h"
 #include "tfrt/host_context/diagnostic.h"
 #include "tfrt/host_context/host_context.h"
 #include "tfrt/host_context/kernel_utils.h"
-#include "tfrt/host_context/parallel_for.h"
 #include "tfrt/tensor/dense_host_tensor_view.h"
 
 namespace tfrt {
 namespace compat {
+namespace internal {
+
+struct MaxPoolParams {
+  std::array<Index, 2> ksize;
+  std::array<Index, 2> strides;
+  std::array<Index, 4> paddings;  // top, bottom, left, right
+  // True if the paddings are zeros fused from the ZeroPadding kernel, false if
+  // the padded elements are ignored (the "same" padding).
+  bool zero_padded;
+
+  FixedRankShape<4> input_shape;
+  FixedRankShape<4> output_shape;
+};
+
+// Computes the output channels [channel_begin, channel_end) of the output
+// rows of a max pooling, in parallel units of one row and one block of
+// channels. The unit `u` is the block `u % num_blocks` of the row
+// `output[r / output_height][r % output_height]`, where `r = u / num_blocks`.
+template <typename T>
+class MaxPool2DBlocks {
+  using Packet = typename Eigen::internal::packet_traits<T>::type;
+  static constexpr Index kPacketSize =
+      Eigen::internal::unpacket_traits<Packet>::size;
+
+  // Every unit reads `ksize[0]` input rows of `kBlockChannels` channels, which
+  // fit into L1 for the typical pooling layers.
+  static constexpr Index kBlockChannels = 16 * kPacketSize;
+
+  // The largest pooling window with the tap pointers on the stack.
+  static constexpr unsigned kMaxInlineTaps = 16;
+
+ public:
+  MaxPool2DBlocks(const MaxPoolParams& params, const T* input, T* output)
+      : params_(params), input_(input), output_(output) {}
+
+  Index NumUnits() const {
+    return params_.output_shape[0] * params_.output_shape[1] * NumBlocks();
+  }
 
+  void operator()(Index begin, Index end) const {
+    const Index num_blocks = NumBlocks();
+    const Index output_height = params_.output_shape[1];
+    const Index output_width = params_.output_shape[2];
+    const Index channels = params_.output_shape[3];
+
+    llvm::SmallVector<const T*, kMaxInlineTaps> taps;
+    for (Index unit = begin; unit < end; ++unit) {
+      const Index row = unit / num_blocks;
+      const Index channel_begin = (unit % num_blocks) * kBlockChannels;
+      const Index channel_end =
+          std::min(channels, channel_begin + kBlockChannels);
+
+      const Index batch = row / output_height;
+      const Index out_y = row % output_height;
+      T* output = output_ + (row * output_width) * channels;
+
+      for (Index out_x = 0; out_x < output_width; ++out_x) {
+        const bool pad_with_zeros = WindowTaps(batch, out_y, out_x, &taps);
+        ComputePixel(taps, pad_with_zeros, channel_begin, channel_end,
+                     output + out_x * channels);
+      }
+    }
+  }
+
+  // Returns the cost of computing one parallel unit.
+  Eigen::TensorOpCost UnitCost() const {
+    const Index output_width = params_.output_shape[2];
+    const Index channels = std::min(kBlockChannels, params_.output_shape[3]);
+    const Index window_size = params_.ksize[0] * params_.ksize[1];
+
+    const double bytes_loaded =
+        sizeof(T) * params_.ksize[0] * params_.input_shape[2] * channels;
+    const double bytes_stored = sizeof(T) * output_width * channels;
+    const double compute_cycles = static_cast<double>(output_width) *
+                                  window_size * channels / kPacketSize;
+    return Eigen::TensorOpCost(bytes_loaded, bytes_stored, compute_cycles);
+  }
+
+ private:
+  Index NumBlocks() const {
+    return (params_.output_shape[3] + kBlockChannels - 1) / kBlockChannels;
+  }
+
+  // Collects the input pixels of the pooling window of the output pixel into
+  // `taps`. The window is clamped to the input instead of reading a padded
+  // copy of it. Returns true if the clamped window lost any zero padding, i.e.
+  // the maximum must include zero.
+  bool WindowTaps(Index batch, Index out_y, Index out_x,
+                  llvm::SmallVectorImpl<const T*>* taps) const {
+    const Index input_height = params_.input_shape[1];
+    const Index input_width = params_.input_shape[2];
+    const Index channels = params_.input_shape[3];
+
+    const Index y_start = out_y * params_.strides[0] - params_.paddings[0];
+    const Index x_start = out_x * params_.strides[1] - params_.paddings[2];
+    const Index y_begin = std::max(y_start, Index{0});
+    const Index x_begin = std::max(x_start, Index{0});
+    const Index y_end = std::min(y_start + params_.ksize[0], input_height);
+    const Index x_end = std::min(x_start + params_.ksize[1], input_width);
+
+    taps->clear();
+    const T* batch_input =
+        input_ + batch * input_height * input_width * channels;
+    for (Index y = y_begin; y < y_end; ++y) {
+      for (Index x = x_begin; x < x_end; ++x)
+        taps->push_back(batch_input + (y * input_width + x) * channels);
+    }
+
+    const Index window_size = params_.ksize[0] * params_.ksize[1];
+    return params_.zero_padded &&
+           static_cast<Index>(taps->size()) != window_size;
+  }
+
+  static void ComputePixel(ArrayRef<const T*> taps, bool pad_with_zeros,
+                           Index channel_begin, Index channel_end, T* output) {
+    using Eigen::internal::pmax;
+    using Eigen::internal::ploadu;
+    using Eigen::internal::pset1;
+    using Eigen::internal::pstoreu;
+
+    const T init =
+        pad_with_zeros ? T(0) : std::numeric_limits<T>::lowest();
+
+    // Four packets at a time to hide the latency of the max instructions.
+    Index c = channel_begin;
+    for (; c + 4 * kPacketSize <= channel_end; c += 4 * kPacketSize) {
+      Packet acc0 = pset1<Packet>(init);
+      Packet acc1 = acc0, acc2 = acc0, acc3 = acc0;
+      for (const T* tap : taps) {
+        acc0 = pmax(acc0, ploadu<Packet>(tap + c + 0 * kPacketSize));
+        acc1 = pmax(acc1, ploadu<Packet>(tap + c + 1 * kPacketSize));
+        acc2 = pmax(acc2, ploadu<Packet>(tap + c + 2 * kPacketSize));
+        acc3 = pmax(acc3, ploadu<Packet>(tap + c + 3 * kPacketSize));
+      }
+      pstoreu(output + c + 0 * kPacketSize, acc0);
+      pstoreu(output + c + 1 * kPacketSize, acc1);
+      pstoreu(output + c + 2 * kPacketSize, acc2);
+      pstoreu(output + c + 3 * kPacketSize, acc3);
+    }
+    for (; c + kPacketSize <= channel_end; c += kPacketSize) {
+      Packet acc = pset1<Packet>(init);
+      for (const T* tap : taps) acc = pmax(acc, ploadu<Packet>(tap + c));
+      pstoreu(output + c, acc);
+    }
+    for (; c < channel_end; ++c) {
+      T acc = init;
+      for (const T* tap : taps) acc = std::max(acc, tap[c]);
+      output[c] = acc;
+    }
+  }
+
+  const MaxPoolParams params_;
+  const T* const input_;
+  T* const output_;
+};
+
+}  // namespace internal
+
+// Computes the max pooling of the NHWC `input` into `output`. Non-empty
+// `zero_padding` is the [height, width] padding of a fused ZeroPadding kernel,
+// see ComputeConv2DParams.
 template <typename T>
 static AsyncValueRef<Chain> MaxPoolImpl(const DenseHostTensor& input,
                                         DenseHostTensor* output,
                                         string_view padding,
                                         ArrayRef<Index> strides,
                                         ArrayRef<Index> ksize,
-                                        const ExecutionContext& exec_ctx) {
-  // TODO(ezhulenev): Move shape computation into support library and share with
-  // shape computations in convolution.
+                                        const ExecutionContext& exec_ctx,
+                                        ArrayRef<Index> zero_padding = {}) {
   DHTIndexableView<T, 4> input_view(&input);
   MutableDHTIndexableView<T, 4> output_view(output);
 
@@ -53,172 +218,57 @@ static AsyncValueRef<Chain> MaxPoolImpl(const DenseHostTensor& input,
     return EmitErrorAsync(exec_ctx, "ksize should have 2 elements");
   }
 
-  // Padding for upper, bottom, left and right.
-  int padding_numbers[4] = {0, 0, 0, 0};
-
-  if (padding.str() == "SAME" || padding.str() == "same") {
-    int total_padding_height = ksize[0] - strides[0];
-    if (shape_input[1] % strides[0] != 0) {
-      total_padding_height = ksize[0] - (shape_input[1] % strides[0]);
-    }
-    int total_padding_width = ksize[1] - strides[1];
-    if (shape_input[2] % strides[1] != 0) {
-      total_padding_width = ksize[1] - (shape_input[2] % strides[1]);
-    }
-
-    padding_numbers[0] = static_cast<int>(total_padding_height / 2.0);
-    padding_numbers[1] = static_cast<int>(total_padding_height / 2.0 + 0.5);
-    padding_numbers[2] = static_cast<int>(total_padding_width / 2.0);
-    padding_numbers[3] = static_cast<int>(total_padding_width / 2.0 + 0.5);
-  } else if (padding.str() != "VALID" && padding.str() != "valid") {
+  auto padding_type = ParsePaddingType(padding);
+  if (!padding_type) {
+    return EmitErrorAsync(exec_ctx, StrCat(padding_type.takeError()));
+  }
+  if (*padding_type == PaddingType::kExplicit) {
     return EmitErrorAsync(exec_ctx, "padding type is not supported");
   }
+  auto explicit_paddings = ComputeZeroPadding(&*padding_type, zero_padding);
+  if (!explicit_paddings) {
+    return EmitErrorAsync(exec_ctx, StrCat(explicit_paddings.takeError()));
+  }
 
-  auto height =
-      (shape_input[1] + padding_numbers[0] + padding_numbers[1] - ksize[0]) /
-          strides[0] +
-      1;
-  auto width =
-      (shape_input[2] + padding_numbers[2] + padding_numbers[3] - ksize[1]) /
-          strides[1] +
-      1;
-  const FixedRankShape<4> expected_output_shape(
-      {shape_input[0], height, width, shape_input[3]});
+  std::array<WindowedOutputDimension, 2> dims;
+  for (int i = 0; i < 2; ++i) {
+    auto dim = ComputeWindowedOutputDimension(
+        shape_input[i + 1], ksize[i], strides[i], /*dilation=*/1,
+        *padding_type, (*explicit_paddings)[i]);
+    if (!dim) return EmitErrorAsync(exec_ctx, StrCat(dim.takeError()));
+    dims[i] = *dim;
+  }
 
+  const FixedRankShape<4> expected_output_shape(
+      {shape_input[0], dims[0].output_size, dims[1].output_size,
+       shape_input[3]});
   if (shape_output != expected_output_shape) {
     return EmitErrorAsync(exec_ctx, "output tensor has the wrong shape");
   }
 
-  // In the following code we treat every channels vector (innermost dimension)
-  // as a single unit for the purpose of computing a maximum value, and pretend
-  // that we are working with a tensor of size: [batch, height, width].
-  using ChannelVector = Eigen::Tensor<T, 1, Eigen::RowMajor, Index>;
-  using InputChannels = Eigen::TensorMap<const ChannelVector, Eigen::Unaligned>;
-  using OutputChannels = Eigen::TensorMap<ChannelVector, Eigen::Unaligned>;
-
-  // At every 3 dimensional coordinate we have a vector of size [num_channels].
-  const size_t num_channels = shape_output[3];
-
-  // Coordinates: [batch, row, col].
-  using Coords = std::array<Index, 3>;
-
-  // Returns OutputChannels for 3 dimensional coordinates.
-  auto output_channels = [output = output->CopyRef(),
-                          num_channels](const Coords& coords) mutable {
-    MutableDHTIndexableView<T, 4> output_view(&output);
-    T* data = &output_view.ElementAt(coords[0], coords[1], coords[2], 0);
-    return OutputChannels(data, num_channels);
-  };
-
-  // Returns InputChannels for 3 dimensional coordinates.
-  auto input_channels = [input = input.CopyRef(),
-                         num_channels](const Coords& coords) mutable {
-    DHTIndexableView<T, 4> input_view(&input);
-    const T* data = &input_view.ElementAt(coords[0], coords[1], coords[2], 0);
-    return InputChannels(data, num_channels);
-  };
-
-  // Strides in the output tensor (excluding innermost channels dimensions).
-  const Coords output_strides = {
-      shape_output[1] * shape_output[2],  // batch stride
-      shape_output[2],                    // height stride
-      1                                   // width stride
-  };
-
-  // Number of output channel-vectors.
-  const Index num_outputs = shape_output[0] * shape_output[1] * shape_output[2];
-
-  // Computes [batch, row, col] coordinates of an output channels from one
-  // dimensional index in [0, num_outputs) range.
-  const auto output_coords = [output_strides](Index index) -> Coords {
-    const Index i0 = index / output_strides[0];
-    index -= i0 * output_strides[0];
-
-    const Index i1 = index / output_strides[1];
-    index -= i1 * output_strides[1];
-
-    const Index i2 = index;
-
-    return {i0, i1, i2};
-  };
-
-  // Computes MaxPool outputs in the [start, end) range. All the state captured
-  // by value explicitly, because this function will be executed asynchonously.
-  std::array<Index, 2> strides_t{strides[0], strides[1]};
-  std::array<Index, 2> ksize_t{ksize[0], ksize[1]};
-  auto compute = [strides = strides_t, ksize = ksize_t, padding_numbers,
-                  shape_input, input_channels = std::move(input_channels),
-                  output_channels = std::move(output_channels),
-                  output_coords](size_t start, size_t end) mutable -> void {
-    // Image patch input channels.
-    std::vector<InputChannels> input_channels_pool;
-    input_channels_pool.reserve(ksize[0] * ksize[1]);
-
-    // Iterate over all outputs in the [start, end) range.
-    for (Index index = start; index < end; ++index) {
-      const Coords coords = output_coords(index);
-      input_channels_pool.clear();
-
-      // Iterate over the spatial pooling patch.
-      for (Index x = 0; x < ksize[0]; ++x) {
-        for (Index y = 0; y < ksize[1]; ++y) {
-          // Coordinates in the input tensor.
-          const Coords input_coords = {
-              coords[0],                                        // batch
-              coords[1] * strides[0] + x - padding_numbers[0],  // row (height)
-              coords[2] * strides[1] + y - padding_numbers[2],  // col (width)
-          };
-
-          // Check if the input coordinates are in the padded space.
-          const bool pad =
-              input_coords[1] < 0 || input_coords[1] >= shape_input[1] ||
-              input_coords[2] < 0 || input_coords[2] >= shape_input[2];
-          if (!pad) {
-            input_channels_pool.push_back(input_channels(input_coords));
-          }
-        }
-      }
-
-      assert(!input_channels_pool.empty());
-      Index i = 0;
-
-      // Initialize output channels.
-      auto out = output_channels(coords);
-      out = out.constant(std::numeric_limits<T>::min());
-
-      // Process 3 input channels in a single Eigen expression to minimize
-      // memory traffic and keep temporary data in the registers.
-      const Index vectorized_pooling =
-          static_cast<Index>(input_channels_pool.size()) - 3;
-      for (; i < vectorized_pooling; i += 3) {
-        auto in0 = input_channels_pool[i + 0];
-        auto in1 = input_channels_pool[i + 1];
-        auto in2 = input_channels_pool[i + 2];
-        out = out.cwiseMax(in0).cwiseMax(in1.cwiseMax(in2));
-      }
-
-      // Process remaining channels one by one.
-      for (; i < static_cast<Index>(input_channels_pool.size()); ++i) {
-        auto in0 = input_channels_pool[i];
-        out = out.cwiseMax(in0);
-      }
-    }
-  };
-
-  // Compute minimum parallel for block size, to make sure that we do not create
-  // too many small tasks if extracted image patches are tiny.
-  // TODO(ezhulenev): Use Eigen expression cost model? Or add TFRT cost model?
-  static constexpr size_t kMinPatchSize = 1000;
-  const size_t image_patch_size = num_channels * ksize[0] * ksize[1];
-  const size_t min_block_size =
-      std::max(static_cast<size_t>(1), kMinPatchSize / image_patch_size);
-  auto chain = MakeUnconstructedAsyncValueRef<Chain>();
-  auto args = KeepBuffers::alive(&input, output);
-
-  ParallelFor(exec_ctx).Execute(
-      num_outputs, ParallelFor::BlockSizes::Min(min_block_size),
-      std::move(compute),
-      [chain = chain.CopyRef(), args = std::move(args)]() { chain.emplace(); });
+  internal::MaxPoolParams params{
+      {ksize[0], ksize[1]},
+      {strides[0], strides[1]},
+      {dims[0].padding.padding_before, dims[0].padding.padding_after,
+       dims[1].padding.padding_before, dims[1].padding.padding_after},
+      /*zero_padded=*/!zero_padding.empty(),
+      shape_input,
+      shape_output};
+
+  internal::MaxPool2DBlocks<T> blocks(
+      params, static_cast<const T*>(input.data()),
+      static_cast<T*>(output->data()));
+  const Index num_units = blocks.NumUnits();
+  const Eigen::TensorOpCost cost = blocks.UnitCost();
+
+  const EigenHostContext& ctx =
+      exec_ctx.host()->GetOrCreateSharedContext<EigenHostContext>();
+  auto chain = MakeConstructedAsyncValueRef<Chain>();
+  ctx.ParallelForAsync(num_units, cost, std::move(blocks),
+                       [chain = chain.CopyRef(),
+                        buffers = KeepBuffers::alive(&input, output)]() {
+                         chain.SetStateConcrete();
+                       });
   return chain;
 }
 
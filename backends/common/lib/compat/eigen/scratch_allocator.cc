@@ -0,0 +1,115 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file implements EigenScratchAllocator.
+
+#include "tfrt/common/compat/eigen/scratch_allocator.h"
+
+#include <cassert>
+#include <cstdint>
+
+#include "llvm/Support/MathExtras.h"
+
+namespace tfrt {
+namespace compat {
+namespace {
+
+// Every buffer is preceded by a header with its size class. The header takes
+// kAlignment bytes, so that the buffer itself stays aligned.
+struct BufferHeader {
+  int size_class;
+};
+
+constexpr size_t kHeaderSize = EigenScratchAllocator::kAlignment;
+static_assert(sizeof(BufferHeader) <= kHeaderSize, "header is too large");
+
+BufferHeader* GetHeader(void* buffer) {
+  return reinterpret_cast<BufferHeader*>(static_cast<char*>(buffer) -
+                                         kHeaderSize);
+}
+
+}  // namespace
+
+EigenScratchAllocator::EigenScratchAllocator(HostContext* host_context,
+                                             size_t max_cached_bytes)
+    : host_context_(host_context), max_cached_bytes_(max_cached_bytes) {}
+
+EigenScratchAllocator::~EigenScratchAllocator() {
+  for (int size_class = 0; size_class < kNumSizeClasses; ++size_class) {
+    for (void* buffer : free_lists_[size_class]) {
+      host_context_->DeallocateBytes(GetHeader(buffer),
+                                     kHeaderSize + ClassSize(size_class));
+    }
+  }
+}
+
+int EigenScratchAllocator::SizeClass(size_t num_bytes) {
+  if (num_bytes <= kMinSize) return 0;
+  return llvm::Log2_64_Ceil(num_bytes) - llvm::Log2_64(kMinSize);
+}
+
+void* EigenScratchAllocator::allocate(size_t num_bytes) const {
+  const int size_class = SizeClass(num_bytes);
+  assert(size_class < kNumSizeClasses && "allocation is too large");
+
+  {
+    mutex_lock lock(mu_);
+    auto& free_list = free_lists_[size_class];
+    if (!free_list.empty()) {
+      void* buffer = free_list.back();
+      free_list.pop_back();
+      cached_bytes_ -= ClassSize(size_class);
+      return buffer;
+    }
+    ++num_host_allocations_;
+  }
+
+  void* ptr = host_context_->AllocateBytes(kHeaderSize + ClassSize(size_class),
+                                           kAlignment);
+  if (ptr == nullptr) return nullptr;
+  static_cast<BufferHeader*>(ptr)->size_class = size_class;
+  return static_cast<char*>(ptr) + kHeaderSize;
+}
+
+void EigenScratchAllocator::deallocate(void* buffer) const {
+  if (buffer == nullptr) return;
+  const int size_class = GetHeader(buffer)->size_class;
+  const size_t size = ClassSize(size_class);
+
+  {
+    mutex_lock lock(mu_);
+    if (cached_bytes_ + size <= max_cached_bytes_) {
+      free_lists_[size_class].push_back(buffer);
+      cached_bytes_ += size;
+      return;
+    }
+  }
+
+  host_context_->DeallocateBytes(GetHeader(buffer), kHeaderSize + size);
+}
+
+size_t EigenScratchAllocator::CachedBytes() const {
+  mutex_lock lock(mu_);
+  return cached_bytes_;
+}
+
+size_t EigenScratchAllocator::NumHostAllocations() const {
+  mutex_lock lock(mu_);
+  return num_host_allocations_;
+}
+
+}  // namespace compat
+}  // namespace tfrt
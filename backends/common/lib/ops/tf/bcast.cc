@@ -20,6 +20,8 @@
 
 #include <sys/types.h>
 
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/raw_ostream.h"
 #include "tfrt/support/error_util.h"
 #include "tfrt/support/forward_decls.h"
@@ -95,4 +97,49 @@ Expected<ArgumentBCast> GetArgumentBCast(const TensorShape& argument_shape,
   return ArgumentBCast(arg_dims, broadcast);
 }
 
+std::optional<BinaryBCastFastPath> GetBinaryBCastFastPath(
+    const ArgumentBCast& lhs_bcast, const ArgumentBCast& rhs_bcast) {
+  assert(lhs_bcast.rank() == rhs_bcast.rank());
+
+  auto is_full = [](const ArgumentBCast& bcast) {
+    return llvm::all_of(bcast.broadcast(), [](Index b) { return b == 1; });
+  };
+
+  // Exactly one of the arguments must be broadcast.
+  const bool lhs_full = is_full(lhs_bcast);
+  if (lhs_full == is_full(rhs_bcast)) return std::nullopt;
+  const ArgumentBCast& bcast = lhs_full ? rhs_bcast : lhs_bcast;
+
+  // Collapse the result dimensions into runs of dimensions that are either all
+  // broadcast or all not broadcast. Dimensions of size 1 are skipped.
+  struct Run {
+    bool broadcast;
+    Index size;
+  };
+  llvm::SmallVector<Run, 4> runs;
+  for (size_t i = 0; i < bcast.rank(); ++i) {
+    Index dim = bcast.reshape()[i] * bcast.broadcast()[i];
+    if (dim == 1) continue;
+    bool broadcast = bcast.broadcast()[i] != 1;
+    if (!runs.empty() && runs.back().broadcast == broadcast) {
+      runs.back().size *= dim;
+    } else {
+      runs.push_back({broadcast, dim});
+    }
+  }
+
+  using Pattern = BinaryBCastFastPath::Pattern;
+  auto make = [&](Pattern pattern, Index outer, Index middle, Index inner) {
+    return BinaryBCastFastPath{pattern, !lhs_full, outer, middle, inner};
+  };
+
+  if (runs.size() == 2 && runs[0].broadcast)
+    return make(Pattern::kRow, 1, runs[0].size, runs[1].size);
+  if (runs.size() == 2 && runs[1].broadcast)
+    return make(Pattern::kColumn, runs[0].size, runs[1].size, 1);
+  if (runs.size() == 3 && runs[1].broadcast)
+    return make(Pattern::kMiddle, runs[0].size, runs[1].size, runs[2].size);
+  return std::nullopt;
+}
+
 }  // namespace tfrt
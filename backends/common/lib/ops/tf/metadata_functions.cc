@@ -93,14 +93,17 @@ static TensorMetadata UnaryIdentityMd(const TensorMetadata& input) {
   return input;
 }
 
-static Expected<TensorMetadata> MatMulMd(const TensorMetadata& a,
+// The output of a fused element-wise chain has the metadata of its first
+// input. Fusion inputs are validated by the kernel.
+static TensorMetadata FusedElementwiseMd(const TensorMetadata& input,
+                                         VariadicOpArg<TensorMetadata> _) {
+  return input;
+}
+
+// Returns the output shape of a MatMul of `a` and `b`.
+static Expected<TensorShape> MatMulShape(const TensorMetadata& a,
                                          const TensorMetadata& b,
-                                         VariadicOpArg<TensorMetadata> _,
                                          const OpAttrsRef& attrs) {
-  if (a.dtype != b.dtype)
-    return MakeStringError("incompatible dtypes for MatMul: In[0]: ", a.dtype,
-                           ", In[1]: ", b.dtype);
-
   if (a.shape.GetRank() != 2)
     return MakeStringError(
         "argument 0 of matmul op is not a rank-2 tensor. Actual rank is ",
@@ -135,8 +138,186 @@ static Expected<TensorMetadata> MatMulMd(const TensorMetadata& a,
   int a_remaining_dim = 1 - a_matching_dim;
   int b_remaining_dim = 1 - b_matching_dim;
 
-  return TensorMetadata(a.dtype, {a.shape.GetDimensionSize(a_remaining_dim),
-                                  b.shape.GetDimensionSize(b_remaining_dim)});
+  return TensorShape({a.shape.GetDimensionSize(a_remaining_dim),
+                      b.shape.GetDimensionSize(b_remaining_dim)});
+}
+
+static Expected<TensorMetadata> MatMulMd(const TensorMetadata& a,
+                                         const TensorMetadata& b,
+                                         VariadicOpArg<TensorMetadata> _,
+                                         const OpAttrsRef& attrs) {
+  if (a.dtype != b.dtype)
+    return MakeStringError("incompatible dtypes for MatMul: In[0]: ", a.dtype,
+                           ", In[1]: ", b.dtype);
+
+  TFRT_ASSIGN_OR_RETURN(auto shape, MatMulShape(a, b, attrs));
+  return TensorMetadata(a.dtype, shape);
+}
+
+// tf.BatchMatMulV2 multiplies the matrices in the last two dimensions of `a`
+// and `b`, and broadcasts the other (batch) dimensions.
+static Expected<TensorMetadata> TfBatchMatMulV2OpMd(const TensorMetadata& a,
+                                                    const TensorMetadata& b,
+                                                    const OpAttrsRef& attrs) {
+  if (a.dtype != b.dtype)
+    return MakeStringError("incompatible dtypes for BatchMatMulV2: In[0]: ",
+                           a.dtype, ", In[1]: ", b.dtype);
+
+  const int a_rank = a.shape.GetRank();
+  const int b_rank = b.shape.GetRank();
+  if (a_rank < 2 || b_rank < 2)
+    return MakeStringError(
+        "arguments of BatchMatMulV2 must have rank >= 2, got In[0]: ", a.shape,
+        ", In[1]: ", b.shape);
+
+  llvm::SmallVector<Index, 4> a_dims, b_dims;
+  a.shape.GetDimensions(&a_dims);
+  b.shape.GetDimensions(&b_dims);
+
+  const bool adj_x = attrs.GetOptional<bool>("adj_x").value_or(false);
+  const bool adj_y = attrs.GetOptional<bool>("adj_y").value_or(false);
+  const Index m = a_dims[a_rank - (adj_x ? 1 : 2)];
+  const Index a_k = a_dims[a_rank - (adj_x ? 2 : 1)];
+  const Index b_k = b_dims[b_rank - (adj_y ? 1 : 2)];
+  const Index n = b_dims[b_rank - (adj_y ? 2 : 1)];
+  if (a_k != b_k)
+    return MakeStringError(
+        "BatchMatMulV2 arguments have incompatible shapes: In[0]: ", a.shape,
+        ", In[1]: ", b.shape, ". adj_x: ", adj_x, ", adj_y: ", adj_y);
+
+  TFRT_ASSIGN_OR_RETURN(
+      auto batch_shape,
+      GetBroadcastedShape(TensorShape(llvm::ArrayRef(a_dims).drop_back(2)),
+                          TensorShape(llvm::ArrayRef(b_dims).drop_back(2))));
+
+  llvm::SmallVector<Index, 4> dims;
+  batch_shape.GetDimensions(&dims);
+  dims.push_back(m);
+  dims.push_back(n);
+  return TensorMetadata(a.dtype, TensorShape(dims));
+}
+
+// tf._ScaledDotProductAttention takes a [batch, heads, query_len, depth]
+// query, and a key and a value of [batch, heads, key_len, depth] and
+// [batch, heads, key_len, value_depth]. The output has the shape of the query,
+// with the depth of the value. The padding mask is validated by the kernel.
+static Expected<TensorMetadata> TfScaledDotProductAttentionOpMd(
+    const TensorMetadata& query, const TensorMetadata& key,
+    const TensorMetadata& value, VariadicOpArg<TensorMetadata> _) {
+  if (query.dtype != key.dtype || query.dtype != value.dtype)
+    return MakeStringError("incompatible dtypes for attention: query ",
+                           query.dtype, ", key ", key.dtype, ", value ",
+                           value.dtype);
+
+  if (query.shape.GetRank() != 4 || key.shape.GetRank() != 4 ||
+      value.shape.GetRank() != 4)
+    return MakeStringError("attention inputs must be rank 4 tensors, got ",
+                           query.shape, ", ", key.shape, ", ", value.shape);
+
+  const Index batch = query.shape.GetDimensionSize(0);
+  const Index heads = query.shape.GetDimensionSize(1);
+  const Index key_len = key.shape.GetDimensionSize(2);
+  const Index depth = query.shape.GetDimensionSize(3);
+  const Index value_depth = value.shape.GetDimensionSize(3);
+  if (key.shape != TensorShape({batch, heads, key_len, depth}) ||
+      value.shape != TensorShape({batch, heads, key_len, value_depth}))
+    return MakeStringError("incompatible attention input shapes: query ",
+                           query.shape, ", key ", key.shape, ", value ",
+                           value.shape);
+
+  return TensorMetadata(
+      query.dtype, TensorShape({batch, heads, query.shape.GetDimensionSize(2),
+                                value_depth}));
+}
+
+// tf.SparseEmbeddingLookup combines the rows of `params` selected by the ids
+// in each row of the rank 2 sparse tensor `sp_ids`. Quantized int8 `params`
+// come with the `scales` of their rows, and have float results. With the
+// "int4" attribute an int8 element packs two elements of a row.
+static Expected<TensorMetadata> TfSparseEmbeddingLookupOpMd(
+    const TensorMetadata& sp_ids, const TensorMetadata& params,
+    OptionalOpArg<TensorMetadata> scales, const OpAttrsRef& attrs) {
+  if (sp_ids.shape.GetRank() != 2)
+    return MakeStringError(
+        "sp_ids of tf.SparseEmbeddingLookup must be a rank-2 tensor. Actual "
+        "rank is ",
+        sp_ids.shape.GetRank());
+  if (sp_ids.dtype != DType::I32 && sp_ids.dtype != DType::I64)
+    return MakeStringError("unsupported dtype for sp_ids: ", sp_ids.dtype);
+  if (params.shape.GetRank() != 2)
+    return MakeStringError(
+        "params of tf.SparseEmbeddingLookup must be a rank-2 tensor. Actual "
+        "rank is ",
+        params.shape.GetRank());
+
+  string_view combiner;
+  if (!attrs.GetString("combiner", &combiner))
+    return MakeStringError(
+        "'combiner' attribute is not specified for SparseEmbeddingLookup op");
+
+  const Index dim = params.shape.GetDimensionSize(1);
+  if (params.dtype != DType::I8 && params.dtype != DType::QI8) {
+    if (scales)
+      return MakeStringError("scales require quantized params, got ",
+                             params.dtype);
+    return TensorMetadata(
+        params.dtype, TensorShape({sp_ids.shape.GetDimensionSize(0), dim}));
+  }
+
+  if (!scales) return MakeStringError("quantized params require scales");
+  const bool int4 = attrs.GetOptional<bool>("int4").value_or(false);
+  return TensorMetadata(DType(DType::F32),
+                        TensorShape({sp_ids.shape.GetDimensionSize(0),
+                                     int4 ? 2 * dim : dim}));
+}
+
+// tf.StringToHashBucketFast and tf.Fingerprint64 hash every element of a
+// string (or, for tf.Fingerprint64, integer) tensor to an int64.
+static Expected<TensorMetadata> TfHashOpMd(const TensorMetadata& input) {
+  if (input.dtype != DType::String && input.dtype != DType::I32 &&
+      input.dtype != DType::I64)
+    return MakeStringError("unsupported dtype for hashing: ", input.dtype);
+  return TensorMetadata(DType(DType::I64), input.shape);
+}
+
+static Expected<TensorMetadata> TfStringToHashBucketFastOpMd(
+    const TensorMetadata& input, const OpAttrsRef& attrs) {
+  if (input.dtype != DType::String)
+    return MakeStringError(
+        "input of tf.StringToHashBucketFast must be a string tensor");
+  int64_t num_buckets;
+  if (!attrs.Get("num_buckets", &num_buckets))
+    return MakeStringError(
+        "'num_buckets' attribute is not specified for StringToHashBucketFast "
+        "op");
+  return TfHashOpMd(input);
+}
+
+// tf.QuantizedMatMul multiplies a quint8 lhs with a qint8 rhs. It returns the
+// qint32 accumulators, and the fused variant returns the requantized quint8
+// result.
+static Expected<TensorMetadata> QuantizedMatMulMd(
+    const TensorMetadata& a, const TensorMetadata& b,
+    VariadicOpArg<TensorMetadata> _, const OpAttrsRef& attrs,
+    DType output_dtype) {
+  if (a.dtype != DType::QUI8 || b.dtype != DType::QI8)
+    return MakeStringError("unsupported dtypes for QuantizedMatMul: In[0]: ",
+                           a.dtype, ", In[1]: ", b.dtype);
+
+  TFRT_ASSIGN_OR_RETURN(auto shape, MatMulShape(a, b, attrs));
+  return TensorMetadata(output_dtype, shape);
+}
+
+static Expected<TensorMetadata> TfQuantizedMatMulOpMd(
+    const TensorMetadata& a, const TensorMetadata& b,
+    VariadicOpArg<TensorMetadata> fusion_inputs, const OpAttrsRef& attrs) {
+  return QuantizedMatMulMd(a, b, fusion_inputs, attrs, DType::QI32);
+}
+
+static Expected<TensorMetadata> TfFusedQuantizedMatMulOpMd(
+    const TensorMetadata& a, const TensorMetadata& b,
+    VariadicOpArg<TensorMetadata> fusion_inputs, const OpAttrsRef& attrs) {
+  return QuantizedMatMulMd(a, b, fusion_inputs, attrs, DType::QUI8);
 }
 
 static Expected<TensorMetadata> TfConvOpMd(const TensorMetadata& input,
@@ -387,13 +568,6 @@ static Expected<TensorMetadata> TfTransposeOpMdImpl(const TensorMetadata& input,
   return TensorMetadata(input.dtype, output_dims);
 }
 
-static Expected<TensorMetadata> TfTransposeOpMd(const TensorMetadata& input,
-                                                const TensorMetadata& /*perm*/,
-                                                const OpAttrsRef& attrs) {
-  static constexpr Index default_perm[] = {0, 3, 1, 2};
-  return TfTransposeOpMdImpl(input, default_perm, attrs);
-}
-
 static Expected<TensorMetadata> TfTransposeOpFoldedMd(
     const TensorMetadata& input, const OpAttrsRef& attrs) {
   DenseAttr perm_attr;
@@ -492,10 +666,20 @@ GetAllTFMetadataFunctions() {
     result->emplace_back("tf.Tanh", TFRT_METADATA(UnaryIdentityMd));
     result->emplace_back("tf.MatMul", TFRT_METADATA(MatMulMd));
     result->emplace_back("tf._FusedMatMul", TFRT_METADATA(MatMulMd));
+    result->emplace_back("tf.BatchMatMulV2",
+                         TFRT_METADATA(TfBatchMatMulV2OpMd));
+    result->emplace_back("tf.QuantizedMatMul",
+                         TFRT_METADATA(TfQuantizedMatMulOpMd));
+    result->emplace_back("tf._FusedQuantizedMatMul",
+                         TFRT_METADATA(TfFusedQuantizedMatMulOpMd));
+    result->emplace_back("tf._FusedElementwise",
+                         TFRT_METADATA(FusedElementwiseMd));
+    result->emplace_back("tf.Equal", TFRT_METADATA(TfBinaryComparisonOpMd));
     result->emplace_back("tf.Less", TFRT_METADATA(TfBinaryComparisonOpMd));
     result->emplace_back("tf.Log", TFRT_METADATA(UnaryIdentityMd));
     result->emplace_back("tf.Log1p", TFRT_METADATA(UnaryIdentityMd));
     result->emplace_back("tf.Relu", TFRT_METADATA(UnaryIdentityMd));
+    result->emplace_back("tf.ReluGrad", TFRT_METADATA(TfBinaryOpMd));
     result->emplace_back("tf.Conv2D", TFRT_METADATA(TfConvOpMd));
     result->emplace_back("tf.MaxPool", TFRT_METADATA(TfMaxPoolOpMd));
     result->emplace_back("_tf.Mean", TFRT_METADATA(TfMeanOpFoldedMd));
@@ -503,17 +687,23 @@ GetAllTFMetadataFunctions() {
     result->emplace_back("tf.RealDiv", TFRT_METADATA(TfBinaryOpMd));
     result->emplace_back("tf.Rsqrt", TFRT_METADATA(UnaryIdentityMd));
     result->emplace_back("tf.Shape", TFRT_METADATA(TfShapeOpMd));
+    result->emplace_back("tf.SparseEmbeddingLookup",
+                         TFRT_METADATA(TfSparseEmbeddingLookupOpMd));
     result->emplace_back("tf.Softmax", TFRT_METADATA(UnaryIdentityMd));
     result->emplace_back("tf.Sigmoid", TFRT_METADATA(UnaryIdentityMd));
     result->emplace_back("tf.LogSoftmax", TFRT_METADATA(UnaryIdentityMd));
+    result->emplace_back("tf._ScaledDotProductAttention",
+                         TFRT_METADATA(TfScaledDotProductAttentionOpMd));
     result->emplace_back("tf.Sub", TFRT_METADATA(TfBinaryOpMd));
     result->emplace_back("tf.BiasAdd", TFRT_METADATA(TfBiasAddOpMd));
+    result->emplace_back("tf.StringToHashBucketFast",
+                         TFRT_METADATA(TfStringToHashBucketFastOpMd));
+    result->emplace_back("tf.Fingerprint64", TFRT_METADATA(TfHashOpMd));
     result->emplace_back("tf.FusedBatchNormV3", TFRT_METADATA(TfBatchNormOpMd));
     result->emplace_back("tf._FusedBatchNormEx",
                          TFRT_METADATA(TfFusedBatchNormExOpMd));
     result->emplace_back("tf.Pad", TFRT_METADATA(TfPadOpMd));
     result->emplace_back("_tf.Pad", TFRT_METADATA(TfPadOpFoldedMd));
-    result->emplace_back("tf.Transpose", TFRT_METADATA(TfTransposeOpMd));
     result->emplace_back("_tf.Transpose", TFRT_METADATA(TfTransposeOpFoldedMd));
     result->emplace_back("tf.Cast", TFRT_METADATA(TfCastOpMd));
     result->emplace_back("tf.ZerosLike", TFRT_METADATA(TfZerosLikeOpMd));
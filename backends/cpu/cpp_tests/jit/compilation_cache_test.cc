@@ -0,0 +1,159 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Unit tests for the compilation cache of JIT-compiled CPU ops.
+
+#include "tfrt/cpu/jit/compilation_cache.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/FileSystem.h"
+#include "tfrt/core_runtime/op_attrs.h"
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/io/file_system.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/tensor/tensor_metadata.h"
+
+namespace tfrt {
+namespace cpu {
+namespace {
+
+std::string GetKey(int32_t transpose_a, ArrayRef<Index> shape,
+                   string_view cpu_features = "cpu,+avx2") {
+  OpAttrs attrs;
+  attrs.Set<int32_t>("transpose_a", transpose_a);
+  attrs.SetArray<int64_t>("dims", {1, 2});
+  TensorMetadata argument(DType(DType::F32), shape);
+  return ComputeCompilationCacheKey("tf.MatMul", OpAttrsRef(attrs), argument,
+                                    cpu_features);
+}
+
+// Returns a new empty directory for the test.
+std::string GetCacheDirectory(string_view name) {
+  std::string directory = ::testing::TempDir() + "/" + name.str();
+  llvm::sys::fs::remove_directories(directory);
+  EXPECT_FALSE(llvm::sys::fs::create_directories(directory));
+  return directory;
+}
+
+void WriteFile(const std::string& path, string_view contents) {
+  auto* file_system = io::FileSystemRegistry::Default()->LookupForPath(path);
+  std::unique_ptr<io::WritableFile> file;
+  ASSERT_FALSE(static_cast<bool>(file_system->NewWritableFile(path, &file)));
+  ASSERT_FALSE(static_cast<bool>(file->Append({contents})));
+  ASSERT_FALSE(static_cast<bool>(file->Close()));
+}
+
+TEST(CompilationCacheTest, KeyDependsOnAttributesShapesAndCpu) {
+  const std::string key = GetKey(0, {2, 3});
+  EXPECT_EQ(key, GetKey(0, {2, 3}));
+  EXPECT_NE(key, GetKey(1, {2, 3}));
+  EXPECT_NE(key, GetKey(0, {3, 2}));
+  EXPECT_NE(key, GetKey(0, {2, 3}, "cpu,-avx2"));
+}
+
+TEST(CompilationCacheTest, CompilesOnce) {
+  CompilationCache cache("");
+  int num_compiles = 0;
+  auto compile = [&]() -> llvm::Expected<std::string> {
+    ++num_compiles;
+    return std::string("object");
+  };
+
+  auto first = cache.GetOrCompile("key", compile);
+  ASSERT_TRUE(static_cast<bool>(first));
+  auto second = cache.GetOrCompile("key", compile);
+  ASSERT_TRUE(static_cast<bool>(second));
+  EXPECT_EQ(first->get(), second->get());
+  EXPECT_EQ((*second)->data(), "object");
+  EXPECT_EQ(num_compiles, 1);
+}
+
+TEST(CompilationCacheTest, CompileErrorIsNotCached) {
+  CompilationCache cache("");
+  auto compile = []() -> llvm::Expected<std::string> {
+    return MakeStringError("compilation failed");
+  };
+  auto artifact = cache.GetOrCompile("key", compile);
+  EXPECT_FALSE(static_cast<bool>(artifact));
+  llvm::consumeError(artifact.takeError());
+  EXPECT_EQ(cache.Lookup("key"), nullptr);
+}
+
+TEST(CompilationCacheTest, LoadsArtifactsOfAnotherCache) {
+  const std::string directory = GetCacheDirectory("persistent");
+  const std::string key = GetKey(0, {2, 3});
+  {
+    CompilationCache cache(directory);
+    EXPECT_FALSE(static_cast<bool>(cache.Insert(key, "object")));
+  }
+
+  CompilationCache cache(directory);
+  auto artifact = cache.Lookup(key);
+  ASSERT_NE(artifact, nullptr);
+  EXPECT_EQ(artifact->data(), "object");
+  EXPECT_EQ(cache.Lookup(GetKey(1, {2, 3})), nullptr);
+}
+
+TEST(CompilationCacheTest, CorruptFilesAreMisses) {
+  const std::string directory = GetCacheDirectory("corrupt");
+  const std::string key = GetKey(0, {2, 3});
+  {
+    CompilationCache cache(directory);
+    EXPECT_FALSE(static_cast<bool>(cache.Insert(key, "object")));
+  }
+
+  // Find the file of the artifact; it is the only file in the directory.
+  std::error_code ec;
+  llvm::sys::fs::directory_iterator it(directory, ec);
+  ASSERT_FALSE(ec);
+  const std::string path = it->path();
+
+  auto* file_system = io::FileSystemRegistry::Default()->LookupForPath(path);
+  std::unique_ptr<io::RandomAccessFile> file;
+  ASSERT_FALSE(
+      static_cast<bool>(file_system->NewRandomAccessFile(path, &file)));
+  std::string contents(1024, '\0');
+  auto count = file->Read(&contents[0], contents.size(), 0);
+  ASSERT_TRUE(static_cast<bool>(count));
+  contents.resize(*count);
+  file.reset();
+
+  // A truncated file.
+  WriteFile(path, string_view(contents).drop_back(1));
+  EXPECT_EQ(CompilationCache(directory).Lookup(key), nullptr);
+
+  // A file with trailing garbage.
+  WriteFile(path, contents + "x");
+  EXPECT_EQ(CompilationCache(directory).Lookup(key), nullptr);
+
+  // A file of another key with the same hash.
+  std::string other = contents;
+  other[other.find(key)] ^= 1;
+  WriteFile(path, other);
+  EXPECT_EQ(CompilationCache(directory).Lookup(key), nullptr);
+
+  WriteFile(path, contents);
+  auto artifact = CompilationCache(directory).Lookup(key);
+  ASSERT_NE(artifact, nullptr);
+  EXPECT_EQ(artifact->data(), "object");
+}
+
+}  // namespace
+}  // namespace cpu
+}  // namespace tfrt
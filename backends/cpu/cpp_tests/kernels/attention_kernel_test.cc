@@ -0,0 +1,183 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Scaled dot-product attention kernel tests.
+
+#include "../../lib/kernels/attention_kernel.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "tfrt/common/compat/eigen/eigen_evaluator.h"
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/host_context/resource_context.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+#include "tfrt/tensor/tensor_metadata.h"
+#include "tfrt/tensor/tensor_shape.h"
+
+namespace tfrt {
+namespace {
+
+using ::tfrt::compat::SyncEigenEvaluator;
+
+class AttentionKernelTest : public ::testing::Test {
+ protected:
+  AttentionKernelTest()
+      : host_([](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+              CreateMultiThreadedWorkQueue(4, 4)) {}
+
+  // Returns a tensor of `dims` filled with small distinct values.
+  DenseHostTensor MakeTensor(llvm::ArrayRef<Index> dims, float seed) {
+    TensorMetadata md(GetDType<float>(), TensorShape(dims));
+    auto tensor = DenseHostTensor::CreateUninitialized(md, &host_);
+    assert(tensor.has_value());
+    auto data = MutableDHTArrayView<float>(&*tensor).Elements();
+    for (size_t i = 0; i < data.size(); ++i)
+      data[i] = static_cast<float>((i * 7 + 3) % 13) * 0.125f - seed;
+    return std::move(*tensor);
+  }
+
+  // Returns a [batch, key_len] mask that attends to the first `lengths[b]`
+  // keys of the batch `b`.
+  DenseHostTensor MakeMask(llvm::ArrayRef<Index> lengths, Index key_len) {
+    TensorMetadata md(DType(DType::I1),
+                      TensorShape({static_cast<Index>(lengths.size()),
+                                   key_len}));
+    auto tensor = DenseHostTensor::CreateUninitialized(md, &host_);
+    assert(tensor.has_value());
+    auto data = MutableDHTArrayView<bool>(&*tensor).Elements();
+    for (size_t b = 0; b < lengths.size(); ++b)
+      for (Index k = 0; k < key_len; ++k)
+        data[b * key_len + k] = k < lengths[b];
+    return std::move(*tensor);
+  }
+
+  // Computes the attention with the kernel, and with a reference that
+  // materializes the scores, and checks that they match.
+  void ExpectMatchesReference(Index batch, Index heads, Index query_len,
+                              Index key_len, Index depth, Index value_depth,
+                              bool causal, const DenseHostTensor* mask) {
+    DenseHostTensor query =
+        MakeTensor({batch, heads, query_len, depth}, 0.5f);
+    DenseHostTensor key = MakeTensor({batch, heads, key_len, depth}, 0.75f);
+    DenseHostTensor value =
+        MakeTensor({batch, heads, key_len, value_depth}, 0.25f);
+    DenseHostTensor output =
+        MakeTensor({batch, heads, query_len, value_depth}, 0.0f);
+    const float scale = 1.0f / std::sqrt(static_cast<float>(depth));
+
+    Expected<RCReference<RequestContext>> req_ctx =
+        RequestContextBuilder(&host_, &resource_context_).build();
+    assert(req_ctx);
+    ExecutionContext exec_ctx(std::move(*req_ctx));
+    Error err = cpu::ScaledDotProductAttention<float, SyncEigenEvaluator>(
+        query, key, value, mask, &output, scale, causal, exec_ctx);
+    ASSERT_FALSE(err) << toString(std::move(err));
+
+    auto q = DHTArrayView<float>(&query).Elements();
+    auto k = DHTArrayView<float>(&key).Elements();
+    auto v = DHTArrayView<float>(&value).Elements();
+    auto o = DHTArrayView<float>(&output).Elements();
+    std::vector<float> scores(key_len);
+    for (Index b = 0; b < batch; ++b) {
+      for (Index h = 0; h < heads; ++h) {
+        const Index head = b * heads + h;
+        for (Index i = 0; i < query_len; ++i) {
+          float max = -std::numeric_limits<float>::infinity();
+          for (Index j = 0; j < key_len; ++j) {
+            float score = 0.0f;
+            for (Index d = 0; d < depth; ++d) {
+              score += q[(head * query_len + i) * depth + d] *
+                       k[(head * key_len + j) * depth + d];
+            }
+            const bool masked =
+                (causal && j > i + key_len - query_len) ||
+                (mask && !DHTArrayView<bool>(mask)[b * key_len + j]);
+            scores[j] = masked ? -std::numeric_limits<float>::infinity()
+                               : score * scale;
+            max = std::max(max, scores[j]);
+          }
+          float sum = 0.0f;
+          for (Index j = 0; j < key_len; ++j) {
+            scores[j] = std::isinf(max) ? 0.0f : std::exp(scores[j] - max);
+            sum += scores[j];
+          }
+          for (Index d = 0; d < value_depth; ++d) {
+            float expected = 0.0f;
+            for (Index j = 0; j < key_len; ++j)
+              expected += scores[j] * v[(head * key_len + j) * value_depth + d];
+            if (sum > 0.0f) expected /= sum;
+            EXPECT_NEAR(o[(head * query_len + i) * value_depth + d], expected,
+                        1e-4)
+                << "at batch " << b << ", head " << h << ", query " << i;
+          }
+        }
+      }
+    }
+  }
+
+  HostContext host_;
+  ResourceContext resource_context_;
+};
+
+TEST_F(AttentionKernelTest, MatchesReference) {
+  // Sequences of several query and key blocks, and of part of a block.
+  ExpectMatchesReference(2, 3, 70, 150, 16, 8, /*causal=*/false, nullptr);
+  ExpectMatchesReference(1, 1, 5, 7, 4, 4, /*causal=*/false, nullptr);
+}
+
+TEST_F(AttentionKernelTest, CausalMask) {
+  ExpectMatchesReference(2, 2, 100, 100, 8, 8, /*causal=*/true, nullptr);
+  // The queries are the last positions of a longer sequence.
+  ExpectMatchesReference(1, 2, 33, 130, 8, 8, /*causal=*/true, nullptr);
+}
+
+TEST_F(AttentionKernelTest, PaddingMask) {
+  DenseHostTensor mask = MakeMask({90, 0, 1}, 100);
+  ExpectMatchesReference(3, 2, 40, 100, 8, 4, /*causal=*/false, &mask);
+  ExpectMatchesReference(3, 2, 100, 100, 8, 4, /*causal=*/true, &mask);
+}
+
+TEST_F(AttentionKernelTest, InvalidMask) {
+  DenseHostTensor query = MakeTensor({1, 1, 4, 8}, 0.5f);
+  DenseHostTensor key = MakeTensor({1, 1, 6, 8}, 0.5f);
+  DenseHostTensor value = MakeTensor({1, 1, 6, 8}, 0.5f);
+  DenseHostTensor output = MakeTensor({1, 1, 4, 8}, 0.0f);
+  DenseHostTensor mask = MakeMask({6}, 5);
+
+  Expected<RCReference<RequestContext>> req_ctx =
+      RequestContextBuilder(&host_, &resource_context_).build();
+  assert(req_ctx);
+  ExecutionContext exec_ctx(std::move(*req_ctx));
+  Error err = cpu::ScaledDotProductAttention<float, SyncEigenEvaluator>(
+      query, key, value, &mask, &output, 1.0f, false, exec_ctx);
+  EXPECT_TRUE(!!err);
+  consumeError(std::move(err));
+}
+
+}  // namespace
+}  // namespace tfrt
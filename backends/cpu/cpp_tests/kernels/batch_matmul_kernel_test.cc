@@ -0,0 +1,191 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Batched MatMul kernel tests.
+
+#include "../../lib/kernels/batch_matmul_kernel.h"
+
+#include <cassert>
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "llvm/ADT/SmallVector.h"
+#include "tfrt/common/compat/eigen/eigen_evaluator.h"
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/host_context/resource_context.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+#include "tfrt/tensor/tensor_metadata.h"
+#include "tfrt/tensor/tensor_shape.h"
+
+namespace tfrt {
+namespace {
+
+using ::tfrt::compat::SyncEigenEvaluator;
+
+class BatchMatMulKernelTest : public ::testing::Test {
+ protected:
+  BatchMatMulKernelTest()
+      : host_([](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+              CreateMultiThreadedWorkQueue(4, 4)) {}
+
+  // Returns a tensor of `dims` filled with small distinct values.
+  DenseHostTensor MakeTensor(llvm::ArrayRef<Index> dims, float seed) {
+    TensorMetadata md(GetDType<float>(), TensorShape(dims));
+    auto tensor = DenseHostTensor::CreateUninitialized(md, &host_);
+    assert(tensor.has_value());
+    auto data = MutableDHTArrayView<float>(&*tensor).Elements();
+    for (size_t i = 0; i < data.size(); ++i)
+      data[i] = static_cast<float>((i * 7 + 3) % 11) * 0.25f - seed;
+    return std::move(*tensor);
+  }
+
+  std::vector<float> Run(const DenseHostTensor& a, const DenseHostTensor& b,
+                         llvm::ArrayRef<Index> out_dims, bool adj_x,
+                         bool adj_y) {
+    Expected<RCReference<RequestContext>> req_ctx =
+        RequestContextBuilder(&host_, &resource_context_).build();
+    assert(req_ctx);
+    ExecutionContext exec_ctx(std::move(*req_ctx));
+
+    DenseHostTensor c = MakeTensor(out_dims, 0.0f);
+    Error err = cpu::BatchMatMul<float>(a, b, &c, adj_x, adj_y, exec_ctx,
+                                        SyncEigenEvaluator(&host_));
+    EXPECT_FALSE(err) << toString(std::move(err));
+
+    auto elements = DHTArrayView<float>(&c).Elements();
+    return std::vector<float>(elements.begin(), elements.end());
+  }
+
+  // Returns the batched product of `a` and `b` computed one element at a time.
+  static std::vector<float> Reference(const DenseHostTensor& a,
+                                      const DenseHostTensor& b,
+                                      llvm::ArrayRef<Index> out_dims,
+                                      bool adj_x, bool adj_y) {
+    llvm::SmallVector<Index, 4> a_dims, b_dims;
+    a.shape().GetDimensions(&a_dims);
+    b.shape().GetDimensions(&b_dims);
+    const Index a_rows = a_dims[a_dims.size() - 2], a_cols = a_dims.back();
+    const Index b_rows = b_dims[b_dims.size() - 2], b_cols = b_dims.back();
+    const Index m = adj_x ? a_cols : a_rows;
+    const Index k = adj_x ? a_rows : a_cols;
+    const Index n = adj_y ? b_rows : b_cols;
+    auto a_data = DHTArrayView<float>(&a).Elements();
+    auto b_data = DHTArrayView<float>(&b).Elements();
+
+    // Returns the matrix of `dims` that is broadcast to the output matrix
+    // with the batch index `index`.
+    auto matrix = [&](llvm::ArrayRef<Index> dims,
+                      llvm::ArrayRef<Index> index) {
+      Index offset = 0;
+      const size_t batch_rank = dims.size() - 2;
+      for (size_t d = 0; d < batch_rank; ++d) {
+        const Index i = index[index.size() - batch_rank + d];
+        offset = offset * dims[d] + (dims[d] == 1 ? 0 : i);
+      }
+      return offset;
+    };
+
+    const size_t batch_rank = out_dims.size() - 2;
+    Index num_batches = 1;
+    for (size_t d = 0; d < batch_rank; ++d) num_batches *= out_dims[d];
+
+    std::vector<float> c(num_batches * m * n, 0.0f);
+    llvm::SmallVector<Index, 4> index(batch_rank, 0);
+    for (Index batch = 0; batch < num_batches; ++batch) {
+      Index rest = batch;
+      for (size_t d = batch_rank; d-- > 0;) {
+        index[d] = rest % out_dims[d];
+        rest /= out_dims[d];
+      }
+      const float* a_matrix = &a_data[matrix(a_dims, index) * m * k];
+      const float* b_matrix = &b_data[matrix(b_dims, index) * k * n];
+      float* c_matrix = &c[batch * m * n];
+      for (Index i = 0; i < m; ++i)
+        for (Index j = 0; j < n; ++j)
+          for (Index l = 0; l < k; ++l)
+            c_matrix[i * n + j] +=
+                (adj_x ? a_matrix[l * m + i] : a_matrix[i * k + l]) *
+                (adj_y ? b_matrix[j * k + l] : b_matrix[l * n + j]);
+    }
+    return c;
+  }
+
+  void ExpectMatchesReference(llvm::ArrayRef<Index> a_dims,
+                              llvm::ArrayRef<Index> b_dims,
+                              llvm::ArrayRef<Index> out_dims, bool adj_x,
+                              bool adj_y) {
+    DenseHostTensor a = MakeTensor(a_dims, 0.5f);
+    DenseHostTensor b = MakeTensor(b_dims, 1.0f);
+    std::vector<float> actual = Run(a, b, out_dims, adj_x, adj_y);
+    std::vector<float> expected = Reference(a, b, out_dims, adj_x, adj_y);
+    ASSERT_EQ(actual.size(), expected.size());
+    for (size_t i = 0; i < actual.size(); ++i)
+      EXPECT_NEAR(actual[i], expected[i], 1e-3) << "at index " << i;
+  }
+
+  HostContext host_;
+  ResourceContext resource_context_;
+};
+
+TEST_F(BatchMatMulKernelTest, BroadcastsBatch) {
+  ExpectMatchesReference({2, 1, 3, 4}, {3, 4, 5}, {2, 3, 3, 5}, false, false);
+  ExpectMatchesReference({3, 4}, {2, 4, 5}, {2, 3, 5}, false, false);
+}
+
+TEST_F(BatchMatMulKernelTest, Adjoints) {
+  for (bool adj_x : {false, true}) {
+    for (bool adj_y : {false, true}) {
+      ExpectMatchesReference({2, adj_x ? 4 : 3, adj_x ? 3 : 4},
+                             {2, adj_y ? 5 : 4, adj_y ? 4 : 5}, {2, 3, 5},
+                             adj_x, adj_y);
+    }
+  }
+}
+
+TEST_F(BatchMatMulKernelTest, SharedRhs) {
+  // The same weights are multiplied with the stacked lhs matrices, and are
+  // packed once they are seen again.
+  DenseHostTensor a = MakeTensor({3, 2, 8}, 0.5f);
+  DenseHostTensor b = MakeTensor({1, 8, 5}, 1.0f);
+  std::vector<float> expected = Reference(a, b, {3, 2, 5}, false, false);
+  for (int run = 0; run < 3; ++run) {
+    std::vector<float> actual = Run(a, b, {3, 2, 5}, false, false);
+    ASSERT_EQ(actual.size(), expected.size());
+    for (size_t i = 0; i < actual.size(); ++i)
+      EXPECT_NEAR(actual[i], expected[i], 1e-3) << "at index " << i;
+  }
+  ExpectMatchesReference({3, 2, 8}, {5, 8}, {3, 2, 5}, false, true);
+}
+
+TEST_F(BatchMatMulKernelTest, LargeMatricesInSmallBatch) {
+  // Fewer matrices than threads, each multiplied by all threads.
+  ExpectMatchesReference({2, 128, 128}, {2, 128, 128}, {2, 128, 128}, false,
+                         false);
+}
+
+TEST_F(BatchMatMulKernelTest, EmptyBatch) {
+  ExpectMatchesReference({0, 3, 4}, {4, 5}, {0, 3, 5}, false, false);
+}
+
+}  // namespace
+}  // namespace tfrt
@@ -0,0 +1,156 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Cast kernel tests.
+
+#include "../../lib/kernels/cast_kernel.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "tfrt/common/compat/eigen/eigen_dtype.h"
+#include "tfrt/common/compat/eigen/eigen_evaluator.h"
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/host_context/resource_context.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+#include "tfrt/tensor/tensor_metadata.h"
+#include "tfrt/tensor/tensor_shape.h"
+
+namespace tfrt {
+namespace {
+
+using ::tfrt::compat::SyncEigenEvaluator;
+using ::tfrt::cpu::CastRounding;
+
+class CastKernelTest : public ::testing::Test {
+ protected:
+  CastKernelTest()
+      : host_([](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+              CreateMultiThreadedWorkQueue(4, 4)) {}
+
+  template <typename T>
+  DenseHostTensor MakeTensor(const std::vector<T>& values) {
+    TensorMetadata md(GetDType<T>(),
+                      TensorShape({static_cast<Index>(values.size())}));
+    auto tensor = DenseHostTensor::CreateUninitialized(md, &host_);
+    assert(tensor.has_value());
+    auto data = MutableDHTArrayView<T>(&*tensor).Elements();
+    for (size_t i = 0; i < values.size(); ++i) data[i] = values[i];
+    return std::move(*tensor);
+  }
+
+  template <typename SrcT, typename DstT>
+  std::vector<DstT> Cast(const std::vector<SrcT>& values,
+                         CastRounding rounding = CastRounding::kTruncate) {
+    Expected<RCReference<RequestContext>> req_ctx =
+        RequestContextBuilder(&host_, &resource_context_).build();
+    assert(req_ctx);
+    ExecutionContext exec_ctx(std::move(*req_ctx));
+
+    DenseHostTensor input = MakeTensor(values);
+    DenseHostTensor output = MakeTensor(std::vector<DstT>(values.size()));
+    Error err = cpu::Cast<SrcT, DstT, SyncEigenEvaluator>(input, &output,
+                                                          rounding, exec_ctx);
+    EXPECT_FALSE(err) << toString(std::move(err));
+
+    auto elements = DHTArrayView<DstT>(&output).Elements();
+    return std::vector<DstT>(elements.begin(), elements.end());
+  }
+
+  HostContext host_;
+  ResourceContext resource_context_;
+};
+
+TEST_F(CastKernelTest, ReducedPrecisionRoundTrip) {
+  const std::vector<float> values = {0.0f, 1.0f, -2.5f, 0.125f, 1024.0f};
+  EXPECT_EQ((Cast<Eigen::bfloat16, float>(
+                Cast<float, Eigen::bfloat16>(values))),
+            values);
+  EXPECT_EQ((Cast<Eigen::half, float>(Cast<float, Eigen::half>(values))),
+            values);
+
+  // 16-bit floats are converted to each other by the way of float.
+  EXPECT_EQ((Cast<Eigen::half, float>(Cast<Eigen::bfloat16, Eigen::half>(
+                Cast<float, Eigen::bfloat16>(values)))),
+            values);
+}
+
+TEST_F(CastKernelTest, SaturatesFloatToInt8) {
+  const float inf = std::numeric_limits<float>::infinity();
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  EXPECT_EQ((Cast<float, int8_t>({300.0f, -300.0f, inf, -inf, nan, 127.9f})),
+            (std::vector<int8_t>{127, -128, 127, -128, 0, 127}));
+  EXPECT_EQ((Cast<Eigen::half, int8_t>(
+                {Eigen::half(1000.0f), Eigen::half(-7.5f)})),
+            (std::vector<int8_t>{127, -7}));
+  EXPECT_EQ((Cast<double, uint8_t>({-1.0, 256.0, 3.9})),
+            (std::vector<uint8_t>{0, 255, 3}));
+}
+
+TEST_F(CastKernelTest, SaturatesFloatToInt32) {
+  // float(INT32_MAX) is 2^31, which does not fit in int32.
+  std::vector<int32_t> result = Cast<float, int32_t>({3e9f, -3e9f});
+  EXPECT_GT(result[0], 2147483000);
+  EXPECT_EQ(result[1], std::numeric_limits<int32_t>::lowest());
+}
+
+TEST_F(CastKernelTest, RoundingModes) {
+  const std::vector<float> values = {2.5f, -2.5f, 3.5f, 0.5f, -3.7f};
+  EXPECT_EQ((Cast<float, int8_t>(values, CastRounding::kTruncate)),
+            (std::vector<int8_t>{2, -2, 3, 0, -3}));
+  EXPECT_EQ((Cast<float, int8_t>(values, CastRounding::kHalfToEven)),
+            (std::vector<int8_t>{2, -2, 4, 0, -4}));
+  EXPECT_EQ((Cast<float, int8_t>(values, CastRounding::kHalfAwayFromZero)),
+            (std::vector<int8_t>{3, -3, 4, 1, -4}));
+}
+
+TEST_F(CastKernelTest, BoolAndComplex) {
+  EXPECT_EQ((Cast<float, bool>({0.0f, -0.5f, 2.0f})),
+            (std::vector<bool>{false, true, true}));
+  EXPECT_EQ((Cast<bool, int32_t>({true, false})),
+            (std::vector<int32_t>{1, 0}));
+  EXPECT_EQ((Cast<std::complex<float>, int8_t>({{2.5f, 1.0f}, {-1e4f, 0.0f}},
+                                               CastRounding::kHalfToEven)),
+            (std::vector<int8_t>{2, -128}));
+  EXPECT_EQ((Cast<int32_t, std::complex<double>>({3})),
+            (std::vector<std::complex<double>>{{3.0, 0.0}}));
+}
+
+TEST_F(CastKernelTest, LargeTensor) {
+  std::vector<float> values(1 << 16);
+  for (size_t i = 0; i < values.size(); ++i)
+    values[i] = static_cast<float>(i % 512) - 256.0f;
+  std::vector<int8_t> result = Cast<float, int8_t>(values);
+  for (size_t i = 0; i < values.size(); ++i)
+    ASSERT_EQ(result[i], static_cast<int8_t>(std::max(
+                             -128.0f, std::min(127.0f, values[i]))))
+        << "at index " << i;
+}
+
+}  // namespace
+}  // namespace tfrt
@@ -0,0 +1,191 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Collective kernels tests.
+
+#include "../../lib/kernels/collective_kernels.h"
+
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+#include "tfrt/tensor/tensor_metadata.h"
+#include "tfrt/tensor/tensor_shape.h"
+
+namespace tfrt {
+namespace cpu {
+namespace {
+
+// The ranks of a group, each with its own HostContext.
+class Group {
+ public:
+  Group(int size, size_t chunk_size)
+      : transport_(std::make_shared<InProcessCollectiveTransport>()) {
+    HostCommunicator::Options options;
+    options.chunk_size = chunk_size;
+    for (int rank = 0; rank < size; ++rank) {
+      hosts_.push_back(std::make_unique<HostContext>(
+          [](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+          CreateMultiThreadedWorkQueue(2, 2)));
+      Expected<RCReference<RequestContext>> req_ctx =
+          RequestContextBuilder(hosts_.back().get(),
+                                /*resource_context=*/nullptr)
+              .build();
+      assert(req_ctx);
+      exec_ctxs_.emplace_back(std::move(*req_ctx));
+      communicators_.push_back(
+          std::make_unique<HostCommunicator>(rank, size, transport_, options));
+    }
+  }
+
+  int size() const { return communicators_.size(); }
+  HostContext* host(int rank) { return hosts_[rank].get(); }
+  const ExecutionContext& exec_ctx(int rank) { return exec_ctxs_[rank]; }
+  HostCommunicator& communicator(int rank) { return *communicators_[rank]; }
+
+  template <typename T>
+  DenseHostTensor MakeTensor(int rank, Index size, T value_base) {
+    auto tensor = DenseHostTensor::CreateUninitialized(
+        TensorMetadata(GetDType<T>(), TensorShape({size})), host(rank));
+    assert(tensor.has_value());
+    auto elements = MutableDHTArrayView<T>(&*tensor).Elements();
+    for (Index i = 0; i < size; ++i) elements[i] = value_base + i;
+    return std::move(*tensor);
+  }
+
+  // Waits for the collective of every rank.
+  void Await(llvm::ArrayRef<AsyncValueRef<Chain>> chains) {
+    for (int rank = 0; rank < size(); ++rank) {
+      host(rank)->Await({chains[rank].CopyRCRef()});
+      ASSERT_FALSE(chains[rank].IsError()) << chains[rank].GetError();
+    }
+  }
+
+ private:
+  std::shared_ptr<InProcessCollectiveTransport> transport_;
+  std::vector<std::unique_ptr<HostContext>> hosts_;
+  std::vector<ExecutionContext> exec_ctxs_;
+  std::vector<std::unique_ptr<HostCommunicator>> communicators_;
+};
+
+TEST(CollectiveKernelsTest, RingAllReduceSum) {
+  // Uneven segments of several chunks.
+  Group group(/*size=*/4, /*chunk_size=*/4 * sizeof(float));
+  const Index size = 37;
+
+  std::vector<DenseHostTensor> tensors;
+  std::vector<AsyncValueRef<Chain>> chains;
+  for (int rank = 0; rank < group.size(); ++rank) {
+    tensors.push_back(group.MakeTensor<float>(rank, size, 100.0f * rank));
+    chains.push_back(group.communicator(rank).AllReduce(
+        tensors.back().CopyRef(), CollectiveReduction::kSum,
+        AllReduceAlgorithm::kRing, group.exec_ctx(rank)));
+  }
+  group.Await(chains);
+
+  for (const DenseHostTensor& tensor : tensors) {
+    auto elements = DHTArrayView<float>(&tensor).Elements();
+    for (Index i = 0; i < size; ++i) EXPECT_EQ(elements[i], 600.0f + 4 * i);
+  }
+}
+
+TEST(CollectiveKernelsTest, TreeAllReduceMax) {
+  Group group(/*size=*/5, /*chunk_size=*/3 * sizeof(int32_t));
+  const Index size = 10;
+
+  std::vector<DenseHostTensor> tensors;
+  std::vector<AsyncValueRef<Chain>> chains;
+  for (int rank = 0; rank < group.size(); ++rank) {
+    // Rank 3 holds the largest values.
+    const int32_t base = rank == 3 ? 1000 : rank;
+    tensors.push_back(group.MakeTensor<int32_t>(rank, size, base));
+    chains.push_back(group.communicator(rank).AllReduce(
+        tensors.back().CopyRef(), CollectiveReduction::kMax,
+        AllReduceAlgorithm::kTree, group.exec_ctx(rank)));
+  }
+  group.Await(chains);
+
+  for (const DenseHostTensor& tensor : tensors) {
+    auto elements = DHTArrayView<int32_t>(&tensor).Elements();
+    for (Index i = 0; i < size; ++i) EXPECT_EQ(elements[i], 1000 + i);
+  }
+}
+
+TEST(CollectiveKernelsTest, AllGather) {
+  Group group(/*size=*/3, /*chunk_size=*/2 * sizeof(int64_t));
+  const Index size = 5;
+
+  std::vector<DenseHostTensor> outputs;
+  std::vector<AsyncValueRef<Chain>> chains;
+  for (int rank = 0; rank < group.size(); ++rank) {
+    outputs.push_back(group.MakeTensor<int64_t>(rank, size * group.size(), 0));
+    chains.push_back(group.communicator(rank).AllGather(
+        group.MakeTensor<int64_t>(rank, size, 10 * rank),
+        outputs.back().CopyRef(), group.exec_ctx(rank)));
+  }
+  group.Await(chains);
+
+  for (const DenseHostTensor& output : outputs) {
+    auto elements = DHTArrayView<int64_t>(&output).Elements();
+    for (int rank = 0; rank < group.size(); ++rank) {
+      for (Index i = 0; i < size; ++i)
+        EXPECT_EQ(elements[rank * size + i], 10 * rank + i);
+    }
+  }
+}
+
+TEST(CollectiveKernelsTest, Broadcast) {
+  Group group(/*size=*/5, /*chunk_size=*/sizeof(double));
+  const Index size = 4;
+  const int root = 2;
+
+  std::vector<DenseHostTensor> tensors;
+  std::vector<AsyncValueRef<Chain>> chains;
+  for (int rank = 0; rank < group.size(); ++rank) {
+    tensors.push_back(group.MakeTensor<double>(rank, size, rank));
+    chains.push_back(group.communicator(rank).Broadcast(
+        tensors.back().CopyRef(), root, group.exec_ctx(rank)));
+  }
+  group.Await(chains);
+
+  for (const DenseHostTensor& tensor : tensors) {
+    auto elements = DHTArrayView<double>(&tensor).Elements();
+    for (Index i = 0; i < size; ++i) EXPECT_EQ(elements[i], root + i);
+  }
+}
+
+TEST(CollectiveKernelsTest, UnsupportedDType) {
+  Group group(/*size=*/1, /*chunk_size=*/1024);
+  auto chain = group.communicator(0).AllReduce(
+      group.MakeTensor<int8_t>(0, 4, 0), CollectiveReduction::kSum,
+      AllReduceAlgorithm::kRing, group.exec_ctx(0));
+  group.host(0)->Await({chain.CopyRCRef()});
+  EXPECT_TRUE(chain.IsError());
+}
+
+}  // namespace
+}  // namespace cpu
+}  // namespace tfrt
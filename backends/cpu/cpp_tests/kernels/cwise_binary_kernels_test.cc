@@ -16,6 +16,9 @@
 
 #include "../../lib/kernels/cwise_binary_kernels.h"
 
+#include <algorithm>
+#include <vector>
+
 #include "benchmark/benchmark.h"
 #include "gtest/gtest.h"
 #include "tfrt/common/ops/tf/bcast.h"
@@ -27,6 +30,7 @@
 #include "tfrt/host_context/host_context.h"
 #include "tfrt/support/latch.h"
 #include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/scalar_host_tensor.h"
 #include "tfrt/tensor/tensor_metadata.h"
 #include "tfrt/tensor/tensor_shape.h"
 
@@ -37,8 +41,109 @@ std::unique_ptr<HostContext> CreateTestHostContext(int num_threads) {
       [](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
       CreateMultiThreadedWorkQueue(num_threads, num_threads));
 }
+
+DenseHostTensor MakeTensor(HostContext* host, ArrayRef<Index> dims,
+                           ArrayRef<float> values) {
+  TensorMetadata md(GetDType<float>(), TensorShape(dims));
+  auto tensor = DenseHostTensor::CreateUninitialized(md, host);
+  assert(tensor.has_value());
+  std::copy(values.begin(), values.end(),
+            static_cast<float*>(tensor->data()));
+  return std::move(*tensor);
+}
+
+template <typename Functor>
+std::vector<float> SyncBinary(HostContext* host, const DenseHostTensor& lhs,
+                              const DenseHostTensor& rhs) {
+  TensorShape out_shape =
+      GetBroadcastedShape(lhs.shape(), rhs.shape()).get();
+  TensorMetadata out_md(GetDType<float>(), out_shape);
+  auto out = DenseHostTensor::CreateUninitialized(out_md, host);
+
+  Error error = Error::success();
+  ::tfrt::cpu::BinaryKernel<Functor, compat::SyncEigenEvaluator>(
+      lhs, rhs, &*out, *host, [&](Error err) { error = std::move(err); });
+  EXPECT_FALSE(error);
+
+  auto* data = static_cast<const float*>(out->data());
+  return std::vector<float>(data, data + out->NumElements());
+}
 }  // namespace
 
+TEST(CwiseBinaryKernelsTest, BroadcastFastPaths) {
+  auto host = CreateTestHostContext(1);
+  using Add = typename ::tfrt::cpu::functor::Add::Functor<float>;
+  using Sub = typename ::tfrt::cpu::functor::Sub::Functor<float>;
+  using Mul = typename ::tfrt::cpu::functor::Mul::Functor<float>;
+
+  auto matrix = MakeTensor(host.get(), {2, 3}, {1, 2, 3, 4, 5, 6});
+
+  // Row vector: [2, 3] + [3].
+  auto row = MakeTensor(host.get(), {3}, {10, 20, 30});
+  EXPECT_EQ(SyncBinary<Add>(host.get(), matrix, row),
+            std::vector<float>({11, 22, 33, 14, 25, 36}));
+
+  // Column vector on the left hand side: [2, 1] - [2, 3].
+  auto column = MakeTensor(host.get(), {2, 1}, {10, 20});
+  EXPECT_EQ(SyncBinary<Sub>(host.get(), column, matrix),
+            std::vector<float>({9, 8, 7, 16, 15, 14}));
+
+  // Middle dimension: [2, 2, 3] * [2, 1, 3].
+  auto tensor = MakeTensor(host.get(), {2, 2, 3},
+                           {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12});
+  auto middle = MakeTensor(host.get(), {2, 1, 3}, {1, 2, 3, -1, -2, -3});
+  EXPECT_EQ(SyncBinary<Mul>(host.get(), tensor, middle),
+            std::vector<float>({1, 4, 9, 4, 10, 18, -7, -16, -27, -10, -22,
+                                -36}));
+}
+
+TEST(CwiseBinaryKernelsTest, ReluGrad) {
+  auto host = CreateTestHostContext(1);
+  using ReluGrad = typename ::tfrt::cpu::functor::ReluGrad::Functor<float>;
+
+  // Large enough for the packet path and the scalar tail.
+  std::vector<float> features, gradients, expected;
+  for (int i = 0; i < 37; ++i) {
+    features.push_back(i % 3 - 1.0f);
+    gradients.push_back(i + 1.0f);
+    expected.push_back(i % 3 == 2 ? i + 1.0f : 0.0f);
+  }
+
+  auto gradients_t = MakeTensor(host.get(), {37}, gradients);
+  auto features_t = MakeTensor(host.get(), {37}, features);
+  EXPECT_EQ(SyncBinary<ReluGrad>(host.get(), gradients_t, features_t),
+            expected);
+}
+
+TEST(CwiseBinaryKernelsTest, ScalarTensor) {
+  auto host = CreateTestHostContext(1);
+  using Sub = typename ::tfrt::cpu::functor::Sub::Functor<float>;
+
+  auto tensor = MakeTensor(host.get(), {1, 3}, {1, 2, 3});
+
+  auto sync_binary = [&](const HostTensor& lhs, const HostTensor& rhs,
+                         ArrayRef<Index> out_dims) {
+    TensorMetadata out_md(GetDType<float>(), TensorShape(out_dims));
+    auto out = DenseHostTensor::CreateUninitialized(out_md, host.get());
+    Error error = Error::success();
+    ::tfrt::cpu::BinaryKernel<Sub, compat::SyncEigenEvaluator>(
+        lhs, rhs, &*out, *host, [&](Error err) { error = std::move(err); });
+    EXPECT_FALSE(error);
+    auto* data = static_cast<const float*>(out->data());
+    return std::vector<float>(data, data + out->NumElements());
+  };
+
+  // The scalar has fewer elements than the tensor: [] - [1, 3].
+  ScalarHostTensor<float> scalar(TensorShape({}), 10);
+  EXPECT_EQ(sync_binary(scalar, tensor, {1, 3}),
+            std::vector<float>({9, 8, 7}));
+
+  // The scalar has more elements than the tensor: [1, 3] - [2, 1].
+  ScalarHostTensor<float> column(TensorShape({2, 1}), 10);
+  EXPECT_EQ(sync_binary(tensor, column, {2, 3}),
+            std::vector<float>({-9, -8, -7, -9, -8, -7}));
+}
+
 void BinaryKernel(benchmark::State& state, int num_threads,
                   const TensorShape& lhs_shape, const TensorShape& rhs_shape) {
   auto host = CreateTestHostContext(num_threads);
@@ -106,4 +211,28 @@ BM_Add_TensorD2_Scalar(4, 1500, 300);
 BM_Add_TensorD2_Scalar(8, 1500, 300);
 BM_Add_TensorD2_Scalar(16, 1500, 300);
 
+void AddTensorRow(benchmark::State& state, int num_threads,
+                  ArrayRef<Index> tensor_dims) {
+  TensorShape lhs_shape(tensor_dims);
+  TensorShape rhs_shape(ArrayRef<Index>{tensor_dims.back()});
+  BinaryKernel(state, num_threads, lhs_shape, rhs_shape);
+}
+
+#define BM_Add_TensorD2_Row(threads, D0, D1)                  \
+  static void BM_AddTensor_##D0##x##D1##_Row_tpool_##threads( \
+      benchmark::State& state) {                              \
+    AddTensorRow(state, threads, {D0, D1});                   \
+  }                                                           \
+  BENCHMARK(BM_AddTensor_##D0##x##D1##_Row_tpool_##threads)
+
+// [300, 300] + [300]
+BM_Add_TensorD2_Row(4, 300, 300);
+BM_Add_TensorD2_Row(8, 300, 300);
+BM_Add_TensorD2_Row(16, 300, 300);
+
+// [1500, 300] + [300]
+BM_Add_TensorD2_Row(4, 1500, 300);
+BM_Add_TensorD2_Row(8, 1500, 300);
+BM_Add_TensorD2_Row(16, 1500, 300);
+
 }  // namespace tfrt
@@ -0,0 +1,220 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Fused element-wise kernel tests and benchmarks.
+
+#include "../../lib/kernels/fused_elementwise_kernel.h"
+
+#include <numeric>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/support/latch.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+#include "tfrt/tensor/tensor_metadata.h"
+#include "tfrt/tensor/tensor_shape.h"
+
+namespace tfrt {
+namespace {
+
+using ::tfrt::cpu::FusedElementwiseStep;
+using ::tfrt::cpu::ParseFusedElementwiseSteps;
+using ::tfrt::cpu::RunFusedElementwiseSteps;
+
+std::unique_ptr<HostContext> CreateTestHostContext(int num_threads) {
+  return std::make_unique<HostContext>(
+      [](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+      CreateMultiThreadedWorkQueue(num_threads, num_threads));
+}
+
+DenseHostTensor MakeTensor(HostContext* host, ArrayRef<Index> dims,
+                           ArrayRef<float> values) {
+  TensorMetadata md(GetDType<float>(), TensorShape(dims));
+  auto tensor = DenseHostTensor::CreateUninitialized(md, host);
+  assert(tensor.has_value());
+  assert(values.size() == tensor->NumElements());
+  std::copy(values.begin(), values.end(),
+            MutableDHTArrayView<float>(&*tensor).data());
+  return std::move(*tensor);
+}
+
+std::vector<float> Run(ArrayRef<string_view> fused_ops,
+                       const DenseHostTensor& input,
+                       ArrayRef<DenseHostTensor> fusion_inputs) {
+  auto steps = ParseFusedElementwiseSteps<float>(fused_ops, fusion_inputs,
+                                                 input.shape());
+  EXPECT_TRUE(!!steps) << toString(steps.takeError());
+  if (!steps) return {};
+
+  std::vector<float> output(input.NumElements());
+  RunFusedElementwiseSteps<float>(*steps, DHTArrayView<float>(&input).data(),
+                                  output.data(), 0, output.size());
+  return output;
+}
+
+Error ParseError(ArrayRef<string_view> fused_ops, const TensorShape& shape,
+                 ArrayRef<DenseHostTensor> fusion_inputs) {
+  auto steps =
+      ParseFusedElementwiseSteps<float>(fused_ops, fusion_inputs, shape);
+  if (steps) return Error::success();
+  return steps.takeError();
+}
+
+TEST(FusedElementwiseKernelTest, BiasAddRelu) {
+  auto host = CreateTestHostContext(1);
+  auto input = MakeTensor(host.get(), {2, 3}, {-1, 2, -3, 4, -5, 6});
+  auto bias = MakeTensor(host.get(), {3}, {1, -2, 3});
+
+  DenseHostTensor fusion_inputs[] = {bias.CopyRef()};
+  EXPECT_EQ(Run({"BiasAdd", "Relu"}, input, fusion_inputs),
+            std::vector<float>({0, 0, 0, 5, 0, 9}));
+}
+
+TEST(FusedElementwiseKernelTest, ScalarAndTensorOperands) {
+  auto host = CreateTestHostContext(1);
+  auto input = MakeTensor(host.get(), {2, 2}, {1, 2, 3, 4});
+  auto scale = MakeTensor(host.get(), {}, {2});
+  auto offset = MakeTensor(host.get(), {2, 2}, {-1, -2, -3, -4});
+  auto row = MakeTensor(host.get(), {2}, {10, 20});
+
+  DenseHostTensor fusion_inputs[] = {scale.CopyRef(), offset.CopyRef(),
+                                     row.CopyRef()};
+  // ((x * 2) - offset) / row, with row broadcast along the inner dimension.
+  EXPECT_EQ(Run({"Mul", "Sub", "RealDiv"}, input, fusion_inputs),
+            std::vector<float>({0.3f, 0.3f, 0.9f, 0.6f}));
+}
+
+TEST(FusedElementwiseKernelTest, InnerBroadcastAcrossTiles) {
+  auto host = CreateTestHostContext(1);
+
+  // More inner elements than fit in a tile, and a row count that makes the
+  // tile boundaries fall in the middle of the rows.
+  constexpr Index kRows = 3;
+  constexpr Index kCols = 3001;
+  std::vector<float> zeros(kRows * kCols, 0.0f);
+  std::vector<float> bias_values(kCols);
+  std::iota(bias_values.begin(), bias_values.end(), 0.0f);
+
+  auto input = MakeTensor(host.get(), {kRows, kCols}, zeros);
+  auto bias = MakeTensor(host.get(), {kCols}, bias_values);
+  DenseHostTensor fusion_inputs[] = {bias.CopyRef()};
+
+  auto steps = ParseFusedElementwiseSteps<float>({"BiasAdd"}, fusion_inputs,
+                                                 input.shape());
+  ASSERT_TRUE(!!steps);
+
+  // Run in two blocks, as parallel blocks would be.
+  std::vector<float> output(kRows * kCols);
+  const float* input_data = DHTArrayView<float>(&input).data();
+  RunFusedElementwiseSteps<float>(*steps, input_data, output.data(), 0, 4000);
+  RunFusedElementwiseSteps<float>(*steps, input_data, output.data(), 4000,
+                                  output.size());
+
+  for (Index i = 0; i < kRows * kCols; ++i)
+    ASSERT_EQ(output[i], static_cast<float>(i % kCols)) << "at " << i;
+}
+
+TEST(FusedElementwiseKernelTest, InPlace) {
+  auto host = CreateTestHostContext(1);
+  auto input = MakeTensor(host.get(), {4}, {-2, -1, 7, 8});
+
+  auto steps = ParseFusedElementwiseSteps<float>(
+      {"Relu6"}, ArrayRef<DenseHostTensor>(), input.shape());
+  ASSERT_TRUE(!!steps);
+
+  float* data = MutableDHTArrayView<float>(&input).data();
+  RunFusedElementwiseSteps<float>(*steps, data, data, 0, 4);
+  EXPECT_EQ(std::vector<float>(data, data + 4),
+            std::vector<float>({0, 0, 6, 6}));
+}
+
+TEST(FusedElementwiseKernelTest, InvalidFusion) {
+  auto host = CreateTestHostContext(1);
+  TensorShape shape({2, 3});
+  auto vector = MakeTensor(host.get(), {2}, {1, 2});
+  auto scalar = MakeTensor(host.get(), {}, {1});
+  DenseHostTensor vector_input[] = {vector.CopyRef()};
+  DenseHostTensor scalar_input[] = {scalar.CopyRef()};
+
+  EXPECT_TRUE(!!ParseError({}, shape, {}));
+  EXPECT_TRUE(!!ParseError({"Foo"}, shape, {}));
+  EXPECT_TRUE(!!ParseError({"AddV2"}, shape, {}));
+  EXPECT_TRUE(!!ParseError({"Relu"}, shape, scalar_input));
+  // BiasAdd requires a vector matching the inner dimension.
+  EXPECT_TRUE(!!ParseError({"BiasAdd"}, shape, scalar_input));
+  EXPECT_TRUE(!!ParseError({"AddV2"}, shape, vector_input));
+  EXPECT_FALSE(!!ParseError({"AddV2", "Relu"}, shape, scalar_input));
+}
+
+void FusedBiasAddRelu(benchmark::State& state, int num_threads, Index rows,
+                      Index cols) {
+  auto host = CreateTestHostContext(num_threads);
+  Expected<RCReference<RequestContext>> req_ctx =
+      RequestContextBuilder(host.get(), /*resource_context=*/nullptr).build();
+  ASSERT_FALSE(!req_ctx);
+  ExecutionContext exec_ctx(std::move(*req_ctx));
+
+  TensorMetadata input_md(GetDType<float>(), TensorShape({rows, cols}));
+  TensorMetadata bias_md(GetDType<float>(), TensorShape({cols}));
+  auto input = DenseHostTensor::CreateUninitialized(input_md, host.get());
+  auto bias = DenseHostTensor::CreateUninitialized(bias_md, host.get());
+  auto output = DenseHostTensor::CreateUninitialized(input_md, host.get());
+
+  llvm::SmallVector<string_view, 2> fused_ops = {"BiasAdd", "Relu"};
+  DenseHostTensor fusion_inputs[] = {bias->CopyRef()};
+  auto steps = ParseFusedElementwiseSteps<float>(fused_ops, fusion_inputs,
+                                                 input->shape());
+  ASSERT_TRUE(!!steps);
+
+  const float* input_data = DHTArrayView<float>(&*input).data();
+  float* output_data = MutableDHTArrayView<float>(&*output).data();
+  constexpr Index kTileSize = cpu::kFusedElementwiseTileBytes / sizeof(float);
+
+  for (auto _ : state) {
+    tfrt::latch done(1);
+    ParallelFor(exec_ctx).Execute(
+        rows * cols, ParallelFor::BlockSizes::Min(kTileSize),
+        [&](size_t begin, size_t end) {
+          RunFusedElementwiseSteps<float>(*steps, input_data, output_data,
+                                          begin, end);
+        },
+        [&]() { done.count_down(); });
+    done.wait();
+  }
+
+  state.SetItemsProcessed(rows * cols * state.iterations());
+}
+
+#define BM_FusedBiasAddRelu(threads, D0, D1)                     \
+  static void BM_FusedBiasAddRelu_##D0##x##D1##_tpool_##threads( \
+      benchmark::State& state) {                                 \
+    FusedBiasAddRelu(state, threads, D0, D1);                    \
+  }                                                              \
+  BENCHMARK(BM_FusedBiasAddRelu_##D0##x##D1##_tpool_##threads)
+
+BM_FusedBiasAddRelu(4, 300, 300);
+BM_FusedBiasAddRelu(8, 1500, 300);
+BM_FusedBiasAddRelu(16, 1500, 300);
+
+}  // namespace
+}  // namespace tfrt
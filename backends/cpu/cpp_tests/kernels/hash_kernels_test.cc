@@ -0,0 +1,193 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Feature hashing kernels tests and benchmarks.
+
+#include "../../lib/kernels/hash_kernels.h"
+
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/support/hash_util.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+#include "tfrt/tensor/string_host_tensor.h"
+#include "tfrt/tensor/tensor_metadata.h"
+#include "tfrt/tensor/tensor_shape.h"
+
+namespace tfrt {
+namespace {
+
+std::unique_ptr<HostContext> CreateTestHostContext(int num_threads) {
+  return std::make_unique<HostContext>(
+      [](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+      CreateMultiThreadedWorkQueue(num_threads, num_threads));
+}
+
+ExecutionContext CreateExecutionContext(HostContext* host) {
+  Expected<RCReference<RequestContext>> req_ctx =
+      RequestContextBuilder(host, /*resource_context=*/nullptr).build();
+  assert(req_ctx);
+  return ExecutionContext(std::move(*req_ctx));
+}
+
+AsyncValueRef<HostTensor> MakeStringTensor(HostContext* host, Index size) {
+  auto tensor =
+      StringHostTensor::CreateUninitialized(TensorShape({size}), host);
+  assert(tensor.has_value());
+  auto strings = tensor->strings();
+  for (Index i = 0; i < size; ++i) strings[i] = "token_" + std::to_string(i);
+  return AsyncValueRef<HostTensor>(
+      MakeAvailableAsyncValueRef<StringHostTensor>(std::move(*tensor))
+          .ReleaseRCRef());
+}
+
+template <typename T>
+AsyncValueRef<HostTensor> MakeIntegerTensor(HostContext* host, Index size) {
+  TensorMetadata md(GetDType<T>(), TensorShape({size}));
+  auto tensor = DenseHostTensor::CreateUninitialized(md, host);
+  assert(tensor.has_value());
+  auto elements = MutableDHTArrayView<T>(&*tensor).Elements();
+  for (Index i = 0; i < size; ++i) elements[i] = static_cast<T>(i - size / 2);
+  return AsyncValueRef<HostTensor>(
+      MakeAvailableAsyncValueRef<DenseHostTensor>(std::move(*tensor))
+          .ReleaseRCRef());
+}
+
+std::vector<int64_t> Hash(HostContext* host, AsyncValueRef<HostTensor> input,
+                          int64_t num_buckets) {
+  ExecutionContext exec_ctx = CreateExecutionContext(host);
+  TensorMetadata md(DType::I64, input->shape());
+  auto output = DenseHostTensor::CreateUninitialized(md, host);
+  assert(output.has_value());
+
+  AsyncValueRef<Chain> chain =
+      cpu::Hash(std::move(input), num_buckets, &*output, exec_ctx);
+  host->Await({chain.CopyRCRef()});
+  EXPECT_TRUE(chain.IsConcrete());
+
+  auto elements = DHTArrayView<int64_t>(&*output).Elements();
+  return std::vector<int64_t>(elements.begin(), elements.end());
+}
+
+TEST(HashKernelsTest, StringFingerprints) {
+  auto host = CreateTestHostContext(4);
+  constexpr Index kSize = 10000;
+  auto fingerprints = Hash(host.get(), MakeStringTensor(host.get(), kSize), 0);
+  ASSERT_EQ(fingerprints.size(), static_cast<size_t>(kSize));
+  for (Index i = 0; i < kSize; ++i) {
+    EXPECT_EQ(fingerprints[i],
+              static_cast<int64_t>(Hash64("token_" + std::to_string(i))));
+  }
+}
+
+TEST(HashKernelsTest, StringBuckets) {
+  auto host = CreateTestHostContext(4);
+  constexpr Index kSize = 10000;
+  constexpr int64_t kNumBuckets = 7;
+  auto buckets =
+      Hash(host.get(), MakeStringTensor(host.get(), kSize), kNumBuckets);
+  std::vector<int> counts(kNumBuckets);
+  for (Index i = 0; i < kSize; ++i) {
+    ASSERT_GE(buckets[i], 0);
+    ASSERT_LT(buckets[i], kNumBuckets);
+    EXPECT_EQ(buckets[i], static_cast<int64_t>(
+                              Hash64("token_" + std::to_string(i)) %
+                              kNumBuckets));
+    ++counts[buckets[i]];
+  }
+  for (int count : counts) EXPECT_GT(count, kSize / kNumBuckets / 2);
+}
+
+TEST(HashKernelsTest, IntegerFingerprints) {
+  auto host = CreateTestHostContext(4);
+  constexpr Index kSize = 100000;
+  auto fingerprints32 =
+      Hash(host.get(), MakeIntegerTensor<int32_t>(host.get(), kSize), 0);
+  auto fingerprints64 =
+      Hash(host.get(), MakeIntegerTensor<int64_t>(host.get(), kSize), 0);
+  EXPECT_EQ(fingerprints32, fingerprints64);
+  for (Index i = 0; i < kSize; ++i) {
+    EXPECT_EQ(fingerprints64[i], static_cast<int64_t>(HashInt64(
+                                     static_cast<int64_t>(i - kSize / 2))));
+  }
+}
+
+TEST(HashKernelsTest, UnsupportedDType) {
+  auto host = CreateTestHostContext(4);
+  ExecutionContext exec_ctx = CreateExecutionContext(host.get());
+
+  TensorMetadata md(DType::F32, TensorShape({4}));
+  auto input = DenseHostTensor::CreateUninitialized(md, host.get());
+  auto output = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(DType::I64, TensorShape({4})), host.get());
+  AsyncValueRef<Chain> chain = cpu::Hash(
+      AsyncValueRef<HostTensor>(
+          MakeAvailableAsyncValueRef<DenseHostTensor>(std::move(*input))
+              .ReleaseRCRef()),
+      0, &*output, exec_ctx);
+  host->Await({chain.CopyRCRef()});
+  EXPECT_TRUE(chain.IsError());
+}
+
+static void BM_HashStrings(benchmark::State& state) {
+  auto host = CreateTestHostContext(4);
+  ExecutionContext exec_ctx = CreateExecutionContext(host.get());
+  const Index size = state.range(0);
+  auto input = MakeStringTensor(host.get(), size);
+  auto output = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(DType::I64, TensorShape({size})), host.get());
+
+  for (auto _ : state) {
+    AsyncValueRef<Chain> chain =
+        cpu::Hash(input.CopyRef(), 1 << 20, &*output, exec_ctx);
+    host->Await({chain.CopyRCRef()});
+  }
+  state.SetItemsProcessed(state.iterations() * size);
+}
+
+static void BM_HashIntegers(benchmark::State& state) {
+  auto host = CreateTestHostContext(4);
+  ExecutionContext exec_ctx = CreateExecutionContext(host.get());
+  const Index size = state.range(0);
+  auto input = MakeIntegerTensor<int64_t>(host.get(), size);
+  auto output = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(DType::I64, TensorShape({size})), host.get());
+
+  for (auto _ : state) {
+    AsyncValueRef<Chain> chain =
+        cpu::Hash(input.CopyRef(), 1 << 20, &*output, exec_ctx);
+    host->Await({chain.CopyRCRef()});
+  }
+  state.SetItemsProcessed(state.iterations() * size);
+}
+
+BENCHMARK(BM_HashStrings)->Arg(1 << 12)->Arg(1 << 20);
+BENCHMARK(BM_HashIntegers)->Arg(1 << 12)->Arg(1 << 20);
+
+}  // namespace
+}  // namespace tfrt
@@ -0,0 +1,218 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Paged key/value cache tests.
+
+#include "../../lib/kernels/kv_cache.h"
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+#include "../../lib/kernels/attention_kernel.h"
+#include "gtest/gtest.h"
+#include "tfrt/common/compat/eigen/eigen_evaluator.h"
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/host_context/resource_context.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+#include "tfrt/tensor/tensor_metadata.h"
+#include "tfrt/tensor/tensor_shape.h"
+
+namespace tfrt {
+namespace {
+
+using ::tfrt::compat::SyncEigenEvaluator;
+using ::tfrt::cpu::KVCache;
+
+constexpr Index kHeads = 2;
+constexpr Index kDepth = 8;
+constexpr Index kValueDepth = 4;
+
+class KVCacheTest : public ::testing::Test {
+ protected:
+  KVCacheTest()
+      : host_([](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+              CreateMultiThreadedWorkQueue(4, 4)) {}
+
+  KVCache::Config MakeConfig(Index num_blocks) {
+    KVCache::Config config;
+    config.dtype = GetDType<float>();
+    config.heads = kHeads;
+    config.depth = kDepth;
+    config.value_depth = kValueDepth;
+    config.num_blocks = num_blocks;
+    return config;
+  }
+
+  // Returns a tensor of `dims` whose elements are `seed` plus their index.
+  DenseHostTensor MakeTensor(llvm::ArrayRef<Index> dims, float seed) {
+    TensorMetadata md(GetDType<float>(), TensorShape(dims));
+    auto tensor = DenseHostTensor::CreateUninitialized(md, &host_);
+    assert(tensor.has_value());
+    auto data = MutableDHTArrayView<float>(&*tensor).Elements();
+    for (size_t i = 0; i < data.size(); ++i)
+      data[i] = seed + static_cast<float>(i % 97) * 0.01f;
+    return std::move(*tensor);
+  }
+
+  // Returns the [batch, heads, tokens, depth] slice of the tokens [begin,
+  // begin + tokens) of `tensor`.
+  DenseHostTensor Slice(const DenseHostTensor& tensor, Index begin,
+                        Index tokens) {
+    const Index batch = tensor.shape().GetDimensionSize(0);
+    const Index len = tensor.shape().GetDimensionSize(2);
+    const Index depth = tensor.shape().GetDimensionSize(3);
+    DenseHostTensor slice = MakeTensor({batch, kHeads, tokens, depth}, 0.0f);
+    auto from = DHTArrayView<float>(&tensor).Elements();
+    auto to = MutableDHTArrayView<float>(&slice).Elements();
+    for (Index head = 0; head < batch * kHeads; ++head)
+      for (Index t = 0; t < tokens; ++t)
+        for (Index d = 0; d < depth; ++d)
+          to[(head * tokens + t) * depth + d] =
+              from[(head * len + begin + t) * depth + d];
+    return slice;
+  }
+
+  static void ExpectEqual(const DenseHostTensor& actual,
+                          const DenseHostTensor& expected, float error) {
+    ASSERT_EQ(actual.shape(), expected.shape());
+    auto a = DHTArrayView<float>(&actual).Elements();
+    auto e = DHTArrayView<float>(&expected).Elements();
+    for (size_t i = 0; i < a.size(); ++i)
+      EXPECT_NEAR(a[i], e[i], error) << "at index " << i;
+  }
+
+  ExecutionContext MakeExecutionContext() {
+    Expected<RCReference<RequestContext>> req_ctx =
+        RequestContextBuilder(&host_, &resource_context_).build();
+    assert(req_ctx);
+    return ExecutionContext(std::move(*req_ctx));
+  }
+
+  HostContext host_;
+  ResourceContext resource_context_;
+};
+
+TEST_F(KVCacheTest, AppendsAcrossBlocks) {
+  KVCache cache(MakeConfig(8), host_.allocator());
+  DenseHostTensor key = MakeTensor({2, kHeads, 150, kDepth}, 1.0f);
+  DenseHostTensor value = MakeTensor({2, kHeads, 150, kValueDepth}, 2.0f);
+
+  // A prompt followed by single tokens and a chunk that crosses a block.
+  Index length = 0;
+  for (Index tokens : {60, 1, 1, 2, 80, 6}) {
+    auto lengths = cache.Append({7, 3}, Slice(key, length, tokens),
+                                Slice(value, length, tokens));
+    ASSERT_TRUE(!!lengths) << toString(lengths.takeError());
+    length += tokens;
+    EXPECT_EQ((*lengths)[0], length);
+    EXPECT_EQ((*lengths)[1], length);
+  }
+  EXPECT_EQ(cache.num_free_blocks(), 2);
+
+  DenseHostTensor gathered_key = MakeTensor({2, kHeads, 150, kDepth}, 0.0f);
+  DenseHostTensor gathered_value =
+      MakeTensor({2, kHeads, 150, kValueDepth}, 0.0f);
+  Error err = cache.Gather({7, 3}, &gathered_key, &gathered_value);
+  ASSERT_FALSE(err) << toString(std::move(err));
+  ExpectEqual(gathered_key, key, 0.0f);
+  ExpectEqual(gathered_value, value, 0.0f);
+}
+
+TEST_F(KVCacheTest, OutOfBlocks) {
+  KVCache cache(MakeConfig(2), host_.allocator());
+  DenseHostTensor key = MakeTensor({1, kHeads, 100, kDepth}, 1.0f);
+  DenseHostTensor value = MakeTensor({1, kHeads, 100, kValueDepth}, 2.0f);
+  ASSERT_TRUE(!!cache.Append({1}, key, value));
+
+  // Nothing is appended when the batch does not fit.
+  auto lengths = cache.Append({1, 2}, Slice(key, 0, 50), Slice(value, 0, 50));
+  EXPECT_FALSE(!!lengths);
+  consumeError(lengths.takeError());
+  EXPECT_EQ(cache.Read(1).length, 100);
+  EXPECT_EQ(cache.Read(2).length, 0);
+}
+
+TEST_F(KVCacheTest, FreedBlocksAreReusedAfterReads) {
+  KVCache cache(MakeConfig(1), host_.allocator());
+  DenseHostTensor key = MakeTensor({1, kHeads, 10, kDepth}, 1.0f);
+  DenseHostTensor value = MakeTensor({1, kHeads, 10, kValueDepth}, 2.0f);
+  ASSERT_TRUE(!!cache.Append({1}, key, value));
+
+  {
+    KVCache::Sequence read = cache.Read(1);
+    cache.Free(1);
+    EXPECT_EQ(cache.num_free_blocks(), 1);
+
+    // The block is still read, so it cannot hold another sequence yet.
+    auto lengths = cache.Append({2}, key, value);
+    EXPECT_FALSE(!!lengths);
+    consumeError(lengths.takeError());
+  }
+  EXPECT_TRUE(!!cache.Append({2}, key, value));
+}
+
+TEST_F(KVCacheTest, AttentionReadsCacheInPlace) {
+  ExecutionContext exec_ctx = MakeExecutionContext();
+  auto cache = cpu::GetOrCreateKVCache(&resource_context_, "layer0",
+                                       MakeConfig(16), host_.allocator());
+  ASSERT_TRUE(!!cache);
+
+  DenseHostTensor key = MakeTensor({2, kHeads, 200, kDepth}, -0.5f);
+  DenseHostTensor value = MakeTensor({2, kHeads, 200, kValueDepth}, 0.5f);
+  ASSERT_TRUE(!!(*cache)->Append({0, 1}, Slice(key, 0, 197),
+                                 Slice(value, 0, 197)));
+
+  // Decode the last three tokens one at a time.
+  for (Index length = 198; length <= 200; ++length) {
+    ASSERT_TRUE(!!(*cache)->Append({0, 1}, Slice(key, length - 1, 1),
+                                   Slice(value, length - 1, 1)));
+    DenseHostTensor query = MakeTensor({2, kHeads, 1, kDepth}, 0.25f);
+    DenseHostTensor output = MakeTensor({2, kHeads, 1, kValueDepth}, 0.0f);
+    Error err = cpu::KVCacheAttention<float, SyncEigenEvaluator>(
+        query, **cache, {0, 1}, &output, 0.5f, /*causal=*/true, exec_ctx);
+    ASSERT_FALSE(err) << toString(std::move(err));
+
+    DenseHostTensor expected = MakeTensor({2, kHeads, 1, kValueDepth}, 0.0f);
+    DenseHostTensor past_key = Slice(key, 0, length);
+    DenseHostTensor past_value = Slice(value, 0, length);
+    err = cpu::ScaledDotProductAttention<float, SyncEigenEvaluator>(
+        query, past_key, past_value, /*padding_mask=*/nullptr, &expected,
+        0.5f, /*causal=*/true, exec_ctx);
+    ASSERT_FALSE(err) << toString(std::move(err));
+    ExpectEqual(output, expected, 1e-5f);
+  }
+
+  // A cache is looked up by its name, and holds keys of a single shape.
+  auto lookup = cpu::GetKVCache(&resource_context_, "layer0");
+  ASSERT_TRUE(!!lookup);
+  EXPECT_EQ(*lookup, *cache);
+  KVCache::Config other = MakeConfig(16);
+  other.depth = 16;
+  auto mismatch = cpu::GetOrCreateKVCache(&resource_context_, "layer0", other,
+                                          host_.allocator());
+  EXPECT_FALSE(!!mismatch);
+  consumeError(mismatch.takeError());
+}
+
+}  // namespace
+}  // namespace tfrt
@@ -0,0 +1,346 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Packed MatMul kernel tests and benchmarks.
+
+#include "../../lib/kernels/packed_matmul_kernel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "../../lib/kernels/matmul_kernel.h"
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "tfrt/common/compat/eigen/contraction_output_kernel.h"
+#include "tfrt/common/compat/eigen/eigen_evaluator.h"
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+#include "tfrt/tensor/tensor_metadata.h"
+#include "tfrt/tensor/tensor_shape.h"
+
+namespace tfrt {
+namespace {
+
+using ::tfrt::compat::SyncEigenEvaluator;
+using ::tfrt::cpu::PackedMatMulWeights;
+using ::tfrt::cpu::PackedWeightCache;
+
+std::unique_ptr<HostContext> CreateTestHostContext(int num_threads) {
+  return std::make_unique<HostContext>(
+      [](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+      CreateMultiThreadedWorkQueue(num_threads, num_threads));
+}
+
+// Returns a [rows, cols] tensor filled with small distinct values.
+DenseHostTensor MakeMatrix(HostContext* host, Index rows, Index cols,
+                           float seed) {
+  TensorMetadata md(GetDType<float>(), TensorShape({rows, cols}));
+  auto tensor = DenseHostTensor::CreateUninitialized(md, host);
+  assert(tensor.has_value());
+  auto data = MutableDHTArrayView<float>(&*tensor).Elements();
+  for (size_t i = 0; i < data.size(); ++i)
+    data[i] = static_cast<float>((i * 7 + 3) % 11) * 0.25f - seed;
+  return std::move(*tensor);
+}
+
+std::vector<float> ReferenceMatMul(const DenseHostTensor& a,
+                                   const DenseHostTensor& b, bool transpose_a,
+                                   bool transpose_b) {
+  const Index m = a.shape().GetDimensionSize(transpose_a ? 1 : 0);
+  const Index k = a.shape().GetDimensionSize(transpose_a ? 0 : 1);
+  const Index n = b.shape().GetDimensionSize(transpose_b ? 0 : 1);
+  auto a_data = DHTArrayView<float>(&a).Elements();
+  auto b_data = DHTArrayView<float>(&b).Elements();
+
+  std::vector<float> c(m * n, 0.0f);
+  for (Index i = 0; i < m; ++i)
+    for (Index j = 0; j < n; ++j)
+      for (Index l = 0; l < k; ++l)
+        c[i * n + j] += (transpose_a ? a_data[l * m + i] : a_data[i * k + l]) *
+                        (transpose_b ? b_data[j * k + l] : b_data[l * n + j]);
+  return c;
+}
+
+template <typename Epilogue>
+std::vector<float> RunPackedMatMul(HostContext* host, const DenseHostTensor& a,
+                                   const DenseHostTensor& b, bool transpose_a,
+                                   bool transpose_b, Epilogue epilogue) {
+  const Index m = a.shape().GetDimensionSize(transpose_a ? 1 : 0);
+  const Index n = b.shape().GetDimensionSize(transpose_b ? 0 : 1);
+  TensorMetadata md(GetDType<float>(), TensorShape({m, n}));
+  auto c = DenseHostTensor::CreateUninitialized(md, host);
+
+  auto packed =
+      std::make_shared<const PackedMatMulWeights<float>>(b, transpose_b);
+  Error err = cpu::PackedMatMul<float>(a, std::move(packed), &*c, transpose_a,
+                                       epilogue, SyncEigenEvaluator(host));
+  EXPECT_FALSE(err) << toString(std::move(err));
+
+  auto elements = DHTArrayView<float>(&*c).Elements();
+  return std::vector<float>(elements.begin(), elements.end());
+}
+
+void ExpectNear(const std::vector<float>& actual,
+                const std::vector<float>& expected) {
+  ASSERT_EQ(actual.size(), expected.size());
+  for (size_t i = 0; i < actual.size(); ++i)
+    EXPECT_NEAR(actual[i], expected[i], 1e-4) << "at index " << i;
+}
+
+TEST(PackedMatMulKernelTest, MatchesReference) {
+  auto host = CreateTestHostContext(1);
+  // Output widths smaller than, equal to and not a multiple of a panel.
+  for (Index n : {3, 16, 37}) {
+    for (bool transpose_a : {false, true}) {
+      for (bool transpose_b : {false, true}) {
+        auto a = transpose_a ? MakeMatrix(host.get(), 19, 5, 0.5f)
+                             : MakeMatrix(host.get(), 5, 19, 0.5f);
+        auto b = transpose_b ? MakeMatrix(host.get(), n, 19, 1.0f)
+                             : MakeMatrix(host.get(), 19, n, 1.0f);
+        ExpectNear(RunPackedMatMul(host.get(), a, b, transpose_a, transpose_b,
+                                   cpu::NoOpPackedEpilogue()),
+                   ReferenceMatMul(a, b, transpose_a, transpose_b));
+      }
+    }
+  }
+}
+
+TEST(PackedMatMulKernelTest, BlocksRowsAndDepth) {
+  auto host = CreateTestHostContext(1);
+  // More rows than fit in the accumulators, and a depth of several blocks.
+  // The products are exact, so the blocked sums match the reference exactly.
+  for (bool transpose_a : {false, true}) {
+    auto a = transpose_a ? MakeMatrix(host.get(), 1000, 37, 0.5f)
+                         : MakeMatrix(host.get(), 37, 1000, 0.5f);
+    auto b = MakeMatrix(host.get(), 1000, 21, 1.0f);
+    ExpectNear(RunPackedMatMul(host.get(), a, b, transpose_a, false,
+                               cpu::NoOpPackedEpilogue()),
+               ReferenceMatMul(a, b, transpose_a, false));
+  }
+}
+
+TEST(PackedMatMulKernelTest, BiasAddRelu) {
+  auto host = CreateTestHostContext(1);
+  auto a = MakeMatrix(host.get(), 3, 8, 0.5f);
+  auto b = MakeMatrix(host.get(), 8, 21, 1.0f);
+
+  std::vector<float> bias(21);
+  for (size_t i = 0; i < bias.size(); ++i) bias[i] = i % 2 ? 1.0f : -2.0f;
+
+  std::vector<float> expected = ReferenceMatMul(a, b, false, false);
+  for (size_t i = 0; i < expected.size(); ++i)
+    expected[i] = std::max(0.0f, expected[i] + bias[i % bias.size()]);
+
+  cpu::BiasAddPackedEpilogue<float, compat::Relu> epilogue(bias.data());
+  ExpectNear(RunPackedMatMul(host.get(), a, b, false, false, epilogue),
+             expected);
+}
+
+// Computes the MatMul with Eigen contraction and `output_kernel`.
+template <typename OutputKernel>
+std::vector<float> RunMatMul(HostContext* host, const DenseHostTensor& a,
+                             const DenseHostTensor& b,
+                             OutputKernel output_kernel) {
+  const Index m = a.shape().GetDimensionSize(0);
+  const Index n = b.shape().GetDimensionSize(1);
+  auto c = MakeMatrix(host, m, n, 0.0f);
+  Error err = cpu::MatMul<float>(1.0, a, b, 0.0, &c, false, false,
+                                 std::move(output_kernel),
+                                 SyncEigenEvaluator(host));
+  EXPECT_FALSE(err) << toString(std::move(err));
+
+  auto elements = DHTArrayView<float>(&c).Elements();
+  return std::vector<float>(elements.begin(), elements.end());
+}
+
+// Checks that the packed epilogue and the contraction output kernel for
+// BiasAdd + Add + `Activation` match `activation` applied to the reference.
+template <typename Activation>
+void TestBiasAddResidual(Activation activation,
+                         std::function<float(float)> reference_activation) {
+  auto host = CreateTestHostContext(1);
+  const Index m = 5, k = 8, n = 21;
+  auto a = MakeMatrix(host.get(), m, k, 0.5f);
+  auto b = MakeMatrix(host.get(), k, n, 1.0f);
+  auto residual = MakeMatrix(host.get(), m, n, 1.5f);
+  auto residual_data = DHTArrayView<float>(&residual).Elements();
+
+  std::vector<float> bias(n);
+  for (size_t i = 0; i < bias.size(); ++i) bias[i] = i % 2 ? 1.0f : -2.0f;
+
+  std::vector<float> expected = ReferenceMatMul(a, b, false, false);
+  for (size_t i = 0; i < expected.size(); ++i) {
+    expected[i] = reference_activation(expected[i] + bias[i % n] +
+                                       residual_data[i]);
+  }
+
+  cpu::BiasAddResidualPackedEpilogue<float, Activation> epilogue(
+      bias.data(), residual_data.data(), n, activation);
+  ExpectNear(RunPackedMatMul(host.get(), a, b, false, false, epilogue),
+             expected);
+
+  compat::BiasAddResidualOutputKernel<float, Activation> output_kernel(
+      compat::EigenConstTensor<float, 1>(bias.data(), n),
+      compat::EigenConstTensor<float, 2>(residual_data.data(), m, n),
+      activation);
+  ExpectNear(RunMatMul(host.get(), a, b, output_kernel), expected);
+}
+
+TEST(PackedMatMulKernelTest, BiasAddResidual) {
+  TestBiasAddResidual(compat::Identity(), [](float x) { return x; });
+}
+
+TEST(PackedMatMulKernelTest, BiasAddResidualLeakyRelu) {
+  TestBiasAddResidual(compat::LeakyRelu(0.1f),
+                      [](float x) { return x < 0.0f ? 0.1f * x : x; });
+}
+
+TEST(PackedMatMulKernelTest, BiasAddResidualGeluApproximate) {
+  TestBiasAddResidual(compat::GeluApproximate(), [](float x) {
+    return 0.5f * x *
+           (1.0f + std::tanh(0.7978845608f * (x + 0.044715f * x * x * x)));
+  });
+}
+
+TEST(PackedMatMulKernelTest, BiasAddResidualGeluExact) {
+  TestBiasAddResidual(compat::GeluExact(), [](float x) {
+    return 0.5f * x * (1.0f + std::erf(x * 0.7071067812f));
+  });
+}
+
+TEST(PackedMatMulKernelTest, BiasAddResidualSwish) {
+  TestBiasAddResidual(compat::Swish(),
+                      [](float x) { return x / (1.0f + std::exp(-x)); });
+}
+
+TEST(PackedMatMulKernelTest, CachePacksRepeatedBuffers) {
+  auto host = CreateTestHostContext(1);
+  auto b = MakeMatrix(host.get(), 8, 16, 1.0f);
+  PackedWeightCache cache;
+
+  // The first sighting of a buffer is not packed.
+  EXPECT_EQ(cache.GetOrPack<float>(b, false), nullptr);
+  EXPECT_EQ(cache.size_bytes(), 0u);
+
+  auto packed = cache.GetOrPack<float>(b, false);
+  ASSERT_NE(packed, nullptr);
+  EXPECT_EQ(cache.size_bytes(), packed->size_bytes());
+  EXPECT_EQ(cache.GetOrPack<float>(b, false), packed);
+
+  // Transposed weights are packed separately.
+  EXPECT_EQ(cache.GetOrPack<float>(b, true), nullptr);
+  EXPECT_NE(cache.GetOrPack<float>(b, true), packed);
+}
+
+TEST(PackedMatMulKernelTest, CacheForgetsDestroyedBuffers) {
+  auto host = CreateTestHostContext(1);
+  PackedWeightCache cache;
+  EXPECT_EQ(cache.GetOrPack<float>(MakeMatrix(host.get(), 8, 16, 1.0f), false),
+            nullptr);
+
+  // A new buffer is not packed on its first sighting, even if it reuses the
+  // address of the destroyed one.
+  auto b = MakeMatrix(host.get(), 8, 16, 1.0f);
+  EXPECT_EQ(cache.GetOrPack<float>(b, false), nullptr);
+  EXPECT_NE(cache.GetOrPack<float>(b, false), nullptr);
+}
+
+TEST(PackedMatMulKernelTest, CacheComparesShapes) {
+  auto host = CreateTestHostContext(1);
+  auto b = MakeMatrix(host.get(), 8, 16, 1.0f);
+  PackedWeightCache cache;
+  cache.GetOrPack<float>(b, false);
+  ASSERT_NE(cache.GetOrPack<float>(b, false), nullptr);
+
+  // A reshaped view of the cached buffer does not match the packed weights.
+  DenseHostTensor reshaped(
+      TensorMetadata(GetDType<float>(), TensorShape({16, 8})),
+      b.buffer().CopyRef());
+  EXPECT_EQ(cache.GetOrPack<float>(reshaped, false), nullptr);
+}
+
+TEST(PackedMatMulKernelTest, CacheEvictsUnreferencedBuffers) {
+  auto host = CreateTestHostContext(1);
+  const size_t packed_size = PackedMatMulWeights<float>(
+                                 MakeMatrix(host.get(), 8, 16, 1.0f), false)
+                                 .size_bytes();
+  PackedWeightCache cache(/*max_bytes=*/packed_size);
+
+  {
+    auto b = MakeMatrix(host.get(), 8, 16, 1.0f);
+    cache.GetOrPack<float>(b, false);
+    ASSERT_NE(cache.GetOrPack<float>(b, false), nullptr);
+  }
+  EXPECT_EQ(cache.size_bytes(), packed_size);
+
+  // The first weights are only referenced by the cache and make room.
+  auto b = MakeMatrix(host.get(), 8, 16, 2.0f);
+  cache.GetOrPack<float>(b, false);
+  auto packed = cache.GetOrPack<float>(b, false);
+  ASSERT_NE(packed, nullptr);
+  EXPECT_EQ(cache.GetOrPack<float>(b, false), packed);
+  EXPECT_EQ(cache.size_bytes(), packed_size);
+}
+
+// -------------------------------------------------------------------------- //
+// Small-batch MatMul benchmarks: Eigen contraction vs packed weights.
+// -------------------------------------------------------------------------- //
+
+static void BM_EigenMatMul(benchmark::State& state) {
+  auto host = CreateTestHostContext(1);
+  const Index m = state.range(0);
+  const Index k = state.range(1);
+  auto a = MakeMatrix(host.get(), m, k, 0.5f);
+  auto b = MakeMatrix(host.get(), k, k, 1.0f);
+  auto c = MakeMatrix(host.get(), m, k, 0.0f);
+
+  for (auto _ : state) {
+    Error err = cpu::MatMul<float>(1.0, a, b, 0.0, &c, false, false,
+                                   Eigen::NoOpOutputKernel(),
+                                   SyncEigenEvaluator(host.get()));
+    benchmark::DoNotOptimize(err);
+  }
+}
+
+static void BM_PackedMatMul(benchmark::State& state) {
+  auto host = CreateTestHostContext(1);
+  const Index m = state.range(0);
+  const Index k = state.range(1);
+  auto a = MakeMatrix(host.get(), m, k, 0.5f);
+  auto b = MakeMatrix(host.get(), k, k, 1.0f);
+  auto c = MakeMatrix(host.get(), m, k, 0.0f);
+  auto packed = std::make_shared<const PackedMatMulWeights<float>>(b, false);
+
+  for (auto _ : state) {
+    Error err = cpu::PackedMatMul<float>(a, packed, &c, false,
+                                         cpu::NoOpPackedEpilogue(),
+                                         SyncEigenEvaluator(host.get()));
+    benchmark::DoNotOptimize(err);
+  }
+}
+
+BENCHMARK(BM_EigenMatMul)->ArgPair(1, 256)->ArgPair(8, 256)->ArgPair(1, 1024);
+BENCHMARK(BM_PackedMatMul)->ArgPair(1, 256)->ArgPair(8, 256)->ArgPair(1, 1024);
+
+}  // namespace
+}  // namespace tfrt
@@ -0,0 +1,174 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Quantized MatMul kernel tests and benchmarks.
+
+#include "../../lib/kernels/quantized_matmul_kernel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "tfrt/common/compat/eigen/eigen_evaluator.h"
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/tensor_metadata.h"
+#include "tfrt/tensor/tensor_shape.h"
+
+namespace tfrt {
+namespace {
+
+using ::tfrt::compat::SyncEigenEvaluator;
+
+std::unique_ptr<HostContext> CreateTestHostContext(int num_threads) {
+  return std::make_unique<HostContext>(
+      [](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+      CreateMultiThreadedWorkQueue(num_threads, num_threads));
+}
+
+DenseHostTensor MakeUninitialized(HostContext* host, DType dtype, Index rows,
+                                  Index cols) {
+  TensorMetadata md(dtype, TensorShape({rows, cols}));
+  auto tensor = DenseHostTensor::CreateUninitialized(md, host);
+  assert(tensor.has_value());
+  return std::move(*tensor);
+}
+
+// Returns a quint8 (or qint8 if `is_signed`) matrix with values spread over
+// the whole quantized range.
+DenseHostTensor MakeQuantizedMatrix(HostContext* host, Index rows, Index cols,
+                                    bool is_signed) {
+  auto tensor = MakeUninitialized(host, is_signed ? DType::QI8 : DType::QUI8,
+                                  rows, cols);
+  auto* data = static_cast<uint8_t*>(tensor.data());
+  for (Index i = 0; i < rows * cols; ++i) data[i] = (i * 37 + 11) % 256;
+  return tensor;
+}
+
+// Returns (a - a_zero_point) * (b - b_zero_point) in int32.
+std::vector<int32_t> ReferenceMatMul(const DenseHostTensor& a,
+                                     const DenseHostTensor& b,
+                                     bool transpose_a, bool transpose_b,
+                                     int32_t a_zero_point,
+                                     int32_t b_zero_point) {
+  const Index m = a.shape().GetDimensionSize(transpose_a ? 1 : 0);
+  const Index k = a.shape().GetDimensionSize(transpose_a ? 0 : 1);
+  const Index n = b.shape().GetDimensionSize(transpose_b ? 0 : 1);
+  const auto* a_data = static_cast<const uint8_t*>(a.data());
+  const auto* b_data = static_cast<const int8_t*>(b.data());
+
+  std::vector<int32_t> c(m * n, 0);
+  for (Index i = 0; i < m; ++i)
+    for (Index j = 0; j < n; ++j)
+      for (Index l = 0; l < k; ++l) {
+        int32_t a_value = transpose_a ? a_data[l * m + i] : a_data[i * k + l];
+        int32_t b_value = transpose_b ? b_data[j * k + l] : b_data[l * n + j];
+        c[i * n + j] += (a_value - a_zero_point) * (b_value - b_zero_point);
+      }
+  return c;
+}
+
+TEST(QuantizedMatMulKernelTest, MatchesReference) {
+  auto host = CreateTestHostContext(1);
+  for (bool transpose_a : {false, true}) {
+    for (bool transpose_b : {false, true}) {
+      auto a = transpose_a ? MakeQuantizedMatrix(host.get(), 67, 3, false)
+                           : MakeQuantizedMatrix(host.get(), 3, 67, false);
+      auto b = transpose_b ? MakeQuantizedMatrix(host.get(), 5, 67, true)
+                           : MakeQuantizedMatrix(host.get(), 67, 5, true);
+      auto c = MakeUninitialized(host.get(), DType::QI32, 3, 5);
+
+      Error err = cpu::QuantizedMatMul(
+          a, b, &c, transpose_a, transpose_b, /*a_zero_point=*/128,
+          /*b_zero_point=*/-3, cpu::QuantizedMatMulOutput(&c),
+          SyncEigenEvaluator(host.get()));
+      ASSERT_FALSE(err) << toString(std::move(err));
+
+      std::vector<int32_t> expected =
+          ReferenceMatMul(a, b, transpose_a, transpose_b, 128, -3);
+      const auto* c_data = static_cast<const int32_t*>(c.data());
+      std::vector<int32_t> actual(c_data, c_data + c.NumElements());
+      EXPECT_EQ(actual, expected)
+          << "transpose_a=" << transpose_a << " transpose_b=" << transpose_b;
+    }
+  }
+}
+
+TEST(QuantizedMatMulKernelTest, RequantizeBiasAddRelu) {
+  auto host = CreateTestHostContext(1);
+  auto a = MakeQuantizedMatrix(host.get(), 4, 16, false);
+  auto b = MakeQuantizedMatrix(host.get(), 16, 6, true);
+  auto c = MakeUninitialized(host.get(), DType::QUI8, 4, 6);
+
+  const float a_scale = 0.02f, b_scale = 0.01f, output_scale = 0.05f;
+  const int32_t a_zero_point = 100, b_zero_point = 0, output_zero_point = 10;
+  std::vector<float> bias = {-2.0f, -1.0f, 0.0f, 0.5f, 1.0f, 2.0f};
+
+  cpu::RequantizeBiasAddOutput requantize(
+      &c, bias.data(), a_scale * b_scale, output_scale, output_zero_point,
+      /*lower=*/0.0f, /*upper=*/std::numeric_limits<float>::max());
+  Error err = cpu::QuantizedMatMul(a, b, &c, false, false, a_zero_point,
+                                   b_zero_point, requantize,
+                                   SyncEigenEvaluator(host.get()));
+  ASSERT_FALSE(err) << toString(std::move(err));
+
+  std::vector<int32_t> acc =
+      ReferenceMatMul(a, b, false, false, a_zero_point, b_zero_point);
+  const auto* actual = static_cast<const uint8_t*>(c.data());
+  for (size_t i = 0; i < acc.size(); ++i) {
+    float value = std::max(0.0f, acc[i] * a_scale * b_scale + bias[i % 6]);
+    float expected = std::nearbyint(value / output_scale) + output_zero_point;
+    expected = std::min(std::max(expected, 0.0f), 255.0f);
+    EXPECT_NEAR(actual[i], expected, 1) << "at index " << i;
+    EXPECT_GE(actual[i], output_zero_point);
+  }
+}
+
+// -------------------------------------------------------------------------- //
+// Quantized MatMul benchmarks.
+// -------------------------------------------------------------------------- //
+
+static void BM_QuantizedMatMul(benchmark::State& state) {
+  auto host = CreateTestHostContext(1);
+  const Index m = state.range(0);
+  const Index k = state.range(1);
+  auto a = MakeQuantizedMatrix(host.get(), m, k, false);
+  auto b = MakeQuantizedMatrix(host.get(), k, k, true);
+  auto c = MakeUninitialized(host.get(), DType::QI32, m, k);
+
+  for (auto _ : state) {
+    Error err = cpu::QuantizedMatMul(a, b, &c, false, true, 128, 0,
+                                     cpu::QuantizedMatMulOutput(&c),
+                                     SyncEigenEvaluator(host.get()));
+    benchmark::DoNotOptimize(err);
+  }
+}
+
+BENCHMARK(BM_QuantizedMatMul)
+    ->ArgPair(1, 256)
+    ->ArgPair(16, 256)
+    ->ArgPair(64, 1024);
+
+}  // namespace
+}  // namespace tfrt
@@ -0,0 +1,198 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Random kernels tests and benchmarks.
+
+#include "../../lib/kernels/random_kernels.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+#include "tfrt/tensor/tensor_metadata.h"
+#include "tfrt/tensor/tensor_shape.h"
+
+namespace tfrt {
+namespace {
+
+using ::tfrt::cpu::RandomDistribution;
+
+std::unique_ptr<HostContext> CreateTestHostContext(int num_threads) {
+  return std::make_unique<HostContext>(
+      [](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+      CreateMultiThreadedWorkQueue(num_threads, num_threads));
+}
+
+ExecutionContext CreateExecutionContext(HostContext* host) {
+  Expected<RCReference<RequestContext>> req_ctx =
+      RequestContextBuilder(host, /*resource_context=*/nullptr).build();
+  assert(req_ctx);
+  return ExecutionContext(std::move(*req_ctx));
+}
+
+template <typename T>
+std::vector<T> GenerateRandom(int num_threads,
+                              RandomDistribution distribution, Index size,
+                              uint64_t seed, uint64_t seed2) {
+  auto host = CreateTestHostContext(num_threads);
+  ExecutionContext exec_ctx = CreateExecutionContext(host.get());
+
+  TensorMetadata md(GetDType<T>(), TensorShape({size}));
+  auto output = DenseHostTensor::CreateUninitialized(md, host.get());
+  assert(output.has_value());
+
+  AsyncValueRef<Chain> chain =
+      cpu::Random<T>(distribution, seed, seed2, &*output, exec_ctx);
+  host->Await({chain.CopyRCRef()});
+  EXPECT_TRUE(chain.IsConcrete());
+
+  auto elements = DHTArrayView<T>(&*output).Elements();
+  return std::vector<T>(elements.begin(), elements.end());
+}
+
+struct Moments {
+  double mean;
+  double variance;
+};
+
+template <typename T>
+Moments ComputeMoments(const std::vector<T>& values) {
+  double sum = 0, sum_squares = 0;
+  for (T value : values) {
+    sum += value;
+    sum_squares += static_cast<double>(value) * value;
+  }
+  const double mean = sum / values.size();
+  return {mean, sum_squares / values.size() - mean * mean};
+}
+
+// The output is the same for any number of threads, so the parallel blocks
+// read disjoint parts of the stream. The odd size leaves a partial last group.
+template <typename T>
+void TestDeterministic(RandomDistribution distribution) {
+  constexpr Index kSize = 100003;
+  auto sequential = GenerateRandom<T>(1, distribution, kSize, 17, 42);
+  auto parallel = GenerateRandom<T>(4, distribution, kSize, 17, 42);
+  EXPECT_EQ(sequential, parallel);
+
+  auto other_seed = GenerateRandom<T>(4, distribution, kSize, 18, 42);
+  EXPECT_NE(sequential, other_seed);
+}
+
+TEST(RandomKernelsTest, Deterministic) {
+  for (auto distribution :
+       {RandomDistribution::kUniform, RandomDistribution::kNormal,
+        RandomDistribution::kTruncatedNormal}) {
+    TestDeterministic<float>(distribution);
+    TestDeterministic<double>(distribution);
+  }
+}
+
+template <typename T>
+void TestUniform() {
+  auto values =
+      GenerateRandom<T>(4, RandomDistribution::kUniform, 1 << 20, 1, 2);
+  for (T value : values) {
+    ASSERT_GE(value, T(0));
+    ASSERT_LT(value, T(1));
+  }
+  Moments moments = ComputeMoments(values);
+  EXPECT_NEAR(moments.mean, 0.5, 0.01);
+  EXPECT_NEAR(moments.variance, 1.0 / 12, 0.01);
+}
+
+TEST(RandomKernelsTest, Uniform) {
+  TestUniform<float>();
+  TestUniform<double>();
+}
+
+template <typename T>
+void TestNormal() {
+  auto values =
+      GenerateRandom<T>(4, RandomDistribution::kNormal, 1 << 20, 1, 2);
+  for (T value : values) ASSERT_TRUE(std::isfinite(value));
+  Moments moments = ComputeMoments(values);
+  EXPECT_NEAR(moments.mean, 0.0, 0.01);
+  EXPECT_NEAR(moments.variance, 1.0, 0.01);
+}
+
+TEST(RandomKernelsTest, Normal) {
+  TestNormal<float>();
+  TestNormal<double>();
+}
+
+template <typename T>
+void TestTruncatedNormal() {
+  auto values = GenerateRandom<T>(4, RandomDistribution::kTruncatedNormal,
+                                  1 << 20, 1, 2);
+  for (T value : values) ASSERT_LT(std::abs(value), T(2));
+  // The variance of the standard normal distribution truncated to [-2, 2].
+  Moments moments = ComputeMoments(values);
+  EXPECT_NEAR(moments.mean, 0.0, 0.01);
+  EXPECT_NEAR(moments.variance, 0.774, 0.01);
+}
+
+TEST(RandomKernelsTest, TruncatedNormal) {
+  TestTruncatedNormal<float>();
+  TestTruncatedNormal<double>();
+}
+
+TEST(RandomKernelsTest, EmptyTensor) {
+  EXPECT_TRUE(
+      GenerateRandom<float>(4, RandomDistribution::kUniform, 0, 1, 2).empty());
+}
+
+static void BM_RandomFloat(benchmark::State& state,
+                           RandomDistribution distribution) {
+  auto host = CreateTestHostContext(4);
+  ExecutionContext exec_ctx = CreateExecutionContext(host.get());
+
+  TensorMetadata md(DType::F32, TensorShape({state.range(0)}));
+  auto output = DenseHostTensor::CreateUninitialized(md, host.get());
+  assert(output.has_value());
+
+  for (auto _ : state) {
+    AsyncValueRef<Chain> chain =
+        cpu::Random<float>(distribution, 1, 2, &*output, exec_ctx);
+    host->Await({chain.CopyRCRef()});
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0) * sizeof(float));
+}
+
+BENCHMARK_CAPTURE(BM_RandomFloat, Uniform, RandomDistribution::kUniform)
+    ->Arg(1 << 12)
+    ->Arg(1 << 20);
+BENCHMARK_CAPTURE(BM_RandomFloat, Normal, RandomDistribution::kNormal)
+    ->Arg(1 << 12)
+    ->Arg(1 << 20);
+BENCHMARK_CAPTURE(BM_RandomFloat, TruncatedNormal,
+                  RandomDistribution::kTruncatedNormal)
+    ->Arg(1 << 20);
+
+}  // namespace
+}  // namespace tfrt
@@ -0,0 +1,133 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Tests for the 16-bit floating point MatMul and Softmax kernels, which
+// accumulate in float.
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "../../lib/kernels/matmul_kernel.h"
+#include "../../lib/kernels/packed_matmul_kernel.h"
+#include "../../lib/kernels/softmax_kernel.h"
+#include "gtest/gtest.h"
+#include "tfrt/common/compat/eigen/eigen_dtype.h"
+#include "tfrt/common/compat/eigen/eigen_evaluator.h"
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+#include "tfrt/tensor/tensor_metadata.h"
+#include "tfrt/tensor/tensor_shape.h"
+
+namespace tfrt {
+namespace {
+
+using ::tfrt::compat::SyncEigenEvaluator;
+
+std::unique_ptr<HostContext> CreateTestHostContext(int num_threads) {
+  return std::make_unique<HostContext>(
+      [](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+      CreateMultiThreadedWorkQueue(num_threads, num_threads));
+}
+
+template <typename T>
+DenseHostTensor MakeTensor(HostContext* host, Index rows, Index cols,
+                           float value) {
+  TensorMetadata md(GetDType<T>(), TensorShape({rows, cols}));
+  auto tensor = DenseHostTensor::CreateUninitialized(md, host);
+  assert(tensor.has_value());
+  for (auto& element : MutableDHTArrayView<T>(&*tensor).Elements())
+    element = static_cast<T>(value);
+  return std::move(*tensor);
+}
+
+template <typename T>
+class ReducedPrecisionKernelsTest : public ::testing::Test {};
+
+using ReducedPrecisionTypes = ::testing::Types<Eigen::half, Eigen::bfloat16>;
+TYPED_TEST_SUITE(ReducedPrecisionKernelsTest, ReducedPrecisionTypes);
+
+// Adding ones to a 16-bit accumulator stops at 256 for bfloat16 and at 2048 for
+// half, while 4096 is exactly representable in both types.
+constexpr Index kDepth = 4096;
+
+TYPED_TEST(ReducedPrecisionKernelsTest, MatMulAccumulatesInFloat) {
+  using T = TypeParam;
+  auto host = CreateTestHostContext(1);
+  auto a = MakeTensor<T>(host.get(), 2, kDepth, 1.0f);
+  auto b = MakeTensor<T>(host.get(), kDepth, 3, 1.0f);
+  auto c = MakeTensor<T>(host.get(), 2, 3, 0.0f);
+
+  Error err = cpu::MatMul<T>(1.0, a, b, 0.0, &c, false, false,
+                             Eigen::NoOpOutputKernel(),
+                             SyncEigenEvaluator(host.get()));
+  ASSERT_FALSE(err) << toString(std::move(err));
+
+  for (T value : DHTArrayView<T>(&c).Elements())
+    EXPECT_EQ(static_cast<float>(value), static_cast<float>(kDepth));
+}
+
+TYPED_TEST(ReducedPrecisionKernelsTest, PackedMatMulAccumulatesInFloat) {
+  using T = TypeParam;
+  auto host = CreateTestHostContext(1);
+  auto a = MakeTensor<T>(host.get(), 2, kDepth, 1.0f);
+  auto b = MakeTensor<T>(host.get(), kDepth, 3, 1.0f);
+  auto c = MakeTensor<T>(host.get(), 2, 3, 0.0f);
+
+  auto packed = std::make_shared<const cpu::PackedMatMulWeights<T>>(b, false);
+  Error err = cpu::PackedMatMul<T>(a, std::move(packed), &c, false,
+                                   cpu::NoOpPackedEpilogue(),
+                                   SyncEigenEvaluator(host.get()));
+  ASSERT_FALSE(err) << toString(std::move(err));
+
+  for (T value : DHTArrayView<T>(&c).Elements())
+    EXPECT_EQ(static_cast<float>(value), static_cast<float>(kDepth));
+}
+
+TYPED_TEST(ReducedPrecisionKernelsTest, SoftmaxAccumulatesInFloat) {
+  using T = TypeParam;
+  auto host = CreateTestHostContext(1);
+  Expected<RCReference<RequestContext>> req_ctx =
+      RequestContextBuilder(host.get(), /*resource_context=*/nullptr).build();
+  ASSERT_TRUE(!!req_ctx);
+  ExecutionContext exec_ctx(std::move(*req_ctx));
+
+  auto logits = MakeTensor<T>(host.get(), 2, kDepth, 0.5f);
+  auto softmax = MakeTensor<T>(host.get(), 2, kDepth, 0.0f);
+  Error err = cpu::Softmax<T, /*log=*/false, SyncEigenEvaluator>(
+      logits, &softmax, exec_ctx);
+  ASSERT_FALSE(err) << toString(std::move(err));
+
+  const float expected = 1.0f / kDepth;
+  for (T value : DHTArrayView<T>(&softmax).Elements())
+    EXPECT_NEAR(static_cast<float>(value), expected, expected * 1e-2);
+
+  auto log_softmax = MakeTensor<T>(host.get(), 2, kDepth, 0.0f);
+  err = cpu::Softmax<T, /*log=*/true, SyncEigenEvaluator>(logits, &log_softmax,
+                                                          exec_ctx);
+  ASSERT_FALSE(err) << toString(std::move(err));
+
+  for (T value : DHTArrayView<T>(&log_softmax).Elements())
+    EXPECT_NEAR(static_cast<float>(value), std::log(expected), 5e-2);
+}
+
+}  // namespace
+}  // namespace tfrt
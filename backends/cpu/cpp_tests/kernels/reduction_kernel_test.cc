@@ -0,0 +1,331 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Reduction kernel tests and benchmarks.
+
+#include "../../lib/kernels/reduction_kernel.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+#include "tfrt/tensor/tensor_metadata.h"
+#include "tfrt/tensor/tensor_shape.h"
+
+namespace tfrt {
+namespace {
+
+std::unique_ptr<HostContext> CreateTestHostContext(int num_threads) {
+  return std::make_unique<HostContext>(
+      [](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+      CreateMultiThreadedWorkQueue(num_threads, num_threads));
+}
+
+ExecutionContext CreateExecutionContext(HostContext* host) {
+  Expected<RCReference<RequestContext>> req_ctx =
+      RequestContextBuilder(host, /*resource_context=*/nullptr).build();
+  assert(req_ctx);
+  return ExecutionContext(std::move(*req_ctx));
+}
+
+template <typename T>
+DenseHostTensor MakeTensor(HostContext* host, const TensorShape& shape) {
+  TensorMetadata md(GetDType<T>(), shape);
+  auto tensor = DenseHostTensor::CreateUninitialized(md, host);
+  assert(tensor.has_value());
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<int> dist(-8, 8);
+  for (auto& element : MutableDHTArrayView<T>(&*tensor).Elements())
+    element = static_cast<T>(dist(gen));
+  return std::move(*tensor);
+}
+
+TensorShape OutputShape(const TensorShape& shape, ArrayRef<bool> reduced) {
+  llvm::SmallVector<Index, 4> dims;
+  for (int i = 0; i < shape.GetRank(); ++i)
+    if (!reduced[i]) dims.push_back(shape.GetDimensionSize(i));
+  return TensorShape(dims);
+}
+
+// Reduces the input element by element into double accumulators.
+template <typename T, template <typename> class Reducer>
+std::vector<double> ReferenceReduce(const DenseHostTensor& input,
+                                    ArrayRef<bool> reduced) {
+  using R = Reducer<double>;
+  const int rank = input.shape().GetRank();
+  const TensorShape output_shape = OutputShape(input.shape(), reduced);
+  llvm::SmallVector<Index, 4> output_strides;
+  output_shape.GetStrides(&output_strides);
+
+  std::vector<double> out(output_shape.GetNumElements(), R::Identity());
+  Index num_reduced = 1;
+  for (int i = 0; i < rank; ++i)
+    if (reduced[i]) num_reduced *= input.shape().GetDimensionSize(i);
+
+  auto in = DHTArrayView<T>(&input).Elements();
+  for (Index i = 0; i < in.size(); ++i) {
+    Index remaining = i;
+    Index o = 0;
+    for (int d = rank - 1, od = output_shape.GetRank() - 1; d >= 0; --d) {
+      const Index size = input.shape().GetDimensionSize(d);
+      const Index coord = remaining % size;
+      remaining /= size;
+      if (!reduced[d]) o += coord * output_strides[od--];
+    }
+    out[o] = R::Combine(out[o], static_cast<double>(in[i]));
+  }
+  for (double& value : out) value = R::Finalize(value, num_reduced);
+  return out;
+}
+
+template <typename T, template <typename> class Reducer>
+std::vector<T> Reduce(HostContext* host, const DenseHostTensor& input,
+                      ArrayRef<bool> reduced) {
+  ExecutionContext exec_ctx = CreateExecutionContext(host);
+  TensorMetadata md(GetDType<T>(), OutputShape(input.shape(), reduced));
+  auto output = DenseHostTensor::CreateUninitialized(md, host);
+  assert(output.has_value());
+
+  cpu::internal::ReductionPlan plan =
+      cpu::internal::MakeReductionPlan(input.shape(), reduced);
+  AsyncValueRef<Chain> chain =
+      cpu::Reduce<T, Reducer>(input, plan, &*output, exec_ctx);
+  host->Await({chain.CopyRCRef()});
+  EXPECT_TRUE(chain.IsConcrete());
+
+  auto elements = DHTArrayView<T>(&*output).Elements();
+  return std::vector<T>(elements.begin(), elements.end());
+}
+
+struct ReductionCase {
+  TensorShape shape;
+  llvm::SmallVector<bool, 4> reduced;
+};
+
+std::vector<ReductionCase> ReductionCases() {
+  return {
+      {TensorShape({1000}), {true}},
+      {TensorShape({3, 100000}), {false, true}},
+      {TensorShape({100000, 3}), {true, false}},
+      {TensorShape({7, 3000, 5}), {false, true, false}},
+      {TensorShape({9, 300, 700}), {true, false, true}},
+      {TensorShape({5, 1, 17, 33}), {false, true, true, true}},
+      {TensorShape({100, 600}), {true, false}},
+      {TensorShape({2, 3, 4}), {false, false, false}},
+      {TensorShape({4, 1, 3}), {false, true, false}},
+      {TensorShape({1 << 20}), {true}},
+  };
+}
+
+template <typename T, template <typename> class Reducer>
+void ExpectReduction(HostContext* host) {
+  for (const ReductionCase& test : ReductionCases()) {
+    DenseHostTensor input = MakeTensor<T>(host, test.shape);
+    std::vector<T> result = Reduce<T, Reducer>(host, input, test.reduced);
+    std::vector<double> expected =
+        ReferenceReduce<T, Reducer>(input, test.reduced);
+    ASSERT_EQ(result.size(), expected.size());
+    for (size_t i = 0; i < result.size(); ++i)
+      ASSERT_NEAR(result[i], expected[i], 1e-3 * std::abs(expected[i]) + 1e-3)
+          << "output " << i;
+  }
+}
+
+TEST(ReductionKernelTest, Sum) {
+  auto host = CreateTestHostContext(4);
+  ExpectReduction<float, cpu::SumReducer>(host.get());
+  ExpectReduction<int32_t, cpu::SumReducer>(host.get());
+}
+
+TEST(ReductionKernelTest, Mean) {
+  auto host = CreateTestHostContext(4);
+  ExpectReduction<float, cpu::MeanReducer>(host.get());
+  ExpectReduction<double, cpu::MeanReducer>(host.get());
+}
+
+TEST(ReductionKernelTest, MaxMin) {
+  auto host = CreateTestHostContext(4);
+  ExpectReduction<float, cpu::MaxReducer>(host.get());
+  ExpectReduction<int64_t, cpu::MaxReducer>(host.get());
+  ExpectReduction<float, cpu::MinReducer>(host.get());
+  ExpectReduction<int32_t, cpu::MinReducer>(host.get());
+}
+
+TEST(ReductionKernelTest, Prod) {
+  auto host = CreateTestHostContext(4);
+  TensorMetadata md(DType::F64, TensorShape({64, 40}));
+  auto input = DenseHostTensor::CreateUninitialized(md, host.get());
+  auto elements = MutableDHTArrayView<double>(&*input).Elements();
+  for (size_t i = 0; i < elements.size(); ++i)
+    elements[i] = 1.0 + (i % 7) / 100.0;
+
+  for (bool inner : {false, true}) {
+    llvm::SmallVector<bool, 2> reduced = {!inner, inner};
+    std::vector<double> result =
+        Reduce<double, cpu::ProdReducer>(host.get(), *input, reduced);
+    std::vector<double> expected =
+        ReferenceReduce<double, cpu::ProdReducer>(*input, reduced);
+    ASSERT_EQ(result.size(), expected.size());
+    for (size_t i = 0; i < result.size(); ++i)
+      EXPECT_NEAR(result[i], expected[i], 1e-9 * expected[i]);
+  }
+}
+
+TEST(ReductionKernelTest, EmptyReduction) {
+  auto host = CreateTestHostContext(4);
+  DenseHostTensor input = MakeTensor<float>(host.get(), TensorShape({3, 0}));
+  EXPECT_EQ(Reduce<float, cpu::SumReducer>(host.get(), input, {false, true}),
+            std::vector<float>(3, 0.0f));
+  for (float mean :
+       Reduce<float, cpu::MeanReducer>(host.get(), input, {false, true}))
+    EXPECT_TRUE(std::isnan(mean));
+}
+
+TEST(ReductionKernelTest, ReduceBroadcast) {
+  EXPECT_EQ((cpu::ReduceBroadcast<int32_t, cpu::SumReducer>(3, 7)), 21);
+  EXPECT_EQ((cpu::ReduceBroadcast<int32_t, cpu::ProdReducer>(2, 10)), 1024);
+  EXPECT_EQ((cpu::ReduceBroadcast<float, cpu::MaxReducer>(-1.5f, 5)), -1.5f);
+  EXPECT_EQ((cpu::ReduceBroadcast<float, cpu::MinReducer>(2.5f, 5)), 2.5f);
+  EXPECT_EQ((cpu::ReduceBroadcast<float, cpu::MeanReducer>(0.5f, 6)), 0.5f);
+  EXPECT_EQ((cpu::ReduceBroadcast<int32_t, cpu::SumReducer>(3, 0)), 0);
+  EXPECT_EQ((cpu::ReduceBroadcast<int32_t, cpu::ProdReducer>(3, 0)), 1);
+}
+
+TEST(ReductionKernelTest, CompensatedSum) {
+  auto host = CreateTestHostContext(4);
+  // A sequential float sum of 4M times 0.1 is off by more than 1%.
+  constexpr Index kSize = 4 << 20;
+  const double expected = static_cast<double>(0.1f) * kSize;
+  for (bool inner : {false, true}) {
+    TensorShape shape =
+        inner ? TensorShape({2, kSize}) : TensorShape({kSize, 2});
+    TensorMetadata md(DType::F32, shape);
+    auto input = DenseHostTensor::CreateUninitialized(md, host.get());
+    for (float& element : MutableDHTArrayView<float>(&*input).Elements())
+      element = 0.1f;
+
+    llvm::SmallVector<bool, 2> reduced = {!inner, inner};
+    std::vector<float> result =
+        Reduce<float, cpu::SumReducer>(host.get(), *input, reduced);
+    ASSERT_EQ(result.size(), 2);
+    for (float sum : result) EXPECT_NEAR(sum, expected, 1e-5 * expected);
+  }
+}
+
+TEST(ReductionKernelTest, Deterministic) {
+  // The reduction order only depends on the shape, so that the results are
+  // bit exact with any number of threads.
+  auto host1 = CreateTestHostContext(1);
+  auto host8 = CreateTestHostContext(8);
+
+  TensorMetadata md(DType::F32, TensorShape({3, 1 << 20}));
+  auto input = DenseHostTensor::CreateUninitialized(md, host1.get());
+  std::mt19937 gen(7);
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  for (float& element : MutableDHTArrayView<float>(&*input).Elements())
+    element = dist(gen);
+
+  for (bool inner : {false, true}) {
+    llvm::SmallVector<bool, 2> reduced = {!inner, inner};
+    std::vector<float> result1 =
+        Reduce<float, cpu::SumReducer>(host1.get(), *input, reduced);
+    std::vector<float> result8 =
+        Reduce<float, cpu::SumReducer>(host8.get(), *input, reduced);
+    ASSERT_EQ(result1.size(), result8.size());
+    EXPECT_EQ(std::memcmp(result1.data(), result8.data(),
+                          result1.size() * sizeof(float)),
+              0);
+  }
+}
+
+TEST(ReductionKernelTest, ArgMax) {
+  auto host = CreateTestHostContext(4);
+  ExecutionContext exec_ctx = CreateExecutionContext(host.get());
+  DenseHostTensor input =
+      MakeTensor<float>(host.get(), TensorShape({6, 500, 300}));
+  auto in = DHTArrayView<float>(&input).Elements();
+
+  for (int axis = 0; axis < 3; ++axis) {
+    llvm::SmallVector<bool, 3> reduced(3, false);
+    reduced[axis] = true;
+    TensorMetadata md(DType::I64, OutputShape(input.shape(), reduced));
+    auto output = DenseHostTensor::CreateUninitialized(md, host.get());
+
+    cpu::internal::ReductionPass pass =
+        cpu::internal::MakeArgReductionPass(input.shape(), axis);
+    AsyncValueRef<Chain> chain = cpu::ArgReduce<float, int64_t, true>(
+        input, pass, &*output, exec_ctx);
+    host->Await({chain.CopyRCRef()});
+    ASSERT_TRUE(chain.IsConcrete());
+
+    auto out = DHTArrayView<int64_t>(&*output).Elements();
+    for (Index o = 0; o < pass.outer; ++o) {
+      for (Index i = 0; i < pass.inner; ++i) {
+        Index expected = 0;
+        for (Index r = 1; r < pass.reduced; ++r) {
+          if (in[(o * pass.reduced + r) * pass.inner + i] >
+              in[(o * pass.reduced + expected) * pass.inner + i])
+            expected = r;
+        }
+        ASSERT_EQ(out[o * pass.inner + i], expected);
+      }
+    }
+  }
+}
+
+static void BM_Sum(benchmark::State& state, bool inner) {
+  auto host = CreateTestHostContext(4);
+  ExecutionContext exec_ctx = CreateExecutionContext(host.get());
+  const Index rows = state.range(0);
+  const Index cols = state.range(1);
+  DenseHostTensor input =
+      MakeTensor<float>(host.get(), TensorShape({rows, cols}));
+  llvm::SmallVector<bool, 2> reduced = {!inner, inner};
+  TensorMetadata md(DType::F32, OutputShape(input.shape(), reduced));
+  auto output = DenseHostTensor::CreateUninitialized(md, host.get());
+  cpu::internal::ReductionPlan plan =
+      cpu::internal::MakeReductionPlan(input.shape(), reduced);
+
+  for (auto _ : state) {
+    AsyncValueRef<Chain> chain =
+        cpu::Reduce<float, cpu::SumReducer>(input, plan, &*output, exec_ctx);
+    host->Await({chain.CopyRCRef()});
+  }
+  state.SetBytesProcessed(state.iterations() * rows * cols * sizeof(float));
+}
+
+static void BM_InnerSum(benchmark::State& state) { BM_Sum(state, true); }
+static void BM_OuterSum(benchmark::State& state) { BM_Sum(state, false); }
+
+BENCHMARK(BM_InnerSum)->Args({1, 1 << 22})->Args({1024, 4096});
+BENCHMARK(BM_OuterSum)->Args({1 << 22, 1})->Args({4096, 1024});
+
+}  // namespace
+}  // namespace tfrt
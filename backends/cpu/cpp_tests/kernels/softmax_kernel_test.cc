@@ -0,0 +1,183 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Softmax kernel tests and benchmarks.
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "../../lib/kernels/softmax_kernel.h"
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "tfrt/common/compat/eigen/eigen_evaluator.h"
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+#include "tfrt/tensor/tensor_metadata.h"
+#include "tfrt/tensor/tensor_shape.h"
+
+namespace tfrt {
+namespace {
+
+using ::tfrt::compat::SyncEigenEvaluator;
+
+std::unique_ptr<HostContext> CreateTestHostContext(int num_threads) {
+  return std::make_unique<HostContext>(
+      [](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+      CreateMultiThreadedWorkQueue(num_threads, num_threads));
+}
+
+ExecutionContext CreateExecutionContext(HostContext* host) {
+  Expected<RCReference<RequestContext>> req_ctx =
+      RequestContextBuilder(host, /*resource_context=*/nullptr).build();
+  assert(req_ctx);
+  return ExecutionContext(std::move(*req_ctx));
+}
+
+DenseHostTensor MakeTensor(HostContext* host, const TensorShape& shape,
+                           const std::vector<float>& values) {
+  TensorMetadata md(GetDType<float>(), shape);
+  auto tensor = DenseHostTensor::CreateUninitialized(md, host);
+  assert(tensor.has_value());
+  MutableDHTArrayView<float> view(&*tensor);
+  assert(view.NumElements() == values.size());
+  std::copy(values.begin(), values.end(), view.Elements().begin());
+  return std::move(*tensor);
+}
+
+// Straightforward three-pass softmax computed in double.
+std::vector<float> ReferenceSoftmax(const std::vector<float>& logits,
+                                    size_t num_classes, bool log) {
+  std::vector<float> softmax(logits.size());
+  for (size_t row = 0; row < logits.size(); row += num_classes) {
+    double max = logits[row];
+    for (size_t i = 0; i < num_classes; ++i)
+      max = std::max<double>(max, logits[row + i]);
+    double sum = 0.0;
+    for (size_t i = 0; i < num_classes; ++i)
+      sum += std::exp(logits[row + i] - max);
+    for (size_t i = 0; i < num_classes; ++i) {
+      double shifted = logits[row + i] - max;
+      softmax[row + i] =
+          log ? shifted - std::log(sum) : std::exp(shifted) / sum;
+    }
+  }
+  return softmax;
+}
+
+// Logits that increase along the class dimension, so that the running
+// maximum changes in every block of the online softmax.
+std::vector<float> IncreasingLogits(size_t batch, size_t num_classes,
+                                    float step) {
+  std::vector<float> logits(batch * num_classes);
+  for (size_t i = 0; i < logits.size(); ++i)
+    logits[i] = step * (i % num_classes) + 0.25f * (i / num_classes);
+  return logits;
+}
+
+template <bool log>
+void TestSoftmax(const TensorShape& shape, const std::vector<float>& logits,
+                 int num_threads) {
+  auto host = CreateTestHostContext(num_threads);
+  ExecutionContext exec_ctx = CreateExecutionContext(host.get());
+
+  auto logits_t = MakeTensor(host.get(), shape, logits);
+  auto softmax_t =
+      MakeTensor(host.get(), shape, std::vector<float>(logits.size()));
+  Error err = cpu::Softmax<float, log, SyncEigenEvaluator>(
+      logits_t, &softmax_t, exec_ctx);
+  ASSERT_FALSE(err) << toString(std::move(err));
+
+  const size_t num_classes = shape.GetDimensionSize(shape.GetRank() - 1);
+  auto expected = ReferenceSoftmax(logits, num_classes, log);
+  auto actual = DHTArrayView<float>(&softmax_t).Elements();
+  for (size_t i = 0; i < expected.size(); ++i) {
+    ASSERT_TRUE(std::isfinite(actual[i])) << "at index " << i;
+    EXPECT_NEAR(actual[i], expected[i], 1e-5 + 1e-4 * std::abs(expected[i]))
+        << "at index " << i;
+  }
+}
+
+TEST(SoftmaxKernelTest, SmallRows) {
+  TestSoftmax</*log=*/false>(TensorShape({2, 3, 5}),
+                             IncreasingLogits(6, 5, 0.5f), 1);
+}
+
+TEST(SoftmaxKernelTest, RowsSpanningMultipleBlocks) {
+  const size_t num_classes = 3 * cpu::internal::kSoftmaxBlockSize + 17;
+  TestSoftmax</*log=*/false>(TensorShape({4, num_classes}),
+                             IncreasingLogits(4, num_classes, 0.001f), 4);
+}
+
+TEST(SoftmaxKernelTest, LogSoftmax) {
+  const size_t num_classes = 2 * cpu::internal::kSoftmaxBlockSize + 3;
+  TestSoftmax</*log=*/true>(TensorShape({3, num_classes}),
+                            IncreasingLogits(3, num_classes, 0.01f), 4);
+}
+
+TEST(SoftmaxKernelTest, LargeLogitsDoNotOverflow) {
+  // exp(x) overflows float for every logit, and the maximum is in the last
+  // block of the row.
+  const size_t num_classes = 2 * cpu::internal::kSoftmaxBlockSize + 1;
+  std::vector<float> logits(2 * num_classes, 1000.0f);
+  logits[num_classes - 1] = 1010.0f;
+  logits[2 * num_classes - 1] = -1000.0f;
+  TestSoftmax</*log=*/false>(TensorShape({2, num_classes}), logits, 2);
+  TestSoftmax</*log=*/true>(TensorShape({2, num_classes}), logits, 2);
+}
+
+TEST(SoftmaxKernelTest, ManyRows) {
+  TestSoftmax</*log=*/false>(TensorShape({1000, 10}),
+                             IncreasingLogits(1000, 10, 1.0f), 4);
+}
+
+// -------------------------------------------------------------------------- //
+// Softmax benchmarks.
+// -------------------------------------------------------------------------- //
+
+static void BM_Softmax(benchmark::State& state) {
+  auto host = CreateTestHostContext(4);
+  ExecutionContext exec_ctx = CreateExecutionContext(host.get());
+  const Index batch = state.range(0);
+  const Index num_classes = state.range(1);
+
+  TensorShape shape({batch, num_classes});
+  auto logits = MakeTensor(host.get(), shape,
+                           IncreasingLogits(batch, num_classes, 0.001f));
+  auto softmax = MakeTensor(host.get(), shape,
+                            std::vector<float>(batch * num_classes));
+
+  for (auto _ : state) {
+    Error err = cpu::Softmax<float, /*log=*/false, SyncEigenEvaluator>(
+        logits, &softmax, exec_ctx);
+    benchmark::DoNotOptimize(err);
+  }
+}
+
+BENCHMARK(BM_Softmax)
+    ->ArgPair(1, 1000)
+    ->ArgPair(32, 1000)
+    ->ArgPair(32, 32000)
+    ->ArgPair(256, 128);
+
+}  // namespace
+}  // namespace tfrt
@@ -0,0 +1,196 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Tile kernel tests and benchmarks.
+
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "../../lib/kernels/tile_kernel.h"
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "tfrt/common/compat/eigen/eigen_evaluator.h"
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+#include "tfrt/tensor/tensor_metadata.h"
+#include "tfrt/tensor/tensor_shape.h"
+
+namespace tfrt {
+namespace {
+
+using ::tfrt::compat::SyncEigenEvaluator;
+
+std::unique_ptr<HostContext> CreateTestHostContext(int num_threads) {
+  return std::make_unique<HostContext>(
+      [](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+      CreateMultiThreadedWorkQueue(num_threads, num_threads));
+}
+
+ExecutionContext CreateExecutionContext(HostContext* host) {
+  Expected<RCReference<RequestContext>> req_ctx =
+      RequestContextBuilder(host, /*resource_context=*/nullptr).build();
+  assert(req_ctx);
+  return ExecutionContext(std::move(*req_ctx));
+}
+
+template <typename T>
+DenseHostTensor MakeTensor(HostContext* host, const TensorShape& shape) {
+  TensorMetadata md(GetDType<T>(), shape);
+  auto tensor = DenseHostTensor::CreateUninitialized(md, host);
+  assert(tensor.has_value());
+  auto elements = MutableDHTArrayView<T>(&*tensor).Elements();
+  for (size_t i = 0; i < elements.size(); ++i) elements[i] = static_cast<T>(i);
+  return std::move(*tensor);
+}
+
+TensorShape TiledShape(const TensorShape& shape,
+                       const llvm::SmallVector<Index, 5>& multiples) {
+  llvm::SmallVector<Index, 5> dims;
+  for (int i = 0; i < shape.GetRank(); ++i)
+    dims.push_back(shape.GetDimensionSize(i) * multiples[i]);
+  return TensorShape(dims);
+}
+
+// Tiles the input with the element by element index math.
+template <typename T>
+std::vector<T> ReferenceTile(const DenseHostTensor& input,
+                             const TensorShape& output_shape) {
+  const int rank = output_shape.GetRank();
+  auto in = DHTArrayView<T>(&input).Elements();
+  std::vector<T> out(output_shape.GetNumElements());
+  for (size_t o = 0; o < out.size(); ++o) {
+    Index remaining = o;
+    Index i = 0;
+    Index stride = 1;
+    for (int d = rank - 1; d >= 0; --d) {
+      const Index in_dim = input.shape().GetDimensionSize(d);
+      i += remaining % output_shape.GetDimensionSize(d) % in_dim * stride;
+      stride *= in_dim;
+      remaining /= output_shape.GetDimensionSize(d);
+    }
+    out[o] = in[i];
+  }
+  return out;
+}
+
+template <typename T>
+void TestTile(const TensorShape& input_shape,
+              const llvm::SmallVector<Index, 5>& multiples) {
+  auto host = CreateTestHostContext(4);
+  ExecutionContext exec_ctx = CreateExecutionContext(host.get());
+
+  auto input = MakeTensor<T>(host.get(), input_shape);
+  TensorShape output_shape = TiledShape(input_shape, multiples);
+  auto output = MakeTensor<T>(host.get(), output_shape);
+
+  Error err =
+      cpu::Tile<T, SyncEigenEvaluator>(input, multiples, &output, exec_ctx);
+  ASSERT_FALSE(err) << toString(std::move(err));
+
+  auto expected = ReferenceTile<T>(input, output_shape);
+  auto actual = DHTArrayView<T>(&output).Elements();
+  ASSERT_EQ(actual.size(), expected.size());
+  for (size_t i = 0; i < expected.size(); ++i)
+    ASSERT_EQ(actual[i], expected[i]) << "at index " << i;
+}
+
+TEST(TileKernelTest, Vector) {
+  TestTile<float>(TensorShape({3}), {4});
+  TestTile<float>(TensorShape({1}), {100000});
+}
+
+TEST(TileKernelTest, Matrix) {
+  TestTile<int32_t>(TensorShape({2, 3}), {1, 1});
+  TestTile<int32_t>(TensorShape({2, 3}), {3, 1});
+  TestTile<int32_t>(TensorShape({2, 3}), {1, 5});
+  TestTile<int32_t>(TensorShape({2, 3}), {4, 7});
+}
+
+TEST(TileKernelTest, CollapsedDimensions) {
+  TestTile<int8_t>(TensorShape({5, 1, 1, 3}), {2, 3, 4, 1});
+  TestTile<int8_t>(TensorShape({1, 1, 7}), {3, 1, 1});
+  TestTile<int64_t>(TensorShape({2, 1, 3, 1, 2}), {1, 2, 2, 3, 1});
+}
+
+TEST(TileKernelTest, AttentionMask) {
+  // [batch, 1, 1, seq_len] mask broadcast to every head and query position.
+  TestTile<float>(TensorShape({2, 1, 1, 384}), {1, 12, 384, 1});
+}
+
+TEST(TileKernelTest, BlocksSplitOutputRows) {
+  // Every output row holds several parallel blocks.
+  TestTile<double>(TensorShape({3, 100}), {2, 1000});
+}
+
+TEST(TileKernelTest, EmptyTensors) {
+  TestTile<float>(TensorShape({0, 3}), {2, 2});
+  TestTile<float>(TensorShape({2, 3}), {2, 0});
+}
+
+TEST(TileKernelTest, Scalar) {
+  TestTile<float>(TensorShape(ArrayRef<Index>()), {});
+}
+
+// -------------------------------------------------------------------------- //
+// Tile benchmarks.
+// -------------------------------------------------------------------------- //
+
+static void BM_TileAttentionMask(benchmark::State& state) {
+  auto host = CreateTestHostContext(4);
+  ExecutionContext exec_ctx = CreateExecutionContext(host.get());
+  const Index seq_len = state.range(0);
+
+  llvm::SmallVector<Index, 5> multiples = {1, 12, seq_len, 1};
+  TensorShape input_shape({8, 1, 1, seq_len});
+  auto input = MakeTensor<float>(host.get(), input_shape);
+  auto output =
+      MakeTensor<float>(host.get(), TiledShape(input_shape, multiples));
+
+  for (auto _ : state) {
+    Error err = cpu::Tile<float, SyncEigenEvaluator>(input, multiples,
+                                                     &output, exec_ctx);
+    benchmark::DoNotOptimize(err);
+  }
+}
+
+static void BM_TileInnermost(benchmark::State& state) {
+  auto host = CreateTestHostContext(4);
+  ExecutionContext exec_ctx = CreateExecutionContext(host.get());
+
+  llvm::SmallVector<Index, 5> multiples = {1, state.range(0)};
+  TensorShape input_shape({64, 4});
+  auto input = MakeTensor<float>(host.get(), input_shape);
+  auto output =
+      MakeTensor<float>(host.get(), TiledShape(input_shape, multiples));
+
+  for (auto _ : state) {
+    Error err = cpu::Tile<float, SyncEigenEvaluator>(input, multiples,
+                                                     &output, exec_ctx);
+    benchmark::DoNotOptimize(err);
+  }
+}
+
+BENCHMARK(BM_TileAttentionMask)->Arg(128)->Arg(512);
+BENCHMARK(BM_TileInnermost)->Arg(16)->Arg(4096);
+
+}  // namespace
+}  // namespace tfrt
@@ -0,0 +1,215 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Transpose kernel tests and benchmarks.
+
+#include <cassert>
+#include <complex>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "../../lib/kernels/transpose_kernel.h"
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "tfrt/common/compat/eigen/eigen_evaluator.h"
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+#include "tfrt/tensor/tensor_metadata.h"
+#include "tfrt/tensor/tensor_shape.h"
+
+namespace tfrt {
+namespace {
+
+using ::tfrt::compat::SyncEigenEvaluator;
+
+std::unique_ptr<HostContext> CreateTestHostContext(int num_threads) {
+  return std::make_unique<HostContext>(
+      [](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+      CreateMultiThreadedWorkQueue(num_threads, num_threads));
+}
+
+ExecutionContext CreateExecutionContext(HostContext* host) {
+  Expected<RCReference<RequestContext>> req_ctx =
+      RequestContextBuilder(host, /*resource_context=*/nullptr).build();
+  assert(req_ctx);
+  return ExecutionContext(std::move(*req_ctx));
+}
+
+template <typename T>
+DenseHostTensor MakeTensor(HostContext* host, const TensorShape& shape) {
+  TensorMetadata md(GetDType<T>(), shape);
+  auto tensor = DenseHostTensor::CreateUninitialized(md, host);
+  assert(tensor.has_value());
+  auto elements = MutableDHTArrayView<T>(&*tensor).Elements();
+  for (size_t i = 0; i < elements.size(); ++i) elements[i] = static_cast<T>(i);
+  return std::move(*tensor);
+}
+
+// Transposes the input with the element by element index math.
+template <typename T>
+std::vector<T> ReferenceTranspose(const DenseHostTensor& input,
+                                  ArrayRef<Index> perm) {
+  const int rank = perm.size();
+  llvm::SmallVector<Index, 5> input_strides;
+  input.shape().GetStrides(&input_strides);
+
+  auto in = DHTArrayView<T>(&input).Elements();
+  std::vector<T> out(in.size());
+  for (size_t o = 0; o < out.size(); ++o) {
+    Index remaining = o;
+    Index i = 0;
+    for (int d = rank - 1; d >= 0; --d) {
+      const Index dim = input.shape().GetDimensionSize(perm[d]);
+      i += remaining % dim * input_strides[perm[d]];
+      remaining /= dim;
+    }
+    out[o] = in[i];
+  }
+  return out;
+}
+
+template <typename T>
+void TestTranspose(const TensorShape& input_shape,
+                   const llvm::SmallVector<Index, 5>& perm) {
+  auto host = CreateTestHostContext(4);
+  ExecutionContext exec_ctx = CreateExecutionContext(host.get());
+
+  auto input = MakeTensor<T>(host.get(), input_shape);
+  auto expected = ReferenceTranspose<T>(input, perm);
+
+  auto plan =
+      cpu::internal::MakeTransposePlan(input_shape, perm, sizeof(T));
+  if (plan.is_identity) {
+    // The output shares the input buffer.
+    auto actual = DHTArrayView<T>(&input).Elements();
+    ASSERT_EQ(actual.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i)
+      ASSERT_EQ(actual[i], expected[i]) << "at index " << i;
+    return;
+  }
+
+  auto output =
+      MakeTensor<T>(host.get(), cpu::TransposedShape(input_shape, perm));
+  Error err = cpu::Transpose<SyncEigenEvaluator>(input, plan, &output,
+                                                 exec_ctx);
+  ASSERT_FALSE(err) << toString(std::move(err));
+
+  auto actual = DHTArrayView<T>(&output).Elements();
+  ASSERT_EQ(actual.size(), expected.size());
+  for (size_t i = 0; i < expected.size(); ++i)
+    ASSERT_EQ(actual[i], expected[i]) << "at index " << i;
+}
+
+TEST(TransposeKernelTest, Matrix) {
+  TestTranspose<float>(TensorShape({3, 5}), {1, 0});
+  TestTranspose<float>(TensorShape({64, 64}), {1, 0});
+  TestTranspose<float>(TensorShape({517, 1029}), {1, 0});
+  TestTranspose<uint16_t>(TensorShape({130, 67}), {1, 0});
+  TestTranspose<double>(TensorShape({33, 129}), {1, 0});
+  TestTranspose<int8_t>(TensorShape({40, 9}), {1, 0});
+}
+
+TEST(TransposeKernelTest, LayoutConversion) {
+  // NHWC to NCHW and back. 16 bit elements stand in for bf16.
+  TestTranspose<float>(TensorShape({2, 7, 9, 3}), {0, 3, 1, 2});
+  TestTranspose<float>(TensorShape({2, 3, 7, 9}), {0, 2, 3, 1});
+  TestTranspose<uint16_t>(TensorShape({4, 14, 14, 64}), {0, 3, 1, 2});
+}
+
+TEST(TransposeKernelTest, InnermostDimensionNotMoved) {
+  TestTranspose<float>(TensorShape({4, 5, 6}), {1, 0, 2});
+  TestTranspose<int64_t>(TensorShape({3, 2, 4, 5}), {2, 0, 1, 3});
+}
+
+TEST(TransposeKernelTest, ComplexElements) {
+  TestTranspose<std::complex<double>>(TensorShape({5, 11}), {1, 0});
+}
+
+TEST(TransposeKernelTest, MetadataOnly) {
+  auto plan = cpu::internal::MakeTransposePlan(TensorShape({1, 8, 1, 4}),
+                                               {2, 1, 0, 3}, sizeof(float));
+  EXPECT_TRUE(plan.is_identity);
+  TestTranspose<float>(TensorShape({1, 8, 1, 4}), {2, 1, 0, 3});
+  TestTranspose<float>(TensorShape({6}), {0});
+}
+
+TEST(TransposeKernelTest, HigherRanks) {
+  TestTranspose<int32_t>(TensorShape({2, 3, 4, 5, 6}), {4, 2, 0, 3, 1});
+  TestTranspose<int32_t>(TensorShape({3, 1, 4, 1, 5}), {4, 3, 0, 1, 2});
+}
+
+TEST(TransposeKernelTest, EmptyTensors) {
+  TestTranspose<float>(TensorShape({0, 3}), {1, 0});
+}
+
+// -------------------------------------------------------------------------- //
+// Transpose benchmarks.
+// -------------------------------------------------------------------------- //
+
+template <typename T>
+static void BM_TransposeNhwcToNchw(benchmark::State& state) {
+  auto host = CreateTestHostContext(4);
+  ExecutionContext exec_ctx = CreateExecutionContext(host.get());
+  const Index size = state.range(0);
+
+  llvm::SmallVector<Index, 5> perm = {0, 3, 1, 2};
+  TensorShape input_shape({8, size, size, 64});
+  auto input = MakeTensor<T>(host.get(), input_shape);
+  auto output =
+      MakeTensor<T>(host.get(), cpu::TransposedShape(input_shape, perm));
+  auto plan = cpu::internal::MakeTransposePlan(input_shape, perm, sizeof(T));
+
+  for (auto _ : state) {
+    Error err =
+        cpu::Transpose<SyncEigenEvaluator>(input, plan, &output, exec_ctx);
+    benchmark::DoNotOptimize(err);
+  }
+  state.SetBytesProcessed(state.iterations() * input.DataSizeInBytes());
+}
+
+static void BM_TransposeMatrix(benchmark::State& state) {
+  auto host = CreateTestHostContext(4);
+  ExecutionContext exec_ctx = CreateExecutionContext(host.get());
+  const Index size = state.range(0);
+
+  llvm::SmallVector<Index, 5> perm = {1, 0};
+  TensorShape input_shape({size, size});
+  auto input = MakeTensor<float>(host.get(), input_shape);
+  auto output = MakeTensor<float>(host.get(), input_shape);
+  auto plan =
+      cpu::internal::MakeTransposePlan(input_shape, perm, sizeof(float));
+
+  for (auto _ : state) {
+    Error err =
+        cpu::Transpose<SyncEigenEvaluator>(input, plan, &output, exec_ctx);
+    benchmark::DoNotOptimize(err);
+  }
+  state.SetBytesProcessed(state.iterations() * input.DataSizeInBytes());
+}
+
+BENCHMARK_TEMPLATE(BM_TransposeNhwcToNchw, float)->Arg(56)->Arg(112);
+BENCHMARK_TEMPLATE(BM_TransposeNhwcToNchw, uint16_t)->Arg(56)->Arg(112);
+BENCHMARK(BM_TransposeMatrix)->Arg(256)->Arg(4096);
+
+}  // namespace
+}  // namespace tfrt
@@ -134,5 +134,48 @@ TEST_F(BufferForwardingTest, SlicedBuffer) {
   }
 }
 
+TEST_F(BufferForwardingTest, DenseHostTensorView) {
+  TensorMetadata input_md(GetDType<float>(), TensorShape({2, 3}));
+  TensorMetadata output_md(GetDType<float>(), TensorShape({3, 2}));
+
+  AsyncValueRef<DenseHostTensor> view;
+  void* data_ptr = nullptr;
+
+  {
+    auto dht =
+        DenseHostTensor::MakeConstructedAsyncValueRef(input_md, &host_ctx_);
+    data_ptr = dht->data();
+
+    auto expected_view = MakeDenseHostTensorView(output_md, dht.get());
+    ASSERT_TRUE(!!expected_view);
+    ASSERT_EQ(expected_view->data(), data_ptr);
+    ASSERT_EQ(expected_view->shape(), output_md.shape);
+    view = MakeAvailableAsyncValueRef<DenseHostTensor>(
+        std::move(*expected_view));
+
+    // View can't be forwarded while the viewed tensor is alive.
+    Argument<DenseHostTensor> arg(view.GetAsyncValue());
+    auto fwd = ForwardInputOrAllocateOutput(exec_ctx_, output_md, arg);
+    ASSERT_NE(fwd.get().data(), data_ptr);
+  }
+
+  {  // View becomes exclusive data owner when the viewed tensor is destroyed.
+    Argument<DenseHostTensor> arg(view.GetAsyncValue());
+    auto fwd = ForwardInputOrAllocateOutput(exec_ctx_, output_md, arg);
+    ASSERT_EQ(fwd.get().data(), data_ptr);
+  }
+}
+
+TEST_F(BufferForwardingTest, DenseHostTensorViewSizeMismatch) {
+  TensorMetadata input_md(GetDType<float>(), TensorShape({2, 3}));
+  TensorMetadata output_md(GetDType<double>(), TensorShape({2, 3}));
+
+  auto dht =
+      DenseHostTensor::MakeConstructedAsyncValueRef(input_md, &host_ctx_);
+  auto view = MakeDenseHostTensorView(output_md, dht.get());
+  ASSERT_FALSE(!!view);
+  consumeError(view.takeError());
+}
+
 }  // namespace
 }  // namespace tfrt
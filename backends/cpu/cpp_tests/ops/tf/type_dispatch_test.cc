@@ -51,5 +51,21 @@ TEST(TypeDispatchTest, Simple) {
   }
 }
 
+TEST(TypeDispatchTest, AllKinds) {
+  auto unsupported = [](DType) { return DType{DType::Invalid}; };
+  auto supported = [](auto type_tag) { return GetDType<decltype(type_tag)>(); };
+
+  // Every DType kind is dispatched to `supported` if it is in the set, and to
+  // `unsupported` otherwise.
+  for (uint8_t i = 0; i <= static_cast<uint8_t>(DType::LastDType); ++i) {
+    DType dtype = static_cast<DType>(i);
+    bool is_float = dtype == DType::F16 || dtype == DType::BF16 ||
+                    dtype == DType::F32 || dtype == DType::F64;
+    internal::FloatTypeDispatch dispatch(dtype);
+    EXPECT_EQ(dispatch(supported, unsupported),
+              is_float ? dtype : DType{DType::Invalid});
+  }
+}
+
 }  // namespace
 }  // namespace tfrt
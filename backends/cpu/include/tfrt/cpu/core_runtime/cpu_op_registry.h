@@ -15,8 +15,9 @@
  */
 
 // This file declares CpuOpRegistry, which maps an op to an optional metadata
-// function (the "shape" function that also produces layout and dtype) and a
-// kernel dispatch function.
+// function (the "shape" function that also produces layout and dtype), a
+// kernel dispatch function, and optional dispatch functions specialized for
+// input shapes.
 
 #ifndef TFRT_BACKENDS_CPU_CORE_RUNTIME_CPU_OP_REGISTRY_H_
 #define TFRT_BACKENDS_CPU_CORE_RUNTIME_CPU_OP_REGISTRY_H_
@@ -34,6 +35,7 @@ class HostTensor;
 class ExecutionContext;
 class OpAttrsRef;
 class OpHandler;
+class PartialTensorShape;
 class TensorHandle;
 struct TensorMetadata;
 
@@ -86,6 +88,11 @@ struct CpuOpFlags {
     // If this is set, the op dispatch function is prepared to deal with tensor
     // inputs in the TFRuntimeFallbackTensor format.
     AllowsTfRuntimeFallback = 1 << 5,
+
+    // If this is set, the op dispatch function is prepared to deal with
+    // tensor inputs in CsrHostTensor format. Rank 2 CooHostTensor inputs are
+    // converted to it.
+    AllowsCsr = 1 << 6,
   } flags;
 
   explicit CpuOpFlags() : flags(None) {}
@@ -132,6 +139,20 @@ class CpuOpRegistry {
   // same op are allowed (making static initialization easier).
   void AddMetadataFn(string_view op_name, OpMetadataFn metadata_fn);
 
+  // Add a variant of the op `op_name` that is specialized for inputs of the
+  // shapes `input_shapes`, e.g. a kernel written against FixedRankShape that
+  // does not derive the dimensions and strides of the inputs at runtime.
+  // Unranked shapes and unknown dimensions match any input.
+  //
+  // The op handler dispatches to the first variant, in registration order,
+  // whose shapes match the metadata of the arguments, and to the dispatch
+  // function of AddOp() if no variant matches or the metadata is not available
+  // yet. The variants share the flags, the attribute names and the metadata
+  // function of the op, which must be added with AddOp() as well.
+  void AddSpecializedOp(string_view op_name,
+                        ArrayRef<PartialTensorShape> input_shapes,
+                        CpuDispatchFn dispatch_fn);
+
  private:
   friend class CpuOpHandler;
   CpuOpRegistry(const CpuOpRegistry&) = delete;
@@ -29,5 +29,11 @@ namespace tfrt {
 
 llvm::Expected<OpHandler*> CreateNullOpHandler(CoreRuntime* runtime);
 
+// Creates a NullOpHandler that accepts every op, and executes it without doing
+// any work: the results are copies of the arguments, repeated in order if there
+// are more results than arguments. Benchmarks use it to measure the dispatch
+// overhead of CoreRuntime alone.
+llvm::Expected<OpHandler*> CreateForwardingNullOpHandler(CoreRuntime* runtime);
+
 }  // namespace tfrt
 #endif  // TFRT_BACKENDS_CPU_CORE_RUNTIME_NULL_OP_HANDLER_H_
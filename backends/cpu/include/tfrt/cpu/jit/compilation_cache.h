@@ -0,0 +1,131 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Persistent compilation cache for JIT-compiled CPU ops
+//
+// This file declares CompilationCache, which keeps the compiled artifacts of
+// JIT ops (e.g. object files) in memory and in a directory of a
+// tfrt::io::FileSystem, so that a restarted process, or another replica that
+// shares the directory, loads them instead of compiling them again:
+//
+//   CompilationCache cache("/var/cache/tfrt_jit");
+//   std::string key = ComputeCompilationCacheKey(op_name, attrs, arguments);
+//   auto artifact = cache.GetOrCompile(key, [&]() -> Expected<std::string> {
+//     return CompileOp(op_name, attrs, arguments);
+//   });
+//
+// The cache is content addressed: every artifact is stored in a file named
+// after the hash of its key, and the file also records the full key, so that
+// hash collisions and truncated files are detected and treated as misses.
+
+#ifndef TFRT_BACKENDS_CPU_JIT_COMPILATION_CACHE_H_
+#define TFRT_BACKENDS_CPU_JIT_COMPILATION_CACHE_H_
+
+#include <memory>
+#include <string>
+
+#include "llvm/ADT/STLFunctionalExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Error.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+
+namespace tfrt {
+
+class OpAttrsRef;
+struct TensorMetadata;
+
+namespace io {
+class FileSystem;
+class ReadOnlyMemoryRegion;
+}  // namespace io
+
+namespace cpu {
+
+// Returns the name and the features of the host CPU, e.g.
+// "skylake-avx512,+avx,+avx2,...". Artifacts compiled for one CPU may not run
+// on another one, so the features are part of every cache key.
+std::string GetHostCpuFeatures();
+
+// Returns the cache key of the op `op_name` with the attributes `attrs`
+// compiled for `arguments` on a CPU with `cpu_features`. The key spells out
+// the op, the attribute names, the argument dtypes and shapes, and the CPU
+// features, and includes a hash of every attribute value.
+std::string ComputeCompilationCacheKey(
+    string_view op_name, const OpAttrsRef& attrs,
+    ArrayRef<TensorMetadata> arguments,
+    string_view cpu_features = GetHostCpuFeatures());
+
+// A compiled artifact of the cache. Artifacts loaded from the file system are
+// memory mapped where the file system supports it.
+class CompiledArtifact {
+ public:
+  explicit CompiledArtifact(std::string data);
+  CompiledArtifact(std::unique_ptr<io::ReadOnlyMemoryRegion> region,
+                   string_view data);
+  ~CompiledArtifact();
+
+  string_view data() const { return data_; }
+
+ private:
+  std::string owned_data_;
+  std::unique_ptr<io::ReadOnlyMemoryRegion> region_;
+  string_view data_;
+};
+
+class CompilationCache {
+ public:
+  // Artifacts are stored in `directory`, on the file system registered for
+  // its scheme. An empty `directory` keeps the artifacts in memory only.
+  explicit CompilationCache(std::string directory);
+
+  CompilationCache(const CompilationCache&) = delete;
+  CompilationCache& operator=(const CompilationCache&) = delete;
+
+  // Returns the artifact for `key` from memory or from the file system, or
+  // nullptr if it is not cached.
+  std::shared_ptr<const CompiledArtifact> Lookup(string_view key);
+
+  // Adds the artifact for `key` to memory and writes it to the file system.
+  // Write errors are returned, but the artifact stays cached in memory.
+  llvm::Error Insert(string_view key, std::string artifact);
+
+  // Returns the artifact for `key`, calling `compile` and inserting its result
+  // if it is not cached yet. Errors of writing the artifact to the file system
+  // are dropped, because the compiled artifact is still usable.
+  llvm::Expected<std::shared_ptr<const CompiledArtifact>> GetOrCompile(
+      string_view key,
+      llvm::function_ref<llvm::Expected<std::string>()> compile);
+
+ private:
+  // Returns the path of the file of the artifact for `key`.
+  std::string GetPath(string_view key) const;
+
+  std::shared_ptr<const CompiledArtifact> Load(string_view key);
+
+  const std::string directory_;
+  io::FileSystem* const file_system_;
+
+  mutex mu_;
+  llvm::StringMap<std::shared_ptr<const CompiledArtifact>> artifacts_
+      TFRT_GUARDED_BY(mu_);
+};
+
+}  // namespace cpu
+}  // namespace tfrt
+
+#endif  // TFRT_BACKENDS_CPU_JIT_COMPILATION_CACHE_H_
@@ -39,6 +39,8 @@ void RegisterTestCpuOps(CpuOpRegistry* registry);
 void RegisterCooKernels(KernelRegistry* registry);
 void RegisterCooCpuOps(CpuOpRegistry* registry);
 
+void RegisterCsrCpuOps(CpuOpRegistry* registry);
+
 }  // namespace tfrt
 
 #endif  // TFRT_BACKENDS_CPU_OPS_TEST_CPU_OPS_AND_KERNELS_H_
@@ -29,10 +29,12 @@
 #include "tfrt/host_context/execution_context.h"
 #include "tfrt/support/logging.h"
 #include "tfrt/tensor/coo_host_tensor.h"
+#include "tfrt/tensor/csr_host_tensor.h"
 #include "tfrt/tensor/dense_host_tensor.h"
 #include "tfrt/tensor/host_tensor.h"
 #include "tfrt/tensor/scalar_host_tensor.h"
 #include "tfrt/tensor/string_host_tensor.h"
+#include "tfrt/tensor/tensor_shape.h"
 #include "tfrt/tensor/tensor_type_registration.h"
 
 #define DEBUG_TYPE "tfrt-cpu-op-op_handler"
@@ -58,6 +60,13 @@ TensorType ArgumentTensorType(const Tensor& t, const CpuOpFlags& flags) {
     if (t.IsTensorType(type)) return type;
   }
 
+  if (flags & CpuOpFlags::AllowsCsr) {
+    auto type = CsrHostTensor::kTensorType;
+    if (t.IsTensorType(type)) return type;
+    if (t.IsTensorType(CooHostTensor::kTensorType) && t.shape().GetRank() == 2)
+      return type;
+  }
+
   if (flags & CpuOpFlags::AllowsString) {
     auto type = StringHostTensor::kTensorType;
     if (t.IsTensorType(type)) return type;
@@ -168,6 +177,38 @@ TensorHandle MaybeConvertArgument(const ExecutionContext& exec_ctx,
   }
 }
 
+// Returns true if `shape` matches the specialized input shape `expected`.
+bool MatchesShape(const TensorShape& shape,
+                  const PartialTensorShape& expected) {
+  if (expected.IsUnranked()) return true;
+  if (shape.GetRank() != expected.GetRank()) return false;
+  for (int i = 0, e = shape.GetRank(); i != e; ++i) {
+    const int64_t dim = expected.GetDimensionSize(i);
+    if (!PartialTensorShape::IsUnknownDim(dim) &&
+        dim != shape.GetDimensionSize(i))
+      return false;
+  }
+  return true;
+}
+
+// Returns the dispatch function of the first variant whose input shapes match
+// `arguments`, or nullptr if there is none. Arguments whose metadata is not
+// available yet do not match any variant.
+CpuDispatchFn SelectVariant(const CpuOpVariants& variants,
+                            ArrayRef<TensorHandle> arguments) {
+  for (const auto& variant : variants) {
+    if (variant.input_shapes.size() != arguments.size()) continue;
+    bool matches = true;
+    for (int i = 0, e = arguments.size(); i != e && matches; ++i) {
+      matches = arguments[i].IsMetadataAvailable() &&
+                MatchesShape(arguments[i].GetAvailableMetadata().shape,
+                             variant.input_shapes[i]);
+    }
+    if (matches) return variant.dispatch_fn;
+  }
+  return nullptr;
+}
+
 struct CpuOpHandlerTraits {
   using InputTensorTy = AsyncValue;
   using OpEntryTy = CpuOpEntry;
@@ -217,6 +258,10 @@ llvm::Expected<CpuOpHandler*> CreateCpuOpHandler(CoreRuntime* runtime,
                                             DenseHostTensor::kTensorType);
   cpu_op_handler_ptr->AddImplicitConversion(CooHostTensor::kTensorType,
                                             DenseHostTensor::kTensorType);
+  cpu_op_handler_ptr->AddImplicitConversion(CooHostTensor::kTensorType,
+                                            CsrHostTensor::kTensorType);
+  cpu_op_handler_ptr->AddImplicitConversion(CsrHostTensor::kTensorType,
+                                            DenseHostTensor::kTensorType);
 
   return cpu_op_handler_ptr;
 }
@@ -241,10 +286,13 @@ Expected<CoreRuntimeOp> CpuOpHandler::MakeOp(string_view op_name) {
   // fallback OpHandler.
   if (op_entry->dispatch_fn == nullptr) return GetFallback()->MakeOp(op_name);
 
+  // The shape specialized variants of the op, or nullptr if there are none.
+  const CpuOpVariants* variants = op_registry_.impl_->LookupVariants(op_name);
+
   // NOTE(fishx): To avoid introducing an extra heap allocation, we need to
-  // ensure that the size of captured variable is smaller than 3 pointers.
+  // ensure that the size of captured variable is not larger than 3 pointers.
   return CoreRuntimeOp(
-      [op_entry, this](const OpInvocation& invocation) {
+      [op_entry, variants, this](const OpInvocation& invocation) {
         // CPU OpHandler should associate a CPU device.
         assert(this->device_);
         bool update_chain = !(op_entry->flags & CpuOpFlags::NoSideEffects);
@@ -255,6 +303,19 @@ Expected<CoreRuntimeOp> CpuOpHandler::MakeOp(string_view op_name) {
                                           this, std::move(argument));
         }
 
+        // Dispatch to the variant specialized for the argument shapes, if
+        // there is one. The conversions above preserve the metadata.
+        if (variants) {
+          if (auto dispatch_fn =
+                  SelectVariant(*variants, invocation.arguments)) {
+            CpuOpEntry variant_entry = *op_entry;
+            variant_entry.dispatch_fn = dispatch_fn;
+            ExecuteOnOpHandler<CpuOpHandlerTraits>(
+                update_chain, invocation, std::move(variant_entry), this);
+            return;
+          }
+        }
+
         // TODO(fishx): ExecuteOnOpHandler should return void.
         ExecuteOnOpHandler<CpuOpHandlerTraits>(update_chain, invocation,
                                                *op_entry, this);
@@ -48,6 +48,12 @@ void CpuOpRegistry::AddMetadataFn(string_view op_name,
   impl_->AddMetadataFn(op_name, metadata_fn);
 }
 
+void CpuOpRegistry::AddSpecializedOp(string_view op_name,
+                                     ArrayRef<PartialTensorShape> input_shapes,
+                                     CpuDispatchFn dispatch_fn) {
+  impl_->AddVariant(op_name, input_shapes, dispatch_fn);
+}
+
 static std::vector<CpuOpRegistration>* GetStaticCpuOpRegistrations() {
   static std::vector<CpuOpRegistration>* ret =
       new std::vector<CpuOpRegistration>;
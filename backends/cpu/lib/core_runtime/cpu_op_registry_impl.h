@@ -20,14 +20,42 @@
 #ifndef TFRT_BACKENDS_CPU_LIB_CORE_RUNTIME_CPU_OP_REGISTRY_IMPL_H_
 #define TFRT_BACKENDS_CPU_LIB_CORE_RUNTIME_CPU_OP_REGISTRY_IMPL_H_
 
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
 #include "tfrt/cpu/core_runtime/cpu_op_registry.h"
 #include "tfrt/support/op_registry_impl.h"
+#include "tfrt/tensor/tensor_shape.h"
 
 namespace tfrt {
 
+// A dispatch function of an op that is specialized for the input shapes.
+struct CpuOpVariant {
+  llvm::SmallVector<PartialTensorShape, 4> input_shapes;
+  CpuDispatchFn dispatch_fn = nullptr;
+};
+
+using CpuOpVariants = llvm::SmallVector<CpuOpVariant, 2>;
+
 // This is the pImpl implementation details for CpuOpRegistry.
 struct CpuOpRegistry::Impl final
-    : OpRegistryImpl<OpMetadataFn, CpuDispatchFn, CpuOpFlags> {};
+    : OpRegistryImpl<OpMetadataFn, CpuDispatchFn, CpuOpFlags> {
+  void AddVariant(string_view op_name,
+                  ArrayRef<PartialTensorShape> input_shapes,
+                  CpuDispatchFn dispatch_fn) {
+    assert(!op_name.empty() && "op names cannot be empty");
+    auto& variant = variants[op_name].emplace_back();
+    variant.input_shapes.assign(input_shapes.begin(), input_shapes.end());
+    variant.dispatch_fn = dispatch_fn;
+  }
+
+  // Returns the variants of `op_name`, or nullptr if it has none.
+  const CpuOpVariants* LookupVariants(string_view op_name) const {
+    auto it = variants.find(op_name);
+    return it == variants.end() ? nullptr : &it->second;
+  }
+
+  llvm::StringMap<CpuOpVariants> variants;
+};
 
 using CpuOpEntry =
     OpRegistryImpl<OpMetadataFn, CpuDispatchFn, CpuOpFlags>::OpEntry;
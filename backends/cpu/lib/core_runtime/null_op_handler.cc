@@ -20,7 +20,11 @@
 #include <memory>
 
 #include "tfrt/core_runtime/core_runtime.h"
+#include "tfrt/core_runtime/core_runtime_op.h"
+#include "tfrt/core_runtime/op_invocation.h"
+#include "tfrt/core_runtime/tensor_handle.h"
 #include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/diagnostic.h"
 #include "tfrt/host_context/execution_context.h"
 #include "tfrt/support/error_util.h"
 
@@ -31,25 +35,53 @@ class NullOpHandler : public OpHandler {
   ~NullOpHandler() override {}
 
   Expected<CoreRuntimeOp> MakeOp(string_view op_name) override {
-    return MakeStringError(op_name, " was not supported by NullOpHandler.");
+    if (!forward_arguments_)
+      return MakeStringError(op_name, " was not supported by NullOpHandler.");
+
+    return CoreRuntimeOp(
+        [](const OpInvocation& invocation) {
+          auto& arguments = invocation.arguments;
+          auto& results = invocation.results;
+          for (size_t i = 0; i < results.size(); ++i) {
+            results[i] = arguments.empty()
+                             ? TensorHandle::CreateError(EmitErrorAsync(
+                                   invocation.exec_ctx,
+                                   "NullOpHandler op without arguments must "
+                                   "not have results"))
+                             : arguments[i % arguments.size()].CopyRef();
+          }
+        },
+        /*is_fallback=*/false);
   }
 
-  friend llvm::Expected<OpHandler*> CreateNullOpHandler(CoreRuntime* runtime);
+  static llvm::Expected<OpHandler*> Create(CoreRuntime* runtime,
+                                           bool forward_arguments) {
+    if (!runtime) {
+      return MakeStringError("Invalid Runtime");
+    }
+    auto null_op_handler = std::unique_ptr<NullOpHandler>(
+        new NullOpHandler(runtime, forward_arguments));
+    auto null_op_handler_ptr = null_op_handler.get();
+    runtime->TakeOpHandler(std::move(null_op_handler));
+    return null_op_handler_ptr;
+  }
 
  private:
-  explicit NullOpHandler(CoreRuntime* runtime)
-      : OpHandler("null", runtime, nullptr) {}
+  NullOpHandler(CoreRuntime* runtime, bool forward_arguments)
+      : OpHandler("null", runtime, nullptr),
+        forward_arguments_(forward_arguments) {}
+
+  // Whether ops are executed by forwarding their arguments instead of failing.
+  const bool forward_arguments_;
 };
 
 llvm::Expected<OpHandler*> CreateNullOpHandler(CoreRuntime* runtime) {
-  if (!runtime) {
-    return MakeStringError("Invalid Runtime");
-  }
-  auto null_op_handler =
-      std::unique_ptr<NullOpHandler>(new NullOpHandler(runtime));
-  auto null_op_handler_ptr = null_op_handler.get();
-  runtime->TakeOpHandler(std::move(null_op_handler));
-  return null_op_handler_ptr;
+  return NullOpHandler::Create(runtime, /*forward_arguments=*/false);
+}
+
+llvm::Expected<OpHandler*> CreateForwardingNullOpHandler(
+    CoreRuntime* runtime) {
+  return NullOpHandler::Create(runtime, /*forward_arguments=*/true);
 }
 
 }  // namespace tfrt
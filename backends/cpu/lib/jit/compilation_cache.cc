@@ -0,0 +1,254 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file implements CompilationCache for JIT-compiled CPU ops.
+
+#include "tfrt/cpu/jit/compilation_cache.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/raw_ostream.h"
+#include "tfrt/core_runtime/op_attrs.h"
+#include "tfrt/io/file_system.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/support/hash_util.h"
+#include "tfrt/tensor/tensor_metadata.h"
+
+namespace tfrt {
+namespace cpu {
+namespace {
+
+// An artifact file is laid out as:
+//
+//   kMagic | uint32 key size | key | uint64 artifact size | artifact
+//
+// with the sizes in the host byte order, since the artifacts are only valid on
+// the CPU they were compiled for anyway.
+constexpr char kMagic[8] = {'T', 'F', 'R', 'T', 'J', 'I', 'T', '1'};
+
+// Returns the artifact stored in the file `contents`, or None if the file does
+// not hold an artifact for `key`, e.g. because it was written only partially.
+llvm::Optional<string_view> ParseArtifactFile(string_view contents,
+                                              string_view key) {
+  auto read = [&contents](void* dst, size_t size) {
+    if (contents.size() < size) return false;
+    std::memcpy(dst, contents.data(), size);
+    contents = contents.drop_front(size);
+    return true;
+  };
+
+  char magic[sizeof(kMagic)];
+  uint32_t key_size;
+  if (!read(magic, sizeof(magic)) ||
+      std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 ||
+      !read(&key_size, sizeof(key_size)) || key_size != key.size() ||
+      !contents.startswith(key))
+    return llvm::None;
+  contents = contents.drop_front(key_size);
+
+  uint64_t artifact_size;
+  if (!read(&artifact_size, sizeof(artifact_size)) ||
+      contents.size() != artifact_size)
+    return llvm::None;
+  return contents;
+}
+
+}  // namespace
+
+std::string GetHostCpuFeatures() {
+  llvm::StringMap<bool> host_features;
+  llvm::SmallVector<std::string, 64> features;
+  if (llvm::sys::getHostCPUFeatures(host_features)) {
+    for (const auto& feature : host_features) {
+      features.push_back((feature.getValue() ? "+" : "-") +
+                         feature.getKey().str());
+    }
+  }
+  std::sort(features.begin(), features.end());
+
+  std::string result = llvm::sys::getHostCPUName().str();
+  for (const auto& feature : features) {
+    result += ",";
+    result += feature;
+  }
+  return result;
+}
+
+std::string ComputeCompilationCacheKey(string_view op_name,
+                                       const OpAttrsRef& attrs,
+                                       ArrayRef<TensorMetadata> arguments,
+                                       string_view cpu_features) {
+  // Attributes are hashed in the order of their names.
+  llvm::SmallVector<const OpAttrsRawEntry*, 16> entries;
+  attrs.IterateEntries(
+      [&](const OpAttrsRawEntry& entry) { entries.push_back(&entry); });
+  std::sort(entries.begin(), entries.end(),
+            [](const OpAttrsRawEntry* a, const OpAttrsRawEntry* b) {
+              return std::strcmp(a->name, b->name) < 0;
+            });
+
+  std::string key;
+  llvm::raw_string_ostream os(key);
+  os << op_name << "(";
+  for (const auto* entry : entries) {
+    const void* data = entry->GetData();
+    const size_t element_size =
+        GetHostSizeAndAlignment(data, entry->type).first;
+    const size_t size =
+        entry->IsArray() ? element_size * entry->element_count : element_size;
+    os << entry->name << ":" << GetNameString(entry->type) << "["
+       << entry->element_count << "]=";
+    os.write_hex(Hash64(static_cast<const char*>(data), size));
+    os << ";";
+  }
+  os << ")(";
+  for (const auto& argument : arguments) os << argument << ";";
+  os << ")@" << cpu_features;
+  return os.str();
+}
+
+CompiledArtifact::CompiledArtifact(std::string data)
+    : owned_data_(std::move(data)), data_(owned_data_) {}
+
+CompiledArtifact::CompiledArtifact(
+    std::unique_ptr<io::ReadOnlyMemoryRegion> region, string_view data)
+    : region_(std::move(region)), data_(data) {}
+
+CompiledArtifact::~CompiledArtifact() = default;
+
+CompilationCache::CompilationCache(std::string directory)
+    : directory_(std::move(directory)),
+      file_system_(directory_.empty()
+                       ? nullptr
+                       : io::FileSystemRegistry::Default()->LookupForPath(
+                             directory_)) {}
+
+std::string CompilationCache::GetPath(string_view key) const {
+  std::string path;
+  llvm::raw_string_ostream os(path);
+  os << directory_ << "/";
+  os.write_hex(Hash64(key));
+  os << ".jit";
+  return os.str();
+}
+
+std::shared_ptr<const CompiledArtifact> CompilationCache::Lookup(
+    string_view key) {
+  {
+    mutex_lock lock(mu_);
+    auto it = artifacts_.find(key);
+    if (it != artifacts_.end()) return it->second;
+  }
+
+  auto artifact = Load(key);
+  if (artifact == nullptr) return nullptr;
+
+  // Another thread may have loaded or compiled the artifact in the meantime.
+  mutex_lock lock(mu_);
+  return artifacts_.try_emplace(key, std::move(artifact)).first->second;
+}
+
+std::shared_ptr<const CompiledArtifact> CompilationCache::Load(
+    string_view key) {
+  if (file_system_ == nullptr) return nullptr;
+  const std::string path = GetPath(key);
+
+  // Map the file if the file system supports it, so that the artifact is not
+  // copied.
+  std::unique_ptr<io::ReadOnlyMemoryRegion> region;
+  if (auto error = file_system_->NewReadOnlyMemoryRegion(path, &region)) {
+    llvm::consumeError(std::move(error));
+  } else {
+    string_view contents(static_cast<const char*>(region->data()),
+                         region->length());
+    auto artifact = ParseArtifactFile(contents, key);
+    if (!artifact) return nullptr;
+    return std::make_shared<CompiledArtifact>(std::move(region), *artifact);
+  }
+
+  std::unique_ptr<io::RandomAccessFile> file;
+  if (auto error = file_system_->NewRandomAccessFile(path, &file)) {
+    llvm::consumeError(std::move(error));
+    return nullptr;
+  }
+  std::string contents;
+  constexpr size_t kChunkSize = 1 << 16;
+  for (;;) {
+    const size_t offset = contents.size();
+    contents.resize(offset + kChunkSize);
+    auto count = file->Read(&contents[offset], kChunkSize, offset);
+    if (!count) {
+      llvm::consumeError(count.takeError());
+      return nullptr;
+    }
+    contents.resize(offset + *count);
+    if (*count < kChunkSize) break;
+  }
+
+  auto artifact = ParseArtifactFile(contents, key);
+  if (!artifact) return nullptr;
+  return std::make_shared<CompiledArtifact>(artifact->str());
+}
+
+llvm::Error CompilationCache::Insert(string_view key, std::string artifact) {
+  const uint64_t artifact_size = artifact.size();
+  auto cached = std::make_shared<const CompiledArtifact>(std::move(artifact));
+  {
+    mutex_lock lock(mu_);
+    artifacts_[key] = cached;
+  }
+  if (file_system_ == nullptr) return llvm::Error::success();
+
+  // Readers that see a partially written file treat it as a miss, so the file
+  // is written in place.
+  std::unique_ptr<io::WritableFile> file;
+  if (auto error = file_system_->NewWritableFile(GetPath(key), &file))
+    return error;
+
+  const uint32_t key_size = key.size();
+  const string_view chunks[] = {
+      string_view(kMagic, sizeof(kMagic)),
+      string_view(reinterpret_cast<const char*>(&key_size), sizeof(key_size)),
+      key,
+      string_view(reinterpret_cast<const char*>(&artifact_size),
+                  sizeof(artifact_size)),
+      cached->data()};
+  if (auto error = file->Append(chunks)) return error;
+  return file->Close();
+}
+
+llvm::Expected<std::shared_ptr<const CompiledArtifact>>
+CompilationCache::GetOrCompile(
+    string_view key,
+    llvm::function_ref<llvm::Expected<std::string>()> compile) {
+  if (auto artifact = Lookup(key)) return artifact;
+
+  auto compiled = compile();
+  if (!compiled) return compiled.takeError();
+  llvm::consumeError(Insert(key, std::move(*compiled)));
+
+  mutex_lock lock(mu_);
+  return artifacts_.find(key)->second;
+}
+
+}  // namespace cpu
+}  // namespace tfrt
@@ -0,0 +1,381 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Scaled dot-product attention kernel implementation.
+//
+// The queries of every head are processed in blocks, and each query block
+// walks the keys and values in blocks as well. The scores of a query block
+// with a key block are computed into a small tile, masked, and folded into
+// running softmax statistics and a running output with the online softmax
+// (see softmax_kernel.h). The [query_len, key_len] score matrix is never
+// materialized, so memory use does not grow with the square of the sequence
+// length. Query blocks are computed in parallel. The keys and values are
+// either dense tensors, or the blocks of a KVCache that are read in place.
+
+#ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_ATTENTION_KERNEL_H_
+#define TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_ATTENTION_KERNEL_H_
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "./kv_cache.h"
+#include "./softmax_kernel.h"
+#include "tfrt/common/compat/eigen/eigen_dtype.h"
+#include "tfrt/common/compat/eigen/eigen_evaluator.h"
+#include "tfrt/common/compat/eigen/tensor_types.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+#include "tfrt/tensor/tensor_shape.h"
+
+namespace tfrt {
+namespace cpu {
+namespace internal {
+
+// The number of queries, and of keys, in the blocks that the score tiles are
+// computed for. A tile of scores stays in L1 cache.
+constexpr Index kAttentionQueryBlock = 32;
+constexpr Index kAttentionKeyBlock = 64;
+
+struct AttentionDims {
+  Index query_len;
+  Index key_len;
+  Index depth;
+  Index value_depth;
+};
+
+// The buffers of the running attention of a query block.
+template <typename Acc>
+struct AttentionScratch {
+  explicit AttentionScratch(Index value_depth)
+      : scores(kAttentionQueryBlock * kAttentionKeyBlock),
+        output(kAttentionQueryBlock * value_depth),
+        stats(kAttentionQueryBlock) {}
+
+  std::vector<Acc> scores;
+  std::vector<Acc> output;
+  std::vector<SoftmaxRowStats<Acc>> stats;
+};
+
+// Computes the attention of the queries [q_begin, q_end) of one head.
+// `key_blocks(k)` returns the keys and the values of the head from the key
+// `k`, a multiple of kAttentionKeyBlock, which are contiguous up to the end of
+// the key block. `mask` is null, or tells which of the `key_len` keys can be
+// attended to.
+template <typename T, typename KeyBlocks>
+void AttentionQueryBlock(
+    const T* query, const KeyBlocks& key_blocks, const bool* mask, T* output,
+    const AttentionDims& dims, Index q_begin, Index q_end, float scale,
+    bool causal, AttentionScratch<compat::AccumulatorType<T>>* scratch) {
+  using Acc = compat::AccumulatorType<T>;
+  using Input =
+      Eigen::TensorMap<const Eigen::Tensor<T, 2, Eigen::RowMajor, Index>,
+                       Eigen::Unaligned>;
+  using Tile = Eigen::TensorMap<Eigen::Tensor<Acc, 2, Eigen::RowMajor, Index>,
+                                Eigen::Unaligned>;
+  using Row = Eigen::TensorMap<Eigen::Tensor<Acc, 1, Eigen::RowMajor, Index>,
+                               Eigen::Unaligned>;
+  using Scalar = Eigen::Tensor<Acc, 0, Eigen::RowMajor, Index>;
+  constexpr Acc kMinusInf = -std::numeric_limits<Acc>::infinity();
+
+  const Index rows = q_end - q_begin;
+  const Index depth = dims.depth;
+  const Index value_depth = dims.value_depth;
+
+  // With the causal mask the query `i` attends to the keys up to
+  // `i + causal_offset`, so that the last query attends to all the keys.
+  const Index causal_offset = dims.key_len - dims.query_len;
+  const Index key_end =
+      causal ? std::clamp<Index>(q_end + causal_offset, 0, dims.key_len)
+             : dims.key_len;
+
+  Eigen::array<Eigen::IndexPair<Index>, 1> score_dims = {
+      Eigen::IndexPair<Index>(1, 1)};
+  Eigen::array<Eigen::IndexPair<Index>, 1> output_dims = {
+      Eigen::IndexPair<Index>(1, 0)};
+
+  Input query_tile(query + q_begin * depth, rows, depth);
+  Tile acc(scratch->output.data(), rows, value_depth);
+  acc.setZero();
+  std::fill_n(scratch->stats.begin(), rows, SoftmaxRowStats<Acc>{kMinusInf, 0});
+
+  for (Index k_begin = 0; k_begin < key_end; k_begin += kAttentionKeyBlock) {
+    const Index cols = std::min(kAttentionKeyBlock, key_end - k_begin);
+    const std::pair<const T*, const T*> block = key_blocks(k_begin);
+    Input key_tile(block.first, cols, depth);
+    Input value_tile(block.second, cols, value_depth);
+
+    Tile scores(scratch->scores.data(), rows, cols);
+    scores = query_tile.template cast<Acc>().contract(
+                 key_tile.template cast<Acc>(), score_dims) *
+             static_cast<Acc>(scale);
+
+    for (Index r = 0; r < rows; ++r) {
+      Acc* score_row = scratch->scores.data() + r * cols;
+
+      // Mask the keys after the causal limit, and the padding keys.
+      const Index limit =
+          causal ? q_begin + r + causal_offset + 1 - k_begin : cols;
+      for (Index c = std::max<Index>(limit, 0); c < cols; ++c)
+        score_row[c] = kMinusInf;
+      if (mask != nullptr) {
+        for (Index c = 0; c < cols; ++c)
+          if (!mask[k_begin + c]) score_row[c] = kMinusInf;
+      }
+
+      // Rescale the running sum and output to the new maximum, and replace
+      // the scores with their exponentials.
+      Row row(score_row, cols);
+      SoftmaxRowStats<Acc>& stats = scratch->stats[r];
+      Scalar block_max = row.maximum();
+      const Acc max = std::max(stats.max, block_max());
+      if (max == kMinusInf) {
+        // No key of the row is attended to so far.
+        row.setZero();
+        continue;
+      }
+      const Acc correction = std::exp(stats.max - max);
+      row = (row - max).exp();
+      Scalar block_sum = row.sum();
+      stats.sum = stats.sum * correction + block_sum();
+      stats.max = max;
+
+      Row output_row(scratch->output.data() + r * value_depth, value_depth);
+      output_row = output_row * correction;
+    }
+
+    acc += scores.contract(value_tile.template cast<Acc>(), output_dims);
+  }
+
+  for (Index r = 0; r < rows; ++r) {
+    using OutputRow =
+        Eigen::TensorMap<Eigen::Tensor<T, 1, Eigen::RowMajor, Index>,
+                         Eigen::Unaligned>;
+    Row acc_row(scratch->output.data() + r * value_depth, value_depth);
+    OutputRow output_row(output + (q_begin + r) * value_depth, value_depth);
+
+    // Queries that attend to no key have a zero output.
+    const Acc sum = scratch->stats[r].sum;
+    const Acc inv_sum = sum > 0 ? Acc(1) / sum : Acc(0);
+    output_row = (acc_row * inv_sum).template cast<T>();
+  }
+}
+
+}  // namespace internal
+
+// Computes the scaled dot-product attention
+//
+//   output = softmax(scale * query key^T + mask) value
+//
+// of `query` [batch, heads, query_len, depth], `key` [batch, heads, key_len,
+// depth] and `value` [batch, heads, key_len, value_depth] into `output`
+// [batch, heads, query_len, value_depth].
+//
+// With `causal` the query `i` only attends to the keys up to
+// `i + key_len - query_len`, which is the usual causal mask for queries that
+// are the last `query_len` positions of the sequence. `padding_mask` is null,
+// or a [batch, key_len] boolean tensor that is false for the keys that are not
+// attended to. Queries that attend to no key have a zero output. 16-bit
+// floating point inputs are computed in float.
+template <typename T, typename EigenEvaluator>
+typename EigenEvaluator::DependencyToken ScaledDotProductAttention(
+    const DenseHostTensor& query, const DenseHostTensor& key,
+    const DenseHostTensor& value, const DenseHostTensor* padding_mask,
+    DenseHostTensor* output, float scale, bool causal,
+    const ExecutionContext& exec_ctx) {
+  using Acc = compat::AccumulatorType<T>;
+  EigenEvaluator eigen{exec_ctx.host()};
+
+  if (query.shape().GetRank() != 4 || key.shape().GetRank() != 4 ||
+      value.shape().GetRank() != 4)
+    return eigen.MakeError("attention inputs must be rank 4 tensors");
+
+  const Index batch = query.shape().GetDimensionSize(0);
+  const Index heads = query.shape().GetDimensionSize(1);
+  internal::AttentionDims dims;
+  dims.query_len = query.shape().GetDimensionSize(2);
+  dims.key_len = key.shape().GetDimensionSize(2);
+  dims.depth = query.shape().GetDimensionSize(3);
+  dims.value_depth = value.shape().GetDimensionSize(3);
+
+  if (key.shape() != TensorShape({batch, heads, dims.key_len, dims.depth}) ||
+      value.shape() !=
+          TensorShape({batch, heads, dims.key_len, dims.value_depth}))
+    return eigen.MakeError("incompatible attention input shapes: query ",
+                           query.shape(), ", key ", key.shape(), ", value ",
+                           value.shape());
+
+  if (padding_mask != nullptr &&
+      (padding_mask->dtype() != DType(DType::I1) ||
+       padding_mask->shape() != TensorShape({batch, dims.key_len})))
+    return eigen.MakeError("padding mask must be a [", batch, ", ",
+                           dims.key_len, "] boolean tensor, got ",
+                           padding_mask->dtype(), " ", padding_mask->shape());
+
+  const T* query_data = DHTArrayView<T>(&query).data();
+  const T* key_data = DHTArrayView<T>(&key).data();
+  const T* value_data = DHTArrayView<T>(&value).data();
+  const bool* mask_data =
+      padding_mask ? DHTArrayView<bool>(padding_mask).data() : nullptr;
+  T* output_data = MutableDHTArrayView<T>(output).data();
+
+  // Without a padding mask, the query is kept alive in its place.
+  const DenseHostTensor* mask_or_query = padding_mask ? padding_mask : &query;
+
+  const Index num_query_blocks =
+      (dims.query_len + internal::kAttentionQueryBlock - 1) /
+      internal::kAttentionQueryBlock;
+
+  // The cost of computing one query block over all the keys.
+  using ExpCost = Eigen::internal::functor_traits<
+      Eigen::internal::scalar_exp_op<Acc>>;
+  const double block_scores =
+      static_cast<double>(internal::kAttentionQueryBlock) * dims.key_len;
+  Eigen::TensorOpCost cost(
+      dims.key_len * (dims.depth + dims.value_depth) * sizeof(T),
+      internal::kAttentionQueryBlock * dims.value_depth * sizeof(T),
+      block_scores * ((dims.depth + dims.value_depth) *
+                          (Eigen::TensorOpCost::AddCost<Acc>() +
+                           Eigen::TensorOpCost::MulCost<Acc>()) +
+                      ExpCost::Cost + 4));
+
+  return eigen.ParallelFor(
+      batch * heads * num_query_blocks, cost,
+      [=](Eigen::Index begin, Eigen::Index end) {
+        internal::AttentionScratch<Acc> scratch(dims.value_depth);
+        for (Index block = begin; block < end; ++block) {
+          const Index head = block / num_query_blocks;
+          const Index q_begin =
+              (block % num_query_blocks) * internal::kAttentionQueryBlock;
+          const Index q_end = std::min(
+              q_begin + internal::kAttentionQueryBlock, dims.query_len);
+          const T* head_keys = key_data + head * dims.key_len * dims.depth;
+          const T* head_values =
+              value_data + head * dims.key_len * dims.value_depth;
+          auto key_blocks = [&](Index k) {
+            return std::make_pair(head_keys + k * dims.depth,
+                                  head_values + k * dims.value_depth);
+          };
+          internal::AttentionQueryBlock<T>(
+              query_data + head * dims.query_len * dims.depth, key_blocks,
+              mask_data ? mask_data + (head / heads) * dims.key_len : nullptr,
+              output_data + head * dims.query_len * dims.value_depth, dims,
+              q_begin, q_end, scale, causal, &scratch);
+        }
+      },
+      eigen.KeepAlive(&query, &key, &value, mask_or_query, output));
+}
+
+// Computes the attention of `query` [batch, heads, query_len, depth] over the
+// keys and values of `sequences`, a batch of sequence ids, that are cached in
+// `cache`, into `output` [batch, heads, query_len, value_depth]. The cached
+// blocks are read in place, and the sequences may have different lengths.
+// `causal` treats the queries as the last positions of their sequences, which
+// are usually the tokens that were just appended.
+template <typename T, typename EigenEvaluator>
+typename EigenEvaluator::DependencyToken KVCacheAttention(
+    const DenseHostTensor& query, const KVCache& cache,
+    llvm::ArrayRef<int64_t> sequences, DenseHostTensor* output, float scale,
+    bool causal, const ExecutionContext& exec_ctx) {
+  static_assert(KVCache::kBlockTokens % internal::kAttentionKeyBlock == 0,
+                "key blocks must not straddle the cache blocks");
+  using Acc = compat::AccumulatorType<T>;
+  EigenEvaluator eigen{exec_ctx.host()};
+  const KVCache::Config& config = cache.config();
+
+  const Index batch = sequences.size();
+  const Index query_len =
+      query.shape().GetRank() == 4 ? query.shape().GetDimensionSize(2) : 0;
+  if (query.dtype() != config.dtype ||
+      query.shape() !=
+          TensorShape({batch, config.heads, query_len, config.depth}))
+    return eigen.MakeError("KV cache attention expects ", config.dtype,
+                           " queries [", batch, ", ", config.heads,
+                           ", query_len, ", config.depth, "], got ",
+                           query.dtype(), " ", query.shape());
+
+  // Reading the sequences keeps their blocks from being reused until the
+  // attention is computed.
+  auto reads = std::make_shared<std::vector<KVCache::Sequence>>();
+  reads->reserve(batch);
+  Index max_key_len = 0;
+  for (int64_t id : sequences) {
+    reads->push_back(cache.Read(id));
+    max_key_len = std::max(max_key_len, reads->back().length);
+  }
+
+  const T* query_data = DHTArrayView<T>(&query).data();
+  T* output_data = MutableDHTArrayView<T>(output).data();
+  const Index heads = config.heads;
+  const Index num_query_blocks =
+      (query_len + internal::kAttentionQueryBlock - 1) /
+      internal::kAttentionQueryBlock;
+
+  using ExpCost = Eigen::internal::functor_traits<
+      Eigen::internal::scalar_exp_op<Acc>>;
+  const double block_scores =
+      static_cast<double>(internal::kAttentionQueryBlock) * max_key_len;
+  Eigen::TensorOpCost cost(
+      max_key_len * (config.depth + config.value_depth) * sizeof(T),
+      internal::kAttentionQueryBlock * config.value_depth * sizeof(T),
+      block_scores * ((config.depth + config.value_depth) *
+                          (Eigen::TensorOpCost::AddCost<Acc>() +
+                           Eigen::TensorOpCost::MulCost<Acc>()) +
+                      ExpCost::Cost + 4));
+
+  return eigen.ParallelFor(
+      batch * heads * num_query_blocks, cost,
+      [=, cache = &cache](Eigen::Index begin, Eigen::Index end) {
+        internal::AttentionScratch<Acc> scratch(config.value_depth);
+        for (Index block = begin; block < end; ++block) {
+          const Index head = block / num_query_blocks;
+          const Index h = head % heads;
+          const KVCache::Sequence& sequence = (*reads)[head / heads];
+          const internal::AttentionDims dims{query_len, sequence.length,
+                                             config.depth,
+                                             config.value_depth};
+          auto key_blocks = [&](Index k) {
+            const HostBuffer& cached =
+                *sequence.blocks[k / KVCache::kBlockTokens];
+            const Index offset = k % KVCache::kBlockTokens;
+            return std::make_pair(
+                static_cast<const T*>(cache->keys(cached, h)) +
+                    offset * config.depth,
+                static_cast<const T*>(cache->values(cached, h)) +
+                    offset * config.value_depth);
+          };
+          const Index q_begin =
+              (block % num_query_blocks) * internal::kAttentionQueryBlock;
+          const Index q_end =
+              std::min(q_begin + internal::kAttentionQueryBlock, query_len);
+          internal::AttentionQueryBlock<T>(
+              query_data + head * query_len * config.depth, key_blocks,
+              /*mask=*/nullptr,
+              output_data + head * query_len * config.value_depth, dims,
+              q_begin, q_end, scale, causal, &scratch);
+        }
+      },
+      eigen.KeepAlive(&query, output));
+}
+
+}  // namespace cpu
+}  // namespace tfrt
+
+#endif  // TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_ATTENTION_KERNEL_H_
@@ -0,0 +1,234 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Batched MatMul kernel implementation.
+//
+// The batch dimensions of the operands are broadcast against each other. A rhs
+// that is shared by the whole batch is multiplied with all the lhs matrices at
+// once, as a single MatMul. Otherwise small matrices are multiplied in
+// parallel across the batch, each one by a single thread, and large matrices
+// are multiplied one at a time by all threads when the batch is too small to
+// keep the threads busy.
+
+#ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_BATCH_MATMUL_KERNEL_H_
+#define TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_BATCH_MATMUL_KERNEL_H_
+
+#include <algorithm>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "./matmul_kernel.h"
+#include "./packed_matmul_kernel.h"
+#include "llvm/ADT/SmallVector.h"
+#include "tfrt/common/compat/eigen/eigen_dtype.h"
+#include "tfrt/common/compat/eigen/eigen_evaluator.h"
+#include "tfrt/common/compat/eigen/tensor_types.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+#include "tfrt/tensor/tensor_metadata.h"
+#include "tfrt/tensor/tensor_shape.h"
+
+namespace tfrt {
+namespace cpu {
+namespace internal {
+
+// Matrices that take at least this many multiply-adds are multiplied by all
+// threads, one at a time, if the batch has fewer matrices than threads.
+constexpr Index kMinInMatrixParallelCost = 128 * 128 * 128;
+
+// Returns the offset, in matrices, of the argument matrix of every output
+// matrix, when the argument batch dimensions `arg_batch` are broadcast to the
+// output batch dimensions `out_batch`.
+inline std::vector<Index> GetBatchOffsets(ArrayRef<Index> arg_batch,
+                                          ArrayRef<Index> out_batch) {
+  assert(arg_batch.size() <= out_batch.size());
+  const size_t rank = out_batch.size();
+
+  // The strides of the argument batch dimensions aligned to the right, and
+  // zero for the broadcast dimensions.
+  llvm::SmallVector<Index, 4> strides(rank, 0);
+  Index stride = 1;
+  for (size_t d = 1; d <= arg_batch.size(); ++d) {
+    const Index size = arg_batch[arg_batch.size() - d];
+    if (size != 1) strides[rank - d] = stride;
+    stride *= size;
+  }
+
+  Index num_batches = 1;
+  for (Index size : out_batch) num_batches *= size;
+
+  std::vector<Index> offsets(num_batches);
+  llvm::SmallVector<Index, 4> index(rank, 0);
+  Index offset = 0;
+  for (Index i = 0; i < num_batches; ++i) {
+    offsets[i] = offset;
+    for (size_t d = rank; d-- > 0;) {
+      offset += strides[d];
+      if (++index[d] < out_batch[d]) break;
+      offset -= strides[d] * out_batch[d];
+      index[d] = 0;
+    }
+  }
+  return offsets;
+}
+
+// Returns the product of the matrices `a` and `b`. 16-bit floating point
+// matrices are multiplied with float accumulation.
+template <typename T, typename Lhs, typename Rhs, typename ContractDims>
+auto MatrixProduct(const Lhs& a, const Rhs& b, const ContractDims& dims) {
+  using Acc = compat::AccumulatorType<T>;
+  if constexpr (std::is_same<Acc, T>::value) {
+    return a.contract(b, dims);
+  } else {
+    return a.template cast<Acc>()
+        .contract(b.template cast<Acc>(), dims)
+        .template cast<T>();
+  }
+}
+
+// Returns a view of `tensor` with `shape`, which has the same number of
+// elements.
+inline DenseHostTensor Reshape(const DenseHostTensor& tensor,
+                               const TensorShape& shape) {
+  assert(shape.GetNumElements() == tensor.NumElements());
+  return DenseHostTensor(TensorMetadata(tensor.dtype(), shape),
+                         tensor.buffer().CopyRef());
+}
+
+}  // namespace internal
+
+// Batched matrix multiplication kernel (tf.BatchMatMulV2):
+//   C[..., :, :] = A[..., :, :] B[..., :, :]
+//
+// The batch dimensions of `a` and `b`, all but the last two, are broadcast to
+// the batch dimensions of `output`. `adj_x` and `adj_y` transpose the lhs and
+// rhs matrices.
+template <typename T, typename EigenEvaluator>
+typename EigenEvaluator::DependencyToken BatchMatMul(
+    const DenseHostTensor& a, const DenseHostTensor& b, DenseHostTensor* output,
+    bool adj_x, bool adj_y, const ExecutionContext& exec_ctx,
+    EigenEvaluator eigen) {
+  using ConstMatrix =
+      Eigen::TensorMap<const Eigen::Tensor<T, 2, Eigen::RowMajor, Index>,
+                       Eigen::Unaligned>;
+  using Matrix = Eigen::TensorMap<Eigen::Tensor<T, 2, Eigen::RowMajor, Index>,
+                                  Eigen::Unaligned>;
+
+  llvm::SmallVector<Index, 4> a_dims, b_dims, out_dims;
+  a.shape().GetDimensions(&a_dims);
+  b.shape().GetDimensions(&b_dims);
+  output->shape().GetDimensions(&out_dims);
+  assert(a_dims.size() >= 2 && b_dims.size() >= 2 && out_dims.size() >= 2);
+
+  const Index a_rows = a_dims[a_dims.size() - 2];
+  const Index a_cols = a_dims.back();
+  const Index b_rows = b_dims[b_dims.size() - 2];
+  const Index b_cols = b_dims.back();
+  const Index m = adj_x ? a_cols : a_rows;
+  const Index k = adj_x ? a_rows : a_cols;
+  const Index n = adj_y ? b_rows : b_cols;
+
+  auto a_batch = llvm::ArrayRef(a_dims).drop_back(2);
+  auto b_batch = llvm::ArrayRef(b_dims).drop_back(2);
+  auto out_batch = llvm::ArrayRef(out_dims).drop_back(2);
+  const Index num_batches = output->NumElements() / std::max<Index>(1, m * n);
+  const Index a_matrices = a.NumElements() / std::max<Index>(1, m * k);
+
+  // The rhs is shared by the whole batch: multiply it with the lhs matrices
+  // stacked into a single matrix, so that it is packed only once.
+  if (b.NumElements() == k * n && !adj_x && a_matrices == num_batches) {
+    DenseHostTensor a_matrix =
+        internal::Reshape(a, TensorShape({num_batches * m, k}));
+    DenseHostTensor b_matrix =
+        internal::Reshape(b, TensorShape({b_rows, b_cols}));
+    DenseHostTensor c_matrix =
+        internal::Reshape(*output, TensorShape({num_batches * m, n}));
+    if (auto packed = GetPackedMatMulWeights<T>(exec_ctx, a_matrix, b_matrix,
+                                                /*transpose_a=*/false, adj_y))
+      return PackedMatMul<T>(a_matrix, std::move(packed), &c_matrix,
+                             /*transpose_a=*/false, NoOpPackedEpilogue(),
+                             eigen);
+    return MatMul<T>(1.0, a_matrix, b_matrix, 0.0, &c_matrix,
+                     /*transpose_a=*/false, adj_y, Eigen::NoOpOutputKernel(),
+                     eigen);
+  }
+
+  std::shared_ptr<const std::vector<Index>> a_offsets =
+      std::make_shared<std::vector<Index>>(
+          internal::GetBatchOffsets(a_batch, out_batch));
+  std::shared_ptr<const std::vector<Index>> b_offsets =
+      std::make_shared<std::vector<Index>>(
+          internal::GetBatchOffsets(b_batch, out_batch));
+
+  Eigen::array<Eigen::IndexPair<Index>, 1> contract_dims;
+  contract_dims[0].first = adj_x ? 0 : 1;
+  contract_dims[0].second = adj_y ? 1 : 0;
+
+  const T* a_data = DHTArrayView<T>(&a).data();
+  const T* b_data = DHTArrayView<T>(&b).data();
+  T* c_data = MutableDHTArrayView<T>(output).data();
+
+  // Multiplies the output matrix `i`.
+  auto multiply = [=](Index i) {
+    ConstMatrix a_matrix(a_data + (*a_offsets)[i] * m * k, a_rows, a_cols);
+    ConstMatrix b_matrix(b_data + (*b_offsets)[i] * k * n, b_rows, b_cols);
+    Matrix c_matrix(c_data + i * m * n, m, n);
+    return std::make_pair(c_matrix, internal::MatrixProduct<T>(
+                                        a_matrix, b_matrix, contract_dims));
+  };
+
+  // Multiply large matrices one at a time with all threads.
+  if (num_batches > 0 &&
+      num_batches < exec_ctx.host()->GetNumWorkerThreads() &&
+      m * n * k >= internal::kMinInMatrixParallelCost) {
+    auto first = multiply(0);
+    auto token = eigen.Evaluate(first.first, first.second,
+                                eigen.KeepAlive(&a, &b, output));
+    for (Index i = 1; i < num_batches; ++i) {
+      auto product = multiply(i);
+      token = eigen.Evaluate(token, product.first, product.second,
+                             eigen.KeepAlive(&a, &b, output));
+    }
+    return token;
+  }
+
+  // Multiply the matrices in parallel across the batch, each one by a single
+  // thread.
+  using Acc = compat::AccumulatorType<T>;
+  const double matrix_cost = static_cast<double>(m) * n * k;
+  Eigen::TensorOpCost cost((m * k + k * n) * sizeof(T), m * n * sizeof(T),
+                           matrix_cost * (Eigen::TensorOpCost::AddCost<Acc>() +
+                                          Eigen::TensorOpCost::MulCost<Acc>()));
+
+  return eigen.ParallelFor(
+      num_batches, cost,
+      [=](Eigen::Index begin, Eigen::Index end) {
+        for (Index i = begin; i < end; ++i) {
+          auto product = multiply(i);
+          product.first = product.second;
+        }
+      },
+      eigen.KeepAlive(&a, &b, output));
+}
+
+}  // namespace cpu
+}  // namespace tfrt
+
+#endif  // TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_BATCH_MATMUL_KERNEL_H_
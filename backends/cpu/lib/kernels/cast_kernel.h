@@ -0,0 +1,167 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Cast kernel implementation.
+//
+// The conversions are Eigen tensor expressions, so they are vectorized with
+// the packet conversions of the target (e.g. F16C for half, AVX512-BF16 for
+// bfloat16 and NEON on Arm), and large tensors are converted in parallel by
+// the async evaluator.
+
+#ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_CAST_KERNEL_H_
+#define TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_CAST_KERNEL_H_
+
+#include <cmath>
+#include <complex>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+#include "tfrt/common/compat/eigen/eigen_evaluator.h"
+#include "tfrt/common/compat/eigen/eigen_kernel.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+
+namespace tfrt {
+namespace cpu {
+
+// The rounding of floating point values cast to integers.
+enum class CastRounding {
+  kTruncate,          // Towards zero, as static_cast does.
+  kHalfToEven,        // To nearest, ties to even.
+  kHalfAwayFromZero,  // To nearest, ties away from zero.
+};
+
+namespace internal {
+
+template <typename T>
+struct IsComplex : std::false_type {};
+template <typename T>
+struct IsComplex<std::complex<T>> : std::true_type {};
+
+template <typename T>
+constexpr bool IsReducedPrecisionFloat() {
+  return std::is_same<T, Eigen::half>::value ||
+         std::is_same<T, Eigen::bfloat16>::value;
+}
+
+template <typename T>
+constexpr bool IsFloat() {
+  return std::is_floating_point<T>::value || IsReducedPrecisionFloat<T>();
+}
+
+template <typename T>
+constexpr bool IsInteger() {
+  return std::is_integral<T>::value && !std::is_same<T, bool>::value;
+}
+
+// Returns the largest value of the floating point type `F` that does not
+// exceed the maximum of the integer type `I`, which is 2^digits - 1. Casting
+// the maximum itself may round it up, e.g. float(INT32_MAX) is 2^31.
+template <typename F, typename I>
+F MaxIntegerInFloat() {
+  F max = static_cast<F>(std::numeric_limits<I>::max());
+  if (max >= std::ldexp(F(1), std::numeric_limits<I>::digits))
+    max = std::nextafter(max, F(0));
+  return max;
+}
+
+// Returns the expression that casts `input` of floating point type `SrcT` to
+// the integer type `DstT`, where `rounded` is `input` rounded to integers: the
+// values are saturated to the range of `DstT`, and NaN is cast to zero.
+template <typename SrcT, typename DstT, typename Input, typename Rounded>
+auto SaturatingCast(const Input& input, const Rounded& rounded) {
+  const SrcT lowest = static_cast<SrcT>(std::numeric_limits<DstT>::lowest());
+  const SrcT max = MaxIntegerInFloat<SrcT, DstT>();
+  auto saturated = rounded.cwiseMax(lowest).cwiseMin(max);
+  return (input == input)
+      .select(saturated, input.constant(SrcT(0)))
+      .template cast<DstT>();
+}
+
+// Evaluates `input` of type `SrcT` cast to `DstT` into `output`.
+template <typename SrcT, typename DstT, typename EigenEvaluator,
+          typename Input, typename Output, typename ArgLifetimeExtension>
+typename EigenEvaluator::DependencyToken EvaluateCast(
+    EigenEvaluator& eigen, const Input& input, Output output,
+    CastRounding rounding, ArgLifetimeExtension args) {
+  if constexpr (std::is_same<SrcT, DstT>::value) {
+    return eigen.Evaluate(std::move(output), input, std::move(args));
+  } else if constexpr (IsComplex<SrcT>::value && !IsComplex<DstT>::value) {
+    // The imaginary part is discarded.
+    using RealT = typename SrcT::value_type;
+    return EvaluateCast<RealT, DstT>(eigen, input.real(), std::move(output),
+                                     rounding, std::move(args));
+  } else if constexpr (std::is_same<DstT, bool>::value) {
+    return eigen.Evaluate(std::move(output), input != input.constant(SrcT(0)),
+                          std::move(args));
+  } else if constexpr (IsReducedPrecisionFloat<SrcT>() &&
+                       !std::is_same<DstT, float>::value) {
+    // 16-bit floats are converted by the way of float, which is exact.
+    return EvaluateCast<float, DstT>(eigen, input.template cast<float>(),
+                                     std::move(output), rounding,
+                                     std::move(args));
+  } else if constexpr (IsFloat<SrcT>() && IsInteger<DstT>()) {
+    switch (rounding) {
+      case CastRounding::kHalfToEven:
+        return eigen.Evaluate(std::move(output),
+                              SaturatingCast<SrcT, DstT>(input, input.rint()),
+                              std::move(args));
+      case CastRounding::kHalfAwayFromZero:
+        return eigen.Evaluate(std::move(output),
+                              SaturatingCast<SrcT, DstT>(input, input.round()),
+                              std::move(args));
+      case CastRounding::kTruncate:
+        break;
+    }
+    return eigen.Evaluate(std::move(output),
+                          SaturatingCast<SrcT, DstT>(input, input),
+                          std::move(args));
+  } else {
+    return eigen.Evaluate(std::move(output), input.template cast<DstT>(),
+                          std::move(args));
+  }
+}
+
+}  // namespace internal
+
+// Casts `input` of type `SrcT` to `output` of type `DstT` (tf.Cast). Integers
+// are cast with static_cast semantics, except that floating point values cast
+// to integers are rounded with `rounding` and saturated to the range of the
+// integer type, with NaN cast to zero. Complex values cast to real types drop
+// their imaginary part, and any type cast to bool is compared to zero.
+template <typename SrcT, typename DstT, typename EigenEvaluator>
+typename EigenEvaluator::DependencyToken Cast(
+    const DenseHostTensor& input, DenseHostTensor* output,
+    CastRounding rounding, const ExecutionContext& exec_ctx) {
+  EigenEvaluator eigen{exec_ctx.host()};
+
+  if (input.NumElements() != output->NumElements())
+    return eigen.MakeError("Cast output must have the shape of the input");
+
+  auto input_t = compat::AsEigenConstTensor(DHTArrayView<SrcT>(&input));
+  auto output_t = compat::AsEigenTensor(MutableDHTArrayView<DstT>(output));
+
+  return internal::EvaluateCast<SrcT, DstT>(eigen, input_t, std::move(output_t),
+                                            rounding,
+                                            eigen.KeepAlive(&input, output));
+}
+
+}  // namespace cpu
+}  // namespace tfrt
+
+#endif  // TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_CAST_KERNEL_H_
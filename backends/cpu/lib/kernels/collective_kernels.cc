@@ -0,0 +1,513 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Collective kernel implementations.
+
+#include "./collective_kernels.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <utility>
+
+#include "./cwise_binary_kernels.h"
+#include "tfrt/host_context/async_dispatch.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/support/ref_count.h"
+#include "tfrt/support/string_util.h"
+#include "unsupported/Eigen/CXX11/Tensor"
+
+namespace tfrt {
+namespace cpu {
+
+//===----------------------------------------------------------------------===//
+// InProcessCollectiveTransport
+//===----------------------------------------------------------------------===//
+
+CollectiveTransport::~CollectiveTransport() = default;
+
+InProcessCollectiveTransport::InProcessCollectiveTransport()
+    : allocator_(CreateMallocAllocator()) {}
+
+InProcessCollectiveTransport::~InProcessCollectiveTransport() = default;
+
+AsyncValueRef<RCReference<HostBuffer>>
+InProcessCollectiveTransport::TakeMessage(const Key& key) {
+  mutex_lock lock(mu_);
+  auto it = messages_.find(key);
+  if (it == messages_.end()) {
+    auto message = MakeUnconstructedAsyncValueRef<RCReference<HostBuffer>>();
+    messages_.emplace(key, message.CopyRef());
+    return message;
+  }
+  auto message = std::move(it->second);
+  messages_.erase(it);
+  return message;
+}
+
+void InProcessCollectiveTransport::Send(int src_rank, int dst_rank,
+                                        const CollectiveMessageId& id,
+                                        const void* data, size_t size) {
+  // The chunk is copied, as the sender may overwrite it before it is received.
+  auto buffer = HostBuffer::CreateUninitialized(
+      size, alignof(std::max_align_t), allocator_.get());
+  auto message = TakeMessage(
+      Key(src_rank, dst_rank, id.instance, id.step, id.chunk));
+  if (!buffer) {
+    message.SetError(absl::ResourceExhaustedError(
+        "failed to allocate a collective chunk"));
+    return;
+  }
+  if (size > 0) std::memcpy(buffer->data(), data, size);
+  message.emplace(std::move(buffer));
+}
+
+AsyncValueRef<RCReference<HostBuffer>> InProcessCollectiveTransport::Recv(
+    int src_rank, int dst_rank, const CollectiveMessageId& id) {
+  return TakeMessage(Key(src_rank, dst_rank, id.instance, id.step, id.chunk));
+}
+
+namespace {
+
+//===----------------------------------------------------------------------===//
+// Reductions
+//===----------------------------------------------------------------------===//
+
+using ReduceFn = void (*)(void* dst, const void* src, size_t num_elements);
+
+// Reduces the elements at `src` into those at `dst`, which need not be
+// aligned.
+template <typename T, typename Reduction>
+void ReduceChunk(void* dst, const void* src, size_t num_elements) {
+  using Functor = typename Reduction::template Functor<T>::Functor;
+  Eigen::TensorMap<Eigen::Tensor<T, 1, Eigen::RowMajor, Eigen::Index>,
+                   Eigen::Unaligned>
+      lhs(static_cast<T*>(dst), num_elements);
+  Eigen::TensorMap<const Eigen::Tensor<T, 1, Eigen::RowMajor, Eigen::Index>,
+                   Eigen::Unaligned>
+      rhs(static_cast<const T*>(src), num_elements);
+  lhs = lhs.binaryExpr(rhs, Functor());
+}
+
+template <typename T>
+ReduceFn GetReduceFn(CollectiveReduction reduction) {
+  switch (reduction) {
+    case CollectiveReduction::kSum:
+      return &ReduceChunk<T, functor::Add>;
+    case CollectiveReduction::kProd:
+      return &ReduceChunk<T, functor::Mul>;
+    case CollectiveReduction::kMin:
+      return &ReduceChunk<T, functor::Min>;
+    case CollectiveReduction::kMax:
+      return &ReduceChunk<T, functor::Max>;
+  }
+  return nullptr;
+}
+
+ReduceFn GetReduceFn(DType dtype, CollectiveReduction reduction) {
+  switch (dtype) {
+    case DType::F32:
+      return GetReduceFn<float>(reduction);
+    case DType::F64:
+      return GetReduceFn<double>(reduction);
+    case DType::I32:
+      return GetReduceFn<int32_t>(reduction);
+    case DType::I64:
+      return GetReduceFn<int64_t>(reduction);
+    default:
+      return nullptr;
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// Schedules
+//===----------------------------------------------------------------------===//
+
+// A transfer of the elements [begin, end) of the tensor to or from a peer.
+struct Transfer {
+  int peer = -1;
+  size_t begin = 0;
+  size_t end = 0;
+
+  bool empty() const { return peer < 0 || begin == end; }
+};
+
+// What a rank does with a chunk in a step of a collective: it sends a part of
+// its tensor, and receives another part that it reduces into its tensor or
+// copies to it.
+struct Step {
+  Transfer send;
+  Transfer recv;
+  bool reduce = false;
+};
+
+using ScheduleFn = std::function<Step(uint32_t step, uint32_t chunk)>;
+
+int Mod(int value, int size) { return ((value % size) + size) % size; }
+
+// The number of steps of the binomial tree algorithms.
+uint32_t GetNumTreeSteps(int size) {
+  uint32_t num_steps = 0;
+  while ((1 << num_steps) < size) ++num_steps;
+  return num_steps;
+}
+
+// Splits `num_elements` into `num_segments` segments, and the segments into
+// chunks of at most `chunk_elements` elements.
+class Segments {
+ public:
+  Segments(size_t num_elements, int num_segments, size_t chunk_elements)
+      : num_elements_(num_elements),
+        num_segments_(num_segments),
+        chunk_elements_(chunk_elements) {}
+
+  // The number of chunks of the largest segment, at least one.
+  uint32_t GetNumChunks() const {
+    const size_t max_segment =
+        (num_elements_ + num_segments_ - 1) / num_segments_;
+    return std::max<size_t>(
+        1, (max_segment + chunk_elements_ - 1) / chunk_elements_);
+  }
+
+  // Sets the range of `transfer` to the elements of `chunk` of `segment`,
+  // which is empty if the segment has fewer chunks.
+  void SetRange(int segment, uint32_t chunk, Transfer* transfer) const {
+    const size_t begin = num_elements_ * segment / num_segments_;
+    const size_t end = num_elements_ * (segment + 1) / num_segments_;
+    transfer->begin = std::min(end, begin + chunk * chunk_elements_);
+    transfer->end = std::min(end, transfer->begin + chunk_elements_);
+  }
+
+ private:
+  const size_t num_elements_;
+  const int num_segments_;
+  const size_t chunk_elements_;
+};
+
+// Reduce-scatter followed by all-gather around the ring of ranks. The tensor
+// is split into one segment per rank. In step i of the reduce-scatter, rank r
+// sends segment r - i to the next rank, and reduces segment r - i - 1 received
+// from the previous rank, so that it holds the reduction of segment r + 1 in
+// the end. The all-gather then passes the reduced segments around the ring.
+ScheduleFn RingAllReduceSchedule(int rank, int size, Segments segments) {
+  return [rank, size, segments](uint32_t step, uint32_t chunk) {
+    Step result;
+    result.send.peer = Mod(rank + 1, size);
+    result.recv.peer = Mod(rank - 1, size);
+    const int i = step;
+    if (i < size - 1) {
+      segments.SetRange(Mod(rank - i, size), chunk, &result.send);
+      segments.SetRange(Mod(rank - i - 1, size), chunk, &result.recv);
+      result.reduce = true;
+    } else {
+      const int j = i - (size - 1);
+      segments.SetRange(Mod(rank + 1 - j, size), chunk, &result.send);
+      segments.SetRange(Mod(rank - j, size), chunk, &result.recv);
+    }
+    return result;
+  };
+}
+
+// Passes the segment of every rank around the ring of ranks.
+ScheduleFn RingAllGatherSchedule(int rank, int size, Segments segments) {
+  return [rank, size, segments](uint32_t step, uint32_t chunk) {
+    Step result;
+    const int i = step;
+    result.send.peer = Mod(rank + 1, size);
+    result.recv.peer = Mod(rank - 1, size);
+    segments.SetRange(Mod(rank - i, size), chunk, &result.send);
+    segments.SetRange(Mod(rank - i - 1, size), chunk, &result.recv);
+    return result;
+  };
+}
+
+// Step `step` of a binomial tree broadcast from `root`: the ranks that have
+// the tensor send it to the rank 2^step ranks after them.
+Step TreeBroadcastStep(int rank, int size, int root, uint32_t step,
+                       uint32_t chunk, const Segments& segments) {
+  Step result;
+  const int relative_rank = Mod(rank - root, size);
+  const int mask = 1 << step;
+  if (relative_rank < mask) {
+    if (relative_rank + mask < size) {
+      result.send.peer = Mod(relative_rank + mask + root, size);
+      segments.SetRange(0, chunk, &result.send);
+    }
+  } else if (relative_rank < 2 * mask) {
+    result.recv.peer = Mod(relative_rank - mask + root, size);
+    segments.SetRange(0, chunk, &result.recv);
+  }
+  return result;
+}
+
+// Step `step` of a binomial tree reduction to rank 0: the ranks that are odd
+// multiples of 2^step send their partial reductions to the rank 2^step ranks
+// before them.
+Step TreeReduceStep(int rank, int size, uint32_t step, uint32_t chunk,
+                    const Segments& segments) {
+  Step result;
+  const int mask = 1 << step;
+  if (rank % (2 * mask) == mask) {
+    result.send.peer = rank - mask;
+    segments.SetRange(0, chunk, &result.send);
+  } else if (rank % (2 * mask) == 0 && rank + mask < size) {
+    result.recv.peer = rank + mask;
+    segments.SetRange(0, chunk, &result.recv);
+    result.reduce = true;
+  }
+  return result;
+}
+
+ScheduleFn TreeAllReduceSchedule(int rank, int size, Segments segments) {
+  const uint32_t num_tree_steps = GetNumTreeSteps(size);
+  return [rank, size, segments, num_tree_steps](uint32_t step,
+                                                uint32_t chunk) {
+    if (step < num_tree_steps)
+      return TreeReduceStep(rank, size, step, chunk, segments);
+    return TreeBroadcastStep(rank, size, /*root=*/0, step - num_tree_steps,
+                             chunk, segments);
+  };
+}
+
+ScheduleFn TreeBroadcastSchedule(int rank, int size, int root,
+                                 Segments segments) {
+  return [rank, size, root, segments](uint32_t step, uint32_t chunk) {
+    return TreeBroadcastStep(rank, size, root, step, chunk, segments);
+  };
+}
+
+//===----------------------------------------------------------------------===//
+// Collective
+//===----------------------------------------------------------------------===//
+
+// A collective in flight. Every chunk goes through the steps of the schedule
+// on its own, and the collective completes when all the chunks have.
+class Collective : public ReferenceCounted<Collective> {
+ public:
+  Collective(const ExecutionContext& exec_ctx,
+             std::shared_ptr<CollectiveTransport> transport, int rank,
+             uint64_t instance, DenseHostTensor tensor, ReduceFn reduce,
+             uint32_t num_steps, uint32_t num_chunks, ScheduleFn schedule)
+      : exec_ctx_(exec_ctx),
+        transport_(std::move(transport)),
+        rank_(rank),
+        instance_(instance),
+        tensor_(std::move(tensor)),
+        data_(static_cast<char*>(tensor_.data())),
+        element_size_(GetHostSize(tensor_.dtype())),
+        reduce_(reduce),
+        num_steps_(num_steps),
+        num_chunks_(num_chunks),
+        schedule_(std::move(schedule)),
+        num_pending_chunks_(num_chunks),
+        done_(MakeUnconstructedAsyncValueRef<Chain>()) {}
+
+  // Starts all the chunks, and returns the chain that is available once the
+  // collective completes.
+  AsyncValueRef<Chain> Start() {
+    auto done = done_.CopyRef();
+    for (uint32_t chunk = 0; chunk < num_chunks_; ++chunk) RunChunk(chunk, 0);
+    return done;
+  }
+
+ private:
+  // Runs the steps of `chunk` from `step` on, until it receives a chunk.
+  void RunChunk(uint32_t chunk, uint32_t step);
+  void CompleteRecv(uint32_t chunk, uint32_t step, const Step& s,
+                    const AsyncValueRef<RCReference<HostBuffer>>& message);
+  void FinishChunk(absl::Status status);
+
+  const ExecutionContext exec_ctx_;
+  const std::shared_ptr<CollectiveTransport> transport_;
+  const int rank_;
+  const uint64_t instance_;
+  DenseHostTensor tensor_;
+  char* const data_;
+  const size_t element_size_;
+  const ReduceFn reduce_;
+  const uint32_t num_steps_;
+  const uint32_t num_chunks_;
+  const ScheduleFn schedule_;
+
+  std::atomic<uint32_t> num_pending_chunks_;
+  mutex mu_;
+  absl::Status status_ TFRT_GUARDED_BY(mu_);
+  AsyncValueRef<Chain> done_;
+};
+
+void Collective::RunChunk(uint32_t chunk, uint32_t step) {
+  for (; step < num_steps_; ++step) {
+    const Step s = schedule_(step, chunk);
+    const CollectiveMessageId id{instance_, step, chunk};
+    if (!s.send.empty()) {
+      transport_->Send(rank_, s.send.peer, id,
+                       data_ + s.send.begin * element_size_,
+                       (s.send.end - s.send.begin) * element_size_);
+    }
+    if (s.recv.empty()) continue;
+
+    auto message = transport_->Recv(s.recv.peer, rank_, id);
+    message.AndThen([self = FormRef(this), chunk, step, s,
+                     message = message.CopyRef()]() mutable {
+      // Reduce on the work queue rather than on the sender's thread.
+      EnqueueWork(self->exec_ctx_, [self = std::move(self), chunk, step, s,
+                                    message = std::move(message)]() {
+        self->CompleteRecv(chunk, step, s, message);
+      });
+    });
+    return;
+  }
+  FinishChunk(absl::OkStatus());
+}
+
+void Collective::CompleteRecv(
+    uint32_t chunk, uint32_t step, const Step& s,
+    const AsyncValueRef<RCReference<HostBuffer>>& message) {
+  if (message.IsError()) {
+    FinishChunk(message.GetError());
+    return;
+  }
+  const HostBuffer& buffer = *message.get();
+  const size_t num_elements = s.recv.end - s.recv.begin;
+  if (buffer.size() != num_elements * element_size_) {
+    FinishChunk(absl::InternalError(
+        StrCat("collective chunk of ", buffer.size(), " bytes instead of ",
+               num_elements * element_size_)));
+    return;
+  }
+  char* dst = data_ + s.recv.begin * element_size_;
+  if (s.reduce) {
+    reduce_(dst, buffer.data(), num_elements);
+  } else {
+    std::memcpy(dst, buffer.data(), buffer.size());
+  }
+  RunChunk(chunk, step + 1);
+}
+
+void Collective::FinishChunk(absl::Status status) {
+  if (!status.ok()) {
+    mutex_lock lock(mu_);
+    if (status_.ok()) status_ = std::move(status);
+  }
+  if (num_pending_chunks_.fetch_sub(1) != 1) return;
+
+  mutex_lock lock(mu_);
+  if (status_.ok()) {
+    done_.emplace();
+  } else {
+    done_.SetError(status_);
+  }
+}
+
+}  // namespace
+
+//===----------------------------------------------------------------------===//
+// HostCommunicator
+//===----------------------------------------------------------------------===//
+
+HostCommunicator::HostCommunicator(
+    int rank, int size, std::shared_ptr<CollectiveTransport> transport,
+    Options options)
+    : rank_(rank),
+      size_(size),
+      transport_(std::move(transport)),
+      options_(options) {
+  assert(size_ > 0 && rank_ >= 0 && rank_ < size_);
+  assert(transport_);
+}
+
+AsyncValueRef<Chain> HostCommunicator::AllReduce(
+    DenseHostTensor tensor, CollectiveReduction reduction,
+    AllReduceAlgorithm algorithm, const ExecutionContext& exec_ctx) {
+  const uint64_t instance = next_instance_++;
+  ReduceFn reduce = GetReduceFn(tensor.dtype(), reduction);
+  if (!reduce)
+    return EmitErrorAsync(
+        exec_ctx, StrCat("unsupported dtype for all-reduce: ", tensor.dtype()));
+
+  const size_t chunk_elements =
+      std::max<size_t>(1, options_.chunk_size / GetHostSize(tensor.dtype()));
+  const size_t num_elements = tensor.NumElements();
+  uint32_t num_steps;
+  uint32_t num_chunks;
+  ScheduleFn schedule;
+  if (algorithm == AllReduceAlgorithm::kRing) {
+    Segments segments(num_elements, size_, chunk_elements);
+    num_steps = 2 * (size_ - 1);
+    num_chunks = segments.GetNumChunks();
+    schedule = RingAllReduceSchedule(rank_, size_, segments);
+  } else {
+    Segments segments(num_elements, /*num_segments=*/1, chunk_elements);
+    num_steps = 2 * GetNumTreeSteps(size_);
+    num_chunks = segments.GetNumChunks();
+    schedule = TreeAllReduceSchedule(rank_, size_, segments);
+  }
+  auto collective = TakeRef(new Collective(
+      exec_ctx, transport_, rank_, instance, std::move(tensor), reduce,
+      num_steps, num_chunks, std::move(schedule)));
+  return collective->Start();
+}
+
+AsyncValueRef<Chain> HostCommunicator::AllGather(
+    DenseHostTensor input, DenseHostTensor output,
+    const ExecutionContext& exec_ctx) {
+  const uint64_t instance = next_instance_++;
+  const size_t num_elements = input.NumElements();
+  if (output.dtype() != input.dtype() ||
+      output.NumElements() != num_elements * size_)
+    return EmitErrorAsync(exec_ctx,
+                          StrCat("all-gather output must be a ", input.dtype(),
+                                 " tensor of ", num_elements * size_,
+                                 " elements"));
+
+  // The segment of this rank is the input.
+  const size_t element_size = GetHostSize(input.dtype());
+  std::memcpy(static_cast<char*>(output.data()) +
+                  num_elements * rank_ * element_size,
+              input.data(), input.DataSizeInBytes());
+
+  const size_t chunk_elements =
+      std::max<size_t>(1, options_.chunk_size / element_size);
+  Segments segments(num_elements * size_, size_, chunk_elements);
+  auto collective = TakeRef(new Collective(
+      exec_ctx, transport_, rank_, instance, std::move(output),
+      /*reduce=*/nullptr, /*num_steps=*/size_ - 1, segments.GetNumChunks(),
+      RingAllGatherSchedule(rank_, size_, segments)));
+  return collective->Start();
+}
+
+AsyncValueRef<Chain> HostCommunicator::Broadcast(
+    DenseHostTensor tensor, int root, const ExecutionContext& exec_ctx) {
+  const uint64_t instance = next_instance_++;
+  if (root < 0 || root >= size_)
+    return EmitErrorAsync(exec_ctx,
+                          StrCat("invalid broadcast root ", root, " of ",
+                                 size_, " ranks"));
+
+  const size_t chunk_elements =
+      std::max<size_t>(1, options_.chunk_size / GetHostSize(tensor.dtype()));
+  Segments segments(tensor.NumElements(), /*num_segments=*/1, chunk_elements);
+  auto collective = TakeRef(new Collective(
+      exec_ctx, transport_, rank_, instance, std::move(tensor),
+      /*reduce=*/nullptr, GetNumTreeSteps(size_), segments.GetNumChunks(),
+      TreeBroadcastSchedule(rank_, size_, root, segments)));
+  return collective->Start();
+}
+
+}  // namespace cpu
+}  // namespace tfrt
@@ -0,0 +1,156 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Collective kernels over DenseHostTensors.
+//
+// The ranks of a group, e.g. one per HostContext, exchange chunks of their
+// tensors through a CollectiveTransport. Every collective splits the tensor
+// into chunks of about `chunk_size` bytes that go through the steps of the
+// algorithm independently, so that the transfer of a chunk overlaps with the
+// reduction of the others. Received chunks are reduced on the work queue with
+// the vectorized cwise functors.
+
+#ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_COLLECTIVE_KERNELS_H_
+#define TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_COLLECTIVE_KERNELS_H_
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <tuple>
+
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_buffer.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+namespace cpu {
+
+// Identifies a chunk sent by a step of a collective.
+struct CollectiveMessageId {
+  // Numbers the collectives of a group, in the order they are issued.
+  uint64_t instance = 0;
+  uint32_t step = 0;
+  uint32_t chunk = 0;
+};
+
+// Delivers chunks between the ranks of a group, e.g. through shared memory
+// within a host or over TCP or RDMA between hosts. Implementations must be
+// thread-safe.
+class CollectiveTransport {
+ public:
+  virtual ~CollectiveTransport();
+
+  // Sends the `size` bytes at `data`, which may be reused once Send returns.
+  virtual void Send(int src_rank, int dst_rank, const CollectiveMessageId& id,
+                    const void* data, size_t size) = 0;
+
+  // Returns the chunk sent with `id` from `src_rank` to `dst_rank`, which may
+  // be received before it is sent.
+  virtual AsyncValueRef<RCReference<HostBuffer>> Recv(
+      int src_rank, int dst_rank, const CollectiveMessageId& id) = 0;
+};
+
+// A CollectiveTransport between the ranks of one process, e.g. one per
+// HostContext, which passes the chunks through memory.
+class InProcessCollectiveTransport : public CollectiveTransport {
+ public:
+  InProcessCollectiveTransport();
+  ~InProcessCollectiveTransport() override;
+
+  void Send(int src_rank, int dst_rank, const CollectiveMessageId& id,
+            const void* data, size_t size) override;
+  AsyncValueRef<RCReference<HostBuffer>> Recv(
+      int src_rank, int dst_rank, const CollectiveMessageId& id) override;
+
+ private:
+  using Key = std::tuple<int, int, uint64_t, uint32_t, uint32_t>;
+
+  AsyncValueRef<RCReference<HostBuffer>> TakeMessage(const Key& key);
+
+  std::unique_ptr<HostAllocator> allocator_;
+  mutex mu_;
+  // The chunks sent but not received yet, and those received but not sent.
+  std::map<Key, AsyncValueRef<RCReference<HostBuffer>>> messages_
+      TFRT_GUARDED_BY(mu_);
+};
+
+enum class CollectiveReduction { kSum, kProd, kMin, kMax };
+
+enum class AllReduceAlgorithm {
+  // Reduce-scatter and all-gather around a ring, which sends about twice the
+  // size of the tensor per rank. Best for large tensors.
+  kRing,
+  // Reduce to rank 0 and broadcast back along binomial trees, which takes a
+  // logarithmic number of steps. Best for small tensors and large groups.
+  kTree,
+};
+
+// A rank of a group of `size` ranks. All the ranks of a group must issue the
+// same collectives in the same order.
+class HostCommunicator {
+ public:
+  struct Options {
+    // The size of the chunks the tensors are split into.
+    size_t chunk_size = 256 * 1024;
+  };
+
+  HostCommunicator(int rank, int size,
+                   std::shared_ptr<CollectiveTransport> transport,
+                   Options options);
+  HostCommunicator(int rank, int size,
+                   std::shared_ptr<CollectiveTransport> transport)
+      : HostCommunicator(rank, size, std::move(transport), Options()) {}
+
+  int rank() const { return rank_; }
+  int size() const { return size_; }
+
+  // Reduces `tensor`, a float, double, int32 or int64 tensor of the same shape
+  // on every rank, in place. The returned chain is available once `tensor`
+  // holds the reduction.
+  AsyncValueRef<Chain> AllReduce(DenseHostTensor tensor,
+                                 CollectiveReduction reduction,
+                                 AllReduceAlgorithm algorithm,
+                                 const ExecutionContext& exec_ctx);
+
+  // Writes the `input` tensors of all ranks, in rank order, to `output`, which
+  // has `size` times the elements of `input`, e.g. the input shape with the
+  // first dimension multiplied by `size`.
+  AsyncValueRef<Chain> AllGather(DenseHostTensor input, DenseHostTensor output,
+                                 const ExecutionContext& exec_ctx);
+
+  // Copies `tensor` of rank `root` to `tensor` of the other ranks, along a
+  // binomial tree.
+  AsyncValueRef<Chain> Broadcast(DenseHostTensor tensor, int root,
+                                 const ExecutionContext& exec_ctx);
+
+ private:
+  const int rank_;
+  const int size_;
+  const std::shared_ptr<CollectiveTransport> transport_;
+  const Options options_;
+  std::atomic<uint64_t> next_instance_{0};
+};
+
+}  // namespace cpu
+}  // namespace tfrt
+
+#endif  // TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_COLLECTIVE_KERNELS_H_
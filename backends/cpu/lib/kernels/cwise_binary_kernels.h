@@ -19,6 +19,8 @@
 #ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_CWISE_BINARY_KERNELS_H_
 #define TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_CWISE_BINARY_KERNELS_H_
 
+#include <algorithm>
+
 #include "tfrt/common/compat/eigen/eigen_evaluator.h"
 #include "tfrt/common/compat/eigen/eigen_kernel.h"
 #include "tfrt/common/compat/eigen/tensor_types.h"
@@ -40,6 +42,9 @@ struct BindRightScalar;
 template <typename T, typename R, typename Functor>
 struct BindLeftScalar;
 
+template <typename T>
+struct ScalarReluGradOp;
+
 }  // namespace functor
 }  // namespace cpu
 }  // namespace tfrt
@@ -64,6 +69,14 @@ struct functor_traits<tfrt::cpu::functor::BindLeftScalar<T, R, Functor>> {
   };
 };
 
+template <typename T>
+struct functor_traits<tfrt::cpu::functor::ScalarReluGradOp<T>> {
+  enum {
+    Cost = NumTraits<T>::AddCost,
+    PacketAccess = packet_traits<T>::HasCmp,
+  };
+};
+
 }  // namespace internal
 }  // namespace Eigen
 
@@ -98,12 +111,49 @@ struct Mul {
   using Functor = BinaryFunctor<T, Eigen::internal::scalar_product_op<T>>;
 };
 
+struct Min {
+  template <typename T>
+  using Functor = BinaryFunctor<T, Eigen::internal::scalar_min_op<T, T>>;
+};
+
+struct Max {
+  template <typename T>
+  using Functor = BinaryFunctor<T, Eigen::internal::scalar_max_op<T, T>>;
+};
+
 struct Less {
   template <typename T>
   using Functor = BinaryFunctor<
       T, Eigen::internal::scalar_cmp_op<T, T, Eigen::internal::cmp_LT>, bool>;
 };
 
+struct Equal {
+  template <typename T>
+  using Functor = BinaryFunctor<
+      T, Eigen::internal::scalar_cmp_op<T, T, Eigen::internal::cmp_EQ>, bool>;
+};
+
+// Computes the gradients of Relu: `gradients` where `features` are positive,
+// and zero elsewhere.
+template <typename T>
+struct ScalarReluGradOp {
+  T operator()(const T& gradients, const T& features) const {
+    return features > T(0) ? gradients : T(0);
+  }
+
+  template <typename Packet>
+  Packet packetOp(const Packet& gradients, const Packet& features) const {
+    const Packet zero = Eigen::internal::pzero(features);
+    return Eigen::internal::pselect(Eigen::internal::pcmp_lt(zero, features),
+                                    gradients, zero);
+  }
+};
+
+struct ReluGrad {
+  template <typename T>
+  using Functor = BinaryFunctor<T, ScalarReluGradOp<T>>;
+};
+
 // Bind scalar value on the right side of the binary expression to the binary
 // functor and get back a unary functor:
 //
@@ -192,17 +242,10 @@ struct BinaryKernelImpl {
     auto* rhs_tensor = cast<DenseHostTensor>(&rhs);
     auto* out_tensor = cast<DenseHostTensor>(output);
 
-    auto rhs_t = compat::AsEigenConstTensor(DHTArrayView<Input>(rhs_tensor));
-    auto out_t = compat::AsEigenTensor(MutableDHTArrayView<Output>(out_tensor));
-
-    // Bind scalar value to the right side of the binary functor.
+    // Bind scalar value to the left side of the binary functor.
     using BindLeft = functor::BindLeftScalar<Input, Output, Functor>;
-    auto expr = rhs_t.unaryExpr(BindLeft(lhs_scalar->GetValue()));
-
-    eigen.Evaluate(
-        out_t, std::move(expr),
-        [buffers = eigen.KeepAlive(rhs_tensor, out_tensor),
-         on_done = std::move(on_done)]() { on_done(Error::success()); });
+    TensorBoundScalar(*rhs_tensor, BindLeft(lhs_scalar->GetValue()),
+                      out_tensor, std::move(on_done));
   }
 
   template <typename OnDone>
@@ -212,17 +255,67 @@ struct BinaryKernelImpl {
     auto* rhs_scalar = cast<ScalarHostTensor<Input>>(&rhs);
     auto* out_tensor = cast<DenseHostTensor>(output);
 
-    auto lhs_t = compat::AsEigenConstTensor(DHTArrayView<Input>(lhs_tensor));
-    auto out_t = compat::AsEigenTensor(MutableDHTArrayView<Output>(out_tensor));
-
     // Bind scalar value to the right side of the binary functor.
     using BindRight = functor::BindRightScalar<Input, Output, Functor>;
-    auto expr = lhs_t.unaryExpr(BindRight(rhs_scalar->GetValue()));
+    TensorBoundScalar(*lhs_tensor, BindRight(rhs_scalar->GetValue()),
+                      out_tensor, std::move(on_done));
+  }
 
-    eigen.Evaluate(
-        out_t, std::move(expr),
-        [buffers = eigen.KeepAlive(lhs_tensor, out_tensor),
-         on_done = std::move(on_done)]() { on_done(Error::success()); });
+  // Evaluates the binary functor with a bound scalar argument, `bound`, over
+  // the `tensor` argument. The scalar argument is never materialized, but it
+  // may have more elements than `tensor` (e.g. [3, 1] and [1, 4]), and then
+  // `tensor` is broadcast to the output shape.
+  template <typename BoundFunctor, typename OnDone>
+  void TensorBoundScalar(const DenseHostTensor& tensor, BoundFunctor bound,
+                         DenseHostTensor* out_tensor, OnDone on_done) {
+    auto arr_view = DHTArrayView<Input>(&tensor);
+
+    auto done_callback = [&]() {
+      return [buffers = eigen.KeepAlive(&tensor, out_tensor),
+              on_done = std::move(on_done)]() { on_done(Error::success()); };
+    };
+
+    if (tensor.shape() == out_tensor->shape()) {
+      auto tensor_t = compat::AsEigenConstTensor(arr_view);
+      auto out_t =
+          compat::AsEigenTensor(MutableDHTArrayView<Output>(out_tensor));
+      eigen.Evaluate(out_t, tensor_t.unaryExpr(bound), done_callback());
+      return;
+    }
+
+    auto bcast = GetArgumentBCast(tensor.shape(), out_tensor->shape());
+    if (auto err = bcast.takeError()) {
+      on_done(std::move(err));
+      return;
+    }
+
+    auto dispatch = [&](auto rank_dispatch) -> void {
+      constexpr int rank = decltype(rank_dispatch)::value;
+
+      FixedRankShape<rank> shape(TensorShape(bcast->reshape()));
+      auto tensor_t = compat::AsEigenConstTensor(arr_view, shape);
+      auto out_t = compat::AsEigenTensor(
+          MutableDHTIndexableView<Output, rank>(out_tensor));
+
+      auto expr = tensor_t.broadcast(bcast->broadcast()).unaryExpr(bound);
+      eigen.Evaluate(out_t, std::move(expr), done_callback());
+    };
+
+    const int rank = bcast->rank();
+    if (rank == 1) {
+      dispatch(Rank<1>{});
+    } else if (rank == 2) {
+      dispatch(Rank<2>{});
+    } else if (rank == 3) {
+      dispatch(Rank<3>{});
+    } else if (rank == 4) {
+      dispatch(Rank<4>{});
+    } else if (rank == 5) {
+      dispatch(Rank<5>{});
+    } else {
+      on_done(MakeStringError("Unsupported binary kernel broadcasting: arg=",
+                              tensor.shape(), " out=", out_tensor->shape()));
+    }
   }
 
   template <typename OnDone>
@@ -283,6 +376,13 @@ struct BinaryKernelImpl {
       return;
     }
 
+    // Common broadcasts (e.g. BiasAdd) have specialized kernels.
+    if (auto fast_path = GetBinaryBCastFastPath(*lhs_bcast, *rhs_bcast)) {
+      TensorTensorFastBcast(lhs_tensor, rhs_tensor, out_tensor, *fast_path,
+                            std::move(on_done));
+      return;
+    }
+
     const int rank = lhs_bcast->rank();
     assert(lhs_bcast->rank() == rhs_bcast->rank());
 
@@ -330,6 +430,100 @@ struct BinaryKernelImpl {
     }
   }
 
+  template <typename OnDone>
+  void TensorTensorFastBcast(const DenseHostTensor& lhs_tensor,
+                             const DenseHostTensor& rhs_tensor,
+                             DenseHostTensor* out_tensor,
+                             const BinaryBCastFastPath& fast_path,
+                             OnDone on_done) {
+    using Pattern = BinaryBCastFastPath::Pattern;
+    using BlockFn = void (*)(const Input* full, const Input* bcast,
+                             Output* out, Index middle, Index inner,
+                             Index begin, Index end);
+
+    auto select = [&](auto pattern) -> BlockFn {
+      constexpr Pattern p = decltype(pattern)::value;
+      return fast_path.broadcast_lhs ? &FastBcastBlock<p, true>
+                                     : &FastBcastBlock<p, false>;
+    };
+
+    BlockFn block_fn = nullptr;
+    switch (fast_path.pattern) {
+      case Pattern::kRow:
+        block_fn = select(std::integral_constant<Pattern, Pattern::kRow>{});
+        break;
+      case Pattern::kColumn:
+        block_fn = select(std::integral_constant<Pattern, Pattern::kColumn>{});
+        break;
+      case Pattern::kMiddle:
+        block_fn = select(std::integral_constant<Pattern, Pattern::kMiddle>{});
+        break;
+    }
+
+    const Input* lhs = DHTArrayView<Input>(&lhs_tensor).data();
+    const Input* rhs = DHTArrayView<Input>(&rhs_tensor).data();
+    const Input* full = fast_path.broadcast_lhs ? rhs : lhs;
+    const Input* bcast = fast_path.broadcast_lhs ? lhs : rhs;
+    Output* out = MutableDHTArrayView<Output>(out_tensor).data();
+    const Index middle = fast_path.middle;
+    const Index inner = fast_path.inner;
+
+    Eigen::TensorOpCost cost(2 * sizeof(Input), sizeof(Output),
+                             Eigen::internal::functor_traits<Functor>::Cost);
+
+    eigen.ParallelFor(
+        out_tensor->NumElements(), cost,
+        [=](Eigen::Index begin, Eigen::Index end) {
+          block_fn(full, bcast, out, middle, inner, begin, end);
+        },
+        [buffers = eigen.KeepAlive(&lhs_tensor, &rhs_tensor, out_tensor),
+         on_done = std::move(on_done)]() { on_done(Error::success()); });
+  }
+
+  // Computes the output elements [begin, end) of a specialized broadcast. The
+  // output is processed in contiguous segments that either share one element
+  // of the broadcast argument (kColumn), or match a contiguous row of it.
+  template <BinaryBCastFastPath::Pattern pattern, bool broadcast_lhs>
+  static void FastBcastBlock(const Input* full, const Input* bcast,
+                             Output* out, Index middle, Index inner,
+                             Index begin, Index end) {
+    using Pattern = BinaryBCastFastPath::Pattern;
+    using InputMap = Eigen::Map<const Eigen::Array<Input, Eigen::Dynamic, 1>>;
+    using OutputMap = Eigen::Map<Eigen::Array<Output, Eigen::Dynamic, 1>>;
+
+    for (Index e = begin; e < end;) {
+      if (pattern == Pattern::kColumn) {
+        Index n = std::min(middle - e % middle, end - e);
+        const Input& value = bcast[e / middle];
+        InputMap full_segment(full + e, n);
+        OutputMap out_segment(out + e, n);
+        if (broadcast_lhs) {
+          using BindLeft = functor::BindLeftScalar<Input, Output, Functor>;
+          out_segment = full_segment.unaryExpr(BindLeft(value));
+        } else {
+          using BindRight = functor::BindRightScalar<Input, Output, Functor>;
+          out_segment = full_segment.unaryExpr(BindRight(value));
+        }
+        e += n;
+      } else {
+        Index i = e % inner;
+        Index n = std::min(inner - i, end - e);
+        const Input* row = pattern == Pattern::kRow
+                               ? bcast + i
+                               : bcast + e / (middle * inner) * inner + i;
+        InputMap full_segment(full + e, n);
+        InputMap bcast_segment(row, n);
+        OutputMap out_segment(out + e, n);
+        if (broadcast_lhs) {
+          out_segment = bcast_segment.binaryExpr(full_segment, Functor());
+        } else {
+          out_segment = full_segment.binaryExpr(bcast_segment, Functor());
+        }
+        e += n;
+      }
+    }
+  }
+
   // Helper struct to pass compile time constant to lambda as a value argument.
   template <int rank>
   struct Rank {
@@ -0,0 +1,353 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Fused element-wise kernel.
+//
+// Evaluates a chain of element-wise operations in a single pass over memory.
+// The output is processed in tiles that stay in L1 cache while every operation
+// of the chain is applied to them, so the input and each fusion input are read
+// once and the output is written once, regardless of the length of the chain.
+
+#ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_FUSED_ELEMENTWISE_KERNEL_H_
+#define TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_FUSED_ELEMENTWISE_KERNEL_H_
+
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+
+#include "./cwise_binary_kernels.h"
+#include "llvm/ADT/SmallVector.h"
+#include "tfrt/common/compat/eigen/eigen_kernel.h"
+#include "tfrt/host_context/attribute_utils.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/parallel_for.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+
+namespace tfrt {
+namespace cpu {
+namespace functor {
+
+template <typename T>
+struct ReluOp {
+  T operator()(const T& x) const { return Eigen::numext::maxi(x, T(0)); }
+
+  template <typename Packet>
+  Packet packetOp(const Packet& x) const {
+    return Eigen::internal::pmax(x, Eigen::internal::pset1<Packet>(T(0)));
+  }
+};
+
+template <typename T>
+struct Relu6Op {
+  T operator()(const T& x) const {
+    return Eigen::numext::mini(Eigen::numext::maxi(x, T(0)), T(6));
+  }
+
+  template <typename Packet>
+  Packet packetOp(const Packet& x) const {
+    return Eigen::internal::pmin(
+        Eigen::internal::pmax(x, Eigen::internal::pset1<Packet>(T(0))),
+        Eigen::internal::pset1<Packet>(T(6)));
+  }
+};
+
+}  // namespace functor
+}  // namespace cpu
+}  // namespace tfrt
+
+namespace Eigen {
+namespace internal {
+
+template <typename T>
+struct functor_traits<tfrt::cpu::functor::ReluOp<T>> {
+  enum {
+    Cost = NumTraits<T>::AddCost,
+    PacketAccess = packet_traits<T>::HasMax,
+  };
+};
+
+template <typename T>
+struct functor_traits<tfrt::cpu::functor::Relu6Op<T>> {
+  enum {
+    Cost = 2 * NumTraits<T>::AddCost,
+    PacketAccess = packet_traits<T>::HasMax && packet_traits<T>::HasMin,
+  };
+};
+
+}  // namespace internal
+}  // namespace Eigen
+
+namespace tfrt {
+namespace cpu {
+
+// The number of bytes of the output processed by all steps of the chain before
+// moving on to the next tile. Small enough for the tile and the matching
+// fusion input tiles to stay in L1 cache.
+constexpr Index kFusedElementwiseTileBytes = 8 * 1024;
+
+// One operation of a fused element-wise chain. A step updates a tile of the
+// output in place: `tile` points to `size` elements starting at element
+// `offset` of the output.
+template <typename T>
+struct FusedElementwiseStep {
+  using ApplyFn = void (*)(const FusedElementwiseStep& step, T* tile,
+                           Index offset, Index size);
+
+  ApplyFn apply;
+  // The fusion input of a binary step, or nullptr for a unary step.
+  const T* operand = nullptr;
+  // The number of elements of `operand`.
+  Index operand_size = 0;
+  // The value of a single element fusion input.
+  T scalar = T(0);
+};
+
+namespace internal {
+
+template <typename T>
+using TileMap = Eigen::Map<Eigen::Array<T, Eigen::Dynamic, 1>>;
+template <typename T>
+using ConstTileMap = Eigen::Map<const Eigen::Array<T, Eigen::Dynamic, 1>>;
+
+template <typename T, typename Functor>
+void ApplyUnaryStep(const FusedElementwiseStep<T>& step, T* tile, Index offset,
+                    Index size) {
+  TileMap<T> t(tile, size);
+  t = t.unaryExpr(Functor());
+}
+
+// The fusion input has a single element, which is bound to the right side of
+// the binary functor.
+template <typename T, typename Functor>
+void ApplyScalarStep(const FusedElementwiseStep<T>& step, T* tile, Index offset,
+                     Index size) {
+  using BindRight = functor::BindRightScalar<T, T, Functor>;
+  TileMap<T> t(tile, size);
+  t = t.unaryExpr(BindRight(step.scalar));
+}
+
+// The fusion input has the shape of the output.
+template <typename T, typename Functor>
+void ApplyTensorStep(const FusedElementwiseStep<T>& step, T* tile, Index offset,
+                     Index size) {
+  TileMap<T> t(tile, size);
+  t = t.binaryExpr(ConstTileMap<T>(step.operand + offset, size), Functor());
+}
+
+// The fusion input is a vector broadcast along the innermost dimension of the
+// output, e.g. the bias of BiasAdd.
+template <typename T, typename Functor>
+void ApplyInnerBroadcastStep(const FusedElementwiseStep<T>& step, T* tile,
+                             Index offset, Index size) {
+  const Index inner_size = step.operand_size;
+  Index pos = offset % inner_size;
+  for (Index i = 0; i < size; pos = 0) {
+    Index n = std::min(inner_size - pos, size - i);
+    TileMap<T> t(tile + i, n);
+    t = t.binaryExpr(ConstTileMap<T>(step.operand + pos, n), Functor());
+    i += n;
+  }
+}
+
+// Picks the inner loop for a binary step from the shape of its fusion input.
+template <typename T, typename Functor>
+Expected<FusedElementwiseStep<T>> MakeBinaryStep(
+    string_view op, const DenseHostTensor& operand,
+    const TensorShape& output_shape, bool inner_broadcast_only = false) {
+  FusedElementwiseStep<T> step;
+  step.operand = DHTArrayView<T>(&operand).data();
+  step.operand_size = operand.NumElements();
+
+  const int rank = output_shape.GetRank();
+  const Index inner_size =
+      rank == 0 ? 1 : output_shape.GetDimensionSize(rank - 1);
+  const bool is_inner_vector = operand.shape().GetRank() == 1 &&
+                               operand.NumElements() == inner_size;
+
+  if (inner_broadcast_only) {
+    if (!is_inner_vector)
+      return MakeStringError(op, " fusion input shape ", operand.shape(),
+                             " must be a vector matching the innermost "
+                             "dimension of ",
+                             output_shape);
+    step.apply = ApplyInnerBroadcastStep<T, Functor>;
+  } else if (operand.NumElements() == 1) {
+    step.scalar = *step.operand;
+    step.apply = ApplyScalarStep<T, Functor>;
+  } else if (operand.shape() == output_shape) {
+    step.apply = ApplyTensorStep<T, Functor>;
+  } else if (is_inner_vector) {
+    step.apply = ApplyInnerBroadcastStep<T, Functor>;
+  } else {
+    return MakeStringError("Unsupported ", op, " fusion input shape ",
+                           operand.shape(), " for output shape ",
+                           output_shape);
+  }
+  return step;
+}
+
+}  // namespace internal
+
+// Decodes `fused_ops` into a chain of steps. Every op is applied
+// to the result of the previous one (the first op to `input`), and binary ops
+// take their right hand side from the next fusion input.
+//
+// Supported ops:
+//   unary:  Relu, Relu6, Log, Log1p, Rsqrt, Sigmoid, Tanh
+//   binary: AddV2, Sub, Mul, RealDiv, BiasAdd
+//
+// A binary fusion input must hold a single element, have the shape of the
+// output, or be a vector broadcast along the innermost output dimension.
+template <typename T, typename FusionInputsRange>
+Expected<llvm::SmallVector<FusedElementwiseStep<T>, 4>>
+ParseFusedElementwiseSteps(ArrayRef<string_view> fused_ops,
+                           FusionInputsRange fusion_inputs,
+                           const TensorShape& output_shape) {
+  namespace ei = Eigen::internal;
+
+  llvm::SmallVector<FusedElementwiseStep<T>, 4> steps;
+  int num_fusion_inputs = fusion_inputs.size();
+  int next_fusion_input = 0;
+
+  auto unary = [&](auto functor) {
+    FusedElementwiseStep<T> step;
+    step.apply = internal::ApplyUnaryStep<T, decltype(functor)>;
+    steps.push_back(step);
+    return Error::success();
+  };
+
+  auto binary = [&](string_view op, auto functor,
+                    bool inner_broadcast_only = false) -> Error {
+    if (next_fusion_input == num_fusion_inputs)
+      return MakeStringError("Missing fusion input for ", op);
+    auto step = internal::MakeBinaryStep<T, decltype(functor)>(
+        op, fusion_inputs[next_fusion_input++], output_shape,
+        inner_broadcast_only);
+    if (!step) return step.takeError();
+    steps.push_back(*step);
+    return Error::success();
+  };
+
+  for (string_view op : fused_ops) {
+    Error error = Error::success();
+    if (op == "Relu") {
+      error = unary(functor::ReluOp<T>());
+    } else if (op == "Relu6") {
+      error = unary(functor::Relu6Op<T>());
+    } else if (op == "Log") {
+      error = unary(ei::scalar_log_op<T>());
+    } else if (op == "Log1p") {
+      error = unary(ei::scalar_log1p_op<T>());
+    } else if (op == "Rsqrt") {
+      error = unary(ei::scalar_rsqrt_op<T>());
+    } else if (op == "Sigmoid") {
+      error = unary(ei::scalar_logistic_op<T>());
+    } else if (op == "Tanh") {
+      error = unary(ei::scalar_tanh_op<T>());
+    } else if (op == "AddV2") {
+      error = binary(op, ei::scalar_sum_op<T>());
+    } else if (op == "Sub") {
+      error = binary(op, ei::scalar_difference_op<T>());
+    } else if (op == "Mul") {
+      error = binary(op, ei::scalar_product_op<T>());
+    } else if (op == "RealDiv") {
+      error = binary(op, ei::scalar_quotient_op<T>());
+    } else if (op == "BiasAdd") {
+      error = binary(op, ei::scalar_sum_op<T>(), /*inner_broadcast_only=*/true);
+    } else {
+      error = MakeStringError("Unsupported fused element-wise op: ", op);
+    }
+    if (error) return std::move(error);
+  }
+
+  if (steps.empty())
+    return MakeStringError("FusedElementwise must specify fused operations");
+  if (next_fusion_input != num_fusion_inputs)
+    return MakeStringError("FusedElementwise got ", num_fusion_inputs,
+                           " fusion inputs, but the fused ops use ",
+                           next_fusion_input);
+  return std::move(steps);
+}
+
+// Applies `steps` to the elements [begin, end) of `input` and writes them to
+// `output`. `input` and `output` may be the same buffer.
+template <typename T>
+void RunFusedElementwiseSteps(ArrayRef<FusedElementwiseStep<T>> steps,
+                              const T* input, T* output, Index begin,
+                              Index end) {
+  constexpr Index kTileSize = kFusedElementwiseTileBytes / sizeof(T);
+  for (Index offset = begin; offset < end; offset += kTileSize) {
+    Index size = std::min(kTileSize, end - offset);
+    T* tile = output + offset;
+    if (tile != input + offset) std::copy_n(input + offset, size, tile);
+    for (const auto& step : steps) step.apply(step, tile, offset, size);
+  }
+}
+
+// Computes `output` = fused_ops(`input`, `fusion_inputs`...) in parallel
+// blocks of whole tiles. `on_done` is called with the error if the fusion is
+// invalid, or with success when the output is computed.
+template <typename T, typename FusionInputsRange, typename OnDone>
+void FusedElementwise(const DenseHostTensor& input,
+                      FusionInputsRange fusion_inputs,
+                      AggregateAttr fused_ops_attr, DenseHostTensor* output,
+                      const ExecutionContext& exec_ctx, OnDone on_done) {
+  static_assert(std::is_same<std::decay_t<decltype(fusion_inputs[0])>,
+                             DenseHostTensor>::value,
+                "fusion_inputs must be a range of DenseHostTensor");
+
+  // Parse the fusion config.
+  llvm::SmallVector<string_view, 4> fused_ops(fused_ops_attr.GetNumElements());
+  for (int i = 0; i < fused_ops_attr.GetNumElements(); ++i) {
+    fused_ops[i] = fused_ops_attr.GetAttribute(i).cast<StringAttr>().GetValue();
+  }
+
+  auto steps = ParseFusedElementwiseSteps<T>(fused_ops, fusion_inputs,
+                                             output->shape());
+  if (!steps) {
+    on_done(steps.takeError());
+    return;
+  }
+
+  // Keep the inputs alive until all parallel blocks are done.
+  llvm::SmallVector<DenseHostTensor, 4> buffers;
+  buffers.push_back(input.CopyRef());
+  for (int i = 0; i < fusion_inputs.size(); ++i)
+    buffers.push_back(fusion_inputs[i].CopyRef());
+
+  const T* input_data = DHTArrayView<T>(&input).data();
+  T* output_data = MutableDHTArrayView<T>(output).data();
+
+  constexpr Index kTileSize = kFusedElementwiseTileBytes / sizeof(T);
+  ParallelFor(exec_ctx).Execute(
+      output->NumElements(), ParallelFor::BlockSizes::Min(kTileSize),
+      [steps = std::move(*steps), input_data, output_data](size_t begin,
+                                                           size_t end) {
+        RunFusedElementwiseSteps<T>(steps, input_data, output_data, begin,
+                                    end);
+      },
+      [buffers = std::move(buffers), on_done = std::move(on_done)]() mutable {
+        on_done(Error::success());
+      });
+}
+
+}  // namespace cpu
+}  // namespace tfrt
+
+#endif  // TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_FUSED_ELEMENTWISE_KERNEL_H_
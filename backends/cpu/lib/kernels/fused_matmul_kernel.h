@@ -19,7 +19,12 @@
 #ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_FUSED_MATMUL_KERNEL_H_
 #define TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_FUSED_MATMUL_KERNEL_H_
 
+#include <memory>
+#include <type_traits>
+#include <vector>
+
 #include "./matmul_kernel.h"
+#include "./packed_matmul_kernel.h"
 #include "tfrt/common/compat/eigen/contraction_output_kernel.h"
 #include "tfrt/common/compat/eigen/eigen_dtype.h"
 #include "tfrt/common/compat/eigen/eigen_evaluator.h"
@@ -33,24 +38,152 @@ namespace tfrt {
 namespace cpu {
 namespace {
 
-template <typename OutputKernel, typename T, typename EigenEvaluator>
+// Output kernel for the float accumulators of a 16-bit floating point MatMul
+// that adds bias. It owns a float copy of the bias, because Eigen copies the
+// output kernel into the contraction evaluator, which outlives this function
+// when evaluated asynchronously.
+template <typename OutputKernel>
+class FloatBiasOutputKernel {
+  using Vec = std::vector<float, Eigen::aligned_allocator<float>>;
+
+ public:
+  template <typename T, typename... Args>
+  explicit FloatBiasOutputKernel(const DHTArrayView<T>& bias, Args... args)
+      : bias_(std::make_shared<Vec>(bias.begin(), bias.end())),
+        output_kernel_(compat::EigenConstTensor<float, 1>(
+                           bias_->data(), static_cast<Index>(bias_->size())),
+                       args...) {}
+
+  EIGEN_ALWAYS_INLINE void operator()(
+      const compat::internal::ContractionOutputMapper<float>& output_mapper,
+      const Eigen::TensorContractionParams& params, Index i, Index j,
+      Index num_rows, Index num_cols) const {
+    output_kernel_(output_mapper, params, i, j, num_rows, num_cols);
+  }
+
+ private:
+  std::shared_ptr<const Vec> bias_;
+  OutputKernel output_kernel_;
+};
+
+template <typename T, typename Activation>
+compat::BiasAddOutputKernel<T, Activation> MakeBiasAddOutputKernel(
+    const DHTArrayView<T>& bias, Activation activation,
+    std::false_type /*accumulate_in_float*/) {
+  return compat::BiasAddOutputKernel<T, Activation>(
+      compat::AsEigenConstTensor(bias), activation);
+}
+
+template <typename T, typename Activation>
+FloatBiasOutputKernel<compat::BiasAddOutputKernel<float, Activation>>
+MakeBiasAddOutputKernel(const DHTArrayView<T>& bias, Activation activation,
+                        std::true_type /*accumulate_in_float*/) {
+  return FloatBiasOutputKernel<compat::BiasAddOutputKernel<float, Activation>>(
+      bias, activation);
+}
+
+template <typename T, typename Activation>
+compat::BiasAddResidualOutputKernel<T, Activation>
+MakeBiasAddResidualOutputKernel(const DHTArrayView<T>& bias,
+                                const DHTIndexableView<T, 2>& residual,
+                                Activation activation,
+                                std::false_type /*accumulate_in_float*/) {
+  return compat::BiasAddResidualOutputKernel<T, Activation>(
+      compat::AsEigenConstTensor(bias), compat::AsEigenConstTensor(residual),
+      activation);
+}
+
+// The residual is read as is and converted to float in the output kernel: it
+// is as large as the output, and is kept alive by the caller like the inputs.
+template <typename T, typename Activation>
+FloatBiasOutputKernel<compat::BiasAddResidualOutputKernel<float, Activation, T>>
+MakeBiasAddResidualOutputKernel(const DHTArrayView<T>& bias,
+                                const DHTIndexableView<T, 2>& residual,
+                                Activation activation,
+                                std::true_type /*accumulate_in_float*/) {
+  return FloatBiasOutputKernel<
+      compat::BiasAddResidualOutputKernel<float, Activation, T>>(
+      bias, compat::AsEigenConstTensor(residual), activation);
+}
+
+// Computes the MatMul with BiasAdd, the optional residual Add, and
+// `activation` fused into its output kernel.
+template <typename T, typename Activation, typename EigenEvaluator>
 typename EigenEvaluator::DependencyToken FusedMatMulInternal(
     const DenseHostTensor& a, const DenseHostTensor& b, DenseHostTensor* output,
-    const DenseHostTensor& fusion_input, bool transpose_a, bool transpose_b,
-    EigenEvaluator eigen) {
-  DHTArrayView<T> bias_view(&fusion_input);
-  OutputKernel output_kernel(compat::AsEigenConstTensor(bias_view));
+    const DenseHostTensor& bias, const DenseHostTensor* residual,
+    bool transpose_a, bool transpose_b, Activation activation,
+    const ExecutionContext& exec_ctx, EigenEvaluator eigen) {
+  DHTArrayView<T> bias_view(&bias);
+
+  if (auto packed = GetPackedMatMulWeights<T>(exec_ctx, a, b, transpose_a,
+                                              transpose_b)) {
+    if (residual != nullptr) {
+      BiasAddResidualPackedEpilogue<T, Activation> epilogue(
+          bias_view.data(), DHTArrayView<T>(residual).data(),
+          output->shape().GetDimensionSize(1), activation);
+      return PackedMatMul<T>(a, std::move(packed), output, transpose_a,
+                             epilogue, eigen);
+    }
+    BiasAddPackedEpilogue<T, Activation> epilogue(bias_view.data(),
+                                                  activation);
+    return PackedMatMul<T>(a, std::move(packed), output, transpose_a,
+                           epilogue, eigen);
+  }
+
+  using Acc = compat::AccumulatorType<T>;
+  using AccumulateInFloat =
+      std::integral_constant<bool, !std::is_same<Acc, T>::value>;
+  if (residual != nullptr) {
+    auto output_kernel = MakeBiasAddResidualOutputKernel<T>(
+        bias_view, DHTIndexableView<T, 2>(residual), activation,
+        AccumulateInFloat());
+    return cpu::MatMul<T>(1.0, a, b, 0.0, output, transpose_a, transpose_b,
+                          std::move(output_kernel), eigen);
+  }
+  auto output_kernel =
+      MakeBiasAddOutputKernel<T>(bias_view, activation, AccumulateInFloat());
   return cpu::MatMul<T>(1.0, a, b, 0.0, output, transpose_a, transpose_b,
                         std::move(output_kernel), eigen);
 }
 
+// Fuses the activations that are only defined for floating point types.
+template <typename EigenEvaluator, typename Fuse>
+typename EigenEvaluator::DependencyToken FuseFloatingPointActivation(
+    string_view activation, float leakyrelu_alpha, Fuse fuse,
+    EigenEvaluator& eigen, std::true_type /*is_floating_point*/) {
+  if (activation == "LeakyRelu")
+    return fuse(compat::LeakyRelu(leakyrelu_alpha));
+  if (activation == "GeluApproximate") return fuse(compat::GeluApproximate());
+  if (activation == "GeluExact") return fuse(compat::GeluExact());
+  if (activation == "Swish") return fuse(compat::Swish());
+  return eigen.MakeError("Unsupported fusion type");
+}
+
+template <typename EigenEvaluator, typename Fuse>
+typename EigenEvaluator::DependencyToken FuseFloatingPointActivation(
+    string_view activation, float leakyrelu_alpha, Fuse fuse,
+    EigenEvaluator& eigen, std::false_type /*is_floating_point*/) {
+  return eigen.MakeError("Unsupported fusion type");
+}
+
 }  // namespace
 
+// MatMul fused with the output operations `fused_ops_attr`:
+//
+//   BiasAdd [+ Add] [+ Activation]
+//
+// BiasAdd adds `fusion_inputs[0]`, a vector, to the output rows, and Add adds
+// the residual `fusion_inputs[1]`, which has the shape of the output. The
+// activation is one of Relu, Relu6 and Elu, or, for floating point types,
+// LeakyRelu (with slope `leakyrelu_alpha`), GeluApproximate (the tanh form),
+// GeluExact (the erf form) and Swish.
 template <typename T, typename EigenEvaluator, typename FuseInputsRange>
 typename EigenEvaluator::DependencyToken FusedMatMul(
     const DenseHostTensor& a, const DenseHostTensor& b, DenseHostTensor* output,
     FuseInputsRange fusion_inputs, bool transpose_a, bool transpose_b,
-    AggregateAttr fused_ops_attr, const ExecutionContext& exec_ctx) {
+    AggregateAttr fused_ops_attr, float leakyrelu_alpha,
+    const ExecutionContext& exec_ctx) {
   static_assert(std::is_same<std::decay_t<decltype(fusion_inputs[0])>,
                              DenseHostTensor>::value,
                 "fusion_inputs must be a range of DenseHostTensor");
@@ -67,53 +200,55 @@ typename EigenEvaluator::DependencyToken FusedMatMul(
     return eigen.MakeError("FusedMatMul must specify fused operations");
   }
 
-  // Match the fusion to Eigen contraction output kernel.
-  auto match_fusion = [&](std::initializer_list<string_view> ops) -> bool {
-    return fused_ops.size() == ops.size() &&
-           std::equal(fused_ops.begin(), fused_ops.end(), ops.begin());
-  };
+  // All supported fusions start with BiasAdd.
+  if (fused_ops[0] != "BiasAdd")
+    return eigen.MakeError("Unsupported fusion type");
 
-  // Dispatch fusion to correct Eigen contraction output kernel.
   // Validate BiasAdd operands.
-  if (fused_ops[0] == "BiasAdd") {
-    auto& bias = fusion_inputs[0];
+  auto& bias = fusion_inputs[0];
 
-    if (bias.shape().GetRank() != 1)
-      return eigen.MakeError("Bias tensor must a vector");
+  if (bias.shape().GetRank() != 1)
+    return eigen.MakeError("Bias tensor must a vector");
 
-    const Index inner_dim = output->shape().GetDimensionSize(1);
-    if (bias.NumElements() != inner_dim)
-      return eigen.MakeError("The number of bias elements ", bias.NumElements(),
-                             " doesn't match output inner dimension ",
-                             inner_dim);
-  }
+  const Index inner_dim = output->shape().GetDimensionSize(1);
+  if (bias.NumElements() != inner_dim)
+    return eigen.MakeError("The number of bias elements ", bias.NumElements(),
+                           " doesn't match output inner dimension ", inner_dim);
 
-  // Fusion: BiasAdd
-  if (match_fusion({"BiasAdd"})) {
-    return FusedMatMulInternal<compat::BiasAddOutputKernel<T>, T>(
-        a, b, output, fusion_inputs[0], transpose_a, transpose_b, eigen);
+  // Validate the residual Add operands.
+  ArrayRef<string_view> activation_ops = llvm::ArrayRef(fused_ops).drop_front();
+  const DenseHostTensor* residual = nullptr;
+  if (!activation_ops.empty() && activation_ops.front() == "Add") {
+    if (fusion_inputs.size() < 2)
+      return eigen.MakeError("Add fusion requires a residual tensor");
+    residual = &fusion_inputs[1];
+    if (residual->shape() != output->shape())
+      return eigen.MakeError("Residual tensor shape ", residual->shape(),
+                             " doesn't match output shape ", output->shape());
+    activation_ops = activation_ops.drop_front();
   }
 
-  // Fusion: BiasAdd + Relu
-  if (match_fusion({"BiasAdd", "Relu"})) {
-    return FusedMatMulInternal<compat::BiasAddOutputKernel<T, compat::Relu>, T>(
-        a, b, output, fusion_inputs[0], transpose_a, transpose_b, eigen);
-  }
+  if (activation_ops.size() > 1)
+    return eigen.MakeError("Unsupported fusion type");
 
-  // Fusion: BiasAdd + Relu6
-  if (match_fusion({"BiasAdd", "Relu6"})) {
-    return FusedMatMulInternal<compat::BiasAddOutputKernel<T, compat::Relu6>,
-                               T>(a, b, output, fusion_inputs[0], transpose_a,
-                                  transpose_b, eigen);
-  }
+  auto fuse = [&](auto activation) {
+    return FusedMatMulInternal<T>(a, b, output, bias, residual, transpose_a,
+                                  transpose_b, activation, exec_ctx, eigen);
+  };
 
-  // Fusion: BiasAdd + Elu
-  if (match_fusion({"BiasAdd", "Elu"})) {
-    return FusedMatMulInternal<compat::BiasAddOutputKernel<T, compat::Elu>, T>(
-        a, b, output, fusion_inputs[0], transpose_a, transpose_b, eigen);
-  }
+  // Fusion: BiasAdd [+ Add]
+  if (activation_ops.empty()) return fuse(compat::Identity());
 
-  return eigen.MakeError("Unsupported fusion type");
+  // Fusion: BiasAdd [+ Add] + Activation
+  const string_view activation = activation_ops.front();
+  if (activation == "Relu") return fuse(compat::Relu());
+  if (activation == "Relu6") return fuse(compat::Relu6());
+  if (activation == "Elu") return fuse(compat::Elu());
+
+  using IsFloatingPoint =
+      std::integral_constant<bool, !std::is_integral<T>::value>;
+  return FuseFloatingPointActivation(activation, leakyrelu_alpha, fuse, eigen,
+                                     IsFloatingPoint());
 }
 
 }  // namespace cpu
@@ -0,0 +1,102 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Feature hashing kernel implementations.
+
+#include "./hash_kernels.h"
+
+#include <string>
+#include <utility>
+
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/parallel_for.h"
+#include "tfrt/support/hash_util.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+#include "tfrt/tensor/string_host_tensor.h"
+
+namespace tfrt {
+namespace cpu {
+namespace {
+
+// The minimum number of strings hashed by a parallel block. String lengths
+// vary, so the blocks are claimed adaptively.
+constexpr size_t kMinStringBlockSize = 1024;
+// The minimum number of integers hashed by a parallel block.
+constexpr size_t kMinIntegerBlockSize = 16 * 1024;
+
+int64_t ToBucket(uint64_t fingerprint, int64_t num_buckets) {
+  if (num_buckets <= 0) return static_cast<int64_t>(fingerprint);
+  return static_cast<int64_t>(fingerprint %
+                              static_cast<uint64_t>(num_buckets));
+}
+
+template <typename T>
+void HashIntegers(const T* input, int64_t num_buckets, int64_t* output,
+                  size_t begin, size_t end) {
+  for (size_t i = begin; i < end; ++i) {
+    const uint64_t value = static_cast<int64_t>(input[i]);
+    output[i] = ToBucket(HashInt64(value), num_buckets);
+  }
+}
+
+}  // namespace
+
+AsyncValueRef<Chain> Hash(AsyncValueRef<HostTensor> input, int64_t num_buckets,
+                          DenseHostTensor* output,
+                          const ExecutionContext& exec_ctx) {
+  if (output->dtype() != DType::I64 ||
+      output->NumElements() != input->NumElements())
+    return EmitErrorAsync(exec_ctx,
+                          "hash output must be an int64 tensor of the input "
+                          "shape");
+
+  const size_t size = input->NumElements();
+  int64_t* out = static_cast<int64_t*>(output->data());
+
+  if (llvm::isa<StringHostTensor>(input.get())) {
+    return ParallelFor(exec_ctx).Execute(
+        size, ParallelFor::BlockSizes::Adaptive(kMinStringBlockSize),
+        [input = std::move(input), num_buckets, out](size_t begin,
+                                                     size_t end) {
+          ArrayRef<std::string> strings =
+              llvm::cast<StringHostTensor>(input.get()).strings();
+          for (size_t i = begin; i < end; ++i)
+            out[i] = ToBucket(Hash64(strings[i]), num_buckets);
+        });
+  }
+
+  const DType dtype = input->dtype();
+  if (!llvm::isa<DenseHostTensor>(input.get()) ||
+      (dtype != DType::I32 && dtype != DType::I64))
+    return EmitErrorAsync(exec_ctx,
+                          StrCat("unsupported input for hashing: ", dtype));
+
+  return ParallelFor(exec_ctx).Execute(
+      size, ParallelFor::BlockSizes::Min(kMinIntegerBlockSize),
+      [input = std::move(input), num_buckets, out](size_t begin, size_t end) {
+        const auto& dht = llvm::cast<DenseHostTensor>(input.get());
+        if (dht.dtype() == DType::I32) {
+          HashIntegers(static_cast<const int32_t*>(dht.data()), num_buckets,
+                       out, begin, end);
+        } else {
+          HashIntegers(static_cast<const int64_t*>(dht.data()), num_buckets,
+                       out, begin, end);
+        }
+      });
+}
+
+}  // namespace cpu
+}  // namespace tfrt
@@ -0,0 +1,51 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Feature hashing kernels.
+//
+// The kernels hash every element of a string or integer tensor to an int64
+// fingerprint, or to a bucket of the fingerprints. Strings are hashed with
+// Hash64, and integers with HashInt64, which mixes a value without a loop over
+// its bytes. Integers are sign extended to 64 bits first, so that int32 and
+// int64 tensors with the same values have the same fingerprints. Elements are
+// hashed in parallel blocks.
+
+#ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_HASH_KERNELS_H_
+#define TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_HASH_KERNELS_H_
+
+#include <cstdint>
+
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/host_tensor.h"
+
+namespace tfrt {
+namespace cpu {
+
+// Writes the fingerprints of the elements of `input`, a StringHostTensor or an
+// int32 or int64 DenseHostTensor, to the int64 `output` of the same shape. If
+// `num_buckets` is positive, writes the fingerprints modulo `num_buckets`
+// instead. `input` is kept alive until the returned chain is available.
+AsyncValueRef<Chain> Hash(AsyncValueRef<HostTensor> input, int64_t num_buckets,
+                          DenseHostTensor* output,
+                          const ExecutionContext& exec_ctx);
+
+}  // namespace cpu
+}  // namespace tfrt
+
+#endif  // TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_HASH_KERNELS_H_
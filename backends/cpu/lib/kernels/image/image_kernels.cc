@@ -14,7 +14,15 @@
 
 // This file implements kernels that process images.
 
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 #include "jpeg/jpeg_mem.h"
 #include "resize_bilinear_op.h"
@@ -22,10 +30,13 @@
 #include "tfrt/host_context/diagnostic.h"
 #include "tfrt/host_context/function.h"
 #include "tfrt/host_context/kernel_utils.h"
+#include "tfrt/host_context/parallel_for.h"
+#include "tfrt/support/bf16.h"
 #include "tfrt/support/error_util.h"
 #include "tfrt/tensor/dense_host_tensor.h"
 #include "tfrt/tensor/dense_host_tensor_view.h"
 #include "tfrt/tensor/dense_tensor_utils.h"
+#include "tfrt/tensor/string_host_tensor.h"
 #include "tfrt/tracing/tracing.h"
 
 namespace tfrt {
@@ -72,56 +83,275 @@ static AsyncValueRef<DenseHostTensor> DecodeJpeg(
   return output;
 }
 
-// IDEA(donglin): allocate tensor buffer outside this kernel
-// Returns tf.compat.v1.image.resize(input, [height, width])
+// Returns tf.compat.v1.image.resize(input, [height, width]) for an input of
+// dtype ui8 or f32. The output rows are resized in parallel.
 static AsyncValueRef<DenseHostTensor> ResizeBilinear(
     Argument<DenseHostTensor> input, Index height, Index width,
     const ExecutionContext& exec_ctx) {
-  using ReturnTy = Expected<DenseHostTensor>;
-  return EnqueueWork(
-      exec_ctx,
-      [input = input.ValueRef(), height, width, exec_ctx]() -> ReturnTy {
-        TFRT_TRACE_SCOPE(Default, "ResizeBilinear");
-        const TensorShape& shape = input->shape();
-        if (shape.GetRank() != 3) {
-          auto diag = EmitError(exec_ctx, "input tensor shape must be 3");
-          return MakeStringError(diag.message());
-        }
+  TFRT_TRACE_SCOPE(Default, "ResizeBilinear");
+  const TensorShape& shape = input->shape();
+  if (shape.GetRank() != 3)
+    return EmitErrorAsync(exec_ctx, "input tensor shape must be 3");
+  if (input->dtype() != DType::UI8 && input->dtype() != DType::F32)
+    return EmitErrorAsync(exec_ctx, "input tensor must have dtype ui8 or f32");
+
+  Index input_height = shape.GetDimensionSize(0);
+  Index input_width = shape.GetDimensionSize(1);
+  Index channels = shape.GetDimensionSize(2);
+  float height_scale = input_height / static_cast<float>(height);
+  float width_scale = input_width / static_cast<float>(width);
+
+  auto output = DenseHostTensor::MakeConstructedAsyncValueRef(
+      TensorMetadata(GetDType<float>(), {height, width, channels}),
+      exec_ctx.host());
+  if (!output) return EmitErrorAsync(exec_ctx, "cannot allocate tensor");
+
+  // Blocks of rows should be large enough to amortize the scheduling.
+  static constexpr Index kMinBlockElements = 16 * 1024;
+  const Index row_elements = std::max<Index>(1, width * channels);
+  const Index min_block_rows =
+      std::max<Index>(1, kMinBlockElements / row_elements);
+  // The captured output is alive until `on_done` runs.
+  ParallelFor(exec_ctx).Execute(
+      height, ParallelFor::BlockSizes::Min(min_block_rows),
+      [input = input.ValueRef(), output = &output.get(), height_scale,
+       width_scale](size_t begin, size_t end) {
+        resize_image(*input, height_scale, width_scale, *output, begin, end);
+      },
+      [output = output.CopyRef()]() mutable { output.SetStateConcrete(); });
+
+  return output;
+}
+
+// Returns the largest libjpeg scale denominator that still decodes an image of
+// `image_height` x `image_width` to at least `height` x `width`, so that the
+// downscaling is done in the DCT domain and the resize only interpolates.
+static int GetDecodeRatio(int image_height, int image_width, Index height,
+                          Index width) {
+  int ratio = 8;
+  while (ratio > 1 &&
+         (image_height / ratio < height || image_width / ratio < width))
+    ratio /= 2;
+  return ratio;
+}
+
+// Decodes `data` and resizes it bilinearly into `output`, which has shape
+// [1, height, width, 3].
+static Error DecodeAndResizeJpeg(string_view data, DenseHostTensor* output,
+                                 HostContext* host) {
+  if (!data.starts_with("\xff\xd8\xff"))
+    return MakeStringError("image does not have jpeg format");
+
+  int image_height, image_width;
+  if (!jpeg::GetImageInfo(data.data(), data.size(), &image_width,
+                          &image_height, /*components=*/nullptr))
+    return MakeStringError("failed to read jpeg header");
+
+  const Index height = output->shape().GetDimensionSize(1);
+  const Index width = output->shape().GetDimensionSize(2);
+  jpeg::UncompressFlags flags;
+  flags.components = 3;
+  flags.dct_method = JDCT_IFAST;
+  flags.ratio = GetDecodeRatio(image_height, image_width, height, width);
+
+  std::optional<DenseHostTensor> decoded;
+  jpeg::Uncompress(
+      data.data(), data.size(), flags, nullptr /* nwarn */,
+      [host, &decoded](int decoded_width, int decoded_height,
+                       int channels) -> uint8_t* {
+        auto tensor = DenseHostTensor::CreateUninitialized<uint8_t>(
+            TensorShape({decoded_height, decoded_width, channels}), host);
+        if (!tensor) return nullptr;
+        decoded = std::move(*tensor);
+        return static_cast<uint8_t*>(decoded->data());
+      });
+  if (!decoded) return MakeStringError("failed to decode jpeg image");
+
+  const TensorShape& shape = decoded->shape();
+  resize_image(*decoded, shape.GetDimensionSize(0) / static_cast<float>(height),
+               shape.GetDimensionSize(1) / static_cast<float>(width), *output);
+  return Error::success();
+}
+
+// Returns tf.compat.v1.image.resize(tf.image.decode_jpeg(image, channels=3),
+// [height, width]) for each image of `images`, stacked into a tensor of shape
+// [num_images, height, width, 3]. The images are decoded in parallel, and
+// downscaled by libjpeg when they are at least twice as large as the output.
+static AsyncValueRef<DenseHostTensor> DecodeJpegBatch(
+    Argument<StringHostTensor> images, Index height, Index width,
+    const ExecutionContext& exec_ctx) {
+  HostContext* host = exec_ctx.host();
+  const size_t num_images = images->NumElements();
+  auto output = DenseHostTensor::MakeConstructedAsyncValueRef(
+      TensorMetadata(GetDType<float>(), {static_cast<Index>(num_images),
+                                         height, width, 3}),
+      host);
+  if (!output) return EmitErrorAsync(exec_ctx, "cannot allocate tensor");
+
+  // Every decode writes to its own slice of the output buffer, and reports
+  // errors to its own element of `errors`.
+  const size_t image_size = height * width * 3 * sizeof(float);
+  auto errors = std::make_shared<std::vector<std::string>>(num_images);
+  auto decode = [host, images = images.ValueRef(), output = &output.get(),
+                 image_size, errors](size_t begin, size_t end) {
+    TFRT_TRACE_SCOPE(Default, "DecodeJpegBatch");
+    const TensorShape& shape = output->shape();
+    const TensorMetadata metadata(
+        GetDType<float>(),
+        {1, shape.GetDimensionSize(1), shape.GetDimensionSize(2), 3});
+    for (size_t i = begin; i < end; ++i) {
+      DenseHostTensor image(metadata,
+                            HostBuffer::CreateFromExternal(
+                                output->buffer().CopyRef(), i * image_size,
+                                image_size));
+      if (auto error =
+              DecodeAndResizeJpeg(images->strings()[i], &image, host))
+        (*errors)[i] = toString(std::move(error));
+    }
+  };
 
-        Index batch_size = 1;
-        Index input_height = shape.GetDimensionSize(0);
-        Index input_width = shape.GetDimensionSize(1);
-        Index channels = shape.GetDimensionSize(2);
-        float height_scale = input_height / static_cast<float>(height);
-        float width_scale = input_width / static_cast<float>(width);
-
-        // Create the temporary output tensor with batch_size=1. This follows
-        // the same logic in tf.image.resize which adds a batch dimension if the
-        // input image does not have the batch dimension. It is easier to port
-        // the code from TF to TFRT by following the same logic. And in the
-        // future we may also want this kernel to process input image with or
-        // without the batch dimension.
-        auto dht = DenseHostTensor::CreateUninitialized<float>(
-            TensorShape({batch_size, height, width, channels}),
-            exec_ctx.host());
-        if (!dht) {
-          auto diag = EmitError(exec_ctx, "cannot allocate tensor");
-          return MakeStringError(diag.message());
+  ParallelFor(exec_ctx).Execute(
+      num_images, ParallelFor::BlockSizes::Fixed(1), std::move(decode),
+      [output = output.CopyRef(), errors, exec_ctx]() mutable {
+        for (size_t i = 0; i < errors->size(); ++i) {
+          if ((*errors)[i].empty()) continue;
+          auto diag = EmitError(exec_ctx, "failed to decode image ", i, ": ",
+                                (*errors)[i]);
+          return output.SetError(diag.status);
         }
-        resize_image(input.get(), height_scale, width_scale, *dht);
+        output.SetStateConcrete();
+      });
+
+  return output;
+}
+
+// Rounds `value` to the nearest bf16, ties to even.
+static bf16 FloatToBF16(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  if ((bits & 0x7fffffff) > 0x7f800000) return bf16(0x7fc0);  // NaN
+  bits += 0x7fff + ((bits >> 16) & 1);
+  return bf16(static_cast<uint16_t>(bits >> 16));
+}
+
+// Decodes `data`, and resizes and normalizes it into `output`, which points to
+// height * width * 3 elements of type T. The scanlines are resized as they are
+// decoded, so neither the decoded nor the resized image is materialized.
+template <typename T>
+static Error DecodeResizeNormalizeJpeg(string_view data, Index height,
+                                       Index width, ArrayRef<float> mean,
+                                       ArrayRef<float> stddev, T* output) {
+  if (!data.starts_with("\xff\xd8\xff"))
+    return MakeStringError("image does not have jpeg format");
+
+  int image_height, image_width;
+  if (!jpeg::GetImageInfo(data.data(), data.size(), &image_width,
+                          &image_height, /*components=*/nullptr))
+    return MakeStringError("failed to read jpeg header");
+
+  jpeg::UncompressFlags flags;
+  flags.components = 3;
+  flags.dct_method = JDCT_IFAST;
+  flags.ratio = GetDecodeRatio(image_height, image_width, height, width);
 
-        // Remove the batch_size dimension before returning the result.
-        TensorMetadata output_metadata(GetDType<float>(),
-                                       {height, width, channels});
-        DenseHostTensor output(output_metadata, dht->ReleaseBuffer());
-        return std::move(output);
+  const float scale[3] = {1.0f / stddev[0], 1.0f / stddev[1],
+                          1.0f / stddev[2]};
+  std::optional<BilinearRowResizer> resizer;
+  auto emit_row = [&](Index y, const float* row) {
+    T* out = output + y * width * 3;
+    for (Index i = 0, e = width * 3; i < e; ++i) {
+      const float value = (row[i] - mean[i % 3]) * scale[i % 3];
+      if constexpr (std::is_same<T, bf16>::value) {
+        out[i] = FloatToBF16(value);
+      } else {
+        out[i] = value;
+      }
+    }
+  };
+  const bool decoded = jpeg::UncompressScanlines(
+      data.data(), data.size(), flags,
+      [&](int decoded_width, int decoded_height, int channels) {
+        resizer.emplace(decoded_height, decoded_width, height, width);
+        return channels == 3;
+      },
+      [&](int row, const uint8_t* scanline) {
+        resizer->AddRow(scanline, emit_row);
       });
+  if (!decoded) return MakeStringError("failed to decode jpeg image");
+  return Error::success();
+}
+
+// Decodes every image of `images`, and resizes it bilinearly to the height and
+// width of `output`, which has shape [num_images, height, width, 3] and dtype
+// f32 or bf16. Channel c of every pixel is normalized to
+// (value - mean[c]) / stddev[c]. The images are processed in parallel.
+static AsyncValueRef<Chain> DecodeResizeNormalize(
+    Argument<StringHostTensor> images, Argument<DenseHostTensor> output,
+    Argument<Chain> in_chain, ArrayAttribute<float> mean,
+    ArrayAttribute<float> stddev, const ExecutionContext& exec_ctx) {
+  const TensorShape& shape = output->shape();
+  const size_t num_images = images->NumElements();
+  if (shape.GetRank() != 4 ||
+      shape.GetDimensionSize(0) != static_cast<Index>(num_images) ||
+      shape.GetDimensionSize(3) != 3)
+    return EmitErrorAsync(exec_ctx,
+                          "output tensor must have shape [num_images, height, "
+                          "width, 3]");
+  const DType dtype = output->dtype();
+  if (dtype != DType::F32 && dtype != DType::BF16)
+    return EmitErrorAsync(exec_ctx,
+                          "output tensor must have dtype f32 or bf16");
+  if (mean.size() != 3 || stddev.size() != 3)
+    return EmitErrorAsync(exec_ctx, "mean and stddev must have 3 elements");
+
+  auto chain = MakeConstructedAsyncValueRef<Chain>();
+  auto errors = std::make_shared<std::vector<std::string>>(num_images);
+  auto decode = [images = images.ValueRef(), output = output.ValueRef(),
+                 mean = std::array<float, 3>{mean[0], mean[1], mean[2]},
+                 stddev = std::array<float, 3>{stddev[0], stddev[1],
+                                               stddev[2]},
+                 errors](size_t begin, size_t end) {
+    TFRT_TRACE_SCOPE(Default, "DecodeResizeNormalize");
+    const Index height = output->shape().GetDimensionSize(1);
+    const Index width = output->shape().GetDimensionSize(2);
+    const size_t image_elements = height * width * 3;
+    for (size_t i = begin; i < end; ++i) {
+      const std::string& data = images->strings()[i];
+      Error error =
+          output->dtype() == DType::BF16
+              ? DecodeResizeNormalizeJpeg(
+                    data, height, width, mean, stddev,
+                    static_cast<bf16*>(output->data()) + i * image_elements)
+              : DecodeResizeNormalizeJpeg(
+                    data, height, width, mean, stddev,
+                    static_cast<float*>(output->data()) + i * image_elements);
+      if (error) (*errors)[i] = toString(std::move(error));
+    }
+  };
+
+  ParallelFor(exec_ctx).Execute(
+      num_images, ParallelFor::BlockSizes::Fixed(1), std::move(decode),
+      [chain = chain.CopyRef(), errors, exec_ctx]() mutable {
+        for (size_t i = 0; i < errors->size(); ++i) {
+          if ((*errors)[i].empty()) continue;
+          auto diag = EmitError(exec_ctx, "failed to decode image ", i, ": ",
+                                (*errors)[i]);
+          return chain.SetError(diag.status);
+        }
+        chain.SetStateConcrete();
+      });
+
+  return chain;
 }
 
 // This is the entrypoint to the library.
 void RegisterImageKernels(KernelRegistry* registry) {
   registry->AddKernel("tfrt_test.decode_jpeg", TFRT_KERNEL(DecodeJpeg));
   registry->AddKernel("tfrt_test.resize_bilinear", TFRT_KERNEL(ResizeBilinear));
+  registry->AddKernel("tfrt_test.decode_jpeg_batch",
+                      TFRT_KERNEL(DecodeJpegBatch));
+  registry->AddKernel("tfrt_test.decode_resize_normalize",
+                      TFRT_KERNEL(DecodeResizeNormalize));
 }
 
 }  // namespace image
@@ -393,6 +393,89 @@ uint8_t* UncompressLow(const void* srcdata, FewerArgsForCompiler* argball) {
   return dstdata;
 }
 
+// Like FewerArgsForCompiler, for UncompressScanlines.
+struct ScanlineArgs {
+  int datasize;
+  UncompressFlags flags;
+  std::function<bool(int, int, int)> start;
+  std::function<void(int, const uint8_t*)> process_scanline;
+};
+
+bool UncompressScanlinesLow(const void* srcdata, ScanlineArgs* args) {
+  const UncompressFlags& flags = args->flags;
+  if (args->datasize == 0 || srcdata == nullptr) return false;
+  if (flags.components != 3 || flags.crop) return false;
+  if ((flags.ratio != 1) && (flags.ratio != 2) && (flags.ratio != 4) &&
+      (flags.ratio != 8)) {
+    return false;
+  }
+
+  struct jpeg_decompress_struct cinfo;
+  struct jpeg_error_mgr jerr;
+  cinfo.err = jpeg_std_error(&jerr);
+  jerr.error_exit = CatchError;
+
+#ifdef FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION
+  jerr.output_message = no_print;
+#endif
+
+  jmp_buf jpeg_jmpbuf;
+  cinfo.client_data = &jpeg_jmpbuf;
+  if (setjmp(jpeg_jmpbuf)) {
+    jpeg_destroy_decompress(&cinfo);
+    return false;
+  }
+
+  jpeg_create_decompress(&cinfo);
+  SetSrc(&cinfo, srcdata, args->datasize, flags.try_recover_truncated_jpeg);
+  jpeg_read_header(&cinfo, TRUE);
+
+  // The CMYK to RGB conversion of Uncompress needs the whole image.
+  if (cinfo.jpeg_color_space == JCS_CMYK ||
+      cinfo.jpeg_color_space == JCS_YCCK) {
+    jpeg_destroy_decompress(&cinfo);
+    return false;
+  }
+  cinfo.out_color_space = JCS_RGB;
+  cinfo.do_fancy_upsampling = boolean(flags.fancy_upscaling);
+  cinfo.scale_num = 1;
+  cinfo.scale_denom = flags.ratio;
+  cinfo.dct_method = flags.dct_method;
+
+  jpeg_calc_output_dimensions(&cinfo);
+  if (cinfo.output_width <= 0 || cinfo.output_height <= 0) {
+    llvm::errs() << "Invalid image size: " << cinfo.output_width << " x "
+                 << cinfo.output_height;
+    jpeg_destroy_decompress(&cinfo);
+    return false;
+  }
+
+  jpeg_start_decompress(&cinfo);
+  if (!args->start(cinfo.output_width, cinfo.output_height,
+                   cinfo.output_components)) {
+    jpeg_destroy_decompress(&cinfo);
+    return false;
+  }
+
+  // The scanline buffer is owned by cinfo, so it is released on error paths
+  // too.
+  JSAMPARRAY scanline = (*cinfo.mem->alloc_sarray)(
+      reinterpret_cast<j_common_ptr>(&cinfo), JPOOL_IMAGE,
+      cinfo.output_width * cinfo.output_components, 1);
+  while (cinfo.output_scanline < cinfo.output_height) {
+    const int row = cinfo.output_scanline;
+    if (jpeg_read_scanlines(&cinfo, scanline, 1) != 1) {
+      jpeg_destroy_decompress(&cinfo);
+      return false;
+    }
+    args->process_scanline(row, scanline[0]);
+  }
+
+  jpeg_finish_decompress(&cinfo);
+  jpeg_destroy_decompress(&cinfo);
+  return true;
+}
+
 }  // namespace
 
 // -----------------------------------------------------------------------------
@@ -432,6 +515,55 @@ uint8_t* Uncompress(const void* srcdata, int datasize,
   return dstdata;
 }
 
+bool UncompressScanlines(
+    const void* srcdata, int datasize, const UncompressFlags& flags,
+    std::function<bool(int, int, int)> start,
+    std::function<void(int, const uint8_t*)> process_scanline) {
+  ScanlineArgs args{datasize, flags, std::move(start),
+                    std::move(process_scanline)};
+  return UncompressScanlinesLow(srcdata, &args);
+}
+
+// ----------------------------------------------------------------------------
+// Computes image information from jpeg header.
+// Returns true on success; false on failure.
+bool GetImageInfo(const void* srcdata, int datasize, int* width, int* height,
+                  int* components) {
+  // Init in case of failure
+  if (width) *width = 0;
+  if (height) *height = 0;
+  if (components) *components = 0;
+
+  // If empty image, return
+  if (datasize == 0 || srcdata == nullptr) return false;
+
+  // Initialize libjpeg structures to have a memory source
+  // Modify the usual jpeg error manager to catch fatal errors.
+  struct jpeg_decompress_struct cinfo;
+  struct jpeg_error_mgr jerr;
+  jmp_buf jpeg_jmpbuf;
+  cinfo.err = jpeg_std_error(&jerr);
+  cinfo.client_data = &jpeg_jmpbuf;
+  jerr.error_exit = CatchError;
+  if (setjmp(jpeg_jmpbuf)) {
+    return false;
+  }
+
+  // set up, read header, set image parameters, save size
+  jpeg_create_decompress(&cinfo);
+  SetSrc(&cinfo, srcdata, datasize, false);
+
+  jpeg_read_header(&cinfo, TRUE);
+  jpeg_calc_output_dimensions(&cinfo);
+  if (width) *width = cinfo.output_width;
+  if (height) *height = cinfo.output_height;
+  if (components) *components = cinfo.output_components;
+
+  jpeg_destroy_decompress(&cinfo);
+
+  return true;
+}
+
 }  // namespace jpeg
 }  // namespace image
 }  // namespace tfrt
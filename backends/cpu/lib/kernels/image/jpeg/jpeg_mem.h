@@ -87,6 +87,22 @@ uint8_t* Uncompress(const void* srcdata, int datasize,
                     const UncompressFlags& flags, int64_t* nwarn,
                     std::function<uint8_t*(int, int, int)> allocate_output);
 
+// Decodes the image one scanline at a time instead of into an output buffer.
+// `start` is called with (width, height, components) once the output size is
+// known, and returns false to abort the decode. `process_scanline` is then
+// called with the index and the width * components bytes of every scanline, in
+// order. Only flags.components == 3 without cropping is supported. Returns
+// true if the whole image was decoded.
+bool UncompressScanlines(
+    const void* srcdata, int datasize, const UncompressFlags& flags,
+    std::function<bool(int, int, int)> start,
+    std::function<void(int, const uint8_t*)> process_scanline);
+
+// Read jpeg header and get image information.  Returns true on success.
+// The width, height, and components points may be null.
+bool GetImageInfo(const void* srcdata, int datasize, int* width, int* height,
+                  int* components);
+
 }  // namespace jpeg
 }  // namespace image
 }  // namespace tfrt
@@ -16,17 +16,24 @@
 
 #include "resize_bilinear_op.h"
 
+#include <map>
+#include <tuple>
+#include <utility>
+
+#include "tfrt/support/mutex.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 namespace tfrt {
 namespace image {
 namespace {
 
-struct CachedInterpolation {
-  Index lower;  // Lower source index used in the interpolation
-  Index upper;  // Upper source index used in the interpolation
-  // 1-D linear iterpolation scale (see:
-  // https://en.wikipedia.org/wiki/Bilinear_interpolation)
-  float lerp;
-};
+// The number of interpolation tables kept by GetInterpolationTable.
+constexpr size_t kMaxCachedTables = 64;
 
 void compute_interpolation_weights(const Index out_size, const Index in_size,
                                    const float scale,
@@ -44,91 +51,168 @@ void compute_interpolation_weights(const Index out_size, const Index in_size,
   }
 }
 
-float compute_lerp(const float top_left, const float top_right,
-                   const float bottom_left, const float bottom_right,
-                   const float x_lerp, const float y_lerp) {
-  const float top = top_left + (top_right - top_left) * x_lerp;
-  const float bottom = bottom_left + (bottom_right - bottom_left) * x_lerp;
-  return top + (bottom - top) * y_lerp;
+// Interpolates `row` of `channels` values per pixel horizontally into the
+// out_size * channels values of `output`.
+template <typename T>
+void interpolate_row(const T* row, const InterpolationTable& xs,
+                     Index channels, float* output) {
+  const Index out_size = xs.size() - 1;
+  for (Index x = 0; x < out_size; ++x) {
+    const T* left = row + xs[x].lower * channels;
+    const T* right = row + xs[x].upper * channels;
+    const float xs_lerp = xs[x].lerp;
+    for (Index c = 0; c < channels; ++c) {
+      const float left_c(left[c]);
+      const float right_c(right[c]);
+      output[x * channels + c] = left_c + (right_c - left_c) * xs_lerp;
+    }
+  }
+}
+
+// Interpolates the horizontally interpolated rows `top` and `bottom` of `size`
+// values into `output`.
+void interpolate_rows(const float* top, const float* bottom, float lerp,
+                      Index size, float* output) {
+  Index i = 0;
+#if defined(__AVX__)
+  const __m256 lerp8 = _mm256_set1_ps(lerp);
+  for (; i + 8 <= size; i += 8) {
+    const __m256 top8 = _mm256_loadu_ps(top + i);
+    const __m256 bottom8 = _mm256_loadu_ps(bottom + i);
+    const __m256 delta8 = _mm256_sub_ps(bottom8, top8);
+    _mm256_storeu_ps(output + i,
+                     _mm256_add_ps(top8, _mm256_mul_ps(delta8, lerp8)));
+  }
+#elif defined(__ARM_NEON)
+  const float32x4_t lerp4 = vdupq_n_f32(lerp);
+  for (; i + 4 <= size; i += 4) {
+    const float32x4_t top4 = vld1q_f32(top + i);
+    const float32x4_t bottom4 = vld1q_f32(bottom + i);
+    vst1q_f32(output + i,
+              vaddq_f32(top4, vmulq_f32(vsubq_f32(bottom4, top4), lerp4)));
+  }
+#endif
+  for (; i < size; ++i) output[i] = top[i] + (bottom[i] - top[i]) * lerp;
 }
+
+template <typename T>
+void resize_rows(const T* input, Index input_width, Index channels,
+                 const InterpolationTable& ys, const InterpolationTable& xs,
+                 float* output, Index begin_row, Index end_row) {
+  const Index in_row_size = input_width * channels;
+  const Index out_row_size = (xs.size() - 1) * channels;
+
+  // Consecutive output rows mostly share their source rows, so the last two
+  // horizontally interpolated source rows are kept.
+  std::vector<float> top(out_row_size), bottom(out_row_size);
+  Index top_row = -1, bottom_row = -1;
+  for (Index y = begin_row; y < end_row; ++y) {
+    const CachedInterpolation& ys_y = ys[y];
+    if (ys_y.lower == bottom_row) {
+      std::swap(top, bottom);
+      std::swap(top_row, bottom_row);
+    }
+    if (ys_y.lower != top_row) {
+      interpolate_row(input + ys_y.lower * in_row_size, xs, channels,
+                      top.data());
+      top_row = ys_y.lower;
+    }
+    if (ys_y.upper != bottom_row) {
+      interpolate_row(input + ys_y.upper * in_row_size, xs, channels,
+                      bottom.data());
+      bottom_row = ys_y.upper;
+    }
+    interpolate_rows(top.data(), bottom.data(), ys_y.lerp, out_row_size,
+                     output + y * out_row_size);
+  }
+}
+
 }  // namespace
 
+std::shared_ptr<const InterpolationTable> GetInterpolationTable(Index out_size,
+                                                                Index in_size,
+                                                                float scale) {
+  using Key = std::tuple<Index, Index, float>;
+  static mutex* mu = new mutex;
+  static auto* tables =
+      new std::map<Key, std::shared_ptr<const InterpolationTable>>;
+
+  const Key key(out_size, in_size, scale);
+  {
+    mutex_lock lock(*mu);
+    auto it = tables->find(key);
+    if (it != tables->end()) return it->second;
+  }
+
+  auto table = std::make_shared<InterpolationTable>(out_size + 1);
+  compute_interpolation_weights(out_size, in_size, scale, table->data());
+
+  mutex_lock lock(*mu);
+  if (tables->size() >= kMaxCachedTables) tables->clear();
+  return tables->emplace(key, std::move(table)).first->second;
+}
+
 void resize_image(const DenseHostTensor& input, const float height_scale,
                   const float width_scale, DenseHostTensor& output) {
+  const TensorShape& output_shape = output.shape();
+  resize_image(input, height_scale, width_scale, output, 0,
+               output_shape.GetDimensionSize(output_shape.GetRank() - 3));
+}
+
+void resize_image(const DenseHostTensor& input, const float height_scale,
+                  const float width_scale, DenseHostTensor& output,
+                  Index begin_row, Index end_row) {
   const TensorShape& input_shape = input.shape();
-  Index batch_size = 1;
   Index input_height = input_shape.GetDimensionSize(0);
   Index input_width = input_shape.GetDimensionSize(1);
   Index channels = input_shape.GetDimensionSize(2);
 
   const TensorShape& output_shape = output.shape();
-  Index output_height = output_shape.GetDimensionSize(1);
-  Index output_width = output_shape.GetDimensionSize(2);
-
-  std::vector<CachedInterpolation> ys(output_height + 1);
-  std::vector<CachedInterpolation> xs(output_width + 1);
-
-  compute_interpolation_weights(output_height, input_height, height_scale,
-                                ys.data());
-  compute_interpolation_weights(output_width, input_width, width_scale,
-                                xs.data());
-
-  // Scale x interpolation weights to avoid a multiplication during iteration.
-  for (int i = 0; i < xs.size(); ++i) {
-    xs[i].lower *= channels;
-    xs[i].upper *= channels;
+  const int output_rank = output_shape.GetRank();
+  Index output_height = output_shape.GetDimensionSize(output_rank - 3);
+  Index output_width = output_shape.GetDimensionSize(output_rank - 2);
+
+  auto ys = GetInterpolationTable(output_height, input_height, height_scale);
+  auto xs = GetInterpolationTable(output_width, input_width, width_scale);
+
+  float* output_ptr = static_cast<float*>(output.data());
+  if (input.dtype() == DType::F32) {
+    resize_rows(static_cast<const float*>(input.data()), input_width, channels,
+                *ys, *xs, output_ptr, begin_row, end_row);
+  } else {
+    assert(input.dtype() == DType::UI8);
+    resize_rows(static_cast<const uint8_t*>(input.data()), input_width,
+                channels, *ys, *xs, output_ptr, begin_row, end_row);
   }
+}
 
-  const Index in_row_size = input_width * channels;
-  const Index in_batch_num_values = input_height * in_row_size;
-  const Index out_row_size = output_width * channels;
-  const uint8_t* input_b_ptr = static_cast<const uint8_t*>(input.data());
-  float* output_y_ptr = static_cast<float*>(output.data());
-
-  for (int b = 0; b < batch_size; ++b) {
-    for (Index y = 0; y < output_height; ++y) {
-      const uint8_t* ys_input_lower_ptr =
-          input_b_ptr + ys[y].lower * in_row_size;
-      const uint8_t* ys_input_upper_ptr =
-          input_b_ptr + ys[y].upper * in_row_size;
-      const float ys_lerp = ys[y].lerp;
-      for (Index x = 0; x < output_width; ++x) {
-        const Index xs_lower = xs[x].lower;
-        const Index xs_upper = xs[x].upper;
-        const float xs_lerp = xs[x].lerp;
-
-        // Read channel 0.
-        const float top_left0(ys_input_lower_ptr[xs_lower + 0]);
-        const float top_right0(ys_input_lower_ptr[xs_upper + 0]);
-        const float bottom_left0(ys_input_upper_ptr[xs_lower + 0]);
-        const float bottom_right0(ys_input_upper_ptr[xs_upper + 0]);
-
-        // Read channel 1.
-        const float top_left1(ys_input_lower_ptr[xs_lower + 1]);
-        const float top_right1(ys_input_lower_ptr[xs_upper + 1]);
-        const float bottom_left1(ys_input_upper_ptr[xs_lower + 1]);
-        const float bottom_right1(ys_input_upper_ptr[xs_upper + 1]);
-
-        // Read channel 2.
-        const float top_left2(ys_input_lower_ptr[xs_lower + 2]);
-        const float top_right2(ys_input_lower_ptr[xs_upper + 2]);
-        const float bottom_left2(ys_input_upper_ptr[xs_lower + 2]);
-        const float bottom_right2(ys_input_upper_ptr[xs_upper + 2]);
-
-        // Compute output.
-        output_y_ptr[x * channels + 0] =
-            compute_lerp(top_left0, top_right0, bottom_left0, bottom_right0,
-                         xs_lerp, ys_lerp);
-        output_y_ptr[x * channels + 1] =
-            compute_lerp(top_left1, top_right1, bottom_left1, bottom_right1,
-                         xs_lerp, ys_lerp);
-        output_y_ptr[x * channels + 2] =
-            compute_lerp(top_left2, top_right2, bottom_left2, bottom_right2,
-                         xs_lerp, ys_lerp);
-      }
-      output_y_ptr += out_row_size;
-    }
-    input_b_ptr += in_batch_num_values;
+BilinearRowResizer::BilinearRowResizer(Index input_height, Index input_width,
+                                       Index output_height, Index output_width)
+    : output_height_(output_height),
+      prev_row_(output_width * 3),
+      row_(output_width * 3),
+      output_row_(output_width * 3) {
+  const float height_scale = input_height / static_cast<float>(output_height);
+  const float width_scale = input_width / static_cast<float>(output_width);
+  ys_ = GetInterpolationTable(output_height, input_height, height_scale);
+  xs_ = GetInterpolationTable(output_width, input_width, width_scale);
+}
+
+void BilinearRowResizer::AddRow(const uint8_t* row, EmitRowFn emit_row) {
+  const Index y_in = next_input_row_++;
+  std::swap(prev_row_, row_);
+  interpolate_row(row, *xs_, 3, row_.data());
+
+  // The upper source rows of the output rows are non-decreasing, and the lower
+  // source row of each is at most one row above the upper one.
+  for (; next_output_row_ < output_height_ &&
+         (*ys_)[next_output_row_].upper == y_in;
+       ++next_output_row_) {
+    const CachedInterpolation& ys = (*ys_)[next_output_row_];
+    const float* top = ys.lower == y_in ? row_.data() : prev_row_.data();
+    interpolate_rows(top, row_.data(), ys.lerp, output_row_.size(),
+                     output_row_.data());
+    emit_row(next_output_row_, output_row_.data());
   }
 }
 
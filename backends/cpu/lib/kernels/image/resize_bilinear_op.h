@@ -19,7 +19,11 @@
 #ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_IMAGE_RESIZE_BILINEAR_OP_H_
 #define TFRT_BACKENDS_CPU_LIB_KERNELS_IMAGE_RESIZE_BILINEAR_OP_H_
 
+#include <memory>
+#include <vector>
+
 #include "jpeg/jpeg_mem.h"
+#include "llvm/ADT/STLFunctionalExtras.h"
 #include "tfrt/host_context/function.h"
 #include "tfrt/host_context/kernel_utils.h"
 #include "tfrt/support/error_util.h"
@@ -30,9 +34,66 @@
 namespace tfrt {
 namespace image {
 
+struct CachedInterpolation {
+  Index lower;  // Lower source index used in the interpolation
+  Index upper;  // Upper source index used in the interpolation
+  // 1-D linear iterpolation scale (see:
+  // https://en.wikipedia.org/wiki/Bilinear_interpolation)
+  float lerp;
+};
+
+// The interpolation weights to resize a dimension of `in_size` to `out_size`,
+// with out_size + 1 entries.
+using InterpolationTable = std::vector<CachedInterpolation>;
+
+// Returns the interpolation table for (out_size, in_size, scale). Tables are
+// cached, so that images of the same size share them. This function is
+// thread-safe.
+std::shared_ptr<const InterpolationTable> GetInterpolationTable(Index out_size,
+                                                                Index in_size,
+                                                                float scale);
+
+// Resizes `input` of shape [height, width, channels] and dtype ui8 or f32 into
+// the float `output` of shape [height, width, channels], optionally with a
+// leading batch dimension of 1.
 void resize_image(const DenseHostTensor& input, float height_scale,
                   float width_scale, DenseHostTensor& output);
 
+// Like resize_image, but only computes the output rows in [begin_row,
+// end_row), so that disjoint row ranges can be resized in parallel.
+void resize_image(const DenseHostTensor& input, float height_scale,
+                  float width_scale, DenseHostTensor& output, Index begin_row,
+                  Index end_row);
+
+// Resizes an RGB image with the same semantics as resize_image, but consumes
+// the input one row at a time, e.g. as the rows are decoded. Only the last two
+// input rows are kept, interpolated horizontally.
+class BilinearRowResizer {
+ public:
+  // Called with the index and the output_width * 3 values of an output row.
+  using EmitRowFn = llvm::function_ref<void(Index, const float*)>;
+
+  BilinearRowResizer(Index input_height, Index input_width,
+                     Index output_height, Index output_width);
+
+  // Adds the next input row of input_width * 3 values, and emits the output
+  // rows which only depend on the rows added so far, in order.
+  void AddRow(const uint8_t* row, EmitRowFn emit_row);
+
+ private:
+  const Index output_height_;
+  std::shared_ptr<const InterpolationTable> ys_;
+  std::shared_ptr<const InterpolationTable> xs_;
+
+  // The previous and the last input row, interpolated horizontally.
+  std::vector<float> prev_row_;
+  std::vector<float> row_;
+  std::vector<float> output_row_;
+
+  Index next_input_row_ = 0;
+  Index next_output_row_ = 0;
+};
+
 }  // namespace image
 }  // namespace tfrt
 
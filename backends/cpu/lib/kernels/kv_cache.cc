@@ -0,0 +1,266 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Paged key/value cache implementation.
+
+#include "./kv_cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "tfrt/tensor/tensor_shape.h"
+
+namespace tfrt {
+namespace cpu {
+namespace {
+
+constexpr const char* kResourcePrefix = "tfrt.cpu.kv_cache.";
+
+// Returns the number of blocks that hold `length` tokens.
+Index NumBlocks(Index length) {
+  return (length + KVCache::kBlockTokens - 1) / KVCache::kBlockTokens;
+}
+
+// Calls `copy(block_rows, rows, index)` for the runs of `tokens` rows, from
+// the row `begin` of the blocks, that are contiguous in a block. `offset` is
+// the offset of the rows in the blocks, and `index` counts the rows copied
+// before the run.
+template <typename CopyFn>
+void ForEachRun(llvm::ArrayRef<RCReference<HostBuffer>> blocks, size_t offset,
+                size_t row_bytes, Index begin, Index tokens, CopyFn copy) {
+  for (Index index = 0; index < tokens;) {
+    const Index row = begin + index;
+    const Index rows = std::min(tokens - index,
+                                KVCache::kBlockTokens -
+                                    row % KVCache::kBlockTokens);
+    char* block_rows = static_cast<char*>(
+                           blocks[row / KVCache::kBlockTokens]->data()) +
+                       offset + (row % KVCache::kBlockTokens) * row_bytes;
+    copy(block_rows, rows * row_bytes, index * row_bytes);
+    index += rows;
+  }
+}
+
+}  // namespace
+
+KVCache::KVCache(const Config& config, HostAllocator* allocator)
+    : config_(config),
+      head_key_bytes_(kBlockTokens * config.depth * GetHostSize(config.dtype)),
+      head_value_bytes_(kBlockTokens * config.value_depth *
+                        GetHostSize(config.dtype)) {
+  const size_t block_bytes =
+      config.heads * (head_key_bytes_ + head_value_bytes_);
+  if (block_bytes == 0 || config.num_blocks <= 0) return;
+
+  RCReference<HostBuffer> pool = HostBuffer::CreateUninitialized(
+      config.num_blocks * block_bytes, HostBuffer::kLargeBufferAlignment,
+      allocator);
+  if (!pool) return;
+
+  free_blocks_.reserve(config.num_blocks);
+  for (Index i = 0; i < config.num_blocks; ++i) {
+    free_blocks_.push_back(HostBuffer::CreateFromExternal(
+        pool.CopyRef(), i * block_bytes, block_bytes));
+  }
+}
+
+Index KVCache::num_free_blocks() const {
+  mutex_lock lock(mu_);
+  return free_blocks_.size();
+}
+
+RCReference<HostBuffer> KVCache::AllocateBlock() {
+  for (auto& block : free_blocks_) {
+    if (!block->IsUnique()) continue;
+    RCReference<HostBuffer> result = std::move(block);
+    block = std::move(free_blocks_.back());
+    free_blocks_.pop_back();
+    return result;
+  }
+  return {};
+}
+
+Expected<llvm::SmallVector<Index, 4>> KVCache::Append(
+    llvm::ArrayRef<int64_t> sequences, const DenseHostTensor& key,
+    const DenseHostTensor& value) {
+  const Index batch = sequences.size();
+  const Index tokens =
+      key.shape().GetRank() == 4 ? key.shape().GetDimensionSize(2) : 0;
+  if (key.dtype() != config_.dtype || value.dtype() != config_.dtype)
+    return MakeStringError("KV cache holds ", config_.dtype,
+                           " keys and values, got ", key.dtype(), " and ",
+                           value.dtype());
+  if (key.shape() !=
+          TensorShape({batch, config_.heads, tokens, config_.depth}) ||
+      value.shape() !=
+          TensorShape({batch, config_.heads, tokens, config_.value_depth}))
+    return MakeStringError("KV cache appends keys [", batch, ", ",
+                           config_.heads, ", tokens, ", config_.depth,
+                           "] and values [", batch, ", ", config_.heads,
+                           ", tokens, ", config_.value_depth, "], got ",
+                           key.shape(), " and ", value.shape());
+
+  mutex_lock lock(mu_);
+
+  // Count the blocks that the batch needs. The tokens of a sequence that is
+  // several times in the batch are appended in order.
+  llvm::SmallDenseMap<int64_t, Index, 4> lengths;
+  Index needed_blocks = 0;
+  for (int64_t id : sequences) {
+    auto inserted = lengths.try_emplace(id, 0);
+    if (inserted.second) {
+      auto it = sequences_.find(id);
+      if (it != sequences_.end()) inserted.first->second = it->second.length;
+    }
+    Index& length = inserted.first->second;
+    needed_blocks += NumBlocks(length + tokens) - NumBlocks(length);
+    length += tokens;
+  }
+  if (needed_blocks > 0) {
+    Index available = 0;
+    for (const auto& block : free_blocks_)
+      if (block->IsUnique()) ++available;
+    if (available < needed_blocks)
+      return MakeStringError("KV cache needs ", needed_blocks,
+                             " free blocks, has ", available);
+  }
+
+  const char* key_data = static_cast<const char*>(key.data());
+  const char* value_data = static_cast<const char*>(value.data());
+  const size_t key_row_bytes = head_key_bytes_ / kBlockTokens;
+  const size_t value_row_bytes = head_value_bytes_ / kBlockTokens;
+
+  llvm::SmallVector<Index, 4> new_lengths;
+  new_lengths.reserve(batch);
+  for (Index b = 0; b < batch; ++b) {
+    Sequence& sequence = sequences_[sequences[b]];
+    while (static_cast<Index>(sequence.blocks.size()) <
+           NumBlocks(sequence.length + tokens))
+      sequence.blocks.push_back(AllocateBlock());
+
+    for (Index h = 0; h < config_.heads; ++h) {
+      const Index head = b * config_.heads + h;
+      const char* head_keys = key_data + head * tokens * key_row_bytes;
+      const char* head_values = value_data + head * tokens * value_row_bytes;
+      ForEachRun(sequence.blocks, key_offset(h), key_row_bytes,
+                 sequence.length, tokens,
+                 [&](char* block_rows, size_t size, size_t index) {
+                   std::memcpy(block_rows, head_keys + index, size);
+                 });
+      ForEachRun(sequence.blocks, value_offset(h), value_row_bytes,
+                 sequence.length, tokens,
+                 [&](char* block_rows, size_t size, size_t index) {
+                   std::memcpy(block_rows, head_values + index, size);
+                 });
+    }
+    sequence.length += tokens;
+    new_lengths.push_back(sequence.length);
+  }
+  return std::move(new_lengths);
+}
+
+KVCache::Sequence KVCache::Read(int64_t sequence) const {
+  mutex_lock lock(mu_);
+  Sequence result;
+  auto it = sequences_.find(sequence);
+  if (it == sequences_.end()) return result;
+  result.length = it->second.length;
+  for (const auto& block : it->second.blocks)
+    result.blocks.push_back(block.CopyRef());
+  return result;
+}
+
+Error KVCache::Gather(llvm::ArrayRef<int64_t> sequences, DenseHostTensor* key,
+                      DenseHostTensor* value) const {
+  const Index batch = sequences.size();
+  llvm::SmallVector<Sequence, 4> reads;
+  for (int64_t id : sequences) reads.push_back(Read(id));
+  const Index length = reads.empty() ? 0 : reads.front().length;
+  for (const Sequence& read : reads) {
+    if (read.length != length)
+      return MakeStringError("KV cache sequences of lengths ", length, " and ",
+                             read.length, " cannot be gathered together");
+  }
+  if (key->dtype() != config_.dtype || value->dtype() != config_.dtype ||
+      key->shape() !=
+          TensorShape({batch, config_.heads, length, config_.depth}) ||
+      value->shape() !=
+          TensorShape({batch, config_.heads, length, config_.value_depth}))
+    return MakeStringError("KV cache gathers keys [", batch, ", ",
+                           config_.heads, ", ", length, ", ", config_.depth,
+                           "] and values [", batch, ", ", config_.heads, ", ",
+                           length, ", ", config_.value_depth, "], got ",
+                           key->shape(), " and ", value->shape());
+
+  char* key_data = static_cast<char*>(key->data());
+  char* value_data = static_cast<char*>(value->data());
+  const size_t key_row_bytes = head_key_bytes_ / kBlockTokens;
+  const size_t value_row_bytes = head_value_bytes_ / kBlockTokens;
+  for (Index b = 0; b < batch; ++b) {
+    for (Index h = 0; h < config_.heads; ++h) {
+      const Index head = b * config_.heads + h;
+      char* head_keys = key_data + head * length * key_row_bytes;
+      char* head_values = value_data + head * length * value_row_bytes;
+      ForEachRun(reads[b].blocks, key_offset(h), key_row_bytes, 0, length,
+                 [&](char* block_rows, size_t size, size_t index) {
+                   std::memcpy(head_keys + index, block_rows, size);
+                 });
+      ForEachRun(reads[b].blocks, value_offset(h), value_row_bytes, 0, length,
+                 [&](char* block_rows, size_t size, size_t index) {
+                   std::memcpy(head_values + index, block_rows, size);
+                 });
+    }
+  }
+  return Error::success();
+}
+
+void KVCache::Free(int64_t sequence) {
+  mutex_lock lock(mu_);
+  auto it = sequences_.find(sequence);
+  if (it == sequences_.end()) return;
+  for (auto& block : it->second.blocks)
+    free_blocks_.push_back(std::move(block));
+  sequences_.erase(it);
+}
+
+Expected<KVCache*> GetOrCreateKVCache(ResourceContext* resource_context,
+                                      const std::string& name,
+                                      const KVCache::Config& config,
+                                      HostAllocator* allocator) {
+  auto* cache = resource_context->GetOrCreateResource<KVCache>(
+      kResourcePrefix + name, config, allocator);
+  const KVCache::Config& cached = cache->config();
+  if (cached.dtype != config.dtype || cached.heads != config.heads ||
+      cached.depth != config.depth || cached.value_depth != config.value_depth)
+    return MakeStringError("KV cache ", name, " holds ", cached.dtype, " [",
+                           cached.heads, ", ", cached.depth, "] keys and [",
+                           cached.heads, ", ", cached.value_depth,
+                           "] values, got ", config.dtype, " [", config.heads,
+                           ", ", config.depth, "] and [", config.heads, ", ",
+                           config.value_depth, "]");
+  return cache;
+}
+
+Expected<KVCache*> GetKVCache(ResourceContext* resource_context,
+                              const std::string& name) {
+  auto cache = resource_context->GetResource<KVCache>(kResourcePrefix + name);
+  if (!cache) return MakeStringError("KV cache ", name, " does not exist");
+  return *cache;
+}
+
+}  // namespace cpu
+}  // namespace tfrt
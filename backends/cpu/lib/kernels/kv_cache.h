@@ -0,0 +1,147 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Paged key/value cache for incremental decoding.
+//
+// A KVCache keeps the keys and values of the past tokens of every sequence
+// across executions, so that a decoding step appends the keys and values of
+// its new tokens instead of feeding those of the whole sequence again. The
+// memory of the cache is preallocated as a pool of blocks of kBlockTokens
+// tokens, and every sequence holds the list of blocks that its tokens were
+// appended to. A block holds the keys, [heads, kBlockTokens, depth], followed
+// by the values, [heads, kBlockTokens, value_depth], so that the keys and the
+// values of a head in a block are contiguous and attention reads them in place
+// (see KVCacheAttention in attention_kernel.h).
+
+#ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_KV_CACHE_H_
+#define TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_KV_CACHE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_buffer.h"
+#include "tfrt/host_context/resource_context.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+namespace cpu {
+
+class KVCache {
+ public:
+  static constexpr Index kBlockTokens = 64;
+  static constexpr Index kDefaultNumBlocks = 1024;
+
+  // The dtype and the dimensions of the cached keys and values, and the
+  // number of blocks of the pool.
+  struct Config {
+    DType dtype;
+    Index heads = 0;
+    Index depth = 0;
+    Index value_depth = 0;
+    Index num_blocks = kDefaultNumBlocks;
+  };
+
+  // The blocks that hold the `length` tokens of a sequence. The references
+  // keep the blocks from being reused by other sequences while they are read.
+  struct Sequence {
+    Index length = 0;
+    llvm::SmallVector<RCReference<HostBuffer>, 4> blocks;
+  };
+
+  // Allocates the blocks of the pool with `allocator`. The pool of a cache
+  // whose allocation failed has no blocks.
+  KVCache(const Config& config, HostAllocator* allocator);
+
+  const Config& config() const { return config_; }
+
+  // Returns the number of blocks that no sequence holds.
+  Index num_free_blocks() const;
+
+  // Appends the keys [batch, heads, tokens, depth] and the values [batch,
+  // heads, tokens, value_depth] of the new tokens of `sequences`, a batch of
+  // sequence ids, and returns the new lengths of the sequences. Sequences that
+  // were never appended to, or were freed, start empty. Nothing is appended if
+  // the pool does not have enough blocks for the whole batch.
+  Expected<llvm::SmallVector<Index, 4>> Append(
+      llvm::ArrayRef<int64_t> sequences, const DenseHostTensor& key,
+      const DenseHostTensor& value);
+
+  // Returns the blocks of `sequence`, which can be read until the returned
+  // value is destroyed, even if tokens are appended to the sequence or it is
+  // freed in the meantime.
+  Sequence Read(int64_t sequence) const;
+
+  // Copies the cached keys and values of `sequences`, which must have the
+  // same length, to `key` [batch, heads, length, depth] and `value` [batch,
+  // heads, length, value_depth].
+  Error Gather(llvm::ArrayRef<int64_t> sequences, DenseHostTensor* key,
+               DenseHostTensor* value) const;
+
+  // Returns the blocks of `sequence` to the pool.
+  void Free(int64_t sequence);
+
+  // Returns the keys, and the values, of `head` in `block`.
+  const void* keys(const HostBuffer& block, Index head) const {
+    return static_cast<const char*>(block.data()) + key_offset(head);
+  }
+  const void* values(const HostBuffer& block, Index head) const {
+    return static_cast<const char*>(block.data()) + value_offset(head);
+  }
+
+ private:
+  size_t key_offset(Index head) const { return head * head_key_bytes_; }
+  size_t value_offset(Index head) const {
+    return config_.heads * head_key_bytes_ + head * head_value_bytes_;
+  }
+
+  // Returns a block that nobody, including the readers of the sequences it
+  // was freed from, references.
+  RCReference<HostBuffer> AllocateBlock() TFRT_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const Config config_;
+  const size_t head_key_bytes_;
+  const size_t head_value_bytes_;
+
+  mutable mutex mu_;
+  std::vector<RCReference<HostBuffer>> free_blocks_ TFRT_GUARDED_BY(mu_);
+  llvm::DenseMap<int64_t, Sequence> sequences_ TFRT_GUARDED_BY(mu_);
+};
+
+// Returns the KVCache named `name` of `resource_context`, which is created
+// with `config` if it does not exist yet. Returns an error if the cached keys
+// and values do not have the dtype and the dimensions of `config`.
+Expected<KVCache*> GetOrCreateKVCache(ResourceContext* resource_context,
+                                      const std::string& name,
+                                      const KVCache::Config& config,
+                                      HostAllocator* allocator);
+
+// Returns the existing KVCache named `name` of `resource_context`.
+Expected<KVCache*> GetKVCache(ResourceContext* resource_context,
+                              const std::string& name);
+
+}  // namespace cpu
+}  // namespace tfrt
+
+#endif  // TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_KV_CACHE_H_
@@ -19,7 +19,10 @@
 #ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_MATMUL_KERNEL_H_
 #define TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_MATMUL_KERNEL_H_
 
+#include <type_traits>
+
 #include "tfrt/common/compat/eigen/contraction_kernel.h"
+#include "tfrt/common/compat/eigen/eigen_dtype.h"
 #include "tfrt/common/compat/eigen/eigen_kernel.h"
 #include "tfrt/common/compat/eigen/tensor_types.h"
 #include "tfrt/host_context/kernel_utils.h"
@@ -27,15 +30,15 @@
 namespace tfrt {
 namespace cpu {
 
-// General matrix multiplication kernel:
-//   C = alpha * AB + beta * C
-//
-// Link: https://en.wikipedia.org/wiki/Basic_Linear_Algebra_Subprograms#Level_3
+namespace internal {
+
+// Computes the matrix multiplication in T.
 template <typename T, typename OutputKernel, typename EigenEvaluator>
-typename EigenEvaluator::DependencyToken MatMul(
+typename EigenEvaluator::DependencyToken MatMulImpl(
     float alpha, const DenseHostTensor& a, const DenseHostTensor& b, float beta,
     DenseHostTensor* c, bool transpose_a, bool transpose_b,
-    OutputKernel output_kernel, EigenEvaluator eigen) {
+    OutputKernel output_kernel, EigenEvaluator eigen,
+    std::false_type /*accumulate_in_float*/) {
   DHTIndexableView<T, 2> a_view(&a);
   DHTIndexableView<T, 2> b_view(&b);
   MutableDHTIndexableView<T, 2> c_view(c);
@@ -70,6 +73,70 @@ typename EigenEvaluator::DependencyToken MatMul(
   }
 }
 
+// Computes the matrix multiplication of 16-bit floating point values in float,
+// and rounds the result to T once. The output kernel operates on the float
+// accumulators.
+template <typename T, typename OutputKernel, typename EigenEvaluator>
+typename EigenEvaluator::DependencyToken MatMulImpl(
+    float alpha, const DenseHostTensor& a, const DenseHostTensor& b, float beta,
+    DenseHostTensor* c, bool transpose_a, bool transpose_b,
+    OutputKernel output_kernel, EigenEvaluator eigen,
+    std::true_type /*accumulate_in_float*/) {
+  using Acc = compat::AccumulatorType<T>;
+
+  DHTIndexableView<T, 2> a_view(&a);
+  DHTIndexableView<T, 2> b_view(&b);
+  MutableDHTIndexableView<T, 2> c_view(c);
+
+  // Contraction dimension.
+  Eigen::array<Eigen::IndexPair<Eigen::Index>, 1> contract_dim;
+  contract_dim[0].first = transpose_a ? 0 : 1;
+  contract_dim[0].second = transpose_b ? 1 : 0;
+
+  auto in0 = compat::AsEigenConstTensor(a_view).template cast<Acc>();
+  auto in1 = compat::AsEigenConstTensor(b_view).template cast<Acc>();
+  auto out = compat::AsEigenTensor(c_view);
+
+  auto buffers = eigen.KeepAlive(&a, &b, c);
+
+  auto contract_expr = in0.contract(in1, contract_dim, output_kernel);
+
+  if (alpha == 1.0 && beta == 0.0) {
+    // Expression: C = AB
+    auto expr = contract_expr.template cast<T>();
+    return eigen.Evaluate(std::move(out), std::move(expr), std::move(buffers));
+
+  } else {
+    // Expression: C = alpha * AB + beta * C
+    auto expr = (contract_expr * static_cast<Acc>(alpha) +
+                 out.template cast<Acc>() * static_cast<Acc>(beta))
+                    .template cast<T>();
+    return eigen.Evaluate(std::move(out), std::move(expr), std::move(buffers));
+  }
+}
+
+}  // namespace internal
+
+// General matrix multiplication kernel:
+//   C = alpha * AB + beta * C
+//
+// 16-bit floating point matrices are multiplied with float accumulation (see
+// compat::AccumulatorType), and `output_kernel` must accept float blocks.
+//
+// Link: https://en.wikipedia.org/wiki/Basic_Linear_Algebra_Subprograms#Level_3
+template <typename T, typename OutputKernel, typename EigenEvaluator>
+typename EigenEvaluator::DependencyToken MatMul(
+    float alpha, const DenseHostTensor& a, const DenseHostTensor& b, float beta,
+    DenseHostTensor* c, bool transpose_a, bool transpose_b,
+    OutputKernel output_kernel, EigenEvaluator eigen) {
+  using Acc = compat::AccumulatorType<T>;
+  using AccumulateInFloat =
+      std::integral_constant<bool, !std::is_same<Acc, T>::value>;
+  return internal::MatMulImpl<T>(alpha, a, b, beta, c, transpose_a,
+                                 transpose_b, std::move(output_kernel),
+                                 std::move(eigen), AccumulateInFloat());
+}
+
 }  // namespace cpu
 }  // namespace tfrt
 
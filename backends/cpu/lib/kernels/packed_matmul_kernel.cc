@@ -0,0 +1,119 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Packed MatMul weight cache and microkernel implementation.
+
+#include "./packed_matmul_kernel.h"
+
+// On x86 the float microkernel is also compiled for AVX-512 and AVX2, and the
+// loader resolves it to the widest version the CPU supports. Elsewhere it uses
+// the instruction set of the build, e.g. NEON on AArch64.
+#if defined(__x86_64__) && defined(__linux__) && defined(__GNUC__)
+#define TFRT_PACKED_MATMUL_TARGET_CLONES \
+  __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define TFRT_PACKED_MATMUL_TARGET_CLONES
+#endif
+
+namespace tfrt {
+namespace cpu {
+namespace {
+
+// The number of buffers seen once that are remembered. Most of them are
+// activations that are never seen again, so the set is simply cleared when it
+// grows too large.
+constexpr size_t kMaxSeenOnce = 4096;
+
+// Depth blocks shorter than this do not amortize the accumulator loads and
+// stores of the microkernel.
+constexpr Index kMinDepthBlock = 64;
+
+}  // namespace
+
+namespace internal {
+
+Index GetPackedMatMulDepthBlock(size_t panel_row_bytes) {
+  // Half of the L1 cache holds the panel slice, and the rest the lhs rows and
+  // the accumulators.
+  static const size_t l1_cache_size = Eigen::l1CacheSize();
+  return std::max<Index>(kMinDepthBlock, l1_cache_size / 2 / panel_row_bytes);
+}
+
+TFRT_PACKED_MATMUL_TARGET_CLONES
+void PackedMatMulRows(Index rows, const float* a, Index a_row_stride,
+                      Index a_depth_stride, const float* panel, Index depth,
+                      float* acc) {
+  constexpr Index kPanelWidth = PackedMatMulWeights<float>::kPanelWidth;
+  switch (rows) {
+    case 4:
+      return PackedMatMulMicrokernel<4, kPanelWidth>(
+          a, a_row_stride, a_depth_stride, panel, depth, acc);
+    case 3:
+      return PackedMatMulMicrokernel<3, kPanelWidth>(
+          a, a_row_stride, a_depth_stride, panel, depth, acc);
+    case 2:
+      return PackedMatMulMicrokernel<2, kPanelWidth>(
+          a, a_row_stride, a_depth_stride, panel, depth, acc);
+    default:
+      return PackedMatMulMicrokernel<1, kPanelWidth>(
+          a, a_row_stride, a_depth_stride, panel, depth, acc);
+  }
+}
+
+}  // namespace internal
+
+size_t PackedWeightCache::size_bytes() const {
+  mutex_lock lock(mu_);
+  return size_bytes_;
+}
+
+std::shared_ptr<const void> PackedWeightCache::Lookup(const Key& key,
+                                                      bool* pack) {
+  mutex_lock lock(mu_);
+  auto it = entries_.find(key);
+  if (it != entries_.end()) return it->second.packed;
+
+  if (seen_once_.erase(key)) {
+    *pack = true;
+    return nullptr;
+  }
+  if (seen_once_.size() >= kMaxSeenOnce) seen_once_.clear();
+  seen_once_.insert(key);
+  return nullptr;
+}
+
+void PackedWeightCache::Insert(const Key& key, RCReference<HostBuffer> buffer,
+                               std::shared_ptr<const void> packed,
+                               size_t size_bytes) {
+  mutex_lock lock(mu_);
+  if (size_bytes_ + size_bytes > max_bytes_) {
+    // Drop the weights whose buffers are only referenced by the cache.
+    for (auto it = entries_.begin(); it != entries_.end();) {
+      auto current = it++;
+      if (!current->second.buffer->IsUnique()) continue;
+      size_bytes_ -= current->second.size_bytes;
+      entries_.erase(current);
+    }
+  }
+  if (size_bytes_ + size_bytes > max_bytes_) return;
+
+  auto inserted = entries_.try_emplace(
+      key, Entry{std::move(buffer), std::move(packed), size_bytes});
+  if (inserted.second) size_bytes_ += size_bytes;
+}
+
+}  // namespace cpu
+}  // namespace tfrt
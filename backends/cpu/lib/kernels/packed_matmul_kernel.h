@@ -0,0 +1,433 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Pre-packed weights for small-batch matrix multiplication.
+//
+// Eigen tensor contraction packs both of its operands into panels on every
+// evaluation. For inference the rhs of a MatMul is almost always a constant
+// weight, and with only a few rows in the lhs, repacking the weights dominates
+// the cost of the multiplication. PackedMatMulWeights packs the rhs once into
+// column panels that the PackedMatMul kernel reads sequentially, and
+// PackedWeightCache keeps them in the ResourceContext keyed by the id of the
+// HostBuffer of the weight tensor.
+//
+// The kernel is register blocked: its microkernel multiplies a few lhs rows
+// with a panel at once, over slices of the panel sized to the L1 cache.
+
+#ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_PACKED_MATMUL_KERNEL_H_
+#define TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_PACKED_MATMUL_KERNEL_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "tfrt/common/compat/eigen/contraction_output_kernel.h"
+#include "tfrt/common/compat/eigen/eigen_dtype.h"
+#include "tfrt/common/compat/eigen/eigen_evaluator.h"
+#include "tfrt/common/compat/eigen/tensor_types.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_buffer.h"
+#include "tfrt/host_context/resource_context.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+
+namespace tfrt {
+namespace cpu {
+
+// MatMuls with at most this many lhs rows use the packed weights. Larger
+// matrix multiplications amortize the packing done by Eigen, and benefit from
+// its cache blocking.
+constexpr Index kPackedMatMulMaxRows = 32;
+
+// Rhs matrix [K, N] packed into panels of kPanelWidth columns. Each panel is
+// stored as K contiguous rows of kPanelWidth elements, padded with zeros past
+// the last column. The elements are converted to the accumulator type, so that
+// 16-bit floating point weights are converted once when they are packed.
+template <typename T>
+class PackedMatMulWeights {
+ public:
+  using Accumulator = compat::AccumulatorType<T>;
+
+  static constexpr Index kPanelWidth =
+      std::max<Index>(1, 64 / sizeof(Accumulator));
+
+  // Packs `b`, which is a [K, N] matrix, or a [N, K] matrix if `transpose_b`.
+  PackedMatMulWeights(const DenseHostTensor& b, bool transpose_b)
+      : depth_(b.shape().GetDimensionSize(transpose_b ? 1 : 0)),
+        cols_(b.shape().GetDimensionSize(transpose_b ? 0 : 1)),
+        data_(num_panels() * depth_ * kPanelWidth, Accumulator(0)) {
+    const T* src = DHTArrayView<T>(&b).data();
+    for (Index col = 0; col < cols_; ++col) {
+      Accumulator* dst = data_.data() +
+                         (col / kPanelWidth) * depth_ * kPanelWidth +
+                         col % kPanelWidth;
+      for (Index k = 0; k < depth_; ++k) {
+        dst[k * kPanelWidth] = static_cast<Accumulator>(
+            transpose_b ? src[col * depth_ + k] : src[k * cols_ + col]);
+      }
+    }
+  }
+
+  // Returns true if the weights were packed from a tensor of `b` shape.
+  bool Matches(const DenseHostTensor& b, bool transpose_b) const {
+    return b.shape().GetRank() == 2 &&
+           b.shape().GetDimensionSize(transpose_b ? 1 : 0) == depth_ &&
+           b.shape().GetDimensionSize(transpose_b ? 0 : 1) == cols_;
+  }
+
+  Index depth() const { return depth_; }
+  Index cols() const { return cols_; }
+  Index num_panels() const { return (cols_ + kPanelWidth - 1) / kPanelWidth; }
+  size_t size_bytes() const { return data_.size() * sizeof(Accumulator); }
+
+  const Accumulator* panel(Index p) const {
+    return data_.data() + p * depth_ * kPanelWidth;
+  }
+
+ private:
+  Index depth_;
+  Index cols_;
+  std::vector<Accumulator, Eigen::aligned_allocator<Accumulator>> data_;
+};
+
+// Caches packed weights by the id of the weight HostBuffer. A buffer is packed
+// the second time it is seen, so that the activations that flow through a
+// MatMul rhs once are not packed. The buffers seen once are remembered by id
+// only, so that the cache does not keep activations alive or prevent their
+// forwarding, and a new buffer at the address of a destroyed one is not taken
+// for it. The cache holds a reference to the packed buffers, which guarantees
+// that they are not forwarded to an op that mutates them in place.
+class PackedWeightCache {
+ public:
+  static constexpr const char* kResourceName = "tfrt.cpu.packed_weight_cache";
+  static constexpr size_t kDefaultMaxBytes = 256 * 1024 * 1024;
+
+  explicit PackedWeightCache(size_t max_bytes = kDefaultMaxBytes)
+      : max_bytes_(max_bytes) {}
+
+  // Returns the packed weights of `b`, or nullptr if `b` should not be packed
+  // yet.
+  template <typename T>
+  std::shared_ptr<const PackedMatMulWeights<T>> GetOrPack(
+      const DenseHostTensor& b, bool transpose_b) {
+    if (!b.buffer()) return nullptr;
+    const Key key = MakeKey(b, transpose_b);
+
+    bool pack = false;
+    if (auto cached = Lookup(key, &pack)) {
+      auto weights =
+          std::static_pointer_cast<const PackedMatMulWeights<T>>(cached);
+      return weights->Matches(b, transpose_b) ? weights : nullptr;
+    }
+    if (!pack) return nullptr;
+
+    auto weights =
+        std::make_shared<const PackedMatMulWeights<T>>(b, transpose_b);
+    Insert(key, b.buffer().CopyRef(), weights, weights->size_bytes());
+    return weights;
+  }
+
+  // Returns the total size of the cached packed weights.
+  size_t size_bytes() const;
+
+ private:
+  // Weight buffer id, dtype and transpose_b.
+  using Key = std::pair<uint64_t, unsigned>;
+
+  struct Entry {
+    RCReference<HostBuffer> buffer;
+    std::shared_ptr<const void> packed;
+    size_t size_bytes;
+  };
+
+  static Key MakeKey(const DenseHostTensor& b, bool transpose_b) {
+    return {b.buffer()->id(),
+            static_cast<unsigned>(b.dtype()) * 2 + (transpose_b ? 1 : 0)};
+  }
+
+  // Returns the cached weights for `key`, or nullptr and sets `pack` if this is
+  // the second time `key` is seen.
+  std::shared_ptr<const void> Lookup(const Key& key, bool* pack);
+
+  // Inserts the packed weights if they fit in the cache, after dropping the
+  // weights of the buffers that nobody else references anymore.
+  void Insert(const Key& key, RCReference<HostBuffer> buffer,
+              std::shared_ptr<const void> packed, size_t size_bytes);
+
+  const size_t max_bytes_;
+
+  mutable mutex mu_;
+  size_t size_bytes_ TFRT_GUARDED_BY(mu_) = 0;
+  llvm::DenseMap<Key, Entry> entries_ TFRT_GUARDED_BY(mu_);
+  llvm::DenseSet<Key> seen_once_ TFRT_GUARDED_BY(mu_);
+};
+
+// Returns the packed weights of `b`, if a MatMul of `a` and `b` should use
+// PackedMatMul.
+template <typename T>
+std::shared_ptr<const PackedMatMulWeights<T>> GetPackedMatMulWeights(
+    const ExecutionContext& exec_ctx, const DenseHostTensor& a,
+    const DenseHostTensor& b, bool transpose_a, bool transpose_b) {
+  if (a.shape().GetDimensionSize(transpose_a ? 1 : 0) > kPackedMatMulMaxRows)
+    return nullptr;
+
+  ResourceContext* resource_context = exec_ctx.resource_context();
+  if (resource_context == nullptr) return nullptr;
+
+  auto* cache = resource_context->GetOrCreateResource<PackedWeightCache>(
+      PackedWeightCache::kResourceName);
+  return cache->GetOrPack<T>(b, transpose_b);
+}
+
+// PackedMatMul epilogue that leaves the accumulators as is.
+struct NoOpPackedEpilogue {
+  template <typename Accumulator>
+  void operator()(Accumulator* acc, Index row, Index col,
+                  Index num_cols) const {}
+};
+
+// PackedMatMul epilogue that adds bias to the accumulators of an output row,
+// and optionally applies activation function specified by `Activation` type
+// parameter.
+template <typename T, typename Activation = compat::Identity>
+class BiasAddPackedEpilogue {
+  using Accumulator = compat::AccumulatorType<T>;
+  using Vec = Eigen::Tensor<Accumulator, 1, Eigen::RowMajor, Index>;
+  using BiasVec = Eigen::Tensor<const T, 1, Eigen::RowMajor, Index>;
+
+ public:
+  explicit BiasAddPackedEpilogue(const T* bias,
+                                 Activation activation = Activation())
+      : bias_(bias), activation_(activation) {}
+
+  void operator()(Accumulator* acc, Index row, Index col,
+                  Index num_cols) const {
+    Eigen::TensorMap<BiasVec, Eigen::Unaligned> bias(bias_ + col, num_cols);
+    Eigen::TensorMap<Vec, Eigen::Unaligned> out(acc, num_cols);
+    const auto expr = out + bias.template cast<Accumulator>();
+    out = activation_.template apply<decltype(expr)>(expr);
+  }
+
+ private:
+  const T* bias_;
+  Activation activation_;
+};
+
+// PackedMatMul epilogue that adds bias and then the residual, a [rows, cols]
+// matrix, to the accumulators of an output row, and optionally applies
+// activation function specified by `Activation` type parameter.
+template <typename T, typename Activation = compat::Identity>
+class BiasAddResidualPackedEpilogue {
+  using Accumulator = compat::AccumulatorType<T>;
+  using Vec = Eigen::Tensor<Accumulator, 1, Eigen::RowMajor, Index>;
+  using InputVec = Eigen::Tensor<const T, 1, Eigen::RowMajor, Index>;
+
+ public:
+  BiasAddResidualPackedEpilogue(const T* bias, const T* residual, Index cols,
+                                Activation activation = Activation())
+      : bias_(bias),
+        residual_(residual),
+        cols_(cols),
+        activation_(activation) {}
+
+  void operator()(Accumulator* acc, Index row, Index col,
+                  Index num_cols) const {
+    Eigen::TensorMap<InputVec, Eigen::Unaligned> bias(bias_ + col, num_cols);
+    Eigen::TensorMap<InputVec, Eigen::Unaligned> residual(
+        residual_ + row * cols_ + col, num_cols);
+    Eigen::TensorMap<Vec, Eigen::Unaligned> out(acc, num_cols);
+    const auto expr = out + bias.template cast<Accumulator>() +
+                      residual.template cast<Accumulator>();
+    out = activation_.template apply<decltype(expr)>(expr);
+  }
+
+ private:
+  const T* bias_;
+  const T* residual_;
+  Index cols_;
+  Activation activation_;
+};
+
+namespace internal {
+
+// The number of lhs rows the microkernel multiplies with a panel at once, so
+// that every load of the panel is reused for that many rows.
+constexpr Index kPackedMatMulMicroRows = 4;
+
+// Returns the number of rows of a panel, each `panel_row_bytes` long, that are
+// multiplied with the lhs rows before moving on to the next ones. A slice of
+// this depth stays in the L1 cache while it is multiplied with all the lhs
+// rows. The cache sizes are detected once at startup.
+Index GetPackedMatMulDepthBlock(size_t panel_row_bytes);
+
+// Accumulates the products of kRows lhs rows with `depth` rows of a panel into
+// `acc`, which holds kPanelWidth accumulators per lhs row.
+template <Index kRows, Index kPanelWidth, typename T, typename Accumulator>
+EIGEN_ALWAYS_INLINE void PackedMatMulMicrokernel(
+    const T* a, Index a_row_stride, Index a_depth_stride,
+    const Accumulator* panel, Index depth, Accumulator* acc) {
+  Accumulator sums[kRows][kPanelWidth];
+  for (Index r = 0; r < kRows; ++r) {
+    for (Index j = 0; j < kPanelWidth; ++j)
+      sums[r][j] = acc[r * kPanelWidth + j];
+  }
+
+  for (Index k = 0; k < depth; ++k) {
+    const Accumulator* b_row = panel + k * kPanelWidth;
+    for (Index r = 0; r < kRows; ++r) {
+      const auto a_value =
+          static_cast<Accumulator>(a[r * a_row_stride + k * a_depth_stride]);
+      for (Index j = 0; j < kPanelWidth; ++j) sums[r][j] += a_value * b_row[j];
+    }
+  }
+
+  for (Index r = 0; r < kRows; ++r) {
+    for (Index j = 0; j < kPanelWidth; ++j)
+      acc[r * kPanelWidth + j] = sums[r][j];
+  }
+}
+
+// Accumulates the products of `rows` lhs rows, at most kPackedMatMulMicroRows,
+// with `depth` rows of a panel into `acc`.
+template <typename T, typename Accumulator>
+void PackedMatMulRows(Index rows, const T* a, Index a_row_stride,
+                      Index a_depth_stride, const Accumulator* panel,
+                      Index depth, Accumulator* acc) {
+  constexpr Index kPanelWidth = PackedMatMulWeights<T>::kPanelWidth;
+  switch (rows) {
+    case 4:
+      return PackedMatMulMicrokernel<4, kPanelWidth>(
+          a, a_row_stride, a_depth_stride, panel, depth, acc);
+    case 3:
+      return PackedMatMulMicrokernel<3, kPanelWidth>(
+          a, a_row_stride, a_depth_stride, panel, depth, acc);
+    case 2:
+      return PackedMatMulMicrokernel<2, kPanelWidth>(
+          a, a_row_stride, a_depth_stride, panel, depth, acc);
+    default:
+      return PackedMatMulMicrokernel<1, kPanelWidth>(
+          a, a_row_stride, a_depth_stride, panel, depth, acc);
+  }
+}
+
+// PackedMatMulRows for float, which is compiled for several instruction sets
+// and picks the widest one the CPU supports at runtime.
+void PackedMatMulRows(Index rows, const float* a, Index a_row_stride,
+                      Index a_depth_stride, const float* panel, Index depth,
+                      float* acc);
+
+// Computes the output columns of the rhs panels [begin, end) for all rows.
+// The rows are computed kPackedMatMulMaxRows at a time, whose accumulators
+// stay in memory while the panel is multiplied with them one depth block
+// after another.
+template <typename T, typename Epilogue>
+void PackedMatMulPanels(const T* a, Index rows, bool transpose_a,
+                        const PackedMatMulWeights<T>& b, T* c,
+                        const Epilogue& epilogue, Index begin, Index end) {
+  using Accumulator = typename PackedMatMulWeights<T>::Accumulator;
+  constexpr Index kPanelWidth = PackedMatMulWeights<T>::kPanelWidth;
+  const Index depth = b.depth();
+  const Index cols = b.cols();
+  const Index a_row_stride = transpose_a ? 1 : depth;
+  const Index a_depth_stride = transpose_a ? rows : 1;
+  const Index depth_block =
+      GetPackedMatMulDepthBlock(kPanelWidth * sizeof(Accumulator));
+
+  Accumulator acc[kPackedMatMulMaxRows * kPanelWidth];
+  for (Index p = begin; p < end; ++p) {
+    const Accumulator* panel = b.panel(p);
+    const Index col = p * kPanelWidth;
+    const Index num_cols = std::min(kPanelWidth, cols - col);
+
+    for (Index row_begin = 0; row_begin < rows;
+         row_begin += kPackedMatMulMaxRows) {
+      const Index num_rows = std::min(kPackedMatMulMaxRows, rows - row_begin);
+      std::fill_n(acc, num_rows * kPanelWidth, Accumulator(0));
+
+      for (Index k = 0; k < depth; k += depth_block) {
+        const Index block_depth = std::min(depth_block, depth - k);
+        for (Index r = 0; r < num_rows; r += kPackedMatMulMicroRows) {
+          PackedMatMulRows(
+              std::min(kPackedMatMulMicroRows, num_rows - r),
+              a + (row_begin + r) * a_row_stride + k * a_depth_stride,
+              a_row_stride, a_depth_stride, panel + k * kPanelWidth,
+              block_depth, acc + r * kPanelWidth);
+        }
+      }
+
+      for (Index r = 0; r < num_rows; ++r) {
+        Accumulator* row_acc = acc + r * kPanelWidth;
+        epilogue(row_acc, row_begin + r, col, num_cols);
+
+        T* c_row = c + (row_begin + r) * cols + col;
+        for (Index j = 0; j < num_cols; ++j)
+          c_row[j] = static_cast<T>(row_acc[j]);
+      }
+    }
+  }
+}
+
+}  // namespace internal
+
+// Matrix multiplication with pre-packed rhs:
+//   C = epilogue(AB)
+//
+// The rhs panels are computed in parallel. The products are accumulated, and
+// the epilogue is applied, in compat::AccumulatorType<T>. The epilogue is
+// called with the accumulators of `num_cols` columns of an output row, starting
+// at (`row`, `col`).
+template <typename T, typename Epilogue, typename EigenEvaluator>
+typename EigenEvaluator::DependencyToken PackedMatMul(
+    const DenseHostTensor& a, std::shared_ptr<const PackedMatMulWeights<T>> b,
+    DenseHostTensor* c, bool transpose_a, Epilogue epilogue,
+    EigenEvaluator eigen) {
+  const Index rows = c->shape().GetDimensionSize(0);
+  const T* a_data = DHTArrayView<T>(&a).data();
+  T* c_data = MutableDHTArrayView<T>(c).data();
+  const PackedMatMulWeights<T>* weights = b.get();
+
+  // The cost of computing one panel.
+  constexpr Index kPanelWidth = PackedMatMulWeights<T>::kPanelWidth;
+  using Accumulator = typename PackedMatMulWeights<T>::Accumulator;
+  const double panel_size = weights->depth() * kPanelWidth;
+  Eigen::TensorOpCost cost(
+      panel_size * sizeof(Accumulator) + rows * weights->depth() * sizeof(T),
+      rows * kPanelWidth * sizeof(T),
+      rows * panel_size *
+          (Eigen::TensorOpCost::AddCost<Accumulator>() +
+           Eigen::TensorOpCost::MulCost<Accumulator>()));
+
+  return eigen.ParallelFor(
+      weights->num_panels(), cost,
+      [=](Eigen::Index begin, Eigen::Index end) {
+        internal::PackedMatMulPanels<T>(a_data, rows, transpose_a, *weights,
+                                        c_data, epilogue, begin, end);
+      },
+      std::make_tuple(eigen.KeepAlive(&a, c), std::move(b)));
+}
+
+}  // namespace cpu
+}  // namespace tfrt
+
+#endif  // TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_PACKED_MATMUL_KERNEL_H_
@@ -0,0 +1,304 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements the scanner for serialized tfrt::proto::Example
+// messages.
+
+#include "example_scanner.h"
+
+#include <cstring>
+
+namespace tfrt {
+namespace proto {
+namespace {
+
+enum WireType : uint32_t {
+  kVarint = 0,
+  kFixed64 = 1,
+  kLengthDelimited = 2,
+  kStartGroup = 3,
+  kEndGroup = 4,
+  kFixed32 = 5,
+};
+
+// Reads the fields of a serialized message in order.
+class WireReader {
+ public:
+  explicit WireReader(string_view data)
+      : pos_(data.begin()), end_(data.end()) {}
+
+  bool done() const { return pos_ == end_; }
+
+  bool ReadTag(uint32_t* field, WireType* type) {
+    uint64_t tag;
+    if (!ReadVarint(&tag) || tag > UINT32_MAX) return false;
+    *field = static_cast<uint32_t>(tag >> 3);
+    *type = static_cast<WireType>(tag & 7);
+    return *field != 0;
+  }
+
+  bool ReadVarint(uint64_t* value) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64 && pos_ != end_; shift += 7) {
+      const uint8_t byte = *pos_++;
+      result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) {
+        *value = result;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool ReadFixed32(uint32_t* value) {
+    if (end_ - pos_ < 4) return false;
+    // The wire format is little endian.
+    *value = static_cast<uint32_t>(static_cast<uint8_t>(pos_[0])) |
+             static_cast<uint32_t>(static_cast<uint8_t>(pos_[1])) << 8 |
+             static_cast<uint32_t>(static_cast<uint8_t>(pos_[2])) << 16 |
+             static_cast<uint32_t>(static_cast<uint8_t>(pos_[3])) << 24;
+    pos_ += 4;
+    return true;
+  }
+
+  bool ReadLengthDelimited(string_view* value) {
+    uint64_t size;
+    if (!ReadVarint(&size) || size > static_cast<uint64_t>(end_ - pos_))
+      return false;
+    *value = string_view(pos_, size);
+    pos_ += size;
+    return true;
+  }
+
+  bool SkipField(WireType type) {
+    uint64_t varint;
+    string_view bytes;
+    switch (type) {
+      case kVarint:
+        return ReadVarint(&varint);
+      case kFixed64:
+        if (end_ - pos_ < 8) return false;
+        pos_ += 8;
+        return true;
+      case kLengthDelimited:
+        return ReadLengthDelimited(&bytes);
+      case kFixed32:
+        if (end_ - pos_ < 4) return false;
+        pos_ += 4;
+        return true;
+      default:
+        // Example and its fields do not have groups.
+        return false;
+    }
+  }
+
+ private:
+  const char* pos_;
+  const char* end_;
+};
+
+// Scans a serialized Features message.
+bool ScanFeatures(string_view features,
+                  const llvm::StringMap<size_t>& key_indices,
+                  MutableArrayRef<std::optional<string_view>> result) {
+  WireReader reader(features);
+  while (!reader.done()) {
+    uint32_t field;
+    WireType type;
+    if (!reader.ReadTag(&field, &type)) return false;
+    if (field != 1 || type != kLengthDelimited) {
+      if (!reader.SkipField(type)) return false;
+      continue;
+    }
+
+    // A map entry, with the key as field 1 and the Feature as field 2.
+    string_view entry;
+    if (!reader.ReadLengthDelimited(&entry)) return false;
+    string_view key, value;
+    WireReader entry_reader(entry);
+    while (!entry_reader.done()) {
+      if (!entry_reader.ReadTag(&field, &type)) return false;
+      if ((field == 1 || field == 2) && type == kLengthDelimited) {
+        if (!entry_reader.ReadLengthDelimited(field == 1 ? &key : &value))
+          return false;
+      } else if (!entry_reader.SkipField(type)) {
+        return false;
+      }
+    }
+
+    auto it = key_indices.find(key);
+    if (it != key_indices.end()) result[it->second] = value;
+  }
+  return true;
+}
+
+// Calls `fn` with the reader positioned at every value of the value lists
+// `lists`, and the wire type of the value. Packed and unpacked values are
+// both accepted.
+template <typename F>
+bool ForEachValue(ArrayRef<string_view> lists, WireType scalar_type, F fn) {
+  for (string_view list : lists) {
+    WireReader reader(list);
+    while (!reader.done()) {
+      uint32_t field;
+      WireType type;
+      if (!reader.ReadTag(&field, &type)) return false;
+      if (field != 1) {
+        if (!reader.SkipField(type)) return false;
+        continue;
+      }
+      if (type == scalar_type) {
+        if (!fn(reader)) return false;
+      } else if (type == kLengthDelimited) {
+        string_view packed;
+        if (!reader.ReadLengthDelimited(&packed)) return false;
+        WireReader packed_reader(packed);
+        while (!packed_reader.done()) {
+          if (!fn(packed_reader)) return false;
+        }
+      } else {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+bool ScanExample(string_view example,
+                 const llvm::StringMap<size_t>& key_indices,
+                 MutableArrayRef<std::optional<string_view>> features) {
+  WireReader reader(example);
+  while (!reader.done()) {
+    uint32_t field;
+    WireType type;
+    if (!reader.ReadTag(&field, &type)) return false;
+    if (field != 1 || type != kLengthDelimited) {
+      if (!reader.SkipField(type)) return false;
+      continue;
+    }
+    // Repeated Features messages are merged.
+    string_view value;
+    if (!reader.ReadLengthDelimited(&value) ||
+        !ScanFeatures(value, key_indices, features))
+      return false;
+  }
+  return true;
+}
+
+bool ScannedFeature::Parse(string_view feature) {
+  kind_ = Kind::kNone;
+  lists_.clear();
+  WireReader reader(feature);
+  while (!reader.done()) {
+    uint32_t field;
+    WireType type;
+    if (!reader.ReadTag(&field, &type)) return false;
+    if (field < 1 || field > 3 || type != kLengthDelimited) {
+      if (!reader.SkipField(type)) return false;
+      continue;
+    }
+    string_view list;
+    if (!reader.ReadLengthDelimited(&list)) return false;
+    // The last field of the oneof wins.
+    const Kind kind = static_cast<Kind>(field);
+    if (kind != kind_) {
+      kind_ = kind;
+      lists_.clear();
+    }
+    lists_.push_back(list);
+  }
+  return true;
+}
+
+int64_t ScannedFeature::CountValues() const {
+  int64_t count = 0;
+  bool valid = true;
+  switch (kind_) {
+    case Kind::kNone:
+      break;
+    case Kind::kInt64List:
+      valid = ForEachValue(lists_, kVarint, [&](WireReader& reader) {
+        uint64_t value;
+        ++count;
+        return reader.ReadVarint(&value);
+      });
+      break;
+    case Kind::kFloatList:
+      valid = ForEachValue(lists_, kFixed32, [&](WireReader& reader) {
+        uint32_t value;
+        ++count;
+        return reader.ReadFixed32(&value);
+      });
+      break;
+    case Kind::kBytesList:
+      // Bytes values are never packed.
+      for (string_view list : lists_) {
+        WireReader reader(list);
+        while (!reader.done()) {
+          uint32_t field;
+          WireType type;
+          if (!reader.ReadTag(&field, &type)) return -1;
+          if (field == 1 && type == kLengthDelimited) ++count;
+          if (!reader.SkipField(type)) return -1;
+        }
+      }
+      break;
+  }
+  return valid ? count : -1;
+}
+
+bool ScannedFeature::GetInt64Values(int64_t* output) const {
+  if (kind_ != Kind::kInt64List) return false;
+  return ForEachValue(lists_, kVarint, [&](WireReader& reader) {
+    uint64_t value;
+    if (!reader.ReadVarint(&value)) return false;
+    *output++ = static_cast<int64_t>(value);
+    return true;
+  });
+}
+
+bool ScannedFeature::GetFloatValues(float* output) const {
+  if (kind_ != Kind::kFloatList) return false;
+  return ForEachValue(lists_, kFixed32, [&](WireReader& reader) {
+    uint32_t bits;
+    if (!reader.ReadFixed32(&bits)) return false;
+    std::memcpy(output++, &bits, sizeof(bits));
+    return true;
+  });
+}
+
+bool ScannedFeature::GetBytesValues(std::string* output) const {
+  if (kind_ != Kind::kBytesList) return false;
+  for (string_view list : lists_) {
+    WireReader reader(list);
+    while (!reader.done()) {
+      uint32_t field;
+      WireType type;
+      if (!reader.ReadTag(&field, &type)) return false;
+      if (field != 1 || type != kLengthDelimited) {
+        if (!reader.SkipField(type)) return false;
+        continue;
+      }
+      string_view value;
+      if (!reader.ReadLengthDelimited(&value)) return false;
+      output++->assign(value.data(), value.size());
+    }
+  }
+  return true;
+}
+
+}  // namespace proto
+}  // namespace tfrt
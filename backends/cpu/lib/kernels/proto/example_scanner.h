@@ -0,0 +1,73 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file declares a scanner for the protobuf wire format of serialized
+// tfrt::proto::Example messages, which extracts features without parsing the
+// whole message.
+
+#ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_PROTO_EXAMPLE_SCANNER_H_
+#define TFRT_BACKENDS_CPU_LIB_KERNELS_PROTO_EXAMPLE_SCANNER_H_
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "tfrt/support/forward_decls.h"
+
+namespace tfrt {
+namespace proto {
+
+// Finds the serialized Feature messages of the features in `key_indices` in
+// the serialized Example `example`. The Feature of the key with index i is
+// stored in features[i], which is left empty if the example does not have the
+// key. As for parsed messages, the last entry of a key wins. Fields other than
+// the requested features are skipped without being decoded. Returns false if
+// `example` is malformed.
+bool ScanExample(string_view example,
+                 const llvm::StringMap<size_t>& key_indices,
+                 MutableArrayRef<std::optional<string_view>> features);
+
+// A serialized Feature message, whose values are decoded on demand.
+class ScannedFeature {
+ public:
+  // The field numbers of the `kind` oneof of Feature.
+  enum class Kind { kNone = 0, kBytesList = 1, kFloatList = 2, kInt64List = 3 };
+
+  // Returns false if `feature` is malformed.
+  bool Parse(string_view feature);
+
+  Kind kind() const { return kind_; }
+
+  // Returns the number of values, or -1 if the value list is malformed.
+  int64_t CountValues() const;
+
+  // Decode the values into `output`, which must have room for CountValues()
+  // values. Return false if the feature has a different kind.
+  bool GetInt64Values(int64_t* output) const;
+  bool GetFloatValues(float* output) const;
+  bool GetBytesValues(std::string* output) const;
+
+ private:
+  Kind kind_ = Kind::kNone;
+  // The serialized value list messages of the kind. Repeated list messages of
+  // the same kind are merged, so their values are concatenated.
+  llvm::SmallVector<string_view, 1> lists_;
+};
+
+}  // namespace proto
+}  // namespace tfrt
+
+#endif  // TFRT_BACKENDS_CPU_LIB_KERNELS_PROTO_EXAMPLE_SCANNER_H_
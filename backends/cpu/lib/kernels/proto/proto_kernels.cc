@@ -14,12 +14,26 @@
 
 // This file implements protobuf-related kernels.
 
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "example_scanner.h"
+#include "google/protobuf/arena.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
 #include "tfrt/cpu/kernels/proto/example.proto.h"
 #include "tfrt/host_context/async_dispatch.h"
+#include "tfrt/host_context/attribute_utils.h"
 #include "tfrt/host_context/diagnostic.h"
 #include "tfrt/host_context/function.h"
 #include "tfrt/host_context/kernel_utils.h"
+#include "tfrt/host_context/parallel_for.h"
 #include "tfrt/support/error_util.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/string_host_tensor.h"
 #include "tfrt/tracing/tracing.h"
 
 namespace tfrt {
@@ -78,6 +92,266 @@ static llvm::Expected<int64_t> GetInt64FieldFromExample(
   return int64_list.value(0);
 }
 
+namespace {
+
+// A feature extracted by ParseExampleBatch, and the batch tensor it is written
+// to.
+struct BatchFeature {
+  std::string key;
+  DType dtype;
+  // The number of values of the feature in every example.
+  int64_t length;
+  // The data of the result tensor, for I64 and F32 features.
+  void* data = nullptr;
+  // The elements of the result tensor, for String features.
+  MutableArrayRef<std::string> strings;
+};
+
+// The size of the initial arena block of every ParallelFor block of
+// ParseExampleBatch. The block is reused for every example of the ParallelFor
+// block, so that most examples are parsed without any heap allocation.
+constexpr size_t kArenaBlockSize = 64 * 1024;
+
+// Examples are small, so a block should parse a few of them to amortize the
+// scheduling and the arena.
+constexpr size_t kMinExamplesPerBlock = 16;
+
+}  // namespace
+
+// Extracts `features` from `example`, which is example `index` of the batch.
+static Error ExtractFeatures(const tfrt::proto::Example& example, size_t index,
+                             ArrayRef<BatchFeature> features) {
+  const auto& feature_map = example.features().feature();
+  for (const BatchFeature& feature : features) {
+    auto it = feature_map.find(feature.key);
+    if (it == feature_map.end())
+      return MakeStringError("key ", feature.key, " is not found in the proto");
+    const tfrt::proto::Feature& value = it->second;
+    const size_t offset = index * feature.length;
+
+    auto check_length = [&](int size) -> Error {
+      if (size == feature.length) return Error::success();
+      return MakeStringError("feature ", feature.key, " has ", size,
+                             " values, expected ", feature.length);
+    };
+    auto wrong_kind = [&]() {
+      return MakeStringError("feature ", feature.key, " is not of type ",
+                             feature.dtype);
+    };
+
+    switch (feature.dtype) {
+      case DType::I64: {
+        if (value.kind_case() != tfrt::proto::Feature::kInt64List)
+          return wrong_kind();
+        const auto& list = value.int64_list().value();
+        if (auto error = check_length(list.size())) return error;
+        std::copy(list.begin(), list.end(),
+                  static_cast<int64_t*>(feature.data) + offset);
+        break;
+      }
+      case DType::F32: {
+        if (value.kind_case() != tfrt::proto::Feature::kFloatList)
+          return wrong_kind();
+        const auto& list = value.float_list().value();
+        if (auto error = check_length(list.size())) return error;
+        std::copy(list.begin(), list.end(),
+                  static_cast<float*>(feature.data) + offset);
+        break;
+      }
+      default: {
+        assert(feature.dtype == DType::String);
+        if (value.kind_case() != tfrt::proto::Feature::kBytesList)
+          return wrong_kind();
+        const auto& list = value.bytes_list().value();
+        if (auto error = check_length(list.size())) return error;
+        std::copy(list.begin(), list.end(), feature.strings.begin() + offset);
+        break;
+      }
+    }
+  }
+  return Error::success();
+}
+
+// Parses `serialized` in parallel into one batch tensor per entry of `keys`,
+// which are stored in `results`. Result i has shape [num_examples, lengths[i]]
+// and dtype dtypes[i], which is i64, f32 or string. Every ParallelFor block
+// calls `parse_block(serialized, begin, end, features, errors)`, which writes
+// the features of examples [begin, end) and reports the error of example i in
+// errors[i], so that blocks can share state, e.g. an arena, across examples.
+template <typename ParseBlockFn>
+static void ParseBatch(AsyncValueRef<StringHostTensor> serialized,
+                       RemainingResults results, AggregateAttr keys,
+                       AggregateAttr dtypes, ArrayAttribute<int64_t> lengths,
+                       const ExecutionContext& exec_ctx,
+                       ParseBlockFn parse_block) {
+  HostContext* host = exec_ctx.host();
+  const size_t num_features = results.size();
+  const Index num_examples = serialized->NumElements();
+
+  auto set_all_errors = [&](string_view message) {
+    auto diag = EmitError(exec_ctx, message);
+    for (size_t i = 0; i < num_features; ++i)
+      results[i] = MakeErrorAsyncValueRef(diag.status);
+  };
+  if (keys.GetNumElements() != num_features ||
+      dtypes.GetNumElements() != num_features ||
+      lengths.size() != num_features)
+    return set_all_errors("keys, dtypes and lengths must match the results");
+
+  // The results are allocated up front, and every example writes its own
+  // slice of them.
+  auto features = std::make_shared<std::vector<BatchFeature>>(num_features);
+  llvm::SmallVector<RCReference<AsyncValue>, 4> values;
+  for (size_t i = 0; i < num_features; ++i) {
+    BatchFeature& feature = (*features)[i];
+    feature.key = keys.GetAttributeOfType<StringAttr>(i).GetValue().str();
+    feature.dtype = dtypes.GetAttributeOfType<TypeAttr>(i).GetValue();
+    feature.length = lengths[i];
+    const TensorShape shape({num_examples, feature.length});
+
+    if (feature.dtype == DType::I64 || feature.dtype == DType::F32) {
+      auto dht = DenseHostTensor::MakeConstructedAsyncValueRef(
+          TensorMetadata(feature.dtype, shape), host);
+      if (!dht) return set_all_errors("cannot allocate tensor");
+      feature.data = dht->data();
+      values.push_back(dht.ReleaseRCRef());
+    } else if (feature.dtype == DType::String) {
+      auto sht = StringHostTensor::MakeConstructedAsyncValueRef(
+          TensorMetadata(feature.dtype, shape), host);
+      if (!sht) return set_all_errors("cannot allocate tensor");
+      feature.strings = sht->strings();
+      values.push_back(sht.ReleaseRCRef());
+    } else {
+      return set_all_errors("unsupported feature dtype");
+    }
+  }
+  for (size_t i = 0; i < num_features; ++i) results[i] = values[i].CopyRef();
+
+  auto errors = std::make_shared<std::vector<std::string>>(num_examples);
+  ParallelFor(exec_ctx).Execute(
+      num_examples, ParallelFor::BlockSizes::Min(kMinExamplesPerBlock),
+      [serialized = std::move(serialized), features, errors,
+       parse_block = std::move(parse_block)](size_t begin, size_t end) {
+        parse_block(*serialized, begin, end, *features,
+                    MutableArrayRef<std::string>(*errors));
+      },
+      [values = std::move(values), errors, exec_ctx]() mutable {
+        for (size_t i = 0; i < errors->size(); ++i) {
+          if ((*errors)[i].empty()) continue;
+          auto diag = EmitError(exec_ctx, "failed to parse example ", i, ": ",
+                                (*errors)[i]);
+          for (auto& value : values) value->SetError(diag.status);
+          return;
+        }
+        for (auto& value : values) value->SetStateConcrete();
+      });
+}
+
+// Parses the serialized tfrt::proto::Example protos of `serialized` in
+// parallel, and returns one batch tensor per entry of `keys`, see ParseBatch.
+static void ParseExampleBatch(Argument<StringHostTensor> serialized,
+                              RemainingResults results, AggregateAttr keys,
+                              AggregateAttr dtypes,
+                              ArrayAttribute<int64_t> lengths,
+                              const ExecutionContext& exec_ctx) {
+  ParseBatch(serialized.ValueRef(), results, keys, dtypes, lengths, exec_ctx,
+             [](const StringHostTensor& serialized, size_t begin, size_t end,
+                ArrayRef<BatchFeature> features,
+                MutableArrayRef<std::string> errors) {
+               TFRT_TRACE_SCOPE(Default, "ParseExampleBatch");
+               std::unique_ptr<char[]> initial_block(
+                   new char[kArenaBlockSize]);
+               google::protobuf::ArenaOptions options;
+               options.initial_block = initial_block.get();
+               options.initial_block_size = kArenaBlockSize;
+               google::protobuf::Arena arena(options);
+
+               for (size_t i = begin; i < end; ++i) {
+                 auto* example = google::protobuf::Arena::CreateMessage<
+                     tfrt::proto::Example>(&arena);
+                 const std::string& data = serialized.strings()[i];
+                 if (!example->ParseFromArray(data.data(), data.size())) {
+                   errors[i] = "failed to parse example.proto from string";
+                 } else if (auto error =
+                                ExtractFeatures(*example, i, features)) {
+                   errors[i] = toString(std::move(error));
+                 }
+                 arena.Reset();
+               }
+             });
+}
+
+// Extracts `features` from the serialized `example`, which is example `index`
+// of the batch, by scanning its wire format.
+static Error ScanFeatures(string_view example, size_t index,
+                          const llvm::StringMap<size_t>& key_indices,
+                          ArrayRef<BatchFeature> features) {
+  llvm::SmallVector<std::optional<string_view>, 8> scanned(features.size());
+  if (!ScanExample(example, key_indices, scanned))
+    return MakeStringError("failed to parse example.proto from string");
+
+  for (size_t i = 0; i < features.size(); ++i) {
+    const BatchFeature& feature = features[i];
+    if (!scanned[i])
+      return MakeStringError("key ", feature.key, " is not found in the proto");
+    ScannedFeature value;
+    if (!value.Parse(*scanned[i]))
+      return MakeStringError("failed to parse feature ", feature.key);
+    const int64_t count = value.CountValues();
+    if (count < 0)
+      return MakeStringError("failed to parse feature ", feature.key);
+    if (count != feature.length) {
+      return MakeStringError("feature ", feature.key, " has ", count,
+                             " values, expected ", feature.length);
+    }
+
+    const size_t offset = index * feature.length;
+    bool ok;
+    switch (feature.dtype) {
+      case DType::I64:
+        ok = value.GetInt64Values(static_cast<int64_t*>(feature.data) + offset);
+        break;
+      case DType::F32:
+        ok = value.GetFloatValues(static_cast<float*>(feature.data) + offset);
+        break;
+      default:
+        assert(feature.dtype == DType::String);
+        ok = value.GetBytesValues(feature.strings.data() + offset);
+        break;
+    }
+    if (!ok) {
+      return MakeStringError("feature ", feature.key, " is not of type ",
+                             feature.dtype);
+    }
+  }
+  return Error::success();
+}
+
+// Like ParseExampleBatch, but scans the wire format of the examples for the
+// requested features instead of parsing them, so that the other features are
+// skipped without being decoded or allocated.
+static void ScanExampleBatch(Argument<StringHostTensor> serialized,
+                             RemainingResults results, AggregateAttr keys,
+                             AggregateAttr dtypes,
+                             ArrayAttribute<int64_t> lengths,
+                             const ExecutionContext& exec_ctx) {
+  auto key_indices = std::make_shared<llvm::StringMap<size_t>>();
+  for (size_t i = 0, e = keys.GetNumElements(); i < e; ++i)
+    (*key_indices)[keys.GetAttributeOfType<StringAttr>(i).GetValue()] = i;
+
+  ParseBatch(serialized.ValueRef(), results, keys, dtypes, lengths, exec_ctx,
+             [key_indices](const StringHostTensor& serialized, size_t begin,
+                           size_t end, ArrayRef<BatchFeature> features,
+                           MutableArrayRef<std::string> errors) {
+               TFRT_TRACE_SCOPE(Default, "ScanExampleBatch");
+               for (size_t i = begin; i < end; ++i) {
+                 if (auto error = ScanFeatures(serialized.strings()[i], i,
+                                               *key_indices, features))
+                   errors[i] = toString(std::move(error));
+               }
+             });
+}
+
 // This is the entrypoint to the library.
 void RegisterProtoKernels(KernelRegistry* registry) {
   registry->AddKernel("tfrt_test.parse_example_from_bytes",
@@ -86,6 +360,10 @@ void RegisterProtoKernels(KernelRegistry* registry) {
                       TFRT_KERNEL(GetBytesFieldFromExample));
   registry->AddKernel("tfrt_test.get_int64_field_from_example",
                       TFRT_KERNEL(GetInt64FieldFromExample));
+  registry->AddKernel("tfrt_test.parse_example_batch",
+                      TFRT_KERNEL(ParseExampleBatch));
+  registry->AddKernel("tfrt_test.scan_example_batch",
+                      TFRT_KERNEL(ScanExampleBatch));
 }
 
 }  // namespace proto
@@ -0,0 +1,210 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Quantized MatMul kernel implementation.
+//
+// Multiplies an asymmetrically quantized quint8 lhs with a qint8 rhs, and
+// accumulates the products in int32. A quantized value q represents the real
+// value scale * (q - zero_point), so every output element is computed as
+//
+//   sum_k (a[m, k] - za) * (b[k, n] - zb)
+//     = dot(a[m, :], b[:, n]) - zb * sum_k a[m, k] - za * sum_k b[k, n]
+//       + K * za * zb
+//
+// which leaves a plain uint8 x int8 dot product in the inner loop. The rows of
+// the lhs and the columns of the rhs are laid out contiguously along the
+// contraction dimension, so that the compiler vectorizes the dot product with
+// the widest int8 multiply-accumulate instructions of the target (e.g.
+// VPDPBUSD on AVX512-VNNI).
+
+#ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_QUANTIZED_MATMUL_KERNEL_H_
+#define TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_QUANTIZED_MATMUL_KERNEL_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+#include "tfrt/common/compat/eigen/eigen_evaluator.h"
+#include "tfrt/common/compat/eigen/tensor_types.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+namespace cpu {
+
+// Writes the int32 accumulators to a qint32 output.
+class QuantizedMatMulOutput {
+ public:
+  explicit QuantizedMatMulOutput(DenseHostTensor* output)
+      : output_(static_cast<int32_t*>(output->data())) {}
+
+  void operator()(Index index, Index col, int32_t acc) const {
+    output_[index] = acc;
+  }
+
+ private:
+  int32_t* output_;
+};
+
+// Adds a float bias to the accumulators, clamps the result to the
+// [lower, upper] range of the fused activation, and requantizes it to a quint8
+// output.
+class RequantizeBiasAddOutput {
+ public:
+  RequantizeBiasAddOutput(DenseHostTensor* output, const float* bias,
+                          float accumulator_scale, float output_scale,
+                          int32_t output_zero_point, float lower, float upper)
+      : output_(static_cast<uint8_t*>(output->data())),
+        bias_(bias),
+        accumulator_scale_(accumulator_scale),
+        inv_output_scale_(1.0f / output_scale),
+        output_zero_point_(output_zero_point),
+        lower_(lower),
+        upper_(upper) {}
+
+  void operator()(Index index, Index col, int32_t acc) const {
+    float value = acc * accumulator_scale_ + bias_[col];
+    value = std::min(std::max(value, lower_), upper_);
+    float quantized = std::nearbyint(value * inv_output_scale_) +
+                      static_cast<float>(output_zero_point_);
+    constexpr float kMaxQuantized = std::numeric_limits<uint8_t>::max();
+    quantized = std::min(std::max(quantized, 0.0f), kMaxQuantized);
+    output_[index] = static_cast<uint8_t>(quantized);
+  }
+
+ private:
+  uint8_t* output_;
+  const float* bias_;
+  float accumulator_scale_;
+  float inv_output_scale_;
+  int32_t output_zero_point_;
+  float lower_;
+  float upper_;
+};
+
+namespace internal {
+
+// The lhs rows and rhs columns of a quantized MatMul, contiguous along the
+// contraction dimension, and their sums used for the zero point correction.
+struct QuantizedMatMulOperands {
+  QuantizedMatMulOperands(const DenseHostTensor& a, const DenseHostTensor& b,
+                          bool transpose_a, bool transpose_b)
+      : rows(a.shape().GetDimensionSize(transpose_a ? 1 : 0)),
+        depth(a.shape().GetDimensionSize(transpose_a ? 0 : 1)),
+        cols(b.shape().GetDimensionSize(transpose_b ? 0 : 1)),
+        lhs(static_cast<const uint8_t*>(a.data())),
+        rhs(static_cast<const int8_t*>(b.data())) {
+    if (transpose_a) {
+      lhs_storage.resize(rows * depth);
+      for (Index k = 0; k < depth; ++k)
+        for (Index m = 0; m < rows; ++m)
+          lhs_storage[m * depth + k] = lhs[k * rows + m];
+      lhs = lhs_storage.data();
+    }
+    if (!transpose_b) {
+      rhs_storage.resize(cols * depth);
+      for (Index k = 0; k < depth; ++k)
+        for (Index n = 0; n < cols; ++n)
+          rhs_storage[n * depth + k] = rhs[k * cols + n];
+      rhs = rhs_storage.data();
+    }
+
+    lhs_sums.resize(rows);
+    for (Index m = 0; m < rows; ++m)
+      lhs_sums[m] = std::accumulate(lhs + m * depth, lhs + (m + 1) * depth, 0);
+    rhs_sums.resize(cols);
+    for (Index n = 0; n < cols; ++n)
+      rhs_sums[n] = std::accumulate(rhs + n * depth, rhs + (n + 1) * depth, 0);
+  }
+
+  Index rows;
+  Index depth;
+  Index cols;
+  const uint8_t* lhs;
+  const int8_t* rhs;
+  std::vector<uint8_t> lhs_storage;
+  std::vector<int8_t> rhs_storage;
+  std::vector<int32_t> lhs_sums;
+  std::vector<int32_t> rhs_sums;
+};
+
+inline int32_t QuantizedDot(const uint8_t* lhs, const int8_t* rhs,
+                            Index depth) {
+  int32_t acc = 0;
+  for (Index k = 0; k < depth; ++k)
+    acc += static_cast<int32_t>(lhs[k]) * static_cast<int32_t>(rhs[k]);
+  return acc;
+}
+
+// Computes the row-major output elements [begin, end).
+template <typename Output>
+void QuantizedMatMulBlock(const QuantizedMatMulOperands& operands,
+                          int32_t a_zero_point, int32_t b_zero_point,
+                          const Output& output, Index begin, Index end) {
+  const Index depth = operands.depth;
+  const Index cols = operands.cols;
+  const int32_t zero_points_product =
+      static_cast<int32_t>(depth) * a_zero_point * b_zero_point;
+
+  for (Index index = begin; index < end; ++index) {
+    const Index row = index / cols;
+    const Index col = index % cols;
+    int32_t acc = QuantizedDot(operands.lhs + row * depth,
+                               operands.rhs + col * depth, depth);
+    acc += zero_points_product - b_zero_point * operands.lhs_sums[row] -
+           a_zero_point * operands.rhs_sums[col];
+    output(index, col, acc);
+  }
+}
+
+}  // namespace internal
+
+// Quantized matrix multiplication:
+//   C = output((A - a_zero_point) * (B - b_zero_point))
+//
+// `a` is a quint8 matrix and `b` is a qint8 matrix. `output` receives the
+// int32 accumulator of every output element.
+template <typename Output, typename EigenEvaluator>
+typename EigenEvaluator::DependencyToken QuantizedMatMul(
+    const DenseHostTensor& a, const DenseHostTensor& b, DenseHostTensor* c,
+    bool transpose_a, bool transpose_b, int32_t a_zero_point,
+    int32_t b_zero_point, Output output, EigenEvaluator eigen) {
+  auto operands = std::make_shared<internal::QuantizedMatMulOperands>(
+      a, b, transpose_a, transpose_b);
+
+  // The cost of computing one output element.
+  const Index depth = operands->depth;
+  Eigen::TensorOpCost cost(2 * depth, sizeof(int32_t),
+                           depth * (Eigen::TensorOpCost::AddCost<int32_t>() +
+                                    Eigen::TensorOpCost::MulCost<int32_t>()));
+
+  return eigen.ParallelFor(
+      operands->rows * operands->cols, cost,
+      [=](Eigen::Index begin, Eigen::Index end) {
+        internal::QuantizedMatMulBlock(*operands, a_zero_point, b_zero_point,
+                                       output, begin, end);
+      },
+      eigen.KeepAlive(&a, &b, c));
+}
+
+}  // namespace cpu
+}  // namespace tfrt
+
+#endif  // TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_QUANTIZED_MATMUL_KERNEL_H_
@@ -0,0 +1,205 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Random tensor generation kernels implementation.
+//
+// The kernels fill dense tensors from a Philox stream. Every 128-bit sample of
+// the stream is converted to a group of output elements, so a block of groups
+// is computed from a copy of the generator that skips to the first sample of
+// the block. The output only depends on the seeds, and not on the number of
+// threads or the block sizes. Samples are generated in batches with
+// PhiloxRandom::Fill(), which computes several samples at once.
+
+#ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_RANDOM_KERNELS_H_
+#define TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_RANDOM_KERNELS_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/parallel_for.h"
+#include "tfrt/support/philox_random.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+namespace cpu {
+
+enum class RandomDistribution {
+  // Uniform in [0, 1).
+  kUniform,
+  // Standard normal.
+  kNormal,
+  // Standard normal, where values more than two standard deviations away from
+  // the mean are dropped and re-picked.
+  kTruncatedNormal,
+};
+
+namespace internal {
+
+using random::PhiloxRandom;
+
+// The number of output elements computed from one 128-bit sample.
+template <typename T>
+constexpr Index kRandomGroupSize =
+    sizeof(PhiloxRandom::CounterType) / sizeof(T);
+
+// The number of samples converted at once from a buffer on the stack.
+constexpr Index kRandomBatchSamples = 64;
+
+// The minimum number of groups computed by a parallel block.
+constexpr size_t kRandomMinBlockGroups = 1024;
+
+// Truncated normal groups reject some of their values, so every group reads
+// from its own range of samples instead of a single sample. Running out of the
+// range, which practically never happens, reads into the range of the next
+// group.
+constexpr uint64_t kTruncatedNormalSamplesPerGroup = 64;
+
+// Returns a float in [0, 1) from the upper 23 bits of `bits`, by setting the
+// mantissa of 1.0f.
+inline float BitsToUniform(uint32_t bits) {
+  const uint32_t value = (bits >> 9) | 0x3f800000u;
+  float result;
+  std::memcpy(&result, &value, sizeof(result));
+  return result - 1.0f;
+}
+
+// Returns a double in [0, 1) from the upper 52 bits of `hi` and `lo`, by
+// setting the mantissa of 1.0.
+inline double BitsToUniform(uint32_t hi, uint32_t lo) {
+  const uint64_t bits = (static_cast<uint64_t>(hi) << 32) | lo;
+  const uint64_t value = (bits >> 12) | 0x3ff0000000000000ull;
+  double result;
+  std::memcpy(&result, &value, sizeof(result));
+  return result - 1.0;
+}
+
+// Converts `size` elements worth of bits to uniform values in [0, 1).
+// Doubles take two 32-bit results each.
+template <typename T>
+void BitsToUniform(const uint32_t* bits, Index size, T* values) {
+  if constexpr (std::is_same<T, float>::value) {
+    for (Index i = 0; i < size; ++i) values[i] = BitsToUniform(bits[i]);
+  } else {
+    for (Index i = 0; i < size; ++i)
+      values[i] = BitsToUniform(bits[2 * i], bits[2 * i + 1]);
+  }
+}
+
+// Transforms pairs of uniform values in [0, 1) to pairs of standard normal
+// values with the Box-Muller transform. `size` is even.
+template <typename T>
+void UniformToNormal(Index size, T* values) {
+  constexpr T kTwoPi = static_cast<T>(6.283185307179586);
+  for (Index i = 0; i < size; i += 2) {
+    // 1 - u is in (0, 1], so the logarithm is finite.
+    const T radius = std::sqrt(T(-2) * std::log(T(1) - values[i]));
+    const T theta = kTwoPi * values[i + 1];
+    values[i] = radius * std::sin(theta);
+    values[i + 1] = radius * std::cos(theta);
+  }
+}
+
+// Computes the groups [begin, end) of a uniform or normal output of `size`
+// elements. The last group may be partial.
+template <typename T>
+void RandomGroups(RandomDistribution distribution, PhiloxRandom generator,
+                  T* output, Index size, size_t begin, size_t end) {
+  constexpr Index kGroupSize = kRandomGroupSize<T>;
+  uint32_t bits[kRandomBatchSamples * PhiloxRandom::kCounterSize];
+  T values[kRandomBatchSamples * kGroupSize];
+
+  generator.Skip(begin);
+  for (size_t group = begin; group < end; group += kRandomBatchSamples) {
+    const Index num_groups =
+        std::min<Index>(kRandomBatchSamples, static_cast<Index>(end - group));
+    generator.Fill(bits, num_groups * PhiloxRandom::kCounterSize);
+    BitsToUniform(bits, num_groups * kGroupSize, values);
+    if (distribution == RandomDistribution::kNormal)
+      UniformToNormal(num_groups * kGroupSize, values);
+
+    const Index first = static_cast<Index>(group) * kGroupSize;
+    const Index count = std::min(num_groups * kGroupSize, size - first);
+    std::copy(values, values + count, output + first);
+  }
+}
+
+// Computes the groups [begin, end) of a truncated normal output of `size`
+// elements.
+template <typename T>
+void TruncatedNormalGroups(const PhiloxRandom& generator, T* output,
+                           Index size, size_t begin, size_t end) {
+  constexpr Index kGroupSize = kRandomGroupSize<T>;
+  uint32_t bits[PhiloxRandom::kCounterSize];
+  T values[kGroupSize];
+
+  for (size_t group = begin; group < end; ++group) {
+    PhiloxRandom group_generator = generator;
+    group_generator.Skip(group * kTruncatedNormalSamplesPerGroup);
+
+    T* out = output + static_cast<Index>(group) * kGroupSize;
+    const Index count =
+        std::min(kGroupSize, size - static_cast<Index>(group) * kGroupSize);
+    Index filled = 0;
+    while (filled < count) {
+      group_generator.Fill(bits, PhiloxRandom::kCounterSize);
+      BitsToUniform(bits, kGroupSize, values);
+      UniformToNormal(kGroupSize, values);
+      for (Index i = 0; i < kGroupSize && filled < count; ++i) {
+        if (std::abs(values[i]) < T(2)) out[filled++] = values[i];
+      }
+    }
+  }
+}
+
+}  // namespace internal
+
+// Fills `output` with random values of `distribution` from the Philox stream
+// of `seed` and `seed2`. The same seeds always produce the same output.
+template <typename T>
+AsyncValueRef<Chain> Random(RandomDistribution distribution, uint64_t seed,
+                            uint64_t seed2, DenseHostTensor* output,
+                            const ExecutionContext& exec_ctx) {
+  static_assert(std::is_same<T, float>::value || std::is_same<T, double>::value,
+                "random kernels support float and double");
+  constexpr Index kGroupSize = internal::kRandomGroupSize<T>;
+
+  const Index size = output->NumElements();
+  const size_t num_groups = (size + kGroupSize - 1) / kGroupSize;
+  const random::PhiloxRandom generator(seed, seed2);
+  T* data = static_cast<T*>(output->data());
+
+  return ParallelFor(exec_ctx).Execute(
+      num_groups, ParallelFor::BlockSizes::Min(internal::kRandomMinBlockGroups),
+      [=](size_t begin, size_t end) {
+        if (distribution == RandomDistribution::kTruncatedNormal) {
+          internal::TruncatedNormalGroups(generator, data, size, begin, end);
+        } else {
+          internal::RandomGroups(distribution, generator, data, size, begin,
+                                 end);
+        }
+      });
+}
+
+}  // namespace cpu
+}  // namespace tfrt
+
+#endif  // TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_RANDOM_KERNELS_H_
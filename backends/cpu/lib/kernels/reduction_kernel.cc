@@ -0,0 +1,130 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Tensorflow reduction kernels planning.
+
+#include "./reduction_kernel.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace tfrt {
+namespace cpu {
+namespace internal {
+namespace {
+
+// The minimum number of input elements reduced by a parallel task, and by a
+// chunk of a split reduced dimension.
+constexpr Index kMinElementsPerTask = 16 * 1024;
+
+// Reduced dimensions of passes with fewer blocks than this are split into
+// chunks, so that there are about this many blocks.
+constexpr Index kTargetBlocks = 64;
+
+Index CeilDiv(Index a, Index b) { return (a + b - 1) / b; }
+
+ReductionPass MakePass(Index outer, Index reduced, Index inner,
+                       Index chunk_size) {
+  ReductionPass pass;
+  pass.outer = outer;
+  pass.reduced = reduced;
+  pass.inner = inner;
+  pass.chunk_size = chunk_size;
+  pass.num_chunks = CeilDiv(reduced, chunk_size);
+  pass.inner_tile = std::max<Index>(1, std::min(inner, kReductionInnerTile));
+  pass.num_inner_tiles = CeilDiv(inner, pass.inner_tile);
+  pass.min_blocks_per_task =
+      std::max<Index>(1, kMinElementsPerTask / (chunk_size * pass.inner_tile));
+  return pass;
+}
+
+// Appends the passes that reduce the [outer, reduced, inner] view.
+void AddReductionPasses(Index outer, Index reduced, Index inner,
+                        ReductionPlan* plan) {
+  const Index inner_tile = std::min(inner, kReductionInnerTile);
+  const Index blocks = outer * CeilDiv(inner, inner_tile);
+  const Index min_chunk_size = CeilDiv(kMinElementsPerTask, inner_tile);
+
+  if (blocks >= kTargetBlocks || reduced < 2 * min_chunk_size) {
+    plan->passes.push_back(MakePass(outer, reduced, inner, reduced));
+    return;
+  }
+
+  // Split the reduced dimension, and reduce the partial results of all chunks
+  // with a second pass that is never split.
+  const Index num_chunks = CeilDiv(kTargetBlocks, blocks);
+  const Index chunk_size =
+      std::max(min_chunk_size, CeilDiv(reduced, num_chunks));
+  ReductionPass split = MakePass(outer, reduced, inner, chunk_size);
+  plan->passes.push_back(split);
+  plan->passes.push_back(
+      MakePass(outer, split.num_chunks, inner, split.num_chunks));
+}
+
+}  // namespace
+
+ReductionPlan MakeReductionPlan(const TensorShape& input_shape,
+                                ArrayRef<bool> reduced_dims) {
+  assert(reduced_dims.size() == input_shape.GetRank());
+  ReductionPlan plan;
+  plan.num_outputs = 1;
+  plan.num_reduced = 1;
+
+  // Collapse adjacent reduced and adjacent kept dimensions. Dimensions of size
+  // one are dropped, as it does not matter whether they are reduced.
+  llvm::SmallVector<Index, 5> dims;
+  llvm::SmallVector<bool, 5> reduced;
+  for (int i = 0; i < input_shape.GetRank(); ++i) {
+    const Index size = input_shape.GetDimensionSize(i);
+    (reduced_dims[i] ? plan.num_reduced : plan.num_outputs) *= size;
+    if (size == 1) continue;
+    if (!dims.empty() && reduced.back() == reduced_dims[i]) {
+      dims.back() *= size;
+    } else {
+      dims.push_back(size);
+      reduced.push_back(reduced_dims[i]);
+    }
+  }
+
+  if (plan.num_outputs == 0 || plan.num_reduced == 0) return plan;
+
+  // Reduce the innermost reduced dimension first. Every pass leaves a
+  // dimension of size one in place of the dimension it reduced.
+  for (int i = static_cast<int>(dims.size()) - 1; i >= 0; --i) {
+    if (!reduced[i]) continue;
+    Index outer = 1, inner = 1;
+    for (int j = 0; j < i; ++j) outer *= dims[j];
+    for (int j = i + 1; j < dims.size(); ++j) inner *= dims[j];
+    AddReductionPasses(outer, dims[i], inner, &plan);
+    dims[i] = 1;
+  }
+
+  return plan;
+}
+
+ReductionPass MakeArgReductionPass(const TensorShape& input_shape, int axis) {
+  assert(axis >= 0 && axis < input_shape.GetRank());
+  Index outer = 1, inner = 1;
+  for (int i = 0; i < axis; ++i) outer *= input_shape.GetDimensionSize(i);
+  for (int i = axis + 1; i < input_shape.GetRank(); ++i)
+    inner *= input_shape.GetDimensionSize(i);
+  const Index reduced = input_shape.GetDimensionSize(axis);
+  return MakePass(outer, reduced, inner, std::max<Index>(reduced, 1));
+}
+
+}  // namespace internal
+}  // namespace cpu
+}  // namespace tfrt
@@ -0,0 +1,470 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Tensorflow reduction kernels (Sum, Prod, Max, Min, Mean, ArgMax, ArgMin).
+//
+// Adjacent reduced dimensions and adjacent kept dimensions are collapsed
+// first, so that every reduction becomes a sequence of passes over
+// [outer, reduced, inner] views, starting with the innermost reduced
+// dimension. A pass with `inner == 1` reduces contiguous rows with several
+// independent accumulators that the compiler can keep in vector registers. A
+// pass with `inner > 1` reduces tiles of `inner` columns element-wise, which
+// vectorizes along the columns.
+//
+// Floating point sums are pairwise over contiguous rows and Kahan compensated
+// over columns, so that the error does not grow linearly with the number of
+// reduced elements. Half precision types are accumulated in float.
+//
+// When there are too few outputs to keep all threads busy, the reduced
+// dimension is split into chunks that are reduced in parallel into a partial
+// results buffer, followed by a pass that reduces the partial results. The
+// split only depends on the shape, and every output is always computed with
+// the same order of operations, so results do not depend on the number of
+// threads or on the scheduling.
+
+#ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_REDUCTION_KERNEL_H_
+#define TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_REDUCTION_KERNEL_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "llvm/ADT/SmallVector.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/parallel_for.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/tensor_shape.h"
+
+namespace tfrt {
+namespace cpu {
+
+// The type in which elements of type `T` are accumulated: integer and floating
+// point types accumulate in their own type, and half precision types in float.
+template <typename T>
+struct ReductionAccumulator {
+  using Type = std::conditional_t<std::is_integral<T>::value ||
+                                      std::is_floating_point<T>::value,
+                                  T, float>;
+};
+
+// A reducer defines the identity and the binary operation of a reduction over
+// values of the accumulator type `T`, and how the result of the reduction of
+// `count` elements is finalized. Floating point sums are compensated.
+template <typename T>
+struct SumReducer {
+  using Type = T;
+  static constexpr bool kCompensated = std::is_floating_point<T>::value;
+  static T Identity() { return T(0); }
+  static T Combine(T a, T b) { return a + b; }
+  static T Finalize(T value, Index count) { return value; }
+};
+
+template <typename T>
+struct MeanReducer : SumReducer<T> {
+  static T Finalize(T value, Index count) {
+    // The mean of an empty integer reduction is zero instead of a division by
+    // zero. Floating point types return NaN like Tensorflow.
+    if (!std::is_floating_point<T>::value && count == 0) return value;
+    return value / static_cast<T>(count);
+  }
+};
+
+template <typename T>
+struct ProdReducer {
+  using Type = T;
+  static constexpr bool kCompensated = false;
+  static T Identity() { return T(1); }
+  static T Combine(T a, T b) { return a * b; }
+  static T Finalize(T value, Index count) { return value; }
+};
+
+template <typename T>
+struct MaxReducer {
+  using Type = T;
+  static constexpr bool kCompensated = false;
+  static T Identity() {
+    return std::numeric_limits<T>::has_infinity
+               ? -std::numeric_limits<T>::infinity()
+               : std::numeric_limits<T>::lowest();
+  }
+  static T Combine(T a, T b) { return a < b ? b : a; }
+  static T Finalize(T value, Index count) { return value; }
+};
+
+template <typename T>
+struct MinReducer {
+  using Type = T;
+  static constexpr bool kCompensated = false;
+  static T Identity() {
+    return std::numeric_limits<T>::has_infinity
+               ? std::numeric_limits<T>::infinity()
+               : std::numeric_limits<T>::max();
+  }
+  static T Combine(T a, T b) { return b < a ? b : a; }
+  static T Finalize(T value, Index count) { return value; }
+};
+
+namespace internal {
+
+// The maximum number of columns of a tile that a pass with `inner > 1`
+// accumulates at once.
+constexpr Index kReductionInnerTile = 256;
+
+// The number of independent accumulators over a contiguous row.
+constexpr Index kReductionLanes = 8;
+
+// Contiguous rows longer than this are summed pairwise.
+constexpr Index kPairwiseBlockSize = 128;
+
+// Reduces the [outer, reduced, inner] input into an [outer, num_chunks, inner]
+// output, where every chunk of `chunk_size` elements of the reduced dimension
+// is reduced separately. Every block reduces one chunk of one tile of
+// `inner_tile` columns of one outer index.
+struct ReductionPass {
+  Index outer = 1;
+  Index reduced = 1;
+  Index inner = 1;
+
+  Index chunk_size = 1;
+  Index num_chunks = 1;
+
+  Index inner_tile = 1;
+  Index num_inner_tiles = 1;
+
+  // The minimum number of blocks executed by a parallel task.
+  Index min_blocks_per_task = 1;
+
+  Index NumBlocks() const { return outer * num_chunks * num_inner_tiles; }
+  Index NumOutputs() const { return outer * num_chunks * inner; }
+};
+
+// Describes a reduction as a sequence of passes. The first pass reads the
+// input, every following pass reads the output of the previous pass, and the
+// last pass writes the output. A reduction without passes is element-wise:
+// either nothing is reduced, or the reduced dimensions are empty.
+struct ReductionPlan {
+  llvm::SmallVector<ReductionPass, 2> passes;
+  // The number of outputs, and the number of inputs reduced by every output.
+  Index num_outputs = 0;
+  Index num_reduced = 0;
+};
+
+// Returns the plan that reduces the dimensions `i` of `input_shape` for which
+// `reduced_dims[i]` is true.
+ReductionPlan MakeReductionPlan(const TensorShape& input_shape,
+                                ArrayRef<bool> reduced_dims);
+
+// Returns the single pass that finds the index of the extremum along
+// dimension `axis` of `input_shape`. The reduced dimension is never split.
+ReductionPass MakeArgReductionPass(const TensorShape& input_shape, int axis);
+
+// Returns `R::Finalize(value, count)` converted to the output type, or the
+// unfinalized value for the intermediate passes.
+template <typename R, typename Out>
+Out FinalizeReduction(typename R::Type value, Index count, bool finalize) {
+  return static_cast<Out>(finalize ? R::Finalize(value, count) : value);
+}
+
+// Reduces `size` contiguous elements.
+template <typename R, typename In>
+typename R::Type ReduceRow(const In* input, Index size) {
+  using Acc = typename R::Type;
+  if constexpr (R::kCompensated) {
+    if (size > kPairwiseBlockSize) {
+      // Split on a multiple of the number of lanes, so that the halves start
+      // on the same alignment as the row.
+      const Index half = size / 2 / kReductionLanes * kReductionLanes;
+      return R::Combine(ReduceRow<R>(input, half),
+                        ReduceRow<R>(input + half, size - half));
+    }
+  }
+
+  Acc lanes[kReductionLanes];
+  std::fill(lanes, lanes + kReductionLanes, R::Identity());
+
+  Index i = 0;
+  for (; i + kReductionLanes <= size; i += kReductionLanes) {
+    for (Index j = 0; j < kReductionLanes; ++j)
+      lanes[j] = R::Combine(lanes[j], static_cast<Acc>(input[i + j]));
+  }
+  for (; i < size; ++i)
+    lanes[0] = R::Combine(lanes[0], static_cast<Acc>(input[i]));
+
+  for (Index width = kReductionLanes / 2; width > 0; width /= 2) {
+    for (Index j = 0; j < width; ++j)
+      lanes[j] = R::Combine(lanes[j], lanes[j + width]);
+  }
+  return lanes[0];
+}
+
+// Reduces `rows` rows of `cols` columns, with a distance of `stride` elements
+// between rows, into `cols` contiguous outputs.
+template <typename R, typename In, typename Out>
+void ReduceColumns(const In* input, Index rows, Index cols, Index stride,
+                   Out* output, Index count, bool finalize) {
+  using Acc = typename R::Type;
+  Acc acc[kReductionInnerTile];
+  std::fill(acc, acc + cols, R::Identity());
+
+  if constexpr (R::kCompensated) {
+    // Kahan summation: `compensation` holds the low order bits lost by the
+    // previous additions of each column.
+    Acc compensation[kReductionInnerTile];
+    std::fill(compensation, compensation + cols, Acc(0));
+    for (Index r = 0; r < rows; ++r, input += stride) {
+      for (Index c = 0; c < cols; ++c) {
+        const Acc y = static_cast<Acc>(input[c]) - compensation[c];
+        const Acc t = acc[c] + y;
+        compensation[c] = (t - acc[c]) - y;
+        acc[c] = t;
+      }
+    }
+  } else {
+    for (Index r = 0; r < rows; ++r, input += stride) {
+      for (Index c = 0; c < cols; ++c)
+        acc[c] = R::Combine(acc[c], static_cast<Acc>(input[c]));
+    }
+  }
+
+  for (Index c = 0; c < cols; ++c)
+    output[c] = FinalizeReduction<R, Out>(acc[c], count, finalize);
+}
+
+// Reduces the blocks [begin, end) of `pass`.
+template <typename R, typename In, typename Out>
+void ReduceBlocks(const ReductionPass& pass, const In* input, Out* output,
+                  Index count, bool finalize, Index begin, Index end) {
+  for (Index block = begin; block < end; ++block) {
+    const Index tile = block % pass.num_inner_tiles;
+    const Index chunk = block / pass.num_inner_tiles % pass.num_chunks;
+    const Index outer = block / pass.num_inner_tiles / pass.num_chunks;
+
+    const Index row_begin = chunk * pass.chunk_size;
+    const Index rows = std::min(pass.chunk_size, pass.reduced - row_begin);
+    const Index col_begin = tile * pass.inner_tile;
+    const Index cols = std::min(pass.inner_tile, pass.inner - col_begin);
+
+    const In* src =
+        input + (outer * pass.reduced + row_begin) * pass.inner + col_begin;
+    Out* dst = output + (outer * pass.num_chunks + chunk) * pass.inner +
+               col_begin;
+
+    if (pass.inner == 1) {
+      *dst = FinalizeReduction<R, Out>(ReduceRow<R>(src, rows), count,
+                                       finalize);
+    } else {
+      ReduceColumns<R>(src, rows, cols, pass.inner, dst, count, finalize);
+    }
+  }
+}
+
+// Writes the index of the first extremum of every reduced row of the blocks
+// [begin, end) of `pass`. `Compare(a, b)` is true if `a` replaces `b`.
+template <typename T, typename OutIndex, typename Compare>
+void ArgReduceBlocks(const ReductionPass& pass, const T* input,
+                     OutIndex* output, Compare compare, Index begin,
+                     Index end) {
+  T best[kReductionInnerTile];
+  OutIndex best_index[kReductionInnerTile];
+
+  for (Index block = begin; block < end; ++block) {
+    const Index tile = block % pass.num_inner_tiles;
+    const Index outer = block / pass.num_inner_tiles;
+    const Index col_begin = tile * pass.inner_tile;
+    const Index cols = std::min(pass.inner_tile, pass.inner - col_begin);
+
+    const T* src = input + outer * pass.reduced * pass.inner + col_begin;
+    std::copy(src, src + cols, best);
+    std::fill(best_index, best_index + cols, OutIndex(0));
+
+    for (Index r = 1; r < pass.reduced; ++r) {
+      const T* row = src + r * pass.inner;
+      for (Index c = 0; c < cols; ++c) {
+        if (compare(row[c], best[c])) {
+          best[c] = row[c];
+          best_index[c] = static_cast<OutIndex>(r);
+        }
+      }
+    }
+
+    std::copy(best_index, best_index + cols,
+              output + outer * pass.inner + col_begin);
+  }
+}
+
+// The state shared by the passes of a reduction. It keeps the input and the
+// intermediate buffers alive until the last pass completes.
+template <typename T, typename R>
+struct ReductionState {
+  ReductionState(const DenseHostTensor& input, const ReductionPlan& plan,
+                 DenseHostTensor* output, const ExecutionContext& exec_ctx)
+      : input(input.CopyRef()),
+        plan(plan),
+        output(static_cast<T*>(output->data())),
+        exec_ctx(exec_ctx),
+        buffers(plan.passes.size()) {}
+
+  DenseHostTensor input;
+  ReductionPlan plan;
+  T* output;
+  ExecutionContext exec_ctx;
+  // The outputs of all but the last pass.
+  std::vector<std::vector<typename R::Type>> buffers;
+};
+
+template <typename T, typename R>
+void RunReductionPass(std::shared_ptr<ReductionState<T, R>> state, size_t index,
+                      AsyncValueRef<Chain> done);
+
+// Executes the pass `index` from `input` into `output`, and continues with the
+// next pass when all of its blocks are reduced.
+template <typename T, typename R, typename In, typename Out>
+void ExecuteReductionPass(std::shared_ptr<ReductionState<T, R>> state,
+                          size_t index, const In* input, Out* output,
+                          AsyncValueRef<Chain> done) {
+  const ReductionPass& pass = state->plan.passes[index];
+  const bool finalize = index + 1 == state->plan.passes.size();
+  const Index count = state->plan.num_reduced;
+
+  ParallelFor(state->exec_ctx)
+      .Execute(
+          pass.NumBlocks(),
+          ParallelFor::BlockSizes::Min(pass.min_blocks_per_task),
+          [pass, input, output, count, finalize](size_t begin, size_t end) {
+            ReduceBlocks<R>(pass, input, output, count, finalize, begin, end);
+          },
+          [state, index, done = std::move(done)]() mutable {
+            // The input of this pass is no longer needed.
+            if (index > 0) state->buffers[index - 1] = {};
+            if (index + 1 == state->plan.passes.size()) {
+              done.SetStateConcrete();
+            } else {
+              RunReductionPass(std::move(state), index + 1, std::move(done));
+            }
+          });
+}
+
+template <typename T, typename R>
+void RunReductionPass(std::shared_ptr<ReductionState<T, R>> state, size_t index,
+                      AsyncValueRef<Chain> done) {
+  using Acc = typename R::Type;
+  const bool last = index + 1 == state->plan.passes.size();
+
+  Acc* buffer = nullptr;
+  if (!last) {
+    state->buffers[index].resize(state->plan.passes[index].NumOutputs());
+    buffer = state->buffers[index].data();
+  }
+
+  if (index == 0) {
+    const T* input = static_cast<const T*>(state->input.data());
+    if (last) {
+      ExecuteReductionPass(state, index, input, state->output, std::move(done));
+    } else {
+      ExecuteReductionPass(state, index, input, buffer, std::move(done));
+    }
+  } else {
+    const Acc* input = state->buffers[index - 1].data();
+    if (last) {
+      ExecuteReductionPass(state, index, input, state->output, std::move(done));
+    } else {
+      ExecuteReductionPass(state, index, input, buffer, std::move(done));
+    }
+  }
+}
+
+}  // namespace internal
+
+// Reduces `input` with the reducer `Reducer` instantiated for the accumulator
+// type of `T`, following `plan`, and writes the result to `output`.
+template <typename T, template <typename> class Reducer>
+AsyncValueRef<Chain> Reduce(const DenseHostTensor& input,
+                            const internal::ReductionPlan& plan,
+                            DenseHostTensor* output,
+                            const ExecutionContext& exec_ctx) {
+  using Acc = typename ReductionAccumulator<T>::Type;
+  using R = Reducer<Acc>;
+
+  if (plan.passes.empty()) {
+    const T* in = static_cast<const T*>(input.data());
+    T* out = static_cast<T*>(output->data());
+    const Index count = plan.num_reduced;
+    return ParallelFor(exec_ctx).Execute(
+        plan.num_outputs, ParallelFor::BlockSizes::Min(16 * 1024),
+        [input = input.CopyRef(), in, out, count](size_t begin, size_t end) {
+          for (size_t i = begin; i < end; ++i) {
+            const Acc value =
+                count == 0 ? R::Identity() : static_cast<Acc>(in[i]);
+            out[i] = static_cast<T>(R::Finalize(value, count));
+          }
+        });
+  }
+
+  auto done = MakeConstructedAsyncValueRef<Chain>();
+  auto state = std::make_shared<internal::ReductionState<T, R>>(
+      input, plan, output, exec_ctx);
+  internal::RunReductionPass(std::move(state), 0, done.CopyRef());
+  return done;
+}
+
+// Returns the reduction with the reducer `Reducer` of `count` copies of
+// `value`, e.g. of the elements of a broadcast scalar. Takes O(log(count))
+// combines by doubling the reduced copies, which for sums is also more accurate
+// than adding the copies one by one.
+template <typename T, template <typename> class Reducer>
+T ReduceBroadcast(T value, Index count) {
+  using Acc = typename ReductionAccumulator<T>::Type;
+  using R = Reducer<Acc>;
+
+  Acc result = R::Identity();
+  Acc copies = static_cast<Acc>(value);
+  for (Index n = count; n > 0; n >>= 1) {
+    if (n & 1) result = R::Combine(result, copies);
+    if (n > 1) copies = R::Combine(copies, copies);
+  }
+  return static_cast<T>(R::Finalize(result, count));
+}
+
+// Writes the index of the first maximum (`kMax`) or minimum along the reduced
+// dimension of `pass` to `output`, of type int32 or int64.
+template <typename T, typename OutIndex, bool kMax>
+AsyncValueRef<Chain> ArgReduce(const DenseHostTensor& input,
+                               const internal::ReductionPass& pass,
+                               DenseHostTensor* output,
+                               const ExecutionContext& exec_ctx) {
+  const T* in = static_cast<const T*>(input.data());
+  OutIndex* out = static_cast<OutIndex*>(output->data());
+  return ParallelFor(exec_ctx).Execute(
+      pass.NumBlocks(), ParallelFor::BlockSizes::Min(pass.min_blocks_per_task),
+      [input = input.CopyRef(), pass, in, out](size_t begin, size_t end) {
+        auto compare = [](const T& a, const T& b) {
+          return kMax ? b < a : a < b;
+        };
+        internal::ArgReduceBlocks(pass, in, out, compare, begin, end);
+      });
+}
+
+}  // namespace cpu
+}  // namespace tfrt
+
+#endif  // TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_REDUCTION_KERNEL_H_
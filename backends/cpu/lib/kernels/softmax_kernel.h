@@ -15,10 +15,23 @@
  */
 
 // Softmax and LogSoftmax kernels implementation.
+//
+// The kernels use the online softmax algorithm: the maximum and the sum of the
+// exponentials of every batch row are computed together in a single pass over
+// the logits, and the output is computed in a second pass. The row is
+// processed in blocks that stay in L1 cache, so that updating the running sum
+// when a block raises the maximum does not require reading the logits again.
+// Rows are computed in parallel.
 
 #ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_SOFTMAX_KERNEL_H_
 #define TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_SOFTMAX_KERNEL_H_
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+#include "tfrt/common/compat/eigen/eigen_dtype.h"
 #include "tfrt/common/compat/eigen/eigen_kernel.h"
 #include "tfrt/common/compat/eigen/tensor_types.h"
 #include "tfrt/host_context/kernel_utils.h"
@@ -27,91 +40,119 @@
 
 namespace tfrt {
 namespace cpu {
+namespace internal {
+
+// The number of classes reduced at once by the online softmax.
+constexpr Index kSoftmaxBlockSize = 2048;
+
+// Maximum of a row of logits, and the sum of exp(logit - max) over the row.
+template <typename Acc>
+struct SoftmaxRowStats {
+  Acc max;
+  Acc sum;
+};
+
+// Computes the row statistics in a single pass over the logits. 16-bit
+// floating point logits are accumulated in float.
+template <typename T>
+SoftmaxRowStats<compat::AccumulatorType<T>> OnlineSoftmaxRowStats(
+    const T* logits, Index num_classes) {
+  using Acc = compat::AccumulatorType<T>;
+  using Block = Eigen::TensorMap<const Eigen::Tensor<T, 1, Eigen::RowMajor>,
+                                 Eigen::Unaligned>;
+  using Scalar = Eigen::Tensor<Acc, 0, Eigen::RowMajor>;
+
+  SoftmaxRowStats<Acc> stats = {-std::numeric_limits<Acc>::infinity(), 0};
+
+  for (Index offset = 0; offset < num_classes; offset += kSoftmaxBlockSize) {
+    Block block(logits + offset, std::min(kSoftmaxBlockSize,
+                                          num_classes - offset));
+    auto block_t = block.template cast<Acc>();
+
+    // Rescale the sum of the previous blocks to the new maximum.
+    Scalar block_max = block_t.maximum();
+    if (block_max() > stats.max) {
+      stats.sum *= std::exp(stats.max - block_max());
+      stats.max = block_max();
+    }
+
+    Scalar block_sum = (block_t - stats.max).exp().sum();
+    stats.sum += block_sum();
+  }
 
-template <typename T, bool log, typename EigenEvaluator>
-static typename EigenEvaluator::DependencyToken Softmax(
-    const DenseHostTensor& logits, DenseHostTensor* softmax,
-    const ExecutionContext& exec_ctx) {
-  // TODO(b/172291736): Avoid creating another DHT by having a generic view
-  // class that operates on only a shape and a pointer.
-  DenseHostTensor reshaped_logits(
-      TensorMetadata(logits.dtype(), GetFlattenedInnerDimsShape(
-                                         logits.shape(), /*num_out_dims=*/2)),
-      logits.buffer());
-  DenseHostTensor reshaped_softmax(
-      TensorMetadata(
-          softmax->dtype(),
-          GetFlattenedInnerDimsShape(softmax->shape(), /*num_out_dims=*/2)),
-      softmax->buffer());
-  DHTIndexableView<T, 2> logits_view(&reshaped_logits);
-  MutableDHTIndexableView<T, 2> softmax_view(&reshaped_softmax);
-
-  auto logits_t = compat::AsEigenConstTensor(logits_view);
-  auto softmax_t = compat::AsEigenTensor(softmax_view);
-
-  static constexpr int kBatchDim = 0;
-  static constexpr int kClassDim = 1;
-
-  const int batch_size = logits_t.dimension(kBatchDim);
-  const int num_classes = logits_t.dimension(kClassDim);
-
-  // Reduce along the class dimension.
-  Eigen::IndexList<Eigen::type2index<kClassDim>> along_class;
-
-  // Broadcast from [num_classes] to [batch, num_classes]
-  Eigen::IndexList<int, Eigen::type2index<1>> batch_by_one;
-  batch_by_one.set(0, batch_size);
-
-  // Broadcast from [batch] to [batch, num_classes]
-  Eigen::IndexList<Eigen::type2index<1>, int> one_by_class;
-  one_by_class.set(1, num_classes);
-
-  // In both cases we first pre-compute temporary logits reduction into the
-  // output (softmax) tensor, and after that evaluate a second expression that
-  // uses pre-computed values to get a final result.
-
-  // shifted_logits = logits - max(logits along classes);
-  auto shifted_logits_expr = (logits_t - logits_t.maximum(along_class)
-                                             .eval()
-                                             .reshape(batch_by_one)
-                                             .broadcast(one_by_class));
-  EigenEvaluator eigen{exec_ctx.host()};
+  return stats;
+}
 
-  if (log) {
-    // softmax = logits - max(logits along classes);
-    auto logits_ready =
-        eigen.Evaluate(softmax_t, std::move(shifted_logits_expr),
-                       eigen.KeepAlive(&logits, softmax));
-
-    // softmax = softmax - log(sum(exp(softmax along classes)));
-    auto softmax_expr = (softmax_t - softmax_t.exp()
-                                         .sum(along_class)
-                                         .log()
-                                         .eval()
-                                         .reshape(batch_by_one)
-                                         .broadcast(one_by_class));
-
-    return eigen.Evaluate(logits_ready, softmax_t, std::move(softmax_expr),
-                          eigen.KeepAlive(&logits, softmax));
+// Computes softmax (or log softmax if `log`) of a row of logits.
+template <typename T, bool log>
+void SoftmaxRow(const T* logits, T* softmax, Index num_classes) {
+  using Acc = compat::AccumulatorType<T>;
+  using Row = Eigen::Tensor<T, 1, Eigen::RowMajor>;
+
+  const auto stats = OnlineSoftmaxRowStats(logits, num_classes);
+
+  Eigen::TensorMap<const Row, Eigen::Unaligned> in(logits, num_classes);
+  Eigen::TensorMap<Row, Eigen::Unaligned> out(softmax, num_classes);
+  auto in_t = in.template cast<Acc>();
 
+  if (log) {
+    // softmax = logits - max - log(sum)
+    const Acc shift = stats.max + std::log(stats.sum);
+    out = (in_t - shift).template cast<T>();
   } else {
-    // softmax = exp(logits - max(logits along classes));
-    auto logits_ready =
-        eigen.Evaluate(softmax_t, std::move(shifted_logits_expr.exp()),
-                       eigen.KeepAlive(&logits, softmax));
-
-    // softmax = softmax * (1 / sum(softmax along classes));
-    auto softmax_expr = (softmax_t * softmax_t.sum(along_class)
-                                         .inverse()
-                                         .eval()
-                                         .reshape(batch_by_one)
-                                         .broadcast(one_by_class));
-
-    return eigen.Evaluate(logits_ready, softmax_t, std::move(softmax_expr),
-                          eigen.KeepAlive(&logits, softmax));
+    // softmax = exp(logits - max) / sum
+    const Acc scale = Acc(1) / stats.sum;
+    out = ((in_t - stats.max).exp() * scale).template cast<T>();
   }
 }
 
+}  // namespace internal
+
+// Computes the softmax (or log softmax) of `logits` that hold `batch_size` rows
+// of `num_classes` elements. 16-bit floating point logits are computed in
+// float (see compat::AccumulatorType).
+template <typename T, bool log, typename EigenEvaluator>
+static typename EigenEvaluator::DependencyToken Softmax(
+    const DenseHostTensor& logits, Index batch_size, Index num_classes,
+    DenseHostTensor* softmax, const ExecutionContext& exec_ctx) {
+  using Acc = compat::AccumulatorType<T>;
+
+  const T* logits_data = logits.data<T>();
+  T* softmax_data = softmax->data<T>();
+
+  // The cost of computing one batch row: the logits are read twice, but the
+  // second read hits the cache for all but the largest rows.
+  using ExpCost = Eigen::internal::functor_traits<
+      Eigen::internal::scalar_exp_op<Acc>>;
+  Eigen::TensorOpCost cost(2 * num_classes * sizeof(T),
+                           num_classes * sizeof(T),
+                           num_classes * (2 * ExpCost::Cost + 4));
+
+  EigenEvaluator eigen{exec_ctx.host()};
+  return eigen.ParallelFor(
+      batch_size, cost,
+      [=](Eigen::Index begin, Eigen::Index end) {
+        for (Index row = begin; row < end; ++row) {
+          internal::SoftmaxRow<T, log>(logits_data + row * num_classes,
+                                       softmax_data + row * num_classes,
+                                       num_classes);
+        }
+      },
+      eigen.KeepAlive(&logits, softmax));
+}
+
+// Computes the softmax (or log softmax) of the `logits` innermost dimension.
+template <typename T, bool log, typename EigenEvaluator>
+static typename EigenEvaluator::DependencyToken Softmax(
+    const DenseHostTensor& logits, DenseHostTensor* softmax,
+    const ExecutionContext& exec_ctx) {
+  const TensorShape shape =
+      GetFlattenedInnerDimsShape(logits.shape(), /*num_out_dims=*/2);
+  return Softmax<T, log, EigenEvaluator>(logits, shape.GetDimensionSize(0),
+                                         shape.GetDimensionSize(1), softmax,
+                                         exec_ctx);
+}
+
 }  // namespace cpu
 }  // namespace tfrt
 
@@ -18,6 +18,10 @@
 
 #include "./tile_kernel.h"
 
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
 namespace tfrt {
 namespace cpu {
 
@@ -46,6 +50,110 @@ Expected<llvm::SmallVector<Index, 5>> TileMultiples(
   return multiples;
 }
 
+namespace internal {
+
+// The preferred size of the output blocks copied by one parallel task.
+static constexpr size_t kTileBlockBytes = 64 * 1024;
+
+TilePlan MakeTilePlan(const TensorShape& input_shape,
+                      ArrayRef<Index> multiples, size_t element_size) {
+  assert(multiples.size() == input_shape.GetRank());
+
+  // Collapse the dimensions from the innermost one. A dimension that is not
+  // tiled can be merged into the outer dimension, and so can two consecutive
+  // dimensions of size one.
+  llvm::SmallVector<Index, 5> dims;
+  llvm::SmallVector<Index, 5> dim_multiples;
+  for (int i = input_shape.GetRank() - 1; i >= 0; --i) {
+    const Index dim = input_shape.GetDimensionSize(i);
+    const Index multiple = multiples[i];
+    if (dim == 1 && multiple == 1) continue;
+
+    if (!dims.empty() && dim_multiples.back() == 1) {
+      dims.back() *= dim;
+      dim_multiples.back() = multiple;
+    } else if (!dims.empty() && dims.back() == 1 && dim == 1) {
+      dim_multiples.back() *= multiple;
+    } else {
+      dims.push_back(dim);
+      dim_multiples.push_back(multiple);
+    }
+  }
+  if (dims.empty()) {
+    dims.push_back(1);
+    dim_multiples.push_back(1);
+  }
+
+  TilePlan plan;
+  plan.row_bytes = dims.front() * element_size;
+  plan.row_multiple = dim_multiples.front();
+
+  Index num_output_rows = 1;
+  for (int i = dims.size() - 1; i > 0; --i) {
+    plan.input_dims.push_back(dims[i]);
+    plan.output_dims.push_back(dims[i] * dim_multiples[i]);
+    num_output_rows *= dims[i] * dim_multiples[i];
+  }
+
+  if (plan.row_bytes == 0 || plan.row_multiple == 0 || num_output_rows == 0)
+    return plan;
+
+  plan.row_multiple_per_block =
+      std::max<Index>(1, kTileBlockBytes / plan.row_bytes);
+  plan.row_multiple_per_block =
+      std::min(plan.row_multiple_per_block, plan.row_multiple);
+  plan.blocks_per_row =
+      (plan.row_multiple + plan.row_multiple_per_block - 1) /
+      plan.row_multiple_per_block;
+  plan.num_blocks = num_output_rows * plan.blocks_per_row;
+
+  return plan;
+}
+
+void TileBlocks(const TilePlan& plan, const void* input, void* output,
+                Index begin, Index end) {
+  const char* in = static_cast<const char*>(input);
+  char* out = static_cast<char*>(output);
+
+  const size_t row_bytes = plan.row_bytes;
+  const size_t output_row_bytes = row_bytes * plan.row_multiple;
+  const int num_outer_dims = plan.output_dims.size();
+
+  for (Index block = begin; block < end; ++block) {
+    const Index output_row = block / plan.blocks_per_row;
+    const Index block_in_row = block % plan.blocks_per_row;
+
+    // Find the input row by wrapping every output index around the input
+    // dimension.
+    Index input_row = 0;
+    Index input_stride = 1;
+    Index remaining = output_row;
+    for (int i = num_outer_dims - 1; i >= 0; --i) {
+      input_row += remaining % plan.output_dims[i] % plan.input_dims[i] *
+                   input_stride;
+      input_stride *= plan.input_dims[i];
+      remaining /= plan.output_dims[i];
+    }
+
+    const Index first_copy = block_in_row * plan.row_multiple_per_block;
+    const Index num_copies =
+        std::min(plan.row_multiple_per_block, plan.row_multiple - first_copy);
+
+    char* dst = out + output_row * output_row_bytes + first_copy * row_bytes;
+    std::memcpy(dst, in + input_row * row_bytes, row_bytes);
+
+    // Double the copied region until the block is filled.
+    const size_t block_bytes = num_copies * row_bytes;
+    for (size_t copied = row_bytes; copied < block_bytes;) {
+      const size_t n = std::min(copied, block_bytes - copied);
+      std::memcpy(dst + copied, dst, n);
+      copied += n;
+    }
+  }
+}
+
+}  // namespace internal
+
 void TileStringTensor(const StringHostTensor& input, StringHostTensor* output) {
   // Compute strides from the shape.
   auto strides = [](const TensorShape& shape) -> llvm::SmallVector<Index, 5> {
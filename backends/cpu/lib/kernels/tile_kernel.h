@@ -15,13 +15,17 @@
  */
 
 // Tensorflow Tile kernel implementation.
+//
+// Dense tensors are tiled with memcpy: every innermost input row is copied
+// once to the output, and then repeatedly doubled within the output until it
+// fills its tiled row. The output rows are split into blocks that are copied
+// in parallel.
 
 #ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_TILE_KERNEL_H_
 #define TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_TILE_KERNEL_H_
 
+#include "llvm/ADT/SmallVector.h"
 #include "tfrt/common/compat/eigen/eigen_evaluator.h"
-#include "tfrt/common/compat/eigen/eigen_kernel.h"
-#include "tfrt/common/compat/eigen/tensor_types.h"
 #include "tfrt/support/error_util.h"
 #include "tfrt/support/forward_decls.h"
 #include "tfrt/tensor/dense_host_tensor.h"
@@ -34,8 +38,37 @@ namespace cpu {
 Expected<llvm::SmallVector<Index, 5>> TileMultiples(
     const DenseHostTensor& multiples_arg);
 
-template <int rank>
-using TileRankTag = std::integral_constant<int, rank>;
+namespace internal {
+
+// Describes how the output of a dense Tile is split into blocks of contiguous
+// memory. Adjacent dimensions are collapsed whenever possible, so that the
+// innermost row is as long as possible.
+struct TilePlan {
+  // The size of the innermost (collapsed) input row, and the number of times
+  // it is repeated in an output row.
+  size_t row_bytes = 0;
+  Index row_multiple = 1;
+
+  // Every output row is split into `blocks_per_row` blocks of up to
+  // `row_multiple_per_block` copies of the input row.
+  Index row_multiple_per_block = 1;
+  Index blocks_per_row = 1;
+  Index num_blocks = 0;
+
+  // Outer (collapsed) dimensions of the input and the output, used to find the
+  // input row of an output row.
+  llvm::SmallVector<Index, 5> input_dims;
+  llvm::SmallVector<Index, 5> output_dims;
+};
+
+TilePlan MakeTilePlan(const TensorShape& input_shape,
+                      ArrayRef<Index> multiples, size_t element_size);
+
+// Copies the blocks [begin, end) of the tiled `input` to `output`.
+void TileBlocks(const TilePlan& plan, const void* input, void* output,
+                Index begin, Index end);
+
+}  // namespace internal
 
 template <typename T, typename EigenEvaluator>
 static typename EigenEvaluator::DependencyToken Tile(
@@ -43,40 +76,25 @@ static typename EigenEvaluator::DependencyToken Tile(
     DenseHostTensor* output, const ExecutionContext& exec_ctx) {
   EigenEvaluator eigen{exec_ctx.host()};
 
-  auto rank_dispatch = [&](auto rank_tag) {
-    static constexpr int rank = decltype(rank_tag)::value;
-
-    auto input_view = DHTIndexableView<T, rank>(&input);
-    auto output_view = MutableDHTIndexableView<T, rank>(output);
-
-    auto input_t = compat::AsEigenConstTensor(input_view);
-    auto output_t = compat::AsEigenTensor(output_view);
-
-    Eigen::DSizes<Eigen::Index, rank> broadcast;
-    for (int i = 0; i < rank; ++i) {
-      broadcast[i] = multiples[i];
-    }
-
-    return eigen.Evaluate(output_t, input_t.broadcast(broadcast),
-                          eigen.KeepAlive(&input, output));
-  };
-
-  // Dispatch based on the output tensor rank.
-  const int rank = output->shape().GetRank();
-
-  if (rank == 1) {
-    return rank_dispatch(TileRankTag<1>{});
-  } else if (rank == 2) {
-    return rank_dispatch(TileRankTag<2>{});
-  } else if (rank == 3) {
-    return rank_dispatch(TileRankTag<3>{});
-  } else if (rank == 4) {
-    return rank_dispatch(TileRankTag<4>{});
-  } else if (rank == 5) {
-    return rank_dispatch(TileRankTag<5>{});
-  } else {
-    return eigen.MakeError("Unsupported tensor rank");
-  }
+  if (multiples.size() != input.shape().GetRank())
+    return eigen.MakeError("Tile multiples must match the input rank");
+
+  internal::TilePlan plan =
+      internal::MakeTilePlan(input.shape(), multiples, sizeof(T));
+
+  const void* input_data = input.data();
+  void* output_data = output->data();
+
+  const double block_bytes = plan.row_bytes * plan.row_multiple_per_block;
+  Eigen::TensorOpCost cost(plan.row_bytes, block_bytes, 0);
+
+  return eigen.ParallelFor(
+      plan.num_blocks, cost,
+      [plan = std::move(plan), input_data, output_data](Eigen::Index begin,
+                                                        Eigen::Index end) {
+        internal::TileBlocks(plan, input_data, output_data, begin, end);
+      },
+      eigen.KeepAlive(&input, output));
 }
 
 void TileStringTensor(const StringHostTensor& input, StringHostTensor* output);
@@ -0,0 +1,449 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Transpose Tensorflow kernel implementations.
+
+#include "./transpose_kernel.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+#include "tfrt/tensor/dense_host_tensor_view.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace tfrt {
+namespace cpu {
+
+Expected<llvm::SmallVector<Index, 5>> TransposePermutation(
+    const DenseHostTensor& perm_arg, int rank) {
+  llvm::SmallVector<Index, 5> perm;
+
+  if (perm_arg.shape().GetRank() != 1) {
+    return MakeStringError("Transpose permutation must be a vector");
+  }
+
+  if (perm_arg.dtype() == DType::I32) {
+    DHTArrayView<int32_t> view(&perm_arg);
+    perm.assign(view.begin(), view.end());
+  } else if (perm_arg.dtype() == DType::I64) {
+    DHTArrayView<int64_t> view(&perm_arg);
+    perm.assign(view.begin(), view.end());
+  } else {
+    return MakeStringError("Unsupported permutation data type");
+  }
+
+  if (perm.size() != rank) {
+    return MakeStringError("Transpose permutation size ", perm.size(),
+                           " must match the input rank ", rank);
+  }
+
+  llvm::SmallVector<bool, 5> seen(rank, false);
+  for (Index dim : perm) {
+    if (dim < 0 || dim >= rank || seen[dim]) {
+      return MakeStringError("Transpose permutation is not a permutation of ",
+                             rank, " dimensions");
+    }
+    seen[dim] = true;
+  }
+
+  return perm;
+}
+
+TensorShape TransposedShape(const TensorShape& input_shape,
+                            ArrayRef<Index> perm) {
+  llvm::SmallVector<Index, 5> dims;
+  for (Index dim : perm) dims.push_back(input_shape.GetDimensionSize(dim));
+  return TensorShape(dims);
+}
+
+namespace internal {
+namespace {
+
+// The preferred size of the strips transposed by one parallel task.
+constexpr size_t kTransposeBlockBytes = 64 * 1024;
+
+// Elements with a size that doesn't match a builtin type.
+template <size_t N>
+struct Bytes {
+  uint8_t bytes[N];
+};
+
+// The tile size of the micro-kernels.
+template <typename T>
+constexpr Index kMicroKernelSize = sizeof(T) >= 8 ? 4 : 8;
+
+// Transposes the `rows` x `cols` tile: out[i * out_i + j] = in[i + j * in_j].
+template <typename T>
+void TransposeTileScalar(const T* in, T* out, Index rows, Index cols,
+                         Index in_j, Index out_i) {
+  for (Index i = 0; i < rows; ++i)
+    for (Index j = 0; j < cols; ++j) out[i * out_i + j] = in[i + j * in_j];
+}
+
+// Transposes a kMicroKernelSize<T> square tile.
+template <typename T>
+void TransposeMicroKernel(const T* in, T* out, Index in_j, Index out_i) {
+  constexpr Index n = kMicroKernelSize<T>;
+  TransposeTileScalar(in, out, n, n, in_j, out_i);
+}
+
+#if defined(__AVX__)
+template <>
+void TransposeMicroKernel<uint32_t>(const uint32_t* in, uint32_t* out,
+                                    Index in_j, Index out_i) {
+  const float* src = reinterpret_cast<const float*>(in);
+  float* dst = reinterpret_cast<float*>(out);
+
+  __m256 r0 = _mm256_loadu_ps(src + 0 * in_j);
+  __m256 r1 = _mm256_loadu_ps(src + 1 * in_j);
+  __m256 r2 = _mm256_loadu_ps(src + 2 * in_j);
+  __m256 r3 = _mm256_loadu_ps(src + 3 * in_j);
+  __m256 r4 = _mm256_loadu_ps(src + 4 * in_j);
+  __m256 r5 = _mm256_loadu_ps(src + 5 * in_j);
+  __m256 r6 = _mm256_loadu_ps(src + 6 * in_j);
+  __m256 r7 = _mm256_loadu_ps(src + 7 * in_j);
+
+  // Interleave pairs of rows, then pairs of pairs within 128 bit lanes.
+  __m256 t0 = _mm256_unpacklo_ps(r0, r1);
+  __m256 t1 = _mm256_unpackhi_ps(r0, r1);
+  __m256 t2 = _mm256_unpacklo_ps(r2, r3);
+  __m256 t3 = _mm256_unpackhi_ps(r2, r3);
+  __m256 t4 = _mm256_unpacklo_ps(r4, r5);
+  __m256 t5 = _mm256_unpackhi_ps(r4, r5);
+  __m256 t6 = _mm256_unpacklo_ps(r6, r7);
+  __m256 t7 = _mm256_unpackhi_ps(r6, r7);
+
+  r0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+  r1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+  r2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+  r3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+  r4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+  r5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+  r6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+  r7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+
+  // Swap the 128 bit lanes.
+  _mm256_storeu_ps(dst + 0 * out_i, _mm256_permute2f128_ps(r0, r4, 0x20));
+  _mm256_storeu_ps(dst + 1 * out_i, _mm256_permute2f128_ps(r1, r5, 0x20));
+  _mm256_storeu_ps(dst + 2 * out_i, _mm256_permute2f128_ps(r2, r6, 0x20));
+  _mm256_storeu_ps(dst + 3 * out_i, _mm256_permute2f128_ps(r3, r7, 0x20));
+  _mm256_storeu_ps(dst + 4 * out_i, _mm256_permute2f128_ps(r0, r4, 0x31));
+  _mm256_storeu_ps(dst + 5 * out_i, _mm256_permute2f128_ps(r1, r5, 0x31));
+  _mm256_storeu_ps(dst + 6 * out_i, _mm256_permute2f128_ps(r2, r6, 0x31));
+  _mm256_storeu_ps(dst + 7 * out_i, _mm256_permute2f128_ps(r3, r7, 0x31));
+}
+
+template <>
+void TransposeMicroKernel<uint64_t>(const uint64_t* in, uint64_t* out,
+                                    Index in_j, Index out_i) {
+  const double* src = reinterpret_cast<const double*>(in);
+  double* dst = reinterpret_cast<double*>(out);
+
+  __m256d r0 = _mm256_loadu_pd(src + 0 * in_j);
+  __m256d r1 = _mm256_loadu_pd(src + 1 * in_j);
+  __m256d r2 = _mm256_loadu_pd(src + 2 * in_j);
+  __m256d r3 = _mm256_loadu_pd(src + 3 * in_j);
+
+  __m256d t0 = _mm256_unpacklo_pd(r0, r1);
+  __m256d t1 = _mm256_unpackhi_pd(r0, r1);
+  __m256d t2 = _mm256_unpacklo_pd(r2, r3);
+  __m256d t3 = _mm256_unpackhi_pd(r2, r3);
+
+  _mm256_storeu_pd(dst + 0 * out_i, _mm256_permute2f128_pd(t0, t2, 0x20));
+  _mm256_storeu_pd(dst + 1 * out_i, _mm256_permute2f128_pd(t1, t3, 0x20));
+  _mm256_storeu_pd(dst + 2 * out_i, _mm256_permute2f128_pd(t0, t2, 0x31));
+  _mm256_storeu_pd(dst + 3 * out_i, _mm256_permute2f128_pd(t1, t3, 0x31));
+}
+#endif  // __AVX__
+
+#if defined(__SSE2__)
+template <>
+void TransposeMicroKernel<uint16_t>(const uint16_t* in, uint16_t* out,
+                                    Index in_j, Index out_i) {
+  auto load = [&](Index j) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + j * in_j));
+  };
+  auto store = [&](Index i, __m128i value) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * out_i), value);
+  };
+
+  __m128i r0 = load(0), r1 = load(1), r2 = load(2), r3 = load(3);
+  __m128i r4 = load(4), r5 = load(5), r6 = load(6), r7 = load(7);
+
+  // Interleave 16, 32 and then 64 bit elements of pairs of rows.
+  __m128i t0 = _mm_unpacklo_epi16(r0, r1);
+  __m128i t1 = _mm_unpackhi_epi16(r0, r1);
+  __m128i t2 = _mm_unpacklo_epi16(r2, r3);
+  __m128i t3 = _mm_unpackhi_epi16(r2, r3);
+  __m128i t4 = _mm_unpacklo_epi16(r4, r5);
+  __m128i t5 = _mm_unpackhi_epi16(r4, r5);
+  __m128i t6 = _mm_unpacklo_epi16(r6, r7);
+  __m128i t7 = _mm_unpackhi_epi16(r6, r7);
+
+  r0 = _mm_unpacklo_epi32(t0, t2);
+  r1 = _mm_unpackhi_epi32(t0, t2);
+  r2 = _mm_unpacklo_epi32(t1, t3);
+  r3 = _mm_unpackhi_epi32(t1, t3);
+  r4 = _mm_unpacklo_epi32(t4, t6);
+  r5 = _mm_unpackhi_epi32(t4, t6);
+  r6 = _mm_unpacklo_epi32(t5, t7);
+  r7 = _mm_unpackhi_epi32(t5, t7);
+
+  store(0, _mm_unpacklo_epi64(r0, r4));
+  store(1, _mm_unpackhi_epi64(r0, r4));
+  store(2, _mm_unpacklo_epi64(r1, r5));
+  store(3, _mm_unpackhi_epi64(r1, r5));
+  store(4, _mm_unpacklo_epi64(r2, r6));
+  store(5, _mm_unpackhi_epi64(r2, r6));
+  store(6, _mm_unpacklo_epi64(r3, r7));
+  store(7, _mm_unpackhi_epi64(r3, r7));
+}
+#endif  // __SSE2__
+
+// Returns where to split a side of `size` elements in two, keeping the first
+// part a multiple of the micro-kernel size.
+Index SplitPoint(Index size, Index micro_kernel_size) {
+  return std::max(micro_kernel_size,
+                  size / 2 / micro_kernel_size * micro_kernel_size);
+}
+
+// Transposes a `rows` x `cols` tile by recursively halving its larger side,
+// which keeps the working set of the leaves in cache for any cache size.
+template <typename T>
+void TransposeTile(const T* in, T* out, Index rows, Index cols, Index in_j,
+                   Index out_i) {
+  constexpr Index n = kMicroKernelSize<T>;
+  if (rows <= n && cols <= n) {
+    if (rows == n && cols == n) {
+      TransposeMicroKernel(in, out, in_j, out_i);
+    } else {
+      TransposeTileScalar(in, out, rows, cols, in_j, out_i);
+    }
+    return;
+  }
+
+  if (rows >= cols) {
+    const Index split = SplitPoint(rows, n);
+    TransposeTile(in, out, split, cols, in_j, out_i);
+    TransposeTile(in + split, out + split * out_i, rows - split, cols, in_j,
+                  out_i);
+  } else {
+    const Index split = SplitPoint(cols, n);
+    TransposeTile(in, out, rows, split, in_j, out_i);
+    TransposeTile(in + split * in_j, out + split, rows, cols - split, in_j,
+                  out_i);
+  }
+}
+
+template <typename T>
+void TransposeBlocks(const TransposePlan& plan, const T* in, T* out,
+                     Index begin, Index end) {
+  const int num_batch_dims = plan.batch_dims.size();
+
+  for (Index block = begin; block < end; ++block) {
+    const Index batch = block / plan.blocks_per_batch;
+    const Index block_in_batch = block % plan.blocks_per_batch;
+
+    Index input_offset = 0;
+    Index output_offset = 0;
+    Index remaining = batch;
+    for (int i = num_batch_dims - 1; i >= 0; --i) {
+      const Index index = remaining % plan.batch_dims[i];
+      input_offset += index * plan.batch_input_strides[i];
+      output_offset += index * plan.batch_output_strides[i];
+      remaining /= plan.batch_dims[i];
+    }
+
+    const Index first_row = block_in_batch * plan.rows_per_block;
+    const Index rows = std::min(plan.rows_per_block, plan.rows - first_row);
+    TransposeTile(in + input_offset + first_row,
+                  out + output_offset + first_row * plan.output_i_stride, rows,
+                  plan.cols, plan.input_j_stride, plan.output_i_stride);
+  }
+}
+
+// Copies the blocks of a plan with `element_size` that has no builtin type.
+void TransposeBlocksBytes(const TransposePlan& plan, const char* in, char* out,
+                          Index begin, Index end) {
+  const size_t element_size = plan.element_size;
+  const int num_batch_dims = plan.batch_dims.size();
+
+  for (Index block = begin; block < end; ++block) {
+    const Index batch = block / plan.blocks_per_batch;
+    const Index block_in_batch = block % plan.blocks_per_batch;
+
+    Index input_offset = 0;
+    Index output_offset = 0;
+    Index remaining = batch;
+    for (int i = num_batch_dims - 1; i >= 0; --i) {
+      const Index index = remaining % plan.batch_dims[i];
+      input_offset += index * plan.batch_input_strides[i];
+      output_offset += index * plan.batch_output_strides[i];
+      remaining /= plan.batch_dims[i];
+    }
+
+    const Index first_row = block_in_batch * plan.rows_per_block;
+    const Index last_row = std::min(first_row + plan.rows_per_block, plan.rows);
+    for (Index i = first_row; i < last_row; ++i) {
+      for (Index j = 0; j < plan.cols; ++j) {
+        const Index src = input_offset + i + j * plan.input_j_stride;
+        const Index dst = output_offset + i * plan.output_i_stride + j;
+        std::memcpy(out + dst * element_size, in + src * element_size,
+                    element_size);
+      }
+    }
+  }
+}
+
+}  // namespace
+
+TransposePlan MakeTransposePlan(const TensorShape& input_shape,
+                                ArrayRef<Index> perm, size_t element_size) {
+  const int rank = input_shape.GetRank();
+  assert(perm.size() == rank);
+
+  TransposePlan plan;
+
+  // Drop the dimensions of size one, they don't affect the memory layout.
+  llvm::SmallVector<Index, 5> new_index(rank, -1);
+  llvm::SmallVector<Index, 5> dims;
+  for (int i = 0; i < rank; ++i) {
+    const Index dim = input_shape.GetDimensionSize(i);
+    if (dim == 0) return plan;
+    if (dim == 1) continue;
+    new_index[i] = dims.size();
+    dims.push_back(dim);
+  }
+
+  // Collapse the input dimensions that are consecutive in the output into
+  // groups, in the output order.
+  llvm::SmallVector<Index, 5> group_begin;  // The first input dimension.
+  llvm::SmallVector<Index, 5> group_last;   // The last input dimension.
+  llvm::SmallVector<Index, 5> group_size;
+  for (Index input_dim : perm) {
+    const Index dim = new_index[input_dim];
+    if (dim < 0) continue;
+    if (!group_last.empty() && dim == group_last.back() + 1) {
+      group_last.back() = dim;
+      group_size.back() *= dims[dim];
+    } else {
+      group_begin.push_back(dim);
+      group_last.push_back(dim);
+      group_size.push_back(dims[dim]);
+    }
+  }
+
+  // Number the groups in the input order.
+  const int num_groups = group_begin.size();
+  llvm::SmallVector<Index, 5> collapsed_perm(num_groups);
+  llvm::SmallVector<Index, 5> collapsed_dims(num_groups);
+  for (int g = 0; g < num_groups; ++g) {
+    Index input_position = 0;
+    for (int h = 0; h < num_groups; ++h)
+      if (group_begin[h] < group_begin[g]) ++input_position;
+    collapsed_perm[g] = input_position;
+    collapsed_dims[input_position] = group_size[g];
+  }
+
+  plan.element_size = element_size;
+
+  // The innermost input rows that are not moved are transposed as elements.
+  int collapsed_rank = num_groups;
+  if (collapsed_rank > 0 &&
+      collapsed_perm[collapsed_rank - 1] == collapsed_rank - 1) {
+    plan.element_size *= collapsed_dims[collapsed_rank - 1];
+    --collapsed_rank;
+  }
+
+  if (collapsed_rank <= 1) {
+    plan.is_identity = true;
+    return plan;
+  }
+
+  llvm::SmallVector<Index, 5> input_strides(collapsed_rank);
+  Index stride = 1;
+  for (int i = collapsed_rank - 1; i >= 0; --i) {
+    input_strides[i] = stride;
+    stride *= collapsed_dims[i];
+  }
+
+  llvm::SmallVector<Index, 5> output_strides(collapsed_rank);
+  stride = 1;
+  for (int i = collapsed_rank - 1; i >= 0; --i) {
+    output_strides[i] = stride;
+    stride *= collapsed_dims[collapsed_perm[i]];
+  }
+
+  const int innermost = collapsed_rank - 1;
+  Index num_batches = 1;
+  for (int i = 0; i < collapsed_rank; ++i) {
+    const Index input_dim = collapsed_perm[i];
+    if (input_dim == innermost) {
+      plan.rows = collapsed_dims[input_dim];
+      plan.output_i_stride = output_strides[i];
+    } else if (i == innermost) {
+      plan.cols = collapsed_dims[input_dim];
+      plan.input_j_stride = input_strides[input_dim];
+    } else {
+      plan.batch_dims.push_back(collapsed_dims[input_dim]);
+      plan.batch_input_strides.push_back(input_strides[input_dim]);
+      plan.batch_output_strides.push_back(output_strides[i]);
+      num_batches *= collapsed_dims[input_dim];
+    }
+  }
+
+  const size_t row_bytes = plan.cols * plan.element_size;
+  constexpr Index kRowAlignment = 8;
+  plan.rows_per_block =
+      std::max<Index>(kRowAlignment, kTransposeBlockBytes / row_bytes /
+                                         kRowAlignment * kRowAlignment);
+  plan.rows_per_block = std::min(plan.rows_per_block, plan.rows);
+  plan.blocks_per_batch =
+      (plan.rows + plan.rows_per_block - 1) / plan.rows_per_block;
+  plan.num_blocks = num_batches * plan.blocks_per_batch;
+
+  return plan;
+}
+
+void TransposeBlocks(const TransposePlan& plan, const void* input,
+                     void* output, Index begin, Index end) {
+  switch (plan.element_size) {
+#define TRANSPOSE_BLOCKS(SIZE, T)                                        \
+  case SIZE:                                                             \
+    return TransposeBlocks(plan, static_cast<const T*>(input),           \
+                           static_cast<T*>(output), begin, end);
+    TRANSPOSE_BLOCKS(1, uint8_t)
+    TRANSPOSE_BLOCKS(2, uint16_t)
+    TRANSPOSE_BLOCKS(4, uint32_t)
+    TRANSPOSE_BLOCKS(8, uint64_t)
+    TRANSPOSE_BLOCKS(16, Bytes<16>)
+#undef TRANSPOSE_BLOCKS
+    default:
+      TransposeBlocksBytes(plan, static_cast<const char*>(input),
+                           static_cast<char*>(output), begin, end);
+  }
+}
+
+}  // namespace internal
+}  // namespace cpu
+}  // namespace tfrt
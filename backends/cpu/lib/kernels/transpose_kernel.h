@@ -0,0 +1,121 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Tensorflow Transpose kernel implementation.
+//
+// Dimensions that keep their relative order are collapsed first, so that e.g.
+// NHWC to NCHW becomes a batch of [HW, C] to [C, HW] transposes. A permutation
+// that does not move any dimension of size larger than one only changes the
+// metadata, and the output can share the input buffer. If the innermost
+// dimension is not moved, whole rows are copied with memcpy.
+//
+// Otherwise every transpose of the innermost input dimension and the innermost
+// output dimension is split into strips that are transposed in parallel. A
+// strip is recursively halved along its larger side until the tiles fit a
+// micro-kernel, so that the tiles stay in cache irrespective of the cache
+// sizes. The 8x8 micro-kernels for 2 and 4 byte elements and the 4x4
+// micro-kernel for 8 byte elements use SSE2 and AVX when available.
+
+#ifndef TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_TRANSPOSE_KERNEL_H_
+#define TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_TRANSPOSE_KERNEL_H_
+
+#include "llvm/ADT/SmallVector.h"
+#include "tfrt/common/compat/eigen/eigen_evaluator.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/tensor_shape.h"
+
+namespace tfrt {
+namespace cpu {
+
+// Reads the transpose permutation from an int32 or int64 vector, and checks
+// that it is a permutation of the `rank` input dimensions.
+Expected<llvm::SmallVector<Index, 5>> TransposePermutation(
+    const DenseHostTensor& perm_arg, int rank);
+
+// Returns the shape of the input transposed with `perm`.
+TensorShape TransposedShape(const TensorShape& input_shape,
+                            ArrayRef<Index> perm);
+
+namespace internal {
+
+// Describes how a transpose is split into blocks that are transposed in
+// parallel.
+struct TransposePlan {
+  // True if the transpose does not move any data.
+  bool is_identity = false;
+
+  // The size of the elements transposed by the micro-kernels. Rows of the
+  // innermost input dimension that are not moved count as one element.
+  size_t element_size = 0;
+
+  // The innermost output dimension `j` is the input dimension with stride
+  // `input_j_stride`, and the innermost input dimension `i` is the output
+  // dimension with stride `output_i_stride`.
+  Index rows = 0;  // Size of dimension `i`.
+  Index cols = 0;  // Size of dimension `j`.
+  Index input_j_stride = 0;
+  Index output_i_stride = 0;
+
+  // The remaining output dimensions and their input and output strides.
+  llvm::SmallVector<Index, 5> batch_dims;
+  llvm::SmallVector<Index, 5> batch_input_strides;
+  llvm::SmallVector<Index, 5> batch_output_strides;
+
+  // Every transpose in the batch is split into strips of `rows_per_block`
+  // rows of dimension `i`.
+  Index rows_per_block = 0;
+  Index blocks_per_batch = 0;
+  Index num_blocks = 0;
+};
+
+TransposePlan MakeTransposePlan(const TensorShape& input_shape,
+                                ArrayRef<Index> perm, size_t element_size);
+
+// Transposes the blocks [begin, end) of `input` to `output`.
+void TransposeBlocks(const TransposePlan& plan, const void* input,
+                     void* output, Index begin, Index end);
+
+}  // namespace internal
+
+// Writes `input` transposed with `perm` to `output`. The caller handles the
+// identity plans, for which the output can share the input buffer.
+template <typename EigenEvaluator>
+static typename EigenEvaluator::DependencyToken Transpose(
+    const DenseHostTensor& input, const internal::TransposePlan& plan,
+    DenseHostTensor* output, const ExecutionContext& exec_ctx) {
+  EigenEvaluator eigen{exec_ctx.host()};
+
+  const void* input_data = input.data();
+  void* output_data = output->data();
+
+  const double block_bytes =
+      plan.rows_per_block * plan.cols * plan.element_size;
+  Eigen::TensorOpCost cost(block_bytes, block_bytes, 0);
+
+  return eigen.ParallelFor(
+      plan.num_blocks, cost,
+      [plan, input_data, output_data](Eigen::Index begin, Eigen::Index end) {
+        internal::TransposeBlocks(plan, input_data, output_data, begin, end);
+      },
+      eigen.KeepAlive(&input, output));
+}
+
+}  // namespace cpu
+}  // namespace tfrt
+
+#endif  // TFRT_BACKENDS_CPU_LIB_KERNELS_CPU_TRANSPOSE_KERNEL_H_
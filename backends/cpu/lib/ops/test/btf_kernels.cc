@@ -14,9 +14,16 @@
 
 // This file implements kernels for reading tensors from file.
 
+#include <optional>
+
+#include "llvm/ADT/StringMap.h"
 #include "tfrt/cpu/ops/test/cpu_ops_and_kernels.h"
+#include "tfrt/host_context/async_dispatch.h"
 #include "tfrt/host_context/kernel_registry.h"
 #include "tfrt/host_context/kernel_utils.h"
+#include "tfrt/io/file_system.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/tensor/btf_mapped_file.h"
 #include "tfrt/tensor/btf_util.h"
 
 namespace tfrt {
@@ -38,6 +45,125 @@ struct ParseDenseHostTensorTraits {
 template <typename DType_, size_t Rank_>
 constexpr size_t ParseDenseHostTensorTraits<DType_, Rank_>::kRank;
 
+// Returns the mapping of the BTF file at `path`. Files are mapped, and their
+// offset tables validated, once per process.
+Expected<RCReference<MappedBTFFile>> GetMappedBTFFile(const std::string& path) {
+  static mutex* mu = new mutex();
+  static auto* files = new llvm::StringMap<RCReference<MappedBTFFile>>();
+
+  mutex_lock lock(*mu);
+  auto& file = (*files)[path];
+  if (!file) {
+    auto opened = MappedBTFFile::Open(path);
+    if (!opened) return opened.takeError();
+    file = std::move(*opened);
+  }
+  return file.CopyRef();
+}
+
+// Kernel to read a tensor from a memory mapped BTF file without copying it.
+// Unlike btf.read_dense_tensor, the dtype and rank are taken from the file.
+Expected<DenseHostTensor> ReadMappedDenseTensor(
+    std::string path, int32_t index, const ExecutionContext& exec_ctx) {
+  auto file = GetMappedBTFFile(path);
+  if (!file) return file.takeError();
+  if (index < 0) return MakeStringError("invalid tensor index ", index);
+  return (*file)->GetDenseHostTensor(index, exec_ctx.host());
+}
+
+// Kernel to read several tensors from a BTF file in parallel. Every tensor is
+// read by a separate task on the blocking work queue.
+// The arguments of the kernel are:
+//   argument 0 (std::string): The path of a binary tensor file.
+//   attribute `indices` (i32 array): The indices of the tensors to read.
+//
+// The return values are the tensors, in the order of `indices`.
+void ReadAllFromBTF(Argument<std::string> path, RemainingResults results,
+                    ArrayAttribute<int32_t> indices,
+                    const ExecutionContext& exec_ctx) {
+  assert(indices.size() == results.size());
+  HostContext* host = exec_ctx.host();
+
+  std::vector<int32_t> tensor_indices(indices.begin(), indices.end());
+  std::vector<AsyncValueRef<DenseHostTensor>> tensors;
+  tensors.reserve(results.size());
+  for (int i = 0, e = results.size(); i < e; ++i) {
+    tensors.push_back(MakeUnconstructedAsyncValueRef<DenseHostTensor>());
+    results[i] = tensors.back().CopyRCRef();
+  }
+
+  auto set_error = [exec_ctx](AsyncValueRef<DenseHostTensor>& tensor,
+                              Error error) {
+    tensor.SetError(EmitError(exec_ctx, std::move(error)).status);
+  };
+
+  // Opening the file and reading the offset table blocks too.
+  bool enqueued = EnqueueBlockingWork(
+      host, [host, path = path.get(), tensor_indices = std::move(tensor_indices),
+             tensors = std::move(tensors), set_error]() mutable {
+        auto set_all_errors = [&](Error error) {
+          std::string message = toString(std::move(error));
+          for (auto& tensor : tensors)
+            set_error(tensor, MakeStringError(message));
+        };
+
+        io::FileSystem* file_system =
+            io::FileSystemRegistry::Default()->LookupForPath(path);
+        if (file_system == nullptr) {
+          return set_all_errors(
+              MakeStringError("no file system registered for ", path));
+        }
+        std::unique_ptr<io::RandomAccessFile> opened;
+        if (auto error = file_system->NewRandomAccessFile(path, &opened))
+          return set_all_errors(std::move(error));
+        std::shared_ptr<io::RandomAccessFile> file = std::move(opened);
+
+        auto offsets = ReadBTFOffsets(*file);
+        if (!offsets) return set_all_errors(offsets.takeError());
+        auto checksums = ReadBTFChecksums(*file, *offsets);
+        if (!checksums) return set_all_errors(checksums.takeError());
+
+        for (int i = 0, e = tensors.size(); i < e; ++i) {
+          const int32_t index = tensor_indices[i];
+          if (index < 0 || index >= offsets->size()) {
+            set_error(tensors[i],
+                      MakeStringError("invalid tensor index ", index,
+                                      " to read tensor from path ", path,
+                                      " which contains ", offsets->size(),
+                                      " tensors"));
+            continue;
+          }
+
+          const uint64_t offset = (*offsets)[index];
+          // Files written without checksums are not verified.
+          std::optional<uint32_t> checksum;
+          if (!checksums->empty()) checksum = (*checksums)[index];
+          bool enqueued = EnqueueBlockingWork(
+              host, [host, file, offset, checksum,
+                     tensor = tensors[i].CopyRef(), set_error]() mutable {
+                auto dht = ReadDHTFromBTF(*file, offset, host);
+                if (!dht) return set_error(tensor, dht.takeError());
+                if (checksum && ComputeBTFChecksum(*dht) != *checksum) {
+                  return set_error(
+                      tensor, MakeStringError(
+                                  "checksum mismatch for tensor at offset ",
+                                  offset));
+                }
+                tensor.emplace(std::move(*dht));
+              });
+          if (!enqueued) {
+            set_error(tensors[i],
+                      MakeStringError("failed to enqueue blocking read"));
+          }
+        }
+      });
+  if (!enqueued) {
+    auto diag = EmitError(exec_ctx, "failed to enqueue blocking read");
+    for (int i = 0, e = results.size(); i < e; ++i)
+      results[i]->SetError(diag.status);
+  }
+}
+
 template <size_t Rank>
 void RegisterDenseTensorReaders(KernelRegistry* registry) {
   registry->AddKernel(
@@ -67,6 +193,9 @@ void RegisterBTFIOKernels(KernelRegistry* registry) {
   RegisterDenseTensorReaders<2>(registry);
   RegisterDenseTensorReaders<3>(registry);
   RegisterDenseTensorReaders<4>(registry);
+  registry->AddKernel("btf.read_mapped_dense_tensor",
+                      TFRT_KERNEL(ReadMappedDenseTensor));
+  registry->AddKernel("btf.read_all", TFRT_KERNEL(ReadAllFromBTF));
 }
 
 }  // namespace tfrt
@@ -0,0 +1,130 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements ops for handling CSR host tensors.
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+#include "tfrt/core_runtime/op_utils.h"
+#include "tfrt/cpu/core_runtime/cpu_op_registry.h"
+#include "tfrt/cpu/ops/test/cpu_ops_and_kernels.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/parallel_for.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/tensor/csr_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+namespace {
+
+// The minimum number of multiply-adds of a parallel block.
+constexpr int64_t kMinBlockCost = 16 * 1024;
+
+// Computes rows [begin, end) of out = a * b. Each non-zero element of a row of
+// `a` scales a whole contiguous row of `b` into the output row, so the inner
+// loop is a unit stride axpy that the compiler vectorizes.
+template <typename T>
+void CsrMatMulRows(const CsrHostTensor& a, const T* __restrict b, Index n,
+                   T* __restrict out, size_t begin, size_t end) {
+  const int64_t* row_ptrs = a.RowPtrs();
+  const int64_t* col_indices = a.ColIndices();
+  const T* values = static_cast<const T*>(a.Values()->data());
+  for (size_t r = begin; r != end; ++r) {
+    T* __restrict out_row = out + r * n;
+    std::fill(out_row, out_row + n, T(0));
+    for (int64_t k = row_ptrs[r]; k != row_ptrs[r + 1]; ++k) {
+      const T value = values[k];
+      const T* __restrict b_row = b + col_indices[k] * n;
+      for (Index j = 0; j != n; ++j) out_row[j] += value * b_row[j];
+    }
+  }
+}
+
+// This implements "c = tfrt_test.csr_matmul(a, b)", which multiplies the
+// sparse matrix `a` by the dense matrix `b`. Rows of the output are computed in
+// parallel, with adaptive blocks since the rows differ in their number of
+// non-zero elements.
+static AsyncValueRef<DenseHostTensor> CsrMatMulOp(
+    const CsrHostTensor& a, const DenseHostTensor& b,
+    const ExecutionContext& exec_ctx) {
+  if (b.shape().GetRank() != 2 ||
+      b.shape().GetDimensionSize(0) != a.NumCols()) {
+    return EmitErrorAsync(exec_ctx,
+                          StrCat("cannot multiply sparse matrix of shape ",
+                                 a.shape(), " by dense tensor of shape ",
+                                 b.shape()));
+  }
+  if (a.dtype() != b.dtype()) {
+    return EmitErrorAsync(exec_ctx, StrCat("mismatched dtypes ", a.dtype(),
+                                           " and ", b.dtype()));
+  }
+
+  const Index m = a.NumRows();
+  const Index n = b.shape().GetDimensionSize(1);
+  const TensorMetadata output_md(a.dtype(), std::array<Index, 2>{m, n});
+  auto output =
+      DenseHostTensor::MakeConstructedAsyncValueRef(output_md, exec_ctx.host());
+  if (!output) {
+    return EmitErrorAsync(exec_ctx, "out of memory allocating result");
+  }
+
+  auto dispatch = [&](auto type_tag) {
+    using T = decltype(type_tag);
+    auto compute = [a = a.CopyRef(), b = b.CopyRef(), n,
+                    out = &output.get()](size_t begin, size_t end) {
+      CsrMatMulRows<T>(a, static_cast<const T*>(b.data()), n,
+                       static_cast<T*>(out->data()), begin, end);
+    };
+    const int64_t row_cost =
+        std::max<int64_t>(1, a.NumNonZeros() * n / std::max<Index>(1, m));
+    const size_t min_block_size =
+        std::max<int64_t>(1, kMinBlockCost / row_cost);
+    ParallelFor(exec_ctx).Execute(
+        m, ParallelFor::BlockSizes::Adaptive(min_block_size),
+        std::move(compute),
+        [output = output.CopyRef()]() mutable { output.SetStateConcrete(); });
+  };
+
+  switch (a.dtype()) {
+    case DType::F32:
+      dispatch(float{});
+      break;
+    case DType::F64:
+      dispatch(double{});
+      break;
+    case DType::I32:
+      dispatch(int32_t{});
+      break;
+    case DType::I64:
+      dispatch(int64_t{});
+      break;
+    default:
+      return EmitErrorAsync(exec_ctx,
+                            StrCat("unsupported dtype ", a.dtype(),
+                                   " for tfrt_test.csr_matmul"));
+  }
+  return output;
+}
+
+}  // namespace
+
+void RegisterCsrCpuOps(CpuOpRegistry* op_registry) {
+  op_registry->AddOp("tfrt_test.csr_matmul", TFRT_CPU_OP(CsrMatMulOp),
+                     CpuOpFlags::NoSideEffects | CpuOpFlags::AllowsCsr);
+}
+
+}  // namespace tfrt
@@ -44,6 +44,7 @@ static void RegisterMetadataFn(CpuOpRegistry* registry) {
 
 static void RegisterDispatchFn(CpuOpRegistry* registry) {
   RegisterCooCpuOps(registry);
+  RegisterCsrCpuOps(registry);
   RegisterTestMnistCpuOps(registry);
   RegisterTestCpuOps(registry);
 }
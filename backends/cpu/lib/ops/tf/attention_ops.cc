@@ -0,0 +1,88 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Tensorflow attention operations.
+
+#include "attention_ops.h"
+
+#include <cmath>
+
+#include "../../kernels/attention_kernel.h"
+#include "tfrt/common/compat/eigen/eigen_dtype.h"
+#include "tfrt/common/compat/eigen/eigen_evaluator.h"
+#include "tfrt/core_runtime/op_attrs.h"
+#include "tfrt/core_runtime/op_utils.h"
+#include "tfrt/cpu/core_runtime/cpu_op_registry.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/kernel_utils.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "type_dispatch.h"
+
+namespace tfrt {
+namespace {
+
+// tf._ScaledDotProductAttention computes the attention of `query` over `key`
+// and `value` without materializing the attention scores. The optional fusion
+// input is a padding mask for the keys. The scale defaults to
+// 1 / sqrt(depth).
+static AsyncValueRef<DenseHostTensor> TfScaledDotProductAttentionOp(
+    const DenseHostTensor& query, const DenseHostTensor& key,
+    const DenseHostTensor& value,
+    RepeatedArguments<DenseHostTensor> fusion_inputs, const OpAttrsRef& attrs,
+    const TensorMetadata& output_md, const ExecutionContext& exec_ctx) {
+  HostContext* host = exec_ctx.host();
+
+  if (fusion_inputs.size() > 1) {
+    return EmitErrorAsync(exec_ctx,
+                          "attention takes at most one padding mask");
+  }
+  const DenseHostTensor* padding_mask =
+      fusion_inputs.size() == 1 ? &fusion_inputs[0] : nullptr;
+
+  auto output = DenseHostTensor::CreateUninitialized(output_md, host);
+  if (!output) {
+    return EmitErrorAsync(exec_ctx, "out of memory allocating result");
+  }
+
+  const Index depth = query.shape().GetDimensionSize(3);
+  float scale = attrs.GetOptional<float>("scale").value_or(
+      1.0f / std::sqrt(static_cast<float>(depth)));
+  bool causal = attrs.GetOptional<bool>("causal").value_or(false);
+
+  auto unsupported = [&](DType dtype) -> AsyncValueRef<Chain> {
+    return EmitErrorAsync(exec_ctx, StrCat("Unsupported input dtype: ", dtype));
+  };
+
+  auto dispatch = [&](auto type_tag) -> AsyncValueRef<Chain> {
+    using T = decltype(type_tag);
+    return cpu::ScaledDotProductAttention<T, compat::AsyncEigenEvaluator>(
+        query, key, value, padding_mask, &*output, scale, causal, exec_ctx);
+  };
+
+  // 16-bit floating point inputs are computed in float.
+  internal::FloatTypeDispatch type_dispatch(query.dtype());
+  return ForwardValue(output.value(), type_dispatch(dispatch, unsupported));
+}
+
+}  // namespace
+
+void RegisterTfAttentionCpuOps(CpuOpRegistry* op_registry) {
+  op_registry->AddOp("tf._ScaledDotProductAttention",
+                     TFRT_CPU_OP(TfScaledDotProductAttentionOp),
+                     CpuOpFlags::NoSideEffects, {"scale", "causal"});
+}
+
+}  // namespace tfrt
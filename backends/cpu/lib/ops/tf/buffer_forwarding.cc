@@ -19,6 +19,7 @@
 #include <utility>
 
 #include "tfrt/host_context/diagnostic.h"
+#include "tfrt/support/error_util.h"
 #include "tfrt/tensor/dense_host_tensor.h"
 
 namespace tfrt {
@@ -56,4 +57,14 @@ AsyncValueRef<DenseHostTensor> ForwardInputOrAllocateOutput(
   return allocated;
 }
 
+Expected<DenseHostTensor> MakeDenseHostTensorView(
+    const TensorMetadata& output_md, const DenseHostTensor& input) {
+  if (output_md.GetHostSizeInBytes() != input.DataSizeInBytes())
+    return MakeStringError("Can't view a tensor of ", input.DataSizeInBytes(),
+                           " bytes as a tensor of ",
+                           output_md.GetHostSizeInBytes(), " bytes");
+
+  return DenseHostTensor(output_md, input.buffer());
+}
+
 }  // namespace tfrt
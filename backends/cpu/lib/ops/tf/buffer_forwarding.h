@@ -74,6 +74,17 @@ AsyncValueRef<DenseHostTensor> ForwardInputOrAllocateOutput(
                                       ArrayRef<Argument<Tensor>>(inputs));
 }
 
+// Returns a DenseHostTensor with the `output_md` metadata that shares the
+// buffer of `input`, for operations that only change the tensor metadata (e.g.
+// tf.Reshape). `output_md` must describe a buffer of the same size.
+//
+// No data is copied. While both tensors are alive neither of them is the
+// exclusive owner of the buffer, so ForwardInputOrAllocateOutput does not
+// forward either of them and in-place updates of one are never visible in the
+// other.
+Expected<DenseHostTensor> MakeDenseHostTensorView(
+    const TensorMetadata& output_md, const DenseHostTensor& input);
+
 }  // namespace tfrt
 
 #endif  // TFRT_BACKENDS_CPU_OPS_TF_BUFFER_FORWARDING_H_
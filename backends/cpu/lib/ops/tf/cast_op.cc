@@ -0,0 +1,97 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Tensorflow Cast operation.
+
+#include "cast_op.h"
+
+#include "../../kernels/cast_kernel.h"
+#include "tfrt/common/compat/eigen/eigen_dtype.h"
+#include "tfrt/common/compat/eigen/eigen_evaluator.h"
+#include "tfrt/core_runtime/op_attrs.h"
+#include "tfrt/core_runtime/op_utils.h"
+#include "tfrt/cpu/core_runtime/cpu_op_registry.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/kernel_utils.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "type_dispatch.h"
+
+namespace tfrt {
+namespace {
+
+// clang-format off
+// The dtypes that tf.Cast converts from and to.
+using CastTypeDispatch = typename internal::GetTypeDispatch<
+    DType::UI8, DType::UI16, DType::UI32, DType::UI64, DType::I1,
+    DType::I8,  DType::I16,  DType::I32,  DType::I64,
+    DType::F16, DType::BF16, DType::F32, DType::F64,
+    DType::Complex64, DType::Complex128>::Type;
+// clang-format on
+
+// Casts `input` to the "DstT" dtype of `output_md`. Floating point values cast
+// to integers are saturated, and are rounded with the optional
+// "rounding_mode" attribute: "truncate" (the default, as in Tensorflow),
+// "half_to_even" or "half_away_from_zero".
+static AsyncValueRef<DenseHostTensor> TfCastOp(
+    const DenseHostTensor& input, const OpAttrsRef& attrs,
+    const TensorMetadata& output_md, const ExecutionContext& exec_ctx) {
+  cpu::CastRounding rounding = cpu::CastRounding::kTruncate;
+  if (auto rounding_mode = attrs.GetStringOptional("rounding_mode")) {
+    if (*rounding_mode == "half_to_even") {
+      rounding = cpu::CastRounding::kHalfToEven;
+    } else if (*rounding_mode == "half_away_from_zero") {
+      rounding = cpu::CastRounding::kHalfAwayFromZero;
+    } else if (*rounding_mode != "truncate") {
+      return EmitErrorAsync(
+          exec_ctx, StrCat("unsupported rounding mode: ", *rounding_mode));
+    }
+  }
+
+  auto dest = DenseHostTensor::CreateUninitialized(output_md, exec_ctx.host());
+  if (!dest) {
+    return EmitErrorAsync(exec_ctx, "out of memory allocating result");
+  }
+
+  auto unsupported = [&](DType dtype) -> AsyncValueRef<Chain> {
+    return EmitErrorAsync(exec_ctx, StrCat("unsupported dtype: ", dtype));
+  };
+
+  auto dispatch = [&](auto src_tag) -> AsyncValueRef<Chain> {
+    using SrcT = decltype(src_tag);
+    return CastTypeDispatch(output_md.dtype)(
+        [&](auto dst_tag) -> AsyncValueRef<Chain> {
+          using DstT = decltype(dst_tag);
+          return cpu::Cast<SrcT, DstT, compat::AsyncEigenEvaluator>(
+              input, &*dest, rounding, exec_ctx);
+        },
+        unsupported);
+  };
+
+  CastTypeDispatch type_dispatch(input.dtype());
+  return ForwardValue(dest.value(), type_dispatch(dispatch, unsupported));
+}
+
+}  // namespace
+
+void RegisterTfCastCpuOp(CpuOpRegistry* op_registry) {
+  op_registry->AddOp("tf.Cast", TFRT_CPU_OP(TfCastOp),
+                     CpuOpFlags::NoSideEffects, {"DstT", "rounding_mode"});
+}
+
+}  // namespace tfrt
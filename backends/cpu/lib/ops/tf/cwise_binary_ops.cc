@@ -96,23 +96,12 @@ static AsyncValueRef<HostTensor> TfBinaryOp(Argument<HostTensor> lhs,
   return type_dispatch(dispatch, unsupported);
 }
 
-// clang-format off
-using Numeric = typename internal::GetTypeDispatch<
-    DType::UI8, DType::UI16, DType::UI32, DType::UI64,
-    DType::I8,  DType::I16,  DType::I32,  DType::I64,
-    DType::F16, DType::F32,  DType::F64>::Type;
-
-using NumericAndComplex = typename internal::GetTypeDispatch<
-    DType::UI8, DType::UI16, DType::UI32, DType::UI64,
-    DType::I8,  DType::I16,  DType::I32,  DType::I64,
-    DType::F16, DType::F32,  DType::F64,
-    DType::Complex64, DType::Complex128>::Type;
-// clang-format on
-
 template <typename Functor, bool complex = true>
 void RegisterTfBinaryOp(CpuOpRegistry* op_registry, string_view op_name) {
   using TypeDispatch =
-      typename std::conditional<complex, NumericAndComplex, Numeric>::type;
+      typename std::conditional<complex,
+                                internal::NumericAndComplexTypeDispatch,
+                                internal::NumericTypeDispatch>::type;
   op_registry->AddOp(op_name, TFRT_CPU_OP(TfBinaryOp<Functor, TypeDispatch>),
                      CpuOpFlags::NoSideEffects | CpuOpFlags::AllowsScalar);
 }
@@ -126,7 +115,10 @@ void RegisterTfBinaryCpuOps(CpuOpRegistry* op_registry) {
   RegisterTfBinaryOp<cpu::functor::Sub>(op_registry, "tf.Sub");
 
   // Operations that do not support compex data types.
+  RegisterTfBinaryOp<cpu::functor::Equal, false>(op_registry, "tf.Equal");
   RegisterTfBinaryOp<cpu::functor::Less, false>(op_registry, "tf.Less");
+  RegisterTfBinaryOp<cpu::functor::ReluGrad, false>(op_registry,
+                                                     "tf.ReluGrad");
 }
 
 }  // namespace tfrt
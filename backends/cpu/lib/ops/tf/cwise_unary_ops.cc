@@ -35,47 +35,68 @@
 #include "tfrt/support/forward_decls.h"
 #include "tfrt/tensor/dense_host_tensor.h"
 #include "tfrt/tensor/dense_host_tensor_view.h"
+#include "tfrt/tensor/scalar_host_tensor.h"
 #include "tfrt/tensor/tensor_serialize_utils.h"
+#include "type_dispatch.h"
 
 namespace tfrt {
 namespace {
 
 template <typename UnaryFunctor>
-static AsyncValueRef<DenseHostTensor> TfUnaryOp(
-    Argument<DenseHostTensor> input, const TensorMetadata& output_md,
-    const ExecutionContext& exec_ctx) {
-  // Forward input tensor or allocate new output tensor.
-  AsyncValueRef<DenseHostTensor> output =
-      ForwardInputOrAllocateOutput(exec_ctx, output_md, input);
-  if (output.IsError()) return output;
-
-  auto on_done = [output = output.CopyRef()](Error err) {
-    // Forward errors to the tensor output.
-    err ? output.SetError(absl::InternalError(toString(std::move(err))))
-        : output.SetStateConcrete();
+static AsyncValueRef<HostTensor> TfUnaryOp(Argument<HostTensor> input,
+                                           const TensorMetadata& output_md,
+                                           const ExecutionContext& exec_ctx) {
+  auto unsupported = [&](DType dtype) -> AsyncValueRef<HostTensor> {
+    return EmitErrorAsync(exec_ctx, "unsupported dtype");
   };
 
-  switch (input->dtype()) {
-    default:
-      return EmitErrorAsync(exec_ctx, "unsupported dtype");
-      break;
-#define DTYPE_FLOAT(ENUM)                                      \
-  case DType::ENUM: {                                          \
-    using F = typename UnaryFunctor::template Functor<         \
-        EigenTypeForDTypeKind<DType::ENUM>>;                   \
-    tfrt::cpu::UnaryKernel<F>(*input, &output.get(), exec_ctx, \
-                              std::move(on_done));             \
-  } break;
-#include "tfrt/dtype/dtype.def"  // NOLINT
+  internal::FloatTypeDispatch type_dispatch(input->dtype());
+
+  // ------------------------------------------------------------------------ //
+  // Handle scalar case, output is a scalar tensor of the same value.
+  // ------------------------------------------------------------------------ //
+  if (auto* scalar = dyn_cast<AnyScalarHostTensor>(&*input)) {
+    auto dispatch = [&](auto type_tag) -> AsyncValueRef<HostTensor> {
+      using T = decltype(type_tag);
+      using F = typename UnaryFunctor::template Functor<T>;
+      using R = typename F::Output;
+      typename F::Functor functor;
+      return MakeAvailableAsyncValueRef<ScalarHostTensor<R>>(
+          output_md, functor(cast<ScalarHostTensor<T>>(scalar)->GetValue()));
+    };
+
+    return type_dispatch(dispatch, unsupported);
   }
 
-  return output;
+  // ------------------------------------------------------------------------ //
+  // Handle dense host tensor case, output is a dense host tensor.
+  // ------------------------------------------------------------------------ //
+  auto dispatch = [&](auto type_tag) -> AsyncValueRef<HostTensor> {
+    // Forward input tensor or allocate new output tensor.
+    AsyncValueRef<DenseHostTensor> output =
+        ForwardInputOrAllocateOutput(exec_ctx, output_md, input);
+    if (output.IsError()) return output;
+
+    auto on_done = [output = output.CopyRef()](Error err) {
+      // Forward errors to the tensor output.
+      err ? output.SetError(absl::InternalError(toString(std::move(err))))
+          : output.SetStateConcrete();
+    };
+
+    using T = decltype(type_tag);
+    using F = typename UnaryFunctor::template Functor<T>;
+    tfrt::cpu::UnaryKernel<F>(cast<DenseHostTensor>(*input), &output.get(),
+                              exec_ctx, std::move(on_done));
+    return output;
+  };
+
+  return type_dispatch(dispatch, unsupported);
 }
 
 template <typename Functor>
 void RegisterTfUnaryOp(CpuOpRegistry* op_registry, string_view op_name) {
   op_registry->AddOp(op_name, TFRT_CPU_OP(TfUnaryOp<Functor>),
-                     CpuOpFlags::NoSideEffects);
+                     CpuOpFlags::NoSideEffects | CpuOpFlags::AllowsScalar);
 }
 
 }  // namespace
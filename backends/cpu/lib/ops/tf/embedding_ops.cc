@@ -0,0 +1,349 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Tensorflow embedding lookup operations.
+
+#include "embedding_ops.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <tuple>
+#include <utility>
+
+#include "llvm/ADT/SmallVector.h"
+#include "tfrt/core_runtime/op_args.h"
+#include "tfrt/core_runtime/op_attrs.h"
+#include "tfrt/core_runtime/op_utils.h"
+#include "tfrt/cpu/core_runtime/cpu_op_registry.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/parallel_for.h"
+#include "tfrt/tensor/csr_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "type_dispatch.h"
+
+namespace tfrt {
+namespace {
+
+enum class Combiner { kSum, kMean, kSqrtN };
+
+// The number of ids ahead of the current one whose rows are prefetched.
+constexpr int64_t kPrefetchDistance = 4;
+// The minimum number of row elements gathered by a parallel block.
+constexpr int64_t kMinBlockCost = 16 * 1024;
+
+inline void PrefetchRow(const char* row, Index size) {
+#if defined(__GNUC__)
+  for (const char* p = row; p < row + size; p += 64) __builtin_prefetch(p);
+#endif
+}
+
+// An f32 or f64 table, whose rows are added to the output rows as is.
+template <typename T>
+struct DenseTable {
+  const T* params;
+  Index dim;
+
+  const void* row(Index id) const { return params + id * dim; }
+  Index row_bytes() const { return dim * sizeof(T); }
+
+  void AddRow(Index id, T* __restrict out_row) const {
+    const T* __restrict param_row = params + id * dim;
+    for (Index j = 0; j != dim; ++j) out_row[j] += param_row[j];
+  }
+};
+
+// An int8 table with a float scale per row, whose rows are dequantized while
+// they are added to the output rows. The loop is vectorized like the one of
+// DenseTable, with the int8 elements widened to float.
+struct Int8Table {
+  const int8_t* params;
+  const float* scales;
+  Index dim;
+
+  const void* row(Index id) const { return params + id * dim; }
+  Index row_bytes() const { return dim; }
+
+  void AddRow(Index id, float* __restrict out_row) const {
+    const int8_t* __restrict param_row = params + id * dim;
+    const float scale = scales[id];
+    for (Index j = 0; j != dim; ++j)
+      out_row[j] += scale * static_cast<float>(param_row[j]);
+  }
+};
+
+// An int4 table with a float scale per row. Every byte packs two elements,
+// the even one in the low nibble, which are sign extended with shifts so that
+// the loop vectorizes.
+struct Int4Table {
+  const int8_t* params;
+  const float* scales;
+  Index dim;
+
+  const void* row(Index id) const { return params + id * (dim / 2); }
+  Index row_bytes() const { return dim / 2; }
+
+  void AddRow(Index id, float* __restrict out_row) const {
+    const int8_t* __restrict param_row = params + id * (dim / 2);
+    const float scale = scales[id];
+    for (Index j = 0; j != dim / 2; ++j) {
+      const int8_t packed = param_row[j];
+      const int8_t low = static_cast<int8_t>(packed << 4) >> 4;
+      const int8_t high = packed >> 4;
+      out_row[2 * j] += scale * static_cast<float>(low);
+      out_row[2 * j + 1] += scale * static_cast<float>(high);
+    }
+  }
+};
+
+// Computes rows [begin, end) of the output. The ids of an output row are
+// consecutive in `sp_ids`, so each output row is accumulated in place while
+// the table rows of the next ids are prefetched.
+template <typename T, typename Id, typename Table>
+void EmbeddingLookupRows(const CsrHostTensor& sp_ids, const Table& table,
+                         Index dim, Combiner combiner, T* output, size_t begin,
+                         size_t end) {
+  const int64_t* row_ptrs = sp_ids.RowPtrs();
+  const Id* ids = static_cast<const Id*>(sp_ids.Values()->data());
+  const int64_t nnz = sp_ids.NumNonZeros();
+  for (size_t r = begin; r != end; ++r) {
+    T* __restrict out_row = output + r * dim;
+    std::fill(out_row, out_row + dim, T(0));
+    const int64_t row_begin = row_ptrs[r];
+    const int64_t row_end = row_ptrs[r + 1];
+    for (int64_t k = row_begin; k != row_end; ++k) {
+      if (k + kPrefetchDistance < nnz)
+        PrefetchRow(static_cast<const char*>(
+                        table.row(ids[k + kPrefetchDistance])),
+                    table.row_bytes());
+      table.AddRow(ids[k], out_row);
+    }
+
+    const int64_t count = row_end - row_begin;
+    if (count == 0 || combiner == Combiner::kSum) continue;
+    const T scale = combiner == Combiner::kMean
+                        ? T(1) / static_cast<T>(count)
+                        : T(1) / std::sqrt(static_cast<T>(count));
+    for (Index j = 0; j != dim; ++j) out_row[j] *= scale;
+  }
+}
+
+// Runs EmbeddingLookupRows for the rows of the output in parallel, with
+// adaptive blocks since the rows differ in their number of ids.
+template <typename T, typename Table>
+AsyncValueRef<DenseHostTensor> EmbeddingLookup(
+    const CsrHostTensor& sp_ids, Table table,
+    llvm::SmallVector<DenseHostTensor, 2> inputs, Combiner combiner,
+    AsyncValueRef<DenseHostTensor> output, const ExecutionContext& exec_ctx) {
+  const Index num_rows = sp_ids.NumRows();
+  const Index dim = table.dim;
+  auto compute = [sp_ids = sp_ids.CopyRef(), table, inputs = std::move(inputs),
+                  dim, combiner, out = &output.get()](size_t begin,
+                                                      size_t end) {
+    auto* output_data = static_cast<T*>(out->data());
+    if (sp_ids.dtype() == DType::I32) {
+      EmbeddingLookupRows<T, int32_t>(sp_ids, table, dim, combiner,
+                                      output_data, begin, end);
+    } else {
+      EmbeddingLookupRows<T, int64_t>(sp_ids, table, dim, combiner,
+                                      output_data, begin, end);
+    }
+  };
+  const int64_t row_cost = std::max<int64_t>(
+      1, sp_ids.NumNonZeros() * dim / std::max<Index>(1, num_rows));
+  const size_t min_block_size = std::max<int64_t>(1, kMinBlockCost / row_cost);
+  ParallelFor(exec_ctx).Execute(
+      num_rows, ParallelFor::BlockSizes::Adaptive(min_block_size),
+      std::move(compute),
+      [output = output.CopyRef()]() mutable { output.SetStateConcrete(); });
+  return output;
+}
+
+template <typename Id>
+bool IdsInRange(const CsrHostTensor& sp_ids, Index vocab_size) {
+  const Id* ids = static_cast<const Id*>(sp_ids.Values()->data());
+  return std::all_of(ids, ids + sp_ids.NumNonZeros(), [&](Id id) {
+    return id >= 0 && static_cast<Index>(id) < vocab_size;
+  });
+}
+
+//===----------------------------------------------------------------------===//
+// tf.SparseEmbeddingLookup op
+//===----------------------------------------------------------------------===//
+
+// Gathers the rows of `params` for the ids of each row of `sp_ids`, and
+// combines them with the `combiner` attribute, one of "sum", "mean" or
+// "sqrtn". Rows without ids are zero. `params` is an ordinary dense tensor, so
+// it may point into a memory mapped BTF file.
+//
+// A quantized `params` is an int8 (or qint8) table that comes with the float
+// `scales` of its rows, see tf._QuantizeEmbeddingTable. With the "int4"
+// attribute every int8 element packs two int4 elements of a row. The output
+// is float.
+static AsyncValueRef<DenseHostTensor> TfSparseEmbeddingLookupOp(
+    const CsrHostTensor& sp_ids, const DenseHostTensor& params,
+    OptionalOpArg<DenseHostTensor> scales, const OpAttrsRef& attrs,
+    const TensorMetadata& output_md, const ExecutionContext& exec_ctx) {
+  string_view combiner_name = attrs.GetStringAsserting("combiner");
+  Combiner combiner;
+  if (combiner_name == "sum") {
+    combiner = Combiner::kSum;
+  } else if (combiner_name == "mean") {
+    combiner = Combiner::kMean;
+  } else if (combiner_name == "sqrtn") {
+    combiner = Combiner::kSqrtN;
+  } else {
+    return EmitErrorAsync(exec_ctx,
+                          StrCat("unsupported combiner: ", combiner_name));
+  }
+
+  const Index vocab_size = params.shape().GetDimensionSize(0);
+  const bool in_range = sp_ids.dtype() == DType::I32
+                            ? IdsInRange<int32_t>(sp_ids, vocab_size)
+                            : IdsInRange<int64_t>(sp_ids, vocab_size);
+  if (!in_range) {
+    return EmitErrorAsync(
+        exec_ctx, StrCat("ids are out of range for params of shape ",
+                         params.shape()));
+  }
+
+  auto output =
+      DenseHostTensor::MakeConstructedAsyncValueRef(output_md, exec_ctx.host());
+  if (!output) {
+    return EmitErrorAsync(exec_ctx, "out of memory allocating result");
+  }
+
+  const Index dim = output_md.shape.GetDimensionSize(1);
+  llvm::SmallVector<DenseHostTensor, 2> inputs;
+  inputs.push_back(params.CopyRef());
+
+  if (params.dtype() == DType::I8 || params.dtype() == DType::QI8) {
+    if (!scales || scales->dtype() != DType::F32 ||
+        scales->shape() != TensorShape({vocab_size})) {
+      return EmitErrorAsync(exec_ctx,
+                            StrCat("quantized params of shape ",
+                                   params.shape(),
+                                   " require f32 scales of shape [",
+                                   vocab_size, "]"));
+    }
+    inputs.push_back(scales->CopyRef());
+    auto* params_data = static_cast<const int8_t*>(params.data());
+    auto* scales_data = static_cast<const float*>(scales->data());
+    if (attrs.GetOptional<bool>("int4").value_or(false)) {
+      return EmbeddingLookup<float>(
+          sp_ids, Int4Table{params_data, scales_data, dim}, std::move(inputs),
+          combiner, std::move(output), exec_ctx);
+    }
+    return EmbeddingLookup<float>(
+        sp_ids, Int8Table{params_data, scales_data, dim}, std::move(inputs),
+        combiner, std::move(output), exec_ctx);
+  }
+
+  auto unsupported = [&](DType dtype) -> AsyncValueRef<DenseHostTensor> {
+    return EmitErrorAsync(exec_ctx, StrCat("unsupported dtype: ", dtype));
+  };
+
+  auto dispatch = [&](auto type_tag) -> AsyncValueRef<DenseHostTensor> {
+    using T = decltype(type_tag);
+    return EmbeddingLookup<T>(
+        sp_ids, DenseTable<T>{static_cast<const T*>(params.data()), dim},
+        std::move(inputs), combiner, output.CopyRef(), exec_ctx);
+  };
+
+  internal::FullPrecisionFloatTypeDispatch type_dispatch(params.dtype());
+  return type_dispatch(dispatch, unsupported);
+}
+
+//===----------------------------------------------------------------------===//
+// tf._QuantizeEmbeddingTable op
+//===----------------------------------------------------------------------===//
+
+// Quantizes the rows of an f32 embedding table to qint8 elements with a float
+// scale per row, for tf.SparseEmbeddingLookup. The scale of a row maps its
+// largest magnitude to 127, or to 7 with the "int4" attribute, where every
+// qint8 element packs two int4 elements and the row length must be even.
+// Returns the quantized table and the scales, which can be stored in BTF
+// files like any other tensors.
+static Expected<std::tuple<DenseHostTensor, DenseHostTensor>>
+TfQuantizeEmbeddingTableOp(const DenseHostTensor& params,
+                           const OpAttrsRef& attrs,
+                           const ExecutionContext& exec_ctx) {
+  if (params.dtype() != DType::F32 || params.shape().GetRank() != 2)
+    return MakeStringError("params must be a rank 2 f32 tensor, got ",
+                           params.dtype(), " ", params.shape());
+  const bool int4 = attrs.GetOptional<bool>("int4").value_or(false);
+  const Index vocab_size = params.shape().GetDimensionSize(0);
+  const Index dim = params.shape().GetDimensionSize(1);
+  if (int4 && dim % 2 != 0)
+    return MakeStringError("int4 tables must have rows of even length, got ",
+                           dim);
+
+  const Index packed_dim = int4 ? dim / 2 : dim;
+  auto table = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(DType(DType::QI8), TensorShape({vocab_size, packed_dim})),
+      exec_ctx.host());
+  auto scales = DenseHostTensor::CreateUninitialized<float>(
+      TensorShape({vocab_size}), exec_ctx.host());
+  if (!table || !scales)
+    return MakeStringError("out of memory allocating result");
+
+  const float max_level = int4 ? 7.0f : 127.0f;
+  auto* params_data = static_cast<const float*>(params.data());
+  auto* table_data = static_cast<int8_t*>(table->data());
+  auto* scales_data = static_cast<float*>(scales->data());
+  for (Index i = 0; i < vocab_size; ++i) {
+    const float* row = params_data + i * dim;
+    float max_abs = 0.0f;
+    for (Index j = 0; j < dim; ++j)
+      max_abs = std::max(max_abs, std::abs(row[j]));
+    const float scale = max_abs / max_level;
+    const float inv_scale = scale > 0.0f ? 1.0f / scale : 0.0f;
+    scales_data[i] = scale;
+
+    auto quantize = [&](float value) {
+      return static_cast<int8_t>(std::clamp(std::nearbyint(value * inv_scale),
+                                            -max_level, max_level));
+    };
+    int8_t* table_row = table_data + i * packed_dim;
+    for (Index j = 0; j < packed_dim; ++j) {
+      if (int4) {
+        const int8_t low = quantize(row[2 * j]);
+        const int8_t high = quantize(row[2 * j + 1]);
+        table_row[j] = static_cast<int8_t>(static_cast<uint8_t>(high) << 4 |
+                                           (static_cast<uint8_t>(low) & 0xf));
+      } else {
+        table_row[j] = quantize(row[j]);
+      }
+    }
+  }
+  return std::make_tuple(std::move(*table), std::move(*scales));
+}
+
+}  // namespace
+
+void RegisterTfEmbeddingCpuOps(CpuOpRegistry* op_registry) {
+  op_registry->AddOp("tf.SparseEmbeddingLookup",
+                     TFRT_CPU_OP(TfSparseEmbeddingLookupOp),
+                     CpuOpFlags::NoSideEffects | CpuOpFlags::AllowsCsr,
+                     {"combiner", "int4"});
+  op_registry->AddOp("tf._QuantizeEmbeddingTable",
+                     TFRT_CPU_OP(TfQuantizeEmbeddingTableOp),
+                     CpuOpFlags::NoSideEffects, {"int4"});
+}
+
+}  // namespace tfrt
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Tensorflow fused element-wise operations.
+
+#include "fused_elementwise_ops.h"
+
+#include "../../kernels/fused_elementwise_kernel.h"
+#include "buffer_forwarding.h"
+#include "tfrt/core_runtime/op_attrs.h"
+#include "tfrt/core_runtime/op_utils.h"
+#include "tfrt/cpu/core_runtime/cpu_op_registry.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/kernel_utils.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "type_dispatch.h"
+
+namespace tfrt {
+namespace {
+
+// Computes fused_ops(input, fusion_inputs...) in a single pass over memory,
+// e.g. fused_ops = ["BiasAdd", "Relu"] computes Relu(BiasAdd(input, bias)).
+static AsyncValueRef<DenseHostTensor> TfFusedElementwiseOp(
+    Argument<DenseHostTensor> input,
+    RepeatedArguments<DenseHostTensor> fusion_inputs, const OpAttrsRef& attrs,
+    const TensorMetadata& output_md, const ExecutionContext& exec_ctx) {
+  // Forward input tensor or allocate new output tensor.
+  AsyncValueRef<DenseHostTensor> output =
+      ForwardInputOrAllocateOutput(exec_ctx, output_md, input);
+  if (output.IsError()) return output;
+
+  auto fused_ops_attr = attrs.GetAsserting<AggregateAttr>("fused_ops");
+
+  auto on_done = [output = output.CopyRef()](Error err) {
+    // Forward errors to the tensor output.
+    err ? output.SetError(absl::InternalError(toString(std::move(err))))
+        : output.SetStateConcrete();
+  };
+
+  auto unsupported = [&](DType dtype) {
+    on_done(MakeStringError("Unsupported input dtype: ", dtype));
+  };
+
+  auto dispatch = [&](auto type_tag) {
+    using T = decltype(type_tag);
+    cpu::FusedElementwise<T>(*input, fusion_inputs, fused_ops_attr,
+                             &output.get(), exec_ctx, std::move(on_done));
+  };
+
+  internal::FullPrecisionFloatTypeDispatch type_dispatch(input->dtype());
+  type_dispatch(dispatch, unsupported);
+
+  return output;
+}
+
+}  // namespace
+
+void RegisterTfFusedElementwiseCpuOps(CpuOpRegistry* op_registry) {
+  op_registry->AddOp("tf._FusedElementwise", TFRT_CPU_OP(TfFusedElementwiseOp),
+                     CpuOpFlags::NoSideEffects, {"fused_ops"});
+}
+
+}  // namespace tfrt
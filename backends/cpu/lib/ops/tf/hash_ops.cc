@@ -0,0 +1,96 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Tensorflow feature hashing operations.
+
+#include "hash_ops.h"
+
+#include <cstdint>
+
+#include "../../kernels/hash_kernels.h"
+#include "tfrt/core_runtime/op_attrs.h"
+#include "tfrt/core_runtime/op_utils.h"
+#include "tfrt/cpu/core_runtime/cpu_op_registry.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/kernel_utils.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/host_tensor.h"
+
+namespace tfrt {
+namespace {
+
+// Hashes the elements of `input` to `num_buckets` buckets, or to fingerprints
+// if `num_buckets` is zero.
+static AsyncValueRef<DenseHostTensor> HashOp(Argument<HostTensor> input,
+                                             int64_t num_buckets,
+                                             const TensorMetadata& output_md,
+                                             const ExecutionContext& exec_ctx) {
+  auto output =
+      DenseHostTensor::CreateUninitialized(output_md, exec_ctx.host());
+  if (!output) {
+    return EmitErrorAsync(exec_ctx, "out of memory allocating result");
+  }
+
+  AsyncValueRef<Chain> chain =
+      cpu::Hash(input.ValueRef(), num_buckets, &*output, exec_ctx);
+  return ForwardValue(output.value(), std::move(chain));
+}
+
+//===----------------------------------------------------------------------===//
+// tf.StringToHashBucketFast op
+//===----------------------------------------------------------------------===//
+
+// Hashes every string to a bucket in [0, num_buckets). Like in Tensorflow the
+// buckets are the string fingerprints modulo `num_buckets`, but the
+// fingerprints are computed with Hash64, so the buckets differ from the ones
+// computed by Tensorflow.
+static AsyncValueRef<DenseHostTensor> TfStringToHashBucketFastOp(
+    Argument<HostTensor> input, const OpAttrsRef& attrs,
+    const TensorMetadata& output_md, const ExecutionContext& exec_ctx) {
+  const int64_t num_buckets = attrs.GetAsserting<int64_t>("num_buckets");
+  if (num_buckets <= 0) {
+    return EmitErrorAsync(exec_ctx, "num_buckets must be positive");
+  }
+  return HashOp(input, num_buckets, output_md, exec_ctx);
+}
+
+//===----------------------------------------------------------------------===//
+// tf.Fingerprint64 op
+//===----------------------------------------------------------------------===//
+
+// Returns the int64 fingerprints of the elements of a string, int32 or int64
+// tensor. int32 and int64 elements with the same value have the same
+// fingerprint.
+static AsyncValueRef<DenseHostTensor> TfFingerprint64Op(
+    Argument<HostTensor> input, const TensorMetadata& output_md,
+    const ExecutionContext& exec_ctx) {
+  return HashOp(input, /*num_buckets=*/0, output_md, exec_ctx);
+}
+
+}  // namespace
+
+void RegisterTfHashCpuOps(CpuOpRegistry* op_registry) {
+  op_registry->AddOp("tf.StringToHashBucketFast",
+                     TFRT_CPU_OP(TfStringToHashBucketFastOp),
+                     CpuOpFlags::NoSideEffects | CpuOpFlags::AllowsString,
+                     {"num_buckets"});
+  op_registry->AddOp("tf.Fingerprint64", TFRT_CPU_OP(TfFingerprint64Op),
+                     CpuOpFlags::NoSideEffects | CpuOpFlags::AllowsString);
+}
+
+}  // namespace tfrt
@@ -0,0 +1,225 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Tensorflow key/value cache operations for incremental decoding.
+
+#include "kv_cache_ops.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <tuple>
+
+#include "../../kernels/attention_kernel.h"
+#include "../../kernels/kv_cache.h"
+#include "llvm/ADT/SmallVector.h"
+#include "tfrt/common/compat/eigen/eigen_dtype.h"
+#include "tfrt/common/compat/eigen/eigen_evaluator.h"
+#include "tfrt/core_runtime/op_attrs.h"
+#include "tfrt/core_runtime/op_utils.h"
+#include "tfrt/cpu/core_runtime/cpu_op_registry.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/kernel_utils.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+#include "type_dispatch.h"
+
+namespace tfrt {
+namespace {
+
+// Returns the sequence ids of a rank 1 int32 or int64 tensor.
+static Expected<llvm::SmallVector<int64_t, 4>> GetSequences(
+    const DenseHostTensor& sequences) {
+  if (sequences.shape().GetRank() != 1)
+    return MakeStringError("sequences must be a vector");
+
+  llvm::SmallVector<int64_t, 4> ids;
+  if (sequences.dtype() == DType::I32) {
+    DHTArrayView<int32_t> view(&sequences);
+    ids.append(view.begin(), view.end());
+  } else if (sequences.dtype() == DType::I64) {
+    DHTArrayView<int64_t> view(&sequences);
+    ids.append(view.begin(), view.end());
+  } else {
+    return MakeStringError("Unsupported sequences data type");
+  }
+  return ids;
+}
+
+// Returns the cache named by the "cache" attribute.
+static Expected<cpu::KVCache*> GetCache(const OpAttrsRef& attrs,
+                                        const ExecutionContext& exec_ctx) {
+  ResourceContext* resource_context = exec_ctx.resource_context();
+  if (resource_context == nullptr)
+    return MakeStringError("KV cache ops require resource context");
+  return cpu::GetKVCache(resource_context,
+                         attrs.GetStringAsserting("cache").str());
+}
+
+//===----------------------------------------------------------------------===//
+// tf._KVCacheAppend op
+//===----------------------------------------------------------------------===//
+
+// Appends the keys [batch, heads, tokens, depth] and the values [batch,
+// heads, tokens, value_depth] of new tokens to the cached sequences, and
+// returns the int64 lengths of the sequences. The cache is created by the
+// first append, with "num_blocks" blocks of KVCache::kBlockTokens tokens.
+static Expected<DenseHostTensor> TfKVCacheAppendOp(
+    const DenseHostTensor& sequences, const DenseHostTensor& key,
+    const DenseHostTensor& value, const OpAttrsRef& attrs,
+    const ExecutionContext& exec_ctx) {
+  auto ids = GetSequences(sequences);
+  if (!ids) return ids.takeError();
+
+  ResourceContext* resource_context = exec_ctx.resource_context();
+  if (resource_context == nullptr)
+    return MakeStringError("KV cache ops require resource context");
+  if (key.shape().GetRank() != 4 || value.shape().GetRank() != 4)
+    return MakeStringError("keys and values must be rank 4 tensors");
+
+  cpu::KVCache::Config config;
+  config.dtype = key.dtype();
+  config.heads = key.shape().GetDimensionSize(1);
+  config.depth = key.shape().GetDimensionSize(3);
+  config.value_depth = value.shape().GetDimensionSize(3);
+  config.num_blocks = attrs.GetOptional<int64_t>("num_blocks")
+                          .value_or(cpu::KVCache::kDefaultNumBlocks);
+  auto cache = cpu::GetOrCreateKVCache(
+      resource_context, attrs.GetStringAsserting("cache").str(), config,
+      exec_ctx.host()->allocator());
+  if (!cache) return cache.takeError();
+
+  auto lengths = (*cache)->Append(*ids, key, value);
+  if (!lengths) return lengths.takeError();
+
+  auto output = DenseHostTensor::CreateUninitialized<int64_t>(
+      TensorShape({static_cast<Index>(ids->size())}), exec_ctx.host());
+  if (!output) return MakeStringError("out of memory allocating result");
+  MutableDHTArrayView<int64_t> view(&*output);
+  std::copy(lengths->begin(), lengths->end(), view.begin());
+  return std::move(*output);
+}
+
+//===----------------------------------------------------------------------===//
+// tf._KVCacheAttention op
+//===----------------------------------------------------------------------===//
+
+// Computes the attention of `query` [batch, heads, query_len, depth] over the
+// cached keys and values of the sequences, which are read in place. The
+// scale defaults to 1 / sqrt(depth).
+static AsyncValueRef<DenseHostTensor> TfKVCacheAttentionOp(
+    const DenseHostTensor& sequences, const DenseHostTensor& query,
+    const OpAttrsRef& attrs, const ExecutionContext& exec_ctx) {
+  auto ids = GetSequences(sequences);
+  if (!ids) return EmitErrorAsync(exec_ctx, ids.takeError());
+  auto cache = GetCache(attrs, exec_ctx);
+  if (!cache) return EmitErrorAsync(exec_ctx, cache.takeError());
+  const cpu::KVCache::Config& config = (*cache)->config();
+
+  const Index query_len =
+      query.shape().GetRank() == 4 ? query.shape().GetDimensionSize(2) : 0;
+  TensorMetadata output_md(
+      config.dtype, TensorShape({static_cast<Index>(ids->size()),
+                                 config.heads, query_len, config.value_depth}));
+  auto output =
+      DenseHostTensor::CreateUninitialized(output_md, exec_ctx.host());
+  if (!output) {
+    return EmitErrorAsync(exec_ctx, "out of memory allocating result");
+  }
+
+  float scale = attrs.GetOptional<float>("scale").value_or(
+      1.0f / std::sqrt(static_cast<float>(config.depth)));
+  bool causal = attrs.GetOptional<bool>("causal").value_or(false);
+
+  auto unsupported = [&](DType dtype) -> AsyncValueRef<Chain> {
+    return EmitErrorAsync(exec_ctx, StrCat("Unsupported input dtype: ", dtype));
+  };
+
+  auto dispatch = [&](auto type_tag) -> AsyncValueRef<Chain> {
+    using T = decltype(type_tag);
+    return cpu::KVCacheAttention<T, compat::AsyncEigenEvaluator>(
+        query, **cache, *ids, &*output, scale, causal, exec_ctx);
+  };
+
+  // 16-bit floating point inputs are computed in float.
+  internal::FloatTypeDispatch type_dispatch(config.dtype);
+  return ForwardValue(output.value(), type_dispatch(dispatch, unsupported));
+}
+
+//===----------------------------------------------------------------------===//
+// tf._KVCacheGather op
+//===----------------------------------------------------------------------===//
+
+// Returns copies of the cached keys [batch, heads, length, depth] and values
+// [batch, heads, length, value_depth] of sequences of the same length.
+static Expected<std::tuple<DenseHostTensor, DenseHostTensor>>
+TfKVCacheGatherOp(const DenseHostTensor& sequences, const OpAttrsRef& attrs,
+                  const ExecutionContext& exec_ctx) {
+  auto ids = GetSequences(sequences);
+  if (!ids) return ids.takeError();
+  auto cache = GetCache(attrs, exec_ctx);
+  if (!cache) return cache.takeError();
+  const cpu::KVCache::Config& config = (*cache)->config();
+
+  const Index batch = ids->size();
+  const Index length = ids->empty() ? 0 : (*cache)->Read(ids->front()).length;
+  auto key = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(config.dtype,
+                     TensorShape({batch, config.heads, length, config.depth})),
+      exec_ctx.host());
+  auto value = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(config.dtype, TensorShape({batch, config.heads, length,
+                                                config.value_depth})),
+      exec_ctx.host());
+  if (!key || !value) return MakeStringError("out of memory allocating result");
+
+  if (auto err = (*cache)->Gather(*ids, &*key, &*value)) return std::move(err);
+  return std::make_tuple(std::move(*key), std::move(*value));
+}
+
+//===----------------------------------------------------------------------===//
+// tf._KVCacheFree op
+//===----------------------------------------------------------------------===//
+
+// Returns the blocks of the sequences to the pool of the cache. The blocks are
+// reused once the reads of the sequences that are in flight complete.
+static AsyncValueRef<Chain> TfKVCacheFreeOp(const DenseHostTensor& sequences,
+                                            const OpAttrsRef& attrs,
+                                            const ExecutionContext& exec_ctx) {
+  auto ids = GetSequences(sequences);
+  if (!ids) return EmitErrorAsync(exec_ctx, ids.takeError());
+  auto cache = GetCache(attrs, exec_ctx);
+  if (!cache) return EmitErrorAsync(exec_ctx, cache.takeError());
+  for (int64_t id : *ids) (*cache)->Free(id);
+  return GetReadyChain();
+}
+
+}  // namespace
+
+void RegisterTfKVCacheCpuOps(CpuOpRegistry* op_registry) {
+  op_registry->AddOp("tf._KVCacheAppend", TFRT_CPU_OP(TfKVCacheAppendOp),
+                     CpuOpFlags::None, {"cache", "num_blocks"});
+  op_registry->AddOp("tf._KVCacheAttention", TFRT_CPU_OP(TfKVCacheAttentionOp),
+                     CpuOpFlags::None, {"cache", "scale", "causal"});
+  op_registry->AddOp("tf._KVCacheGather", TFRT_CPU_OP(TfKVCacheGatherOp),
+                     CpuOpFlags::None, {"cache"});
+  op_registry->AddOp("tf._KVCacheFree", TFRT_CPU_OP(TfKVCacheFreeOp),
+                     CpuOpFlags::None, {"cache"});
+}
+
+}  // namespace tfrt
@@ -22,7 +22,9 @@
 #include <complex>
 #include <initializer_list>
 
+#include "../../kernels/batch_matmul_kernel.h"
 #include "../../kernels/matmul_kernel.h"
+#include "../../kernels/packed_matmul_kernel.h"
 #include "tfrt/common/compat/eigen/eigen_evaluator.h"
 #include "tfrt/core_runtime/op_attrs.h"
 #include "tfrt/core_runtime/op_utils.h"
@@ -60,12 +62,51 @@ static AsyncValueRef<DenseHostTensor> TfMatMulOp(
 
   auto dispatch = [&](auto type_tag) -> AsyncValueRef<Chain> {
     using T = decltype(type_tag);
+    if (auto packed = cpu::GetPackedMatMulWeights<T>(exec_ctx, a, b,
+                                                     transpose_a, transpose_b))
+      return cpu::PackedMatMul<T>(a, std::move(packed), &*output, transpose_a,
+                                  cpu::NoOpPackedEpilogue(), evaluator);
     return cpu::MatMul<T>(1.0, a, b, 0.0, &*output, transpose_a, transpose_b,
                           Eigen::NoOpOutputKernel(), evaluator);
   };
 
-  internal::TypeDispatch<float, double, int32_t, int64_t, uint32_t, uint64_t,
-                         std::complex<float>, std::complex<double>>
+  // 16-bit floating point matrices are multiplied with float accumulation.
+  internal::TypeDispatch<float, double, Eigen::half, Eigen::bfloat16, int32_t,
+                         int64_t, uint32_t, uint64_t, std::complex<float>,
+                         std::complex<double>>
+      type_dispatch(a.dtype());
+  return ForwardValue(output.value(), type_dispatch(dispatch, unsupported));
+}
+
+static AsyncValueRef<DenseHostTensor> TfBatchMatMulV2Op(
+    const DenseHostTensor& a, const DenseHostTensor& b, const OpAttrsRef& attrs,
+    const TensorMetadata& output_md, const ExecutionContext& exec_ctx) {
+  HostContext* host = exec_ctx.host();
+
+  auto output = DenseHostTensor::CreateUninitialized(output_md, host);
+  if (!output) {
+    return EmitErrorAsync(exec_ctx, "out of memory allocating result");
+  }
+
+  bool adj_x = attrs.GetOptional<bool>("adj_x").value_or(false);
+  bool adj_y = attrs.GetOptional<bool>("adj_y").value_or(false);
+
+  AsyncEigenEvaluator evaluator(exec_ctx.host());
+
+  // Dispatch based on the input data type.
+  auto unsupported = [&](DType dtype) -> AsyncValueRef<Chain> {
+    return EmitErrorAsync(exec_ctx, StrCat("Unsupported input dtype: ", dtype));
+  };
+
+  auto dispatch = [&](auto type_tag) -> AsyncValueRef<Chain> {
+    using T = decltype(type_tag);
+    return cpu::BatchMatMul<T>(a, b, &*output, adj_x, adj_y, exec_ctx,
+                               evaluator);
+  };
+
+  // Complex matrices are not supported, because adjoints conjugate them.
+  internal::TypeDispatch<float, double, Eigen::half, Eigen::bfloat16, int32_t,
+                         int64_t>
       type_dispatch(a.dtype());
   return ForwardValue(output.value(), type_dispatch(dispatch, unsupported));
 }
@@ -75,6 +116,8 @@ static AsyncValueRef<DenseHostTensor> TfMatMulOp(
 void RegisterTfMatmulCpuOps(CpuOpRegistry* op_registry) {
   op_registry->AddOp("tf.MatMul", TFRT_CPU_OP(TfMatMulOp),
                      CpuOpFlags::NoSideEffects, {"transpose_a", "transpose_b"});
+  op_registry->AddOp("tf.BatchMatMulV2", TFRT_CPU_OP(TfBatchMatMulV2Op),
+                     CpuOpFlags::NoSideEffects, {"adj_x", "adj_y"});
 }
 
 }  // namespace tfrt
@@ -0,0 +1,167 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Tensorflow quantized MatMul operations.
+
+#include "quantized_matmul_ops.h"
+
+#include <cstdint>
+#include <limits>
+
+#include "../../kernels/quantized_matmul_kernel.h"
+#include "llvm/ADT/SmallVector.h"
+#include "tfrt/common/compat/eigen/eigen_evaluator.h"
+#include "tfrt/core_runtime/op_attrs.h"
+#include "tfrt/core_runtime/op_utils.h"
+#include "tfrt/cpu/core_runtime/cpu_op_registry.h"
+#include "tfrt/host_context/attribute_utils.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+namespace {
+
+using compat::AsyncEigenEvaluator;
+
+// Validates the zero points of the quint8 lhs and the qint8 rhs.
+static Error CheckZeroPoints(int32_t a_zero_point, int32_t b_zero_point) {
+  if (a_zero_point < std::numeric_limits<uint8_t>::min() ||
+      a_zero_point > std::numeric_limits<uint8_t>::max())
+    return MakeStringError("a_zero_point ", a_zero_point,
+                           " is out of the quint8 range");
+  if (b_zero_point < std::numeric_limits<int8_t>::min() ||
+      b_zero_point > std::numeric_limits<int8_t>::max())
+    return MakeStringError("b_zero_point ", b_zero_point,
+                           " is out of the qint8 range");
+  return Error::success();
+}
+
+// Computes the qint32 accumulators of a quint8 x qint8 matrix multiplication.
+//
+// The real value of the output is a_scale * b_scale * output.
+static AsyncValueRef<DenseHostTensor> TfQuantizedMatMulOp(
+    const DenseHostTensor& a, const DenseHostTensor& b, const OpAttrsRef& attrs,
+    const TensorMetadata& output_md, const ExecutionContext& exec_ctx) {
+  HostContext* host = exec_ctx.host();
+
+  bool transpose_a = attrs.GetAsserting<bool>("transpose_a");
+  bool transpose_b = attrs.GetAsserting<bool>("transpose_b");
+  int32_t a_zero_point = attrs.GetAsserting<int32_t>("a_zero_point");
+  int32_t b_zero_point = attrs.GetAsserting<int32_t>("b_zero_point");
+  if (auto err = CheckZeroPoints(a_zero_point, b_zero_point))
+    return EmitErrorAsync(exec_ctx, std::move(err));
+
+  auto output = DenseHostTensor::CreateUninitialized(output_md, host);
+  if (!output) {
+    return EmitErrorAsync(exec_ctx, "out of memory allocating result");
+  }
+
+  auto chain = cpu::QuantizedMatMul(
+      a, b, &*output, transpose_a, transpose_b, a_zero_point, b_zero_point,
+      cpu::QuantizedMatMulOutput(&*output), AsyncEigenEvaluator(host));
+  return ForwardValue(output.value(), std::move(chain));
+}
+
+// Computes a quint8 x qint8 matrix multiplication, adds a float bias, applies
+// an optional activation function and requantizes the result to quint8.
+//
+// fused_ops = ["BiasAdd"], ["BiasAdd", "Relu"] or ["BiasAdd", "Relu6"].
+static AsyncValueRef<DenseHostTensor> TfFusedQuantizedMatMulOp(
+    const DenseHostTensor& a, const DenseHostTensor& b,
+    RepeatedArguments<DenseHostTensor> fusion_inputs, const OpAttrsRef& attrs,
+    const TensorMetadata& output_md, const ExecutionContext& exec_ctx) {
+  HostContext* host = exec_ctx.host();
+
+  bool transpose_a = attrs.GetAsserting<bool>("transpose_a");
+  bool transpose_b = attrs.GetAsserting<bool>("transpose_b");
+  float a_scale = attrs.GetAsserting<float>("a_scale");
+  int32_t a_zero_point = attrs.GetAsserting<int32_t>("a_zero_point");
+  float b_scale = attrs.GetAsserting<float>("b_scale");
+  int32_t b_zero_point = attrs.GetAsserting<int32_t>("b_zero_point");
+  float output_scale = attrs.GetAsserting<float>("output_scale");
+  int32_t output_zero_point = attrs.GetAsserting<int32_t>("output_zero_point");
+  auto fused_ops_attr = attrs.GetAsserting<AggregateAttr>("fused_ops");
+
+  if (auto err = CheckZeroPoints(a_zero_point, b_zero_point))
+    return EmitErrorAsync(exec_ctx, std::move(err));
+  if (!(output_scale > 0.0f))
+    return EmitErrorAsync(exec_ctx, "output_scale must be positive");
+
+  // Parse the fusion config.
+  llvm::SmallVector<string_view, 2> fused_ops(fused_ops_attr.GetNumElements());
+  for (int i = 0; i < fused_ops_attr.GetNumElements(); ++i) {
+    fused_ops[i] = fused_ops_attr.GetAttribute(i).cast<StringAttr>().GetValue();
+  }
+
+  if (fused_ops.empty() || fused_ops[0] != "BiasAdd" || fused_ops.size() > 2)
+    return EmitErrorAsync(exec_ctx, "Unsupported fusion type");
+
+  // The activation is applied to the real value before requantization.
+  float lower = std::numeric_limits<float>::lowest();
+  float upper = std::numeric_limits<float>::max();
+  if (fused_ops.size() == 2) {
+    if (fused_ops[1] == "Relu") {
+      lower = 0.0f;
+    } else if (fused_ops[1] == "Relu6") {
+      lower = 0.0f;
+      upper = 6.0f;
+    } else {
+      return EmitErrorAsync(exec_ctx, "Unsupported fusion type");
+    }
+  }
+
+  if (fusion_inputs.size() != 1)
+    return EmitErrorAsync(exec_ctx, "BiasAdd requires exactly one bias input");
+
+  const DenseHostTensor& bias = fusion_inputs[0];
+  const Index inner_dim = output_md.shape.GetDimensionSize(1);
+  if (bias.dtype() != DType::F32 || bias.shape().GetRank() != 1)
+    return EmitErrorAsync(exec_ctx, "Bias tensor must be a float vector");
+  if (bias.NumElements() != inner_dim)
+    return EmitErrorAsync(
+        exec_ctx, StrCat("The number of bias elements ", bias.NumElements(),
+                         " doesn't match output inner dimension ", inner_dim));
+
+  auto output = DenseHostTensor::CreateUninitialized(output_md, host);
+  if (!output) {
+    return EmitErrorAsync(exec_ctx, "out of memory allocating result");
+  }
+
+  cpu::RequantizeBiasAddOutput requantize(
+      &*output, bias.data<float>(), a_scale * b_scale, output_scale,
+      output_zero_point, lower, upper);
+  auto chain = cpu::QuantizedMatMul(a, b, &*output, transpose_a, transpose_b,
+                                    a_zero_point, b_zero_point, requantize,
+                                    AsyncEigenEvaluator(host));
+  return ForwardValue(output.value(), std::move(chain));
+}
+
+}  // namespace
+
+void RegisterTfQuantizedMatmulCpuOps(CpuOpRegistry* op_registry) {
+  op_registry->AddOp(
+      "tf.QuantizedMatMul", TFRT_CPU_OP(TfQuantizedMatMulOp),
+      CpuOpFlags::NoSideEffects,
+      {"transpose_a", "transpose_b", "a_zero_point", "b_zero_point"});
+  op_registry->AddOp("tf._FusedQuantizedMatMul",
+                     TFRT_CPU_OP(TfFusedQuantizedMatMulOp),
+                     CpuOpFlags::NoSideEffects,
+                     {"transpose_a", "transpose_b", "a_scale", "a_zero_point",
+                      "b_scale", "b_zero_point", "output_scale",
+                      "output_zero_point", "fused_ops"});
+}
+
+}  // namespace tfrt
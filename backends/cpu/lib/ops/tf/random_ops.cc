@@ -0,0 +1,145 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Tensorflow random tensor operations.
+
+#include "random_ops.h"
+
+#include <cstdint>
+
+#include "../../kernels/random_kernels.h"
+#include "llvm/ADT/SmallVector.h"
+#include "tfrt/core_runtime/op_attr_type.h"
+#include "tfrt/core_runtime/op_attrs.h"
+#include "tfrt/core_runtime/op_utils.h"
+#include "tfrt/cpu/core_runtime/cpu_op_registry.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/kernel_utils.h"
+#include "tfrt/support/random_util.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+#include "type_dispatch.h"
+
+namespace tfrt {
+namespace {
+
+static Expected<llvm::SmallVector<Index, 4>> GetOutputDims(
+    const DenseHostTensor& shape) {
+  llvm::SmallVector<Index, 4> dims;
+
+  if (shape.shape().GetRank() != 1)
+    return MakeStringError("Shape must be a vector");
+
+  if (shape.dtype() == DType::I32) {
+    DHTArrayView<int32_t> view(&shape);
+    dims.append(view.begin(), view.end());
+  } else if (shape.dtype() == DType::I64) {
+    DHTArrayView<int64_t> view(&shape);
+    dims.append(view.begin(), view.end());
+  } else {
+    return MakeStringError("Unsupported shape data type");
+  }
+
+  for (Index dim : dims) {
+    if (dim < 0) return MakeStringError("Invalid output dimension ", dim);
+  }
+
+  return dims;
+}
+
+static DType GetOutputDType(const OpAttrsRef& attrs) {
+  switch (attrs.GetAsserting<OpAttrType>("dtype")) {
+    case OpAttrType::F32:
+      return DType(DType::F32);
+    case OpAttrType::F64:
+      return DType(DType::F64);
+    default:
+      return DType(DType::Invalid);
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// tf.RandomUniform, tf.RandomStandardNormal and tf.TruncatedNormal ops
+//===----------------------------------------------------------------------===//
+
+// Fills a tensor of the given `shape` with random values. Like in Tensorflow,
+// the `seed` and `seed2` attributes seed the Philox stream, and a random seed
+// is used if both of them are zero. The output is computed in parallel, and
+// it only depends on the seeds: unlike in Tensorflow, where the kernel
+// advances its generator on every call, the same non-zero seeds produce the
+// same output on every call.
+template <cpu::RandomDistribution distribution>
+static AsyncValueRef<DenseHostTensor> TfRandomOp(
+    const DenseHostTensor& shape, const OpAttrsRef& attrs,
+    const ExecutionContext& exec_ctx) {
+  auto dims = GetOutputDims(shape);
+  if (auto err = dims.takeError()) {
+    return EmitErrorAsync(exec_ctx,
+                          absl::InternalError(toString(std::move(err))));
+  }
+
+  const DType dtype = GetOutputDType(attrs);
+  if (dtype == DType::Invalid) {
+    return EmitErrorAsync(exec_ctx, "unsupported dtype for random op");
+  }
+
+  uint64_t seed = attrs.GetOptional<int64_t>("seed").value_or(0);
+  uint64_t seed2 = attrs.GetOptional<int64_t>("seed2").value_or(0);
+  if (seed == 0 && seed2 == 0) {
+    seed = random::New64();
+    seed2 = random::New64();
+  }
+
+  auto output = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(dtype, *dims), exec_ctx.host());
+  if (!output) {
+    return EmitErrorAsync(exec_ctx, "out of memory allocating result");
+  }
+
+  auto unsupported = [&](DType dtype) -> AsyncValueRef<Chain> {
+    return EmitErrorAsync(exec_ctx, StrCat("unsupported dtype: ", dtype));
+  };
+
+  auto dispatch = [&](auto type_tag) -> AsyncValueRef<Chain> {
+    using T = decltype(type_tag);
+    return cpu::Random<T>(distribution, seed, seed2, &*output, exec_ctx);
+  };
+
+  internal::FullPrecisionFloatTypeDispatch type_dispatch(dtype);
+  AsyncValueRef<Chain> chain = type_dispatch(dispatch, unsupported);
+  return ForwardValue(output.value(), std::move(chain));
+}
+
+}  // namespace
+
+void RegisterTfRandomCpuOps(CpuOpRegistry* op_registry) {
+  op_registry->AddOp(
+      "tf.RandomUniform",
+      TFRT_CPU_OP(TfRandomOp<cpu::RandomDistribution::kUniform>),
+      CpuOpFlags::NoSideEffects, {"dtype", "seed", "seed2"});
+  op_registry->AddOp(
+      "tf.RandomStandardNormal",
+      TFRT_CPU_OP(TfRandomOp<cpu::RandomDistribution::kNormal>),
+      CpuOpFlags::NoSideEffects, {"dtype", "seed", "seed2"});
+  op_registry->AddOp(
+      "tf.TruncatedNormal",
+      TFRT_CPU_OP(TfRandomOp<cpu::RandomDistribution::kTruncatedNormal>),
+      CpuOpFlags::NoSideEffects, {"dtype", "seed", "seed2"});
+}
+
+}  // namespace tfrt
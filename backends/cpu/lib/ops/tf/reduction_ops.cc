@@ -0,0 +1,301 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Tensorflow reduction operations.
+
+#include "reduction_ops.h"
+
+#include <cstdint>
+
+#include "../../kernels/reduction_kernel.h"
+#include "llvm/ADT/SmallVector.h"
+#include "tfrt/common/compat/eigen/eigen_dtype.h"
+#include "tfrt/core_runtime/op_attrs.h"
+#include "tfrt/core_runtime/op_utils.h"
+#include "tfrt/cpu/core_runtime/cpu_op_registry.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/kernel_utils.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+#include "tfrt/tensor/scalar_host_tensor.h"
+
+namespace tfrt {
+namespace {
+
+// Reads the int32 or int64 elements of a scalar or vector tensor of indices.
+// The tensor is either a DenseHostTensor or a ScalarHostTensor.
+static Expected<llvm::SmallVector<int64_t, 4>> ReadIndices(
+    const HostTensor& indices) {
+  llvm::SmallVector<int64_t, 4> result;
+  if (indices.shape().GetRank() > 1)
+    return MakeStringError("reduction indices must be a scalar or a vector");
+
+  if (auto* scalar = dyn_cast<ScalarHostTensor<int32_t>>(&indices)) {
+    result.assign(indices.NumElements(), scalar->GetValue());
+  } else if (auto* scalar = dyn_cast<ScalarHostTensor<int64_t>>(&indices)) {
+    result.assign(indices.NumElements(), scalar->GetValue());
+  } else if (!isa<DenseHostTensor>(indices)) {
+    return MakeStringError("unsupported reduction indices tensor type");
+  } else if (indices.dtype() == DType::I32) {
+    auto elements =
+        DHTArrayView<int32_t>(cast<DenseHostTensor>(&indices)).Elements();
+    result.assign(elements.begin(), elements.end());
+  } else if (indices.dtype() == DType::I64) {
+    auto elements =
+        DHTArrayView<int64_t>(cast<DenseHostTensor>(&indices)).Elements();
+    result.assign(elements.begin(), elements.end());
+  } else {
+    return MakeStringError("unsupported reduction indices dtype: ",
+                           indices.dtype());
+  }
+  return result;
+}
+
+struct ReductionHelper {
+  // Whether every input dimension is reduced.
+  llvm::SmallVector<bool, 4> reduced_dims;
+  TensorMetadata output_metadata;
+};
+
+static Expected<ReductionHelper> TfReductionOutputMd(
+    const HostTensor& input, const HostTensor& reduction_indices,
+    bool keep_dims) {
+  auto indices = ReadIndices(reduction_indices);
+  if (!indices) return indices.takeError();
+
+  const int rank = input.shape().GetRank();
+  ReductionHelper helper;
+  helper.reduced_dims.resize(rank, false);
+  for (int64_t index : *indices) {
+    if (index < -rank || index >= rank) {
+      return MakeStringError(
+          "reduction index must be in [-input_rank, input_rank) range");
+    }
+    // Add the rank to get the corresponding positive index if it is negative.
+    index = (index + rank) % rank;
+    // Like in Tensorflow, reducing the same dimension twice is the same as
+    // reducing it once.
+    helper.reduced_dims[index] = true;
+  }
+
+  llvm::SmallVector<Index, 4> output_dims;
+  output_dims.reserve(rank);
+  for (int i = 0; i < rank; ++i) {
+    if (!helper.reduced_dims[i]) {
+      output_dims.push_back(input.shape().GetDimensionSize(i));
+    } else if (keep_dims) {
+      output_dims.push_back(1);
+    }
+  }
+  helper.output_metadata = TensorMetadata(input.dtype(), output_dims);
+
+  return helper;
+}
+
+//===----------------------------------------------------------------------===//
+// tf.Sum, tf.Prod, tf.Max, tf.Min and tf.Mean ops
+//===----------------------------------------------------------------------===//
+
+// Reduces a ScalarHostTensor: every output element is the reduction of the
+// same number of copies of the scalar value, so the output is a scalar too.
+template <template <typename> class Reducer>
+static AsyncValueRef<HostTensor> TfScalarReduction(
+    const AnyScalarHostTensor& input, const ReductionHelper& helper,
+    const ExecutionContext& exec_ctx) {
+  Index count = 1;
+  for (int i = 0, e = input.shape().GetRank(); i < e; ++i) {
+    if (helper.reduced_dims[i]) count *= input.shape().GetDimensionSize(i);
+  }
+
+  switch (input.dtype()) {
+    default:
+      return EmitErrorAsync(
+          exec_ctx, StrCat("unsupported dtype for reduction: ", input.dtype()));
+#define DTYPE_NUMERIC(ENUM)                                                 \
+  case DType::ENUM: {                                                       \
+    using T = EigenTypeForDTypeKind<DType::ENUM>;                           \
+    return MakeAvailableAsyncValueRef<ScalarHostTensor<T>>(                 \
+        helper.output_metadata,                                             \
+        cpu::ReduceBroadcast<T, Reducer>(                                   \
+            cast<ScalarHostTensor<T>>(&input)->GetValue(), count));         \
+  }
+#include "tfrt/dtype/dtype.def"  // NOLINT
+  }
+}
+
+template <template <typename> class Reducer>
+static AsyncValueRef<HostTensor> TfReductionOp(
+    const HostTensor& input, const HostTensor& reduction_indices,
+    const OpAttrsRef& attrs, const ExecutionContext& exec_ctx) {
+  bool keep_dims = false;
+  if (auto attr = attrs.GetOptional<bool>("keep_dims"))
+    keep_dims = attr.value();
+
+  // Compute output tensor metadata from reduction indices.
+  auto helper = TfReductionOutputMd(input, reduction_indices, keep_dims);
+  if (auto err = helper.takeError())
+    return EmitErrorAsync(exec_ctx,
+                          absl::InternalError(toString(std::move(err))));
+
+  if (auto* scalar = dyn_cast<AnyScalarHostTensor>(&input))
+    return TfScalarReduction<Reducer>(*scalar, *helper, exec_ctx);
+
+  auto output = DenseHostTensor::CreateUninitialized(helper->output_metadata,
+                                                     exec_ctx.host());
+  if (!output) {
+    return EmitErrorAsync(exec_ctx, "out of memory allocating tensor");
+  }
+
+  const auto& input_dht = cast<DenseHostTensor>(input);
+  cpu::internal::ReductionPlan plan =
+      cpu::internal::MakeReductionPlan(input.shape(), helper->reduced_dims);
+
+  AsyncValueRef<Chain> chain;
+  switch (input.dtype()) {
+    default:
+      chain = EmitErrorAsync(
+          exec_ctx, StrCat("unsupported dtype for reduction: ", input.dtype()));
+      break;
+#define DTYPE_NUMERIC(ENUM)                                           \
+  case DType::ENUM:                                                   \
+    chain = cpu::Reduce<EigenTypeForDTypeKind<DType::ENUM>, Reducer>( \
+        input_dht, plan, &*output, exec_ctx);                         \
+    break;
+#include "tfrt/dtype/dtype.def"  // NOLINT
+  }
+
+  return ForwardValue(output.value(), std::move(chain));
+}
+
+//===----------------------------------------------------------------------===//
+// tf.ArgMax and tf.ArgMin ops
+//===----------------------------------------------------------------------===//
+
+template <typename T, bool kMax>
+static AsyncValueRef<Chain> ArgReduce(const DenseHostTensor& input,
+                                      const cpu::internal::ReductionPass& pass,
+                                      DenseHostTensor* output,
+                                      const ExecutionContext& exec_ctx) {
+  if (output->dtype() == DType::I32)
+    return cpu::ArgReduce<T, int32_t, kMax>(input, pass, output, exec_ctx);
+  return cpu::ArgReduce<T, int64_t, kMax>(input, pass, output, exec_ctx);
+}
+
+template <bool kMax>
+static AsyncValueRef<HostTensor> TfArgReductionOp(
+    const HostTensor& input, const HostTensor& dimension,
+    const OpAttrsRef& attrs, const ExecutionContext& exec_ctx) {
+  DType output_dtype(DType::I64);
+  if (auto attr = attrs.GetOptional<OpAttrType>("output_type")) {
+    if (*attr == OpAttrType::I32) {
+      output_dtype = DType(DType::I32);
+    } else if (*attr != OpAttrType::I64) {
+      return EmitErrorAsync(exec_ctx, "output_type must be int32 or int64");
+    }
+  }
+
+  auto indices = ReadIndices(dimension);
+  if (auto err = indices.takeError())
+    return EmitErrorAsync(exec_ctx,
+                          absl::InternalError(toString(std::move(err))));
+  if (indices->size() != 1)
+    return EmitErrorAsync(exec_ctx, "dimension must be a single index");
+
+  const int rank = input.shape().GetRank();
+  int64_t axis = (*indices)[0];
+  if (axis < -rank || axis >= rank) {
+    return EmitErrorAsync(
+        exec_ctx, "dimension must be in [-input_rank, input_rank) range");
+  }
+  axis = (axis + rank) % rank;
+
+  llvm::SmallVector<Index, 4> output_dims;
+  for (int i = 0; i < rank; ++i) {
+    if (i != axis) output_dims.push_back(input.shape().GetDimensionSize(i));
+  }
+  TensorMetadata output_md(output_dtype, output_dims);
+
+  if (input.shape().GetDimensionSize(axis) == 0 &&
+      output_md.shape.GetNumElements() > 0) {
+    return EmitErrorAsync(exec_ctx, "reduction dimension must not be empty");
+  }
+
+  // All elements of a ScalarHostTensor are equal, so the first one is both the
+  // maximum and the minimum.
+  if (isa<AnyScalarHostTensor>(input)) {
+    if (output_dtype == DType::I32) {
+      return MakeAvailableAsyncValueRef<ScalarHostTensor<int32_t>>(output_md,
+                                                                   0);
+    }
+    return MakeAvailableAsyncValueRef<ScalarHostTensor<int64_t>>(output_md, 0);
+  }
+
+  auto output =
+      DenseHostTensor::CreateUninitialized(output_md, exec_ctx.host());
+  if (!output) {
+    return EmitErrorAsync(exec_ctx, "out of memory allocating tensor");
+  }
+
+  const cpu::internal::ReductionPass pass =
+      cpu::internal::MakeArgReductionPass(input.shape(), axis);
+
+  AsyncValueRef<Chain> chain;
+  switch (input.dtype()) {
+    default:
+      chain = EmitErrorAsync(
+          exec_ctx, StrCat("unsupported dtype for reduction: ", input.dtype()));
+      break;
+#define DTYPE_NUMERIC(ENUM)                                      \
+  case DType::ENUM:                                              \
+    chain = ArgReduce<EigenTypeForDTypeKind<DType::ENUM>, kMax>( \
+        cast<DenseHostTensor>(input), pass, &*output, exec_ctx); \
+    break;
+#include "tfrt/dtype/dtype.def"  // NOLINT
+  }
+
+  return ForwardValue(output.value(), std::move(chain));
+}
+
+}  // namespace
+
+void RegisterTfReductionCpuOps(CpuOpRegistry* op_registry) {
+  op_registry->AddOp("tf.Sum", TFRT_CPU_OP(TfReductionOp<cpu::SumReducer>),
+                     CpuOpFlags::NoSideEffects | CpuOpFlags::AllowsScalar,
+                     {"keep_dims"});
+  op_registry->AddOp("tf.Prod", TFRT_CPU_OP(TfReductionOp<cpu::ProdReducer>),
+                     CpuOpFlags::NoSideEffects | CpuOpFlags::AllowsScalar,
+                     {"keep_dims"});
+  op_registry->AddOp("tf.Max", TFRT_CPU_OP(TfReductionOp<cpu::MaxReducer>),
+                     CpuOpFlags::NoSideEffects | CpuOpFlags::AllowsScalar,
+                     {"keep_dims"});
+  op_registry->AddOp("tf.Min", TFRT_CPU_OP(TfReductionOp<cpu::MinReducer>),
+                     CpuOpFlags::NoSideEffects | CpuOpFlags::AllowsScalar,
+                     {"keep_dims"});
+  op_registry->AddOp("tf.Mean", TFRT_CPU_OP(TfReductionOp<cpu::MeanReducer>),
+                     CpuOpFlags::NoSideEffects | CpuOpFlags::AllowsScalar,
+                     {"keep_dims"});
+  op_registry->AddOp("tf.ArgMax", TFRT_CPU_OP(TfArgReductionOp<true>),
+                     CpuOpFlags::NoSideEffects | CpuOpFlags::AllowsScalar,
+                     {"output_type"});
+  op_registry->AddOp("tf.ArgMin", TFRT_CPU_OP(TfArgReductionOp<false>),
+                     CpuOpFlags::NoSideEffects | CpuOpFlags::AllowsScalar,
+                     {"output_type"});
+}
+
+}  // namespace tfrt
@@ -20,6 +20,7 @@
 
 #include <algorithm>
 
+#include "buffer_forwarding.h"
 #include "tfrt/core_runtime/op_utils.h"
 #include "tfrt/cpu/core_runtime/cpu_op_registry.h"
 #include "tfrt/host_context/async_value_ref.h"
@@ -67,6 +68,35 @@ static AsyncValueRef<DenseHostTensor> TfShapeOp(
   return dest;
 }
 
+//===----------------------------------------------------------------------===//
+// Metadata only ops.
+//===----------------------------------------------------------------------===//
+
+// Returns a tensor with the `output_md` metadata and the data of `input`. Dense
+// tensors share the input buffer, and are compatible with the input buffer
+// forwarding (see MakeDenseHostTensorView). String tensors are copied.
+static AsyncValueRef<Tensor> MakeTensorView(const Tensor& input,
+                                            const TensorMetadata& output_md,
+                                            const ExecutionContext& exec_ctx,
+                                            string_view op_name) {
+  if (const auto* dht = llvm::dyn_cast<const DenseHostTensor>(&input)) {
+    auto view = MakeDenseHostTensorView(output_md, *dht);
+    if (auto err = view.takeError()) {
+      return EmitErrorAsync(exec_ctx,
+                            absl::InternalError(toString(std::move(err))));
+    }
+    return MakeAvailableAsyncValueRef<DenseHostTensor>(std::move(*view));
+  }
+
+  if (const auto* sht = llvm::dyn_cast<const StringHostTensor>(&input)) {
+    return MakeAvailableAsyncValueRef<StringHostTensor>(
+        output_md, sht->CopyBuffer(exec_ctx.host()));
+  }
+
+  return EmitErrorAsync(exec_ctx,
+                        StrCat("Unsupported tensor type for ", op_name));
+}
+
 //===----------------------------------------------------------------------===//
 // tf.ExpandDims op
 //===----------------------------------------------------------------------===//
@@ -93,8 +123,6 @@ static Expected<int64_t> GetExpandAxisValue(const DenseHostTensor& axis) {
 static AsyncValueRef<Tensor> TfExpandDimsOp(const Tensor& input,
                                             const DenseHostTensor& axis,
                                             const ExecutionContext& exec_ctx) {
-  HostContext* host = exec_ctx.host();
-
   const TensorShape& input_shape = input.shape();
   const int input_rank = input_shape.GetRank();
 
@@ -128,18 +156,131 @@ static AsyncValueRef<Tensor> TfExpandDimsOp(const Tensor& input,
   }
 
   TensorMetadata output_md(input.metadata().dtype, output_dims);
+  return MakeTensorView(input, output_md, exec_ctx, "tf.ExpandDims");
+}
 
-  if (const auto* dht = llvm::dyn_cast<const DenseHostTensor>(&input)) {
-    return MakeAvailableAsyncValueRef<DenseHostTensor>(output_md,
-                                                       dht->buffer());
+//===----------------------------------------------------------------------===//
+// tf.Reshape op
+//===----------------------------------------------------------------------===//
+
+static Expected<llvm::SmallVector<Index, 4>> GetReshapeDims(
+    const DenseHostTensor& shape) {
+  llvm::SmallVector<Index, 4> dims;
+
+  if (shape.shape().GetRank() != 1)
+    return MakeStringError("Shape must be a vector");
+
+  if (shape.dtype() == DType::I32) {
+    DHTArrayView<int32_t> view(&shape);
+    dims.append(view.begin(), view.end());
+  } else if (shape.dtype() == DType::I64) {
+    DHTArrayView<int64_t> view(&shape);
+    dims.append(view.begin(), view.end());
+  } else {
+    return MakeStringError("Unsupported shape data type");
   }
 
-  if (const auto* sht = llvm::dyn_cast<const StringHostTensor>(&input)) {
-    return MakeAvailableAsyncValueRef<StringHostTensor>(output_md,
-                                                        sht->CopyBuffer(host));
+  return dims;
+}
+
+static AsyncValueRef<Tensor> TfReshapeOp(const Tensor& input,
+                                         const DenseHostTensor& shape,
+                                         const ExecutionContext& exec_ctx) {
+  auto expected_dims = GetReshapeDims(shape);
+  if (auto err = expected_dims.takeError()) {
+    return EmitErrorAsync(exec_ctx,
+                          absl::InternalError(toString(std::move(err))));
+  }
+  llvm::SmallVector<Index, 4>& output_dims = *expected_dims;
+
+  // At most one dimension can be -1, and it is inferred from the number of
+  // elements.
+  int inferred_dim = -1;
+  Index num_elements = 1;
+  for (int d = 0; d < output_dims.size(); ++d) {
+    if (output_dims[d] == -1 && inferred_dim == -1) {
+      inferred_dim = d;
+    } else if (output_dims[d] < 0) {
+      return EmitErrorAsync(exec_ctx, StrCat("Invalid reshape dimension ",
+                                             output_dims[d]));
+    } else {
+      num_elements *= output_dims[d];
+    }
   }
 
-  return EmitErrorAsync(exec_ctx, "Unsupported tensor type for tf.ExpandDims");
+  const Index input_num_elements = input.shape().GetNumElements();
+  if (inferred_dim != -1 && num_elements != 0 &&
+      input_num_elements % num_elements == 0) {
+    output_dims[inferred_dim] = input_num_elements / num_elements;
+    num_elements = input_num_elements;
+  }
+
+  if (num_elements != input_num_elements) {
+    return EmitErrorAsync(
+        exec_ctx, StrCat("Input to reshape is a tensor with ",
+                         input_num_elements,
+                         " values, but the requested shape has ",
+                         num_elements));
+  }
+
+  TensorMetadata output_md(input.metadata().dtype, output_dims);
+  return MakeTensorView(input, output_md, exec_ctx, "tf.Reshape");
+}
+
+//===----------------------------------------------------------------------===//
+// tf.Squeeze op
+//===----------------------------------------------------------------------===//
+
+static AsyncValueRef<Tensor> TfSqueezeOp(const Tensor& input,
+                                         const OpAttrsRef& attrs,
+                                         const ExecutionContext& exec_ctx) {
+  const TensorShape& input_shape = input.shape();
+  const int input_rank = input_shape.GetRank();
+
+  // All dimensions of size 1 are squeezed if `squeeze_dims` is empty.
+  llvm::SmallVector<bool, 4> squeeze(input_rank, false);
+  llvm::SmallVector<int64_t, 4> squeeze_dims;
+  ArrayRef<int64_t> squeeze_dims_i64;
+  ArrayRef<int32_t> squeeze_dims_i32;
+  if (attrs.GetArray("squeeze_dims", &squeeze_dims_i64)) {
+    squeeze_dims.append(squeeze_dims_i64.begin(), squeeze_dims_i64.end());
+  } else if (attrs.GetArray("squeeze_dims", &squeeze_dims_i32)) {
+    squeeze_dims.append(squeeze_dims_i32.begin(), squeeze_dims_i32.end());
+  }
+
+  for (int64_t dim : squeeze_dims) {
+    if (dim < -input_rank || dim >= input_rank) {
+      return EmitErrorAsync(exec_ctx,
+                            StrCat("Failed to squeeze axis ", dim,
+                                   " for tensor of rank ", input_rank));
+    }
+    if (dim < 0) dim += input_rank;
+    if (input_shape.GetDimensionSize(dim) != 1) {
+      return EmitErrorAsync(exec_ctx,
+                            StrCat("Can't squeeze dimension ", dim, " of size ",
+                                   input_shape.GetDimensionSize(dim)));
+    }
+    squeeze[dim] = true;
+  }
+
+  llvm::SmallVector<Index, 4> output_dims;
+  for (int d = 0; d < input_rank; ++d) {
+    const Index dim = input_shape.GetDimensionSize(d);
+    if (squeeze_dims.empty() ? dim == 1 : squeeze[d]) continue;
+    output_dims.push_back(dim);
+  }
+
+  TensorMetadata output_md(input.metadata().dtype, output_dims);
+  return MakeTensorView(input, output_md, exec_ctx, "tf.Squeeze");
+}
+
+//===----------------------------------------------------------------------===//
+// tf.Identity op
+//===----------------------------------------------------------------------===//
+
+static AsyncValueRef<Tensor> TfIdentityOp(const Tensor& input,
+                                          const ExecutionContext& exec_ctx) {
+  return MakeTensorView(input, input.metadata(), exec_ctx, "tf.Identity");
 }
 
 }  // namespace
@@ -153,6 +294,15 @@ void RegisterTfShapeCpuOps(CpuOpRegistry* op_registry) {
                      CpuOpFlags::NoSideEffects | CpuOpFlags::AllowsString);
   op_registry->AddOp("tf.ExpandDims", TFRT_CPU_OP(TfExpandDimsOp),
                      CpuOpFlags::NoSideEffects | CpuOpFlags::AllowsString);
+  op_registry->AddOp("tf.Reshape", TFRT_CPU_OP(TfReshapeOp),
+                     CpuOpFlags::NoSideEffects | CpuOpFlags::AllowsString);
+  op_registry->AddOp("tf.Squeeze", TFRT_CPU_OP(TfSqueezeOp),
+                     CpuOpFlags::NoSideEffects | CpuOpFlags::AllowsString,
+                     {"squeeze_dims"});
+  op_registry->AddOp("tf.Identity", TFRT_CPU_OP(TfIdentityOp),
+                     CpuOpFlags::NoSideEffects | CpuOpFlags::AllowsString);
+  op_registry->AddOp("tf.StopGradient", TFRT_CPU_OP(TfIdentityOp),
+                     CpuOpFlags::NoSideEffects | CpuOpFlags::AllowsString);
 }
 
 }  // namespace tfrt
@@ -29,45 +29,69 @@
 #include "tfrt/host_context/kernel_utils.h"
 #include "tfrt/support/forward_decls.h"
 #include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/tensor_shape.h"
+#include "type_dispatch.h"
 
 namespace tfrt {
 namespace {
 
-template <bool log>
+// Computes the softmax of `logits`. The variant for rank 2 logits, registered
+// as a specialization of the op, reads the batch size and the number of
+// classes with a FixedRankShape instead of flattening the shape.
+template <bool log, size_t Rank = 0>
 static AsyncValueRef<DenseHostTensor> TfSoftmaxOp(
     const DenseHostTensor& logits, const TensorMetadata& output_md,
     const ExecutionContext& exec_ctx) {
+  static_assert(Rank == 0 || Rank == 2, "unsupported Softmax specialization");
   HostContext* host = exec_ctx.host();
 
+  Index batch_size, num_classes;
+  if (Rank == 2) {
+    FixedRankShape<2> shape(logits.shape());
+    batch_size = shape[0];
+    num_classes = shape[1];
+  } else {
+    TensorShape shape =
+        GetFlattenedInnerDimsShape(logits.shape(), /*num_out_dims=*/2);
+    batch_size = shape.GetDimensionSize(0);
+    num_classes = shape.GetDimensionSize(1);
+  }
+
   auto dest = DenseHostTensor::CreateUninitialized(output_md, host);
   if (!dest) {
     return EmitErrorAsync(exec_ctx, "out of memory allocating result");
   }
 
-  AsyncValueRef<Chain> chain;
-  switch (logits.dtype()) {
-    default:
-      chain = EmitErrorAsync(exec_ctx, "unsupported dtype");
-      break;
-#define DTYPE_FLOAT(ENUM)                                                     \
-  case DType::ENUM: {                                                         \
-    chain = ::tfrt::cpu::Softmax<EigenTypeForDTypeKind<DType::ENUM>, log,     \
-                                 compat::AsyncEigenEvaluator>(logits, &*dest, \
-                                                              exec_ctx);      \
-  } break;
-#include "tfrt/dtype/dtype.def"  // NOLINT
-  }
+  auto unsupported = [&](DType dtype) -> AsyncValueRef<Chain> {
+    return EmitErrorAsync(exec_ctx, "unsupported dtype");
+  };
 
-  return ForwardValue(dest.value(), std::move(chain));
+  auto dispatch = [&](auto type_tag) -> AsyncValueRef<Chain> {
+    using T = decltype(type_tag);
+    return cpu::Softmax<T, log, compat::AsyncEigenEvaluator>(
+        logits, batch_size, num_classes, &*dest, exec_ctx);
+  };
+
+  // 16-bit floating point logits are computed in float.
+  internal::FloatTypeDispatch type_dispatch(logits.dtype());
+  return ForwardValue(dest.value(), type_dispatch(dispatch, unsupported));
 }
 
 }  // namespace
 
 void RegisterTfSofmaxCpuOps(CpuOpRegistry* op_registry) {
+  const Index kMatrixDims[] = {PartialTensorShape::kUnknownDimSize,
+                               PartialTensorShape::kUnknownDimSize};
+  const PartialTensorShape matrix{ArrayRef<Index>(kMatrixDims)};
+
   op_registry->AddOp("tf.Softmax", TFRT_CPU_OP(TfSoftmaxOp<false>),
                      CpuOpFlags::NoSideEffects);
+  op_registry->AddSpecializedOp("tf.Softmax", matrix,
+                                TFRT_CPU_OP(TfSoftmaxOp<false, 2>));
   op_registry->AddOp("tf.LogSoftmax", TFRT_CPU_OP(TfSoftmaxOp<true>),
                      CpuOpFlags::NoSideEffects);
+  op_registry->AddSpecializedOp("tf.LogSoftmax", matrix,
+                                TFRT_CPU_OP(TfSoftmaxOp<true, 2>));
 }
 
 }  // namespace tfrt
@@ -0,0 +1,79 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Tensorflow Transpose operation.
+
+#include "transpose_op.h"
+
+#include "../../kernels/transpose_kernel.h"
+#include "tfrt/common/compat/eigen/eigen_evaluator.h"
+#include "tfrt/core_runtime/op_utils.h"
+#include "tfrt/cpu/core_runtime/cpu_op_registry.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/kernel_utils.h"
+#include "tfrt/support/forward_decls.h"
+
+namespace tfrt {
+namespace {
+
+static AsyncValueRef<DenseHostTensor> TfTransposeOp(
+    const DenseHostTensor& input, const DenseHostTensor& perm_arg,
+    const ExecutionContext& exec_ctx) {
+  if (input.dtype() == DType::String) {
+    return EmitErrorAsync(exec_ctx,
+                          StrCat("Unsupported dtype: ", input.dtype()));
+  }
+
+  Expected<llvm::SmallVector<Index, 5>> perm =
+      cpu::TransposePermutation(perm_arg, input.shape().GetRank());
+  if (auto err = perm.takeError())
+    return EmitErrorAsync(exec_ctx,
+                          absl::InternalError(toString(std::move(err))));
+
+  TensorMetadata output_md(input.dtype(),
+                           cpu::TransposedShape(input.shape(), *perm));
+
+  cpu::internal::TransposePlan plan = cpu::internal::MakeTransposePlan(
+      input.shape(), *perm, GetHostSize(input.dtype()));
+
+  // The permutation only changes the metadata, so the output shares the input
+  // buffer.
+  if (plan.is_identity) {
+    return MakeAvailableAsyncValueRef<DenseHostTensor>(output_md,
+                                                       input.buffer());
+  }
+
+  auto output =
+      DenseHostTensor::CreateUninitialized(output_md, exec_ctx.host());
+  if (!output) {
+    return EmitErrorAsync(exec_ctx, "out of memory allocating result");
+  }
+
+  AsyncValueRef<Chain> chain =
+      cpu::Transpose<compat::AsyncEigenEvaluator>(input, plan, &*output,
+                                                  exec_ctx);
+  return ForwardValue(output.value(), std::move(chain));
+}
+
+}  // namespace
+
+void RegisterTfTransposeCpuOp(CpuOpRegistry* op_registry) {
+  op_registry->AddOp("tf.Transpose", TFRT_CPU_OP(TfTransposeOp),
+                     CpuOpFlags::NoSideEffects);
+}
+
+}  // namespace tfrt
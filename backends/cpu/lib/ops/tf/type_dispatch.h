@@ -21,6 +21,10 @@
 #ifndef TFRT_BACKENDS_CPU_OPS_TF_DISPATCH_OP_H_
 #define TFRT_BACKENDS_CPU_OPS_TF_DISPATCH_OP_H_
 
+#include <array>
+#include <cstddef>
+#include <type_traits>
+
 #include "tfrt/common/compat/eigen/eigen_dtype.h"
 #include "tfrt/dtype/dtype.h"
 
@@ -60,33 +64,55 @@ class TypeDispatch {
 
   template <typename Dispatch, typename Unsupported>
   auto operator()(Dispatch&& dispatch, Unsupported&& unsupported) {
-    return Impl<Dispatch, Unsupported, Types...>(
-        std::forward<Dispatch>(dispatch),
-        std::forward<Unsupported>(unsupported));
+    using DispatchFn = std::remove_reference_t<Dispatch>;
+    using UnsupportedFn = std::remove_reference_t<Unsupported>;
+    using Result = decltype(unsupported(dtype_));
+
+    static constexpr auto kTable =
+        MakeTable<Result, DispatchFn, UnsupportedFn>();
+    const size_t index = static_cast<size_t>(dtype_);
+    return kTable[index < kNumDTypeKinds ? index : 0](dispatch, unsupported,
+                                                       dtype_);
   }
 
  private:
-  // Variadic template recursion that compares first type of the variadic pack
-  // with `dtype`. If type matches it calls `dispatch` with a type tag (default
-  // constructed value of Eigen compatibe type derived from T), otherwise it
-  // will try to match the next type in the variadic pack.
-  template <typename Dispatch, typename Unsupported, typename T,
-            typename... Rest>
-  auto Impl(Dispatch&& dispatch, Unsupported&& unsupported) {
-    if (dtype_ == GetDType<T>()) {
-      return dispatch(EigenTypeForDTypeKind<GetDType<T>()>{});
-    }
-
-    return Impl<Dispatch, Unsupported, Rest...>(
-        std::forward<Dispatch>(dispatch),
-        std::forward<Unsupported>(unsupported));
+  // The number of DType kinds, including `Invalid` and `Unsupported`.
+  static constexpr size_t kNumDTypeKinds =
+      static_cast<size_t>(DType::LastDType) + 1;
+
+  template <typename Result, typename Dispatch, typename Unsupported>
+  using Entry = Result (*)(Dispatch&, Unsupported&, DType);
+
+  // Calls `dispatch` with a type tag (default constructed value of Eigen
+  // compatible type) for the DType kind `kind`.
+  template <DType kind, typename Result, typename Dispatch,
+            typename Unsupported>
+  static Result CallDispatch(Dispatch& dispatch, Unsupported&, DType) {
+    return dispatch(EigenTypeForDTypeKind<kind>{});
   }
 
-  // Variadic template recursion base case, pass unsupported dtype to
-  // `unsupported` callback.
-  template <typename Dispatch, typename Unsupported>
-  auto Impl(Dispatch&& dispatch, Unsupported&& unsupported) {
-    return unsupported(dtype_);
+  // Passes the unsupported dtype to the `unsupported` callback.
+  template <typename Result, typename Dispatch, typename Unsupported>
+  static Result CallUnsupported(Dispatch&, Unsupported& unsupported,
+                                DType dtype) {
+    return unsupported(dtype);
+  }
+
+  // Returns the table of the dispatch functions indexed by DType kind. The
+  // kinds that are not in `Types` all share a single entry that calls
+  // `unsupported`, so the table is generated once per pair of callbacks and
+  // dispatching is a single indirect call.
+  template <typename Result, typename Dispatch, typename Unsupported>
+  static constexpr std::array<Entry<Result, Dispatch, Unsupported>,
+                              kNumDTypeKinds>
+  MakeTable() {
+    std::array<Entry<Result, Dispatch, Unsupported>, kNumDTypeKinds> table{};
+    for (auto& entry : table)
+      entry = &CallUnsupported<Result, Dispatch, Unsupported>;
+    ((table[static_cast<size_t>(GetDType<Types>())] =
+          &CallDispatch<GetDType<Types>(), Result, Dispatch, Unsupported>),
+     ...);
+    return table;
   }
 
   const DType dtype_;
@@ -97,6 +123,31 @@ struct GetTypeDispatch {
   using Type = internal::TypeDispatch<TypeForDTypeKind<kind>...>;
 };
 
+// The dtypes supported by the Tensorflow ops, declared once and shared by the
+// ops that support the same dtypes.
+
+// Floating point types.
+using FloatTypeDispatch =
+    TypeDispatch<float, double, Eigen::half, Eigen::bfloat16>;
+
+// 32 and 64 bit floating point types.
+using FullPrecisionFloatTypeDispatch = TypeDispatch<float, double>;
+
+// clang-format off
+// Integer and floating point types.
+using NumericTypeDispatch = typename GetTypeDispatch<
+    DType::UI8, DType::UI16, DType::UI32, DType::UI64,
+    DType::I8,  DType::I16,  DType::I32,  DType::I64,
+    DType::F16, DType::BF16, DType::F32, DType::F64>::Type;
+
+// Integer, floating point and complex types.
+using NumericAndComplexTypeDispatch = typename GetTypeDispatch<
+    DType::UI8, DType::UI16, DType::UI32, DType::UI64,
+    DType::I8,  DType::I16,  DType::I32,  DType::I64,
+    DType::F16, DType::BF16, DType::F32, DType::F64,
+    DType::Complex64, DType::Complex128>::Type;
+// clang-format on
+
 }  // namespace internal
 }  // namespace tfrt
 
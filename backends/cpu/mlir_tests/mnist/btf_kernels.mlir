@@ -43,6 +43,47 @@ func.func @tensor_io() {
   tfrt.return
 }
 
+// CHECK-LABEL: --- Running 'mapped_tensor_io'
+func.func @mapped_tensor_io() {
+  %c0 = tfrt.new.chain
+  %path = "tfrt_test.get_string"() { value = "backends/cpu/mlir_tests/mnist/test_data/test_tensor.btf" } : () -> !tfrt.string
+
+  %zero = tfrt.constant.i32 0
+  %one = tfrt.constant.i32 1
+  %two = tfrt.constant.i32 2
+
+  %t0 = "btf.read_mapped_dense_tensor"(%path, %zero) : (!tfrt.string, i32) -> (!tfrt_tensor.tensor)
+  // CHECK-NEXT: shape = [2, 2], values = [1, 2, 3, 4]
+  %c1 = tfrt_dht.print_tensor %t0, %c0
+
+  %t1 = "btf.read_mapped_dense_tensor"(%path, %one) : (!tfrt.string, i32) -> (!tfrt_tensor.tensor)
+  // CHECK-NEXT: shape = [5], values = [0, 1, 2, 3, 4]
+  %c2 = tfrt_dht.print_tensor %t1, %c1
+
+  %t2 = "btf.read_mapped_dense_tensor"(%path, %two) : (!tfrt.string, i32) -> (!tfrt_tensor.tensor)
+  // CHECK-NEXT: shape = [0], values = []
+  %c3 = tfrt_dht.print_tensor %t2, %c2
+
+  tfrt.return
+}
+
+// CHECK-LABEL: --- Running 'read_all_tensors'
+func.func @read_all_tensors() {
+  %c0 = tfrt.new.chain
+  %path = "tfrt_test.get_string"() { value = "backends/cpu/mlir_tests/mnist/test_data/test_tensor.btf" } : () -> !tfrt.string
+
+  %t2, %t0, %t1 = "btf.read_all"(%path) { indices = [2 : i32, 0 : i32, 1 : i32] } : (!tfrt.string) -> (!tfrt_tensor.tensor, !tfrt_tensor.tensor, !tfrt_tensor.tensor)
+
+  // CHECK-NEXT: shape = [2, 2], values = [1, 2, 3, 4]
+  %c1 = tfrt_dht.print_tensor %t0, %c0
+  // CHECK-NEXT: shape = [5], values = [0, 1, 2, 3, 4]
+  %c2 = tfrt_dht.print_tensor %t1, %c1
+  // CHECK-NEXT: shape = [0], values = []
+  %c3 = tfrt_dht.print_tensor %t2, %c2
+
+  tfrt.return
+}
+
 // CHECK-LABEL: --- Running 'tensor_io_invalid_path'
 func.func @tensor_io_invalid_path() {
   %c0 = tfrt.new.chain
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Unit tests for BEF section compression.
+
+#include "tfrt/bef/bef_compression.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace tfrt {
+namespace {
+
+class BefCompressionTest
+    : public ::testing::TestWithParam<BEFCompressionFormat> {};
+
+TEST_P(BefCompressionTest, RoundTrip) {
+  const BEFCompressionFormat format = GetParam();
+  if (!IsBEFCompressionAvailable(format))
+    GTEST_SKIP() << "compression format is not available";
+
+  std::vector<uint8_t> data;
+  for (int i = 0; i < 4096; ++i) data.push_back(i % 7);
+
+  llvm::SmallVector<uint8_t, 0> compressed;
+  ASSERT_FALSE(static_cast<bool>(
+      CompressBEFSectionData(format, data, &compressed)));
+  EXPECT_LT(compressed.size(), data.size());
+
+  // Prepend the section header that the BEF emitter writes.
+  std::vector<uint8_t> payload = {
+      static_cast<uint8_t>(BEFSectionID::kLocations),
+      static_cast<uint8_t>(format), 0x80 | (4096 >> 7), 4096 & 127};
+  payload.insert(payload.end(), compressed.begin(), compressed.end());
+
+  CompressedBEFSection section;
+  ASSERT_TRUE(ReadCompressedBEFSection(payload, &section));
+  EXPECT_EQ(section.section_id, BEFSectionID::kLocations);
+  EXPECT_EQ(section.format, format);
+  EXPECT_EQ(section.uncompressed_size, data.size());
+
+  llvm::SmallVector<uint8_t, 0> decompressed;
+  ASSERT_FALSE(static_cast<bool>(DecompressBEFSection(section, &decompressed)));
+  EXPECT_THAT(decompressed, ::testing::ElementsAreArray(data));
+}
+
+INSTANTIATE_TEST_SUITE_P(Formats, BefCompressionTest,
+                         ::testing::Values(BEFCompressionFormat::kZlib,
+                                           BEFCompressionFormat::kZstd));
+
+TEST(BefCompressionTest, RejectsCorruptedHeader) {
+  CompressedBEFSection section;
+  EXPECT_FALSE(ReadCompressedBEFSection({}, &section));
+
+  // A compressed section cannot hold another compressed section.
+  const uint8_t nested[] = {static_cast<uint8_t>(BEFSectionID::kCompressed),
+                            static_cast<uint8_t>(BEFCompressionFormat::kZlib),
+                            0};
+  EXPECT_FALSE(ReadCompressedBEFSection(nested, &section));
+
+  const uint8_t unknown_format[] = {
+      static_cast<uint8_t>(BEFSectionID::kLocations), 0, 0};
+  EXPECT_FALSE(ReadCompressedBEFSection(unknown_format, &section));
+}
+
+}  // namespace
+}  // namespace tfrt
@@ -249,6 +249,46 @@ TEST_F(BefAttrEmitterTest, EncodeDenseAttribute) {
   EXPECT_EQ(attr.GetElement<float>(1), 1.5f);
 }
 
+TEST_F(BefAttrEmitterTest, PoolLargeAttributesWithSameEncoding) {
+  auto get_dense_attr = [&](int64_t size,
+                            mlir::IntegerType::SignednessSemantics signedness) {
+    auto type = mlir::RankedTensorType::get(
+        {size}, mlir::IntegerType::get(&context_, 32, signedness));
+    llvm::SmallVector<int32_t, 256> values(size);
+    for (int i = 0; i < size; ++i) values[i] = i;
+    return mlir::DenseElementsAttr::get(type, llvm::ArrayRef(values));
+  };
+  const auto type = BEFAttributeType::kDense;
+
+  // Emit a small attribute first, so that the pooled ones are not at the start
+  // of the buffer.
+  emitter_.EmitAttribute(
+      mlir::IntegerAttr::get(mlir::IntegerType::get(&context_, 8), 1));
+
+  auto large_offset = emitter_.EmitPooledAttribute(
+      type, get_dense_attr(256, mlir::IntegerType::Signless));
+  const auto size = emitter_.size();
+  EXPECT_EQ(emitter_.EmitPooledAttribute(
+                type, get_dense_attr(256, mlir::IntegerType::Signed)),
+            large_offset);
+  EXPECT_EQ(emitter_.size(), size);
+
+  // Small attributes are not pooled.
+  auto small_offset = emitter_.EmitPooledAttribute(
+      type, get_dense_attr(4, mlir::IntegerType::Signless));
+  EXPECT_NE(emitter_.EmitPooledAttribute(
+                type, get_dense_attr(4, mlir::IntegerType::Signed)),
+            small_offset);
+
+  auto buffer = emitter_.TakeResult();
+  DenseAttr attr(buffer.data() + large_offset);
+  EXPECT_EQ(attr.GetNumElements(), 256);
+  EXPECT_EQ(attr.GetElement<int32_t>(255), 255);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(attr.GetElements()) %
+                kAttributeTensorAlignment,
+            0);
+}
+
 constexpr int32_t kTestAggregateAttr1 = 123;
 constexpr char kTestAggregateAttr2[] = "Aggregate Attribute";
 constexpr float kTestAggregateAttr3 = 3.14;
@@ -0,0 +1,163 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Unit tests for BefFunctionCache and its use by ConvertMLIRToBEF.
+
+#include "tfrt/bef_converter/bef_function_cache.h"
+
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/Parser/Parser.h"
+#include "tfrt/basic_kernels/opdefs/tfrt_base.h"
+#include "tfrt/bef/bef_buffer.h"
+#include "tfrt/bef_converter/mlir_to_bef.h"
+
+namespace tfrt {
+namespace {
+
+class BefFunctionCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_FALSE(llvm::sys::fs::createUniqueDirectory("bef_function_cache",
+                                                      directory_));
+    mlir::DialectRegistry registry;
+    registry.insert<compiler::TFRTDialect, mlir::func::FuncDialect>();
+    context_.appendDialectRegistry(registry);
+    context_.allowUnregisteredDialects();
+  }
+
+  void TearDown() override { llvm::sys::fs::remove_directories(directory_); }
+
+  BefBuffer Convert(const std::string& source,
+                    const BefFunctionCache* cache) {
+    mlir::OwningOpRef<mlir::ModuleOp> module =
+        mlir::parseSourceString<mlir::ModuleOp>(source, &context_);
+    EXPECT_TRUE(module);
+    return ConvertMLIRToBEF(module.get(), /*disable_optional_sections=*/false,
+                            /*debug_section_compression=*/std::nullopt,
+                            cache);
+  }
+
+  llvm::SmallString<128> directory_;
+  mlir::MLIRContext context_;
+};
+
+std::string Module(int constant) {
+  return R"(
+func.func @first(%a: i32) -> i32 {
+  %b = "simple.kernel"(%a) {value = 1 : i32} : (i32) -> i32
+  %c = "simple.kernel"(%a, %b) : (i32, i32) -> i32
+  tfrt.return %c : i32
+}
+
+func.func @second(%a: i32) -> i32 {
+  %b = "simple.kernel"(%a) {value = 2 : i32} : (i32) -> i32
+  tfrt.return %b : i32
+}
+
+func.func @third(%a: i32) -> i32 {
+  %b = "simple.kernel"(%a) {value = )" +
+         std::to_string(constant) + R"( : i32} : (i32) -> i32
+  tfrt.return %b : i32
+}
+)";
+}
+
+TEST_F(BefFunctionCacheTest, LookupInsertedEntry) {
+  BefFunctionCache cache(std::string(directory_.str()));
+  EXPECT_FALSE(cache.Lookup("entry").has_value());
+
+  cache.Insert("entry", "value");
+  cache.Insert("other", std::string("\0\1", 2));
+  EXPECT_EQ(cache.Lookup("entry"), "value");
+  EXPECT_EQ(cache.Lookup("other"), std::string("\0\1", 2));
+  EXPECT_EQ(cache.num_hits(), 2);
+  EXPECT_EQ(cache.num_misses(), 1);
+}
+
+TEST_F(BefFunctionCacheTest, ReuseUnchangedFunctions) {
+  const BefBuffer expected = Convert(Module(3), /*cache=*/nullptr);
+  ASSERT_FALSE(expected.empty());
+
+  // The first conversion fills the cache.
+  {
+    BefFunctionCache cache(std::string(directory_.str()));
+    EXPECT_EQ(Convert(Module(3), &cache), expected);
+    EXPECT_EQ(cache.num_hits(), 0);
+  }
+
+  // The second conversion restores the encoding of every function.
+  {
+    BefFunctionCache cache(std::string(directory_.str()));
+    EXPECT_EQ(Convert(Module(3), &cache), expected);
+    EXPECT_EQ(cache.num_hits(), 3);
+    EXPECT_EQ(cache.num_misses(), 0);
+  }
+
+  // Only the changed function, the last one, is encoded again. Its new
+  // attribute moves the attributes of no other function.
+  {
+    const BefBuffer changed = Convert(Module(4), /*cache=*/nullptr);
+    BefFunctionCache cache(std::string(directory_.str()));
+    EXPECT_EQ(Convert(Module(4), &cache), changed);
+    EXPECT_EQ(cache.num_hits(), 2);
+    // The function entry and the streams entry of the changed function.
+    EXPECT_EQ(cache.num_misses(), 2);
+  }
+}
+
+TEST_F(BefFunctionCacheTest, IgnoreEntriesOfCollidingKeys) {
+  const BefBuffer expected = Convert(Module(3), /*cache=*/nullptr);
+  {
+    BefFunctionCache cache(std::string(directory_.str()));
+    EXPECT_EQ(Convert(Module(3), &cache), expected);
+  }
+
+  // Give every entry the content of one of them, as if the keys of all the
+  // entries had collided with its key.
+  std::vector<std::string> paths;
+  std::error_code error;
+  for (llvm::sys::fs::directory_iterator it(directory_, error), end;
+       !error && it != end; it.increment(error))
+    paths.push_back(it->path());
+  ASSERT_FALSE(error);
+  ASSERT_GT(paths.size(), 1);
+  auto content = llvm::MemoryBuffer::getFile(paths.front());
+  ASSERT_TRUE(content);
+  for (const std::string& path : paths) {
+    llvm::raw_fd_ostream os(path, error);
+    ASSERT_FALSE(error);
+    os << (*content)->getBuffer();
+  }
+
+  // The entries are found, but none of them is restored.
+  BefFunctionCache cache(std::string(directory_.str()));
+  EXPECT_EQ(Convert(Module(3), &cache), expected);
+  EXPECT_EQ(cache.num_hits(), 6);
+}
+
+}  // namespace
+}  // namespace tfrt
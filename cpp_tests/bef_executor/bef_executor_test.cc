@@ -0,0 +1,250 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Unit test for the scheduling modes of BEFExecutor.
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/raw_ostream.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/Parser/Parser.h"
+#include "tfrt/basic_kernels/opdefs/tfrt_base.h"
+#include "tfrt/bef/bef_buffer.h"
+#include "tfrt/bef_converter/mlir_to_bef.h"
+#include "tfrt/bef_executor/bef_executor_options.h"
+#include "tfrt/bef_executor/bef_file.h"
+#include "tfrt/host_context/async_value.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/function.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/host_context/kernel_registry.h"
+#include "tfrt/host_context/kernel_utils.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/test_kernels/opdefs/test_kernels.h"
+
+namespace tfrt {
+namespace {
+
+constexpr int kDepth = 4;
+constexpr int kWidth = 16;
+
+// Returns a function of `kDepth` layers of `kWidth` kernels, where every
+// kernel adds two kernels of the previous layer and the last kernel adds up
+// the last layer. A cost threshold of 1 puts every kernel in its own stream,
+// so every layer fans out to the work queue.
+std::string WideFunction(bool async) {
+  const char* add = async ? "tfrt_test.async_add.i32" : "tfrt.add.i32";
+  std::string mlir;
+  llvm::raw_string_ostream os(mlir);
+  os << "module attributes {tfrt.cost_threshold = 1 : i64} {\n"
+     << "func.func @wide(%a: i32) -> i32 {\n";
+  for (int layer = 0; layer < kDepth; ++layer) {
+    for (int index = 0; index < kWidth; ++index) {
+      os << "  %v" << layer << '_' << index << " = \"" << add << "\"(";
+      if (layer == 0) {
+        os << "%a, %a";
+      } else {
+        os << "%v" << layer - 1 << '_' << index << ", %v" << layer - 1 << '_'
+           << (index + 1) % kWidth;
+      }
+      os << ") : (i32, i32) -> i32\n";
+    }
+  }
+  os << "  %result = \"tfrt_test.sum\"(";
+  for (int i = 0; i < kWidth; ++i)
+    os << (i ? ", " : "") << "%v" << kDepth - 1 << '_' << i;
+  os << ") : (";
+  for (int i = 0; i < kWidth; ++i) os << (i ? ", " : "") << "i32";
+  os << ") -> i32\n  tfrt.return %result : i32\n}\n}\n";
+  return os.str();
+}
+
+// The result of WideFunction() for an argument of 1: the kernels of layer `l`
+// return 2^(l + 1).
+constexpr int32_t kWideResult = kWidth * (1 << kDepth);
+
+// A function where %x has a user %y of its own stream, which is the stream of
+// the return, and a user %z of another stream. Each kernel records the thread
+// it runs on in the slot of its attribute.
+constexpr char kPlacementFunction[] = R"mlir(
+module attributes {tfrt.cost_threshold = 1 : i64} {
+func.func @placement(%a: i32) -> (i32, i32) {
+  %x = "bef_executor_test.record_thread"(%a) {slot = 0 : i32} : (i32) -> i32
+  %y = "bef_executor_test.record_thread"(%x) {slot = 1 : i32} : (i32) -> i32
+  %z = "bef_executor_test.record_thread"(%x) {slot = 2 : i32} : (i32) -> i32
+  tfrt.return %y, %z : i32, i32
+}
+}
+)mlir";
+
+constexpr int kNumSlots = 3;
+
+mutex threads_mu;
+std::thread::id threads[kNumSlots];
+
+int32_t RecordThread(int32_t value, Attribute<int32_t> slot) {
+  mutex_lock lock(threads_mu);
+  threads[slot.get()] = std::this_thread::get_id();
+  return value;
+}
+
+std::thread::id GetThread(int slot) {
+  mutex_lock lock(threads_mu);
+  return threads[slot];
+}
+
+class BEFExecutorTest : public ::testing::Test {
+ protected:
+  BEFExecutorTest()
+      : host_([](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+              CreateMultiThreadedWorkQueue(4, 4)) {
+    RegisterStaticKernels(host_.GetMutableRegistry());
+    host_.GetMutableRegistry()->AddKernel("bef_executor_test.record_thread",
+                                          TFRT_KERNEL(RecordThread));
+  }
+
+  const Function* Load(const std::string& source, string_view name) {
+    mlir::MLIRContext context;
+    mlir::DialectRegistry registry;
+    registry.insert<compiler::TFRTDialect, mlir::func::FuncDialect,
+                    test::TestDialect>();
+    context.appendDialectRegistry(registry);
+    context.allowUnregisteredDialects();
+    mlir::OwningOpRef<mlir::ModuleOp> module =
+        mlir::parseSourceString<mlir::ModuleOp>(source, &context);
+    EXPECT_TRUE(module);
+    bef_buffer_ =
+        ConvertMLIRToBEF(module.get(), /*disable_optional_sections=*/true);
+    bef_file_ = BEFFile::Open(bef_buffer_, host_.GetKernelRegistry(),
+                              host_.diag_handler(), host_.allocator());
+    EXPECT_TRUE(bef_file_);
+    return bef_file_ ? bef_file_->GetFunction(name) : nullptr;
+  }
+
+  ExecutionContext CreateExecutionContext(const BEFExecutorOptions& options) {
+    RequestContextBuilder builder(&host_, /*resource_context=*/nullptr);
+    builder.context_data().emplace<BEFExecutorOptions>(options);
+    auto request_ctx = std::move(builder).build();
+    EXPECT_FALSE(!request_ctx);
+    return ExecutionContext(std::move(*request_ctx));
+  }
+
+  // Runs `fn` with 1 as its argument, and returns its first result.
+  RCReference<AsyncValue> Run(const Function* fn,
+                              const ExecutionContext& exec_ctx) {
+    auto argument = MakeAvailableAsyncValueRef<int32_t>(1);
+    llvm::SmallVector<RCReference<AsyncValue>, 2> results;
+    results.resize(fn->result_types().size());
+    fn->Execute(exec_ctx, {argument.GetAsyncValue()}, results);
+    host_.Await(results);
+    return std::move(results[0]);
+  }
+
+  // Options that time every kernel, so that the placement follows the costs
+  // from the second execution on.
+  static BEFExecutorOptions AdaptivePlacementOptions() {
+    BEFExecutorOptions options;
+    options.adaptive_placement = true;
+    options.adaptive_sample_period = 1;
+    return options;
+  }
+
+  HostContext host_;
+  BefBuffer bef_buffer_;
+  RCReference<BEFFile> bef_file_;
+};
+
+class BEFExecutorKernelsTest : public BEFExecutorTest,
+                               public ::testing::WithParamInterface<bool> {};
+
+TEST_P(BEFExecutorKernelsTest, WorkStealingRunsEveryStream) {
+  const Function* fn = Load(WideFunction(/*async=*/GetParam()), "wide");
+  ASSERT_NE(fn, nullptr);
+
+  BEFExecutorOptions options;
+  options.work_stealing = true;
+  options.steal_batch_size = 3;
+  auto exec_ctx = CreateExecutionContext(options);
+
+  for (int i = 0; i < 100; ++i) {
+    auto result = Run(fn, exec_ctx);
+    ASSERT_FALSE(result->IsError()) << result->GetError();
+    EXPECT_EQ(result->get<int32_t>(), kWideResult);
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(SyncAndAsyncKernels, BEFExecutorKernelsTest,
+                         ::testing::Bool());
+
+TEST_F(BEFExecutorTest, CheapKernelOfOtherStreamRunsInline) {
+  const Function* fn = Load(kPlacementFunction, "placement");
+  ASSERT_NE(fn, nullptr);
+
+  // Every kernel is cheap enough to run inline, and none is expensive enough
+  // to be enqueued.
+  BEFExecutorOptions options = AdaptivePlacementOptions();
+  options.max_inline_kernel_ns = 1e9;
+  options.min_outline_kernel_ns = 1e9;
+  auto exec_ctx = CreateExecutionContext(options);
+
+  for (int i = 0; i < 3; ++i) {
+    auto result = Run(fn, exec_ctx);
+    ASSERT_FALSE(result->IsError()) << result->GetError();
+  }
+
+  // The function runs on the thread that executes it, including %z of another
+  // stream.
+  for (int slot = 0; slot < kNumSlots; ++slot)
+    EXPECT_EQ(GetThread(slot), std::this_thread::get_id()) << slot;
+}
+
+TEST_F(BEFExecutorTest, ExpensiveKernelOfSameStreamIsOutlined) {
+  const Function* fn = Load(kPlacementFunction, "placement");
+  ASSERT_NE(fn, nullptr);
+
+  // Every kernel is cheap enough to run inline from another stream, and
+  // expensive enough to be enqueued from its own stream.
+  BEFExecutorOptions options = AdaptivePlacementOptions();
+  options.max_inline_kernel_ns = 1e9;
+  options.min_outline_kernel_ns = 1;
+  auto exec_ctx = CreateExecutionContext(options);
+
+  for (int i = 0; i < 3; ++i) {
+    auto result = Run(fn, exec_ctx);
+    ASSERT_FALSE(result->IsError()) << result->GetError();
+  }
+
+  // %x runs on the thread that executes the function, as no other kernel is
+  // ready then, and so does %z of another stream. %y of the same stream is
+  // enqueued to a worker thread, as %z is left to run inline.
+  EXPECT_EQ(GetThread(0), std::this_thread::get_id());
+  EXPECT_NE(GetThread(1), std::this_thread::get_id());
+  EXPECT_EQ(GetThread(2), std::this_thread::get_id());
+}
+
+}  // namespace
+}  // namespace tfrt
@@ -0,0 +1,148 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Unit test for BEFFileSlot.
+
+#include "tfrt/bef_executor/bef_file_slot.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/support/error_util.h"
+
+namespace tfrt {
+namespace {
+
+std::atomic<int> num_live_files{0};
+
+// A BEFFile stand-in that knows its version and counts the live instances.
+class FakeBEFFile : public BEFFile {
+ public:
+  explicit FakeBEFFile(int version) : BEFFile(nullptr), version_(version) {
+    ++num_live_files;
+  }
+  ~FakeBEFFile() override {
+    version_ = -1;
+    --num_live_files;
+  }
+
+  int version() const { return version_; }
+
+ private:
+  int version_;
+};
+
+int VersionOf(const RCReference<BEFFile>& bef_file) {
+  return static_cast<const FakeBEFFile*>(bef_file.get())->version();
+}
+
+TEST(BEFFileSlotTest, KeepsPreviousVersionAliveWhileReferenced) {
+  {
+    BEFFileSlot slot;
+    EXPECT_EQ(slot.Get(), nullptr);
+    EXPECT_EQ(slot.version(), 0);
+
+    slot.Publish(MakeRef<FakeBEFFile>(1));
+    RCReference<BEFFile> in_flight = slot.Get();
+    EXPECT_EQ(VersionOf(in_flight), 1);
+
+    RCReference<BEFFile> previous = slot.Publish(MakeRef<FakeBEFFile>(2));
+    EXPECT_EQ(previous, in_flight);
+    previous.reset();
+    EXPECT_EQ(slot.version(), 2);
+    EXPECT_EQ(VersionOf(slot.Get()), 2);
+
+    // The in-flight request still runs the first version.
+    EXPECT_EQ(VersionOf(in_flight), 1);
+    EXPECT_EQ(num_live_files, 2);
+    in_flight.reset();
+    EXPECT_EQ(num_live_files, 1);
+  }
+  EXPECT_EQ(num_live_files, 0);
+}
+
+TEST(BEFFileSlotTest, ReadersSeeIncreasingVersions) {
+  constexpr int kNumReaders = 4;
+  constexpr int kNumVersions = 1000;
+  {
+    BEFFileSlot slot(MakeRef<FakeBEFFile>(0));
+    std::atomic<bool> done{false};
+
+    std::vector<std::thread> readers;
+    for (int i = 0; i < kNumReaders; ++i) {
+      readers.emplace_back([&] {
+        int last_version = 0;
+        while (!done.load()) {
+          RCReference<BEFFile> bef_file = slot.Get();
+          int version = VersionOf(bef_file);
+          EXPECT_GE(version, last_version);
+          last_version = version;
+        }
+      });
+    }
+
+    for (int version = 1; version <= kNumVersions; ++version)
+      slot.Publish(MakeRef<FakeBEFFile>(version));
+    done = true;
+    for (auto& reader : readers) reader.join();
+
+    EXPECT_EQ(VersionOf(slot.Get()), kNumVersions);
+    EXPECT_EQ(num_live_files, 1);
+  }
+  EXPECT_EQ(num_live_files, 0);
+}
+
+TEST(BEFFileSlotTest, ReloadPublishesWarmedUpVersion) {
+  HostContext host([](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+                   CreateMultiThreadedWorkQueue(2, 2));
+  BEFFileSlot slot(MakeRef<FakeBEFFile>(1));
+
+  bool warmed_up = false;
+  auto done = slot.Reload(
+      &host, [] { return RCReference<BEFFile>(MakeRef<FakeBEFFile>(2)); },
+      [&](const BEFFile& bef_file) {
+        warmed_up = true;
+        return llvm::Error::success();
+      });
+  host.Await(done.CopyRCRef());
+  ASSERT_FALSE(done.IsError()) << done.GetError();
+  EXPECT_TRUE(warmed_up);
+  EXPECT_EQ(VersionOf(slot.Get()), 2);
+
+  // A failed warm up keeps the current version.
+  done = slot.Reload(
+      &host, [] { return RCReference<BEFFile>(MakeRef<FakeBEFFile>(3)); },
+      [](const BEFFile& bef_file) { return MakeStringError("cold"); });
+  host.Await(done.CopyRCRef());
+  EXPECT_TRUE(done.IsError());
+  EXPECT_EQ(VersionOf(slot.Get()), 2);
+
+  // So does a failed open.
+  done = slot.Reload(&host, [] { return RCReference<BEFFile>(); });
+  host.Await(done.CopyRCRef());
+  EXPECT_TRUE(done.IsError());
+  EXPECT_EQ(VersionOf(slot.Get()), 2);
+  EXPECT_EQ(slot.version(), 2);
+}
+
+}  // namespace
+}  // namespace tfrt
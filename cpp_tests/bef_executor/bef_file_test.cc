@@ -0,0 +1,396 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Unit test for opening BEF files.
+
+#include "tfrt/bef_executor/bef_file.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/Parser/Parser.h"
+#include "tfrt/basic_kernels/opdefs/tfrt_base.h"
+#include "tfrt/bef/bef_buffer.h"
+#include "tfrt/bef/bef_encoding.h"
+#include "tfrt/bef/bef_reader.h"
+#include "tfrt/bef_converter/mlir_to_bef.h"
+#include "tfrt/bef_executor/bef_interpreter.h"
+#include "tfrt/host_context/async_value.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/function.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/host_context/kernel_registry.h"
+#include "tfrt/host_context/sync_kernel_frame.h"
+#include "tfrt/host_context/value.h"
+#include "tfrt/io/file_system.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/string_util.h"
+
+namespace tfrt {
+namespace {
+
+constexpr char kAsyncFunction[] = R"mlir(
+func.func @async() -> i32 {
+  %x = tfrt.constant.i32 1
+  tfrt.return %x : i32
+}
+)mlir";
+
+constexpr char kSyncFunction[] = R"mlir(
+func.func @sync() attributes {tfrt.sync} {
+  tfrt.return
+}
+)mlir";
+
+// A sync function with registers of two types: %a and %c are i32, and %b is
+// i64.
+constexpr char kTypedSyncFunction[] = R"mlir(
+func.func @typed_sync(%a: i32, %b: i64) -> i32 attributes {tfrt.sync} {
+  %c = "bef_file_test.sync_copy.i32"(%a) : (i32) -> i32
+  tfrt.return %c : i32
+}
+)mlir";
+
+void SyncCopyI32(SyncKernelFrame* frame) {
+  frame->EmplaceResultAt<int32_t>(0, frame->GetArgAt<int32_t>(0));
+}
+
+// The number of memory regions of CountingFileSystem that are alive.
+std::atomic<int> num_live_regions{0};
+
+class CountingRegion : public io::ReadOnlyMemoryRegion {
+ public:
+  explicit CountingRegion(std::unique_ptr<io::ReadOnlyMemoryRegion> region)
+      : region_(std::move(region)) {
+    num_live_regions.fetch_add(1);
+  }
+  ~CountingRegion() override { num_live_regions.fetch_sub(1); }
+
+  const void* data() const override { return region_->data(); }
+  size_t length() const override { return region_->length(); }
+
+ private:
+  std::unique_ptr<io::ReadOnlyMemoryRegion> region_;
+};
+
+// Maps the files of the default file system, and counts the live mappings.
+class CountingFileSystem : public io::FileSystem {
+ public:
+  static constexpr char kScheme[] = "bef_file_test";
+
+  llvm::Error NewRandomAccessFile(
+      const std::string& path,
+      std::unique_ptr<io::RandomAccessFile>* file) override {
+    file->reset();
+    return MakeStringError("random access is not supported for file ", path);
+  }
+
+  llvm::Error NewReadOnlyMemoryRegion(
+      const std::string& path,
+      std::unique_ptr<io::ReadOnlyMemoryRegion>* region) override {
+    std::string disk_path = path.substr(path.find("://") + 3);
+    std::unique_ptr<io::ReadOnlyMemoryRegion> disk_region;
+    if (auto error = io::FileSystemRegistry::Default()
+                         ->LookupForPath(disk_path)
+                         ->NewReadOnlyMemoryRegion(disk_path, &disk_region)) {
+      region->reset();
+      return error;
+    }
+    *region = std::make_unique<CountingRegion>(std::move(disk_region));
+    return llvm::Error::success();
+  }
+};
+
+class BEFFileTest : public ::testing::Test {
+ protected:
+  BEFFileTest()
+      : host_(
+            [this](const DecodedDiagnostic& diagnostic) {
+              mutex_lock lock(mu_);
+              errors_.emplace_back(diagnostic.message());
+            },
+            CreateMallocAllocator(), CreateMultiThreadedWorkQueue(2, 2)) {
+    RegisterStaticKernels(host_.GetMutableRegistry());
+    host_.GetMutableRegistry()->AddSyncKernel("bef_file_test.sync_copy.i32",
+                                              SyncCopyI32);
+  }
+
+  BefBuffer ConvertToBEF(const char* source,
+                         bool disable_optional_sections = true) {
+    mlir::MLIRContext context;
+    context.allowUnregisteredDialects();
+    mlir::DialectRegistry registry;
+    registry.insert<compiler::TFRTDialect, mlir::func::FuncDialect>();
+    context.appendDialectRegistry(registry);
+    mlir::OwningOpRef<mlir::ModuleOp> module =
+        mlir::parseSourceString<mlir::ModuleOp>(source, &context);
+    EXPECT_TRUE(module);
+    return ConvertMLIRToBEF(module.get(), disable_optional_sections);
+  }
+
+  // Returns the data of the section `id` of `bef`, or an empty array if there
+  // is no such section.
+  static llvm::MutableArrayRef<uint8_t> FindSection(BefBuffer& bef,
+                                                    BEFSectionID id) {
+    BEFReader reader(bef);
+    // Skip the magic number and the format version.
+    reader.SkipOffset(3);
+    while (!reader.Empty()) {
+      uint8_t section_id;
+      ArrayRef<uint8_t> data;
+      if (!reader.ReadSection(&section_id, &data)) break;
+      if (section_id == static_cast<uint8_t>(id))
+        return {bef.data() + (data.data() - bef.data()), data.size()};
+    }
+    return {};
+  }
+
+  // Overwrites the Functions section of `bef`, so that no function can be
+  // decoded from it while the function index stays valid.
+  static void CorruptFunctions(BefBuffer& bef) {
+    auto functions = FindSection(bef, BEFSectionID::kFunctions);
+    ASSERT_FALSE(functions.empty());
+    std::fill(functions.begin(), functions.end(), 0xFF);
+  }
+
+  ExecutionContext CreateExecutionContext() {
+    auto request_ctx =
+        RequestContextBuilder(&host_, /*resource_context=*/nullptr).build();
+    EXPECT_FALSE(!request_ctx);
+    return ExecutionContext(std::move(*request_ctx));
+  }
+
+  // Writes `bef` to a new file in `directory_`, and returns its path.
+  std::string WriteFile(const BefBuffer& bef) {
+    llvm::SmallString<128> path(directory_);
+    llvm::sys::path::append(path, "test.bef");
+    std::error_code error;
+    llvm::raw_fd_ostream os(path, error);
+    EXPECT_FALSE(error) << error.message();
+    os.write(reinterpret_cast<const char*>(bef.data()), bef.size());
+    return std::string(path);
+  }
+
+  void SetUp() override {
+    ASSERT_FALSE(
+        llvm::sys::fs::createUniqueDirectory("bef_file_test", directory_));
+    io::FileSystemRegistry::Default()->Register(
+        CountingFileSystem::kScheme, std::make_unique<CountingFileSystem>());
+  }
+
+  void TearDown() override { llvm::sys::fs::remove_directories(directory_); }
+
+  // Runs the function "typed_sync" of kTypedSyncFunction in `bef`, and returns
+  // its result or its error.
+  Expected<int32_t> RunTypedSync(const BefBuffer& bef) {
+    auto bef_file = BEFFile::Open(bef, host_.GetKernelRegistry(),
+                                  host_.diag_handler(), host_.allocator());
+    if (!bef_file) return MakeStringError("failed to open BEF file");
+    const Function* fn = bef_file->GetFunction("typed_sync");
+    if (fn == nullptr) return MakeStringError("missing function");
+
+    Value a(int32_t{1});
+    Value b(int64_t{2});
+    Value c;
+    Value* arguments[] = {&a, &b};
+    Value* results[] = {&c};
+    BEFInterpreter interpreter(*fn);
+    if (auto error =
+            interpreter.Execute(CreateExecutionContext(), arguments, results))
+      return std::move(error);
+    return c.get<int32_t>();
+  }
+
+  std::vector<std::string> errors() {
+    mutex_lock lock(mu_);
+    return errors_;
+  }
+
+  mutex mu_;
+  std::vector<std::string> errors_;
+  HostContext host_;
+  llvm::SmallString<128> directory_;
+};
+
+TEST_F(BEFFileTest, RegisterTypesAreChecked) {
+  BefBuffer bef =
+      ConvertToBEF(kTypedSyncFunction, /*disable_optional_sections=*/false);
+  ASSERT_FALSE(FindSection(bef, BEFSectionID::kRegisterTypes).empty());
+
+  auto result = RunTypedSync(bef);
+  ASSERT_TRUE(static_cast<bool>(result)) << toString(result.takeError());
+  EXPECT_EQ(*result, 1);
+  EXPECT_TRUE(errors().empty());
+}
+
+TEST_F(BEFFileTest, MalformedRegisterTypesAreIgnored) {
+  BefBuffer bef =
+      ConvertToBEF(kTypedSyncFunction, /*disable_optional_sections=*/false);
+  auto register_types = FindSection(bef, BEFSectionID::kRegisterTypes);
+  ASSERT_FALSE(register_types.empty());
+  std::fill(register_types.begin(), register_types.end(), 0xFF);
+
+  // The section is optional, so the function still runs, without checking the
+  // types of its registers.
+  auto result = RunTypedSync(bef);
+  ASSERT_TRUE(static_cast<bool>(result)) << toString(result.takeError());
+  EXPECT_EQ(*result, 1);
+
+  auto errors = this->errors();
+  ASSERT_EQ(errors.size(), 1u);
+  EXPECT_NE(errors[0].find("invalid RegisterTypes section"), std::string::npos)
+      << errors[0];
+}
+
+TEST_F(BEFFileTest, RegisterTypeMismatchFailsExecution) {
+  BefBuffer bef =
+      ConvertToBEF(kTypedSyncFunction, /*disable_optional_sections=*/false);
+  // The section has the number of tables and the table of the function: the
+  // number of registers, followed by the types of %a, %b and %c. Swapping
+  // the types of %a and %b makes the argument types mismatch.
+  auto register_types = FindSection(bef, BEFSectionID::kRegisterTypes);
+  ASSERT_EQ(register_types.size(), 5u);
+  ASSERT_EQ(register_types[0], 1u);
+  ASSERT_EQ(register_types[1], 3u);
+  ASSERT_NE(register_types[2], register_types[3]);
+  std::swap(register_types[2], register_types[3]);
+
+  auto result = RunTypedSync(bef);
+  ASSERT_FALSE(static_cast<bool>(result));
+  std::string message = toString(result.takeError());
+  EXPECT_NE(message.find("Argument register type mismatch"), std::string::npos)
+      << message;
+
+  // The error is reported once, through the error handler of the file.
+  auto errors = this->errors();
+  ASSERT_EQ(errors.size(), 1u);
+  EXPECT_NE(errors[0].find("Argument register type mismatch"),
+            std::string::npos)
+      << errors[0];
+}
+
+TEST_F(BEFFileTest, MappedFileLivesAsLongAsTheBEFFile) {
+  std::string path = StrCat(CountingFileSystem::kScheme,
+                            "://", WriteFile(ConvertToBEF(kAsyncFunction)));
+  auto bef_file = BEFFile::OpenMapped(path, host_.GetKernelRegistry(),
+                                      host_.diag_handler(), host_.allocator());
+  ASSERT_TRUE(bef_file);
+  EXPECT_EQ(num_live_regions.load(), 1);
+
+  // The function is decoded from the mapping while it is executed.
+  const Function* fn = bef_file->GetFunction("async");
+  ASSERT_NE(fn, nullptr);
+  auto exec_ctx = CreateExecutionContext();
+  RCReference<AsyncValue> results[1];
+  fn->Execute(exec_ctx, {}, results);
+  host_.Await(results);
+  ASSERT_FALSE(results[0]->IsError()) << results[0]->GetError();
+  EXPECT_EQ(results[0]->get<int32_t>(), 1);
+
+  // The mapping is released with the last reference to the BEF file, and not
+  // before.
+  RCReference<BEFFile> other = bef_file;
+  bef_file.reset();
+  EXPECT_EQ(num_live_regions.load(), 1);
+  other.reset();
+  EXPECT_EQ(num_live_regions.load(), 0);
+  EXPECT_TRUE(errors().empty());
+}
+
+TEST_F(BEFFileTest, OpenMappedReportsMissingFile) {
+  llvm::SmallString<128> path(directory_);
+  llvm::sys::path::append(path, "missing.bef");
+  auto bef_file = BEFFile::OpenMapped(
+      StrCat(CountingFileSystem::kScheme, "://", path.str()),
+      host_.GetKernelRegistry(), host_.diag_handler(), host_.allocator());
+  EXPECT_FALSE(bef_file);
+  EXPECT_EQ(errors().size(), 1u);
+  EXPECT_EQ(num_live_regions.load(), 0);
+}
+
+TEST_F(BEFFileTest, MalformedFunctionFailsOnFirstExecution) {
+  BefBuffer bef = ConvertToBEF(kAsyncFunction);
+  CorruptFunctions(bef);
+  auto bef_file = BEFFile::Open(bef, host_.GetKernelRegistry(),
+                                host_.diag_handler(), host_.allocator());
+  ASSERT_TRUE(bef_file);
+  EXPECT_TRUE(errors().empty());
+
+  const Function* fn = bef_file->GetFunction("async");
+  ASSERT_NE(fn, nullptr);
+  auto exec_ctx = CreateExecutionContext();
+  for (int i = 0; i < 2; ++i) {
+    RCReference<AsyncValue> results[1];
+    fn->Execute(exec_ctx, {}, results);
+    host_.Await(results);
+    EXPECT_TRUE(results[0]->IsError());
+  }
+
+  // The format error is reported once, through the error handler of the file.
+  EXPECT_EQ(errors().size(), 1u);
+}
+
+TEST_F(BEFFileTest, MalformedSyncFunctionFailsOnFirstExecution) {
+  BefBuffer bef = ConvertToBEF(kSyncFunction);
+  CorruptFunctions(bef);
+  auto bef_file = BEFFile::Open(bef, host_.GetKernelRegistry(),
+                                host_.diag_handler(), host_.allocator());
+  ASSERT_TRUE(bef_file);
+  EXPECT_TRUE(errors().empty());
+
+  const Function* fn = bef_file->GetFunction("sync");
+  ASSERT_NE(fn, nullptr);
+  auto exec_ctx = CreateExecutionContext();
+  for (int i = 0; i < 2; ++i) {
+    BEFInterpreter interpreter(*fn);
+    auto error = interpreter.Execute(exec_ctx, {}, {});
+    EXPECT_TRUE(static_cast<bool>(error));
+    llvm::consumeError(std::move(error));
+  }
+
+  // The format error is reported once, through the error handler of the file.
+  EXPECT_EQ(errors().size(), 1u);
+}
+
+TEST_F(BEFFileTest, OpenParallelRejectsMalformedSyncFunction) {
+  BefBuffer bef = ConvertToBEF(kSyncFunction);
+  CorruptFunctions(bef);
+  auto bef_file = BEFFile::OpenParallel(bef, host_.GetKernelRegistry(),
+                                        host_.diag_handler(), &host_);
+  EXPECT_FALSE(bef_file);
+  EXPECT_EQ(errors().size(), 1u);
+}
+
+}  // namespace
+}  // namespace tfrt
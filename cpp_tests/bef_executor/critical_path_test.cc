@@ -0,0 +1,140 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Unit test for CriticalPathRecorder and the critical path analysis.
+
+#include "tfrt/bef_executor/critical_path.h"
+
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace tfrt {
+namespace {
+
+KernelTrace MakeKernel(std::string name, int stream_id, int unblocked_by,
+                       int64_t ready_ns, int64_t start_ns, int64_t end_ns,
+                       int64_t done_ns, std::vector<unsigned> users) {
+  KernelTrace kernel;
+  kernel.name = std::move(name);
+  kernel.stream_id = stream_id;
+  kernel.unblocked_by = unblocked_by;
+  kernel.ready_ns = ready_ns;
+  kernel.start_ns = start_ns;
+  kernel.end_ns = end_ns;
+  kernel.done_ns = done_ns;
+  kernel.users = std::move(users);
+  return kernel;
+}
+
+// Two kernels in different streams feed an asynchronous kernel, which is made
+// ready by the slower of the two.
+ExecutionTrace MakeDiamondTrace() {
+  ExecutionTrace trace;
+  trace.function_name = "diamond";
+  trace.kernels.push_back(MakeKernel("<arguments>", 0, -1, 0, 0, 0, 0, {1, 2}));
+  trace.kernels.push_back(MakeKernel("slow", 0, 0, 0, 0, 100, 100, {3}));
+  trace.kernels.push_back(MakeKernel("fast", 1, 0, 0, 10, 40, 40, {3}));
+  trace.kernels.push_back(MakeKernel("async", 0, 1, 100, 100, 150, 200, {}));
+  return trace;
+}
+
+TEST(CriticalPathTest, FollowsTheLastProducers) {
+  CriticalPath path = AnalyzeCriticalPath(MakeDiamondTrace());
+
+  EXPECT_EQ(path.latency_ns, 200);
+  EXPECT_THAT(path.kernels, ::testing::ElementsAre(1, 3));
+  EXPECT_THAT(path.slack_ns, ::testing::ElementsAre(0, 0, 60, 0));
+
+  ASSERT_EQ(path.streams.size(), 2);
+  EXPECT_EQ(path.streams[0].stream_id, 0);
+  EXPECT_EQ(path.streams[0].num_kernels, 2);
+  EXPECT_EQ(path.streams[0].num_critical_kernels, 2);
+  EXPECT_EQ(path.streams[0].busy_ns, 150);
+  EXPECT_EQ(path.streams[0].min_slack_ns, 0);
+  EXPECT_EQ(path.streams[1].stream_id, 1);
+  EXPECT_EQ(path.streams[1].num_kernels, 1);
+  EXPECT_EQ(path.streams[1].num_critical_kernels, 0);
+  EXPECT_EQ(path.streams[1].busy_ns, 30);
+  EXPECT_EQ(path.streams[1].queued_ns, 10);
+  EXPECT_EQ(path.streams[1].min_slack_ns, 60);
+  EXPECT_EQ(path.streams[1].mean_slack_ns, 60);
+
+  std::string output;
+  llvm::raw_string_ostream os(output);
+  PrintCriticalPath(MakeDiamondTrace(), path, os);
+  os.flush();
+  EXPECT_NE(output.find("function diamond: 0.200 us, 3 kernels, 2 on the "
+                        "critical path\n"),
+            std::string::npos);
+}
+
+TEST(CriticalPathTest, IgnoresKernelsThatDidNotRun) {
+  ExecutionTrace trace = MakeDiamondTrace();
+  trace.kernels.push_back(MakeKernel("skipped", 2, -1, -1, -1, -1, -1, {}));
+  trace.kernels[3].users.push_back(4);
+
+  CriticalPath path = AnalyzeCriticalPath(trace);
+  EXPECT_EQ(path.latency_ns, 200);
+  EXPECT_EQ(path.slack_ns[3], 0);
+  EXPECT_EQ(path.slack_ns[4], -1);
+  EXPECT_EQ(path.streams.size(), 2);
+}
+
+TEST(CriticalPathTest, PrintedTracesParseBack) {
+  CriticalPathRecorder recorder;
+  recorder.Record(MakeDiamondTrace());
+  recorder.Record(MakeDiamondTrace());
+
+  std::string output;
+  llvm::raw_string_ostream os(output);
+  recorder.Print(os);
+  os.flush();
+
+  auto traces = ParseExecutionTraces(output);
+  ASSERT_TRUE(!!traces) << llvm::toString(traces.takeError());
+  ASSERT_EQ(traces->size(), 2);
+  const ExecutionTrace& trace = (*traces)[1];
+  EXPECT_EQ(trace.function_name, "diamond");
+  ASSERT_EQ(trace.kernels.size(), 4);
+  EXPECT_EQ(trace.kernels[0].unblocked_by, -1);
+  EXPECT_THAT(trace.kernels[0].users, ::testing::ElementsAre(1, 2));
+  EXPECT_EQ(trace.kernels[3].name, "async");
+  EXPECT_EQ(trace.kernels[3].unblocked_by, 1);
+  EXPECT_EQ(trace.kernels[3].ready_ns, 100);
+  EXPECT_EQ(trace.kernels[3].done_ns, 200);
+  EXPECT_TRUE(trace.kernels[3].users.empty());
+}
+
+bool Parses(string_view text) {
+  auto traces = ParseExecutionTraces(text);
+  if (traces) return true;
+  llvm::consumeError(traces.takeError());
+  return false;
+}
+
+TEST(CriticalPathTest, RejectsMalformedTraces) {
+  EXPECT_TRUE(Parses("# comment\nfunction f\n0 0 -1 0 0 0 0 k 1\n"));
+  EXPECT_FALSE(Parses("0 0 -1 0 0 0 0 <arguments>\n"));
+  EXPECT_FALSE(Parses("function f\n0 0 -1 0 0 0\n"));
+  EXPECT_FALSE(Parses("function f\n1 0 -1 0 0 0 0 k\n"));
+  EXPECT_FALSE(Parses("function f\n0 0 -1 0 0 0 0 k x\n"));
+}
+
+}  // namespace
+}  // namespace tfrt
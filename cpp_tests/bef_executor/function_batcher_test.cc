@@ -0,0 +1,219 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Unit test for FunctionBatcher.
+
+#include "tfrt/bef_executor/function_batcher.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "llvm/ADT/SmallVector.h"
+#include "tfrt/host_context/async_dispatch.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/host_context/native_function.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+
+namespace tfrt {
+namespace {
+
+std::atomic<int> num_executions{0};
+
+// Adds one to every element of an int32 tensor.
+void AddOne(AsyncValue* const* arguments, int num_arguments,
+            RCReference<AsyncValue>* results, int num_results,
+            HostContext* host) {
+  ++num_executions;
+  const auto& input = arguments[0]->get<DenseHostTensor>();
+  auto output = DenseHostTensor::CreateUninitialized(input.metadata(), host);
+  DHTArrayView<int32_t> input_view(&input);
+  MutableDHTArrayView<int32_t> output_view(&*output);
+  for (size_t i = 0; i < input_view.NumElements(); ++i)
+    output_view[i] = input_view[i] + 1;
+  results[0] =
+      MakeAvailableAsyncValueRef<DenseHostTensor>(std::move(*output))
+          .ReleaseRCRef();
+}
+
+class FunctionBatcherTest : public ::testing::Test {
+ protected:
+  FunctionBatcherTest()
+      : host_(std::make_unique<HostContext>(
+            [](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+            CreateMultiThreadedWorkQueue(2, 2))),
+        tensor_type_(host_->GetKernelRegistry().GetType("!t.tensor")),
+        function_("add_one", {tensor_type_}, {tensor_type_}, AddOne) {
+    num_executions = 0;
+  }
+
+  ExecutionContext CreateExecutionContext() {
+    return CreateExecutionContext(&resource_context_);
+  }
+
+  ExecutionContext CreateExecutionContext(ResourceContext* resource_context) {
+    auto request_ctx =
+        RequestContextBuilder(host_.get(), resource_context).build();
+    EXPECT_FALSE(!request_ctx);
+    return ExecutionContext(std::move(*request_ctx));
+  }
+
+  // Returns an int32 tensor of `rows` x `cols` elements counting up from
+  // `start`.
+  RCReference<AsyncValue> MakeTensor(int rows, int cols, int32_t start) {
+    auto tensor = DenseHostTensor::CreateUninitialized<int32_t>(
+        TensorShape({rows, cols}), host_.get());
+    MutableDHTArrayView<int32_t> view(&*tensor);
+    for (size_t i = 0; i < view.NumElements(); ++i) view[i] = start + i;
+    return MakeAvailableAsyncValueRef<DenseHostTensor>(std::move(*tensor))
+        .ReleaseRCRef();
+  }
+
+  // Calls the function through `batcher`, and returns its result.
+  RCReference<AsyncValue> Call(FunctionBatcher& batcher,
+                               const ExecutionContext& exec_ctx,
+                               RCReference<AsyncValue> argument) {
+    AsyncValue* arguments[] = {argument.get()};
+    RCReference<AsyncValue> results[1];
+    batcher.Execute(exec_ctx, arguments, results);
+    return std::move(results[0]);
+  }
+
+  std::vector<int32_t> GetValues(const RCReference<AsyncValue>& result) {
+    DHTArrayView<int32_t> view(&result->get<DenseHostTensor>());
+    return std::vector<int32_t>(view.Elements().begin(),
+                                view.Elements().end());
+  }
+
+  std::unique_ptr<HostContext> host_;
+  ResourceContext resource_context_;
+  TypeName tensor_type_;
+  NativeFunction function_;
+};
+
+TEST_F(FunctionBatcherTest, RunsFullBatchOnce) {
+  FunctionBatcherOptions options;
+  options.max_batch_size = 2;
+  options.batch_timeout = std::chrono::seconds(60);
+  FunctionBatcher batcher(&function_, options);
+  auto exec_ctx = CreateExecutionContext();
+
+  llvm::SmallVector<RCReference<AsyncValue>, 2> results;
+  results.push_back(Call(batcher, exec_ctx, MakeTensor(1, 2, 0)));
+  results.push_back(Call(batcher, exec_ctx, MakeTensor(2, 2, 10)));
+  host_->Await(results);
+
+  EXPECT_EQ(num_executions, 1);
+  EXPECT_EQ(results[0]->get<DenseHostTensor>().shape(), TensorShape({1, 2}));
+  EXPECT_EQ(results[1]->get<DenseHostTensor>().shape(), TensorShape({2, 2}));
+  EXPECT_EQ(GetValues(results[0]), std::vector<int32_t>({1, 2}));
+  EXPECT_EQ(GetValues(results[1]), std::vector<int32_t>({11, 12, 13, 14}));
+}
+
+TEST_F(FunctionBatcherTest, RunsPartialBatchAfterTimeout) {
+  FunctionBatcherOptions options;
+  options.max_batch_size = 8;
+  options.batch_timeout = std::chrono::milliseconds(1);
+  FunctionBatcher batcher(&function_, options);
+  auto exec_ctx = CreateExecutionContext();
+
+  auto result = Call(batcher, exec_ctx, MakeTensor(1, 2, 0));
+  host_->Await(result);
+
+  EXPECT_EQ(num_executions, 1);
+  EXPECT_EQ(GetValues(result), std::vector<int32_t>({1, 2}));
+}
+
+TEST_F(FunctionBatcherTest, RunsMismatchedCallsOnTheirOwn) {
+  FunctionBatcherOptions options;
+  options.max_batch_size = 2;
+  options.batch_timeout = std::chrono::seconds(60);
+  FunctionBatcher batcher(&function_, options);
+  auto exec_ctx = CreateExecutionContext();
+
+  llvm::SmallVector<RCReference<AsyncValue>, 2> results;
+  results.push_back(Call(batcher, exec_ctx, MakeTensor(1, 2, 0)));
+  results.push_back(Call(batcher, exec_ctx, MakeTensor(1, 3, 10)));
+  host_->Await(results);
+
+  EXPECT_EQ(num_executions, 2);
+  EXPECT_EQ(GetValues(results[0]), std::vector<int32_t>({1, 2}));
+  EXPECT_EQ(GetValues(results[1]), std::vector<int32_t>({11, 12, 13}));
+}
+
+TEST_F(FunctionBatcherTest, CancelsCallsOnTheirOwn) {
+  FunctionBatcherOptions options;
+  options.max_batch_size = 2;
+  options.batch_timeout = std::chrono::seconds(60);
+  FunctionBatcher batcher(&function_, options);
+  auto cancelled_ctx = CreateExecutionContext();
+  auto exec_ctx = CreateExecutionContext();
+
+  auto unavailable = MakeUnconstructedAsyncValueRef<DenseHostTensor>();
+  llvm::SmallVector<RCReference<AsyncValue>, 2> results;
+  results.push_back(Call(batcher, cancelled_ctx, unavailable.CopyRCRef()));
+  results.push_back(Call(batcher, exec_ctx, MakeTensor(1, 2, 10)));
+  cancelled_ctx.request_ctx()->Cancel();
+  unavailable.emplace(MakeTensor(1, 2, 0)->get<DenseHostTensor>().CopyRef());
+  host_->Await(results);
+
+  EXPECT_TRUE(results[0]->IsError());
+  EXPECT_EQ(GetValues(results[1]), std::vector<int32_t>({11, 12}));
+}
+
+TEST_F(FunctionBatcherTest, BatchesCallsOfTheSameResourceContext) {
+  FunctionBatcherOptions options;
+  options.max_batch_size = 2;
+  options.batch_timeout = std::chrono::seconds(60);
+  FunctionBatcher batcher(&function_, options);
+  ResourceContext other_resource_context;
+  auto exec_ctx = CreateExecutionContext();
+  auto other_exec_ctx = CreateExecutionContext(&other_resource_context);
+
+  llvm::SmallVector<RCReference<AsyncValue>, 2> results;
+  results.push_back(Call(batcher, exec_ctx, MakeTensor(1, 2, 0)));
+  results.push_back(Call(batcher, other_exec_ctx, MakeTensor(1, 2, 10)));
+  host_->Await(results);
+
+  EXPECT_EQ(num_executions, 2);
+  EXPECT_EQ(GetValues(results[0]), std::vector<int32_t>({1, 2}));
+  EXPECT_EQ(GetValues(results[1]), std::vector<int32_t>({11, 12}));
+}
+
+TEST_F(FunctionBatcherTest, FlushesOnDestruction) {
+  FunctionBatcherOptions options;
+  options.batch_timeout = std::chrono::seconds(60);
+  auto batcher = std::make_unique<FunctionBatcher>(&function_, options);
+  auto exec_ctx = CreateExecutionContext();
+
+  auto result = Call(*batcher, exec_ctx, MakeTensor(1, 2, 0));
+  batcher.reset();
+  host_->Await(result);
+
+  EXPECT_EQ(GetValues(result), std::vector<int32_t>({1, 2}));
+}
+
+}  // namespace
+}  // namespace tfrt
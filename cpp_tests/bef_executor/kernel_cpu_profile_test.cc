@@ -0,0 +1,60 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Unit test for KernelCpuProfile.
+
+#include "tfrt/bef_executor/kernel_cpu_profile.h"
+
+#include <chrono>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace tfrt {
+namespace {
+
+using std::chrono::nanoseconds;
+
+TEST(KernelCpuProfileTest, AggregatesPerFunctionAndKernel) {
+  KernelCpuProfile profile;
+  profile.Record("main", "tfrt.add.i32", nanoseconds(10), nanoseconds(20));
+  profile.Record("main", "tfrt.add.i32", nanoseconds(5), nanoseconds(100));
+  profile.Record("main", "tfrt.mul.i32", nanoseconds(1), nanoseconds(1));
+  profile.Record("other", "tfrt.add.i32", nanoseconds(2), nanoseconds(3));
+  profile.Record("", "tfrt.add.i32", nanoseconds(4), nanoseconds(4));
+
+  auto entries = profile.GetEntries();
+  ASSERT_EQ(entries.size(), 3);
+  ASSERT_EQ(entries["main"].size(), 2);
+  const KernelCpuProfile::Entry& add = entries["main"]["tfrt.add.i32"];
+  EXPECT_EQ(add.count, 2);
+  EXPECT_EQ(add.cpu_ns, 15);
+  EXPECT_EQ(add.wall_ns, 120);
+  EXPECT_EQ(entries["other"]["tfrt.add.i32"].count, 1);
+  EXPECT_EQ(entries[KernelCpuProfile::kAnonymousFunction]["tfrt.add.i32"]
+                .cpu_ns,
+            4);
+
+  std::string output;
+  llvm::raw_string_ostream os(output);
+  profile.Print(os);
+  os.flush();
+  EXPECT_NE(output.find("2 15 120 main tfrt.add.i32\n1 1 1 main tfrt.mul.i32\n"
+                        "1 2 3 other tfrt.add.i32\n"),
+            std::string::npos);
+}
+
+}  // namespace
+}  // namespace tfrt
@@ -0,0 +1,202 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Microbenchmarks for the kernel dispatch cost of BEFExecutor. The kernels of
+// the synthetic functions do next to no work, so the reported time per kernel
+// is the cost of scheduling a kernel, building its frame and creating its
+// results.
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "llvm/Support/raw_ostream.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/Parser/Parser.h"
+#include "tfrt/basic_kernels/opdefs/tfrt_base.h"
+#include "tfrt/bef_converter/mlir_to_bef.h"
+#include "tfrt/bef_executor/bef_executor_options.h"
+#include "tfrt/bef_executor/bef_file.h"
+#include "tfrt/host_context/async_value.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/function.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/host_context/kernel_registry.h"
+#include "tfrt/support/logging.h"
+#include "tfrt/test_kernels/opdefs/test_kernels.h"
+
+namespace tfrt {
+namespace {
+
+struct SyntheticFunctionSpec {
+  // Number of layers of kernels.
+  int depth;
+  // Number of kernels per layer.
+  int width;
+  // Number of operands of each kernel, taken from adjacent kernels of the
+  // previous layer. Every result is used by as many kernels of the next layer.
+  int fan_in;
+  // Whether the kernels complete asynchronously. tfrt_test.async_add.i32 takes
+  // two operands, so asynchronous kernels always have a fan in of two.
+  bool async;
+  // Whether the kernels are outlined to the work queue. Otherwise the cost
+  // threshold keeps every kernel in the stream of the function, and the
+  // kernels run inline.
+  bool outline;
+  // Whether the kernels are placed by their measured cost, see
+  // BEFExecutorOptions::adaptive_placement.
+  bool adaptive;
+
+  int num_kernels() const { return depth * width + 1; }
+};
+
+// Returns a function of `spec.depth` layers of `spec.width` kernels, whose
+// results are summed by one kernel at the end.
+std::string SyntheticFunction(const SyntheticFunctionSpec& spec) {
+  const int fan_in = spec.async ? 2 : spec.fan_in;
+  auto kernel = [&](llvm::raw_ostream& os, int layer, int index) {
+    os << "  %v" << layer << '_' << index << " = \""
+       << (spec.async ? "tfrt_test.async_add.i32" : "tfrt_test.sum")
+       << "\"(";
+    for (int i = 0; i < fan_in; ++i) {
+      os << (i ? ", " : "");
+      if (layer == 0) {
+        os << "%a";
+      } else {
+        os << "%v" << layer - 1 << '_' << (index + i) % spec.width;
+      }
+    }
+    os << ") : (";
+    for (int i = 0; i < fan_in; ++i) os << (i ? ", " : "") << "i32";
+    os << ") -> i32\n";
+  };
+
+  std::string mlir;
+  llvm::raw_string_ostream os(mlir);
+  os << "module attributes {tfrt.cost_threshold = "
+     << (spec.outline ? 1 : 1000000000) << " : i64} {\n"
+     << "func.func @synthetic(%a: i32) -> i32 {\n";
+  for (int layer = 0; layer < spec.depth; ++layer) {
+    for (int index = 0; index < spec.width; ++index) kernel(os, layer, index);
+  }
+  os << "  %result = \"tfrt_test.sum\"(";
+  for (int i = 0; i < spec.width; ++i)
+    os << (i ? ", " : "") << "%v" << spec.depth - 1 << '_' << i;
+  os << ") : (";
+  for (int i = 0; i < spec.width; ++i) os << (i ? ", " : "") << "i32";
+  os << ") -> i32\n  tfrt.return %result : i32\n}\n}\n";
+  return os.str();
+}
+
+class SyntheticFunctionRunner {
+ public:
+  SyntheticFunctionRunner(const SyntheticFunctionSpec& spec, int num_threads)
+      : host_([](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+              CreateMultiThreadedWorkQueue(num_threads, num_threads)) {
+    RegisterStaticKernels(host_.GetMutableRegistry());
+
+    mlir::MLIRContext context;
+    mlir::DialectRegistry registry;
+    registry.insert<compiler::TFRTDialect, mlir::func::FuncDialect,
+                    test::TestDialect>();
+    context.appendDialectRegistry(registry);
+    mlir::OwningOpRef<mlir::ModuleOp> module =
+        mlir::parseSourceString<mlir::ModuleOp>(SyntheticFunction(spec),
+                                                &context);
+    bef_buffer_ =
+        ConvertMLIRToBEF(module.get(), /*disable_optional_sections=*/true);
+    bef_file_ = BEFFile::Open(bef_buffer_, host_.GetKernelRegistry(),
+                              host_.diag_handler(), host_.allocator());
+    func_ = bef_file_->GetFunction("synthetic");
+
+    RequestContextBuilder builder(&host_, /*resource_context=*/nullptr);
+    builder.context_data().emplace<BEFExecutorOptions>().adaptive_placement =
+        spec.adaptive;
+    auto req_ctx = std::move(builder).build();
+    if (!req_ctx) TFRT_LOG(FATAL) << req_ctx.takeError();
+    exec_ctx_ = std::make_unique<ExecutionContext>(std::move(*req_ctx));
+  }
+
+  // Returns false if the function failed.
+  bool Run() {
+    RCReference<AsyncValue> results[1];
+    func_->Execute(*exec_ctx_, {arg_.GetAsyncValue()}, results);
+    host_.Await(results);
+    return !results[0]->IsError();
+  }
+
+ private:
+  HostContext host_;
+  BefBuffer bef_buffer_;
+  RCReference<BEFFile> bef_file_;
+  const Function* func_ = nullptr;
+  std::unique_ptr<ExecutionContext> exec_ctx_;
+  AsyncValueRef<int32_t> arg_ = MakeAvailableAsyncValueRef<int32_t>(1);
+};
+
+// Arguments are the depth, width and fan in of the function, whether its
+// kernels are asynchronous, whether they are outlined, and whether they are
+// placed by their measured cost.
+void BM_KernelDispatch(benchmark::State& state) {
+  SyntheticFunctionSpec spec;
+  spec.depth = state.range(0);
+  spec.width = state.range(1);
+  spec.fan_in = state.range(2);
+  spec.async = state.range(3);
+  spec.outline = state.range(4);
+  spec.adaptive = state.range(5);
+  SyntheticFunctionRunner runner(spec, /*num_threads=*/4);
+
+  for (auto _ : state) {
+    if (!runner.Run()) {
+      state.SkipWithError("the synthetic function failed");
+      break;
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * spec.num_kernels());
+  state.counters["kernel_time"] = benchmark::Counter(
+      spec.num_kernels(), benchmark::Counter::kIsIterationInvariantRate |
+                              benchmark::Counter::kInvert);
+}
+BENCHMARK(BM_KernelDispatch)
+    ->ArgNames({"depth", "width", "fan_in", "async", "outline", "adaptive"})
+    // Chains of sync kernels: the inline path.
+    ->Args({256, 1, 1, 0, 0, 0})
+    ->Args({256, 1, 1, 0, 1, 0})
+    // Wide layers of sync kernels, with increasing fan in and fan out.
+    ->Args({16, 16, 1, 0, 0, 0})
+    ->Args({16, 16, 4, 0, 0, 0})
+    ->Args({16, 16, 16, 0, 0, 0})
+    ->Args({16, 16, 4, 0, 1, 0})
+    // Async kernels, whose results are only available after they return.
+    ->Args({256, 1, 2, 1, 0, 0})
+    ->Args({16, 16, 2, 1, 0, 0})
+    ->Args({16, 16, 2, 1, 1, 0})
+    // Outlined cheap kernels that adaptive placement runs inline.
+    ->Args({256, 1, 1, 0, 1, 1})
+    ->Args({16, 16, 4, 0, 1, 1})
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace tfrt
@@ -0,0 +1,65 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Unit test for KernelSampler.
+
+#include "tfrt/bef_executor/kernel_sampler.h"
+
+#include <string>
+
+#include "gtest/gtest.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace tfrt {
+namespace {
+
+TEST(KernelSamplerTest, SamplesEveryInvocationWithPeriodOne) {
+  KernelSampler sampler(1);
+  for (int i = 0; i < 100; ++i) EXPECT_TRUE(sampler.ShouldSample());
+}
+
+TEST(KernelSamplerTest, SamplesOneInPeriod) {
+  KernelSampler sampler(8);
+  constexpr int kInvocations = 80000;
+  int samples = 0;
+  for (int i = 0; i < kInvocations; ++i) samples += sampler.ShouldSample();
+  EXPECT_GT(samples, kInvocations / 8 * 0.9);
+  EXPECT_LT(samples, kInvocations / 8 * 1.1);
+}
+
+TEST(KernelSamplerTest, AggregatesPerKernel) {
+  KernelSampler sampler(4);
+  const uint64_t start = KernelSampler::ReadCycleCounter();
+  sampler.Record("tfrt.add.i32", 0);
+  sampler.Record("tfrt.add.i32", KernelSampler::ReadCycleCounter() - start);
+  sampler.Record("tfrt.mul.i32", 0);
+
+  auto stats = sampler.GetStats();
+  ASSERT_EQ(stats.size(), 2);
+  EXPECT_EQ(stats["tfrt.add.i32"].num_samples, 2);
+  EXPECT_EQ(stats["tfrt.add.i32"].min_ns, 0);
+  EXPECT_GE(stats["tfrt.add.i32"].max_ns, 0);
+  EXPECT_EQ(stats["tfrt.mul.i32"].num_samples, 1);
+
+  std::string output;
+  llvm::raw_string_ostream os(output);
+  sampler.Print(os);
+  os.flush();
+  EXPECT_NE(output.find("1 4 0 0 0 tfrt.mul.i32\n"), std::string::npos);
+}
+
+}  // namespace
+}  // namespace tfrt
@@ -0,0 +1,167 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// This file has unit tests for the op dispatch caches.
+
+#include "tfrt/core_runtime/dispatch_cache.h"
+
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "tfrt/core_runtime/op_attrs.h"
+#include "tfrt/tensor/tensor_metadata.h"
+
+namespace tfrt {
+namespace internal {
+namespace {
+
+RCReference<AsyncValue> IdentityMetadataFn(
+    const ExecutionContext& exec_ctx, ArrayRef<TensorMetadata> inputs,
+    const OpAttrsRef& attrs, MutableArrayRef<TensorMetadata> results) {
+  results[0] = inputs[0];
+  return {};
+}
+
+TEST(DispatchCacheTest, AttrsKeyIgnoresInsertionOrder) {
+  OpAttrs a;
+  ASSERT_TRUE(a.Set<int64_t>("x", 1));
+  ASSERT_TRUE(a.Set<bool>("y", true));
+  ASSERT_TRUE(a.SetString("z", "foo"));
+
+  OpAttrs b;
+  ASSERT_TRUE(b.SetString("z", "foo"));
+  ASSERT_TRUE(b.Set<bool>("y", true));
+  ASSERT_TRUE(b.Set<int64_t>("x", 1));
+
+  std::string key_a, key_b;
+  ASSERT_TRUE(GetOpAttrsCacheKey(OpAttrsRef(a), &key_a));
+  ASSERT_TRUE(GetOpAttrsCacheKey(b.freeze(), &key_b));
+  EXPECT_EQ(key_a, key_b);
+}
+
+TEST(DispatchCacheTest, AttrsKeyDistinguishesValues) {
+  OpAttrs a;
+  ASSERT_TRUE(a.Set<int64_t>("x", 1));
+  OpAttrs b;
+  ASSERT_TRUE(b.Set<int64_t>("x", 2));
+  OpAttrs c;
+  ASSERT_TRUE(c.Set<int32_t>("x", 1));
+
+  std::string key_a, key_b, key_c;
+  ASSERT_TRUE(GetOpAttrsCacheKey(OpAttrsRef(a), &key_a));
+  ASSERT_TRUE(GetOpAttrsCacheKey(OpAttrsRef(b), &key_b));
+  ASSERT_TRUE(GetOpAttrsCacheKey(OpAttrsRef(c), &key_c));
+  EXPECT_NE(key_a, key_b);
+  EXPECT_NE(key_a, key_c);
+}
+
+TEST(DispatchCacheTest, ResultMetadataLookup) {
+  ResultMetadataCache cache;
+  TensorMetadata md = TensorMetadata::Create<float>(2, 3);
+  TensorMetadata other_md = TensorMetadata::Create<float>(3, 2);
+
+  llvm::SmallVector<TensorMetadata, 4> results;
+  EXPECT_FALSE(
+      cache.Lookup("op", IdentityMetadataFn, "key", {md}, &results));
+
+  cache.Insert("op", IdentityMetadataFn, "key", {md}, {md});
+  ASSERT_TRUE(cache.Lookup("op", IdentityMetadataFn, "key", {md}, &results));
+  ASSERT_EQ(results.size(), 1);
+  EXPECT_EQ(results[0], md);
+
+  EXPECT_FALSE(
+      cache.Lookup("op", IdentityMetadataFn, "key", {other_md}, &results));
+  EXPECT_FALSE(
+      cache.Lookup("op", IdentityMetadataFn, "other", {md}, &results));
+  EXPECT_EQ(cache.hits(), 1);
+  EXPECT_EQ(cache.misses(), 3);
+}
+
+TEST(DispatchCacheTest, ResultMetadataEvictsUnusedEntries) {
+  ResultMetadataCache cache;
+  llvm::SmallVector<TensorMetadata, 4> results;
+  TensorMetadata used_md = TensorMetadata::Create<float>(1);
+  TensorMetadata unused_md = TensorMetadata::Create<float>(2);
+  cache.Insert("used", IdentityMetadataFn, "key", {used_md}, {used_md});
+  cache.Insert("unused", IdentityMetadataFn, "key", {unused_md}, {unused_md});
+
+  // An op with dynamic shapes ends a generation every kMaxEntriesPerOp
+  // shapes, and keeps having its latest shapes cached. The bound is per op
+  // name, also when ops share a metadata function.
+  const size_t num_shapes = 3 * ResultMetadataCache::kMaxEntriesPerOp;
+  for (size_t i = 0; i < num_shapes; ++i) {
+    TensorMetadata md = TensorMetadata::Create<float>(i + 3);
+    cache.Insert("dynamic", IdentityMetadataFn, "key", {md}, {md});
+    EXPECT_TRUE(cache.Lookup("dynamic", IdentityMetadataFn, "key", {md},
+                             &results));
+    // The entries that are used stay cached across the generations.
+    ASSERT_TRUE(cache.Lookup("used", IdentityMetadataFn, "key", {used_md},
+                             &results));
+  }
+  EXPECT_LE(cache.size(), ResultMetadataCache::kMaxEntriesPerOp + 1);
+  EXPECT_FALSE(cache.Lookup("unused", IdentityMetadataFn, "key", {unused_md},
+                            &results));
+}
+
+TEST(DispatchCacheTest, ResultMetadataConcurrentLookups) {
+  ResultMetadataCache cache;
+  constexpr int kNumShapes = 64;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&cache] {
+      llvm::SmallVector<TensorMetadata, 4> results;
+      for (int i = 0; i < 1000; ++i) {
+        TensorMetadata md = TensorMetadata::Create<float>(i % kNumShapes + 1);
+        if (cache.Lookup("op", IdentityMetadataFn, "key", {md}, &results)) {
+          ASSERT_EQ(results.size(), 1);
+          ASSERT_EQ(results[0], md);
+        } else {
+          cache.Insert("op", IdentityMetadataFn, "key", {md}, {md});
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+  EXPECT_EQ(cache.size(), kNumShapes);
+  EXPECT_EQ(cache.hits() + cache.misses(), 4000);
+}
+
+TEST(DispatchCacheTest, ResultMetadataConcurrentEvictions) {
+  ResultMetadataCache cache;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&cache, t] {
+      llvm::SmallVector<TensorMetadata, 4> results;
+      for (int i = 0; i < 4 * ResultMetadataCache::kMaxEntriesPerOp; ++i) {
+        TensorMetadata md = TensorMetadata::Create<float>(i + 1, t + 1);
+        if (cache.Lookup("op", IdentityMetadataFn, "key", {md}, &results)) {
+          ASSERT_EQ(results.size(), 1);
+          ASSERT_EQ(results[0], md);
+        } else {
+          cache.Insert("op", IdentityMetadataFn, "key", {md}, {md});
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+  EXPECT_LE(cache.size(), ResultMetadataCache::kMaxEntriesPerOp);
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace tfrt
@@ -24,7 +24,9 @@
 #include "llvm_derived/Support/raw_ostream.h"
 #include "tfrt/core_runtime/core_runtime_op.h"
 #include "tfrt/core_runtime/op_attrs.h"
+#include "tfrt/core_runtime/op_utils.h"
 #include "tfrt/core_runtime/tensor_handle.h"
+#include "tfrt/cpu/core_runtime/cpu_op_registry.h"
 #include "tfrt/host_context/chain.h"
 #include "tfrt/host_context/host_context.h"
 #include "tfrt/host_context/location.h"
@@ -33,10 +35,37 @@
 #include "tfrt/tensor/dense_host_tensor.h"
 #include "tfrt/tensor/dense_host_tensor_view.h"
 #include "tfrt/tensor/tensor_metadata.h"
+#include "tfrt/tensor/tensor_shape.h"
 
 namespace tfrt {
 namespace {
 
+// Returns a scalar tensor holding `kVariant`, so that tests can tell which
+// variant of the op was dispatched.
+template <int32_t kVariant>
+static AsyncValueRef<DenseHostTensor> TestVariantOp(
+    const DenseHostTensor& input, const ExecutionContext& exec_ctx) {
+  auto result =
+      DenseHostTensor::CreateScalar<int32_t>(kVariant, exec_ctx.host());
+  return MakeAvailableAsyncValueRef<DenseHostTensor>(std::move(*result));
+}
+
+static void RegisterTestVariantOps(CpuOpRegistry* op_registry) {
+  const Index kVectorDims[] = {PartialTensorShape::kUnknownDimSize};
+  const Index kFixedDims[] = {2, 3};
+  const PartialTensorShape vector{ArrayRef<Index>(kVectorDims)};
+  const PartialTensorShape fixed{ArrayRef<Index>(kFixedDims)};
+
+  op_registry->AddOp("test.variant", TFRT_CPU_OP(TestVariantOp<0>),
+                     CpuOpFlags::NoSideEffects);
+  op_registry->AddSpecializedOp("test.variant", vector,
+                                TFRT_CPU_OP(TestVariantOp<1>));
+  op_registry->AddSpecializedOp("test.variant", fixed,
+                                TFRT_CPU_OP(TestVariantOp<2>));
+}
+
+TFRT_STATIC_CPU_OP_REGISTRATION(RegisterTestVariantOps);
+
 class CpuDriverTest : public testing::Test {
  protected:
   example::CoreRuntimeCpuDriver driver_;
@@ -165,5 +194,88 @@ TEST_F(CpuDriverTest, NativeCompositeOpTest) {
   ASSERT_EQ(a2->get<int32_t>(), 2);
 }
 
+TEST_F(CpuDriverTest, DispatchesShapeSpecializedVariants) {
+  auto execute = [&](ArrayRef<Index> shape) {
+    tfrt::OpAttrs attrs;
+    attrs.SetArray("shape", shape);
+    attrs.SetArray("values", tfrt::ArrayRef<float>{1.0});
+    tfrt::TensorHandle input;
+    driver_.Execute(driver_.CreateExecutionContext(__FILE__, __LINE__),
+                    "tfrt_test.create_dense_tensor", {}, attrs.freeze(),
+                    input);
+
+    tfrt::OpAttrs empty_attrs;
+    tfrt::TensorHandle result;
+    driver_.Execute(driver_.CreateExecutionContext(__FILE__, __LINE__),
+                    "test.variant", input, empty_attrs.freeze(), result);
+    driver_.WaitForHostContextQuiesce();
+    return DHTArrayView<int32_t>(
+               &result.GetAsyncTensor()->get<DenseHostTensor>())
+        .Elements()[0];
+  };
+
+  EXPECT_EQ(execute({4}), 1);
+  EXPECT_EQ(execute({2, 3}), 2);
+  EXPECT_EQ(execute({3, 2}), 0);
+  EXPECT_EQ(execute({2, 3, 1}), 0);
+}
+
+TEST_F(CpuDriverTest, ReadyInputsProduceReadyResults) {
+  tfrt::OpAttrs attrs;
+  attrs.SetArray("shape", tfrt::ArrayRef<Index>{2});
+  attrs.SetArray("values", tfrt::ArrayRef<float>{1.0});
+  tfrt::TensorHandle input;
+  driver_.Execute(driver_.CreateExecutionContext(__FILE__, __LINE__),
+                  "tfrt_test.create_dense_tensor", {}, attrs.freeze(), input);
+  driver_.WaitForHostContextQuiesce();
+  ASSERT_TRUE(input.GetAsyncTensor()->IsConcrete());
+
+  // "test.variant" has no metadata function, so the metadata of the result is
+  // only available synchronously if the op runs inline.
+  tfrt::OpAttrs empty_attrs;
+  tfrt::TensorHandle result;
+  driver_.Execute(driver_.CreateExecutionContext(__FILE__, __LINE__),
+                  "test.variant", input, empty_attrs.freeze(), result);
+  EXPECT_TRUE(result.IsMetadataAvailable());
+  EXPECT_TRUE(result.GetAsyncTensor()->IsConcrete());
+  EXPECT_EQ(result.GetAvailableMetadata().shape.GetRank(), 0);
+}
+
+TEST_F(CpuDriverTest, ExternalInputIsNotCopied) {
+  alignas(16) float data[4] = {-1.0, 2.0, -3.0, 4.0};
+  bool deallocated = false;
+  const TensorMetadata metadata(GetDType<float>(), ArrayRef<Index>{4});
+  auto input = TensorHandle::CreateFromExternal(
+      driver_.GetHostContext(), metadata, data, sizeof(data),
+      [&](void*, size_t) { deallocated = true; });
+  ASSERT_TRUE(!!input);
+  EXPECT_EQ(input->GetAsyncTensor()->get<DenseHostTensor>().data(), data);
+
+  tfrt::OpAttrs empty_attrs;
+  tfrt::TensorHandle result;
+  driver_.Execute(driver_.CreateExecutionContext(__FILE__, __LINE__),
+                  "tfrt_test.relu", *input, empty_attrs.freeze(), result);
+  driver_.WaitForHostContextQuiesce();
+
+  // The client owned buffer is not forwarded to the result.
+  const auto& result_tensor = result.GetAsyncTensor()->get<DenseHostTensor>();
+  EXPECT_NE(result_tensor.data(), data);
+  EXPECT_EQ(DHTArrayView<float>(&result_tensor).Elements()[1], 2.0);
+  EXPECT_EQ(data[0], -1.0);
+
+  *input = TensorHandle();
+  EXPECT_TRUE(deallocated);
+}
+
+TEST_F(CpuDriverTest, MisalignedExternalInputFails) {
+  alignas(16) char data[20];
+  const TensorMetadata metadata(GetDType<float>(), ArrayRef<Index>{4});
+  auto input = TensorHandle::CreateFromExternal(
+      driver_.GetHostContext(), metadata, data + 1, sizeof(data) - 1,
+      [](void*, size_t) {});
+  EXPECT_FALSE(!!input);
+  llvm::consumeError(input.takeError());
+}
+
 }  // namespace
 }  // namespace tfrt
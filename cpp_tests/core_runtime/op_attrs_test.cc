@@ -219,6 +219,59 @@ TEST(OpAttrsTest, ArrayAsserting) {
   ASSERT_EQ(op_attrs_ref.GetArrayAsserting<int32_t>("bar"), empty_ref);
 }
 
+TEST(OpAttrsTest, Key) {
+  const OpAttrKey foo("foo");
+  EXPECT_EQ(foo, OpAttrKey("foo"));
+  EXPECT_NE(foo, OpAttrKey("bar"));
+  EXPECT_EQ(foo.str(), "foo");
+
+  OpAttrs op_attrs;
+  ASSERT_TRUE(op_attrs.Set<int64_t>(foo, 1234));
+  ASSERT_TRUE(op_attrs.Set<int64_t>("bar", 5678));
+  ASSERT_FALSE(op_attrs.Set<int64_t>("foo", 0));
+  ASSERT_FALSE(op_attrs.Set<int64_t>(OpAttrKey("bar"), 0));
+
+  // Keys and strings find the same attributes.
+  EXPECT_EQ(op_attrs.GetAsserting<int64_t>(foo), 1234);
+  EXPECT_EQ(op_attrs.GetAsserting<int64_t>("foo"), 1234);
+  EXPECT_EQ(op_attrs.GetAsserting<int64_t>(OpAttrKey("bar")), 5678);
+  EXPECT_FALSE(op_attrs.GetOptional<int64_t>(OpAttrKey("baz")).has_value());
+
+  OpAttrsRef op_attrs_ref = op_attrs.freeze();
+  EXPECT_EQ(op_attrs_ref.GetAsserting<int64_t>(foo), 1234);
+  EXPECT_EQ(op_attrs_ref.GetAsserting<int64_t>("bar"), 5678);
+  EXPECT_FALSE(op_attrs_ref.GetOptional<int64_t>("baz").has_value());
+}
+
+TEST(OpAttrsTest, KeyFrozen) {
+  const OpAttrKey a("a"), b("b"), c("c");
+
+  OpAttrs op_attrs;
+  ASSERT_TRUE(op_attrs.Set<int32_t>(c, 3));
+  ASSERT_TRUE(op_attrs.Set<int32_t>(a, 1));
+  ASSERT_TRUE(op_attrs.Set<int32_t>(b, 2));
+
+  OpAttrsRef op_attrs_ref = op_attrs.freeze();
+  EXPECT_EQ(op_attrs_ref.GetAsserting<int32_t>(a), 1);
+  EXPECT_EQ(op_attrs_ref.GetAsserting<int32_t>("b"), 2);
+  EXPECT_EQ(op_attrs_ref.GetAsserting<int32_t>(c), 3);
+  EXPECT_FALSE(op_attrs_ref.GetOptional<int32_t>(OpAttrKey("d")).has_value());
+  EXPECT_FALSE(op_attrs_ref.GetOptional<int32_t>("bb").has_value());
+}
+
+TEST(OpAttrsTest, KeyOutOfLine) {
+  OpAttrs op_attrs;
+  const char* names[] = {"a", "b", "c", "d", "e", "f", "g", "h"};
+  for (int i = 0; i < 8; ++i)
+    ASSERT_TRUE(op_attrs.Set<int64_t>(OpAttrKey(names[i]), i));
+  ASSERT_TRUE(op_attrs.IsOutOfLine());
+
+  for (int i = 0; i < 8; ++i) {
+    EXPECT_EQ(op_attrs.GetAsserting<int64_t>(OpAttrKey(names[i])), i);
+    EXPECT_EQ(op_attrs.GetAsserting<int64_t>(names[i]), i);
+  }
+}
+
 void BM_OpAttrSetBool(benchmark::State& state) {
   for (auto _ : state) {
     tfrt::OpAttrs attrs;
@@ -236,6 +289,37 @@ void BM_OpAttrGetBool(benchmark::State& state) {
 }
 BENCHMARK(BM_OpAttrGetBool);
 
+void BM_OpAttrSetBoolByKey(benchmark::State& state) {
+  const OpAttrKey transpose("transpose");
+  for (auto _ : state) {
+    tfrt::OpAttrs attrs;
+    benchmark::DoNotOptimize(attrs.Set<bool>(transpose, false));
+  }
+}
+BENCHMARK(BM_OpAttrSetBoolByKey);
+
+void BM_OpAttrGetBoolByKey(benchmark::State& state) {
+  const OpAttrKey transpose("transpose");
+  tfrt::OpAttrs attrs;
+  attrs.Set<bool>(transpose, false);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(attrs.GetAsserting<bool>(transpose));
+  }
+}
+BENCHMARK(BM_OpAttrGetBoolByKey);
+
+void BM_OpAttrGetBoolByKeyFrozen(benchmark::State& state) {
+  const OpAttrKey keys[] = {OpAttrKey("data_format"), OpAttrKey("padding"),
+                            OpAttrKey("strides"), OpAttrKey("transpose")};
+  tfrt::OpAttrs attrs;
+  for (const auto& key : keys) attrs.Set<bool>(key, false);
+  tfrt::OpAttrsRef frozen = attrs.freeze();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(frozen.GetAsserting<bool>(keys[3]));
+  }
+}
+BENCHMARK(BM_OpAttrGetBoolByKeyFrozen);
+
 void BM_OpAttrSetUnrankedShape(benchmark::State& state) {
   tfrt::BefAttrEncoder encoder;
   const size_t offset = encoder.EncodeUnrankedShapeAttr();
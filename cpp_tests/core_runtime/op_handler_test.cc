@@ -16,16 +16,30 @@
 
 #include "tfrt/core_runtime/op_handler.h"
 
+#include <atomic>
+#include <chrono>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "gtest/gtest.h"
+#include "llvm/Support/raw_ostream.h"
 #include "tfrt/core_runtime/core_runtime.h"
+#include "tfrt/core_runtime/core_runtime_op.h"
+#include "tfrt/core_runtime/logging_op_handler.h"
+#include "tfrt/core_runtime/op_attrs.h"
+#include "tfrt/core_runtime/remote_op_handler.h"
+#include "tfrt/core_runtime/tensor_handle.h"
 #include "tfrt/cpp_tests/test_util.h"
 #include "tfrt/cpu/core_runtime/cpu_op_handler.h"
 #include "tfrt/cpu/core_runtime/null_op_handler.h"
 #include "tfrt/host_context/diagnostic.h"
 #include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/host_context/resource_context.h"
 #include "tfrt/support/error_util.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
 
 namespace tfrt {
 namespace {
@@ -85,5 +99,216 @@ TEST(OpHandlerTest, Registration) {
   ASSERT_EQ(core_runtime->GetOpHandler(chain_name), chain_root);
   ASSERT_FALSE(core_runtime->GetOpHandler(op_handler_name));
 }
+
+TEST(OpHandlerTest, AsyncLoggingWritesOpLog) {
+  std::string log;
+  {
+    auto core_runtime = CreateCoreRuntime();
+    auto* host = core_runtime->GetHostContext();
+    auto op_handler = CreateAsyncLoggingOpHandler(
+        core_runtime.get(), core_runtime->GetOpHandler("cpu"),
+        std::make_unique<llvm::raw_string_ostream>(log),
+        /*flush_interval=*/std::chrono::milliseconds(1));
+    ASSERT_TRUE(!!op_handler);
+    auto create_op = (*op_handler)->MakeOp("tfrt_test.create_dense_tensor");
+    auto relu_op = (*op_handler)->MakeOp("tfrt_test.relu");
+    ASSERT_TRUE(create_op && relu_op);
+
+    ResourceContext resource_context;
+    auto req_ctx = RequestContextBuilder(host, &resource_context).build();
+    ASSERT_TRUE(!!req_ctx);
+    ExecutionContext exec_ctx(std::move(*req_ctx));
+
+    OpAttrs attrs;
+    attrs.SetArray("shape", ArrayRef<Index>{2, 3});
+    attrs.SetArray("values", ArrayRef<float>{1.0});
+    TensorHandle tensor;
+    (*create_op)(exec_ctx, {}, attrs.freeze(), tensor, /*chain=*/nullptr);
+    host->Await(tensor.GetAsyncTensor()->CopyRCRef());
+
+    OpAttrs empty_attrs;
+    TensorHandle result;
+    (*relu_op)(exec_ctx, tensor, empty_attrs.freeze(), result,
+               /*chain=*/nullptr);
+    host->Quiesce();
+    // Destroying the CoreRuntime writes the records left in the buffers.
+  }
+
+  std::vector<OpLogRecord> records;
+  auto num_dropped = DecodeOpLog(
+      log, [&](const OpLogRecord& record) { records.push_back(record); });
+  ASSERT_TRUE(!!num_dropped);
+  EXPECT_EQ(*num_dropped, 0);
+  ASSERT_EQ(records.size(), 2);
+
+  EXPECT_EQ(records[0].op_name, "tfrt_test.create_dense_tensor");
+  EXPECT_TRUE(records[0].argument_shapes.empty());
+  EXPECT_EQ(records[0].result_shapes.size(), 1);
+
+  EXPECT_EQ(records[1].op_name, "tfrt_test.relu");
+  ASSERT_EQ(records[1].argument_shapes.size(), 1);
+  ASSERT_TRUE(records[1].argument_shapes[0].has_value());
+  EXPECT_EQ(*records[1].argument_shapes[0],
+            (llvm::SmallVector<int64_t, 4>{2, 3}));
+  EXPECT_EQ(records[1].thread_index, records[0].thread_index);
+  EXPECT_GE(records[1].begin, records[0].begin + records[0].duration);
+}
+
+TEST(OpHandlerTest, DecodeOpLogRejectsMalformedLogs) {
+  auto ignore = [](const OpLogRecord&) {};
+  auto not_a_log = DecodeOpLog("XXXX", ignore);
+  EXPECT_FALSE(!!not_a_log);
+  llvm::consumeError(not_a_log.takeError());
+
+  // An op entry with an op id that has no name.
+  auto unknown_op = DecodeOpLog(llvm::StringRef("TFOL\x01\x01\x00", 7), ignore);
+  EXPECT_FALSE(!!unknown_op);
+  llvm::consumeError(unknown_op.takeError());
+
+  auto empty = DecodeOpLog("TFOL\x01", ignore);
+  ASSERT_TRUE(!!empty);
+  EXPECT_EQ(*empty, 0);
+}
+
+// Counts the requests and fetches sent through another transport.
+class CountingTransport : public RemoteOpTransport {
+ public:
+  CountingTransport(std::unique_ptr<RemoteOpTransport> transport,
+                    std::atomic<int>* num_sends,
+                    std::atomic<int>* num_inline_arguments,
+                    std::atomic<int>* num_fetches)
+      : transport_(std::move(transport)),
+        num_sends_(num_sends),
+        num_inline_arguments_(num_inline_arguments),
+        num_fetches_(num_fetches) {}
+
+  void Send(RemoteOpRequest request, RemoteOpDoneFn done) override {
+    ++*num_sends_;
+    for (auto& argument : request.arguments) {
+      if (argument.remote_id == RemoteOpArgument::kInlineTensor)
+        ++*num_inline_arguments_;
+    }
+    transport_->Send(std::move(request), std::move(done));
+  }
+
+  void Fetch(uint64_t remote_id, RemoteFetchDoneFn done) override {
+    ++*num_fetches_;
+    transport_->Fetch(remote_id, std::move(done));
+  }
+
+  void Release(uint64_t remote_id) override { transport_->Release(remote_id); }
+
+ private:
+  std::unique_ptr<RemoteOpTransport> transport_;
+  std::atomic<int>* num_sends_;
+  std::atomic<int>* num_inline_arguments_;
+  std::atomic<int>* num_fetches_;
+};
+
+class RemoteOpHandlerTest : public ::testing::Test {
+ protected:
+  RemoteOpHandlerTest()
+      : core_runtime_(CreateCoreRuntime()),
+        host_(core_runtime_->GetHostContext()),
+        server_(core_runtime_.get(), core_runtime_->GetOpHandler("cpu")) {
+    auto op_handler = CreateRemoteOpHandler(
+        core_runtime_.get(), "remote0",
+        std::make_unique<CountingTransport>(
+            CreateLoopbackRemoteOpTransport(&server_, host_), &num_sends_,
+            &num_inline_arguments_, &num_fetches_));
+    assert(op_handler);
+    op_handler_ = *op_handler;
+
+    auto req_ctx = RequestContextBuilder(host_, &resource_context_).build();
+    assert(req_ctx);
+    exec_ctx_ = std::make_unique<ExecutionContext>(std::move(*req_ctx));
+  }
+
+  ~RemoteOpHandlerTest() override { host_->Quiesce(); }
+
+  TensorHandle CreateTensor(OpHandler* op_handler) {
+    auto create_op = op_handler->MakeOp("tfrt_test.create_dense_tensor");
+    assert(create_op);
+    OpAttrs attrs;
+    attrs.SetArray("shape", ArrayRef<Index>{2});
+    attrs.SetArray("values", ArrayRef<float>{-1.0, 2.0});
+    TensorHandle tensor;
+    (*create_op)(*exec_ctx_, {}, attrs.freeze(), tensor, /*chain=*/nullptr);
+    return tensor;
+  }
+
+  TensorHandle Relu(TensorHandle tensor) {
+    auto relu_op = op_handler_->MakeOp("tfrt_test.relu");
+    assert(relu_op);
+    OpAttrs empty_attrs;
+    TensorHandle result;
+    (*relu_op)(*exec_ctx_, tensor, empty_attrs.freeze(), result,
+               /*chain=*/nullptr);
+    return result;
+  }
+
+  // Fetches `tensor` and checks that it holds relu({-1, 2}).
+  void ExpectReluResult(const TensorHandle& tensor) {
+    auto host_tensor = tensor.TransferTo(*exec_ctx_, host_->GetHostDeviceRef(),
+                                         DenseHostTensor::kTensorType);
+    host_->Await(FormRef(host_tensor.GetAsyncTensor()));
+    ASSERT_FALSE(host_tensor.GetAsyncTensor()->IsError())
+        << host_tensor.GetAsyncTensor()->GetError();
+    const auto& dht = host_tensor.GetAsyncTensor()->get<DenseHostTensor>();
+    ASSERT_EQ(dht.NumElements(), 2);
+    EXPECT_EQ(DHTArrayView<float>(&dht).Elements()[0], 0.0);
+    EXPECT_EQ(DHTArrayView<float>(&dht).Elements()[1], 2.0);
+  }
+
+  std::unique_ptr<CoreRuntime> core_runtime_;
+  HostContext* host_;
+  RemoteOpServer server_;
+  OpHandler* op_handler_;
+  ResourceContext resource_context_;
+  std::unique_ptr<ExecutionContext> exec_ctx_;
+  std::atomic<int> num_sends_{0};
+  std::atomic<int> num_inline_arguments_{0};
+  std::atomic<int> num_fetches_{0};
+};
+
+TEST_F(RemoteOpHandlerTest, ResultsStayRemote) {
+  // The relu request refers to the result of the first request, which it does
+  // not wait for.
+  TensorHandle result = Relu(CreateTensor(op_handler_));
+  EXPECT_EQ(result.GetAvailableDevice()->name(), "remote0");
+
+  ExpectReluResult(result);
+  EXPECT_EQ(num_sends_, 2);
+  EXPECT_EQ(num_inline_arguments_, 0);
+  EXPECT_EQ(num_fetches_, 1);
+
+  result = TensorHandle();
+  host_->Quiesce();
+  EXPECT_EQ(server_.GetNumTensors(), 0);
+}
+
+TEST_F(RemoteOpHandlerTest, LocalArgumentsAreSentInline) {
+  TensorHandle tensor = CreateTensor(core_runtime_->GetOpHandler("cpu"));
+  TensorHandle result = Relu(std::move(tensor));
+
+  ExpectReluResult(result);
+  EXPECT_EQ(num_sends_, 1);
+  EXPECT_EQ(num_inline_arguments_, 1);
+  EXPECT_EQ(num_fetches_, 1);
+}
+
+TEST_F(RemoteOpHandlerTest, UnknownOpFails) {
+  auto op = op_handler_->MakeOp("tfrt_test.unknown");
+  ASSERT_TRUE(!!op);
+  OpAttrs empty_attrs;
+  TensorHandle result;
+  (*op)(*exec_ctx_, {}, empty_attrs.freeze(), result, /*chain=*/nullptr);
+  host_->Await(FormRef(result.GetAsyncTensor()));
+  EXPECT_TRUE(result.IsError());
+  host_->Quiesce();
+  result = TensorHandle();
+  EXPECT_EQ(server_.GetNumTensors(), 0);
+}
+
 }  // namespace
 }  // namespace tfrt
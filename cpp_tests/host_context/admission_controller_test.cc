@@ -0,0 +1,152 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Unit test for TFRT AdmissionController.
+
+#include "tfrt/host_context/admission_controller.h"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "llvm/Support/Error.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+
+namespace tfrt {
+namespace {
+
+// A work queue that runs tasks inline and reports the load set by the test.
+class FakeLoadWorkQueue : public ConcurrentWorkQueue {
+ public:
+  std::string name() const override { return "fake"; }
+  void AddTask(TaskFunction work) override { work(); }
+  std::optional<TaskFunction> AddBlockingTask(TaskFunction work,
+                                              bool allow_queuing) override {
+    work();
+    return std::nullopt;
+  }
+  void Await(ArrayRef<RCReference<AsyncValue>> values) override {}
+  void Quiesce() override {}
+  int GetParallelismLevel() const override { return 1; }
+  bool IsInWorkerThread() const override { return false; }
+
+  WorkQueueLoad GetLoad() const override {
+    WorkQueueLoad load;
+    load.num_queued_tasks = num_queued_tasks.load();
+    if (auto latency = task_latency_us.load(); latency >= 0)
+      load.task_latency = std::chrono::microseconds(latency);
+    return load;
+  }
+
+  std::atomic<int64_t> num_queued_tasks{0};
+  std::atomic<int64_t> task_latency_us{-1};
+};
+
+TEST(AdmissionControllerTest, RejectsQueuedTasksAboveLimit) {
+  FakeLoadWorkQueue work_queue;
+  AdmissionControlOptions options;
+  options.max_queued_tasks = 10;
+  AdmissionController controller(&work_queue, options);
+
+  work_queue.num_queued_tasks = 10;
+  EXPECT_FALSE(controller.Admit(TaskPriority::kDefault));
+
+  work_queue.num_queued_tasks = 11;
+  Error error = controller.Admit(TaskPriority::kDefault);
+  ASSERT_TRUE(!!error);
+  EXPECT_NE(toString(std::move(error)).find("11 queued tasks, limit 10"),
+            std::string::npos);
+
+  // Critical requests are always admitted.
+  EXPECT_FALSE(controller.Admit(TaskPriority::kCritical));
+
+  EXPECT_EQ(controller.num_admitted(), 2);
+  EXPECT_EQ(controller.num_rejected(), 1);
+}
+
+TEST(AdmissionControllerTest, RejectsTaskLatencyAboveLimit) {
+  FakeLoadWorkQueue work_queue;
+  AdmissionControlOptions options;
+  options.max_task_latency = std::chrono::milliseconds(1);
+  AdmissionController controller(&work_queue, options);
+
+  work_queue.num_queued_tasks = 1;
+  work_queue.task_latency_us = 500;
+  EXPECT_FALSE(controller.Admit(TaskPriority::kDefault));
+
+  work_queue.task_latency_us = 5000;
+  Error error = controller.Admit(TaskPriority::kDefault);
+  ASSERT_TRUE(!!error);
+  EXPECT_NE(toString(std::move(error)).find("task latency 5000us"),
+            std::string::npos);
+
+  // The latency of the last started tasks does not matter once the queues
+  // are empty.
+  work_queue.num_queued_tasks = 0;
+  EXPECT_FALSE(controller.Admit(TaskPriority::kDefault));
+}
+
+TEST(AdmissionControllerTest, DelaysUntilLoadDrops) {
+  FakeLoadWorkQueue work_queue;
+  AdmissionControlOptions options;
+  options.max_queued_tasks = 10;
+  options.max_delay = std::chrono::seconds(60);
+  AdmissionController controller(&work_queue, options);
+
+  work_queue.num_queued_tasks = 100;
+  std::thread thread([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    work_queue.num_queued_tasks = 0;
+  });
+  EXPECT_FALSE(controller.Admit(TaskPriority::kDefault));
+  thread.join();
+
+  EXPECT_EQ(controller.num_admitted(), 1);
+  EXPECT_EQ(controller.num_delayed(), 1);
+}
+
+TEST(AdmissionControllerTest, RequestContextBuilder) {
+  auto work_queue = std::make_unique<FakeLoadWorkQueue>();
+  FakeLoadWorkQueue* fake_work_queue = work_queue.get();
+  HostContext host([](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+                   std::move(work_queue));
+  AdmissionControlOptions options;
+  options.max_queued_tasks = 10;
+  AdmissionController controller(&host.work_queue(), options);
+
+  RequestOptions request_options;
+  request_options.admission_controller = &controller;
+  auto admitted = RequestContextBuilder(&host, /*resource_context=*/nullptr)
+                      .set_request_options(request_options)
+                      .build();
+  ASSERT_TRUE(!!admitted) << toString(admitted.takeError());
+
+  fake_work_queue->num_queued_tasks = 100;
+  auto request = RequestContextBuilder(&host, /*resource_context=*/nullptr)
+                     .set_request_options(request_options)
+                     .build();
+  ASSERT_FALSE(!!request);
+  EXPECT_NE(toString(request.takeError()).find("admission control"),
+            std::string::npos);
+}
+
+}  // namespace
+}  // namespace tfrt
@@ -0,0 +1,124 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Unit test for the coroutine support of AsyncValueRef.
+
+#include "tfrt/host_context/async_coroutine.h"
+
+#include <cassert>
+
+#include "gtest/gtest.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+
+#if defined(TFRT_HAS_COROUTINES)
+
+namespace tfrt {
+namespace {
+
+std::unique_ptr<HostContext> CreateTestHostContext() {
+  return std::make_unique<HostContext>([](const DecodedDiagnostic&) {},
+                                       CreateMallocAllocator(),
+                                       CreateSingleThreadedWorkQueue());
+}
+
+ExecutionContext CreateExecutionContext(HostContext* host,
+                                        ResourceContext* resource_context) {
+  auto request_context = RequestContextBuilder(host, resource_context).build();
+  assert(request_context);
+  return ExecutionContext(std::move(*request_context));
+}
+
+Task<int> Add(AsyncValueRef<int> a, AsyncValueRef<int> b,
+              const ExecutionContext& exec_ctx) {
+  AsyncValueRef<int> x = co_await std::move(a);
+  if (x.IsError()) co_return x.GetError();
+  AsyncValueRef<int> y = co_await std::move(b);
+  if (y.IsError()) co_return y.GetError();
+  co_return x.get() + y.get();
+}
+
+Task<int> Double(AsyncValueRef<int> a) {
+  AsyncValueRef<int> x = co_await std::move(a);
+  co_return 2 * x.get();
+}
+
+Task<int> DoublePlusOne(AsyncValueRef<int> a) {
+  AsyncValueRef<int> x = co_await Double(std::move(a));
+  co_return x.get() + 1;
+}
+
+TEST(AsyncCoroutineTest, CompletesSynchronously) {
+  auto host = CreateTestHostContext();
+  ResourceContext resource_context;
+  auto exec_ctx = CreateExecutionContext(host.get(), &resource_context);
+
+  auto result = Add(MakeAvailableAsyncValueRef<int>(1),
+                    MakeAvailableAsyncValueRef<int>(2), exec_ctx)
+                    .ToAsyncValueRef();
+  ASSERT_TRUE(result.IsAvailable());
+  EXPECT_EQ(result.get(), 3);
+}
+
+TEST(AsyncCoroutineTest, ResumesOnWorkQueue) {
+  auto host = CreateTestHostContext();
+  ResourceContext resource_context;
+  auto exec_ctx = CreateExecutionContext(host.get(), &resource_context);
+
+  auto b = MakeUnconstructedAsyncValueRef<int>();
+  auto result =
+      Add(MakeAvailableAsyncValueRef<int>(1), b, exec_ctx).ToAsyncValueRef();
+  EXPECT_FALSE(result.IsAvailable());
+
+  // The coroutine is resumed by a task on the work queue, not inline.
+  b.emplace(2);
+  EXPECT_FALSE(result.IsAvailable());
+  host->Quiesce();
+  ASSERT_TRUE(result.IsAvailable());
+  EXPECT_EQ(result.get(), 3);
+}
+
+TEST(AsyncCoroutineTest, PropagatesErrors) {
+  auto host = CreateTestHostContext();
+  ResourceContext resource_context;
+  auto exec_ctx = CreateExecutionContext(host.get(), &resource_context);
+
+  auto a = MakeUnconstructedAsyncValueRef<int>();
+  auto result =
+      Add(a, MakeUnconstructedAsyncValueRef<int>(), exec_ctx).ToAsyncValueRef();
+  a.SetError(absl::InternalError("failed"));
+  host->Quiesce();
+  ASSERT_TRUE(result.IsError());
+  EXPECT_EQ(result.GetError().message(), "failed");
+}
+
+TEST(AsyncCoroutineTest, AwaitsTask) {
+  auto a = MakeUnconstructedAsyncValueRef<int>();
+  auto result = DoublePlusOne(a).ToAsyncValueRef();
+
+  // Without an ExecutionContext, the coroutines resume inline.
+  a.emplace(5);
+  ASSERT_TRUE(result.IsAvailable());
+  EXPECT_EQ(result.get(), 11);
+}
+
+}  // namespace
+}  // namespace tfrt
+
+#endif  // defined(TFRT_HAS_COROUTINES)
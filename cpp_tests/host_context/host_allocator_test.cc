@@ -18,9 +18,14 @@
 
 #include "tfrt/host_context/host_allocator.h"
 
+#include <algorithm>
 #include <cstdint>
+#include <thread>
+#include <vector>
 
 #include "gtest/gtest.h"
+#include "tfrt/host_context/allocation_site.h"
+#include "tfrt/host_context/profiled_allocator.h"
 
 namespace tfrt {
 namespace {
@@ -53,6 +58,187 @@ TEST_F(HostAllocatorTest, AllocateDeallocate) {
   allocator_->Deallocate<uint64_t>(entries, kTestAllocateEntryCount);
 }
 
+TEST(RequestArenaAllocatorTest, AllocateBytesWithAlignment) {
+  auto parent = CreateMallocAllocator();
+  auto arena = CreateRequestArenaAllocator(parent.get(), /*block_size=*/4096);
+
+  for (size_t alignment : {1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024}) {
+    void* buffer = arena->AllocateBytes(kTestAllocateSize, alignment);
+    ASSERT_NE(nullptr, buffer);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(buffer) % alignment, 0);
+    memset(buffer, 0, kTestAllocateSize);
+    arena->DeallocateBytes(buffer, kTestAllocateSize);
+  }
+}
+
+TEST(RequestArenaAllocatorTest, AllocationsDoNotOverlap) {
+  auto parent = CreateMallocAllocator();
+  auto arena = CreateRequestArenaAllocator(parent.get(), /*block_size=*/4096);
+
+  // Mix small allocations that share blocks with ones that are large enough to
+  // get a dedicated block.
+  std::vector<uint64_t*> entries;
+  for (int i = 0; i < 64; ++i) {
+    size_t count = (i % 8 == 0) ? 1024 : 10;
+    uint64_t* entry = arena->Allocate<uint64_t>(count);
+    for (size_t j = 0; j < count; ++j) entry[j] = i;
+    entries.push_back(entry);
+  }
+
+  for (int i = 0; i < 64; ++i) EXPECT_EQ(entries[i][0], i);
+}
+
+TEST(PooledAllocatorTest, AllocateBytesWithAlignment) {
+  auto allocator = CreatePooledAllocator(CreateMallocAllocator());
+
+  for (size_t size : {1, 24, 100, 1000, 4096, 10000}) {
+    for (size_t alignment : {1, 8, 16, 64, 256, 4096, 8192}) {
+      void* buffer = allocator->AllocateBytes(size, alignment);
+      ASSERT_NE(nullptr, buffer);
+      EXPECT_EQ(reinterpret_cast<std::uintptr_t>(buffer) % alignment, 0);
+      memset(buffer, 0, size);
+      allocator->DeallocateBytes(buffer, size);
+    }
+  }
+}
+
+TEST(PooledAllocatorTest, ReusesFreedChunks) {
+  auto allocator = CreatePooledAllocator(CreateMallocAllocator());
+
+  void* first = allocator->AllocateBytes(64, 8);
+  allocator->DeallocateBytes(first, 64);
+  void* second = allocator->AllocateBytes(64, 8);
+  EXPECT_EQ(first, second);
+  allocator->DeallocateBytes(second, 64);
+}
+
+TEST(PooledAllocatorTest, CrossThreadDeallocation) {
+  auto allocator = CreatePooledAllocator(CreateMallocAllocator());
+
+  constexpr int kNumAllocations = 10000;
+  std::vector<uint64_t*> entries(kNumAllocations);
+  std::thread producer([&]() {
+    for (int i = 0; i < kNumAllocations; ++i) {
+      entries[i] = allocator->Allocate<uint64_t>(1 + i % 32);
+      entries[i][0] = i;
+    }
+  });
+  producer.join();
+
+  std::thread consumer([&]() {
+    for (int i = 0; i < kNumAllocations; ++i) {
+      EXPECT_EQ(entries[i][0], i);
+      allocator->Deallocate<uint64_t>(entries[i], 1 + i % 32);
+    }
+  });
+  consumer.join();
+}
+
+constexpr size_t kHugePageTestSize = 2 * 1024 * 1024;
+
+TEST(HugePageAllocatorTest, AllocateBytesWithAlignment) {
+  auto allocator = CreateHugePageAllocator(CreateMallocAllocator(),
+                                           /*min_size=*/kHugePageTestSize);
+
+  // Small allocations go to the parent, large ones are mapped.
+  const size_t sizes[] = {100, 4096, kHugePageTestSize,
+                          3 * kHugePageTestSize + 1};
+  const size_t alignments[] = {1, 64, 4096, 4 * kHugePageTestSize};
+  for (size_t size : sizes) {
+    for (size_t alignment : alignments) {
+      void* buffer = allocator->AllocateBytes(size, alignment);
+      ASSERT_NE(nullptr, buffer);
+      EXPECT_EQ(reinterpret_cast<std::uintptr_t>(buffer) % alignment, 0);
+      memset(buffer, 0, size);
+      allocator->DeallocateBytes(buffer, size);
+    }
+  }
+}
+
+TEST(HugePageAllocatorTest, ReusesFreedMappings) {
+  auto allocator = CreateHugePageAllocator(CreateMallocAllocator(),
+                                           /*min_size=*/kHugePageTestSize / 2);
+
+  void* first = allocator->AllocateBytes(kHugePageTestSize, 64);
+  allocator->DeallocateBytes(first, kHugePageTestSize);
+  // The size rounds up to the same mapping.
+  void* second = allocator->AllocateBytes(kHugePageTestSize - 1, 64);
+  EXPECT_EQ(first, second);
+  allocator->DeallocateBytes(second, kHugePageTestSize - 1);
+}
+
+TEST(HugePageAllocatorTest, DoesNotCacheBeyondLimit) {
+  auto allocator = CreateHugePageAllocator(CreateMallocAllocator(),
+                                           /*min_size=*/kHugePageTestSize,
+                                           /*max_cached_bytes=*/0);
+
+  void* buffer = allocator->AllocateBytes(kHugePageTestSize, 64);
+  ASSERT_NE(nullptr, buffer);
+  memset(buffer, 1, kHugePageTestSize);
+  allocator->DeallocateBytes(buffer, kHugePageTestSize);
+}
+
+TEST(HugePageAllocatorTest, AllocateZeroedBytes) {
+  auto allocator = CreateHugePageAllocator(CreateMallocAllocator(),
+                                           /*min_size=*/kHugePageTestSize);
+
+  for (size_t size : {size_t{100}, kHugePageTestSize}) {
+    // The second allocation reuses the memory of the first one.
+    for (int i = 0; i < 2; ++i) {
+      auto* buffer =
+          static_cast<char*>(allocator->AllocateZeroedBytes(size, 64));
+      ASSERT_NE(nullptr, buffer);
+      EXPECT_TRUE(std::all_of(buffer, buffer + size,
+                              [](char byte) { return byte == 0; }));
+      memset(buffer, 1, size);
+      allocator->DeallocateBytes(buffer, size);
+    }
+  }
+}
+
+// With a sampling period of one byte, every allocation but the first one of a
+// thread is sampled with a weight of one.
+TEST(AllocationProfilerTest, AttributesAllocationsToSites) {
+  auto profiler = CreateAllocationProfiler(CreateMallocAllocator(),
+                                           /*sample_period_bytes=*/1);
+  profiler->DeallocateBytes(profiler->AllocateBytes(64, 8), 64);
+
+  void* unattributed = profiler->AllocateBytes(64, 8);
+  void* first;
+  void* second;
+  {
+    AllocationSite::Scope scope("tfrt_test.first", Location());
+    first = profiler->AllocateBytes(256, 8);
+    {
+      AllocationSite::Scope nested("tfrt_test.second", Location());
+      second = profiler->AllocateBytes(1024, 8);
+    }
+    profiler->DeallocateBytes(profiler->AllocateBytes(512, 8), 512);
+  }
+  EXPECT_EQ(AllocationSite::Current(), nullptr);
+
+  auto stats = profiler->GetSiteStats();
+  ASSERT_EQ(stats.size(), 3);
+  EXPECT_EQ(stats[0].kernel_name, "tfrt_test.second");
+  EXPECT_EQ(stats[0].num_allocations, 1);
+  EXPECT_EQ(stats[0].live_bytes, 1024);
+  EXPECT_EQ(stats[1].kernel_name, "tfrt_test.first");
+  EXPECT_EQ(stats[1].num_allocations, 2);
+  EXPECT_EQ(stats[1].bytes_allocated, 768);
+  EXPECT_EQ(stats[1].live_bytes, 256);
+  EXPECT_EQ(stats[1].peak_live_bytes, 768);
+  EXPECT_EQ(stats[2].kernel_name, "<unattributed>");
+  EXPECT_EQ(stats[2].live_allocations, 1);
+
+  profiler->DeallocateBytes(first, 256);
+  profiler->DeallocateBytes(second, 1024);
+  profiler->DeallocateBytes(unattributed, 64);
+  for (const auto& site : profiler->GetSiteStats()) {
+    EXPECT_EQ(site.live_allocations, 0) << site.kernel_name;
+    EXPECT_EQ(site.live_bytes, 0) << site.kernel_name;
+  }
+}
+
 // Tests for HostArray class.
 constexpr size_t kTestArraySize = 16;
 class HostArrayTest : public ::testing::Test {
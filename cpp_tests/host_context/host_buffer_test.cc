@@ -18,6 +18,8 @@
 
 #include "tfrt/host_context/host_buffer.h"
 
+#include <algorithm>
+
 #include "gtest/gtest.h"
 #include "tfrt/host_context/host_allocator.h"
 
@@ -92,6 +94,33 @@ TEST_F(HostBufferTest, CreateUninitialized) {
   EXPECT_TRUE(host_buffer->IsExclusiveDataOwner());
 }
 
+TEST_F(HostBufferTest, CreateZeroed) {
+  for (auto alignment : {1, 64, 256}) {
+    for (size_t size : {size_t{10}, kTestAllocSize}) {
+      RCReference<HostBuffer> host_buffer = HostBuffer::CreateZeroed(
+          size, alignment, malloc_allocator_.get());
+      ASSERT_TRUE(host_buffer);
+      EXPECT_TRUE(IsAligned(host_buffer->data(), alignment));
+      auto bytes = host_buffer->CastAs<char>();
+      EXPECT_TRUE(std::all_of(bytes.begin(), bytes.end(),
+                              [](char byte) { return byte == 0; }));
+    }
+  }
+}
+
+TEST_F(HostBufferTest, LargeBufferAlignment) {
+  auto allocator = CreateHugePageAllocator(CreateMallocAllocator());
+
+  for (size_t size : {HostBuffer::kLargeBufferSize, 4 * kTestAllocSize}) {
+    RCReference<HostBuffer> host_buffer =
+        HostBuffer::CreateUninitialized(size, /*alignment=*/1, allocator.get());
+    ASSERT_TRUE(host_buffer);
+    memset(host_buffer->data(), 0, size);
+    EXPECT_TRUE(
+        IsAligned(host_buffer->data(), HostBuffer::kLargeBufferAlignment));
+  }
+}
+
 TEST_F(HostBufferTest, CreateFromExternal) {
   RCReference<HostBuffer> parent_buffer = HostBuffer::CreateUninitialized(
       kTestAllocSize, kTestAlignment, malloc_allocator_.get());
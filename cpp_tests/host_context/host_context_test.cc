@@ -86,6 +86,33 @@ TEST(HostContextTest, RunBlockingWorkWithResult) {
   ASSERT_EQ(result.get(), 42);
 }
 
+TEST(HostContextTest, InternedDeviceNames) {
+  auto host = CreateTestHostContext(1);
+  DeviceManager* device_manager = host->GetDeviceManager();
+
+  auto host_device = device_manager->GetDeviceRef<Device>(
+      device_manager->InternDeviceName(kDefaultHostDeviceName));
+  ASSERT_TRUE(host_device);
+  EXPECT_EQ(host_device.get(), host->GetHostDeviceRef().get());
+  EXPECT_EQ(device_manager->GetDeviceRef<Device>(host_device->type()).get(),
+            host_device.get());
+
+  // A name may be interned before its device is added.
+  constexpr char kOtherDeviceName[] = "/job:localhost/replica:0/task:0/CPU:1";
+  DeviceManager::NameHandle other_name =
+      device_manager->InternDeviceName(kOtherDeviceName);
+  EXPECT_EQ(other_name.name(), kOtherDeviceName);
+  EXPECT_FALSE(device_manager->GetDeviceRef<Device>(other_name));
+  EXPECT_FALSE(device_manager->GetDeviceRef<Device>(kOtherDeviceName));
+
+  auto other_device =
+      device_manager->MaybeAddDevice(MakeRef<CpuDevice>(kOtherDeviceName));
+  EXPECT_EQ(device_manager->GetDeviceRef<Device>(other_name).get(),
+            other_device.get());
+  EXPECT_EQ(device_manager->GetDeviceRef<Device>(kOtherDeviceName).get(),
+            other_device.get());
+}
+
 static void BM_HostDeviceDirectLookup(benchmark::State& state) {
   static auto* host = CreateTestHostContext(1).release();
   std::string device_name(kDefaultHostDeviceName);
@@ -95,6 +122,15 @@ static void BM_HostDeviceDirectLookup(benchmark::State& state) {
   }
 }
 
+static void BM_HostDeviceInternedLookup(benchmark::State& state) {
+  static auto* host = CreateTestHostContext(1).release();
+  static auto device_name =
+      host->GetDeviceManager()->InternDeviceName(kDefaultHostDeviceName);
+  for (auto s : state) {
+    host->GetDeviceManager()->GetDeviceRef<tfrt::Device>(device_name);
+  }
+}
+
 static void BM_HostDeviceCachedLookup(benchmark::State& state) {
   static auto* host = CreateTestHostContext(1).release();
   std::string device_name(kDefaultHostDeviceName);
@@ -105,6 +141,7 @@ static void BM_HostDeviceCachedLookup(benchmark::State& state) {
 }
 
 BENCHMARK(BM_HostDeviceDirectLookup)->ThreadRange(1, 512);
+BENCHMARK(BM_HostDeviceInternedLookup)->ThreadRange(1, 512);
 BENCHMARK(BM_HostDeviceCachedLookup)->ThreadRange(1, 512);
 
 }  // namespace
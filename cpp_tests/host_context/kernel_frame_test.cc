@@ -0,0 +1,243 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Unit tests for TFRT AsyncKernelFrame and KernelFrameBuilder.
+
+#include "tfrt/host_context/kernel_frame.h"
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+
+namespace tfrt {
+namespace {
+
+std::unique_ptr<HostContext> CreateTestHostContext() {
+  return std::make_unique<HostContext>([](const DecodedDiagnostic&) {},
+                                       CreateMallocAllocator(),
+                                       CreateSingleThreadedWorkQueue());
+}
+
+ExecutionContext CreateTestExecutionContext(HostContext* host) {
+  Expected<RCReference<RequestContext>> request_ctx =
+      RequestContextBuilder(host, /*resource_context=*/nullptr).build();
+  EXPECT_FALSE(!request_ctx);
+  return ExecutionContext{std::move(*request_ctx)};
+}
+
+bool IsUnique(const AsyncValueRef<int32_t>& value) {
+  return value.GetAsyncValue()->IsUnique();
+}
+
+TEST(KernelFrameTest, ArgumentsAndResults) {
+  auto host = CreateTestHostContext();
+  KernelFrameBuilder frame(CreateTestExecutionContext(host.get()));
+  auto arg0 = MakeAvailableAsyncValueRef<int32_t>(1);
+  auto arg1 = MakeAvailableAsyncValueRef<int32_t>(2);
+  frame.AddArg(arg0.CopyRCRef());
+  frame.AddArg(arg1.CopyRCRef());
+  frame.SetNumResults(1);
+
+  ASSERT_EQ(frame.GetNumArgs(), 2);
+  ASSERT_EQ(frame.GetNumResults(), 1);
+  EXPECT_EQ(frame.GetArgAt<int32_t>(0), 1);
+  EXPECT_EQ(frame.GetArgAt<int32_t>(1), 2);
+  EXPECT_FALSE(frame.GetResultAt(0));
+
+  frame.EmplaceResult<int32_t>(3);
+  frame.ResetArguments();
+  EXPECT_EQ(frame.GetNumArgs(), 0);
+  EXPECT_TRUE(IsUnique(arg0));
+  EXPECT_TRUE(IsUnique(arg1));
+
+  // The results stay valid after the arguments are reset.
+  RCReference<AsyncValue> result = frame.ReleaseResultAt(0);
+  EXPECT_EQ(result->get<int32_t>(), 3);
+}
+
+TEST(KernelFrameTest, ChainResultsShareReadyChain) {
+  auto host = CreateTestHostContext();
+  KernelFrameBuilder frame(CreateTestExecutionContext(host.get()));
+  frame.SetNumResults(2);
+
+  frame.EmplaceResultAt<Chain>(0);
+  frame.EmplaceResultAt<Chain>(1);
+  RCReference<AsyncValue> result0 = frame.ReleaseResultAt(0);
+  RCReference<AsyncValue> result1 = frame.ReleaseResultAt(1);
+  EXPECT_TRUE(result0->IsAvailable());
+  EXPECT_EQ(result0.get(), result1.get());
+  EXPECT_EQ(result0.get(), GetReadyChain().GetAsyncValue());
+}
+
+TEST(KernelFrameTest, ReuseForSeveralKernels) {
+  auto host = CreateTestHostContext();
+  KernelFrameBuilder frame(CreateTestExecutionContext(host.get()));
+
+  // A kernel with more arguments and results than fit in the inline storage.
+  std::vector<AsyncValueRef<int32_t>> args;
+  frame.Reserve(32, 8);
+  for (int i = 0; i < 32; ++i) {
+    args.push_back(MakeAvailableAsyncValueRef<int32_t>(i));
+    frame.AddArg(args.back().CopyRCRef());
+  }
+  frame.SetNumResults(8);
+  for (int i = 0; i < 8; ++i) frame.EmplaceResultAt<int32_t>(i, 100 + i);
+  frame.ResetArguments();
+  for (int i = 0; i < 8; ++i)
+    EXPECT_EQ(frame.ReleaseResultAt(i)->get<int32_t>(), 100 + i);
+  for (auto& arg : args) EXPECT_TRUE(IsUnique(arg));
+
+  // A kernel with no arguments.
+  frame.SetNumResults(2);
+  ASSERT_EQ(frame.GetNumArgs(), 0);
+  ASSERT_EQ(frame.GetNumResults(), 2);
+  EXPECT_FALSE(frame.GetResultAt(0));
+  EXPECT_FALSE(frame.GetResultAt(1));
+  frame.EmplaceResultAt<int32_t>(0, 7);
+  frame.EmplaceResultAt<int32_t>(1, 8);
+  frame.ResetArguments();
+  EXPECT_EQ(frame.ReleaseResultAt(0)->get<int32_t>(), 7);
+  EXPECT_EQ(frame.ReleaseResultAt(1)->get<int32_t>(), 8);
+
+  // A kernel with one argument and no results.
+  frame.AddArg(args[5].CopyRCRef());
+  frame.SetNumResults(0);
+  ASSERT_EQ(frame.GetNumArgs(), 1);
+  ASSERT_EQ(frame.GetNumResults(), 0);
+  EXPECT_EQ(frame.GetArgAt<int32_t>(0), 5);
+  frame.ResetArguments();
+  EXPECT_TRUE(IsUnique(args[5]));
+}
+
+TEST(KernelFrameTest, CopyAndMove) {
+  auto host = CreateTestHostContext();
+  KernelFrameBuilder frame(CreateTestExecutionContext(host.get()));
+  auto arg = MakeAvailableAsyncValueRef<int32_t>(1);
+  frame.AddArg(arg.CopyRCRef());
+  frame.SetNumResults(1);
+  frame.EmplaceResult<int32_t>(2);
+
+  {
+    AsyncKernelFrame copy(frame);
+    ASSERT_EQ(copy.GetNumArgs(), 1);
+    ASSERT_EQ(copy.GetNumResults(), 1);
+    EXPECT_EQ(copy.GetArgAt<int32_t>(0), 1);
+    EXPECT_EQ(copy.GetResults()[0]->get<int32_t>(), 2);
+    EXPECT_EQ(copy.GetResults()[0].get(), frame.GetResultAt(0).get());
+
+    AsyncKernelFrame moved(std::move(copy));
+    ASSERT_EQ(moved.GetNumArgs(), 1);
+    ASSERT_EQ(moved.GetNumResults(), 1);
+    EXPECT_EQ(moved.GetArgAt<int32_t>(0), 1);
+    EXPECT_FALSE(IsUnique(arg));
+  }
+
+  // Destroying the copies drops their references.
+  frame.ResetArguments();
+  EXPECT_TRUE(IsUnique(arg));
+  EXPECT_TRUE(frame.ReleaseResultAt(0)->IsUnique());
+}
+
+// Counts the references to an attribute section.
+class CountingAttributeSectionOwner : public AttributeSectionOwner {
+ public:
+  void AddAttributeSectionRef() const override { ++num_refs; }
+  void DropAttributeSectionRef() const override { --num_refs; }
+
+  mutable int num_refs = 0;
+};
+
+TEST(KernelFrameTest, BorrowAttributeData) {
+  auto host = CreateTestHostContext();
+  std::vector<uint8_t> attribute_section(64, 1);
+  CountingAttributeSectionOwner owner;
+
+  KernelFrameBuilder frame(CreateTestExecutionContext(host.get()));
+  frame.SetAttributeSection(attribute_section);
+  EXPECT_FALSE(frame.BorrowAttributeData(attribute_section.data(), 16));
+
+  frame.SetAttributeSection(attribute_section, &owner);
+  RCReference<HostBuffer> buffer =
+      frame.BorrowAttributeData(attribute_section.data() + 16, 32);
+  ASSERT_TRUE(buffer);
+  EXPECT_EQ(buffer->data(), attribute_section.data() + 16);
+  EXPECT_EQ(buffer->size(), 32);
+  EXPECT_FALSE(buffer->IsExclusiveDataOwner());
+  EXPECT_EQ(owner.num_refs, 1);
+
+  // Copies of the frame borrow from the same owner.
+  AsyncKernelFrame copy(frame);
+  RCReference<HostBuffer> other = copy.BorrowAttributeData(
+      attribute_section.data(), attribute_section.size());
+  EXPECT_EQ(owner.num_refs, 2);
+
+  buffer.reset();
+  other.reset();
+  EXPECT_EQ(owner.num_refs, 0);
+}
+
+class CountingCallSiteState : public KernelCallSiteState {
+ public:
+  explicit CountingCallSiteState(int* num_live) : num_live_(num_live) {
+    ++*num_live_;
+  }
+  ~CountingCallSiteState() override { --*num_live_; }
+
+  int num_executions = 0;
+
+ private:
+  int* num_live_;
+};
+
+TEST(KernelFrameTest, CallSiteState) {
+  auto host = CreateTestHostContext();
+  KernelFrameBuilder frame(CreateTestExecutionContext(host.get()));
+  EXPECT_EQ(frame.GetCallSiteSlot(), nullptr);
+
+  int num_live = 0;
+  {
+    KernelCallSiteSlot slot;
+    frame.SetCallSiteSlot(&slot);
+    int num_created = 0;
+    auto create = [&] {
+      ++num_created;
+      return std::make_unique<CountingCallSiteState>(&num_live);
+    };
+    for (int i = 0; i < 3; ++i) {
+      auto& state =
+          frame.GetCallSiteSlot()->GetOrCreate<CountingCallSiteState>(create);
+      ++state.num_executions;
+    }
+    auto& state = slot.GetOrCreate<CountingCallSiteState>(create);
+    EXPECT_EQ(state.num_executions, 3);
+    EXPECT_EQ(num_created, 1);
+    EXPECT_EQ(num_live, 1);
+    frame.SetCallSiteSlot(nullptr);
+  }
+  // The slot destroys its state.
+  EXPECT_EQ(num_live, 0);
+}
+
+}  // namespace
+}  // namespace tfrt
@@ -0,0 +1,103 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmarks for the startup cost of kernel registration: adding the
+// statically linked kernels to the registry of a new HostContext and freezing
+// it, as every process does before it opens its first BEF file.
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/host_context/kernel_registry.h"
+
+namespace tfrt {
+namespace {
+
+void AsyncKernel(AsyncKernelFrame* frame) {}
+
+std::unique_ptr<HostContext> CreateTestHostContext() {
+  return std::make_unique<HostContext>([](const DecodedDiagnostic&) {},
+                                       CreateMallocAllocator(),
+                                       CreateSingleThreadedWorkQueue());
+}
+
+// Registers the statically linked basic kernels and test kernels.
+void BM_RegisterStaticKernels(benchmark::State& state) {
+  // The previous host is destroyed while the timing is paused.
+  std::unique_ptr<HostContext> host;
+  for (auto _ : state) {
+    state.PauseTiming();
+    host = CreateTestHostContext();
+    state.ResumeTiming();
+    RegisterStaticKernels(host->GetMutableRegistry());
+    benchmark::DoNotOptimize(
+        host->GetKernelRegistry().GetKernel("tfrt.add.i32"));
+  }
+}
+BENCHMARK(BM_RegisterStaticKernels);
+
+// The names of the synthetic kernels, which outlive the registries.
+const std::vector<std::string>& KernelNames(size_t num_kernels) {
+  static auto* names = new std::vector<std::string>();
+  while (names->size() < num_kernels)
+    names->push_back("test.kernel." + std::to_string(names->size()));
+  return *names;
+}
+
+// Adds the kernels one at a time, copying their names.
+void BM_AddKernels(benchmark::State& state) {
+  const std::vector<std::string>& names = KernelNames(state.range(0));
+  std::unique_ptr<HostContext> host;
+  for (auto _ : state) {
+    state.PauseTiming();
+    host = CreateTestHostContext();
+    state.ResumeTiming();
+    KernelRegistry* registry = host->GetMutableRegistry();
+    for (int i = 0; i < state.range(0); ++i)
+      registry->AddKernel(names[i], AsyncKernel);
+    registry->Freeze();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_AddKernels)->Arg(100)->Arg(1000);
+
+// Adds the kernels as a single table.
+void BM_AddKernelTable(benchmark::State& state) {
+  const std::vector<std::string>& names = KernelNames(state.range(0));
+  std::vector<StaticKernel> table;
+  for (int i = 0; i < state.range(0); ++i)
+    table.emplace_back(names[i], AsyncKernel);
+  std::unique_ptr<HostContext> host;
+  for (auto _ : state) {
+    state.PauseTiming();
+    host = CreateTestHostContext();
+    state.ResumeTiming();
+    KernelRegistry* registry = host->GetMutableRegistry();
+    registry->AddKernelTable(table);
+    registry->Freeze();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_AddKernelTable)->Arg(100)->Arg(1000);
+
+}  // namespace
+}  // namespace tfrt
@@ -0,0 +1,130 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Unit test for TFRT KernelRegistry.
+
+#include "tfrt/host_context/kernel_registry.h"
+
+#include <memory>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+
+namespace tfrt {
+namespace {
+
+void AsyncKernel(AsyncKernelFrame* frame) {}
+void SyncKernel(SyncKernelFrame* frame) {}
+
+constexpr StaticKernel kStaticKernels[] = {
+    {"test.static.async", AsyncKernel},
+    {"test.static.sync", SyncKernel},
+};
+TFRT_STATIC_KERNEL_TABLE(kStaticKernels);
+
+std::unique_ptr<HostContext> CreateTestHostContext() {
+  return std::make_unique<HostContext>([](const DecodedDiagnostic&) {},
+                                       CreateMallocAllocator(),
+                                       CreateSingleThreadedWorkQueue());
+}
+
+TEST(KernelRegistryTest, FrozenLookup) {
+  auto host = CreateTestHostContext();
+  KernelRegistry* registry = host->GetMutableRegistry();
+  for (int i = 0; i < 1000; ++i) {
+    registry->AddKernel("test.async." + std::to_string(i), AsyncKernel);
+    registry->AddSyncKernel("test.sync." + std::to_string(i), SyncKernel);
+  }
+  registry->Freeze();
+
+  for (int i = 0; i < 1000; ++i) {
+    KernelImplementation async_kernel =
+        registry->GetKernel("test.async." + std::to_string(i));
+    ASSERT_TRUE(async_kernel.is<AsyncKernelImplementation>());
+    EXPECT_EQ(async_kernel.get<AsyncKernelImplementation>(), &AsyncKernel);
+
+    KernelImplementation sync_kernel =
+        registry->GetKernel("test.sync." + std::to_string(i));
+    ASSERT_TRUE(sync_kernel.is<SyncKernelImplementation>());
+    EXPECT_EQ(sync_kernel.get<SyncKernelImplementation>(), &SyncKernel);
+  }
+  EXPECT_TRUE(registry->GetKernel("test.async.1000").is<Monostate>());
+  EXPECT_TRUE(registry->GetKernel("test.async").is<Monostate>());
+  EXPECT_TRUE(registry->GetKernel("").is<Monostate>());
+}
+
+TEST(KernelRegistryTest, AddKernelAfterFreeze) {
+  auto host = CreateTestHostContext();
+  KernelRegistry* registry = host->GetMutableRegistry();
+  auto is_async = [&](string_view name) {
+    return registry->GetKernel(name).is<AsyncKernelImplementation>();
+  };
+  auto is_sync = [&](string_view name) {
+    return registry->GetKernel(name).is<SyncKernelImplementation>();
+  };
+
+  registry->AddKernel("test.first", AsyncKernel);
+  registry->Freeze();
+  EXPECT_TRUE(registry->GetKernel("test.second").is<Monostate>());
+
+  registry->AddSyncKernel("test.second", SyncKernel);
+  EXPECT_TRUE(is_async("test.first"));
+  EXPECT_TRUE(is_sync("test.second"));
+
+  registry->Freeze();
+  EXPECT_TRUE(is_async("test.first"));
+  EXPECT_TRUE(is_sync("test.second"));
+}
+
+TEST(KernelRegistryTest, KernelTable) {
+  auto host = CreateTestHostContext();
+  KernelRegistry* registry = host->GetMutableRegistry();
+  auto is_async = [&](string_view name) {
+    return registry->GetKernel(name).is<AsyncKernelImplementation>();
+  };
+  auto is_sync = [&](string_view name) {
+    return registry->GetKernel(name).is<SyncKernelImplementation>();
+  };
+
+  registry->AddKernel("test.added", AsyncKernel);
+  registry->AddKernelTable(kStaticKernels);
+  EXPECT_TRUE(is_async("test.added"));
+  EXPECT_TRUE(is_async("test.static.async"));
+  EXPECT_TRUE(is_sync("test.static.sync"));
+  EXPECT_TRUE(registry->GetKernel("test.static").is<Monostate>());
+
+  registry->Freeze();
+  EXPECT_TRUE(is_async("test.added"));
+  EXPECT_TRUE(is_async("test.static.async"));
+  EXPECT_TRUE(is_sync("test.static.sync"));
+  EXPECT_TRUE(registry->GetKernel("test.static").is<Monostate>());
+}
+
+TEST(KernelRegistryTest, StaticKernelTable) {
+  auto host = CreateTestHostContext();
+  KernelRegistry* registry = host->GetMutableRegistry();
+  RegisterStaticKernels(registry);
+
+  KernelImplementation kernel = registry->GetKernel("test.static.async");
+  ASSERT_TRUE(kernel.is<AsyncKernelImplementation>());
+  EXPECT_EQ(kernel.get<AsyncKernelImplementation>(), &AsyncKernel);
+}
+
+}  // namespace
+}  // namespace tfrt
@@ -18,6 +18,7 @@
 
 #include "tfrt/host_context/parallel_for.h"
 
+#include <atomic>
 #include <chrono>
 #include <thread>
 #include <utility>
@@ -102,6 +103,38 @@ TEST(ParallelForTest, MinBlockSize) {
   ASSERT_EQ(ranges, expected);
 }
 
+TEST(ParallelForTest, AdaptiveBlockSize) {
+  auto host = CreateTestHostContext(4);
+  ParallelFor pfor(CreateTestExecutionContext(host.get()));
+
+  latch barrier(1);
+  mutex mu;
+  std::vector<Range> ranges;
+
+  AsyncValueRef<Chain> done = pfor.Execute(
+      1000, BlockSizes::Adaptive(10), [&](size_t begin, size_t end) {
+        mutex_lock lock(mu);
+        ranges.push_back({begin, end});
+      });
+  done.AndThen([&]() { barrier.count_down(); });
+
+  barrier.wait();
+
+  // The blocks cover the range without overlapping, and only the last block
+  // may be smaller than the minimum.
+  std::sort(ranges.begin(), ranges.end());
+  size_t next = 0;
+  for (const Range& range : ranges) {
+    ASSERT_EQ(range.first, next);
+    if (range.second != 1000) ASSERT_GE(range.second - range.first, 10);
+    next = range.second;
+  }
+  ASSERT_EQ(next, 1000);
+
+  // Blocks shrink towards the end, so there are more blocks than workers.
+  ASSERT_GT(ranges.size(), 4);
+}
+
 TEST(ParallelForTest, BlockTasksCompletion) {
   auto host = CreateTestHostContext(4);
   ParallelFor pfor(CreateTestExecutionContext(host.get()));
@@ -156,4 +189,49 @@ TEST(ParallelForTest, ExecuteNestedParallelism) {
   ASSERT_EQ(ranges, expected);
 }
 
+TEST(ParallelForTest, CoarsenNestedParallelism) {
+  auto host = CreateTestHostContext(4);
+  auto exec_ctx = CreateTestExecutionContext(host.get());
+  ParallelFor pfor(exec_ctx);
+
+  std::atomic<int> inner_blocks{0};
+  std::atomic<int> inner_elements{0};
+  std::atomic<int> innermost_blocks{0};
+
+  // Count down once for the outer region and once for each inner region.
+  latch barrier(5);
+
+  auto inner_compute = [&](size_t start, size_t end) {
+    inner_blocks.fetch_add(1);
+    inner_elements.fetch_add(end - start);
+
+    // Regions nested twice run all blocks in the caller thread.
+    const std::thread::id caller = std::this_thread::get_id();
+    pfor.Execute(
+        10, BlockSizes::Fixed(2),
+        [&, caller](size_t, size_t) {
+          EXPECT_EQ(std::this_thread::get_id(), caller);
+          innermost_blocks.fetch_add(1);
+        },
+        [] {});
+  };
+
+  pfor.Execute(
+      4, BlockSizes::Fixed(1),
+      [&](size_t, size_t) {
+        EXPECT_EQ(ParallelFor::RegionScope::Depth(), 1);
+        pfor.Execute(1000, BlockSizes::Min(1), inner_compute,
+                     [&]() { barrier.count_down(); });
+      },
+      [&]() { barrier.count_down(); });
+
+  barrier.wait();
+
+  // Each inner region is split as if there was a single worker thread.
+  EXPECT_EQ(inner_blocks, 16);
+  EXPECT_EQ(inner_elements, 4000);
+  EXPECT_EQ(innermost_blocks, 80);
+  EXPECT_EQ(ParallelFor::RegionScope::Depth(), 0);
+}
+
 }  // namespace tfrt
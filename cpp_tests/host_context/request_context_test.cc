@@ -17,10 +17,14 @@
 // Unit test for TFRT RequestContext.
 
 #include "gtest/gtest.h"
+#include "tfrt/host_context/async_dispatch.h"
+#include "tfrt/host_context/async_value_ref.h"
 #include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
 #include "tfrt/host_context/execution_context.h"
 #include "tfrt/host_context/host_allocator.h"
 #include "tfrt/host_context/host_context.h"
+#include "tfrt/host_context/request_stats.h"
 
 namespace tfrt {
 namespace {
@@ -60,5 +64,116 @@ TEST(RequestContextTest, ContextData) {
   EXPECT_EQ(expected_request_context.get()->GetDataIfExists<int>(), nullptr);
 }
 
+TEST(RequestContextTest, ExecutionContextAccessors) {
+  auto host = CreateTestHostContext();
+  ResourceContext resource_context;
+  RequestOptions request_options;
+  request_options.use_arena_allocator = true;
+  auto request_context = RequestContextBuilder(host.get(), &resource_context)
+                             .set_request_options(request_options)
+                             .build();
+  ASSERT_FALSE(!request_context);
+  HostAllocator* arena_allocator = request_context.get()->allocator();
+  EXPECT_NE(arena_allocator, host->allocator());
+
+  ExecutionContext exec_ctx(std::move(*request_context));
+  EXPECT_EQ(exec_ctx.host(), host.get());
+  EXPECT_EQ(exec_ctx.allocator(), arena_allocator);
+  EXPECT_EQ(&exec_ctx.work_queue(), &host->work_queue());
+}
+
+TEST(RequestContextTest, Stats) {
+  auto host = std::make_unique<HostContext>(
+      [](const DecodedDiagnostic&) {},
+      CreateRequestAccountingAllocator(CreateMallocAllocator()),
+      CreateSingleThreadedWorkQueue());
+  ResourceContext resource_context;
+  RequestStats stats;
+  RequestOptions request_options;
+  request_options.stats = &stats;
+  auto request_context = RequestContextBuilder(host.get(), &resource_context)
+                             .set_request_options(request_options)
+                             .build();
+  ASSERT_FALSE(!request_context);
+  EXPECT_EQ(request_context.get()->stats(), &stats);
+
+  // Allocations outside of a scope are not attributed to the request.
+  void* ptr = host->allocator()->AllocateBytes(32, 8);
+  host->allocator()->DeallocateBytes(ptr, 32);
+  EXPECT_EQ(stats.snapshot().bytes_allocated, 0);
+
+  {
+    RequestStats::Scope scope(&stats);
+    EXPECT_EQ(RequestStats::Current(), &stats);
+    {
+      // Nested scopes keep attributing to the outer request.
+      RequestStats other_stats;
+      RequestStats::Scope nested_scope(&other_stats);
+      EXPECT_EQ(RequestStats::Current(), &stats);
+    }
+    ptr = host->allocator()->AllocateBytes(64, 8);
+    host->allocator()->DeallocateBytes(ptr, 64);
+    stats.AddKernelsExecuted(3);
+  }
+  EXPECT_EQ(RequestStats::Current(), nullptr);
+
+  ExecutionContext exec_ctx(std::move(*request_context));
+  llvm::SmallVector<RCReference<AsyncValue>, 1> values;
+  values.push_back(MakeAvailableAsyncValueRef<int>(1).CopyRCRef());
+  Await(exec_ctx, values);
+
+  auto snapshot = stats.snapshot();
+  EXPECT_EQ(snapshot.bytes_allocated, 64);
+  EXPECT_EQ(snapshot.kernels_executed, 3);
+  EXPECT_GE(snapshot.cpu_time.count(), 0);
+  EXPECT_GE(snapshot.await_time.count(), 0);
+}
+
+TEST(RequestContextTest, ShareErrors) {
+  int num_diagnostics = 0;
+  auto host = std::make_unique<HostContext>(
+      [&](const DecodedDiagnostic&) { ++num_diagnostics; },
+      CreateMallocAllocator(), CreateSingleThreadedWorkQueue());
+  ResourceContext resource_context;
+  RequestOptions request_options;
+  request_options.share_errors = true;
+  auto request_context = RequestContextBuilder(host.get(), &resource_context)
+                             .set_request_options(request_options)
+                             .build();
+  ASSERT_FALSE(!request_context);
+  ExecutionContext exec_ctx(std::move(*request_context));
+  EXPECT_EQ(GetSharedError(exec_ctx), nullptr);
+
+  auto first = EmitErrorAsync(exec_ctx, "first error");
+  auto second = EmitErrorAsync(exec_ctx, absl::InvalidArgumentError("second"));
+  auto third = EmitErrorAsync(exec_ctx, MakeStringError("third"));
+
+  EXPECT_EQ(GetSharedError(exec_ctx), first.get());
+  EXPECT_EQ(second.get(), first.get());
+  EXPECT_EQ(third.get(), first.get());
+  EXPECT_EQ(second->GetError().message(), "first error");
+  EXPECT_EQ(num_diagnostics, 1);
+}
+
+TEST(RequestContextTest, DoNotShareErrors) {
+  int num_diagnostics = 0;
+  auto host = std::make_unique<HostContext>(
+      [&](const DecodedDiagnostic&) { ++num_diagnostics; },
+      CreateMallocAllocator(), CreateSingleThreadedWorkQueue());
+  ResourceContext resource_context;
+  auto request_context =
+      RequestContextBuilder(host.get(), &resource_context).build();
+  ASSERT_FALSE(!request_context);
+  ExecutionContext exec_ctx(std::move(*request_context));
+
+  auto first = EmitErrorAsync(exec_ctx, "first error");
+  auto second = EmitErrorAsync(exec_ctx, "second error");
+
+  EXPECT_EQ(GetSharedError(exec_ctx), nullptr);
+  EXPECT_NE(second.get(), first.get());
+  EXPECT_EQ(second->GetError().message(), "second error");
+  EXPECT_EQ(num_diagnostics, 2);
+}
+
 }  // namespace
 }  // namespace tfrt
@@ -18,9 +18,11 @@
 
 #include "tfrt/host_context/request_deadline_tracker.h"
 
+#include <atomic>
 #include <chrono>
 
 #include "gtest/gtest.h"
+#include "tfrt/host_context/async_dispatch.h"
 #include "tfrt/host_context/concurrent_work_queue.h"
 #include "tfrt/host_context/host_allocator.h"
 #include "tfrt/host_context/host_context.h"
@@ -54,5 +56,42 @@ TEST(RequestDeadlineTrackerTest, CancelRequest) {
   ASSERT_TRUE((*req_ctx)->IsCancelled());
 }
 
+TEST(RequestDeadlineTrackerTest, CancelRequestWithDeadlineOption) {
+  std::unique_ptr<HostContext> host = CreateTestHostContext(1);
+  RequestDeadlineTracker req_deadline_tracker{host.get()};
+  RequestOptions options;
+  options.deadline = std::chrono::system_clock::now() + 1s;
+  Expected<RCReference<RequestContext>> req_ctx =
+      RequestContextBuilder(host.get(), /*resource_context=*/nullptr)
+          .set_request_options(options)
+          .build();
+  ASSERT_FALSE(!req_ctx);
+
+  req_deadline_tracker.CancelRequestOnDeadline(*req_ctx);
+
+  std::this_thread::sleep_for(2s);
+
+  ASSERT_TRUE((*req_ctx)->IsCancelled());
+}
+
+// Test that work of a request past its deadline sees the request cancelled.
+TEST(RequestDeadlineTrackerTest, ShedExpiredRequest) {
+  std::unique_ptr<HostContext> host = CreateTestHostContext(1);
+  RequestOptions options;
+  options.deadline = std::chrono::system_clock::now() - 1s;
+  Expected<RCReference<RequestContext>> req_ctx =
+      RequestContextBuilder(host.get(), /*resource_context=*/nullptr)
+          .set_request_options(options)
+          .build();
+  ASSERT_FALSE(!req_ctx);
+
+  ExecutionContext exec_ctx(req_ctx->CopyRef());
+  std::atomic<bool> cancelled{false};
+  EnqueueWork(exec_ctx, [&]() { cancelled = exec_ctx.IsCancelled(); });
+  host->Quiesce();
+
+  ASSERT_TRUE(cancelled);
+}
+
 }  // namespace
 }  // namespace tfrt
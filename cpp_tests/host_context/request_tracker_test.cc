@@ -0,0 +1,144 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Unit test for TFRT RequestTracker.
+
+#include "tfrt/host_context/request_tracker.h"
+
+#include <chrono>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+
+namespace tfrt {
+namespace {
+
+std::unique_ptr<HostContext> CreateTestHostContext() {
+  return std::make_unique<HostContext>([](const DecodedDiagnostic&) {},
+                                       CreateMallocAllocator(),
+                                       CreateSingleThreadedWorkQueue());
+}
+
+RCReference<RequestContext> BuildRequest(
+    HostContext* host, ResourceContext* resource_context,
+    RequestTracker* tracker = nullptr, bool track_in_resource_context = true) {
+  RequestOptions options;
+  options.track_in_resource_context = track_in_resource_context;
+  options.request_tracker = tracker;
+  auto request = RequestContextBuilder(host, resource_context)
+                     .set_request_options(std::move(options))
+                     .build();
+  EXPECT_FALSE(!request);
+  return std::move(*request);
+}
+
+TEST(RequestTrackerTest, TracksRequestsOfResourceContext) {
+  auto host = CreateTestHostContext();
+  ResourceContext resource_context;
+  RequestTracker& tracker = resource_context.request_tracker();
+
+  auto first = BuildRequest(host.get(), &resource_context);
+  auto second = BuildRequest(host.get(), &resource_context);
+  auto other = BuildRequest(host.get(), /*resource_context=*/nullptr);
+  EXPECT_EQ(tracker.GetNumPendingRequests(), 2);
+
+  // The request completes with its last reference.
+  auto copy = first;
+  first.reset();
+  EXPECT_EQ(tracker.GetNumPendingRequests(), 2);
+  copy.reset();
+  EXPECT_EQ(tracker.GetNumPendingRequests(), 1);
+
+  EXPECT_FALSE(tracker.DrainFor(std::chrono::milliseconds(1)));
+  second.reset();
+  EXPECT_TRUE(tracker.DrainFor(std::chrono::milliseconds(1)));
+}
+
+TEST(RequestTrackerTest, ResourceContextTrackingIsOptIn) {
+  auto host = CreateTestHostContext();
+  ResourceContext resource_context;
+
+  auto request = BuildRequest(host.get(), &resource_context,
+                              /*tracker=*/nullptr,
+                              /*track_in_resource_context=*/false);
+  EXPECT_EQ(resource_context.request_tracker().GetNumPendingRequests(), 0);
+}
+
+TEST(RequestTrackerTest, TracksRequestsOfOptions) {
+  auto host = CreateTestHostContext();
+  ResourceContext resource_context;
+  RequestTracker tracker;
+
+  auto tracked = BuildRequest(host.get(), &resource_context, &tracker);
+  auto untracked = BuildRequest(host.get(), &resource_context);
+  EXPECT_EQ(tracker.GetNumPendingRequests(), 1);
+  EXPECT_EQ(resource_context.request_tracker().GetNumPendingRequests(), 2);
+
+  tracked.reset();
+  EXPECT_EQ(tracker.GetNumPendingRequests(), 0);
+  EXPECT_EQ(resource_context.request_tracker().GetNumPendingRequests(), 1);
+}
+
+TEST(RequestTrackerTest, DrainWaitsForOtherThreads) {
+  auto host = CreateTestHostContext();
+  RequestTracker tracker;
+
+  auto request = BuildRequest(host.get(), /*resource_context=*/nullptr,
+                              &tracker);
+  std::thread thread([request = std::move(request)]() mutable {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    request.reset();
+  });
+  tracker.Drain();
+  EXPECT_EQ(tracker.GetNumPendingRequests(), 0);
+  thread.join();
+}
+
+TEST(RequestTrackerTest, OnDrained) {
+  auto host = CreateTestHostContext();
+  RequestTracker tracker;
+
+  int num_drained = 0;
+  tracker.OnDrained([&] { ++num_drained; });
+  EXPECT_EQ(num_drained, 1);
+
+  auto request = BuildRequest(host.get(), /*resource_context=*/nullptr,
+                              &tracker);
+  tracker.OnDrained([&] { ++num_drained; });
+  EXPECT_EQ(num_drained, 1);
+  request.reset();
+  EXPECT_EQ(num_drained, 2);
+}
+
+TEST(RequestTrackerTest, CancelPendingRequests) {
+  auto host = CreateTestHostContext();
+  RequestTracker tracker;
+
+  auto pending = BuildRequest(host.get(), /*resource_context=*/nullptr,
+                              &tracker);
+  auto other = BuildRequest(host.get(), /*resource_context=*/nullptr);
+  tracker.CancelPendingRequests();
+  EXPECT_TRUE(pending->IsCancelled());
+  EXPECT_FALSE(other->IsCancelled());
+}
+
+}  // namespace
+}  // namespace tfrt
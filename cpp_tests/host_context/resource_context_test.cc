@@ -19,6 +19,8 @@
 #include "tfrt/host_context/resource_context.h"
 
 #include <optional>
+#include <thread>
+#include <vector>
 
 #include "gtest/gtest.h"
 #include "tfrt/support/string_util.h"
@@ -99,5 +101,52 @@ TEST(ResourceContextTest, DestructionOrder) {
   }
 }
 
+TEST(ResourceContextTest, DeleteAndGet) {
+  ResourceContext resource_context;
+  resource_context.CreateResource<SomeResource>("some_name", 41);
+  resource_context.CreateResource<SomeResource>("other_name", 42);
+  resource_context.DeleteResource("some_name");
+
+  EXPECT_FALSE(
+      resource_context.GetResource<SomeResource>("some_name").has_value());
+  EXPECT_EQ(
+      resource_context.GetResourceOrDie<SomeResource>("other_name")->GetData(),
+      42);
+}
+
+TEST(ResourceContextTest, GetWhileCreating) {
+  constexpr int kNumThreads = 4;
+  constexpr int kNumResources = 100;
+  ResourceContext resource_context;
+
+  // Every thread reads the resources while they are created by all threads.
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&] {
+      for (int i = 0; i < kNumResources; ++i) {
+        SomeResource* rc = resource_context.GetOrCreateResource<SomeResource>(
+            StrCat("resource", i), i);
+        EXPECT_EQ(rc->GetData(), i);
+        std::optional<SomeResource*> resource =
+            resource_context.GetResource<SomeResource>(StrCat("resource", i));
+        ASSERT_TRUE(resource.has_value());
+        EXPECT_EQ(*resource, rc);
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+}
+
+TEST(ResourceContextTest, HandleResolvesOnceCreated) {
+  ResourceContext resource_context;
+  ResourceHandle<SomeResource> handle(&resource_context, "some_name");
+  EXPECT_EQ(handle.get(), nullptr);
+
+  SomeResource* rc =
+      resource_context.CreateResource<SomeResource>("some_name", 41);
+  EXPECT_EQ(handle.get(), rc);
+  EXPECT_EQ(handle.get()->GetData(), 41);
+}
+
 }  // namespace
 }  // namespace tfrt
@@ -0,0 +1,120 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Unit test for TFRT SharedMemoryAllocator.
+
+#include "tfrt/host_context/shared_memory_allocator.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include <unistd.h>
+
+#include "gtest/gtest.h"
+#include "tfrt/host_context/host_buffer.h"
+
+namespace tfrt {
+namespace {
+
+std::string GetSegmentName(const char* test_name) {
+  return "/tfrt_shm_test_" + std::to_string(getpid()) + "_" + test_name;
+}
+
+TEST(SharedMemoryAllocatorTest, AllocateBytesWithAlignment) {
+  auto allocator = SharedMemoryAllocator::Create(GetSegmentName("align"),
+                                                 /*capacity=*/1 << 20);
+  ASSERT_TRUE(!!allocator) << toString(allocator.takeError());
+
+  for (size_t alignment : {1, 64, 4096}) {
+    void* ptr = (*allocator)->AllocateBytes(100, alignment);
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr) % alignment, 0);
+    (*allocator)->DeallocateBytes(ptr, 100);
+  }
+}
+
+TEST(SharedMemoryAllocatorTest, ReusesFreedRanges) {
+  auto allocator = SharedMemoryAllocator::Create(GetSegmentName("reuse"),
+                                                 /*capacity=*/4096);
+  ASSERT_TRUE(!!allocator) << toString(allocator.takeError());
+
+  void* first = (*allocator)->AllocateBytes(2048, 64);
+  void* second = (*allocator)->AllocateBytes(2048, 64);
+  ASSERT_NE(first, nullptr);
+  ASSERT_NE(second, nullptr);
+  EXPECT_EQ((*allocator)->AllocateBytes(64, 64), nullptr);
+
+  // The freed ranges coalesce, so the whole capacity is available again.
+  (*allocator)->DeallocateBytes(second, 2048);
+  (*allocator)->DeallocateBytes(first, 2048);
+  void* whole = (*allocator)->AllocateBytes(4096, 64);
+  EXPECT_EQ(whole, first);
+  (*allocator)->DeallocateBytes(whole, 4096);
+}
+
+TEST(SharedMemoryAllocatorTest, OpenedSegmentSharesBuffers) {
+  auto creator = SharedMemoryAllocator::Create(GetSegmentName("share"),
+                                               /*capacity=*/1 << 16);
+  ASSERT_TRUE(!!creator) << toString(creator.takeError());
+  auto opener = SharedMemoryAllocator::Open((*creator)->name());
+  ASSERT_TRUE(!!opener) << toString(opener.takeError());
+  EXPECT_EQ((*opener)->AllocateBytes(64, 64), nullptr);
+
+  auto buffer = HostBuffer::CreateUninitialized(/*size=*/256, /*alignment=*/64,
+                                                creator->get());
+  ASSERT_TRUE(buffer);
+  std::memset(buffer->data(), 42, buffer->size());
+
+  auto descriptor = (*creator)->GetDescriptor(*buffer);
+  ASSERT_TRUE(!!descriptor) << toString(descriptor.takeError());
+  EXPECT_EQ(descriptor->segment_name, (*creator)->name());
+  EXPECT_EQ(descriptor->size, 256);
+
+  // The opened segment is a separate mapping of the same memory.
+  auto shared = (*opener)->CreateHostBuffer(*descriptor);
+  ASSERT_TRUE(!!shared) << toString(shared.takeError());
+  EXPECT_NE((*shared)->data(), buffer->data());
+  auto data = (*shared)->CastAs<uint8_t>();
+  ASSERT_EQ(data.size(), 256);
+  EXPECT_EQ(data.front(), 42);
+  EXPECT_EQ(data.back(), 42);
+}
+
+TEST(SharedMemoryAllocatorTest, RejectsForeignBuffersAndDescriptors) {
+  auto allocator = SharedMemoryAllocator::Create(GetSegmentName("foreign"),
+                                                 /*capacity=*/4096);
+  ASSERT_TRUE(!!allocator) << toString(allocator.takeError());
+
+  char data[16];
+  auto buffer = HostBuffer::CreateFromExternal(data, sizeof(data),
+                                               [](void* ptr, size_t size) {});
+  auto descriptor = (*allocator)->GetDescriptor(*buffer);
+  EXPECT_FALSE(!!descriptor);
+  consumeError(descriptor.takeError());
+
+  auto shared = (*allocator)->CreateHostBuffer(
+      {(*allocator)->name(), /*offset=*/64, /*size=*/1 << 20});
+  EXPECT_FALSE(!!shared);
+  consumeError(shared.takeError());
+
+  auto missing = SharedMemoryAllocator::Open(GetSegmentName("missing"));
+  EXPECT_FALSE(!!missing);
+  consumeError(missing.takeError());
+}
+
+}  // namespace
+}  // namespace tfrt
@@ -0,0 +1,122 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Unit test for TFRT SharedWorkQueue.
+
+#include "tfrt/host_context/shared_work_queue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "tfrt/host_context/async_dispatch.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/support/mutex.h"
+
+namespace tfrt {
+namespace {
+
+TEST(SharedWorkQueueTest, HostContextsShareWorkQueueAndAllocator) {
+  SharedWorkQueue shared(CreateMultiThreadedWorkQueue(2, 2));
+  std::shared_ptr<HostAllocator> allocator = CreateMallocAllocator();
+
+  std::vector<std::unique_ptr<HostContext>> hosts;
+  for (const char* name : {"tenant_a", "tenant_b", "tenant_c"}) {
+    hosts.push_back(std::make_unique<HostContext>(
+        [](const DecodedDiagnostic&) {}, CreateSharedAllocator(allocator),
+        shared.CreateTenantWorkQueue(name)));
+  }
+
+  std::atomic<int> count{0};
+  for (auto& host : hosts) {
+    for (int i = 0; i < 100; ++i) {
+      EnqueueWork(host.get(), [&count] { ++count; });
+    }
+    void* ptr = host->AllocateBytes(64, 16);
+    EXPECT_NE(ptr, nullptr);
+    host->DeallocateBytes(ptr, 64);
+  }
+  for (auto& host : hosts) host->Quiesce();
+
+  EXPECT_EQ(count.load(), 300);
+  EXPECT_EQ(hosts[0]->GetNumWorkerThreads(), 2);
+}
+
+TEST(SharedWorkQueueTest, TasksAreDispatchedByWeight) {
+  SharedWorkQueue shared(CreateMultiThreadedWorkQueue(1, 1),
+                         /*max_in_flight=*/1);
+  auto light = shared.CreateTenantWorkQueue("light", /*weight=*/1);
+  auto heavy = shared.CreateTenantWorkQueue("heavy", /*weight=*/2);
+
+  // Occupy the only slot until all the tasks are queued.
+  std::atomic<bool> release{false};
+  light->AddTask([&release] {
+    while (!release) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  });
+
+  mutex mu;
+  std::vector<char> order;
+  for (int i = 0; i < 30; ++i) {
+    light->AddTask([&] {
+      mutex_lock lock(mu);
+      order.push_back('l');
+    });
+    heavy->AddTask([&] {
+      mutex_lock lock(mu);
+      order.push_back('h');
+    });
+  }
+  release = true;
+  light->Quiesce();
+  heavy->Quiesce();
+
+  ASSERT_EQ(order.size(), 60);
+  // While both tenants have pending tasks, the heavy tenant gets two of every
+  // three slots.
+  int num_heavy = std::count(order.begin(), order.begin() + 30, 'h');
+  EXPECT_GE(num_heavy, 19);
+  EXPECT_LE(num_heavy, 21);
+}
+
+TEST(SharedWorkQueueTest, AwaitInTaskReleasesSlot) {
+  SharedWorkQueue shared(CreateMultiThreadedWorkQueue(2, 2),
+                         /*max_in_flight=*/1);
+  auto tenant = shared.CreateTenantWorkQueue("tenant");
+  ConcurrentWorkQueue* queue = tenant.get();
+
+  std::atomic<bool> done{false};
+  queue->AddTask([queue, &done] {
+    auto value = MakeUnconstructedAsyncValueRef<int>();
+    // This task can only run once the awaiting task gives up its slot.
+    queue->AddTask([value = value.CopyRef()] { value.emplace(42); });
+    RCReference<AsyncValue> values[] = {value.CopyRCRef()};
+    queue->Await(values);
+    EXPECT_EQ(value.get(), 42);
+    done = true;
+  });
+  tenant->Quiesce();
+
+  EXPECT_TRUE(done);
+}
+
+}  // namespace
+}  // namespace tfrt
@@ -0,0 +1,119 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Unit test for TFRT TaskFunction.
+
+#include "tfrt/host_context/task_function.h"
+
+#include <array>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "llvm/ADT/FunctionExtras.h"
+
+namespace tfrt {
+namespace {
+
+// Counts the live copies of a callable.
+struct Counted {
+  explicit Counted(int* live) : live(live) { ++*live; }
+  Counted(Counted&& other) noexcept : live(other.live) { ++*live; }
+  ~Counted() { --*live; }
+  int* live;
+};
+
+static_assert(sizeof(TaskFunction) == 64, "TaskFunction is a cache line");
+
+TEST(TaskFunctionTest, EmptyFunction) {
+  TaskFunction task;
+  EXPECT_FALSE(task);
+  EXPECT_TRUE(task.IsInline());
+  TaskFunction null_task = nullptr;
+  EXPECT_FALSE(null_task);
+}
+
+TEST(TaskFunctionTest, ExecutorClosuresAreInline) {
+  // A continuation of the executor: the executor, a stream and the kernels.
+  int stream_id = 0, calls = 0;
+  std::vector<unsigned> kernel_ids = {1, 2, 3};
+  TaskFunction task([&calls, stream_id, kernel_ids = std::move(kernel_ids)]() {
+    calls += stream_id + static_cast<int>(kernel_ids.size());
+  });
+  EXPECT_TRUE(task.IsInline());
+  task();
+  EXPECT_EQ(calls, 3);
+
+  // Wrapped unique_functions fit as well.
+  llvm::unique_function<void()> function = [&calls]() { ++calls; };
+  TaskFunction wrapped(std::move(function));
+  EXPECT_TRUE(wrapped.IsInline());
+  wrapped();
+  EXPECT_EQ(calls, 4);
+}
+
+TEST(TaskFunctionTest, LargeClosuresAreOnHeap) {
+  std::array<int, 32> values = {};
+  values[31] = 7;
+  int result = 0;
+  TaskFunction task([&result, values]() { result = values[31]; });
+  EXPECT_FALSE(task.IsInline());
+
+  TaskFunction moved = std::move(task);
+  EXPECT_FALSE(task);  // NOLINT(bugprone-use-after-move)
+  moved();
+  EXPECT_EQ(result, 7);
+}
+
+TEST(TaskFunctionTest, DestroysCallables) {
+  int live = 0;
+  {
+    TaskFunction inline_task([counted = Counted(&live)]() {});
+    TaskFunction heap_task(
+        [counted = Counted(&live), values = std::array<int, 32>()]() {});
+    EXPECT_TRUE(inline_task.IsInline());
+    EXPECT_FALSE(heap_task.IsInline());
+    EXPECT_EQ(live, 2);
+
+    // Moving relocates the callables without leaving copies behind.
+    TaskFunction moved_inline = std::move(inline_task);
+    TaskFunction moved_heap = std::move(heap_task);
+    EXPECT_EQ(live, 2);
+
+    // Assignment destroys the previous callable.
+    moved_inline = std::move(moved_heap);
+    EXPECT_EQ(live, 1);
+    moved_inline = nullptr;
+    EXPECT_EQ(live, 0);
+  }
+  EXPECT_EQ(live, 0);
+}
+
+TEST(TaskFunctionTest, MoveOnlyCaptures) {
+  auto value = std::make_unique<int>(42);
+  int result = 0;
+  TaskFunction task(
+      [&result, value = std::move(value)]() { result = *value; });
+  std::vector<TaskFunction> tasks;
+  tasks.push_back(std::move(task));
+  tasks.emplace_back();
+  tasks.front()();
+  EXPECT_EQ(result, 42);
+}
+
+}  // namespace
+}  // namespace tfrt
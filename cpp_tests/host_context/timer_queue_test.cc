@@ -21,6 +21,7 @@
 #include <chrono>
 #include <ctime>
 #include <memory>
+#include <vector>
 
 #include "gtest/gtest.h"
 
@@ -93,5 +94,55 @@ TEST(TimerQueueTest, TimerQueueTimerCancelled) {
   ASSERT_FALSE(expired_2);
 }
 
+// This test checks that timers across several wheel levels expire in deadline
+// order, and never before their deadline.
+TEST(TimerQueueTest, TimerQueueTimersExpireInOrder) {
+  constexpr int kNumTimers = 40;
+  std::vector<std::chrono::system_clock::time_point> deadlines(kNumTimers);
+  std::vector<std::chrono::system_clock::time_point> expirations(kNumTimers);
+  std::atomic<int> num_expired{0};
+  std::atomic<int> last_expired{-1};
+  std::atomic<bool> in_order{true};
+
+  {
+    TimerQueue tq;
+    std::vector<TimerQueue::TimerHandle> timers;
+    auto now = std::chrono::system_clock::now();
+    // Schedule the timers in reverse order, 25ms apart.
+    for (int i = kNumTimers - 1; i >= 0; --i) {
+      deadlines[i] = now + (i + 1) * 25ms;
+      timers.push_back(tq.ScheduleTimerAt(deadlines[i], [&, i]() {
+        expirations[i] = std::chrono::system_clock::now();
+        if (last_expired.exchange(i) >= i) in_order = false;
+        num_expired++;
+      }));
+    }
+    std::this_thread::sleep_for(kNumTimers * 25ms + 500ms);
+  }
+
+  ASSERT_EQ(num_expired, kNumTimers);
+  EXPECT_TRUE(in_order);
+  for (int i = 0; i < kNumTimers; ++i) EXPECT_GE(expirations[i], deadlines[i]);
+}
+
+// This test checks that cancelled timers are removed from the queue right away.
+TEST(TimerQueueTest, TimerQueueCancelledTimerIsReleased) {
+  TimerQueue tq;
+  auto payload = std::make_shared<int>(0);
+
+  auto timer = tq.ScheduleTimer(1h, [payload]() {});
+  EXPECT_EQ(payload.use_count(), 2);
+  tq.CancelTimer(timer);
+  timer.reset();
+  EXPECT_EQ(payload.use_count(), 1);
+
+  // Cancelling a timer that expired already is a no-op.
+  std::atomic<bool> expired{false};
+  timer = tq.ScheduleTimer(10ms, [&]() { expired = true; });
+  std::this_thread::sleep_for(500ms);
+  ASSERT_TRUE(expired);
+  tq.CancelTimer(timer);
+}
+
 }  // namespace
 }  // namespace tfrt
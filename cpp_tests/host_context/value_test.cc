@@ -64,6 +64,34 @@ TEST(ValueTest, InPlace) {
   ASSERT_FALSE(v2.HasValue());
 }
 
+// A type stored in place that counts its destructions.
+struct CountedType {
+  explicit CountedType(int* count) : count(count) {}
+  CountedType(CountedType&& other) : count(other.count) {
+    other.count = nullptr;
+  }
+  ~CountedType() {
+    if (count) ++*count;
+  }
+
+  int* count;
+};
+
+TEST(ValueTest, InPlaceNonTrivial) {
+  int count = 0;
+  Value v1{CountedType(&count)};
+  static_assert(Value::IsInPlace<CountedType>(), "");
+
+  Value v2{std::move(v1)};
+  ASSERT_FALSE(v1.HasValue());  // NOLINT Disable use after move warning
+  ASSERT_EQ(v2.get<CountedType>().count, &count);
+  ASSERT_EQ(count, 0);
+
+  v2.reset();
+  ASSERT_FALSE(v2.HasValue());
+  ASSERT_EQ(count, 1);
+}
+
 struct BigType1 {
   explicit BigType1(int v) : v(v) {}
 
@@ -0,0 +1,205 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Unit test for TFRT DecompressingInputStream.
+
+#include "tfrt/io/decompressing_input_stream.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "tfrt/cpp_tests/test_util.h"
+#include "tfrt/host_context/host_context.h"
+#include "zlib.h"
+
+namespace tfrt {
+namespace io {
+namespace {
+
+// A stream whose contents are a string in memory.
+class StringInputStream : public InputStream {
+ public:
+  explicit StringInputStream(std::string contents)
+      : contents_(std::move(contents)) {}
+
+  llvm::Expected<size_t> Read(char* buf, size_t max_count) override {
+    size_t count = std::min(max_count, contents_.size() - pos_);
+    std::memcpy(buf, contents_.data() + pos_, count);
+    pos_ += count;
+    return count;
+  }
+
+  llvm::Expected<size_t> Tell() override { return pos_; }
+
+ private:
+  std::string contents_;
+  size_t pos_ = 0;
+};
+
+// Compresses `data` with deflate, in the gzip format for `window_bits` 31 and
+// as raw deflate data for -15.
+std::string Deflate(const std::string& data, int window_bits) {
+  z_stream stream;
+  std::memset(&stream, 0, sizeof(stream));
+  deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, window_bits,
+               /*memLevel=*/8, Z_DEFAULT_STRATEGY);
+  std::string result(deflateBound(&stream, data.size()), '\0');
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+  stream.avail_in = data.size();
+  stream.next_out = reinterpret_cast<Bytef*>(&result[0]);
+  stream.avail_out = result.size();
+  deflate(&stream, Z_FINISH);
+  result.resize(stream.total_out);
+  deflateEnd(&stream);
+  return result;
+}
+
+template <typename T>
+void AppendInteger(T value, std::string* result) {
+  result->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// Compresses `data` into a BGZF frame, as written by bgzip.
+std::string MakeFrame(const std::string& data) {
+  const std::string deflated = Deflate(data, -MAX_WBITS);
+  std::string frame("\x1f\x8b\x08\x04", 4);
+  AppendInteger<uint32_t>(0, &frame);  // MTIME
+  frame.append("\x00\xff", 2);         // XFL, OS
+  AppendInteger<uint16_t>(6, &frame);  // XLEN
+  frame.append("BC");
+  AppendInteger<uint16_t>(2, &frame);
+  AppendInteger<uint16_t>(18 + deflated.size() + 8 - 1, &frame);
+  frame.append(deflated);
+  AppendInteger<uint32_t>(
+      crc32(0, reinterpret_cast<const Bytef*>(data.data()), data.size()),
+      &frame);
+  AppendInteger<uint32_t>(data.size(), &frame);
+  return frame;
+}
+
+std::string MakeData(size_t size) {
+  std::string data;
+  for (size_t i = 0; i < size; ++i) data.push_back('a' + (i * i) % 7);
+  return data;
+}
+
+// Reads `stream` to the end in reads of `read_size` bytes.
+llvm::Expected<std::string> ReadAll(InputStream* stream, size_t read_size) {
+  std::string result;
+  std::string buffer(read_size, '\0');
+  while (true) {
+    auto count = stream->Read(&buffer[0], read_size);
+    if (!count) return count.takeError();
+    if (*count == 0) return result;
+    result.append(buffer, 0, *count);
+  }
+}
+
+DecompressingInputStream::Options SmallOptions() {
+  DecompressingInputStream::Options options;
+  options.num_frames_in_flight = 3;
+  options.input_buffer_size = 100;
+  return options;
+}
+
+TEST(DecompressingInputStreamTest, ReadGzipMembers) {
+  auto host = CreateHostContext();
+  const std::string first = MakeData(300000);
+  const std::string second = MakeData(5000);
+  DecompressingInputStream stream(
+      std::make_unique<StringInputStream>(Deflate(first, MAX_WBITS + 16) +
+                                          Deflate(second, MAX_WBITS + 16)),
+      host.get(), SmallOptions());
+
+  auto result = ReadAll(&stream, 777);
+  ASSERT_TRUE(!!result) << toString(result.takeError());
+  EXPECT_EQ(*result, first + second);
+  EXPECT_EQ(*stream.Tell(), first.size() + second.size());
+}
+
+TEST(DecompressingInputStreamTest, ReadZlib) {
+  auto host = CreateHostContext();
+  const std::string data = MakeData(3000);
+  DecompressingInputStream stream(
+      std::make_unique<StringInputStream>(Deflate(data, MAX_WBITS)),
+      host.get());
+
+  auto result = ReadAll(&stream, 50);
+  ASSERT_TRUE(!!result) << toString(result.takeError());
+  EXPECT_EQ(*result, data);
+}
+
+TEST(DecompressingInputStreamTest, ReadFrames) {
+  auto host = CreateHostContext();
+  std::string file;
+  std::string data;
+  for (int i = 0; i < 10; ++i) {
+    const std::string frame_data = MakeData(60000 + i);
+    file.append(MakeFrame(frame_data));
+    data.append(frame_data);
+  }
+  // The empty frame that marks the end of a BGZF file.
+  file.append(MakeFrame(""));
+  // A gzip member that is not a frame.
+  const std::string tail = MakeData(2000);
+  file.append(Deflate(tail, MAX_WBITS + 16));
+
+  DecompressingInputStream stream(std::make_unique<StringInputStream>(file),
+                                  host.get(), SmallOptions());
+  auto result = ReadAll(&stream, 10000);
+  ASSERT_TRUE(!!result) << toString(result.takeError());
+  EXPECT_EQ(*result, data + tail);
+}
+
+TEST(DecompressingInputStreamTest, CorruptedFrame) {
+  auto host = CreateHostContext();
+  const std::string data = MakeData(1000);
+  std::string file = MakeFrame(data) + MakeFrame(data);
+  // Corrupt the checksum of the second frame.
+  file[file.size() - 8] ^= 1;
+
+  DecompressingInputStream stream(std::make_unique<StringInputStream>(file),
+                                  host.get());
+  std::string buffer(5000, '\0');
+  auto count = stream.Read(&buffer[0], buffer.size());
+  ASSERT_TRUE(!!count) << toString(count.takeError());
+  EXPECT_EQ(buffer.substr(0, *count), data);
+
+  count = stream.Read(&buffer[0], buffer.size());
+  ASSERT_FALSE(!!count);
+  EXPECT_EQ(toString(count.takeError()),
+            "failed to decompress stream: gzip frame checksum mismatch");
+}
+
+TEST(DecompressingInputStreamTest, TruncatedStream) {
+  auto host = CreateHostContext();
+  std::string file = Deflate(MakeData(5000), MAX_WBITS + 16);
+  file.resize(file.size() / 2);
+
+  DecompressingInputStream stream(std::make_unique<StringInputStream>(file),
+                                  host.get());
+  auto result = ReadAll(&stream, 100000);
+  ASSERT_FALSE(!!result);
+  EXPECT_EQ(toString(result.takeError()), "truncated compressed stream");
+}
+
+}  // namespace
+}  // namespace io
+}  // namespace tfrt
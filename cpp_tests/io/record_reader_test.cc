@@ -0,0 +1,192 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Unit test for TFRT RecordReader.
+
+#include "tfrt/io/record_reader.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "tfrt/support/crc32c.h"
+
+namespace tfrt {
+namespace io {
+namespace {
+
+// A file whose contents are a string in memory.
+class StringFile : public RandomAccessFile {
+ public:
+  explicit StringFile(std::string contents) : contents_(std::move(contents)) {}
+
+  llvm::Expected<size_t> Read(char* buf, size_t max_count,
+                              size_t offset) const override {
+    if (offset >= contents_.size()) return 0;
+    size_t count = std::min(max_count, contents_.size() - offset);
+    std::memcpy(buf, contents_.data() + offset, count);
+    return count;
+  }
+
+ private:
+  std::string contents_;
+};
+
+// A stream whose contents are a string in memory.
+class StringInputStream : public InputStream {
+ public:
+  explicit StringInputStream(std::string contents)
+      : contents_(std::move(contents)) {}
+
+  llvm::Expected<size_t> Read(char* buf, size_t max_count) override {
+    size_t count = std::min(max_count, contents_.size() - pos_);
+    std::memcpy(buf, contents_.data() + pos_, count);
+    pos_ += count;
+    return count;
+  }
+
+  llvm::Expected<size_t> Tell() override { return pos_; }
+
+ private:
+  std::string contents_;
+  size_t pos_ = 0;
+};
+
+template <typename T>
+void AppendInteger(T value, std::string* file) {
+  file->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void AppendRecord(const std::string& data, std::string* file) {
+  uint64_t length = data.size();
+  AppendInteger(length, file);
+  AppendInteger(crc32c::Mask(crc32c::Value(
+                    reinterpret_cast<const char*>(&length), sizeof(length))),
+                file);
+  file->append(data);
+  AppendInteger(crc32c::Mask(crc32c::Value(data.data(), data.size())), file);
+}
+
+std::string MakeRecordFile(const std::vector<std::string>& records) {
+  std::string file;
+  for (const auto& record : records) AppendRecord(record, &file);
+  return file;
+}
+
+TEST(RecordReaderTest, ReadRecordsInOrder) {
+  RecordReader reader(std::make_unique<StringFile>(
+      MakeRecordFile({"first", "", "third record"})));
+
+  uint64_t offset = 0;
+  std::vector<std::string> records(4);
+  auto count = reader.ReadRecords(&offset, records);
+  ASSERT_TRUE(!!count) << toString(count.takeError());
+  EXPECT_EQ(*count, 3);
+  EXPECT_EQ(records[0], "first");
+  EXPECT_EQ(records[1], "");
+  EXPECT_EQ(records[2], "third record");
+
+  std::string record;
+  auto read = reader.ReadRecord(&offset, &record);
+  ASSERT_TRUE(!!read) << toString(read.takeError());
+  EXPECT_FALSE(*read);
+}
+
+TEST(RecordReaderTest, ReadRecordsAtIndex) {
+  RecordReader reader(
+      std::make_unique<StringFile>(MakeRecordFile({"a", "bb", "ccc"})));
+
+  auto index = reader.BuildIndex();
+  ASSERT_TRUE(!!index) << toString(index.takeError());
+  EXPECT_THAT(*index, ::testing::ElementsAre(0, 17, 35));
+
+  std::vector<uint64_t> offsets = {(*index)[2], (*index)[0]};
+  std::vector<std::string> records(2);
+  ASSERT_FALSE(reader.ReadRecordsAt(offsets, records));
+  EXPECT_EQ(records[0], "ccc");
+  EXPECT_EQ(records[1], "a");
+}
+
+TEST(RecordReaderTest, CorruptedData) {
+  std::string file = MakeRecordFile({"record"});
+  file[RecordReader::kHeaderSize] ^= 1;
+
+  uint64_t offset = 0;
+  std::string record;
+  RecordReader reader(std::make_unique<StringFile>(file));
+  auto read = reader.ReadRecord(&offset, &record);
+  ASSERT_FALSE(!!read);
+  EXPECT_EQ(toString(read.takeError()), "corrupted record at offset 0");
+
+  RecordReader unverified_reader(std::make_unique<StringFile>(file),
+                                 {/*verify_checksums=*/false});
+  read = unverified_reader.ReadRecord(&offset, &record);
+  ASSERT_TRUE(!!read) << toString(read.takeError());
+  EXPECT_TRUE(*read);
+  EXPECT_EQ(record, "secord");
+}
+
+TEST(RecordReaderTest, TruncatedRecord) {
+  std::string file = MakeRecordFile({"record"});
+  file.resize(file.size() - 1);
+
+  uint64_t offset = 0;
+  std::string record;
+  RecordReader reader(std::make_unique<StringFile>(file));
+  auto read = reader.ReadRecord(&offset, &record);
+  ASSERT_FALSE(!!read);
+  EXPECT_EQ(toString(read.takeError()), "truncated record at offset 0");
+}
+
+TEST(SequentialRecordReaderTest, ReadRecordsInOrder) {
+  SequentialRecordReader reader(std::make_unique<StringInputStream>(
+      MakeRecordFile({"first", "", "third record"})));
+
+  std::vector<std::string> records(2);
+  auto count = reader.ReadRecords(records);
+  ASSERT_TRUE(!!count) << toString(count.takeError());
+  EXPECT_EQ(*count, 2);
+  EXPECT_EQ(records[0], "first");
+  EXPECT_EQ(records[1], "");
+
+  count = reader.ReadRecords(records);
+  ASSERT_TRUE(!!count) << toString(count.takeError());
+  EXPECT_EQ(*count, 1);
+  EXPECT_EQ(records[0], "third record");
+}
+
+TEST(SequentialRecordReaderTest, CorruptedData) {
+  std::string file = MakeRecordFile({"a", "record"});
+  file[2 * RecordReader::kHeaderSize + RecordReader::kFooterSize + 1] ^= 1;
+
+  SequentialRecordReader reader(std::make_unique<StringInputStream>(file));
+  std::string record;
+  auto read = reader.ReadRecord(&record);
+  ASSERT_TRUE(!!read) << toString(read.takeError());
+  EXPECT_EQ(record, "a");
+  read = reader.ReadRecord(&record);
+  ASSERT_FALSE(!!read);
+  EXPECT_EQ(toString(read.takeError()), "corrupted record at offset 17");
+}
+
+}  // namespace
+}  // namespace io
+}  // namespace tfrt
@@ -0,0 +1,45 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmarks for recording into the in-process metrics.
+
+#include "benchmark/benchmark.h"
+#include "tfrt/metrics/in_process_metrics.h"
+
+namespace tfrt {
+namespace metrics {
+namespace {
+
+static void BM_ShardedCounterIncrement(benchmark::State& state) {
+  static auto* counter = new ShardedCounter;
+  for (auto _ : state) counter->Increment();
+}
+BENCHMARK(BM_ShardedCounterIncrement)->ThreadRange(1, 8);
+
+static void BM_ShardedHistogramRecord(benchmark::State& state) {
+  static auto* histogram = new ShardedHistogram(
+      Buckets::Explicit({64, 256, 1024, 4096, 16384, 65536, 262144, 1048576}));
+  double value = 0;
+  for (auto _ : state) {
+    histogram->Record(value);
+    value = value < 2e6 ? value * 2 + 1 : 0;
+  }
+}
+BENCHMARK(BM_ShardedHistogramRecord)->ThreadRange(1, 8);
+
+}  // namespace
+}  // namespace metrics
+}  // namespace tfrt
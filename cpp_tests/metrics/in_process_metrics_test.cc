@@ -0,0 +1,132 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Unit test for the in-process metrics registry.
+
+#include "tfrt/metrics/in_process_metrics.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace tfrt {
+namespace metrics {
+namespace {
+
+using ::testing::ElementsAre;
+
+TEST(InProcessMetricsTest, CounterMergesShards) {
+  InProcessMetricsRegistry registry;
+  Counter* counter = registry.NewCounter("/test/counter");
+  EXPECT_EQ(registry.NewCounter("/test/counter"), counter);
+
+  constexpr int kNumThreads = 8;
+  constexpr int kIncrements = 10000;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([counter] {
+      for (int j = 0; j < kIncrements; ++j) counter->Increment();
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  EXPECT_EQ(registry.Snapshot().counters["/test/counter"],
+            kNumThreads * kIncrements);
+}
+
+TEST(InProcessMetricsTest, ThreadsOutnumberShards) {
+  ShardedCounter counter;
+  ShardedHistogram histogram(Buckets::Explicit({1}));
+
+  // Keeps all threads alive until each has recorded, so that some of them
+  // share the last shard.
+  const int num_threads = GetNumMetricShards() + 4;
+  constexpr int kIncrements = 1000;
+  std::atomic<int> num_done{0};
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; ++i) {
+    threads.emplace_back([&] {
+      for (int j = 0; j < kIncrements; ++j) {
+        counter.Increment();
+        histogram.Record(2);
+      }
+      num_done.fetch_add(1);
+      while (num_done.load() != num_threads) std::this_thread::yield();
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  EXPECT_EQ(counter.value(), num_threads * kIncrements);
+  HistogramSnapshot snapshot = histogram.snapshot();
+  EXPECT_THAT(snapshot.counts, ElementsAre(0, num_threads * kIncrements));
+  EXPECT_DOUBLE_EQ(snapshot.sum, 2.0 * num_threads * kIncrements);
+}
+
+TEST(InProcessMetricsTest, ReusesShardsOfExitedThreads) {
+  unsigned shard = 0;
+  std::thread([&] { shard = internal::GetThreadShard(); }).join();
+  unsigned next_shard = 0;
+  std::thread([&] { next_shard = internal::GetThreadShard(); }).join();
+  EXPECT_EQ(next_shard, shard);
+}
+
+TEST(InProcessMetricsTest, HistogramBuckets) {
+  InProcessMetricsRegistry registry;
+  Histogram* histogram =
+      registry.NewHistogram("/test/histogram", Buckets::Explicit({1, 10}));
+  for (double value : {0.5, 1.0, 5.0, 10.0, 100.0}) histogram->Record(value);
+
+  HistogramSnapshot snapshot = registry.Snapshot().histograms["/test/histogram"];
+  EXPECT_THAT(snapshot.bounds, ElementsAre(1, 10));
+  EXPECT_THAT(snapshot.counts, ElementsAre(1, 2, 2));
+  EXPECT_EQ(snapshot.count, 5);
+  EXPECT_DOUBLE_EQ(snapshot.sum, 116.5);
+}
+
+TEST(InProcessMetricsTest, WritePrometheusText) {
+  InProcessMetricsRegistry registry;
+  registry.NewCounter("/tfrt/op_cache_hits")->IncrementBy(3);
+  registry.NewStringGauge("/tfrt/version")->Set("v\"1\"");
+  Histogram* histogram =
+      registry.NewHistogram("/tfrt/kernel_time_ns/tfrt.add.i32",
+                            Buckets::Explicit({64, 256}));
+  histogram->Record(10);
+  histogram->Record(100);
+
+  std::string text;
+  llvm::raw_string_ostream os(text);
+  registry.WritePrometheusText(os);
+  EXPECT_EQ(os.str(),
+            "# TYPE tfrt_op_cache_hits counter\n"
+            "tfrt_op_cache_hits 3\n"
+            "# TYPE tfrt_version gauge\n"
+            "tfrt_version{value=\"v\\\"1\\\"\"} 1\n"
+            "# TYPE tfrt_kernel_time_ns_tfrt_add_i32 histogram\n"
+            "tfrt_kernel_time_ns_tfrt_add_i32_bucket{le=\"64\"} 1\n"
+            "tfrt_kernel_time_ns_tfrt_add_i32_bucket{le=\"256\"} 2\n"
+            "tfrt_kernel_time_ns_tfrt_add_i32_bucket{le=\"+Inf\"} 2\n"
+            "tfrt_kernel_time_ns_tfrt_add_i32_sum 110\n"
+            "tfrt_kernel_time_ns_tfrt_add_i32_count 2\n");
+}
+
+}  // namespace
+}  // namespace metrics
+}  // namespace tfrt
@@ -12,19 +12,31 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
-// Unit test for ConcurrentVector
+// Unit test for ConcurrentVector and LockFreeConcurrentVector
 
 #include "tfrt/support/concurrent_vector.h"
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
 #include <thread>
+#include <vector>
 
+#include "benchmark/benchmark.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
 namespace {
 
-TEST(ConcurrentVectorTest, SingleThreaded) {
-  tfrt::ConcurrentVector<int> vec(1);
+template <typename Vector>
+class ConcurrentVectorTest : public ::testing::Test {};
+
+using VectorTypes = ::testing::Types<tfrt::ConcurrentVector<int>,
+                                     tfrt::LockFreeConcurrentVector<int>>;
+TYPED_TEST_SUITE(ConcurrentVectorTest, VectorTypes);
+
+TYPED_TEST(ConcurrentVectorTest, SingleThreaded) {
+  TypeParam vec(1);
 
   constexpr int kCount = 1000;
 
@@ -37,8 +49,8 @@ TEST(ConcurrentVectorTest, SingleThreaded) {
   }
 }
 
-TEST(ConcurrentVectorTest, OneWriterOneReader) {
-  tfrt::ConcurrentVector<int> vec(1);
+TYPED_TEST(ConcurrentVectorTest, OneWriterOneReader) {
+  TypeParam vec(1);
 
   constexpr int kCount = 1000;
 
@@ -59,8 +71,8 @@ TEST(ConcurrentVectorTest, OneWriterOneReader) {
   reader.join();
 }
 
-TEST(ConcurrentVectorTest, TwoWritersTwoReaders) {
-  tfrt::ConcurrentVector<int> vec(1);
+TYPED_TEST(ConcurrentVectorTest, TwoWritersTwoReaders) {
+  TypeParam vec(1);
 
   constexpr int kCount = 1000;
 
@@ -99,4 +111,87 @@ TEST(ConcurrentVectorTest, TwoWritersTwoReaders) {
   reader2.join();
 }
 
+TEST(LockFreeConcurrentVectorTest, ManyWriters) {
+  tfrt::LockFreeConcurrentVector<int> vec(3);
+
+  constexpr int kNumWriters = 8;
+  constexpr int kCount = 10000;
+
+  std::vector<std::thread> writers;
+  for (int w = 0; w < kNumWriters; ++w) {
+    writers.emplace_back([&vec, w] {
+      for (int i = 0; i < kCount; ++i) vec.emplace_back(w * kCount + i);
+    });
+  }
+  for (auto& writer : writers) writer.join();
+
+  ASSERT_EQ(vec.size(), static_cast<size_t>(kNumWriters * kCount));
+  std::vector<int> stored;
+  for (int i = 0; i < kNumWriters * kCount; ++i) stored.push_back(vec[i]);
+  std::sort(stored.begin(), stored.end());
+  for (int i = 0; i < kNumWriters * kCount; ++i) ASSERT_EQ(stored[i], i);
+}
+
+TEST(LockFreeConcurrentVectorTest, ReadOwnElement) {
+  tfrt::LockFreeConcurrentVector<int> vec(1);
+
+  // An element can be read through the index emplace_back returns, also while
+  // an earlier element of another writer is not constructed yet.
+  constexpr int kNumWriters = 8;
+  constexpr int kCount = 10000;
+  std::vector<std::thread> writers;
+  for (int w = 0; w < kNumWriters; ++w) {
+    writers.emplace_back([&vec, w] {
+      for (int i = 0; i < kCount; ++i) {
+        const int value = w * kCount + i;
+        ASSERT_EQ(vec[vec.emplace_back(value)], value);
+      }
+    });
+  }
+  for (auto& writer : writers) writer.join();
+  EXPECT_EQ(vec.size(), static_cast<size_t>(kNumWriters * kCount));
+}
+
+TEST(LockFreeConcurrentVectorTest, StableAddresses) {
+  tfrt::LockFreeConcurrentVector<std::unique_ptr<int>> vec(1);
+
+  vec.emplace_back(std::make_unique<int>(0));
+  std::unique_ptr<int>* first = &vec[0];
+  for (int i = 1; i < 1000; ++i) vec.emplace_back(std::make_unique<int>(i));
+
+  EXPECT_EQ(first, &vec[0]);
+  for (int i = 0; i < 1000; ++i) EXPECT_EQ(*vec[i], i);
+}
+
+template <typename Vector>
+static void BM_ConcurrentEmplaceBack(benchmark::State& state) {
+  const int num_writers = state.range(0);
+  constexpr int kCount = 100000;
+
+  for (auto _ : state) {
+    Vector vec(16);
+    std::vector<std::thread> writers;
+    for (int w = 0; w < num_writers; ++w) {
+      writers.emplace_back([&vec] {
+        for (int i = 0; i < kCount; ++i) vec.emplace_back(i);
+      });
+    }
+    for (auto& writer : writers) writer.join();
+    benchmark::DoNotOptimize(vec.size());
+  }
+  state.SetItemsProcessed(state.iterations() * num_writers * kCount);
+}
+
+BENCHMARK_TEMPLATE(BM_ConcurrentEmplaceBack, tfrt::ConcurrentVector<int>)
+    ->Arg(1)
+    ->Arg(4)
+    ->Arg(8)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ConcurrentEmplaceBack,
+                   tfrt::LockFreeConcurrentVector<int>)
+    ->Arg(1)
+    ->Arg(4)
+    ->Arg(8)
+    ->UseRealTime();
+
 }  // namespace
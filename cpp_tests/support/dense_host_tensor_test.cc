@@ -19,6 +19,7 @@
 #include "tfrt/tensor/dense_host_tensor.h"
 
 #include <complex>
+#include <cstdint>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -203,5 +204,36 @@ TEST(DenseHostTensorSharedTest, FillWithInt32Type) {
   ASSERT_EQ(dht_b_data[1], 3.0);
 }
 
+TEST(DenseHostTensorTest, CreateFromExternal) {
+  alignas(16) int32_t data[6] = {0, 1, 2, 3, 4, 5};
+  const TensorMetadata metadata(GetDType<int32_t>(), TensorShape({2, 3}));
+  int num_deallocations = 0;
+  {
+    auto dht = DenseHostTensor::CreateFromExternal(
+        metadata, data, sizeof(data), [&](void* ptr, size_t size) {
+          EXPECT_EQ(ptr, data);
+          EXPECT_EQ(size, sizeof(data));
+          ++num_deallocations;
+        });
+    ASSERT_TRUE(dht.has_value());
+    EXPECT_EQ(dht->data(), data);
+    EXPECT_FALSE(dht->buffer()->IsExclusiveDataOwner());
+    EXPECT_EQ(DHTArrayView<int32_t>(&*dht)[4], 4);
+  }
+  EXPECT_EQ(num_deallocations, 1);
+}
+
+TEST(DenseHostTensorTest, CreateFromExternalRejectsInvalidBuffers) {
+  alignas(16) int32_t data[8] = {};
+  auto deallocator = [](void*, size_t) { ADD_FAILURE(); };
+  const TensorMetadata metadata(GetDType<int32_t>(), TensorShape({2, 3}));
+
+  EXPECT_FALSE(DenseHostTensor::CreateFromExternal(metadata, data,
+                                                   5 * sizeof(int32_t),
+                                                   deallocator));
+  EXPECT_FALSE(DenseHostTensor::CreateFromExternal(
+      metadata, data + 1, 7 * sizeof(int32_t), deallocator));
+}
+
 }  // namespace
 }  // namespace tfrt
@@ -57,5 +57,10 @@ TEST(HashUtilTest, Hash64CheckAlgorithm) {
   EXPECT_EQ(Hash64(kTestBuffer, sizeof(kTestBuffer), 0), 0x32e09401ac25876d);
 }
 
+TEST(HashUtilTest, HashInt64CheckAlgorithm) {
+  EXPECT_EQ(HashInt64(0), 0xe220a8397b1dcdaf);
+  EXPECT_EQ(HashInt64(1), 0x910a2dec89025cc1);
+}
+
 }  // namespace
 }  // namespace tfrt
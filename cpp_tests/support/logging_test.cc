@@ -0,0 +1,81 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Tests for the asynchronous logging backend.
+
+#include "tfrt/support/logging.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace tfrt {
+namespace {
+
+class AsyncLoggingTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    AsyncLoggingOptions options;
+    options.max_lines_per_second_per_site = 3;
+    options.max_buffered_bytes_per_thread = 1024;
+    // Lines are only written by FlushLogs() in the tests.
+    options.flush_interval = std::chrono::hours(1);
+    EnableAsyncLogging(options);
+  }
+};
+
+TEST_F(AsyncLoggingTest, WritesBufferedLines) {
+  ::testing::internal::CaptureStderr();
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 2; ++i) {
+    threads.emplace_back([i] { TFRT_LOG(INFO) << "from thread " << i; });
+  }
+  for (auto& thread : threads) thread.join();
+  FlushLogs();
+  std::string output = ::testing::internal::GetCapturedStderr();
+
+  // The buffers of exited threads are written.
+  EXPECT_NE(output.find("] from thread 0\n"), std::string::npos);
+  EXPECT_NE(output.find("] from thread 1\n"), std::string::npos);
+}
+
+TEST_F(AsyncLoggingTest, RateLimitsCallSites) {
+  ::testing::internal::CaptureStderr();
+  for (int i = 0; i < 10; ++i) TFRT_LOG(ERROR) << "line " << i;
+  FlushLogs();
+  std::string output = ::testing::internal::GetCapturedStderr();
+
+  EXPECT_NE(output.find("] line 0\n"), std::string::npos);
+  // At most 6 lines are logged, even if the loop runs across two seconds.
+  EXPECT_EQ(output.find("] line 9\n"), std::string::npos);
+  EXPECT_NE(output.find("over the per call site rate limit"),
+            std::string::npos);
+}
+
+TEST_F(AsyncLoggingTest, DropsLinesOverBufferLimit) {
+  ::testing::internal::CaptureStderr();
+  TFRT_LOG(WARNING) << std::string(2048, 'x');
+  FlushLogs();
+  std::string output = ::testing::internal::GetCapturedStderr();
+
+  EXPECT_EQ(output.find("xxxx"), std::string::npos);
+  EXPECT_NE(output.find("Dropped 1 log lines over the per thread buffer"),
+            std::string::npos);
+}
+
+}  // namespace
+}  // namespace tfrt
@@ -16,6 +16,9 @@
 
 #include "tfrt/support/philox_random.h"
 
+#include <cstdint>
+#include <vector>
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
@@ -28,5 +31,32 @@ TEST(PhiloxRandomTest, GenerateNumber) {
   EXPECT_THAT(generator(), 3724722508);
 }
 
+TEST(PhiloxRandomTest, FillMatchesSequentialResults) {
+  random::PhiloxRandom generator(100, 200);
+  std::vector<uint32_t> expected(1000);
+  for (auto& value : expected) value = generator();
+
+  // Unaligned sizes mix the cached results, the batches and the tail.
+  random::PhiloxRandom fill_generator(100, 200);
+  std::vector<uint32_t> results(expected.size());
+  fill_generator.Fill(results.data(), 3);
+  fill_generator.Fill(results.data() + 3, 501);
+  fill_generator.Fill(results.data() + 504, 496);
+  EXPECT_EQ(results, expected);
+}
+
+TEST(PhiloxRandomTest, SkipSamples) {
+  random::PhiloxRandom generator(100, 200);
+  std::vector<uint32_t> expected(400);
+  for (auto& value : expected) value = generator();
+
+  random::PhiloxRandom skip_generator(100, 200);
+  skip_generator();
+  skip_generator.Skip(49);
+  std::vector<uint32_t> results(200);
+  skip_generator.Fill(results.data(), results.size());
+  EXPECT_THAT(results, ::testing::ElementsAreArray(expected.data() + 200, 200));
+}
+
 }  // namespace
 }  // namespace tfrt
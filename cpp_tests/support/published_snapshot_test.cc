@@ -0,0 +1,88 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Unit tests for PublishedSnapshot.
+
+#include "tfrt/support/published_snapshot.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace tfrt {
+namespace {
+
+// Counts the live snapshots, and marks the deleted ones so that a read of a
+// deleted snapshot is caught.
+struct Snapshot {
+  explicit Snapshot(int value, std::atomic<int>* live)
+      : value(value), live(live) {
+    live->fetch_add(1);
+  }
+  ~Snapshot() {
+    value = -1;
+    live->fetch_sub(1);
+  }
+
+  int value;
+  std::atomic<int>* live;
+};
+
+TEST(PublishedSnapshotTest, ReplacedSnapshotsAreDeleted) {
+  std::atomic<int> live{0};
+  {
+    PublishedSnapshot<Snapshot> snapshot;
+    EXPECT_TRUE(snapshot.Read([](const Snapshot* s) { return s == nullptr; }));
+
+    for (int i = 0; i < 100; ++i) {
+      snapshot.Publish(std::make_unique<Snapshot>(i, &live));
+      EXPECT_EQ(live.load(), 1);
+      EXPECT_EQ(snapshot.Read([](const Snapshot* s) { return s->value; }), i);
+    }
+  }
+  EXPECT_EQ(live.load(), 0);
+}
+
+TEST(PublishedSnapshotTest, ConcurrentReads) {
+  std::atomic<int> live{0};
+  PublishedSnapshot<Snapshot> snapshot;
+  snapshot.Publish(std::make_unique<Snapshot>(0, &live));
+
+  std::atomic<bool> done{false};
+  std::atomic<bool> deleted_read{false};
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; ++i) {
+    readers.emplace_back([&] {
+      while (!done.load()) {
+        snapshot.Read([&](const Snapshot* s) {
+          if (s->value < 0) deleted_read = true;
+        });
+      }
+    });
+  }
+
+  for (int i = 1; i <= 1000; ++i)
+    snapshot.Publish(std::make_unique<Snapshot>(i, &live));
+  EXPECT_EQ(live.load(), 1);
+
+  done = true;
+  for (auto& reader : readers) reader.join();
+  EXPECT_FALSE(deleted_read.load());
+}
+
+}  // namespace
+}  // namespace tfrt
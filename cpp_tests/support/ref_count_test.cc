@@ -16,6 +16,10 @@
 
 #include "tfrt/support/ref_count.h"
 
+#include <thread>
+#include <vector>
+
+#include "benchmark/benchmark.h"
 #include "gtest/gtest.h"
 
 namespace tfrt {
@@ -124,5 +128,69 @@ TEST(RefCountTest, RCReferenceGlobalSwap) {
   EXPECT_EQ(123, rwi_b->value());
 }
 
+class ConfinedInt32 : public ThreadConfinedReferenceCounted<ConfinedInt32> {
+ public:
+  explicit ConfinedInt32(int32_t value) : value_(value) {}
+
+  int32_t value() const { return value_; }
+
+ private:
+  int32_t value_;
+};
+
+TEST(RefCountTest, ThreadConfinedRCReference) {
+  RCReference<ConfinedInt32> rci = MakeRef<ConfinedInt32>(123);
+  EXPECT_FALSE(rci->IsShared());
+  EXPECT_TRUE(rci->IsUnique());
+
+  RCReference<ConfinedInt32> rci_copied = rci;
+  EXPECT_EQ(2u, rci->NumRef());
+  rci_copied.reset();
+  EXPECT_TRUE(rci->IsUnique());
+  EXPECT_EQ(123, rci->value());
+}
+
+TEST(RefCountTest, ThreadConfinedShare) {
+  RCReference<ConfinedInt32> rci = MakeRef<ConfinedInt32>(123);
+  rci->Share();
+  EXPECT_TRUE(rci->IsShared());
+  rci->Share();
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([rci = rci.CopyRef()] {
+      for (int j = 0; j < 1000; ++j) {
+        RCReference<ConfinedInt32> copy = rci;
+        EXPECT_EQ(123, copy->value());
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  EXPECT_TRUE(rci->IsUnique());
+}
+
+// Performance benchmarks are below.
+
+static void BM_AtomicCopyAndDropRef(benchmark::State& state) {
+  RCReference<WrappedInt32> ref = MakeRef<WrappedInt32>(123);
+  for (auto _ : state) {
+    RCReference<WrappedInt32> copy = ref;
+    benchmark::DoNotOptimize(copy);
+  }
+}
+
+// Argument is whether the value has been shared.
+static void BM_ThreadConfinedCopyAndDropRef(benchmark::State& state) {
+  RCReference<ConfinedInt32> ref = MakeRef<ConfinedInt32>(123);
+  if (state.range(0)) ref->Share();
+  for (auto _ : state) {
+    RCReference<ConfinedInt32> copy = ref;
+    benchmark::DoNotOptimize(copy);
+  }
+}
+
+BENCHMARK(BM_AtomicCopyAndDropRef);
+BENCHMARK(BM_ThreadConfinedCopyAndDropRef)->Arg(0)->Arg(1);
+
 }  // namespace
 }  // namespace tfrt
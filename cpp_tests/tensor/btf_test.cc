@@ -18,9 +18,17 @@
 
 #include "tfrt/tensor/btf.h"
 
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+
 #include "gtest/gtest.h"
 #include "llvm/Support/raw_ostream.h"
 #include "tfrt/cpp_tests/test_util.h"
+#include "tfrt/io/buffered_input_stream.h"
+#include "tfrt/io/file_system.h"
 #include "tfrt/tensor/btf_util.h"
 
 namespace tfrt {
@@ -38,6 +46,7 @@ TEST(BTFTest, ToDTypeKind) {
   EXPECT_EQ(ToDTypeKind(TensorDType::kUInt16), DType::UI16);
   EXPECT_EQ(ToDTypeKind(TensorDType::kUInt32), DType::UI32);
   EXPECT_EQ(ToDTypeKind(TensorDType::kUInt64), DType::UI64);
+  EXPECT_EQ(ToDTypeKind(TensorDType::kQInt8), DType::QI8);
 }
 
 TEST(BTFTest, ToTensorDType) {
@@ -51,6 +60,7 @@ TEST(BTFTest, ToTensorDType) {
   EXPECT_EQ(ToTensorDType(DType::UI16).get(), TensorDType::kUInt16);
   EXPECT_EQ(ToTensorDType(DType::UI32).get(), TensorDType::kUInt32);
   EXPECT_EQ(ToTensorDType(DType::UI64).get(), TensorDType::kUInt64);
+  EXPECT_EQ(ToTensorDType(DType::QI8).get(), TensorDType::kQInt8);
 }
 
 TEST(BTFTest, ToTensorDTypeUnsupported) {
@@ -74,6 +84,7 @@ TEST(BTFTest, TensorDTypeToRawStream) {
   CheckEnumStr(TensorDType::kUInt16, "ui16");
   CheckEnumStr(TensorDType::kUInt32, "ui32");
   CheckEnumStr(TensorDType::kUInt64, "ui64");
+  CheckEnumStr(TensorDType::kQInt8, "qi8");
 }
 
 TEST(BTFTest, TensorLayoutToRawStream) {
@@ -103,6 +114,111 @@ TEST(BTFTest, BTFWriteAndRead) {
   }
 }
 
+// An input stream that reads from a string.
+class StringInputStream : public io::InputStream {
+ public:
+  explicit StringInputStream(std::string data) : data_(std::move(data)) {}
+
+  llvm::Expected<size_t> Read(char* buf, size_t max_count) override {
+    const size_t count = std::min(max_count, data_.size() - pos_);
+    std::memcpy(buf, data_.data() + pos_, count);
+    pos_ += count;
+    return count;
+  }
+
+  llvm::Expected<size_t> Tell() override { return pos_; }
+
+ private:
+  std::string data_;
+  size_t pos_ = 0;
+};
+
+TEST(BTFTest, BTFWriteAndReadChunks) {
+  auto context = CreateHostContext();
+  const auto a = CreateDummyTensor<int>({3, 2}, context.get());
+  const auto b = CreateDummyTensor<uint8_t>({63}, context.get());
+  const auto c = CreateDummyTensor<uint64_t>({100}, context.get());
+  std::vector<const Tensor*> tensors{&a, &b, &c};
+  std::stringstream os;
+  EXPECT_FALSE(WriteTensorsToBTF(&os, tensors));
+
+  // The last tensor does not fit into the buffer.
+  io::BufferedInputStream stream(std::make_unique<StringInputStream>(os.str()),
+                                 /*buffer_size=*/256, context->allocator());
+  std::vector<uint64_t> offsets(tensors.size() + 1);
+  EXPECT_EQ(*stream.Read(reinterpret_cast<char*>(offsets.data()),
+                         offsets.size() * sizeof(uint64_t)),
+            offsets.size() * sizeof(uint64_t));
+
+  for (int i = 0; i < tensors.size(); i++) {
+    EXPECT_EQ(*stream.Tell(), offsets[i + 1]);
+    const auto& expected =
+        reinterpret_cast<const DenseHostTensor&>(*tensors[i]);
+    auto out = ReadDHTFromBTF(&stream, context.get());
+    ASSERT_TRUE(!!out);
+    EXPECT_EQ(*out, expected);
+  }
+}
+
+TEST(BTFTest, BTFWriteFileWithChecksums) {
+  auto context = CreateHostContext();
+  const auto a = CreateDummyTensor<int>({3, 2}, context.get());
+  const auto b = CreateDummyTensor<uint8_t>({63}, context.get());
+  const auto c = CreateDummyTensor<float>({}, context.get());
+  std::vector<const DenseHostTensor*> tensors{&a, &b, &c};
+
+  const std::string path = ::testing::TempDir() + "/checksums.btf";
+  io::FileSystem* file_system =
+      io::FileSystemRegistry::Default()->LookupForPath(path);
+  ASSERT_NE(file_system, nullptr);
+  {
+    std::unique_ptr<io::WritableFile> file;
+    ASSERT_FALSE(file_system->NewWritableFile(path, &file));
+    ASSERT_FALSE(WriteTensorsToBTF(file.get(), tensors));
+    ASSERT_FALSE(file->Close());
+  }
+
+  std::unique_ptr<io::RandomAccessFile> file;
+  ASSERT_FALSE(file_system->NewRandomAccessFile(path, &file));
+  auto offsets = ReadBTFOffsets(*file);
+  ASSERT_TRUE(!!offsets);
+  ASSERT_EQ(offsets->size(), tensors.size());
+  auto checksums = ReadBTFChecksums(*file, *offsets);
+  ASSERT_TRUE(!!checksums);
+  ASSERT_EQ(checksums->size(), tensors.size());
+
+  for (int i = 0; i < tensors.size(); i++) {
+    auto out = ReadDHTFromBTF(*file, (*offsets)[i], context.get());
+    ASSERT_TRUE(!!out);
+    EXPECT_EQ(*out, *tensors[i]);
+    EXPECT_EQ(ComputeBTFChecksum(*out), (*checksums)[i]);
+  }
+}
+
+TEST(BTFTest, BTFReadChecksumsAbsent) {
+  auto context = CreateHostContext();
+  const auto a = CreateDummyTensor<int>({3, 2}, context.get());
+  std::vector<const Tensor*> tensors{&a};
+  std::stringstream os;
+  ASSERT_FALSE(WriteTensorsToBTF(&os, tensors));
+
+  const std::string path = ::testing::TempDir() + "/no_checksums.btf";
+  {
+    std::ofstream out(path, std::ios::binary);
+    out << os.str();
+  }
+  io::FileSystem* file_system =
+      io::FileSystemRegistry::Default()->LookupForPath(path);
+  ASSERT_NE(file_system, nullptr);
+  std::unique_ptr<io::RandomAccessFile> file;
+  ASSERT_FALSE(file_system->NewRandomAccessFile(path, &file));
+  auto offsets = ReadBTFOffsets(*file);
+  ASSERT_TRUE(!!offsets);
+  auto checksums = ReadBTFChecksums(*file, *offsets);
+  ASSERT_TRUE(!!checksums);
+  EXPECT_TRUE(checksums->empty());
+}
+
 }  // namespace
 }  // namespace btf
 }  // namespace tfrt
@@ -0,0 +1,99 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Unit test for ConstantTensorPool.
+
+#include "tfrt/tensor/constant_tensor_pool.h"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace tfrt {
+namespace {
+
+std::vector<uint8_t> MakeData(size_t size, uint8_t seed) {
+  std::vector<uint8_t> data(size);
+  for (size_t i = 0; i < size; ++i) data[i] = static_cast<uint8_t>(seed + i);
+  return data;
+}
+
+TEST(ConstantTensorPoolTest, SharesIdenticalConstants) {
+  ConstantTensorPool pool(/*min_pooled_size=*/16);
+  // Separate copies, as if embedded in different BEF files.
+  std::vector<uint8_t> first = MakeData(64, 1);
+  std::vector<uint8_t> second = MakeData(64, 1);
+  std::vector<uint8_t> other = MakeData(64, 2);
+
+  auto a = pool.GetOrCreate(first, 16);
+  auto b = pool.GetOrCreate(second, 16);
+  auto c = pool.GetOrCreate(other, 16);
+  ASSERT_TRUE(a && b && c);
+  EXPECT_EQ(a->data(), b->data());
+  EXPECT_NE(a->data(), c->data());
+  EXPECT_NE(a->data(), first.data());
+  EXPECT_EQ(std::memcmp(a->data(), first.data(), first.size()), 0);
+  EXPECT_FALSE(a->IsExclusiveDataOwner());
+
+  ConstantTensorPool::Stats stats = pool.GetStats();
+  EXPECT_EQ(stats.num_entries, 2);
+  EXPECT_EQ(stats.pooled_bytes, 128);
+  EXPECT_EQ(stats.saved_bytes, 64);
+
+  // The data is released with the last buffer referring to it.
+  a.reset();
+  EXPECT_EQ(pool.GetStats().num_entries, 2);
+  b.reset();
+  EXPECT_EQ(pool.GetStats().num_entries, 1);
+  c.reset();
+  stats = pool.GetStats();
+  EXPECT_EQ(stats.num_entries, 0);
+  EXPECT_EQ(stats.pooled_bytes, 0);
+}
+
+TEST(ConstantTensorPoolTest, CopiesSmallConstants) {
+  ConstantTensorPool pool(/*min_pooled_size=*/16);
+  std::vector<uint8_t> data = MakeData(8, 1);
+
+  auto a = pool.GetOrCreate(data, 8);
+  auto b = pool.GetOrCreate(data, 8);
+  ASSERT_TRUE(a && b);
+  EXPECT_NE(a->data(), b->data());
+  EXPECT_EQ(pool.GetStats().num_entries, 0);
+}
+
+TEST(ConstantTensorPoolTest, CreatesDenseHostTensors) {
+  ConstantTensorPool pool(/*min_pooled_size=*/16);
+  std::vector<float> values(32, 1.5f);
+  ArrayRef<uint8_t> data(reinterpret_cast<const uint8_t*>(values.data()),
+                         values.size() * sizeof(float));
+
+  // Tensors of different shapes may share the same bytes.
+  auto matrix = pool.GetOrCreateDenseHostTensor(
+      TensorMetadata(DType(DType::F32), {4, 8}), data);
+  auto vector = pool.GetOrCreateDenseHostTensor(
+      TensorMetadata(DType(DType::F32), {32}), data);
+  ASSERT_TRUE(matrix && vector);
+  EXPECT_EQ(matrix->data(), vector->data());
+  EXPECT_EQ(matrix->shape(), TensorShape({4, 8}));
+  EXPECT_EQ(static_cast<const float*>(vector->data())[31], 1.5f);
+  EXPECT_EQ(pool.GetStats().num_entries, 1);
+}
+
+}  // namespace
+}  // namespace tfrt
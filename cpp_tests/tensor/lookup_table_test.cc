@@ -0,0 +1,153 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Unit tests for LookupTable.
+
+#include "tfrt/tensor/lookup_table.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "tfrt/cpp_tests/error_util.h"
+#include "tfrt/cpp_tests/test_util.h"
+#include "tfrt/tensor/btf_util.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+
+namespace tfrt {
+namespace {
+
+TEST(LookupTableTest, StringKeys) {
+  std::vector<std::string> keys;
+  std::vector<int64_t> values;
+  for (int i = 0; i < 10000; ++i) {
+    keys.push_back("token" + std::to_string(i));
+    values.push_back(3 * i);
+  }
+  std::vector<string_view> views(keys.begin(), keys.end());
+  RCReference<LookupTable> table;
+  TFRT_ASSERT_AND_ASSIGN(table, LookupTable::Create(views, values));
+  EXPECT_EQ(table->key_type(), LookupTable::KeyType::kString);
+  EXPECT_EQ(table->size(), keys.size());
+
+  for (size_t i = 0; i < keys.size(); ++i)
+    ASSERT_EQ(table->Lookup(keys[i], -1), values[i]);
+  EXPECT_EQ(table->Lookup("token10000", -1), -1);
+  EXPECT_EQ(table->Lookup("", -1), -1);
+
+  // The batch is not a multiple of the interleaved group size.
+  std::vector<std::string> batch = {"token7", "unknown", "token9999",
+                                    "token0", "token",   "token42"};
+  for (int i = 0; i < 20; ++i) batch.push_back("token" + std::to_string(i));
+  std::vector<int64_t> batch_values(batch.size());
+  table->Lookup(batch, -1, batch_values);
+  for (size_t i = 0; i < batch.size(); ++i)
+    EXPECT_EQ(batch_values[i], table->Lookup(batch[i], -1));
+}
+
+TEST(LookupTableTest, Int64Keys) {
+  const std::vector<int64_t> keys = {-5, 0, 7, 1ll << 40, 123456789};
+  const std::vector<int64_t> values = {1, 2, 3, 4, 5};
+  RCReference<LookupTable> table;
+  TFRT_ASSERT_AND_ASSIGN(table, LookupTable::Create(keys, values));
+  EXPECT_EQ(table->key_type(), LookupTable::KeyType::kInt64);
+
+  std::vector<int64_t> batch = {7, 8, -5, 1ll << 40, 0, -1};
+  std::vector<int64_t> batch_values(batch.size());
+  table->Lookup(batch, 0, batch_values);
+  EXPECT_EQ(batch_values, std::vector<int64_t>({3, 0, 1, 4, 2, 0}));
+}
+
+TEST(LookupTableTest, EmptyTable) {
+  RCReference<LookupTable> table;
+  TFRT_ASSERT_AND_ASSIGN(table, LookupTable::Create(ArrayRef<string_view>(),
+                                                    ArrayRef<int64_t>()));
+  EXPECT_EQ(table->size(), 0);
+  EXPECT_EQ(table->Lookup("a", 9), 9);
+}
+
+TEST(LookupTableTest, DuplicateKeys) {
+  const std::vector<string_view> keys = {"a", "b", "a"};
+  const std::vector<int64_t> values = {1, 2, 3};
+  EXPECT_THAT(LookupTable::Create(keys, values).takeError(),
+              IsFailure());
+}
+
+TEST(LookupTableTest, TextFile) {
+  const std::string path = ::testing::TempDir() + "/vocabulary.txt";
+  {
+    std::ofstream file(path);
+    file << "hello\nworld\r\nfoo\t42\n\n";
+  }
+
+  RCReference<LookupTable> table;
+  TFRT_ASSERT_AND_ASSIGN(table, LookupTable::CreateFromTextFile(path));
+  EXPECT_EQ(table->size(), 4);
+  EXPECT_EQ(table->Lookup("hello", -1), 0);
+  EXPECT_EQ(table->Lookup("world", -1), 1);
+  EXPECT_EQ(table->Lookup("foo", -1), 42);
+  EXPECT_EQ(table->Lookup("", -1), 3);
+  EXPECT_EQ(table->Lookup("foo\t42", -1), -1);
+}
+
+TEST(LookupTableTest, BTFFile) {
+  auto host = CreateHostContext();
+  auto keys = CreateDummyTensor<int64_t>({4}, host.get());
+  auto values = CreateDummyTensor<int64_t>({4}, host.get());
+  MutableDHTArrayView<int64_t> values_view(&values);
+  for (int i = 0; i < 4; ++i) values_view[i] = 10 * i;
+
+  const std::string path = ::testing::TempDir() + "/vocabulary.btf";
+  {
+    std::ofstream file(path, std::ios::binary);
+    std::vector<const Tensor*> tensors = {&keys, &values};
+    ASSERT_FALSE(WriteTensorsToBTF(&file, tensors));
+  }
+
+  RCReference<LookupTable> table;
+  TFRT_ASSERT_AND_ASSIGN(table,
+                         LookupTable::CreateFromBTFFile(path, host.get()));
+  DHTArrayView<int64_t> keys_view(&keys);
+  for (int i = 0; i < 4; ++i)
+    EXPECT_EQ(table->Lookup(keys_view[i], -1), 10 * i);
+}
+
+TEST(LookupTableTest, SaveAndOpen) {
+  const std::vector<string_view> keys = {"the", "quick", "brown", "fox"};
+  const std::vector<int64_t> values = {4, 3, 2, 1};
+  RCReference<LookupTable> table;
+  TFRT_ASSERT_AND_ASSIGN(table, LookupTable::Create(keys, values));
+
+  const std::string path = ::testing::TempDir() + "/vocabulary.table";
+  ASSERT_FALSE(table->Save(path));
+  RCReference<LookupTable> mapped;
+  TFRT_ASSERT_AND_ASSIGN(mapped, LookupTable::Open(path));
+  EXPECT_EQ(mapped->size(), keys.size());
+  for (size_t i = 0; i < keys.size(); ++i)
+    EXPECT_EQ(mapped->Lookup(keys[i], -1), values[i]);
+  EXPECT_EQ(mapped->Lookup("jumps", -1), -1);
+
+  // A file that is not a saved table is rejected.
+  const std::string text_path = ::testing::TempDir() + "/not_a_table.txt";
+  {
+    std::ofstream file(text_path);
+    file << "this is not a lookup table, only some text";
+  }
+  EXPECT_THAT(LookupTable::Open(text_path).takeError(), IsFailure());
+}
+
+}  // namespace
+}  // namespace tfrt
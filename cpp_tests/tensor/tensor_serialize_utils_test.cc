@@ -95,5 +95,51 @@ TEST_F(TensorSerializeUtilsTest, SerializeDeserialzeDenseHostTensor) {
   EXPECT_EQ(expected.get(), dht_);
 }
 
+TEST_F(TensorSerializeUtilsTest, SerializeDeserializeDenseHostTensorWire) {
+  auto wire = SerializeDenseHostTensorToWire(dht_);
+  auto chunks = wire.GetChunks();
+  ASSERT_EQ(chunks.size(), 2);
+  EXPECT_EQ(chunks[0].size(), wire.header.size());
+  // The data is borrowed from the tensor.
+  EXPECT_EQ(chunks[1].data(), dht_.data());
+  EXPECT_EQ(chunks[1].size(), 4 * sizeof(float));
+
+  auto md = DeserializeDenseHostTensorWireHeader(wire.header);
+  ASSERT_TRUE(!!md);
+  EXPECT_EQ(*md, dht_.metadata());
+
+  // The received buffer is adopted without copying.
+  auto expected =
+      DeserializeDenseHostTensorFromWire(wire.header, dht_.buffer());
+  ASSERT_TRUE(!!expected);
+  EXPECT_EQ(expected->data(), dht_.data());
+  EXPECT_EQ(*expected, dht_);
+}
+
+TEST_F(TensorSerializeUtilsTest, DeserializeDenseHostTensorWireErrors) {
+  auto wire = SerializeDenseHostTensorToWire(dht_);
+
+  auto bad_header = DeserializeDenseHostTensorFromWire(
+      string_view(wire.header).drop_back(1), dht_.buffer());
+  EXPECT_FALSE(!!bad_header);
+  consumeError(bad_header.takeError());
+
+  auto short_data = DeserializeDenseHostTensorFromWire(
+      wire.header, HostBuffer::CreateFromExternal(dht_.buffer(), /*offset=*/0,
+                                                  /*size=*/sizeof(float)));
+  EXPECT_FALSE(!!short_data);
+  consumeError(short_data.takeError());
+
+  auto buffer = HostBuffer::CreateUninitialized(
+      /*size=*/4 * sizeof(float) + 1, /*alignment=*/16,
+      host_context_->allocator());
+  auto misaligned_data = DeserializeDenseHostTensorFromWire(
+      wire.header, HostBuffer::CreateFromExternal(std::move(buffer),
+                                                  /*offset=*/1,
+                                                  /*size=*/4 * sizeof(float)));
+  EXPECT_FALSE(!!misaligned_data);
+  consumeError(misaligned_data.takeError());
+}
+
 }  // namespace
 }  // namespace tfrt
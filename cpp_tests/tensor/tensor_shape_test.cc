@@ -19,6 +19,7 @@
 #include "tfrt/tensor/tensor_shape.h"
 
 #include <array>
+#include <vector>
 
 #include "gtest/gtest.h"
 
@@ -36,5 +37,55 @@ TEST(TensorShapeTest, Strides) {
   EXPECT_EQ(strides, expected);
 }
 
+TEST(TensorShapeTest, Representations) {
+  // Rep16, Rep32, and the out of line representation for a large rank and for
+  // a dimension that does not fit in 32 bits.
+  std::vector<std::vector<Index>> all_dims = {
+      {},
+      {2, 3, 4, 5, 6, 7, 8},
+      {100000, 3, 224, 224},
+      {2, 3, 4, 5, 6, 7, 8, 9},
+      {Index{1} << 33, 3},
+  };
+
+  for (const std::vector<Index>& dims : all_dims) {
+    TensorShape shape(dims);
+    ASSERT_EQ(shape.GetRank(), dims.size());
+
+    Index num_elements = 1;
+    for (int i = 0; i < dims.size(); ++i) {
+      EXPECT_EQ(shape.GetDimensionSize(i), dims[i]);
+      num_elements *= dims[i];
+    }
+    EXPECT_EQ(shape.GetNumElements(), num_elements);
+
+    llvm::SmallVector<Index, 4> result;
+    shape.GetDimensions(&result);
+    EXPECT_EQ(std::vector<Index>(result.begin(), result.end()), dims);
+
+    TensorShape copy(shape);
+    EXPECT_EQ(copy, shape);
+    EXPECT_EQ(copy.GetNumElements(), num_elements);
+
+    TensorShape moved(std::move(copy));
+    EXPECT_EQ(moved, shape);
+    EXPECT_EQ(moved.GetNumElements(), num_elements);
+
+    TensorShape assigned(std::vector<Index>{1});
+    assigned = shape;
+    EXPECT_EQ(assigned, shape);
+    EXPECT_EQ(assigned.GetNumElements(), num_elements);
+  }
+}
+
+TEST(TensorShapeTest, Equality) {
+  EXPECT_EQ(TensorShape({2, 3, 4, 5, 6, 7, 8, 9}),
+            TensorShape({2, 3, 4, 5, 6, 7, 8, 9}));
+  EXPECT_NE(TensorShape({2, 3, 4, 5, 6, 7, 8, 9}),
+            TensorShape({2, 3, 4, 5, 6, 7, 8, 10}));
+  EXPECT_NE(TensorShape({2, 3}), TensorShape({3, 2}));
+  EXPECT_NE(TensorShape({2, 3}), TensorShape({2, 3, 1}));
+}
+
 }  // namespace
 }  // namespace tfrt
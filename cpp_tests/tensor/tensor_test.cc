@@ -16,14 +16,24 @@
 
 // Unit test for TFRT Tensor.
 
+#include <algorithm>
+#include <iterator>
 #include <memory>
+#include <vector>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "tfrt/cpp_tests/test_util.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/tensor/contiguous_string_host_tensor.h"
+#include "tfrt/tensor/conversion_registry.h"
+#include "tfrt/tensor/coo_host_tensor.h"
+#include "tfrt/tensor/csr_host_tensor.h"
 #include "tfrt/tensor/dense_host_tensor.h"
 #include "tfrt/tensor/dense_host_tensor_view.h"
 #include "tfrt/tensor/dense_tensor_utils.h"
+#include "tfrt/tensor/string_host_tensor.h"
+#include "tfrt/tensor/strided_host_tensor_view.h"
 #include "tfrt/tensor/tensor_metadata.h"
 #include "tfrt/tensor/tensor_shape.h"
 
@@ -148,5 +158,179 @@ TEST(TensorTest, FlattenTensor) {
   EXPECT_TRUE(dht.buffer().get() == flat.buffer().get());
 }
 
+TEST(TensorTest, StridedHostTensorViewSlice) {
+  auto context = CreateHostContext();
+  auto dht = DenseHostTensor::CreateUninitialized(
+                 TensorMetadata::Create<int>(2, 3), context.get())
+                 .value();
+  MutableDHTArrayView<int> view(&dht);
+  for (int i = 0; i < view.NumElements(); i++) {
+    view[i] = i;
+  }
+
+  StridedHostTensorView strided(dht);
+  EXPECT_TRUE(strided.IsContiguous());
+  EXPECT_THAT(strided.strides(), ElementsAre(3, 1));
+
+  // A slice of whole rows is contiguous and shares the buffer.
+  auto rows = strided.Slice({1, 0}, {1, 3});
+  EXPECT_TRUE(rows.IsContiguous());
+  auto rows_dht = rows.ToDenseHostTensor(context.get()).value();
+  EXPECT_EQ(rows_dht.data(), dht.data<int>() + 3);
+  EXPECT_THAT(DHTArrayView<int>(&rows_dht), ElementsAre(3, 4, 5));
+
+  // A slice of columns is strided and is copied.
+  auto columns = strided.Slice({0, 1}, {2, 2});
+  EXPECT_FALSE(columns.IsContiguous());
+  EXPECT_EQ(columns.ElementAt<int>({1, 0}), 4);
+  auto columns_dht = columns.ToDenseHostTensor(context.get()).value();
+  EXPECT_NE(columns_dht.buffer().get(), dht.buffer().get());
+  EXPECT_THAT(DHTArrayView<int>(&columns_dht), ElementsAre(1, 2, 4, 5));
+}
+
+TEST(TensorTest, StridedHostTensorViewStridedSliceAndTranspose) {
+  auto context = CreateHostContext();
+  auto dht = DenseHostTensor::CreateUninitialized(
+                 TensorMetadata::Create<int>(2, 3), context.get())
+                 .value();
+  MutableDHTArrayView<int> view(&dht);
+  for (int i = 0; i < view.NumElements(); i++) {
+    view[i] = i;
+  }
+  StridedHostTensorView strided(dht);
+
+  auto reversed = strided.StridedSlice({0, 2}, {2, -1}, {1, -1});
+  EXPECT_EQ(reversed.shape().GetDimensionSize(1), 3);
+  auto reversed_dht = reversed.ToDenseHostTensor(context.get()).value();
+  EXPECT_THAT(DHTArrayView<int>(&reversed_dht),
+              ElementsAre(2, 1, 0, 5, 4, 3));
+
+  auto every_other = strided.StridedSlice({0, 0}, {2, 3}, {1, 2});
+  auto every_other_dht = every_other.ToDenseHostTensor(context.get()).value();
+  EXPECT_THAT(DHTArrayView<int>(&every_other_dht), ElementsAre(0, 2, 3, 5));
+
+  auto transposed = strided.Transpose({1, 0});
+  EXPECT_FALSE(transposed.IsContiguous());
+  EXPECT_THAT(transposed.strides(), ElementsAre(1, 3));
+  auto transposed_dht = transposed.ToDenseHostTensor(context.get()).value();
+  EXPECT_THAT(DHTArrayView<int>(&transposed_dht),
+              ElementsAre(0, 3, 1, 4, 2, 5));
+
+  // Transposing twice restores the contiguous layout.
+  EXPECT_TRUE(transposed.Transpose({1, 0}).IsContiguous());
+}
+
+TEST(TensorTest, CreateContiguousStringHostTensor) {
+  auto context = CreateHostContext();
+  std::vector<string_view> strings{"foo", "", "barbaz", "x"};
+  auto tensor = ContiguousStringHostTensor::Create(TensorShape({2, 2}), strings,
+                                                   context.get());
+  ASSERT_TRUE(tensor.has_value());
+  EXPECT_EQ(tensor->dtype(), DType(DType::String));
+  EXPECT_THAT(tensor->offsets(), ElementsAre(0, 3, 3, 9, 10));
+  EXPECT_EQ(tensor->bytes(), "foobarbazx");
+  for (int i = 0; i < strings.size(); ++i)
+    EXPECT_EQ(tensor->GetString(i), strings[i]);
+
+  auto copy = tensor->CopyRef();
+  EXPECT_EQ(copy.bytes_buffer().get(), tensor->bytes_buffer().get());
+}
+
+TEST(TensorTest, ConvertContiguousStringHostTensor) {
+  auto context = CreateHostContext();
+  auto request_ctx =
+      RequestContextBuilder(context.get(), /*resource_context=*/nullptr)
+          .build();
+  ASSERT_TRUE(!!request_ctx);
+  ExecutionContext exec_ctx(std::move(*request_ctx));
+
+  auto sht =
+      StringHostTensor::CreateUninitialized(TensorShape({3}), context.get());
+  ASSERT_TRUE(sht.has_value());
+  sht->strings()[0] = "a";
+  sht->strings()[1] = "bc";
+  sht->strings()[2] = "def";
+
+  auto contiguous = ConvertTensorOnHost(
+      exec_ctx, *sht, ContiguousStringHostTensor::kTensorType);
+  ASSERT_TRUE(contiguous.IsConcrete());
+  const auto& cst = cast<ContiguousStringHostTensor>(contiguous.get());
+  EXPECT_EQ(cst.bytes(), "abcdef");
+
+  auto roundtrip =
+      ConvertTensorOnHost(exec_ctx, cst, StringHostTensor::kTensorType);
+  ASSERT_TRUE(roundtrip.IsConcrete());
+  EXPECT_THAT(cast<StringHostTensor>(roundtrip.get()).strings(),
+              ElementsAre("a", "bc", "def"));
+}
+
+TEST(TensorTest, ConvertCooHostTensorToCsrHostTensor) {
+  auto context = CreateHostContext();
+  auto request_ctx =
+      RequestContextBuilder(context.get(), /*resource_context=*/nullptr)
+          .build();
+  ASSERT_TRUE(!!request_ctx);
+  ExecutionContext exec_ctx(std::move(*request_ctx));
+
+  // Unsorted indices, with a duplicate of (2, 1).
+  auto indices = CreateDummyTensor<int64_t>({5, 2}, context.get());
+  const int64_t coords[] = {2, 1, 0, 3, 2, 0, 0, 1, 2, 1};
+  std::copy(std::begin(coords), std::end(coords),
+            MutableDHTArrayView<int64_t>(&indices).begin());
+  auto values = CreateDummyTensor<float>({5}, context.get());
+  const float elements[] = {1, 2, 3, 4, 5};
+  std::copy(std::begin(elements), std::end(elements),
+            MutableDHTArrayView<float>(&values).begin());
+  CooHostTensor coo(TensorShape({3, 4}), DType::F32, std::move(indices),
+                    std::move(values));
+
+  auto csr = ConvertTensorOnHost(exec_ctx, coo, CsrHostTensor::kTensorType);
+  ASSERT_TRUE(csr.IsConcrete());
+  const auto& csr_tensor = cast<CsrHostTensor>(csr.get());
+  EXPECT_THAT(llvm::makeArrayRef(csr_tensor.RowPtrs(), 4),
+              ElementsAre(0, 2, 2, 4));
+  EXPECT_THAT(llvm::makeArrayRef(csr_tensor.ColIndices(), 4),
+              ElementsAre(1, 3, 0, 1));
+  EXPECT_THAT(DHTArrayView<float>(csr_tensor.Values()),
+              ElementsAre(4, 2, 3, 5));
+
+  auto dense =
+      ConvertTensorOnHost(exec_ctx, csr_tensor, DenseHostTensor::kTensorType);
+  ASSERT_TRUE(dense.IsConcrete());
+  EXPECT_THAT(DHTArrayView<float>(&cast<DenseHostTensor>(dense.get())),
+              ElementsAre(0, 4, 0, 2, 0, 0, 0, 0, 3, 5, 0, 0));
+}
+
+template <int N>
+AsyncValueRef<Tensor> DummyConversionFn(const Tensor& tensor, const Device& src,
+                                        const Device& dst,
+                                        const ExecutionContext& exec_ctx) {
+  return {};
+}
+
+TEST(TensorTest, TensorConversionPath) {
+  const TensorType coo = CooHostTensor::kTensorType;
+  const TensorType csr = CsrHostTensor::kTensorType;
+  const TensorType dht = DenseHostTensor::kTensorType;
+  const TensorType sht = StringHostTensor::kTensorType;
+
+  TensorConversionFnRegistry registry;
+  registry.AddTensorConversionFn({coo, csr}, &DummyConversionFn<0>);
+  registry.AddTensorConversionFn({csr, dht}, &DummyConversionFn<1>);
+  registry.AddTensorConversionFn({dht, dht}, &DummyConversionFn<2>);
+
+  EXPECT_THAT(registry.GetTensorConversionPath({coo, csr}),
+              ElementsAre(&DummyConversionFn<0>));
+  EXPECT_THAT(registry.GetTensorConversionPath({coo, dht}),
+              ElementsAre(&DummyConversionFn<0>, &DummyConversionFn<1>));
+  EXPECT_TRUE(registry.GetTensorConversionPath({dht, coo}).empty());
+  EXPECT_TRUE(registry.GetTensorConversionPath({coo, sht}).empty());
+
+  // Registering a shorter path replaces the cached one.
+  registry.AddTensorConversionFn({coo, dht}, &DummyConversionFn<3>);
+  EXPECT_THAT(registry.GetTensorConversionPath({coo, dht}),
+              ElementsAre(&DummyConversionFn<3>));
+}
+
 }  // namespace
 }  // namespace tfrt
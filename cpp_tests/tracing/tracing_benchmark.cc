@@ -17,12 +17,14 @@
 #include <chrono>
 #include <future>
 #include <string>
+#include <thread>
 
 #include "benchmark/benchmark.h"
 #include "gtest/gtest.h"
 #include "tfrt/cpp_tests/error_util.h"
 #include "tfrt/support/logging.h"
 #include "tfrt/support/string_util.h"
+#include "tfrt/tracing/trace_buffers.h"
 #include "tfrt/tracing/tracing.h"
 
 namespace tfrt {
@@ -106,6 +108,21 @@ BENCHMARK(BM_VerboseTracingScopes);
 BENCHMARK(BM_DefaultTracingScopes);
 BENCHMARK(BM_StrCatTracingScopes);
 
+// Measures recording into per-thread buffers which a collector thread drains.
+static void BM_TraceBuffersRecord(benchmark::State& state) {
+  static auto* buffers = new TraceBuffers;
+  static auto* collector =
+      new TraceCollector(buffers, std::chrono::milliseconds(1),
+                         [](std::thread::id, TraceEvent&&) {});
+  (void)collector;
+  for (auto _ : state) {
+    auto now = TraceEvent::Clock::now();
+    buffers->Record(TraceEvent{StrName(), now, now});
+  }
+  state.counters["dropped"] = buffers->dropped();
+}
+BENCHMARK(BM_TraceBuffersRecord)->ThreadRange(1, 8);
+
 }  // namespace
 }  // namespace tracing
 }  // namespace tfrt
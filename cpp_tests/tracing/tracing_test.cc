@@ -16,17 +16,24 @@
 
 #include "tfrt/tracing/tracing.h"
 
+#include <algorithm>
 #include <limits>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "tfrt/support/error_util.h"
+#include "tfrt/tracing/perf_counters.h"
+#include "tfrt/tracing/trace_buffers.h"
 
 namespace tfrt {
 namespace tracing {
 namespace {
 
 using ::testing::ByMove;
+using ::testing::ElementsAre;
 using ::testing::DefaultValue;
 using ::testing::InSequence;
 using ::testing::Matcher;
@@ -166,6 +173,117 @@ TEST(TracingTest, Scopes) {
   TracingScope(TracingLevel::Default, [] { return "scope3"; });
 }
 
+class CountingTracingSink : public TracingSink {
+ public:
+  Error RequestTracing(bool enable) override { return Error::success(); }
+  void RecordTracingEvent(NameGenerator gen_name) override { ++count; }
+  void PushTracingScope(NameGenerator gen_name) override { ++count; }
+  void PopTracingScope() override {}
+
+  int count = 0;
+};
+
+TEST(TracingTest, SelectTracingSink) {
+  TFRT_SKIP_IF(internal::kMaxTracingLevel < TracingLevel::Default);
+
+  CountingTracingSink sink;
+  AddNamedTracingSink("counting", &sink);
+
+  Error error = SelectTracingSink("unknown");
+  EXPECT_TRUE(static_cast<bool>(error));
+  consumeError(std::move(error));
+
+  EXPECT_FALSE(static_cast<bool>(SelectTracingSink("counting")));
+  RequestTracing(true);
+  RecordTracingEvent(TracingLevel::Default, [] { return "event"; });
+  RequestTracing(false);
+  EXPECT_EQ(sink.count, 1);
+}
+
+TEST(TraceBuffersTest, RingBufferDropsWhenFull) {
+  TraceRingBuffer ring(3);
+  EXPECT_EQ(ring.capacity(), 4);
+  for (int i = 0; i < 6; ++i)
+    EXPECT_EQ(ring.TryPush(TraceEvent{std::to_string(i)}), i < 4);
+  EXPECT_EQ(ring.dropped(), 2);
+
+  std::vector<std::string> names;
+  EXPECT_EQ(ring.Drain([&](TraceEvent&& event) {
+    names.push_back(std::move(event.name));
+  }),
+            4);
+  EXPECT_THAT(names, ElementsAre("0", "1", "2", "3"));
+
+  // Draining makes room again.
+  EXPECT_TRUE(ring.TryPush(TraceEvent{"4"}));
+}
+
+TEST(TraceBuffersTest, CollectsEventsOfAllThreads) {
+  constexpr int kNumThreads = 4;
+  constexpr int kNumEvents = 1000;
+  TraceBuffers buffers(/*capacity_per_thread=*/kNumEvents);
+  std::vector<std::thread::id> tids;
+  int count = 0;
+  {
+    TraceCollector collector(&buffers, std::chrono::milliseconds(1),
+                             [&](std::thread::id tid, TraceEvent&& event) {
+                               tids.push_back(tid);
+                               ++count;
+                             });
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kNumThreads; ++i) {
+      threads.emplace_back([&] {
+        for (int j = 0; j < kNumEvents; ++j)
+          buffers.Record(TraceEvent{"event"});
+      });
+    }
+    for (auto& thread : threads) thread.join();
+  }
+
+  // Every event is either collected or counted as dropped.
+  EXPECT_EQ(count + buffers.dropped(), uint64_t{kNumThreads * kNumEvents});
+  std::sort(tids.begin(), tids.end());
+  tids.erase(std::unique(tids.begin(), tids.end()), tids.end());
+  EXPECT_LE(tids.size(), kNumThreads);
+}
+
+TEST(TraceBuffersTest, AlternatingInstancesKeepTheirBuffers) {
+  TraceBuffers first(/*capacity_per_thread=*/4);
+  TraceBuffers second(/*capacity_per_thread=*/4);
+  // A thread that switches between instances keeps one buffer in each, so the
+  // fifth event of each instance is dropped.
+  for (int i = 0; i < 5; ++i) {
+    first.Record(TraceEvent{"first"});
+    second.Record(TraceEvent{"second"});
+  }
+  EXPECT_EQ(first.dropped(), 1);
+  EXPECT_EQ(second.dropped(), 1);
+
+  int count = 0;
+  first.Drain([&](std::thread::id, TraceEvent&&) { ++count; });
+  EXPECT_EQ(count, 4);
+}
+
+TEST(PerfCountersTest, CountsEnabledScopes) {
+  EXPECT_FALSE(StartPerfCounters("kernel").has_value());
+
+  if (auto error = EnablePerfCounters({"kernel"})) {
+    GTEST_SKIP() << toString(std::move(error));
+  }
+  EXPECT_FALSE(StartPerfCounters("other").has_value());
+
+  PerfCounterStart start = StartPerfCounters("kernel");
+  ASSERT_TRUE(start.has_value());
+  volatile uint64_t sum = 0;
+  for (int i = 0; i < 100000; ++i) sum += i;
+  auto counts = StopPerfCounters("kernel", start);
+  ASSERT_TRUE(counts.has_value());
+  EXPECT_GT((*counts)[static_cast<int>(PerfCounter::kInstructions)], 100000);
+
+  DisablePerfCounters();
+  EXPECT_FALSE(StartPerfCounters("kernel").has_value());
+}
+
 }  // namespace
 }  // namespace tracing
 }  // namespace tfrt
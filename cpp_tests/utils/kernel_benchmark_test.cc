@@ -0,0 +1,99 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tfrt/utils/kernel_benchmark.h"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+#include "gtest/gtest.h"
+#include "tfrt/cpp_tests/test_util.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/kernel_registry.h"
+#include "tfrt/host_context/kernel_utils.h"
+#include "tfrt/host_context/sync_kernel_frame.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+namespace {
+
+int64_t CountElements(const DenseHostTensor& tensor, int32_t scalar,
+                      Chain chain, Attribute<int64_t> extra) {
+  return tensor.NumElements() + extra.get();
+}
+
+void SyncFail(SyncKernelFrame* frame) {
+  frame->SetError(MakeStringError("something bad happened"));
+}
+
+class KernelBenchmarkTest : public ::testing::Test {
+ protected:
+  KernelBenchmarkTest() : host_(CreateHostContext()) {
+    host_->GetMutableRegistry()->AddKernel("bm.count_elements",
+                                           TFRT_KERNEL(CountElements));
+    host_->GetMutableRegistry()->AddSyncKernel("bm.sync_fail", SyncFail);
+  }
+
+  std::unique_ptr<HostContext> host_;
+};
+
+TEST_F(KernelBenchmarkTest, GeneratesArguments) {
+  KernelBenchmarkOptions options{
+      "bm.count_elements", {"f32[2,3]", "i32", "chain"}, {"i64:5"}};
+
+  auto runner = CreateKernelBenchmarkRunner(options, host_.get());
+  ASSERT_TRUE(!!runner) << toString(runner.takeError());
+  EXPECT_EQ((*runner)->RunAndGetResult<int64_t>(), 11);
+  EXPECT_FALSE((*runner)->GetRunError());
+
+  auto bytes = GetKernelBenchmarkArgumentBytes(options);
+  ASSERT_TRUE(!!bytes);
+  EXPECT_EQ(*bytes, 6 * sizeof(float) + sizeof(int32_t));
+}
+
+TEST_F(KernelBenchmarkTest, RunsOnThreads) {
+  KernelBenchmarkOptions options{
+      "bm.count_elements", {"f32[16]", "i32", "chain"}, {"i64:0"}};
+
+  auto stats = RunKernelBenchmark(options, /*num_threads=*/2,
+                                  std::chrono::milliseconds(1), host_.get());
+  ASSERT_TRUE(!!stats) << toString(stats.takeError());
+  EXPECT_EQ(stats->num_threads, 2);
+  EXPECT_GE(stats->num_runs, 2);
+  EXPECT_GT(stats->ns_per_run, 0);
+  EXPECT_GT(stats->bytes_per_second, 0);
+}
+
+TEST_F(KernelBenchmarkTest, ReportsErrors) {
+  auto error_message = [&](KernelBenchmarkOptions options) {
+    auto stats = RunKernelBenchmark(options, /*num_threads=*/1,
+                                    std::chrono::milliseconds(1), host_.get());
+    return stats ? std::string() : toString(stats.takeError());
+  };
+
+  EXPECT_EQ(error_message({"bm.unknown"}), "kernel not found: bm.unknown");
+  EXPECT_EQ(error_message({"bm.count_elements", {"f32[2"}}),
+            "missing ']' in argument 'f32[2'");
+  EXPECT_EQ(error_message({"bm.count_elements", {"x32"}}),
+            "unknown dtype 'x32'");
+  EXPECT_EQ(error_message({"bm.count_elements", {"f32"}, {"i64"}}),
+            "missing ':' in attribute 'i64'");
+  EXPECT_EQ(error_message({"bm.sync_fail", {}, {}, /*num_results=*/0}),
+            "something bad happened");
+}
+
+}  // namespace
+}  // namespace tfrt
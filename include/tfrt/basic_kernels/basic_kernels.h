@@ -32,6 +32,8 @@ void RegisterFloatKernels(KernelRegistry* registry);
 void RegisterControlFlowKernels(KernelRegistry* registry);
 void RegisterParallelKernels(KernelRegistry* registry);
 void RegisterDeviceKernels(KernelRegistry* registry);
+void RegisterChannelKernels(KernelRegistry* registry);
+void RegisterRendezvousKernels(KernelRegistry* registry);
 
 }  // namespace tfrt
 
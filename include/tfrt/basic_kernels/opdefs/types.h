@@ -52,6 +52,13 @@ class DeviceType
   static constexpr mlir::StringLiteral name = "tfrt.compiler.device";
 };
 
+class ChannelType
+    : public mlir::Type::TypeBase<ChannelType, mlir::Type, mlir::TypeStorage> {
+ public:
+  using Base::Base;
+  static constexpr mlir::StringLiteral name = "tfrt.compiler.channel";
+};
+
 }  // namespace compiler
 }  // namespace tfrt
 
@@ -0,0 +1,59 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Helpers to compress and decompress BEF sections.
+
+#ifndef TFRT_BEF_BEF_COMPRESSION_H_
+#define TFRT_BEF_BEF_COMPRESSION_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/Error.h"
+#include "tfrt/bef/bef_encoding.h"
+
+namespace tfrt {
+
+// A decoded kCompressed section.
+struct CompressedBEFSection {
+  BEFSectionID section_id;
+  BEFCompressionFormat format;
+  size_t uncompressed_size;
+  ArrayRef<uint8_t> data;
+};
+
+// Return true if this build can compress and decompress `format`.
+bool IsBEFCompressionAvailable(BEFCompressionFormat format);
+
+// Compress `data` with `format` into `compressed`.
+llvm::Error CompressBEFSectionData(BEFCompressionFormat format,
+                                   ArrayRef<uint8_t> data,
+                                   llvm::SmallVectorImpl<uint8_t>* compressed);
+
+// Decode the payload of a kCompressed section. Return false if the payload is
+// corrupted.
+bool ReadCompressedBEFSection(ArrayRef<uint8_t> payload,
+                              CompressedBEFSection* section);
+
+// Decompress the data of `section` into `data`.
+llvm::Error DecompressBEFSection(const CompressedBEFSection& section,
+                                 llvm::SmallVectorImpl<uint8_t>* data);
+
+}  // namespace tfrt
+
+#endif  // TFRT_BEF_BEF_COMPRESSION_H_
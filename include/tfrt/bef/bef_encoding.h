@@ -95,6 +95,19 @@ enum class BEFSectionID : uint8_t {
   // It will be used for converting BEF back to mlir.
   kRegisterTypes = 10,
 
+  // The compressed section holds the compressed data of another section. Its
+  // payload is the id of that section, the BEFCompressionFormat, the VBR
+  // encoded length of the uncompressed data, and then the compressed data.
+  // Only sections that are not needed for execution (locations, attribute
+  // names) are compressed, so the executable sections stay mappable.
+  kCompressed = 11,
+
+  // The kernel timeouts section lists the kernels that have a timeout, by the
+  // offset of their function in the Functions section and their kernel index.
+  // A kernel whose results are not available by its timeout gets them set to
+  // a timeout error. Only present if some kernel has a timeout.
+  kKernelTimeouts = 12,
+
   // kNumSectionIDs is the number of section ids in a BEF file including
   // optional sections.
   kNumSectionIDs,
@@ -104,11 +117,18 @@ enum : size_t {
   // Kernels in BEF are 4-byte aligned.
   kKernelEntryAlignment = 4,
 
-  // DenseTensor data address alignment.
-  kAttributeTensorAlignment = 8,
+  // DenseTensor data address alignment. The data of tensor attributes is
+  // aligned to cache lines, so that kernels can use it without copying.
+  kAttributeTensorAlignment = 64,
 
   // Maximum attribute alignment.
-  kAttributeMaxAlignment = 8,
+  kAttributeMaxAlignment = 64,
+};
+
+// The compression formats of BEF sections.
+enum class BEFCompressionFormat : uint8_t {
+  kZlib = 1,
+  kZstd = 2,
 };
 
 // This enum defined the function kind.
@@ -123,6 +143,11 @@ enum class FunctionKind : uint8_t {
 
   // This is the sync BEF function that defines registers and kernels in BEF.
   kSyncBEFFunction = 2,
+
+  // This is an async BEF function produced by kernel fusion. Its kernels are
+  // run one after another in program order by the calling thread, instead of
+  // being scheduled by BEFExecutor.
+  kFusedBEFFunction = 3,
 };
 
 // Below constants defines bit positions and bit sizes for different category of
@@ -62,12 +62,13 @@ class BefLocation {
 
   explicit operator bool() const { return base_ != nullptr; }
 
+  // Returns the pointer past the end of the location at `ptr`.
+  static const uint8_t *NextLocation(const uint8_t *ptr);
+
  protected:
   string_view OffsetToString(ArrayRef<uint8_t> location_strings_section,
                              size_t offset) const;
 
-  static const uint8_t *NextLocation(const uint8_t *ptr);
-
   const uint8_t *base_ = nullptr;
   size_t length_ = 0;
 };
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares the cache of encoded BEF functions that MLIRToBEF reuses
+// across conversions.
+
+#ifndef TFRT_BEF_CONVERTER_BEF_FUNCTION_CACHE_H_
+#define TFRT_BEF_CONVERTER_BEF_FUNCTION_CACHE_H_
+
+#include <atomic>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "tfrt/support/forward_decls.h"
+
+namespace tfrt {
+
+// BefFunctionCache stores the per-function results of MLIRToBEF in a
+// directory, one file per entry, so that a conversion of a module in which
+// only a few functions changed reuses the results of the unchanged functions
+// from a previous conversion. The entries are keyed by content hashes that
+// the converter computes, and are never invalidated: a changed function has a
+// different key.
+//
+// The cache is thread-safe, and several processes may share a directory.
+// Entries are written to a temporary file and renamed, so a reader never sees
+// a partial entry.
+class BefFunctionCache {
+ public:
+  // Creates a cache of the entries in `directory`, which is created on the
+  // first insertion if it does not exist.
+  explicit BefFunctionCache(std::string directory)
+      : directory_(std::move(directory)) {}
+
+  BefFunctionCache(const BefFunctionCache&) = delete;
+  BefFunctionCache& operator=(const BefFunctionCache&) = delete;
+
+  // Returns the entry for `key`, or std::nullopt if there is none.
+  std::optional<std::string> Lookup(string_view key) const;
+
+  // Stores `value` as the entry for `key`. The cache only saves work, so
+  // failures to write the entry are ignored.
+  void Insert(string_view key, string_view value) const;
+
+  const std::string& directory() const { return directory_; }
+
+  // The number of lookups that found an entry, and that did not.
+  size_t num_hits() const { return num_hits_.load(std::memory_order_relaxed); }
+  size_t num_misses() const {
+    return num_misses_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::string EntryPath(string_view key) const;
+
+  std::string directory_;
+  mutable std::atomic<size_t> num_hits_{0};
+  mutable std::atomic<size_t> num_misses_{0};
+};
+
+}  // namespace tfrt
+
+#endif  // TFRT_BEF_CONVERTER_BEF_FUNCTION_CACHE_H_
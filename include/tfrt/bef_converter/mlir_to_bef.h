@@ -20,15 +20,23 @@
 #define TFRT_BEF_CONVERTER_MLIR_TO_BEF_H_
 
 #include <cstdint>
+#include <optional>
 #include <vector>
 
 #include "tfrt/bef/bef_buffer.h"
+#include "tfrt/bef/bef_encoding.h"
 
 namespace mlir {
 class ModuleOp;
 }
 
 namespace tfrt {
+class BefFunctionCache;
+
+// The name of the attribute that sets the timeout of a kernel in milliseconds,
+// e.g. `{_tfrt_timeout_ms = 100 : i64}`. It is not passed to the kernel, but
+// recorded in the KernelTimeouts section for the executor.
+inline constexpr char kKernelTimeoutAttrName[] = "_tfrt_timeout_ms";
 
 // This function converts the specified MLIR module containing a host executor
 // compatible program to the BinaryExecutableFormat (BEF) format, which is the
@@ -36,8 +44,20 @@ namespace tfrt {
 //
 // On error, this emits the error message through the MLIR error handler, and
 // returns an empty AlignedBuffer.
-BefBuffer ConvertMLIRToBEF(mlir::ModuleOp module,
-                           bool disable_optional_sections);
+//
+// If `debug_section_compression` is set, the sections that are only needed
+// for diagnostics (LocationStrings, Locations and AttributeNames) are
+// compressed with it when it is available and makes them smaller.
+//
+// If `function_cache` is set, the encodings of the functions, and their stream
+// analysis, are reused from it when the functions did not change since they
+// were cached, and the others are added to it. The result does not depend on
+// the cache.
+BefBuffer ConvertMLIRToBEF(
+    mlir::ModuleOp module, bool disable_optional_sections,
+    std::optional<BEFCompressionFormat> debug_section_compression =
+        std::nullopt,
+    const BefFunctionCache* function_cache = nullptr);
 
 }  // namespace tfrt
 
@@ -0,0 +1,108 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Per-request BEFExecutor options
+//
+// This file declares BEFExecutorOptions, which a client may insert into the
+// RequestContext::ContextData of a request to tune how BEFExecutor schedules
+// the kernels of that request.
+
+#ifndef TFRT_BEF_EXECUTOR_BEF_EXECUTOR_OPTIONS_H_
+#define TFRT_BEF_EXECUTOR_BEF_EXECUTOR_OPTIONS_H_
+
+#include <cstdint>
+
+namespace tfrt {
+
+class CriticalPathRecorder;
+class KernelCpuProfile;
+class KernelProfile;
+class KernelSampler;
+
+// Sample usage:
+//   RequestContextBuilder builder(host, resource_context);
+//   builder.context_data().emplace<BEFExecutorOptions>().work_stealing = true;
+struct BEFExecutorOptions {
+  // By default, every group of ready kernels that belongs to another stream is
+  // enqueued to the work queue as a separate task. When `work_stealing` is set,
+  // the groups are instead pushed to a ready pool owned by the executor, and a
+  // bounded number of worker tasks (at most the work queue parallelism level)
+  // pop and run them in batches. This avoids flooding the work queue with tiny
+  // tasks when a wide graph fans out.
+  bool work_stealing = false;
+
+  // The maximum number of stream groups a worker task takes from the ready
+  // pool at once. Larger batches reduce synchronization on the pool at the cost
+  // of less even load balancing.
+  int steal_batch_size = 4;
+
+  // If set, the wall time of every kernel invocation is recorded into this
+  // profile. For asynchronous kernels this only covers the time until the
+  // kernel returns, not until its results become available. The profile is
+  // not owned and must outlive the execution.
+  KernelProfile* kernel_profile = nullptr;
+
+  // If set, the CPU time of the thread and the wall time of every kernel
+  // invocation are recorded into this profile, per function and kernel name.
+  // Reading the thread CPU clock costs a system call on some platforms, so
+  // this is meant for profiling runs. It is ignored if `kernel_profile` is
+  // set. The profile is not owned and must outlive the execution.
+  KernelCpuProfile* kernel_cpu_profile = nullptr;
+
+  // If set, about one in `kernel_sampler->sample_period()` kernel invocations
+  // is timed with the cycle counter and recorded into this sampler, which is
+  // cheap enough to leave enabled. It is ignored if `kernel_profile` or
+  // `kernel_cpu_profile` is set.
+  // The sampler is not owned and must outlive the execution.
+  KernelSampler* kernel_sampler = nullptr;
+
+  // If true, every kernel invocation makes the kernel the AllocationSite of
+  // its thread until it returns, so that an allocation profiler created with
+  // CreateAllocationProfiler() attributes the allocations to the kernel.
+  bool attribute_allocations = false;
+
+  // If set, the ready, start and end times of the kernels of every execution,
+  // and the producer that made each kernel ready, are recorded into this
+  // recorder when the execution completes. Executions then also stay alive
+  // until their unused asynchronous results are available. The recorder is not
+  // owned and must outlive the execution.
+  CriticalPathRecorder* critical_path_recorder = nullptr;
+
+  // If true, the kernels of other streams that become ready are enqueued with
+  // an affinity hint for their stream, so that the work queue runs the kernels
+  // of one stream on the same worker, where the registers the stream produced
+  // are likely still in cache. Idle workers may still steal them. This is
+  // ignored in the work stealing mode.
+  bool stream_affinity = false;
+
+  // If true, about one in `adaptive_sample_period` kernel invocations is timed
+  // into a moving average of the execution time of the kernel, which is kept
+  // with the function and shared by all of its executions. The averages then
+  // override the streams assigned by the compiler: a ready kernel of another
+  // stream that takes less than `max_inline_kernel_ns` runs inline instead of
+  // being enqueued, and a ready kernel of the current stream that takes at
+  // least `min_outline_kernel_ns` is enqueued if other kernels are left to run
+  // inline. Kernels that were not timed yet keep their stream placement.
+  //
+  // Setting the environment variable TFRT_DISABLE_ADAPTIVE_KERNEL_PLACEMENT to
+  // "true" or "1" disables this for every request of the process.
+  bool adaptive_placement = false;
+  uint32_t adaptive_sample_period = 16;
+  float max_inline_kernel_ns = 2000;
+  float min_outline_kernel_ns = 100000;
+};
+
+}  // namespace tfrt
+
+#endif  // TFRT_BEF_EXECUTOR_BEF_EXECUTOR_OPTIONS_H_
@@ -22,7 +22,9 @@
 
 #include <functional>
 #include <memory>
+#include <vector>
 
+#include "llvm/ADT/StringMap.h"
 #include "tfrt/support/forward_decls.h"
 #include "tfrt/support/ref_count.h"
 
@@ -33,12 +35,41 @@ class SmallVectorImpl;
 
 namespace tfrt {
 
+class AsyncValue;
 struct DecodedDiagnostic;
+class ExecutionContext;
 class Function;
 class HostAllocator;
+class HostContext;
 class KernelRegistry;
 class LocationHandler;
 
+// The inputs that BEFFile::WarmUp() executes the functions of a BEF file with,
+// keyed by function name.
+class BEFWarmUpInputs {
+ public:
+  // Return the arguments of one warm-up execution. It is called for every
+  // execution, as functions may consume their arguments.
+  using ArgumentsFactory =
+      std::function<std::vector<RCReference<AsyncValue>>()>;
+
+  // Register `make_arguments` as an input of the function `function_name`. A
+  // function may have several inputs, e.g. to warm up the kernels for all the
+  // shapes it is served with.
+  void Register(string_view function_name, ArgumentsFactory make_arguments) {
+    inputs_[function_name].push_back(std::move(make_arguments));
+  }
+
+  ArrayRef<ArgumentsFactory> Get(string_view function_name) const {
+    auto it = inputs_.find(function_name);
+    if (it == inputs_.end()) return {};
+    return it->second;
+  }
+
+ private:
+  llvm::StringMap<std::vector<ArgumentsFactory>> inputs_;
+};
+
 // Instances of this class represent a BEF file in memory.  The in-memory
 // representation of BEF files is HostContext independent, allowing reuse across
 // multiple contexts if desired.
@@ -52,6 +83,10 @@ class BEFFile : public ReferenceCounted<BEFFile> {
   // pointer to our initialized object on success.  On failure, an error
   // message is emitted to the error_handler and nullptr is returned.
   //
+  // The kernel and register tables of the functions are decoded on their first
+  // execution. The format errors in a function are emitted to the
+  // error_handler then, and the executions of the function fail.
+  //
   // TODO: This should (optionally) manage ownership of the underlying data
   // passed in, taking a closure to run when the lifetime of the BEFFile is
   // done.
@@ -60,6 +95,29 @@ class BEFFile : public ReferenceCounted<BEFFile> {
                                    ErrorHandler error_handler,
                                    HostAllocator* host_allocator);
 
+  // Like Open(), but spreads the work that grows with the size of the file
+  // over the non-blocking worker threads of `host`, after the section and
+  // function index tables have been read: the kernels are resolved in
+  // parallel, and so are the kernel and register tables of all BEFFunctions,
+  // which Open() decodes lazily on the first execution of each function
+  // instead. A malformed function therefore fails the open. The caller blocks
+  // until the file is decoded, so it must not be a worker thread of `host`.
+  static RCReference<BEFFile> OpenParallel(ArrayRef<uint8_t> file,
+                                           const KernelRegistry& registry,
+                                           ErrorHandler error_handler,
+                                           HostContext* host);
+
+  // Memory-map the BEF file at `path` read-only through the io::FileSystem
+  // registered for its scheme, and open it in place without copying. The
+  // mapping is owned by the returned BEFFile and released together with its
+  // last reference, so the file pages live in the shared page cache and are
+  // not duplicated across processes that load the same file. On failure, an
+  // error message is emitted to the error_handler and nullptr is returned.
+  static RCReference<BEFFile> OpenMapped(string_view path,
+                                         const KernelRegistry& registry,
+                                         ErrorHandler error_handler,
+                                         HostAllocator* host_allocator);
+
   // Get a list of functions out of the BEF file.
   void GetFunctionList(llvm::SmallVectorImpl<const Function*>* result) const;
 
@@ -67,6 +125,19 @@ class BEFFile : public ReferenceCounted<BEFFile> {
   // found in this BEF file.
   const Function* GetFunction(string_view function_name) const;
 
+  // Prepare the file for its first requests, which would otherwise pay for
+  // page faults and lazy initialization. This reads every page of the sections
+  // of the file, which faults in files opened with OpenMapped(), and decodes
+  // the kernel and register tables of all functions and the location sections.
+  // Then every function with registered `inputs` is executed `num_runs` times
+  // with each of them in `exec_ctx`, and awaited. This grows the executor
+  // pools of the functions and the pools of the allocator, and initializes the
+  // caches of the kernels. The caller blocks until the executions completed,
+  // so it must not be a worker thread of the host. Return the first decoding
+  // error, or the first error result of the warm-up executions.
+  Error WarmUp(const ExecutionContext& exec_ctx, const BEFWarmUpInputs& inputs,
+               int num_runs = 1) const;
+
   LocationHandler* location_handler() const { return location_handler_.get(); }
 
   virtual ~BEFFile() = 0;
@@ -76,14 +147,14 @@ class BEFFile : public ReferenceCounted<BEFFile> {
 };
 
 // Execute SyncBEFFunction synchronously. Return excution error in the Error
-// return value.
+// return value. A native function with a SyncNativeCallable is run on the
+// Values directly as well.
 //
 // TODO(jingdong): Remove this function once we implement
 // SyncBEFFunction::Execute() that takes and returns AsyncValue. This is
 // required for now, as we want to be able to call
 // SyncBEFFunction::SyncExecute() without exposing SyncBEFFunction in the header
 // file.
-class ExecutionContext;
 class Value;
 Error ExecuteSyncBEFFunction(const Function& func,
                              const ExecutionContext& exec_ctx,
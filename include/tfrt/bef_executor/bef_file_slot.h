@@ -0,0 +1,114 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Hot-reloadable BEF file
+//
+// This file declares BEFFileSlot, which publishes the current version of a BEF
+// file to the requests of a server. A new version is opened and warmed up in
+// the background and then swapped in atomically, without draining the traffic:
+// requests that already took a reference to the previous version keep running
+// it, and the previous version is released with their last reference.
+
+#ifndef TFRT_BEF_EXECUTOR_BEF_FILE_SLOT_H_
+#define TFRT_BEF_EXECUTOR_BEF_FILE_SLOT_H_
+
+#include <atomic>
+#include <cstdint>
+
+#include "llvm/ADT/FunctionExtras.h"
+#include "llvm/Support/Error.h"
+#include "tfrt/bef_executor/bef_file.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/ref_count.h"
+
+namespace tfrt {
+
+class HostContext;
+
+// Sample usage:
+//   BEFFileSlot slot(BEFFile::Open(...));
+//
+//   // For every request:
+//   RCReference<BEFFile> bef_file = slot.Get();
+//   bef_file->GetFunction("main")->Execute(exec_ctx, arguments, results);
+//
+//   // To roll out a new version:
+//   slot.Reload(host, [] { return BEFFile::OpenMapped(...); },
+//               [](const BEFFile& file) { return RunWarmUpRequests(file); });
+//
+// The Function records of a BEFFile are only valid while a reference to the
+// file is held, so a request must keep the reference returned by Get() until
+// it has looked up and started all the functions it executes. Executions
+// started from the file keep it alive themselves.
+class BEFFileSlot {
+ public:
+  BEFFileSlot() = default;
+  explicit BEFFileSlot(RCReference<BEFFile> bef_file) {
+    Publish(std::move(bef_file));
+  }
+  ~BEFFileSlot();
+
+  BEFFileSlot(const BEFFileSlot&) = delete;
+  BEFFileSlot& operator=(const BEFFileSlot&) = delete;
+
+  // Return a reference to the current version, or null if none was published
+  // yet. This does not block, also not while a new version is published, and
+  // is thread-safe.
+  RCReference<BEFFile> Get() const;
+
+  // The number of versions published so far.
+  int64_t version() const { return version_.load(); }
+
+  // Make `bef_file` the current version and return the previous one. This
+  // waits for the concurrent Get() calls that may still be reading the
+  // previous version, but not for the requests running it.
+  RCReference<BEFFile> Publish(RCReference<BEFFile> bef_file);
+
+  // Open a new version with `open` in a blocking work queue thread of `host`,
+  // warm it up with `warm_up` if given, and publish it. Until then Get()
+  // returns the current version. The returned chain becomes available once the
+  // new version is published, or an error if `open` returns null or `warm_up`
+  // fails, in which case the current version stays published. The slot must
+  // outlive the reload.
+  AsyncValueRef<Chain> Reload(
+      HostContext* host, llvm::unique_function<RCReference<BEFFile>()> open,
+      llvm::unique_function<llvm::Error(const BEFFile&)> warm_up = nullptr);
+
+ private:
+  // Readers pin the version they read by counting themselves in the reader
+  // count of the current epoch, as in a reader-side RCU lock. Publishing a
+  // version swaps it in, switches the epoch, and then waits for the readers of
+  // the previous epoch to leave. New readers are counted in the new epoch, so
+  // they cannot starve a publisher.
+  struct alignas(64) ReaderCount {
+    std::atomic<int64_t> value{0};
+  };
+
+  std::atomic<BEFFile*> current_{nullptr};
+  std::atomic<int64_t> version_{0};
+
+  mutable std::atomic<uint32_t> epoch_{0};
+  mutable ReaderCount readers_[2];
+
+  // Serializes publishers.
+  mutex publish_mu_;
+};
+
+}  // namespace tfrt
+
+#endif  // TFRT_BEF_EXECUTOR_BEF_FILE_SLOT_H_
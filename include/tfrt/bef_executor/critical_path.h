@@ -0,0 +1,131 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Critical path recorder for BEF executions
+//
+// This file declares CriticalPathRecorder, which collects a trace of every
+// BEFExecutor execution: when each kernel became ready, started and ended, and
+// which producer made it ready, i.e. the producer whose result arrived last.
+// AnalyzeCriticalPath() follows these edges back from the kernel that
+// completed last to find the critical path, and computes how much each kernel
+// and each stream could have been delayed without delaying the execution.
+//
+// The traces are written as text, one execution after another:
+//
+//   function <function name>
+//   <kernel id> <stream id> <unblocked by> <ready ns> <start ns> <end ns>
+//       <done ns> <kernel name> [<user kernel id>...]
+//
+// where the times are nanoseconds since the start of the execution, -1 for
+// kernels that did not run, and <unblocked by> is -1 for the arguments pseudo
+// kernel. Lines starting with '#' are comments.
+
+#ifndef TFRT_BEF_EXECUTOR_CRITICAL_PATH_H_
+#define TFRT_BEF_EXECUTOR_CRITICAL_PATH_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "llvm/Support/Error.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
+
+namespace tfrt {
+
+struct KernelTrace {
+  std::string name;
+  int stream_id = 0;
+  // The kernel whose result made this kernel ready, or -1 if the kernel did
+  // not run or is the arguments pseudo kernel.
+  int unblocked_by = -1;
+  // The times the kernel became ready, was started and returned.
+  int64_t ready_ns = -1;
+  int64_t start_ns = -1;
+  int64_t end_ns = -1;
+  // The time the last result of the kernel became available. It is later than
+  // `end_ns` for asynchronous kernels.
+  int64_t done_ns = -1;
+  // The kernels that use the results of this kernel.
+  std::vector<unsigned> users;
+
+  bool ran() const { return start_ns >= 0; }
+};
+
+struct ExecutionTrace {
+  std::string function_name;
+  // Indexed by kernel id. Kernel 0 is the pseudo kernel that provides the
+  // function arguments.
+  std::vector<KernelTrace> kernels;
+};
+
+class CriticalPathRecorder {
+ public:
+  // Record the trace of one execution. This is thread-safe.
+  void Record(ExecutionTrace trace);
+
+  // Return a snapshot of the traces recorded so far.
+  std::vector<ExecutionTrace> GetTraces() const;
+
+  // Write the traces in the text format described above.
+  void Print(raw_ostream& os) const;
+
+ private:
+  mutable mutex mu_;
+  std::vector<ExecutionTrace> traces_ TFRT_GUARDED_BY(mu_);
+};
+
+// Parse traces written by CriticalPathRecorder::Print().
+llvm::Expected<std::vector<ExecutionTrace>> ParseExecutionTraces(
+    string_view text);
+
+struct CriticalPath {
+  struct StreamSlack {
+    int stream_id = 0;
+    int num_kernels = 0;
+    int num_critical_kernels = 0;
+    // The total time the kernels of the stream ran, and waited between
+    // becoming ready and being started.
+    int64_t busy_ns = 0;
+    int64_t queued_ns = 0;
+    // The smallest and average slack of the kernels of the stream.
+    int64_t min_slack_ns = 0;
+    int64_t mean_slack_ns = 0;
+  };
+
+  // The time the last kernel completed.
+  int64_t latency_ns = 0;
+  // The kernels on the critical path, from the first to the last to run. The
+  // arguments pseudo kernel is not included.
+  std::vector<unsigned> kernels;
+  // Indexed by kernel id: how much later the kernel could have completed
+  // without delaying the execution, given the observed durations of the
+  // kernels after it. -1 for kernels that did not run.
+  std::vector<int64_t> slack_ns;
+  // Sorted by stream id.
+  std::vector<StreamSlack> streams;
+};
+
+CriticalPath AnalyzeCriticalPath(const ExecutionTrace& trace);
+
+// Print the critical path and the slack per stream of `trace` in a human
+// readable form.
+void PrintCriticalPath(const ExecutionTrace& trace, const CriticalPath& path,
+                       raw_ostream& os);
+
+}  // namespace tfrt
+
+#endif  // TFRT_BEF_EXECUTOR_CRITICAL_PATH_H_
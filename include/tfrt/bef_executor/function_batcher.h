@@ -0,0 +1,89 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Dynamic batching of function calls
+//
+// This file declares FunctionBatcher, which collects concurrent calls of a
+// function whose arguments and results are DenseHostTensors with a leading
+// batch dimension. It concatenates the arguments of the calls along dimension
+// 0, executes the function once for the whole batch, and hands each caller the
+// rows of the results that belong to its call. This lets many small requests
+// share kernels that are only efficient at larger batch sizes, e.g. matmul.
+
+#ifndef TFRT_BEF_EXECUTOR_FUNCTION_BATCHER_H_
+#define TFRT_BEF_EXECUTOR_FUNCTION_BATCHER_H_
+
+#include <chrono>
+#include <memory>
+
+#include "tfrt/host_context/async_value.h"
+#include "tfrt/support/forward_decls.h"
+
+namespace tfrt {
+
+class ExecutionContext;
+class Function;
+
+struct FunctionBatcherOptions {
+  // A batch runs as soon as it has this many calls.
+  int max_batch_size = 32;
+
+  // A batch runs at most this long after its first call, even if it is not
+  // full. This bounds the latency added to a call by batching.
+  std::chrono::microseconds batch_timeout{1000};
+};
+
+class FunctionBatcher {
+ public:
+  // `function` must outlive the batcher and the calls made through it. All its
+  // arguments and results must be DenseHostTensors, and dimension 0 of each
+  // argument of a call must be the number of rows of the call. Results must
+  // have the sum of the rows of the calls as dimension 0.
+  FunctionBatcher(const Function* function, FunctionBatcherOptions options);
+
+  // Runs the pending batch, if any.
+  ~FunctionBatcher();
+
+  FunctionBatcher(const FunctionBatcher&) = delete;
+  FunctionBatcher& operator=(const FunctionBatcher&) = delete;
+
+  // Adds a call to the current batch, like Function::Execute(). Populates
+  // `results` with unavailable AsyncValues, which become available once the
+  // batch has run. The batch executes in a request of its own, with the
+  // ResourceContext of its calls and the highest priority among them. A call
+  // that is cancelled before its results are ready fails alone, and the
+  // deadlines of the calls do not apply to the batch.
+  //
+  // Only calls with the same ResourceContext are batched together. Calls whose
+  // arguments cannot be concatenated with the rest of their batch (different
+  // dtypes, or different dimensions other than dimension 0), or differ from
+  // each other in dimension 0, are executed on their own, in their own
+  // ExecutionContext.
+  void Execute(const ExecutionContext& exec_ctx,
+               ArrayRef<AsyncValue*> arguments,
+               MutableArrayRef<RCReference<AsyncValue>> results);
+
+  // Runs the pending batch now, without waiting for it to fill up.
+  void Flush();
+
+ private:
+  class Impl;
+  // Shared with the timers of pending batches, which may fire concurrently
+  // with the destruction of the batcher.
+  std::shared_ptr<Impl> impl_;
+};
+
+}  // namespace tfrt
+
+#endif  // TFRT_BEF_EXECUTOR_FUNCTION_BATCHER_H_
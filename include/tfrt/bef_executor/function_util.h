@@ -34,8 +34,8 @@
 
 namespace tfrt {
 
-// A utility function to make invoking a sync tfrt::Function, similar
-// to invoking a C++ function.
+// A utility function to make invoking a sync tfrt::Function, or a native
+// function with a sync implementation, similar to invoking a C++ function.
 //
 // Example:
 //
@@ -66,7 +66,8 @@ template <typename... Args, size_t N>
 Error InvokeSyncFunctionHelper(const Function& function,
                                const ExecutionContext& exec_ctx,
                                std::array<Value, N>* results, Args&&... args) {
-  assert(function.function_kind() == tfrt::FunctionKind::kSyncBEFFunction);
+  assert(function.function_kind() == tfrt::FunctionKind::kSyncBEFFunction ||
+         function.function_kind() == tfrt::FunctionKind::kNativeFunction);
 
   static constexpr size_t kNArgs = sizeof...(Args);
   if (function.num_arguments() != kNArgs ||
@@ -0,0 +1,85 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Per-kernel CPU time profile
+//
+// This file declares KernelCpuProfile, which accumulates the CPU time of the
+// thread and the wall time BEFExecutor spends in each kernel invocation, per
+// BEF function and kernel name. A kernel that takes much more wall time than
+// CPU time blocks its thread, e.g. on I/O, locks or Await(); the time an
+// asynchronous kernel waits for its results after it returns is not counted.
+//
+// The times are also added to the counter metrics
+//
+//   /tfrt/bef_executor/kernel_cpu_time_ns/<function name>/<kernel name>
+//   /tfrt/bef_executor/kernel_wall_time_ns/<function name>/<kernel name>
+//
+// so they are exported through the registered metrics::MetricsRegistry.
+
+#ifndef TFRT_BEF_EXECUTOR_KERNEL_CPU_PROFILE_H_
+#define TFRT_BEF_EXECUTOR_KERNEL_CPU_PROFILE_H_
+
+#include <chrono>
+#include <cstdint>
+
+#include "llvm/ADT/StringMap.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
+
+namespace tfrt {
+namespace metrics {
+class Counter;
+}  // namespace metrics
+
+class KernelCpuProfile {
+ public:
+  struct Entry {
+    int64_t count = 0;
+    int64_t cpu_ns = 0;
+    int64_t wall_ns = 0;
+  };
+
+  // The name recorded for functions without a name.
+  static constexpr char kAnonymousFunction[] = "<anonymous>";
+
+  // Record one invocation of `kernel_name` in `function_name` during which
+  // the calling thread consumed `cpu_time`, and that took `wall_time`. This is
+  // thread-safe.
+  void Record(string_view function_name, string_view kernel_name,
+              std::chrono::nanoseconds cpu_time,
+              std::chrono::nanoseconds wall_time);
+
+  // Return a snapshot of the entries recorded so far, keyed by function name
+  // and then by kernel name.
+  llvm::StringMap<llvm::StringMap<Entry>> GetEntries() const;
+
+  // Write one line per function and kernel, sorted by name:
+  //
+  //   <number of calls> <total CPU ns> <total wall ns> <function> <kernel>
+  void Print(raw_ostream& os) const;
+
+ private:
+  struct KernelEntry {
+    Entry entry;
+    metrics::Counter* cpu_time_ns;
+    metrics::Counter* wall_time_ns;
+  };
+
+  mutable mutex mu_;
+  llvm::StringMap<llvm::StringMap<KernelEntry>> entries_ TFRT_GUARDED_BY(mu_);
+};
+
+}  // namespace tfrt
+
+#endif  // TFRT_BEF_EXECUTOR_KERNEL_CPU_PROFILE_H_
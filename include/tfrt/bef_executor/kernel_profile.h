@@ -0,0 +1,66 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Per-kernel wall time profile
+//
+// This file declares KernelProfile, which accumulates the wall time BEFExecutor
+// spends in each kernel, keyed by the source location of the kernel. The
+// profile is written as text and can be fed back to the compiler (see
+// tfrt-apply-kernel-profile) to drive stream analysis with measured costs.
+//
+// Each line of the text format describes one kernel location:
+//
+//   <number of calls> <total nanoseconds> <location>
+//
+// where <location> is "file:line:col" for kernels with a file location. Lines
+// starting with '#' are comments.
+
+#ifndef TFRT_BEF_EXECUTOR_KERNEL_PROFILE_H_
+#define TFRT_BEF_EXECUTOR_KERNEL_PROFILE_H_
+
+#include <chrono>
+#include <cstdint>
+
+#include "llvm/ADT/StringMap.h"
+#include "tfrt/host_context/location.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
+
+namespace tfrt {
+
+class KernelProfile {
+ public:
+  struct Entry {
+    int64_t count = 0;
+    int64_t total_ns = 0;
+  };
+
+  // Record one execution of the kernel at `loc` that took `duration`. Kernels
+  // without a location are ignored. This is thread-safe.
+  void Record(Location loc, std::chrono::nanoseconds duration);
+
+  // Return a snapshot of the entries recorded so far, keyed by location.
+  llvm::StringMap<Entry> GetEntries() const;
+
+  // Write the profile in the text format described above.
+  void Print(raw_ostream& os) const;
+
+ private:
+  mutable mutex mu_;
+  llvm::StringMap<Entry> entries_ TFRT_GUARDED_BY(mu_);
+};
+
+}  // namespace tfrt
+
+#endif  // TFRT_BEF_EXECUTOR_KERNEL_PROFILE_H_
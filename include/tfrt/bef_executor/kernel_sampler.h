@@ -0,0 +1,122 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Sampled per-kernel execution time
+//
+// This file declares KernelSampler, which times about one in every N kernel
+// invocations of BEFExecutor with the cycle counter of the CPU, and aggregates
+// the times per kernel name. Unlike KernelProfile, the cost of an invocation
+// that is not sampled is a thread local decrement, so the sampler can stay
+// enabled in production.
+//
+// Each sample is also recorded into the histogram metric
+// "/tfrt/bef_executor/kernel_time_ns/<kernel name>", so the per-kernel costs
+// are exported through the registered metrics::MetricsRegistry. Print()
+// writes the aggregates on demand.
+
+#ifndef TFRT_BEF_EXECUTOR_KERNEL_SAMPLER_H_
+#define TFRT_BEF_EXECUTOR_KERNEL_SAMPLER_H_
+
+#include <chrono>
+#include <cstdint>
+
+#include "llvm/ADT/StringMap.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace tfrt {
+namespace metrics {
+class Histogram;
+}  // namespace metrics
+
+class KernelSampler {
+ public:
+  struct Stats {
+    int64_t num_samples = 0;
+    double total_ns = 0;
+    double min_ns = 0;
+    double max_ns = 0;
+  };
+
+  // Samples about one in `sample_period` kernel invocations. A period of one
+  // samples every invocation.
+  explicit KernelSampler(uint32_t sample_period);
+
+  uint32_t sample_period() const { return sample_period_; }
+
+  // Returns true if the calling thread should time its next kernel invocation.
+  // The intervals between samples are drawn uniformly from
+  // [1, 2 * sample_period - 1], so that each invocation of a kernel is sampled
+  // with a probability of 1 / sample_period even if the kernels of a program
+  // run in a fixed order.
+  bool ShouldSample() {
+    static thread_local uint32_t countdown = 0;
+    if (countdown > 1) {
+      --countdown;
+      return false;
+    }
+    countdown = NextInterval();
+    return true;
+  }
+
+  // Returns a timestamp of the cycle counter of the CPU, or of the steady
+  // clock in nanoseconds on CPUs without one.
+  static uint64_t ReadCycleCounter() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t value;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(value));
+    return value;
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+  }
+
+  // Records one sampled invocation of `kernel_name` that took `cycles` ticks
+  // of ReadCycleCounter(). This is thread-safe.
+  void Record(string_view kernel_name, uint64_t cycles);
+
+  // Returns a snapshot of the statistics sampled so far, keyed by kernel name.
+  llvm::StringMap<Stats> GetStats() const;
+
+  // Writes one line per kernel, sorted by name:
+  //
+  //   <samples> <estimated calls> <mean ns> <min ns> <max ns> <kernel name>
+  void Print(raw_ostream& os) const;
+
+ private:
+  struct Entry {
+    Stats stats;
+    metrics::Histogram* histogram;
+  };
+
+  uint32_t NextInterval() const;
+
+  const uint32_t sample_period_;
+  const double ns_per_cycle_;
+
+  mutable mutex mu_;
+  llvm::StringMap<Entry> entries_ TFRT_GUARDED_BY(mu_);
+};
+
+}  // namespace tfrt
+
+#endif  // TFRT_BEF_EXECUTOR_KERNEL_SAMPLER_H_
@@ -45,6 +45,20 @@ enum class HostAllocatorType {
   // Allocator wrapped around profiled malloc and exit(1) on detecting memory
   // leak.
   kLeakCheckMalloc,
+
+  // Size-class pooled allocator with thread-local caches, based on malloc.
+  kPooledMalloc,
+
+  // Pooled malloc for small allocations and huge pages for large ones.
+  kHugePageMalloc,
+
+  // Malloc for the HostContext, plus a per-request arena for the executor
+  // state of each entry function.
+  kRequestArena,
+
+  // Malloc wrapped in a sampling allocation profiler that attributes the
+  // allocations to the kernels that make them.
+  kAllocationProfiler,
 };
 
 struct RunBefConfig {
@@ -57,6 +71,35 @@ struct RunBefConfig {
   std::string work_queue_type;
   tfrt::HostAllocatorType host_allocator_type;
   bool print_error_code = false;
+  // If non-empty, the wall time of each kernel is recorded and written to this
+  // file in the KernelProfile text format after all functions have run.
+  std::string kernel_profile_filename;
+  // With kAllocationProfiler, the per-kernel allocation summary is printed
+  // after all functions have run, and if this is non-empty the sampled
+  // allocations are also written to this file as a pprof profile.
+  std::string allocation_profile_filename;
+  // If non-empty, the critical path traces of all executions are written to
+  // this file after all functions have run, for use with bef_critical_path.
+  std::string critical_path_filename;
+  // If true, the BEF file is opened with BEFFile::OpenParallel().
+  bool parallel_open = false;
+  // If true, BEFFile::WarmUp() runs every function that takes no arguments
+  // `warmup_runs` times after the init function, before the functions are run
+  // as test cases. Output printed by the functions is repeated.
+  bool warmup = false;
+  int warmup_runs = 1;
+
+  // If non-empty, the driver generates load with this function instead of
+  // running the functions as test cases, and prints its throughput, latency
+  // percentiles and allocations. Tensor arguments are read from the BTF file
+  // `load_inputs_filename`, one group of tensors per request.
+  std::string load_function;
+  std::string load_inputs_filename;
+  // The number of client threads that run one request at a time, if
+  // `load_rate` is zero. Otherwise requests arrive at `load_rate` per second.
+  int load_clients = 1;
+  double load_rate = 0;
+  double load_duration_seconds = 10;
 };
 
 // Run the BEF program with default execution context.
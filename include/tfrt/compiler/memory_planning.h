@@ -0,0 +1,112 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// MemoryPlanning: Given a function in TFRT dialects, it assigns the buffers of
+// the intermediate values whose sizes are known at compile time to offsets in
+// a single slab, so that the runtime can allocate one slab per invocation
+// instead of one buffer per value.
+//
+// Two buffers can share memory only if one of them is dead before the other one
+// is defined, i.e. if the op defining the second buffer transitively depends on
+// every user of the first one. This stays valid when independent ops are
+// executed concurrently by BEFExecutor, unlike plain program order lifetimes.
+//
+// The offsets are assigned greedily by decreasing buffer size: every buffer is
+// placed at the lowest aligned offset that does not overlap any already placed
+// buffer it can't share memory with.
+//
+// Function arguments and values returned from the function are not planned,
+// as their buffers are owned by the caller.
+
+#ifndef TFRT_COMPILER_MEMORY_PLANNING_H_
+#define TFRT_COMPILER_MEMORY_PLANNING_H_
+
+#include <cstdint>
+#include <optional>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/Block.h"
+#include "mlir/IR/Value.h"
+
+namespace tfrt {
+namespace compiler {
+
+// MemoryPlanning is a per-function analysis that produces the memory plan of a
+// function.
+class MemoryPlanning {
+ public:
+  class SizeModelInterface {
+   public:
+    virtual ~SizeModelInterface();
+
+    // The implementation is expected to return the size in bytes of the buffer
+    // holding `value`, or std::nullopt if the buffer can't be planned (e.g. its
+    // size is only known at run time).
+    virtual std::optional<int64_t> GetBufferSize(mlir::Value value) const = 0;
+  };
+
+  // The alignment of every buffer offset, and of the slab.
+  static constexpr int64_t kBufferAlignment = 64;
+
+  struct Buffer {
+    mlir::Value value;
+    int64_t size = 0;
+    int64_t offset = 0;
+  };
+
+  // By default only values of statically shaped builtin tensor types are
+  // planned.
+  explicit MemoryPlanning(mlir::func::FuncOp op,
+                          const SizeModelInterface* size_model = nullptr);
+  explicit MemoryPlanning(mlir::Block& block,
+                          const SizeModelInterface* size_model = nullptr);
+
+  // The planned buffers, in the order their values are defined.
+  llvm::ArrayRef<Buffer> buffers() const { return buffers_; }
+
+  // Return the planned buffer of `value`, or nullptr if it is not planned.
+  const Buffer* GetBuffer(mlir::Value value) const {
+    auto iter = buffer_map_.find(value);
+    if (iter == buffer_map_.end()) return nullptr;
+    return &buffers_[iter->second];
+  }
+
+  // The size of the slab holding all planned buffers.
+  int64_t slab_size() const { return slab_size_; }
+
+  // The sum of the sizes of all planned buffers, i.e. the memory needed if no
+  // buffers shared memory.
+  int64_t total_buffer_size() const { return total_buffer_size_; }
+
+ private:
+  void AnalyzeBlock(mlir::Block& block);
+  void AssignOffsets(llvm::ArrayRef<llvm::SmallVector<int, 4>> conflicts);
+
+  llvm::SmallVector<Buffer, 8> buffers_;
+  llvm::DenseMap<mlir::Value, int> buffer_map_;
+  int64_t slab_size_ = 0;
+  int64_t total_buffer_size_ = 0;
+
+  const SizeModelInterface* size_model_ = nullptr;
+};
+
+}  // namespace compiler
+}  // namespace tfrt
+
+#endif  // TFRT_COMPILER_MEMORY_PLANNING_H_
@@ -0,0 +1,68 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// ProfileCostModel: A StreamAnalysis cost model backed by the kernel wall times
+// measured by BEFExecutor (see tfrt/bef_executor/kernel_profile.h, and the
+// `--kernel_profile` flag of bef_executor). The cost of an operation is its
+// average wall time in nanoseconds, looked up by its FileLineColLoc, so the
+// profile only applies to the same source file it was recorded from.
+//
+// The profile also picks the cost threshold: outlining a stream costs about as
+// much as running a typical kernel (a work queue task has to be created and
+// scheduled), so only streams that are several times more expensive than the
+// median kernel are worth executing in parallel.
+
+#ifndef TFRT_COMPILER_PROFILE_COST_MODEL_H_
+#define TFRT_COMPILER_PROFILE_COST_MODEL_H_
+
+#include <cstdint>
+#include <optional>
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Error.h"
+#include "mlir/IR/Operation.h"
+#include "tfrt/compiler/stream_analysis.h"
+
+namespace tfrt {
+namespace compiler {
+
+class ProfileCostModel : public StreamAnalysis::CostModelInterface {
+ public:
+  // The cost threshold is this many times the median kernel cost.
+  static constexpr int64_t kCostThresholdFactor = 4;
+
+  // Parse a profile in the KernelProfile text format.
+  static llvm::Expected<ProfileCostModel> Parse(llvm::StringRef profile);
+
+  std::optional<int64_t> GetOperationCost(mlir::Operation* op) const override;
+
+  // Return the cost threshold picked from the profile, or std::nullopt if the
+  // profile is empty.
+  std::optional<int64_t> GetCostThreshold() const;
+
+  size_t size() const { return costs_.size(); }
+
+ private:
+  // The average wall time in nanoseconds (at least 1), keyed by location.
+  llvm::StringMap<int64_t> costs_;
+};
+
+}  // namespace compiler
+}  // namespace tfrt
+
+#endif  // TFRT_COMPILER_PROFILE_COST_MODEL_H_
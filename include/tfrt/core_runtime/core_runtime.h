@@ -108,6 +108,10 @@ class CoreRuntime final {
   // This Function must take TensorHandle as inputs and produce TensorHandle
   // as output. Right now the Function cannot have side effect since it cannot
   // handle chain properly.
+  //
+  // A SyncBEFFunction takes no chain and returns none. It is run by the
+  // BEFInterpreter directly on the TensorHandles of each invocation, which
+  // avoids the BEFExecutor and the AsyncValues an async Function needs.
   Expected<CoreRuntimeOp> MakeCompositeOp(const Function* fn);
 
   // Similar to the above API, but this function takes and returns AsyncValues
@@ -0,0 +1,161 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares the caches used to reduce the overhead of dispatching the
+// same op repeatedly, as eager clients typically do in loops.
+
+#ifndef TFRT_CORE_RUNTIME_DISPATCH_CACHE_H_
+#define TFRT_CORE_RUNTIME_DISPATCH_CACHE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "llvm/ADT/SmallVector.h"
+#include "tfrt/core_runtime/op_metadata_function.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/published_snapshot.h"
+#include "tfrt/tensor/tensor_metadata.h"
+
+namespace tfrt {
+
+class OpAttrsRef;
+
+namespace internal {
+// Internal implementaion details, please do not depend on things inside this
+// namespace.
+
+// Serializes the names, types and values of `attrs` into `key`, with the
+// entries sorted by name, so that two attribute sets hold the same attributes
+// iff their keys are equal. Returns false if `attrs` has an attribute of an
+// unsupported type, in which case `key` is unspecified.
+bool GetOpAttrsCacheKey(const OpAttrsRef& attrs, std::string* key);
+
+// A thread-safe cache of the TensorMetadata computed by metadata functions,
+// keyed on the metadata function, the op attributes (see GetOpAttrsCacheKey())
+// and the argument metadata. Metadata functions must be pure functions of
+// these for the cache to be used. Only successful results are cached.
+//
+// Lookups are lock-free: the entries live in fixed size open addressing tables
+// of atomic pointers, and are immutable once published. Insertions are
+// serialized by a mutex. The cache keeps two generations of tables. Entries
+// are inserted into the current table, and a lookup that misses there looks
+// in the previous one and moves the entry it finds to the current one. Once
+// the current table holds kMaxEntries entries, or kMaxEntriesPerOp entries of
+// one op, so that an op with many different argument shapes does not take the
+// space of the others, it becomes the previous table. The previous table is
+// then freed once the lookups that may read it are done, see
+// PublishedSnapshot. So the entries that are used stay cached, and the others
+// are evicted within two generations. The hit and miss counts are reported
+// through metrics.
+class ResultMetadataCache {
+ public:
+  static constexpr size_t kMaxEntries = 4096;
+  static constexpr size_t kMaxEntriesPerOp = 512;
+
+  ResultMetadataCache();
+  ~ResultMetadataCache();
+
+  // Fills `result_mds` and returns true if the results are in the cache.
+  // `op_name` is the name of the op the metadata function belongs to.
+  bool Lookup(string_view op_name, OpMetadataFn metadata_fn,
+              string_view attrs_key, ArrayRef<TensorMetadata> argument_mds,
+              llvm::SmallVectorImpl<TensorMetadata>* result_mds);
+
+  void Insert(string_view op_name, OpMetadataFn metadata_fn,
+              string_view attrs_key, ArrayRef<TensorMetadata> argument_mds,
+              ArrayRef<TensorMetadata> result_mds);
+
+  int64_t hits() const { return hits_.load(std::memory_order_relaxed); }
+  int64_t misses() const { return misses_.load(std::memory_order_relaxed); }
+
+  // Returns the number of entries in the current generation.
+  size_t size() const;
+
+ private:
+  // A table has twice as many slots as there are entries at most, and a
+  // lookup probes at most kMaxProbes consecutive slots.
+  static constexpr size_t kNumSlots = 2 * kMaxEntries;
+  static constexpr size_t kMaxProbes = 16;
+
+  struct Entry {
+    size_t hash;
+    OpMetadataFn metadata_fn;
+    std::string attrs_key;
+    llvm::SmallVector<TensorMetadata, 4> argument_mds;
+    llvm::SmallVector<TensorMetadata, 4> result_mds;
+
+    bool Matches(size_t hash, OpMetadataFn metadata_fn, string_view attrs_key,
+                 ArrayRef<TensorMetadata> argument_mds) const;
+  };
+
+  // The entries of one generation. Entries are never removed from a table, so
+  // the probe sequence of a key never has a hole before the key.
+  struct Table {
+    Table();
+    ~Table();
+
+    const Entry* Find(size_t hash, OpMetadataFn metadata_fn,
+                      string_view attrs_key,
+                      ArrayRef<TensorMetadata> argument_mds) const;
+
+    const std::unique_ptr<std::atomic<const Entry*>[]> slots;
+  };
+
+  // The tables read by lookups. The previous table is null until the first
+  // generation ends.
+  struct Generations {
+    std::shared_ptr<const Table> current;
+    std::shared_ptr<const Table> previous;
+  };
+
+  static size_t Hash(OpMetadataFn metadata_fn, string_view attrs_key,
+                     ArrayRef<TensorMetadata> argument_mds);
+
+  // Inserts the entry into the current table. Returns false if the table or
+  // the entries of `op_name` are full, or all the slots that a lookup would
+  // probe are taken.
+  bool TryInsert(size_t hash, string_view op_name, OpMetadataFn metadata_fn,
+                 string_view attrs_key, ArrayRef<TensorMetadata> argument_mds,
+                 ArrayRef<TensorMetadata> result_mds) TFRT_REQUIRES(mu_);
+
+  // Makes the current table the previous one, and starts an empty one.
+  void StartGeneration() TFRT_REQUIRES(mu_);
+
+  // Published under `mu_`.
+  PublishedSnapshot<Generations> generations_;
+
+  mutable mutex mu_;
+  // The current table, into which entries are inserted.
+  std::shared_ptr<const Table> current_ TFRT_GUARDED_BY(mu_);
+  size_t num_entries_ TFRT_GUARDED_BY(mu_) = 0;
+  std::unordered_map<std::string, size_t> num_entries_per_op_
+      TFRT_GUARDED_BY(mu_);
+
+  std::atomic<int64_t> hits_{0};
+  std::atomic<int64_t> misses_{0};
+};
+
+// Returns the process wide result metadata cache.
+ResultMetadataCache& GetResultMetadataCache();
+
+}  // namespace internal
+}  // namespace tfrt
+
+#endif  // TFRT_CORE_RUNTIME_DISPATCH_CACHE_H_
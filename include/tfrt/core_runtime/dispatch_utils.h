@@ -309,7 +309,11 @@ template <typename OpHandlerTraits>
 
     // If this is a side effecting operation, propagate the error through the
     // result.
-    if (chain && *chain) chain->SetError(cancel_error->GetError());
+    if (chain && *chain) {
+      chain->SetError(cancel_error->GetError());
+    } else if (chain) {
+      *chain = AsyncValueRef<Chain>(FormRef(cancel_error));
+    }
     return;
   }
   // Finally, run the dispatch function.
@@ -324,7 +328,12 @@ template <typename OpHandlerTraits>
     OpHandlerTraits::Dispatch(op_entry, op_handler_info, arg_tensors, attrs,
                               result_mds, *results, &op_chain, exec_ctx);
   }
-  if (chain && *chain) {
+  if (chain && !*chain) {
+    // The op was dispatched synchronously, so its out chain is the out chain
+    // of the invocation.
+    assert(op_chain && "the op does not produce a required out chain.");
+    *chain = std::move(op_chain);
+  } else if (chain) {
     assert(op_chain && "the op does not produce a required out chain.");
     op_chain.AndThen(
         [op_chain = op_chain.CopyRef(), chain = chain->CopyRef()]() {
@@ -371,6 +380,11 @@ template <typename OpHandlerTraits>
 // If there is no shape function, then result_mds is empty, and result_md_avs
 // must be filled in with the AsyncValue's for the eventually computed shape
 // results of the tensor op.
+//
+// If the arguments and the chain are available, the op is dispatched
+// synchronously: its results and its out chain are returned as they are, and
+// result_md_avs is left empty, because the metadata can be read from the
+// results (see MakeResultTensorHandle).
 template <typename OpHandlerTraits>
 void ExecuteWithResultMetadataResolved(
     const ExecutionContext& exec_ctx, MutableArrayRef<TensorHandle> arguments,
@@ -381,16 +395,6 @@ void ExecuteWithResultMetadataResolved(
     AsyncValueRef<Chain>* chain, bool update_chain,
     typename OpHandlerTraits::OpEntryTy op_entry,
     typename OpHandlerTraits::OpHandlerInfoTy op_handler_info) {
-  // If we have no input metadatas (from a metadata function) then we need to
-  // resolve the TensorHandle metadata's from the op results.
-  if (result_md_avs) {
-    result_md_avs->reserve(num_results);
-    for (size_t i = 0; i != num_results; ++i) {
-      result_md_avs->push_back(
-          MakeUnconstructedAsyncValueRef<TensorMetadata>());
-    }
-  }
-
   // Keep track of all the non-resolved values to see if we can dispatch the
   // kernel immediately. If not we will "and then" on these non-resolved values.
   llvm::SmallVector<AsyncValue*, 4> async_args;
@@ -400,13 +404,8 @@ void ExecuteWithResultMetadataResolved(
 
   assert((!update_chain || (chain && *chain)) &&
          "the op requires an in chain.");
-  if (chain && *chain) {
-    if (!chain->IsAvailable()) async_args.push_back(chain->GetAsyncValue());
-    if (update_chain) {
-      // TODO(fishx): Avoid this heap allocation.
-      *chain = MakeUnconstructedAsyncValueRef<Chain>();
-    }
-  }
+  if (chain && *chain && !chain->IsAvailable())
+    async_args.push_back(chain->GetAsyncValue());
 
   for (auto& argument : arguments) {
     AsyncValue* async_tensor = argument.GetAsyncTensor();
@@ -422,12 +421,13 @@ void ExecuteWithResultMetadataResolved(
 
   if (async_args.empty()) {
     // All input tensor and input chain are available. We can immediately
-    // dispatch the kernel synchronously.
+    // dispatch the kernel synchronously, and the out chain of the op becomes
+    // the out chain of the invocation.
+    if (update_chain) *chain = AsyncValueRef<Chain>();
     llvm::SmallVector<RCReference<AsyncValue>, 4> result_tensors;
-    llvm::SmallVector<AsyncValueRef<TensorMetadata>, 0> empty_md_avs;
     internal::AsyncOpDispatcher<OpHandlerTraits>::RunDispatchFunctionSync(
         op_entry, op_handler_info, arg_tensors, attrs, num_results, result_mds,
-        result_md_avs ? *result_md_avs : empty_md_avs, &result_tensors,
+        /*result_missing_md_avs=*/{}, &result_tensors,
         update_chain ? chain : nullptr, exec_ctx);
     result_tensor_avs->reserve(num_results);
     // Fulfill the result async values with the results of the op.
@@ -440,6 +440,26 @@ void ExecuteWithResultMetadataResolved(
 
   // We have at least one async tensor input, so we need to run the
   // kernel when it resolves.
+
+  // If we have no input metadatas (from a metadata function) then we need to
+  // resolve the TensorHandle metadata's from the op results.
+  if (result_md_avs) {
+    result_md_avs->reserve(num_results);
+    for (size_t i = 0; i != num_results; ++i) {
+      result_md_avs->push_back(
+          MakeUnconstructedAsyncValueRef<TensorMetadata>());
+    }
+  }
+
+  // The input chain is kept alive until the kernel runs, since it may be
+  // one of the values it waits for.
+  AsyncValueRef<Chain> in_chain;
+  if (update_chain) {
+    in_chain = std::move(*chain);
+    // TODO(fishx): Avoid this heap allocation.
+    *chain = MakeUnconstructedAsyncValueRef<Chain>();
+  }
+
   internal::AsyncOpDispatcher<OpHandlerTraits> op_dispatcher(
       exec_ctx, attrs.freeze(), std::move(arg_tensors),
       update_chain ? chain->CopyRef() : AsyncValueRef<Chain>(), result_mds,
@@ -460,10 +480,35 @@ void ExecuteWithResultMetadataResolved(
     }
   }
 
-  RunWhenReady(async_args,
-               [op_dispatcher = std::move(op_dispatcher)]() mutable {
-                 op_dispatcher.RunDispatchFunction();
-               });
+  RunWhenReady(async_args, [op_dispatcher = std::move(op_dispatcher),
+                            in_chain = std::move(in_chain)]() mutable {
+    op_dispatcher.RunDispatchFunction();
+  });
+}
+
+// Returns the TensorHandle of the result `tensor` of an op without a metadata
+// function that was dispatched synchronously. The metadata is taken from the
+// tensor if it is available already, so that no async value is created for it.
+template <typename DeviceTy>
+TensorHandle MakeResultTensorHandle(DeviceTy device,
+                                    AsyncValueRef<Tensor> tensor) {
+  if (tensor.IsError()) return TensorHandle::CreateError(tensor.ReleaseRCRef());
+  if (tensor.IsAvailable()) {
+    const TensorMetadata& metadata = tensor->metadata();
+    return TensorHandle(std::move(device), metadata, std::move(tensor));
+  }
+
+  auto metadata = MakeUnconstructedAsyncValueRef<TensorMetadata>();
+  AsyncValue* tensor_av = tensor.GetAsyncValue();
+  tensor_av->AndThen([metadata = metadata.CopyRef(), tensor_av]() {
+    if (tensor_av->IsError()) {
+      metadata.SetError(tensor_av->GetError());
+    } else {
+      metadata.emplace(tensor_av->get<Tensor>().metadata());
+    }
+  });
+  return TensorHandle(std::move(device), std::move(metadata),
+                      std::move(tensor));
 }
 
 // This is the slow-path that is run when it turns out that an input
@@ -556,7 +601,19 @@ bool ExecuteOnOpHandlerImpl(
               .ReleaseRCRef());
       continue;
     }
-    if (op_entry.metadata_fn && result_device.is<RCReference<Device>>()) {
+    if (!op_entry.metadata_fn && result_md_avs.empty()) {
+      // The op was dispatched synchronously.
+      if (result_device.is<RCReference<Device>>()) {
+        results[i] = internal::MakeResultTensorHandle(
+            std::move(result_device.get<RCReference<Device>>()),
+            std::move(result_tensor_avs[i]));
+      } else {
+        results[i] = internal::MakeResultTensorHandle(
+            std::move(result_device.get<AsyncValueRef<RCReference<Device>>>()),
+            std::move(result_tensor_avs[i]));
+      }
+    } else if (op_entry.metadata_fn &&
+               result_device.is<RCReference<Device>>()) {
       results[i] =
           TensorHandle(std::move(result_device.get<RCReference<Device>>()),
                        result_mds[i], std::move(result_tensor_avs[i]));
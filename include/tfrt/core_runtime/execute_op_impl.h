@@ -27,6 +27,7 @@ class AggregateAttr;
 class ExecutionContext;
 class CoreRuntimeOp;
 class OpAttrs;
+class OpAttrsRef;
 class Value;
 class TensorHandle;
 template <typename T>
@@ -53,6 +54,14 @@ void ExecuteOpImpl(CoreRuntimeOp op, ArrayRef<AsyncValue *> args,
                    AggregateAttr op_func_attr_array,
                    const ExecutionContext &exec_ctx);
 
+// Like ExecuteOpImpl above, with the attributes set up ahead of time, e.g. to
+// reuse them across executions.
+void ExecuteOpImpl(const CoreRuntimeOp &op, ArrayRef<AsyncValue *> args,
+                   AsyncValueRef<Chain> *op_chain,
+                   MutableArrayRef<RCReference<AsyncValue>> results,
+                   const OpAttrsRef &op_attrs,
+                   const ExecutionContext &exec_ctx);
+
 void ExecuteOpImplSync(const CoreRuntimeOp &op,
                        RepeatedSyncArguments<TensorHandle> args,
                        AsyncValueRef<Chain> *op_chain, SyncKernelFrame *frame,
@@ -19,6 +19,15 @@
 #ifndef TFRT_CORE_RUNTIME_LOGGING_OP_HANDLER_H_
 #define TFRT_CORE_RUNTIME_LOGGING_OP_HANDLER_H_
 
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/raw_ostream.h"
 #include "tfrt/support/forward_decls.h"
 
 namespace tfrt {
@@ -29,6 +38,39 @@ class CoreRuntime;
 llvm::Expected<tfrt::OpHandler *> CreateLoggingOpHandler(
     tfrt::CoreRuntime *runtime, OpHandler *fallback, bool sync_log_results);
 
+// Creates an op handler that dispatches ops to `fallback` and records the name
+// of every op, the shapes of its arguments and results that are available, and
+// the time spent dispatching it. Recording neither blocks nor takes a lock
+// once a thread recorded its first op. A background thread writes the records
+// to `os` every `flush_interval`, in the format read by DecodeOpLog. Records
+// are dropped while a thread is `capacity_per_thread` records ahead of it.
+llvm::Expected<tfrt::OpHandler *> CreateAsyncLoggingOpHandler(
+    tfrt::CoreRuntime *runtime, OpHandler *fallback,
+    std::unique_ptr<llvm::raw_ostream> os,
+    std::chrono::milliseconds flush_interval = std::chrono::milliseconds(100),
+    size_t capacity_per_thread = 8192);
+
+// An op recorded by the async logging op handler.
+struct OpLogRecord {
+  // The dimensions of a tensor, or nullopt if its metadata was not available.
+  using Shape = std::optional<llvm::SmallVector<int64_t, 4>>;
+
+  std::string op_name;
+  // Numbers the threads that dispatched ops in the order they appear.
+  uint32_t thread_index;
+  // Since the creation of the op handler.
+  std::chrono::nanoseconds begin;
+  std::chrono::nanoseconds duration;
+  llvm::SmallVector<Shape, 4> argument_shapes;
+  llvm::SmallVector<Shape, 4> result_shapes;
+};
+
+// Passes the records of a log written by the async logging op handler to
+// `consume`, in order per thread. Returns the number of records the op handler
+// dropped.
+llvm::Expected<uint64_t> DecodeOpLog(
+    string_view log, llvm::function_ref<void(const OpLogRecord &)> consume);
+
 }  // namespace tfrt
 
 #endif  // TFRT_CORE_RUNTIME_LOGGING_OP_HANDLER_H_
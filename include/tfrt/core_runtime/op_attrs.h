@@ -25,6 +25,7 @@
 #include <cstdint>
 #include <memory>
 #include <optional>
+#include <string>
 
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/PointerUnion.h"
@@ -40,6 +41,61 @@ namespace tfrt {
 class OpAttrsRef;
 class ImmutableOpAttrs;
 
+// An interned attribute name. All the keys with the same name share one null
+// terminated copy of the name, so OpAttrs can find the attributes set with a
+// key by comparing pointers instead of strings. Keys are meant to be created
+// once, e.g. as static locals or when an op is registered, and reused for all
+// the Set and Get calls:
+//
+//   static const OpAttrKey kTranspose("transpose");
+//   bool transpose = attrs.GetAsserting<bool>(kTranspose);
+//
+// Creating a key takes a lock on the process-wide table of names.
+class OpAttrKey {
+ public:
+  explicit OpAttrKey(string_view name);
+
+  const char* name() const { return name_; }
+  size_t size() const { return size_; }
+  string_view str() const { return string_view(name_, size_); }
+
+  bool operator==(const OpAttrKey& other) const {
+    return name_ == other.name_;
+  }
+  bool operator!=(const OpAttrKey& other) const { return !(*this == other); }
+
+ private:
+  const char* name_;
+  size_t size_;
+};
+
+// The name of an attribute, as passed to OpAttrs and OpAttrsRef. It is either
+// an OpAttrKey, or a string that is looked up by comparing strings.
+class OpAttrName {
+ public:
+  OpAttrName(const OpAttrKey& key)  // NOLINT(google-explicit-constructor)
+      : data_(key.name()), size_(key.size()), is_interned_(true) {}
+  OpAttrName(string_view name)  // NOLINT(google-explicit-constructor)
+      : data_(name.data()), size_(name.size()) {}
+  OpAttrName(const char* name)  // NOLINT(google-explicit-constructor)
+      : OpAttrName(string_view(name)) {}
+  OpAttrName(const std::string& name)  // NOLINT(google-explicit-constructor)
+      : OpAttrName(string_view(name)) {}
+
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+  string_view str() const { return string_view(data_, size_); }
+
+  // Return true if the name is the interned name of an OpAttrKey.
+  bool IsInterned() const { return is_interned_; }
+
+ private:
+  // Keep this small enough to be passed in registers.
+  const char* data_;
+  uint32_t size_;
+  bool is_interned_ = false;
+};
+
 // Defines entry type
 //  When kExternalScalar and kExternalArray types are used,
 //  the entry data should be available during execution.
@@ -143,40 +199,40 @@ class OpAttrs final {
   // Set an attribute to the specified value, returning true on success or
   // false if an attribute with the specified name already exists.
   template <typename T>
-  bool Set(string_view attr_name, const T& value) {
+  bool Set(OpAttrName attr_name, const T& value) {
     return SetRaw(attr_name, &value, GetOpAttrType<T>(),
                   /*element_count=*/1, OpAttrsRawEntryType::kScalar);
   }
 
   // Overload for DenseAttr.
-  bool Set(string_view attr_name, DenseAttr value) {
+  bool Set(OpAttrName attr_name, DenseAttr value) {
     return SetRaw(attr_name, value.data(), OpAttrType::DENSE,
                   /*element_count=*/1, OpAttrsRawEntryType::kScalar);
   }
 
-  bool SetExternal(string_view attr_name, DenseAttr value) {
+  bool SetExternal(OpAttrName attr_name, DenseAttr value) {
     return SetRaw(attr_name, value.data(), OpAttrType::DENSE,
                   /*element_count=*/1, OpAttrsRawEntryType::kExternalScalar);
   }
 
   // Overload for ShapeAttr.
-  bool Set(string_view attr_name, ShapeAttr value) {
+  bool Set(OpAttrName attr_name, ShapeAttr value) {
     return SetRaw(attr_name, value.data(), OpAttrType::SHAPE,
                   /*element_count=*/1, OpAttrsRawEntryType::kScalar);
   }
 
-  bool SetExternal(string_view attr_name, ShapeAttr value) {
+  bool SetExternal(OpAttrName attr_name, ShapeAttr value) {
     return SetRaw(attr_name, value.data(), OpAttrType::SHAPE,
                   /*element_count=*/1, OpAttrsRawEntryType::kExternalScalar);
   }
 
   // Overload for AggregateAttr.
-  bool Set(string_view attr_name, AggregateAttr value) {
+  bool Set(OpAttrName attr_name, AggregateAttr value) {
     return SetRaw(attr_name, value.data(), OpAttrType::AGGREGATE,
                   /*element_count=*/1, OpAttrsRawEntryType::kScalar);
   }
 
-  bool SetExternal(string_view attr_name, AggregateAttr value) {
+  bool SetExternal(OpAttrName attr_name, AggregateAttr value) {
     return SetRaw(attr_name, value.data(), OpAttrType::AGGREGATE,
                   /*element_count=*/1, OpAttrsRawEntryType::kExternalScalar);
   }
@@ -184,7 +240,7 @@ class OpAttrs final {
   // Read an attribute with the specified value, returning false on failure or
   // true on success.
   template <typename T>
-  bool Get(string_view attr_name, T* value) const {
+  bool Get(OpAttrName attr_name, T* value) const {
     const OpAttrsRawEntry* result = GetRaw(attr_name);
     if (!result || result->IsArray() || result->type != GetOpAttrType<T>())
       return false;
@@ -193,7 +249,7 @@ class OpAttrs final {
   }
 
   // Overload for DenseAttr.
-  bool Get(string_view attr_name, DenseAttr* value) const {
+  bool Get(OpAttrName attr_name, DenseAttr* value) const {
     const OpAttrsRawEntry* result = GetRaw(attr_name);
     if (!result || result->IsArray() || result->type != OpAttrType::DENSE)
       return false;
@@ -202,7 +258,7 @@ class OpAttrs final {
   }
 
   // Overload for ShapeAttr.
-  bool Get(string_view attr_name, ShapeAttr* value) const {
+  bool Get(OpAttrName attr_name, ShapeAttr* value) const {
     const OpAttrsRawEntry* result = GetRaw(attr_name);
     if (!result || result->IsArray() || result->type != OpAttrType::SHAPE)
       return false;
@@ -211,7 +267,7 @@ class OpAttrs final {
   }
 
   // Overload for AggregateAttr.
-  bool Get(string_view attr_name, AggregateAttr* value) const {
+  bool Get(OpAttrName attr_name, AggregateAttr* value) const {
     const OpAttrsRawEntry* result = GetRaw(attr_name);
     if (!result || result->IsArray() || result->type != OpAttrType::AGGREGATE)
       return false;
@@ -222,7 +278,7 @@ class OpAttrs final {
   // Read a scalar attribute when it is known to exist. This asserts on
   // failure.
   template <typename T>
-  T GetAsserting(string_view attr_name) const {
+  T GetAsserting(OpAttrName attr_name) const {
     T value;
     bool success = Get(attr_name, &value);
     assert(success && "OpAttrs::GetAsserting() failed");
@@ -231,7 +287,7 @@ class OpAttrs final {
   }
 
   template <typename T>
-  std::optional<T> GetOptional(string_view attr_name) const {
+  std::optional<T> GetOptional(OpAttrName attr_name) const {
     T value;
     bool success = Get(attr_name, &value);
     if (success) {
@@ -242,19 +298,19 @@ class OpAttrs final {
   }
 
   template <typename T>
-  bool SetArray(string_view attr_name, ArrayRef<T> value) {
+  bool SetArray(OpAttrName attr_name, ArrayRef<T> value) {
     return SetRaw(attr_name, value.data(), GetOpAttrType<T>(), value.size(),
                   OpAttrsRawEntryType::kArray);
   }
 
   template <typename T>
-  bool SetArrayExternal(string_view attr_name, ArrayRef<T> value) {
+  bool SetArrayExternal(OpAttrName attr_name, ArrayRef<T> value) {
     return SetRaw(attr_name, value.data(), GetOpAttrType<T>(), value.size(),
                   OpAttrsRawEntryType::kExternalArray);
   }
 
   template <typename T>
-  bool GetArray(string_view attr_name, ArrayRef<T>* value) const {
+  bool GetArray(OpAttrName attr_name, ArrayRef<T>* value) const {
     const OpAttrsRawEntry* result = GetRaw(attr_name);
     if (!result || !result->IsArray() || result->type != GetOpAttrType<T>())
       return false;
@@ -266,7 +322,7 @@ class OpAttrs final {
   // Read an array attribute when it is known to exist. This asserts on
   // failure.
   template <typename T>
-  ArrayRef<T> GetArrayAsserting(string_view attr_name) const {
+  ArrayRef<T> GetArrayAsserting(OpAttrName attr_name) const {
     ArrayRef<T> values;
     bool success = GetArray(attr_name, &values);
     assert(success);
@@ -275,23 +331,23 @@ class OpAttrs final {
   }
 
   template <typename T>
-  ArrayRef<T> GetArrayOptional(string_view attr_name) const {
+  ArrayRef<T> GetArrayOptional(OpAttrName attr_name) const {
     ArrayRef<T> values;
     GetArray(attr_name, &values);
     return values;
   }
 
   // Support string_views as aliases of ArrayRef<char> in Get/Set.
-  bool SetString(string_view attr_name, string_view value) {
+  bool SetString(OpAttrName attr_name, string_view value) {
     return SetArray(attr_name, ArrayRef<char>(value.data(), value.size()));
   }
 
-  bool SetStringExternal(string_view attr_name, string_view value) {
+  bool SetStringExternal(OpAttrName attr_name, string_view value) {
     return SetArrayExternal(attr_name,
                             ArrayRef<char>(value.data(), value.size()));
   }
 
-  bool GetString(string_view attr_name, string_view* value) const {
+  bool GetString(OpAttrName attr_name, string_view* value) const {
     ArrayRef<char> value_ar;
     if (!GetArray(attr_name, &value_ar)) return false;
     *value = string_view(value_ar.data(), value_ar.size());
@@ -299,7 +355,7 @@ class OpAttrs final {
   }
 
   // Read a string attribute when it is known to exist. This asserts on failure.
-  string_view GetStringAsserting(string_view attr_name) const {
+  string_view GetStringAsserting(OpAttrName attr_name) const {
     string_view value;
     bool success = GetString(attr_name, &value);
     assert(success);
@@ -307,7 +363,7 @@ class OpAttrs final {
     return value;
   }
 
-  std::optional<string_view> GetStringOptional(string_view attr_name) const {
+  std::optional<string_view> GetStringOptional(OpAttrName attr_name) const {
     string_view value;
     bool success = GetString(attr_name, &value);
     if (success) {
@@ -318,17 +374,17 @@ class OpAttrs final {
   }
 
   // Support string_views as aliases of ArrayRef<char> in Get/Set.
-  bool SetFunc(string_view attr_name, FunctionAttribute value) {
+  bool SetFunc(OpAttrName attr_name, FunctionAttribute value) {
     return SetRaw(attr_name, value.func_name.data(), OpAttrType::FUNC,
                   value.func_name.size(), OpAttrsRawEntryType::kArray);
   }
 
-  bool SetFuncExternal(string_view attr_name, FunctionAttribute value) {
+  bool SetFuncExternal(OpAttrName attr_name, FunctionAttribute value) {
     return SetRaw(attr_name, value.func_name.data(), OpAttrType::FUNC,
                   value.func_name.size(), OpAttrsRawEntryType::kExternalArray);
   }
 
-  bool GetFuncName(string_view attr_name, string_view* value) const {
+  bool GetFuncName(OpAttrName attr_name, string_view* value) const {
     ArrayRef<char> value_ar;
     const OpAttrsRawEntry* result = GetRaw(attr_name);
     if (!result || !result->IsArray() || result->type != OpAttrType::FUNC)
@@ -342,7 +398,7 @@ class OpAttrs final {
 
   // Read a function attribute when it is known to exist. This asserts on
   // failure.
-  string_view GetFuncNameAsserting(string_view attr_name) const {
+  string_view GetFuncNameAsserting(OpAttrName attr_name) const {
     string_view value;
     bool success = GetFuncName(attr_name, &value);
     assert(success);
@@ -350,7 +406,7 @@ class OpAttrs final {
     return value;
   }
 
-  std::optional<string_view> GetFuncNameOptional(string_view attr_name) const {
+  std::optional<string_view> GetFuncNameOptional(OpAttrName attr_name) const {
     string_view value;
     bool success = GetFuncName(attr_name, &value);
     if (success) {
@@ -362,17 +418,17 @@ class OpAttrs final {
 
   // Look up an attribute by name, regardless of its underlying type.
   // On lookup failure, pointer is null.
-  const OpAttrsRawEntry* GetRaw(string_view attr_name) const;
+  const OpAttrsRawEntry* GetRaw(OpAttrName attr_name) const;
 
   // Look up an attribute by name, regardless of its underlying type.
-  const OpAttrsRawEntry& GetRawAsserting(string_view attr_name) const {
+  const OpAttrsRawEntry& GetRawAsserting(OpAttrName attr_name) const {
     auto* result = GetRaw(attr_name);
     assert(result);
     return *result;
   }
 
   // Set the specified attribute.
-  bool SetRaw(string_view attr_name, const void* data, OpAttrType type,
+  bool SetRaw(OpAttrName attr_name, const void* data, OpAttrType type,
               uint32_t element_count, OpAttrsRawEntryType entry_type);
 
   // Print the state of this attribute set, this is only intended for
@@ -407,6 +463,7 @@ class OpAttrs final {
 
   class OutOfLineRepresentation;
   friend class OutOfLineRepresentation;
+  friend class ImmutableOpAttrs;
 
   // Most op invocations have a small number of attributes, and we want them
   // to be formed without an allocation.  This array holds the string and
@@ -430,6 +487,11 @@ class OpAttrs final {
   // This is the number of attribute entries in OpAttrs.
   size_t num_inline_entries_ = 0;
 
+  // True if all the inline entries were set with an OpAttrKey. Their names
+  // then point to the interned names, so lookups with a key only need to
+  // compare pointers.
+  bool all_names_interned_ = true;
+
   // If non-null, OpAttrs overflowed the stack representation and all entries
   // got moved to the heap. All of the above entries are undefined when this
   // pointer is non-null.
@@ -467,7 +529,7 @@ class OpAttrsRef {
   // Read an attribute with the specified value, returning false on failure or
   // true on success.
   template <typename T>
-  bool Get(string_view attr_name, T* value) const {
+  bool Get(OpAttrName attr_name, T* value) const {
     const OpAttrsRawEntry* result = GetRaw(attr_name);
     if (!result || result->IsArray() || result->type != GetOpAttrType<T>())
       return false;
@@ -476,7 +538,7 @@ class OpAttrsRef {
   }
 
   // Overload for DenseAttr.
-  bool Get(string_view attr_name, DenseAttr* value) const {
+  bool Get(OpAttrName attr_name, DenseAttr* value) const {
     const OpAttrsRawEntry* result = GetRaw(attr_name);
     if (!result || result->IsArray() || result->type != OpAttrType::DENSE)
       return false;
@@ -485,7 +547,7 @@ class OpAttrsRef {
   }
 
   // Overload for ShapeAttr.
-  bool Get(string_view attr_name, ShapeAttr* value) const {
+  bool Get(OpAttrName attr_name, ShapeAttr* value) const {
     const OpAttrsRawEntry* result = GetRaw(attr_name);
     if (!result || result->IsArray() || result->type != OpAttrType::SHAPE)
       return false;
@@ -494,7 +556,7 @@ class OpAttrsRef {
   }
 
   // Overload for AggregateAttr.
-  bool Get(string_view attr_name, AggregateAttr* value) const {
+  bool Get(OpAttrName attr_name, AggregateAttr* value) const {
     const OpAttrsRawEntry* result = GetRaw(attr_name);
     if (!result || result->IsArray() || result->type != OpAttrType::AGGREGATE)
       return false;
@@ -504,7 +566,7 @@ class OpAttrsRef {
 
   // Read a scalar attribute when it is known to exist. This asserts on failure.
   template <typename T>
-  T GetAsserting(string_view attr_name) const {
+  T GetAsserting(OpAttrName attr_name) const {
     T value;
     bool success = Get(attr_name, &value);
     assert(success && "OpAttrs::GetAsserting() failed");
@@ -513,7 +575,7 @@ class OpAttrsRef {
   }
 
   template <typename T>
-  std::optional<T> GetOptional(string_view attr_name) const {
+  std::optional<T> GetOptional(OpAttrName attr_name) const {
     T value;
     bool success = Get(attr_name, &value);
     if (success) {
@@ -524,7 +586,7 @@ class OpAttrsRef {
   }
 
   template <typename T>
-  bool GetArray(string_view attr_name, ArrayRef<T>* value) const {
+  bool GetArray(OpAttrName attr_name, ArrayRef<T>* value) const {
     const OpAttrsRawEntry* result = GetRaw(attr_name);
     if (!result || !result->IsArray() || result->type != GetOpAttrType<T>())
       return false;
@@ -535,7 +597,7 @@ class OpAttrsRef {
 
   // Read an array attribute when it is known to exist. This asserts on failure.
   template <typename T>
-  ArrayRef<T> GetArrayAsserting(string_view attr_name) const {
+  ArrayRef<T> GetArrayAsserting(OpAttrName attr_name) const {
     ArrayRef<T> values;
     bool success = GetArray(attr_name, &values);
     assert(success);
@@ -544,13 +606,13 @@ class OpAttrsRef {
   }
 
   template <typename T>
-  ArrayRef<T> GetArrayOptional(string_view attr_name) const {
+  ArrayRef<T> GetArrayOptional(OpAttrName attr_name) const {
     ArrayRef<T> values;
     GetArray(attr_name, &values);
     return values;
   }
 
-  bool GetString(string_view attr_name, string_view* value) const {
+  bool GetString(OpAttrName attr_name, string_view* value) const {
     ArrayRef<char> value_ar;
     if (!GetArray(attr_name, &value_ar)) return false;
     *value = string_view(value_ar.data(), value_ar.size());
@@ -558,7 +620,7 @@ class OpAttrsRef {
   }
 
   // Read a string attribute when it is known to exist. This asserts on failure.
-  string_view GetStringAsserting(string_view attr_name) const {
+  string_view GetStringAsserting(OpAttrName attr_name) const {
     string_view value;
     bool success = GetString(attr_name, &value);
     assert(success);
@@ -566,7 +628,7 @@ class OpAttrsRef {
     return value;
   }
 
-  std::optional<string_view> GetStringOptional(string_view attr_name) const {
+  std::optional<string_view> GetStringOptional(OpAttrName attr_name) const {
     string_view value;
     bool success = GetString(attr_name, &value);
     if (success) {
@@ -576,7 +638,7 @@ class OpAttrsRef {
     }
   }
 
-  bool GetFuncName(string_view attr_name, string_view* value) const {
+  bool GetFuncName(OpAttrName attr_name, string_view* value) const {
     ArrayRef<char> value_ar;
     const OpAttrsRawEntry* result = GetRaw(attr_name);
     if (!result || !result->IsArray() || result->type != OpAttrType::FUNC)
@@ -590,7 +652,7 @@ class OpAttrsRef {
 
   // Read a function attribute when it is known to exist. This asserts on
   // failure.
-  string_view GetFuncNameAsserting(string_view attr_name) const {
+  string_view GetFuncNameAsserting(OpAttrName attr_name) const {
     string_view value;
     bool success = GetFuncName(attr_name, &value);
     assert(success);
@@ -598,7 +660,7 @@ class OpAttrsRef {
     return value;
   }
 
-  std::optional<string_view> GetFuncNameOptional(string_view attr_name) const {
+  std::optional<string_view> GetFuncNameOptional(OpAttrName attr_name) const {
     string_view value;
     bool success = GetFuncName(attr_name, &value);
     if (success) {
@@ -617,10 +679,10 @@ class OpAttrsRef {
   void IterateEntries(
       const std::function<void(const OpAttrsRawEntry& entry)>& fn) const;
 
-  const OpAttrsRawEntry* GetRaw(string_view attr_name) const;
+  const OpAttrsRawEntry* GetRaw(OpAttrName attr_name) const;
 
   // Look up an attribute by name, regardless of its underlying type.
-  const OpAttrsRawEntry& GetRawAsserting(string_view attr_name) const {
+  const OpAttrsRawEntry& GetRawAsserting(OpAttrName attr_name) const {
     auto* result = GetRaw(attr_name);
     assert(result);
     return *result;
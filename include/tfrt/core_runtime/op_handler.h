@@ -19,6 +19,9 @@
 #ifndef TFRT_CORE_RUNTIME_OP_HANDLER_H_
 #define TFRT_CORE_RUNTIME_OP_HANDLER_H_
 
+#include <atomic>
+#include <cstdint>
+
 #include "llvm/Support/Error.h"
 #include "tfrt/core_runtime/core_runtime_op.h"
 #include "tfrt/support/error_util.h"
@@ -49,6 +52,12 @@ class OpHandler {
 
   OpHandler *GetFallback() const { return fallback_; }
 
+  // Returns an id that no other OpHandler of the process has, unlike the
+  // address of this op handler, which an op handler of a later CoreRuntime may
+  // reuse. Caches of ops that outlive a CoreRuntime, e.g. in BEF files, can
+  // use it to tell op handlers apart.
+  uint64_t id() const { return id_; }
+
   virtual Expected<CoreRuntimeOp> MakeOp(string_view op_name) = 0;
 
   virtual ~OpHandler();
@@ -57,6 +66,12 @@ class OpHandler {
   const std::string name_;
   CoreRuntime *const runtime_;
   OpHandler *const fallback_;
+  const uint64_t id_ = NextId();
+
+  static uint64_t NextId() {
+    static std::atomic<uint64_t> next_id{0};
+    return next_id.fetch_add(1, std::memory_order_relaxed);
+  }
 };
 
 //===----------------------------------------------------------------------===//
@@ -0,0 +1,211 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares the remote op handler, which executes ops on another node
+// through a RemoteOpTransport, and RemoteOpServer, which executes them there.
+
+#ifndef TFRT_CORE_RUNTIME_REMOTE_OP_HANDLER_H_
+#define TFRT_CORE_RUNTIME_REMOTE_OP_HANDLER_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/status/status.h"  // from @com_google_absl
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/FunctionExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "tfrt/core_runtime/core_runtime_op.h"
+#include "tfrt/core_runtime/tensor_handle.h"
+#include "tfrt/host_context/device.h"
+#include "tfrt/host_context/resource_context.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+#include "tfrt/tensor/tensor.h"
+#include "tfrt/tensor/tensor_serialize_utils.h"
+
+namespace tfrt {
+
+class CoreRuntime;
+class OpAttrs;
+class OpAttrsRef;
+class OpHandler;
+class TensorConversionFnRegistry;
+
+// An argument of a remote op.
+struct RemoteOpArgument {
+  static constexpr uint64_t kInlineTensor = 0;
+
+  // The id of a tensor kept by the server, e.g. a result of an earlier request,
+  // or kInlineTensor if `tensor` is sent along with the request.
+  uint64_t remote_id = kInlineTensor;
+  DenseHostTensorWireChunks tensor;
+};
+
+// A request to execute an op on the remote node.
+struct RemoteOpRequest {
+  std::string op_name;
+  // The attributes, as serialized by SerializeOpAttrs().
+  std::string attrs;
+  llvm::SmallVector<RemoteOpArgument, 4> arguments;
+  // The ids the server keeps the results under. They are assigned by the
+  // client, so that requests can use the results of earlier requests before
+  // these complete.
+  llvm::SmallVector<uint64_t, 4> result_ids;
+};
+
+// The metadata of a result of a remote op, or the error it failed with.
+struct RemoteOpResult {
+  absl::Status status;
+  TensorMetadata metadata;
+};
+
+using RemoteOpDoneFn =
+    llvm::unique_function<void(llvm::SmallVector<RemoteOpResult, 4>)>;
+using RemoteFetchDoneFn =
+    llvm::unique_function<void(Expected<DenseHostTensorWireChunks>)>;
+
+// A stream of requests to a RemoteOpServer on another node, e.g. a streaming
+// RPC. Implementations must be thread-safe.
+class RemoteOpTransport {
+ public:
+  virtual ~RemoteOpTransport();
+
+  // Sends `request`. The server must handle the requests in the order they are
+  // sent. `done` is called with the results once their metadata is known, and
+  // must not be called before Send() returns.
+  virtual void Send(RemoteOpRequest request, RemoteOpDoneFn done) = 0;
+
+  // Fetches the tensor kept under `remote_id` once it is available. `done`
+  // must not be called before Fetch() returns.
+  virtual void Fetch(uint64_t remote_id, RemoteFetchDoneFn done) = 0;
+
+  // Tells the server that the tensor kept under `remote_id` is no longer used.
+  // Fetches and releases are handled after the requests sent before them.
+  virtual void Release(uint64_t remote_id) = 0;
+};
+
+// The device of the results of a remote op handler.
+class RemoteDevice : public Device, public DeviceTraits<RemoteDevice> {
+ public:
+  static const char* type_name() {
+    static constexpr char kName[] = "remote";
+    return kName;
+  }
+
+  explicit RemoteDevice(string_view name) : Device(kDeviceType, name) {}
+};
+
+// A tensor that is kept by a RemoteOpServer. Converting it to a DenseHostTensor
+// fetches it from the server, and destroying it releases it there.
+class RemoteTensor final : public Tensor, public TensorTraits<RemoteTensor> {
+ public:
+  RemoteTensor(const TensorMetadata& metadata,
+               std::shared_ptr<RemoteOpTransport> transport,
+               uint64_t remote_id)
+      : Tensor(metadata),
+        transport_(std::move(transport)),
+        remote_id_(remote_id) {}
+  ~RemoteTensor() override;
+
+  // A moved-from tensor does not release the remote tensor.
+  RemoteTensor(RemoteTensor&& other) = default;
+  RemoteTensor& operator=(RemoteTensor&& other) = delete;
+
+  const std::shared_ptr<RemoteOpTransport>& transport() const {
+    return transport_;
+  }
+  uint64_t remote_id() const { return remote_id_; }
+
+  void Print(raw_ostream& os) const override;
+
+  static const char* name() { return "Remote"; }
+
+ private:
+  std::shared_ptr<RemoteOpTransport> transport_;
+  uint64_t remote_id_;
+};
+
+void RegisterRemoteTensorConversionFn(TensorConversionFnRegistry* registry);
+
+// Serializes the attributes of a remote op. Returns false if `attrs` has an
+// attribute of an unsupported type.
+bool SerializeOpAttrs(const OpAttrsRef& attrs, std::string* serialized);
+llvm::Error DeserializeOpAttrs(string_view serialized, OpAttrs* attrs);
+
+// Executes the requests of remote op handlers with the ops of `op_handler`,
+// and keeps their results until they are released. The requests of a stream
+// must be handled one at a time, in order, while fetches and releases may be
+// concurrent.
+class RemoteOpServer {
+ public:
+  RemoteOpServer(CoreRuntime* runtime, OpHandler* op_handler);
+  ~RemoteOpServer();
+
+  RemoteOpServer(const RemoteOpServer&) = delete;
+  RemoteOpServer& operator=(const RemoteOpServer&) = delete;
+
+  // Executes the op of `request`, and calls `done` once the metadata of the
+  // results is available, which may be before the results are.
+  void Handle(RemoteOpRequest request, RemoteOpDoneFn done);
+
+  // Calls `done` with the tensor kept under `remote_id` once it is available.
+  // The tensor data is not copied.
+  void Fetch(uint64_t remote_id, RemoteFetchDoneFn done);
+
+  void Release(uint64_t remote_id);
+
+  // The number of tensors kept by this server.
+  size_t GetNumTensors() const;
+
+ private:
+  Expected<ExecutionContext> CreateExecutionContext();
+  Expected<const CoreRuntimeOp*> GetOp(string_view op_name);
+
+  CoreRuntime* const runtime_;
+  OpHandler* const op_handler_;
+  ResourceContext resource_context_;
+  // Orders the side effects of the ops, which are handled one at a time.
+  AsyncValueRef<Chain> chain_;
+
+  // Only used by Handle(), which is not called concurrently.
+  llvm::StringMap<CoreRuntimeOp> ops_;
+
+  mutable mutex mu_;
+  llvm::DenseMap<uint64_t, TensorHandle> tensors_ TFRT_GUARDED_BY(mu_);
+};
+
+// Creates a transport to `server` in this process, which passes tensors along
+// without copying them. The callbacks are run on the work queue of `host`.
+std::unique_ptr<RemoteOpTransport> CreateLoopbackRemoteOpTransport(
+    RemoteOpServer* server, HostContext* host);
+
+// Creates an op handler that executes ops on another node through
+// `transport`. Requests are sent without waiting for the earlier ones to
+// complete: arguments that are results of earlier requests stay on the remote
+// node, and DenseHostTensor arguments are sent along without copying them.
+// Other arguments are converted to DenseHostTensors first. The results are
+// RemoteTensors on a RemoteDevice named `device_name`, which are only fetched
+// when they are converted to host tensors, e.g. with TensorHandle::TransferTo.
+llvm::Expected<OpHandler*> CreateRemoteOpHandler(
+    CoreRuntime* runtime, string_view device_name,
+    std::unique_ptr<RemoteOpTransport> transport);
+
+}  // namespace tfrt
+
+#endif  // TFRT_CORE_RUNTIME_REMOTE_OP_HANDLER_H_
@@ -24,6 +24,7 @@
 #include "llvm/ADT/PointerIntPair.h"
 #include "tfrt/host_context/async_value_ref.h"
 #include "tfrt/host_context/device.h"
+#include "tfrt/host_context/host_buffer.h"
 #include "tfrt/support/forward_decls.h"
 #include "tfrt/tensor/tensor.h"
 #include "tfrt/tensor/tensor_metadata.h"
@@ -33,6 +34,7 @@ namespace tfrt {
 
 class ExecutionContext;
 class Device;
+class HostContext;
 
 // An opaque representation of a rectangular tensor computed by the host/device
 // runtime.
@@ -81,6 +83,15 @@ class TensorHandle final {
   // will be set to the error AsyncValue.
   static TensorHandle CreateError(RCReference<AsyncValue> error);
 
+  // Create a TensorHandle on the host device of `host` for a DenseHostTensor
+  // whose data is the `size` bytes at `ptr`, so that it can be passed to
+  // CoreRuntime::Execute or to a BEFFunction without copying. See
+  // DenseHostTensor::CreateFromExternal for how `deallocator` is called and
+  // when this fails.
+  static Expected<TensorHandle> CreateFromExternal(
+      HostContext* host, const TensorMetadata& metadata, void* ptr,
+      size_t size, HostBuffer::Deallocator deallocator);
+
   bool IsDeviceAvailable() const {
     return IsDeviceInline() || async_device_.IsConcrete();
   }
@@ -0,0 +1,48 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// MLIR op definitions for the input pipeline dialect
+//
+// This file declares the 'tfrt_data' dialect.
+
+#ifndef TFRT_DATA_OPDEFS_DATA_H_
+#define TFRT_DATA_OPDEFS_DATA_H_
+
+#include "mlir/Bytecode/BytecodeOpInterface.h"
+#include "mlir/IR/Dialect.h"
+#include "mlir/IR/OpDefinition.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
+
+using namespace mlir;
+
+namespace tfrt {
+namespace data {
+
+// Dialect for input pipeline operations.
+class DataDialect : public Dialect {
+ public:
+  static StringRef getDialectNamespace() { return "tfrt_data"; }
+  explicit DataDialect(MLIRContext *context);
+};
+
+}  // namespace data
+}  // namespace tfrt
+
+#define GET_OP_CLASSES
+#include "tfrt/data/opdefs/data.h.inc"
+
+#endif  // TFRT_DATA_OPDEFS_DATA_H_
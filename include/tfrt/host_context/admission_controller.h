@@ -0,0 +1,104 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares AdmissionController, which rejects or delays new requests
+// while a work queue is overloaded.
+
+#ifndef TFRT_HOST_CONTEXT_ADMISSION_CONTROLLER_H_
+#define TFRT_HOST_CONTEXT_ADMISSION_CONTROLLER_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/support/forward_decls.h"
+
+namespace tfrt {
+
+struct AdmissionControlOptions {
+  // New requests are not admitted while more non-blocking tasks than this wait
+  // for a worker. Non-positive values disable the limit. The worker queues
+  // hold 1024 tasks of each priority, and run the tasks that do not fit in
+  // the caller thread, so the limit should leave some headroom.
+  int64_t max_queued_tasks = 0;
+
+  // New requests are not admitted while tasks wait longer than this for a
+  // worker on average. Zero disables the limit. The task latency is only
+  // measured by work queues that collect stats, see
+  // MultiThreadedWorkQueueOptions::collect_stats.
+  std::chrono::microseconds max_task_latency{0};
+
+  // How long a request that is not admitted is delayed, waiting for the load
+  // to drop, before it is rejected. Zero rejects it right away. Requests
+  // built in worker threads of the work queue are never delayed, as that
+  // would hold up the work that reduces the load.
+  std::chrono::microseconds max_delay{0};
+
+  // How often the load is checked while a request is delayed.
+  std::chrono::microseconds poll_interval{100};
+};
+
+// AdmissionController decides at RequestContextBuilder::build() whether a new
+// request may start, see RequestOptions::admission_controller. Shedding load
+// at the entry keeps the latency of the admitted requests bounded, while
+// letting the work queues grow until they overflow slows down every request.
+//
+// Requests of TaskPriority::kCritical are always admitted. This class is
+// thread-safe.
+class AdmissionController {
+ public:
+  AdmissionController(ConcurrentWorkQueue* work_queue,
+                      AdmissionControlOptions options)
+      : work_queue_(*work_queue), options_(options) {}
+
+  AdmissionController(const AdmissionController&) = delete;
+  AdmissionController& operator=(const AdmissionController&) = delete;
+
+  // Returns an error that describes the overload if a request of `priority`
+  // is not admitted, possibly after delaying the caller.
+  Error Admit(TaskPriority priority);
+
+  const AdmissionControlOptions& options() const { return options_; }
+
+  // The number of requests admitted, admitted after a delay, and rejected.
+  int64_t num_admitted() const {
+    return num_admitted_.load(std::memory_order_relaxed);
+  }
+  int64_t num_delayed() const {
+    return num_delayed_.load(std::memory_order_relaxed);
+  }
+  int64_t num_rejected() const {
+    return num_rejected_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  // Returns the reason why `load` overloads the work queue, or an empty
+  // string if it does not.
+  std::string GetOverload(const WorkQueueLoad& load) const;
+
+  ConcurrentWorkQueue& work_queue_;
+  const AdmissionControlOptions options_;
+
+  std::atomic<int64_t> num_admitted_{0};
+  std::atomic<int64_t> num_delayed_{0};
+  std::atomic<int64_t> num_rejected_{0};
+};
+
+}  // namespace tfrt
+
+#endif  // TFRT_HOST_CONTEXT_ADMISSION_CONTROLLER_H_
@@ -0,0 +1,76 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares AllocationSite, which identifies the kernel that the
+// allocations of a thread are made by, for allocation profilers.
+
+#ifndef TFRT_HOST_CONTEXT_ALLOCATION_SITE_H_
+#define TFRT_HOST_CONTEXT_ALLOCATION_SITE_H_
+
+#include "llvm/ADT/StringRef.h"
+#include "tfrt/host_context/location.h"
+#include "tfrt/support/forward_decls.h"
+
+namespace tfrt {
+
+// The kernel name and location that allocations are attributed to. BEFExecutor
+// sets the site of the kernels it runs if BEFExecutorOptions ask for it.
+// Allocations made after a kernel returns, e.g. by the continuations of an
+// asynchronous kernel, are attributed to whatever site is current then.
+class AllocationSite {
+ public:
+  AllocationSite() = default;
+  AllocationSite(string_view kernel_name, Location location)
+      : kernel_name_(kernel_name), location_(location) {}
+
+  // The name is not owned, and must outlive the allocations made at the site.
+  string_view kernel_name() const { return kernel_name_; }
+  Location location() const { return location_; }
+
+  // Makes a site current for the calling thread while in scope.
+  class Scope;
+
+  // Returns the site of the allocations of the calling thread, or null.
+  static const AllocationSite* Current() { return current_; }
+
+ private:
+  static thread_local const AllocationSite* current_;
+
+  string_view kernel_name_;
+  Location location_;
+};
+
+// Makes `kernel_name` at `location` the site of the allocations of the calling
+// thread until the destruction of the scope. Scopes nest.
+class AllocationSite::Scope {
+ public:
+  Scope(string_view kernel_name, Location location)
+      : site_(kernel_name, location), previous_(current_) {
+    current_ = &site_;
+  }
+  ~Scope() { current_ = previous_; }
+
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+
+ private:
+  AllocationSite site_;
+  const AllocationSite* previous_;
+};
+
+}  // namespace tfrt
+
+#endif  // TFRT_HOST_CONTEXT_ALLOCATION_SITE_H_
@@ -0,0 +1,232 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// C++20 coroutine support for AsyncValueRef
+//
+// This file declares Task<T>, a coroutine return type that produces an
+// AsyncValueRef<T>, and makes AsyncValueRef<T> awaitable within namespace
+// tfrt. It lets kernels write multi-step asynchronous work sequentially instead
+// of as nested AndThen() callbacks:
+//
+//   Task<int> AddAsync(AsyncValueRef<int> a, AsyncValueRef<int> b,
+//                      const ExecutionContext& exec_ctx) {
+//     AsyncValueRef<int> x = co_await std::move(a);
+//     if (x.IsError()) co_return x.GetError();
+//     AsyncValueRef<int> y = co_await std::move(b);
+//     if (y.IsError()) co_return y.GetError();
+//     co_return x.get() + y.get();
+//   }
+//
+//   AsyncValueRef<int> result = AddAsync(a, b, exec_ctx).ToAsyncValueRef();
+//
+// A Task starts running when it is called and runs until it awaits a value that
+// is not available yet. If the coroutine takes an ExecutionContext argument, it
+// is resumed on that context's work queue once the value becomes available, and
+// its frame is allocated from the HostContext allocator. Otherwise, it resumes
+// on the thread that makes the value available, and the frame is allocated with
+// operator new. In both cases, suspending only adds a callback that fits in the
+// inline storage of the AsyncValue waiter, so an asynchronous step costs no
+// allocation beyond the AsyncValue it waits on.
+//
+// Coroutines require C++20, e.g. 'bazel build --config=cpp20'. This header is
+// empty otherwise.
+
+#ifndef TFRT_HOST_CONTEXT_ASYNC_COROUTINE_H_
+#define TFRT_HOST_CONTEXT_ASYNC_COROUTINE_H_
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#define TFRT_HAS_COROUTINES 1
+
+#include <coroutine>
+#include <cstddef>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include "absl/status/status.h"  // from @com_google_absl
+#include "tfrt/host_context/async_dispatch.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+
+namespace tfrt {
+
+namespace internal {
+
+// Coroutine frames are prefixed with the allocator that allocated them, so that
+// operator delete can return them to it.
+constexpr size_t kCoroutineFrameHeaderSize = alignof(std::max_align_t);
+static_assert(kCoroutineFrameHeaderSize >= sizeof(HostAllocator*));
+
+inline HostAllocator* GetCoroutineAllocator() { return nullptr; }
+
+template <typename Arg, typename... Args>
+HostAllocator* GetCoroutineAllocator(const Arg& arg, const Args&... args) {
+  if constexpr (std::is_same_v<Arg, ExecutionContext>) {
+    return arg.host()->allocator();
+  } else {
+    return GetCoroutineAllocator(args...);
+  }
+}
+
+inline const ExecutionContext* GetCoroutineExecutionContext() {
+  return nullptr;
+}
+
+template <typename Arg, typename... Args>
+const ExecutionContext* GetCoroutineExecutionContext(const Arg& arg,
+                                                     const Args&... args) {
+  if constexpr (std::is_same_v<Arg, ExecutionContext>) {
+    return &arg;
+  } else {
+    return GetCoroutineExecutionContext(args...);
+  }
+}
+
+// The part of the Task promise that does not depend on the result type.
+class TaskPromiseBase {
+ public:
+  template <typename... Args>
+  explicit TaskPromiseBase(const Args&... args) {
+    if (auto* exec_ctx = GetCoroutineExecutionContext(args...))
+      exec_ctx_.emplace(*exec_ctx);
+  }
+
+  template <typename... Args>
+  static void* operator new(size_t size, const Args&... args) {
+    HostAllocator* allocator = GetCoroutineAllocator(args...);
+    const size_t alloc_size = size + kCoroutineFrameHeaderSize;
+    void* ptr = allocator ? allocator->AllocateBytes(alloc_size,
+                                                     kCoroutineFrameHeaderSize)
+                          : ::operator new(alloc_size);
+    *static_cast<HostAllocator**>(ptr) = allocator;
+    return static_cast<char*>(ptr) + kCoroutineFrameHeaderSize;
+  }
+
+  static void operator delete(void* frame, size_t size) {
+    void* ptr = static_cast<char*>(frame) - kCoroutineFrameHeaderSize;
+    if (HostAllocator* allocator = *static_cast<HostAllocator**>(ptr)) {
+      allocator->DeallocateBytes(ptr, size + kCoroutineFrameHeaderSize);
+    } else {
+      ::operator delete(ptr);
+    }
+  }
+
+  std::suspend_never initial_suspend() noexcept { return {}; }
+  std::suspend_never final_suspend() noexcept { return {}; }
+
+  // The context to resume the coroutine on, or null to resume it inline.
+  const ExecutionContext* execution_context() const {
+    return exec_ctx_ ? &*exec_ctx_ : nullptr;
+  }
+
+ private:
+  std::optional<ExecutionContext> exec_ctx_;
+};
+
+}  // namespace internal
+
+// Suspends the awaiting coroutine until `value` is available, and returns it.
+// The returned value may be an error.
+template <typename T>
+class AsyncValueAwaiter {
+ public:
+  explicit AsyncValueAwaiter(AsyncValueRef<T> value)
+      : value_(std::move(value)) {}
+
+  bool await_ready() const { return value_.IsAvailable(); }
+
+  template <typename Promise>
+  void await_suspend(std::coroutine_handle<Promise> handle) {
+    // The coroutine, and with it this awaiter, may be resumed and destroyed
+    // before AndThen() returns, so keep the value alive in a local.
+    AsyncValueRef<T> value = value_.CopyRef();
+    value.AndThen([handle] {
+      const ExecutionContext* exec_ctx = nullptr;
+      if constexpr (std::is_base_of_v<internal::TaskPromiseBase, Promise>)
+        exec_ctx = handle.promise().execution_context();
+      if (exec_ctx) {
+        EnqueueWork(*exec_ctx, [handle] { handle.resume(); });
+      } else {
+        handle.resume();
+      }
+    });
+  }
+
+  AsyncValueRef<T> await_resume() { return std::move(value_); }
+
+ private:
+  AsyncValueRef<T> value_;
+};
+
+template <typename T>
+AsyncValueAwaiter<T> operator co_await(AsyncValueRef<T> value) {
+  return AsyncValueAwaiter<T>(std::move(value));
+}
+
+// The return type of a coroutine which produces a T asynchronously. The
+// coroutine completes the task with 'co_return value;', or with
+// 'co_return status;' for an error absl::Status.
+template <typename T>
+class Task {
+ public:
+  class promise_type : public internal::TaskPromiseBase {
+   public:
+    template <typename... Args>
+    explicit promise_type(const Args&... args)
+        : TaskPromiseBase(args...),
+          value_(MakeUnconstructedAsyncValueRef<T>()) {}
+
+    Task get_return_object() { return Task(value_.CopyRef()); }
+
+    template <typename U>
+    void return_value(U&& value) {
+      if constexpr (std::is_constructible_v<T, U&&>) {
+        value_.emplace(std::forward<U>(value));
+      } else {
+        value_.SetError(absl::Status(std::forward<U>(value)));
+      }
+    }
+
+    void unhandled_exception() {
+      value_.SetError(absl::InternalError("Unhandled exception in coroutine"));
+    }
+
+   private:
+    AsyncValueRef<T> value_;
+  };
+
+  // Returns the result of the task, which becomes available when the
+  // coroutine returns.
+  AsyncValueRef<T> ToAsyncValueRef() && { return std::move(value_); }
+
+  // Tasks are awaitable from other coroutines.
+  AsyncValueAwaiter<T> operator co_await() && {
+    return AsyncValueAwaiter<T>(std::move(value_));
+  }
+
+ private:
+  explicit Task(AsyncValueRef<T> value) : value_(std::move(value)) {}
+
+  AsyncValueRef<T> value_;
+};
+
+}  // namespace tfrt
+
+#endif  // defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#endif  // TFRT_HOST_CONTEXT_ASYNC_COROUTINE_H_
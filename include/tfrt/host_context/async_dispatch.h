@@ -24,6 +24,7 @@
 #include "tfrt/concurrency/async_value.h"  // See note on RunWhenReady below.
 #include "tfrt/host_context/execution_context.h"
 #include "tfrt/host_context/host_context.h"
+#include "tfrt/host_context/task_function.h"
 #include "tfrt/support/latch.h"
 
 namespace tfrt {
@@ -99,9 +100,21 @@ inline void Await(ArrayRef<RCReference<AsyncValue>> rc_refs) {
 void Await(const ExecutionContext& exec_ctx,
            ArrayRef<RCReference<AsyncValue>> values);
 
-// Add some non-blocking work to the work_queue used by the ExecutionContext.
+// Add some non-blocking work to the work_queue used by the ExecutionContext,
+// at the priority and deadline of its request. If the request has missed its
+// deadline by the time the work runs, the request is cancelled first.
+void EnqueueWork(const ExecutionContext& exec_ctx, TaskFunction work);
+
+// Same as above, but the work prefers the worker that `affinity` maps to, see
+// TaskAffinity. The hint is dropped if the request has a deadline, as deadline
+// scheduling takes precedence.
+void EnqueueWork(const ExecutionContext& exec_ctx, TaskAffinity affinity,
+                 TaskFunction work);
+
+// Same as above, but enqueues a batch of work at once, moving out of `work`,
+// see ConcurrentWorkQueue::AddTasks().
 void EnqueueWork(const ExecutionContext& exec_ctx,
-                 llvm::unique_function<void()> work);
+                 MutableArrayRef<TaskFunction> work);
 
 // An overload set that automatically converts llvm::Expected values to the
 // corresponding absl::StatusOr when emplacing async values.
@@ -144,7 +157,7 @@ template <typename F, typename R = internal::AsyncResultTypeT<F>,
 // without an ExecutionContext. They should only be used for tasks that are
 // outside of a kernel execution. Depending on the thread pool implementation,
 // such tasks are typically scheduled at the default priority.
-void EnqueueWork(HostContext* host, llvm::unique_function<void()> work);
+void EnqueueWork(HostContext* host, TaskFunction work);
 
 // Overload of EnqueueWork that return AsyncValueRef<R> for work that returns R
 // when R is not void.
@@ -187,8 +200,7 @@ void AndThenEnqueue(HostContext* host, const AsyncValueRef<T>& value, F&& f) {
   });
 }
 
-[[nodiscard]] bool EnqueueBlockingWork(HostContext* host,
-                                       llvm::unique_function<void()> work);
+[[nodiscard]] bool EnqueueBlockingWork(HostContext* host, TaskFunction work);
 
 // Overload of EnqueueBlockingWork that return AsyncValueRef<R> for work that
 // returns R when R is not void.
@@ -213,8 +225,7 @@ template <typename F, typename R = internal::AsyncResultTypeT<F>,
   return result;
 }
 
-[[nodiscard]] bool RunBlockingWork(HostContext* host,
-                                   llvm::unique_function<void()> work);
+[[nodiscard]] bool RunBlockingWork(HostContext* host, TaskFunction work);
 
 // Overload of RunBlockingWork that return AsyncValueRef<R> for work that
 // returns R when R is not void.
@@ -19,8 +19,8 @@
 // Chain is a control dependence between kernels. Its runtime representation is
 // a zero sized value.
 //
-// ReadyChain is a singleton that holds an AsyncValueRef to a Chain for each
-// HostContext, to avoid repeated creation of ready chains on the heap.
+// GetReadyChain() returns a ready chain that is shared by all its callers on a
+// thread, to avoid repeated creation of ready chains on the heap.
 //===----------------------------------------------------------------------===//
 
 #ifndef TFRT_HOST_CONTEXT_CHAIN_H_
@@ -34,7 +34,12 @@ namespace tfrt {
 using ::tsl::Chain;  // NOLINT
 
 inline AsyncValueRef<Chain> GetReadyChain() {
-  return MakeAvailableAsyncValueRef<Chain>();
+  // Chains carry no data, so all ready chains can be the same AsyncValue. Each
+  // thread has its own, to keep the reference count updates of a chain heavy
+  // program from contending on one cache line.
+  static thread_local AsyncValueRef<Chain> ready_chain =
+      MakeAvailableAsyncValueRef<Chain>();
+  return ready_chain.CopyRef();
 }
 
 }  // namespace tfrt
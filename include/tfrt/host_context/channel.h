@@ -0,0 +1,167 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Bounded asynchronous channel
+//
+// This file declares Channel<T>, a bounded multi-producer multi-consumer queue
+// whose Push() and Pop() return AsyncValueRefs instead of blocking, so that
+// kernels and BEF functions can be connected into producer/consumer pipelines.
+
+#ifndef TFRT_HOST_CONTEXT_CHANNEL_H_
+#define TFRT_HOST_CONTEXT_CHANNEL_H_
+
+#include <cassert>
+#include <cstddef>
+#include <deque>
+#include <optional>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "tfrt/host_context/async_value.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/ref_count.h"
+
+namespace tfrt {
+
+// Channel<T> holds up to `capacity` values that have been pushed but not
+// popped. Pushes to a full channel and pops from an empty one complete in
+// order once a value is popped or pushed, respectively.
+//
+// Waiting pushes and pops are completed outside of the lock of the channel,
+// on the thread of the Pop() or Push() that completes them, so their
+// continuations should be cheap or be offloaded to a work queue.
+//
+// This class is thread-safe.
+template <typename T>
+class Channel : public ReferenceCounted<Channel<T>> {
+ public:
+  // `capacity` must be positive.
+  explicit Channel(size_t capacity) : capacity_(capacity) {
+    assert(capacity_ > 0 && "Channel must have room for a value");
+  }
+
+  // Waiting pushes and pops are set to an error.
+  ~Channel();
+
+  // Push `value` to the end of the channel. Returns a chain that becomes
+  // available once the value is in the channel, which is immediately if the
+  // channel has room. A producer that waits for the chain before pushing again
+  // is throttled to the rate of the consumers. Returns an error if the channel
+  // is closed.
+  AsyncValueRef<Chain> Push(T value);
+
+  // Pop the value at the front of the channel. Returns nullopt once the
+  // channel is closed and all values pushed before are popped.
+  AsyncValueRef<std::optional<T>> Pop();
+
+  // Mark the end of the values. Later pushes fail and waiting pops return
+  // nullopt, but the values pushed before can still be popped.
+  void Close();
+
+ private:
+  struct PendingPush {
+    T value;
+    AsyncValueRef<Chain> pushed;
+  };
+
+  const size_t capacity_;
+
+  mutex mu_;
+  // Invariant: `pending_pushes_` is only non-empty while `values_` is full, and
+  // `pending_pops_` is only non-empty while `values_` is empty.
+  std::deque<T> values_ TFRT_GUARDED_BY(mu_);
+  std::deque<PendingPush> pending_pushes_ TFRT_GUARDED_BY(mu_);
+  std::deque<AsyncValueRef<std::optional<T>>> pending_pops_
+      TFRT_GUARDED_BY(mu_);
+  bool closed_ TFRT_GUARDED_BY(mu_) = false;
+};
+
+// A channel of values of any type, as used by the tfrt.channel kernels. The
+// values need not be available when they are pushed.
+using AsyncValueChannel = Channel<RCReference<AsyncValue>>;
+
+template <typename T>
+Channel<T>::~Channel() {
+  for (auto& push : pending_pushes_)
+    push.pushed.SetError(absl::InternalError("channel destroyed"));
+  for (auto& pop : pending_pops_)
+    pop.SetError(absl::InternalError("channel destroyed"));
+}
+
+template <typename T>
+AsyncValueRef<Chain> Channel<T>::Push(T value) {
+  AsyncValueRef<std::optional<T>> pop;
+  {
+    mutex_lock lock(mu_);
+    if (closed_) return MakeErrorAsyncValueRef("push to a closed channel");
+    if (!pending_pops_.empty()) {
+      pop = std::move(pending_pops_.front());
+      pending_pops_.pop_front();
+    } else if (values_.size() < capacity_) {
+      values_.push_back(std::move(value));
+      return GetReadyChain();
+    } else {
+      auto pushed = MakeUnconstructedAsyncValueRef<Chain>();
+      pending_pushes_.push_back({std::move(value), pushed.CopyRef()});
+      return pushed;
+    }
+  }
+  pop.emplace(std::move(value));
+  return GetReadyChain();
+}
+
+template <typename T>
+AsyncValueRef<std::optional<T>> Channel<T>::Pop() {
+  std::optional<T> value;
+  AsyncValueRef<Chain> pushed;
+  {
+    mutex_lock lock(mu_);
+    if (values_.empty()) {
+      if (closed_) return MakeAvailableAsyncValueRef<std::optional<T>>();
+      auto pop = MakeUnconstructedAsyncValueRef<std::optional<T>>();
+      pending_pops_.push_back(pop.CopyRef());
+      return pop;
+    }
+
+    value.emplace(std::move(values_.front()));
+    values_.pop_front();
+    if (!pending_pushes_.empty()) {
+      values_.push_back(std::move(pending_pushes_.front().value));
+      pushed = std::move(pending_pushes_.front().pushed);
+      pending_pushes_.pop_front();
+    }
+  }
+  // Resume the producer outside of the lock, as it may push again right away.
+  if (pushed) pushed.emplace();
+  return MakeAvailableAsyncValueRef<std::optional<T>>(std::move(value));
+}
+
+template <typename T>
+void Channel<T>::Close() {
+  std::deque<AsyncValueRef<std::optional<T>>> pops;
+  {
+    mutex_lock lock(mu_);
+    closed_ = true;
+    pops.swap(pending_pops_);
+  }
+  for (auto& pop : pops) pop.emplace(std::nullopt);
+}
+
+}  // namespace tfrt
+
+#endif  // TFRT_HOST_CONTEXT_CHANNEL_H_
@@ -22,10 +22,13 @@
 #ifndef TFRT_HOST_CONTEXT_CONCURRENT_WORK_QUEUE_H_
 #define TFRT_HOST_CONTEXT_CONCURRENT_WORK_QUEUE_H_
 
+#include <chrono>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <optional>
 #include <string>
+#include <utility>
 
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/Support/Compiler.h"
@@ -36,6 +39,34 @@ namespace tfrt {
 
 class RequestContextBuilder;
 
+// The priority of a non-blocking task. Work queues that support priorities
+// run tasks of a higher priority (lower value) first, while still giving
+// lower priority tasks a share of the workers so they are not starved.
+enum class TaskPriority : int8_t {
+  kCritical = 0,
+  kHigh = 1,
+  kDefault = 2,
+  kLow = 3
+};
+
+// A hint of the worker that a non-blocking task prefers to run on. Work queues
+// that support affinity hints send the tasks with the same `key` to the same
+// worker, so that they share its caches, while other workers may still steal
+// them.
+struct TaskAffinity {
+  uint64_t key = 0;
+};
+
+// A snapshot of the load of a work queue. See ConcurrentWorkQueue::GetLoad().
+struct WorkQueueLoad {
+  // An estimate of the number of non-blocking tasks that wait for a worker.
+  int64_t num_queued_tasks = 0;
+
+  // A moving average of the time from enqueueing a non-blocking task to
+  // starting it, if the work queue measures it.
+  std::optional<std::chrono::nanoseconds> task_latency;
+};
+
 // This is a pure virtual base class for concurrent work queue implementations.
 // This provides an abstraction for adding work items to a queue to be executed
 // later. Implementation is allowed to execute work items in any order,
@@ -89,6 +120,45 @@ class ConcurrentWorkQueue {
   // thread.
   virtual void AddTask(TaskFunction work) = 0;
 
+  // Enqueue a block of work with the given priority. Thread-safe.
+  //
+  // Implementations that do not support priorities ignore `priority`.
+  virtual void AddTask(TaskFunction work, TaskPriority priority) {
+    AddTask(std::move(work));
+  }
+
+  // Enqueue a block of work on behalf of a request that should finish by
+  // `deadline`. Thread-safe.
+  //
+  // Implementations that support deadline scheduling run such tasks earliest
+  // deadline first among themselves. Others fall back to
+  // AddTask(work, priority).
+  virtual void AddTask(TaskFunction work, TaskPriority priority,
+                       std::chrono::system_clock::time_point deadline) {
+    AddTask(std::move(work), priority);
+  }
+
+  // Enqueue a block of work with the given priority and affinity hint.
+  // Thread-safe.
+  //
+  // Implementations that do not support affinity hints fall back to
+  // AddTask(work, priority).
+  virtual void AddTask(TaskFunction work, TaskPriority priority,
+                       TaskAffinity affinity) {
+    AddTask(std::move(work), priority);
+  }
+
+  // Enqueue a batch of work with the given priority, moving out of `work`.
+  // Thread-safe.
+  //
+  // Implementations may spread the batch over their workers and wake up
+  // parked workers once for the whole batch. Others fall back to
+  // AddTask(work, priority) for every task.
+  virtual void AddTasks(MutableArrayRef<TaskFunction> work,
+                        TaskPriority priority) {
+    for (TaskFunction& task : work) AddTask(std::move(task), priority);
+  }
+
   // Enqueue a blocking task. Thread-safe.
   //
   // If `allow_queuing` is false, implementation must guarantee that work will
@@ -103,7 +173,9 @@ class ConcurrentWorkQueue {
   // Block until the specified values are available (either with a value or an
   // error result).
   //
-  // This should not be called by a thread managed by the work queue.
+  // Work queues that can, run pending tasks in the caller thread while waiting
+  // if it is a thread managed by the work queue, instead of blocking it.
+  // Otherwise, this should not be called by a thread managed by the work queue.
   virtual void Await(ArrayRef<RCReference<AsyncValue>> values) = 0;
 
   // Block until the system is quiescent (no pending work and no inflight work).
@@ -120,18 +192,64 @@ class ConcurrentWorkQueue {
   // Returns true if the caller thread is one of the worker threads managed by
   // this work queue. Returns true only for threads executing compute tasks.
   virtual bool IsInWorkerThread() const = 0;
+
+  // Returns the current load of the work queue, e.g. for admission control.
+  // Work queues that do not queue tasks report no load.
+  virtual WorkQueueLoad GetLoad() const { return {}; }
 };
 
 // Create a thread pool that only uses the host donor thread, involving no
 // synchronization.
 std::unique_ptr<ConcurrentWorkQueue> CreateSingleThreadedWorkQueue();
 
+// How non-blocking worker threads that are out of work wait for new tasks.
+// An idle worker first spins in the steal loop, then yields its CPU between
+// steal attempts, and finally parks until a new task is added. Spinning and
+// yielding reduce the wakeup latency at the cost of burned CPU cycles.
+struct WorkerIdlePolicy {
+  // The maximum number of workers that spin or yield at the same time. The
+  // other idle workers are parked right away.
+  int max_spinning_threads = 1;
+
+  // The number of steal attempts while spinning, and while yielding, before
+  // parking. Both are divided by the number of worker threads.
+  int spin_count = 5000;
+  int yield_count = 0;
+
+  // If true, each worker adapts its spin and yield counts to the recent
+  // arrival rate of tasks: they are cut down every time the worker parks for
+  // longer than `short_park`, and restored every time it finds a task while
+  // spinning or is woken up within `short_park`.
+  bool adaptive = false;
+  std::chrono::microseconds short_park{100};
+};
+
 // Thread names prefixes for various thread pools that together form a
 // multi-threaded work queue.
 struct MultiThreadedWorkQueueOptions {
   std::string thread_name_prefix;
   std::string blocking_thread_name_prefix;
   std::string dynamic_thread_name_prefix;
+
+  // If true and the host has more than one NUMA node, the non-blocking worker
+  // threads are spread over the nodes and pinned to the CPUs of their node,
+  // and idle workers steal from workers on the same node first. Worker threads
+  // report their node through GetCurrentNumaNode().
+  bool numa_aware = false;
+
+  // If true, non-blocking tasks enqueued with a deadline are run earliest
+  // deadline first among themselves. Otherwise the deadline is ignored and
+  // only the task priority is used.
+  bool earliest_deadline_first = false;
+
+  // If true, the non-blocking work queue records the number of tasks enqueued
+  // per worker, steal attempts, the time workers spend parked, and histograms
+  // of the queue depth and of the task latency from enqueue to start, into
+  // the metrics "/tfrt/work_queue/<thread name prefix>/...".
+  bool collect_stats = false;
+
+  // How the idle non-blocking worker threads wait for new tasks.
+  WorkerIdlePolicy idle_policy;
 };
 
 // Create a multi-threaded non-blocking thread pool that supports both blocking
@@ -21,13 +21,17 @@
 #ifndef TFRT_HOST_CONTEXT_DEVICE_H_
 #define TFRT_HOST_CONTEXT_DEVICE_H_
 
+#include <atomic>
+#include <memory>
 #include <string>
+#include <utility>
 
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include "tfrt/support/forward_decls.h"
 #include "tfrt/support/mutex.h"
+#include "tfrt/support/published_snapshot.h"
 #include "tfrt/support/ref_count.h"
 #include "tfrt/support/thread_annotations.h"
 
@@ -87,9 +91,35 @@ class Device : public ReferenceCounted<Device> {
   const std::string name_;
 };
 
-// A central place to manage all active devices. Thread-safe.
+// DeviceManager owns the devices of a HostContext. This class is thread-safe.
+//
+// Looking up a device does not lock: the devices are indexed by an immutable
+// snapshot that is replaced whenever a device is added or a device name is
+// interned, which is expected to be rare after startup. The entries of the
+// interned names are owned by the DeviceManager rather than by the snapshots,
+// so NameHandles stay valid when a snapshot is replaced and freed.
 class DeviceManager {
+  struct Entry;
+
  public:
+  // An interned device name, which looks up its device without hashing the
+  // name or probing the device map. A NameHandle stays valid as long as the
+  // DeviceManager it was interned in, and refers to the device with its name
+  // also if the device is added after the name was interned.
+  class NameHandle {
+   public:
+    NameHandle() = default;
+
+    bool IsValid() const { return entry_ != nullptr; }
+    string_view name() const;
+
+   private:
+    friend class DeviceManager;
+    explicit NameHandle(const Entry* entry) : entry_(entry) {}
+
+    const Entry* entry_ = nullptr;
+  };
+
   DeviceManager() = default;
   ~DeviceManager() = default;
   DeviceManager(const DeviceManager&) = delete;
@@ -102,39 +132,52 @@ class DeviceManager {
   RCReference<T> MaybeAddDevice(RCReference<T> device) {
     mutex_lock l(mu_);
     auto it = device_map_.try_emplace(device->name(), device);
+    if (it.second) AddDeviceToIndex(it.first->second.get());
     // TODO(fishx): Change the static_cast to dyn_cast to check the type after
     // introducing classof method into Device.
     return FormRef(static_cast<T*>(it.first->second.get()));
   }
 
   // Lookup a device by its name. Return an empty RCReference if not found.
+  // This does not lock.
   template <typename T,
             std::enable_if_t<std::is_base_of<Device, T>::value, int> = 0>
   RCReference<T> GetDeviceRef(string_view device_name) const {
-    mutex_lock l(mu_);
-    auto it = device_map_.find(device_name);
+    return GetDeviceRef<T>(NameHandle(FindEntry(device_name)));
+  }
 
+  // Lookup a device by its interned name. Return an empty RCReference if not
+  // found. This does not lock.
+  template <typename T,
+            std::enable_if_t<std::is_base_of<Device, T>::value, int> = 0>
+  RCReference<T> GetDeviceRef(NameHandle device_name) const {
+    if (!device_name.IsValid()) return RCReference<T>();
+    Device* device = device_name.entry_->device.load(std::memory_order_acquire);
     // TODO(fishx): Change the static_cast to dyn_cast to check the type after
     // introducing classof method into Device.
-    return it == device_map_.end() ? RCReference<T>()
-                                   : FormRef(static_cast<T*>(it->second.get()));
+    return device == nullptr ? RCReference<T>()
+                             : FormRef(static_cast<T*>(device));
   }
 
   // Return a default device for a Device type. Return an empty RCReference if
-  // not found.
+  // not found. This does not lock.
   template <typename T,
             std::enable_if_t<std::is_base_of<Device, T>::value, int> = 0>
   RCReference<T> GetDeviceRef(const DeviceType& type) const {
-    mutex_lock l(mu_);
-    for (auto& it : device_map_) {
-      // TODO(fishx): Change the static_cast to dyn_cast to check the type after
-      // introducing classof method into Device.
-      if (it.second->type() == type)
-        return FormRef(static_cast<T*>(it.second.get()));
-    }
-    return RCReference<T>();
+    return index_.Read([&](const Index* index) {
+      if (index == nullptr) return RCReference<T>();
+      for (const auto& it : index->default_devices) {
+        // TODO(fishx): Change the static_cast to dyn_cast to check the type
+        // after introducing classof method into Device.
+        if (*it.first == type) return FormRef(static_cast<T*>(it.second));
+      }
+      return RCReference<T>();
+    });
   }
 
+  // Intern `device_name`, whose device may be added later.
+  NameHandle InternDeviceName(string_view device_name);
+
   // Return a list of devices.
   template <typename T,
             std::enable_if_t<std::is_base_of<Device, T>::value, int> = 0>
@@ -159,10 +202,41 @@ class DeviceManager {
   }
 
  private:
+  // The device with an interned name, if it is added.
+  struct Entry {
+    explicit Entry(string_view name) : name(name) {}
+
+    const std::string name;
+    std::atomic<Device*> device{nullptr};
+  };
+
+  // An immutable snapshot of the interned names and the default devices.
+  struct Index {
+    llvm::StringMap<const Entry*> entries;
+    // The first device of each type in `device_map_`.
+    llvm::SmallVector<std::pair<const DeviceType*, Device*>, 4>
+        default_devices;
+  };
+
+  const Entry* FindEntry(string_view device_name) const;
+  Entry* GetOrCreateEntry(string_view device_name) TFRT_REQUIRES(mu_);
+  void AddDeviceToIndex(Device* device) TFRT_REQUIRES(mu_);
+  // Replace the index with a snapshot of `entries_` and `device_map_`.
+  void PublishIndex() TFRT_REQUIRES(mu_);
+
   mutable mutex mu_;
   llvm::StringMap<RCReference<Device>> device_map_ TFRT_GUARDED_BY(mu_);
+  llvm::StringMap<std::unique_ptr<Entry>> entries_ TFRT_GUARDED_BY(mu_);
+
+  // Published under `mu_`.
+  PublishedSnapshot<Index> index_;
 };
 
+inline string_view DeviceManager::NameHandle::name() const {
+  assert(IsValid());
+  return entry_->name;
+}
+
 // Contains all the DeviceType that are supported.
 class DeviceTypeRegistry {
  public:
@@ -68,8 +68,16 @@ DecodedDiagnostic EmitError(const ExecutionContext& exec_ctx, Args&&... args) {
                    absl::InternalError(StrCat(std::forward<Args>(args)...)));
 }
 
+// If RequestOptions::share_errors was set for the request of `exec_ctx` and an
+// error has been emitted for it, return that error. Otherwise, return nullptr.
+// Callers can check it to skip formatting an error message that is dropped.
+ErrorAsyncValue* GetSharedError(const ExecutionContext& exec_ctx);
+
 // For consistency, the error message should start with a lower case letter
 // and not end with a period.
+//
+// If RequestOptions::share_errors was set for the request, these return the
+// first error emitted for the request instead, see GetSharedError().
 RCReference<ErrorAsyncValue> EmitErrorAsync(const ExecutionContext& exec_ctx,
                                             absl::Status status);
 
@@ -19,10 +19,18 @@
 #ifndef TFRT_HOST_CONTEXT_EXECUTION_CONTEXT_H_
 #define TFRT_HOST_CONTEXT_EXECUTION_CONTEXT_H_
 
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <optional>
 #include <utility>
 
 #include "llvm/Support/Error.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/host_allocator.h"
 #include "tfrt/host_context/location.h"
+#include "tfrt/host_context/request_stats.h"
+#include "tfrt/host_context/request_tracker.h"
 #include "tfrt/host_context/resource_context.h"
 #include "tfrt/support/forward_decls.h"
 #include "tfrt/support/map_by_type.h"
@@ -30,8 +38,8 @@
 
 namespace tfrt {
 
+class AdmissionController;
 class HostContext;
-class ConcurrentWorkQueue;
 
 class CancellationContext : public ReferenceCounted<CancellationContext> {
  public:
@@ -66,11 +74,29 @@ class RequestContext : public ReferenceCounted<RequestContext> {
  public:
   using ContextData = MapByType<RequestContext>;
 
+  // Records the stats of the request into the request metrics, if enabled.
+  ~RequestContext();
+
   bool IsCancelled() const { return cancellation_->IsCancelled(); }
   void Cancel();
   HostContext* host() const { return host_; }
   ResourceContext* resource_context() const { return resource_context_; }
 
+  // Return the allocator for memory that does not outlive this request. This is
+  // a request arena if RequestOptions::use_arena_allocator was set, and the
+  // HostContext allocator otherwise.
+  HostAllocator* allocator() const;
+
+  // The priority of the non-blocking tasks enqueued on behalf of this request.
+  TaskPriority priority() const { return priority_; }
+
+  // The deadline of the request, if it has one. Work queues that support
+  // deadline scheduling run the tasks of the request earliest deadline first.
+  const std::optional<std::chrono::system_clock::time_point>& deadline()
+      const {
+    return deadline_;
+  }
+
   const RCReference<CancellationContext>& cancellation_context() const {
     return cancellation_;
   }
@@ -97,18 +123,55 @@ class RequestContext : public ReferenceCounted<RequestContext> {
 
   int64_t id() const { return id_; }
 
+  // The resource accounting of the request, if RequestOptions::stats was set.
+  RequestStats* stats() const { return stats_; }
+
+  // Whether RequestOptions::share_errors was set.
+  bool share_errors() const { return share_errors_; }
+
+  // If errors are shared and an error has been emitted for the request, return
+  // that error. Otherwise, return nullptr.
+  ErrorAsyncValue* GetSharedError() const {
+    return shared_error_.load(std::memory_order_acquire);
+  }
+
+  // Make `error` the shared error of the request, unless another error won the
+  // race to be the first, and return the shared error.
+  RCReference<ErrorAsyncValue> ShareError(RCReference<ErrorAsyncValue> error);
+
  private:
   friend class RequestContextBuilder;
 
   RequestContext(HostContext* host, ResourceContext* resource_context,
-                 ContextData ctx_data, int64_t id)
-      : id_{id},
+                 ContextData ctx_data, int64_t id, TaskPriority priority,
+                 std::optional<std::chrono::system_clock::time_point> deadline,
+                 std::unique_ptr<HostAllocator> arena_allocator,
+                 RequestStats* stats, RequestTracker* resource_tracker,
+                 RequestTracker* request_tracker, bool share_errors)
+      : cancellation_{TakeRef(new CancellationContext)},
+        resource_registration_{resource_tracker, cancellation_},
+        options_registration_{request_tracker, cancellation_},
+        id_{id},
+        priority_{priority},
+        deadline_{deadline},
         host_{host},
         resource_context_{resource_context},
         context_data_{std::move(ctx_data)},
-        cancellation_{TakeRef(new CancellationContext)} {}
+        arena_allocator_{std::move(arena_allocator)},
+        stats_{stats},
+        share_errors_{share_errors} {}
+
+  RCReference<CancellationContext> cancellation_;
+
+  // The request is pending in the trackers until the members below, e.g. the
+  // arena and the context data, are destroyed. The registrations without a
+  // tracker do nothing.
+  RequestTracker::Registration resource_registration_;
+  RequestTracker::Registration options_registration_;
 
   int64_t id_;
+  TaskPriority priority_;
+  std::optional<std::chrono::system_clock::time_point> deadline_;
   HostContext* const host_ = nullptr;
   // Both ResourceContext and ContextData manages data used during the request
   // execution. ResourceContext is more flexible than ContextData at the cost of
@@ -121,13 +184,66 @@ class RequestContext : public ReferenceCounted<RequestContext> {
   ResourceContext* const resource_context_ = nullptr;
   ContextData context_data_;
 
-  RCReference<CancellationContext> cancellation_;
+  // The arena backing allocator(), if arena allocation is enabled. It is
+  // destroyed together with the last reference to the request.
+  std::unique_ptr<HostAllocator> arena_allocator_;
+
+  RequestStats* const stats_ = nullptr;
+
+  const bool share_errors_ = false;
+  std::atomic<ErrorAsyncValue*> shared_error_{nullptr};
 };
 
 struct RequestOptions {
-  using RequestPriority = int;
-
-  RequestPriority priority = 0;
+  using RequestPriority = TaskPriority;
+
+  // The priority of the tasks of the request in work queues that support
+  // priorities. Latency critical requests should use a higher priority than
+  // batch traffic.
+  RequestPriority priority = TaskPriority::kDefault;
+
+  // The time by which the request should finish. Tasks of an expired request
+  // cancel the request before they run, so its remaining kernels are skipped.
+  // Note that setting a deadline does not cancel a request that is not making
+  // progress; use RequestDeadlineTracker for that.
+  std::optional<std::chrono::system_clock::time_point> deadline;
+
+  // If true, per-execution state of the request (e.g. BEFExecutor and its
+  // register and kernel tables) is bump-allocated from an arena that is
+  // released as a whole when the request finishes, instead of going through
+  // the HostContext allocator for every function call.
+  bool use_arena_allocator = false;
+
+  // If set, accumulates the CPU time, allocated bytes, executed kernels and
+  // Await() time of the request. Not owned; it must outlive the request. The
+  // values are final once the last reference to the RequestContext is dropped.
+  RequestStats* stats = nullptr;
+
+  // If true, the request is tracked by the request_tracker() of its
+  // ResourceContext until it completes, so that the owner of the context can
+  // drain its requests before deleting the resources. Tracking takes the lock
+  // of the tracker when the request is built and when it completes, so it is
+  // off by default.
+  bool track_in_resource_context = false;
+
+  // If set, tracks the request until it completes, in addition to the tracker
+  // of its ResourceContext. This allows the owner of e.g. a BEFFile to drain
+  // the requests that execute its functions. Not owned; it must outlive the
+  // request.
+  RequestTracker* request_tracker = nullptr;
+
+  // If set, decides whether the request is admitted when it is built, and
+  // RequestContextBuilder::build() returns its error if it is not. Not owned;
+  // it must outlive the builder.
+  AdmissionController* admission_controller = nullptr;
+
+  // If true, the first error emitted for the request (see EmitErrorAsync()) is
+  // shared by the errors emitted after it: they refer to the same
+  // ErrorAsyncValue, and neither format their message nor decode their
+  // location or go through the diagnostic handler. This keeps error storms,
+  // e.g. when shedding load fails many kernels of a wide graph, cheap, at the
+  // cost of reporting only the first error of the request.
+  bool share_errors = false;
 };
 
 // A builder class for RequestContext.
@@ -193,7 +309,11 @@ class ExecutionContext {
                             Location location = {});
 
   Location location() const { return location_; }
-  HostContext* host() const { return request_ctx_->host(); }
+  // The HostContext and the allocator of the request are cached here, so that
+  // the kernels reach them without going through the RequestContext.
+  HostContext* host() const { return host_; }
+  // See RequestContext::allocator().
+  HostAllocator* allocator() const { return allocator_; }
   bool IsCancelled() const { return request_ctx_->IsCancelled(); }
   ErrorAsyncValue* GetCancelAsyncValue() const {
     return request_ctx_->GetCancelAsyncValue();
@@ -218,6 +338,8 @@ class ExecutionContext {
 
  private:
   RCReference<RequestContext> request_ctx_;
+  HostContext* host_;
+  HostAllocator* allocator_;
   // If set, this work queue will be used for running async tasks in the
   // execution. Otherwise, the work queue in HostContext is used.
   ConcurrentWorkQueue* work_queue_ = nullptr;
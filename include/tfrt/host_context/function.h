@@ -19,6 +19,8 @@
 #ifndef TFRT_HOST_CONTEXT_FUNCTION_H_
 #define TFRT_HOST_CONTEXT_FUNCTION_H_
 
+#include <atomic>
+#include <cstdint>
 #include <vector>
 
 #include "llvm/ADT/ArrayRef.h"
@@ -82,6 +84,11 @@ class Function {
       std::vector<RCReference<AsyncValue>> arguments,
       MutableArrayRef<RCReference<AsyncValue>> results) const = 0;
 
+  // Set up the state that executions of this function reuse, e.g. decoded
+  // tables or executor memory, so that the next Execute() starts right away.
+  // Kernels call this for functions they may execute on the critical path.
+  virtual void Prepare() const {}
+
   // Reference counting operations, used by async kernels to keep the underlying
   // storage for a function alive.
   virtual void AddRef() const = 0;
@@ -89,6 +96,11 @@ class Function {
 
   FunctionKind function_kind() const { return function_kind_; }
 
+  // Returns an id that no other Function of the process has, unlike the
+  // address of this function, which a function of a BEF file loaded later may
+  // reuse. Caches keyed by function can use it to tell functions apart.
+  uint64_t id() const { return id_; }
+
  protected:
   Function(string_view name, FunctionKind function_kind,
            ArrayRef<TypeName> argument_types, ArrayRef<TypeName> result_types)
@@ -107,12 +119,19 @@ class Function {
  private:
   virtual void VtableAnchor();
 
+  static uint64_t NextId() {
+    static std::atomic<uint64_t> next_id{0};
+    return next_id.fetch_add(1, std::memory_order_relaxed);
+  }
+
   // This is the name of the function, or empty if anonymous.
   string_view name_;
   FunctionKind function_kind_;
 
   size_t num_argument_;
   llvm::SmallVector<TypeName, 8> argument_result_types_;
+
+  uint64_t id_ = NextId();
 };
 
 }  // namespace tfrt
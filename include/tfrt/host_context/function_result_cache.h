@@ -0,0 +1,108 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Cache of function results keyed by argument values
+//
+// This file declares FunctionResultCache, a bounded LRU cache that maps a
+// function and the values of its arguments to the results of calling it, and
+// the encoders that turn argument values into cache keys. It backs the
+// tfrt.memoized_call kernel, which only memoizes functions that promise to be
+// free of side effects.
+
+#ifndef TFRT_HOST_CONTEXT_FUNCTION_RESULT_CACHE_H_
+#define TFRT_HOST_CONTEXT_FUNCTION_RESULT_CACHE_H_
+
+#include <list>
+#include <string>
+#include <unordered_map>
+
+#include "llvm/ADT/SmallVector.h"
+#include "tfrt/host_context/async_value.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/support/hash_util.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/ref_count.h"
+
+namespace tfrt {
+
+class Function;
+
+// A MemoizationKeyEncoder appends a byte encoding of `value`, which is
+// available and not an error, to `key` and returns true, or returns false if it
+// does not handle the type of `value`. Two values of the same type must have
+// the same encoding if and only if they are equal, and the encoding must start
+// with a tag that is unique to the type.
+using MemoizationKeyEncoder = bool (*)(const AsyncValue& value,
+                                       std::string* key);
+
+// Add an encoder for EncodeMemoizationKey(). This is meant to be called from
+// static initializers.
+void AddStaticMemoizationKeyEncoder(MemoizationKeyEncoder encoder);
+
+// Append the encoding of `arguments` to `key`. Returns false if an argument is
+// not available, is an error, or has a type that no encoder handles, in which
+// case the call cannot be memoized. bool, int32_t, int64_t, float and double
+// are handled without registering an encoder.
+bool EncodeMemoizationKey(ArrayRef<AsyncValue*> arguments, std::string* key);
+
+// This class is thread-safe. Cached results hold references to the values
+// returned by the functions, so the cache must not outlive the BEF files the
+// functions belong to.
+class FunctionResultCache {
+ public:
+  static constexpr size_t kDefaultCapacity = 1024;
+
+  explicit FunctionResultCache(size_t capacity = kDefaultCapacity)
+      : capacity_(capacity) {}
+
+  // If calling `fn` with arguments encoded as `key` has been cached, copy the
+  // cached results to `results` and return true.
+  bool Lookup(const Function* fn, string_view key,
+              MutableArrayRef<RCReference<AsyncValue>> results);
+
+  // Cache `results` as the results of calling `fn` with arguments encoded as
+  // `key`. If the cache is full, the least recently used entry is evicted.
+  void Insert(const Function* fn, string_view key,
+              ArrayRef<RCReference<AsyncValue>> results);
+
+  size_t size() const;
+
+ private:
+  struct Entry {
+    std::string key;
+    llvm::SmallVector<RCReference<AsyncValue>, 2> results;
+  };
+
+  struct KeyHash {
+    size_t operator()(string_view key) const { return Hash64(key); }
+  };
+
+  // Prefix `key` with the id of `fn`. The cache lives in a ResourceContext,
+  // which may outlive the BEF file of `fn`, so the address of `fn` could be
+  // reused by a function of another file.
+  static std::string MakeKey(const Function* fn, string_view key);
+
+  const size_t capacity_;
+
+  mutable mutex mu_;
+  // Entries in order of use, most recently used first.
+  std::list<Entry> entries_ TFRT_GUARDED_BY(mu_);
+  // Maps Entry::key, which the list nodes keep alive, to the entry.
+  std::unordered_map<string_view, std::list<Entry>::iterator, KeyHash> index_
+      TFRT_GUARDED_BY(mu_);
+};
+
+}  // namespace tfrt
+
+#endif  // TFRT_HOST_CONTEXT_FUNCTION_RESULT_CACHE_H_
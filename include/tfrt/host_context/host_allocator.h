@@ -58,6 +58,13 @@ class HostAllocator {
   // Allocate the specified number of bytes with the specified alignment.
   virtual void* AllocateBytes(size_t size, size_t alignment) = 0;
 
+  // Same as AllocateBytes(), but the allocated memory is zeroed. The default
+  // implementation clears the memory from AllocateBytes(). Allocators that get
+  // fresh pages from the operating system override it to skip clearing them,
+  // so that large zeroed buffers are only zeroed page by page as they are
+  // first touched.
+  virtual void* AllocateZeroedBytes(size_t size, size_t alignment);
+
   // Deallocate the specified pointer that has the specified size.
   virtual void DeallocateBytes(void* ptr, size_t size) = 0;
 
@@ -74,9 +81,53 @@ class HostAllocator {
 // Create an allocator that just calls malloc/free.
 std::unique_ptr<HostAllocator> CreateMallocAllocator();
 
+// Create an allocator that serves allocations of up to 4KB from size-class
+// pools with per-thread free lists, refilled in batches from a shared pool
+// that carves slabs out of `parent`. Larger allocations go to `parent`
+// directly. Unlike CreateMallocAllocator(), the common small allocations do
+// not contend on a global lock.
+std::unique_ptr<HostAllocator> CreatePooledAllocator(
+    std::unique_ptr<HostAllocator> parent);
+
+// Create an allocator that serves allocations of at least `min_size` bytes
+// from memory mapped in multiples of 2MB and aligned to 2MB, backed by
+// explicit huge pages if the system has them reserved and by transparent huge
+// pages otherwise. This avoids the TLB misses of large buffers scattered over
+// 4KB pages. Up to `max_cached_bytes` of freed huge page memory is kept for
+// reuse. Smaller allocations go to `parent`. On platforms without huge pages
+// `parent` is returned.
+std::unique_ptr<HostAllocator> CreateHugePageAllocator(
+    std::unique_ptr<HostAllocator> parent, size_t min_size = 2 * 1024 * 1024,
+    size_t max_cached_bytes = 256 * 1024 * 1024);
+
+// Create an allocator that bump-allocates out of blocks of `block_size` bytes
+// obtained from `parent`. DeallocateBytes() is a no-op and all blocks are
+// returned to `parent` at once when the allocator is destroyed, so it is only
+// suitable for memory that does not outlive a single request. See
+// RequestOptions::use_arena_allocator.
+std::unique_ptr<HostAllocator> CreateRequestArenaAllocator(
+    HostAllocator* parent, size_t block_size = 64 * 1024);
+
+// Create an allocator that forwards to `allocator`, which it shares with the
+// other allocators created from it. This lets several HostContexts, e.g. the
+// CoreRuntimes of the tenants of a SharedWorkQueue, use one heap.
+std::unique_ptr<HostAllocator> CreateSharedAllocator(
+    std::shared_ptr<HostAllocator> allocator);
+
 // Create an allocator of fixed size for testing.
 std::unique_ptr<HostAllocator> CreateFixedSizeAllocator(size_t capacity = 1024);
 
+// Returns the NUMA node of the calling thread if it is a worker thread pinned to
+// a node by a NUMA-aware work queue, and -1 otherwise. HostAllocator
+// implementations may use it to serve allocations from node-local memory.
+int GetCurrentNumaNode();
+
+namespace internal {
+// Records the NUMA node the calling thread is pinned to. Called by NUMA-aware
+// work queues when a worker thread starts.
+void SetCurrentNumaNode(int node);
+}  // namespace internal
+
 // An RAII-based abstraction that manages an array of objects via HostAllocator.
 template <typename ObjectT>
 class HostArray {
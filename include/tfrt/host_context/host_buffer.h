@@ -21,6 +21,8 @@
 #ifndef TFRT_HOST_CONTEXT_HOST_BUFFER_H_
 #define TFRT_HOST_CONTEXT_HOST_BUFFER_H_
 
+#include <cstdint>
+
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/FunctionExtras.h"
 #include "llvm/Support/raw_ostream.h"
@@ -35,14 +37,26 @@ class HostAllocator;
 // memory may be managed by HostContext or allocated by the user.
 class HostBuffer : public ReferenceCounted<HostBuffer> {
  public:
+  static constexpr size_t kLargeBufferSize = 1024 * 1024;
+  static constexpr size_t kLargeBufferAlignment = 64;
+
   // Create an uninitialized HostBuffer of the specified size and alignment.
   // This returns a null RCReference on allocation failure.
   // `allocator` will be used to allocate the memory and to deallocate it
   // when the returned buffer is destroyed.
+  // The data of buffers of at least kLargeBufferSize bytes is aligned to at
+  // least kLargeBufferAlignment, so that 512 bit vector loads do not split
+  // cache lines. Such buffers are best served by CreateHugePageAllocator().
   static RCReference<HostBuffer> CreateUninitialized(size_t size,
                                                      size_t alignment,
                                                      HostAllocator *allocator);
 
+  // Same as CreateUninitialized(), but the data is zeroed. The memory comes
+  // from HostAllocator::AllocateZeroedBytes(), so large buffers of fresh pages
+  // are only zeroed as they are first touched.
+  static RCReference<HostBuffer> CreateZeroed(size_t size, size_t alignment,
+                                              HostAllocator *allocator);
+
   using Deallocator = llvm::unique_function<void(void *ptr, size_t size)>;
   // Create a HostBuffer by taking ownership of an externally allocated buffer.
   // `deallocator` is called with `ptr` and `size` as arguments when we destroy
@@ -68,6 +82,11 @@ class HostBuffer : public ReferenceCounted<HostBuffer> {
 
   size_t size() const { return size_; }
 
+  // Returns an id that no other HostBuffer of the process has, unlike the
+  // address of this buffer, which a buffer allocated after it is destroyed may
+  // reuse. Caches that do not hold a reference to the buffer can key on it.
+  uint64_t id() const { return id_; }
+
   template <typename T>
   ArrayRef<T> CastAs() const {
     assert((size() % sizeof(T) == 0) &&
@@ -108,6 +127,10 @@ class HostBuffer : public ReferenceCounted<HostBuffer> {
   // For access to Destroy().
   friend class ReferenceCounted<HostBuffer>;
 
+  // Implements CreateUninitialized() and CreateZeroed().
+  static RCReference<HostBuffer> Create(size_t size, size_t alignment,
+                                        bool zeroed, HostAllocator *allocator);
+
   HostBuffer(size_t size, size_t allocated_size, HostAllocator *allocator)
       : size_(size),
         mode_{Mode::kInlined},
@@ -129,6 +152,10 @@ class HostBuffer : public ReferenceCounted<HostBuffer> {
 
   void Destroy();
 
+  // Returns the next buffer id. Ids are reserved in blocks per thread, so that
+  // allocating threads do not contend on a shared counter.
+  static uint64_t NextId();
+
   void *data_;
   size_t size_ : 62;
 
@@ -143,6 +170,8 @@ class HostBuffer : public ReferenceCounted<HostBuffer> {
   // should be 64 bits.
   Mode mode_ : 2;
 
+  const uint64_t id_ = NextId();
+
   // TODO(zhangqiaorjc): Use variant instead of union.
   union {
     struct {
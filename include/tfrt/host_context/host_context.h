@@ -44,10 +44,10 @@ class SharedContext;
 // This represents one instance of a CPU device, which can have multiple
 // threads, a private heap for tensor data, and a way of reporting errors.  We
 // limit the maximum number of HostContext objects that can be created in a
-// process to kDummyIndex in order to allow encoding a HostContext
-// pointer using only one byte (See HostContextPtr). A HostContext instance is
-// expected to be re-used through the life-time of a process, so the limited
-// instance numbers are not expected to be a problem in practice.
+// process to HostContextPool::kCompacity in order to allow encoding a
+// HostContext pointer using only two bytes (See HostContextPtr). A HostContext
+// instance is expected to be re-used through the life-time of a process, so
+// the limited instance numbers are not expected to be a problem in practice.
 class HostContext {
  public:
   // The host device name that we will use if the caller does not specify the
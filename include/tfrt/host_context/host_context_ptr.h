@@ -34,11 +34,13 @@ class HostContext;
 class HostContextPtr;
 
 // HostContextPool manages all the live HostContext instances. It limits the
-// number of live HostContext instances to 256 to allow referecing a HostContext
-// with a 1-byte int. This is used to keep sizeof(HostContextPtr) to 1 byte.
+// number of live HostContext instances to 4096 to allow referencing a
+// HostContext with a 2-byte int. This is used to keep sizeof(HostContextPtr) to
+// 2 bytes, while leaving room for the HostContexts of many tenants sharing a
+// process (see SharedWorkQueue).
 class HostContextPool {
  public:
-  static constexpr int kCompacity = 256;
+  static constexpr int kCompacity = 4096;
 
   static HostContextPool& instance() {
     static HostContextPool* pool = new HostContextPool();
@@ -48,7 +50,14 @@ class HostContextPool {
   HostContextPtr AllocateForHostContext(HostContext* host);
   void FreeHostContext(HostContext* host);
 
-  HostContext* GetHostContextByIndex(int index) const;
+  HostContext* GetHostContextByIndex(int index) const {
+    // Note that we do not need to lock the mutex here as
+    // all_host_contexts_[index] is guranteed to filled when this function is
+    // called.
+    assert(index < all_host_contexts_.size());
+    assert(all_host_contexts_[index]);
+    return all_host_contexts_[index];
+  }
 
  private:
   HostContextPool() = default;
@@ -70,18 +79,20 @@ class HostContextPtr {
 
   HostContext& operator*() const { return *get(); }
 
-  HostContext* get() const;
+  HostContext* get() const {
+    return HostContextPool::instance().GetHostContextByIndex(index_);
+  }
 
  private:
   friend class HostContextPool;
   friend class ReadyChain;
 
-  explicit HostContextPtr(int index) : index_{static_cast<uint8_t>(index)} {
+  explicit HostContextPtr(int index) : index_{static_cast<uint16_t>(index)} {
     assert(index < HostContextPool::kCompacity);
   }
-  uint8_t index() const { return index_; }
+  uint16_t index() const { return index_; }
 
-  const uint8_t index_ = 0;
+  const uint16_t index_ = 0;
 };
 
 }  // namespace tfrt
@@ -22,7 +22,11 @@
 #ifndef TFRT_HOST_CONTEXT_KERNEL_CONTEXT_H_
 #define TFRT_HOST_CONTEXT_KERNEL_CONTEXT_H_
 
+#include <atomic>
+#include <memory>
+#include <new>
 #include <string>
+#include <type_traits>
 #include <utility>
 
 #include "llvm/ADT/ArrayRef.h"
@@ -30,8 +34,10 @@
 #include "llvm/ADT/StringRef.h"
 #include "tfrt/host_context/async_value.h"
 #include "tfrt/host_context/attribute_utils.h"
+#include "tfrt/host_context/chain.h"
 #include "tfrt/host_context/diagnostic.h"
 #include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_buffer.h"
 #include "tfrt/host_context/host_context.h"
 #include "tfrt/host_context/location.h"
 #include "tfrt/support/forward_decls.h"
@@ -41,6 +47,56 @@ namespace tfrt {
 
 class Function;
 
+// Keeps the memory of an attribute section alive, so that kernels may refer to
+// their attributes after they return, e.g. BEF files that own their memory.
+class AttributeSectionOwner {
+ public:
+  virtual ~AttributeSectionOwner() = default;
+
+  virtual void AddAttributeSectionRef() const = 0;
+  virtual void DropAttributeSectionRef() const = 0;
+};
+
+// State that a kernel keeps across the executions of one of its call sites,
+// e.g. values it derives from its attributes. The kernel implementation of a
+// call site determines the type of its state.
+class KernelCallSiteState {
+ public:
+  virtual ~KernelCallSiteState() = default;
+};
+
+// Holds the KernelCallSiteState of one kernel call site, e.g. one kernel in a
+// BEF function. This class is thread-safe.
+class KernelCallSiteSlot {
+ public:
+  KernelCallSiteSlot() = default;
+  ~KernelCallSiteSlot() { delete state_.load(std::memory_order_relaxed); }
+
+  KernelCallSiteSlot(const KernelCallSiteSlot&) = delete;
+  KernelCallSiteSlot& operator=(const KernelCallSiteSlot&) = delete;
+
+  // Return the state of the call site, creating it with `create`, which
+  // returns a std::unique_ptr<T>, if the call site has none yet. Concurrent
+  // first executions may create the state more than once, in which case all
+  // but one of the states are destroyed again.
+  template <typename T, typename F>
+  T& GetOrCreate(F&& create) {
+    KernelCallSiteState* state = state_.load(std::memory_order_acquire);
+    if (state == nullptr) {
+      std::unique_ptr<KernelCallSiteState> created = create();
+      if (state_.compare_exchange_strong(state, created.get(),
+                                         std::memory_order_acq_rel,
+                                         std::memory_order_acquire)) {
+        state = created.release();
+      }
+    }
+    return *static_cast<T*>(state);
+  }
+
+ private:
+  std::atomic<KernelCallSiteState*> state_{nullptr};
+};
+
 // AsyncKernelFrame captures the states associated with a kernel invocation,
 // including the input arguments, attributes, result values, location and host
 // context. AsyncKernelFrame is constructed by the kernel caller (currently only
@@ -51,6 +107,10 @@ class Function;
 // The result AsyncValue pointers are not initialized when a kernel is called.
 // The Kernel implementation is responsible for creating AsyncValue objects and
 // setting the result AsyncValue pointers.
+//
+// The arguments and results are kept in one contiguous block, the arguments
+// first, so that setting up a frame makes no heap allocation for kernels with
+// up to kNumInlineValues arguments and results, and a single one otherwise.
 class AsyncKernelFrame {
  public:
   explicit AsyncKernelFrame(ExecutionContext exec_ctx)
@@ -74,7 +134,10 @@ class AsyncKernelFrame {
     return *this;
   }
 
-  ~AsyncKernelFrame() { ResetArguments(); }
+  ~AsyncKernelFrame() {
+    ResetArguments();
+    ClearResults();
+  }
 
   const ExecutionContext& GetExecutionContext() const { return exec_ctx_; }
   HostContext* GetHostContext() const { return exec_ctx_.host(); }
@@ -84,8 +147,21 @@ class AsyncKernelFrame {
 
   ArrayRef<uint8_t> GetAttributeSection() const { return attribute_section_; }
 
+  // Get the slot for the state of the kernel call site, or null if the caller
+  // does not keep state across executions, in which case the kernel must not
+  // cache anything.
+  KernelCallSiteSlot* GetCallSiteSlot() const { return call_site_slot_; }
+
+  // Return a HostBuffer that refers to the `size` bytes at `data` in the
+  // attribute section without copying them, and keeps the attribute section
+  // alive. The buffer is never exclusively owned and must not be written to.
+  // Returns null if the attribute section has no owner, in which case the
+  // attribute must be copied to outlive the kernel.
+  RCReference<HostBuffer> BorrowAttributeData(const void* data,
+                                              size_t size) const;
+
   // Get the number of arguments.
-  int GetNumArgs() const { return arguments_.size(); }
+  int GetNumArgs() const { return num_arguments_; }
 
   // Get the argument at the given index as type T.
   template <typename T>
@@ -96,11 +172,13 @@ class AsyncKernelFrame {
   // Get the argument at the given index as AsyncValue*.
   AsyncValue* GetArgAt(int index) const {
     assert(index < GetNumArgs());
-    return arguments_[index];
+    return arguments()[index];
   }
 
   // Get all arguments.
-  ArrayRef<AsyncValue*> GetArguments() const { return arguments_; }
+  ArrayRef<AsyncValue*> GetArguments() const {
+    return ArrayRef<AsyncValue*>(arguments(), num_arguments_);
+  }
 
   // Get the attribute at the given index.
   const void* GetAttribute(int index) const {
@@ -165,7 +243,7 @@ class AsyncKernelFrame {
   }
 
   // Get the number of results.
-  int GetNumResults() const { return results_.size(); }
+  int GetNumResults() const { return num_results_; }
 
   // Emplace construct the result at index 0.
   template <typename T, typename... Args>
@@ -176,8 +254,13 @@ class AsyncKernelFrame {
   // Emplace construct the result at given index.
   template <typename T, typename... Args>
   void EmplaceResultAt(int index, Args&&... args) {
-    SetResultAt(index,
-                MakeAvailableAsyncValueRef<T>(std::forward<Args>(args)...));
+    if constexpr (std::is_same_v<T, Chain>) {
+      // Share the ready chain instead of allocating one per kernel.
+      SetResultAt(index, GetReadyChain());
+    } else {
+      SetResultAt(index,
+                  MakeAvailableAsyncValueRef<T>(std::forward<Args>(args)...));
+    }
   }
 
   // Allocate an AsyncValue with uninitialized payload as the result at the
@@ -198,8 +281,8 @@ class AsyncKernelFrame {
 
   // Set the result at the given index with the given AsyncValue.
   void SetResultAt(int index, RCReference<AsyncValue> value) {
-    assert(index < results_.size() && "Invalid result index");
-    RCReference<AsyncValue>& result = results_[index];
+    assert(index < GetNumResults() && "Invalid result index");
+    RCReference<AsyncValue>& result = results()[index];
     assert(!result && "Result is not nullptr");
     result = std::move(value);
   }
@@ -218,10 +301,14 @@ class AsyncKernelFrame {
   }
 
   // Get all results as an immutable ArrayRef
-  ArrayRef<RCReference<AsyncValue>> GetResults() const { return results_; }
+  ArrayRef<RCReference<AsyncValue>> GetResults() const {
+    return ArrayRef<RCReference<AsyncValue>>(results(), num_results_);
+  }
 
   // Get all results as MutableArrayRef.
-  MutableArrayRef<RCReference<AsyncValue>> GetResults() { return results_; }
+  MutableArrayRef<RCReference<AsyncValue>> GetResults() {
+    return MutableArrayRef<RCReference<AsyncValue>>(results(), num_results_);
+  }
 
   // Example usage:
   //
@@ -229,8 +316,12 @@ class AsyncKernelFrame {
   // int i = 2;
   // TensorShape shape = ...
   // kernel_handler.ReportError("Error: i is ", i, ", shape is ", shape);
+  //
+  // The message is not formatted if the request shares an earlier error, see
+  // RequestOptions::share_errors.
   template <typename... Args>
   void ReportError(Args&&... args) {
+    if (GetSharedError(exec_ctx_)) return ReportError(string_view());
     ReportError(string_view(StrCat(std::forward<Args>(args)...)));
   }
   // Report error and set any unset results with an error AsyncValue.
@@ -238,6 +329,8 @@ class AsyncKernelFrame {
 
   template <typename... Args>
   RCReference<AsyncValue> EmitError(Args&&... args) {
+    if (auto* shared_error = GetSharedError(exec_ctx_))
+      return FormRef(shared_error);
     return EmitError(string_view(StrCat(std::forward<Args>(args)...)));
   }
 
@@ -252,25 +345,80 @@ class AsyncKernelFrame {
   void AssertArity(int num_arguments, int num_attributes,
                    int num_results) const;
 
-  // Clear arguments.
+  // Clear arguments. The results stay in place until the frame is set up for
+  // the next kernel.
   void ResetArguments() {
-    for (auto* arg : arguments_) arg->DropRef();
-    arguments_.clear();
+    for (auto* arg : GetArguments()) arg->DropRef();
+    num_arguments_ = 0;
   }
 
  protected:
+  // The number of arguments and results that fit in the inline storage.
+  static constexpr int kNumInlineValues = 16;
+
+  // Storage for one argument (AsyncValue*) or result (RCReference<AsyncValue>).
+  struct alignas(AsyncValue*) ValueSlot {
+    char bytes[sizeof(AsyncValue*)];
+  };
+  static_assert(sizeof(RCReference<AsyncValue>) == sizeof(ValueSlot) &&
+                    alignof(RCReference<AsyncValue>) <= alignof(ValueSlot),
+                "RCReference must fit in a ValueSlot");
+
   // Assign each member except ExecutionContext.
   void AssignFields(const AsyncKernelFrame& other);
   void AssignFields(AsyncKernelFrame&& other);
 
-  // AsyncValues of `arguments_` are owned by AsyncKernelFrame.
+  // The arguments are at the beginning of `values_`, and the results at the
+  // end. After ResetArguments() the slots in between are unused.
+  AsyncValue* const* arguments() const {
+    return reinterpret_cast<AsyncValue* const*>(values_.data());
+  }
+  const RCReference<AsyncValue>* results() const {
+    return reinterpret_cast<const RCReference<AsyncValue>*>(values_.end() -
+                                                            num_results_);
+  }
+  RCReference<AsyncValue>* results() {
+    return reinterpret_cast<RCReference<AsyncValue>*>(values_.end() -
+                                                      num_results_);
+  }
+
+  // Append an argument. `value` is owned by AsyncKernelFrame.
+  void PushArgument(AsyncValue* value) {
+    // Drop the results of the previous kernel, if any.
+    if (values_.size() != num_arguments_) ClearResults();
+    values_.emplace_back();
+    new (&values_.back()) AsyncValue*(value);
+    ++num_arguments_;
+  }
+
+  // Append `n` null results.
+  void PushResults(size_t n) {
+    if (values_.size() != num_arguments_) ClearResults();
+    values_.resize(values_.size() + n);
+    for (ValueSlot* slot = values_.end() - n; slot != values_.end(); ++slot)
+      new (slot) RCReference<AsyncValue>();
+    num_results_ = n;
+  }
+
+  // Destroy the results and the unused slots.
+  void ClearResults() {
+    for (auto& result : GetResults()) result.~RCReference<AsyncValue>();
+    values_.resize(num_arguments_);
+    num_results_ = 0;
+  }
+
+  // Arguments followed by results. The AsyncValues of the arguments are owned
+  // by AsyncKernelFrame.
   //
-  // TODO(tfrt-devs): Use RCReference<AsyncValue> instead of AsyncValue* so
-  // the ownership is clearer.
-  llvm::SmallVector<AsyncValue*, 8> arguments_;
-  llvm::SmallVector<RCReference<AsyncValue>, 8> results_;
+  // TODO(tfrt-devs): Use RCReference<AsyncValue> instead of AsyncValue* for
+  // the arguments so the ownership is clearer.
+  llvm::SmallVector<ValueSlot, kNumInlineValues> values_;
+  size_t num_arguments_ = 0;
+  size_t num_results_ = 0;
 
   ArrayRef<uint8_t> attribute_section_;
+  const AttributeSectionOwner* attribute_section_owner_ = nullptr;
+  KernelCallSiteSlot* call_site_slot_ = nullptr;
   ArrayRef<uint32_t> attribute_offsets_;
   ArrayRef<uint32_t> function_indices_;
   ArrayRef<std::unique_ptr<Function>> functions_;
@@ -278,26 +426,41 @@ class AsyncKernelFrame {
 };
 
 inline void AsyncKernelFrame::AssignFields(const AsyncKernelFrame& other) {
-  for (auto* arg : arguments_) arg->DropRef();
-  arguments_ = other.arguments_;
-  for (auto* arg : arguments_) arg->AddRef();
+  ResetArguments();
+  ClearResults();
 
-  assert(results_.empty());
-  results_.reserve(other.results_.size());
-  for (auto& result : other.results_) results_.push_back(result);
+  values_.reserve(other.num_arguments_ + other.num_results_);
+  for (auto* arg : other.GetArguments()) {
+    arg->AddRef();
+    PushArgument(arg);
+  }
+  PushResults(other.num_results_);
+  for (size_t i = 0; i < num_results_; ++i) results()[i] = other.results()[i];
 
   attribute_section_ = other.attribute_section_;
+  attribute_section_owner_ = other.attribute_section_owner_;
+  call_site_slot_ = other.call_site_slot_;
   attribute_offsets_ = other.attribute_offsets_;
   function_indices_ = other.function_indices_;
   functions_ = other.functions_;
 }
 
 inline void AsyncKernelFrame::AssignFields(AsyncKernelFrame&& other) {
-  for (auto* arg : arguments_) arg->DropRef();
-  arguments_ = std::move(other.arguments_);
-  results_ = std::move(other.results_);
+  ResetArguments();
+  ClearResults();
+
+  // The slots are trivially copyable, so moving them moves the arguments and
+  // results without touching their reference counts.
+  values_ = std::move(other.values_);
+  num_arguments_ = other.num_arguments_;
+  num_results_ = other.num_results_;
+  other.values_.clear();
+  other.num_arguments_ = 0;
+  other.num_results_ = 0;
 
   attribute_section_ = other.attribute_section_;
+  attribute_section_owner_ = other.attribute_section_owner_;
+  call_site_slot_ = other.call_site_slot_;
   attribute_offsets_ = other.attribute_offsets_;
   function_indices_ = other.function_indices_;
   functions_ = other.functions_;
@@ -308,11 +471,14 @@ inline void AsyncKernelFrame::AssignFields(AsyncKernelFrame&& other) {
 // implementation.
 //
 // This class requires that the client performs the following in order:
-// 1. Add args (using AddArg()) and set the number of results (using
-//    SetNumResults()),
+// 1. Optionally reserve storage (using Reserve()), add args (using AddArg())
+//    and set the number of results (using SetNumResults()),
 // 2. call the kernel,
 // 3. reset arguments (using ResetArguments()) and release results (using
 //    ReleaseResultAt()).
+//
+// A KernelFrameBuilder may be reused for several kernels in a row, in which
+// case the storage for arguments and results is reused as well.
 class KernelFrameBuilder : public AsyncKernelFrame {
  public:
   explicit KernelFrameBuilder(ExecutionContext exec_ctx)
@@ -320,25 +486,41 @@ class KernelFrameBuilder : public AsyncKernelFrame {
 
   // Get result AsyncValue at the given index.
   const RCReference<AsyncValue>& GetResultAt(int index) const {
-    return results_[index];
+    return results()[index];
   }
 
   RCReference<AsyncValue> ReleaseResultAt(int index) {
-    return std::move(results_[index]);
+    return std::move(results()[index]);
+  }
+
+  // Make room for `num_arguments` arguments and `num_results` results, as
+  // recorded in the BEF kernel header, so that adding them allocates at most
+  // once. No allocation happens if they fit in the inline storage or in the
+  // storage left by a previous kernel.
+  void Reserve(int num_arguments, int num_results) {
+    values_.reserve(num_arguments + num_results);
   }
 
   // TODO(tfrt-devs): Consider keeping BEFFile* in the kernel frame directly
   // instead of keeping individual fields.
-  void SetAttributeSection(ArrayRef<uint8_t> attribute_section) {
+  void SetAttributeSection(ArrayRef<uint8_t> attribute_section,
+                           const AttributeSectionOwner* owner = nullptr) {
     attribute_section_ = attribute_section;
+    attribute_section_owner_ = owner;
   }
   void SetFunctions(ArrayRef<std::unique_ptr<Function>> functions) {
     functions_ = functions;
   }
 
+  // Set the slot for the state of the next kernel call site, see
+  // KernelCallSiteState. The slot must outlive the frame.
+  void SetCallSiteSlot(KernelCallSiteSlot* call_site_slot) {
+    call_site_slot_ = call_site_slot;
+  }
+
   // Add a new argument to the AsyncKernelFrame.
   void AddArg(RCReference<AsyncValue> async_value) {
-    arguments_.push_back(async_value.release());
+    PushArgument(async_value.release());
   }
 
   // Add all attributes to the AsyncKernelFrame.
@@ -352,7 +534,7 @@ class KernelFrameBuilder : public AsyncKernelFrame {
   }
 
   // Set the number of results expected.
-  void SetNumResults(size_t n) { results_.resize(n); }
+  void SetNumResults(size_t n) { PushResults(n); }
 
   // Set the location.
   void SetLocation(const Location& location) {
@@ -364,7 +546,7 @@ class KernelFrameBuilder : public AsyncKernelFrame {
 
 inline void AsyncKernelFrame::AssertArity(int num_arguments, int num_attributes,
                                           int num_results) const {
-  assert(arguments_.size() == num_arguments);
+  assert(GetNumArgs() == num_arguments);
   assert(GetNumAttributes() == num_attributes);
   assert(GetNumResults() == num_results);
 }
@@ -48,6 +48,30 @@ AsyncKernelImplementation AsBEFKernel();
 
 }  // namespace internal
 
+// A kernel of a table that is built at compile time, e.g.
+//
+//   static constexpr StaticKernel kKernels[] = {
+//       {"tfrt.add.i32", TFRT_KERNEL(TFRTAdd<int32_t>)},
+//       {"tfrt.add.i64", TFRT_KERNEL(TFRTAdd<int64_t>)},
+//   };
+//
+// See KernelRegistry::AddKernelTable().
+struct StaticKernel {
+  constexpr StaticKernel(string_view name, AsyncKernelImplementation fn)
+      : name(name), async_fn(fn) {}
+  constexpr StaticKernel(string_view name, SyncKernelImplementation fn)
+      : name(name), sync_fn(fn) {}
+
+  KernelImplementation implementation() const {
+    if (async_fn) return KernelImplementation{async_fn};
+    return KernelImplementation{sync_fn};
+  }
+
+  string_view name;
+  AsyncKernelImplementation async_fn = nullptr;
+  SyncKernelImplementation sync_fn = nullptr;
+};
+
 // This represents a mapping between the names of the MLIR opcodes to the
 // implementations of those functions, along with type mappings.
 class KernelRegistry {
@@ -66,8 +90,21 @@ class KernelRegistry {
     AddKernel(name, internal::AsBEFKernel<KernelTraitT>());
   }
 
+  // Adds the kernels of a table that is built at compile time. The kernels
+  // are not copied, so `kernels` must outlive the registry, and their names
+  // are only hashed once the registry is frozen. Until then GetKernel() scans
+  // the tables.
+  void AddKernelTable(ArrayRef<StaticKernel> kernels);
+
   KernelImplementation GetKernel(string_view name) const;
 
+  // Builds a flat open-addressing table of the kernels registered so far, so
+  // that GetKernel() resolves a name with a single hash and typically a single
+  // probe of contiguous memory. This is done by RegisterStaticKernels(), as
+  // BEFFile::Open() resolves every kernel of the file through GetKernel().
+  // Adding a kernel afterwards discards the table until the next Freeze().
+  void Freeze();
+
   TypeName GetType(string_view type) const;
 
  private:
@@ -90,6 +127,18 @@ class KernelRegistry {
     return true;                                            \
   }()
 
+// Use this macro to add a table of kernels that are statically linked in the
+// binary, see KernelRegistry::AddKernelTable(). TABLE should be an array of
+// StaticKernel with static storage duration.
+#define TFRT_STATIC_KERNEL_TABLE(TABLE) \
+  TFRT_STATIC_KERNEL_TABLE_(TABLE, __COUNTER__)
+#define TFRT_STATIC_KERNEL_TABLE_(TABLE, N) TFRT_STATIC_KERNEL_TABLE__(TABLE, N)
+#define TFRT_STATIC_KERNEL_TABLE__(TABLE, N)                      \
+  static bool tfrt_static_kernel_table_##N##_registered_ = []() { \
+    ::tfrt::AddStaticKernelTable(TABLE);                          \
+    return true;                                                  \
+  }()
+
 // The type for kernel registration functions. This is the same as the
 // prototype for the entry point function for dynamic plugins.
 using KernelRegistration = void (*)(KernelRegistry*);
@@ -102,6 +151,10 @@ void RegisterStaticKernels(KernelRegistry* kernel_reg);
 // TFRT_STATIC_KERNEL_REGISTRATION instead.
 void AddStaticKernelRegistration(KernelRegistration func);
 
+// Adds a table of kernels to the registry. This should not be used directly;
+// use TFRT_STATIC_KERNEL_TABLE instead.
+void AddStaticKernelTable(ArrayRef<StaticKernel> kernels);
+
 }  // namespace tfrt
 
 #endif  // TFRT_HOST_CONTEXT_KERNEL_REGISTRY_H_
@@ -44,6 +44,11 @@ class Function;
 
 template <typename T>
 AsyncValueRef<T> ForwardValue(T& value, AsyncValueRef<Chain> chain) {
+  // Ready chains are the common case for kernels that complete inline, and do
+  // not need the AndThen callback.
+  if (chain.IsConcrete())
+    return MakeAvailableAsyncValueRef<T>(std::move(value));
+
   auto result = MakeUnconstructedAsyncValueRef<T>();
   auto* chain_av = chain.GetAsyncValue();
   chain_av->AndThen([result = result.CopyRef(), value = std::move(value),
@@ -19,10 +19,15 @@
 #ifndef TFRT_HOST_CONTEXT_NATIVE_FUNCTION_H_
 #define TFRT_HOST_CONTEXT_NATIVE_FUNCTION_H_
 
+#include <cassert>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Error.h"
 #include "tfrt/host_context/function.h"
+#include "tfrt/host_context/value.h"
 #include "tfrt/support/mutex.h"
 
 namespace tfrt {
@@ -39,6 +44,76 @@ using NativeCallable = void (*)(AsyncValue* const* arguments, int num_arguments,
                                 RCReference<AsyncValue>* results,
                                 int num_results, HostContext* host);
 
+// The sync counterpart of NativeCallable, which takes the Values of the
+// arguments and results directly, so that sync callers such as the
+// BEFInterpreter do not box them in AsyncValues. The results are empty Values
+// for the callee to emplace into. Errors are returned instead of being set on
+// the results.
+using SyncNativeCallable = Error (*)(Value* const* arguments, int num_arguments,
+                                     Value* const* results, int num_results,
+                                     const ExecutionContext& exec_ctx);
+
+namespace internal {
+
+template <typename T>
+struct IsExpected : std::false_type {};
+template <typename T>
+struct IsExpected<Expected<T>> : std::true_type {};
+
+template <typename F, F f>
+struct SyncNativeCallableImpl;
+
+template <typename Return, typename... Args, Return (*f)(Args...)>
+struct SyncNativeCallableImpl<Return (*)(Args...), f> {
+  static constexpr int kNumResults =
+      std::is_void<Return>::value || std::is_same<Return, Error>::value ? 0
+                                                                        : 1;
+
+  static Error Invoke(Value* const* arguments, int num_arguments,
+                      Value* const* results, int num_results,
+                      const ExecutionContext& exec_ctx) {
+    assert(num_arguments == sizeof...(Args) && "argument count mismatch");
+    assert(num_results == kNumResults && "result count mismatch");
+    return InvokeImpl(arguments, results, std::index_sequence_for<Args...>());
+  }
+
+ private:
+  template <size_t... I>
+  static Error InvokeImpl(Value* const* arguments, Value* const* results,
+                          std::index_sequence<I...>) {
+    if constexpr (std::is_void<Return>::value) {
+      f(arguments[I]->get<std::decay_t<Args>>()...);
+      return Error::success();
+    } else if constexpr (std::is_same<Return, Error>::value) {
+      return f(arguments[I]->get<std::decay_t<Args>>()...);
+    } else if constexpr (IsExpected<Return>::value) {
+      Return result = f(arguments[I]->get<std::decay_t<Args>>()...);
+      if (!result) return result.takeError();
+      results[0]->emplace<std::decay_t<decltype(*result)>>(
+          std::move(*result));
+      return Error::success();
+    } else {
+      results[0]->emplace<Return>(
+          f(arguments[I]->get<std::decay_t<Args>>()...));
+      return Error::success();
+    }
+  }
+};
+
+}  // namespace internal
+
+// TFRT_SYNC_NATIVE_FUNCTION turns a function with typed arguments into a
+// SyncNativeCallable. The function returns its only result, Expected<T> for a
+// result that may fail, Error if it has no result but may fail, or void, e.g.
+//
+//   int32_t Add(int32_t a, int32_t b) { return a + b; }
+//   registry->AddSync("add", TFRT_SYNC_NATIVE_FUNCTION(Add));
+#define TFRT_SYNC_NATIVE_FUNCTION(...)                              \
+  &::tfrt::internal::SyncNativeCallableImpl<decltype(&__VA_ARGS__), \
+                                            &__VA_ARGS__>::Invoke
+
+// A native function may be registered with a NativeCallable, a
+// SyncNativeCallable or both under the same name.
 class NativeFunctionRegistry {
  public:
   static NativeFunctionRegistry& GetGlobalRegistry() {
@@ -53,25 +128,44 @@ class NativeFunctionRegistry {
     (void)r;
   }
 
+  void AddSync(string_view name, SyncNativeCallable callable) {
+    mutex_lock lock(m_);
+    auto r = sync_callables_.try_emplace(name, callable);
+    assert(r.second && "sync native function already exists");
+    (void)r;
+  }
+
   NativeCallable Get(string_view name) const {
     mutex_lock lock(m_);
     return callables_.lookup(name);
   }
 
+  SyncNativeCallable GetSync(string_view name) const {
+    mutex_lock lock(m_);
+    return sync_callables_.lookup(name);
+  }
+
  private:
   mutable mutex m_;
   llvm::StringMap<NativeCallable> callables_ TFRT_GUARDED_BY(m_);
+  llvm::StringMap<SyncNativeCallable> sync_callables_ TFRT_GUARDED_BY(m_);
 };
 
 // NativeFunction provides an interface for BEF Executor to run native
-// executables.
+// executables. Either of `callable` and `sync_callable` may be null, but not
+// both.
 class NativeFunction : public Function {
  public:
   NativeFunction(string_view name, ArrayRef<TypeName> argument_types,
-                 ArrayRef<TypeName> result_types, NativeCallable callable)
+                 ArrayRef<TypeName> result_types, NativeCallable callable,
+                 SyncNativeCallable sync_callable = nullptr)
       : Function(name, FunctionKind::kNativeFunction, argument_types,
                  result_types),
-        callable_(callable) {}
+        callable_(callable),
+        sync_callable_(sync_callable) {
+    assert((callable_ != nullptr || sync_callable_ != nullptr) &&
+           "native function has no implementation");
+  }
 
   void Execute(const ExecutionContext& exec_ctx,
                ArrayRef<AsyncValue*> arguments,
@@ -84,6 +178,13 @@ class NativeFunction : public Function {
     assert(false && "not implemented");
   }
 
+  // Run the SyncNativeCallable on `arguments` and `results`, which is what
+  // ExecuteSyncBEFFunction() does for native functions. Returns an error if
+  // the function has no sync implementation.
+  Error SyncExecute(const ExecutionContext& exec_ctx,
+                    ArrayRef<Value*> arguments,
+                    ArrayRef<Value*> results) const;
+
   // Do nothing with reference counting as a native function should be always
   // available.
   void AddRef() const final {}
@@ -91,6 +192,7 @@ class NativeFunction : public Function {
 
  private:
   NativeCallable callable_;
+  SyncNativeCallable sync_callable_;
 };
 
 }  // namespace tfrt
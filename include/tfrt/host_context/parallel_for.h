@@ -48,6 +48,13 @@ class ParallelFor {
     static BlockSizes Fixed(size_t n);
     // Splits range into a block sizes not smaller than `min`.
     static BlockSizes Min(size_t min);
+    // Splits range into blocks at run time. Worker tasks repeatedly claim the
+    // next block from the unprocessed part of the range. Each block is a
+    // fraction of what is left, and never smaller than `min` unless the range
+    // ends, so blocks shrink towards the end of the range. This balances ranges
+    // with skewed per-element costs, and workers that start late because the
+    // work queue is busy simply process fewer blocks.
+    static BlockSizes Adaptive(size_t min);
 
    private:
     friend class ParallelFor;
@@ -55,6 +62,10 @@ class ParallelFor {
     explicit BlockSizes(llvm::unique_function<size_t(size_t)> impl)
         : impl_(std::move(impl)) {}
 
+    // The minimum size of the blocks claimed at run time, or zero if the block
+    // size is computed up front by GetBlockSize().
+    size_t adaptive_min_block_size_ = 0;
+
     // Returns a parallel block size for a range of `total_size` and the
     // specified number of worker threads.
     size_t GetBlockSize(size_t num_worker_threads, size_t total_size) const;
@@ -66,6 +77,35 @@ class ParallelFor {
     mutable llvm::unique_function<size_t(size_t)> impl_;
   };
 
+  //===--------------------------------------------------------------------===//
+  // RegionScope marks the calling thread as running one block of a parallel
+  // region for as long as the scope is alive.
+  //===--------------------------------------------------------------------===//
+  //
+  // ParallelFor enters a scope around every block it runs in parallel, and
+  // other parallel runtimes that share the HostContext work queue (e.g. the
+  // Eigen thread pool device) should do the same for their tasks. The worker
+  // threads are already occupied by the blocks of the enclosing regions, so a
+  // nested ParallelFor splits its range as if there was a single worker
+  // thread, and runs all of its blocks in the caller thread once the nesting
+  // depth reaches kMaxNestingDepth.
+  class RegionScope {
+   public:
+    RegionScope() { ++depth_; }
+    ~RegionScope() { --depth_; }
+
+    RegionScope(const RegionScope&) = delete;
+    RegionScope& operator=(const RegionScope&) = delete;
+
+    // Returns the number of parallel regions the calling thread is in.
+    static int Depth() { return depth_; }
+
+   private:
+    static thread_local int depth_;
+  };
+
+  static constexpr int kMaxNestingDepth = 2;
+
   //===--------------------------------------------------------------------===//
   // Parallel for algorithms.
   //===--------------------------------------------------------------------===//
@@ -17,11 +17,19 @@
 // Profiled Memory Allocator
 //
 // This file implements a profiling host memory allocator that does a memory
-// leak check and prints allocation statistics when destroyed.
+// leak check and prints allocation statistics when destroyed, and a sampling
+// allocation profiler that attributes allocations to kernels.
 
+#ifndef TFRT_HOST_CONTEXT_PROFILED_ALLOCATOR_H_
+#define TFRT_HOST_CONTEXT_PROFILED_ALLOCATOR_H_
+
+#include <cstdint>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "tfrt/host_context/host_allocator.h"
+#include "tfrt/support/forward_decls.h"
 
 namespace tfrt {
 
@@ -33,4 +41,50 @@ std::unique_ptr<HostAllocator> CreateProfiledAllocator(
 std::unique_ptr<HostAllocator> CreateLeakCheckAllocator(
     std::unique_ptr<HostAllocator> allocator);
 
+// An allocator that samples the allocations it forwards and attributes them to
+// the AllocationSite of the allocating thread (see allocation_site.h). The
+// sampled allocations are scaled to estimates of all allocations, so the cost
+// of an allocation that is not sampled is a thread local decrement.
+class AllocationProfiler : public HostAllocator {
+ public:
+  // Estimated statistics of the allocations made at one site.
+  struct SiteStats {
+    std::string kernel_name;
+    // The decoded location of the kernel, or empty if unknown.
+    std::string location;
+    std::string filename;
+    int line = 0;
+    int64_t num_samples = 0;
+    int64_t num_allocations = 0;
+    int64_t bytes_allocated = 0;
+    int64_t live_allocations = 0;
+    int64_t live_bytes = 0;
+    int64_t peak_live_bytes = 0;
+  };
+
+  // Returns a snapshot of the statistics of every site, sorted by decreasing
+  // peak live bytes. Allocations without a site are reported under the kernel
+  // name "<unattributed>".
+  virtual std::vector<SiteStats> GetSiteStats() const = 0;
+
+  // Writes one line per site, in the order of GetSiteStats():
+  //
+  //   <peak live bytes> <live bytes> <bytes> <allocations> <kernel> [at <loc>]
+  virtual void Print(raw_ostream& os) const = 0;
+
+  // Writes the sampled allocations as an uncompressed pprof profile.proto,
+  // with the sample types of a Go heap profile: alloc_objects, alloc_space,
+  // inuse_objects and inuse_space. Each site is a single frame named after the
+  // kernel, at the file and line of its location.
+  virtual void WritePprofProfile(raw_ostream& os) const = 0;
+};
+
+// Decorate an allocator with a sampling allocation profiler, which samples on
+// average one allocation every `sample_period_bytes` bytes allocated.
+std::unique_ptr<AllocationProfiler> CreateAllocationProfiler(
+    std::unique_ptr<HostAllocator> allocator,
+    int64_t sample_period_bytes = 256 * 1024);
+
 }  // namespace tfrt
+
+#endif  // TFRT_HOST_CONTEXT_PROFILED_ALLOCATOR_H_
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares Rendezvous, which passes values between the partitions
+// of a function that run on different hosts, e.g. through the tfrt.send and
+// tfrt.recv kernels.
+
+#ifndef TFRT_HOST_CONTEXT_RENDEZVOUS_H_
+#define TFRT_HOST_CONTEXT_RENDEZVOUS_H_
+
+#include <deque>
+#include <memory>
+
+#include "llvm/ADT/StringMap.h"
+#include "tfrt/host_context/async_value.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+
+namespace tfrt {
+
+class ResourceContext;
+
+// A Rendezvous pairs the values sent under a key with the receives of that
+// key, in order. A value can be received before it is sent, or before it is
+// available. Implementations must be thread-safe.
+class Rendezvous {
+ public:
+  virtual ~Rendezvous();
+
+  virtual void Send(string_view key, RCReference<AsyncValue> value) = 0;
+
+  // Returns the value of the next Send() of `key`.
+  virtual RCReference<AsyncValue> Recv(string_view key) = 0;
+};
+
+// A Rendezvous between the partitions of a function that run in this
+// process, which passes the values along without copying them.
+class InProcessRendezvous : public Rendezvous {
+ public:
+  InProcessRendezvous();
+  ~InProcessRendezvous() override;
+
+  void Send(string_view key, RCReference<AsyncValue> value) override;
+  RCReference<AsyncValue> Recv(string_view key) override;
+
+ private:
+  // The values sent but not received yet, or the receives waiting for values.
+  // At most one of them is non-empty.
+  struct Entry {
+    std::deque<RCReference<AsyncValue>> values;
+    std::deque<RCReference<IndirectAsyncValue>> receives;
+  };
+
+  mutex mu_;
+  llvm::StringMap<Entry> entries_ TFRT_GUARDED_BY(mu_);
+};
+
+// Makes the tfrt.send and tfrt.recv kernels of the requests with
+// `resource_context` use `rendezvous`, e.g. one that sends the values to
+// other hosts. Must be called before the first of these kernels runs.
+void SetRendezvous(ResourceContext* resource_context,
+                   std::unique_ptr<Rendezvous> rendezvous);
+
+// Returns the rendezvous set with SetRendezvous(), or creates an
+// InProcessRendezvous if there is none.
+Rendezvous* GetOrCreateRendezvous(ResourceContext* resource_context);
+
+}  // namespace tfrt
+
+#endif  // TFRT_HOST_CONTEXT_RENDEZVOUS_H_
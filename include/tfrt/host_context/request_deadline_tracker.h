@@ -40,6 +40,13 @@ class RequestDeadlineTracker {
         });
   }
 
+  // Enqueue a timer that cancels the request when the deadline from its
+  // RequestOptions passes. Does nothing if the request has no deadline.
+  void CancelRequestOnDeadline(const RCReference<RequestContext>& req_ctx) {
+    if (req_ctx->deadline().has_value())
+      CancelRequestOnDeadline(*req_ctx->deadline(), req_ctx);
+  }
+
  private:
   TimerQueue* timer_queue_;
 };
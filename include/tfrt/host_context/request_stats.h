@@ -0,0 +1,117 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares RequestStats, which accounts the resources consumed on
+// behalf of a request.
+
+#ifndef TFRT_HOST_CONTEXT_REQUEST_STATS_H_
+#define TFRT_HOST_CONTEXT_REQUEST_STATS_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+namespace tfrt {
+
+class HostAllocator;
+
+// Accumulates the cost of a request, see RequestOptions::stats. The counters
+// are updated concurrently by the threads that work on the request, and can be
+// read at any time. They are final once the request completes, i.e. once the
+// last reference to its RequestContext is dropped, which also records them
+// into the histogram metrics "/tfrt/request/<counter>".
+class RequestStats {
+ public:
+  struct Snapshot {
+    // The CPU time of the threads that ran kernels of the request, summed
+    // over the threads.
+    std::chrono::nanoseconds cpu_time{0};
+    // The bytes allocated on behalf of the request through an allocator that
+    // was created with CreateRequestAccountingAllocator().
+    int64_t bytes_allocated = 0;
+    // The number of BEF kernels run for the request.
+    int64_t kernels_executed = 0;
+    // The wall time threads spent blocked in Await() for the request.
+    std::chrono::nanoseconds await_time{0};
+  };
+
+  // Makes `stats` the request that the resources consumed by the calling
+  // thread are attributed to, and adds the CPU time of the thread until the
+  // destruction of the scope to it. Does nothing if `stats` is null, or if
+  // the thread is already attributing to a request.
+  class Scope {
+   public:
+    explicit Scope(RequestStats* stats) {
+      if (stats != nullptr && current_ == nullptr) Enter(stats);
+    }
+    ~Scope() {
+      if (stats_ != nullptr) Exit();
+    }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+   private:
+    void Enter(RequestStats* stats);
+    void Exit();
+
+    RequestStats* stats_ = nullptr;
+    std::chrono::nanoseconds start_cpu_time_{0};
+  };
+
+  // Returns the request the calling thread attributes to, or null.
+  static RequestStats* Current() { return current_; }
+
+  // Returns the CPU time consumed by the calling thread so far.
+  static std::chrono::nanoseconds ThreadCpuTime();
+
+  void AddCpuTime(std::chrono::nanoseconds duration) {
+    cpu_time_ns_.fetch_add(duration.count(), std::memory_order_relaxed);
+  }
+  void AddBytesAllocated(int64_t bytes) {
+    bytes_allocated_.fetch_add(bytes, std::memory_order_relaxed);
+  }
+  void AddKernelsExecuted(int64_t count) {
+    kernels_executed_.fetch_add(count, std::memory_order_relaxed);
+  }
+  void AddAwaitTime(std::chrono::nanoseconds duration) {
+    await_time_ns_.fetch_add(duration.count(), std::memory_order_relaxed);
+  }
+
+  Snapshot snapshot() const;
+
+  // Records the current values into the request histogram metrics.
+  void RecordMetrics() const;
+
+ private:
+  static thread_local RequestStats* current_;
+
+  std::atomic<int64_t> cpu_time_ns_{0};
+  std::atomic<int64_t> bytes_allocated_{0};
+  std::atomic<int64_t> kernels_executed_{0};
+  std::atomic<int64_t> await_time_ns_{0};
+};
+
+// Creates an allocator that forwards to `parent`, and charges the bytes
+// allocated to RequestStats::Current(), if any. Install it as the HostContext
+// allocator to attribute the tensors allocated by kernels to requests.
+std::unique_ptr<HostAllocator> CreateRequestAccountingAllocator(
+    std::unique_ptr<HostAllocator> parent);
+
+}  // namespace tfrt
+
+#endif  // TFRT_HOST_CONTEXT_REQUEST_STATS_H_
@@ -0,0 +1,113 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares RequestTracker, which tracks the completion of a group of
+// requests.
+
+#ifndef TFRT_HOST_CONTEXT_REQUEST_TRACKER_H_
+#define TFRT_HOST_CONTEXT_REQUEST_TRACKER_H_
+
+#include <chrono>
+#include <cstddef>
+
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/FunctionExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/ref_count.h"
+#include "tfrt/support/thread_annotations.h"
+
+namespace tfrt {
+
+class CancellationContext;
+
+// RequestTracker tracks the requests of a group, e.g. the requests that use
+// the resources of one model, until they complete. A request completes when
+// the last reference to its RequestContext is dropped, i.e. when no kernel of
+// the request runs or waits any more.
+//
+// Unlike HostContext::Quiesce(), which waits until the work queue is idle,
+// draining a tracker only waits for the requests of the group, so a model can
+// be unloaded while the requests of other models keep running.
+//
+// Every ResourceContext has a tracker of the requests built with it. Other
+// groups, e.g. the requests that execute the functions of a BEFFile, can be
+// tracked with RequestOptions::request_tracker. This class is thread-safe.
+class RequestTracker {
+ public:
+  // The tracking of one request, from the construction to the destruction of
+  // its RequestContext. Registrations without a tracker do nothing.
+  class Registration {
+   public:
+    Registration(RequestTracker* tracker,
+                 const RCReference<CancellationContext>& cancellation);
+    ~Registration();
+
+    Registration(const Registration&) = delete;
+    Registration& operator=(const Registration&) = delete;
+
+   private:
+    friend class RequestTracker;
+
+    RequestTracker* const tracker_;
+    // Kept here, as the tracker may cancel the request while the members of
+    // the RequestContext are destroyed.
+    RCReference<CancellationContext> cancellation_;
+  };
+
+  RequestTracker() = default;
+  // All tracked requests must have completed.
+  ~RequestTracker();
+
+  RequestTracker(const RequestTracker&) = delete;
+  RequestTracker& operator=(const RequestTracker&) = delete;
+
+  // Returns the number of tracked requests that have not completed.
+  size_t GetNumPendingRequests() const TFRT_EXCLUDES(mu_);
+
+  // Cancels the requests that have not completed. Their remaining kernels are
+  // skipped, so they complete soon.
+  void CancelPendingRequests() TFRT_EXCLUDES(mu_);
+
+  // Blocks until no tracked request is pending. Requests that start while
+  // draining are waited for as well, so the caller should stop starting new
+  // requests of the group first. Must not be called from the threads that run
+  // the requests.
+  void Drain() TFRT_EXCLUDES(mu_);
+
+  // Same as Drain(), but gives up after `timeout`. Returns true if no tracked
+  // request is pending.
+  bool DrainFor(std::chrono::steady_clock::duration timeout)
+      TFRT_EXCLUDES(mu_);
+
+  // Calls `callback` once no tracked request is pending, in the thread that
+  // completes the last pending request, or right away if none is pending.
+  void OnDrained(llvm::unique_function<void()> callback) TFRT_EXCLUDES(mu_);
+
+ private:
+  void Add(Registration* registration) TFRT_EXCLUDES(mu_);
+  void Remove(Registration* registration) TFRT_EXCLUDES(mu_);
+
+  mutable mutex mu_;
+  condition_variable drained_;
+  llvm::DenseSet<Registration*> pending_ TFRT_GUARDED_BY(mu_);
+  llvm::SmallVector<llvm::unique_function<void()>, 2> on_drained_
+      TFRT_GUARDED_BY(mu_);
+};
+
+}  // namespace tfrt
+
+#endif  // TFRT_HOST_CONTEXT_REQUEST_TRACKER_H_
@@ -22,22 +22,33 @@
 
 #include <array>
 #include <atomic>
+#include <cstdint>
 #include <memory>
 #include <optional>
+#include <string>
 
 #include "absl/status/statusor.h"  // from @com_google_absl
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm_derived/Support/unique_any.h"
+#include "tfrt/host_context/request_tracker.h"
 #include "tfrt/support/forward_decls.h"
 #include "tfrt/support/mutex.h"
+#include "tfrt/support/published_snapshot.h"
 #include "tfrt/support/thread_annotations.h"
 
 namespace tfrt {
 
 // ResourceContext is used to store and retrieve resources. This class is
 // thread-safe.
+//
+// Looking up a resource does not lock: the resources are indexed by an
+// immutable snapshot of their names that is replaced whenever a resource is
+// created or deleted. Resources are expected to be created once and looked up
+// many times, e.g. by every request that shares them. A replaced snapshot is
+// freed once the lookups that may still read it are done, see
+// PublishedSnapshot.
 class ResourceContext {
  public:
   ResourceContext() = default;
@@ -49,27 +60,35 @@ class ResourceContext {
   ResourceContext(const ResourceContext&) = delete;
   ResourceContext& operator=(const ResourceContext&) = delete;
 
-  // Get a resource T with a `resource_name`. Thread-safe.
+  // Returns an id that no other ResourceContext of the process has, unlike
+  // the address of this context, which a later context may reuse. Caches of
+  // resources can use it to tell contexts apart.
+  uint64_t id() const { return id_; }
+
+  // Tracks the requests that are built with this context and
+  // RequestOptions::track_in_resource_context until they complete, e.g. to
+  // drain them before the resources are deleted.
+  RequestTracker& request_tracker() { return request_tracker_; }
+
+  // Get a resource T with a `resource_name`. Thread-safe and lock-free.
   template <typename T>
-  std::optional<T*> GetResource(string_view resource_name) TFRT_EXCLUDES(mu_) {
-    tfrt::mutex_lock lock(mu_);
-    auto it = resources_.find(resource_name);
-    if (it == resources_.end()) {
+  std::optional<T*> GetResource(string_view resource_name) const {
+    tfrt::UniqueAny* resource = Find(resource_name);
+    if (resource == nullptr) {
       return std::nullopt;
     }
-    T* data = tfrt::any_cast<T>(&it->second);
+    T* data = tfrt::any_cast<T>(resource);
     return data;
   }
 
   // Get a resource T with a `resource_name`. Asserts that the resource has
   // been created.
-  // Thread-safe.
+  // Thread-safe and lock-free.
   template <typename T>
-  T* GetResourceOrDie(tfrt::string_view resource_name) TFRT_EXCLUDES(mu_) {
-    tfrt::mutex_lock lock(mu_);
-    auto it = resources_.find(resource_name);
-    assert(it != resources_.end());
-    T* data = tfrt::any_cast<T>(&it->second);
+  T* GetResourceOrDie(tfrt::string_view resource_name) const {
+    tfrt::UniqueAny* resource = Find(resource_name);
+    assert(resource != nullptr);
+    T* data = tfrt::any_cast<T>(resource);
     return data;
   }
 
@@ -83,6 +102,7 @@ class ResourceContext {
                                       std::forward<Args>(args)...);
     assert(res.second);
     resource_vector_.push_back(&res.first->second);
+    PublishIndex();
     return tfrt::any_cast<T>(&res.first->second);
   }
 
@@ -90,14 +110,20 @@ class ResourceContext {
   // GetResource and CreateResource are the preferred API. GetOrCreateResource
   // is useful when callers want to lazily initialize some resources. Since it
   // requires constructor arguments, it is more awkward to use.
-  // Thread-safe.
+  // Thread-safe, and lock-free if the resource exists.
   template <typename T, typename... Args>
   T* GetOrCreateResource(tfrt::string_view resource_name, Args&&... args)
       TFRT_EXCLUDES(mu_) {
+    if (tfrt::UniqueAny* resource = Find(resource_name))
+      return tfrt::any_cast<T>(resource);
+
     tfrt::mutex_lock lock(mu_);
     auto res = resources_.try_emplace(resource_name, tfrt::in_place_type<T>,
                                       std::forward<Args>(args)...);
-    if (res.second) resource_vector_.push_back(&res.first->second);
+    if (res.second) {
+      resource_vector_.push_back(&res.first->second);
+      PublishIndex();
+    }
     return tfrt::any_cast<T>(&res.first->second);
   }
 
@@ -105,6 +131,9 @@ class ResourceContext {
   absl::StatusOr<T*> GetOrCreateResource(
       tfrt::string_view resource_name,
       std::function<absl::StatusOr<T>()> creator) TFRT_EXCLUDES(mu_) {
+    if (tfrt::UniqueAny* resource = Find(resource_name))
+      return tfrt::any_cast<T>(resource);
+
     tfrt::mutex_lock lock(mu_);
     if (auto it = resources_.find(resource_name); it != resources_.end()) {
       return tfrt::any_cast<T>(&it->second);
@@ -113,12 +142,14 @@ class ResourceContext {
     if (!resource.ok()) return resource.status();
     auto res = resources_.try_emplace(resource_name, std::move(*resource));
     resource_vector_.push_back(&res.first->second);
+    PublishIndex();
     return tfrt::any_cast<T>(&res.first->second);
   }
 
   // Delete resource with name `resource_name`.  No-op if it doesn't exist.
+  // The resource must not be looked up or used while it is deleted.
   // Thread-safe.
-  void DeleteResource(tfrt::string_view resource_name) {
+  void DeleteResource(tfrt::string_view resource_name) TFRT_EXCLUDES(mu_) {
     tfrt::mutex_lock lock(mu_);
     auto map_it = resources_.find(resource_name);
     if (map_it == resources_.end()) {
@@ -127,13 +158,49 @@ class ResourceContext {
     auto vector_it = std::find(resource_vector_.begin(), resource_vector_.end(),
                                &map_it->second);
     resource_vector_.erase(vector_it);
+    // Unpublish the resource before destroying it.
+    PublishIndex(/*excluded=*/&map_it->second);
     resources_.erase(map_it);
   }
 
  private:
+  // An immutable snapshot of the resources by name.
+  using Index = llvm::StringMap<tfrt::UniqueAny*>;
+
+  tfrt::UniqueAny* Find(string_view resource_name) const {
+    return index_.Read([&](const Index* index) -> tfrt::UniqueAny* {
+      if (index == nullptr) return nullptr;
+      auto it = index->find(resource_name);
+      return it == index->end() ? nullptr : it->second;
+    });
+  }
+
+  // Replace the index with a snapshot of `resources_` without `excluded`.
+  void PublishIndex(const tfrt::UniqueAny* excluded = nullptr)
+      TFRT_REQUIRES(mu_) {
+    auto index = std::make_unique<Index>();
+    for (auto& resource : resources_) {
+      if (&resource.getValue() != excluded)
+        index->try_emplace(resource.getKey(), &resource.getValue());
+    }
+    index_.Publish(std::move(index));
+  }
+
+  static uint64_t NextId() {
+    static std::atomic<uint64_t> next_id{0};
+    return next_id.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  RequestTracker request_tracker_;
+
+  const uint64_t id_ = NextId();
+
   tfrt::mutex mu_;
   llvm::StringMap<tfrt::UniqueAny> resources_ TFRT_GUARDED_BY(mu_);
   llvm::SmallVector<tfrt::UniqueAny*, 8> resource_vector_ TFRT_GUARDED_BY(mu_);
+
+  // Published under `mu_`.
+  PublishedSnapshot<Index> index_;
 };
 
 inline ResourceContext::~ResourceContext() {
@@ -141,5 +208,42 @@ inline ResourceContext::~ResourceContext() {
   for (auto* res : llvm::reverse(resource_vector_)) res->reset();
 }
 
+// ResourceHandle refers to a resource T with a `resource_name` of a
+// ResourceContext. It resolves the resource once it is created and caches it,
+// so that later lookups through the handle are a single atomic load and do not
+// hash the name. The resource must not be deleted while the handle is used.
+// This class is thread-safe.
+//
+// Sample usage:
+//   ResourceHandle<VocabTable> vocab(resource_context, "vocab");
+//   // For every request:
+//   if (VocabTable* table = vocab.get()) table->Lookup(...);
+template <typename T>
+class ResourceHandle {
+ public:
+  ResourceHandle(const ResourceContext* resource_context,
+                 string_view resource_name)
+      : resource_context_(resource_context), resource_name_(resource_name) {}
+
+  ResourceHandle(const ResourceHandle&) = delete;
+  ResourceHandle& operator=(const ResourceHandle&) = delete;
+
+  // Return the resource, or null if it is not created yet.
+  T* get() const {
+    if (T* resource = resource_.load(std::memory_order_acquire))
+      return resource;
+    std::optional<T*> resource =
+        resource_context_->GetResource<T>(resource_name_);
+    if (!resource.has_value() || *resource == nullptr) return nullptr;
+    resource_.store(*resource, std::memory_order_release);
+    return *resource;
+  }
+
+ private:
+  const ResourceContext* const resource_context_;
+  const std::string resource_name_;
+  mutable std::atomic<T*> resource_{nullptr};
+};
+
 }  // namespace tfrt
 #endif  // TFRT_HOST_CONTEXT_RESOURCE_CONTEXT_H_
@@ -0,0 +1,111 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Shared Memory Host Allocator
+//
+// This file declares SharedMemoryAllocator, a HostAllocator that serves
+// allocations out of a named shared memory segment, so that buffers allocated
+// in one process can be handed to another process on the same host by
+// descriptor instead of being serialized.
+
+#ifndef TFRT_HOST_CONTEXT_SHARED_MEMORY_ALLOCATOR_H_
+#define TFRT_HOST_CONTEXT_SHARED_MEMORY_ALLOCATOR_H_
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "llvm/Support/Error.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_buffer.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
+
+namespace tfrt {
+
+// Identifies a range of a shared memory segment. A descriptor is plain data
+// and can be sent to another process, e.g. next to the TensorMetadata of a
+// DenseHostTensor whose buffer is in the segment.
+struct SharedMemoryDescriptor {
+  std::string segment_name;
+  size_t offset = 0;
+  size_t size = 0;
+};
+
+// SharedMemoryAllocator maps a named POSIX shared memory segment and serves
+// allocations out of it with a first-fit free list. The process that creates
+// the segment allocates from it, e.g. by using the allocator as the allocator
+// of its HostContext so that kernels allocate their outputs in the segment.
+// Other processes open the segment by name and wrap descriptors of buffers in
+// it as HostBuffers without copying.
+//
+// The allocation state is private to the creating process. Buffers are owned
+// by the creator, which must keep a buffer alive until the processes it handed
+// the buffer to are done with it. The allocator must outlive the buffers
+// allocated from it or created with CreateHostBuffer().
+class SharedMemoryAllocator : public HostAllocator {
+ public:
+  // Create the segment `name`, which must start with '/' and must not exist,
+  // with room for `capacity` bytes of allocations. The segment is removed
+  // when the returned allocator is destroyed, but stays mapped in the
+  // processes that have opened it.
+  static Expected<std::unique_ptr<SharedMemoryAllocator>> Create(
+      string_view name, size_t capacity);
+
+  // Open the existing segment `name` created by another allocator, typically
+  // in another process. Allocating from an opened segment is not supported.
+  static Expected<std::unique_ptr<SharedMemoryAllocator>> Open(
+      string_view name);
+
+  ~SharedMemoryAllocator() override;
+
+  // Return nullptr if the segment is exhausted or was opened rather than
+  // created. Allocations are aligned to at least 64 bytes.
+  void* AllocateBytes(size_t size, size_t alignment) override;
+  void DeallocateBytes(void* ptr, size_t size) override;
+
+  const std::string& name() const { return name_; }
+
+  // Return the descriptor of `buffer`, or an error if the data of `buffer` is
+  // not in the segment.
+  Expected<SharedMemoryDescriptor> GetDescriptor(
+      const HostBuffer& buffer) const;
+
+  // Return a HostBuffer that references the range of the segment described by
+  // `descriptor`, or an error if `descriptor` is not of this segment.
+  Expected<RCReference<HostBuffer>> CreateHostBuffer(
+      const SharedMemoryDescriptor& descriptor);
+
+ private:
+  SharedMemoryAllocator(std::string name, char* base, size_t mapped_size,
+                        bool owns_segment);
+
+  const std::string name_;
+  // The mapping of the whole segment. Allocations start after a header.
+  char* const base_;
+  const size_t mapped_size_;
+  const bool owns_segment_;
+
+  mutex mu_;
+  // Free ranges of the segment as offset to size, with adjacent ranges
+  // coalesced.
+  std::map<size_t, size_t> free_ranges_ TFRT_GUARDED_BY(mu_);
+};
+
+}  // namespace tfrt
+
+#endif  // TFRT_HOST_CONTEXT_SHARED_MEMORY_ALLOCATOR_H_
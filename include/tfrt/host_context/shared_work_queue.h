@@ -0,0 +1,81 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Work queue shared by multiple HostContexts
+//
+// This file declares SharedWorkQueue, which lets the HostContexts of many
+// tenants, e.g. the CoreRuntimes of the models served by one process, run on
+// the threads of a single work queue instead of creating a thread pool each:
+//
+//   SharedWorkQueue shared(CreateMultiThreadedWorkQueue(16, 16));
+//   auto allocator = std::shared_ptr<HostAllocator>(CreateMallocAllocator());
+//   auto runtime = CoreRuntime::Create(
+//       diag_handler, CreateSharedAllocator(allocator),
+//       shared.CreateTenantWorkQueue("model_a", /*weight=*/2), device_name);
+//
+// The non-blocking tasks of the tenants are scheduled onto the shared work
+// queue in proportion to the weights of the tenants, so that a busy tenant
+// cannot starve the others.
+
+#ifndef TFRT_HOST_CONTEXT_SHARED_WORK_QUEUE_H_
+#define TFRT_HOST_CONTEXT_SHARED_WORK_QUEUE_H_
+
+#include <memory>
+
+#include "llvm/ADT/StringRef.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/support/forward_decls.h"
+
+namespace tfrt {
+
+class SharedWorkQueue {
+ public:
+  // `work_queue` must run its non-blocking tasks on its own threads, i.e. have
+  // a non-zero parallelism level. At most `max_in_flight` non-blocking tasks
+  // of all tenants are submitted to it at a time, and the rest wait in
+  // per-tenant queues. Zero uses the parallelism level of `work_queue`.
+  explicit SharedWorkQueue(std::unique_ptr<ConcurrentWorkQueue> work_queue,
+                           int max_in_flight = 0);
+  ~SharedWorkQueue();
+
+  SharedWorkQueue(const SharedWorkQueue&) = delete;
+  SharedWorkQueue& operator=(const SharedWorkQueue&) = delete;
+
+  // Returns a work queue for a new tenant, to be passed to its HostContext.
+  // When tenants compete for the threads, each gets a share of the
+  // non-blocking task slots that is proportional to its `weight`. Within a
+  // tenant, tasks of a higher TaskPriority are dispatched first.
+  //
+  // Blocking tasks, and Await() on the returned queue, go to the shared work
+  // queue directly. Quiesce() only waits for the tasks of the tenant. The
+  // returned queue keeps the shared work queue alive, so it may outlive this
+  // object.
+  std::unique_ptr<ConcurrentWorkQueue> CreateTenantWorkQueue(string_view name,
+                                                             int weight = 1);
+
+  // Returns the work queue shared by the tenants.
+  ConcurrentWorkQueue* work_queue() const;
+
+ private:
+  class Scheduler;
+  class TenantWorkQueue;
+
+  std::shared_ptr<Scheduler> scheduler_;
+};
+
+}  // namespace tfrt
+
+#endif  // TFRT_HOST_CONTEXT_SHARED_WORK_QUEUE_H_
@@ -72,6 +72,15 @@ class SyncKernelFrame {
   // Get all arguments.
   ArrayRef<uint32_t> GetArguments() const { return argument_indices_; }
 
+  // Returns true if this kernel is the last user of the argument at the given
+  // index. The register of the argument is cleared when the kernel returns, so
+  // the kernel may move the argument value instead of copying it, e.g. to let
+  // an op reuse the buffer of a tensor that nothing else reads.
+  bool IsLastUseOfArgAt(int index) const {
+    assert(index < GetNumArgs());
+    return !argument_last_uses_.empty() && argument_last_uses_[index];
+  }
+
   // Get the number of attributes.
   int GetNumAttributes() const { return attributes_.size(); }
 
@@ -141,6 +150,8 @@ class SyncKernelFrame {
 
   // These are indices into `registers_`.
   ArrayRef<uint32_t> argument_indices_;
+  // Empty if the caller does not know the last uses of the arguments.
+  ArrayRef<bool> argument_last_uses_;
   ArrayRef<const void*> attributes_;
   // These are indices into `registers_`.
   ArrayRef<uint32_t> result_indices_;
@@ -169,8 +180,12 @@ class SyncKernelFrameBuilder : public SyncKernelFrame {
                                   const ExecutionContext& exec_ctx)
       : SyncKernelFrame{registers, exec_ctx} {}
 
-  void SetArguments(ArrayRef<uint32_t> argument_indices) {
+  void SetArguments(ArrayRef<uint32_t> argument_indices,
+                    ArrayRef<bool> argument_last_uses = {}) {
+    assert(argument_last_uses.empty() ||
+           argument_last_uses.size() == argument_indices.size());
     argument_indices_ = argument_indices;
+    argument_last_uses_ = argument_last_uses;
   }
   void SetAttributes(ArrayRef<const void*> attributes) {
     attributes_ = attributes;
@@ -21,11 +21,139 @@
 #ifndef TFRT_HOST_CONTEXT_TASK_FUNCTION_H_
 #define TFRT_HOST_CONTEXT_TASK_FUNCTION_H_
 
-#include "llvm/ADT/FunctionExtras.h"
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 namespace tfrt {
 
-using TaskFunction = llvm::unique_function<void()>;
+// TaskFunction is a move-only `void()` callable, like
+// llvm::unique_function<void()>, with an inline buffer sized for the typical
+// closures of the executor and the work queues, so that scheduling a task does
+// not allocate. Callables that do not fit into the buffer, or that may throw
+// when moved, are allocated on the heap.
+class TaskFunction {
+ public:
+  // The size of the inline buffer, so that a TaskFunction is 64 bytes.
+  static constexpr size_t kInlineSize = 64 - sizeof(void*);
+
+  TaskFunction() = default;
+  TaskFunction(std::nullptr_t) {}  // NOLINT
+
+  template <typename F,
+            typename = std::enable_if_t<
+                !std::is_same<std::decay_t<F>, TaskFunction>::value &&
+                std::is_invocable_r<void, std::decay_t<F>&>::value>>
+  TaskFunction(F&& f) {  // NOLINT
+    using Callable = std::decay_t<F>;
+    if constexpr (IsInline<Callable>()) {
+      new (&storage_) Callable(std::forward<F>(f));
+      ops_ = &kInlineOps<Callable>;
+    } else {
+      *reinterpret_cast<Callable**>(&storage_) =
+          new Callable(std::forward<F>(f));
+      ops_ = &kHeapOps<Callable>;
+    }
+  }
+
+  TaskFunction(TaskFunction&& other) noexcept : ops_(other.ops_) {
+    if (ops_ != nullptr) {
+      ops_->relocate(&storage_, &other.storage_);
+      other.ops_ = nullptr;
+    }
+  }
+
+  TaskFunction& operator=(TaskFunction&& other) noexcept {
+    if (this != &other) {
+      Reset();
+      if (other.ops_ != nullptr) {
+        other.ops_->relocate(&storage_, &other.storage_);
+        ops_ = other.ops_;
+        other.ops_ = nullptr;
+      }
+    }
+    return *this;
+  }
+
+  TaskFunction& operator=(std::nullptr_t) {
+    Reset();
+    return *this;
+  }
+
+  TaskFunction(const TaskFunction&) = delete;
+  TaskFunction& operator=(const TaskFunction&) = delete;
+
+  ~TaskFunction() { Reset(); }
+
+  void operator()() {
+    assert(ops_ != nullptr && "calling an empty TaskFunction");
+    ops_->call(&storage_);
+  }
+
+  explicit operator bool() const { return ops_ != nullptr; }
+
+  // Returns true if the callable is stored in the inline buffer. Empty
+  // functions are inline.
+  bool IsInline() const { return ops_ == nullptr || ops_->is_inline; }
+
+ private:
+  struct Ops {
+    void (*call)(void* storage);
+    // Moves the callable from `src` to `dst`, and destroys it in `src`.
+    void (*relocate)(void* dst, void* src);
+    void (*destroy)(void* storage);
+    bool is_inline;
+  };
+
+  template <typename Callable>
+  static constexpr bool IsInline() {
+    return sizeof(Callable) <= kInlineSize &&
+           alignof(Callable) <= alignof(std::max_align_t) &&
+           std::is_nothrow_move_constructible<Callable>::value;
+  }
+
+  template <typename Callable>
+  static Callable* Inline(void* storage) {
+    return std::launder(reinterpret_cast<Callable*>(storage));
+  }
+
+  template <typename Callable>
+  static Callable* Heap(void* storage) {
+    return *reinterpret_cast<Callable**>(storage);
+  }
+
+  template <typename Callable>
+  static constexpr Ops kInlineOps = {
+      [](void* storage) { (*Inline<Callable>(storage))(); },
+      [](void* dst, void* src) {
+        Callable* callable = Inline<Callable>(src);
+        new (dst) Callable(std::move(*callable));
+        callable->~Callable();
+      },
+      [](void* storage) { Inline<Callable>(storage)->~Callable(); },
+      /*is_inline=*/true};
+
+  template <typename Callable>
+  static constexpr Ops kHeapOps = {
+      [](void* storage) { (*Heap<Callable>(storage))(); },
+      [](void* dst, void* src) {
+        *reinterpret_cast<Callable**>(dst) = Heap<Callable>(src);
+      },
+      [](void* storage) { delete Heap<Callable>(storage); },
+      /*is_inline=*/false};
+
+  void Reset() {
+    if (ops_ != nullptr) {
+      ops_->destroy(&storage_);
+      ops_ = nullptr;
+    }
+  }
+
+  alignas(std::max_align_t) unsigned char storage_[kInlineSize];
+  const Ops* ops_ = nullptr;
+};
 
 }  // namespace tfrt
 
@@ -16,15 +16,19 @@
 
 // Timer Queue
 //
-// This file declares TimerQueue, a priority queue to keep track of pending
-// timers. The queue is keyed by timer deadline (the sooner it expires, the
-// higher the priority). On timer expiration, it calls the associated callback.
+// This file declares TimerQueue, which keeps track of pending timers and calls
+// their callbacks when they expire. Timers are kept in hierarchical timing
+// wheels with millisecond ticks, so that scheduling and cancelling a timer take
+// constant time. The wheels are sharded by scheduling thread, each shard has
+// its own lock.
 
 #ifndef TFRT_HOST_CONTEXT_TIMER_QUEUE_H_
 #define TFRT_HOST_CONTEXT_TIMER_QUEUE_H_
 
+#include <atomic>
 #include <chrono>
-#include <queue>
+#include <cstdint>
+#include <memory>
 #include <thread>
 
 #include "llvm/ADT/FunctionExtras.h"
@@ -41,6 +45,7 @@ class TimerQueue {
       std::chrono::time_point<std::chrono::system_clock, TimeDuration>;
 
   class TimerEntry;
+  class TimerWheel;
 
  public:
   using TimerHandle = RCReference<TimerEntry>;
@@ -56,6 +61,8 @@ class TimerQueue {
   // Enqueue a timer. Deadline is `timeout` microseconds from now.
   TimerHandle ScheduleTimer(TimeDuration timeout, TimerCallback callback);
 
+  // Cancel a timer. A cancelled timer is removed from the queue immediately,
+  // its callback is destroyed once the last handle is gone.
   void CancelTimer(const TimerHandle& timer_handle);
 
  private:
@@ -71,34 +78,41 @@ class TimerQueue {
       return MakeRef<TimerEntry>(deadline, std::move(timer_callback));
     }
 
-    struct TimerEntryCompare {
-      bool operator()(const RCReference<TimerEntry>& a,
-                      const RCReference<TimerEntry>& b) const {
-        return a->deadline_ > b->deadline_;
-      }
-    };
-
    private:
     friend class TimerQueue;
+    friend class TimerWheel;
     TimePoint deadline_;
     TimerCallback timer_callback_;
     std::atomic<bool> cancelled_{false};
+
+    // The fields below are owned by the wheel of `shard_`, and guarded by its
+    // mutex.
+    int shard_ = 0;
+    // The tick at which the timer expires.
+    int64_t tick_ = 0;
+    // The wheel level and slot of the timer, as `level * kWheelSize + slot`.
+    int slot_ = 0;
+    bool linked_ = false;
+    TimerEntry* prev_ = nullptr;
+    TimerEntry* next_ = nullptr;
   };
+
+  static constexpr int kNumShards = 8;
+
   // Timer thread. If a timeout goes off, it calls the callback.
   void TimerThreadRun();
 
-  // Obtain the top timer (timer with the closest deadline) from the queue.
-  // Returns NULL if no active (not cancelled) timer found.
-  TimerEntry* getTopTimer();
-
   mutable mutex mu_;
   condition_variable cv_;
   std::thread timer_thread_;
-  std::atomic<bool> stop_{false};
-  std::priority_queue<RCReference<TimerEntry>,
-                      std::vector<RCReference<TimerEntry>>,
-                      TimerEntry::TimerEntryCompare>
-      timers_ TFRT_GUARDED_BY(mu_);
+  bool stop_ TFRT_GUARDED_BY(mu_) = false;
+  // Whether a timer was scheduled before `wakeup_tick_` since the timer thread
+  // last looked at the wheels.
+  bool pending_ TFRT_GUARDED_BY(mu_) = false;
+  // The tick at which the timer thread wakes up next. Timers expiring earlier
+  // must wake it up.
+  std::atomic<int64_t> wakeup_tick_;
+  std::unique_ptr<TimerWheel[]> wheels_;
 };
 
 }  // namespace tfrt
@@ -23,6 +23,7 @@
 #define TFRT_HOST_CONTEXT_VALUE_H_
 
 #include <cassert>
+#include <type_traits>
 
 #include "tfrt/support/type_traits.h"
 
@@ -187,6 +188,10 @@ class Value {
   template <typename T, typename... Args>
   void fill(Args&&... args);
 
+  // Move constructs the payload of `v`, which must be non-empty, into this
+  // empty Value.
+  void MoveConstructFrom(Value* v);
+
   // In place storage for the payload
   using InPlaceStorageT =
       std::aligned_storage_t<kInPlaceSize, kInPlaceAlignment>;
@@ -285,6 +290,8 @@ struct TypeTraits {
     move_construct = &TypeTraitFns::MoveConstruct;
     is_polymorphic = std::is_polymorphic<T>::value;
     is_pointer_payload = false;
+    is_trivial = Value::IsInPlace<T>() && std::is_trivially_copyable<T>() &&
+                 std::is_trivially_destructible<T>();
   }
 
   template <typename T>
@@ -294,12 +301,17 @@ struct TypeTraits {
     move_construct = &TypeTraitFns::MoveConstruct;
     is_polymorphic = std::is_polymorphic<T>::value;
     is_pointer_payload = true;
+    is_trivial = false;
   }
 
   ClearFn clear;
   MoveConstructFn move_construct;
   bool is_polymorphic;
   bool is_pointer_payload;
+  // True for payloads stored in place that are trivially copyable and
+  // destructible, e.g. scalars and chains. They are moved and cleared inline
+  // by Value, without calling `move_construct` and `clear`.
+  bool is_trivial;
 };
 
 template <typename T>
@@ -327,15 +339,27 @@ Value::Value(T* t, PointerPayload)
     : value_{t}, traits_{internal::GetTypeTraits<T>(PointerPayload{})} {}
 
 inline Value::Value(Value&& v) {
-  if (v.HasValue()) v.traits_->move_construct(this, &v);
+  if (v.HasValue()) MoveConstructFrom(&v);
 }
 
 inline Value& Value::operator=(Value&& v) {
   reset();
-  if (v.HasValue()) v.traits_->move_construct(this, &v);
+  if (v.HasValue()) MoveConstructFrom(&v);
   return *this;
 }
 
+inline void Value::MoveConstructFrom(Value* v) {
+  assert(!HasValue() && v->HasValue());
+  if (!v->traits_->is_trivial) {
+    v->traits_->move_construct(this, v);
+    return;
+  }
+  storage_ = v->storage_;
+  value_ = &storage_;
+  traits_ = v->traits_;
+  v->traits_ = nullptr;
+}
+
 inline Value::~Value() { reset(); }
 
 template <typename T>
@@ -388,6 +412,10 @@ void Value::fill(Args&&... args) {
 // Reset the Value object to empty.
 inline void Value::reset() {
   if (!traits_) return;
+  if (traits_->is_trivial) {
+    traits_ = nullptr;
+    return;
+  }
   traits_->clear(this);
 }
 
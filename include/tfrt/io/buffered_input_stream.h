@@ -21,24 +21,27 @@
 #define TFRT_IO_BUFFERED_INPUT_STREAM_H_
 
 #include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_buffer.h"
 #include "tfrt/io/input_stream.h"
+#include "tfrt/support/ref_count.h"
 
 namespace tfrt {
 namespace io {
 
 class BufferedInputStream : public InputStream {
  public:
+  // The alignment of the internal buffer. Chunks returned by ReadChunk() are
+  // sliced from it when possible.
+  static constexpr size_t kBufferAlignment = 64;
+
   explicit BufferedInputStream(std::unique_ptr<InputStream> input_stream,
                                size_t buffer_size, HostAllocator* allocator)
       : input_stream_(std::move(input_stream)),
         allocator_(allocator),
         buffer_size_(buffer_size) {
     assert(buffer_size_ > 0);
-    buffer_ = allocator_->Allocate<char>(buffer_size_);
-  }
-
-  ~BufferedInputStream() override {
-    allocator_->Deallocate(buffer_, buffer_size_);
+    buffer_ = HostBuffer::CreateUninitialized(buffer_size_, kBufferAlignment,
+                                              allocator_);
   }
 
   // This class is not copyable or movable.
@@ -47,21 +50,34 @@ class BufferedInputStream : public InputStream {
 
   llvm::Expected<size_t> Read(char* buf, size_t max_count) override;
 
+  // Reads the next `count` bytes of the stream, or fewer at EOF, and returns
+  // them as a HostBuffer whose data is aligned to `alignment`. If the bytes
+  // fit in the internal buffer, the result is a slice of it and no bytes are
+  // copied. The internal buffer is never overwritten while such a slice is
+  // alive; the stream switches to a new buffer instead.
+  llvm::Expected<RCReference<HostBuffer>> ReadChunk(size_t count,
+                                                    size_t alignment = 1);
+
   llvm::Expected<size_t> Tell() override;
 
  private:
+  size_t BufferedCount() const { return buffer_limit_ - buffer_pos_; }
+
+  // Moves the unread bytes to the front of the buffer, and fills the rest of
+  // it from the underlying stream.
+  llvm::Error FillBuffer();
+
   std::unique_ptr<InputStream> input_stream_;
   HostAllocator* allocator_;
-  // The pointer to the buffer.
-  char* buffer_ = nullptr;
+  // The buffer. It is shared with the chunks returned by ReadChunk().
+  RCReference<HostBuffer> buffer_;
   // The size of buffer in bytes that is allocated and can be written.
   size_t buffer_size_ = 0;
   // The position of the next byte in the buffer to be read.
   size_t buffer_pos_ = 0;
   // The range [0, buffer_limit_) of the buffer holds valid bytes that can be
-  // read. It is guaranteed that buffer_limit_ <= buffer_size_. It could contain
-  // error from the last read of the input_stream_.
-  llvm::Expected<size_t> buffer_limit_ = 0;
+  // read. It is guaranteed that buffer_limit_ <= buffer_size_.
+  size_t buffer_limit_ = 0;
   // Current position in this stream.
   size_t stream_pos_ = 0;
 };
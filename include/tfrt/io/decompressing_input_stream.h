@@ -0,0 +1,137 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares the DecompressingInputStream class, which decompresses
+// the bytes read from another input stream.
+
+#ifndef TFRT_IO_DECOMPRESSING_INPUT_STREAM_H_
+#define TFRT_IO_DECOMPRESSING_INPUT_STREAM_H_
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/host_buffer.h"
+#include "tfrt/io/input_stream.h"
+#include "tfrt/support/ref_count.h"
+
+// Avoid including zlib.h in the header.
+struct z_stream_s;
+
+namespace tfrt {
+
+class HostContext;
+
+namespace io {
+
+// DecompressingInputStream decompresses gzip and zlib data read from another
+// input stream, e.g. a FileInputStream. Concatenated gzip members are read as
+// one stream, as by gunzip.
+//
+// Streams made of BGZF frames (gzip members of at most 64 KiB of data that
+// store their compressed size in the header, as written by bgzip) are
+// decompressed in parallel: up to `num_frames_in_flight` frames ahead of the
+// consumer are decompressed concurrently on the work queue of `host`, into
+// output buffers that are reused once the consumer has read them. Other
+// streams are decompressed on the consumer thread.
+//
+// It can be wrapped into a BufferedInputStream to read BTF tensor records, or
+// passed to a SequentialRecordReader to read compressed record files.
+class DecompressingInputStream : public InputStream {
+ public:
+  struct Options {
+    size_t num_frames_in_flight = 16;
+    // The size of the reads from the underlying stream.
+    size_t input_buffer_size = 256 * 1024;
+  };
+
+  DecompressingInputStream(std::unique_ptr<InputStream> input,
+                           HostContext* host, Options options);
+  DecompressingInputStream(std::unique_ptr<InputStream> input,
+                           HostContext* host)
+      : DecompressingInputStream(std::move(input), host, Options()) {}
+
+  ~DecompressingInputStream() override;
+
+  // This class is not copyable or movable.
+  DecompressingInputStream(const DecompressingInputStream&) = delete;
+  DecompressingInputStream& operator=(const DecompressingInputStream&) =
+      delete;
+
+  // Blocks until the frames being decompressed are available, so it must not
+  // be called from a non-blocking work queue thread.
+  llvm::Expected<size_t> Read(char* buf, size_t max_count) override;
+
+  // Returns the position in the decompressed stream.
+  llvm::Expected<size_t> Tell() override;
+
+ private:
+  enum class Format { kUnknown, kFramed, kStream };
+
+  // A BGZF frame being decompressed.
+  struct Frame {
+    RCReference<HostBuffer> data;
+    AsyncValueRef<size_t> count;
+    // The number of bytes of this frame consumed so far.
+    size_t pos = 0;
+  };
+
+  // Buffers the next `count` bytes of the underlying stream, or fewer at EOF.
+  llvm::Error FillInput(size_t count);
+  size_t BufferedInputCount() const { return input_.size() - input_pos_; }
+
+  // Picks the format from the header of the stream.
+  llvm::Error DetectFormat();
+
+  // Starts decompressing frames until `num_frames_in_flight` are in flight,
+  // the underlying stream ends, or a member is not a BGZF frame.
+  void ScheduleFrames();
+  void ScheduleFrame(size_t frame_size);
+  void ScheduleError(llvm::Error error);
+
+  llvm::Expected<size_t> ReadFrames(char* buf, size_t max_count);
+  llvm::Expected<size_t> ReadStream(char* buf, size_t max_count);
+
+  std::unique_ptr<InputStream> input_stream_;
+  HostContext* host_;
+  const Options options_;
+  Format format_ = Format::kUnknown;
+
+  // The bytes read from the underlying stream, from `input_pos_` on not yet
+  // decompressed.
+  std::string input_;
+  size_t input_pos_ = 0;
+  bool input_done_ = false;
+
+  // The frames in flight, in stream order.
+  std::deque<Frame> frames_;
+  // Output buffers of consumed frames, for reuse.
+  std::vector<RCReference<HostBuffer>> free_buffers_;
+
+  // The inflater of the kStream format, and whether it is inside a member.
+  std::unique_ptr<z_stream_s> inflater_;
+  bool in_member_ = false;
+
+  // Current position in this stream.
+  size_t stream_pos_ = 0;
+};
+
+}  // namespace io
+}  // namespace tfrt
+
+#endif  // TFRT_IO_DECOMPRESSING_INPUT_STREAM_H_
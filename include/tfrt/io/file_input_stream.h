@@ -36,6 +36,13 @@ class FileInputStream : public InputStream {
 
   llvm::Expected<size_t> Read(char* buf, size_t max_count) override;
 
+  // Asynchronous version of Read(), see RandomAccessFile::ReadAsync(). The
+  // stream position advances when the read completes, so at most one read may
+  // be in flight and the stream must not be used until the result is
+  // available.
+  AsyncValueRef<size_t> ReadAsync(char* buf, size_t max_count,
+                                  HostContext* host);
+
   llvm::Expected<size_t> Tell() override;
 
  private:
@@ -20,11 +20,16 @@
 #define TFRT_IO_FILE_SYSTEM_H_
 
 #include "llvm/ADT/StringMap.h"
+#include "tfrt/host_context/async_value_ref.h"
 #include "tfrt/support/error_util.h"
+#include "tfrt/support/forward_decls.h"
 #include "tfrt/support/mutex.h"
 #include "tfrt/support/thread_annotations.h"
 
 namespace tfrt {
+
+class HostContext;
+
 namespace io {
 
 // The priority of a FileSystem instance is used by FileSystemRegistry::Register
@@ -51,6 +56,50 @@ class RandomAccessFile {
   // On error, llvm::Error is returned.
   virtual llvm::Expected<size_t> Read(char* buf, size_t max_count,
                                       size_t offset) const = 0;
+
+  // Asynchronous version of Read(). The returned value becomes available with
+  // the number of bytes read, or with an error, on a `host` work queue thread.
+  // This file and `buf` must stay valid until then.
+  //
+  // The default implementation calls Read() on a blocking work queue thread.
+  // File systems with an asynchronous I/O interface override it, so that
+  // outstanding reads do not hold threads.
+  virtual AsyncValueRef<size_t> ReadAsync(char* buf, size_t max_count,
+                                          size_t offset,
+                                          HostContext* host) const;
+};
+
+// An interface that declares operations to append bytes to a file.
+class WritableFile {
+ public:
+  explicit WritableFile() {}
+
+  virtual ~WritableFile() {}
+
+  // Appends the concatenation of `chunks` to the file. Implementations write
+  // the chunks with scatter-gather I/O where possible, so callers do not need
+  // to copy them into a single buffer first.
+  virtual llvm::Error Append(ArrayRef<string_view> chunks) = 0;
+
+  // Closes the file. Destroying the file also closes it, but drops errors.
+  virtual llvm::Error Close() = 0;
+};
+
+// An interface for a read-only region of memory backed by the contents of a
+// file, e.g. a memory mapping. The region stays valid until this object is
+// destroyed.
+class ReadOnlyMemoryRegion {
+ public:
+  explicit ReadOnlyMemoryRegion() {}
+
+  virtual ~ReadOnlyMemoryRegion() {}
+
+  // Returns a pointer to the beginning of the region. The pointer is aligned at
+  // least to the page size of the underlying mapping.
+  virtual const void* data() const = 0;
+
+  // Returns the size of the region in bytes.
+  virtual size_t length() const = 0;
 };
 
 // An interface that declares operations to manage files in a file system.
@@ -68,6 +117,30 @@ class FileSystem {
   virtual llvm::Error NewRandomAccessFile(
       const std::string& path, std::unique_ptr<RandomAccessFile>* file) = 0;
 
+  // Creates a writable file at the given `path`, replacing any existing file.
+  //
+  // On success, stores a pointer to the new file in `file` and returns
+  // llvm::Error::success(). Otherwise, stores NULL in `file` and returns the
+  // error. Read-only file systems return an error by default.
+  virtual llvm::Error NewWritableFile(const std::string& path,
+                                      std::unique_ptr<WritableFile>* file) {
+    file->reset();
+    return MakeStringError("writing is not supported for file ", path);
+  }
+
+  // Creates a read-only memory region holding the contents of the file at the
+  // given `path`, typically by memory mapping it. Pages of the region are
+  // shared with every other reader of the same file.
+  //
+  // On success, stores a pointer to the new region in `region` and returns
+  // llvm::Error::success(). Otherwise, stores NULL in `region` and returns the
+  // error. File systems that cannot map files return an error by default.
+  virtual llvm::Error NewReadOnlyMemoryRegion(
+      const std::string& path, std::unique_ptr<ReadOnlyMemoryRegion>* region) {
+    region->reset();
+    return MakeStringError("memory mapping is not supported for file ", path);
+  }
+
   // Returns the priority of this file system. The file system with the highest
   // priority will be used if multiple file systems have been registered for the
   // same scheme.
@@ -105,6 +178,11 @@ class FileSystemRegistry {
   // FileSystemRegistry::Register(...).
   FileSystem* Lookup(const std::string& scheme);
 
+  // Returns the file system registered for the scheme of `path`. Paths without
+  // an explicit "scheme://" prefix belong to the default file system, which is
+  // registered with an empty scheme.
+  FileSystem* LookupForPath(string_view path);
+
  private:
   mutex mu_;
   llvm::StringMap<std::unique_ptr<FileSystem>> file_systems_
@@ -0,0 +1,114 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file declares the PrefetchingInputStream class which reads ahead of the
+// consumer of a file.
+
+#ifndef TFRT_IO_PREFETCHING_INPUT_STREAM_H_
+#define TFRT_IO_PREFETCHING_INPUT_STREAM_H_
+
+#include <deque>
+#include <memory>
+
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/host_buffer.h"
+#include "tfrt/io/file_system.h"
+#include "tfrt/io/input_stream.h"
+#include "tfrt/support/ref_count.h"
+
+namespace tfrt {
+
+class HostContext;
+
+namespace io {
+
+// PrefetchingInputStream reads a file sequentially and keeps up to
+// `num_buffers` reads in flight ahead of the consumer, using
+// RandomAccessFile::ReadAsync(). The readahead size of each read starts at
+// `min_readahead` and doubles, up to `max_readahead`, every time the consumer
+// has to wait for a read, so streams consumed faster than the file system
+// delivers issue fewer and larger reads. It halves again after the consumer
+// found `num_buffers` consecutive reads complete, which bounds the memory held
+// by slow consumers.
+class PrefetchingInputStream : public InputStream {
+ public:
+  struct Options {
+    size_t num_buffers = 4;
+    size_t min_readahead = 256 * 1024;
+    size_t max_readahead = 16 * 1024 * 1024;
+  };
+
+  PrefetchingInputStream(std::unique_ptr<RandomAccessFile> file,
+                         HostContext* host, Options options);
+  PrefetchingInputStream(std::unique_ptr<RandomAccessFile> file,
+                         HostContext* host)
+      : PrefetchingInputStream(std::move(file), host, Options()) {}
+
+  // Waits for the reads in flight.
+  ~PrefetchingInputStream() override;
+
+  // This class is not copyable or movable.
+  PrefetchingInputStream(const PrefetchingInputStream&) = delete;
+  PrefetchingInputStream& operator=(const PrefetchingInputStream&) = delete;
+
+  // Blocks until the prefetched data is available, so it must not be called
+  // from a non-blocking work queue thread.
+  llvm::Expected<size_t> Read(char* buf, size_t max_count) override;
+
+  llvm::Expected<size_t> Tell() override;
+
+  // Returns the size of the next reads issued to the file.
+  size_t readahead() const { return readahead_; }
+
+ private:
+  // A read issued to the file.
+  struct Segment {
+    RCReference<HostBuffer> data;
+    AsyncValueRef<size_t> count;
+    // The number of bytes of this segment consumed so far.
+    size_t pos = 0;
+  };
+
+  // Issues reads until `num_buffers` reads are in flight, unless EOF or an
+  // error has been reached.
+  void Prefetch();
+
+  // Waits for all reads in flight and drops them.
+  void DropSegments();
+
+  std::unique_ptr<RandomAccessFile> file_;
+  HostContext* host_;
+  const Options options_;
+
+  // The reads in flight, in file order.
+  std::deque<Segment> segments_;
+  // The file offset of the next read to issue.
+  size_t prefetch_offset_ = 0;
+  // Set when the consumer reached EOF or an error. No further reads are issued
+  // after it.
+  bool prefetch_done_ = false;
+
+  size_t readahead_;
+  // The number of consecutive reads that were complete when the consumer
+  // needed them.
+  size_t ready_streak_ = 0;
+
+  // Current position in this stream.
+  size_t stream_pos_ = 0;
+};
+
+}  // namespace io
+}  // namespace tfrt
+
+#endif  // TFRT_IO_PREFETCHING_INPUT_STREAM_H_
@@ -0,0 +1,133 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// This file declares the RecordReader class, which reads files of
+// length-prefixed records.
+
+#ifndef TFRT_IO_RECORD_READER_H_
+#define TFRT_IO_RECORD_READER_H_
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "tfrt/io/file_system.h"
+#include "tfrt/io/input_stream.h"
+#include "tfrt/support/forward_decls.h"
+
+namespace tfrt {
+namespace io {
+
+// RecordReader reads files of records in the TFRecord format. Each record is
+// stored as
+//
+//   uint64_t length
+//   uint32_t masked crc32c of length
+//   char     data[length]
+//   uint32_t masked crc32c of data
+//
+// with the integers in little endian byte order. The records are read with
+// positional reads of the file, so the reader keeps no position and may be
+// used from several threads at once, e.g. to read parts of an index in
+// parallel.
+class RecordReader {
+ public:
+  static constexpr size_t kHeaderSize = sizeof(uint64_t) + sizeof(uint32_t);
+  static constexpr size_t kFooterSize = sizeof(uint32_t);
+
+  struct Options {
+    // Verifies the crc32c of the record data. The crc32c of the length is
+    // always verified, since a corrupted length misplaces all later records.
+    bool verify_checksums = true;
+  };
+
+  RecordReader(std::unique_ptr<RandomAccessFile> file, Options options)
+      : file_(std::move(file)), options_(options) {}
+  explicit RecordReader(std::unique_ptr<RandomAccessFile> file)
+      : RecordReader(std::move(file), Options()) {}
+
+  // This class is not copyable or movable.
+  RecordReader(const RecordReader&) = delete;
+  RecordReader& operator=(const RecordReader&) = delete;
+
+  // Reads the record at `*offset` into `record` and advances `*offset` to the
+  // next record. The data is read into `record` directly. Returns false at the
+  // end of the file.
+  llvm::Expected<bool> ReadRecord(uint64_t* offset, std::string* record) const;
+
+  // Reads up to `records.size()` consecutive records starting at `*offset`,
+  // e.g. into the strings of a StringHostTensor, and advances `*offset` past
+  // them. Returns the number of records read, which is smaller than
+  // `records.size()` only at the end of the file.
+  llvm::Expected<size_t> ReadRecords(
+      uint64_t* offset, MutableArrayRef<std::string> records) const;
+
+  // Reads the records at `offsets`, e.g. offsets from an index, into
+  // `records`, which must have the same size.
+  llvm::Error ReadRecordsAt(ArrayRef<uint64_t> offsets,
+                            MutableArrayRef<std::string> records) const;
+
+  // Returns the offsets of all records in the file for random access. Only the
+  // record headers are read.
+  llvm::Expected<std::vector<uint64_t>> BuildIndex() const;
+
+ private:
+  // Reads the header at `offset` and returns the length of the record, or
+  // std::nullopt at the end of the file.
+  llvm::Expected<std::optional<uint64_t>> ReadLength(uint64_t offset) const;
+
+  std::unique_ptr<RandomAccessFile> file_;
+  const Options options_;
+};
+
+// SequentialRecordReader reads the records of a stream in order, e.g. of a
+// DecompressingInputStream over a compressed record file, which does not
+// support positional reads.
+class SequentialRecordReader {
+ public:
+  using Options = RecordReader::Options;
+
+  SequentialRecordReader(std::unique_ptr<InputStream> stream, Options options)
+      : stream_(std::move(stream)), options_(options) {}
+  explicit SequentialRecordReader(std::unique_ptr<InputStream> stream)
+      : SequentialRecordReader(std::move(stream), Options()) {}
+
+  // This class is not copyable or movable.
+  SequentialRecordReader(const SequentialRecordReader&) = delete;
+  SequentialRecordReader& operator=(const SequentialRecordReader&) = delete;
+
+  // Reads the next record into `record`. Returns false at the end of the
+  // stream.
+  llvm::Expected<bool> ReadRecord(std::string* record);
+
+  // Reads up to `records.size()` records. Returns the number of records read,
+  // which is smaller than `records.size()` only at the end of the stream.
+  llvm::Expected<size_t> ReadRecords(MutableArrayRef<std::string> records);
+
+ private:
+  std::unique_ptr<InputStream> stream_;
+  const Options options_;
+  // The offset of the next record in the stream, for error messages.
+  uint64_t offset_ = 0;
+};
+
+}  // namespace io
+}  // namespace tfrt
+
+#endif  // TFRT_IO_RECORD_READER_H_
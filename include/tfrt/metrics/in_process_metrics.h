@@ -0,0 +1,211 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares an in-process MetricsRegistry with sharded metrics.
+//
+// Counters and histograms keep one copy of their state per thread, up to
+// GetNumMetricShards() threads at a time, so recording is a load and a store
+// on a cache line that no other thread writes. Threads beyond that share one
+// more shard, which they update with atomic read-modify-writes. The shards are
+// merged when the metrics are read.
+//
+// Sample usage:
+//   auto* registry = new metrics::InProcessMetricsRegistry;
+//   metrics::RegisterMetricsRegistry(registry);
+//   ...
+//   registry->WritePrometheusText(llvm::outs());
+
+#ifndef TFRT_METRICS_IN_PROCESS_METRICS_H_
+#define TFRT_METRICS_IN_PROCESS_METRICS_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Compiler.h"
+#include "tfrt/metrics/metrics_registry.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
+
+namespace tfrt {
+namespace metrics {
+
+namespace internal {
+unsigned AcquireThreadShard();
+
+// Returns the shard of the calling thread. No two running threads have the
+// same shard, and shards of exited threads are reused, smallest first.
+inline unsigned GetThreadShard() {
+  // Zero until assigned. A constant initializer keeps the access free of the
+  // guard of dynamically initialized thread locals.
+  static thread_local unsigned shard_plus_one = 0;
+  if (LLVM_UNLIKELY(shard_plus_one == 0))
+    shard_plus_one = AcquireThreadShard() + 1;
+  return shard_plus_one - 1;
+}
+}  // namespace internal
+
+// The number of threads that have a shard of their own in each metric: twice
+// the number of hardware threads, and at most 128.
+unsigned GetNumMetricShards();
+
+class ShardedCounter : public Counter {
+ public:
+  ShardedCounter();
+
+  void IncrementBy(int64_t value) override {
+    const unsigned shard = internal::GetThreadShard();
+    if (LLVM_LIKELY(shard < num_shards_)) {
+      std::atomic<int64_t>& own = shards_[shard].value;
+      own.store(own.load(std::memory_order_relaxed) + value,
+                std::memory_order_relaxed);
+    } else {
+      shards_[num_shards_].value.fetch_add(value, std::memory_order_relaxed);
+    }
+  }
+
+  int64_t value() const;
+
+ private:
+  struct alignas(64) Shard {
+    std::atomic<int64_t> value{0};
+  };
+
+  const unsigned num_shards_;
+  // The shards of the threads, followed by the shared shard.
+  const std::unique_ptr<Shard[]> shards_;
+};
+
+struct HistogramSnapshot {
+  // The bounds of the histogram buckets, see Buckets::Explicit().
+  std::vector<double> bounds;
+  // The number of values per bucket, including the underflow bucket first and
+  // the overflow bucket last.
+  std::vector<uint64_t> counts;
+  uint64_t count = 0;
+  double sum = 0;
+};
+
+class ShardedHistogram : public Histogram {
+ public:
+  explicit ShardedHistogram(const Buckets& buckets);
+
+  void Record(double value) override {
+    const size_t bucket =
+        std::upper_bound(bounds_.begin(), bounds_.end(), value) -
+        bounds_.begin();
+    const unsigned shard = internal::GetThreadShard();
+    if (LLVM_LIKELY(shard < num_shards_)) {
+      std::atomic<uint64_t>* own = &slots_[shard * stride_];
+      std::atomic<uint64_t>& count = own[kFirstBucketSlot + bucket];
+      count.store(count.load(std::memory_order_relaxed) + 1,
+                  std::memory_order_relaxed);
+      std::atomic<uint64_t>& sum = own[kSumSlot];
+      sum.store(ToBits(FromBits(sum.load(std::memory_order_relaxed)) + value),
+                std::memory_order_relaxed);
+      return;
+    }
+    std::atomic<uint64_t>* shared = &slots_[num_shards_ * stride_];
+    shared[kFirstBucketSlot + bucket].fetch_add(1, std::memory_order_relaxed);
+    // The sum is kept as the bits of a double.
+    std::atomic<uint64_t>& sum = shared[kSumSlot];
+    uint64_t old_bits = sum.load(std::memory_order_relaxed);
+    while (!sum.compare_exchange_weak(old_bits,
+                                      ToBits(FromBits(old_bits) + value),
+                                      std::memory_order_relaxed)) {
+    }
+  }
+
+  HistogramSnapshot snapshot() const;
+
+ private:
+  static constexpr size_t kSumSlot = 0;
+  static constexpr size_t kFirstBucketSlot = 1;
+
+  static uint64_t ToBits(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+  }
+  static double FromBits(uint64_t bits) {
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  const std::vector<double> bounds_;
+  const unsigned num_shards_;
+  // The number of slots per shard, padded to whole cache lines.
+  const size_t stride_;
+  // The slots of the shards of the threads, followed by the shared shard.
+  const std::unique_ptr<std::atomic<uint64_t>[]> slots_;
+};
+
+class StringGauge : public Gauge<std::string> {
+ public:
+  void Set(std::string value) override;
+
+  std::string value() const;
+
+ private:
+  mutable mutex mu_;
+  std::string value_ TFRT_GUARDED_BY(mu_);
+};
+
+// The values of all metrics of a registry at one point in time, sorted by
+// name.
+struct MetricsSnapshot {
+  std::map<std::string, int64_t> counters;
+  std::map<std::string, std::string> string_gauges;
+  std::map<std::string, HistogramSnapshot> histograms;
+};
+
+// A MetricsRegistry that owns its metrics. Creating a metric with the name of
+// an existing metric of the same kind returns the existing metric.
+class InProcessMetricsRegistry : public MetricsRegistry {
+ public:
+  Gauge<std::string>* NewStringGauge(std::string name) override;
+  Histogram* NewHistogram(std::string name, const Buckets& buckets) override;
+  Counter* NewCounter(std::string name) override;
+
+  MetricsSnapshot Snapshot() const;
+
+  // Writes the metrics in the Prometheus text exposition format. Metric names
+  // are converted to valid Prometheus names by dropping the leading '/' and
+  // replacing other invalid characters with '_'. String gauges are written as
+  // a gauge with value 1 and the string in the "value" label.
+  void WritePrometheusText(raw_ostream& os) const;
+
+ private:
+  mutable mutex mu_;
+  llvm::StringMap<std::unique_ptr<ShardedCounter>> counters_
+      TFRT_GUARDED_BY(mu_);
+  llvm::StringMap<std::unique_ptr<StringGauge>> string_gauges_
+      TFRT_GUARDED_BY(mu_);
+  llvm::StringMap<std::unique_ptr<ShardedHistogram>> histograms_
+      TFRT_GUARDED_BY(mu_);
+};
+
+}  // namespace metrics
+}  // namespace tfrt
+
+#endif  // TFRT_METRICS_IN_PROCESS_METRICS_H_
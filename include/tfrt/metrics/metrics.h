@@ -21,6 +21,7 @@
 
 #include <string>
 
+#include "counter.h"
 #include "gauge.h"
 #include "histogram.h"
 
@@ -37,6 +38,12 @@ Gauge<T>* NewGauge(std::string name);
 template <>
 Gauge<std::string>* NewGauge(std::string name);
 
+//===----------------------------------------------------------------------===//
+// Methods to create Counter metrics
+//===----------------------------------------------------------------------===//
+
+Counter* NewCounter(std::string name);
+
 //===----------------------------------------------------------------------===//
 // Methods to create Histogram metrics
 //===----------------------------------------------------------------------===//
@@ -21,6 +21,7 @@
 
 #include <string>
 
+#include "counter.h"
 #include "gauge.h"
 #include "histogram.h"
 
@@ -34,6 +35,10 @@ class MetricsRegistry {
   virtual Gauge<std::string>* NewStringGauge(std::string name) = 0;
 
   virtual Histogram* NewHistogram(std::string name, const Buckets& buckets) = 0;
+
+  // Registries that do not support counters return nullptr, in which case the
+  // counter is a no-op.
+  virtual Counter* NewCounter(std::string name) { return nullptr; }
 };
 
 namespace internal {
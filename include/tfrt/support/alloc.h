@@ -28,6 +28,11 @@ namespace tfrt {
 // are hard to debug.
 void* AlignedAlloc(size_t alignment, size_t size);
 
+// Same as AlignedAlloc(), but the returned memory is zeroed. Where possible the
+// memory comes from calloc(), which need not touch the fresh pages it maps, as
+// the operating system zeroes them on first access.
+void* AlignedZeroedAlloc(size_t alignment, size_t size);
+
 void AlignedFree(void* ptr);
 
 }  // namespace tfrt
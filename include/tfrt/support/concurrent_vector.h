@@ -14,16 +14,163 @@
  * limitations under the License.
  */
 
-// A concurent sequential container optimized for read access.
+// Concurent sequential containers optimized for read access.
 
 #ifndef TFRT_SUPPORT_CONCURRENT_VECTOR_H_
 #define TFRT_SUPPORT_CONCURRENT_VECTOR_H_
 
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <utility>
+
+#include "llvm/Support/MathExtras.h"
 #include "tfrt/concurrency/concurrent_vector.h"
 
 namespace tfrt {
 
 using ::tsl::internal::ConcurrentVector;  // NOLINT
 
+// A concurrent sequential container with lock-free appends and reads. Unlike
+// ConcurrentVector, which serializes `emplace_back` with a mutex, writers
+// reserve an index with an atomic increment and construct the element in
+// place, so concurrent appends don't contend on a lock.
+//
+// Elements are stored in chunks that double in size and are never moved or
+// freed until the container is destroyed, so readers don't need any
+// reclamation scheme, and element addresses are stable. Chunks are allocated
+// on first use by the writer that reserves an index in them; racing writers
+// resolve the allocation with a CAS.
+//
+// `size()` is the length of the longest prefix of constructed elements. A
+// writer that finishes out of order leaves its element unpublished until all
+// the elements before it are constructed; any thread that observes the prefix
+// grow helps to advance it, so no thread waits for another.
+template <typename T>
+class LockFreeConcurrentVector {
+ public:
+  explicit LockFreeConcurrentVector(size_t initial_capacity)
+      : first_chunk_log2_(llvm::Log2_64_Ceil(initial_capacity ? initial_capacity
+                                                              : 1)) {
+    assert(first_chunk_log2_ < kMaxChunks);
+    for (auto& chunk : chunks_) chunk.store(nullptr, std::memory_order_relaxed);
+  }
+
+  ~LockFreeConcurrentVector() {
+    const size_t size = reserved_.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < size; ++i) {
+      Slot* slot = FindSlot(i);
+      assert(slot && slot->ready.load(std::memory_order_relaxed));
+      slot->get()->~T();
+    }
+    for (auto& chunk : chunks_) delete[] chunk.load(std::memory_order_relaxed);
+  }
+
+  LockFreeConcurrentVector(const LockFreeConcurrentVector&) = delete;
+  LockFreeConcurrentVector& operator=(const LockFreeConcurrentVector&) = delete;
+
+  // Returns the element at `index`, which must be constructed: either below
+  // `size()`, or returned by an `emplace_back` that happened before. The
+  // latter may be above `size()` while an earlier element is being
+  // constructed.
+  T& operator[](size_t index) { return *ReadySlot(index)->get(); }
+
+  const T& operator[](size_t index) const {
+    return *ReadySlot(index)->get();
+  }
+
+  // Returns the number of elements that are visible to readers.
+  size_t size() const {
+    size_t size = size_.load(std::memory_order_acquire);
+    while (size < reserved_.load(std::memory_order_acquire)) {
+      Slot* slot = FindSlot(size);
+      if (!slot || !slot->ready.load(std::memory_order_acquire)) break;
+      // On failure `size` is reloaded and we retry from the published size.
+      if (size_.compare_exchange_weak(size, size + 1,
+                                      std::memory_order_acq_rel,
+                                      std::memory_order_acquire))
+        ++size;
+    }
+    return size;
+  }
+
+  // Constructs a new element from `args` and returns its index. The element is
+  // visible to readers once all the elements before it are constructed.
+  template <typename... Args>
+  size_t emplace_back(Args&&... args) {
+    const size_t index = reserved_.fetch_add(1, std::memory_order_acq_rel);
+    Slot* slot = GetOrAllocateSlot(index);
+    new (slot->storage) T(std::forward<Args>(args)...);
+    slot->ready.store(true, std::memory_order_release);
+    // Publish this element if all the elements before it are already ready.
+    size();
+    return index;
+  }
+
+ private:
+  static constexpr size_t kMaxChunks = 64;
+
+  struct Slot {
+    T* get() { return std::launder(reinterpret_cast<T*>(storage)); }
+
+    std::atomic<bool> ready{false};
+    alignas(T) unsigned char storage[sizeof(T)];
+  };
+
+  // Chunk `c` holds `1 << (first_chunk_log2_ + c)` elements starting at index
+  // `(1 << (first_chunk_log2_ + c)) - (1 << first_chunk_log2_)`.
+  size_t ChunkIndex(size_t index) const {
+    return llvm::Log2_64(index + (size_t{1} << first_chunk_log2_)) -
+           first_chunk_log2_;
+  }
+
+  size_t ChunkSize(size_t chunk) const {
+    return size_t{1} << (first_chunk_log2_ + chunk);
+  }
+
+  size_t ChunkOffset(size_t index, size_t chunk) const {
+    return index + (size_t{1} << first_chunk_log2_) - ChunkSize(chunk);
+  }
+
+  // Returns the slot of `index`, or nullptr if its chunk is not allocated yet.
+  Slot* FindSlot(size_t index) const {
+    const size_t chunk = ChunkIndex(index);
+    Slot* slots = chunks_[chunk].load(std::memory_order_acquire);
+    return slots ? &slots[ChunkOffset(index, chunk)] : nullptr;
+  }
+
+  Slot* ReadySlot(size_t index) const {
+    Slot* slot = FindSlot(index);
+    assert(slot && slot->ready.load(std::memory_order_acquire));
+    return slot;
+  }
+
+  Slot* GetOrAllocateSlot(size_t index) {
+    const size_t chunk = ChunkIndex(index);
+    assert(chunk < kMaxChunks);
+    Slot* slots = chunks_[chunk].load(std::memory_order_acquire);
+    if (!slots) {
+      Slot* allocated = new Slot[ChunkSize(chunk)];
+      if (chunks_[chunk].compare_exchange_strong(slots, allocated,
+                                                 std::memory_order_acq_rel,
+                                                 std::memory_order_acquire)) {
+        slots = allocated;
+      } else {
+        // Another writer allocated the chunk first.
+        delete[] allocated;
+      }
+    }
+    return &slots[ChunkOffset(index, chunk)];
+  }
+
+  const size_t first_chunk_log2_;
+  std::atomic<Slot*> chunks_[kMaxChunks];
+  // The number of reserved indices.
+  std::atomic<size_t> reserved_{0};
+  // The number of published elements.
+  mutable std::atomic<size_t> size_{0};
+};
+
 }  // namespace tfrt
 #endif  // TFRT_SUPPORT_CONCURRENT_VECTOR_H_
@@ -40,6 +40,15 @@ inline uint64_t Hash64(const string_view& str) {
   return Hash64(str.data(), str.size());
 }
 
+// Returns a 64-bit hash of a 64-bit integer with the SplitMix64 mixer, which
+// mixes all bits of `value` without a loop over its bytes.
+inline uint64_t HashInt64(uint64_t value) {
+  value += 0x9e3779b97f4a7c15ULL;
+  value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+  return value ^ (value >> 31);
+}
+
 inline uint64_t Hash64Combine(uint64_t a, uint64_t b) {
   return a ^ (b + 0x9e3779b97f4a7800ULL + (a << 10) + (a >> 4));
 }
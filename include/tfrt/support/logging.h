@@ -19,6 +19,10 @@
 #ifndef TFRT_SUPPORT_LOGGING_H_
 #define TFRT_SUPPORT_LOGGING_H_
 
+#include <chrono>
+#include <cstddef>
+
+#include "llvm/ADT/SmallString.h"
 #include "llvm/Support/raw_ostream.h"
 
 // There are four severity levels: INFO, WARNING, ERROR, FATAL.
@@ -38,6 +42,34 @@ enum class Severity : int8_t {
   FATAL = 3,
 };
 
+// Options of the asynchronous logging backend.
+struct AsyncLoggingOptions {
+  // The maximum number of lines logged per second from one call site. Lines
+  // above the limit are suppressed, except for FATAL ones. Zero disables the
+  // limit.
+  int max_lines_per_second_per_site = 100;
+  // The maximum number of bytes of log lines buffered by one thread. Lines
+  // that do not fit are dropped until the buffer is flushed.
+  size_t max_buffered_bytes_per_thread = 1 << 20;
+  // How often the background thread writes the buffered lines to stderr.
+  std::chrono::milliseconds flush_interval{10};
+};
+
+// Switches TFRT_LOG to the asynchronous backend, for processes that may log
+// at high rates from many threads, e.g. errors of kernels. Lines are appended
+// to a buffer of the logging thread and written to stderr by a background
+// thread, so that logging threads do not serialize on stderr. The lines of one
+// thread stay in order, but the lines of different threads may be reordered.
+// The numbers of suppressed and dropped lines are logged when they occur.
+//
+// By default, lines are written to stderr synchronously. Only the options of
+// the first call take effect.
+void EnableAsyncLogging(const AsyncLoggingOptions& options = {});
+
+// Writes the lines buffered by the asynchronous backend to stderr. This is
+// done before FATAL aborts and at exit.
+void FlushLogs();
+
 namespace internal {
 class LogStream : public llvm::raw_ostream {
  public:
@@ -48,8 +80,11 @@ class LogStream : public llvm::raw_ostream {
   void write_impl(const char* Ptr, size_t Size) override;
   uint64_t current_pos() const override;
 
-  uint64_t pos_;
+  // The call site, which lines are rate limited by.
+  const char* fname_;
+  int line_;
   Severity severity_;
+  llvm::SmallString<256> buffer_;
 };
 
 // LogStreamFatal marks the destructor as noreturn to allow code paths with
@@ -26,6 +26,8 @@
 #include <stdlib.h>
 
 #include <array>
+#include <cstddef>
+#include <cstdint>
 
 #include "tfrt/support/forward_decls.h"
 
@@ -61,7 +63,41 @@ class PhiloxRandom {
     return cached_results_[next_result_index_++];
   }
 
+  // Skips the next `count` 128-bit samples of the stream, i.e. the next
+  // 4 * `count` results. The remaining results of the current sample are
+  // discarded. Copies of a generator that skip to disjoint ranges of samples
+  // produce the same results in parallel as the generator does sequentially.
+  void Skip(uint64_t count) {
+    const uint64_t counter_lo =
+        (static_cast<uint64_t>(counter_[1]) << 32) | counter_[0];
+    const uint64_t next_counter_lo = counter_lo + count;
+    counter_[0] = static_cast<uint32_t>(next_counter_lo);
+    counter_[1] = static_cast<uint32_t>(next_counter_lo >> 32);
+    if (next_counter_lo < counter_lo && ++counter_[2] == 0) ++counter_[3];
+
+    next_result_index_ = kCounterSize;
+  }
+
+  // Writes the next `size` results to `results`, same as `size` calls of
+  // operator().
+  void Fill(uint32_t* results, size_t size) {
+    for (; size > 0 && next_result_index_ != kCounterSize; --size)
+      *results++ = cached_results_[next_result_index_++];
+
+    constexpr size_t kBatchSize = kNumLanes * kCounterSize;
+    for (; size >= kBatchSize; size -= kBatchSize, results += kBatchSize)
+      ComputeRandomBitsBatch(results);
+
+    for (; size > 0; --size) *results++ = (*this)();
+  }
+
  private:
+  // The number of samples that ComputeRandomBitsBatch() computes at once.
+  // The rounds are computed for all of them in lockstep, with the counter
+  // words of the samples in separate arrays, so that compilers vectorize the
+  // 32x32->64 bit multiplications across the samples.
+  static constexpr int kNumLanes = 8;
+
   // Uses the same constants as recommended by the original paper.
   static constexpr uint32_t kPhiloxW32A = 0x9E3779B9;
   static constexpr uint32_t kPhiloxW32B = 0xBB67AE85;
@@ -100,6 +136,42 @@ class PhiloxRandom {
     return counter;
   }
 
+  // Computes the next kNumLanes samples into `results`, in stream order.
+  void ComputeRandomBitsBatch(uint32_t* results) {
+    uint32_t c0[kNumLanes], c1[kNumLanes], c2[kNumLanes], c3[kNumLanes];
+    for (int i = 0; i < kNumLanes; ++i) {
+      c0[i] = counter_[0];
+      c1[i] = counter_[1];
+      c2[i] = counter_[2];
+      c3[i] = counter_[3];
+      SkipOne();
+    }
+
+    KeyType key = key_;
+    for (int round = 0; round < 10; ++round) {
+      for (int i = 0; i < kNumLanes; ++i) {
+        const uint64_t product0 = static_cast<uint64_t>(kPhiloxM4x32A) * c0[i];
+        const uint64_t product1 = static_cast<uint64_t>(kPhiloxM4x32B) * c2[i];
+        const uint32_t next0 =
+            static_cast<uint32_t>(product1 >> 32) ^ c1[i] ^ key[0];
+        const uint32_t next2 =
+            static_cast<uint32_t>(product0 >> 32) ^ c3[i] ^ key[1];
+        c0[i] = next0;
+        c1[i] = static_cast<uint32_t>(product1);
+        c2[i] = next2;
+        c3[i] = static_cast<uint32_t>(product0);
+      }
+      RaiseKey(&key);
+    }
+
+    for (int i = 0; i < kNumLanes; ++i) {
+      results[kCounterSize * i + 0] = c0[i];
+      results[kCounterSize * i + 1] = c1[i];
+      results[kCounterSize * i + 2] = c2[i];
+      results[kCounterSize * i + 3] = c3[i];
+    }
+  }
+
   // Helper function to skip the next sample of 128-bits in the current stream.
   void SkipOne() {
     if (++counter_[0] == 0) {
@@ -0,0 +1,118 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Immutable snapshots read without locking and reclaimed after replacement.
+
+#ifndef TFRT_SUPPORT_PUBLISHED_SNAPSHOT_H_
+#define TFRT_SUPPORT_PUBLISHED_SNAPSHOT_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <utility>
+
+namespace tfrt {
+
+// PublishedSnapshot holds an immutable T, e.g. an index of a container, that
+// readers access without locking while a writer replaces it with a new one.
+//
+// A replaced snapshot is deleted as soon as no reader can use it, as in
+// read-copy-update. Every read is counted in one of two reader counts, chosen
+// by the parity of an epoch. To replace a snapshot, the writer publishes the
+// new one, and then twice flips the epoch and waits for the count of the
+// previous parity to drain. New reads go to the other count while the writer
+// waits, so it only waits for the reads that were in progress, and the reads
+// that started before the snapshot was replaced are done when it returns.
+// Reads never wait.
+//
+// The reader counts are sharded by thread so that concurrent readers do not
+// contend on one cache line. Writers must be serialized by the caller, and a
+// reader must not publish a snapshot from within a read.
+template <typename T>
+class PublishedSnapshot {
+ public:
+  PublishedSnapshot() = default;
+  ~PublishedSnapshot() { delete snapshot_.load(std::memory_order_relaxed); }
+
+  PublishedSnapshot(const PublishedSnapshot&) = delete;
+  PublishedSnapshot& operator=(const PublishedSnapshot&) = delete;
+
+  // Calls `fn` with the current snapshot, or nullptr if none has been
+  // published, and returns its result. The snapshot must not be used after
+  // `fn` returns. Thread-safe and lock-free.
+  template <typename Fn>
+  decltype(auto) Read(Fn&& fn) const {
+    ReadScope scope(this);
+    return std::forward<Fn>(fn)(snapshot_.load(std::memory_order_seq_cst));
+  }
+
+  // Replaces the snapshot by `snapshot`, and deletes the replaced snapshot
+  // once the reads that may use it are done. Must be serialized with the other
+  // calls to Publish().
+  void Publish(std::unique_ptr<const T> snapshot) {
+    std::unique_ptr<const T> replaced(
+        snapshot_.exchange(snapshot.release(), std::memory_order_seq_cst));
+    if (replaced) WaitForReaders();
+  }
+
+ private:
+  static constexpr size_t kNumShards = 8;
+
+  struct alignas(64) Shard {
+    std::atomic<int64_t> count{0};
+  };
+
+  class ReadScope {
+   public:
+    explicit ReadScope(const PublishedSnapshot* owner) {
+      const uint64_t epoch = owner->epoch_.load(std::memory_order_seq_cst);
+      count_ = &owner->counts_[epoch & 1][ThreadShard()].count;
+      count_->fetch_add(1, std::memory_order_seq_cst);
+    }
+    ~ReadScope() { count_->fetch_sub(1, std::memory_order_release); }
+
+   private:
+    std::atomic<int64_t>* count_;
+  };
+
+  static size_t ThreadShard() {
+    static std::atomic<size_t> next_shard{0};
+    static thread_local const size_t shard =
+        next_shard.fetch_add(1, std::memory_order_relaxed) % kNumShards;
+    return shard;
+  }
+
+  void WaitForReaders() {
+    for (int i = 0; i < 2; ++i) {
+      const uint64_t parity =
+          epoch_.fetch_add(1, std::memory_order_seq_cst) & 1;
+      for (const Shard& shard : counts_[parity]) {
+        while (shard.count.load(std::memory_order_seq_cst) != 0)
+          std::this_thread::yield();
+      }
+    }
+  }
+
+  std::atomic<const T*> snapshot_{nullptr};
+  std::atomic<uint64_t> epoch_{0};
+  mutable Shard counts_[2][kNumShards];
+};
+
+}  // namespace tfrt
+
+#endif  // TFRT_SUPPORT_PUBLISHED_SNAPSHOT_H_
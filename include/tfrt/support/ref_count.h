@@ -19,6 +19,11 @@
 #ifndef TFRT_SUPPORT_REF_COUNT_H_
 #define TFRT_SUPPORT_REF_COUNT_H_
 
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <thread>
+
 #include "tfrt/concurrency/ref_count.h"
 
 namespace tfrt {
@@ -37,6 +42,107 @@ using ::tsl::ReferenceCounted;  // NOLINT
 using ::tsl::swap;              // NOLINT
 using ::tsl::TakeRef;           // NOLINT
 
+// ThreadConfinedReferenceCounted is a drop-in alternative to ReferenceCounted
+// for values that are usually created, used and destroyed on one thread, like
+// the temporaries of a sync function or of an inline chain of kernels.
+//
+// The reference count starts out confined to the constructing thread, and is
+// updated with plain loads and stores instead of atomic read-modify-write
+// operations. Before a reference escapes to another thread, e.g. when it is
+// captured by a task that is enqueued to the work queue or by a waiter that
+// may run on another thread, the owning thread must call Share(). From then
+// on the reference count is updated atomically, as in ReferenceCounted. The
+// hand-off of the reference to the other thread must synchronize with the
+// call to Share(), which the work queue and async values do.
+template <typename SubClass>
+class ThreadConfinedReferenceCounted {
+ public:
+  ThreadConfinedReferenceCounted() : ThreadConfinedReferenceCounted(1) {}
+  explicit ThreadConfinedReferenceCounted(unsigned ref_count)
+      : ref_count_(ref_count) {
+    AddNumReferenceCountedObjects();
+  }
+
+  ~ThreadConfinedReferenceCounted() {
+    assert(ref_count_.load() == 0 &&
+           "Shouldn't destroy a reference counted object with references!");
+    DropNumReferenceCountedObjects();
+  }
+
+  // Not copyable or movable.
+  ThreadConfinedReferenceCounted(const ThreadConfinedReferenceCounted&) =
+      delete;
+  ThreadConfinedReferenceCounted& operator=(
+      const ThreadConfinedReferenceCounted&) = delete;
+
+  // Add a new reference to this object.
+  void AddRef() {
+    assert(ref_count_.load(std::memory_order_relaxed) >= 1);
+    if (IsShared()) {
+      ref_count_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      AssertOwningThread();
+      ref_count_.store(ref_count_.load(std::memory_order_relaxed) + 1,
+                       std::memory_order_relaxed);
+    }
+  }
+
+  // Drop a reference to this object, potentially deallocating it.
+  void DropRef() {
+    assert(ref_count_.load(std::memory_order_relaxed) > 0);
+    if (IsShared()) {
+      if (ref_count_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        static_cast<SubClass*>(this)->Destroy();
+      return;
+    }
+    AssertOwningThread();
+    const unsigned ref_count = ref_count_.load(std::memory_order_relaxed) - 1;
+    ref_count_.store(ref_count, std::memory_order_relaxed);
+    if (ref_count == 0) static_cast<SubClass*>(this)->Destroy();
+  }
+
+  // Switches the reference count to atomic updates. Must be called by the
+  // owning thread before a reference to this object is passed to another
+  // thread. Calling it again is a no-op.
+  void Share() {
+    if (IsShared()) return;
+    AssertOwningThread();
+    shared_.store(true, std::memory_order_relaxed);
+  }
+
+  // Returns true if Share() has been called.
+  bool IsShared() const { return shared_.load(std::memory_order_relaxed); }
+
+  // Return reference count. This should be used for testing and debugging
+  // only.
+  uint32_t NumRef() const { return ref_count_.load(std::memory_order_acquire); }
+
+  // Return true if reference count is 1.
+  bool IsUnique() const {
+    return ref_count_.load(std::memory_order_acquire) == 1;
+  }
+
+ protected:
+  // Subclasses are allowed to customize this, but the default implementation
+  // of Destroy() will just delete the pointer.
+  void Destroy() { delete static_cast<SubClass*>(this); }
+
+ private:
+  void AssertOwningThread() const {
+    assert(owner_ == std::this_thread::get_id() &&
+           "Thread confined reference count used on another thread; call "
+           "Share() before the reference escapes");
+  }
+
+  // Updated with relaxed loads and stores while the object is confined to the
+  // owning thread, which compile to plain memory accesses.
+  std::atomic<unsigned> ref_count_;
+  std::atomic<bool> shared_{false};
+#ifndef NDEBUG
+  const std::thread::id owner_ = std::this_thread::get_id();
+#endif
+};
+
 }  // namespace tfrt
 
 #endif  // TFRT_SUPPORT_REF_COUNT_H_
@@ -41,6 +41,9 @@ enum class TensorDType : uint8_t {
   kUInt16 = 7,
   kUInt32 = 8,
   kUInt64 = 9,
+  // Quantized tables, e.g. of tf._QuantizeEmbeddingTable, whose scales are
+  // stored as separate float tensors.
+  kQInt8 = 10,
 };
 
 DType ToDTypeKind(TensorDType type);
@@ -60,6 +63,7 @@ constexpr TensorDType GetTensorDType(uint8_t) { return TensorDType::kUInt8; }
 constexpr TensorDType GetTensorDType(uint16_t) { return TensorDType::kUInt16; }
 constexpr TensorDType GetTensorDType(uint32_t) { return TensorDType::kUInt32; }
 constexpr TensorDType GetTensorDType(uint64_t) { return TensorDType::kUInt64; }
+constexpr TensorDType GetTensorDType(qint8) { return TensorDType::kQInt8; }
 
 // This class should be kept in sync with the TensorLayout enum in
 // utils/mnist/btf_writer.py.
@@ -89,6 +93,15 @@ static_assert(offsetof(TensorHeader, dtype) == 8,
 static_assert(offsetof(TensorHeader, layout) == 9,
               "layout does not start at the correct offset.");
 
+// BTF files may have a checksum section between the tensor record offsets and
+// the first tensor record. Readers that seek to the offsets skip it.
+//
+// <magic:uint64_t><checksums:uint32_t[num_tensors]><padding to 8 bytes>
+//
+// The magic is "BTFCRC32" in ASCII, and each checksum is the masked crc32c of
+// the tensor data of the respective record (see crc32c::Mask).
+constexpr uint64_t kChecksumMagic = 0x3233435243465442;
+
 }  // namespace btf
 }  // namespace tfrt
 
@@ -0,0 +1,73 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Memory-mapped BTF file
+//
+// This file declares MappedBTFFile, which memory maps a BTF file and exposes
+// its tensors as DenseHostTensors that point into the mapping. Pages of the
+// mapping are shared with every other reader of the file, and a tensor is only
+// read from disk when it is first touched.
+
+#ifndef TFRT_TENSOR_BTF_MAPPED_FILE_H_
+#define TFRT_TENSOR_BTF_MAPPED_FILE_H_
+
+#include <cstdint>
+#include <memory>
+
+#include "tfrt/io/file_system.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/support/ref_count.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+
+class HostContext;
+
+// This class is thread-safe. Tensors returned by GetDenseHostTensor() keep the
+// file mapped, and must not be written to.
+class MappedBTFFile : public ReferenceCounted<MappedBTFFile> {
+ public:
+  // Maps the BTF file at `path` with the file system registered for its
+  // scheme, and validates its tensor offset table.
+  static Expected<RCReference<MappedBTFFile>> Open(string_view path);
+
+  size_t num_tensors() const { return offsets_.size(); }
+
+  // Returns tensor `index`. Its data points into the mapping unless it is not
+  // aligned for the dtype of the tensor, in which case it is copied into a
+  // buffer allocated from `host`.
+  Expected<DenseHostTensor> GetDenseHostTensor(size_t index,
+                                               HostContext* host) const;
+
+ private:
+  MappedBTFFile(std::string path,
+                std::unique_ptr<io::ReadOnlyMemoryRegion> region,
+                ArrayRef<uint64_t> offsets)
+      : path_(std::move(path)),
+        region_(std::move(region)),
+        offsets_(offsets) {}
+
+  const uint8_t* data() const {
+    return static_cast<const uint8_t*>(region_->data());
+  }
+
+  const std::string path_;
+  const std::unique_ptr<io::ReadOnlyMemoryRegion> region_;
+  // The TENSOR_RECORD_OFFSETs, which point into the mapping.
+  const ArrayRef<uint64_t> offsets_;
+};
+
+}  // namespace tfrt
+
+#endif  // TFRT_TENSOR_BTF_MAPPED_FILE_H_
@@ -38,6 +38,11 @@
 #include "tfrt/tensor/tensor_shape.h"
 
 namespace tfrt {
+namespace io {
+class BufferedInputStream;
+class RandomAccessFile;
+class WritableFile;
+}  // namespace io
 
 // Utility function to read n elements of data of type T from the input stream.
 template <typename T>
@@ -194,10 +199,36 @@ Expected<std::vector<uint64_t>> ReadBTFOffsets(std::istream* stream);
 Expected<DenseHostTensor> ReadDHTFromBTF(std::istream* stream, uint64_t offset,
                                          HostContext* host);
 
+// Versions of ReadBTFOffsets and ReadDHTFromBTF that use positional reads, so
+// that they can read different tensors of the same file concurrently.
+Expected<std::vector<uint64_t>> ReadBTFOffsets(const io::RandomAccessFile& file);
+Expected<DenseHostTensor> ReadDHTFromBTF(const io::RandomAccessFile& file,
+                                         uint64_t offset, HostContext* host);
+
+// Reads the TENSOR_RECORD at the current position of `stream` as a DHT, and
+// leaves the stream at the beginning of the next record. The tensor data is a
+// chunk of the stream buffer (see BufferedInputStream::ReadChunk), so it is not
+// copied if the record fits into the buffer.
+Expected<DenseHostTensor> ReadDHTFromBTF(io::BufferedInputStream* stream,
+                                         HostContext* host);
+
 // Writes a BTF-file, with file header (offsets) and tensor records. Currently
 // only supports DenseHostTensors.
 Error WriteTensorsToBTF(std::ostream* stream, ArrayRef<const Tensor*> tensors);
 
+// Writes a BTF-file with a checksum section. Each tensor record is appended to
+// `file` with a single scatter-gather write straight from the tensor buffer.
+Error WriteTensorsToBTF(io::WritableFile* file,
+                        ArrayRef<const DenseHostTensor*> tensors);
+
+// Reads the checksum section of a BTF-file given its tensor record `offsets`.
+// Returns an empty vector if the file does not have one.
+Expected<std::vector<uint32_t>> ReadBTFChecksums(
+    const io::RandomAccessFile& file, ArrayRef<uint64_t> offsets);
+
+// Returns the checksum of `dht` as stored in the checksum section.
+uint32_t ComputeBTFChecksum(const DenseHostTensor& dht);
+
 }  // namespace tfrt
 
 #endif  // TFRT_TENSOR_BTF_UTIL_H_
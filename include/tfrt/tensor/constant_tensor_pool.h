@@ -0,0 +1,118 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Content-addressed pool of constant tensor data
+//
+// This file declares ConstantTensorPool, which deduplicates the data of
+// constant tensors by their contents. Constants with identical bytes, e.g. the
+// same embedding table embedded in several BEF files, share a single read-only
+// copy that is released with the last tensor using it.
+
+#ifndef TFRT_TENSOR_CONSTANT_TENSOR_POOL_H_
+#define TFRT_TENSOR_CONSTANT_TENSOR_POOL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "tfrt/host_context/host_buffer.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/ref_count.h"
+#include "tfrt/support/thread_annotations.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+
+// This class is thread-safe. The pool must outlive all the buffers and tensors
+// it returns, which the process-wide pool returned by Global() does.
+//
+// Pooled buffers are never exclusively owned (see
+// HostBuffer::IsExclusiveDataOwner), so kernels that reuse their operand
+// buffers in place leave them alone. Pooled tensors must not be written to.
+class ConstantTensorPool {
+ public:
+  // Constants smaller than this are copied instead of pooled, as hashing and
+  // the pool entry would cost more than the copy.
+  static constexpr size_t kDefaultMinPooledSize = 1024;
+
+  explicit ConstantTensorPool(size_t min_pooled_size = kDefaultMinPooledSize)
+      : min_pooled_size_(min_pooled_size) {}
+  ~ConstantTensorPool();
+
+  ConstantTensorPool(const ConstantTensorPool&) = delete;
+  ConstantTensorPool& operator=(const ConstantTensorPool&) = delete;
+
+  // The pool shared by all HostContexts and BEF files of the process.
+  static ConstantTensorPool* Global();
+
+  // Return a read-only buffer holding a copy of `data` with at least
+  // `alignment`. If the pool holds a buffer with the same bytes, this returns
+  // that buffer instead of copying `data` again. Data smaller than the minimum
+  // pooled size is copied into a buffer of its own. Returns null on allocation
+  // failure.
+  RCReference<HostBuffer> GetOrCreate(ArrayRef<uint8_t> data,
+                                      size_t alignment);
+
+  // Return a DenseHostTensor with `metadata` whose data is the pooled copy of
+  // `data`, which must have the size of `metadata`. Returns std::nullopt on
+  // allocation failure.
+  std::optional<DenseHostTensor> GetOrCreateDenseHostTensor(
+      const TensorMetadata& metadata, ArrayRef<uint8_t> data);
+
+  struct Stats {
+    // The number of distinct constants in the pool, and their total size.
+    int64_t num_entries = 0;
+    int64_t pooled_bytes = 0;
+    // The number of bytes not allocated because a pooled copy was returned.
+    int64_t saved_bytes = 0;
+  };
+  Stats GetStats() const;
+
+ private:
+  struct Entry {
+    uint64_t hash;
+    void* data;
+    size_t size;
+    // The number of pooled buffers referring to `data`.
+    int64_t num_buffers;
+  };
+
+  // Return a new buffer referring to the data of `entry`.
+  RCReference<HostBuffer> MakeBuffer(Entry* entry) TFRT_REQUIRES(mu_);
+
+  // Called when the last reference to a buffer returned by MakeBuffer() is
+  // dropped.
+  void ReleaseBuffer(Entry* entry);
+
+  // Return the entry with `hash` and the same bytes as `data` whose data has
+  // at least `alignment`, or null.
+  Entry* Find(uint64_t hash, ArrayRef<uint8_t> data, size_t alignment)
+      TFRT_REQUIRES(mu_);
+
+  const size_t min_pooled_size_;
+
+  mutable mutex mu_;
+  // Entries with the same hash are compared by their bytes.
+  llvm::DenseMap<uint64_t, llvm::SmallVector<std::unique_ptr<Entry>, 1>>
+      entries_ TFRT_GUARDED_BY(mu_);
+  Stats stats_ TFRT_GUARDED_BY(mu_);
+};
+
+}  // namespace tfrt
+
+#endif  // TFRT_TENSOR_CONSTANT_TENSOR_POOL_H_
@@ -0,0 +1,110 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file defines the ContiguousStringHostTensor class.
+
+#ifndef TFRT_TENSOR_CONTIGUOUS_STRING_HOST_TENSOR_H_
+#define TFRT_TENSOR_CONTIGUOUS_STRING_HOST_TENSOR_H_
+
+#include <cstdint>
+#include <optional>
+
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/host_buffer.h"
+#include "tfrt/tensor/host_tensor.h"
+
+namespace tfrt {
+
+class HostContext;
+class TensorConversionFnRegistry;
+
+void RegisterContiguousStringHostTensorConversionFn(
+    TensorConversionFnRegistry* registry);
+
+// Represents a tensor of strings whose bytes are stored back to back in a
+// single buffer, in row major order. Element i is the byte range
+// [offsets[i], offsets[i + 1]) of the buffer, so the offsets buffer holds
+// NumElements() + 1 uint64_t values. Compared to StringHostTensor, creating
+// the tensor takes two allocations regardless of the number of elements, and
+// the contents can be parsed or hashed as one contiguous range.
+//
+// The buffers are immutable and reference counted, so copies of the tensor
+// share them.
+class ContiguousStringHostTensor final
+    : public HostTensor,
+      public TensorTraits<ContiguousStringHostTensor> {
+ public:
+  // Copies `strings` into a new tensor of `shape`. Returns None on allocation
+  // failure.
+  static std::optional<ContiguousStringHostTensor> Create(
+      const TensorShape& shape, ArrayRef<string_view> strings,
+      HostContext* host);
+
+  // Makes a tensor over existing buffers. `offsets` must hold
+  // shape.GetNumElements() + 1 non-decreasing uint64_t values, starting at 0
+  // and ending at most at bytes->size().
+  ContiguousStringHostTensor(const TensorShape& shape,
+                             RCReference<HostBuffer> bytes,
+                             RCReference<HostBuffer> offsets)
+      : HostTensor(TensorMetadata(DType(DType::String), shape)),
+        bytes_(std::move(bytes)),
+        offsets_(std::move(offsets)) {
+    assert(offsets_->size() ==
+           (shape.GetNumElements() + 1) * sizeof(uint64_t));
+  }
+
+  ContiguousStringHostTensor(ContiguousStringHostTensor&& other) = default;
+  ContiguousStringHostTensor& operator=(ContiguousStringHostTensor&& other) =
+      default;
+
+  // Returns a tensor that shares the buffers of this one.
+  ContiguousStringHostTensor CopyRef() const {
+    return ContiguousStringHostTensor(shape(), bytes_.CopyRef(),
+                                      offsets_.CopyRef());
+  }
+
+  ArrayRef<uint64_t> offsets() const {
+    return ArrayRef<uint64_t>(static_cast<const uint64_t*>(offsets_->data()),
+                              offsets_->size() / sizeof(uint64_t));
+  }
+
+  // Returns the bytes of all elements.
+  string_view bytes() const {
+    return string_view(static_cast<const char*>(bytes_->data()),
+                       offsets().back());
+  }
+
+  string_view GetString(size_t index) const {
+    auto offsets = this->offsets();
+    return bytes().slice(offsets[index], offsets[index + 1]);
+  }
+
+  const RCReference<HostBuffer>& bytes_buffer() const { return bytes_; }
+  const RCReference<HostBuffer>& offsets_buffer() const { return offsets_; }
+
+  void Print(raw_ostream& os) const override;
+
+  // Tensor type for ContiguousStringHostTensor.
+  static const char* name() { return "ContiguousStringHost"; }
+
+ private:
+  RCReference<HostBuffer> bytes_;
+  RCReference<HostBuffer> offsets_;
+};
+
+}  // namespace tfrt
+
+#endif  // TFRT_TENSOR_CONTIGUOUS_STRING_HOST_TENSOR_H_
@@ -16,9 +16,14 @@
 #ifndef TFRT_TENSOR_CONVERSION_REGISTRY_H_
 #define TFRT_TENSOR_CONVERSION_REGISTRY_H_
 
+#include <memory>
+
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DenseMapInfo.h"
+#include "llvm/ADT/SmallVector.h"
 #include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
 #include "tfrt/tensor/tensor.h"
 #include "tfrt/tensor/tensor_type_registration.h"
 
@@ -40,7 +45,9 @@ using TensorConversionFn = AsyncValueRef<Tensor> (*)(
     const ExecutionContext& exec_ctx);
 
 // Convert tensor to tensor type. It will look up and call the
-// TensorConversionFn registered in the TensorConversionFn registry
+// TensorConversionFn registered in the TensorConversionFn registry. If there is
+// no direct conversion, the tensor is converted through the shortest chain of
+// registered conversions. Intermediate tensors stay on the `src` device.
 AsyncValueRef<Tensor> ConvertTensor(const ExecutionContext& exec_ctx,
                                     const Tensor& tensor, const Device& src,
                                     const Device& dst,
@@ -74,8 +81,24 @@ class TensorConversionFnRegistry {
   void AddTensorConversionFn(ConversionKey key, TensorConversionFn fn);
   TensorConversionFn GetTensorConversionFn(ConversionKey key) const;
 
+  // Returns the conversion functions to apply in order to convert tensors of
+  // the source type into the destination type with the fewest conversions, or
+  // an empty path if there is no such chain. Paths are searched once per key
+  // and cached, the returned array stays valid until the next
+  // AddTensorConversionFn call.
+  ArrayRef<TensorConversionFn> GetTensorConversionPath(ConversionKey key) const;
+
  private:
+  using ConversionPath = llvm::SmallVector<TensorConversionFn, 2>;
+
+  ConversionPath FindTensorConversionPath(ConversionKey key) const;
+
   llvm::DenseMap<ConversionKey, TensorConversionFn> conversion_fn_map_;
+
+  mutable mutex mu_;
+  // Paths are heap allocated so that they do not move when the map grows.
+  mutable llvm::DenseMap<ConversionKey, std::unique_ptr<ConversionPath>>
+      conversion_path_cache_ TFRT_GUARDED_BY(mu_);
 };
 
 // The type for TensorConversionFn registration functions.
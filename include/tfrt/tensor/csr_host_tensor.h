@@ -0,0 +1,83 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file define the CsrHostTensor class.
+
+#ifndef TFRT_TENSOR_CSR_HOST_TENSOR_H_
+#define TFRT_TENSOR_CSR_HOST_TENSOR_H_
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+
+class TensorConversionFnRegistry;
+
+void RegisterCsrHostTensorConversionFn(TensorConversionFnRegistry* registry);
+
+// Represents a rank 2 sparse tensor in compressed sparse row (CSR) format.
+// The non-zero elements of row `r` are values[row_ptrs[r]:row_ptrs[r + 1]],
+// and their columns are the matching elements of col_indices. The columns of
+// each row are sorted and unique.
+class CsrHostTensor final : public HostTensor,
+                            public TensorTraits<CsrHostTensor> {
+ public:
+  // Empty and null by default.
+  CsrHostTensor() = default;
+
+  // `row_ptrs` is an int64 tensor of shape [rows + 1], `col_indices` is an
+  // int64 tensor of shape [nnz] and `values` is a tensor of shape [nnz].
+  CsrHostTensor(const TensorShape& shape, DType dtype,
+                DenseHostTensor&& row_ptrs, DenseHostTensor&& col_indices,
+                DenseHostTensor&& values)
+      : HostTensor(TensorMetadata(dtype, shape)),
+        row_ptrs_(std::move(row_ptrs)),
+        col_indices_(std::move(col_indices)),
+        values_(std::move(values)) {
+    assert(shape.GetRank() == 2);
+  }
+
+  CsrHostTensor CopyRef() const {
+    return CsrHostTensor(shape(), dtype(), row_ptrs_.CopyRef(),
+                         col_indices_.CopyRef(), values_.CopyRef());
+  }
+
+  Index NumRows() const { return shape().GetDimensionSize(0); }
+  Index NumCols() const { return shape().GetDimensionSize(1); }
+  Index NumNonZeros() const { return values_.NumElements(); }
+
+  // Raw access to data.
+  const int64_t* RowPtrs() const {
+    return static_cast<const int64_t*>(row_ptrs_.data());
+  }
+  const int64_t* ColIndices() const {
+    return static_cast<const int64_t*>(col_indices_.data());
+  }
+  const DenseHostTensor* Values() const { return &values_; }
+  DenseHostTensor* Values() { return &values_; }
+
+  void Print(raw_ostream& os) const override;
+
+  // Tensor type for CsrHostTensor.
+  static const char* name() { return "CsrHost"; }
+
+ private:
+  DenseHostTensor row_ptrs_;
+  DenseHostTensor col_indices_;
+  DenseHostTensor values_;
+};
+
+}  // namespace tfrt
+
+#endif  // TFRT_TENSOR_CSR_HOST_TENSOR_H_
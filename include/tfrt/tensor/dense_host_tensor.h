@@ -20,6 +20,7 @@
 #define TFRT_TENSOR_DENSE_HOST_TENSOR_H_
 
 #include <optional>
+#include <string>
 
 #include "tfrt/host_context/host_buffer.h"
 #include "tfrt/host_context/value.h"
@@ -32,6 +33,11 @@ class HostContext;
 
 void RegisterDenseHostTensorConversionFn(TensorConversionFnRegistry* registry);
 
+// MemoizationKeyEncoder for DenseHostTensor values, which encodes the metadata
+// and the bytes of the tensor. See host_context/function_result_cache.h.
+bool EncodeDenseHostTensorMemoizationKey(const AsyncValue& value,
+                                         std::string* key);
+
 // Represents a tensor whose elements are stored contiguously in row major
 // format with no padding or stride.
 class DenseHostTensor final : public HostTensor,
@@ -46,6 +52,10 @@ class DenseHostTensor final : public HostTensor,
   DenseHostTensor(DenseHostTensor&& other) = default;
   DenseHostTensor& operator=(DenseHostTensor&& other) = default;
 
+  // The alignment of the data of a DenseHostTensor with `dtype`. Buffers
+  // passed to the constructor must have at least this alignment.
+  static size_t GetBufferAlignment(DType dtype);
+
   // Allocate a DenseHostTensor with an uninitialized body.  This returns None
   // on allocation failure.
   static std::optional<DenseHostTensor> CreateUninitialized(
@@ -60,6 +70,25 @@ class DenseHostTensor final : public HostTensor,
     return CreateUninitialized(TensorMetadata(GetDType<T>(), shape), host);
   }
 
+  // Allocate a DenseHostTensor whose elements are all zero, e.g. of value 0 or
+  // 0.0 or false. Unlike CreateUninitialized() followed by a fill, the pages of
+  // a large tensor are zeroed lazily by the operating system if the allocator
+  // gets them fresh (see HostAllocator::AllocateZeroedBytes). This returns
+  // None on allocation failure.
+  static std::optional<DenseHostTensor> CreateZeroed(
+      const TensorMetadata& metadata, HostContext* host);
+
+  // Create a DenseHostTensor whose data is the `size` bytes at `ptr`, without
+  // copying them, e.g. for request payloads in an RPC arena or shared memory.
+  // `deallocator` is called with `ptr` and `size` once the data is no longer
+  // referenced. Kernels do not forward such a buffer to their results (see
+  // HostBuffer::IsExclusiveDataOwner), so the data is only read. This returns
+  // None, and does not call `deallocator`, if `size` is smaller than the size
+  // of `metadata` or `ptr` is not aligned to GetBufferAlignment().
+  static std::optional<DenseHostTensor> CreateFromExternal(
+      const TensorMetadata& metadata, void* ptr, size_t size,
+      HostBuffer::Deallocator deallocator);
+
   template <typename T>
   static std::optional<DenseHostTensor> CreateScalar(T value,
                                                      HostContext* host) {
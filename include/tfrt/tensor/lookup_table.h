@@ -0,0 +1,130 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Immutable lookup table
+//
+// This file declares LookupTable, an immutable map from string or int64 keys
+// to int64 values, e.g. from the tokens of a vocabulary to their ids, indexed
+// by a minimal perfect hash.
+
+#ifndef TFRT_TENSOR_LOOKUP_TABLE_H_
+#define TFRT_TENSOR_LOOKUP_TABLE_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "tfrt/io/file_system.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/support/ref_count.h"
+
+namespace tfrt {
+
+class HostContext;
+
+// LookupTable maps each key to a slot with a minimal perfect hash built with
+// the "hash and displace" scheme: the keys are grouped into buckets of about
+// four keys by one hash, and every bucket stores the seed of a second hash
+// that sends its keys to free slots. A lookup takes one hash of the key, and
+// reads the seed of its bucket, and the key and value of its slot. The key of
+// the slot is compared to tell keys of the table from other keys.
+//
+// The table is stored in one contiguous region in the format written by
+// Save(), and Open() maps a saved table without copying it, so the pages of
+// the table are shared by all processes that map the same file. Tables are
+// immutable and reference counted, so one table can be shared read-only by the
+// ResourceContexts of several HostContexts. This class is thread-safe.
+class LookupTable : public ReferenceCounted<LookupTable> {
+ public:
+  enum class KeyType : uint32_t { kString = 0, kInt64 = 1 };
+
+  // Builds a table that maps keys[i] to values[i]. Returns an error if a key
+  // occurs twice.
+  static Expected<RCReference<LookupTable>> Create(ArrayRef<string_view> keys,
+                                                   ArrayRef<int64_t> values);
+  static Expected<RCReference<LookupTable>> Create(ArrayRef<int64_t> keys,
+                                                   ArrayRef<int64_t> values);
+
+  // Builds a table of string keys from the text file at `path`. Every line
+  // holds a key, which maps to the index of its line, or a key and a value
+  // separated by a tab.
+  static Expected<RCReference<LookupTable>> CreateFromTextFile(
+      string_view path);
+
+  // Builds a table of int64 keys from the BTF file at `path`, whose first two
+  // tensors are the keys and the values: two i64 tensors of rank 1 with the
+  // same number of elements.
+  static Expected<RCReference<LookupTable>> CreateFromBTFFile(
+      string_view path, HostContext* host);
+
+  // Maps the table saved by Save() at `path`.
+  static Expected<RCReference<LookupTable>> Open(string_view path);
+
+  // Writes the table to `path`, to be mapped by Open().
+  Error Save(string_view path) const;
+
+  KeyType key_type() const { return key_type_; }
+  size_t size() const { return values_.size(); }
+
+  // Returns the value of `key`, or `default_value` if the table does not have
+  // `key`. The key type must match the table.
+  int64_t Lookup(string_view key, int64_t default_value) const;
+  int64_t Lookup(int64_t key, int64_t default_value) const;
+
+  // Looks up a batch of keys, as above. The lookups of a batch are interleaved
+  // and their memory accesses prefetched, so that they wait for memory in
+  // parallel rather than one after the other.
+  void Lookup(ArrayRef<std::string> keys, int64_t default_value,
+              MutableArrayRef<int64_t> values) const;
+  void Lookup(ArrayRef<int64_t> keys, int64_t default_value,
+              MutableArrayRef<int64_t> values) const;
+
+ private:
+  // Returns the table in `region` if it holds a valid table.
+  static Expected<RCReference<LookupTable>> Parse(
+      std::unique_ptr<io::ReadOnlyMemoryRegion> region, string_view source);
+
+  explicit LookupTable(std::unique_ptr<io::ReadOnlyMemoryRegion> region)
+      : region_(std::move(region)) {}
+
+  // Returns the slot of a key of hash `hash`. The key is in the table only if
+  // it equals the key of the slot.
+  uint64_t GetSlot(uint64_t hash) const;
+
+  bool HasKeyAt(uint64_t slot, string_view key) const {
+    return string_view(key_bytes_ + key_offsets_[slot],
+                       key_offsets_[slot + 1] - key_offsets_[slot]) == key;
+  }
+
+  template <typename Key>
+  void LookupBatch(ArrayRef<Key> keys, int64_t default_value,
+                   MutableArrayRef<int64_t> values) const;
+
+  // Holds the table in the format written by Save(). The views below point
+  // into it.
+  const std::unique_ptr<io::ReadOnlyMemoryRegion> region_;
+  KeyType key_type_ = KeyType::kString;
+  ArrayRef<uint32_t> seeds_;
+  ArrayRef<int64_t> values_;
+  // The keys of the slots of an int64 table.
+  ArrayRef<int64_t> int_keys_;
+  // The keys of the slots of a string table: key i is the byte range
+  // [key_offsets_[i], key_offsets_[i + 1]) of key_bytes_.
+  ArrayRef<uint64_t> key_offsets_;
+  const char* key_bytes_ = nullptr;
+};
+
+}  // namespace tfrt
+
+#endif  // TFRT_TENSOR_LOOKUP_TABLE_H_
@@ -0,0 +1,36 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file declares kernels for lookup tables.
+
+#ifndef TFRT_TENSOR_LOOKUP_TABLE_KERNELS_H_
+#define TFRT_TENSOR_LOOKUP_TABLE_KERNELS_H_
+
+#include <string>
+
+#include "tfrt/host_context/kernel_registry.h"
+#include "tfrt/support/forward_decls.h"
+
+namespace tfrt {
+
+// Returns the name of the ResourceContext resource that holds the
+// RCReference<LookupTable> loaded by tfrt_lut.load_table as `name`. Other
+// code can add tables under this name to share them with the kernels.
+std::string GetLookupTableResourceName(string_view name);
+
+void RegisterLookupTableKernels(KernelRegistry* registry);
+
+}  // namespace tfrt
+
+#endif  // TFRT_TENSOR_LOOKUP_TABLE_KERNELS_H_
@@ -0,0 +1,119 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file defines the StridedHostTensorView class.
+
+#ifndef TFRT_TENSOR_STRIDED_HOST_TENSOR_VIEW_H_
+#define TFRT_TENSOR_STRIDED_HOST_TENSOR_VIEW_H_
+
+#include <cassert>
+#include <cstddef>
+#include <optional>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+#include "tfrt/host_context/host_buffer.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/tensor_metadata.h"
+
+namespace tfrt {
+
+class HostAllocator;
+class HostContext;
+
+// StridedHostTensorView describes a strided layout of tensor elements over a
+// shared HostBuffer: the element at coordinate `c` is stored at element offset
+// `offset() + sum(c[i] * strides()[i])` of the buffer. Strides are in elements
+// and can be negative.
+//
+// Slicing, strided slicing and transposition only compute a new offset and new
+// strides, and keep a reference to the same buffer, so they never copy the
+// elements. `ToDenseHostTensor` returns a DenseHostTensor sharing the buffer if
+// the view is contiguous and row-major, and copies the elements otherwise, so
+// kernels that accept strided input can consume the view directly and defer
+// the copy to the consumers that need contiguous memory.
+class StridedHostTensorView {
+ public:
+  // Returns a contiguous row-major view of `dht`.
+  explicit StridedHostTensorView(const DenseHostTensor& dht);
+
+  StridedHostTensorView(const TensorMetadata& metadata,
+                        RCReference<HostBuffer> buffer, Index offset,
+                        ArrayRef<Index> strides);
+
+  StridedHostTensorView(const StridedHostTensorView& other) = default;
+  StridedHostTensorView& operator=(const StridedHostTensorView& other) =
+      default;
+  StridedHostTensorView(StridedHostTensorView&& other) = default;
+  StridedHostTensorView& operator=(StridedHostTensorView&& other) = default;
+
+  const TensorMetadata& metadata() const { return metadata_; }
+  DType dtype() const { return metadata_.dtype; }
+  const TensorShape& shape() const { return metadata_.shape; }
+  Index NumElements() const { return metadata_.shape.GetNumElements(); }
+
+  const RCReference<HostBuffer>& buffer() const { return buffer_; }
+
+  // The offset of the first element in the buffer, in elements.
+  Index offset() const { return offset_; }
+
+  // The distance between consecutive elements of each dimension, in elements.
+  ArrayRef<Index> strides() const { return strides_; }
+
+  // Returns true if the elements are stored contiguously in row-major order.
+  bool IsContiguous() const;
+
+  // Returns a view of the elements in [begin[i], begin[i] + size[i]) of every
+  // dimension `i`.
+  StridedHostTensorView Slice(ArrayRef<Index> begin,
+                              ArrayRef<Index> size) const;
+
+  // Returns a view of the elements begin[i], begin[i] + strides[i], ... up to
+  // and excluding end[i] of every dimension `i`. Strides must not be zero and
+  // can be negative, in which case `begin` is above `end`.
+  StridedHostTensorView StridedSlice(ArrayRef<Index> begin, ArrayRef<Index> end,
+                                     ArrayRef<Index> strides) const;
+
+  // Returns a view whose dimension `i` is the dimension `perm[i]` of this view.
+  StridedHostTensorView Transpose(ArrayRef<Index> perm) const;
+
+  // Returns the element at coordinate `coord`.
+  template <typename T>
+  const T& ElementAt(ArrayRef<Index> coord) const {
+    assert(GetDType<T>() == dtype() && "Incorrect dtype for tensor");
+    return static_cast<const T*>(buffer_->data())[OffsetOf(coord)];
+  }
+
+  // Returns a DenseHostTensor with the elements of this view. The tensor shares
+  // the buffer of the view if the view is contiguous, otherwise it is a copy.
+  // This returns None on allocation failure.
+  std::optional<DenseHostTensor> ToDenseHostTensor(HostContext* host) const;
+  std::optional<DenseHostTensor> ToDenseHostTensor(
+      HostAllocator* allocator) const;
+
+ private:
+  Index OffsetOf(ArrayRef<Index> coord) const;
+
+  TensorMetadata metadata_;
+  RCReference<HostBuffer> buffer_;
+  Index offset_ = 0;
+  llvm::SmallVector<Index, 4> strides_;
+};
+
+}  // namespace tfrt
+
+#endif  // TFRT_TENSOR_STRIDED_HOST_TENSOR_VIEW_H_
@@ -22,8 +22,10 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <string>
 
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
 #include "tfrt/bef/bef_encoding.h"
 #include "tfrt/bef_converter/bef_attr_encoder.h"
 #include "tfrt/host_context/host_buffer.h"
@@ -33,6 +35,9 @@
 
 namespace tfrt {
 
+class AggregateAttr;
+class AsyncKernelFrame;
+class ContiguousStringHostTensor;
 class DenseHostTensor;
 class HostContext;
 class DenseAttr;
@@ -45,6 +50,34 @@ size_t SerializeDenseHostTensorToDenseAttr(const DenseHostTensor& dht,
 llvm::Expected<DenseHostTensor> DeserializeDenseHostTensorFromDenseAttr(
     DenseAttr attr, HostContext* host);
 
+// Constant DenseHostTensor with `md` whose data are the `data` bytes of an
+// attribute of the kernel running in `frame`. The tensor refers to the
+// attribute without copying it if the attribute section is kept alive by its
+// owner (see AsyncKernelFrame::BorrowAttributeData) and `data` is aligned for
+// DenseHostTensor, and to a copy pooled by ConstantTensorPool otherwise. The
+// tensor must not be written to.
+llvm::Expected<DenseHostTensor> CreateConstantDenseHostTensor(
+    const TensorMetadata& md, ArrayRef<uint8_t> data,
+    const AsyncKernelFrame& frame);
+
+// DenseAttr of the kernel running in `frame` to a constant DenseHostTensor, as
+// above.
+llvm::Expected<DenseHostTensor> CreateConstantDenseHostTensor(
+    DenseAttr attr, const AsyncKernelFrame& frame);
+
+// Constant ContiguousStringHostTensor of `shape` whose elements are the
+// StringAttrs in `values`, an aggregate attribute of the kernel running in
+// `frame`. `values` holds either one string per element or a single string
+// for all elements. A tensor with a single element refers to the string in
+// the attribute section without copying it if the section is kept alive by its
+// owner. Otherwise the strings are copied into one buffer, so the tensor takes
+// two allocations regardless of the number of elements. The tensor must not
+// be written to.
+llvm::Expected<ContiguousStringHostTensor>
+CreateConstantContiguousStringHostTensor(const TensorShape& shape,
+                                         AggregateAttr values,
+                                         const AsyncKernelFrame& frame);
+
 TensorMetadata CreateTensorMetadata(const DenseAttr& attr);
 
 DenseView CreateDenseView(const DenseAttr& attr);
@@ -61,6 +94,37 @@ llvm::Expected<DenseHostTensor> DeserializeDenseHostTensor(
     const llvm::SmallVector<RCReference<HostBuffer>, 4>& serialized,
     HostContext* host);
 
+// A DenseHostTensor serialized for scatter-gather I/O, e.g. with writev() or
+// by an RPC layer that sends a list of buffers. The tensor data is borrowed
+// rather than copied, and `data` keeps it alive while the chunks are in use.
+struct DenseHostTensorWireChunks {
+  // The metadata of the tensor, as serialized by SerializeTensorMetadata().
+  // Its size is 8 bytes per dimension plus 8 bytes.
+  std::string header;
+  RCReference<HostBuffer> data;
+  // The bytes of `data` that hold the tensor.
+  size_t data_size = 0;
+
+  // The header and the tensor data, to be sent back to back.
+  llvm::SmallVector<ArrayRef<uint8_t>, 2> GetChunks() const;
+};
+
+DenseHostTensorWireChunks SerializeDenseHostTensorToWire(
+    const DenseHostTensor& dht);
+
+// Returns the metadata of a tensor serialized by
+// SerializeDenseHostTensorToWire(), e.g. to allocate the DenseHostTensor that
+// its data is received into.
+llvm::Expected<TensorMetadata> DeserializeDenseHostTensorWireHeader(
+    string_view header);
+
+// Returns a DenseHostTensor that adopts `data`, the tensor data received after
+// `header`, as its buffer without copying. Returns an error if `header` is
+// malformed, or if `data` is smaller than the tensor or misaligned for it (see
+// DenseHostTensor::GetBufferAlignment).
+llvm::Expected<DenseHostTensor> DeserializeDenseHostTensorFromWire(
+    string_view header, RCReference<HostBuffer> data);
+
 }  // namespace tfrt
 
 #endif  // TFRT_SUPPORT_BEF_SERIALIZE_H_
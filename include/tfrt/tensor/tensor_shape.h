@@ -20,7 +20,9 @@
 #define TFRT_TENSOR_TENSOR_SHAPE_H_
 
 #include <array>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <optional>
 
 #include "llvm/ADT/ArrayRef.h"
@@ -120,6 +122,9 @@ class TensorShape {
   // Rep16 and Rep32, the representation value is assumed to be deterministic.
   // This means for Rep16 and Rep32 it is sufficient to compare the memory
   // blocks to determine if two shapes are identical.
+  //
+  // The out of line representation caches the number of elements in front of
+  // the dimensions, so that GetNumElements() never loops over a large rank.
   enum class RepKind : uint8_t { kRep16, kRep32, kRepExternal };
 
   struct Rep16 {
@@ -135,6 +140,7 @@ class TensorShape {
   };
 
   struct RepExternal {
+    // Points past the number of elements, at the first dimension.
     size_t* dims;
 
     // FIXME: This isn't correct for big endian systems.  static_asserts should
@@ -156,6 +162,25 @@ class TensorShape {
   bool IsRepresentationExternal() const {
     return GetRepresentationKind() == RepKind::kRepExternal;
   }
+
+  // Allocates and frees the dimensions of the out of line representation,
+  // preceded by the number of elements.
+  static size_t* AllocateExternalDims(int rank) {
+    return new size_t[rank + 1] + 1;
+  }
+  static void FreeExternalDims(size_t* dims) { delete[] (dims - 1); }
+
+  // Copies the dimensions and the number of elements of `rhs`, which uses the
+  // out of line representation.
+  void CopyExternalDims(const TensorShape& rhs) {
+    const int rank = rhs.GetRank();
+    representation_.rep_external.dims = AllocateExternalDims(rank);
+    memcpy(representation_.rep_external.dims - 1,
+           rhs.representation_.rep_external.dims - 1,
+           (rank + 1) * sizeof(size_t));
+  }
+
+  bool EqualsExternal(const TensorShape& other) const;
 };
 
 // Represents the shape of a tensor when the shape is known at C++ compile time.
@@ -323,8 +348,13 @@ inline TensorShape::TensorShape(ArrayRef<T> dims) {
   }
 
   // Otherwise, nothing fits, use the most general representation.
-  auto* elts = new size_t[rank];
-  memcpy(elts, dims.data(), sizeof(size_t) * rank);
+  auto* elts = AllocateExternalDims(rank);
+  size_t num_elements = 1;
+  for (size_t i = 0; i != rank; ++i) {
+    elts[i] = dims[i];
+    num_elements *= dims[i];
+  }
+  elts[-1] = num_elements;
   representation_.rep_external.dims = elts;
   representation_.rep_external.rank = rank;
   representation_.rep_external.kind = RepKind::kRepExternal;
@@ -358,12 +388,7 @@ inline int TensorShape::GetRank() const {
 
 inline TensorShape::TensorShape(const TensorShape& rhs) {
   memcpy(&representation_, &rhs.representation_, sizeof(representation_));
-  if (rhs.IsRepresentationExternal()) {
-    auto rank = GetRank();
-    representation_.rep_external.dims = new size_t[rank];
-    memcpy(representation_.rep_external.dims,
-           rhs.representation_.rep_external.dims, rank * sizeof(size_t));
-  }
+  if (rhs.IsRepresentationExternal()) CopyExternalDims(rhs);
 }
 
 inline TensorShape::TensorShape(TensorShape&& rhs) {
@@ -377,20 +402,17 @@ inline TensorShape::TensorShape(TensorShape&& rhs) {
 }
 
 inline TensorShape& TensorShape::operator=(const TensorShape& rhs) {
-  if (IsRepresentationExternal()) delete[] representation_.rep_external.dims;
+  if (IsRepresentationExternal())
+    FreeExternalDims(representation_.rep_external.dims);
 
   memcpy(&representation_, &rhs.representation_, sizeof(representation_));
-  if (rhs.IsRepresentationExternal()) {
-    auto rank = GetRank();
-    representation_.rep_external.dims = new size_t[rank];
-    memcpy(representation_.rep_external.dims,
-           rhs.representation_.rep_external.dims, rank * sizeof(size_t));
-  }
+  if (rhs.IsRepresentationExternal()) CopyExternalDims(rhs);
   return *this;
 }
 
 inline TensorShape& TensorShape::operator=(TensorShape&& rhs) {
-  if (IsRepresentationExternal()) delete[] representation_.rep_external.dims;
+  if (IsRepresentationExternal())
+    FreeExternalDims(representation_.rep_external.dims);
 
   memcpy(&representation_, &rhs.representation_, sizeof(representation_));
 
@@ -403,7 +425,86 @@ inline TensorShape& TensorShape::operator=(TensorShape&& rhs) {
 }
 
 inline TensorShape::~TensorShape() {
-  if (IsRepresentationExternal()) delete[] representation_.rep_external.dims;
+  if (IsRepresentationExternal())
+    FreeExternalDims(representation_.rep_external.dims);
+}
+
+inline bool TensorShape::operator==(const TensorShape& other) const {
+  // We assume that two identical shapes have the same representation kind.
+  if (GetRepresentationKind() != other.GetRepresentationKind()) return false;
+  if (!IsRepresentationExternal()) {
+    // Both rep16 and rep32 have the same size and share the same memory, so
+    // either representation is sufficient when comparing the block of memory.
+    return memcmp(&representation_, &other.representation_,
+                  sizeof(representation_)) == 0;
+  }
+  return EqualsExternal(other);
+}
+
+inline bool TensorShape::operator!=(const TensorShape& other) const {
+  return !(*this == other);
+}
+
+// Return the total number of elements in this TensorShape.  This is all of
+// the dimensions multiplied together.
+inline Index TensorShape::GetNumElements() const {
+  Index result = 1;
+  switch (GetRepresentationKind()) {
+    case RepKind::kRep16:
+      for (size_t i = 0, e = GetRank(); i != e; ++i)
+        result *= representation_.rep16.dims[i];
+      return result;
+
+    case RepKind::kRep32:
+      switch (GetRank()) {
+        case 4:
+          result = representation_.rep32.dim3;
+          [[fallthrough]];
+        case 3:
+          result *= representation_.rep32.dims[2];
+          [[fallthrough]];
+        case 2:
+          result *= representation_.rep32.dims[1];
+          [[fallthrough]];
+        case 1:
+          result *= representation_.rep32.dims[0];
+          return result;
+        default:
+          assert(0 && "unreachable");
+          return result;
+      }
+
+    case RepKind::kRepExternal:
+      return representation_.rep_external.dims[-1];
+  }
+  return result;
+}
+
+inline Index TensorShape::GetDimensionSize(int dim_idx) const {
+  assert(dim_idx < GetRank());
+  switch (GetRepresentationKind()) {
+    case RepKind::kRep16:
+      return representation_.rep16.dims[dim_idx];
+
+    case RepKind::kRep32:
+      switch (dim_idx) {
+        case 3:
+          return representation_.rep32.dim3;
+        case 2:
+          return representation_.rep32.dims[2];
+        case 1:
+          return representation_.rep32.dims[1];
+        case 0:
+          return representation_.rep32.dims[0];
+        default:
+          assert(0 && "unreachable");
+          return 0;
+      }
+
+    case RepKind::kRepExternal:
+      return representation_.rep_external.dims[dim_idx];
+  }
+  return 0;
 }
 
 template <size_t Rank>
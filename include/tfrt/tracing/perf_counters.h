@@ -0,0 +1,102 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Hardware performance counters of tracing scopes
+//
+// This file declares the collection of hardware performance counters (cycles,
+// instructions, cache misses and data TLB misses) for the tracing scopes of
+// selected names, e.g. the TFRT_TRACE_SCOPE that BEFExecutor opens around
+// every kernel, which is named after the kernel.
+//
+// The counters are read with perf_event_open(2), so they are only available on
+// Linux, and only count user space events. Each thread that enters a counted
+// scope opens its own group of counters, and each counted scope costs two
+// read(2) calls, which only suits the kernels of interest.
+//
+// Tracing sinks that support counters call StartPerfCounters() when they push
+// a scope and StopPerfCounters() when they pop it, and attach the counts to
+// the recorded event. The counts are also added to the counter metrics
+// "/tfrt/perf_counters/<counter name>/<scope name>".
+
+#ifndef TFRT_TRACING_PERF_COUNTERS_H_
+#define TFRT_TRACING_PERF_COUNTERS_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Error.h"
+
+namespace tfrt {
+namespace tracing {
+
+enum class PerfCounter { kCycles, kInstructions, kCacheMisses, kDtlbMisses };
+constexpr int kNumPerfCounters = 4;
+
+// Counts indexed by PerfCounter.
+using PerfCounterValues = std::array<uint64_t, kNumPerfCounters>;
+
+// Returns e.g. "cycles" for PerfCounter::kCycles.
+llvm::StringRef GetPerfCounterName(PerfCounter counter);
+
+// Starts counting the tracing scopes named one of `scope_names`, replacing the
+// previous names. Returns an error if the counters cannot be opened, e.g.
+// because the platform does not support them or perf_event_paranoid forbids
+// them.
+llvm::Error EnablePerfCounters(llvm::ArrayRef<std::string> scope_names);
+
+// Stops counting tracing scopes. Scopes that were started are still stopped.
+void DisablePerfCounters();
+
+namespace internal {
+extern std::atomic<bool> kPerfCountersEnabled;
+bool IsPerfCounterScope(llvm::StringRef scope_name);
+bool ReadPerfCounters(PerfCounterValues* values);
+PerfCounterValues StopPerfCounters(llvm::StringRef scope_name,
+                                   const PerfCounterValues& start);
+}  // namespace internal
+
+// The counters read when a counted scope started, or none if the scope is not
+// counted.
+using PerfCounterStart = std::optional<PerfCounterValues>;
+
+// Reads the counters of the calling thread if the scope named `scope_name`
+// is counted.
+inline PerfCounterStart StartPerfCounters(llvm::StringRef scope_name) {
+  if (!internal::kPerfCountersEnabled.load(std::memory_order_relaxed) ||
+      !internal::IsPerfCounterScope(scope_name))
+    return std::nullopt;
+  PerfCounterValues values;
+  if (!internal::ReadPerfCounters(&values)) return std::nullopt;
+  return values;
+}
+
+// Returns the counts of the calling thread since `start`, and adds them to the
+// metrics of `scope_name`. Returns none if the scope is not counted.
+inline std::optional<PerfCounterValues> StopPerfCounters(
+    llvm::StringRef scope_name, const PerfCounterStart& start) {
+  if (!start.has_value()) return std::nullopt;
+  return internal::StopPerfCounters(scope_name, *start);
+}
+
+}  // namespace tracing
+}  // namespace tfrt
+
+#endif  // TFRT_TRACING_PERF_COUNTERS_H_
@@ -0,0 +1,287 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Per-thread trace event buffers
+//
+// This file declares TraceBuffers, which lets tracing sinks record events into
+// bounded per-thread ring buffers without taking locks, and TraceCollector,
+// which drains them from a background thread. Both are instances of templates
+// that other recorders may use with events of their own.
+
+#ifndef TFRT_TRACING_TRACE_BUFFERS_H_
+#define TFRT_TRACING_TRACE_BUFFERS_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "llvm/ADT/FunctionExtras.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/MathExtras.h"
+#include "tfrt/tracing/perf_counters.h"
+
+namespace tfrt {
+namespace tracing {
+
+struct TraceEvent {
+  using Clock = std::chrono::steady_clock;
+
+  std::string name;
+  // Equal for instant events.
+  Clock::time_point begin, end;
+  // The hardware counts of the scope, if it is counted. See perf_counters.h.
+  std::optional<PerfCounterValues> counters;
+};
+
+// A bounded queue of events with a single producer and a single consumer.
+// Events pushed while the queue is full are dropped and counted.
+template <typename Event>
+class RingBuffer {
+ public:
+  // The capacity is rounded up to a power of two.
+  explicit RingBuffer(size_t capacity)
+      : mask_(llvm::PowerOf2Ceil(std::max<size_t>(capacity, 1)) - 1),
+        slots_(new Event[mask_ + 1]) {}
+
+  // Must only be called by the producer.
+  bool TryPush(Event&& event) {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) > mask_) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    slots_[tail & mask_] = std::move(event);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Passes the queued events to `consume` in FIFO order. Must only be called
+  // by the consumer. Returns the number of events consumed.
+  size_t Drain(llvm::function_ref<void(Event&&)> consume) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    const size_t tail = tail_.load(std::memory_order_acquire);
+    const size_t count = tail - head;
+    for (; head != tail; ++head) consume(std::move(slots_[head & mask_]));
+    head_.store(head, std::memory_order_release);
+    return count;
+  }
+
+  size_t capacity() const { return mask_ + 1; }
+  uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+ private:
+  const size_t mask_;
+  const std::unique_ptr<Event[]> slots_;
+  // The producer and the consumer each write one of these, so they are kept
+  // on separate cache lines.
+  alignas(64) std::atomic<size_t> head_{0};
+  alignas(64) std::atomic<size_t> tail_{0};
+  std::atomic<uint64_t> dropped_{0};
+};
+
+namespace internal {
+// Returns a process-wide unique id for an instance of ThreadEventBuffers.
+uint64_t NextThreadEventBuffersId();
+}  // namespace internal
+
+// Records events into one RingBuffer per recording thread. Only the first
+// event of each thread takes a lock, to register its buffer. Buffers of
+// threads that exited stay registered, so the memory used is bounded by the
+// number of threads times the capacity of a buffer.
+template <typename Event>
+class ThreadEventBuffers {
+ public:
+  using ConsumeFn = llvm::function_ref<void(std::thread::id, Event&&)>;
+
+  explicit ThreadEventBuffers(size_t capacity_per_thread = 8192)
+      : id_(internal::NextThreadEventBuffersId()),
+        capacity_per_thread_(capacity_per_thread) {}
+
+  // Records `event` for the calling thread. Returns false if the buffer of
+  // the thread is full and the event was dropped.
+  bool Record(Event&& event) {
+    return GetThreadBuffer()->ring.TryPush(std::move(event));
+  }
+
+  // Passes the events recorded so far to `consume`, in order per thread. Must
+  // not be called concurrently with itself.
+  size_t Drain(ConsumeFn consume) {
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      buffers = buffers_;
+    }
+    size_t count = 0;
+    for (const auto& buffer : buffers) {
+      count += buffer->ring.Drain(
+          [&](Event&& event) { consume(buffer->tid, std::move(event)); });
+    }
+    return count;
+  }
+
+  // Returns the number of events dropped because a buffer was full.
+  uint64_t dropped() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t dropped = 0;
+    for (const auto& buffer : buffers_) dropped += buffer->ring.dropped();
+    return dropped;
+  }
+
+ private:
+  struct ThreadBuffer {
+    ThreadBuffer(std::thread::id tid, size_t capacity)
+        : tid(tid), ring(capacity) {}
+
+    const std::thread::id tid;
+    RingBuffer<Event> ring;
+  };
+
+  // The buffers of the calling thread in the instances it recorded to. Like
+  // the thread caches of the pooled allocator, it remembers the buffer of
+  // every instance, so that a thread that alternates between instances does
+  // not register a new buffer on every switch.
+  class ThreadCache {
+   public:
+    ThreadBuffer* Find(uint64_t owner_id) {
+      if (last_owner_id_ == owner_id) return last_;
+      for (const auto& entry : entries_) {
+        if (entry.owner_id != owner_id) continue;
+        // The instance holds a reference to its buffers while it records.
+        last_owner_id_ = owner_id;
+        return last_ = entry.buffer.lock().get();
+      }
+      return nullptr;
+    }
+
+    void Add(uint64_t owner_id, const std::shared_ptr<ThreadBuffer>& buffer) {
+      // Forget the buffers of instances that are gone.
+      entries_.erase(std::remove_if(entries_.begin(), entries_.end(),
+                                    [](const Entry& entry) {
+                                      return entry.buffer.expired();
+                                    }),
+                     entries_.end());
+      entries_.push_back({owner_id, buffer});
+      last_owner_id_ = owner_id;
+      last_ = buffer.get();
+    }
+
+   private:
+    struct Entry {
+      uint64_t owner_id;
+      std::weak_ptr<ThreadBuffer> buffer;
+    };
+
+    // Ids start at 1, so no instance matches the initial value.
+    uint64_t last_owner_id_ = 0;
+    ThreadBuffer* last_ = nullptr;
+    std::vector<Entry> entries_;
+  };
+
+  ThreadBuffer* GetThreadBuffer() {
+    static thread_local ThreadCache cache;
+    if (ThreadBuffer* buffer = cache.Find(id_)) return buffer;
+    auto buffer = RegisterThreadBuffer();
+    cache.Add(id_, buffer);
+    return buffer.get();
+  }
+
+  std::shared_ptr<ThreadBuffer> RegisterThreadBuffer() {
+    auto buffer = std::make_shared<ThreadBuffer>(std::this_thread::get_id(),
+                                                 capacity_per_thread_);
+    std::lock_guard<std::mutex> lock(mutex_);
+    buffers_.push_back(buffer);
+    return buffer;
+  }
+
+  // Distinguishes instances in the per-thread buffer cache, since an address
+  // may be reused by a later instance.
+  const uint64_t id_;
+  const size_t capacity_per_thread_;
+
+  mutable std::mutex mutex_;
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers_;
+};
+
+// Drains ThreadEventBuffers every `interval` on a dedicated thread, so that
+// the recording threads never process events.
+template <typename Event>
+class EventCollector {
+ public:
+  using ConsumeFn = llvm::unique_function<void(std::thread::id, Event&&)>;
+
+  EventCollector(ThreadEventBuffers<Event>* buffers,
+                 std::chrono::milliseconds interval, ConsumeFn consume)
+      : buffers_(buffers),
+        interval_(interval),
+        consume_(std::move(consume)),
+        thread_([this] { Run(); }) {}
+
+  // Stops the thread after a final drain.
+  ~EventCollector() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    cond_.notify_one();
+    thread_.join();
+  }
+
+  EventCollector(const EventCollector&) = delete;
+  EventCollector& operator=(const EventCollector&) = delete;
+
+ private:
+  void Run() {
+    auto consume = [this](std::thread::id tid, Event&& event) {
+      consume_(tid, std::move(event));
+    };
+    std::unique_lock<std::mutex> lock(mutex_);
+    // Drains once more after the stop request, which picks up the events
+    // recorded before it.
+    for (bool stop = false; !stop;) {
+      stop = cond_.wait_for(lock, interval_, [this] { return stop_; });
+      lock.unlock();
+      buffers_->Drain(consume);
+      lock.lock();
+    }
+  }
+
+  ThreadEventBuffers<Event>* const buffers_;
+  const std::chrono::milliseconds interval_;
+  ConsumeFn consume_;
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  bool stop_ = false;
+  std::thread thread_;
+};
+
+using TraceRingBuffer = RingBuffer<TraceEvent>;
+using TraceBuffers = ThreadEventBuffers<TraceEvent>;
+using TraceCollector = EventCollector<TraceEvent>;
+
+}  // namespace tracing
+}  // namespace tfrt
+
+#endif  // TFRT_TRACING_TRACE_BUFFERS_H_
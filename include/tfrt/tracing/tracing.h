@@ -103,6 +103,15 @@ extern std::atomic<TracingLevel> kCurrentTracingLevel;
 // Tracing needs to be disabled during registration.
 void RegisterTracingSink(TracingSink* tracing_sink);
 
+// Makes `tracing_sink` selectable with SelectTracingSink(name). It is also
+// registered with RegisterTracingSink() if no sink is registered yet, so that a
+// binary linking a single sink uses it by default.
+void AddNamedTracingSink(llvm::StringRef name, TracingSink* tracing_sink);
+
+// Registers the sink added with AddNamedTracingSink(name). Tracing needs to be
+// disabled.
+Error SelectTracingSink(llvm::StringRef name);
+
 // Returns the current tracing level.
 inline TracingLevel GetCurrentTracingLevel() {
   return internal::kCurrentTracingLevel.load(std::memory_order_acquire);
@@ -0,0 +1,105 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file declares helpers to benchmark individual kernels with KernelRunner
+// on generated inputs, without writing MLIR.
+
+#ifndef TFRT_UTILS_KERNEL_BENCHMARK_H_
+#define TFRT_UTILS_KERNEL_BENCHMARK_H_
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "llvm/Support/Error.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/utils/kernel_runner.h"
+
+namespace tfrt {
+
+// The kernel to benchmark and how to call it.
+//
+// Arguments are given in order as one of:
+//   "chain"           a Chain,
+//   "<dtype>"         a scalar, e.g. "i32",
+//   "<dtype>[<dims>]" a DenseHostTensor, e.g. "f32[8,32,32,3]" or "f32[]".
+// Scalars and tensors are filled with random values.
+//
+// Attributes are given in order as one of:
+//   "str:<string>", "<dtype>:<value>" or "<dtype>[]:<value>,...", e.g.
+//   "str:same", "f32:0.001" or "i64[]:1,1". Only i32, i64, f32 and f64 are
+//   supported for non-string attributes.
+struct KernelBenchmarkOptions {
+  std::string kernel_name;
+  std::vector<std::string> arguments;
+  std::vector<std::string> attributes;
+  size_t num_results = 1;
+};
+
+struct KernelBenchmarkStats {
+  int num_threads = 0;
+  // The number of kernel runs over all threads.
+  int64_t num_runs = 0;
+  // The wall time of a run on one thread.
+  double ns_per_run = 0;
+  // The bytes of the scalar and tensor arguments of the runs per second of
+  // wall time over all threads.
+  double bytes_per_second = 0;
+};
+
+// Return a KernelRunner for `options` with generated arguments, or an error if
+// the kernel is not registered with `host` or the options are malformed.
+Expected<std::unique_ptr<KernelRunner>> CreateKernelBenchmarkRunner(
+    const KernelBenchmarkOptions& options, HostContext* host);
+
+// Return the bytes of the scalar and tensor arguments of `options`.
+Expected<size_t> GetKernelBenchmarkArgumentBytes(
+    const KernelBenchmarkOptions& options);
+
+// Run the kernel on `num_threads` threads, each with arguments of its own, for
+// at least `min_time` after one warm-up run per thread. Returns the first
+// error of the warm-up runs, if any.
+Expected<KernelBenchmarkStats> RunKernelBenchmark(
+    const KernelBenchmarkOptions& options, int num_threads,
+    std::chrono::milliseconds min_time, HostContext* host);
+
+// Benchmark function for the benchmark library, which runs the kernel on the
+// threads of `state`. Errors are reported with SkipWithError().
+void BenchmarkKernel(benchmark::State& state,
+                     const KernelBenchmarkOptions& options, HostContext* host);
+
+// Define a benchmark of a kernel, e.g.
+//
+//   TFRT_KERNEL_BENCHMARK(BM_Conv2D, GetHost(),
+//                         {"eigen.conv2d.f32",
+//                          {"f32[8,32,32,3]", "f32[3,3,3,16]",
+//                           "f32[8,32,32,16]", "chain"},
+//                          {"str:same", "i64[]:1,1"}})
+//       ->ThreadRange(1, 8);
+#define TFRT_KERNEL_BENCHMARK(name, host, ...)                    \
+  static void name(::benchmark::State& state) {                   \
+    ::tfrt::BenchmarkKernel(                                      \
+        state, ::tfrt::KernelBenchmarkOptions __VA_ARGS__, host); \
+  }                                                               \
+  BENCHMARK(name)->UseRealTime()
+
+}  // namespace tfrt
+
+#endif  // TFRT_UTILS_KERNEL_BENCHMARK_H_
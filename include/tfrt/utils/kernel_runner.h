@@ -19,6 +19,7 @@
 
 #include <cstddef>
 #include <cstring>
+#include <string>
 #include <type_traits>
 
 #include "tfrt/bef/bef_buffer.h"
@@ -103,6 +104,10 @@ class KernelRunner {
                             : results_[index]->get<T>();
   }
 
+  // Return the error reported by the last run, which is the first error
+  // result of an async kernel or the error set by a sync kernel.
+  Error GetRunError() const;
+
   template <typename T, typename... Args>
   KernelRunner& AddRequestContextData(Args&&... args) {
     assert(!req_ctx_ &&
@@ -161,6 +166,8 @@ class KernelRunner {
 
   llvm::SmallVector<Value, 8> sync_arguments_;
   llvm::SmallVector<Value, 8> sync_results_;
+  // The error set by the sync kernel in the last run, if any.
+  std::string sync_error_;
 
   ResourceContext resource_ctx_;
   RequestContextBuilder req_ctx_builder_;
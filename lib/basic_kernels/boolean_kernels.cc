@@ -15,6 +15,7 @@
 // This file implements host executor kernels for boolean types.
 
 #include "tfrt/basic_kernels/basic_kernels.h"
+#include "tfrt/host_context/kernel_registry.h"
 #include "tfrt/host_context/kernel_utils.h"
 
 namespace tfrt {
@@ -39,10 +40,14 @@ bool TFRTAnd(bool arg0, bool arg1) { return arg0 && arg1; }
 // Registration
 //===----------------------------------------------------------------------===//
 
-void RegisterBooleanKernels(KernelRegistry* registry) {
-  registry->AddKernel("tfrt.constant.i1", TFRT_KERNEL(TFRTConstantI1));
+constexpr StaticKernel kBooleanKernels[] = {
+    {"tfrt.constant.i1", TFRT_KERNEL(TFRTConstantI1)},
+
+    {"tfrt.and.i1", TFRT_KERNEL(TFRTAnd)},
+};
 
-  registry->AddKernel("tfrt.and.i1", TFRT_KERNEL(TFRTAnd));
+void RegisterBooleanKernels(KernelRegistry* registry) {
+  registry->AddKernelTable(kBooleanKernels);
 }
 
 }  // namespace tfrt
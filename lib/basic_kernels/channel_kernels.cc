@@ -0,0 +1,215 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements the kernels that create, feed and consume channels of
+// values of any type, which connect producers and consumers in pipelines and
+// pass unbounded input sequences to streaming loops.
+
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "llvm/ADT/STLExtras.h"
+#include "tfrt/basic_kernels/basic_kernels.h"
+#include "tfrt/host_context/async_dispatch.h"
+#include "tfrt/host_context/async_value.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/channel.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/function.h"
+#include "tfrt/host_context/kernel_registry.h"
+#include "tfrt/host_context/kernel_utils.h"
+#include "tfrt/support/ref_count.h"
+
+namespace tfrt {
+namespace {
+
+using PoppedValue = std::optional<RCReference<AsyncValue>>;
+
+RCReference<AsyncValueChannel> TFRTChannelCreate(Attribute<int64_t> capacity) {
+  return MakeRef<AsyncValueChannel>(capacity.get());
+}
+
+// The value to push and the chain are the remaining arguments, so that the
+// value can be of any type.
+AsyncValueRef<Chain> TFRTChannelPush(
+    Argument<RCReference<AsyncValueChannel>> channel, RemainingArguments args) {
+  assert(args.size() == 2 && "expected a value and a chain");
+  return (*channel)->Push(FormRef(args[0]));
+}
+
+// The results are the popped value, whether there was a value, and a chain.
+// Once the channel is closed and empty the value is an error.
+void TFRTChannelPop(Argument<RCReference<AsyncValueChannel>> channel,
+                    Chain chain, RemainingResults results) {
+  assert(results.size() == 3 && "expected a value, an i1 and a chain");
+  auto value = results.AllocateIndirectResultAt(0);
+  auto valid = MakeUnconstructedAsyncValueRef<bool>();
+  results[1] = valid.CopyRCRef();
+  results[2] = GetReadyChain().ReleaseRCRef();
+
+  auto popped = (*channel)->Pop();
+  popped.AndThen([popped = popped.CopyRef(), value = std::move(value),
+                  valid = std::move(valid)]() mutable {
+    if (popped.IsError()) {
+      value->SetError(popped.GetError());
+      valid.SetError(popped.GetError());
+    } else if (!popped->has_value()) {
+      value->SetError(absl::OutOfRangeError("pop from a closed channel"));
+      valid.emplace(false);
+    } else {
+      value->ForwardTo(std::move(**popped));
+      valid.emplace(true);
+    }
+  });
+}
+
+Chain TFRTChannelClose(Argument<RCReference<AsyncValueChannel>> channel,
+                       Chain chain) {
+  (*channel)->Close();
+  return Chain();
+}
+
+// The state of a tfrt.stream.for loop, which outlives the kernel invocation
+// while the loop waits for elements.
+class StreamForLoop : public ReferenceCounted<StreamForLoop> {
+ public:
+  StreamForLoop(const ExecutionContext& exec_ctx, const Function* body_fn,
+                RCReference<AsyncValueChannel> channel,
+                std::vector<RCReference<AsyncValue>> state,
+                std::vector<RCReference<IndirectAsyncValue>> results)
+      : exec_ctx_(exec_ctx),
+        body_fn_(FormRef(body_fn)),
+        channel_(std::move(channel)),
+        state_(std::move(state)),
+        results_(std::move(results)) {}
+
+  // Call the body on the elements of the channel in order, until the channel
+  // ends or there is no element yet. The body is called on an element once the
+  // state of the previous one is available, so that a fast producer is
+  // throttled by the channel instead of queuing up calls.
+  void Run() {
+    while (true) {
+      if (!llvm::all_of(state_, [](const RCReference<AsyncValue>& value) {
+            return value->IsAvailable();
+          })) {
+        RunWhenReady(state_, [loop = FormRef(this)] { loop->Run(); });
+        return;
+      }
+
+      auto element = channel_->Pop();
+      if (!element.IsAvailable()) {
+        element.AndThen([loop = FormRef(this), element = element.CopyRef()] {
+          if (loop->CallBody(element)) loop->Run();
+        });
+        return;
+      }
+      if (!CallBody(element)) return;
+    }
+  }
+
+ private:
+  // Call the body on `element` and return true, or set the results and return
+  // false at the end of the channel.
+  bool CallBody(const AsyncValueRef<PoppedValue>& element) {
+    if (element.IsError() || !element->has_value()) {
+      for (size_t i = 0; i < results_.size(); ++i) {
+        if (element.IsError())
+          results_[i]->SetError(element.GetError());
+        else
+          results_[i]->ForwardTo(std::move(state_[i]));
+      }
+      return false;
+    }
+
+    // The state is passed from call to call as is, so values the body does not
+    // change are not copied.
+    std::vector<AsyncValue*> body_args;
+    body_args.reserve(state_.size() + 1);
+    body_args.push_back(element->value().get());
+    for (auto& value : state_) body_args.push_back(value.get());
+    std::vector<RCReference<AsyncValue>> body_results(state_.size());
+    body_fn_->Execute(exec_ctx_, body_args, body_results);
+    state_ = std::move(body_results);
+    return true;
+  }
+
+  ExecutionContext exec_ctx_;
+  RCReference<const Function> body_fn_;
+  RCReference<AsyncValueChannel> channel_;
+  std::vector<RCReference<AsyncValue>> state_;
+  std::vector<RCReference<IndirectAsyncValue>> results_;
+};
+
+// TFRTStreamFor() implements the tfrt.stream.for kernel, eg.
+//  %results = tfrt.stream.for %channel @body(%args) : (i32) -> (i32)
+//
+//  %channel: The channel whose elements the body is called on.
+//  %args: The initial state of the loop.
+//  %results: The state after the last element of the channel. The number and
+//    types of results are the same as the number and types of arguments.
+//  %body: The body function that takes an element and the state and returns
+//    the next state.
+//
+// The pseudo code:
+//
+//  for (element : channel) {
+//    args = body(element, args)
+//  }
+//  return args
+//
+void TFRTStreamFor(Argument<RCReference<AsyncValueChannel>> channel,
+                   RemainingArguments args, RemainingResults results,
+                   Attribute<Function> body_fn_const,
+                   KernelErrorHandler handler,
+                   const ExecutionContext& exec_ctx) {
+  const Function* body_fn = &(*body_fn_const);
+  if (body_fn->num_arguments() != args.size() + 1 ||
+      body_fn->num_results() != args.size() ||
+      results.size() != args.size()) {
+    handler.ReportError(
+        "tfrt.stream.for body must take an element and the state and return "
+        "the state");
+    return;
+  }
+
+  std::vector<RCReference<AsyncValue>> state;
+  state.reserve(args.size());
+  for (auto* arg : args.values()) state.push_back(FormRef(arg));
+
+  // The loop may end after the kernel returns.
+  std::vector<RCReference<IndirectAsyncValue>> loop_results;
+  loop_results.reserve(results.size());
+  for (int i = 0; i < results.size(); ++i)
+    loop_results.push_back(results.AllocateIndirectResultAt(i));
+
+  auto loop =
+      MakeRef<StreamForLoop>(exec_ctx, body_fn, *channel, std::move(state),
+                             std::move(loop_results));
+  loop->Run();
+}
+
+}  // namespace
+
+void RegisterChannelKernels(KernelRegistry* registry) {
+  registry->AddKernel("tfrt.channel.create", TFRT_KERNEL(TFRTChannelCreate));
+  registry->AddKernel("tfrt.channel.push", TFRT_KERNEL(TFRTChannelPush));
+  registry->AddKernel("tfrt.channel.pop", TFRT_KERNEL(TFRTChannelPop));
+  registry->AddKernel("tfrt.channel.close", TFRT_KERNEL(TFRTChannelClose));
+  registry->AddKernel("tfrt.stream.for", TFRT_KERNEL(TFRTStreamFor));
+}
+
+}  // namespace tfrt
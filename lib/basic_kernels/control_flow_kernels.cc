@@ -15,18 +15,31 @@
 // This file implements core control flow related kernels.
 
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
 #include <iterator>
+#include <memory>
+#include <string>
 #include <utility>
+#include <vector>
 
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "tfrt/bef_executor/bef_file.h"
 #include "tfrt/host_context/async_dispatch.h"
 #include "tfrt/host_context/async_value.h"
 #include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/chain.h"
 #include "tfrt/host_context/concurrent_work_queue.h"
 #include "tfrt/host_context/diagnostic.h"
 #include "tfrt/host_context/function.h"
+#include "tfrt/host_context/function_result_cache.h"
 #include "tfrt/host_context/kernel_frame.h"
 #include "tfrt/host_context/kernel_utils.h"
+#include "tfrt/host_context/resource_context.h"
+#include "tfrt/host_context/sync_kernel_frame.h"
+#include "tfrt/host_context/value.h"
 #include "tfrt/support/error_util.h"
 #include "tfrt/support/rc_array.h"
 #include "tfrt/support/ref_count.h"
@@ -48,6 +61,69 @@ static void TFRTCall(RemainingArguments args, RemainingResults results,
   fn->Execute(exec_ctx, args.values(), results.values());
 }
 
+// TFRTSyncCall() implements the tfrt_sync.call kernel, which calls a sync
+// function or a native function with a sync implementation from a sync
+// function on the Values of the caller, eg.
+//  %result = "tfrt_sync.call"(%arg) {callee = @square} : (i32) -> i32
+static void TFRTSyncCall(SyncKernelFrame* frame) {
+  assert(frame->GetNumAttributes() == 1 && "expected one callee");
+  const auto* fn = static_cast<const Function*>(frame->GetAttributeAt(0));
+  assert(fn->num_arguments() == frame->GetNumArgs() &&
+         "argument count mismatch");
+  assert(fn->num_results() == frame->GetNumResults() &&
+         "result count mismatch");
+
+  llvm::SmallVector<Value*, 4> arguments;
+  for (int i = 0, e = frame->GetNumArgs(); i != e; ++i)
+    arguments.push_back(frame->GetArgAt(i));
+  llvm::SmallVector<Value*, 4> results;
+  for (int i = 0, e = frame->GetNumResults(); i != e; ++i)
+    results.push_back(frame->GetResultAt(i));
+
+  if (auto error = ExecuteSyncBEFFunction(*fn, frame->GetExecutionContext(),
+                                          arguments, results))
+    frame->SetError(std::move(error));
+}
+
+// TFRTMemoizedCall() implements the tfrt.memoized_call kernel, eg.
+//  %result = tfrt.memoized_call @square(%arg) : (i32) -> i32
+static void TFRTMemoizedCall(RemainingArguments args, RemainingResults results,
+                             Attribute<Function> fn,
+                             const ExecutionContext& exec_ctx) {
+  assert(fn->num_arguments() == args.size() && "argument count mismatch");
+  assert(fn->num_results() == results.size() && "result count mismatch");
+
+  std::string key;
+  if (!exec_ctx.resource_context() ||
+      !EncodeMemoizationKey(args.values(), &key)) {
+    fn->Execute(exec_ctx, args.values(), results.values());
+    return;
+  }
+
+  auto* cache =
+      exec_ctx.resource_context()->GetOrCreateResource<FunctionResultCache>(
+          "tfrt.function_result_cache");
+  if (cache->Lookup(&fn.get(), key, results.values())) return;
+
+  fn->Execute(exec_ctx, args.values(), results.values());
+
+  // Only cache the results once they are known not to be errors, so that a
+  // transient failure is retried by the next call.
+  llvm::SmallVector<RCReference<AsyncValue>, 4> values;
+  values.reserve(results.size());
+  for (auto& result : results.values()) values.push_back(result.CopyRef());
+  llvm::SmallVector<AsyncValue*, 4> pending;
+  for (auto& value : values) pending.push_back(value.get());
+  RunWhenReady(pending, [cache, fn = &fn.get(), key = std::move(key),
+                         values = std::move(values)]() {
+    if (llvm::any_of(values, [](const RCReference<AsyncValue>& value) {
+          return value->IsError();
+        }))
+      return;
+    cache->Insert(fn, key, values);
+  });
+}
+
 static void TFRTCase(RemainingArguments args, RemainingResults results,
                      RemainingFunctions branches,
                      const ExecutionContext& exec_ctx) {
@@ -225,6 +301,195 @@ static void TFRTIf(RemainingArguments args, RemainingResults results,
   });
 }
 
+namespace {
+
+// The state of a tfrt.cond.speculative or tfrt.case.speculative call site. It
+// counts how often each branch was taken to predict the next one. The counts
+// are updated without synchronizing the branches with each other, so they are
+// only approximate under concurrent executions.
+class BranchPredictionState : public KernelCallSiteState {
+ public:
+  // A branch is predicted once it was taken for at least three quarters of
+  // kMinSamples or more executions. The counts are halved every kMaxSamples
+  // executions, so that the prediction follows changes of the branch taken.
+  static constexpr uint32_t kMinSamples = 4;
+  static constexpr uint32_t kMaxSamples = 1024;
+
+  // Prepares the branches for execution, so that a mispredicted branch does
+  // not pay for it either.
+  explicit BranchPredictionState(ArrayRef<const Function*> branches)
+      : counts_(branches.size()) {
+    for (const Function* branch : branches) {
+      branch->Prepare();
+      auto is_chain = [](TypeName type) {
+        return type.GetName() == "!tfrt.chain";
+      };
+      if (llvm::any_of(branch->argument_types(), is_chain) ||
+          llvm::any_of(branch->result_types(), is_chain))
+        speculative_ = false;
+    }
+  }
+
+  // Returns the branch to execute before the branch index is known, or -1.
+  int Predict() const {
+    if (!speculative_) return -1;
+    uint32_t total = 0;
+    int best = -1;
+    uint32_t best_count = 0;
+    for (int i = 0, e = counts_.size(); i != e; ++i) {
+      const uint32_t count = counts_[i].load(std::memory_order_relaxed);
+      total += count;
+      if (count > best_count) {
+        best = i;
+        best_count = count;
+      }
+    }
+    if (total < kMinSamples || best_count * 4 < total * 3) return -1;
+    return best;
+  }
+
+  void RecordTaken(int branch) {
+    counts_[branch].fetch_add(1, std::memory_order_relaxed);
+    if (num_samples_.fetch_add(1, std::memory_order_relaxed) % kMaxSamples ==
+        kMaxSamples - 1) {
+      for (auto& count : counts_)
+        count.store(count.load(std::memory_order_relaxed) / 2,
+                    std::memory_order_relaxed);
+    }
+  }
+
+ private:
+  std::vector<std::atomic<uint32_t>> counts_;
+  std::atomic<uint32_t> num_samples_{0};
+  bool speculative_ = true;
+};
+
+}  // namespace
+
+// Returns the branch of a tfrt.cond.speculative selected by `condition`.
+static int SelectCondBranch(const AsyncValue& condition, int num_branches) {
+  return condition.get<bool>() ? 0 : 1;
+}
+
+// Returns the branch of a tfrt.case.speculative selected by `branch_index`.
+// The last branch is the default branch, as for tfrt.case.
+static int SelectCaseBranch(const AsyncValue& branch_index, int num_branches) {
+  const int index = branch_index.get<int>();
+  return index < 0 || index >= num_branches ? num_branches - 1 : index;
+}
+
+// Executes the branch that `select` picks by the first argument, and executes
+// the predicted branch speculatively if the first argument is not available
+// yet.
+static void ExecuteSpeculativeBranch(
+    ArrayRef<const Function*> branches,
+    int (*select)(const AsyncValue&, int), RemainingArguments args,
+    RemainingResults results, const ExecutionContext& exec_ctx,
+    AsyncKernelFrame* frame) {
+  BranchPredictionState* state = nullptr;
+  if (KernelCallSiteSlot* slot = frame->GetCallSiteSlot()) {
+    state = &slot->GetOrCreate<BranchPredictionState>(
+        [&] { return std::make_unique<BranchPredictionState>(branches); });
+  }
+
+  AsyncValue* selector = args[0];
+  if (selector->IsAvailable()) {
+    if (selector->IsError()) {
+      for (auto& result : results.values()) result = FormRef(selector);
+      return;
+    }
+    const int branch = select(*selector, branches.size());
+    if (state) state->RecordTaken(branch);
+    branches[branch]->Execute(exec_ctx, args.values().drop_front(),
+                              results.values());
+    return;
+  }
+
+  // The results of the predicted branch are discarded if it is not taken, but
+  // its execution is not cancelled.
+  const int predicted = state ? state->Predict() : -1;
+  llvm::SmallVector<RCReference<AsyncValue>, 4> speculative_results(
+      results.size());
+  if (predicted >= 0) {
+    branches[predicted]->Execute(exec_ctx, args.values().drop_front(),
+                                 speculative_results);
+  }
+
+  RCArray<AsyncValue> arg_refs(args.values());
+  llvm::SmallVector<RCReference<IndirectAsyncValue>, 4> result_refs;
+  result_refs.reserve(results.size());
+  for (int i = 0, e = results.size(); i != e; ++i)
+    result_refs.push_back(results.AllocateIndirectResultAt(i));
+  // The branches keep the call site state alive, as it belongs to the same BEF
+  // file.
+  llvm::SmallVector<RCReference<const Function>, 4> branch_refs;
+  branch_refs.reserve(branches.size());
+  for (const Function* branch : branches)
+    branch_refs.push_back(FormRef(branch));
+
+  selector->AndThen([exec_ctx, select, state, predicted,
+                     branch_refs = std::move(branch_refs),
+                     arg_refs = std::move(arg_refs),
+                     result_refs = std::move(result_refs),
+                     speculative_results =
+                         std::move(speculative_results)]() mutable {
+    AsyncValue* selector = arg_refs[0];
+    if (selector->IsError()) {
+      for (auto& result : result_refs) result->ForwardTo(FormRef(selector));
+      return;
+    }
+
+    const int branch = select(*selector, branch_refs.size());
+    if (state) state->RecordTaken(branch);
+    if (branch != predicted) {
+      speculative_results.clear();
+      speculative_results.resize(result_refs.size());
+      branch_refs[branch]->Execute(exec_ctx, arg_refs.values().drop_front(),
+                                   speculative_results);
+    }
+    for (int i = 0, e = result_refs.size(); i != e; ++i)
+      result_refs[i]->ForwardTo(std::move(speculative_results[i]));
+  });
+}
+
+// TFRTSpeculativeCond() implements the tfrt.cond.speculative kernel, eg.
+//  %result = tfrt.cond.speculative %cond @true_fn @false_fn (%arg)
+//    : (i32) -> (i32)
+static void TFRTSpeculativeCond(RemainingArguments args,
+                                RemainingResults results,
+                                Attribute<Function> true_fn,
+                                Attribute<Function> false_fn,
+                                const ExecutionContext& exec_ctx,
+                                AsyncKernelFrame* frame) {
+  assert(args.size() > 0);
+  assert(true_fn->num_arguments() == args.size() - 1 &&
+         "argument count mismatch");
+  assert(true_fn->num_results() == results.size() && "result count mismatch");
+
+  const Function* branches[] = {&(*true_fn), &(*false_fn)};
+  ExecuteSpeculativeBranch(branches, SelectCondBranch, args, results, exec_ctx,
+                           frame);
+}
+
+// TFRTSpeculativeCase() implements the tfrt.case.speculative kernel, eg.
+//  %result = tfrt.case.speculative %index [@branch0, @branch1] (%arg)
+//    : (i32) -> (i32)
+static void TFRTSpeculativeCase(RemainingArguments args,
+                                RemainingResults results,
+                                RemainingFunctions branches,
+                                const ExecutionContext& exec_ctx,
+                                AsyncKernelFrame* frame) {
+  assert(args.size() >= 1);
+  assert(branches.size() > 0);
+
+  llvm::SmallVector<const Function*, 4> branch_vector;
+  branch_vector.reserve(branches.size());
+  for (int i = 0, e = branches.size(); i != e; ++i)
+    branch_vector.push_back(&(*branches.Get(i)));
+  ExecuteSpeculativeBranch(branch_vector, SelectCaseBranch, args, results,
+                           exec_ctx, frame);
+}
+
 static void TFRTWhileInlineImpl(
     const ExecutionContext& exec_ctx, const Function* body_fn,
     RCReference<AsyncValue> condition,
@@ -301,11 +566,21 @@ static void TFRTWhileInlineImpl(
   }
 }
 
+// The iterations of a pipelined tfrt.while that have been started but whose
+// results are not all available yet, oldest first. Each chain becomes available
+// when all results of its iteration are available.
+using InFlightIterations = std::deque<AsyncValueRef<Chain>>;
+
+// Start the next iteration as soon as `condition` is available, while keeping
+// at most `max_in_flight` iterations in flight. An iteration only waits for the
+// loop-carried values it actually uses, so iterations overlap whenever the
+// condition is computed before the other results of the body.
 static void TFRTWhileAsyncImpl(
     const ExecutionContext& exec_ctx, const Function* body_fn,
     RCReference<AsyncValue> condition,
     std::vector<RCReference<AsyncValue>> body_args,
-    std::vector<RCReference<IndirectAsyncValue>> while_results) {
+    std::vector<RCReference<IndirectAsyncValue>> while_results,
+    int64_t max_in_flight, InFlightIterations in_flight) {
   assert(condition->IsAvailable());
   assert(body_args.size() == while_results.size());
 
@@ -333,11 +608,33 @@ static void TFRTWhileAsyncImpl(
     return;
   }
 
+  while (!in_flight.empty() && in_flight.front().IsAvailable())
+    in_flight.pop_front();
+
+  // If the window is full, wait for the oldest iteration. Iterations mostly
+  // finish in order, so this rarely waits longer than necessary.
+  if (static_cast<int64_t>(in_flight.size()) >= max_in_flight) {
+    AsyncValue* oldest = in_flight.front().GetAsyncValue();
+    oldest->AndThen([exec_ctx, body_fn, condition = std::move(condition),
+                     body_args = std::move(body_args),
+                     while_results = std::move(while_results), max_in_flight,
+                     in_flight = std::move(in_flight)]() mutable {
+      TFRTWhileAsyncImpl(exec_ctx, body_fn, std::move(condition),
+                         std::move(body_args), std::move(while_results),
+                         max_in_flight, std::move(in_flight));
+    });
+    return;
+  }
+
   std::vector<RCReference<AsyncValue>> body_results;
   body_results.resize(body_args.size() + 1);
 
   body_fn->ExecuteAsync(exec_ctx, std::move(body_args), body_results);
 
+  auto done = MakeUnconstructedAsyncValueRef<Chain>();
+  RunWhenReady(body_results, [done = done.CopyRef()]() { done.emplace(); });
+  in_flight.push_back(std::move(done));
+
   // The last result from the body is the condition for the next iteration.
   RCReference<AsyncValue> next_condition = std::move(body_results.back());
   body_results.pop_back();
@@ -346,9 +643,11 @@ static void TFRTWhileAsyncImpl(
   next_condition_av->AndThen(
       [exec_ctx, body_fn, next_condition = std::move(next_condition),
        next_body_args = std::move(body_results),
-       while_results = std::move(while_results)]() mutable {
+       while_results = std::move(while_results), max_in_flight,
+       in_flight = std::move(in_flight)]() mutable {
         TFRTWhileAsyncImpl(exec_ctx, body_fn, std::move(next_condition),
-                           std::move(next_body_args), std::move(while_results));
+                           std::move(next_body_args), std::move(while_results),
+                           max_in_flight, std::move(in_flight));
       });
 }
 
@@ -405,13 +704,13 @@ static void TFRTWhile(RemainingArguments args, RemainingResults results,
   }
 
   if (parallel_iterations.get() > 1) {
-    // Invoke execution of the iterations asynchronously. If there are no data
-    // dependencies between iterations, they will be executed in parallel using
-    // the work_queue in `exec_ctx`.
-    //
-    // TODO(chky): Implement concurrency control based on `parallel_iterations`.
+    // Invoke execution of the iterations asynchronously and pipeline them. Up
+    // to `parallel_iterations` iterations are in flight at once, and run in
+    // parallel using the work_queue in `exec_ctx` as far as their data
+    // dependencies allow.
     TFRTWhileAsyncImpl(exec_ctx, body_fn, std::move(condition),
-                       std::move(body_args), std::move(while_results));
+                       std::move(body_args), std::move(while_results),
+                       parallel_iterations.get(), InFlightIterations());
   } else {
     // Invoke execution of the iterations inline.
     TFRTWhileInlineImpl(exec_ctx, body_fn, std::move(condition),
@@ -419,32 +718,96 @@ static void TFRTWhile(RemainingArguments args, RemainingResults results,
   }
 }
 
+namespace {
+
+struct TFRTOnceResource {
+  explicit TFRTOnceResource(size_t num_results) : results(num_results) {
+    for (auto& result : results) result = MakeIndirectAsyncValue();
+  }
+
+  llvm::SmallVector<RCReference<IndirectAsyncValue>, 4> results;
+  std::atomic<bool> executed = {false};
+};
+
+// The state of a tfrt.once call site. It holds the name of the resource, and
+// caches the resource of the first resource context the function was launched
+// in, so that later executions in that context, e.g. the requests to a model,
+// find the results with one atomic load instead of a lookup by name.
+class TFRTOnceCallSiteState : public KernelCallSiteState {
+ public:
+  explicit TFRTOnceCallSiteState(const Function& function)
+      : resource_name_(("tfrt.once @" + function.name()).str()) {}
+
+  ~TFRTOnceCallSiteState() override {
+    delete cached_.load(std::memory_order_relaxed);
+  }
+
+  string_view resource_name() const { return resource_name_; }
+
+  // Returns the resource of `context` if it is cached, which implies that the
+  // function has been launched.
+  TFRTOnceResource* Lookup(const ResourceContext& context) const {
+    const CachedResource* cached = cached_.load(std::memory_order_acquire);
+    if (cached == nullptr || cached->context_id != context.id())
+      return nullptr;
+    return cached->resource;
+  }
+
+  // Caches `resource` of `context` unless a resource is cached already.
+  void Cache(const ResourceContext& context, TFRTOnceResource* resource) {
+    if (cached_.load(std::memory_order_relaxed) != nullptr) return;
+    auto cached = std::make_unique<CachedResource>(
+        CachedResource{context.id(), resource});
+    const CachedResource* expected = nullptr;
+    if (cached_.compare_exchange_strong(expected, cached.get(),
+                                        std::memory_order_acq_rel))
+      cached.release();
+  }
+
+ private:
+  struct CachedResource {
+    uint64_t context_id;
+    TFRTOnceResource* resource;
+  };
+
+  const std::string resource_name_;
+  std::atomic<const CachedResource*> cached_{nullptr};
+};
+
+}  // namespace
+
 // TFRTOnce() implements the tfrt.once kernel, eg.
 //  %result = tfrt.once @body(%arg) : (i32) -> (i32)
 static void TFRTOnce(RemainingArguments args, RemainingResults results,
                      Attribute<Function> function,
-                     const ExecutionContext& exec_ctx) {
+                     const ExecutionContext& exec_ctx,
+                     AsyncKernelFrame* frame) {
   assert(function->num_arguments() == args.size());
   assert(function->num_results() == results.size());
 
-  if (!exec_ctx.resource_context()) {
+  ResourceContext* resource_context = exec_ctx.resource_context();
+  if (!resource_context) {
     auto error = MakeErrorAsyncValueRef("tfrt.once requires resource context");
     for (auto& result : results.values()) result = error.CopyRef();
     return;
   }
 
-  struct TFRTOnceResource {
-    explicit TFRTOnceResource(size_t num_results) : results(num_results) {
-      for (auto& result : results) result = MakeIndirectAsyncValue();
+  TFRTOnceCallSiteState* state = nullptr;
+  std::string resource_name;
+  if (KernelCallSiteSlot* slot = frame->GetCallSiteSlot()) {
+    state = &slot->GetOrCreate<TFRTOnceCallSiteState>(
+        [&] { return std::make_unique<TFRTOnceCallSiteState>(*function); });
+    if (TFRTOnceResource* resource = state->Lookup(*resource_context)) {
+      llvm::copy(resource->results, results.values().begin());
+      return;
     }
+  } else {
+    resource_name = ("tfrt.once @" + function->name()).str();
+  }
 
-    llvm::SmallVector<RCReference<IndirectAsyncValue>, 4> results;
-    std::atomic<bool> executed = {false};
-  };
-
-  auto resource =
-      exec_ctx.resource_context()->GetOrCreateResource<TFRTOnceResource>(
-          ("tfrt.once @" + function->name()).str(), function->num_results());
+  auto resource = resource_context->GetOrCreateResource<TFRTOnceResource>(
+      state ? state->resource_name() : string_view(resource_name),
+      function->num_results());
 
   // Execute the function after unlocking the resource context mutex.
   if (!resource->executed.exchange(true)) {
@@ -454,6 +817,7 @@ static void TFRTOnce(RemainingArguments args, RemainingResults results,
     for (auto pair : llvm::zip_first(resource->results, values))
       std::get<0>(pair)->ForwardTo(std::get<1>(pair));
   }
+  if (state) state->Cache(*resource_context, resource);
 
   llvm::copy(resource->results, results.values().begin());
 }
@@ -643,11 +1007,17 @@ void RegisterControlFlowKernels(KernelRegistry* registry) {
   registry->AddKernel("tfrt.alias.value", TFRT_KERNEL(TFRTAliasValue));
   registry->AddKernel("tfrt.repeat.i32", TFRT_KERNEL(TFRTRepeatI32));
   registry->AddKernel("tfrt.call", TFRT_KERNEL(TFRTCall));
+  registry->AddKernel("tfrt.memoized_call", TFRT_KERNEL(TFRTMemoizedCall));
   registry->AddKernel("tfrt.if", TFRT_KERNEL(TFRTIf));
   registry->AddKernel("tfrt.cond", TFRT_KERNEL(TFRTIf));
   registry->AddKernel("tfrt.case", TFRT_KERNEL(TFRTCase));
+  registry->AddKernel("tfrt.cond.speculative",
+                      TFRT_KERNEL(TFRTSpeculativeCond));
+  registry->AddKernel("tfrt.case.speculative",
+                      TFRT_KERNEL(TFRTSpeculativeCase));
   registry->AddKernel("tfrt.while", TFRT_KERNEL(TFRTWhile));
   registry->AddKernel("tfrt.once", TFRT_KERNEL(TFRTOnce));
+  registry->AddSyncKernel("tfrt_sync.call", TFRTSyncCall);
 }
 
 }  // namespace tfrt
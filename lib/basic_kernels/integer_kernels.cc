@@ -16,6 +16,7 @@
 
 #include "llvm_derived/Support/raw_ostream.h"
 #include "tfrt/basic_kernels/basic_kernels.h"
+#include "tfrt/host_context/kernel_registry.h"
 #include "tfrt/host_context/kernel_utils.h"
 #include "tfrt/host_context/sync_kernel_utils.h"
 #include "tfrt/support/error_util.h"
@@ -120,46 +121,42 @@ static Tout TFRTCast(Tin value) {
 // Registration
 //===----------------------------------------------------------------------===//
 
+constexpr StaticKernel kIntegerKernels[] = {
+    {"tfrt.constant.i32", TFRT_KERNEL(TFRTConstant<int32_t>)},
+    {"tfrt.constant.i64", TFRT_KERNEL(TFRTConstant<int64_t>)},
+    {"tfrt.constant.ui32", TFRT_KERNEL(TFRTConstant<uint32_t>)},
+    {"tfrt.constant.ui64", TFRT_KERNEL(TFRTConstant<uint64_t>)},
+
+    {"tfrt.add.i32", TFRT_KERNEL(TFRTAdd<int32_t>)},
+    {"tfrt.add.i64", TFRT_KERNEL(TFRTAdd<int64_t>)},
+
+    {"tfrt.minus.i32", TFRT_KERNEL(TFRTMinus<int32_t>)},
+    {"tfrt.minus.i64", TFRT_KERNEL(TFRTMinus<int64_t>)},
+
+    {"tfrt.equal.i32", TFRT_KERNEL(TFRTEqual<int32_t>)},
+    {"tfrt.equal.i64", TFRT_KERNEL(TFRTEqual<int64_t>)},
+
+    {"tfrt.lessequal.i32", TFRT_KERNEL(TFRTLessEqual<int32_t>)},
+    {"tfrt.lessequal.i64", TFRT_KERNEL(TFRTLessEqual<int64_t>)},
+
+    {"tfrt.div.i32", TFRT_KERNEL(TFRTDiv<int32_t>)},
+    {"tfrt.div.i64", TFRT_KERNEL(TFRTDiv<int64_t>)},
+
+    {"tfrt.mul.i32", TFRT_KERNEL(TFRTMul<int32_t>)},
+    {"tfrt.mul.i64", TFRT_KERNEL(TFRTMul<int64_t>)},
+
+    {"tfrt.print.i1", TFRT_KERNEL(TFRTPrintI1)},
+    {"tfrt.print.i32", TFRT_KERNEL(TFRTPrintI32)},
+    {"tfrt.print.i64", TFRT_KERNEL(TFRTPrintI64)},
+
+    {"tfrt.cast.i64_to_f32", TFRT_KERNEL(TFRTCast<int64_t, float>)},
+    {"tfrt.cast.f32_to_i64", TFRT_KERNEL(TFRTCast<float, int64_t>)},
+    {"tfrt.cast.i64_to_f64", TFRT_KERNEL(TFRTCast<int64_t, double>)},
+    {"tfrt.cast.f64_to_i64", TFRT_KERNEL(TFRTCast<double, int64_t>)},
+};
+
 void RegisterIntegerKernels(KernelRegistry* registry) {
-  registry->AddKernel("tfrt.constant.i32", TFRT_KERNEL(TFRTConstant<int32_t>));
-  registry->AddKernel("tfrt.constant.i64", TFRT_KERNEL(TFRTConstant<int64_t>));
-  registry->AddKernel("tfrt.constant.ui32",
-                      TFRT_KERNEL(TFRTConstant<uint32_t>));
-  registry->AddKernel("tfrt.constant.ui64",
-                      TFRT_KERNEL(TFRTConstant<uint64_t>));
-
-  registry->AddKernel("tfrt.add.i32", TFRT_KERNEL(TFRTAdd<int32_t>));
-  registry->AddKernel("tfrt.add.i64", TFRT_KERNEL(TFRTAdd<int64_t>));
-
-  registry->AddKernel("tfrt.minus.i32", TFRT_KERNEL(TFRTMinus<int32_t>));
-  registry->AddKernel("tfrt.minus.i64", TFRT_KERNEL(TFRTMinus<int64_t>));
-
-  registry->AddKernel("tfrt.equal.i32", TFRT_KERNEL(TFRTEqual<int32_t>));
-  registry->AddKernel("tfrt.equal.i64", TFRT_KERNEL(TFRTEqual<int64_t>));
-
-  registry->AddKernel("tfrt.lessequal.i32",
-                      TFRT_KERNEL(TFRTLessEqual<int32_t>));
-  registry->AddKernel("tfrt.lessequal.i64",
-                      TFRT_KERNEL(TFRTLessEqual<int64_t>));
-
-  registry->AddKernel("tfrt.div.i32", TFRT_KERNEL(TFRTDiv<int32_t>));
-  registry->AddKernel("tfrt.div.i64", TFRT_KERNEL(TFRTDiv<int64_t>));
-
-  registry->AddKernel("tfrt.mul.i32", TFRT_KERNEL(TFRTMul<int32_t>));
-  registry->AddKernel("tfrt.mul.i64", TFRT_KERNEL(TFRTMul<int64_t>));
-
-  registry->AddKernel("tfrt.print.i1", TFRT_KERNEL(TFRTPrintI1));
-  registry->AddKernel("tfrt.print.i32", TFRT_KERNEL(TFRTPrintI32));
-  registry->AddKernel("tfrt.print.i64", TFRT_KERNEL(TFRTPrintI64));
-
-  registry->AddKernel("tfrt.cast.i64_to_f32",
-                      TFRT_KERNEL(TFRTCast<int64_t, float>));
-  registry->AddKernel("tfrt.cast.f32_to_i64",
-                      TFRT_KERNEL(TFRTCast<float, int64_t>));
-  registry->AddKernel("tfrt.cast.i64_to_f64",
-                      TFRT_KERNEL(TFRTCast<int64_t, double>));
-  registry->AddKernel("tfrt.cast.f64_to_i64",
-                      TFRT_KERNEL(TFRTCast<double, int64_t>));
+  registry->AddKernelTable(kIntegerKernels);
 }
 
 }  // namespace tfrt
@@ -51,7 +51,10 @@ void createArgs(ArrayRef<OpAsmParser::UnresolvedOperand> operands,
 // CallOp
 //===----------------------------------------------------------------------===//
 
-ParseResult CallOp::parse(OpAsmParser &parser, OperationState &result) {
+// Parse the syntax shared by tfrt.call and tfrt.memoized_call:
+//   @callee(%operands...) attr-dict : (operand types) -> result types
+static ParseResult parseCallLikeOp(OpAsmParser &parser,
+                                   OperationState &result) {
   SymbolRefAttr calleeAttr;
   FunctionType calleeType;
   SmallVector<OpAsmParser::UnresolvedOperand, 4> operands;
@@ -68,46 +71,60 @@ ParseResult CallOp::parse(OpAsmParser &parser, OperationState &result) {
   return success();
 }
 
-void CallOp::print(OpAsmPrinter &p) {
-  p << " " << (*this)->getAttr("callee") << '(';
-  p.printOperands(getOperands());
+static void printCallLikeOp(OpAsmPrinter &p, Operation *op) {
+  p << " " << op->getAttr("callee") << '(';
+  p.printOperands(op->getOperands());
   p << ')';
-  p.printOptionalAttrDict((*this)->getAttrs(), /*elidedAttrs=*/{"callee"});
+  p.printOptionalAttrDict(op->getAttrs(), /*elidedAttrs=*/{"callee"});
   p << " : ";
-  p.printType(getCalleeType());
+  p.printType(FunctionType::get(op->getContext(), op->getOperandTypes(),
+                                op->getResultTypes()));
 }
 
-LogicalResult CallOp::verify() {
-  CallOp op = *this;
+// Verify that `op` calls a function whose type matches the operands and
+// results of `op`, and return the function in `callee`.
+static LogicalResult verifyCallLikeOp(Operation *op, func::FuncOp &callee) {
   // Check that the callee attribute was specified.
   auto fnAttr = op->getAttrOfType<FlatSymbolRefAttr>("callee");
   if (!fnAttr)
-    return op.emitOpError("requires a 'callee' symbol reference attribute");
+    return op->emitOpError("requires a 'callee' symbol reference attribute");
   auto fn = op->getParentOfType<ModuleOp>().lookupSymbol<func::FuncOp>(
       fnAttr.getValue());
   if (!fn)
-    return op.emitOpError() << "'" << fnAttr.getValue()
-                            << "' does not reference a valid function";
+    return op->emitOpError() << "'" << fnAttr.getValue()
+                             << "' does not reference a valid function";
 
   // Verify that the operand and result types match the callee.
   auto fnType = fn.getFunctionType();
-  if (fnType.getNumInputs() != op.getNumOperands())
-    return op.emitOpError("incorrect number of operands for callee");
+  if (fnType.getNumInputs() != op->getNumOperands())
+    return op->emitOpError("incorrect number of operands for callee");
 
   for (unsigned i = 0, e = fnType.getNumInputs(); i != e; ++i)
-    if (op.getOperand(i).getType() != fnType.getInput(i))
-      return op.emitOpError("operand type mismatch");
+    if (op->getOperand(i).getType() != fnType.getInput(i))
+      return op->emitOpError("operand type mismatch");
 
-  if (fnType.getNumResults() != op.getNumResults())
-    return op.emitOpError("incorrect number of results for callee");
+  if (fnType.getNumResults() != op->getNumResults())
+    return op->emitOpError("incorrect number of results for callee");
 
   for (unsigned i = 0, e = fnType.getNumResults(); i != e; ++i)
-    if (op.getResult(i).getType() != fnType.getResult(i))
-      return op.emitOpError("result type mismatch");
+    if (op->getResult(i).getType() != fnType.getResult(i))
+      return op->emitOpError("result type mismatch");
 
+  callee = fn;
   return success();
 }
 
+ParseResult CallOp::parse(OpAsmParser &parser, OperationState &result) {
+  return parseCallLikeOp(parser, result);
+}
+
+void CallOp::print(OpAsmPrinter &p) { printCallLikeOp(p, *this); }
+
+LogicalResult CallOp::verify() {
+  func::FuncOp callee;
+  return verifyCallLikeOp(*this, callee);
+}
+
 mlir::FunctionType CallOp::getCalleeType() {
   return FunctionType::get(getContext(), getOperandTypes(), getResultTypes());
 }
@@ -144,6 +161,41 @@ void CallOp::setCalleeFromCallable(CallInterfaceCallable callee) {
   return setOperand(0, callee.get<Value>());
 }
 
+//===----------------------------------------------------------------------===//
+// MemoizedCallOp
+//===----------------------------------------------------------------------===//
+
+ParseResult MemoizedCallOp::parse(OpAsmParser &parser,
+                                  OperationState &result) {
+  return parseCallLikeOp(parser, result);
+}
+
+void MemoizedCallOp::print(OpAsmPrinter &p) { printCallLikeOp(p, *this); }
+
+LogicalResult MemoizedCallOp::verify() {
+  func::FuncOp callee;
+  if (failed(verifyCallLikeOp(*this, callee))) return failure();
+
+  // Only the author of the function knows that it has no side effects.
+  if (!callee->hasAttr("tfrt.memoize"))
+    return emitOpError() << "callee '" << callee.getName()
+                         << "' is not marked with 'tfrt.memoize'";
+
+  // A chain orders side effects, so a function that takes or returns one is
+  // not pure.
+  auto is_chain = [](Type type) { return type.isa<compiler::ChainType>(); };
+  auto fnType = callee.getFunctionType();
+  if (llvm::any_of(fnType.getInputs(), is_chain) ||
+      llvm::any_of(fnType.getResults(), is_chain))
+    return emitOpError("memoized callee must not take or return a chain");
+
+  return success();
+}
+
+mlir::FunctionType MemoizedCallOp::getCalleeType() {
+  return FunctionType::get(getContext(), getOperandTypes(), getResultTypes());
+}
+
 //===----------------------------------------------------------------------===//
 // IfOp
 //===----------------------------------------------------------------------===//
@@ -256,8 +308,9 @@ void IfOp::print(OpAsmPrinter &p) {
 // CondOp
 //===----------------------------------------------------------------------===//
 
-LogicalResult CondOp::verify() {
-  CondOp op = *this;
+// Verify a tfrt.cond or tfrt.cond.speculative op.
+template <typename OpTy>
+static LogicalResult VerifyCondOp(OpTy op) {
   // Check that the true/false function attributes are specified.
   auto trueFnAttr = op->getAttrOfType<FlatSymbolRefAttr>("a_true_fn");
   if (!trueFnAttr)
@@ -313,6 +366,10 @@ LogicalResult CondOp::verify() {
   return success();
 }
 
+LogicalResult CondOp::verify() { return VerifyCondOp(*this); }
+
+LogicalResult SpeculativeCondOp::verify() { return VerifyCondOp(*this); }
+
 //===----------------------------------------------------------------------===//
 // RepeatI32Op
 //===----------------------------------------------------------------------===//
@@ -382,10 +439,11 @@ LogicalResult RepeatI32Op::verify() {
 }
 
 //===----------------------------------------------------------------------===//
-// ParallelForI32Op
+// ParallelForI32Op and ParallelForI64Op
 //===----------------------------------------------------------------------===//
 
-// Parse tfrt.parallel_for.i32 operation.
+// Parse tfrt.parallel_for.i32 and tfrt.parallel_for.i64 operations with
+// `index_width` bit indices.
 //
 // Expected format:
 //
@@ -394,18 +452,23 @@ LogicalResult RepeatI32Op::verify() {
 //     ... parallel block compute function ...
 //     tfrt.return ... : !tfrt.chain
 //   }
-ParseResult ParallelForI32Op::parse(OpAsmParser &parser,
-                                    OperationState &result) {
+static ParseResult parseParallelFor(OpAsmParser &parser,
+                                    OperationState &result,
+                                    unsigned index_width) {
   OpAsmParser::UnresolvedOperand start;
   OpAsmParser::UnresolvedOperand end;
   OpAsmParser::UnresolvedOperand block_size;
 
-  // Parse parallel for bounds: %start to %end fixed %block_size
+  // Parse parallel for bounds: %start to %end (fixed|adaptive) %block_size
   if (parser.parseOperand(start) || parser.parseKeyword("to") ||
-      parser.parseOperand(end) || parser.parseKeyword("fixed") ||
-      parser.parseOperand(block_size)) {
+      parser.parseOperand(end))
+    return failure();
+  if (succeeded(parser.parseOptionalKeyword("adaptive"))) {
+    result.addAttribute("adaptive", parser.getBuilder().getBoolAttr(true));
+  } else if (parser.parseKeyword("fixed")) {
     return failure();
   }
+  if (parser.parseOperand(block_size)) return failure();
 
   // Parse additional parallel for operands.
   SmallVector<OpAsmParser::UnresolvedOperand, 4> operands;
@@ -419,10 +482,10 @@ ParseResult ParallelForI32Op::parse(OpAsmParser &parser,
   if (parser.parseOptionalColonTypeList(types)) return failure();
 
   // Resolve parsed parallel for bounds operands ...
-  auto i32_type = IntegerType::get(result.getContext(), 32);
-  if (parser.resolveOperand(start, i32_type, result.operands) ||
-      parser.resolveOperand(end, i32_type, result.operands) ||
-      parser.resolveOperand(block_size, i32_type, result.operands)) {
+  auto index_type = IntegerType::get(result.getContext(), index_width);
+  if (parser.resolveOperand(start, index_type, result.operands) ||
+      parser.resolveOperand(end, index_type, result.operands) ||
+      parser.resolveOperand(block_size, index_type, result.operands)) {
     return failure();
   }
 
@@ -437,7 +500,7 @@ ParseResult ParallelForI32Op::parse(OpAsmParser &parser,
   // Parallel for body operands and types.
   SmallVector<OpAsmParser::UnresolvedOperand, 6> body_operands = {start, end};
   for (auto &operand : operands) body_operands.push_back(operand);
-  SmallVector<Type, 6> body_operands_types = {i32_type, i32_type};
+  SmallVector<Type, 6> body_operands_types = {index_type, index_type};
   for (auto &type : types) body_operands_types.push_back(type);
 
   SmallVector<OpAsmParser::Argument> body_args;
@@ -447,34 +510,35 @@ ParseResult ParallelForI32Op::parse(OpAsmParser &parser,
                             /*enableNameShadowing=*/true);
 }
 
-void ParallelForI32Op::print(OpAsmPrinter &p) {
+template <typename OpTy>
+static void printParallelFor(OpTy op, OpAsmPrinter &p) {
   p << " ";
 
-  p.printOperand(getOperand(0));
+  p.printOperand(op.getOperand(0));
   p << " to ";
-  p.printOperand(getOperand(1));
-  p << " fixed ";
-  p.printOperand(getOperand(2));
+  p.printOperand(op.getOperand(1));
+  p << (op->hasAttr("adaptive") ? " adaptive " : " fixed ");
+  p.printOperand(op.getOperand(2));
 
-  if (getNumOperands() > 3) {
+  if (op.getNumOperands() > 3) {
     p << ", ";
-    p.printOperands(llvm::drop_begin(getOperands(), 3));
+    p.printOperands(llvm::drop_begin(op.getOperands(), 3));
     p << " : ";
-    interleaveComma(llvm::drop_begin(getOperandTypes(), 3), p);
+    interleaveComma(llvm::drop_begin(op.getOperandTypes(), 3), p);
   }
 
   // Reuse the argument names provided to the op for the bbarg names within
   // the region (except block_size argument).
-  SmallVector<Value, 4> arg_name_values(getOperands());
+  SmallVector<Value, 4> arg_name_values(op.getOperands());
   arg_name_values.erase(arg_name_values.begin() + 2);
 
-  p.shadowRegionArgs(getRegion(), arg_name_values);
+  p.shadowRegionArgs(op.getRegion(), arg_name_values);
   p << ' ';
-  p.printRegion(getRegion(), /*printEntryBlockArgs=*/false);
+  p.printRegion(op.getRegion(), /*printEntryBlockArgs=*/false);
 }
 
-LogicalResult ParallelForI32Op::verify() {
-  ParallelForI32Op op = *this;
+template <typename OpTy>
+static LogicalResult verifyParallelFor(OpTy op) {
   auto *block = &op.getRegion().front();
   if (block->empty() || !isa<ReturnOp>(block->back()))
     return op.emitOpError("expected tfrt.return in body");
@@ -488,18 +552,38 @@ LogicalResult ParallelForI32Op::verify() {
   return checkTFRTReturn(op, &op.getRegion(), op.getResultTypes());
 }
 
+ParseResult ParallelForI32Op::parse(OpAsmParser &parser,
+                                    OperationState &result) {
+  return parseParallelFor(parser, result, /*index_width=*/32);
+}
+
+void ParallelForI32Op::print(OpAsmPrinter &p) { printParallelFor(*this, p); }
+
+LogicalResult ParallelForI32Op::verify() { return verifyParallelFor(*this); }
+
+ParseResult ParallelForI64Op::parse(OpAsmParser &parser,
+                                    OperationState &result) {
+  return parseParallelFor(parser, result, /*index_width=*/64);
+}
+
+void ParallelForI64Op::print(OpAsmPrinter &p) { printParallelFor(*this, p); }
+
+LogicalResult ParallelForI64Op::verify() { return verifyParallelFor(*this); }
+
 //===----------------------------------------------------------------------===//
-// ParallelCallI32Op
+// ParallelCallI32Op and ParallelCallI64Op
 //===----------------------------------------------------------------------===//
 
-// Parse tfrt.parallel_call.i32 operation.
+// Parse tfrt.parallel_call.i32 and tfrt.parallel_call.i64 operations with
+// `index_width` bit indices.
 //
 // Expected format:
 //
 //   %ch = tfrt.parallel_call.i32 %start to %end fixed %block_size
 //         @callee(%loop_arg0) : !my.type
-ParseResult ParallelCallI32Op::parse(OpAsmParser &parser,
-                                     OperationState &result) {
+static ParseResult parseParallelCall(OpAsmParser &parser,
+                                     OperationState &result,
+                                     unsigned index_width) {
   OpAsmParser::UnresolvedOperand start;
   OpAsmParser::UnresolvedOperand end;
   OpAsmParser::UnresolvedOperand block_size;
@@ -527,10 +611,10 @@ ParseResult ParallelCallI32Op::parse(OpAsmParser &parser,
   if (parser.parseOptionalColonTypeList(types)) return failure();
 
   // Resolve parsed parallel call bounds operands ...
-  auto i32_type = IntegerType::get(result.getContext(), 32);
-  if (parser.resolveOperand(start, i32_type, result.operands) ||
-      parser.resolveOperand(end, i32_type, result.operands) ||
-      parser.resolveOperand(block_size, i32_type, result.operands)) {
+  auto index_type = IntegerType::get(result.getContext(), index_width);
+  if (parser.resolveOperand(start, index_type, result.operands) ||
+      parser.resolveOperand(end, index_type, result.operands) ||
+      parser.resolveOperand(block_size, index_type, result.operands)) {
     return failure();
   }
 
@@ -545,29 +629,30 @@ ParseResult ParallelCallI32Op::parse(OpAsmParser &parser,
   return success();
 }
 
-void ParallelCallI32Op::print(OpAsmPrinter &p) {
+template <typename OpTy>
+static void printParallelCall(OpTy op, OpAsmPrinter &p) {
   p << " ";
 
-  p.printOperand(getOperand(0));
+  p.printOperand(op.getOperand(0));
   p << " to ";
-  p.printOperand(getOperand(1));
+  p.printOperand(op.getOperand(1));
   p << " fixed ";
-  p.printOperand(getOperand(2));
+  p.printOperand(op.getOperand(2));
   p << " ";
 
-  p << (*this)->getAttr("callee");
+  p << op->getAttr("callee");
   p << '(';
-  p.printOperands(llvm::drop_begin(getOperands(), 3));
+  p.printOperands(llvm::drop_begin(op.getOperands(), 3));
   p << ')';
 
-  if (getNumOperands() > 3) {
+  if (op.getNumOperands() > 3) {
     p << " : ";
-    interleaveComma(llvm::drop_begin(getOperandTypes(), 3), p);
+    interleaveComma(llvm::drop_begin(op.getOperandTypes(), 3), p);
   }
 }
 
-LogicalResult ParallelCallI32Op::verify() {
-  ParallelCallI32Op op = *this;
+template <typename OpTy>
+static LogicalResult verifyParallelCall(OpTy op) {
   // Check that the callee attribute was specified.
   auto fnAttr = op->getAttrOfType<FlatSymbolRefAttr>("callee");
   if (!fnAttr)
@@ -585,9 +670,9 @@ LogicalResult ParallelCallI32Op::verify() {
   if (fnType.getNumInputs() != op.getNumOperands() - 1)
     return op.emitOpError("incorrect number of callee operands");
 
-  auto i32_type = IntegerType::get(op.getContext(), 32);
+  auto index_type = op.getOperand(0).getType();
   for (unsigned i = 0; i != 2; ++i) {
-    if (fnType.getInput(i) != i32_type)
+    if (fnType.getInput(i) != index_type)
       return op.emitOpError("callee must take stard and end indices first");
   }
 
@@ -611,6 +696,24 @@ LogicalResult ParallelCallI32Op::verify() {
   return success();
 }
 
+ParseResult ParallelCallI32Op::parse(OpAsmParser &parser,
+                                     OperationState &result) {
+  return parseParallelCall(parser, result, /*index_width=*/32);
+}
+
+void ParallelCallI32Op::print(OpAsmPrinter &p) { printParallelCall(*this, p); }
+
+LogicalResult ParallelCallI32Op::verify() { return verifyParallelCall(*this); }
+
+ParseResult ParallelCallI64Op::parse(OpAsmParser &parser,
+                                     OperationState &result) {
+  return parseParallelCall(parser, result, /*index_width=*/64);
+}
+
+void ParallelCallI64Op::print(OpAsmPrinter &p) { printParallelCall(*this, p); }
+
+LogicalResult ParallelCallI64Op::verify() { return verifyParallelCall(*this); }
+
 //===----------------------------------------------------------------------===//
 // ReturnOp
 //===----------------------------------------------------------------------===//
@@ -16,12 +16,21 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
+#include "absl/status/status.h"  // from @com_google_absl
+#include "tfrt/bef_executor/bef_interpreter.h"
 #include "tfrt/host_context/function.h"
 #include "tfrt/host_context/host_context.h"
 #include "tfrt/host_context/kernel_utils.h"
 #include "tfrt/host_context/parallel_for.h"
+#include "tfrt/host_context/value.h"
+#include "tfrt/support/error_util.h"
 #include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
 #include "tfrt/support/ref_count.h"
 
 namespace tfrt {
@@ -31,8 +40,9 @@ namespace {
 // Executes parallel for operation with an asynchronous body function: body
 // function returns a chain to signal its completion.
 //--------------------------------------------------------------------------- //
+template <typename IndexT>
 static AsyncValueRef<Chain> ExecuteAsyncParallelForBody(
-    const ExecutionContext& exec_ctx, size_t total_size, size_t offset,
+    const ExecutionContext& exec_ctx, size_t total_size, IndexT offset,
     ParallelFor::BlockSizes& block_sizes, RemainingArguments args,
     const Function* body_fn) {
   // Parallel for block function.
@@ -40,10 +50,10 @@ static AsyncValueRef<Chain> ExecuteAsyncParallelForBody(
                   args = RCArray<AsyncValue>(args.values())](size_t start,
                                                              size_t end) {
     // Pack parallel block arguments into async values.
-    auto start_arg = MakeAvailableAsyncValueRef<int32_t>(
-        static_cast<int32_t>(start + offset));
+    auto start_arg = MakeAvailableAsyncValueRef<IndexT>(
+        static_cast<IndexT>(start) + offset);
     auto end_arg =
-        MakeAvailableAsyncValueRef<int32_t>(static_cast<int32_t>(end + offset));
+        MakeAvailableAsyncValueRef<IndexT>(static_cast<IndexT>(end) + offset);
 
     llvm::SmallVector<AsyncValue*, 6> fn_args = {start_arg.GetAsyncValue(),
                                                  end_arg.GetAsyncValue()};
@@ -74,8 +84,9 @@ static AsyncValueRef<Chain> ExecuteAsyncParallelForBody(
 // function has empty results, and all kernels are completed synchronously
 // in the caller thread.
 //--------------------------------------------------------------------------- //
+template <typename IndexT>
 static AsyncValueRef<Chain> ExecuteSyncParallelForBody(
-    const ExecutionContext& exec_ctx, size_t total_size, size_t offset,
+    const ExecutionContext& exec_ctx, size_t total_size, IndexT offset,
     ParallelFor::BlockSizes& block_sizes, RemainingArguments args,
     const Function* body_fn) {
   // Parallel for block function.
@@ -83,10 +94,10 @@ static AsyncValueRef<Chain> ExecuteSyncParallelForBody(
                   args = RCArray<AsyncValue>(args.values())](size_t start,
                                                              size_t end) {
     // Pack parallel block arguments into async values.
-    auto start_arg = MakeAvailableAsyncValueRef<int32_t>(
-        static_cast<int32_t>(start + offset));
+    auto start_arg = MakeAvailableAsyncValueRef<IndexT>(
+        static_cast<IndexT>(start) + offset);
     auto end_arg =
-        MakeAvailableAsyncValueRef<int32_t>(static_cast<int32_t>(end + offset));
+        MakeAvailableAsyncValueRef<IndexT>(static_cast<IndexT>(end) + offset);
 
     llvm::SmallVector<AsyncValue*, 6> fn_args = {start_arg.GetAsyncValue(),
                                                  end_arg.GetAsyncValue()};
@@ -111,28 +122,133 @@ static AsyncValueRef<Chain> ExecuteSyncParallelForBody(
 }
 
 //--------------------------------------------------------------------------- //
+// Executes parallel for operation with a SyncBEFFunction body: the blocks run
+// the body with a BEFInterpreter on unboxed start and end Values, without
+// allocating async values.
+//--------------------------------------------------------------------------- //
+
+// The interpreters and the first error of the blocks of one parallel for
+// operation. Interpreters are taken from a free list and returned to it after
+// a block, so there are at most as many interpreters as blocks that ran at the
+// same time.
+class SyncParallelForBodyState {
+ public:
+  explicit SyncParallelForBodyState(const Function* body_fn)
+      : body_fn_(body_fn) {}
+
+  void Run(const ExecutionContext& exec_ctx, Value* start, Value* end) {
+    std::unique_ptr<BEFInterpreter> interpreter = TakeInterpreter();
+    Value* args[] = {start, end};
+    if (auto error = interpreter->Execute(exec_ctx, args, {})) {
+      // The interpreter is dropped, as a failed run leaves its registers set.
+      mutex_lock lock(mu_);
+      if (error_.empty()) error_ = toString(std::move(error));
+      return;
+    }
+
+    mutex_lock lock(mu_);
+    free_interpreters_.push_back(std::move(interpreter));
+  }
+
+  // Return the first error of the blocks, or an empty string if all blocks
+  // succeeded.
+  std::string TakeError() {
+    mutex_lock lock(mu_);
+    return std::move(error_);
+  }
+
+ private:
+  std::unique_ptr<BEFInterpreter> TakeInterpreter() {
+    {
+      mutex_lock lock(mu_);
+      if (!free_interpreters_.empty()) {
+        auto interpreter = std::move(free_interpreters_.back());
+        free_interpreters_.pop_back();
+        return interpreter;
+      }
+    }
+    return std::make_unique<BEFInterpreter>(*body_fn_);
+  }
+
+  const Function* body_fn_;
+
+  mutex mu_;
+  std::vector<std::unique_ptr<BEFInterpreter>> free_interpreters_
+      TFRT_GUARDED_BY(mu_);
+  std::string error_ TFRT_GUARDED_BY(mu_);
+};
+
+template <typename IndexT>
+static AsyncValueRef<Chain> ExecuteSyncBEFParallelForBody(
+    const ExecutionContext& exec_ctx, size_t total_size, IndexT offset,
+    ParallelFor::BlockSizes& block_sizes, const Function* body_fn) {
+  auto state = std::make_shared<SyncParallelForBodyState>(body_fn);
+
+  // Parallel for block function.
+  auto compute = [exec_ctx, offset, state](size_t start, size_t end) {
+    Value start_arg(static_cast<IndexT>(start) + offset);
+    Value end_arg(static_cast<IndexT>(end) + offset);
+    state->Run(exec_ctx, &start_arg, &end_arg);
+  };
 
+  // Mark result chain completed when all parallel for blocks are completed.
+  auto done = MakeConstructedAsyncValueRef<Chain>();
+  auto on_done = [done = done.CopyRef(), state]() {
+    std::string error = state->TakeError();
+    if (error.empty()) {
+      done.SetStateConcrete();
+    } else {
+      done.SetError(absl::InternalError(error));
+    }
+  };
+
+  // Launch parallel for operation.
+  ParallelFor parallel_for(exec_ctx);
+  parallel_for.Execute(total_size, block_sizes, std::move(compute),
+                       std::move(on_done));
+
+  return done;
+}
+
+//--------------------------------------------------------------------------- //
+
+template <typename IndexT>
 static AsyncValueRef<Chain> TFRTParallelFor(const ExecutionContext& exec_ctx,
-                                            Argument<int32_t> start,
-                                            Argument<int32_t> end,
-                                            Argument<int32_t> block_size,
+                                            Argument<IndexT> start,
+                                            Argument<IndexT> end,
+                                            Argument<IndexT> block_size,
                                             RemainingArguments args,
+                                            RemainingAttributes attrs,
                                             Attribute<Function> body_fn_const) {
   const Function* body_fn = &(*body_fn_const);
 
   const size_t total_size = *end - *start;
-  const size_t offset = *start;
+  const IndexT offset = *start;
+
+  // tfrt.parallel_for has an `adaptive` attribute if the block size is the
+  // minimum size of adaptively sized blocks. tfrt.parallel_call has none.
+  const bool adaptive = attrs.size() > 0 && *attrs.Get<bool>(0);
+  auto block_sizes = adaptive ? ParallelFor::BlockSizes::Adaptive(*block_size)
+                              : ParallelFor::BlockSizes::Fixed(*block_size);
 
-  auto fixed_block_sizes = ParallelFor::BlockSizes::Fixed(*block_size);
+  if (body_fn->function_kind() == FunctionKind::kSyncBEFFunction) {
+    // TODO(b/160501723): Pass the remaining arguments to sync bodies once
+    // AsyncValues can be converted to Values.
+    if (body_fn->num_arguments() != 2 || !body_fn->result_types().empty())
+      return MakeErrorAsyncValueRef(
+          "Sync parallel body function must take only start and end indices "
+          "and have empty results");
+    return ExecuteSyncBEFParallelForBody(exec_ctx, total_size, offset,
+                                         block_sizes, body_fn);
 
-  if (body_fn->result_types().empty()) {
+  } else if (body_fn->result_types().empty()) {
     return ExecuteSyncParallelForBody(exec_ctx, total_size, offset,
-                                      fixed_block_sizes, args, body_fn);
+                                      block_sizes, args, body_fn);
 
   } else if (body_fn->result_types().size() == 1) {
     assert(body_fn->result_types()[0].GetName() == "!tfrt.chain");
     return ExecuteAsyncParallelForBody(exec_ctx, total_size, offset,
-                                       fixed_block_sizes, args, body_fn);
+                                       block_sizes, args, body_fn);
 
   } else {
     return MakeErrorAsyncValueRef(
@@ -143,8 +259,14 @@ static AsyncValueRef<Chain> TFRTParallelFor(const ExecutionContext& exec_ctx,
 }  // namespace
 
 void RegisterParallelKernels(KernelRegistry* registry) {
-  registry->AddKernel("tfrt.parallel_for.i32", TFRT_KERNEL(TFRTParallelFor));
-  registry->AddKernel("tfrt.parallel_call.i32", TFRT_KERNEL(TFRTParallelFor));
+  registry->AddKernel("tfrt.parallel_for.i32",
+                      TFRT_KERNEL(TFRTParallelFor<int32_t>));
+  registry->AddKernel("tfrt.parallel_for.i64",
+                      TFRT_KERNEL(TFRTParallelFor<int64_t>));
+  registry->AddKernel("tfrt.parallel_call.i32",
+                      TFRT_KERNEL(TFRTParallelFor<int32_t>));
+  registry->AddKernel("tfrt.parallel_call.i64",
+                      TFRT_KERNEL(TFRTParallelFor<int64_t>));
 }
 
 }  // namespace tfrt
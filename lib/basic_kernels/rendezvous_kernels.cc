@@ -0,0 +1,76 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements the kernels that pass values of any type between the
+// partitions of a function through the rendezvous of the request.
+
+#include <cassert>
+
+#include "tfrt/basic_kernels/basic_kernels.h"
+#include "tfrt/host_context/async_value.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/attribute_utils.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/kernel_registry.h"
+#include "tfrt/host_context/kernel_utils.h"
+#include "tfrt/host_context/rendezvous.h"
+#include "tfrt/support/ref_count.h"
+
+namespace tfrt {
+namespace {
+
+// Returns the rendezvous of the request, or null if it has no resource
+// context.
+Rendezvous* GetRendezvous(const ExecutionContext& exec_ctx) {
+  ResourceContext* resource_context = exec_ctx.resource_context();
+  if (resource_context == nullptr) return nullptr;
+  return GetOrCreateRendezvous(resource_context);
+}
+
+// The value to send and the chain are the remaining arguments, so that the
+// value can be of any type. The value is sent before it is available.
+AsyncValueRef<Chain> TFRTSend(RemainingArguments args, StringAttribute key,
+                              const ExecutionContext& exec_ctx) {
+  assert(args.size() == 2 && "expected a value and a chain");
+  Rendezvous* rendezvous = GetRendezvous(exec_ctx);
+  if (rendezvous == nullptr)
+    return MakeErrorAsyncValueRef("tfrt.send requires resource context");
+  rendezvous->Send(key.get(), FormRef(args[0]));
+  return GetReadyChain();
+}
+
+// The results are the received value, which becomes available once the value
+// is sent and available, and a chain.
+void TFRTRecv(Chain chain, RemainingResults results, StringAttribute key,
+              const ExecutionContext& exec_ctx) {
+  assert(results.size() == 2 && "expected a value and a chain");
+  results[1] = GetReadyChain().ReleaseRCRef();
+  Rendezvous* rendezvous = GetRendezvous(exec_ctx);
+  if (rendezvous == nullptr) {
+    results[0] =
+        MakeErrorAsyncValueRef("tfrt.recv requires resource context");
+    return;
+  }
+  results[0] = rendezvous->Recv(key.get());
+}
+
+}  // namespace
+
+void RegisterRendezvousKernels(KernelRegistry* registry) {
+  registry->AddKernel("tfrt.send", TFRT_KERNEL(TFRTSend));
+  registry->AddKernel("tfrt.recv", TFRT_KERNEL(TFRTRecv));
+}
+
+}  // namespace tfrt
@@ -29,6 +29,8 @@ static void RegisterKernels(KernelRegistry* registry) {
   RegisterControlFlowKernels(registry);
   RegisterParallelKernels(registry);
   RegisterDeviceKernels(registry);
+  RegisterChannelKernels(registry);
+  RegisterRendezvousKernels(registry);
 }
 
 TFRT_STATIC_KERNEL_REGISTRATION(RegisterKernels);
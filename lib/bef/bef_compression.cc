@@ -0,0 +1,87 @@
+/*
+ * Copyright 2021 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tfrt/bef/bef_compression.h"
+
+#include "llvm/Support/Compression.h"
+#include "tfrt/bef/bef_reader.h"
+#include "tfrt/support/error_util.h"
+
+namespace tfrt {
+namespace {
+
+llvm::compression::Format ToLlvmFormat(BEFCompressionFormat format) {
+  switch (format) {
+    case BEFCompressionFormat::kZlib:
+      return llvm::compression::Format::Zlib;
+    case BEFCompressionFormat::kZstd:
+      return llvm::compression::Format::Zstd;
+  }
+  llvm_unreachable("unknown BEF compression format");
+}
+
+bool IsValidFormat(uint8_t format) {
+  return format == static_cast<uint8_t>(BEFCompressionFormat::kZlib) ||
+         format == static_cast<uint8_t>(BEFCompressionFormat::kZstd);
+}
+
+}  // namespace
+
+bool IsBEFCompressionAvailable(BEFCompressionFormat format) {
+  return llvm::compression::getReasonIfUnsupported(ToLlvmFormat(format)) ==
+         nullptr;
+}
+
+llvm::Error CompressBEFSectionData(BEFCompressionFormat format,
+                                   ArrayRef<uint8_t> data,
+                                   llvm::SmallVectorImpl<uint8_t>* compressed) {
+  const auto llvm_format = ToLlvmFormat(format);
+  if (const char* reason =
+          llvm::compression::getReasonIfUnsupported(llvm_format))
+    return MakeStringError(reason);
+
+  compressed->clear();
+  llvm::compression::compress(llvm::compression::Params(llvm_format), data,
+                              *compressed);
+  return llvm::Error::success();
+}
+
+bool ReadCompressedBEFSection(ArrayRef<uint8_t> payload,
+                              CompressedBEFSection* section) {
+  BEFReader reader(payload);
+  uint8_t section_id, format;
+  if (!reader.ReadByte(&section_id) ||
+      section_id >= static_cast<uint8_t>(BEFSectionID::kNumSectionIDs) ||
+      section_id == static_cast<uint8_t>(BEFSectionID::kCompressed) ||
+      !reader.ReadByte(&format) || !IsValidFormat(format) ||
+      !reader.ReadVbrInt(&section->uncompressed_size))
+    return false;
+
+  section->section_id = static_cast<BEFSectionID>(section_id);
+  section->format = static_cast<BEFCompressionFormat>(format);
+  section->data = reader.file();
+  return true;
+}
+
+llvm::Error DecompressBEFSection(const CompressedBEFSection& section,
+                                 llvm::SmallVectorImpl<uint8_t>* data) {
+  data->clear();
+  return llvm::compression::decompress(ToLlvmFormat(section.format),
+                                       section.data, *data,
+                                       section.uncompressed_size);
+}
+
+}  // namespace tfrt
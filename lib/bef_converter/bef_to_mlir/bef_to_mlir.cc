@@ -22,6 +22,7 @@
 
 #include "tfrt/bef_converter/bef_to_mlir.h"
 
+#include <deque>
 #include <optional>
 #include <utility>
 #include <vector>
@@ -45,6 +46,7 @@
 #include "mlir/IR/MLIRContext.h"
 #include "mlir/Parser/Parser.h"
 #include "mlir/Support/LogicalResult.h"
+#include "tfrt/bef/bef_compression.h"
 #include "tfrt/bef/bef_encoding.h"
 #include "tfrt/bef/bef_reader.h"
 #include "tfrt/core_runtime/opdefs/attributes.h"
@@ -67,8 +69,18 @@ class BEFSections {
     sections_.at(static_cast<uint8_t>(section_id)) = section_data;
   }
 
+  // Decompresses `compressed` and sets the section it holds to the result.
+  llvm::Error SetCompressed(const CompressedBEFSection& compressed) {
+    auto& data = decompressed_.emplace_back();
+    if (auto error = DecompressBEFSection(compressed, &data)) return error;
+    Set(compressed.section_id, data);
+    return llvm::Error::success();
+  }
+
  private:
   std::vector<ArrayRef<uint8_t>> sections_;
+  // The data of the decompressed sections.
+  std::deque<llvm::SmallVector<uint8_t, 0>> decompressed_;
 };
 
 // This struct keeps the track of properties of a function (eg, offset, name,
@@ -93,6 +105,9 @@ struct BEFFunction {
     return kind == FunctionKind::kNativeFunction;
   }
   bool IsSyncFunction() const { return kind == FunctionKind::kSyncBEFFunction; }
+  bool IsFusedFunction() const {
+    return kind == FunctionKind::kFusedBEFFunction;
+  }
 };
 
 // This struct keeps the information of a BEF file.
@@ -360,7 +375,21 @@ mlir::LogicalResult BEFToMLIRConverter::ReadNextSection(BEFSections* sections) {
   if (!file_reader_.ReadSection(&section_id, &section_data))
     return mlir::failure();
   file_reader_.SkipPast(section_data);
-  sections->Set(static_cast<BEFSectionID>(section_id), section_data);
+  if (static_cast<BEFSectionID>(section_id) != BEFSectionID::kCompressed) {
+    sections->Set(static_cast<BEFSectionID>(section_id), section_data);
+    return mlir::success();
+  }
+
+  CompressedBEFSection compressed;
+  if (!ReadCompressedBEFSection(section_data, &compressed)) {
+    EmitError(bef_file_.location, "Corrupted compressed section.");
+    return mlir::failure();
+  }
+  if (auto error = sections->SetCompressed(compressed)) {
+    EmitError(bef_file_.location,
+              "Failed to decompress section: " + toString(std::move(error)));
+    return mlir::failure();
+  }
   return mlir::success();
 }
 
@@ -550,6 +579,8 @@ mlir::func::FuncOp BEFToMLIRConverter::CreateBEFFuncOp(
 
   if (bef_function.IsSyncFunction()) {
     func_op->setAttr("tfrt.sync", mlir::UnitAttr::get(&context_));
+  } else if (bef_function.IsFusedFunction()) {
+    func_op->setAttr("tfrt.fused", mlir::UnitAttr::get(&context_));
   }
   return func_op;
 }
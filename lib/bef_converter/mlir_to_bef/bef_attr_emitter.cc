@@ -16,6 +16,10 @@
 
 #include "bef_attr_emitter.h"
 
+#include <algorithm>
+#include <cstring>
+
+#include "llvm/ADT/Hashing.h"
 #include "mlir/IR/Attributes.h"
 #include "mlir/IR/Block.h"
 #include "mlir/IR/BuiltinAttributes.h"
@@ -365,6 +369,36 @@ size_t BefAttrEmitter::EmitAttribute(BEFAttributeType attribute_type,
   llvm_unreachable("Unknown attribute");
 }
 
+size_t BefAttrEmitter::EmitPooledAttribute(BEFAttributeType attribute_type,
+                                           mlir::Attribute mlir_attr) {
+  const size_t start = size();
+  const size_t offset = EmitAttribute(attribute_type, mlir_attr);
+  const size_t encoded_size = size() - offset;
+  if (encoded_size < kMinPooledAttributeSize) return offset;
+
+  const uint8_t* encoded = result_.data() + offset;
+  const uint64_t hash = llvm::hash_combine(
+      attribute_type,
+      llvm::hash_value(llvm::ArrayRef<uint8_t>(encoded, encoded_size)));
+
+  // The earlier attribute has to be aligned at least as well as the new one,
+  // which may be aligned to more than the alignment of its header.
+  const size_t alignment =
+      offset == 0 ? kAttributeMaxAlignment
+                  : std::min<size_t>(offset & -offset, kAttributeMaxAlignment);
+  auto& candidates = pooled_attributes_[hash];
+  for (const PooledAttribute& pooled : candidates) {
+    if (pooled.size == encoded_size && pooled.offset % alignment == 0 &&
+        std::memcmp(result_.data() + pooled.offset, encoded, encoded_size) ==
+            0) {
+      result_.resize(start);
+      return pooled.offset;
+    }
+  }
+  candidates.push_back({offset, encoded_size});
+  return offset;
+}
+
 size_t BefAttrEmitter::EmitArrayAttribute(BEFAttributeType attribute_type,
                                           mlir::ArrayAttr attr) {
   const auto element_count = attr.size();
@@ -20,6 +20,8 @@
 #define TFRT_LIB_BEF_CONVERTER_MLIR_TO_BEF_BEF_ATTR_EMITTER_H_
 
 #include "bef_compilation_units.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
 #include "mlir/IR/BuiltinOps.h"
 #include "tfrt/bef_converter/bef_attr_encoder.h"
 #include "tfrt/bef_converter/bef_emitter.h"
@@ -48,6 +50,15 @@ class BefAttrEmitter : public BefAttrEncoder {
   size_t EmitAttribute(BEFAttributeType attribute_type,
                        mlir::Attribute mlir_attr);
 
+  // Emit an attribute like EmitAttribute(), but if its encoding is at least
+  // kMinPooledAttributeSize bytes and identical to the encoding of an attribute
+  // pooled earlier, drop the new bytes and return the offset of the earlier
+  // attribute. MLIR already uniques attributes by value, so this catches
+  // distinct attributes with the same encoding, e.g. dense tensors of i32 and
+  // si32 elements.
+  size_t EmitPooledAttribute(BEFAttributeType attribute_type,
+                             mlir::Attribute mlir_attr);
+
   // Emit a SymbolRefAttribute.
   size_t EmitSymbolRefAttribute(BefCompilationUnits& compilation_units,
                                 mlir::SymbolRefAttr attr);
@@ -68,6 +79,16 @@ class BefAttrEmitter : public BefAttrEncoder {
 
   size_t GetAlignment(mlir::Attribute mlir_attr);
   size_t GetMaximumAlignment(mlir::ArrayAttr attr);
+
+  static constexpr size_t kMinPooledAttributeSize = 256;
+
+  struct PooledAttribute {
+    size_t offset;
+    size_t size;
+  };
+  // The pooled attributes, keyed by the hash of their type and encoding.
+  llvm::DenseMap<uint64_t, llvm::SmallVector<PooledAttribute, 1>>
+      pooled_attributes_;
 };
 
 }  // namespace tfrt
@@ -0,0 +1,72 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements the directory-backed cache of encoded BEF functions.
+
+#include "tfrt/bef_converter/bef_function_cache.h"
+
+#include <memory>
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace tfrt {
+
+std::string BefFunctionCache::EntryPath(string_view key) const {
+  llvm::SmallString<128> path(directory_);
+  llvm::sys::path::append(path, key);
+  return std::string(path.str());
+}
+
+std::optional<std::string> BefFunctionCache::Lookup(string_view key) const {
+  auto buffer = llvm::MemoryBuffer::getFile(EntryPath(key),
+                                            /*IsText=*/false,
+                                            /*RequiresNullTerminator=*/false);
+  if (!buffer) {
+    num_misses_.fetch_add(1, std::memory_order_relaxed);
+    return std::nullopt;
+  }
+  num_hits_.fetch_add(1, std::memory_order_relaxed);
+  return (*buffer)->getBuffer().str();
+}
+
+void BefFunctionCache::Insert(string_view key, string_view value) const {
+  if (llvm::sys::fs::create_directories(directory_)) return;
+
+  // Write a uniquely named temporary file in the cache directory, so that the
+  // rename that publishes it does not cross file systems.
+  const std::string path = EntryPath(key);
+  llvm::SmallString<128> temp_path;
+  int fd;
+  if (llvm::sys::fs::createUniqueFile(path + ".tmp-%%%%%%%%", fd, temp_path))
+    return;
+
+  {
+    llvm::raw_fd_ostream os(fd, /*shouldClose=*/true);
+    os << value;
+    os.close();
+    if (os.has_error()) {
+      os.clear_error();
+      llvm::sys::fs::remove(temp_path);
+      return;
+    }
+  }
+
+  if (llvm::sys::fs::rename(temp_path, path)) llvm::sys::fs::remove(temp_path);
+}
+
+}  // namespace tfrt
@@ -25,21 +25,31 @@
 
 #include "tfrt/bef_converter/mlir_to_bef.h"
 
+#include <array>
+#include <cstdint>
 #include <cstring>
+#include <memory>
 #include <optional>
+#include <string>
+#include <vector>
 
 #include "bef_attr_emitter.h"
 #include "bef_compilation_units.h"
 #include "bef_location_emitter.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/Support/Alignment.h"
 #include "llvm/Support/Casting.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/SHA256.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
 #include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/AsmState.h"
 #include "mlir/IR/Attributes.h"
 #include "mlir/IR/Block.h"
 #include "mlir/IR/BuiltinAttributes.h"
@@ -47,8 +57,11 @@
 #include "mlir/IR/BuiltinTypes.h"
 #include "mlir/IR/Operation.h"
 #include "mlir/IR/OperationSupport.h"
+#include "mlir/IR/Threading.h"
+#include "tfrt/bef/bef_compression.h"
 #include "tfrt/bef/bef_encoding.h"
 #include "tfrt/bef_converter/bef_emitter.h"
+#include "tfrt/bef_converter/bef_function_cache.h"
 #include "tfrt/compiler/stream_analysis.h"
 #include "tfrt/core_runtime/opdefs/attributes.h"
 #include "tfrt/core_runtime/opdefs/traits.h"
@@ -88,6 +101,35 @@ static bool IsSyncFunc(mlir::func::FuncOp op) {
   return !!op->getAttr("tfrt.sync");
 }
 
+static bool IsFusedFunc(mlir::func::FuncOp op) {
+  return !!op->getAttr("tfrt.fused");
+}
+
+// Returns whether the attribute `name` of an operation is passed to its
+// kernel. The cost attribute is only used by the compiler, and the timeout
+// attribute is encoded in the KernelTimeouts section for the executor.
+//
+// TODO(tfrt-devs): Use attribute interface instead of hardcoding here.
+static bool IsKernelAttribute(llvm::StringRef name) {
+  return name != "_tfrt_cost" && name != kKernelTimeoutAttrName;
+}
+
+// Appends the kernel index and the timeout of each kernel of the function in
+// `region` that has the timeout attribute to `timeouts`. The kernels are
+// numbered as in the kernel table of the function, after the pseudo kernel.
+static void CollectKernelTimeouts(
+    mlir::Region* region,
+    llvm::SmallVectorImpl<std::pair<unsigned, uint64_t>>* timeouts) {
+  unsigned kernel_index = 1;
+  for (auto& op : region->front()) {
+    if (IsReturn(&op)) continue;
+    if (auto timeout =
+            op.getAttrOfType<mlir::IntegerAttr>(kKernelTimeoutAttrName))
+      timeouts->push_back({kernel_index, timeout.getInt()});
+    ++kernel_index;
+  }
+}
+
 static mlir::FunctionType GetRegionFunctionType(mlir::Region* region) {
   // Emit information about the type of the function.
   auto& block = region->front();
@@ -389,8 +431,12 @@ LogicalResult EntityTable::Collect(mlir::ModuleOp module,
               }
             }
 
-            auto func_kind = IsSyncFunc(fn) ? FunctionKind::kSyncBEFFunction
-                                            : FunctionKind::kBEFFunction;
+            auto func_kind = FunctionKind::kBEFFunction;
+            if (IsSyncFunc(fn)) {
+              func_kind = FunctionKind::kSyncBEFFunction;
+            } else if (IsFusedFunc(fn)) {
+              func_kind = FunctionKind::kFusedBEFFunction;
+            }
             if (AddFunction(&fn.getBody(), fn.getName(), func_kind) ==
                 LogicalResult::Failure) {
               result = LogicalResult::Failure;
@@ -402,11 +448,30 @@ LogicalResult EntityTable::Collect(mlir::ModuleOp module,
 
           // Keep track of any attributes used by this op.
           for (auto attr : op->getAttrs()) {
-            // Skip cost attribute which is not used in runtime execution.
-            //
-            // TODO(tfrt-devs): Use attribute interface instead of hardcoding
-            // here.
-            if (attr.getName() == "_tfrt_cost") continue;
+            if (attr.getName() == kKernelTimeoutAttrName) {
+              auto timeout = attr.getValue().dyn_cast<mlir::IntegerAttr>();
+              if (!timeout || timeout.getInt() <= 0 ||
+                  timeout.getInt() > UINT32_MAX) {
+                op->emitError() << "'" << kKernelTimeoutAttrName
+                                << "' must be a positive number of "
+                                   "milliseconds";
+                result = LogicalResult::Failure;
+                return;
+              }
+
+              // Fused functions run their kernels back to back without the
+              // executor, which would ignore the timeout.
+              auto fn = op->getParentOfType<mlir::func::FuncOp>();
+              if (fn && IsFusedFunc(fn)) {
+                op->emitError() << "'" << kKernelTimeoutAttrName
+                                << "' is not supported in a fused function";
+                result = LogicalResult::Failure;
+                return;
+              }
+            }
+
+            // Skip the attributes that are not passed to the kernel.
+            if (!IsKernelAttribute(attr.getName())) continue;
 
             // Check to make sure that this is a supported attribute, if not,
             // reject it.
@@ -605,6 +670,38 @@ class BEFFileEmitter : public BefEmitter {
   void EmitSection(BEFSectionID section_id, const BefEmitter& emitter) {
     EmitSection(section_id, emitter.result(), emitter.GetRequiredAlignment());
   }
+
+  // Emit the section as a kCompressed section if `compression` is set, the
+  // section data needs no alignment and compressing makes it smaller.
+  // Otherwise emit it as is.
+  void EmitCompressibleSection(
+      BEFSectionID section_id, const BefEmitter& emitter,
+      std::optional<BEFCompressionFormat> compression) {
+    if (!compression.has_value() || emitter.GetRequiredAlignment() > 1 ||
+        !IsBEFCompressionAvailable(*compression)) {
+      EmitSection(section_id, emitter);
+      return;
+    }
+
+    llvm::SmallVector<uint8_t, 0> compressed;
+    if (auto error = CompressBEFSectionData(*compression, emitter.result(),
+                                            &compressed)) {
+      llvm::consumeError(std::move(error));
+      EmitSection(section_id, emitter);
+      return;
+    }
+
+    BefEmitter payload;
+    payload.EmitByte(static_cast<uint8_t>(section_id));
+    payload.EmitByte(static_cast<uint8_t>(*compression));
+    payload.EmitVbrInt(emitter.size());
+    payload.EmitBytes(compressed);
+    if (payload.size() >= emitter.size()) {
+      EmitSection(section_id, emitter);
+      return;
+    }
+    EmitSection(BEFSectionID::kCompressed, payload);
+  }
 };
 
 constexpr uint32_t BEFFileEmitter::kDummyPseudoKernelCode;
@@ -612,10 +709,14 @@ constexpr uint32_t BEFFileEmitter::kDummyPseudoKernelLocation;
 
 }  // namespace
 
+class BEFFunctionEmitter;
+
 // This is the emitter that builds a BEF into an std::vector.
 class BEFModuleEmitter : public BEFFileEmitter {
  public:
-  explicit BEFModuleEmitter(mlir::ModuleOp module) : module_(module) {}
+  BEFModuleEmitter(mlir::ModuleOp module,
+                   const BefFunctionCache* function_cache)
+      : module_(module), function_cache_(function_cache) {}
 
   LogicalResult CollectEntities(bool collect_attribute_types_and_names) {
     return entities_.Collect(module_, collect_attribute_types_and_names);
@@ -632,7 +733,16 @@ class BEFModuleEmitter : public BEFFileEmitter {
                      BEFFileEmitter* register_types);
 
  private:
+  // Encodes the function in `region`, or restores its encoding from the
+  // function cache.
+  void EmitCachedFunction(mlir::Region* region,
+                          ArrayRef<size_t> location_offsets,
+                          BEFFunctionEmitter* function,
+                          BEFFileEmitter* attribute_names,
+                          BEFFileEmitter* register_types) const;
+
   mlir::ModuleOp module_;
+  const BefFunctionCache* function_cache_;
   EntityTable entities_;
   EntityIndex entity_index_;
 };
@@ -681,7 +791,7 @@ void BEFModuleEmitter::EmitAttributes(BEFFileEmitter* attribute_types) {
         (IsSymbolRefAttribute(attribute_type))
             ? attributes_section.EmitSymbolRefAttribute(
                   compilation_units, attr.cast<mlir::SymbolRefAttr>())
-            : attributes_section.EmitAttribute(attribute_type, attr);
+            : attributes_section.EmitPooledAttribute(attribute_type, attr);
 
     entity_index_.AddAttributeOffset(attr, offset);
     if (attribute_types == nullptr) continue;
@@ -733,17 +843,60 @@ void BEFModuleEmitter::EmitTypes() {
   EmitSection(BEFSectionID::kTypes, types_section);
 }
 
-// This is the emitter that builds the function entry of a BEF.
+// This is the emitter that builds the function entry of a BEF. Each function
+// is encoded by its own emitter, which only reads the module and the entity
+// tables, so that functions can be encoded concurrently.
 class BEFFunctionEmitter : public BEFFileEmitter {
  public:
   BEFFunctionEmitter(const EntityTable& entities,
                      const EntityIndex& entity_index)
       : entities_(entities), entity_index_(entity_index) {}
 
-  void EmitFunction(mlir::Region* region, BefLocationEmitter* locations,
-                    BEFFileEmitter* attribute_names,
+  // Returns the location offsets of the function in `region`, in the order
+  // EmitFunction() uses them: the function first, then the kernels. The
+  // locations are emitted into `locations`.
+  static llvm::SmallVector<size_t, 16> EmitLocations(
+      mlir::Region* region, BefLocationEmitter* locations);
+
+  // Returns the stream ids of the function in `block`, in the order
+  // EmitFunction() uses them: the root stream first, then the stream of every
+  // kernel.
+  static llvm::SmallVector<int, 16> AnalyzeStreams(mlir::Block& block);
+
+  // Encodes the function in `region`, given its `location_offsets` from
+  // EmitLocations() and its `stream_ids` from AnalyzeStreams().
+  void EmitFunction(mlir::Region* region, ArrayRef<size_t> location_offsets,
+                    ArrayRef<int> stream_ids, BEFFileEmitter* attribute_names,
                     BEFFileEmitter* register_types);
 
+  // Returns the offsets and indices of the module entities that the encoding
+  // of the function in `region` refers to. It must list every entity that
+  // EmitFunction() encodes, as two functions with the same content and the
+  // same references have the same encoding.
+  llvm::SmallVector<uint64_t, 64> GetReferences(
+      mlir::Region* region, ArrayRef<size_t> location_offsets,
+      bool attribute_names) const;
+
+  // Serializes the encoded function and its parts of the optional sections,
+  // for a BefFunctionCache entry.
+  std::string Serialize(const BEFFileEmitter* attribute_names,
+                        const BEFFileEmitter* register_types) const;
+
+  // Restores the encoded function and its parts of the optional sections from
+  // a serialized `entry`. Returns false, and leaves the emitters unchanged, if
+  // the entry does not have the expected parts.
+  bool Restore(string_view entry, BEFFileEmitter* attribute_names,
+               BEFFileEmitter* register_types);
+
+  // Appends the encoded function to the Functions section. The kernel list is
+  // aligned relative to the start of the section, so it is kept apart until
+  // the function is placed.
+  void AppendTo(BEFFileEmitter* functions_section) const {
+    functions_section->EmitBytes(result());
+    functions_section->EmitAlignment(4);
+    functions_section->EmitEmitter(kernel_list_);
+  }
+
  private:
   void EmitRegisterTable(mlir::Block* block, BEFFileEmitter* register_types);
   template <typename UserRange>
@@ -752,7 +905,7 @@ class BEFFunctionEmitter : public BEFFileEmitter {
   void EmitArgumentsPseudoKernel(mlir::Block* block,
                                  BEFFileEmitter* kernel_list) const;
   void EmitKernel(mlir::Operation* op, BEFFileEmitter* kernel_list,
-                  BefLocationEmitter* locations,
+                  size_t location_offset,
                   BEFFileEmitter* attribute_names) const;
 
   unsigned GetRegisterNumber(mlir::Value reg) const {
@@ -772,22 +925,56 @@ class BEFFunctionEmitter : public BEFFileEmitter {
 
   llvm::DenseMap<mlir::Value, unsigned> register_number_;
   llvm::DenseMap<mlir::Operation*, unsigned> kernel_index_;
+  BEFFileEmitter kernel_list_;
 
   const EntityTable& entities_;
   const EntityIndex& entity_index_;
 };
 
+llvm::SmallVector<size_t, 16> BEFFunctionEmitter::EmitLocations(
+    mlir::Region* region, BefLocationEmitter* locations) {
+  llvm::SmallVector<size_t, 16> location_offsets;
+  location_offsets.push_back(locations->EmitOpLocation(region->getParentOp()));
+  for (auto& op : region->front()) {
+    if (!IsReturn(&op))
+      location_offsets.push_back(locations->EmitOpLocation(&op));
+  }
+  return location_offsets;
+}
+
+llvm::SmallVector<int, 16> BEFFunctionEmitter::AnalyzeStreams(
+    mlir::Block& block) {
+  // Perform stream analysis to get stream information for this function.
+  //
+  // TODO(chky): This analysis is better performed at compiler side. However,
+  // due to the limitation that asynchrony is implicit at compile-time the only
+  // choice to integrate with BEF executor is to perform analysis in MLIRToBEF.
+  // Once we make asynchrony explicit at compile-time, we should be able to move
+  // this analysis out.
+  compiler::StreamAnalysis stream_analysis(block);
+
+  llvm::SmallVector<int, 16> stream_ids;
+  stream_ids.push_back(stream_analysis.GetRootStream().id());
+  for (auto& op : block) {
+    if (!IsReturn(&op))
+      stream_ids.push_back(stream_analysis.GetStream(&op).id());
+  }
+  return stream_ids;
+}
+
 void BEFFunctionEmitter::EmitFunction(mlir::Region* region,
-                                      BefLocationEmitter* locations,
+                                      ArrayRef<size_t> location_offsets,
+                                      ArrayRef<int> stream_ids,
                                       BEFFileEmitter* attribute_names,
                                       BEFFileEmitter* register_types) {
   Reset();
+  assert(size() == 0 && kernel_list_.size() == 0 &&
+         "a function emitter encodes a single function");
 
   assert(llvm::hasSingleElement(*region) && "should have a single block");
   auto& block = region->front();
 
-  auto location_offset = locations->EmitOpLocation(region->getParentOp());
-  EmitVbrInt(location_offset);
+  EmitVbrInt(location_offsets.front());
 
   // Emit the register table.
   EmitRegisterTable(&block, register_types);
@@ -805,18 +992,11 @@ void BEFFunctionEmitter::EmitFunction(mlir::Region* region,
 
   mlir::Operation* return_op = nullptr;
 
-  BEFFileEmitter kernel_list;
+  BEFFileEmitter& kernel_list = kernel_list_;
 
   if (attribute_names != nullptr) attribute_names->EmitVbrInt(num_kernels);
 
-  // Perform stream analysis to get stream information for this function.
-  //
-  // TODO(chky): This analysis is better performed at compiler side. However,
-  // due to the limitation that asynchrony is implicit at compile-time the only
-  // choice to integrate with BEF executor is to perform analysis in MLIRToBEF.
-  // Once we make asynchrony explicit at compile-time, we should be able to move
-  // this analysis out.
-  compiler::StreamAnalysis stream_analysis(block);
+  assert(stream_ids.size() == num_kernels && "one stream id per kernel");
 
   // Before we emit all the kernels, we always emit a pseudo kernel (with no
   // kernel_code) that is the entry to the other kernels. Specifically, its
@@ -829,7 +1009,7 @@ void BEFFunctionEmitter::EmitFunction(mlir::Region* region,
   // Pseudo has zero operands that need to be available.
   EmitVbrInt(0);
   // The pseudo kernel is always in the root stream.
-  EmitVbrInt(stream_analysis.GetRootStream().id());
+  EmitVbrInt(stream_ids.front());
 
   EmitArgumentsPseudoKernel(&block, &kernel_list);
 
@@ -848,10 +1028,10 @@ void BEFFunctionEmitter::EmitFunction(mlir::Region* region,
     EmitVbrInt(num_operands_before_running);
 
     // Emit stream id from stream analysis.
-    const auto& stream = stream_analysis.GetStream(&op);
-    EmitVbrInt(stream.id());
+    EmitVbrInt(stream_ids[kernel_index_[&op]]);
 
-    EmitKernel(&op, &kernel_list, locations, attribute_names);
+    EmitKernel(&op, &kernel_list, location_offsets[kernel_index_[&op]],
+               attribute_names);
   }
 
   // Emit the result registers list at the end of the KERNEL_TABLE if present.
@@ -861,14 +1041,125 @@ void BEFFunctionEmitter::EmitFunction(mlir::Region* region,
     }
   }
 
-  // Once we're done, we can emit the kernel data after the kernel index
-  // list. Note that kernel entries are fixed32 integers with 4-byte alignment.
-  EmitAlignment(4);
-  EmitEmitter(kernel_list);
-
+  // The kernel data follows the kernel index list once the function is placed
+  // by AppendTo(). Note that kernel entries are fixed32 integers with 4-byte
+  // alignment.
   kernel_index_.clear();
 }
 
+llvm::SmallVector<uint64_t, 64> BEFFunctionEmitter::GetReferences(
+    mlir::Region* region, ArrayRef<size_t> location_offsets,
+    bool attribute_names) const {
+  llvm::SmallVector<uint64_t, 64> references(location_offsets.begin(),
+                                             location_offsets.end());
+  auto& block = region->front();
+  for (auto arg : block.getArguments())
+    references.push_back(entities_.GetTypeIndex(arg.getType()));
+
+  for (auto& op : block) {
+    for (auto result : op.getResults())
+      references.push_back(entities_.GetTypeIndex(result.getType()));
+    if (IsReturn(&op)) continue;
+
+    references.push_back(entities_.GetKernelID(&op));
+    for (auto attr_name_pair : op.getAttrs()) {
+      if (!IsKernelAttribute(attr_name_pair.getName())) continue;
+
+      if (auto array_fn_attr =
+              attr_name_pair.getValue().dyn_cast<mlir::ArrayAttr>()) {
+        if (!array_fn_attr.empty() &&
+            array_fn_attr.begin()->dyn_cast<mlir::FlatSymbolRefAttr>()) {
+          for (auto fn : array_fn_attr) {
+            references.push_back(entities_.GetFunctionNamed(
+                fn.dyn_cast<mlir::FlatSymbolRefAttr>().getValue()));
+          }
+          continue;
+        }
+      }
+
+      if (auto fn_attr =
+              attr_name_pair.getValue().dyn_cast<mlir::FlatSymbolRefAttr>()) {
+        references.push_back(entities_.GetFunctionNamed(fn_attr.getValue()));
+      } else {
+        if (attribute_names) {
+          references.push_back(
+              entity_index_.GetStringOffset(attr_name_pair.getName()));
+        }
+        references.push_back(
+            entity_index_.GetAttributeOffset(attr_name_pair.getValue()));
+      }
+    }
+
+    for (auto& op_region : op.getRegions())
+      references.push_back(entities_.GetFunctionID(op_region));
+  }
+
+  return references;
+}
+
+// A cache entry is a sequence of parts, each encoded as its alignment and size
+// (fixed64 integers) followed by its bytes.
+static void SerializePart(const BefEmitter& emitter, std::string* entry) {
+  const uint64_t header[2] = {emitter.GetRequiredAlignment(), emitter.size()};
+  entry->append(reinterpret_cast<const char*>(header), sizeof(header));
+  entry->append(reinterpret_cast<const char*>(emitter.result().data()),
+                emitter.size());
+}
+
+static bool DeserializePart(string_view* entry, BefEmitter* emitter) {
+  uint64_t header[2];
+  if (entry->size() < sizeof(header)) return false;
+  std::memcpy(header, entry->data(), sizeof(header));
+  entry->remove_prefix(sizeof(header));
+  if (header[0] == 0 || header[0] > 256 || !llvm::isPowerOf2_64(header[0]) ||
+      entry->size() < header[1])
+    return false;
+
+  // The emitter is empty, so the alignment only sets its requirement.
+  emitter->EmitAlignment(header[0]);
+  emitter->EmitBytes(llvm::ArrayRef(
+      reinterpret_cast<const uint8_t*>(entry->data()), header[1]));
+  entry->remove_prefix(header[1]);
+  return true;
+}
+
+std::string BEFFunctionEmitter::Serialize(
+    const BEFFileEmitter* attribute_names,
+    const BEFFileEmitter* register_types) const {
+  std::string entry;
+  SerializePart(*this, &entry);
+  SerializePart(kernel_list_, &entry);
+  if (attribute_names != nullptr) SerializePart(*attribute_names, &entry);
+  if (register_types != nullptr) SerializePart(*register_types, &entry);
+  return entry;
+}
+
+bool BEFFunctionEmitter::Restore(string_view entry,
+                                 BEFFileEmitter* attribute_names,
+                                 BEFFileEmitter* register_types) {
+  assert(size() == 0 && kernel_list_.size() == 0 &&
+         "a function emitter encodes a single function");
+
+  BEFFileEmitter function, kernel_list, function_attribute_names,
+      function_register_types;
+  if (!DeserializePart(&entry, &function) ||
+      !DeserializePart(&entry, &kernel_list) ||
+      (attribute_names != nullptr &&
+       !DeserializePart(&entry, &function_attribute_names)) ||
+      (register_types != nullptr &&
+       !DeserializePart(&entry, &function_register_types)) ||
+      !entry.empty())
+    return false;
+
+  EmitEmitter(function);
+  kernel_list_.EmitEmitter(kernel_list);
+  if (attribute_names != nullptr)
+    attribute_names->EmitEmitter(function_attribute_names);
+  if (register_types != nullptr)
+    register_types->EmitEmitter(function_register_types);
+  return true;
+}
+
 void BEFFunctionEmitter::EmitRegisterTable(mlir::Block* block,
                                            BEFFileEmitter* register_types) {
   BEFFileEmitter reg_table;
@@ -962,13 +1253,12 @@ void BEFFunctionEmitter::EmitArgumentsPseudoKernel(
 
 void BEFFunctionEmitter::EmitKernel(mlir::Operation* op,
                                     BEFFileEmitter* kernel_list,
-                                    BefLocationEmitter* locations,
+                                    size_t location_offset,
                                     BEFFileEmitter* attribute_names) const {
   // Each kernel starts out with an opcode record.
   kernel_list->Emit<uint32_t>(entities_.GetKernelID(op));
 
   // Include a location.
-  auto location_offset = locations->EmitOpLocation(op);
   kernel_list->Emit<uint32_t>(location_offset);
 
   // Because the numbers of each types of entries are emitted first, we use
@@ -986,10 +1276,8 @@ void BEFFunctionEmitter::EmitKernel(mlir::Operation* op,
   BEFFileEmitter input_function_emitter;
   BEFFileEmitter input_attribute_emitter;
   for (auto attr_name_pair : op->getAttrs()) {
-    // Skip cost attribute which is not used in runtime execution.
-    //
-    // TODO(tfrt-devs): Use attribute interface instead of hardcoding here.
-    if (attr_name_pair.getName() == "_tfrt_cost") continue;
+    // Skip the attributes that are not passed to the kernel.
+    if (!IsKernelAttribute(attr_name_pair.getName())) continue;
 
     // Emit array of function attributes.
     if (auto array_fn_attr =
@@ -1049,23 +1337,215 @@ void BEFFunctionEmitter::EmitKernel(mlir::Operation* op,
   kernel_list->EmitEmitter(kernel_body);
 }
 
+// The version of the function cache entries, and of the content that their
+// keys hash. It must be changed whenever the encoding of functions changes.
+constexpr char kFunctionCacheVersion[] = "tfrt-bef-function-cache-v2";
+
+// Returns the content of the function in `region`: its argument types and
+// operations, without their locations. Stream analysis also reads options from
+// the module attributes, so they are part of the content too.
+static std::string GetFunctionContent(mlir::Region* region) {
+  std::string content = kFunctionCacheVersion;
+  llvm::raw_string_ostream os(content);
+
+  mlir::Operation* parent = region->getParentOp();
+  mlir::AsmState state(parent, mlir::OpPrintingFlags().printGenericOpForm());
+  for (auto arg : region->front().getArguments()) os << arg.getType() << ',';
+  os << '\n';
+  for (auto& op : region->front()) {
+    op.print(os, state);
+    os << '\n';
+  }
+  if (auto module = parent->getParentOfType<mlir::ModuleOp>())
+    os << module->getAttrDictionary();
+
+  os.flush();
+  return content;
+}
+
+static std::string FunctionCacheKey(string_view kind, string_view material) {
+  return (kind + "-" +
+          llvm::utohexstr(llvm::xxHash64(material), /*LowerCase=*/true))
+      .str();
+}
+
+// The entries of the function cache start with the SHA-256 digest of the data
+// their key was computed from, since the 64-bit keys may collide.
+constexpr size_t kFunctionCacheDigestSize = 32;
+
+static std::array<uint8_t, kFunctionCacheDigestSize> GetDigest(
+    string_view material) {
+  return llvm::SHA256::hash(llvm::arrayRefFromStringRef(material));
+}
+
+// Returns the entry that stores `value` for the key computed from `material`.
+static std::string MakeFunctionCacheEntry(string_view material,
+                                          string_view value) {
+  const auto digest = GetDigest(material);
+  std::string entry(digest.begin(), digest.end());
+  entry.append(value.begin(), value.end());
+  return entry;
+}
+
+// Returns the value of `entry` if it was stored for the key computed from
+// `material`, and std::nullopt if it was stored for a colliding key.
+static std::optional<string_view> GetFunctionCacheValue(string_view entry,
+                                                        string_view material) {
+  if (entry.size() < kFunctionCacheDigestSize) return std::nullopt;
+  const auto digest = GetDigest(material);
+  if (std::memcmp(entry.data(), digest.data(), kFunctionCacheDigestSize) != 0)
+    return std::nullopt;
+  return entry.substr(kFunctionCacheDigestSize);
+}
+
+void BEFModuleEmitter::EmitCachedFunction(
+    mlir::Region* region, ArrayRef<size_t> location_offsets,
+    BEFFunctionEmitter* function, BEFFileEmitter* attribute_names,
+    BEFFileEmitter* register_types) const {
+  const std::string content = GetFunctionContent(region);
+
+  // The encoding depends on the content of the function, on the offsets of the
+  // entities it refers to, and on the optional sections that are emitted.
+  llvm::SmallVector<uint64_t, 64> references = function->GetReferences(
+      region, location_offsets, attribute_names != nullptr);
+  references.push_back(attribute_names != nullptr);
+  references.push_back(register_types != nullptr);
+  std::string function_material = content;
+  function_material.append(reinterpret_cast<const char*>(references.data()),
+                           references.size() * sizeof(uint64_t));
+  const std::string function_key =
+      FunctionCacheKey("function", function_material);
+
+  if (auto entry = function_cache_->Lookup(function_key)) {
+    if (auto value = GetFunctionCacheValue(*entry, function_material)) {
+      if (function->Restore(*value, attribute_names, register_types)) return;
+    }
+  }
+
+  // The references change whenever other functions add entities or change the
+  // number of locations before this one, but the streams only depend on the
+  // content of the function, so they are cached on their own.
+  auto& block = region->front();
+  const size_t num_kernels =
+      1 + llvm::count_if(block, [](mlir::Operation& op) {
+        return !IsReturn(&op);
+      });
+  const std::string streams_key = FunctionCacheKey("streams", content);
+
+  llvm::SmallVector<int, 16> stream_ids;
+  if (auto entry = function_cache_->Lookup(streams_key)) {
+    auto value = GetFunctionCacheValue(*entry, content);
+    if (value && value->size() == num_kernels * sizeof(int32_t)) {
+      stream_ids.resize(num_kernels);
+      for (size_t i = 0; i < num_kernels; ++i) {
+        int32_t id;
+        std::memcpy(&id, value->data() + i * sizeof(int32_t), sizeof(id));
+        stream_ids[i] = id;
+      }
+    }
+  }
+  if (stream_ids.empty()) {
+    stream_ids = BEFFunctionEmitter::AnalyzeStreams(block);
+    std::string entry;
+    for (int id : stream_ids) {
+      const int32_t id32 = id;
+      entry.append(reinterpret_cast<const char*>(&id32), sizeof(id32));
+    }
+    function_cache_->Insert(streams_key,
+                            MakeFunctionCacheEntry(content, entry));
+  }
+
+  function->EmitFunction(region, location_offsets, stream_ids,
+                         attribute_names, register_types);
+  function_cache_->Insert(
+      function_key,
+      MakeFunctionCacheEntry(
+          function_material,
+          function->Serialize(attribute_names, register_types)));
+}
+
 void BEFModuleEmitter::EmitFunctions(BefLocationEmitter* locations,
                                      BEFFileEmitter* attribute_names,
                                      BEFFileEmitter* register_types) {
-  BEFFunctionEmitter functions_section(entities_, entity_index_);
+  const size_t num_functions = entities_.functions.size();
+
+  // The locations are emitted up front in function order, as their offsets
+  // depend on all the locations before them.
+  llvm::SmallVector<llvm::SmallVector<size_t, 16>, 8> location_offsets(
+      num_functions);
+  for (size_t i = 0; i < num_functions; ++i) {
+    const auto& function_entry = entities_.functions[i];
+    if (!function_entry.IsNative()) {
+      location_offsets[i] = BEFFunctionEmitter::EmitLocations(
+          function_entry.region, locations);
+    }
+  }
 
-  if (attribute_names != nullptr)
-    attribute_names->EmitVbrInt(entities_.functions.size());
-  if (register_types != nullptr)
-    register_types->EmitVbrInt(entities_.functions.size());
-  for (auto function_entry : entities_.functions) {
+  // Then the functions are encoded independently, in parallel if the context
+  // allows multithreading, each with its own part of the optional sections.
+  struct EncodedFunction {
+    EncodedFunction(const EntityTable& entities,
+                    const EntityIndex& entity_index)
+        : function(entities, entity_index) {}
+
+    BEFFunctionEmitter function;
+    BEFFileEmitter attribute_names;
+    BEFFileEmitter register_types;
+  };
+  std::vector<std::unique_ptr<EncodedFunction>> encoded(num_functions);
+  mlir::parallelFor(module_.getContext(), 0, num_functions, [&](size_t i) {
+    const auto& function_entry = entities_.functions[i];
+    if (function_entry.IsNative()) return;
+    encoded[i] = std::make_unique<EncodedFunction>(entities_, entity_index_);
+    BEFFileEmitter* function_attribute_names =
+        attribute_names ? &encoded[i]->attribute_names : nullptr;
+    BEFFileEmitter* function_register_types =
+        register_types ? &encoded[i]->register_types : nullptr;
+    if (function_cache_ != nullptr) {
+      EmitCachedFunction(function_entry.region, location_offsets[i],
+                         &encoded[i]->function, function_attribute_names,
+                         function_register_types);
+      return;
+    }
+    encoded[i]->function.EmitFunction(
+        function_entry.region, location_offsets[i],
+        BEFFunctionEmitter::AnalyzeStreams(function_entry.region->front()),
+        function_attribute_names, function_register_types);
+  });
+
+  // Finally they are placed in the Functions section in order. The kernel
+  // timeouts refer to the functions by their offsets in the section.
+  BEFFileEmitter functions_section;
+  BEFFileEmitter kernel_timeouts;
+  size_t num_functions_with_timeouts = 0;
+  if (attribute_names != nullptr) attribute_names->EmitVbrInt(num_functions);
+  if (register_types != nullptr) register_types->EmitVbrInt(num_functions);
+  for (size_t i = 0; i < num_functions; ++i) {
+    const auto& function_entry = entities_.functions[i];
     // Remember that we emitted this region to this offset.
     entity_index_.AddFunction(function_entry.name, functions_section.size(),
                               function_entry.type, function_entry.kind);
-    if (!function_entry.IsNative()) {
-      functions_section.EmitFunction(function_entry.region, locations,
-                                     attribute_names, register_types);
+    if (!encoded[i]) continue;
+
+    llvm::SmallVector<std::pair<unsigned, uint64_t>, 4> timeouts;
+    CollectKernelTimeouts(function_entry.region, &timeouts);
+    if (!timeouts.empty()) {
+      ++num_functions_with_timeouts;
+      kernel_timeouts.EmitVbrInt(functions_section.size());
+      kernel_timeouts.EmitVbrInt(timeouts.size());
+      for (const auto& [kernel_index, timeout_ms] : timeouts) {
+        kernel_timeouts.EmitVbrInt(kernel_index);
+        kernel_timeouts.EmitVbrInt(timeout_ms);
+      }
     }
+
+    encoded[i]->function.AppendTo(&functions_section);
+    if (attribute_names != nullptr)
+      attribute_names->EmitEmitter(encoded[i]->attribute_names);
+    if (register_types != nullptr)
+      register_types->EmitEmitter(encoded[i]->register_types);
+    // The encoding is no longer needed once it is copied into the sections.
+    encoded[i].reset();
   }
 
   // TODO(hyojun): Reduce the increased peak memory usage for keeping
@@ -1099,6 +1579,15 @@ void BEFModuleEmitter::EmitFunctions(BefLocationEmitter* locations,
 
   EmitSection(BEFSectionID::kFunctionIndex, function_index_section);
   EmitSection(BEFSectionID::kFunctions, functions_section);
+
+  // Unlike the optional sections, the timeouts are needed for execution, so
+  // they are always emitted when some kernel has one.
+  if (num_functions_with_timeouts > 0) {
+    BEFFileEmitter kernel_timeouts_section;
+    kernel_timeouts_section.EmitVbrInt(num_functions_with_timeouts);
+    kernel_timeouts_section.EmitEmitter(kernel_timeouts);
+    EmitSection(BEFSectionID::kKernelTimeouts, kernel_timeouts_section);
+  }
 }
 
 // This function converts the specified MLIR module containing a host executor
@@ -1107,9 +1596,11 @@ void BEFModuleEmitter::EmitFunctions(BefLocationEmitter* locations,
 //
 // On error, this emits the error message through the MLIR error handler, and
 // returns an empty std:vector.
-BefBuffer ConvertMLIRToBEF(mlir::ModuleOp module,
-                           bool disable_optional_sections) {
-  BEFModuleEmitter emitter(module);
+BefBuffer ConvertMLIRToBEF(
+    mlir::ModuleOp module, bool disable_optional_sections,
+    std::optional<BEFCompressionFormat> debug_section_compression,
+    const BefFunctionCache* function_cache) {
+  BEFModuleEmitter emitter(module, function_cache);
 
   // Build the entities table.
   if (emitter.CollectEntities(!disable_optional_sections) ==
@@ -1143,15 +1634,19 @@ BefBuffer ConvertMLIRToBEF(mlir::ModuleOp module,
   }
 
   if (locations.GetConcreteLocationCount() > 0) {
-    emitter.EmitSection(BEFSectionID::kLocationStrings,
-                        locations.GetStringsSectionEmitter());
+    emitter.EmitCompressibleSection(BEFSectionID::kLocationStrings,
+                                    locations.GetStringsSectionEmitter(),
+                                    debug_section_compression);
 
-    emitter.EmitSection(BEFSectionID::kLocations, locations);
+    emitter.EmitCompressibleSection(BEFSectionID::kLocations, locations,
+                                    debug_section_compression);
   }
 
   if (!disable_optional_sections) {
     emitter.EmitSection(BEFSectionID::kAttributeTypes, attribute_types);
-    emitter.EmitSection(BEFSectionID::kAttributeNames, attribute_names);
+    emitter.EmitCompressibleSection(BEFSectionID::kAttributeNames,
+                                    attribute_names,
+                                    debug_section_compression);
     emitter.EmitSection(BEFSectionID::kRegisterTypes, register_types);
   }
 
@@ -17,9 +17,14 @@
 // This file implements the registration for the mlir-to-bef converter in MLIR
 // Translate infrastructure.  It opens up an mlir file specified on the command
 // line and converts it to a bef file at specified location.
+#include <optional>
+#include <string>
+
 #include "llvm/Support/CommandLine.h"
 #include "mlir/IR/BuiltinOps.h"
 #include "tfrt/bef/bef_buffer.h"
+#include "tfrt/bef/bef_encoding.h"
+#include "tfrt/bef_converter/bef_function_cache.h"
 #include "tfrt/bef_converter/mlir_to_bef.h"
 
 static llvm::cl::opt<bool> disable_optional_sections(  // NOLINT
@@ -28,12 +33,39 @@ static llvm::cl::opt<bool> disable_optional_sections(  // NOLINT
                    "types and attribute names."),
     llvm::cl::init(false));
 
+static llvm::cl::opt<std::string> compress_debug_sections(  // NOLINT
+    "compress-debug-sections",
+    llvm::cl::desc("Compress the location and attribute name sections with "
+                   "the given format: none, zlib or zstd."),
+    llvm::cl::init("none"));
+
+static llvm::cl::opt<std::string> bef_function_cache_dir(  // NOLINT
+    "bef-function-cache-dir",
+    llvm::cl::desc("Reuse the encodings of the functions that did not change "
+                   "since a previous conversion from this directory."),
+    llvm::cl::init(""));
+
 namespace tfrt {
 
 mlir::LogicalResult MLIRToBEFTranslate(mlir::ModuleOp module,
                                        llvm::raw_ostream& output) {
-  BefBuffer bef_file =
-      tfrt::ConvertMLIRToBEF(module, disable_optional_sections);
+  std::optional<BEFCompressionFormat> compression;
+  if (compress_debug_sections == "zlib") {
+    compression = BEFCompressionFormat::kZlib;
+  } else if (compress_debug_sections == "zstd") {
+    compression = BEFCompressionFormat::kZstd;
+  } else if (compress_debug_sections != "none") {
+    return module.emitError("unknown --compress-debug-sections format: ")
+           << compress_debug_sections;
+  }
+
+  std::optional<BefFunctionCache> function_cache;
+  if (!bef_function_cache_dir.empty())
+    function_cache.emplace(bef_function_cache_dir);
+
+  BefBuffer bef_file = tfrt::ConvertMLIRToBEF(
+      module, disable_optional_sections, compression,
+      function_cache ? &*function_cache : nullptr);
   if (bef_file.empty()) return mlir::failure();
 
   // Success!
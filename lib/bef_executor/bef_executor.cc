@@ -16,8 +16,14 @@
 
 #include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 
@@ -27,8 +33,15 @@
 #include "bef_file_impl.h"
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/MathExtras.h"
 #include "tfrt/bef/bef_encoding.h"
 #include "tfrt/bef/bef_reader.h"
+#include "tfrt/bef_executor/bef_executor_options.h"
+#include "tfrt/bef_executor/critical_path.h"
+#include "tfrt/bef_executor/kernel_cpu_profile.h"
+#include "tfrt/bef_executor/kernel_profile.h"
+#include "tfrt/bef_executor/kernel_sampler.h"
+#include "tfrt/host_context/allocation_site.h"
 #include "tfrt/host_context/async_dispatch.h"
 #include "tfrt/host_context/async_value.h"
 #include "tfrt/host_context/concurrent_work_queue.h"
@@ -36,9 +49,13 @@
 #include "tfrt/host_context/host_context.h"
 #include "tfrt/host_context/kernel_frame.h"
 #include "tfrt/host_context/location.h"
+#include "tfrt/host_context/request_stats.h"
+#include "tfrt/host_context/task_function.h"
+#include "tfrt/host_context/timer_queue.h"
 #include "tfrt/metrics/metrics.h"
 #include "tfrt/support/forward_decls.h"
 #include "tfrt/support/logging.h"
+#include "tfrt/support/mutex.h"
 #include "tfrt/support/ref_count.h"
 #include "tfrt/tracing/tracing.h"
 
@@ -56,12 +73,42 @@ namespace tfrt {
 
 namespace {
 
-// Take one reference to `new_value` and set it in the register. The final
-// AsyncValue inside this register may be different from `new_value` in case
-// that there is an existing indirect async value.
+// Returns true for about one in `period` calls on the calling thread. As in
+// KernelSampler, the intervals between samples are random, so that all the
+// kernels of a function that always run in the same order are sampled.
+bool ShouldTimeKernel(uint32_t period) {
+  static thread_local uint32_t countdown = 0;
+  static thread_local uint32_t state =
+      static_cast<uint32_t>(reinterpret_cast<uintptr_t>(&countdown)) | 1;
+  if (countdown > 1) {
+    --countdown;
+    return false;
+  }
+  // xorshift32
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  countdown = period <= 1 ? 1 : 1 + state % (2 * period - 1);
+  return true;
+}
+
+// Returns false if adaptive kernel placement is disabled for the process by
+// the environment variable TFRT_DISABLE_ADAPTIVE_KERNEL_PLACEMENT.
+bool IsAdaptivePlacementAllowed() {
+  static const bool allowed = [] {
+    const char* flag = std::getenv("TFRT_DISABLE_ADAPTIVE_KERNEL_PLACEMENT");
+    return !(flag && (strcmp(flag, "true") == 0 || strcmp(flag, "1") == 0));
+  }();
+  return allowed;
+}
+
+// Take one reference to `new_value` and set it in the register, which has
+// `user_count` uses. The final AsyncValue inside this register may be different
+// from `new_value` in case that there is an existing indirect async value.
 LLVM_ATTRIBUTE_ALWAYS_INLINE void SetRegisterValue(
-    BEFFileImpl::RegisterInfo* reg, RCReference<AsyncValue> result) {
-  assert(reg->user_count > 0 &&
+    BEFFileImpl::RegisterInfo* reg, unsigned user_count,
+    RCReference<AsyncValue> result) {
+  assert(user_count > 0 &&
          "No need to set register value if it is not being used by anyone.");
 
   if (reg->value) {
@@ -70,7 +117,7 @@ LLVM_ATTRIBUTE_ALWAYS_INLINE void SetRegisterValue(
     auto* indirect_value = cast<IndirectAsyncValue>(reg->value);
 
     // Move one reference to the indirect value. Though a register might be used
-    // as multiple return results, `reg->user_count` will only include one
+    // as multiple return results, `user_count` will only include one
     // reference for all return results.
 
     if (indirect_value->NumRef() == 1) {
@@ -93,7 +140,7 @@ LLVM_ATTRIBUTE_ALWAYS_INLINE void SetRegisterValue(
     auto* raw = result.release();
     // Note that `result` already has +1 reference. So add (user_count - 1) more
     // refs, bringing its effective refcount to +(user_count).
-    raw->AddRef(reg->user_count - 1);
+    raw->AddRef(user_count - 1);
     // Set the register value for other kernels to use.
     reg->value = raw;
   }
@@ -110,22 +157,166 @@ llvm::ArrayRef<unsigned> GetNextUsedBys(const BEFKernel& kernel,
   return used_bys;
 }
 
+// KernelTimeout bounds the time the unavailable results of one kernel take to
+// resolve. Every watched result is replaced by an IndirectAsyncValue that is
+// forwarded to the result once it resolves, or set to a DeadlineExceeded error
+// if the timer fires first. The users of the kernel then see an error argument
+// and propagate it, so only the subgraph downstream of the kernel is cancelled.
+// The kernel itself keeps running, and its late results are dropped.
+class KernelTimeout : public ReferenceCounted<KernelTimeout> {
+ public:
+  explicit KernelTimeout(string_view kernel_name)
+      : kernel_name_(kernel_name) {}
+
+  // Returns the value that stands for `result` until the timeout.
+  RCReference<AsyncValue> Watch(RCReference<AsyncValue> result) {
+    auto indirect = MakeIndirectAsyncValue();
+    size_t index;
+    {
+      mutex_lock lock(mu_);
+      index = pending_.size();
+      pending_.push_back(indirect);
+      ++num_pending_;
+    }
+    auto* raw = result.get();
+    raw->AndThen([self = FormRef(this), index, result = std::move(result)]() {
+      self->Resolve(index, result);
+    });
+    return indirect;
+  }
+
+  // Starts the timer for the results still pending. Expiry runs in a work
+  // thread instead of the timer thread, as the users of the results may run
+  // inline when they are set.
+  void Start(uint32_t timeout_ms, const ExecutionContext& exec_ctx) {
+    mutex_lock lock(mu_);
+    if (num_pending_ == 0) return;
+    timer_queue_ = exec_ctx.host()->GetTimerQueue();
+    timer_ = timer_queue_->ScheduleTimer(
+        std::chrono::milliseconds(timeout_ms),
+        [self = FormRef(this), timeout_ms, exec_ctx]() {
+          EnqueueWork(exec_ctx, [self, timeout_ms]() {
+            self->Expire(timeout_ms);
+          });
+        });
+  }
+
+ private:
+  void Resolve(size_t index, const RCReference<AsyncValue>& result) {
+    RCReference<IndirectAsyncValue> indirect;
+    TimerQueue::TimerHandle timer;
+    {
+      mutex_lock lock(mu_);
+      // The result has timed out already.
+      if (!pending_[index]) return;
+      indirect = std::move(pending_[index]);
+      if (--num_pending_ == 0) timer = std::move(timer_);
+    }
+    // Dropping the handle breaks the cycle through the timer callback.
+    if (timer) timer_queue_->CancelTimer(timer);
+    indirect->ForwardTo(result);
+  }
+
+  void Expire(uint32_t timeout_ms) {
+    llvm::SmallVector<RCReference<IndirectAsyncValue>, 4> expired;
+    {
+      mutex_lock lock(mu_);
+      for (auto& indirect : pending_)
+        if (indirect) expired.push_back(std::move(indirect));
+      num_pending_ = 0;
+      timer_.reset();
+    }
+    for (auto& indirect : expired)
+      indirect->SetError(absl::DeadlineExceededError(absl::StrFormat(
+          "kernel %s timed out after %u ms", kernel_name_, timeout_ms)));
+  }
+
+  // A copy, as the results may time out after the BEF file is released.
+  const std::string kernel_name_;
+  TimerQueue* timer_queue_ = nullptr;
+  mutex mu_;
+  // The results not yet resolved, or null.
+  llvm::SmallVector<RCReference<IndirectAsyncValue>, 2> pending_
+      TFRT_GUARDED_BY(mu_);
+  size_t num_pending_ TFRT_GUARDED_BY(mu_) = 0;
+  TimerQueue::TimerHandle timer_ TFRT_GUARDED_BY(mu_);
+};
+
+// ExecutionTimeline records the times of the kernels of one execution for a
+// CriticalPathRecorder. The ready time and the producer of a kernel are set by
+// the thread that makes it ready, and its start and end times by the thread
+// that runs it afterwards, so only the completion times need to be atomic.
+class ExecutionTimeline {
+ public:
+  explicit ExecutionTimeline(size_t num_kernels)
+      : start_(std::chrono::steady_clock::now()),
+        kernels_(new Kernel[num_kernels]) {
+    // The arguments pseudo kernel is ready once the execution is created.
+    kernels_[0].ready_ns = 0;
+  }
+
+  void SetReady(unsigned kernel_id, unsigned producer_id) {
+    kernels_[kernel_id].ready_ns = Now();
+    kernels_[kernel_id].unblocked_by = producer_id;
+  }
+  void SetStart(unsigned kernel_id) { kernels_[kernel_id].start_ns = Now(); }
+  void SetEnd(unsigned kernel_id) { kernels_[kernel_id].end_ns = Now(); }
+
+  // Called whenever a result of `kernel_id` becomes available.
+  void SetDone(unsigned kernel_id) {
+    const int64_t now = Now();
+    auto& done_ns = kernels_[kernel_id].done_ns;
+    int64_t done = done_ns.load(std::memory_order_relaxed);
+    while (done < now && !done_ns.compare_exchange_weak(
+                             done, now, std::memory_order_relaxed)) {
+    }
+  }
+
+  // Copy the times of `kernel_id` to `trace`.
+  void GetKernelTrace(unsigned kernel_id, KernelTrace* trace) const {
+    const Kernel& kernel = kernels_[kernel_id];
+    trace->unblocked_by = kernel_id == 0 ? -1 : kernel.unblocked_by;
+    trace->ready_ns = kernel.ready_ns;
+    trace->start_ns = kernel.start_ns;
+    trace->end_ns = kernel.end_ns;
+    // Results that nobody waits for do not report their completion.
+    trace->done_ns =
+        std::max(kernel.done_ns.load(std::memory_order_relaxed), kernel.end_ns);
+  }
+
+ private:
+  struct Kernel {
+    int64_t ready_ns = -1;
+    int64_t start_ns = -1;
+    int64_t end_ns = -1;
+    int unblocked_by = -1;
+    std::atomic<int64_t> done_ns{-1};
+  };
+
+  int64_t Now() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now() - start_)
+        .count();
+  }
+
+  const std::chrono::steady_clock::time_point start_;
+  std::unique_ptr<Kernel[]> kernels_;
+};
+
 // ReadyKernelQueue is used for managing ready-to-run kernels in one sequential
 // path.
 class ReadyKernelQueue {
  public:
   // Constructs an empty queue with `stream_id`.
-  ReadyKernelQueue(int stream_id,
-                   MutableArrayRef<BEFFileImpl::KernelInfo> kernel_array)
-      : stream_id_(stream_id), kernel_array_(kernel_array) {}
+  ReadyKernelQueue(int stream_id, BEFFileImpl::FunctionInfo* function_info)
+      : stream_id_(stream_id), function_info_(function_info) {}
 
   // Constructs a queue using `kernel_ids`, all kernels of which belong to the
   // same stream with `stream_id`.
-  ReadyKernelQueue(int stream_id,
-                   MutableArrayRef<BEFFileImpl::KernelInfo> kernel_array,
+  ReadyKernelQueue(int stream_id, BEFFileImpl::FunctionInfo* function_info,
                    std::vector<unsigned> kernel_ids)
       : stream_id_(stream_id),
-        kernel_array_(kernel_array),
+        function_info_(function_info),
         inline_kernel_ids_(std::move(kernel_ids)) {}
 
   // If the inline kernels are empty, we can move some of the outline kernels
@@ -138,12 +329,14 @@ class ReadyKernelQueue {
     if (outline_kernel_ids_.empty()) return;
 
     // Pick the new stream id from the ready outline kernels.
-    stream_id_ = kernel_array_[outline_kernel_ids_[0]].stream_id;
+    stream_id_ = function_info_->stream_id(outline_kernel_ids_[0]);
 
     // Partition outlined kernels using the new stream id.
     auto inline_kernels_begin = std::partition(
         outline_kernel_ids_.begin(), outline_kernel_ids_.end(),
-        [&](unsigned id) { return kernel_array_[id].stream_id != stream_id_; });
+        [&](unsigned id) {
+          return function_info_->stream_id(id) != stream_id_;
+        });
 
     // Move outline kernels belonging to the new stream into the inline kernels.
     inline_kernel_ids_.assign(inline_kernels_begin, outline_kernel_ids_.end());
@@ -151,23 +344,27 @@ class ReadyKernelQueue {
   }
 
   // Decrement the ready counts for `kernel_ids` and put them in the queue.
-  // Depending on their stream_id, they will be either put in the inline queue
-  // for inline execution or outline queue for launching to a separate thread.
+  // Depending on their stream_id, or their cost with adaptive placement, they
+  // will be either put in the inline queue for inline execution or outline
+  // queue for launching to a separate thread.
+  // The kernels made ready are recorded in `timeline` as unblocked by
+  // `producer_id`, if it is not null.
   LLVM_ATTRIBUTE_ALWAYS_INLINE void DecrementReadyCountAndEnqueue(
-      ArrayRef<unsigned> kernel_ids) {
+      ArrayRef<unsigned> kernel_ids, ExecutionTimeline* timeline,
+      unsigned producer_id) {
     // TODO(b/173798236): Consider introducing a randomization logic here in
     // mode to trigger errors in tests that relies on the implicit order.
     for (unsigned kernel_id : kernel_ids) {
-      assert(kernel_id < kernel_array_.size());
-      auto& kernel_info = kernel_array_[kernel_id];
+      assert(kernel_id < function_info_->layout->kernel_entries.size());
       // `arguments_not_ready` must be a postive number, so if it equals 1, then
       // this is the last producer kernel touching the consumer kernel, and we
       // don't need to perform the expensive fetch_sub for this case.
-      auto& ready_count = kernel_info.arguments_not_ready;
+      auto& ready_count = function_info_->arguments_not_ready(kernel_id);
       assert(ready_count.load() > 0);
       if (ready_count.load(std::memory_order_acquire) == 1 ||
           ready_count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
-        if (kernel_info.stream_id == stream_id_) {
+        if (timeline != nullptr) timeline->SetReady(kernel_id, producer_id);
+        if (function_info_->IsInline(kernel_id, stream_id_)) {
           inline_kernel_ids_.push_back(kernel_id);
         } else {
           outline_kernel_ids_.push_back(kernel_id);
@@ -176,6 +373,15 @@ class ReadyKernelQueue {
     }
   }
 
+  // Move the outline kernels into the inline kernels, so that they are
+  // processed in this thread instead of being launched to separate threads.
+  void InlineOutlineKernels() {
+    inline_kernel_ids_.insert(inline_kernel_ids_.end(),
+                              outline_kernel_ids_.begin(),
+                              outline_kernel_ids_.end());
+    outline_kernel_ids_.clear();
+  }
+
   // `inline_kernel_ids` contains the kernels to be executed in the same thread.
   std::vector<unsigned>& inline_kernel_ids() { return inline_kernel_ids_; }
 
@@ -183,16 +389,12 @@ class ReadyKernelQueue {
   // thread.
   std::vector<unsigned>& outline_kernel_ids() { return outline_kernel_ids_; }
 
-  MutableArrayRef<BEFFileImpl::KernelInfo> kernel_array() const {
-    return kernel_array_;
-  }
-
   // The stream id for this sequence.
   int stream_id() const { return stream_id_; }
 
  private:
   int stream_id_;
-  MutableArrayRef<BEFFileImpl::KernelInfo> kernel_array_;
+  BEFFileImpl::FunctionInfo* function_info_;
 
   std::vector<unsigned> inline_kernel_ids_;
   std::vector<unsigned> outline_kernel_ids_;
@@ -214,12 +416,27 @@ class BEFExecutor final : public ReferenceCounted<BEFExecutor> {
                            MutableArrayRef<RCReference<AsyncValue>> results);
 
   /// When the last reference to the BEFExecutor is dropped, we deallocate
-  /// ourself.  The memory for this class is managed through the HostAllocator
-  /// managed by the HostContext.
+  /// ourself.  The memory for this class is recycled through the executor pool
+  /// of the function if it came from there, and is otherwise managed through
+  /// the request allocator, which is either the HostAllocator managed by the
+  /// HostContext or the request arena.
   void Destroy() {
-    auto host = this->GetHost();
+    if (executor_pool_ != nullptr) {
+      // The pool belongs to a function of the BEF file, so keep the file alive
+      // until the block is returned.
+      RCReference<BEFFileImpl> bef_file = bef_file_.CopyRef();
+      ExecutorBlockPool* pool = executor_pool_;
+      this->~BEFExecutor();
+      pool->Deallocate(this);
+      return;
+    }
+
+    // The request may be backed by an arena that owns our memory, so keep it
+    // alive until the deallocation below.
+    RCReference<RequestContext> request_ctx = FormRef(exec_ctx_.request_ctx());
+    HostAllocator* allocator = request_ctx->allocator();
     this->~BEFExecutor();
-    host->Deallocate<BEFExecutor>(this);
+    allocator->Deallocate<BEFExecutor>(this);
   }
 
  private:
@@ -255,20 +472,67 @@ class BEFExecutor final : public ReferenceCounted<BEFExecutor> {
   void ProcessReadyKernel(unsigned kernel_id, KernelFrameBuilder* kernel_frame,
                           ReadyKernelQueue& ready_kernel_queue);
 
+  // Skip `kernel` of a cancelled execution: drop its arguments and set its
+  // results to `cancel_value`, without setting up a kernel frame.
+  void PruneCancelledKernel(const BEFKernel& kernel, unsigned kernel_id,
+                            AsyncValue* cancel_value,
+                            ReadyKernelQueue& ready_kernel_queue);
+
+  // Fold the execution time of a sampled invocation of `kernel_id` into its
+  // moving average, see BEFExecutorOptions::adaptive_placement.
+  void RecordKernelCost(unsigned kernel_id, std::chrono::nanoseconds duration);
+
+  // Enqueue the outline kernels of `ready_kernel_queue` to the concurrent work
+  // queue. If the execution has been cancelled, they are processed inline
+  // instead, as pruning them is cheaper than launching tasks.
+  void EnqueueOutlineKernels(ReadyKernelQueue& ready_kernel_queue);
+
   // Enqueue the `users` of the `result` for later processing. If the result has
   // no users, it will be skipped. If the result is immediately available, then
   // we push them to `ready_kernel_queue`, otherwise we need to enqueue them
   // into this unavailable result. This function also publish the `result` to
-  // the corresponding `result_register` so that the subscribers can use it.
+  // the result register `result_reg_idx` so that the subscribers can use it.
+  // `producer_id` is the kernel that produced the result.
   void ProcessUsedBysAndSetRegister(llvm::ArrayRef<unsigned> users,
                                     ReadyKernelQueue& ready_kernel_queue,
                                     RCReference<AsyncValue> result,
-                                    BEFFileImpl::RegisterInfo* result_register);
+                                    unsigned result_reg_idx,
+                                    unsigned producer_id);
+
+  // Returns the affinity hint of the tasks that run the kernels of
+  // `stream_id`. The key also depends on the execution, so that the streams
+  // of concurrent executions are spread over the workers.
+  TaskAffinity GetStreamAffinity(int stream_id) const {
+    return TaskAffinity{reinterpret_cast<uintptr_t>(this) ^
+                        (static_cast<uint64_t>(stream_id) << 48)};
+  }
+
+  // Enqueue `tasks` that run kernels of the streams `stream_ids`, with an
+  // affinity hint for the stream of every task if stream affinity is enabled,
+  // and as a single batch otherwise.
+  void EnqueueStreamTasks(ArrayRef<int> stream_ids,
+                          MutableArrayRef<TaskFunction> tasks);
 
   // Enqueue `kernel_ids` to the concurrent work queue so that they can be
   // executed in a dfferent thread in parallel.
   void EnqueueReadyKernels(std::vector<unsigned>& kernel_ids);
 
+  struct StreamBatch;
+
+  // Enqueue worker tasks that process the stream batches. Batches are spread
+  // over at most `max_outline_tasks_` tasks, so a value with many consumers in
+  // different streams wakes up one worker per task rather than per stream.
+  void EnqueueStreamBatches(MutableArrayRef<StreamBatch> batches);
+
+  // Push the stream batches to the ready pool, and enqueue worker tasks to
+  // drain the pool unless enough of them are already running. Only used in the
+  // work stealing mode.
+  void PushStreamBatches(MutableArrayRef<StreamBatch> batches);
+
+  // Pop stream batches from the ready pool and process them until the pool is
+  // empty. This is the body of the worker tasks in the work stealing mode.
+  void DrainReadyPool();
+
   HostContext* GetHost() const { return exec_ctx_.host(); }
   BEFFileImpl* BefFile() const { return bef_file_.get(); }
 
@@ -278,13 +542,21 @@ class BEFExecutor final : public ReferenceCounted<BEFExecutor> {
     return function_info_.register_infos.mutable_array();
   }
 
-  MutableArrayRef<BEFFileImpl::KernelInfo> kernel_infos() {
-    return function_info_.kernel_infos.mutable_array();
+  BEFFileImpl::FunctionInfo* function_info() { return &function_info_; }
+
+  // Take one reference to `result` and set it in register `reg_idx`.
+  void SetRegister(unsigned reg_idx, RCReference<AsyncValue> result) {
+    SetRegisterValue(&register_infos()[reg_idx],
+                           function_info_.user_count(reg_idx),
+                           std::move(result));
   }
 
   void DebugPrintError(const BEFKernel& kernel, unsigned kernel_id,
                        AsyncValue* result);
 
+  // Build the trace of this execution from `timeline_`.
+  ExecutionTrace GetExecutionTrace();
+
   friend class ReferenceCounted<BEFExecutor>;
 
   /// The execution context for this BEFExecutor.
@@ -293,7 +565,56 @@ class BEFExecutor final : public ReferenceCounted<BEFExecutor> {
   /// Decoded BEFFunction
   BEFFileImpl::FunctionInfo function_info_;
 
+  /// The pool our memory is returned to, or nullptr if it came from the
+  /// request allocator.
+  ExecutorBlockPool* executor_pool_ = nullptr;
+
   RCReference<BEFFileImpl> bef_file_;
+
+  // A group of ready kernels that belong to the same stream.
+  struct StreamBatch {
+    int stream_id;
+    std::vector<unsigned> kernel_ids;
+  };
+
+  // The maximum number of tasks EnqueueReadyKernels() enqueues at once. It is
+  // the parallelism level of the work queue.
+  int max_outline_tasks_ = 1;
+
+  // The maximum number of worker tasks draining `ready_pool_`, or zero if the
+  // work stealing mode is disabled for this execution.
+  int max_pool_workers_ = 0;
+  int steal_batch_size_ = 1;
+
+  // The profile that kernel wall times are recorded into, if profiling is
+  // enabled for this execution.
+  KernelProfile* kernel_profile_ = nullptr;
+  // The profile that kernel CPU and wall times are recorded into per
+  // function, if enabled for this execution.
+  KernelCpuProfile* kernel_cpu_profile_ = nullptr;
+  // The sampler that a fraction of the kernel invocations are timed into, if
+  // sampling is enabled for this execution.
+  KernelSampler* kernel_sampler_ = nullptr;
+  // Whether the kernels are made the allocation site of their thread.
+  bool attribute_allocations_ = false;
+  // Whether ready kernels are placed by their measured cost, and the period of
+  // the invocations that are timed for it.
+  bool adaptive_placement_ = false;
+  uint32_t adaptive_sample_period_ = 1;
+  // Whether the outline kernels are enqueued with an affinity hint for their
+  // stream.
+  bool stream_affinity_ = false;
+  // The recorder the trace of this execution is recorded into when it
+  // completes, and the timeline of the kernels until then.
+  CriticalPathRecorder* critical_path_recorder_ = nullptr;
+  std::unique_ptr<ExecutionTimeline> timeline_;
+  string_view function_name_;
+
+  mutex ready_pool_mu_;
+  // Ready stream batches that are not yet taken by any worker task.
+  std::deque<StreamBatch> ready_pool_ TFRT_GUARDED_BY(ready_pool_mu_);
+  // The number of worker tasks that are enqueued or draining `ready_pool_`.
+  int num_pool_workers_ TFRT_GUARDED_BY(ready_pool_mu_) = 0;
 };
 
 //===----------------------------------------------------------------------===//
@@ -332,26 +653,44 @@ struct StackOverflowGuard {
 // no users, it will be skipped. If the result is immediately available, then we
 // push them to `ready_kernel_queue`, otherwise we need to enqueue them into
 // this unavailable result. This function also publish the `result` to the
-// corresponding `result_register` so that the subscribers can use it.
+// result register `result_reg_idx` so that the subscribers can use it.
 LLVM_ATTRIBUTE_ALWAYS_INLINE void BEFExecutor::ProcessUsedBysAndSetRegister(
     llvm::ArrayRef<unsigned> users, ReadyKernelQueue& ready_kernel_queue,
-    RCReference<AsyncValue> result,
-    BEFFileImpl::RegisterInfo* result_register) {
+    RCReference<AsyncValue> result, unsigned result_reg_idx,
+    unsigned producer_id) {
+  // Do not wait for the result if the execution has been cancelled, as its
+  // users are going to be pruned anyway.
+  if (!result->IsAvailable()) {
+    if (auto* cancel_value = exec_ctx_.GetCancelAsyncValue())
+      result = FormRef(cancel_value);
+  }
+
   // If the result is available, we can set the register and schedule ready
   // users immediately.
   if (result->IsAvailable()) {
+    if (timeline_) timeline_->SetDone(producer_id);
     // SetRegisterValue() must be done before DecrementReadyCountAndEnqueue()
     // because as soon as we decrement a kernel's ready count, it might be
     // executed in another thread.
-    SetRegisterValue(result_register, std::move(result));
-    ready_kernel_queue.DecrementReadyCountAndEnqueue(users);
+    SetRegister(result_reg_idx, std::move(result));
+    ready_kernel_queue.DecrementReadyCountAndEnqueue(users, timeline_.get(),
+                                                     producer_id);
     return;
   }
 
   // If the result is unavailable but has no users, we just need to set the
   // register which should be only used as the function result.
   if (users.empty()) {
-    SetRegisterValue(result_register, std::move(result));
+    // When recording the critical path, keep this executor alive until the
+    // result completes, as it may be the last one to.
+    if (timeline_) {
+      AddRef();
+      result->AndThen([this, producer_id]() {
+        timeline_->SetDone(producer_id);
+        DropRef();
+      });
+    }
+    SetRegister(result_reg_idx, std::move(result));
     return;
   }
 
@@ -367,20 +706,24 @@ LLVM_ATTRIBUTE_ALWAYS_INLINE void BEFExecutor::ProcessUsedBysAndSetRegister(
   // alive when the BEF executor is alive.
   auto* result_ptr = result.get();
   result_ptr->AndThen([this, stream_id = ready_kernel_queue.stream_id(), users,
-                       result_register, result = std::move(result)]() mutable {
+                       result_reg_idx, producer_id,
+                       result = std::move(result)]() mutable {
+    if (timeline_) timeline_->SetDone(producer_id);
+
     // Keep track of the call stack depth to prevent stack overflows.
     StackOverflowGuard guard;
 
     // Continue processing ready kernels.
-    auto continuation = [this, stream_id, users, result_register,
+    auto continuation = [this, stream_id, users, result_reg_idx, producer_id,
                          result = std::move(result)]() mutable {
-      ReadyKernelQueue ready_kernel_queue(stream_id, kernel_infos());
+      ReadyKernelQueue ready_kernel_queue(stream_id, function_info());
 
       // SetRegisterValue() must be done before
       // DecrementReadyCountAndEnqueue() because as soon as we decrement a
       // kernel's ready count, it might be executed in another thread.
-      SetRegisterValue(result_register, std::move(result));
-      ready_kernel_queue.DecrementReadyCountAndEnqueue(users);
+      SetRegister(result_reg_idx, std::move(result));
+      ready_kernel_queue.DecrementReadyCountAndEnqueue(users, timeline_.get(),
+                                                       producer_id);
       this->ProcessReadyKernels(ready_kernel_queue);
       this->DropRef();
     };
@@ -405,14 +748,16 @@ void BEFExecutor::ProcessArgumentsPseudoKernel(
   assert(ready_kernel_queue.outline_kernel_ids().empty());
 
   BEFKernel kernel(kernels().data());
+  if (timeline_) {
+    timeline_->SetStart(kPseudoKernelId);
+    timeline_->SetEnd(kPseudoKernelId);
+  }
 
   assert(kernel.num_arguments() == 0);
   assert(kernel.num_attributes() == 0);
   assert(kernel.num_functions() == 0);
   assert(kernel.num_results() != 0);
 
-  MutableArrayRef<BEFFileImpl::RegisterInfo> register_array = register_infos();
-
   // The kernel body of argument pseudo kernel contains only results and
   // used_bys.
   auto results = kernel.GetKernelEntries(0, kernel.num_results());
@@ -423,26 +768,27 @@ void BEFExecutor::ProcessArgumentsPseudoKernel(
   // The first result is the pseudo result to trigger execution of the kernels
   // with no operands.
   assert(!results.empty());
-  assert(results.front() == register_array.size());
+  assert(results.front() == register_infos().size());
 
   // Process the pseudo result first, which has no corresponding AsyncValue.
   auto used_bys = GetNextUsedBys(kernel, /*result_number=*/0, &used_by_offset);
-  ready_kernel_queue.DecrementReadyCountAndEnqueue(used_bys);
+  ready_kernel_queue.DecrementReadyCountAndEnqueue(used_bys, timeline_.get(),
+                                                   kPseudoKernelId);
 
   assert(arguments.size() + 1 == results.size());
   for (int argument_number = 0, result_number = 1;
        result_number < results.size(); ++argument_number, ++result_number) {
-    auto& result_register = register_array[results[result_number]];
+    unsigned result_reg_idx = results[result_number];
 
     // Skip setting register if there is no use.
-    if (result_register.user_count == 0) continue;
+    if (function_info_.user_count(result_reg_idx) == 0) continue;
 
     auto used_bys = GetNextUsedBys(kernel, result_number, &used_by_offset);
 
     // Process users of this result.
     ProcessUsedBysAndSetRegister(used_bys, ready_kernel_queue,
                                  std::move(arguments[argument_number]),
-                                 &result_register);
+                                 result_reg_idx, kPseudoKernelId);
   }
 }
 
@@ -466,16 +812,25 @@ void BEFExecutor::DebugPrintError(const BEFKernel& kernel, unsigned kernel_id,
 void BEFExecutor::ProcessReadyKernel(unsigned kernel_id,
                                      KernelFrameBuilder* kernel_frame,
                                      ReadyKernelQueue& ready_kernel_queue) {
+  if (timeline_) timeline_->SetStart(kernel_id);
+
   MutableArrayRef<BEFFileImpl::RegisterInfo> register_array = register_infos();
 
-  assert(kernel_infos()[kernel_id].offset % kKernelEntryAlignment == 0);
-  BEFKernel kernel(kernels().data() +
-                   kernel_infos()[kernel_id].offset / kKernelEntryAlignment);
+  unsigned kernel_offset = function_info_.kernel_entry(kernel_id).offset;
+  assert(kernel_offset % kKernelEntryAlignment == 0);
+  BEFKernel kernel(kernels().data() + kernel_offset / kKernelEntryAlignment);
 
   // Keep track of whether we saw any error arguments. If so, we propagate
-  // the error to the results automatically. Initialize it with the cancel
-  // async value if the execution has been canceled.
-  AsyncValue* any_error_argument = exec_ctx_.GetCancelAsyncValue();
+  // the error to the results automatically.
+  AsyncValue* any_error_argument = nullptr;
+
+  // The kernels of a cancelled execution are skipped, so do not set up their
+  // kernel frames.
+  if (auto* cancel_value = exec_ctx_.GetCancelAsyncValue()) {
+    PruneCancelledKernel(kernel, kernel_id, cancel_value, ready_kernel_queue);
+    if (timeline_) timeline_->SetEnd(kernel_id);
+    return;
+  }
 
   // Find the kernel implementation of this kernel.
   AsyncKernelImplementation kernel_fn =
@@ -484,7 +839,10 @@ void BEFExecutor::ProcessReadyKernel(unsigned kernel_id,
   DEBUG_PRINT("Run kernel %u %s\n", kernel_id,
               BefFile()->GetKernelName(kernel.kernel_code()));
 
-  // Set up operands.
+  // Set up operands. The storage for arguments and results is sized from the
+  // kernel header up front, and is shared with the previous kernels run with
+  // this frame.
+  kernel_frame->Reserve(kernel.num_arguments(), kernel.num_results());
   int entry_offset = 0;
   auto arguments =
       kernel.GetKernelEntries(entry_offset, kernel.num_arguments());
@@ -492,14 +850,10 @@ void BEFExecutor::ProcessReadyKernel(unsigned kernel_id,
     BEFFileImpl::RegisterInfo& reg = register_array[reg_idx];
 
     RCReference<AsyncValue> value = TakeRef(reg.value);
-    // TODO(b/142757465): remove arguments_and_results_ vector in
-    // AsyncKernelFrame.
     if (value->IsError()) any_error_argument = value.get();
     kernel_frame->AddArg(std::move(value));
   }
 
-  // TODO(b/142757465): remove arguments_and_results_ vector in
-  // AsyncKernelFrame.
   kernel_frame->SetNumResults(kernel.num_results());
 
   // Set up attributes.
@@ -513,6 +867,8 @@ void BEFExecutor::ProcessReadyKernel(unsigned kernel_id,
   auto function_indices =
       kernel.GetKernelEntries(entry_offset, kernel.num_functions());
   kernel_frame->SetFunctionIndices(function_indices);
+  kernel_frame->SetCallSiteSlot(
+      &function_info_.layout->call_site_slots[kernel_id]);
 
   // If all arguments are good, run the function.
   if (any_error_argument == nullptr) {
@@ -525,9 +881,42 @@ void BEFExecutor::ProcessReadyKernel(unsigned kernel_id,
     // so that we don't have extra bookkeeping in bef executor.
     TFRT_TRACE_SCOPE(Debug, BefFile()->GetKernelName(kernel.kernel_code()));
 
+    std::optional<AllocationSite::Scope> allocation_site;
+    if (attribute_allocations_) {
+      allocation_site.emplace(BefFile()->GetKernelName(kernel.kernel_code()),
+                              kernel_frame->GetLocation());
+    }
+
     // kernel_fn should populate results in kernel_frame with pointers to
     // AsyncValue before it returns.
-    kernel_fn(kernel_frame);
+    if (kernel_profile_ != nullptr) {
+      auto start = std::chrono::steady_clock::now();
+      kernel_fn(kernel_frame);
+      auto duration = std::chrono::steady_clock::now() - start;
+      kernel_profile_->Record(kernel_frame->GetLocation(), duration);
+      if (adaptive_placement_) RecordKernelCost(kernel_id, duration);
+    } else if (kernel_cpu_profile_ != nullptr) {
+      const auto start_cpu_time = RequestStats::ThreadCpuTime();
+      const auto start = std::chrono::steady_clock::now();
+      kernel_fn(kernel_frame);
+      const auto duration = std::chrono::steady_clock::now() - start;
+      kernel_cpu_profile_->Record(
+          function_name_, BefFile()->GetKernelName(kernel.kernel_code()),
+          RequestStats::ThreadCpuTime() - start_cpu_time, duration);
+      if (adaptive_placement_) RecordKernelCost(kernel_id, duration);
+    } else if (kernel_sampler_ != nullptr && kernel_sampler_->ShouldSample()) {
+      const uint64_t start = KernelSampler::ReadCycleCounter();
+      kernel_fn(kernel_frame);
+      kernel_sampler_->Record(BefFile()->GetKernelName(kernel.kernel_code()),
+                              KernelSampler::ReadCycleCounter() - start);
+    } else if (adaptive_placement_ &&
+               ShouldTimeKernel(adaptive_sample_period_)) {
+      auto start = std::chrono::steady_clock::now();
+      kernel_fn(kernel_frame);
+      RecordKernelCost(kernel_id, std::chrono::steady_clock::now() - start);
+    } else {
+      kernel_fn(kernel_frame);
+    }
 
   } else {
     // Otherwise, automatically propagate errors to the result values.
@@ -537,6 +926,7 @@ void BEFExecutor::ProcessReadyKernel(unsigned kernel_id,
   }
 
   kernel_frame->ResetArguments();
+  if (timeline_) timeline_->SetEnd(kernel_id);
 
   // The following loop iterates over all results of the kernel. If a result
   // has no users, it will be skipped. If the kernel immediately completed a
@@ -549,19 +939,26 @@ void BEFExecutor::ProcessReadyKernel(unsigned kernel_id,
   // Move entry offset to start of all used_bys.
   entry_offset += results.size();
 
+  // The results of a kernel with a timeout are watched if it ran and left them
+  // unavailable.
+  const uint32_t timeout_ms = any_error_argument == nullptr
+                                  ? function_info_.timeout_ms(kernel_id)
+                                  : 0;
+  RCReference<KernelTimeout> timeout;
+
   for (int result_number = 0; result_number < results.size(); ++result_number) {
-    auto& result_register = register_array[results[result_number]];
+    unsigned result_reg_idx = results[result_number];
 
     // This kernel is not a pesudo kernel, assert the result register is
     // either unset or an IndirectAsyncValue.
-    assert(result_register.value == nullptr ||
-           result_register.value->IsUnresolvedIndirect());
+    assert(register_array[result_reg_idx].value == nullptr ||
+           register_array[result_reg_idx].value->IsUnresolvedIndirect());
 
     // Copy back the result AsyncValue to this result register.
     RCReference<AsyncValue> result =
         kernel_frame->ReleaseResultAt(result_number);
     assert(result && "Kernel did not set result AsyncValue");
-    if (result_register.user_count == 0) {
+    if (function_info_.user_count(result_reg_idx) == 0) {
       // If no one uses this result, skip storing the value in the register.
       // Note the reference to `result` will be dropped.
       continue;
@@ -569,53 +966,222 @@ void BEFExecutor::ProcessReadyKernel(unsigned kernel_id,
 
     DebugPrintError(kernel, kernel_id, result.get());
 
+    if (timeout_ms != 0 && !result->IsAvailable()) {
+      if (!timeout) {
+        timeout = TakeRef(
+            new KernelTimeout(BefFile()->GetKernelName(kernel.kernel_code())));
+      }
+      result = timeout->Watch(std::move(result));
+    }
+
     auto used_bys = GetNextUsedBys(kernel, result_number, &entry_offset);
 
     // Process users of this result.
     ProcessUsedBysAndSetRegister(used_bys, ready_kernel_queue,
-                                 std::move(result), &result_register);
+                                 std::move(result), result_reg_idx, kernel_id);
   }
+
+  if (timeout) timeout->Start(timeout_ms, exec_ctx_);
+}
+
+void BEFExecutor::PruneCancelledKernel(const BEFKernel& kernel,
+                                       unsigned kernel_id,
+                                       AsyncValue* cancel_value,
+                                       ReadyKernelQueue& ready_kernel_queue) {
+  MutableArrayRef<BEFFileImpl::RegisterInfo> register_array = register_infos();
+
+  // Drop the references the arguments hold for this kernel, see
+  // SetRegisterValue().
+  int entry_offset = 0;
+  auto arguments =
+      kernel.GetKernelEntries(entry_offset, kernel.num_arguments());
+  for (auto reg_idx : arguments) register_array[reg_idx].value->DropRef();
+
+  // Skip the attributes and functions, and set the results to the cancel
+  // value, which unblocks the users right away.
+  entry_offset +=
+      arguments.size() + kernel.num_attributes() + kernel.num_functions();
+  auto results = kernel.GetKernelEntries(entry_offset, kernel.num_results());
+  entry_offset += results.size();
+
+  for (int result_number = 0; result_number < results.size(); ++result_number) {
+    unsigned result_reg_idx = results[result_number];
+    assert(register_array[result_reg_idx].value == nullptr ||
+           register_array[result_reg_idx].value->IsUnresolvedIndirect());
+    if (function_info_.user_count(result_reg_idx) == 0) continue;
+
+    auto used_bys = GetNextUsedBys(kernel, result_number, &entry_offset);
+    ProcessUsedBysAndSetRegister(used_bys, ready_kernel_queue,
+                                 FormRef(cancel_value), result_reg_idx,
+                                 kernel_id);
+  }
+}
+
+void BEFExecutor::RecordKernelCost(unsigned kernel_id,
+                                   std::chrono::nanoseconds duration) {
+  // An exponential moving average that gives the new sample a weight of 1/8.
+  // Concurrent updates of the same kernel may overwrite each other, which
+  // only drops samples. Zero is reserved for kernels that were not timed.
+  std::atomic<float>& cost = function_info_.layout->kernel_costs_ns[kernel_id];
+  const float ns = std::max<float>(duration.count(), 1);
+  const float old_cost = cost.load(std::memory_order_relaxed);
+  cost.store(old_cost == 0 ? ns : old_cost + (ns - old_cost) / 8,
+             std::memory_order_relaxed);
+}
+
+void BEFExecutor::EnqueueOutlineKernels(ReadyKernelQueue& ready_kernel_queue) {
+  if (ready_kernel_queue.outline_kernel_ids().empty()) return;
+  if (exec_ctx_.IsCancelled()) {
+    ready_kernel_queue.InlineOutlineKernels();
+  } else {
+    EnqueueReadyKernels(ready_kernel_queue.outline_kernel_ids());
+  }
+  assert(ready_kernel_queue.outline_kernel_ids().empty());
 }
 
 // Enqueue `kernel_ids` to the concurrent work queue so that they can be
 // executed in a dfferent thread in parallel.
 LLVM_ATTRIBUTE_NOINLINE void BEFExecutor::EnqueueReadyKernels(
     std::vector<unsigned>& kernel_ids) {
-  auto kernel_array = kernel_infos();
-
   // Sort the kernels by streams to group them.
-  std::sort(
-      kernel_ids.begin(), kernel_ids.end(), [&](unsigned x_id, unsigned y_id) {
-        assert(x_id < kernel_array.size());
-        assert(y_id < kernel_array.size());
-        return kernel_array[x_id].stream_id < kernel_array[y_id].stream_id;
-      });
-
-  // For each stream group, we enqueue the kernels to the work queue.
+  std::sort(kernel_ids.begin(), kernel_ids.end(),
+            [&](unsigned x_id, unsigned y_id) {
+              return function_info_.stream_id(x_id) <
+                     function_info_.stream_id(y_id);
+            });
+
+  // Collect the kernels of each stream group into one batch.
+  llvm::SmallVector<StreamBatch, 4> batches;
   for (auto iter = kernel_ids.begin(); iter != kernel_ids.end();) {
-    int stream_id = kernel_array[*iter].stream_id;
+    int stream_id = function_info_.stream_id(*iter);
     auto jter = iter++;
-    for (;
-         iter != kernel_ids.end() && kernel_array[*iter].stream_id == stream_id;
+    for (; iter != kernel_ids.end() &&
+           function_info_.stream_id(*iter) == stream_id;
          ++iter) {
     }
+    batches.push_back({stream_id, std::vector<unsigned>(jter, iter)});
+  }
 
-    std::vector<unsigned> stream_kernel_ids(jter, iter);
-    AddRef();
-    EnqueueWork(
-        exec_ctx_,
-        [this, stream_id, kernel_ids = std::move(stream_kernel_ids)]() mutable {
-          ReadyKernelQueue ready_kernel_queue(stream_id, kernel_infos(),
-                                              std::move(kernel_ids));
-          ProcessReadyKernels(ready_kernel_queue);
-          DropRef();
-        });
+  if (max_pool_workers_ > 0) {
+    PushStreamBatches(batches);
+  } else {
+    EnqueueStreamBatches(batches);
   }
 
   // Clear the kernel_ids as they are enqueued.
   kernel_ids.clear();
 }
 
+void BEFExecutor::EnqueueStreamBatches(MutableArrayRef<StreamBatch> batches) {
+  llvm::SmallVector<int, 8> stream_ids;
+  llvm::SmallVector<TaskFunction, 8> tasks;
+
+  // With no more batches than workers, every batch gets a task of its own.
+  if (batches.size() <= static_cast<size_t>(max_outline_tasks_)) {
+    for (auto& batch : batches) {
+      AddRef();
+      auto work = [this, stream_id = batch.stream_id,
+                   kernel_ids = std::move(batch.kernel_ids)]() mutable {
+        ReadyKernelQueue ready_kernel_queue(stream_id, function_info(),
+                                            std::move(kernel_ids));
+        ProcessReadyKernels(ready_kernel_queue);
+        DropRef();
+      };
+      stream_ids.push_back(batch.stream_id);
+      tasks.push_back(TaskFunction(std::move(work)));
+    }
+    EnqueueStreamTasks(stream_ids, tasks);
+    return;
+  }
+
+  // Otherwise at most `max_outline_tasks_` of them can run in parallel anyway,
+  // so deal the batches round robin to that many tasks. Each task has the
+  // affinity of its first stream.
+  llvm::SmallVector<llvm::SmallVector<StreamBatch, 4>, 8> task_batches(
+      max_outline_tasks_);
+  for (size_t i = 0; i < batches.size(); ++i)
+    task_batches[i % max_outline_tasks_].push_back(std::move(batches[i]));
+
+  for (auto& task_batch : task_batches) {
+    AddRef();
+    const int stream_id = task_batch.front().stream_id;
+    auto work = [this, task_batch = std::move(task_batch)]() mutable {
+      for (auto& batch : task_batch) {
+        ReadyKernelQueue ready_kernel_queue(
+            batch.stream_id, function_info(), std::move(batch.kernel_ids));
+        ProcessReadyKernels(ready_kernel_queue);
+      }
+      DropRef();
+    };
+    stream_ids.push_back(stream_id);
+    tasks.push_back(TaskFunction(std::move(work)));
+  }
+  EnqueueStreamTasks(stream_ids, tasks);
+}
+
+void BEFExecutor::EnqueueStreamTasks(ArrayRef<int> stream_ids,
+                                     MutableArrayRef<TaskFunction> tasks) {
+  assert(stream_ids.size() == tasks.size());
+  if (!stream_affinity_) {
+    EnqueueWork(exec_ctx_, tasks);
+    return;
+  }
+  for (size_t i = 0; i < tasks.size(); ++i)
+    EnqueueWork(exec_ctx_, GetStreamAffinity(stream_ids[i]),
+                std::move(tasks[i]));
+}
+
+void BEFExecutor::PushStreamBatches(MutableArrayRef<StreamBatch> batches) {
+  int num_workers_to_start = 0;
+  {
+    mutex_lock lock(ready_pool_mu_);
+    for (auto& batch : batches) ready_pool_.push_back(std::move(batch));
+    num_workers_to_start =
+        std::min(static_cast<int>(batches.size()),
+                 max_pool_workers_ - num_pool_workers_);
+    num_pool_workers_ += num_workers_to_start;
+  }
+
+  // The remaining batches are picked up by the running workers, as workers
+  // only exit after observing an empty pool under the lock.
+  llvm::SmallVector<TaskFunction, 8> workers;
+  for (int i = 0; i < num_workers_to_start; ++i) {
+    AddRef();
+    workers.push_back(TaskFunction([this]() {
+      DrainReadyPool();
+      DropRef();
+    }));
+  }
+  EnqueueWork(exec_ctx_, workers);
+}
+
+void BEFExecutor::DrainReadyPool() {
+  llvm::SmallVector<StreamBatch, 4> batches;
+  while (true) {
+    {
+      mutex_lock lock(ready_pool_mu_);
+      if (ready_pool_.empty()) {
+        --num_pool_workers_;
+        return;
+      }
+      // Take up to `steal_batch_size_` stream batches at once to amortize the
+      // synchronization on the pool.
+      while (!ready_pool_.empty() &&
+             static_cast<int>(batches.size()) < steal_batch_size_) {
+        batches.push_back(std::move(ready_pool_.front()));
+        ready_pool_.pop_front();
+      }
+    }
+
+    for (auto& batch : batches) {
+      ReadyKernelQueue ready_kernel_queue(batch.stream_id, function_info(),
+                                          std::move(batch.kernel_ids));
+      ProcessReadyKernels(ready_kernel_queue);
+    }
+    batches.clear();
+  }
+}
+
 // Iteratively process ready kernels in `ready_kernel_queue` and inserts ready
 // users back for next round of processing, until there are no more ready
 // kernels.
@@ -623,17 +1189,20 @@ void BEFExecutor::ProcessReadyKernels(ReadyKernelQueue& ready_kernel_queue) {
   // Process the kernel record to get information about what argument
   // registers, result registers, and attributes should be passed.
   KernelFrameBuilder kernel_frame(exec_ctx_);
-  kernel_frame.SetAttributeSection(BefFile()->attribute_section_);
+  kernel_frame.SetAttributeSection(BefFile()->attribute_section_,
+                                   BefFile()->attribute_section_owner());
   kernel_frame.SetFunctions(BefFile()->functions_);
 
+  RequestStats* stats = exec_ctx_.request_ctx()->stats();
+  RequestStats::Scope stats_scope(stats);
+  int64_t num_kernels = 0;
+
   // Switch stream id if there are no inline kernels to process.
   if (ready_kernel_queue.inline_kernel_ids().empty())
     ready_kernel_queue.SwitchStreamId();
 
   // Enqueue outline kernels into the concurrent work queue.
-  if (!ready_kernel_queue.outline_kernel_ids().empty())
-    EnqueueReadyKernels(ready_kernel_queue.outline_kernel_ids());
-  assert(ready_kernel_queue.outline_kernel_ids().empty());
+  EnqueueOutlineKernels(ready_kernel_queue);
 
   // The loop below process inline kernels in a LIFO order for cache locality.
   // Outline kernels are enqueued to the concurrent work queue immediately.
@@ -643,16 +1212,17 @@ void BEFExecutor::ProcessReadyKernels(ReadyKernelQueue& ready_kernel_queue) {
     ready_kernel_queue.inline_kernel_ids().pop_back();
 
     ProcessReadyKernel(kernel_id, &kernel_frame, ready_kernel_queue);
+    ++num_kernels;
 
     // Switch stream id if there are no inline kernels to process.
     if (ready_kernel_queue.inline_kernel_ids().empty())
       ready_kernel_queue.SwitchStreamId();
 
     // Enqueue outline kernels into the concurrent work queue.
-    if (!ready_kernel_queue.outline_kernel_ids().empty())
-      EnqueueReadyKernels(ready_kernel_queue.outline_kernel_ids());
-    assert(ready_kernel_queue.outline_kernel_ids().empty());
+    EnqueueOutlineKernels(ready_kernel_queue);
   }
+
+  if (stats) stats->AddKernelsExecuted(num_kernels);
 }
 
 //===----------------------------------------------------------------------===//
@@ -660,12 +1230,65 @@ void BEFExecutor::ProcessReadyKernels(ReadyKernelQueue& ready_kernel_queue) {
 //===----------------------------------------------------------------------===//
 
 BEFExecutor::BEFExecutor(ExecutionContext exec_ctx, BEFFileImpl* bef_file)
-    : exec_ctx_(std::move(exec_ctx)), bef_file_(FormRef(bef_file)) {}
+    : exec_ctx_(std::move(exec_ctx)), bef_file_(FormRef(bef_file)) {
+  max_outline_tasks_ =
+      std::max(1, exec_ctx_.work_queue().GetParallelismLevel());
+
+  auto* options =
+      exec_ctx_.request_ctx()->GetDataIfExists<BEFExecutorOptions>();
+  if (options != nullptr && options->work_stealing) {
+    max_pool_workers_ = max_outline_tasks_;
+    steal_batch_size_ = std::max(1, options->steal_batch_size);
+  }
+  if (options != nullptr) {
+    kernel_profile_ = options->kernel_profile;
+    kernel_cpu_profile_ = options->kernel_cpu_profile;
+    kernel_sampler_ = options->kernel_sampler;
+    attribute_allocations_ = options->attribute_allocations;
+    critical_path_recorder_ = options->critical_path_recorder;
+    adaptive_placement_ =
+        options->adaptive_placement && IsAdaptivePlacementAllowed();
+    adaptive_sample_period_ =
+        std::max<uint32_t>(options->adaptive_sample_period, 1);
+    stream_affinity_ = options->stream_affinity;
+  }
+}
+
+BEFExecutor::~BEFExecutor() {
+  if (timeline_) critical_path_recorder_->Record(GetExecutionTrace());
+}
 
-BEFExecutor::~BEFExecutor() {}
+ExecutionTrace BEFExecutor::GetExecutionTrace() {
+  ExecutionTrace trace;
+  trace.function_name = function_name_.str();
+  const size_t num_kernels = function_info_.layout->kernel_entries.size();
+  trace.kernels.resize(num_kernels);
+
+  for (unsigned kernel_id = 0; kernel_id < num_kernels; ++kernel_id) {
+    KernelTrace& kernel_trace = trace.kernels[kernel_id];
+    timeline_->GetKernelTrace(kernel_id, &kernel_trace);
+    kernel_trace.stream_id = function_info_.stream_id(kernel_id);
+
+    unsigned kernel_offset = function_info_.kernel_entry(kernel_id).offset;
+    BEFKernel kernel(kernels().data() + kernel_offset / kKernelEntryAlignment);
+    kernel_trace.name = kernel_id == kPseudoKernelId
+                            ? "<arguments>"
+                            : BefFile()->GetKernelName(kernel.kernel_code());
+
+    // The used_bys follow the results, see ProcessReadyKernel().
+    int entry_offset = kernel.num_arguments() + kernel.num_attributes() +
+                       kernel.num_functions() + kernel.num_results();
+    for (int result_number = 0; result_number < kernel.num_results();
+         ++result_number) {
+      for (unsigned user : GetNextUsedBys(kernel, result_number, &entry_offset))
+        kernel_trace.users.push_back(user);
+    }
+  }
+  return trace;
+}
 
 void BEFExecutor::Execute(std::vector<RCReference<AsyncValue>> arguments) {
-  // Each KernelInfo::arguments_not_ready to the number of arguments (or one for
+  // Each ready count is initialized to the number of arguments (or one for
   // kernels with no arguments). This means that as we walk the list to drop the
   // argument count, if we hit zero then it is time for us to trigger the
   // computation. This arrangement is nice because any sync or async kernel that
@@ -675,8 +1298,8 @@ void BEFExecutor::Execute(std::vector<RCReference<AsyncValue>> arguments) {
   // (very cache friendly), and results in all the atomics staying in that
   // cores' cache, if these benefits outweigh the latency improvement from
   // launching these kernels in different threads.
-  ReadyKernelQueue ready_kernel_queue(kernel_infos()[kPseudoKernelId].stream_id,
-                                      kernel_infos());
+  ReadyKernelQueue ready_kernel_queue(
+      function_info_.stream_id(kPseudoKernelId), function_info());
 
   // The first kernel (kernel_id == 0) is a pseudo kernel that provides the
   // arguments, which gets special handling.
@@ -688,6 +1311,19 @@ void BEFExecutor::Execute(std::vector<RCReference<AsyncValue>> arguments) {
   ProcessReadyKernels(ready_kernel_queue);
 }
 
+// The executor blocks of a function hold the executor, followed by the
+// register and ready count arrays of the function.
+static constexpr size_t kExecutorSize =
+    (sizeof(BEFExecutor) + kCacheLineSize - 1) / kCacheLineSize *
+    kCacheLineSize;
+static constexpr size_t kExecutorBlockAlignment =
+    std::max(alignof(BEFExecutor), size_t{kCacheLineSize});
+
+static size_t GetExecutorBlockSize(const BEFFunctionLayout* layout) {
+  return kExecutorSize +
+         (layout ? BEFFileImpl::GetInfoStorageSize(*layout) : 0);
+}
+
 RCReference<BEFExecutor> BEFExecutor::Create(
     ExecutionContext exec_ctx, const BEFFunction& fn,
     ArrayRef<RCReference<AsyncValue>> arguments,
@@ -698,15 +1334,30 @@ RCReference<BEFExecutor> BEFExecutor::Create(
   assert(results.size() == fn.result_types().size() &&
          "incorrect number of results passed to function call");
 
-  HostContext* host = exec_ctx.host();
-  auto* exec_ptr = host->Allocate<BEFExecutor>();
+  HostAllocator* allocator = exec_ctx.request_ctx()->allocator();
+
+  // Reuse the memory of a previous execution of `fn` if possible. Functions
+  // that are executed over and over, such as loop bodies, then do not allocate
+  // an executor per execution. Executions beyond the capacity of the pool,
+  // e.g. deep recursion, fall back to the request allocator. A pooled block
+  // also holds the register and ready count arrays that do not fit inline.
+  const BEFFunctionLayout* layout = fn.GetLayout();
+  ExecutorBlockPool& pool = fn.executor_pool();
+  void* exec_ptr =
+      pool.Allocate(GetExecutorBlockSize(layout), kExecutorBlockAlignment);
+  bool pooled = exec_ptr != nullptr;
+  if (!pooled) exec_ptr = allocator->Allocate<BEFExecutor>();
   auto* exec = new (exec_ptr) BEFExecutor(std::move(exec_ctx), bef_file);
+  if (pooled) exec->executor_pool_ = &pool;
+  RCReference<BEFExecutor> exec_ref = TakeRef(exec);
 
   size_t location_offset;
   llvm::SmallVector<size_t, 4> result_regs;
-  bool success = bef_file->ReadFunction(fn.function_offset(), fn.result_types(),
-                                        &location_offset, &exec->function_info_,
-                                        &result_regs, host->allocator());
+  void* info_storage =
+      pooled ? static_cast<char*>(exec_ptr) + kExecutorSize : nullptr;
+  bool success =
+      bef_file->ReadFunction(fn, &location_offset, &exec->function_info_,
+                             &result_regs, allocator, info_storage);
   if (!success) {
     for (size_t i = 0, e = results.size(); i != e; ++i) {
       assert(!results[i] && "result AsyncValue is not nullptr");
@@ -717,6 +1368,23 @@ RCReference<BEFExecutor> BEFExecutor::Create(
 
   assert(result_regs.size() == fn.result_types().size());
 
+  if (exec->adaptive_placement_) {
+    auto* options =
+        exec->exec_ctx_.request_ctx()->GetDataIfExists<BEFExecutorOptions>();
+    exec->function_info_.adaptive_placement = true;
+    exec->function_info_.max_inline_cost_ns = options->max_inline_kernel_ns;
+    exec->function_info_.min_outline_cost_ns = options->min_outline_kernel_ns;
+  }
+
+  if (exec->critical_path_recorder_ != nullptr) {
+    exec->timeline_ = std::make_unique<ExecutionTimeline>(
+        exec->function_info_.layout->kernel_entries.size());
+  }
+  if (exec->critical_path_recorder_ != nullptr ||
+      exec->kernel_cpu_profile_ != nullptr) {
+    exec->function_name_ = fn.name();
+  }
+
   MutableArrayRef<BEFFileImpl::RegisterInfo> register_array =
       exec->register_infos();
 
@@ -731,6 +1399,7 @@ RCReference<BEFExecutor> BEFExecutor::Create(
   for (size_t i = 0, e = results.size(); i != e; ++i) {
     assert(!results[i] && "result AsyncValue is not nullptr");
     BEFFileImpl::RegisterInfo& result_reg = register_array[result_regs[i]];
+    unsigned user_count = exec->function_info_.user_count(result_regs[i]);
 
     if (!result_reg.value) {
       // Create an indirect async value for return results.
@@ -740,7 +1409,7 @@ RCReference<BEFExecutor> BEFExecutor::Create(
       // in the function. The additional +1 is to pin this async value for this
       // function, in case that the external users drop the reference before the
       // kernels in the function populates it.
-      indirect_value->AddRef(result_reg.user_count);
+      indirect_value->AddRef(user_count);
       result_reg.value = indirect_value;
     }
 
@@ -750,7 +1419,7 @@ RCReference<BEFExecutor> BEFExecutor::Create(
     results[i] = TakeRef(result_reg.value);
   }
 
-  return TakeRef(exec);
+  return exec_ref;
 }
 
 void BEFExecutor::Execute(ExecutionContext exec_ctx, const BEFFunction& fn,
@@ -778,9 +1447,11 @@ void BEFExecutor::ExecuteAsync(
       BEFExecutor::Create(std::move(exec_ctx), fn, arguments, results);
   if (!exec) return;
 
-  auto& work_queue = exec->exec_ctx_.work_queue();
-  work_queue.AddTask([&fn, exec = std::move(exec),
-                      arg_copies = std::move(arguments)]() mutable {
+  // `exec` keeps its execution context alive until the task has run. The task
+  // is enqueued at the priority and deadline of the request.
+  const ExecutionContext& exec_ctx_ref = exec->exec_ctx_;
+  auto execute = [&fn, exec = std::move(exec),
+                  arg_copies = std::move(arguments)]() mutable {
     DEBUG_PRINT("Execute function %s start\n",
                 fn.name().empty() ? "(unknown)" : fn.name().str().c_str());
 
@@ -790,9 +1461,265 @@ void BEFExecutor::ExecuteAsync(
     DEBUG_PRINT("Execute function %s end\n",
                 fn.name().empty() ? "(unknown)" : fn.name().str().c_str());
     (void)fn;
+  };
+  EnqueueWork(exec_ctx_ref, std::move(execute));
+}
+
+//===----------------------------------------------------------------------===//
+// Fused function execution
+//===----------------------------------------------------------------------===//
+
+namespace {
+
+// FusedExecution runs the kernels of a kFusedBEFFunction one after another in
+// program order, reusing one KernelFrameBuilder for all of them. Unlike
+// BEFExecutor, it keeps no ready queue and no per-kernel ready counts: the
+// kernel fusion pass only produces straight-line functions, for which program
+// order is the only schedule.
+//
+// If an argument of the next kernel is not available yet (e.g. a function
+// argument, or the result of a kernel that completes asynchronously), the
+// execution is moved to the heap and resumed when the argument is available.
+class FusedExecution {
+ public:
+  FusedExecution(const ExecutionContext& exec_ctx, const BEFFunction& fn,
+                 const BEFFunctionLayout& layout)
+      : exec_ctx_(exec_ctx),
+        bef_file_(FormRef(fn.bef_file())),
+        layout_(layout),
+        registers_(layout.register_user_counts.size()),
+        remaining_uses_(layout.register_user_counts.begin(),
+                        layout.register_user_counts.end()) {}
+
+  // Bind `arguments` to the result registers of the pseudo kernel.
+  void SetArguments(ArrayRef<AsyncValue*> arguments);
+
+  // Run the kernels from `next_kernel_id_` on. Return nullptr if all kernels
+  // have run, or the unavailable argument of the next kernel otherwise.
+  AsyncValue* Run();
+
+  // Populate `results` after all kernels have run.
+  void GetResults(MutableArrayRef<RCReference<AsyncValue>> results) const;
+
+  // Populate `results` with IndirectAsyncValues for the results that are not
+  // computed yet, to be forwarded by ForwardResults().
+  void GetPendingResults(MutableArrayRef<RCReference<AsyncValue>> results);
+  void ForwardResults();
+
+  // Resume `execution` when `value` becomes available.
+  static void RunWhenReady(std::unique_ptr<FusedExecution> execution,
+                           AsyncValue* value);
+
+ private:
+  void RunKernel(const BEFKernel& kernel, KernelFrameBuilder* kernel_frame);
+
+  ExecutionContext exec_ctx_;
+  RCReference<BEFFileImpl> bef_file_;
+  const BEFFunctionLayout& layout_;
+
+  // The kernel to run next. Kernel 0 is the pseudo kernel for the arguments.
+  size_t next_kernel_id_ = 1;
+  llvm::SmallVector<RCReference<AsyncValue>, 16> registers_;
+  // The number of uses of each register that are not executed yet. The uses by
+  // the function results are never executed, so they keep result registers
+  // alive until the end.
+  llvm::SmallVector<uint32_t, 16> remaining_uses_;
+  // Results that were not computed when the execution was suspended, with the
+  // index of the function result.
+  llvm::SmallVector<std::pair<size_t, RCReference<IndirectAsyncValue>>, 4>
+      pending_results_;
+};
+
+void FusedExecution::SetArguments(ArrayRef<AsyncValue*> arguments) {
+  BEFKernel kernel(layout_.kernels.data());
+  auto results = kernel.GetKernelEntries(0, kernel.num_results());
+
+  // The first result is the pseudo result that triggers the kernels with no
+  // operands, which has no register.
+  assert(arguments.size() + 1 == results.size());
+  for (size_t i = 0; i < arguments.size(); ++i) {
+    uint32_t reg = results[i + 1];
+    if (remaining_uses_[reg] > 0) registers_[reg] = FormRef(arguments[i]);
+  }
+}
+
+AsyncValue* FusedExecution::Run() {
+  KernelFrameBuilder kernel_frame(exec_ctx_);
+  kernel_frame.SetAttributeSection(bef_file_->attribute_section_,
+                                   bef_file_->attribute_section_owner());
+  kernel_frame.SetFunctions(bef_file_->functions_);
+
+  RequestStats* stats = exec_ctx_.request_ctx()->stats();
+  RequestStats::Scope stats_scope(stats);
+  const size_t first_kernel_id = next_kernel_id_;
+  auto record_kernels = [&] {
+    if (stats) stats->AddKernelsExecuted(next_kernel_id_ - first_kernel_id);
+  };
+
+  for (; next_kernel_id_ < layout_.kernel_entries.size(); ++next_kernel_id_) {
+    const auto& kernel_entry = layout_.kernel_entries[next_kernel_id_];
+    assert(kernel_entry.offset % kKernelEntryAlignment == 0);
+    BEFKernel kernel(layout_.kernels.data() +
+                     kernel_entry.offset / kKernelEntryAlignment);
+
+    for (uint32_t reg : kernel.GetKernelEntries(0, kernel.num_arguments())) {
+      AsyncValue* value = registers_[reg].get();
+      assert(value && "kernel argument is not defined before its use");
+      if (!value->IsAvailable()) {
+        record_kernels();
+        return value;
+      }
+    }
+
+    kernel_frame.SetCallSiteSlot(&layout_.call_site_slots[next_kernel_id_]);
+    RunKernel(kernel, &kernel_frame);
+  }
+
+  record_kernels();
+  return nullptr;
+}
+
+void FusedExecution::RunKernel(const BEFKernel& kernel,
+                               KernelFrameBuilder* kernel_frame) {
+  AsyncValue* any_error_argument = exec_ctx_.GetCancelAsyncValue();
+
+  // Set up operands. The last use of a register hands its reference over to
+  // the kernel, so that it can forward the buffers of unique arguments.
+  kernel_frame->Reserve(kernel.num_arguments(), kernel.num_results());
+  int entry_offset = 0;
+  auto arguments =
+      kernel.GetKernelEntries(entry_offset, kernel.num_arguments());
+  for (uint32_t reg : arguments) {
+    RCReference<AsyncValue>& value = registers_[reg];
+    if (value->IsError()) any_error_argument = value.get();
+    if (--remaining_uses_[reg] == 0) {
+      kernel_frame->AddArg(std::move(value));
+    } else {
+      kernel_frame->AddArg(value.CopyRef());
+    }
+  }
+  kernel_frame->SetNumResults(kernel.num_results());
+
+  entry_offset += arguments.size();
+  auto attributes =
+      kernel.GetKernelEntries(entry_offset, kernel.num_attributes());
+  kernel_frame->SetAttributes(attributes);
+
+  entry_offset += attributes.size();
+  auto function_indices =
+      kernel.GetKernelEntries(entry_offset, kernel.num_functions());
+  kernel_frame->SetFunctionIndices(function_indices);
+
+  if (any_error_argument == nullptr) {
+    kernel_frame->SetLocation(
+        {bef_file_->location_handler(), kernel.kernel_location()});
+
+    TFRT_TRACE_SCOPE(Debug, bef_file_->GetKernelName(kernel.kernel_code()));
+    bef_file_->GetAsyncKernel(kernel.kernel_code())(kernel_frame);
+  } else {
+    for (size_t i = 0, e = kernel_frame->GetNumResults(); i != e; ++i) {
+      kernel_frame->SetResultAt(i, FormRef(any_error_argument));
+    }
+  }
+
+  kernel_frame->ResetArguments();
+
+  entry_offset += function_indices.size();
+  auto results = kernel.GetKernelEntries(entry_offset, kernel.num_results());
+  for (int i = 0, e = results.size(); i != e; ++i) {
+    RCReference<AsyncValue> result = kernel_frame->ReleaseResultAt(i);
+    assert(result && "Kernel did not set result AsyncValue");
+    // Results without users are dropped right away.
+    if (remaining_uses_[results[i]] > 0)
+      registers_[results[i]] = std::move(result);
+  }
+}
+
+void FusedExecution::GetResults(
+    MutableArrayRef<RCReference<AsyncValue>> results) const {
+  assert(results.size() == layout_.result_regs.size());
+  for (size_t i = 0, e = results.size(); i != e; ++i) {
+    assert(!results[i] && "result AsyncValue is not nullptr");
+    results[i] = registers_[layout_.result_regs[i]].CopyRef();
+  }
+}
+
+void FusedExecution::GetPendingResults(
+    MutableArrayRef<RCReference<AsyncValue>> results) {
+  assert(results.size() == layout_.result_regs.size());
+  for (size_t i = 0, e = results.size(); i != e; ++i) {
+    assert(!results[i] && "result AsyncValue is not nullptr");
+    if (const auto& value = registers_[layout_.result_regs[i]]) {
+      results[i] = value.CopyRef();
+    } else {
+      auto indirect = MakeIndirectAsyncValue();
+      results[i] = indirect.CopyRef();
+      pending_results_.emplace_back(i, std::move(indirect));
+    }
+  }
+}
+
+void FusedExecution::ForwardResults() {
+  for (auto& pending : pending_results_) {
+    pending.second->ForwardTo(
+        registers_[layout_.result_regs[pending.first]].CopyRef());
+  }
+  pending_results_.clear();
+}
+
+void FusedExecution::RunWhenReady(std::unique_ptr<FusedExecution> execution,
+                                  AsyncValue* value) {
+  value->AndThen([execution = std::move(execution)]() mutable {
+    // Keep track of the call stack depth to prevent stack overflows.
+    StackOverflowGuard guard;
+
+    ExecutionContext exec_ctx = execution->exec_ctx_;
+    auto continuation = [execution = std::move(execution)]() mutable {
+      if (AsyncValue* value = execution->Run()) {
+        RunWhenReady(std::move(execution), value);
+      } else {
+        execution->ForwardResults();
+      }
+    };
+
+    // Maybe schedule continuation as a separate task to prevent stack overflow.
+    if (StackOverflowGuard::MustEnqueue())
+      EnqueueWork(exec_ctx, std::move(continuation));
+    else
+      continuation();
   });
 }
 
+}  // namespace
+
+void BEFFunction::ExecuteFused(
+    const ExecutionContext& exec_ctx, ArrayRef<AsyncValue*> arguments,
+    MutableArrayRef<RCReference<AsyncValue>> results) const {
+  const BEFFunctionLayout* layout = GetLayout();
+  if (layout == nullptr) {
+    for (auto& result : results) {
+      assert(!result && "result AsyncValue is not nullptr");
+      result = MakeErrorAsyncValueRef(
+          absl::InternalError("Could not read BEF function."));
+    }
+    return;
+  }
+
+  // The common case of a fused function whose kernels all complete
+  // synchronously runs without any heap allocation for the execution state.
+  FusedExecution execution(exec_ctx, *this, *layout);
+  execution.SetArguments(arguments);
+  AsyncValue* pending = execution.Run();
+  if (pending == nullptr) {
+    execution.GetResults(results);
+    return;
+  }
+
+  execution.GetPendingResults(results);
+  FusedExecution::RunWhenReady(
+      std::make_unique<FusedExecution>(std::move(execution)), pending);
+}
+
 //===----------------------------------------------------------------------===//
 // BEFFunction implementation
 //===----------------------------------------------------------------------===//
@@ -801,6 +1728,11 @@ void BEFExecutor::ExecuteAsync(
 void BEFFunction::Execute(
     const ExecutionContext& exec_ctx, ArrayRef<AsyncValue*> arguments,
     MutableArrayRef<RCReference<AsyncValue>> results) const {
+  if (function_kind() == FunctionKind::kFusedBEFFunction) {
+    ExecuteFused(exec_ctx, arguments, results);
+    return;
+  }
+
   std::vector<RCReference<AsyncValue>> args;
   args.reserve(arguments.size());
   for (auto* av : arguments) {
@@ -814,6 +1746,14 @@ void BEFFunction::ExecuteByValue(
     const ExecutionContext& exec_ctx,
     std::vector<RCReference<AsyncValue>> arguments,
     MutableArrayRef<RCReference<AsyncValue>> results) const {
+  if (function_kind() == FunctionKind::kFusedBEFFunction) {
+    llvm::SmallVector<AsyncValue*, 4> args;
+    args.reserve(arguments.size());
+    for (auto& arg : arguments) args.push_back(arg.get());
+    ExecuteFused(exec_ctx, args, results);
+    return;
+  }
+
   BEFExecutor::Execute(exec_ctx, *this, std::move(arguments), results);
 }
 
@@ -824,6 +1764,17 @@ void BEFFunction::ExecuteAsync(
   BEFExecutor::ExecuteAsync(exec_ctx, *this, std::move(arguments), results);
 }
 
+void BEFFunction::Prepare() const {
+  if (function_kind() != FunctionKind::kBEFFunction) return;
+  const BEFFunctionLayout* layout = GetLayout();
+  if (layout == nullptr) return;
+  // If the pool has no free block, this allocates one and leaves it there.
+  ExecutorBlockPool& pool = executor_pool();
+  if (void* block =
+          pool.Allocate(GetExecutorBlockSize(layout), kExecutorBlockAlignment))
+    pool.Deallocate(block);
+}
+
 // To keep this function alive, we have to keep the underlying BEF file alive.
 void BEFFunction::AddRef() const { bef_file_->AddRef(); }
 
@@ -19,18 +19,29 @@
 
 #include "tfrt/bef_executor/bef_file.h"
 
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <numeric>
 #include <optional>
+#include <vector>
 
 #include "bef_file_impl.h"
+#include "llvm/Support/MathExtras.h"
+#include "tfrt/bef/bef_compression.h"
 #include "tfrt/bef/bef_encoding.h"
 #include "tfrt/bef/bef_location.h"
 #include "tfrt/bef/bef_reader.h"
+#include "tfrt/host_context/async_dispatch.h"
 #include "tfrt/host_context/async_value.h"
 #include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
 #include "tfrt/host_context/host_context.h"
 #include "tfrt/host_context/location.h"
 #include "tfrt/host_context/native_function.h"
+#include "tfrt/io/file_system.h"
 #include "tfrt/support/error_util.h"
+#include "tfrt/support/mutex.h"
 #include "tfrt/support/variant.h"
 
 namespace tfrt {
@@ -55,29 +66,81 @@ struct FunctionIndex {
 //
 // These functions return true on success.
 // When a failure occurs, emit an error message and return false.
+//
+// If `host` is not null, the kernels and the BEFFunction layouts are decoded
+// in parallel on its work queue.
 class BEFFileReader : public BEFReader {
  public:
   BEFFileReader(ArrayRef<uint8_t> file, const KernelRegistry& registry,
-                BEFFileImpl* bef_file)
-      : BEFReader(file), registry_(registry), bef_file_(bef_file) {}
+                BEFFileImpl* bef_file, HostContext* host = nullptr)
+      : BEFReader(file),
+        registry_(registry),
+        bef_file_(bef_file),
+        host_(host) {}
 
   bool ReadNextSection();
-  bool ReadKernelsSection(HostAllocator* host_allocator);
+  bool ReadKernelsSection();
   bool ReadTypesSection();
   bool ReadFunctionIndexSection();
+  // Decodes the layouts of all the BEFFunctions, and the tables of all the
+  // SyncBEFFunctions, read by ReadFunctionIndexSection().
+  bool DecodeFunctionLayouts();
 
  private:
   bool ReadFunctionIndexSectionInternal(
       llvm::SmallVectorImpl<FunctionIndex>* function_indices);
-  bool DiagnoseUnknownKernel(size_t kernel_idx, const char* kernel_name,
-                             HostAllocator* host_allocator);
+  bool DiagnoseUnknownKernel(size_t kernel_idx, const char* kernel_name);
 
   // These are things set up at construction time.
   const KernelRegistry& registry_;
 
   // This is the file structure we're reading.
   BEFFileImpl* bef_file_;
+
+  HostContext* const host_;
+
+  // The BEFFunctions and FusedBEFFunctions of the file.
+  std::vector<const BEFFunction*> bef_functions_;
+  // The SyncBEFFunctions of the file.
+  std::vector<const SyncBEFFunction*> sync_functions_;
 };
+
+// The minimum number of items decoded by one task of ParallelForEachBlock().
+constexpr size_t kMinKernelsPerBlock = 256;
+constexpr size_t kMinFunctionsPerBlock = 16;
+
+// Calls `fn(begin, end)` for non-overlapping blocks of [0, size) on the work
+// queue of `host` and in the caller thread, and returns when all the blocks
+// are done. Calls `fn(0, size)` inline if `host` is null or has no worker
+// threads.
+template <typename F>
+void ParallelForEachBlock(HostContext* host, size_t size,
+                          size_t min_block_size, const F& fn) {
+  const size_t num_threads = host ? host->GetNumWorkerThreads() : 0;
+  const size_t num_blocks =
+      std::min<size_t>(llvm::divideCeil(size, min_block_size), 4 * num_threads);
+  if (num_blocks <= 1) {
+    fn(0, size);
+    return;
+  }
+
+  const size_t block_size = llvm::divideCeil(size, num_blocks);
+  mutex mu;
+  condition_variable done;
+  size_t num_pending = num_blocks - 1;
+  for (size_t block = 1; block < num_blocks; ++block) {
+    EnqueueWork(host, [&, block] {
+      fn(std::min(size, block * block_size),
+         std::min(size, (block + 1) * block_size));
+      mutex_lock lock(mu);
+      if (--num_pending == 0) done.notify_one();
+    });
+  }
+  fn(0, block_size);
+
+  mutex_lock lock(mu);
+  while (num_pending > 0) done.wait(lock);
+}
 }  // namespace
 
 bool BEFFileReader::ReadNextSection() {
@@ -131,6 +194,16 @@ bool BEFFileReader::ReadNextSection() {
       SkipPast(section_data);
       break;
 
+    case tfrt::BEFSectionID::kRegisterTypes:
+      bef_file_->register_types_section_ = section_data;
+      SkipPast(section_data);
+      break;
+
+    case tfrt::BEFSectionID::kKernelTimeouts:
+      bef_file_->kernel_timeouts_section_ = section_data;
+      SkipPast(section_data);
+      break;
+
     case tfrt::BEFSectionID::kLocationStrings:
       bef_file_->location_strings_section_ = section_data;
       SkipPast(section_data);
@@ -140,6 +213,21 @@ bool BEFFileReader::ReadNextSection() {
       bef_file_->locations_section_ = section_data;
       SkipPast(section_data);
       break;
+
+    // Of the sections that may be compressed, only the location sections are
+    // used by the executor. They are decompressed when they are first needed.
+    case tfrt::BEFSectionID::kCompressed: {
+      CompressedBEFSection compressed;
+      if (!ReadCompressedBEFSection(section_data, &compressed)) {
+        bef_file_->EmitFormatError("BEF file compressed section corrupted");
+        return false;
+      }
+      if (compressed.section_id == BEFSectionID::kLocationStrings ||
+          compressed.section_id == BEFSectionID::kLocations)
+        bef_file_->compressed_location_sections_.push_back(compressed);
+      SkipPast(section_data);
+      break;
+    }
   }
 
   // Make sure the section reader consumed the right number of bytes.  Not
@@ -160,8 +248,7 @@ bool BEFFileReader::ReadNextSection() {
 //
 // If we can't find a nice location, we can fallback to a poor location.
 bool BEFFileReader::DiagnoseUnknownKernel(size_t kernel_idx,
-                                          const char* kernel_name,
-                                          HostAllocator* host_allocator) {
+                                          const char* kernel_name) {
   std::string error_message =
       "unknown kernel name '" + std::string(kernel_name) + "'";
 
@@ -176,27 +263,20 @@ bool BEFFileReader::DiagnoseUnknownKernel(size_t kernel_idx,
   // The unknown kernel must be referenced by some function in the program,
   // and each kernel record has location info.  Scan through to see if we can
   // figure out where the reference is coming from.
-  llvm::SmallVector<size_t, 4> result_regs;
-
   for (const auto& function_index : function_indices) {
     if (function_index.kind == FunctionKind::kNativeFunction) continue;
 
-    BEFFileImpl::FunctionInfo function_info;
-
-    result_regs.clear();
-    size_t location_offset;
-    bool success = bef_file_->ReadFunction(
-        function_index.function_offset, function_index.results,
-        &location_offset, &function_info, &result_regs, host_allocator);
+    BEFFunctionLayout layout;
+    bool success = bef_file_->DecodeFunctionLayout(
+        function_index.function_offset, function_index.results.size(),
+        &layout);
     if (!success) continue;
 
     // Decode all of the kernels to see if any refers to our unknown kernel.
-    MutableArrayRef<BEFFileImpl::KernelInfo> kernel_infos_array =
-        function_info.kernel_infos.mutable_array();
-    for (const auto& kernel_info : kernel_infos_array) {
-      assert(kernel_info.offset % kKernelEntryAlignment == 0);
-      BEFKernel kernel(function_info.kernels.data() +
-                       kernel_info.offset / kKernelEntryAlignment);
+    for (const auto& kernel_entry : layout.kernel_entries) {
+      assert(kernel_entry.offset % kKernelEntryAlignment == 0);
+      BEFKernel kernel(layout.kernels.data() +
+                       kernel_entry.offset / kKernelEntryAlignment);
 
       // Okay, we decoded the kernel.  See if this is referring to the
       // current kernel_idx.  If so, we can use its location.  We know that the
@@ -217,7 +297,7 @@ bool BEFFileReader::DiagnoseUnknownKernel(size_t kernel_idx,
 
 // Read the Kernels section from a BEF file, resolving the kernels and
 // returning true on success.  Emit an error and return false on failure.
-bool BEFFileReader::ReadKernelsSection(HostAllocator* host_allocator) {
+bool BEFFileReader::ReadKernelsSection() {
   auto format_error = [&]() -> bool {
     bef_file_->EmitFormatError("invalid Kernels section in BEF file");
     return false;
@@ -228,11 +308,8 @@ bool BEFFileReader::ReadKernelsSection(HostAllocator* host_allocator) {
   size_t num_kernels;
   if (!reader.ReadVbrInt(&num_kernels)) return format_error();
 
-#if defined(TFRT_BEF_DEBUG)
-  bef_file_->kernel_names_.reserve(num_kernels);
-#endif
-
-  bef_file_->kernels_.reserve(num_kernels);
+  std::vector<const char*> kernel_names;
+  kernel_names.reserve(num_kernels);
   while (num_kernels--) {
     // Each kernel is encoded as an offset into the string table of the
     // kernel name.
@@ -243,24 +320,30 @@ bool BEFFileReader::ReadKernelsSection(HostAllocator* host_allocator) {
         kernel_name_offset >= bef_file_->string_section_.size())
       return format_error();
 
-    // If this is an unknown kernel, bail out.
-    const char* kernel_name = reinterpret_cast<const char*>(
-        &bef_file_->string_section_[kernel_name_offset]);
-
-#if defined(TFRT_BEF_DEBUG)
-    bef_file_->kernel_names_.push_back(kernel_name);
-#endif
+    kernel_names.push_back(reinterpret_cast<const char*>(
+        &bef_file_->string_section_[kernel_name_offset]));
+  }
 
-    auto kernel = registry_.GetKernel(kernel_name);
-    if (kernel.is<Monostate>()) {
-      return DiagnoseUnknownKernel(bef_file_->kernels_.size(), kernel_name,
-                                   host_allocator);
+  auto& kernels = bef_file_->kernels_;
+  kernels.resize(kernel_names.size());
+  ParallelForEachBlock(host_, kernel_names.size(), kMinKernelsPerBlock,
+                       [&](size_t begin, size_t end) {
+                         for (size_t i = begin; i < end; ++i)
+                           kernels[i] = registry_.GetKernel(kernel_names[i]);
+                       });
+
+  // If there is an unknown kernel, bail out.
+  for (size_t i = 0; i < kernels.size(); ++i) {
+    if (kernels[i].is<Monostate>()) {
+      kernels.resize(i);
+      return DiagnoseUnknownKernel(i, kernel_names[i]);
     }
-
-    // Otherwise remember it.
-    bef_file_->kernels_.push_back(kernel);
   }
 
+#if defined(TFRT_BEF_DEBUG)
+  bef_file_->kernel_names_ = std::move(kernel_names);
+#endif
+
   return true;
 }
 
@@ -381,13 +464,15 @@ bool BEFFileReader::ReadFunctionIndexSection() {
 
     // TODO(tfrt-devs): Consider adding a factory for functions.
     switch (function_index.kind) {
-      case FunctionKind::kBEFFunction: {
+      case FunctionKind::kBEFFunction:
+      case FunctionKind::kFusedBEFFunction: {
         if (function_index.function_offset >=
             bef_file_->function_section_.size())
           return format_error("Invalid offset found for BEFFunction");
         auto bef_function = std::make_unique<BEFFunction>(
-            name, function_index.arguments, function_index.results,
-            function_index.function_offset, bef_file_);
+            name, function_index.kind, function_index.arguments,
+            function_index.results, function_index.function_offset, bef_file_);
+        bef_functions_.push_back(bef_function.get());
         bef_file_->functions_.push_back(std::move(bef_function));
         break;
       }
@@ -395,21 +480,24 @@ bool BEFFileReader::ReadFunctionIndexSection() {
         if (function_index.function_offset >=
             bef_file_->function_section_.size())
           return format_error("Invalid offset found for SyncBEFFunction");
-        auto bef_function = SyncBEFFunction::Create(
+        auto sync_function = SyncBEFFunction::Create(
             name, function_index.arguments, function_index.results,
             function_index.function_offset, bef_file_);
-        if (!bef_function) return format_error(bef_function.takeError());
-        bef_file_->functions_.push_back(std::move(bef_function.get()));
+        sync_functions_.push_back(sync_function.get());
+        bef_file_->functions_.push_back(std::move(sync_function));
         break;
       }
       case FunctionKind::kNativeFunction: {
-        auto callable = NativeFunctionRegistry::GetGlobalRegistry().Get(name);
-        if (callable == nullptr) {
+        auto& registry = NativeFunctionRegistry::GetGlobalRegistry();
+        auto callable = registry.Get(name);
+        auto sync_callable = registry.GetSync(name);
+        if (callable == nullptr && sync_callable == nullptr) {
           return format_error(
               "unable to find native function in global registry");
         }
         bef_file_->functions_.push_back(std::make_unique<NativeFunction>(
-            name, function_index.arguments, function_index.results, callable));
+            name, function_index.arguments, function_index.results, callable,
+            sync_callable));
         break;
       }
     }
@@ -418,16 +506,38 @@ bool BEFFileReader::ReadFunctionIndexSection() {
   return true;
 }
 
-// BEFFile / BEFFileImpl Implementation
-BEFFile::BEFFile(std::unique_ptr<LocationHandler> location_handler)
-    : location_handler_(std::move(location_handler)) {}
+bool BEFFileReader::DecodeFunctionLayouts() {
+  // The layouts are cached by the functions, and decoding errors are emitted
+  // by DecodeFunctionLayout() and SyncBEFFunction::EnsureInitialized().
+  std::atomic<bool> success{true};
+  ParallelForEachBlock(host_, bef_functions_.size(), kMinFunctionsPerBlock,
+                       [&](size_t begin, size_t end) {
+                         for (size_t i = begin; i < end; ++i) {
+                           if (bef_functions_[i]->GetLayout() == nullptr)
+                             success.store(false, std::memory_order_relaxed);
+                         }
+                       });
+  ParallelForEachBlock(host_, sync_functions_.size(), kMinFunctionsPerBlock,
+                       [&](size_t begin, size_t end) {
+                         for (size_t i = begin; i < end; ++i) {
+                           if (auto error =
+                                   sync_functions_[i]->EnsureInitialized()) {
+                             llvm::consumeError(std::move(error));
+                             success.store(false, std::memory_order_relaxed);
+                           }
+                         }
+                       });
+  return success.load(std::memory_order_relaxed);
+}
 
-BEFFile::~BEFFile() {}
+namespace {
 
-RCReference<BEFFile> BEFFile::Open(ArrayRef<uint8_t> file,
-                                   const KernelRegistry& registry,
-                                   ErrorHandler error_handler,
-                                   tfrt::HostAllocator* host_allocator) {
+// Implements BEFFile::Open() if `host` is null, and BEFFile::OpenParallel()
+// otherwise.
+RCReference<BEFFile> OpenBEFFile(ArrayRef<uint8_t> file,
+                                 const KernelRegistry& registry,
+                                 BEFFile::ErrorHandler error_handler,
+                                 HostContext* host) {
   auto* bef_impl = new BEFFileImpl(error_handler);
   auto bef_rc = TakeRef(bef_impl);
 
@@ -439,7 +549,7 @@ RCReference<BEFFile> BEFFile::Open(ArrayRef<uint8_t> file,
     return {};
   }
 
-  BEFFileReader reader(file, registry, bef_impl);
+  BEFFileReader reader(file, registry, bef_impl, host);
 
   uint8_t header[2];
 
@@ -462,14 +572,74 @@ RCReference<BEFFile> BEFFile::Open(ArrayRef<uint8_t> file,
 
   // Now that we've figured out the contents of the sections, resolve some
   // things.
-  if (!reader.ReadKernelsSection(host_allocator) ||
-      !reader.ReadTypesSection() || !reader.ReadFunctionIndexSection())
+  if (!reader.ReadKernelsSection() || !reader.ReadTypesSection() ||
+      !reader.ReadFunctionIndexSection())
     return {};
 
+  if (host != nullptr && !reader.DecodeFunctionLayouts()) return {};
+
   // Now that we decoded the whole thing, return the BEFFile to the caller.
   return bef_rc;
 }
 
+}  // namespace
+
+// BEFFile / BEFFileImpl Implementation
+BEFFile::BEFFile(std::unique_ptr<LocationHandler> location_handler)
+    : location_handler_(std::move(location_handler)) {}
+
+BEFFile::~BEFFile() {}
+
+RCReference<BEFFile> BEFFile::Open(ArrayRef<uint8_t> file,
+                                   const KernelRegistry& registry,
+                                   ErrorHandler error_handler,
+                                   tfrt::HostAllocator* host_allocator) {
+  return OpenBEFFile(file, registry, std::move(error_handler),
+                     /*host=*/nullptr);
+}
+
+RCReference<BEFFile> BEFFile::OpenParallel(ArrayRef<uint8_t> file,
+                                           const KernelRegistry& registry,
+                                           ErrorHandler error_handler,
+                                           HostContext* host) {
+  assert(host != nullptr);
+  return OpenBEFFile(file, registry, std::move(error_handler), host);
+}
+
+RCReference<BEFFile> BEFFile::OpenMapped(string_view path,
+                                         const KernelRegistry& registry,
+                                         ErrorHandler error_handler,
+                                         HostAllocator* host_allocator) {
+  auto emit_error = [&](string_view message) {
+    error_handler(DecodedDiagnostic(absl::InternalError(message)));
+  };
+
+  io::FileSystem* file_system =
+      io::FileSystemRegistry::Default()->LookupForPath(path);
+  if (file_system == nullptr) {
+    emit_error(StrCat("no file system registered for BEF file ", path));
+    return {};
+  }
+
+  std::unique_ptr<io::ReadOnlyMemoryRegion> region;
+  if (auto error = file_system->NewReadOnlyMemoryRegion(std::string(path),
+                                                        &region)) {
+    emit_error(toString(std::move(error)));
+    return {};
+  }
+
+  ArrayRef<uint8_t> file(static_cast<const uint8_t*>(region->data()),
+                         region->length());
+  auto bef_file =
+      Open(file, registry, std::move(error_handler), host_allocator);
+  if (!bef_file) return {};
+
+  // Sections decoded by Open() point into the mapping, so it must stay alive
+  // for as long as the BEF file does.
+  static_cast<BEFFileImpl*>(bef_file.get())->mapped_file_ = std::move(region);
+  return bef_file;
+}
+
 DecodedLocation BEFLocationHandler::DecodeLocation(Location loc) const {
   return bef_file_->DecodeLocation(loc.data);
 }
@@ -485,17 +655,47 @@ BEFFileImpl::BEFFileImpl(std::function<void(DecodedDiagnostic)> error_handler)
 BEFFileImpl::~BEFFileImpl() {}
 
 void BEFFileImpl::EmitFormatError(string_view message) {
+  mutex_lock lock(error_mu_);
   error_handler_(DecodedDiagnostic(absl::InternalError(message)));
 }
 
+namespace {
+
+// Lay out the ready counts of the kernels in `layout` grouped by stream, with
+// each stream starting on a new cache line if there is more than one stream.
+void AssignReadyCountIndices(BEFFunctionLayout* layout) {
+  auto& kernel_entries = layout->kernel_entries;
+
+  llvm::SmallVector<uint32_t, 16> kernel_ids(kernel_entries.size());
+  std::iota(kernel_ids.begin(), kernel_ids.end(), 0);
+  std::stable_sort(kernel_ids.begin(), kernel_ids.end(),
+                   [&](uint32_t x, uint32_t y) {
+                     return kernel_entries[x].stream_id <
+                            kernel_entries[y].stream_id;
+                   });
+
+  bool single_stream =
+      kernel_ids.empty() || kernel_entries[kernel_ids.front()].stream_id ==
+                                kernel_entries[kernel_ids.back()].stream_id;
+
+  size_t index = 0;
+  for (size_t i = 0, e = kernel_ids.size(); i != e; ++i) {
+    auto& entry = kernel_entries[kernel_ids[i]];
+    if (!single_stream && i > 0 &&
+        entry.stream_id != kernel_entries[kernel_ids[i - 1]].stream_id)
+      index = llvm::alignTo(index, kReadyCountsPerLine);
+    entry.ready_count_index = static_cast<uint32_t>(index++);
+  }
+  layout->num_ready_counts = index;
+}
+
+}  // namespace
+
 // TODO(b/160504938): Refactor this function to return Error instead of
 // reporting error via EmitFormatError to make the API more natural.
-bool BEFFileImpl::ReadFunction(size_t function_offset,
-                               ArrayRef<TypeName> results,
-                               size_t* location_offset,
-                               FunctionInfo* function_info,
-                               llvm::SmallVectorImpl<size_t>* result_regs,
-                               HostAllocator* host_allocator) {
+bool BEFFileImpl::DecodeFunctionLayout(size_t function_offset,
+                                       size_t num_results,
+                                       BEFFunctionLayout* layout) {
   auto format_error = [&]() -> bool {
     EmitFormatError("invalid Function section in BEF file");
     return false;
@@ -507,73 +707,337 @@ bool BEFFileImpl::ReadFunction(size_t function_offset,
 
   // First we have the location info and register info table.
   size_t num_registers;
-  if (!reader.ReadVbrInt(location_offset) || !reader.ReadVbrInt(&num_registers))
+  if (!reader.ReadVbrInt(&layout->location_offset) ||
+      !reader.ReadVbrInt(&num_registers))
     return format_error();
 
-  function_info->register_infos.resize(num_registers, host_allocator);
-  auto* register_info_ptr =
-      function_info->register_infos.mutable_array().data();
-  unsigned register_idx = 0;
-  while (num_registers--) {
+  layout->register_user_counts.reserve(num_registers);
+  for (size_t i = 0; i < num_registers; ++i) {
     size_t user_count;
     if (!reader.ReadVbrInt(&user_count)) return format_error();
-    new (register_info_ptr + register_idx) RegisterInfo(user_count);
-    ++register_idx;
+    layout->register_user_counts.push_back(user_count);
   }
 
   // Next we have the kernel index table.
   size_t num_kernels;
   if (!reader.ReadVbrInt(&num_kernels)) return format_error();
 
-  function_info->kernel_infos.resize(num_kernels, host_allocator);
-  auto* kernel_info_ptr = function_info->kernel_infos.mutable_array().data();
-  unsigned kernel_idx = 0;
+  layout->kernel_entries.reserve(num_kernels);
   while (num_kernels--) {
     size_t offset, num_operands, stream_id;
     if (!reader.ReadVbrInt(&offset) || !reader.ReadVbrInt(&num_operands) ||
         !reader.ReadVbrInt(&stream_id))
       return format_error();
-    new (kernel_info_ptr + kernel_idx)
-        KernelInfo(offset, stream_id, num_operands);
-    ++kernel_idx;
+    layout->kernel_entries.push_back(
+        {static_cast<uint32_t>(offset), static_cast<uint32_t>(stream_id),
+         static_cast<uint32_t>(num_operands), /*ready_count_index=*/0});
   }
+  AssignReadyCountIndices(layout);
+  layout->call_site_slots =
+      std::make_unique<KernelCallSiteSlot[]>(layout->kernel_entries.size());
+  layout->kernel_costs_ns =
+      std::make_unique<std::atomic<float>[]>(layout->kernel_entries.size());
 
   // Read the result registers.
-  result_regs->reserve(results.size());
-  for (unsigned i = 0, e = results.size(); i != e; ++i) {
+  layout->result_regs.reserve(num_results);
+  for (size_t i = 0; i < num_results; ++i) {
     size_t result_reg;
     if (!reader.ReadVbrInt(&result_reg) || result_reg >= num_registers)
       return format_error();
-    result_regs->push_back(result_reg);
+    layout->result_regs.push_back(result_reg);
   }
 
   // Kernels are aligned to kKernelEntryAlignment.
   if (!reader.ReadAlignment(kKernelEntryAlignment)) return format_error();
 
   // We found the start of our kernel section.
-  function_info->kernels =
+  layout->kernels =
       llvm::ArrayRef(reinterpret_cast<const uint32_t*>(reader.file().begin()),
                      reader.file().size() / kKernelEntryAlignment);
 
+  return DecodeKernelTimeouts(function_offset, layout);
+}
+
+bool BEFFileImpl::DecodeKernelTimeouts(size_t function_offset,
+                                       BEFFunctionLayout* layout) {
+  if (kernel_timeouts_section_.empty()) return true;
+
+  auto format_error = [&]() -> bool {
+    EmitFormatError("invalid KernelTimeouts section in BEF file");
+    return false;
+  };
+
+  // The section lists the functions that have kernels with timeouts, so it is
+  // short and scanned for the function.
+  BEFReader reader(kernel_timeouts_section_);
+  size_t num_functions;
+  if (!reader.ReadVbrInt(&num_functions)) return format_error();
+  for (size_t i = 0; i < num_functions; ++i) {
+    size_t offset, num_timeouts;
+    if (!reader.ReadVbrInt(&offset) || !reader.ReadVbrInt(&num_timeouts))
+      return format_error();
+    const bool is_function = offset == function_offset;
+    if (is_function)
+      layout->kernel_timeouts_ms.resize(layout->kernel_entries.size());
+
+    for (size_t j = 0; j < num_timeouts; ++j) {
+      size_t kernel_id, timeout_ms;
+      if (!reader.ReadVbrInt(&kernel_id) || !reader.ReadVbrInt(&timeout_ms))
+        return format_error();
+      if (!is_function) continue;
+      if (kernel_id >= layout->kernel_entries.size() || timeout_ms == 0 ||
+          timeout_ms > UINT32_MAX)
+        return format_error();
+      layout->kernel_timeouts_ms[kernel_id] = static_cast<uint32_t>(timeout_ms);
+    }
+    if (is_function) break;
+  }
   return true;
 }
 
+// The info arrays that do not fit inline each start on a cache line, as the
+// ready counts must.
+static size_t GetRegisterStorageSize(size_t num_registers) {
+  if (num_registers <= BEFFileImpl::RegisterInfoArray::kInlineSize) return 0;
+  return llvm::alignTo(num_registers * sizeof(BEFFileImpl::RegisterInfo),
+                       kCacheLineSize);
+}
+
+static size_t GetReadyCountStorageSize(size_t num_lines) {
+  if (num_lines <= BEFFileImpl::ReadyCountArray::kInlineSize) return 0;
+  return num_lines * sizeof(BEFFileImpl::ReadyCountLine);
+}
+
+size_t BEFFileImpl::GetInfoStorageSize(const BEFFunctionLayout& layout) {
+  size_t num_lines =
+      llvm::divideCeil(layout.num_ready_counts, kReadyCountsPerLine);
+  return GetRegisterStorageSize(layout.register_user_counts.size()) +
+         GetReadyCountStorageSize(num_lines);
+}
+
+bool BEFFileImpl::ReadFunction(const BEFFunction& fn, size_t* location_offset,
+                               FunctionInfo* function_info,
+                               llvm::SmallVectorImpl<size_t>* result_regs,
+                               HostAllocator* host_allocator,
+                               void* info_storage) {
+  const BEFFunctionLayout* layout = fn.GetLayout();
+  if (layout == nullptr) return false;
+
+  *location_offset = layout->location_offset;
+
+  function_info->layout = layout;
+
+  auto* storage = static_cast<char*>(info_storage);
+  size_t num_registers = layout->register_user_counts.size();
+  if (size_t size = GetRegisterStorageSize(num_registers);
+      storage != nullptr && size > 0) {
+    function_info->register_infos.resize(MutableArrayRef<RegisterInfo>(
+        reinterpret_cast<RegisterInfo*>(storage), num_registers));
+    storage += size;
+  } else {
+    function_info->register_infos.resize(num_registers, host_allocator);
+  }
+  for (auto& register_info : function_info->register_infos.mutable_array())
+    new (&register_info) RegisterInfo();
+
+  size_t num_lines = llvm::divideCeil(layout->num_ready_counts,
+                                      kReadyCountsPerLine);
+  if (storage != nullptr && GetReadyCountStorageSize(num_lines) > 0) {
+    function_info->ready_counts.resize(MutableArrayRef<ReadyCountLine>(
+        reinterpret_cast<ReadyCountLine*>(storage), num_lines));
+  } else {
+    function_info->ready_counts.resize(num_lines, host_allocator);
+  }
+  for (auto& line : function_info->ready_counts.mutable_array())
+    new (&line) ReadyCountLine();
+
+  // We initialize the ready counts to at least 1 so that kernels with no
+  // operands can be triggered by the pseudo kernel.
+  for (size_t i = 0, e = layout->kernel_entries.size(); i != e; ++i) {
+    function_info->arguments_not_ready(i).store(
+        std::max(1u, layout->kernel_entries[i].num_operands),
+        std::memory_order_relaxed);
+  }
+
+  result_regs->append(layout->result_regs.begin(), layout->result_regs.end());
+
+  function_info->kernels = layout->kernels;
+
+  return true;
+}
+
+ExecutorBlockPool::~ExecutorBlockPool() {
+  // Executors keep the BEF file alive, so they are all gone by now.
+  size_t num_free_blocks = 0;
+  for (auto& slot : free_blocks_) {
+    if (void* block = slot.load(std::memory_order_relaxed)) {
+      ::operator delete(block, std::align_val_t(alignment_.load()));
+      ++num_free_blocks;
+    }
+  }
+  assert(num_free_blocks == num_blocks_.load() &&
+         "executor block still in use");
+  (void)num_free_blocks;
+}
+
+void* ExecutorBlockPool::Allocate(size_t size, size_t alignment) {
+  for (auto& slot : free_blocks_) {
+    if (slot.load(std::memory_order_relaxed) == nullptr) continue;
+    // Acquires the writes of the previous user of the block.
+    if (void* block = slot.exchange(nullptr, std::memory_order_acquire)) {
+      assert(size == size_.load(std::memory_order_relaxed) &&
+             alignment == alignment_.load(std::memory_order_relaxed));
+      return block;
+    }
+  }
+
+  if (num_blocks_.fetch_add(1, std::memory_order_relaxed) >= kMaxBlocks) {
+    num_blocks_.fetch_sub(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+  size_t previous_size = size_.exchange(size, std::memory_order_relaxed);
+  size_t previous_alignment =
+      alignment_.exchange(alignment, std::memory_order_relaxed);
+  assert((previous_size == 0 || previous_size == size) &&
+         (previous_alignment == 0 || previous_alignment == alignment));
+  (void)previous_size;
+  (void)previous_alignment;
+  return ::operator new(size, std::align_val_t(alignment));
+}
+
+void ExecutorBlockPool::Deallocate(void* block) {
+  // There are no more blocks than slots, so one is free, but other threads may
+  // fill it first and free another one behind this pass.
+  for (;;) {
+    for (auto& slot : free_blocks_) {
+      void* expected = nullptr;
+      if (slot.compare_exchange_strong(expected, block,
+                                       std::memory_order_release,
+                                       std::memory_order_relaxed))
+        return;
+    }
+  }
+}
+
+const BEFFunctionLayout* BEFFunction::GetLayout() const {
+  std::call_once(layout_once_, [this]() {
+    auto layout = std::make_unique<BEFFunctionLayout>();
+    if (bef_file_->DecodeFunctionLayout(function_offset_,
+                                        result_types().size(), layout.get()))
+      layout_ = std::move(layout);
+  });
+  return layout_.get();
+}
+
+void BEFFileImpl::DecompressLocationSections() {
+  std::call_once(location_sections_once_, [this]() {
+    for (const auto& compressed : compressed_location_sections_) {
+      const bool is_strings =
+          compressed.section_id == BEFSectionID::kLocationStrings;
+      auto& data = is_strings ? decompressed_location_strings_
+                              : decompressed_locations_;
+      if (auto error = DecompressBEFSection(compressed, &data)) {
+        EmitFormatError(StrCat("failed to decompress BEF location section: ",
+                               toString(std::move(error))));
+        data.clear();
+      }
+      (is_strings ? location_strings_section_ : locations_section_) = data;
+    }
+  });
+}
+
+ArrayRef<uint8_t> BEFFileImpl::GetRegisterTypeTable(const Function* function) {
+  std::call_once(register_type_tables_once_, [this]() {
+    if (register_types_section_.empty()) return;
+
+    // The section has the number of tables, followed by the table of every
+    // non-native function in function index order. A table has the number of
+    // registers, followed by the type index of every register.
+    BEFReader reader(register_types_section_);
+    size_t num_tables;
+    bool ok = reader.ReadVbrInt(&num_tables);
+    for (const auto& func : functions_) {
+      if (!ok) break;
+      if (func->function_kind() == FunctionKind::kNativeFunction) continue;
+      ArrayRef<uint8_t> table = reader.file();
+      size_t num_registers, type_index;
+      ok = reader.ReadVbrInt(&num_registers);
+      for (size_t i = 0; ok && i < num_registers; ++i)
+        ok = reader.ReadVbrInt(&type_index);
+      register_type_tables_[func.get()] =
+          table.take_front(table.size() - reader.file().size());
+    }
+    if (!ok) {
+      EmitFormatError("invalid RegisterTypes section in BEF file");
+      register_type_tables_.clear();
+    }
+  });
+
+  auto it = register_type_tables_.find(function);
+  if (it == register_type_tables_.end()) return {};
+  return it->second;
+}
+
+BEFFileImpl::CachedLocation* BEFFileImpl::GetCachedLocation(
+    size_t location_position_offset) {
+  DecompressLocationSections();
+  std::call_once(location_index_once_, [this]() {
+    // The section is the concatenation of the locations of the operations,
+    // with nested locations encoded inline.
+    const uint8_t* begin = locations_section_.data();
+    const uint8_t* end = begin + locations_section_.size();
+    for (const uint8_t* ptr = begin; ptr < end;) {
+      if (*ptr > static_cast<uint8_t>(BefLocationType::kFused)) {
+        EmitFormatError("unknown location in BEF location section");
+        break;
+      }
+      const uint8_t* next = BefLocation::NextLocation(ptr);
+      if (next > end) break;
+      location_index_.try_emplace(ptr - begin, location_index_.size());
+      ptr = next;
+    }
+    cached_locations_ =
+        std::make_unique<CachedLocation[]>(location_index_.size());
+  });
+
+  auto it = location_index_.find(location_position_offset);
+  if (it == location_index_.end()) return nullptr;
+  return &cached_locations_[it->second];
+}
+
 // Given an offset into locations_section_, decode it and return
 // a DecodedDiagnostic.
 DecodedLocation BEFFileImpl::DecodeLocation(size_t location_position_offset) {
-  if (location_position_offset >= locations_section_.size()) return {};
+  CachedLocation* cached = GetCachedLocation(location_position_offset);
+  if (!cached) {
+    if (location_position_offset >= locations_section_.size()) return {};
+    BefLocation loc(locations_section_.data() + location_position_offset);
+    return DecodeBefLocation(location_strings_section_, loc);
+  }
 
-  BefLocation loc(locations_section_.data() + location_position_offset);
-  return DecodeBefLocation(location_strings_section_, loc);
+  std::call_once(cached->decoded_once, [&]() {
+    BefLocation loc(locations_section_.data() + location_position_offset);
+    cached->decoded = DecodeBefLocation(location_strings_section_, loc);
+  });
+  return cached->decoded;
 }
 
 std::optional<DebugInfo> BEFFileImpl::GetDebugInfo(
     size_t location_position_offset) {
-  if (location_position_offset >= locations_section_.size())
-    return std::nullopt;
+  CachedLocation* cached = GetCachedLocation(location_position_offset);
+  if (!cached) {
+    if (location_position_offset >= locations_section_.size())
+      return std::nullopt;
+    BefLocation loc(locations_section_.data() + location_position_offset);
+    return GetDebugInfoFromBefLocation(location_strings_section_, loc);
+  }
 
-  BefLocation loc(locations_section_.data() + location_position_offset);
-  return GetDebugInfoFromBefLocation(location_strings_section_, loc);
+  std::call_once(cached->debug_info_once, [&]() {
+    BefLocation loc(locations_section_.data() + location_position_offset);
+    cached->debug_info =
+        GetDebugInfoFromBefLocation(location_strings_section_, loc);
+  });
+  return cached->debug_info;
 }
 
 const char* BEFFileImpl::GetKernelName(size_t kernel_id) const {
@@ -604,19 +1068,110 @@ const Function* BEFFile::GetFunction(string_view function_name) const {
   return impl->functions_[it->second].get();
 }
 
-Expected<std::unique_ptr<SyncBEFFunction>> SyncBEFFunction::Create(
+namespace {
+
+// Read one byte of every page of `section`, so that the pages of a
+// memory-mapped file are faulted in.
+void TouchPages(ArrayRef<uint8_t> section) {
+  constexpr size_t kPageSize = 4096;
+  uint8_t sum = 0;
+  for (size_t i = 0; i < section.size(); i += kPageSize) sum += section[i];
+  // The volatile store keeps the reads above.
+  volatile uint8_t sink = sum;
+  (void)sink;
+}
+
+}  // namespace
+
+Error BEFFile::WarmUp(const ExecutionContext& exec_ctx,
+                      const BEFWarmUpInputs& inputs, int num_runs) const {
+  auto* impl = static_cast<BEFFileImpl*>(const_cast<BEFFile*>(this));
+
+  for (ArrayRef<uint8_t> section :
+       {impl->string_section_, impl->attribute_section_,
+        impl->kernels_section_, impl->types_section_, impl->function_section_,
+        impl->function_index_section_, impl->location_strings_section_,
+        impl->locations_section_})
+    TouchPages(section);
+  impl->DecompressLocationSections();
+
+  // Decode the functions first, so that executions do not wait for the
+  // decoding of the functions they call.
+  for (auto& fn : impl->functions_) {
+    switch (fn->function_kind()) {
+      case FunctionKind::kSyncBEFFunction:
+        if (auto error =
+                static_cast<const SyncBEFFunction&>(*fn).EnsureInitialized())
+          return error;
+        break;
+      case FunctionKind::kNativeFunction:
+        break;
+      default:
+        if (static_cast<const BEFFunction&>(*fn).GetLayout() == nullptr)
+          return MakeStringError("invalid BEF function ", fn->name());
+        break;
+    }
+  }
+
+  for (auto& fn : impl->functions_) {
+    ArrayRef<BEFWarmUpInputs::ArgumentsFactory> fn_inputs =
+        inputs.Get(fn->name());
+    if (fn_inputs.empty() || fn->name().empty()) continue;
+    if (fn->function_kind() == FunctionKind::kSyncBEFFunction) {
+      return MakeStringError("cannot warm up sync function ", fn->name(),
+                             " with inputs");
+    }
+
+    llvm::SmallVector<RCReference<AsyncValue>, 4> results;
+    for (int run = 0; run < num_runs; ++run) {
+      for (const auto& make_arguments : fn_inputs) {
+        std::vector<RCReference<AsyncValue>> arguments = make_arguments();
+        if (arguments.size() != fn->num_arguments()) {
+          return MakeStringError("warm-up input of function ", fn->name(),
+                                 " has ", arguments.size(),
+                                 " arguments, expected ",
+                                 fn->num_arguments());
+        }
+
+        results.clear();
+        results.resize(fn->num_results());
+        fn->ExecuteByValue(exec_ctx, std::move(arguments), results);
+        exec_ctx.host()->Await(results);
+        for (const auto& result : results) {
+          if (auto* error = result->GetErrorIfPresent()) {
+            return MakeStringError("warm-up of function ", fn->name(),
+                                   " failed: ", error->message());
+          }
+        }
+      }
+    }
+  }
+
+  return Error::success();
+}
+
+std::unique_ptr<SyncBEFFunction> SyncBEFFunction::Create(
     string_view name, ArrayRef<TypeName> arguments, ArrayRef<TypeName> results,
     size_t function_offset, BEFFileImpl* bef_file) {
   // std::make_unique cannot be used, as the constructor of SyncBEFFunction is
   // private.
   // NOLINTNEXTLINE
-  auto bef_function = std::unique_ptr<SyncBEFFunction>(
+  return std::unique_ptr<SyncBEFFunction>(
       new SyncBEFFunction(name, arguments, results, function_offset, bef_file));
+}
 
-  if (auto error = bef_function->Init())
-    return std::move(error);
-  else
-    return std::move(bef_function);
+Error SyncBEFFunction::EnsureInitialized() const {
+  // Init() only mutates the cached tables, which are logically part of the
+  // function and written exactly once under `init_once_`. The format error is
+  // emitted once, like the errors of BEFFunction::GetLayout().
+  std::call_once(init_once_, [this]() {
+    if (auto error = const_cast<SyncBEFFunction*>(this)->Init()) {
+      init_error_ = toString(std::move(error));
+      bef_file_->EmitFormatError(init_error_);
+    }
+  });
+  if (!init_error_.empty()) return MakeStringError(init_error_);
+  return Error::success();
 }
 
 Error SyncBEFFunction::Init() {
@@ -708,6 +1263,124 @@ Error SyncBEFFunction::Init() {
       llvm::ArrayRef(reinterpret_cast<const uint32_t*>(reader.file().begin()),
                      reader.file().size() / kKernelEntryAlignment);
 
+  if (auto error = ReadRegisterTypes()) return error;
+  return DecodeKernels();
+}
+
+Error SyncBEFFunction::ReadRegisterTypes() {
+  auto format_error = [&](const char* msg) -> Error {
+    return MakeStringError("Invalid SyncBEFFunction(", msg, ")");
+  };
+
+  ArrayRef<uint8_t> table = bef_file_->GetRegisterTypeTable(this);
+  if (table.empty()) return Error::success();
+
+  // The types are checked once here, so that the interpreter and the kernels
+  // can access the register values without checking their types.
+  BEFReader reader(table);
+  size_t num_registers;
+  if (!reader.ReadVbrInt(&num_registers) ||
+      num_registers != register_infos_.size())
+    return format_error("Register types do not match the registers");
+
+  for (auto& reg_info : register_infos_) {
+    size_t type_index;
+    if (!reader.ReadVbrInt(&type_index) ||
+        type_index >= bef_file_->type_names_.size())
+      return format_error("Failed to read register type");
+    reg_info.type = bef_file_->type_names_[type_index];
+  }
+
+  for (size_t i = 0, e = num_arguments(); i != e; ++i) {
+    if (register_infos_[i].type != argument_types()[i])
+      return format_error("Argument register type mismatch");
+  }
+  for (size_t i = 0, e = result_regs_.size(); i != e; ++i) {
+    if (register_infos_[result_regs_[i]].type != result_types()[i])
+      return format_error("Result register type mismatch");
+  }
+
+  return Error::success();
+}
+
+Error SyncBEFFunction::DecodeKernels() {
+  auto format_error = [&](const char* msg) -> Error {
+    return MakeStringError("Invalid SyncBEFFunction(", msg, ")");
+  };
+
+  llvm::SmallVector<uint32_t, 16> user_counts;
+  user_counts.reserve(register_infos_.size());
+  for (auto& reg_info : register_infos_)
+    user_counts.push_back(reg_info.user_count);
+
+  // The pools grow while the kernels are decoded, so the ArrayRefs into them
+  // are only formed once all kernels have been decoded.
+  llvm::SmallVector<size_t, 8> retired_starts, last_use_starts,
+      attribute_starts;
+
+  decoded_kernels_.reserve(kernel_offsets_.size());
+  for (auto kernel_offset : kernel_offsets_) {
+    size_t kernel_start = kernel_offset / kKernelEntryAlignment;
+    if (kernel_start >= kernels_.size())
+      return format_error("Invalid kernel offset");
+
+    BEFKernel kernel(kernels_.data() + kernel_start);
+    auto& decoded = decoded_kernels_.emplace_back();
+    decoded.kernel_code = kernel.kernel_code();
+    decoded.kernel_fn = bef_file_->GetSyncKernel(kernel.kernel_code());
+    assert(decoded.kernel_fn != nullptr);
+    decoded.arguments = kernel.GetArguments();
+    decoded.results = kernel.GetResults();
+
+    // A local register is retired after its last user, or right after it is
+    // defined if it has no user. Kernels run in the order they are encoded, so
+    // the last user is known statically: it is the last use of the register in
+    // the last kernel reading it. Argument and result registers of the function
+    // are never retired.
+    retired_starts.push_back(retired_register_pool_.size());
+    last_use_starts.push_back(last_use_pool_.size());
+    for (auto reg_idx : decoded.arguments) {
+      if (reg_idx >= user_counts.size() || user_counts[reg_idx] == 0)
+        return format_error("Invalid kernel argument register");
+      bool last_use = --user_counts[reg_idx] == 0;
+      if (last_use) retired_register_pool_.push_back(reg_idx);
+      last_use_pool_.push_back(last_use);
+    }
+    for (auto reg_idx : decoded.results) {
+      if (reg_idx >= user_counts.size())
+        return format_error("Invalid kernel result register");
+      if (user_counts[reg_idx] == 0) retired_register_pool_.push_back(reg_idx);
+    }
+
+    attribute_starts.push_back(attribute_pool_.size());
+    for (auto attribute_offset : kernel.GetAttributes()) {
+      // We pass the pointer here because this attribute could be an array of
+      // size 0.
+      attribute_pool_.push_back(bef_file_->attribute_section_.data() +
+                                attribute_offset);
+    }
+    for (auto fn_idx : kernel.GetFunctions()) {
+      // Functions are passed as their corresponding `Function`.
+      attribute_pool_.push_back(bef_file_->functions_[fn_idx].get());
+    }
+  }
+  retired_starts.push_back(retired_register_pool_.size());
+  last_use_starts.push_back(last_use_pool_.size());
+  attribute_starts.push_back(attribute_pool_.size());
+
+  for (size_t i = 0, e = decoded_kernels_.size(); i != e; ++i) {
+    auto& decoded = decoded_kernels_[i];
+    decoded.retired_regs = llvm::ArrayRef(
+        retired_register_pool_.begin() + retired_starts[i],
+        retired_register_pool_.begin() + retired_starts[i + 1]);
+    decoded.argument_last_uses =
+        llvm::ArrayRef(last_use_pool_.begin() + last_use_starts[i],
+                       last_use_pool_.begin() + last_use_starts[i + 1]);
+    decoded.attributes =
+        llvm::ArrayRef(attribute_pool_.begin() + attribute_starts[i],
+                       attribute_pool_.begin() + attribute_starts[i + 1]);
+  }
+
   return Error::success();
 }
 
@@ -715,6 +1388,10 @@ Error ExecuteSyncBEFFunction(const Function& func,
                              const ExecutionContext& exec_ctx,
                              ArrayRef<Value*> arguments,
                              ArrayRef<Value*> results) {
+  if (func.function_kind() == FunctionKind::kNativeFunction) {
+    return static_cast<const NativeFunction&>(func).SyncExecute(
+        exec_ctx, arguments, results);
+  }
   assert(func.function_kind() == FunctionKind::kSyncBEFFunction &&
          "cannot run a non sync TFRT function via ExecuteSyncBEFFunction.");
   const SyncBEFFunction& sync_func = static_cast<const SyncBEFFunction&>(func);
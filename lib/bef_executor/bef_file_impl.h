@@ -19,21 +19,30 @@
 #ifndef TFRT_LIB_BEF_EXECUTOR_BEF_FILE_IMPL_H_
 #define TFRT_LIB_BEF_EXECUTOR_BEF_FILE_IMPL_H_
 
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <string>
 #include <type_traits>
 #include <vector>
 
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/Error.h"
+#include "tfrt/bef/bef_compression.h"
 #include "tfrt/bef_executor/bef_file.h"
 #include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/kernel_frame.h"
 #include "tfrt/host_context/kernel_registry.h"
 #include "tfrt/host_context/location.h"
 #include "tfrt/host_context/native_function.h"
+#include "tfrt/io/file_system.h"
 #include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
 
 namespace tfrt {
 
@@ -43,10 +52,12 @@ class Value;
 // Inlined array to keep registers and kernels info together with a BEF executor
 // if their size is small. Default constructed as empty, and must be resized
 // before use. If the number of records is larger than `n` it allocates
-// HostArray for storage.
+// HostArray for storage, unless the caller provides the storage.
 template <typename InfoT, size_t n>
 class BEFInfoArray {
  public:
+  static constexpr size_t kInlineSize = n;
+
   BEFInfoArray() : inlined_size_(0) {}
 
   ~BEFInfoArray() {
@@ -64,7 +75,19 @@ class BEFInfoArray {
     }
   }
 
+  // Use `storage`, which must out-live this array, for the records. The
+  // records are not destroyed, so InfoT must be trivially destructible.
+  void resize(MutableArrayRef<InfoT> storage) {
+    static_assert(std::is_trivially_destructible<InfoT>::value,
+                  "external records are not destroyed");
+    assert(inlined_size_ == 0 && host_array_.size() == 0 && external_.empty());
+    external_ = storage;
+  }
+
   MutableArrayRef<InfoT> mutable_array() {
+    if (!external_.empty()) {
+      return external_;
+    }
     if (host_array_.size() > 0) {
       return host_array_.mutable_array();
     }
@@ -72,6 +95,9 @@ class BEFInfoArray {
   }
 
   size_t size() const {
+    if (!external_.empty()) {
+      return external_.size();
+    }
     if (host_array_.size() > 0) {
       return host_array_.size();
     }
@@ -80,6 +106,9 @@ class BEFInfoArray {
 
   InfoT& operator[](size_t index) {
     assert(index < size());
+    if (!external_.empty()) {
+      return external_[index];
+    }
     if (host_array_.size() > 0) {
       return host_array_[index];
     }
@@ -98,6 +127,98 @@ class BEFInfoArray {
   typename std::aligned_storage<sizeof(InfoT), alignof(InfoT)>::type
       inlined_array_[n];
   HostArray<InfoT> host_array_;
+  MutableArrayRef<InfoT> external_;
+};
+
+// The number of bytes in a cache line, for the layout of the executor states
+// that are written by several threads.
+constexpr size_t kCacheLineSize = 64;
+
+// The number of kernel ready counts in one cache line.
+constexpr size_t kReadyCountsPerLine =
+    kCacheLineSize / sizeof(std::atomic<int>);
+
+// The register and kernel tables of a BEFFunction, decoded from the Functions
+// section of its BEF file. The tables are decoded once per function, on its
+// first execution, and shared by all later executions of the function.
+//
+// The layout holds everything about the function that is the same for all of
+// its executions. It is only read at execution time, so the cache lines it
+// occupies can be shared by all cores, while the per-execution states in
+// BEFFileImpl::FunctionInfo are kept small.
+struct BEFFunctionLayout {
+  struct KernelEntry {
+    uint32_t offset;
+    uint32_t stream_id;
+    uint32_t num_operands;
+    // The index of the ready count of the kernel in the per-execution ready
+    // count array. The ready counts are grouped by stream, as the kernels of a
+    // stream usually become ready on the same thread. If the function has more
+    // than one stream, each stream starts on a new cache line so that threads
+    // running different streams do not write to the same cache line.
+    uint32_t ready_count_index;
+  };
+
+  // Offset of the function location in the LocationPositions section.
+  size_t location_offset = 0;
+  // This ArrayRef contains kernel entries of all kernels of this function.
+  ArrayRef<uint32_t> kernels;
+  // The user count of each register, indexed by the register number.
+  llvm::SmallVector<uint32_t, 24> register_user_counts;
+  // The kernel index table, indexed by the kernel number.
+  llvm::SmallVector<KernelEntry, 8> kernel_entries;
+  // The state that the kernels keep across executions, indexed by the kernel
+  // number, see KernelCallSiteState.
+  std::unique_ptr<KernelCallSiteSlot[]> call_site_slots;
+  // The register index of each function result.
+  llvm::SmallVector<size_t, 4> result_regs;
+  // The number of slots in the ready count array, including the padding
+  // between streams.
+  size_t num_ready_counts = 0;
+  // The moving average of the execution time of each kernel in nanoseconds,
+  // indexed by the kernel number, or zero if the kernel was not timed yet.
+  // Unlike the rest of the layout, the averages are written at execution time,
+  // but only by the sampled invocations of the executions with adaptive
+  // placement, see BEFExecutorOptions::adaptive_placement.
+  std::unique_ptr<std::atomic<float>[]> kernel_costs_ns;
+  // The timeout of each kernel in milliseconds, indexed by the kernel number,
+  // or zero for the kernels without a timeout. Empty if no kernel of the
+  // function has a timeout, see BEFSectionID::kKernelTimeouts.
+  llvm::SmallVector<uint32_t, 0> kernel_timeouts_ms;
+};
+
+// A bounded free list of memory blocks that recycles the executors of one
+// function across executions, e.g. the iterations of a loop body or the calls
+// of a function that serves many requests. A block holds the executor and the
+// executor states that do not fit in it, so a recycled executor only resets
+// them. The blocks are owned by the pool rather than by a request, so a
+// recycled executor does not depend on the allocator of the request that
+// created it. This class is thread-safe and lock-free.
+class ExecutorBlockPool {
+ public:
+  static constexpr size_t kMaxBlocks = 4;
+
+  ExecutorBlockPool() = default;
+  ~ExecutorBlockPool();
+
+  // Return a block of `size` bytes aligned to `alignment`, or nullptr if
+  // kMaxBlocks blocks are already in use. Each pool only serves one size.
+  void* Allocate(size_t size, size_t alignment);
+
+  // Return a block obtained from Allocate() to the pool.
+  void Deallocate(void* block);
+
+ private:
+  ExecutorBlockPool(const ExecutorBlockPool&) = delete;
+  ExecutorBlockPool& operator=(const ExecutorBlockPool&) = delete;
+
+  // The free blocks, with nullptr for an empty slot. Blocks are taken out by
+  // exchanging the slot with nullptr, so no block is handed out twice.
+  std::atomic<void*> free_blocks_[kMaxBlocks] = {};
+  std::atomic<size_t> num_blocks_{0};
+  // Only read to check the size and to free the blocks.
+  std::atomic<size_t> size_{0};
+  std::atomic<size_t> alignment_{0};
 };
 
 // This class implements Function for BEF files.
@@ -109,14 +230,32 @@ class BEFFunction : public Function {
       : BEFFunction(name, FunctionKind::kBEFFunction, arguments, results,
                     function_offset, bef_file) {}
 
+  // The layout cache and the executor pool are not moved, as they can only be
+  // populated once the function is in its final location.
   BEFFunction(BEFFunction&& other)
       : Function(std::move(other)),
         function_offset_(other.function_offset_),
         bef_file_(other.bef_file_) {}
 
+  // `function_kind` is kBEFFunction or kFusedBEFFunction, or kSyncBEFFunction
+  // for SyncBEFFunction.
+  BEFFunction(string_view name, FunctionKind function_kind,
+              ArrayRef<TypeName> arguments, ArrayRef<TypeName> results,
+              size_t function_offset, BEFFileImpl* bef_file)
+      : Function(name, function_kind, arguments, results),
+        function_offset_(function_offset),
+        bef_file_(bef_file) {}
+
   size_t function_offset() const { return function_offset_; }
   BEFFileImpl* bef_file() const { return bef_file_; }
 
+  // Return the decoded register and kernel tables of this function, decoding
+  // them on the first call. Return nullptr if the function is malformed; the
+  // format error is emitted to the BEF file error handler once.
+  const BEFFunctionLayout* GetLayout() const;
+
+  ExecutorBlockPool& executor_pool() const { return executor_pool_; }
+
   void Execute(const ExecutionContext& exec_ctx,
                ArrayRef<AsyncValue*> arguments,
                MutableArrayRef<RCReference<AsyncValue>> results) const override;
@@ -128,19 +267,25 @@ class BEFFunction : public Function {
       const ExecutionContext& exec_ctx,
       std::vector<RCReference<AsyncValue>> arguments,
       MutableArrayRef<RCReference<AsyncValue>> results) const override;
+  // Decodes the layout and puts an executor block into the pool.
+  void Prepare() const override;
   void AddRef() const override;
   void DropRef() const override;
 
  protected:
-  BEFFunction(string_view name, FunctionKind function_kind,
-              ArrayRef<TypeName> arguments, ArrayRef<TypeName> results,
-              size_t function_offset, BEFFileImpl* bef_file)
-      : Function(name, function_kind, arguments, results),
-        function_offset_(function_offset),
-        bef_file_(bef_file) {}
-
   size_t function_offset_;
   BEFFileImpl* bef_file_;
+
+ private:
+  // Run the kernels of a kFusedBEFFunction in program order.
+  void ExecuteFused(const ExecutionContext& exec_ctx,
+                    ArrayRef<AsyncValue*> arguments,
+                    MutableArrayRef<RCReference<AsyncValue>> results) const;
+
+  mutable std::once_flag layout_once_;
+  mutable std::unique_ptr<BEFFunctionLayout> layout_;
+
+  mutable ExecutorBlockPool executor_pool_;
 };
 
 // This class implements SyncFunction for BEF files.
@@ -149,13 +294,34 @@ class SyncBEFFunction final : public BEFFunction {
   struct RegisterInfo {
     uint32_t user_count : 31;
     bool is_arg_or_result : 1;
+    // The type of the register, if the BEF file has a RegisterTypes section.
+    TypeName type;
+  };
+
+  // A kernel of the function decoded from its BEF kernel entry, so that the
+  // interpreter can dispatch it without re-reading the entry.
+  struct DecodedKernel {
+    SyncKernelImplementation kernel_fn;
+    // Register indices of the arguments and results.
+    ArrayRef<uint32_t> arguments;
+    ArrayRef<uint32_t> results;
+    // For every argument, whether this kernel is the last user of the local
+    // register it is read from.
+    ArrayRef<bool> argument_last_uses;
+    // All attributes, including function attributes.
+    ArrayRef<const void*> attributes;
+    // Local registers that are retired after the execution of this kernel.
+    ArrayRef<uint32_t> retired_regs;
+    uint32_t kernel_code;
   };
 
-  // Create a SyncBEFFunction. Return nullptr if the BEF file has format error.
-  static Expected<std::unique_ptr<SyncBEFFunction>> Create(
-      string_view name, ArrayRef<TypeName> arguments,
-      ArrayRef<TypeName> results, size_t function_offset,
-      BEFFileImpl* bef_file);
+  // Create a SyncBEFFunction. The register and kernel information is decoded
+  // lazily by EnsureInitialized().
+  static std::unique_ptr<SyncBEFFunction> Create(string_view name,
+                                                 ArrayRef<TypeName> arguments,
+                                                 ArrayRef<TypeName> results,
+                                                 size_t function_offset,
+                                                 BEFFileImpl* bef_file);
 
   void Execute(
       const ExecutionContext& exec_ctx, ArrayRef<AsyncValue*> arguments,
@@ -172,6 +338,12 @@ class SyncBEFFunction final : public BEFFunction {
   Error SyncExecute(const ExecutionContext& exec_ctx,
                     ArrayRef<Value*> arguments, ArrayRef<Value*> results) const;
 
+  // Read the register and kernel information for the function on the first
+  // call. Return an error if the function is malformed, which is also emitted
+  // to the BEF file error handler once. The accessors below are only valid
+  // after this returned success.
+  Error EnsureInitialized() const;
+
   // Return an array of descriptors for all of our registers, indexed by
   // their register number.
   ArrayRef<RegisterInfo> register_infos() const { return register_infos_; }
@@ -186,6 +358,9 @@ class SyncBEFFunction final : public BEFFunction {
   // Return an array of register index for the result registers.
   ArrayRef<uint32_t> result_regs() const { return result_regs_; }
 
+  // Return the decoded kernels of this function in execution order.
+  ArrayRef<DecodedKernel> decoded_kernels() const { return decoded_kernels_; }
+
  private:
   SyncBEFFunction(string_view name, ArrayRef<TypeName> arguments,
                   ArrayRef<TypeName> results, size_t function_offset,
@@ -197,6 +372,16 @@ class SyncBEFFunction final : public BEFFunction {
   // this information in SyncBEFFunction to avoid repeatedly reading this
   // information for every function execution.
   Error Init();
+  // Read the types of the registers from the RegisterTypes section, if the
+  // BEF file has one, and verify them against the function signature.
+  Error ReadRegisterTypes();
+  // Decode the kernel entries into decoded_kernels_. Must be called at the
+  // end of Init().
+  Error DecodeKernels();
+
+  mutable std::once_flag init_once_;
+  // The error message of Init(), or empty if it succeeded.
+  mutable std::string init_error_;
 
   // This is an array of descriptors for all of our registers, indexed by
   // their register number.
@@ -212,6 +397,13 @@ class SyncBEFFunction final : public BEFFunction {
 
   // This is an array of register index for the result registers.
   llvm::SmallVector<uint32_t, 4> result_regs_;
+
+  // The kernels of this function decoded once for the interpreter. The
+  // ArrayRefs in the entries refer to the BEF file or to the pools below.
+  llvm::SmallVector<DecodedKernel, 8> decoded_kernels_;
+  llvm::SmallVector<uint32_t, 16> retired_register_pool_;
+  llvm::SmallVector<bool, 16> last_use_pool_;
+  llvm::SmallVector<const void*, 16> attribute_pool_;
 };
 
 class BEFFileImpl;
@@ -230,89 +422,166 @@ class BEFLocationHandler final : public LocationHandler {
 // This class is the implementation details behind the BEFFile::Open method,
 // which maintains all the state necessary for the BEFExecutor.  It is fully
 // public because it is a private implementation detail within this library.
-class BEFFileImpl : public BEFFile {
+class BEFFileImpl : public BEFFile, public AttributeSectionOwner {
  public:
   ~BEFFileImpl() override;
 
   explicit BEFFileImpl(ErrorHandler error_handler);
 
+  // The owner to pass to kernels along with the attribute section, so that
+  // they can refer to their attributes instead of copying them. Only files
+  // that own their memory keep the attribute section alive, as the memory that
+  // other files were opened from may be released before their last reference.
+  const AttributeSectionOwner* attribute_section_owner() const {
+    return mapped_file_ ? this : nullptr;
+  }
+  void AddAttributeSectionRef() const override { AddRef(); }
+  void DropAttributeSectionRef() const override {
+    const_cast<BEFFileImpl*>(this)->DropRef();
+  }
+
   // Emit an error message about a malformed BEF file.
   void EmitFormatError(string_view message);
 
-  // When decoding a function info descriptor, this describes each register.
+  // The per-execution state of a register. The number of uses of the register
+  // is the same for all executions and is read from the BEFFunctionLayout.
   struct RegisterInfo {
-    // This is the number of uses of the register in the program.  The value
-    // may be deallocated when this number of uses are complete.
-    unsigned user_count = 0;
-    // 'value' is not used by BEFFileImpl. BEFExecutor takes ownership of
-    // RegisterInfo, and uses 'value' to track the register's contents as it
-    // executes a function.
+    // 'value' is not used by BEFFileImpl. BEFExecutor uses 'value' to track the
+    // register's contents as it executes a function.
     AsyncValue* value = nullptr;
-
-    explicit RegisterInfo(unsigned user_count) : user_count(user_count) {}
   };
 
-  // When decoding the kernel table for a function, we get the offset of
-  // each kernel as well as the number of operands it has.
-  //
-  // The executor keeps an array of these, indexed by kernel number to know
-  // where to find each kernel in the kernels section, and to know how many
-  // arguments are still waiting to come in before the kernel can start.
-  //
-  // This struct is defined here, because ReadFunction() below will populate it.
-  struct KernelInfo {
-    unsigned offset;
-    unsigned stream_id;
-    std::atomic<int> arguments_not_ready;
-
-    // We initialize the ready list to at least 1 so that kernels with no
-    // operands can be triggered by the pseudo kernel.
-    //
-    // TODO(b/173800007): Add perf benchmark to illustrate the improvement from
-    // the reduced number of kernel enqueues.
-    KernelInfo(unsigned offset, unsigned stream_id, unsigned num_operands)
-        : offset(offset),
-          stream_id(stream_id),
-          arguments_not_ready(std::max(1u, num_operands)) {}
+  // One cache line of kernel ready counts. Each ready count is the number of
+  // arguments that are still waiting to come in before the kernel can start.
+  struct alignas(kCacheLineSize) ReadyCountLine {
+    std::atomic<int> arguments_not_ready[kReadyCountsPerLine];
   };
 
   using RegisterInfoArray = BEFInfoArray<BEFFileImpl::RegisterInfo, 24>;
-  using KernelInfoArray = BEFInfoArray<BEFFileImpl::KernelInfo, 8>;
+  using ReadyCountArray = BEFInfoArray<BEFFileImpl::ReadyCountLine, 2>;
 
-  // Decoded BEFFunction information.
+  // The per-execution state of a BEFFunction, set up by ReadFunction(). The
+  // static properties of the kernels and registers are read from `layout`.
   struct FunctionInfo {
+    const BEFFunctionLayout* layout = nullptr;
     // This ArrayRef contains kernel entries of all kernels of this function.
     ArrayRef<uint32_t> kernels;
-    // This is an array of descriptors for all of the kernels in this function,
-    // indexed by the kernel number.
+    // This is an array of the states of our registers, indexed by their
+    // register number.
     RegisterInfoArray register_infos;
-    // This is an array of descriptors for all of our registers, indexed by
-    // their register number.
-    KernelInfoArray kernel_infos;
+    // The ready counts of the kernels, laid out as described in
+    // BEFFunctionLayout::KernelEntry::ready_count_index.
+    ReadyCountArray ready_counts;
+    // Whether ready kernels are placed by their measured cost rather than by
+    // their stream, and the cost bounds of the placement, see
+    // BEFExecutorOptions::adaptive_placement.
+    bool adaptive_placement = false;
+    float max_inline_cost_ns = 0;
+    float min_outline_cost_ns = 0;
+
+    const BEFFunctionLayout::KernelEntry& kernel_entry(
+        unsigned kernel_id) const {
+      return layout->kernel_entries[kernel_id];
+    }
+
+    unsigned stream_id(unsigned kernel_id) const {
+      return kernel_entry(kernel_id).stream_id;
+    }
+
+    // Returns whether the ready kernel `kernel_id` should run inline on a
+    // thread that runs the stream `stream_id`, rather than being enqueued.
+    bool IsInline(unsigned kernel_id, unsigned stream_id) const {
+      const bool same_stream = this->stream_id(kernel_id) == stream_id;
+      if (!adaptive_placement) return same_stream;
+      const float cost =
+          layout->kernel_costs_ns[kernel_id].load(std::memory_order_relaxed);
+      if (cost == 0) return same_stream;
+      return same_stream ? cost < min_outline_cost_ns
+                         : cost < max_inline_cost_ns;
+    }
+
+    // Returns the timeout of the kernel in milliseconds, or zero if it has
+    // none.
+    uint32_t timeout_ms(unsigned kernel_id) const {
+      const auto& timeouts = layout->kernel_timeouts_ms;
+      return timeouts.empty() ? 0 : timeouts[kernel_id];
+    }
+
+    unsigned user_count(unsigned register_index) const {
+      return layout->register_user_counts[register_index];
+    }
+
+    std::atomic<int>& arguments_not_ready(unsigned kernel_id) {
+      uint32_t index = kernel_entry(kernel_id).ready_count_index;
+      return ready_counts[index / kReadyCountsPerLine]
+          .arguments_not_ready[index % kReadyCountsPerLine];
+    }
   };
 
-  // Decode the specified BEFFunction into the FunctionInfo. `host_allocator` is
-  // used for the heap-allocated buffer that backs info arrays in FunctionInfo.
+  // Decode the register and kernel tables of the function at
+  // `function_offset` into `layout`.
+  //
+  // On error, an error is emitted and false is returned.
+  bool DecodeFunctionLayout(size_t function_offset, size_t num_results,
+                            BEFFunctionLayout* layout);
+
+  // Decode the timeouts of the kernels of the function at `function_offset`
+  // from the KernelTimeouts section into `layout`, whose kernel table has
+  // been decoded.
+  //
+  // On error, an error is emitted and false is returned.
+  bool DecodeKernelTimeouts(size_t function_offset, BEFFunctionLayout* layout);
+
+  // Set up the FunctionInfo for an execution of `fn` from its cached layout.
+  // The info arrays in FunctionInfo that do not fit inline are placed in
+  // `info_storage` if it is not null, which must then hold
+  // GetInfoStorageSize() bytes aligned to kCacheLineSize. Otherwise they are
+  // allocated with `host_allocator`.
   //
   // On error, an error is emitted and false is returned.
   //
-  // ReadFunction is invoked for every BEFFunction execution. We can consider
-  // caching the kernel and register information in the BEFFunction object to
-  // avoid repeadly reading the same information from the BEF file. However, in
-  // the current implementation, we couple BEFExecutor states, e.g. AsyncValue
-  // for RegisterInfo, with the function reading. Caching kernel and register
-  // information would require us to avoid such coupling which can adversely
-  // affect the performance.
-  bool ReadFunction(size_t function_offset, ArrayRef<TypeName> results,
-                    size_t* location_offset, FunctionInfo* function_info,
+  // ReadFunction is invoked for every BEFFunction execution. The BEF file is
+  // only decoded on the first execution of `fn`; later executions only set up
+  // the per-execution FunctionInfo, which holds executor states such as the
+  // AsyncValue for each register and the ready count of each kernel.
+  bool ReadFunction(const BEFFunction& fn, size_t* location_offset,
+                    FunctionInfo* function_info,
                     llvm::SmallVectorImpl<size_t>* result_regs,
-                    HostAllocator* host_allocator);
+                    HostAllocator* host_allocator,
+                    void* info_storage = nullptr);
+
+  // Return the number of bytes of the info arrays of an execution of a
+  // function with `layout` that do not fit inline in FunctionInfo.
+  static size_t GetInfoStorageSize(const BEFFunctionLayout& layout);
 
   // Given an offset into the LocationPositions section, decode it and return
   // a DecodedDiagnostic.
   DecodedLocation DecodeLocation(size_t location_position_offset);
   std::optional<DebugInfo> GetDebugInfo(size_t location_position_offset);
 
+  // Decompresses the compressed location sections on the first call.
+  void DecompressLocationSections();
+
+  // Returns the register type table of `function` in the RegisterTypes
+  // section, or an empty array if the section is absent. The tables of all
+  // functions are found on the first call.
+  ArrayRef<uint8_t> GetRegisterTypeTable(const Function* function);
+
+  // The decoding of a location in locations_section_, memoized on the first
+  // call of DecodeLocation() or GetDebugInfo() for it.
+  struct CachedLocation {
+    std::once_flag decoded_once;
+    DecodedLocation decoded;
+    std::once_flag debug_info_once;
+    std::optional<DebugInfo> debug_info;
+  };
+
+  // Returns the cached location at `location_position_offset`, or nullptr if
+  // the offset is not the start of a top level location, which is then
+  // decoded without caching. The index of the locations is built on the first
+  // call.
+  CachedLocation* GetCachedLocation(size_t location_position_offset);
+
   // Only used for debugging. If TFRT_BEF_DEBUG is not defined, it
   // returns "unknown".
   const char* GetKernelName(size_t kernel_id) const;
@@ -334,6 +603,9 @@ class BEFFileImpl : public BEFFile {
   ArrayRef<uint8_t> function_section() const { return function_section_; }
 
   ErrorHandler error_handler_;
+  // Serializes the calls of error_handler_, as functions may be decoded
+  // concurrently.
+  mutex error_mu_;
 
   ArrayRef<uint8_t> string_section_;
   ArrayRef<uint8_t> attribute_section_;
@@ -345,8 +617,30 @@ class BEFFileImpl : public BEFFile {
   llvm::SmallVector<TypeName, 8> type_names_;
   llvm::StringMap<size_t> function_symbol_table_;
   llvm::SmallVector<std::unique_ptr<Function>, 8> functions_;
+  // The optional RegisterTypes section, and the register type table of every
+  // BEF function in it.
+  ArrayRef<uint8_t> register_types_section_;
+  std::once_flag register_type_tables_once_;
+  llvm::DenseMap<const Function*, ArrayRef<uint8_t>> register_type_tables_;
+  // The KernelTimeouts section, empty if no kernel has a timeout.
+  ArrayRef<uint8_t> kernel_timeouts_section_;
   ArrayRef<uint8_t> location_strings_section_;
   ArrayRef<uint8_t> locations_section_;
+  // The compressed location sections, and the decompressed data that the
+  // sections above point into once DecompressLocationSections() has run.
+  llvm::SmallVector<CompressedBEFSection, 2> compressed_location_sections_;
+  std::once_flag location_sections_once_;
+  llvm::SmallVector<uint8_t, 0> decompressed_location_strings_;
+  llvm::SmallVector<uint8_t, 0> decompressed_locations_;
+  // Maps the offsets of the locations in locations_section_ to their index in
+  // cached_locations_.
+  std::once_flag location_index_once_;
+  llvm::DenseMap<size_t, size_t> location_index_;
+  std::unique_ptr<CachedLocation[]> cached_locations_;
+
+  // If the BEF file was opened with BEFFile::OpenMapped(), this owns the
+  // memory mapping that all the sections above point into.
+  std::unique_ptr<io::ReadOnlyMemoryRegion> mapped_file_;
 
 #if defined(TFRT_BEF_DEBUG)
   // Maps from kernel_id to the name of the kernel.
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file implements BEFFileSlot.
+
+#include "tfrt/bef_executor/bef_file_slot.h"
+
+#include <thread>
+#include <utility>
+
+#include "tfrt/host_context/async_dispatch.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/support/string_util.h"
+
+namespace tfrt {
+
+// All operations on the epoch, the reader counts and the current version are
+// sequentially consistent, which the argument in Publish() relies on.
+
+BEFFileSlot::~BEFFileSlot() {
+  // Nobody may read the slot anymore, so there is no need to wait.
+  if (BEFFile* bef_file = current_.load()) bef_file->DropRef();
+}
+
+RCReference<BEFFile> BEFFileSlot::Get() const {
+  ReaderCount* readers;
+  while (true) {
+    const uint32_t epoch = epoch_.load();
+    readers = &readers_[epoch & 1];
+    readers->value.fetch_add(1);
+    // Publish() only waits for the readers of the epoch it ends, so we must
+    // not be counted in an epoch that ended before we were counted.
+    if (epoch_.load() == epoch) break;
+    readers->value.fetch_sub(1);
+  }
+
+  BEFFile* bef_file = current_.load();
+  RCReference<BEFFile> result;
+  if (bef_file != nullptr) result = FormRef(bef_file);
+  readers->value.fetch_sub(1);
+  return result;
+}
+
+RCReference<BEFFile> BEFFileSlot::Publish(RCReference<BEFFile> bef_file) {
+  mutex_lock lock(publish_mu_);
+
+  BEFFile* previous = current_.exchange(bef_file.release());
+
+  // Readers that see the new epoch read the new version, as the epoch is
+  // switched after the exchange above. So do readers of the previous epoch
+  // that are counted after the wait below saw their count drop to zero. The
+  // remaining readers of the previous epoch may have read the previous version
+  // and not yet taken their reference to it. Readers of older epochs were
+  // waited for by the publishers of those epochs.
+  const uint32_t epoch = epoch_.fetch_add(1);
+  const std::atomic<int64_t>& readers = readers_[epoch & 1].value;
+  while (readers.load() != 0) std::this_thread::yield();
+
+  version_.fetch_add(1);
+  return TakeRef(previous);
+}
+
+AsyncValueRef<Chain> BEFFileSlot::Reload(
+    HostContext* host, llvm::unique_function<RCReference<BEFFile>()> open,
+    llvm::unique_function<llvm::Error(const BEFFile&)> warm_up) {
+  auto done = MakeConstructedAsyncValueRef<Chain>();
+  bool enqueued = EnqueueBlockingWork(
+      host, [this, done = done.CopyRef(), open = std::move(open),
+             warm_up = std::move(warm_up)]() mutable {
+        RCReference<BEFFile> bef_file = open();
+        if (!bef_file) {
+          done.SetError(absl::InternalError("Could not open the BEF file."));
+          return;
+        }
+        if (warm_up) {
+          if (auto error = warm_up(*bef_file)) {
+            done.SetError(absl::InternalError(
+                StrCat("Could not warm up the BEF file: ",
+                       toString(std::move(error)))));
+            return;
+          }
+        }
+        // The previous version is released by its last request.
+        Publish(std::move(bef_file));
+        done.SetStateConcrete();
+      });
+  if (!enqueued) {
+    done.SetError(absl::InternalError("Failed to enqueue blocking work."));
+  }
+  return done;
+}
+
+}  // namespace tfrt
@@ -14,22 +14,23 @@
 
 //===- bef_interpreter.cc--------------------------------------------------===//
 //
-// This file implements the Interpreter for BEF files.
+// This file implements the Interpreter for BEF files. It runs the kernels of a
+// SyncBEFFunction from their decoded form, which the function builds once.
 
 #include "tfrt/bef_executor/bef_interpreter.h"
 
 #include <cstdint>
 #include <cstdio>
 #include <memory>
+#include <string>
 
 #include "bef_file_impl.h"
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/SmallVector.h"
-#include "tfrt/bef/bef_encoding.h"
-#include "tfrt/bef/bef_reader.h"
 #include "tfrt/host_context/host_context.h"
 #include "tfrt/host_context/location.h"
 #include "tfrt/host_context/sync_kernel_frame.h"
+#include "tfrt/support/error_util.h"
 #include "tfrt/support/forward_decls.h"
 
 #ifdef TFRT_BEF_DEBUG
@@ -55,41 +56,19 @@ class BEFInterpreterImpl final {
                 ArrayRef<Value*> results);
 
  private:
-  struct KernelEntry {
-    SyncKernelImplementation kernel_fn;
-    // KernelEntry starting location in BEF.
-    const uint32_t* kernel_start;
-    // All attributes, including, function attributes.
-    // This refers to a segment in attribute_pool_.
-    int attribute_start;
-    int num_attributes;
-    // Registers that are retired after the execution of this kernel.
-    // This refers to a segment in retired_register_pool_.
-    ArrayRef<Value*> retired_regs;
-    // Kernel code.
-    uint32_t kernel_code;
-  };
-
-  // Set up the data for each kernel.
-  void SetupKernelEntries();
   // Set up the registers for the function computation.
   void SetupRegisters(ArrayRef<Value*> arguments, ArrayRef<Value*> results);
 
   const SyncBEFFunction& func_;
 
+  // The error from decoding `func_`, or empty if it was decoded successfully.
+  std::string init_error_;
+
   // All registers used in the function.
   llvm::SmallVector<Value*, 16> registers_;
 
   // Store local Values used in the computation.
   llvm::SmallVector<Value, 16> local_values_;
-
-  // All kernel entries in the function.
-  llvm::SmallVector<KernelEntry, 16> kernel_entries_;
-
-  // Registers that are retired at each kernel.
-  llvm::SmallVector<Value*, 16> retired_register_pool_;
-  // Attributes used in all kernels.
-  llvm::SmallVector<const void*, 16> attribute_pool_;
 };
 
 //===----------------------------------------------------------------------===//
@@ -111,6 +90,11 @@ Error BEFInterpreter::Execute(const ExecutionContext& exec_ctx,
 BEFInterpreterImpl::BEFInterpreterImpl(const Function& func)
     : func_{static_cast<const SyncBEFFunction&>(func)} {
   assert(func.function_kind() == FunctionKind::kSyncBEFFunction);
+  if (auto error = func_.EnsureInitialized()) {
+    init_error_ = toString(std::move(error));
+    return;
+  }
+
   auto register_infos = func_.register_infos();
 
   size_t num_registers = register_infos.size();
@@ -137,92 +121,6 @@ BEFInterpreterImpl::BEFInterpreterImpl(const Function& func)
       ++local_value_index;
     }
   }
-
-  SetupKernelEntries();
-}
-
-void BEFInterpreterImpl::SetupKernelEntries() {
-  llvm::SmallVector<int, 16> user_counts;
-
-  auto register_infos = func_.register_infos();
-  user_counts.reserve(register_infos.size());
-
-  // Initialize the user counts for each register.
-  for (auto& reg_info : register_infos) {
-    user_counts.emplace_back() = reg_info.user_count;
-  }
-
-  retired_register_pool_.reserve(local_values_.size());
-
-  // Prepare all kernel entries for this function.
-  for (auto kernel_offset : func_.kernel_offsets()) {
-    auto& kernel_entry = kernel_entries_.emplace_back();
-
-    // Get the KernelEntry starting location in BEF.
-    kernel_entry.kernel_start =
-        func_.kernels().data() + kernel_offset / kKernelEntryAlignment;
-
-    BEFKernel kernel(kernel_entry.kernel_start);
-
-    // Get the kernel function.
-    kernel_entry.kernel_fn =
-        func_.bef_file()->GetSyncKernel(kernel.kernel_code());
-    kernel_entry.kernel_code = kernel.kernel_code();
-    assert(kernel_entry.kernel_fn != nullptr);
-
-    int retired_reg_start = retired_register_pool_.size();
-
-    // Collect retired registers from arguments.
-    auto arguments = kernel.GetArguments();
-    for (auto reg_idx : arguments) {
-      auto& user_count = user_counts[reg_idx];
-
-      --user_count;
-      assert(user_count >= 0);
-      if (user_count == 0) {
-        auto* value = registers_[reg_idx];
-        assert(value);
-        retired_register_pool_.emplace_back(value);
-      }
-    }
-
-    // Collect retired registers from results.
-    auto results = kernel.GetResults();
-    for (auto reg_index : results) {
-      // If there is no use for the result, mark it as retired.
-      if (user_counts[reg_index] == 0) {
-        auto* value = registers_[reg_index];
-        assert(value);
-        retired_register_pool_.emplace_back(value);
-      }
-    }
-
-    // Set the retired registers for this kernel.
-    kernel_entry.retired_regs =
-        llvm::ArrayRef(retired_register_pool_.begin() + retired_reg_start,
-                       retired_register_pool_.end());
-
-    // Collect the attributes
-    int attribute_start = attribute_pool_.size();
-    auto attributes = kernel.GetAttributes();
-    for (auto attribute_offset : attributes) {
-      // We pass the pointer here because this attribute could be an array of
-      // size 0.
-      attribute_pool_.emplace_back(func_.bef_file()->attribute_section_.data() +
-                                   attribute_offset);
-    }
-
-    // Collect the function attributes.
-    auto functions = kernel.GetFunctions();
-    for (auto fn_idx : functions) {
-      // Functions are passed as their corresponding `Function`.
-      attribute_pool_.emplace_back(func_.bef_file()->functions_[fn_idx].get());
-    }
-
-    // Set the attributes for this kernel.
-    kernel_entry.attribute_start = attribute_start;
-    kernel_entry.num_attributes = attribute_pool_.size() - attribute_start;
-  }
 }
 
 void BEFInterpreterImpl::SetupRegisters(ArrayRef<Value*> arguments,
@@ -253,28 +151,26 @@ Error BEFInterpreterImpl::Execute(const ExecutionContext& exec_ctx,
   assert(results.size() == func_.num_results() &&
          "incorrect number of results passed to function call");
 
+  if (!init_error_.empty()) return MakeStringError(init_error_);
+
   SetupRegisters(arguments, results);
 
   SyncKernelFrameBuilder kernel_frame(registers_, exec_ctx);
-  // Walk through each kernel entry and invoke each kernel sequentially.
-  for (auto& kernel_entry : kernel_entries_) {
+  // Walk through the decoded kernels and invoke each kernel sequentially.
+  for (const auto& kernel : func_.decoded_kernels()) {
     DEBUG_PRINT("Running kernel %s with kernel code %d: \n",
-                func_.bef_file()->GetKernelName(kernel_entry.kernel_code),
-                kernel_entry.kernel_code);
-
-    BEFKernel kernel(kernel_entry.kernel_start);
+                func_.bef_file()->GetKernelName(kernel.kernel_code),
+                kernel.kernel_code);
 
-    kernel_frame.SetArguments(kernel.GetArguments());
-    kernel_frame.SetAttributes(
-        llvm::ArrayRef(attribute_pool_.data() + kernel_entry.attribute_start,
-                       kernel_entry.num_attributes));
-    kernel_frame.SetResults(kernel.GetResults());
+    kernel_frame.SetArguments(kernel.arguments, kernel.argument_last_uses);
+    kernel_frame.SetAttributes(kernel.attributes);
+    kernel_frame.SetResults(kernel.results);
 
-    kernel_entry.kernel_fn(&kernel_frame);
+    kernel.kernel_fn(&kernel_frame);
 
     // Free values that are no longer needed.
-    for (auto value : kernel_entry.retired_regs) {
-      value->reset();
+    for (auto reg_idx : kernel.retired_regs) {
+      registers_[reg_idx]->reset();
     }
 
     // Check for error.
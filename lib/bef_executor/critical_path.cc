@@ -0,0 +1,237 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file implements CriticalPathRecorder and the critical path analysis.
+
+#include "tfrt/bef_executor/critical_path.h"
+
+#include <algorithm>
+#include <map>
+#include <utility>
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include "tfrt/support/error_util.h"
+
+namespace tfrt {
+
+void CriticalPathRecorder::Record(ExecutionTrace trace) {
+  mutex_lock lock(mu_);
+  traces_.push_back(std::move(trace));
+}
+
+std::vector<ExecutionTrace> CriticalPathRecorder::GetTraces() const {
+  mutex_lock lock(mu_);
+  return traces_;
+}
+
+void CriticalPathRecorder::Print(raw_ostream& os) const {
+  os << "# <kernel id> <stream id> <unblocked by> <ready ns> <start ns> "
+        "<end ns> <done ns> <kernel name> [<user kernel id>...]\n";
+  for (const ExecutionTrace& trace : GetTraces()) {
+    os << "function " << trace.function_name << '\n';
+    for (size_t id = 0; id < trace.kernels.size(); ++id) {
+      const KernelTrace& kernel = trace.kernels[id];
+      os << id << ' ' << kernel.stream_id << ' ' << kernel.unblocked_by << ' '
+         << kernel.ready_ns << ' ' << kernel.start_ns << ' ' << kernel.end_ns
+         << ' ' << kernel.done_ns << ' ' << kernel.name;
+      for (unsigned user : kernel.users) os << ' ' << user;
+      os << '\n';
+    }
+  }
+}
+
+llvm::Expected<std::vector<ExecutionTrace>> ParseExecutionTraces(
+    string_view text) {
+  std::vector<ExecutionTrace> traces;
+  llvm::SmallVector<llvm::StringRef, 16> lines;
+  llvm::StringRef(text.data(), text.size()).split(lines, '\n');
+
+  for (size_t line_number = 1; line_number <= lines.size(); ++line_number) {
+    llvm::StringRef line = lines[line_number - 1].trim();
+    if (line.empty() || line.startswith("#")) continue;
+
+    if (line.consume_front("function")) {
+      traces.emplace_back();
+      traces.back().function_name = line.trim().str();
+      continue;
+    }
+    if (traces.empty()) {
+      return MakeStringError("line ", line_number,
+                             ": kernel before the first function");
+    }
+
+    llvm::SmallVector<llvm::StringRef, 16> fields;
+    llvm::SplitString(line, fields);
+    if (fields.size() < 8) {
+      return MakeStringError("line ", line_number,
+                             ": expected at least 8 fields, got ",
+                             fields.size());
+    }
+
+    std::vector<KernelTrace>& kernels = traces.back().kernels;
+    unsigned id;
+    KernelTrace kernel;
+    if (fields[0].getAsInteger(10, id) ||
+        fields[1].getAsInteger(10, kernel.stream_id) ||
+        fields[2].getAsInteger(10, kernel.unblocked_by) ||
+        fields[3].getAsInteger(10, kernel.ready_ns) ||
+        fields[4].getAsInteger(10, kernel.start_ns) ||
+        fields[5].getAsInteger(10, kernel.end_ns) ||
+        fields[6].getAsInteger(10, kernel.done_ns)) {
+      return MakeStringError("line ", line_number, ": malformed kernel");
+    }
+    if (id != kernels.size()) {
+      return MakeStringError("line ", line_number, ": expected kernel ",
+                             kernels.size(), ", got ", id);
+    }
+    kernel.name = fields[7].str();
+    for (llvm::StringRef field : llvm::drop_begin(fields, 8)) {
+      unsigned user;
+      if (field.getAsInteger(10, user)) {
+        return MakeStringError("line ", line_number, ": malformed user ",
+                               field);
+      }
+      kernel.users.push_back(user);
+    }
+    kernels.push_back(std::move(kernel));
+  }
+
+  return std::move(traces);
+}
+
+CriticalPath AnalyzeCriticalPath(const ExecutionTrace& trace) {
+  const std::vector<KernelTrace>& kernels = trace.kernels;
+  const size_t num_kernels = kernels.size();
+
+  CriticalPath path;
+  path.slack_ns.assign(num_kernels, -1);
+
+  // The critical path ends at the kernel that completed last.
+  int last = -1;
+  for (size_t id = 1; id < num_kernels; ++id) {
+    if (!kernels[id].ran()) continue;
+    if (last < 0 || kernels[id].done_ns > kernels[last].done_ns) last = id;
+  }
+  if (last < 0) return path;
+  path.latency_ns = kernels[last].done_ns;
+
+  // Every kernel is made ready by a producer with a smaller kernel id, so the
+  // walk terminates at the arguments pseudo kernel even for malformed traces.
+  for (int id = last; id > 0;) {
+    path.kernels.push_back(id);
+    int next = kernels[id].unblocked_by;
+    id = next < id ? next : -1;
+  }
+  std::reverse(path.kernels.begin(), path.kernels.end());
+
+  // The latest time each kernel could have completed without delaying its
+  // users. A user could have become ready as late as its own latest
+  // completion time minus the time it took from becoming ready to completing.
+  // Users follow their producers, so a reverse walk sees users first.
+  std::vector<int64_t> latest_done_ns(num_kernels, path.latency_ns);
+  for (size_t id = num_kernels; id-- > 0;) {
+    const KernelTrace& kernel = kernels[id];
+    if (!kernel.ran()) continue;
+    for (unsigned user : kernel.users) {
+      if (user >= num_kernels || user <= id || !kernels[user].ran()) continue;
+      const KernelTrace& user_kernel = kernels[user];
+      latest_done_ns[id] =
+          std::min(latest_done_ns[id],
+                   latest_done_ns[user] -
+                       (user_kernel.done_ns - user_kernel.ready_ns));
+    }
+    path.slack_ns[id] =
+        std::max<int64_t>(0, latest_done_ns[id] - kernel.done_ns);
+  }
+
+  std::vector<bool> critical(num_kernels, false);
+  for (unsigned id : path.kernels) critical[id] = true;
+
+  std::map<int, CriticalPath::StreamSlack> streams;
+  for (size_t id = 1; id < num_kernels; ++id) {
+    const KernelTrace& kernel = kernels[id];
+    if (!kernel.ran()) continue;
+    auto inserted = streams.try_emplace(kernel.stream_id);
+    CriticalPath::StreamSlack& stream = inserted.first->second;
+    if (inserted.second) {
+      stream.stream_id = kernel.stream_id;
+      stream.min_slack_ns = path.slack_ns[id];
+    }
+    ++stream.num_kernels;
+    stream.num_critical_kernels += critical[id];
+    stream.busy_ns += kernel.end_ns - kernel.start_ns;
+    stream.queued_ns += kernel.start_ns - kernel.ready_ns;
+    stream.min_slack_ns = std::min(stream.min_slack_ns, path.slack_ns[id]);
+    // Accumulate the total here, and divide it below.
+    stream.mean_slack_ns += path.slack_ns[id];
+  }
+  for (auto& iter : streams) {
+    iter.second.mean_slack_ns /= iter.second.num_kernels;
+    path.streams.push_back(iter.second);
+  }
+
+  return path;
+}
+
+namespace {
+
+// Format nanoseconds as microseconds.
+auto FormatMicros(int64_t ns) { return llvm::format("%12.3f", ns * 1e-3); }
+
+}  // namespace
+
+void PrintCriticalPath(const ExecutionTrace& trace, const CriticalPath& path,
+                       raw_ostream& os) {
+  const std::vector<KernelTrace>& kernels = trace.kernels;
+  int num_ran = 0;
+  for (size_t id = 1; id < kernels.size(); ++id) num_ran += kernels[id].ran();
+
+  os << "function "
+     << (trace.function_name.empty() ? "(unknown)" : trace.function_name)
+     << ": " << llvm::format("%.3f", path.latency_ns * 1e-3) << " us, "
+     << num_ran << " kernels, " << path.kernels.size()
+     << " on the critical path\n";
+
+  os << "  critical path (times in us):\n"
+     << "      kernel  stream        ready       queued          ran"
+        "        async  name\n";
+  for (unsigned id : path.kernels) {
+    const KernelTrace& kernel = kernels[id];
+    os << llvm::format("  %10u  %6d", id, kernel.stream_id) << ' '
+       << FormatMicros(kernel.ready_ns) << ' '
+       << FormatMicros(kernel.start_ns - kernel.ready_ns) << ' '
+       << FormatMicros(kernel.end_ns - kernel.start_ns) << ' '
+       << FormatMicros(kernel.done_ns - kernel.end_ns) << "  " << kernel.name
+       << '\n';
+  }
+
+  os << "  slack per stream (times in us):\n"
+     << "      stream  kernels  critical         busy       queued"
+        "    min slack   mean slack\n";
+  for (const CriticalPath::StreamSlack& stream : path.streams) {
+    os << llvm::format("  %10d  %7d  %8d", stream.stream_id, stream.num_kernels,
+                       stream.num_critical_kernels)
+       << ' ' << FormatMicros(stream.busy_ns) << ' '
+       << FormatMicros(stream.queued_ns) << ' '
+       << FormatMicros(stream.min_slack_ns) << ' '
+       << FormatMicros(stream.mean_slack_ns) << '\n';
+  }
+}
+
+}  // namespace tfrt
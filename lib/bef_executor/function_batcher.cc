@@ -0,0 +1,422 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements FunctionBatcher.
+
+#include "tfrt/bef_executor/function_batcher.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"  // from @com_google_absl
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "tfrt/host_context/async_dispatch.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/function.h"
+#include "tfrt/host_context/host_buffer.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/host_context/timer_queue.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/string_util.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+namespace {
+
+struct Call {
+  explicit Call(const ExecutionContext& exec_ctx) : exec_ctx(exec_ctx) {}
+
+  // The context of the caller. The call is cancelled on its own, and shares
+  // the batch only with calls of the same ResourceContext.
+  ExecutionContext exec_ctx;
+  std::vector<RCReference<AsyncValue>> arguments;
+  std::vector<RCReference<IndirectAsyncValue>> results;
+};
+
+struct Batch {
+  // The host whose timer queue runs the timer of the batch.
+  HostContext* host = nullptr;
+  std::vector<Call> calls;
+  TimerQueue::TimerHandle timer;
+};
+
+void SetResultsToError(Call& call, const absl::Status& status) {
+  for (auto& result : call.results)
+    result->ForwardTo(MakeErrorAsyncValueRef(status));
+}
+
+// Sets the results of `call` to its cancellation error.
+void SetResultsToCancelled(Call& call, ErrorAsyncValue* cancel_value) {
+  for (auto& result : call.results) result->ForwardTo(FormRef(cancel_value));
+}
+
+// Returns dimension 0 of `tensor`, which must have rank 1 or more.
+Index GetNumRows(const DenseHostTensor& tensor) {
+  return tensor.shape().GetDimensionSize(0);
+}
+
+// Returns the shape of `tensor` with dimension 0 replaced by `num_rows`.
+TensorShape WithNumRows(const TensorShape& shape, Index num_rows) {
+  llvm::SmallVector<Index, 4> dims;
+  shape.GetDimensions(&dims);
+  dims[0] = num_rows;
+  return TensorShape(dims);
+}
+
+// Returns true if `lhs` and `rhs` share dtype and all dimensions but the first.
+bool CanConcatenate(const DenseHostTensor& lhs, const DenseHostTensor& rhs) {
+  if (lhs.dtype() != rhs.dtype()) return false;
+  if (lhs.shape().GetRank() != rhs.shape().GetRank()) return false;
+  for (int i = 1; i < lhs.shape().GetRank(); ++i) {
+    if (lhs.shape().GetDimensionSize(i) != rhs.shape().GetDimensionSize(i))
+      return false;
+  }
+  return true;
+}
+
+// Returns true if all arguments of `call` have rank 1 or more and the same
+// dimension 0, which is the number of rows of the call.
+bool HasBatchDimension(const Call& call) {
+  const auto& first = call.arguments.front()->get<DenseHostTensor>();
+  if (first.shape().GetRank() == 0) return false;
+  return llvm::all_of(call.arguments, [&](const auto& argument) {
+    const auto& tensor = argument->get<DenseHostTensor>();
+    return tensor.shape().GetRank() > 0 &&
+           GetNumRows(tensor) == GetNumRows(first);
+  });
+}
+
+// Returns true if `lhs` and `rhs` can be executed as one batch: they have the
+// same ResourceContext, and their arguments can be concatenated.
+bool CanBatch(const Call& lhs, const Call& rhs) {
+  if (lhs.exec_ctx.resource_context() != rhs.exec_ctx.resource_context())
+    return false;
+  for (size_t i = 0; i < lhs.arguments.size(); ++i) {
+    if (!CanConcatenate(lhs.arguments[i]->get<DenseHostTensor>(),
+                        rhs.arguments[i]->get<DenseHostTensor>()))
+      return false;
+  }
+  return true;
+}
+
+// Returns the context to execute a batch of `calls` in. It has the
+// ResourceContext of the calls and the highest priority among them, but the
+// deadline and the cancellation of none of them, so that a caller that is
+// cancelled or expires does not fail the other calls.
+Expected<ExecutionContext> CreateBatchContext(ArrayRef<Call> calls) {
+  const ExecutionContext& first = calls.front().exec_ctx;
+  RequestOptions options;
+  options.priority = first.request_ctx()->priority();
+  for (const Call& call : calls)
+    options.priority =
+        std::min(options.priority, call.exec_ctx.request_ctx()->priority());
+  auto request_ctx =
+      RequestContextBuilder(first.host(), first.resource_context())
+          .set_request_options(std::move(options))
+          .build();
+  if (!request_ctx) return request_ctx.takeError();
+  return ExecutionContext(std::move(*request_ctx));
+}
+
+// Executes a single call in its own context, forwarding its results to the
+// caller.
+void ExecuteCall(const Function* function, Call& call) {
+  const ExecutionContext& exec_ctx = call.exec_ctx;
+  llvm::SmallVector<AsyncValue*, 4> arguments;
+  for (const auto& argument : call.arguments)
+    arguments.push_back(argument.get());
+  llvm::SmallVector<RCReference<AsyncValue>, 4> results(call.results.size());
+  function->Execute(exec_ctx, arguments, results);
+  for (size_t i = 0; i < results.size(); ++i)
+    call.results[i]->ForwardTo(std::move(results[i]));
+}
+
+// Splits the rows of `batch_results` across `calls`, where `num_rows[i]` is
+// the number of rows of `calls[i]`. The results share the buffers of the batch
+// results. The calls that were cancelled in the meantime get their
+// cancellation error instead.
+void SplitResults(ArrayRef<RCReference<AsyncValue>> batch_results,
+                  ArrayRef<Index> num_rows, MutableArrayRef<Call> calls) {
+  Index total_rows = 0;
+  for (Index rows : num_rows) total_rows += rows;
+
+  for (size_t i = 0; i < batch_results.size(); ++i) {
+    AsyncValue* batch_result = batch_results[i].get();
+    if (batch_result->IsError()) {
+      for (Call& call : calls)
+        call.results[i]->ForwardTo(FormRef(batch_result));
+      continue;
+    }
+    const auto& tensor = batch_result->get<DenseHostTensor>();
+    if (tensor.shape().GetRank() == 0 || GetNumRows(tensor) != total_rows) {
+      auto status = absl::InvalidArgumentError(
+          StrCat("batched result ", i, " has shape ", tensor.shape(),
+                 ", expected ", total_rows, " rows"));
+      for (Call& call : calls)
+        call.results[i]->ForwardTo(MakeErrorAsyncValueRef(status));
+      continue;
+    }
+
+    const size_t row_size =
+        total_rows == 0 ? 0 : tensor.DataSizeInBytes() / total_rows;
+    size_t offset = 0;
+    for (size_t j = 0; j < calls.size(); ++j) {
+      const size_t size = num_rows[j] * row_size;
+      if (auto* cancel_value = calls[j].exec_ctx.GetCancelAsyncValue()) {
+        calls[j].results[i]->ForwardTo(FormRef(cancel_value));
+        offset += size;
+        continue;
+      }
+      DenseHostTensor rows(
+          TensorMetadata(tensor.dtype(),
+                         WithNumRows(tensor.shape(), num_rows[j])),
+          HostBuffer::CreateFromExternal(tensor.buffer(), offset, size));
+      calls[j].results[i]->ForwardTo(
+          MakeAvailableAsyncValueRef<DenseHostTensor>(std::move(rows))
+              .ReleaseRCRef());
+      offset += size;
+    }
+  }
+}
+
+}  // namespace
+
+class FunctionBatcher::Impl : public std::enable_shared_from_this<Impl> {
+ public:
+  Impl(const Function* function, FunctionBatcherOptions options)
+      : function_(function), options_(options) {}
+
+  void Execute(const ExecutionContext& exec_ctx,
+               ArrayRef<AsyncValue*> arguments,
+               MutableArrayRef<RCReference<AsyncValue>> results);
+
+  void Flush() {
+    std::unique_ptr<Batch> batch;
+    {
+      mutex_lock lock(mu_);
+      batch = TakePendingBatch();
+    }
+    if (batch) RunBatch(function_, std::move(batch));
+  }
+
+ private:
+  // Removes the pending batch, and cancels its timer.
+  std::unique_ptr<Batch> TakePendingBatch() TFRT_REQUIRES(mu_) {
+    if (!pending_batch_) return nullptr;
+    ++pending_batch_id_;
+    auto batch = std::move(pending_batch_);
+    if (batch->timer) batch->host->GetTimerQueue()->CancelTimer(batch->timer);
+    return batch;
+  }
+
+  // Runs the pending batch if it is still `batch_id` when its timer fires.
+  // The batch runs on the work queue, to keep the timer thread free. It is
+  // not enqueued with the context of a call, whose deadline would shed it.
+  void OnTimeout(uint64_t batch_id) {
+    std::unique_ptr<Batch> batch;
+    {
+      mutex_lock lock(mu_);
+      if (pending_batch_id_ != batch_id || !pending_batch_) return;
+      ++pending_batch_id_;
+      batch = std::move(pending_batch_);
+    }
+    HostContext* host = batch->host;
+    EnqueueWork(host,
+                [function = function_, batch = std::move(batch)]() mutable {
+                  RunBatch(function, std::move(batch));
+                });
+  }
+
+  // Runs `batch` once the arguments of all its calls are available.
+  static void RunBatch(const Function* function, std::unique_ptr<Batch> batch) {
+    llvm::SmallVector<AsyncValue*, 8> arguments;
+    for (const Call& call : batch->calls)
+      for (const auto& argument : call.arguments)
+        arguments.push_back(argument.get());
+    RunWhenReady(arguments, [function, batch = std::move(batch)]() mutable {
+      ExecuteBatch(function, *batch);
+    });
+  }
+
+  static void ExecuteBatch(const Function* function, Batch& batch);
+  // Executes `calls`, which can be batched, as one batch.
+  static void ExecuteBatchedCalls(const Function* function,
+                                  std::vector<Call> calls);
+
+  const Function* const function_;
+  const FunctionBatcherOptions options_;
+
+  mutex mu_;
+  std::unique_ptr<Batch> pending_batch_ TFRT_GUARDED_BY(mu_);
+  uint64_t pending_batch_id_ TFRT_GUARDED_BY(mu_) = 0;
+};
+
+void FunctionBatcher::Impl::Execute(
+    const ExecutionContext& exec_ctx, ArrayRef<AsyncValue*> arguments,
+    MutableArrayRef<RCReference<AsyncValue>> results) {
+  assert(arguments.size() == function_->num_arguments());
+  assert(results.size() == function_->num_results());
+
+  Call call(exec_ctx);
+  call.arguments.reserve(arguments.size());
+  for (AsyncValue* argument : arguments)
+    call.arguments.push_back(FormRef(argument));
+  call.results.reserve(results.size());
+  for (auto& result : results) {
+    call.results.push_back(MakeIndirectAsyncValue());
+    result = call.results.back();
+  }
+
+  std::unique_ptr<Batch> full_batch;
+  {
+    mutex_lock lock(mu_);
+    if (!pending_batch_) {
+      pending_batch_ = std::make_unique<Batch>();
+      pending_batch_->host = exec_ctx.host();
+      if (options_.max_batch_size > 1) {
+        pending_batch_->timer = exec_ctx.host()->GetTimerQueue()->ScheduleTimer(
+            options_.batch_timeout,
+            [impl = weak_from_this(), batch_id = pending_batch_id_]() {
+              if (auto self = impl.lock()) self->OnTimeout(batch_id);
+            });
+      }
+    }
+    pending_batch_->calls.push_back(std::move(call));
+    if (pending_batch_->calls.size() >=
+        static_cast<size_t>(options_.max_batch_size))
+      full_batch = TakePendingBatch();
+  }
+  if (full_batch) RunBatch(function_, std::move(full_batch));
+}
+
+void FunctionBatcher::Impl::ExecuteBatch(const Function* function,
+                                         Batch& batch) {
+  // Calls that are cancelled, or have errors in their arguments, fail on
+  // their own. Calls without a batch dimension run on their own. The other
+  // calls are grouped with the calls they can be batched with.
+  std::vector<std::vector<Call>> groups;
+  for (Call& call : batch.calls) {
+    if (auto* cancel_value = call.exec_ctx.GetCancelAsyncValue()) {
+      SetResultsToCancelled(call, cancel_value);
+      continue;
+    }
+    auto error = llvm::find_if(call.arguments, [](const auto& argument) {
+      return argument->IsError();
+    });
+    if (error != call.arguments.end()) {
+      SetResultsToError(call, (*error)->GetError());
+      continue;
+    }
+    if (call.arguments.empty() || !HasBatchDimension(call)) {
+      ExecuteCall(function, call);
+      continue;
+    }
+    auto group = llvm::find_if(groups, [&](const std::vector<Call>& calls) {
+      return CanBatch(calls.front(), call);
+    });
+    if (group == groups.end()) {
+      groups.emplace_back();
+      group = std::prev(groups.end());
+    }
+    group->push_back(std::move(call));
+  }
+
+  for (std::vector<Call>& calls : groups) {
+    if (calls.size() == 1) {
+      ExecuteCall(function, calls.front());
+    } else {
+      ExecuteBatchedCalls(function, std::move(calls));
+    }
+  }
+}
+
+void FunctionBatcher::Impl::ExecuteBatchedCalls(const Function* function,
+                                                std::vector<Call> calls) {
+  const size_t num_arguments = function->num_arguments();
+  auto exec_ctx = CreateBatchContext(calls);
+  if (!exec_ctx) {
+    auto status = absl::InternalError(toString(exec_ctx.takeError()));
+    for (Call& call : calls) SetResultsToError(call, status);
+    return;
+  }
+
+  llvm::SmallVector<Index, 8> num_rows;
+  for (const Call& call : calls)
+    num_rows.push_back(GetNumRows(call.arguments[0]->get<DenseHostTensor>()));
+
+  // Concatenate each argument of the calls along dimension 0.
+  llvm::SmallVector<RCReference<AsyncValue>, 4> batch_arguments;
+  for (size_t i = 0; i < num_arguments; ++i) {
+    const auto& first = calls.front().arguments[i]->get<DenseHostTensor>();
+    Index total_rows = 0;
+    for (const Call& call : calls)
+      total_rows += GetNumRows(call.arguments[i]->get<DenseHostTensor>());
+
+    auto tensor = DenseHostTensor::CreateUninitialized(
+        TensorMetadata(first.dtype(), WithNumRows(first.shape(), total_rows)),
+        exec_ctx->host());
+    if (!tensor) {
+      auto status = absl::ResourceExhaustedError(
+          "failed to allocate the batched arguments");
+      for (Call& call : calls) SetResultsToError(call, status);
+      return;
+    }
+    char* data = static_cast<char*>(tensor->data());
+    for (const Call& call : calls) {
+      const auto& part = call.arguments[i]->get<DenseHostTensor>();
+      std::memcpy(data, part.data(), part.DataSizeInBytes());
+      data += part.DataSizeInBytes();
+    }
+    batch_arguments.push_back(
+        MakeAvailableAsyncValueRef<DenseHostTensor>(std::move(*tensor))
+            .ReleaseRCRef());
+  }
+
+  llvm::SmallVector<AsyncValue*, 4> arguments;
+  for (const auto& argument : batch_arguments)
+    arguments.push_back(argument.get());
+  llvm::SmallVector<RCReference<AsyncValue>, 4> batch_results(
+      function->num_results());
+  function->Execute(*exec_ctx, arguments, batch_results);
+
+  llvm::SmallVector<AsyncValue*, 4> results;
+  for (const auto& result : batch_results) results.push_back(result.get());
+  RunWhenReady(results, [batch_results = std::move(batch_results),
+                         num_rows = std::move(num_rows),
+                         calls = std::move(calls)]() mutable {
+    SplitResults(batch_results, num_rows, calls);
+  });
+}
+
+FunctionBatcher::FunctionBatcher(const Function* function,
+                                 FunctionBatcherOptions options)
+    : impl_(std::make_shared<Impl>(function, options)) {}
+
+FunctionBatcher::~FunctionBatcher() { impl_->Flush(); }
+
+void FunctionBatcher::Execute(
+    const ExecutionContext& exec_ctx, ArrayRef<AsyncValue*> arguments,
+    MutableArrayRef<RCReference<AsyncValue>> results) {
+  impl_->Execute(exec_ctx, arguments, results);
+}
+
+void FunctionBatcher::Flush() { impl_->Flush(); }
+
+}  // namespace tfrt
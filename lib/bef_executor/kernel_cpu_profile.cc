@@ -0,0 +1,107 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements KernelCpuProfile.
+
+#include "tfrt/bef_executor/kernel_cpu_profile.h"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "llvm/Support/raw_ostream.h"
+#include "tfrt/metrics/metrics.h"
+
+namespace tfrt {
+
+// Counters are process-wide, so profiles share one per metric name.
+static metrics::Counter* GetCounter(std::string name) {
+  static mutex* mu = new mutex;
+  static auto* counters = new llvm::StringMap<metrics::Counter*>;
+  mutex_lock lock(*mu);
+  metrics::Counter*& counter = (*counters)[name];
+  if (counter == nullptr) counter = metrics::NewCounter(std::move(name));
+  return counter;
+}
+
+void KernelCpuProfile::Record(string_view function_name,
+                              string_view kernel_name,
+                              std::chrono::nanoseconds cpu_time,
+                              std::chrono::nanoseconds wall_time) {
+  if (function_name.empty()) function_name = kAnonymousFunction;
+
+  metrics::Counter* cpu_time_ns;
+  metrics::Counter* wall_time_ns;
+  {
+    mutex_lock lock(mu_);
+    llvm::StringMap<KernelEntry>& kernels = entries_[function_name];
+    auto it = kernels.find(kernel_name);
+    if (it == kernels.end()) {
+      const std::string suffix = (function_name + "/" + kernel_name).str();
+      it = kernels
+               .try_emplace(
+                   kernel_name,
+                   KernelEntry{
+                       Entry{},
+                       GetCounter("/tfrt/bef_executor/kernel_cpu_time_ns/" +
+                                  suffix),
+                       GetCounter("/tfrt/bef_executor/kernel_wall_time_ns/" +
+                                  suffix)})
+               .first;
+    }
+    Entry& entry = it->second.entry;
+    ++entry.count;
+    entry.cpu_ns += cpu_time.count();
+    entry.wall_ns += wall_time.count();
+    cpu_time_ns = it->second.cpu_time_ns;
+    wall_time_ns = it->second.wall_time_ns;
+  }
+  cpu_time_ns->IncrementBy(cpu_time.count());
+  wall_time_ns->IncrementBy(wall_time.count());
+}
+
+llvm::StringMap<llvm::StringMap<KernelCpuProfile::Entry>>
+KernelCpuProfile::GetEntries() const {
+  llvm::StringMap<llvm::StringMap<Entry>> result;
+  mutex_lock lock(mu_);
+  for (const auto& function : entries_) {
+    llvm::StringMap<Entry>& kernels = result[function.getKey()];
+    for (const auto& kernel : function.getValue())
+      kernels.try_emplace(kernel.getKey(), kernel.getValue().entry);
+  }
+  return result;
+}
+
+void KernelCpuProfile::Print(raw_ostream& os) const {
+  auto entries = GetEntries();
+
+  // Sort by name to make the output deterministic.
+  std::vector<std::pair<llvm::StringRef, llvm::StringRef>> names;
+  for (const auto& function : entries) {
+    for (const auto& kernel : function.getValue())
+      names.emplace_back(function.getKey(), kernel.getKey());
+  }
+  std::sort(names.begin(), names.end());
+
+  os << "# <number of calls> <total CPU ns> <total wall ns> <function> "
+        "<kernel>\n";
+  for (const auto& name : names) {
+    const Entry& entry = entries[name.first][name.second];
+    os << entry.count << ' ' << entry.cpu_ns << ' ' << entry.wall_ns << ' '
+       << name.first << ' ' << name.second << '\n';
+  }
+}
+
+}  // namespace tfrt
@@ -0,0 +1,64 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements KernelProfile.
+
+#include "tfrt/bef_executor/kernel_profile.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "llvm/Support/raw_ostream.h"
+
+namespace tfrt {
+
+void KernelProfile::Record(Location loc, std::chrono::nanoseconds duration) {
+  if (!loc) return;
+
+  // Decode the location outside of the lock. It is only paid when profiling.
+  std::string location;
+  llvm::raw_string_ostream os(location);
+  os << loc.Decode();
+  os.flush();
+  if (location.empty()) return;
+
+  mutex_lock lock(mu_);
+  Entry& entry = entries_[location];
+  ++entry.count;
+  entry.total_ns += duration.count();
+}
+
+llvm::StringMap<KernelProfile::Entry> KernelProfile::GetEntries() const {
+  mutex_lock lock(mu_);
+  return entries_;
+}
+
+void KernelProfile::Print(raw_ostream& os) const {
+  auto entries = GetEntries();
+
+  // Sort by location to make the output deterministic.
+  std::vector<llvm::StringRef> locations;
+  locations.reserve(entries.size());
+  for (const auto& entry : entries) locations.push_back(entry.getKey());
+  std::sort(locations.begin(), locations.end());
+
+  os << "# <number of calls> <total nanoseconds> <location>\n";
+  for (llvm::StringRef location : locations) {
+    const Entry& entry = entries[location];
+    os << entry.count << ' ' << entry.total_ns << ' ' << location << '\n';
+  }
+}
+
+}  // namespace tfrt
@@ -0,0 +1,130 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements KernelSampler.
+
+#include "tfrt/bef_executor/kernel_sampler.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "llvm/Support/raw_ostream.h"
+#include "tfrt/metrics/metrics.h"
+
+namespace tfrt {
+
+// Measures the period of ReadCycleCounter() against the steady clock once per
+// process. The cycle counters used are invariant, so their rate does not
+// change with the frequency of the core.
+static double GetNanosecondsPerCycle() {
+  static const double ns_per_cycle = [] {
+    using Clock = std::chrono::steady_clock;
+    const auto start_time = Clock::now();
+    const uint64_t start_cycles = KernelSampler::ReadCycleCounter();
+    Clock::time_point end_time;
+    do {
+      end_time = Clock::now();
+    } while (end_time - start_time < std::chrono::milliseconds(1));
+    const uint64_t cycles = KernelSampler::ReadCycleCounter() - start_cycles;
+    const double ns =
+        std::chrono::duration<double, std::nano>(end_time - start_time).count();
+    return cycles == 0 ? 1.0 : ns / cycles;
+  }();
+  return ns_per_cycle;
+}
+
+// Histograms are process-wide, so samplers share one per kernel name.
+static metrics::Histogram* GetKernelTimeHistogram(string_view kernel_name) {
+  static mutex* mu = new mutex;
+  static auto* histograms = new llvm::StringMap<metrics::Histogram*>;
+  mutex_lock lock(*mu);
+  metrics::Histogram*& histogram = (*histograms)[kernel_name];
+  if (histogram == nullptr) {
+    // Powers of four from 64ns to about 17 seconds.
+    std::vector<double> bounds;
+    for (double bound = 64; bound < 2e10; bound *= 4) bounds.push_back(bound);
+    histogram = metrics::NewHistogram(
+        ("/tfrt/bef_executor/kernel_time_ns/" + kernel_name).str(),
+        metrics::Buckets::Explicit(std::move(bounds)));
+  }
+  return histogram;
+}
+
+KernelSampler::KernelSampler(uint32_t sample_period)
+    : sample_period_(std::max<uint32_t>(sample_period, 1)),
+      ns_per_cycle_(GetNanosecondsPerCycle()) {}
+
+uint32_t KernelSampler::NextInterval() const {
+  if (sample_period_ == 1) return 1;
+  // xorshift32, seeded differently for each thread.
+  static thread_local uint32_t state =
+      static_cast<uint32_t>(ReadCycleCounter()) | 1;
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return 1 + state % (2 * sample_period_ - 1);
+}
+
+void KernelSampler::Record(string_view kernel_name, uint64_t cycles) {
+  const double ns = cycles * ns_per_cycle_;
+  metrics::Histogram* histogram;
+  {
+    mutex_lock lock(mu_);
+    auto it = entries_.find(kernel_name);
+    if (it == entries_.end()) {
+      it = entries_
+               .try_emplace(kernel_name,
+                            Entry{Stats{0, 0, ns, ns},
+                                  GetKernelTimeHistogram(kernel_name)})
+               .first;
+    }
+    Stats& stats = it->second.stats;
+    ++stats.num_samples;
+    stats.total_ns += ns;
+    stats.min_ns = std::min(stats.min_ns, ns);
+    stats.max_ns = std::max(stats.max_ns, ns);
+    histogram = it->second.histogram;
+  }
+  histogram->Record(ns);
+}
+
+llvm::StringMap<KernelSampler::Stats> KernelSampler::GetStats() const {
+  llvm::StringMap<Stats> result;
+  mutex_lock lock(mu_);
+  for (const auto& entry : entries_)
+    result.try_emplace(entry.getKey(), entry.getValue().stats);
+  return result;
+}
+
+void KernelSampler::Print(raw_ostream& os) const {
+  auto stats = GetStats();
+
+  // Sort by name to make the output deterministic.
+  std::vector<llvm::StringRef> names;
+  names.reserve(stats.size());
+  for (const auto& entry : stats) names.push_back(entry.getKey());
+  std::sort(names.begin(), names.end());
+
+  os << "# <samples> <estimated calls> <mean ns> <min ns> <max ns> <kernel>\n";
+  for (llvm::StringRef name : names) {
+    const Stats& s = stats[name];
+    os << s.num_samples << ' ' << s.num_samples * sample_period_ << ' '
+       << static_cast<int64_t>(s.total_ns / s.num_samples) << ' '
+       << static_cast<int64_t>(s.min_ns) << ' '
+       << static_cast<int64_t>(s.max_ns) << ' ' << name << '\n';
+  }
+}
+
+}  // namespace tfrt
@@ -25,15 +25,20 @@
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/ScopeExit.h"
 #include "llvm/Support/DynamicLibrary.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm_derived/Support/raw_ostream.h"
+#include "load_generator.h"
 #include "mlir/IR/BuiltinAttributes.h"
 #include "mlir/IR/Diagnostics.h"
 #include "mlir/IR/Location.h"
 #include "mlir/IR/MLIRContext.h"
 #include "mlir/Support/FileUtilities.h"
 #include "tfrt/bef/bef_buffer.h"
+#include "tfrt/bef_executor/bef_executor_options.h"
 #include "tfrt/bef_executor/bef_file.h"
+#include "tfrt/bef_executor/critical_path.h"
+#include "tfrt/bef_executor/kernel_profile.h"
 #include "tfrt/core_runtime/core_runtime.h"
 #include "tfrt/core_runtime/tensor_handle.h"
 #include "tfrt/host_context/async_value.h"
@@ -60,14 +65,70 @@ static void RunBefFunction(
     bool print_error_code);
 
 int RunBefExecutor(const RunBefConfig& run_config) {
-  return RunBefExecutor(
+  RequestOptions request_options;
+  request_options.use_arena_allocator =
+      run_config.host_allocator_type == HostAllocatorType::kRequestArena;
+
+  std::unique_ptr<KernelProfile> kernel_profile;
+  if (!run_config.kernel_profile_filename.empty())
+    kernel_profile = std::make_unique<KernelProfile>();
+
+  std::unique_ptr<CriticalPathRecorder> critical_path_recorder;
+  if (!run_config.critical_path_filename.empty())
+    critical_path_recorder = std::make_unique<CriticalPathRecorder>();
+
+  const bool attribute_allocations =
+      run_config.host_allocator_type == HostAllocatorType::kAllocationProfiler;
+
+  int exit_code = RunBefExecutor(
       run_config,
-      [](HostContext* host, ResourceContext* resource_context)
+      [request_options, profile = kernel_profile.get(), attribute_allocations,
+       recorder = critical_path_recorder.get()](
+          HostContext* host, ResourceContext* resource_context)
           -> llvm::Expected<ExecutionContext> {
-        auto req_ctx = RequestContextBuilder(host, resource_context).build();
+        RequestContextBuilder builder(host, resource_context);
+        builder.set_request_options(request_options);
+        if (profile != nullptr || attribute_allocations ||
+            recorder != nullptr) {
+          auto& options = builder.context_data().emplace<BEFExecutorOptions>();
+          options.kernel_profile = profile;
+          options.attribute_allocations = attribute_allocations;
+          options.critical_path_recorder = recorder;
+        }
+        auto req_ctx = std::move(builder).build();
         if (!req_ctx) return req_ctx.takeError();
         return ExecutionContext{std::move(req_ctx.get())};
       });
+
+  if (kernel_profile) {
+    std::error_code error_code;
+    llvm::raw_fd_ostream os(run_config.kernel_profile_filename, error_code,
+                            llvm::sys::fs::OF_Text);
+    if (error_code) {
+      llvm::errs() << run_config.program_name
+                   << ": couldn't write kernel profile to "
+                   << run_config.kernel_profile_filename << ": "
+                   << error_code.message() << "\n";
+      return 1;
+    }
+    kernel_profile->Print(os);
+  }
+
+  if (critical_path_recorder) {
+    std::error_code error_code;
+    llvm::raw_fd_ostream os(run_config.critical_path_filename, error_code,
+                            llvm::sys::fs::OF_Text);
+    if (error_code) {
+      llvm::errs() << run_config.program_name
+                   << ": couldn't write critical path traces to "
+                   << run_config.critical_path_filename << ": "
+                   << error_code.message() << "\n";
+      return 1;
+    }
+    critical_path_recorder->Print(os);
+  }
+
+  return exit_code;
 }
 
 int RunBefExecutor(
@@ -112,6 +173,8 @@ int RunBefExecutor(
          "We have reference-counted objects before we started to do anything");
 
   std::unique_ptr<HostAllocator> host_allocator;
+  // Owned by the HostContext once it is created.
+  AllocationProfiler* allocation_profiler = nullptr;
   switch (run_config.host_allocator_type) {
     case HostAllocatorType::kMalloc:
       host_allocator = CreateMallocAllocator();
@@ -130,6 +193,35 @@ int RunBefExecutor(
       host_allocator = CreateMallocAllocator();
       host_allocator = CreateLeakCheckAllocator(std::move(host_allocator));
       tfrt::outs() << "Choosing memory leak check allocator.\n";
+      break;
+    case HostAllocatorType::kPooledMalloc:
+      host_allocator = CreatePooledAllocator(CreateMallocAllocator());
+      tfrt::outs() << "Choosing pooled allocator based on malloc.\n";
+      break;
+    case HostAllocatorType::kHugePageMalloc:
+      host_allocator = CreateHugePageAllocator(
+          CreatePooledAllocator(CreateMallocAllocator()));
+      tfrt::outs() << "Choosing huge page allocator based on pooled malloc.\n";
+      break;
+    case HostAllocatorType::kRequestArena:
+      host_allocator = CreateMallocAllocator();
+      tfrt::outs() << "Choosing malloc with per-request arena.\n";
+      break;
+    case HostAllocatorType::kAllocationProfiler: {
+      auto profiler = CreateAllocationProfiler(CreateMallocAllocator());
+      allocation_profiler = profiler.get();
+      host_allocator = std::move(profiler);
+      tfrt::outs() << "Choosing allocation profiler based on malloc.\n";
+      break;
+    }
+  }
+  // Count the allocations of the requests of the load generator.
+  internal::LoadCountingAllocator* load_allocator = nullptr;
+  if (!run_config.load_function.empty()) {
+    auto allocator = std::make_unique<internal::LoadCountingAllocator>(
+        std::move(host_allocator));
+    load_allocator = allocator.get();
+    host_allocator = std::move(allocator);
   }
   tfrt::outs().flush();
 
@@ -204,8 +296,11 @@ int RunBefExecutor(
     }
   }
 
-  auto bef(BEFFile::Open(buffer_arr, host->GetKernelRegistry(),
-                         decoded_diagnostic_handler, host->allocator()));
+  auto bef(run_config.parallel_open
+               ? BEFFile::OpenParallel(buffer_arr, host->GetKernelRegistry(),
+                                       decoded_diagnostic_handler, host)
+               : BEFFile::Open(buffer_arr, host->GetKernelRegistry(),
+                               decoded_diagnostic_handler, host->allocator()));
 
   if (!bef) {
     return mlir::failed(source_mgr_handler.verify());
@@ -240,15 +335,77 @@ int RunBefExecutor(
                    run_config.print_error_code);
   }
 
-  // Loop over each of the functions, running each as a standalone testcase.
-  for (auto* fn : function_list) {
-    if (fn != test_init_function) {
-      RunBefFunction(host, *fn, create_execution_context,
-                     run_config.print_error_code);
+  if (run_config.warmup) {
+    BEFWarmUpInputs warmup_inputs;
+    for (auto* fn : function_list) {
+      if (fn != test_init_function && fn->argument_types().empty() &&
+          fn->function_kind() != FunctionKind::kSyncBEFFunction) {
+        warmup_inputs.Register(
+            fn->name(), [] { return std::vector<RCReference<AsyncValue>>(); });
+      }
+    }
+
+    // The warm-up runs use a plain execution context, so that they are not
+    // recorded in the profiles of the test cases.
+    ResourceContext resource_context;
+    auto req_ctx = RequestContextBuilder(host, &resource_context).build();
+    if (!req_ctx) {
+      llvm::errs() << req_ctx.takeError() << "\n";
+      return 1;
+    }
+    if (auto error = bef->WarmUp(ExecutionContext(std::move(*req_ctx)),
+                                 warmup_inputs, run_config.warmup_runs)) {
+      // Functions that are expected to fail end the warm-up early, which is
+      // not an error of the test.
+      llvm::errs() << run_config.program_name << ": warm-up stopped: " << error
+                   << "\n";
+    }
+    host->Quiesce();
+  }
+
+  if (!run_config.load_function.empty()) {
+    auto* fn = bef->GetFunction(run_config.load_function);
+    if (!fn) {
+      llvm::errs() << run_config.program_name << ": couldn't find function "
+                   << run_config.load_function << "\n";
+      return 1;
+    }
+    if (load_allocator != nullptr) load_allocator->ResetPeak();
+    if (int exit_code = internal::RunLoad(run_config, host, *fn,
+                                          load_allocator,
+                                          create_execution_context))
+      return exit_code;
+  } else {
+    // Loop over each of the functions, running each as a standalone testcase.
+    for (auto* fn : function_list) {
+      if (fn != test_init_function) {
+        RunBefFunction(host, *fn, create_execution_context,
+                       run_config.print_error_code);
+      }
     }
   }
 
   bef.reset();
+
+  if (allocation_profiler != nullptr) {
+    tfrt::outs() << "Allocation profile:\n";
+    allocation_profiler->Print(tfrt::outs());
+    tfrt::outs().flush();
+    if (!run_config.allocation_profile_filename.empty()) {
+      std::error_code error_code;
+      llvm::raw_fd_ostream os(run_config.allocation_profile_filename,
+                              error_code, llvm::sys::fs::OF_None);
+      if (error_code) {
+        llvm::errs() << run_config.program_name
+                     << ": couldn't write allocation profile to "
+                     << run_config.allocation_profile_filename << ": "
+                     << error_code.message() << "\n";
+        return 1;
+      }
+      allocation_profiler->WritePprofProfile(os);
+    }
+  }
+
   // Verify the diagnostic handler to make sure that each of the diagnostics
   // matched.
   return mlir::failed(source_mgr_handler.verify());
@@ -0,0 +1,350 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//===- load_generator.cc - Load generation mode of the bef_executor -------===//
+//
+// This file implements the load generation mode of the bef executor driver.
+//
+// In the closed loop mode every client thread runs one request at a time, and
+// starts the next one as soon as the previous one completes. In the open loop
+// mode requests arrive at a fixed rate regardless of how many are in flight,
+// and their latency is measured from their scheduled arrival, so that a slow
+// request does not hide the queueing delay of the requests behind it.
+
+#include "load_generator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/Format.h"
+#include "llvm_derived/Support/raw_ostream.h"
+#include "tfrt/host_context/async_dispatch.h"
+#include "tfrt/host_context/async_value.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/host_context/resource_context.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/tensor/btf_mapped_file.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+namespace internal {
+
+void* LoadCountingAllocator::AllocateBytes(size_t size, size_t alignment) {
+  num_allocations_.fetch_add(1, std::memory_order_relaxed);
+  bytes_allocated_.fetch_add(size, std::memory_order_relaxed);
+  const int64_t live =
+      live_bytes_.fetch_add(size, std::memory_order_relaxed) + size;
+  int64_t peak = peak_live_bytes_.load(std::memory_order_relaxed);
+  // Note that compare_exchange_weak updates `peak` on failure.
+  while (peak < live && !peak_live_bytes_.compare_exchange_weak(
+                            peak, live, std::memory_order_relaxed)) {
+  }
+  return allocator_->AllocateBytes(size, alignment);
+}
+
+void LoadCountingAllocator::DeallocateBytes(void* ptr, size_t size) {
+  live_bytes_.fetch_sub(size, std::memory_order_relaxed);
+  allocator_->DeallocateBytes(ptr, size);
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// The arguments of one request.
+struct RequestArguments {
+  std::vector<RCReference<AsyncValue>> values;
+  std::vector<AsyncValue*> pointers;
+};
+
+// Returns the groups of arguments that the requests cycle through. Tensor
+// arguments are read from the BTF file, and chain arguments are ready chains.
+llvm::Expected<std::vector<RequestArguments>> ReadRequestArguments(
+    const RunBefConfig& run_config, HostContext* host,
+    const Function& function) {
+  const auto argument_types = function.argument_types();
+  size_t num_tensors_per_request = 0;
+  for (const auto& type : argument_types) {
+    if (type.GetName() == "!t.tensor") {
+      ++num_tensors_per_request;
+    } else if (type.GetName() != "!tfrt.chain") {
+      return MakeStringError("unsupported argument type ", type.GetName(),
+                             " of '", function.name(), "'");
+    }
+  }
+
+  RCReference<MappedBTFFile> file;
+  size_t num_requests = 1;
+  if (num_tensors_per_request > 0) {
+    if (run_config.load_inputs_filename.empty())
+      return MakeStringError("'", function.name(),
+                             "' takes tensors, which need --load_inputs");
+    auto opened = MappedBTFFile::Open(run_config.load_inputs_filename);
+    if (!opened) return opened.takeError();
+    file = std::move(*opened);
+    if (file->num_tensors() == 0 ||
+        file->num_tensors() % num_tensors_per_request != 0)
+      return MakeStringError(run_config.load_inputs_filename, " has ",
+                             file->num_tensors(), " tensors, which is not a ",
+                             "multiple of the ", num_tensors_per_request,
+                             " tensor arguments of '", function.name(), "'");
+    num_requests = file->num_tensors() / num_tensors_per_request;
+  }
+
+  std::vector<RequestArguments> requests(num_requests);
+  size_t next_tensor = 0;
+  for (auto& request : requests) {
+    for (const auto& type : argument_types) {
+      if (type.GetName() == "!tfrt.chain") {
+        request.values.push_back(GetReadyChain().ReleaseRCRef());
+        continue;
+      }
+      auto tensor = file->GetDenseHostTensor(next_tensor++, host);
+      if (!tensor) return tensor.takeError();
+      request.values.push_back(
+          MakeAvailableAsyncValueRef<DenseHostTensor>(std::move(*tensor))
+              .ReleaseRCRef());
+    }
+    for (auto& value : request.values) request.pointers.push_back(value.get());
+  }
+  return std::move(requests);
+}
+
+// Collects the latencies and the errors of the completed requests.
+class LoadRecorder {
+ public:
+  void Record(Clock::duration latency, bool failed) {
+    mutex_lock lock(mu_);
+    latencies_us_.push_back(
+        std::chrono::duration<double, std::micro>(latency).count());
+    if (failed) ++num_errors_;
+    --num_in_flight_;
+    if (num_in_flight_ == 0) in_flight_cv_.notify_all();
+  }
+
+  void Start() {
+    mutex_lock lock(mu_);
+    ++num_in_flight_;
+  }
+
+  // Blocks until all started requests have been recorded.
+  void AwaitInFlight() {
+    mutex_lock lock(mu_);
+    in_flight_cv_.wait(lock, [&] { return num_in_flight_ == 0; });
+  }
+
+  // Must be called once all requests are recorded.
+  void Print(raw_ostream& os, double wall_seconds,
+             const LoadCountingAllocator* allocator,
+             int64_t allocations_before, int64_t bytes_before) {
+    mutex_lock lock(mu_);
+    const size_t num_requests = latencies_us_.size();
+    os << "requests: " << num_requests << " (" << num_errors_ << " errors)\n";
+    os << "throughput: "
+       << llvm::format("%.1f", num_requests / wall_seconds)
+       << " requests/s\n";
+    if (num_requests > 0) {
+      std::sort(latencies_us_.begin(), latencies_us_.end());
+      auto percentile = [&](double p) {
+        return latencies_us_[static_cast<size_t>(p * (num_requests - 1))];
+      };
+      double sum = 0;
+      for (double latency : latencies_us_) sum += latency;
+      os << "latency (us): mean " << llvm::format("%.1f", sum / num_requests)
+         << " p50 " << llvm::format("%.1f", percentile(0.5)) << " p90 "
+         << llvm::format("%.1f", percentile(0.9)) << " p99 "
+         << llvm::format("%.1f", percentile(0.99)) << " p99.9 "
+         << llvm::format("%.1f", percentile(0.999)) << " max "
+         << llvm::format("%.1f", latencies_us_.back()) << "\n";
+    }
+    if (allocator != nullptr && num_requests > 0) {
+      const double requests = num_requests;
+      os << "allocations: "
+         << llvm::format("%.1f", (allocator->num_allocations() -
+                                  allocations_before) /
+                                     requests)
+         << " per request, "
+         << llvm::format("%.0f",
+                         (allocator->bytes_allocated() - bytes_before) /
+                             requests)
+         << " bytes per request, " << allocator->peak_live_bytes()
+         << " peak live bytes\n";
+    }
+  }
+
+ private:
+  mutex mu_;
+  condition_variable in_flight_cv_;
+  std::vector<double> latencies_us_ TFRT_GUARDED_BY(mu_);
+  int64_t num_errors_ TFRT_GUARDED_BY(mu_) = 0;
+  int64_t num_in_flight_ TFRT_GUARDED_BY(mu_) = 0;
+};
+
+bool HasError(ArrayRef<RCReference<AsyncValue>> results) {
+  return llvm::any_of(results, [](const RCReference<AsyncValue>& result) {
+    return result->IsError();
+  });
+}
+
+// Runs `num_clients` threads that each run one request at a time until
+// `deadline`.
+void RunClosedLoop(
+    HostContext* host, const Function& function,
+    ArrayRef<RequestArguments> requests, ResourceContext* resource_context,
+    const std::function<llvm::Expected<ExecutionContext>(
+        HostContext*, ResourceContext*)>& create_execution_context,
+    int num_clients, Clock::time_point deadline, LoadRecorder* recorder) {
+  std::atomic<size_t> next_request{0};
+  auto client = [&]() {
+    std::vector<RCReference<AsyncValue>> results(
+        function.result_types().size());
+    while (Clock::now() < deadline) {
+      const auto& arguments =
+          requests[next_request.fetch_add(1) % requests.size()];
+      auto exec_ctx = create_execution_context(host, resource_context);
+      if (!exec_ctx) {
+        llvm::errs() << exec_ctx.takeError() << "\n";
+        return;
+      }
+      recorder->Start();
+      const auto start = Clock::now();
+      function.Execute(*exec_ctx, arguments.pointers, results);
+      host->Await(results);
+      recorder->Record(Clock::now() - start, HasError(results));
+      for (auto& result : results) result.reset();
+    }
+  };
+
+  std::vector<std::thread> clients;
+  for (int i = 0; i < num_clients; ++i) clients.emplace_back(client);
+  for (auto& thread : clients) thread.join();
+}
+
+// Starts requests at `rate` requests per second until `deadline`, each one
+// from a task of the work queue, and waits for all of them to complete.
+void RunOpenLoop(
+    HostContext* host, const Function& function,
+    ArrayRef<RequestArguments> requests, ResourceContext* resource_context,
+    const std::function<llvm::Expected<ExecutionContext>(
+        HostContext*, ResourceContext*)>& create_execution_context,
+    double rate, Clock::time_point start, Clock::time_point deadline,
+    LoadRecorder* recorder) {
+  const auto period = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(1.0 / rate));
+  size_t index = 0;
+  for (auto arrival = start; arrival < deadline; arrival += period, ++index) {
+    std::this_thread::sleep_until(arrival);
+    auto exec_ctx = create_execution_context(host, resource_context);
+    if (!exec_ctx) {
+      llvm::errs() << exec_ctx.takeError() << "\n";
+      break;
+    }
+    const RequestArguments* arguments = &requests[index % requests.size()];
+    recorder->Start();
+    EnqueueWork(*exec_ctx, [&function, arguments, arrival, recorder,
+                            exec_ctx = std::move(*exec_ctx)]() mutable {
+      auto results = std::make_shared<std::vector<RCReference<AsyncValue>>>(
+          function.result_types().size());
+      function.Execute(exec_ctx, arguments->pointers, *results);
+      RunWhenReady(*results, [results, arrival, recorder,
+                              exec_ctx = std::move(exec_ctx)]() {
+        recorder->Record(Clock::now() - arrival, HasError(*results));
+      });
+    });
+  }
+  recorder->AwaitInFlight();
+}
+
+}  // namespace
+
+int RunLoad(const RunBefConfig& run_config, HostContext* host,
+            const Function& function, const LoadCountingAllocator* allocator,
+            const std::function<llvm::Expected<ExecutionContext>(
+                HostContext*, ResourceContext*)>& create_execution_context) {
+  if (function.function_kind() == FunctionKind::kSyncBEFFunction) {
+    llvm::errs() << run_config.program_name << ": can't generate load with "
+                 << "the sync function '" << function.name() << "'\n";
+    return 1;
+  }
+  if (run_config.load_clients <= 0 || run_config.load_rate < 0 ||
+      run_config.load_duration_seconds <= 0) {
+    llvm::errs() << run_config.program_name
+                 << ": --load_clients and --load_duration_s must be positive,"
+                 << " and --load_rate must not be negative\n";
+    return 1;
+  }
+
+  auto requests = ReadRequestArguments(run_config, host, function);
+  if (!requests) {
+    llvm::errs() << run_config.program_name << ": "
+                 << requests.takeError() << "\n";
+    return 1;
+  }
+
+  tfrt::outs() << "--- Generating load with '" << function.name() << "': ";
+  if (run_config.load_rate > 0) {
+    tfrt::outs() << run_config.load_rate << " requests/s";
+  } else {
+    tfrt::outs() << run_config.load_clients << " clients";
+  }
+  tfrt::outs() << " for " << run_config.load_duration_seconds << " s, "
+               << requests->size() << " distinct inputs, "
+               << host->work_queue().name() << " work queue with "
+               << host->GetNumWorkerThreads() << " threads\n";
+  tfrt::outs().flush();
+
+  // The resource context is shared by all requests, as in a server.
+  ResourceContext resource_context;
+  LoadRecorder recorder;
+  const int64_t allocations_before =
+      allocator ? allocator->num_allocations() : 0;
+  const int64_t bytes_before = allocator ? allocator->bytes_allocated() : 0;
+
+  const auto start = Clock::now();
+  const auto deadline =
+      start + std::chrono::duration_cast<Clock::duration>(
+                  std::chrono::duration<double>(
+                      run_config.load_duration_seconds));
+  if (run_config.load_rate > 0) {
+    RunOpenLoop(host, function, *requests, &resource_context,
+                create_execution_context, run_config.load_rate, start,
+                deadline, &recorder);
+  } else {
+    RunClosedLoop(host, function, *requests, &resource_context,
+                  create_execution_context, run_config.load_clients, deadline,
+                  &recorder);
+  }
+  const double wall_seconds =
+      std::chrono::duration<double>(Clock::now() - start).count();
+  host->Quiesce();
+
+  recorder.Print(tfrt::outs(), wall_seconds, allocator, allocations_before,
+                 bytes_before);
+  tfrt::outs().flush();
+  return 0;
+}
+
+}  // namespace internal
+}  // namespace tfrt
@@ -0,0 +1,87 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//===- load_generator.h - Load generation mode of the bef_executor --------===//
+//
+// This file declares the load generation mode of the bef executor driver,
+// which replays a function concurrently for a fixed duration and reports its
+// throughput, latency and allocations.
+
+#ifndef TFRT_LIB_BEF_EXECUTOR_DRIVER_LOAD_GENERATOR_H_
+#define TFRT_LIB_BEF_EXECUTOR_DRIVER_LOAD_GENERATOR_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "tfrt/bef_executor_driver/bef_executor_driver.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/function.h"
+#include "tfrt/host_context/host_allocator.h"
+
+namespace tfrt {
+namespace internal {
+
+// Forwards to another allocator and counts the allocations, so that the load
+// generator can report the allocations per request. The counters are relaxed
+// atomics shared by all threads.
+class LoadCountingAllocator : public HostAllocator {
+ public:
+  explicit LoadCountingAllocator(std::unique_ptr<HostAllocator> allocator)
+      : allocator_(std::move(allocator)) {}
+
+  void* AllocateBytes(size_t size, size_t alignment) override;
+  void DeallocateBytes(void* ptr, size_t size) override;
+
+  int64_t num_allocations() const {
+    return num_allocations_.load(std::memory_order_relaxed);
+  }
+  int64_t bytes_allocated() const {
+    return bytes_allocated_.load(std::memory_order_relaxed);
+  }
+  int64_t peak_live_bytes() const {
+    return peak_live_bytes_.load(std::memory_order_relaxed);
+  }
+
+  // Resets the peak to the bytes currently live, e.g. after the warm-up.
+  void ResetPeak() {
+    peak_live_bytes_.store(live_bytes_.load(std::memory_order_relaxed),
+                           std::memory_order_relaxed);
+  }
+
+ private:
+  std::unique_ptr<HostAllocator> allocator_;
+  std::atomic<int64_t> num_allocations_{0};
+  std::atomic<int64_t> bytes_allocated_{0};
+  std::atomic<int64_t> live_bytes_{0};
+  std::atomic<int64_t> peak_live_bytes_{0};
+};
+
+// Replays `function` as configured by the load_* fields of `run_config`, and
+// prints the report to tfrt::outs(). The arguments of the function are read
+// from the BTF file `run_config.load_inputs_filename`: every request takes the
+// next group of tensors, one per argument, and wraps around at the end of the
+// file. `allocator`, if not null, is the HostContext allocator. Returns the
+// exit code of the driver.
+int RunLoad(const RunBefConfig& run_config, HostContext* host,
+            const Function& function, const LoadCountingAllocator* allocator,
+            const std::function<llvm::Expected<ExecutionContext>(
+                HostContext*, ResourceContext*)>& create_execution_context);
+
+}  // namespace internal
+}  // namespace tfrt
+
+#endif  // TFRT_LIB_BEF_EXECUTOR_DRIVER_LOAD_GENERATOR_H_
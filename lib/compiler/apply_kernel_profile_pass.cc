@@ -0,0 +1,96 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// This implements ApplyKernelProfilePass that feeds the kernel wall times
+// recorded by bef_executor back to StreamAnalysis.
+
+#include <memory>
+#include <string>
+
+#include "llvm/Support/MemoryBuffer.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/Pass/Pass.h"
+#include "tfrt/compiler/profile_cost_model.h"
+
+namespace tfrt {
+namespace compiler {
+namespace {
+
+// Attach the measured cost of each profiled operation as the `_tfrt_cost`
+// attribute, which StreamAnalysis prefers over the static cost of the op, and
+// set the module-level `tfrt.cost_threshold` from the profile unless it is
+// already set. The streams are then re-partitioned by MLIRToBEF.
+class ApplyKernelProfilePass
+    : public mlir::PassWrapper<ApplyKernelProfilePass,
+                               mlir::OperationPass<mlir::ModuleOp>> {
+ public:
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(ApplyKernelProfilePass)
+
+  ApplyKernelProfilePass() = default;
+  ApplyKernelProfilePass(const ApplyKernelProfilePass& other)
+      : PassWrapper(other) {}
+
+  llvm::StringRef getArgument() const final {
+    return "tfrt-apply-kernel-profile";
+  }
+
+  llvm::StringRef getDescription() const final {
+    return "Annotate operations with the costs measured by bef_executor "
+           "--kernel_profile";
+  }
+
+  void runOnOperation() override {
+    auto module = getOperation();
+
+    auto buffer = llvm::MemoryBuffer::getFile(profile_);
+    if (!buffer) {
+      module.emitError("cannot open kernel profile '")
+          << profile_ << "': " << buffer.getError().message();
+      return signalPassFailure();
+    }
+
+    auto cost_model = ProfileCostModel::Parse((*buffer)->getBuffer());
+    if (!cost_model) {
+      module.emitError(llvm::toString(cost_model.takeError()));
+      return signalPassFailure();
+    }
+
+    mlir::Builder builder(module.getContext());
+    module.walk([&](mlir::Operation* op) {
+      if (auto cost = cost_model->GetOperationCost(op))
+        op->setAttr("_tfrt_cost", builder.getI64IntegerAttr(*cost));
+    });
+
+    if (!module->hasAttr("tfrt.cost_threshold")) {
+      if (auto threshold = cost_model->GetCostThreshold())
+        module->setAttr("tfrt.cost_threshold",
+                        builder.getI64IntegerAttr(*threshold));
+    }
+  }
+
+ private:
+  Option<std::string> profile_{
+      *this, "profile",
+      llvm::cl::desc("The kernel profile written by bef_executor")};
+};
+
+static mlir::PassRegistration<ApplyKernelProfilePass> apply_kernel_profile;
+
+}  // namespace
+}  // namespace compiler
+}  // namespace tfrt
@@ -0,0 +1,188 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This implements BatchExecuteOpSeqPass that merges chains of
+// corert.executeop.seq on the same op handler into corert.executeop.seq_batch.
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinAttributes.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/Pass/Pass.h"
+#include "tfrt/core_runtime/opdefs/core_runtime.h"
+
+namespace tfrt {
+namespace compiler {
+namespace {
+
+using SeqChain = llvm::SmallVector<corert::ExecuteOpSeq, 4>;
+
+// BatchExecuteOpSeqPass finds chains of corert.executeop.seq in which every op
+// but the first one runs on the same op handler after the out_op_chain of the
+// previous one, and that out_op_chain has no other uses:
+//
+//   %ch1 = corert.executeop.seq(%cpu, %ch0) "tfrt_test.print"(%a) : 0
+//   %ch2, %b = corert.executeop.seq(%cpu, %ch1) "tfrt_test.add"(%a, %a) : 1
+//
+// and replaces each chain by one corert.executeop.seq_batch, which runs the
+// ops back to back in one kernel and produces the out_op_chain of the last op:
+//
+//   %ch2, %b = corert.executeop.seq_batch(%cpu, %ch0) (%a, %a, %a)
+//     {op_attrs = [[], []], op_func_attrs = [[], []],
+//      op_names = ["tfrt_test.print", "tfrt_test.add"],
+//      op_num_args = [1 : i32, 2 : i32], op_num_results = [0 : i32, 1 : i32]}
+//     : 1
+//
+// The ops are sequenced in the same order, so their side effects are too. The
+// arguments of every op in a chain must also be arguments of its first op, so
+// batching never delays an op on a value its first op did not already wait
+// for. Results of earlier ops in the chain are not accepted either, since the
+// batch consumes its arguments before any of its ops runs.
+class BatchExecuteOpSeqPass
+    : public mlir::PassWrapper<BatchExecuteOpSeqPass,
+                               mlir::OperationPass<mlir::ModuleOp>> {
+ public:
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(BatchExecuteOpSeqPass)
+
+  BatchExecuteOpSeqPass() = default;
+  BatchExecuteOpSeqPass(const BatchExecuteOpSeqPass& other)
+      : PassWrapper(other) {}
+
+  llvm::StringRef getArgument() const final {
+    return "tfrt-batch-execute-op-seq";
+  }
+
+  llvm::StringRef getDescription() const final {
+    return "Batch chains of corert.executeop.seq on the same op handler into "
+           "corert.executeop.seq_batch";
+  }
+
+  void runOnOperation() override {
+    llvm::SmallVector<mlir::Block*, 8> blocks;
+    getOperation().walk([&](mlir::Block* block) { blocks.push_back(block); });
+
+    for (auto* block : blocks) {
+      for (auto& chain : FindChains(*block)) {
+        if (chain.size() < static_cast<size_t>(min_ops_)) continue;
+        BatchChain(chain);
+      }
+    }
+  }
+
+ private:
+  // Return the op that extends `chain`, whose last op is `tail`, or null.
+  static corert::ExecuteOpSeq GetNextInChain(const SeqChain& chain,
+                                             corert::ExecuteOpSeq tail) {
+    mlir::Value op_chain = tail.getOutOpChain();
+    if (!op_chain.hasOneUse()) return nullptr;
+
+    auto next =
+        llvm::dyn_cast<corert::ExecuteOpSeq>(*op_chain.getUsers().begin());
+    if (!next || next->getBlock() != tail->getBlock() ||
+        next.getInOpChain() != op_chain)
+      return nullptr;
+
+    corert::ExecuteOpSeq head = chain.front();
+    if (next.getOpHandler() != head.getOpHandler()) return nullptr;
+
+    // Values defined before the head are not necessarily ready when it runs,
+    // so only the ones the head already waits for are accepted.
+    bool used_by_head =
+        llvm::all_of(next.getArguments(), [&](mlir::Value argument) {
+          return llvm::is_contained(head.getArguments(), argument);
+        });
+    if (!used_by_head) return nullptr;
+    return next;
+  }
+
+  static llvm::SmallVector<SeqChain, 4> FindChains(mlir::Block& block) {
+    llvm::SmallVector<SeqChain, 4> chains;
+    llvm::SmallPtrSet<mlir::Operation*, 16> chained_ops;
+
+    for (auto& op : block) {
+      auto head = llvm::dyn_cast<corert::ExecuteOpSeq>(&op);
+      if (!head || chained_ops.contains(head)) continue;
+
+      SeqChain chain{head};
+      while (auto next = GetNextInChain(chain, chain.back())) {
+        chain.push_back(next);
+        chained_ops.insert(next);
+      }
+      chains.push_back(std::move(chain));
+    }
+
+    return chains;
+  }
+
+  static void BatchChain(const SeqChain& chain) {
+    corert::ExecuteOpSeq head = chain.front();
+    auto* context = head->getContext();
+    mlir::OpBuilder builder(head);
+
+    llvm::SmallVector<mlir::Value, 8> arguments;
+    llvm::SmallVector<mlir::Type, 4> result_types;
+    llvm::SmallVector<mlir::Attribute, 4> op_attrs;
+    llvm::SmallVector<mlir::Attribute, 4> op_func_attrs;
+    llvm::SmallVector<mlir::Attribute, 4> op_names;
+    llvm::SmallVector<int32_t, 4> op_num_args;
+    llvm::SmallVector<int32_t, 4> op_num_results;
+    llvm::SmallVector<mlir::Location, 4> locations;
+    for (auto op : chain) {
+      arguments.append(op.getArguments().begin(), op.getArguments().end());
+      auto types = op.getResults().getTypes();
+      result_types.append(types.begin(), types.end());
+      op_attrs.push_back(op.getOpAttrs());
+      op_func_attrs.push_back(op.getOpFuncAttrs());
+      op_names.push_back(op.getOpNameAttr());
+      op_num_args.push_back(op.getArguments().size());
+      op_num_results.push_back(op.getResults().size());
+      locations.push_back(op->getLoc());
+    }
+
+    auto batch = builder.create<corert::ExecuteOpSeqBatch>(
+        mlir::FusedLoc::get(context, locations),
+        chain.back().getOutOpChain().getType(), result_types,
+        head.getOpHandler(), head.getInOpChain(), arguments,
+        builder.getArrayAttr(op_attrs), builder.getArrayAttr(op_func_attrs),
+        builder.getArrayAttr(op_names), builder.getI32ArrayAttr(op_num_args),
+        builder.getI32ArrayAttr(op_num_results));
+
+    // The out_op_chain of every op but the last one is only used by the next
+    // op, so it goes away with the ops.
+    chain.back().getOutOpChain().replaceAllUsesWith(batch.getOutOpChain());
+    auto batch_results = batch.getResults();
+    for (auto op : chain) {
+      size_t num_results = op.getResults().size();
+      op.getResults().replaceAllUsesWith(
+          batch_results.take_front(num_results));
+      batch_results = batch_results.drop_front(num_results);
+    }
+    for (auto op : llvm::reverse(chain)) op->erase();
+  }
+
+  Option<int> min_ops_{
+      *this, "min-ops",
+      llvm::cl::desc("The minimum number of corert.executeop.seq in a batch"),
+      llvm::cl::init(2)};
+};
+
+static mlir::PassRegistration<BatchExecuteOpSeqPass> batch_execute_op_seq;
+
+}  // namespace
+}  // namespace compiler
+}  // namespace tfrt
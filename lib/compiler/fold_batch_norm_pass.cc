@@ -0,0 +1,218 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This implements FoldBatchNormPass that folds constant batch normalization
+// parameters of fused Conv2D kernels into the convolution filter.
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/IRMapping.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/Pass/Pass.h"
+#include "tfrt/basic_kernels/opdefs/basic_kernels.h"
+
+namespace tfrt {
+namespace compiler {
+namespace {
+
+// The fused Conv2D + BatchNorm kernels, and the Conv2D + bias kernels that
+// replace them.
+struct FusedConv2DKernel {
+  llvm::StringLiteral batch_norm;
+  llvm::StringLiteral bias;
+};
+
+constexpr FusedConv2DKernel kFusedConv2DKernels[] = {
+    {"eigen.conv2d.batch_norm.f32", "eigen.conv2d.bias.f32"},
+    {"eigen.conv2d.batch_norm.relu.f32", "eigen.conv2d.bias.relu.f32"},
+};
+
+constexpr llvm::StringLiteral kFoldBatchNormKernel =
+    "eigen.fold_batch_norm.f32";
+
+// The operands of the fused Conv2D + BatchNorm kernels:
+//   (input, filter, scale, offset, mean, variance, output, chain)
+constexpr unsigned kNumBatchNormOperands = 8;
+constexpr unsigned kFilterOperand = 1;
+constexpr unsigned kNumFoldedOperands = 5;  // filter, scale, offset, mean, var
+constexpr unsigned kOutputOperand = 6;
+constexpr unsigned kChainOperand = 7;
+
+// FoldBatchNormPass rewrites every fused Conv2D + BatchNorm kernel whose
+// filter and batch normalization parameters are constants, i.e. computed by
+// kernels that do not depend on the function arguments, into a Conv2D + bias
+// kernel:
+//
+//   %ch = "eigen.conv2d.batch_norm.f32"(%input, %filter, %scale, %offset,
+//           %mean, %variance, %output, %ch0) {epsilon = ..., ...}
+//
+// becomes
+//
+//   %folded_filter, %bias, %ch1 = tfrt.once @f_fold_batch_norm_0()
+//   %ch = "eigen.conv2d.bias.f32"(%input, %folded_filter, %bias, %output,
+//           %ch1) {...}
+//
+// where @f_fold_batch_norm_0 computes the constants and folds them with
+// "eigen.fold_batch_norm.f32". tfrt.once runs it on the first execution only,
+// so the normalization math is not repeated on every call. The kernels that
+// computed the constants are removed if nothing else uses them, i.e. they also
+// run only once.
+//
+// The chain operand of the kernel must be a constant as well, so the folded
+// kernel is ordered after everything the original kernel was ordered after.
+class FoldBatchNormPass
+    : public mlir::PassWrapper<FoldBatchNormPass,
+                               mlir::OperationPass<mlir::ModuleOp>> {
+ public:
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(FoldBatchNormPass)
+
+  llvm::StringRef getArgument() const final {
+    return "tfrt-fold-batch-norm";
+  }
+
+  llvm::StringRef getDescription() const final {
+    return "Fold constant batch normalization parameters of fused Conv2D "
+           "kernels into the filter";
+  }
+
+  void runOnOperation() override {
+    auto module = getOperation();
+    mlir::SymbolTable symbol_table(module);
+
+    llvm::SmallVector<mlir::func::FuncOp, 4> funcs(
+        module.getOps<mlir::func::FuncOp>());
+    for (auto func : funcs) {
+      if (func.isExternal()) continue;
+
+      llvm::SmallVector<std::pair<mlir::Operation*, llvm::StringRef>, 4>
+          kernels;
+      for (auto& op : func.front()) {
+        if (op.getNumOperands() != kNumBatchNormOperands) continue;
+        for (const auto& kernel : kFusedConv2DKernels) {
+          if (op.getName().getStringRef() == kernel.batch_norm)
+            kernels.emplace_back(&op, kernel.bias);
+        }
+      }
+
+      int folded_count = 0;
+      for (auto& kernel : kernels) {
+        if (Fold(func, kernel.first, kernel.second, folded_count,
+                 symbol_table))
+          ++folded_count;
+      }
+    }
+  }
+
+ private:
+  // Collects the kernels that `values` are computed by into `slice`, in block
+  // order. Returns false if any of the values depends on a block argument.
+  static bool GetConstantSlice(mlir::ValueRange values,
+                               llvm::SmallVectorImpl<mlir::Operation*>& slice) {
+    llvm::SmallPtrSet<mlir::Operation*, 8> visited;
+    llvm::SmallVector<mlir::Value, 8> worklist(values.begin(), values.end());
+    while (!worklist.empty()) {
+      mlir::Value value = worklist.pop_back_val();
+      mlir::Operation* def = value.getDefiningOp();
+      if (def == nullptr || def->getNumRegions() != 0) return false;
+      if (!visited.insert(def).second) continue;
+      slice.push_back(def);
+      worklist.append(def->operand_begin(), def->operand_end());
+    }
+
+    llvm::sort(slice, [](mlir::Operation* a, mlir::Operation* b) {
+      return a->isBeforeInBlock(b);
+    });
+    return true;
+  }
+
+  // Returns true if `kernel` was rewritten.
+  static bool Fold(mlir::func::FuncOp func, mlir::Operation* kernel,
+                   llvm::StringRef bias_kernel, int index,
+                   mlir::SymbolTable& symbol_table) {
+    auto* context = func.getContext();
+    auto epsilon = kernel->getAttr("epsilon");
+    if (!epsilon) return false;
+
+    llvm::SmallVector<mlir::Value, kNumFoldedOperands + 1> constants(
+        kernel->getOperands().slice(kFilterOperand, kNumFoldedOperands));
+    constants.push_back(kernel->getOperand(kChainOperand));
+
+    llvm::SmallVector<mlir::Operation*, 8> slice;
+    if (!GetConstantSlice(constants, slice)) return false;
+
+    // Create the function that computes the folded filter and bias.
+    mlir::Type tensor_type = kernel->getOperand(kFilterOperand).getType();
+    mlir::Type chain_type = kernel->getOperand(kChainOperand).getType();
+    llvm::SmallVector<mlir::Type, 3> result_types = {tensor_type, tensor_type,
+                                                      chain_type};
+    auto fold_func = mlir::func::FuncOp::create(
+        kernel->getLoc(),
+        (func.getSymName() + "_fold_batch_norm_" + llvm::Twine(index)).str(),
+        mlir::FunctionType::get(context, {}, result_types));
+    fold_func.setPrivate();
+    symbol_table.insert(fold_func);
+
+    mlir::Block* body = fold_func.addEntryBlock();
+    auto body_builder = mlir::OpBuilder::atBlockEnd(body);
+    mlir::IRMapping mapping;
+    for (auto* op : slice) body_builder.clone(*op, mapping);
+
+    mlir::OperationState fold_state(kernel->getLoc(), kFoldBatchNormKernel);
+    for (mlir::Value value : constants)
+      fold_state.addOperands(mapping.lookup(value));
+    fold_state.addTypes(result_types);
+    fold_state.addAttribute("epsilon", epsilon);
+    mlir::Operation* fold = body_builder.create(fold_state);
+    body_builder.create<ReturnOp>(kernel->getLoc(), fold->getResults());
+
+    // Replace the kernel with Conv2D + bias on the folded values.
+    mlir::OpBuilder builder(kernel);
+    auto once = builder.create<OnceOp>(kernel->getLoc(), result_types,
+                                       mlir::ValueRange(),
+                                       mlir::SymbolRefAttr::get(fold_func));
+
+    mlir::OperationState bias_state(kernel->getLoc(), bias_kernel);
+    bias_state.addOperands({kernel->getOperand(0), once.getResult(0),
+                            once.getResult(1),
+                            kernel->getOperand(kOutputOperand),
+                            once.getResult(2)});
+    bias_state.addTypes(kernel->getResultTypes());
+    for (auto attr : kernel->getAttrs()) {
+      if (attr.getName() != "epsilon")
+        bias_state.addAttribute(attr.getName(), attr.getValue());
+    }
+    mlir::Operation* conv = builder.create(bias_state);
+    kernel->replaceAllUsesWith(conv->getResults());
+    kernel->erase();
+
+    // The constants are computed by the fold function now.
+    for (auto* op : llvm::reverse(slice))
+      if (op->use_empty()) op->erase();
+
+    return true;
+  }
+};
+
+static mlir::PassRegistration<FoldBatchNormPass> fold_batch_norm;
+
+}  // namespace
+}  // namespace compiler
+}  // namespace tfrt
@@ -0,0 +1,217 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// This implements FuseKernelsPass that merges straight-line sequences of
+// kernels into a single compound kernel.
+
+#include <string>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringSet.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/IRMapping.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/Pass/Pass.h"
+#include "tfrt/basic_kernels/opdefs/basic_kernels.h"
+
+namespace tfrt {
+namespace compiler {
+namespace {
+
+using KernelChain = llvm::SmallVector<mlir::Operation*, 4>;
+
+// FuseKernelsPass finds chains of kernels in which every kernel but the last
+// one is only used by the next kernel, and outlines each chain into a function
+// marked `tfrt.fused` that is invoked by one `tfrt.call`. BEFExecutor runs the
+// kernels of a fused function back to back in one KernelFrame, without
+// scheduling each of them and without publishing their intermediate results to
+// the registers of the caller.
+//
+// Every other operand of a kernel in a chain must be defined before the chain
+// starts, so fusion never delays a kernel on a value it did not already wait
+// for transitively.
+class FuseKernelsPass
+    : public mlir::PassWrapper<FuseKernelsPass,
+                               mlir::OperationPass<mlir::ModuleOp>> {
+ public:
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(FuseKernelsPass)
+
+  FuseKernelsPass() = default;
+  FuseKernelsPass(const FuseKernelsPass& other) : PassWrapper(other) {}
+
+  llvm::StringRef getArgument() const final { return "tfrt-fuse-kernels"; }
+
+  llvm::StringRef getDescription() const final {
+    return "Fuse straight-line sequences of kernels into compound kernels";
+  }
+
+  void runOnOperation() override {
+    auto module = getOperation();
+
+    dialects_set_.clear();
+    if (dialects_.empty()) {
+      dialects_set_.insert("tfrt_dht");
+      dialects_set_.insert("corert");
+    } else {
+      for (const auto& dialect : dialects_) dialects_set_.insert(dialect);
+    }
+
+    mlir::SymbolTable symbol_table(module);
+
+    llvm::SmallVector<mlir::func::FuncOp, 4> funcs(
+        module.getOps<mlir::func::FuncOp>());
+    for (auto func : funcs) {
+      if (func.isExternal() || func->hasAttr("tfrt.sync") ||
+          func->hasAttr("tfrt.fused"))
+        continue;
+
+      int fused_count = 0;
+      for (auto& chain : FindChains(func.front())) {
+        if (chain.size() < static_cast<size_t>(min_kernels_)) continue;
+        OutlineChain(func, chain, fused_count++, symbol_table);
+      }
+    }
+  }
+
+ private:
+  bool IsFusible(mlir::Operation* op) const {
+    if (op->getNumRegions() != 0) return false;
+    if (op->hasTrait<mlir::OpTrait::IsTerminator>()) return false;
+    // Fused kernels are not run by the executor, which enforces timeouts.
+    if (op->hasAttr("_tfrt_timeout_ms")) return false;
+    return dialects_set_.contains(op->getName().getDialectNamespace());
+  }
+
+  // Return true if `op` can be appended to `chain`, whose last kernel is
+  // `tail`.
+  static bool CanExtendChain(const KernelChain& chain, mlir::Operation* tail,
+                             mlir::Operation* op) {
+    // The results of `tail` must not be used by anything else, otherwise they
+    // have to be published anyway.
+    if (!llvm::all_of(tail->getUsers(),
+                      [&](mlir::Operation* user) { return user == op; }))
+      return false;
+
+    mlir::Operation* head = chain.front();
+    return llvm::all_of(op->getOperands(), [&](mlir::Value operand) {
+      auto* def = operand.getDefiningOp();
+      return def == nullptr || def == tail || def->isBeforeInBlock(head);
+    });
+  }
+
+  llvm::SmallVector<KernelChain, 4> FindChains(mlir::Block& block) const {
+    llvm::SmallVector<KernelChain, 4> chains;
+    // The index in `chains` of the chain that ends with the key.
+    llvm::DenseMap<mlir::Operation*, size_t> tails;
+
+    for (auto& op : block) {
+      if (!IsFusible(&op)) continue;
+
+      size_t chain_id = chains.size();
+      for (mlir::Value operand : op.getOperands()) {
+        auto* def = operand.getDefiningOp();
+        auto iter = tails.find(def);
+        if (iter == tails.end()) continue;
+        if (CanExtendChain(chains[iter->second], def, &op)) {
+          chain_id = iter->second;
+          tails.erase(iter);
+          break;
+        }
+      }
+
+      if (chain_id == chains.size()) chains.emplace_back();
+      chains[chain_id].push_back(&op);
+      tails[&op] = chain_id;
+    }
+
+    return chains;
+  }
+
+  void OutlineChain(mlir::func::FuncOp func, const KernelChain& chain,
+                    int index, mlir::SymbolTable& symbol_table) {
+    auto* context = func.getContext();
+
+    llvm::SmallPtrSet<mlir::Operation*, 4> chain_ops(chain.begin(),
+                                                      chain.end());
+    llvm::SetVector<mlir::Value> inputs;
+    llvm::SmallVector<mlir::Location, 4> locations;
+    for (auto* op : chain) {
+      for (mlir::Value operand : op->getOperands()) {
+        if (!chain_ops.contains(operand.getDefiningOp()))
+          inputs.insert(operand);
+      }
+      locations.push_back(op->getLoc());
+    }
+
+    // Only the results of the last kernel are used outside of the chain.
+    mlir::Operation* last = chain.back();
+    auto function_type = mlir::FunctionType::get(
+        context, mlir::ValueRange(inputs.getArrayRef()).getTypes(),
+        last->getResultTypes());
+
+    auto fused_func = mlir::func::FuncOp::create(
+        func.getLoc(),
+        (func.getSymName() + "_fused_" + llvm::Twine(index)).str(),
+        function_type);
+    fused_func->setAttr("tfrt.fused", mlir::UnitAttr::get(context));
+    fused_func.setPrivate();
+    // Make the name unique, and insert the function into the module.
+    symbol_table.insert(fused_func);
+
+    mlir::Block* body = fused_func.addEntryBlock();
+    mlir::IRMapping mapping;
+    for (auto iter : llvm::enumerate(inputs))
+      mapping.map(iter.value(), body->getArgument(iter.index()));
+
+    auto body_builder = mlir::OpBuilder::atBlockEnd(body);
+    for (auto* op : chain) body_builder.clone(*op, mapping);
+    llvm::SmallVector<mlir::Value, 4> return_values;
+    for (mlir::Value result : last->getResults())
+      return_values.push_back(mapping.lookup(result));
+    body_builder.create<ReturnOp>(last->getLoc(), return_values);
+
+    // Replace the chain with a call to the fused function.
+    mlir::OpBuilder builder(last);
+    auto call = builder.create<CallOp>(
+        mlir::FusedLoc::get(context, locations), last->getResultTypes(),
+        mlir::SymbolRefAttr::get(fused_func), inputs.getArrayRef());
+    last->replaceAllUsesWith(call.getResults());
+    for (auto* op : llvm::reverse(chain)) op->erase();
+  }
+
+  ListOption<std::string> dialects_{
+      *this, "dialects",
+      llvm::cl::desc("The dialects whose kernels are fused (default: "
+                     "tfrt_dht,corert)")};
+  Option<int> min_kernels_{
+      *this, "min-kernels",
+      llvm::cl::desc("The minimum number of kernels in a fused chain"),
+      llvm::cl::init(2)};
+
+  llvm::StringSet<> dialects_set_;
+};
+
+static mlir::PassRegistration<FuseKernelsPass> fuse_kernels;
+
+}  // namespace
+}  // namespace compiler
+}  // namespace tfrt
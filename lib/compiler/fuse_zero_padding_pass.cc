@@ -0,0 +1,165 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This implements FuseZeroPaddingPass that fuses ZeroPadding kernels into the
+// convolution and pooling kernels that consume the padded tensors.
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinAttributes.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/Pass/Pass.h"
+
+namespace tfrt {
+namespace compiler {
+namespace {
+
+constexpr llvm::StringLiteral kZeroPaddingKernel = "eigen.zero_padding.f32";
+
+// The kernels that can read a zero padded input in place, and their fused
+// versions. All of them have the input as the first operand and the chain as
+// the last operand.
+struct PaddedKernel {
+  llvm::StringLiteral kernel;
+  llvm::StringLiteral fused;
+};
+
+constexpr PaddedKernel kPaddedKernels[] = {
+    {"eigen.max_pooling_2d.f32", "eigen.zero_padding.max_pooling_2d.f32"},
+    {"eigen.conv2d.f32", "eigen.zero_padding.conv2d.f32"},
+    {"eigen.conv2d.batch_norm.f32", "eigen.zero_padding.conv2d.batch_norm.f32"},
+    {"eigen.conv2d.batch_norm.relu.f32",
+     "eigen.zero_padding.conv2d.batch_norm.relu.f32"},
+};
+
+// The operands of the ZeroPadding kernel: (input, output, chain).
+constexpr unsigned kNumZeroPaddingOperands = 3;
+
+// FuseZeroPaddingPass rewrites a ZeroPadding kernel followed by a kernel with
+// the "valid" padding that is the only reader of the padded tensor:
+//
+//   %ch1 = "eigen.zero_padding.f32"(%input, %padded, %ch0) {padding = [3, 3]}
+//   %ch2 = "eigen.conv2d.f32"(%padded, %filter, %output, %ch1)
+//            {padding = "valid", strides = [2, 2]}
+//
+// into the fused kernel, which treats the padding as virtual zeros:
+//
+//   %ch2 = "eigen.zero_padding.conv2d.f32"(%input, %filter, %output, %ch0)
+//            {padding = "valid", strides = [2, 2], zero_padding = [3, 3]}
+//
+// The padded tensor is removed if it was allocated by
+// tfrt_dht.create_uninitialized_tensor and has no other uses.
+class FuseZeroPaddingPass
+    : public mlir::PassWrapper<FuseZeroPaddingPass,
+                               mlir::OperationPass<mlir::ModuleOp>> {
+ public:
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(FuseZeroPaddingPass)
+
+  llvm::StringRef getArgument() const final {
+    return "tfrt-fuse-zero-padding";
+  }
+
+  llvm::StringRef getDescription() const final {
+    return "Fuse ZeroPadding kernels into the convolution and pooling kernels "
+           "that read the padded tensors";
+  }
+
+  void runOnOperation() override {
+    getOperation().walk([](mlir::func::FuncOp func) {
+      if (func.isExternal()) return;
+
+      llvm::SmallVector<mlir::Operation*, 4> paddings;
+      for (auto& op : func.front()) {
+        if (op.getName().getStringRef() == kZeroPaddingKernel &&
+            op.getNumOperands() == kNumZeroPaddingOperands &&
+            op.getNumResults() == 1)
+          paddings.push_back(&op);
+      }
+
+      for (auto* padding : paddings) Fuse(padding);
+    });
+  }
+
+ private:
+  // Returns the fused kernel name if `op` can read a zero padded input.
+  static llvm::StringRef GetFusedKernel(mlir::Operation* op) {
+    for (const auto& kernel : kPaddedKernels) {
+      if (op->getName().getStringRef() == kernel.kernel) return kernel.fused;
+    }
+    return {};
+  }
+
+  static void Fuse(mlir::Operation* padding) {
+    mlir::Value padded = padding->getOperand(1);
+    mlir::Value chain = padding->getResult(0);
+
+    // The padded tensor must be read by one kernel that waits for the padding.
+    if (!chain.hasOneUse()) return;
+    mlir::Operation* consumer = *chain.getUsers().begin();
+    if (consumer->getBlock() != padding->getBlock()) return;
+
+    llvm::StringRef fused = GetFusedKernel(consumer);
+    if (fused.empty()) return;
+    if (consumer->getOperand(0) != padded ||
+        consumer->getOperands().back() != chain)
+      return;
+    for (auto& use : padded.getUses()) {
+      if (use.getOwner() != padding &&
+          (use.getOwner() != consumer || use.getOperandNumber() != 0))
+        return;
+    }
+
+    // The fused kernels only add the zero padding to the "valid" padding.
+    auto consumer_padding =
+        consumer->getAttrOfType<mlir::StringAttr>("padding");
+    if (!consumer_padding ||
+        !consumer_padding.getValue().equals_insensitive("valid"))
+      return;
+    auto zero_padding = padding->getAttr("padding");
+    if (!zero_padding) return;
+
+    mlir::OperationState state(consumer->getLoc(), fused);
+    llvm::SmallVector<mlir::Value, 8> operands(consumer->getOperands());
+    operands.front() = padding->getOperand(0);
+    operands.back() = padding->getOperand(2);
+    state.addOperands(operands);
+    state.addTypes(consumer->getResultTypes());
+    state.addAttributes(consumer->getAttrs());
+    state.addAttribute("zero_padding", zero_padding);
+
+    mlir::OpBuilder builder(consumer);
+    mlir::Operation* fused_kernel = builder.create(state);
+    consumer->replaceAllUsesWith(fused_kernel->getResults());
+    consumer->erase();
+    padding->erase();
+
+    // Remove the padded tensor buffer if nothing else uses it.
+    mlir::Operation* alloc = padded.getDefiningOp();
+    if (alloc && alloc->use_empty() &&
+        alloc->getName().getStringRef().startswith(
+            "tfrt_dht.create_uninitialized_tensor."))
+      alloc->erase();
+  }
+};
+
+static mlir::PassRegistration<FuseZeroPaddingPass> fuse_zero_padding;
+
+}  // namespace
+}  // namespace compiler
+}  // namespace tfrt
@@ -0,0 +1,201 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This implements MemoryPlanning that packs intermediate buffers into a slab.
+
+#include "tfrt/compiler/memory_planning.h"
+
+#include <algorithm>
+#include <numeric>
+
+#include "llvm/ADT/BitVector.h"
+#include "llvm/Support/MathExtras.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/Operation.h"
+
+namespace tfrt {
+namespace compiler {
+namespace {
+
+class DefaultSizeModel : public MemoryPlanning::SizeModelInterface {
+ public:
+  std::optional<int64_t> GetBufferSize(mlir::Value value) const override {
+    auto type = value.getType().dyn_cast<mlir::RankedTensorType>();
+    if (!type || !type.hasStaticShape()) return std::nullopt;
+
+    mlir::Type element_type = type.getElementType();
+    int64_t num_components = 1;
+    if (auto complex_type = element_type.dyn_cast<mlir::ComplexType>()) {
+      element_type = complex_type.getElementType();
+      num_components = 2;
+    }
+    if (!element_type.isIntOrFloat()) return std::nullopt;
+
+    const int64_t element_size =
+        num_components * llvm::divideCeil(element_type.getIntOrFloatBitWidth(),
+                                          8);
+    return type.getNumElements() * element_size;
+  }
+};
+
+const DefaultSizeModel* GetDefaultSizeModel() {
+  static const auto* const default_size_model = new DefaultSizeModel();
+  return default_size_model;
+}
+
+}  // namespace
+
+MemoryPlanning::SizeModelInterface::~SizeModelInterface() = default;
+
+MemoryPlanning::MemoryPlanning(mlir::func::FuncOp op,
+                               const SizeModelInterface* size_model)
+    : MemoryPlanning(op.front(), size_model) {}
+MemoryPlanning::MemoryPlanning(mlir::Block& block,
+                               const SizeModelInterface* size_model)
+    : size_model_(size_model) {
+  if (size_model_ == nullptr) size_model_ = GetDefaultSizeModel();
+  AnalyzeBlock(block);
+}
+
+void MemoryPlanning::AnalyzeBlock(mlir::Block& block) {
+  llvm::SmallVector<mlir::Operation*, 16> ops;
+  llvm::DenseMap<mlir::Operation*, int> op_index;
+  for (auto& op : block) {
+    op_index[&op] = ops.size();
+    ops.push_back(&op);
+  }
+  const int num_ops = ops.size();
+
+  // Returns the index of the op in `block` that contains `op`, or -1 if `op` is
+  // not in `block`.
+  auto get_op_index = [&](mlir::Operation* op) -> int {
+    if (op == nullptr) return -1;
+    op = block.findAncestorOpInBlock(*op);
+    if (op == nullptr) return -1;
+    return op_index.lookup(op);
+  };
+
+  // `ancestors[i]` are the ops that the i-th op transitively depends on. Ops
+  // are visited in the topological order, so the ancestors of the operands are
+  // already known.
+  llvm::SmallVector<llvm::BitVector, 16> ancestors(num_ops,
+                                                   llvm::BitVector(num_ops));
+  for (int i = 0; i < num_ops; ++i) {
+    ops[i]->walk([&](mlir::Operation* nested) {
+      for (mlir::Value operand : nested->getOperands()) {
+        int def_index = get_op_index(operand.getDefiningOp());
+        if (def_index < 0 || def_index == i) continue;
+        ancestors[i].set(def_index);
+        ancestors[i] |= ancestors[def_index];
+      }
+    });
+  }
+
+  // Collect the buffers, together with the ops that access them: the defining
+  // op and all users.
+  llvm::SmallVector<int, 8> buffer_defs;
+  llvm::SmallVector<llvm::SmallVector<int, 4>, 8> buffer_accesses;
+  mlir::Operation* terminator =
+      block.empty() ? nullptr : block.getTerminator();
+
+  for (int i = 0; i < num_ops; ++i) {
+    for (mlir::Value result : ops[i]->getResults()) {
+      auto size = size_model_->GetBufferSize(result);
+      if (!size || *size <= 0) continue;
+
+      llvm::SmallVector<int, 4> accesses = {i};
+      bool escapes = false;
+      for (mlir::Operation* user : result.getUsers()) {
+        int user_index = get_op_index(user);
+        if (user_index < 0) continue;
+        if (ops[user_index] == terminator) escapes = true;
+        accesses.push_back(user_index);
+      }
+      if (escapes) continue;
+
+      buffer_map_[result] = buffers_.size();
+      buffers_.push_back({result, *size, 0});
+      buffer_defs.push_back(i);
+      buffer_accesses.push_back(std::move(accesses));
+      total_buffer_size_ += *size;
+    }
+  }
+
+  // Returns true if the buffer `a` is dead when the buffer `b` is defined.
+  auto dead_before = [&](int a, int b) {
+    const int b_def = buffer_defs[b];
+    return llvm::all_of(buffer_accesses[a], [&](int access) {
+      return access != b_def && ancestors[b_def].test(access);
+    });
+  };
+
+  const int num_buffers = buffers_.size();
+  llvm::SmallVector<llvm::SmallVector<int, 4>, 8> conflicts(num_buffers);
+  for (int a = 0; a < num_buffers; ++a) {
+    for (int b = a + 1; b < num_buffers; ++b) {
+      if (dead_before(a, b) || dead_before(b, a)) continue;
+      conflicts[a].push_back(b);
+      conflicts[b].push_back(a);
+    }
+  }
+
+  AssignOffsets(conflicts);
+}
+
+void MemoryPlanning::AssignOffsets(
+    llvm::ArrayRef<llvm::SmallVector<int, 4>> conflicts) {
+  llvm::SmallVector<int, 8> order(buffers_.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+    return buffers_[a].size > buffers_[b].size;
+  });
+
+  llvm::BitVector placed(buffers_.size());
+  llvm::SmallVector<const Buffer*, 8> live;
+
+  for (int index : order) {
+    Buffer& buffer = buffers_[index];
+
+    // Address ranges of the placed buffers that can't share memory with this
+    // one, in the order of their offsets.
+    live.clear();
+    for (int other : conflicts[index]) {
+      if (placed.test(other)) live.push_back(&buffers_[other]);
+    }
+    std::sort(live.begin(), live.end(), [](const Buffer* a, const Buffer* b) {
+      return a->offset < b->offset;
+    });
+
+    // Find the lowest gap that fits the buffer.
+    int64_t offset = 0;
+    for (const Buffer* other : live) {
+      if (offset + buffer.size <= other->offset) break;
+      offset = std::max(
+          offset, static_cast<int64_t>(llvm::alignTo(
+                      other->offset + other->size, kBufferAlignment)));
+    }
+
+    buffer.offset = offset;
+    placed.set(index);
+    slab_size_ = std::max(
+        slab_size_,
+        static_cast<int64_t>(llvm::alignTo(offset + buffer.size,
+                                           kBufferAlignment)));
+  }
+}
+
+}  // namespace compiler
+}  // namespace tfrt
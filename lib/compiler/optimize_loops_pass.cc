@@ -0,0 +1,212 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// This implements OptimizeLoopsPass that hoists loop-invariant kernels out of
+// tfrt.repeat.i32 bodies and unrolls small bodies with a constant trip count.
+
+#include <cstdint>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/IRMapping.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
+#include "mlir/Pass/Pass.h"
+#include "tfrt/basic_kernels/opdefs/basic_kernels.h"
+
+namespace tfrt {
+namespace compiler {
+namespace {
+
+// OptimizeLoopsPass reduces the number of body executions of tfrt.repeat.i32,
+// each of which sets up a BEFExecutor for the body, and the work done by each
+// of them.
+//
+// Hoisting: a pure kernel of the body whose operands are all computed by other
+// hoisted kernels produces the same value in every iteration. These kernels
+// are moved in front of the loop. As the body is isolated from above, every
+// hoisted value that is still used in the body is passed in as an additional
+// loop-carried value, which the body returns unchanged. Kernels without
+// operands, such as constants, are cheaper to recompute than to pass in, so
+// they are only hoisted together with a kernel that uses them.
+//
+// Unrolling: if the trip count is a tfrt.constant.i32 that is a multiple of
+// `unroll-factor`, and the body has at most `max-unroll-kernels` kernels, the
+// body is replicated `unroll-factor` times and the trip count is divided
+// accordingly.
+class OptimizeLoopsPass
+    : public mlir::PassWrapper<OptimizeLoopsPass,
+                               mlir::OperationPass<mlir::ModuleOp>> {
+ public:
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(OptimizeLoopsPass)
+
+  OptimizeLoopsPass() = default;
+  OptimizeLoopsPass(const OptimizeLoopsPass& other) : PassWrapper(other) {}
+
+  llvm::StringRef getArgument() const final { return "tfrt-optimize-loops"; }
+
+  llvm::StringRef getDescription() const final {
+    return "Hoist loop-invariant kernels out of tfrt.repeat.i32 and unroll "
+           "small loop bodies";
+  }
+
+  void runOnOperation() override {
+    // Collect the loops first, as hoisting replaces them. Inner loops come
+    // first, so that kernels hoisted out of them can be hoisted further.
+    llvm::SmallVector<RepeatI32Op, 4> loops;
+    getOperation().walk([&](RepeatI32Op loop) { loops.push_back(loop); });
+
+    for (auto loop : loops) {
+      loop = HoistInvariants(loop);
+      Unroll(loop);
+    }
+  }
+
+ private:
+  static bool IsHoistable(
+      mlir::Operation* op,
+      const llvm::SmallPtrSetImpl<mlir::Operation*>& invariant) {
+    if (op->getNumRegions() != 0) return false;
+    if (op->hasTrait<mlir::OpTrait::IsTerminator>()) return false;
+    if (!mlir::isPure(op)) return false;
+    return llvm::all_of(op->getOperands(), [&](mlir::Value operand) {
+      auto* def = operand.getDefiningOp();
+      return def != nullptr && invariant.contains(def);
+    });
+  }
+
+  // Move the loop-invariant kernels of the body of `loop` in front of it.
+  // Returns the loop that replaces `loop`.
+  static RepeatI32Op HoistInvariants(RepeatI32Op loop) {
+    mlir::Block& body = loop.getRegion().front();
+
+    llvm::SmallVector<mlir::Operation*, 4> candidates;
+    llvm::SmallPtrSet<mlir::Operation*, 4> invariant;
+    for (auto& op : body) {
+      if (!IsHoistable(&op, invariant)) continue;
+      candidates.push_back(&op);
+      invariant.insert(&op);
+    }
+
+    // Drop the kernels without operands that no other hoisted kernel uses.
+    llvm::SmallPtrSet<mlir::Operation*, 4> hoisted;
+    for (auto* op : llvm::reverse(candidates)) {
+      if (op->getNumOperands() != 0 ||
+          llvm::any_of(op->getUsers(), [&](mlir::Operation* user) {
+            return hoisted.contains(user);
+          }))
+        hoisted.insert(op);
+    }
+    if (hoisted.empty()) return loop;
+
+    llvm::SmallVector<mlir::Operation*, 4> invariants;
+    for (auto* op : candidates)
+      if (hoisted.contains(op)) invariants.push_back(op);
+    for (auto* op : invariants) op->moveBefore(loop);
+
+    // The hoisted values that are still used in the body.
+    llvm::SetVector<mlir::Value> live_ins;
+    for (auto* op : invariants) {
+      for (mlir::Value result : op->getResults()) {
+        if (llvm::any_of(result.getUsers(), [&](mlir::Operation* user) {
+              return !hoisted.contains(user);
+            }))
+          live_ins.insert(result);
+      }
+    }
+
+    auto* terminator = body.getTerminator();
+    for (mlir::Value value : live_ins) {
+      mlir::Value arg = body.addArgument(value.getType(), value.getLoc());
+      value.replaceUsesWithIf(arg, [&](mlir::OpOperand& use) {
+        return loop->isProperAncestor(use.getOwner());
+      });
+      terminator->insertOperands(terminator->getNumOperands(), arg);
+    }
+    if (live_ins.empty()) return loop;
+
+    // Create a loop with the additional operands and results, and move the
+    // body over.
+    llvm::SmallVector<mlir::Value, 4> operands(loop.getOperands());
+    operands.append(live_ins.begin(), live_ins.end());
+    llvm::SmallVector<mlir::Type, 4> result_types(loop.getResultTypes());
+    for (mlir::Value value : live_ins) result_types.push_back(value.getType());
+
+    mlir::OpBuilder builder(loop);
+    auto new_loop = builder.create<RepeatI32Op>(loop.getLoc(), result_types,
+                                                operands, loop->getAttrs());
+    new_loop.getRegion().takeBody(loop.getRegion());
+    loop->replaceAllUsesWith(
+        new_loop.getResults().take_front(loop.getNumResults()));
+    loop->erase();
+    return new_loop;
+  }
+
+  void Unroll(RepeatI32Op loop) const {
+    if (unroll_factor_ <= 1) return;
+
+    auto trip_count_op = loop.getOperand(0).getDefiningOp<ConstantI32Op>();
+    if (!trip_count_op) return;
+    int64_t trip_count = trip_count_op.getValueAttr().getInt();
+    if (trip_count <= 0 || trip_count % unroll_factor_ != 0) return;
+
+    mlir::Block& body = loop.getRegion().front();
+    llvm::SmallVector<mlir::Operation*, 8> kernels;
+    for (auto& op : body.without_terminator()) kernels.push_back(&op);
+    if (kernels.size() > static_cast<size_t>(max_unroll_kernels_)) return;
+
+    // Append copies of the body, each of which takes the values returned by
+    // the previous copy instead of the block arguments.
+    auto* terminator = body.getTerminator();
+    llvm::SmallVector<mlir::Value, 4> returned(terminator->getOperands());
+    mlir::OpBuilder builder(terminator);
+    for (int copy = 1; copy < unroll_factor_; ++copy) {
+      mlir::IRMapping mapping;
+      mapping.map(body.getArguments(), returned);
+      for (auto* op : kernels) builder.clone(*op, mapping);
+      for (auto& value : returned) value = mapping.lookupOrDefault(value);
+    }
+    terminator->setOperands(returned);
+
+    builder.setInsertionPoint(loop);
+    auto new_trip_count = builder.create<ConstantI32Op>(
+        trip_count_op.getLoc(), builder.getI32Type(),
+        builder.getI32IntegerAttr(trip_count / unroll_factor_));
+    loop->setOperand(0, new_trip_count);
+    if (trip_count_op->use_empty()) trip_count_op->erase();
+  }
+
+  Option<int> unroll_factor_{
+      *this, "unroll-factor",
+      llvm::cl::desc("The number of body copies per iteration of an unrolled "
+                     "loop, or 1 to disable unrolling"),
+      llvm::cl::init(4)};
+  Option<int> max_unroll_kernels_{
+      *this, "max-unroll-kernels",
+      llvm::cl::desc("The maximum number of kernels in a loop body to unroll"),
+      llvm::cl::init(8)};
+};
+
+static mlir::PassRegistration<OptimizeLoopsPass> optimize_loops;
+
+}  // namespace
+}  // namespace compiler
+}  // namespace tfrt
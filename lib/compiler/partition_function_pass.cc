@@ -0,0 +1,291 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This implements PartitionFunctionPass that splits functions into one
+// function per host according to the device annotations of their kernels, and
+// connects the partitions with tfrt.send and tfrt.recv.
+
+#include <string>
+#include <utility>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/Twine.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/IRMapping.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Transforms/RegionUtils.h"
+#include "tfrt/basic_kernels/opdefs/basic_kernels.h"
+#include "tfrt/basic_kernels/opdefs/types.h"
+
+namespace tfrt {
+namespace compiler {
+namespace {
+
+constexpr llvm::StringLiteral kDeviceAttr = "device";
+
+// A value defined on one host and used on another one, which is sent under
+// `key`.
+struct Transfer {
+  llvm::StringRef dst_host;
+  std::string key;
+};
+
+// PartitionFunctionPass splits every function whose kernels are annotated
+// with devices of several hosts, e.g.
+//
+//   func.func @f(%x: i32) -> i32 {
+//     %y = tfrt.add.i32 %x, %x {device = "/job:worker/task:1/device:CPU:0"}
+//     %z = tfrt.add.i32 %y, %x
+//     tfrt.return %z : i32
+//   }
+//
+// into one function per host. The host of a kernel is its "device" attribute
+// without the trailing "/device:..." component. Kernels without a device run
+// on `default-host`, whose partition keeps the name and the signature of the
+// function. The partition of every other host is named "<function>@<host>",
+// takes the same arguments and returns a chain that is available once all its
+// values are sent:
+//
+//   func.func @f(%x: i32) -> i32 {
+//     %ch = tfrt.new.chain
+//     %y, %ch1 = tfrt.recv %ch key("f:0") : i32
+//     %z = tfrt.add.i32 %y, %x
+//     tfrt.return %z : i32
+//   }
+//   func.func @"f@/job:worker/task:1"(%x: i32) -> !tfrt.chain {
+//     %ch = tfrt.new.chain
+//     %y = tfrt.add.i32 %x, %x {device = "/job:worker/task:1/device:CPU:0"}
+//     %ch1 = tfrt.send %y, %ch key("f:0") : i32
+//     tfrt.return %ch1 : !tfrt.chain
+//   }
+//
+// Every host runs its partition with the same arguments and a resource
+// context whose rendezvous reaches the other hosts (see SetRendezvous()).
+// Values, including chains, are sent once per host that uses them. Sends do
+// not wait for the values, so a partition never blocks on the others for
+// values it does not use.
+class PartitionFunctionPass
+    : public mlir::PassWrapper<PartitionFunctionPass,
+                               mlir::OperationPass<mlir::ModuleOp>> {
+ public:
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(PartitionFunctionPass)
+
+  PartitionFunctionPass() = default;
+  PartitionFunctionPass(const PartitionFunctionPass& other)
+      : PassWrapper(other) {}
+
+  llvm::StringRef getArgument() const final {
+    return "tfrt-partition-function";
+  }
+
+  llvm::StringRef getDescription() const final {
+    return "Partition functions across hosts by the devices of their kernels, "
+           "connected by tfrt.send and tfrt.recv";
+  }
+
+  void runOnOperation() override {
+    auto module = getOperation();
+    mlir::SymbolTable symbol_table(module);
+
+    llvm::SmallVector<mlir::func::FuncOp, 4> funcs(
+        module.getOps<mlir::func::FuncOp>());
+    for (auto func : funcs) {
+      if (func.isExternal() || !func.getBody().hasOneBlock()) continue;
+      if (mlir::failed(Partition(func, symbol_table))) {
+        signalPassFailure();
+        return;
+      }
+    }
+  }
+
+ private:
+  llvm::StringRef default_host() const { return default_host_; }
+
+  llvm::StringRef GetHost(mlir::Operation* op) const {
+    auto device = op->getAttrOfType<mlir::StringAttr>(kDeviceAttr);
+    if (!device) return default_host();
+    llvm::StringRef host = device.getValue();
+    return host.substr(0, host.find("/device:"));
+  }
+
+  mlir::LogicalResult Partition(mlir::func::FuncOp func,
+                                mlir::SymbolTable& symbol_table) {
+    mlir::Block& block = func.front();
+
+    llvm::SetVector<llvm::StringRef> hosts;
+    hosts.insert(default_host());
+    llvm::DenseMap<mlir::Operation*, llvm::StringRef> op_hosts;
+    for (auto& op : block.without_terminator()) {
+      llvm::StringRef host = GetHost(&op);
+      op_hosts[&op] = host;
+      hosts.insert(host);
+    }
+    if (hosts.size() == 1) return mlir::success();
+
+    // Find the values used on other hosts than their defining kernel. The
+    // arguments are passed to every partition.
+    llvm::MapVector<mlir::Value, llvm::SmallVector<Transfer, 2>> transfers;
+    llvm::DenseMap<std::pair<mlir::Value, llvm::StringRef>, std::string>
+        recv_keys;
+    auto add_use = [&](mlir::Value value, llvm::StringRef host) {
+      auto* def = value.getDefiningOp();
+      if (def == nullptr || def->getBlock() != &block) return;
+      if (op_hosts[def] == host || recv_keys.count({value, host})) return;
+      std::string key =
+          (func.getSymName() + ":" + llvm::Twine(recv_keys.size())).str();
+      transfers[value].push_back({host, key});
+      recv_keys[{value, host}] = std::move(key);
+    };
+    for (auto& op : block) {
+      llvm::StringRef host = op.hasTrait<mlir::OpTrait::IsTerminator>()
+                                 ? default_host()
+                                 : op_hosts[&op];
+      for (mlir::Value operand : GetUsedValues(&op)) add_use(operand, host);
+    }
+
+    // The partitions of the other hosts follow the function.
+    mlir::Block::iterator insert_point = std::next(func->getIterator());
+    for (llvm::StringRef host : hosts.getArrayRef().drop_front()) {
+      std::string name = (func.getSymName() + "@" + host).str();
+      if (symbol_table.lookup(name))
+        return func.emitError() << "partition " << name << " already exists";
+
+      auto partition = mlir::func::FuncOp::create(
+          func.getLoc(), name,
+          mlir::FunctionType::get(func.getContext(), func.getArgumentTypes(),
+                                  {ChainType::get(func.getContext())}));
+      symbol_table.insert(partition, insert_point);
+      insert_point = std::next(partition->getIterator());
+      BuildPartition(func, host, op_hosts, transfers, recv_keys, partition);
+    }
+
+    // The partition of the default host replaces the body of the function.
+    auto partition = mlir::func::FuncOp::create(
+        func.getLoc(), func.getSymName(), func.getFunctionType());
+    BuildPartition(func, default_host(), op_hosts, transfers, recv_keys,
+                   partition);
+    func.getBody().takeBody(partition.getBody());
+    partition->erase();
+
+    return mlir::success();
+  }
+
+  // Returns the operands of `op` and the values its regions use from above.
+  static llvm::SetVector<mlir::Value> GetUsedValues(mlir::Operation* op) {
+    llvm::SetVector<mlir::Value> values(op->operand_begin(),
+                                        op->operand_end());
+    mlir::getUsedValuesDefinedAbove(op->getRegions(), values);
+    return values;
+  }
+
+  // Clones the kernels of `host` into `partition`, receiving the values
+  // defined on other hosts and sending the values used on other hosts.
+  void BuildPartition(
+      mlir::func::FuncOp func, llvm::StringRef host,
+      const llvm::DenseMap<mlir::Operation*, llvm::StringRef>& op_hosts,
+      const llvm::MapVector<mlir::Value, llvm::SmallVector<Transfer, 2>>&
+          transfers,
+      const llvm::DenseMap<std::pair<mlir::Value, llvm::StringRef>,
+                           std::string>& recv_keys,
+      mlir::func::FuncOp partition) {
+    auto chain_type = ChainType::get(func.getContext());
+    mlir::Block* body = partition.addEntryBlock();
+    auto builder = mlir::OpBuilder::atBlockEnd(body);
+
+    mlir::IRMapping mapping;
+    mapping.map(func.getArguments(), partition.getArguments());
+
+    // The chain of the sends and receives, created at the start of the
+    // partition on first use.
+    mlir::Value entry_chain;
+    auto get_entry_chain = [&]() {
+      if (!entry_chain) {
+        entry_chain = mlir::OpBuilder::atBlockBegin(body).create<NewChainOp>(
+            func.getLoc(), chain_type);
+      }
+      return entry_chain;
+    };
+    llvm::SmallVector<mlir::Value, 4> send_chains;
+
+    auto recv_used_values = [&](mlir::Operation* op) {
+      for (mlir::Value value : GetUsedValues(op)) {
+        if (mapping.contains(value)) continue;
+        auto it = recv_keys.find({value, host});
+        if (it == recv_keys.end()) continue;
+        auto recv = builder.create<RecvOp>(op->getLoc(), value.getType(),
+                                           chain_type, get_entry_chain(),
+                                           it->second);
+        mapping.map(value, recv.getValue());
+      }
+    };
+
+    mlir::Block& block = func.front();
+    for (auto& op : block.without_terminator()) {
+      if (op_hosts.lookup(&op) != host) continue;
+      recv_used_values(&op);
+      builder.clone(op, mapping);
+
+      for (mlir::Value result : op.getResults()) {
+        auto it = transfers.find(result);
+        if (it == transfers.end()) continue;
+        for (const Transfer& transfer : it->second) {
+          auto send = builder.create<SendOp>(op.getLoc(), chain_type,
+                                             mapping.lookup(result),
+                                             get_entry_chain(), transfer.key);
+          send_chains.push_back(send.getOutChain());
+        }
+      }
+    }
+
+    mlir::Operation* terminator = block.getTerminator();
+    if (host == default_host()) {
+      recv_used_values(terminator);
+      builder.clone(*terminator, mapping);
+      return;
+    }
+
+    mlir::Value done;
+    if (send_chains.empty()) {
+      done = get_entry_chain();
+    } else if (send_chains.size() == 1) {
+      done = send_chains.front();
+    } else {
+      done = builder.create<MergeChainsOp>(terminator->getLoc(), chain_type,
+                                           send_chains);
+    }
+    builder.create<ReturnOp>(terminator->getLoc(), done);
+  }
+
+  Option<std::string> default_host_{
+      *this, "default-host",
+      llvm::cl::desc("The host of the kernels without a device, whose "
+                     "partition keeps the name of the function"),
+      llvm::cl::init("")};
+};
+
+static mlir::PassRegistration<PartitionFunctionPass> partition_function;
+
+}  // namespace
+}  // namespace compiler
+}  // namespace tfrt
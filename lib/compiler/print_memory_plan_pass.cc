@@ -0,0 +1,61 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This implements PrintMemoryPlanPass for testing MemoryPlanning.
+
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/Pass/Pass.h"
+#include "tfrt/compiler/memory_planning.h"
+
+namespace tfrt {
+namespace compiler {
+namespace {
+
+class PrintMemoryPlanPass
+    : public mlir::PassWrapper<PrintMemoryPlanPass,
+                               mlir::OperationPass<mlir::func::FuncOp>> {
+ public:
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(PrintMemoryPlanPass)
+
+  llvm::StringRef getArgument() const final {
+    return "tfrt-print-memory-plan";
+  }
+
+  llvm::StringRef getDescription() const final {
+    return "A test pass for MemoryPlanning";
+  }
+
+  void runOnOperation() override {
+    auto func_op = getOperation();
+
+    const auto& memory_planning = getAnalysis<MemoryPlanning>();
+
+    mlir::emitRemark(func_op.getLoc(), "slab size: ")
+        << memory_planning.slab_size()
+        << ", total buffer size: " << memory_planning.total_buffer_size();
+
+    for (const auto& buffer : memory_planning.buffers()) {
+      mlir::emitRemark(buffer.value.getLoc(), "buffer offset: ")
+          << buffer.offset << ", size: " << buffer.size;
+    }
+  }
+};
+
+static mlir::PassRegistration<PrintMemoryPlanPass> print_memory_plan;
+
+}  // namespace
+}  // namespace compiler
+}  // namespace tfrt
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// This implements ProfileCostModel that provides measured costs to
+// StreamAnalysis.
+
+#include "tfrt/compiler/profile_cost_model.h"
+
+#include <algorithm>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "llvm/Support/raw_ostream.h"
+#include "mlir/IR/Location.h"
+
+namespace tfrt {
+namespace compiler {
+namespace {
+
+std::string GetLocationKey(mlir::Location loc) {
+  std::string key;
+  if (auto file_loc = loc.dyn_cast<mlir::FileLineColLoc>()) {
+    llvm::raw_string_ostream os(key);
+    os << file_loc.getFilename().getValue() << ":" << file_loc.getLine() << ":"
+       << file_loc.getColumn();
+  }
+  return key;
+}
+
+}  // namespace
+
+llvm::Expected<ProfileCostModel> ProfileCostModel::Parse(
+    llvm::StringRef profile) {
+  // The number of calls and the total wall time of each location. Locations
+  // can appear more than once, e.g. in profiles concatenated from several runs.
+  llvm::StringMap<std::pair<int64_t, int64_t>> totals;
+
+  llvm::SmallVector<llvm::StringRef, 16> lines;
+  profile.split(lines, '\n', /*MaxSplit=*/-1, /*KeepEmpty=*/false);
+  for (llvm::StringRef line : lines) {
+    line = line.trim();
+    if (line.empty() || line.startswith("#")) continue;
+
+    // <number of calls> <total nanoseconds> <location>
+    llvm::StringRef count_str, total_str, location;
+    std::tie(count_str, location) = line.split(' ');
+    std::tie(total_str, location) = location.split(' ');
+    int64_t count, total_ns;
+    if (count_str.getAsInteger(10, count) ||
+        total_str.getAsInteger(10, total_ns) || count <= 0 || total_ns < 0 ||
+        location.empty())
+      return llvm::createStringError(llvm::inconvertibleErrorCode(),
+                                     "malformed kernel profile line: '%s'",
+                                     line.str().c_str());
+
+    auto& total = totals[location];
+    total.first += count;
+    total.second += total_ns;
+  }
+
+  ProfileCostModel model;
+  for (const auto& entry : totals) {
+    int64_t count = entry.getValue().first;
+    int64_t total_ns = entry.getValue().second;
+    model.costs_[entry.getKey()] = std::max<int64_t>(1, total_ns / count);
+  }
+  return model;
+}
+
+std::optional<int64_t> ProfileCostModel::GetOperationCost(
+    mlir::Operation* op) const {
+  auto iter = costs_.find(GetLocationKey(op->getLoc()));
+  if (iter == costs_.end()) return std::nullopt;
+  return iter->second;
+}
+
+std::optional<int64_t> ProfileCostModel::GetCostThreshold() const {
+  if (costs_.empty()) return std::nullopt;
+
+  std::vector<int64_t> costs;
+  costs.reserve(costs_.size());
+  for (const auto& entry : costs_) costs.push_back(entry.getValue());
+
+  auto median = costs.begin() + costs.size() / 2;
+  std::nth_element(costs.begin(), median, costs.end());
+  return *median * kCostThresholdFactor;
+}
+
+}  // namespace compiler
+}  // namespace tfrt
@@ -69,6 +69,12 @@ bool GetMergeInterDependentStreams(mlir::Block& block) {
 class DefaultCostModel : public StreamAnalysis::CostModelInterface {
  public:
   std::optional<int64_t> GetOperationCost(mlir::Operation* op) const override {
+    // A cost attached by a pass (e.g. measured by tfrt-apply-kernel-profile)
+    // takes precedence over the cost the operation defines itself.
+    if (auto attr = op->getAttrOfType<mlir::IntegerAttr>("_tfrt_cost")) {
+      if (attr.getInt() > 0) return attr.getInt();
+    }
+
     // Check if operations defines a cost function.
     if (auto cost_function = mlir::dyn_cast<CostFunctionInterface>(op)) {
       int64_t cost = cost_function.cost();
@@ -18,6 +18,9 @@
 
 #include <string>
 
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringMap.h"
+#include "tfrt/bef_executor/bef_file.h"
 #include "tfrt/core_runtime/core_runtime_op.h"
 #include "tfrt/core_runtime/op_handler.h"
 #include "tfrt/core_runtime/op_invocation.h"
@@ -33,6 +36,8 @@
 #include "tfrt/host_context/kernel_registry.h"
 #include "tfrt/host_context/location.h"
 #include "tfrt/host_context/shared_context.h"
+#include "tfrt/host_context/value.h"
+#include "tfrt/metrics/metrics.h"
 #include "tfrt/support/error_util.h"
 #include "tfrt/support/logging.h"
 #include "tfrt/support/mutex.h"
@@ -109,12 +114,61 @@ class CoreRuntime::Impl {
     op_handler_registry_ = std::move(op_handler_registry);
   }
 
+  // Return the op `op_name` of `op_handler`, or nullptr if the op handler does
+  // not support it.
+  const CoreRuntimeOp* GetOrMakeOp(string_view op_name, OpHandler* op_handler);
+
   // There is a 1-1 correspondence between HostContext and CoreRuntime.
   HostContext context_;
 
   OpHandlerRegistry op_handler_registry_;
+
+  // The ops resolved by Execute(), by op handler and op name. Entries of a
+  // StringMap are allocated individually, so pointers to the cached ops stay
+  // valid when the maps grow.
+  mutex op_cache_mu_;
+  llvm::DenseMap<OpHandler*, llvm::StringMap<CoreRuntimeOp>> op_cache_
+      TFRT_GUARDED_BY(op_cache_mu_);
 };
 
+static metrics::Counter* GetOpCacheHitCounter() {
+  static metrics::Counter* counter =
+      metrics::NewCounter("/tensorflow/runtime/core_runtime/op_cache_hits");
+  return counter;
+}
+
+static metrics::Counter* GetOpCacheMissCounter() {
+  static metrics::Counter* counter =
+      metrics::NewCounter("/tensorflow/runtime/core_runtime/op_cache_misses");
+  return counter;
+}
+
+const CoreRuntimeOp* CoreRuntime::Impl::GetOrMakeOp(string_view op_name,
+                                                    OpHandler* op_handler) {
+  {
+    mutex_lock lock(op_cache_mu_);
+    auto& ops = op_cache_[op_handler];
+    auto it = ops.find(op_name);
+    if (it != ops.end()) {
+      GetOpCacheHitCounter()->Increment();
+      return &it->second;
+    }
+  }
+
+  // Make the op without holding the lock, as op handlers may dispatch to other
+  // op handlers of this runtime.
+  GetOpCacheMissCounter()->Increment();
+  auto op = op_handler->MakeOp(op_name);
+  if (!op) {
+    llvm::consumeError(op.takeError());
+    return nullptr;
+  }
+
+  mutex_lock lock(op_cache_mu_);
+  auto inserted = op_cache_[op_handler].try_emplace(op_name, std::move(*op));
+  return &inserted.first->second;
+}
+
 void CoreRuntime::Impl::Execute(const ExecutionContext& exec_ctx,
                                 string_view op_name, OpHandler* op_handler,
                                 MutableArrayRef<TensorHandle> arguments,
@@ -122,9 +176,8 @@ void CoreRuntime::Impl::Execute(const ExecutionContext& exec_ctx,
                                 MutableArrayRef<TensorHandle> results,
                                 AsyncValueRef<Chain>* chain) {
   // Ask the op_handler to execute the op.  If successful, we're done.
-  auto op_handle = op_handler->MakeOp(op_name);
-  if (op_handle) {
-    op_handle.get()(exec_ctx, arguments, attrs, results, chain);
+  if (const CoreRuntimeOp* op = GetOrMakeOp(op_name, op_handler)) {
+    (*op)(exec_ctx, arguments, attrs, results, chain);
     return;
   }
 
@@ -238,7 +291,70 @@ Expected<CoreRuntimeOp> CoreRuntime::MakeOp(string_view op_name,
       is_fallback, std::move(device), op->GetTensorType());
 }
 
+// Make a composite op out of a SyncBEFFunction, which takes and returns
+// TensorHandles without chains. The function is run by the BEFInterpreter with
+// its argument and result registers bound to Values that hold the
+// TensorHandles of the invocation, so that no BEFExecutor or AsyncValue is
+// created.
+static Expected<CoreRuntimeOp> MakeSyncCompositeOp(const Function* fn) {
+  for (const auto& iter : llvm::enumerate(fn->argument_types())) {
+    if (iter.value().GetName() != kTensorHandleType) {
+      return MakeStringError("The sync function should only takes type [",
+                             kTensorHandleType, "] as input. But the ",
+                             iter.index(), "-th argument is type [",
+                             iter.value().GetName(), "].");
+    }
+  }
+  for (const auto& iter : llvm::enumerate(fn->result_types())) {
+    if (iter.value().GetName() != kTensorHandleType) {
+      return MakeStringError("The sync function should only returns type [",
+                             kTensorHandleType, "]. But the ", iter.index(),
+                             "-th results is type [", iter.value().GetName(),
+                             "].");
+    }
+  }
+  auto execute_fn = [fn = fn](const OpInvocation& invocation) {
+    assert(invocation.arguments.size() == fn->num_arguments());
+    assert(invocation.results.size() == fn->num_results());
+
+    const size_t num_arguments = invocation.arguments.size();
+    llvm::SmallVector<Value, 8> values;
+    llvm::SmallVector<Value*, 8> value_ptrs;
+    values.reserve(num_arguments + invocation.results.size());
+    value_ptrs.reserve(num_arguments + invocation.results.size());
+
+    // Move the arguments to enable input forwarding, as in the async case.
+    for (auto& argument : invocation.arguments) {
+      values.emplace_back(std::move(argument));
+      value_ptrs.push_back(&values.back());
+    }
+    for (size_t i = 0, e = invocation.results.size(); i != e; ++i) {
+      values.emplace_back();
+      value_ptrs.push_back(&values.back());
+    }
+
+    auto arguments = llvm::ArrayRef(value_ptrs).take_front(num_arguments);
+    auto results = llvm::ArrayRef(value_ptrs).drop_front(num_arguments);
+    if (auto error = ExecuteSyncBEFFunction(*fn, invocation.exec_ctx,
+                                            arguments, results)) {
+      auto err = EmitErrorAsync(invocation.exec_ctx, std::move(error));
+      for (auto& result : invocation.results) result = TensorHandle(err);
+      if (invocation.chain) *invocation.chain = std::move(err);
+      return;
+    }
+
+    // The side effects of the function happened before it returned, so the
+    // chain is left as is.
+    for (size_t i = 0, e = invocation.results.size(); i != e; ++i)
+      invocation.results[i] = std::move(results[i]->get<TensorHandle>());
+  };
+  return CoreRuntimeOp(std::move(execute_fn), false);
+}
+
 Expected<CoreRuntimeOp> CoreRuntime::MakeCompositeOp(const Function* fn) {
+  if (fn->function_kind() == FunctionKind::kSyncBEFFunction)
+    return MakeSyncCompositeOp(fn);
+
   for (const auto& iter : llvm::enumerate(fn->argument_types().drop_front())) {
     size_t i = iter.index();
     auto& type = iter.value();
@@ -0,0 +1,258 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file implements the caches used to reduce op dispatch overhead.
+
+#include "tfrt/core_runtime/dispatch_cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "llvm/ADT/Hashing.h"
+#include "tfrt/core_runtime/op_attrs.h"
+#include "tfrt/metrics/metrics.h"
+
+namespace tfrt {
+namespace internal {
+
+static bool IsSupportedAttrType(OpAttrType type) {
+  switch (type) {
+    case OpAttrType::UNSUPPORTED_RESOURCE:
+    case OpAttrType::UNSUPPORTED_VARIANT:
+    case OpAttrType::UNSUPPORTED_QUI8:
+    case OpAttrType::UNSUPPORTED_QUI16:
+    case OpAttrType::UNSUPPORTED_QI8:
+    case OpAttrType::UNSUPPORTED_QI16:
+    case OpAttrType::UNSUPPORTED_QI32:
+      return false;
+    default:
+      return true;
+  }
+}
+
+bool GetOpAttrsCacheKey(const OpAttrsRef& attrs, std::string* key) {
+  key->clear();
+
+  llvm::SmallVector<const OpAttrsRawEntry*, 8> entries;
+  entries.reserve(attrs.GetNumEntries());
+  attrs.IterateEntries(
+      [&](const OpAttrsRawEntry& entry) { entries.push_back(&entry); });
+
+  // Mutable attribute sets iterate in a non-deterministic order.
+  std::sort(entries.begin(), entries.end(),
+            [](const OpAttrsRawEntry* a, const OpAttrsRawEntry* b) {
+              return std::strcmp(a->name, b->name) < 0;
+            });
+
+  for (const OpAttrsRawEntry* entry : entries) {
+    if (!IsSupportedAttrType(entry->type)) return false;
+
+    size_t num_bytes = 0;
+    if (entry->element_count > 0) {
+      num_bytes = GetHostSizeAndAlignment(entry->GetData(), entry->type).first;
+      // Dense, shape and aggregate attributes know their full size.
+      if (entry->IsArray()) num_bytes *= entry->element_count;
+    }
+
+    // The name includes its null terminator to separate it from the value.
+    key->append(entry->name, std::strlen(entry->name) + 1);
+    key->push_back(static_cast<char>(entry->type));
+    key->push_back(entry->IsArray() ? 1 : 0);
+    key->append(reinterpret_cast<const char*>(&entry->element_count),
+                sizeof(entry->element_count));
+    key->append(static_cast<const char*>(entry->GetData()), num_bytes);
+  }
+  return true;
+}
+
+bool ResultMetadataCache::Entry::Matches(
+    size_t hash, OpMetadataFn metadata_fn, string_view attrs_key,
+    ArrayRef<TensorMetadata> argument_mds) const {
+  return this->hash == hash && this->metadata_fn == metadata_fn &&
+         this->attrs_key == attrs_key &&
+         ArrayRef<TensorMetadata>(this->argument_mds) == argument_mds;
+}
+
+size_t ResultMetadataCache::Hash(OpMetadataFn metadata_fn,
+                                 string_view attrs_key,
+                                 ArrayRef<TensorMetadata> argument_mds) {
+  llvm::hash_code hash =
+      llvm::hash_combine(reinterpret_cast<const void*>(metadata_fn),
+                         llvm::hash_combine_range(attrs_key.begin(),
+                                                  attrs_key.end()));
+  for (const TensorMetadata& md : argument_mds) {
+    hash = llvm::hash_combine(hash, static_cast<int>(md.dtype),
+                              md.shape.GetRank());
+    for (int i = 0, e = md.shape.GetRank(); i < e; ++i)
+      hash = llvm::hash_combine(hash, md.shape.GetDimensionSize(i));
+  }
+  return hash;
+}
+
+static metrics::Counter* GetHitCounter() {
+  static metrics::Counter* counter = metrics::NewCounter(
+      "/tensorflow/runtime/core_runtime/metadata_cache_hits");
+  return counter;
+}
+
+static metrics::Counter* GetMissCounter() {
+  static metrics::Counter* counter = metrics::NewCounter(
+      "/tensorflow/runtime/core_runtime/metadata_cache_misses");
+  return counter;
+}
+
+// Counts the generations that ended because the current table was full.
+static metrics::Counter* GetFullCounter() {
+  static metrics::Counter* counter = metrics::NewCounter(
+      "/tensorflow/runtime/core_runtime/metadata_cache_full");
+  return counter;
+}
+
+ResultMetadataCache::Table::Table()
+    : slots(new std::atomic<const Entry*>[kNumSlots]) {
+  for (size_t i = 0; i < kNumSlots; ++i)
+    slots[i].store(nullptr, std::memory_order_relaxed);
+}
+
+ResultMetadataCache::Table::~Table() {
+  for (size_t i = 0; i < kNumSlots; ++i)
+    delete slots[i].load(std::memory_order_relaxed);
+}
+
+const ResultMetadataCache::Entry* ResultMetadataCache::Table::Find(
+    size_t hash, OpMetadataFn metadata_fn, string_view attrs_key,
+    ArrayRef<TensorMetadata> argument_mds) const {
+  for (size_t probe = 0; probe < kMaxProbes; ++probe) {
+    const Entry* entry =
+        slots[(hash + probe) % kNumSlots].load(std::memory_order_acquire);
+    if (entry == nullptr) break;
+    if (entry->Matches(hash, metadata_fn, attrs_key, argument_mds))
+      return entry;
+  }
+  return nullptr;
+}
+
+ResultMetadataCache::ResultMetadataCache() {
+  mutex_lock lock(mu_);
+  current_ = std::make_shared<const Table>();
+  generations_.Publish(
+      std::make_unique<const Generations>(Generations{current_, nullptr}));
+}
+
+ResultMetadataCache::~ResultMetadataCache() = default;
+
+size_t ResultMetadataCache::size() const {
+  mutex_lock lock(mu_);
+  return num_entries_;
+}
+
+bool ResultMetadataCache::Lookup(
+    string_view op_name, OpMetadataFn metadata_fn, string_view attrs_key,
+    ArrayRef<TensorMetadata> argument_mds,
+    llvm::SmallVectorImpl<TensorMetadata>* result_mds) {
+  const size_t hash = Hash(metadata_fn, attrs_key, argument_mds);
+  bool in_previous = false;
+  const bool found = generations_.Read([&](const Generations* generations) {
+    const Entry* entry =
+        generations->current->Find(hash, metadata_fn, attrs_key, argument_mds);
+    if (entry == nullptr && generations->previous) {
+      entry = generations->previous->Find(hash, metadata_fn, attrs_key,
+                                          argument_mds);
+      in_previous = entry != nullptr;
+    }
+    if (entry == nullptr) return false;
+    result_mds->assign(entry->result_mds.begin(), entry->result_mds.end());
+    return true;
+  });
+
+  if (!found) {
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    GetMissCounter()->Increment();
+    return false;
+  }
+  hits_.fetch_add(1, std::memory_order_relaxed);
+  GetHitCounter()->Increment();
+  // Keep the entries that are used in the current generation.
+  if (in_previous)
+    Insert(op_name, metadata_fn, attrs_key, argument_mds, *result_mds);
+  return true;
+}
+
+void ResultMetadataCache::Insert(string_view op_name, OpMetadataFn metadata_fn,
+                                 string_view attrs_key,
+                                 ArrayRef<TensorMetadata> argument_mds,
+                                 ArrayRef<TensorMetadata> result_mds) {
+  const size_t hash = Hash(metadata_fn, attrs_key, argument_mds);
+
+  mutex_lock lock(mu_);
+  if (TryInsert(hash, op_name, metadata_fn, attrs_key, argument_mds,
+                result_mds))
+    return;
+
+  // The current table is full, or all the slots that a lookup would probe are
+  // taken. The entry always fits into the new table.
+  GetFullCounter()->Increment();
+  StartGeneration();
+  TryInsert(hash, op_name, metadata_fn, attrs_key, argument_mds, result_mds);
+}
+
+bool ResultMetadataCache::TryInsert(size_t hash, string_view op_name,
+                                    OpMetadataFn metadata_fn,
+                                    string_view attrs_key,
+                                    ArrayRef<TensorMetadata> argument_mds,
+                                    ArrayRef<TensorMetadata> result_mds) {
+  for (size_t probe = 0; probe < kMaxProbes; ++probe) {
+    std::atomic<const Entry*>& slot =
+        current_->slots[(hash + probe) % kNumSlots];
+    const Entry* entry = slot.load(std::memory_order_relaxed);
+    if (entry == nullptr) {
+      size_t& num_op_entries = num_entries_per_op_[std::string(op_name)];
+      if (num_entries_ >= kMaxEntries || num_op_entries >= kMaxEntriesPerOp)
+        return false;
+      slot.store(new Entry{hash, metadata_fn, attrs_key.str(),
+                           {argument_mds.begin(), argument_mds.end()},
+                           {result_mds.begin(), result_mds.end()}},
+                 std::memory_order_release);
+      ++num_entries_;
+      ++num_op_entries;
+      return true;
+    }
+    // Another thread inserted the same results first.
+    if (entry->Matches(hash, metadata_fn, attrs_key, argument_mds)) return true;
+  }
+  return false;
+}
+
+void ResultMetadataCache::StartGeneration() {
+  // The lookups hold the previous table until the snapshot that refers to it
+  // is freed by Publish().
+  auto previous = std::move(current_);
+  current_ = std::make_shared<const Table>();
+  num_entries_ = 0;
+  num_entries_per_op_.clear();
+  generations_.Publish(std::make_unique<const Generations>(
+      Generations{current_, std::move(previous)}));
+}
+
+ResultMetadataCache& GetResultMetadataCache() {
+  static auto* cache = new ResultMetadataCache;
+  return *cache;
+}
+
+}  // namespace internal
+}  // namespace tfrt
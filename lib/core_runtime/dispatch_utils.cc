@@ -17,6 +17,9 @@
 
 #include "tfrt/core_runtime/dispatch_utils.h"
 
+#include <string>
+
+#include "tfrt/core_runtime/dispatch_cache.h"
 #include "tfrt/host_context/host_context.h"
 #include "tfrt/host_context/location.h"
 
@@ -65,7 +68,19 @@ MDFunctionExecResult ExecuteMetadataFunction(
     argument_mds.push_back(arg_md_av.get());
   }
 
+  // Eager clients tend to run the same op on the same shapes over and over, so
+  // look for the result metadata in the cache first.
+  static thread_local std::string attrs_key;
+  ResultMetadataCache& cache = GetResultMetadataCache();
+  bool cacheable = GetOpAttrsCacheKey(invocation.attrs, &attrs_key);
+  if (cacheable &&
+      cache.Lookup(invocation.op_name, metadata_fn, attrs_key, argument_mds,
+                   &result_mds) &&
+      result_mds.size() == invocation.results.size())
+    return MDFunctionExecResult::kSuccess;
+
   // Okay, the shapes are available as we expect, get the result metadata.
+  result_mds.clear();
   result_mds.resize(invocation.results.size());
 
   // TODO(tfrt-devs): Remove this tracing tag when finished debugging
@@ -78,6 +93,10 @@ MDFunctionExecResult ExecuteMetadataFunction(
     return MDFunctionExecResult::kError;
   }
 
+  if (cacheable) {
+    cache.Insert(invocation.op_name, metadata_fn, attrs_key, argument_mds,
+                 result_mds);
+  }
   return MDFunctionExecResult::kSuccess;
 }
 
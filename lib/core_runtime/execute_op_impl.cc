@@ -150,6 +150,21 @@ void ExecuteOpImpl(CoreRuntimeOp op, ArrayRef<AsyncValue *> args,
                    AggregateAttr op_attr_array,
                    AggregateAttr op_func_attr_array,
                    const ExecutionContext &exec_ctx) {
+  // Set up OpAttrs.
+  OpAttrs op_attrs;
+  SetUpOpAttrs(op_attr_array, &op_attrs);
+
+  // Set up OpAttrs specifically for function attributes.
+  SetUpOpFuncAttrs(op_func_attr_array, &op_attrs);
+
+  ExecuteOpImpl(op, args, op_chain, results, OpAttrsRef(op_attrs), exec_ctx);
+}
+
+void ExecuteOpImpl(const CoreRuntimeOp &op, ArrayRef<AsyncValue *> args,
+                   AsyncValueRef<Chain> *op_chain,
+                   MutableArrayRef<RCReference<AsyncValue>> results,
+                   const OpAttrsRef &op_attrs,
+                   const ExecutionContext &exec_ctx) {
   llvm::SmallVector<TensorHandle, 8> th_args;
   th_args.reserve(args.size());
 
@@ -167,14 +182,7 @@ void ExecuteOpImpl(CoreRuntimeOp op, ArrayRef<AsyncValue *> args,
   llvm::SmallVector<TensorHandle, 8> result_ths;
   result_ths.resize(results.size());
 
-  // Set up OpAttrs.
-  OpAttrs op_attrs;
-  SetUpOpAttrs(op_attr_array, &op_attrs);
-
-  // Set up OpAttrs specifically for function attributes.
-  SetUpOpFuncAttrs(op_func_attr_array, &op_attrs);
-
-  op(exec_ctx, th_args, OpAttrsRef(op_attrs), result_ths, op_chain);
+  op(exec_ctx, th_args, op_attrs, result_ths, op_chain);
 
   AsyncWaitForResultsFromTensorHandles(results, result_ths);
 }
@@ -187,8 +195,16 @@ void ExecuteOpImplSync(const CoreRuntimeOp &op,
   llvm::SmallVector<TensorHandle, 8> th_args;
   th_args.reserve(args.size());
 
-  for (auto &arg : args) {
-    th_args.push_back(arg.CopyRef());
+  // As in ExecuteOpImpl, move the TensorHandle if this kernel is the last user
+  // of the register, so that the op can forward the tensor buffer. The tensor
+  // handles are the trailing arguments of the kernel.
+  const int first_arg = frame->GetNumArgs() - args.size();
+  for (int i = 0, e = args.size(); i != e; ++i) {
+    if (frame->IsLastUseOfArgAt(first_arg + i)) {
+      th_args.push_back(std::move(args[i]));
+    } else {
+      th_args.push_back(args[i].CopyRef());
+    }
   }
 
   llvm::SmallVector<TensorHandle, 8> result_ths;
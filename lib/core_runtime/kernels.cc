@@ -17,8 +17,15 @@
 
 #include "tfrt/core_runtime/kernels.h"
 
+#include <atomic>
+#include <memory>
+#include <utility>
+
 #include "llvm/ADT/FunctionExtras.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
 #include "tfrt/core_runtime/core_runtime.h"
 #include "tfrt/core_runtime/execute_op_impl.h"
 #include "tfrt/core_runtime/logging_op_handler.h"
@@ -32,10 +39,13 @@
 #include "tfrt/host_context/chain.h"
 #include "tfrt/host_context/diagnostic.h"
 #include "tfrt/host_context/function.h"
+#include "tfrt/host_context/kernel_frame.h"
 #include "tfrt/host_context/kernel_utils.h"
 #include "tfrt/host_context/sync_kernel_utils.h"
 #include "tfrt/support/error_util.h"
+#include "tfrt/support/mutex.h"
 #include "tfrt/support/ref_count.h"
+#include "tfrt/support/thread_annotations.h"
 #include "tfrt/tensor/conversion_registry.h"
 #include "tfrt/tensor/dense_host_tensor.h"
 #include "tfrt/tensor/dense_host_tensor_view.h"
@@ -177,9 +187,11 @@ static llvm::Expected<TensorHandle> ConstStringTensor(
 }
 
 static llvm::Expected<TensorHandle> ConstDenseTensor(
-    DenseAttr value, const ExecutionContext &context) {
-  auto *host = context.host();
-  auto dht = DeserializeDenseHostTensorFromDenseAttr(value, host);
+    DenseAttr value, AsyncKernelFrame *frame) {
+  auto *host = frame->GetHostContext();
+  // The tensor refers to the BEF file or to the data of identical constants
+  // of other BEF files instead of copying the attribute on every execution.
+  auto dht = CreateConstantDenseHostTensor(value, *frame);
   if (!dht) return dht.takeError();
 
   auto metadata = dht->metadata();
@@ -195,18 +207,24 @@ static llvm::Expected<TensorHandle> ConstDenseTensor(
 template <typename DType>
 static llvm::Expected<TensorHandle> CreateDenseTensor(
     ArrayAttribute<int64_t> shape, ArrayAttribute<DType> value,
-    const ExecutionContext &context) {
-  auto *host = context.host();
+    AsyncKernelFrame *frame) {
+  auto *host = frame->GetHostContext();
 
   TensorMetadata metadata(GetDType<DType>(), shape.data());
-  auto dht = DenseHostTensor::MakeConstructedAsyncValueRef(metadata, host);
-  if (!dht) return MakeStringError("failed to allocate dense host tensor");
-
-  std::memcpy(dht->data(), value.data().data(), dht->DataSizeInBytes());
+  auto dht = CreateConstantDenseHostTensor(
+      metadata,
+      llvm::ArrayRef(reinterpret_cast<const uint8_t *>(value.data().data()),
+                     metadata.GetHostSizeInBytes()),
+      *frame);
+  if (!dht) return dht.takeError();
 
-  dht.SetStateConcrete();
+  auto tensor_ref =
+      MakeAvailableAsyncValueRef<DenseHostTensor>(std::move(*dht));
+  if (!tensor_ref)
+    return MakeStringError("failed to allocate dense host tensor");
 
-  return TensorHandle(host->GetHostDeviceRef(), metadata, std::move(dht));
+  return TensorHandle(host->GetHostDeviceRef(), metadata,
+                      std::move(tensor_ref));
 }
 
 static llvm::Expected<CoreRuntimeOp> GetCoreRuntimeOp(
@@ -219,22 +237,174 @@ static llvm::Expected<CoreRuntimeOp> GetCoreRuntimeOp(
   return core_rt->MakeOp(op_name, op_handler);
 }
 
+namespace {
+
+// The op and the attributes of a corert.executeop call site. The attributes
+// are fixed at the call site, so they are set up once, and the op is resolved
+// once for each op handler it runs on. The call site lives as long as the BEF
+// file, which may run under several CoreRuntimes, so the ops are keyed by the
+// id of their op handler rather than by its address, which a later op handler
+// may reuse.
+class ExecuteOpCallSiteState : public KernelCallSiteState {
+ public:
+  // The number of op handlers whose ops are cached. The op is resolved on every
+  // execution for further op handlers.
+  static constexpr int kMaxCachedOps = 4;
+
+  ExecuteOpCallSiteState(AggregateAttr op_attr_array,
+                         AggregateAttr op_func_attr_array)
+      : attrs_(FreezeOpAttrs(op_attr_array, op_func_attr_array)) {}
+
+  ~ExecuteOpCallSiteState() override {
+    CachedOp *op = ops_.load(std::memory_order_relaxed);
+    while (op != nullptr) delete std::exchange(op, op->next);
+  }
+
+  const OpAttrsRef &attrs() const { return attrs_; }
+
+  // Return the op cached for `op_handler`, or null. This does not block.
+  const CoreRuntimeOp *FindOp(OpHandler *op_handler) const {
+    for (const CachedOp *op = ops_.load(std::memory_order_acquire);
+         op != nullptr; op = op->next) {
+      if (op->op_handler_id == op_handler->id()) return &op->op;
+    }
+    return nullptr;
+  }
+
+  // Cache `*op` for `op_handler` by moving it, and return the cached op, which
+  // is the op cached by a concurrent execution if there is one. Return `op` if
+  // the cache is full.
+  const CoreRuntimeOp *AddOp(OpHandler *op_handler, CoreRuntimeOp *op) {
+    mutex_lock lock(mu_);
+    if (const CoreRuntimeOp *cached = FindOp(op_handler)) return cached;
+    if (num_ops_ == kMaxCachedOps) return op;
+    ++num_ops_;
+    auto *cached = new CachedOp{op_handler->id(), std::move(*op),
+                                ops_.load(std::memory_order_relaxed)};
+    ops_.store(cached, std::memory_order_release);
+    return &cached->op;
+  }
+
+ private:
+  struct CachedOp {
+    uint64_t op_handler_id;
+    CoreRuntimeOp op;
+    CachedOp *next;
+  };
+
+  static OpAttrsRef FreezeOpAttrs(AggregateAttr op_attr_array,
+                                  AggregateAttr op_func_attr_array) {
+    OpAttrs op_attrs;
+    SetUpOpAttrs(op_attr_array, &op_attrs);
+    SetUpOpFuncAttrs(op_func_attr_array, &op_attrs);
+    return op_attrs.freeze();
+  }
+
+  const OpAttrsRef attrs_;
+
+  // A list of the cached ops, which only grows, so that FindOp() can walk it
+  // without locking.
+  std::atomic<CachedOp *> ops_{nullptr};
+  mutex mu_;
+  int num_ops_ TFRT_GUARDED_BY(mu_) = 0;
+};
+
+// The states of the ops of a corert.executeop.seq_batch call site.
+class ExecuteOpSeqBatchCallSiteState : public KernelCallSiteState {
+ public:
+  ExecuteOpSeqBatchCallSiteState(AggregateAttr op_attrs,
+                                 AggregateAttr op_func_attrs) {
+    for (int i = 0, e = op_attrs.GetNumElements(); i < e; ++i) {
+      ops_.push_back(std::make_unique<ExecuteOpCallSiteState>(
+          op_attrs.GetAttributeOfType<AggregateAttr>(i),
+          op_func_attrs.GetAttributeOfType<AggregateAttr>(i)));
+    }
+  }
+
+  ExecuteOpCallSiteState *op(int index) const { return ops_[index].get(); }
+
+ private:
+  llvm::SmallVector<std::unique_ptr<ExecuteOpCallSiteState>, 4> ops_;
+};
+
+}  // namespace
+
+// Execute the `op_name` operation on `op_handler` and allocate its `results`.
+// The op and the attributes are taken from the call site `state` and cached
+// there, or set up for this execution only if `state` is null.
+static llvm::Error ExecuteOpWithState(
+    ExecuteOpCallSiteState *state, OpHandler *op_handler,
+    ArrayRef<AsyncValue *> args, AsyncValueRef<Chain> *op_chain,
+    MutableArrayRef<RCReference<AsyncValue>> results,
+    AggregateAttr op_attr_array, AggregateAttr op_func_attr_array,
+    string_view op_name, const ExecutionContext &exec_ctx) {
+  auto allocate_results = [&] {
+    for (auto &result : results)
+      result = MakeUnconstructedAsyncValueRef<TensorHandle>().ReleaseRCRef();
+  };
+
+  if (state == nullptr) {
+    auto expected_op = GetCoreRuntimeOp(op_name, op_handler, exec_ctx);
+    if (!expected_op) return expected_op.takeError();
+
+    allocate_results();
+    ExecuteOpImpl(std::move(expected_op.get()), args, op_chain, results,
+                  op_attr_array, op_func_attr_array, exec_ctx);
+    return llvm::Error::success();
+  }
+
+  const CoreRuntimeOp *op = state->FindOp(op_handler);
+  CoreRuntimeOp uncached_op;
+  if (op == nullptr) {
+    auto expected_op = GetCoreRuntimeOp(op_name, op_handler, exec_ctx);
+    if (!expected_op) return expected_op.takeError();
+    uncached_op = std::move(expected_op.get());
+    op = state->AddOp(op_handler, &uncached_op);
+  }
+
+  allocate_results();
+  ExecuteOpImpl(*op, args, op_chain, results, state->attrs(), exec_ctx);
+  return llvm::Error::success();
+}
+
+// Execute the `op_name` operation of a corert.executeop or corert.executeop.seq
+// call site on `op_handler`. The op and the attributes are cached at the call
+// site if the caller keeps call site state, so that steady-state executions
+// neither look up the op nor set up the attributes. Return false if an error
+// was reported to all results instead.
+static bool ExecuteOpAtCallSite(OpHandler *op_handler, RemainingArguments args,
+                                AsyncValueRef<Chain> *op_chain,
+                                RemainingResults results,
+                                AggregateAttr op_attr_array,
+                                AggregateAttr op_func_attr_array,
+                                StringAttr op_name, KernelErrorHandler handler,
+                                AsyncKernelFrame *frame) {
+  ExecuteOpCallSiteState *state = nullptr;
+  if (KernelCallSiteSlot *slot = frame->GetCallSiteSlot()) {
+    state = &slot->GetOrCreate<ExecuteOpCallSiteState>([&] {
+      return std::make_unique<ExecuteOpCallSiteState>(op_attr_array,
+                                                      op_func_attr_array);
+    });
+  }
+
+  if (auto error = ExecuteOpWithState(
+          state, op_handler, args.values(), op_chain, results.values(),
+          op_attr_array, op_func_attr_array, op_name.GetValue(),
+          frame->GetExecutionContext())) {
+    handler.ReportError(StrCat(error));
+    return false;
+  }
+  return true;
+}
+
 // ExecuteOp executes the `op_name` operation on the `op_handler`.
 static void ExecuteOp(Argument<OpHandler *> op_handler, RemainingArguments args,
                       RemainingResults results, AggregateAttr op_attr_array,
                       AggregateAttr op_func_attr_array, StringAttr op_name,
-                      KernelErrorHandler handler,
-                      const ExecutionContext &exec_ctx) {
-  auto expected_op =
-      GetCoreRuntimeOp(op_name.GetValue(), op_handler.get(), exec_ctx);
-  if (!expected_op) return handler.ReportError(StrCat(expected_op.takeError()));
-
-  for (int b = 0, e = results.size(); b < e; ++b)
-    results.AllocateAt<TensorHandle>(b);
-
-  ExecuteOpImpl(std::move(expected_op.get()), args.values(),
-                /*op_chain=*/nullptr, results.values(), op_attr_array,
-                op_func_attr_array, exec_ctx);
+                      KernelErrorHandler handler, AsyncKernelFrame *frame) {
+  ExecuteOpAtCallSite(op_handler.get(), args, /*op_chain=*/nullptr, results,
+                      op_attr_array, op_func_attr_array, op_name, handler,
+                      frame);
 }
 
 // ExecuteOpSeq executes the `op_name` operation on the `op_handler`. It takes
@@ -246,18 +416,54 @@ static void ExecuteOpSeq(Argument<OpHandler *> op_handler,
                          Result<Chain> out_op_chain, RemainingResults results,
                          AggregateAttr op_attr_array,
                          AggregateAttr op_func_attr_array, StringAttr op_name,
-                         KernelErrorHandler handler,
-                         const ExecutionContext &exec_ctx) {
-  auto expected_op =
-      GetCoreRuntimeOp(op_name.GetValue(), op_handler.get(), exec_ctx);
-  if (!expected_op) return handler.ReportError(StrCat(expected_op.takeError()));
+                         KernelErrorHandler handler, AsyncKernelFrame *frame) {
+  auto op_chain = in_op_chain.ValueRef();
+  if (ExecuteOpAtCallSite(op_handler.get(), args, &op_chain, results,
+                          op_attr_array, op_func_attr_array, op_name, handler,
+                          frame)) {
+    out_op_chain.Set(std::move(op_chain));
+  }
+}
 
-  for (int b = 0, e = results.size(); b < e; ++b)
-    results.AllocateAt<TensorHandle>(b);
+// ExecuteOpSeqBatch executes the ops of a corert.executeop.seq_batch on the
+// `op_handler` back to back. Each op is sequenced after the previous one with
+// the op chain, as if they were a chain of corert.executeop.seq, and the
+// `out_op_chain` is the op chain produced by the last op.
+static void ExecuteOpSeqBatch(
+    Argument<OpHandler *> op_handler, Argument<Chain> in_op_chain,
+    RemainingArguments args, Result<Chain> out_op_chain,
+    RemainingResults results, AggregateAttr op_attrs,
+    AggregateAttr op_func_attrs, AggregateAttr op_names,
+    ArrayAttribute<int32_t> op_num_args, ArrayAttribute<int32_t> op_num_results,
+    KernelErrorHandler handler, AsyncKernelFrame *frame) {
+  ExecuteOpSeqBatchCallSiteState *state = nullptr;
+  if (KernelCallSiteSlot *slot = frame->GetCallSiteSlot()) {
+    state = &slot->GetOrCreate<ExecuteOpSeqBatchCallSiteState>([&] {
+      return std::make_unique<ExecuteOpSeqBatchCallSiteState>(op_attrs,
+                                                              op_func_attrs);
+    });
+  }
 
   auto op_chain = in_op_chain.ValueRef();
-  ExecuteOpImpl(std::move(expected_op.get()), args.values(), &op_chain,
-                results.values(), op_attr_array, op_func_attr_array, exec_ctx);
+  ArrayRef<AsyncValue *> op_args = args.values();
+  MutableArrayRef<RCReference<AsyncValue>> op_results = results.values();
+  for (int i = 0, e = op_names.GetNumElements(); i < e; ++i) {
+    if (auto error = ExecuteOpWithState(
+            state ? state->op(i) : nullptr, op_handler.get(),
+            op_args.take_front(op_num_args[i]), &op_chain,
+            op_results.take_front(op_num_results[i]),
+            op_attrs.GetAttributeOfType<AggregateAttr>(i),
+            op_func_attrs.GetAttributeOfType<AggregateAttr>(i),
+            op_names.GetAttributeOfType<StringAttr>(i).GetValue(),
+            frame->GetExecutionContext())) {
+      // The results of the following ops and the op chain become errors, as
+      // a failing corert.executeop.seq would leave them.
+      handler.ReportError(StrCat(error));
+      return;
+    }
+    op_args = op_args.drop_front(op_num_args[i]);
+    op_results = op_results.drop_front(op_num_results[i]);
+  }
   out_op_chain.Set(std::move(op_chain));
 }
 
@@ -305,6 +511,54 @@ static tfrt::Expected<OpHandler *> GetOpHandler(
   return tfrt::MakeStringError("op_handler not found: ", op_handler_name.get());
 }
 
+// corert_sync.get_op_handler returns the op handler registered as
+// `device_name`.
+static void SyncGetOpHandler(SyncKernelFrame *frame) {
+  auto *runtime = CoreRuntime::GetFromHostContext(frame->GetHostContext());
+  assert(runtime);
+
+  string_view op_handler_name = frame->GetStringAttribute(0).get();
+  if (auto *op_handler = runtime->GetOpHandler(op_handler_name)) {
+    frame->EmplaceResultAt<OpHandler *>(0, op_handler);
+    return;
+  }
+  frame->SetError(
+      tfrt::MakeStringError("op_handler not found: ", op_handler_name));
+}
+
+// corert_sync.executeop dispatches the `op_name` operation on the op handler
+// in the first argument. The ops are cached by the CoreRuntime. As with
+// corert.executeop, the resulting TensorHandles may still be computed
+// asynchronously when the kernel returns.
+static void SyncExecuteOp(SyncKernelFrame *frame) {
+  const ExecutionContext &exec_ctx = frame->GetExecutionContext();
+  auto *runtime = CoreRuntime::GetFromHostContext(exec_ctx.host());
+  assert(runtime);
+
+  auto *op_handler = frame->GetArgAt<OpHandler *>(0);
+  // The attributes are sorted by name: op_attrs, op_name.
+  OpAttrs op_attrs;
+  SetUpOpAttrs(frame->GetAggregateAttr(0), &op_attrs);
+  string_view op_name = frame->GetStringAttribute(1).get();
+
+  // As in ExecuteOpImpl, move the TensorHandle if this kernel is the last user
+  // of the register, so that the op can forward the tensor buffer.
+  llvm::SmallVector<TensorHandle, 8> args;
+  args.reserve(frame->GetNumArgs() - 1);
+  for (int i = 1, e = frame->GetNumArgs(); i != e; ++i) {
+    auto &arg = frame->GetArgAt<TensorHandle>(i);
+    args.push_back(frame->IsLastUseOfArgAt(i) ? std::move(arg)
+                                              : arg.CopyRef());
+  }
+
+  llvm::SmallVector<TensorHandle, 8> results(frame->GetNumResults());
+  runtime->Execute(exec_ctx, op_name, op_handler, args, OpAttrsRef(op_attrs),
+                   results, /*chain=*/nullptr);
+
+  for (int i = 0, e = results.size(); i != e; ++i)
+    frame->EmplaceResultAt<TensorHandle>(i, std::move(results[i]));
+}
+
 static Chain RegisterOpHandler(Argument<OpHandler *> root,
                                StringAttribute chain_name,
                                const ExecutionContext &exec_ctx) {
@@ -328,6 +582,22 @@ void CreateLoggingOpHandlerKernel(Argument<OpHandler *> fallback,
   op_handler.Emplace(op_handler_ptr.get());
 }
 
+// Creates an AsyncLoggingOpHandler that writes the op log to the file at
+// `path`.
+static llvm::Expected<OpHandler *> CreateAsyncLoggingOpHandlerKernel(
+    Argument<OpHandler *> fallback, StringAttribute path,
+    const ExecutionContext &exec_ctx) {
+  auto *runtime = tfrt::CoreRuntime::GetFromHostContext(exec_ctx.host());
+  assert(runtime);
+  std::error_code error_code;
+  auto os = std::make_unique<llvm::raw_fd_ostream>(path.get(), error_code,
+                                                   llvm::sys::fs::OF_None);
+  if (error_code)
+    return MakeStringError("error opening file ", path.get(), ": ",
+                           error_code.message());
+  return CreateAsyncLoggingOpHandler(runtime, fallback.get(), std::move(os));
+}
+
 static bool GetDHTPredicateValue(const DenseHostTensor &dht) {
   switch (dht.dtype()) {
     default:
@@ -912,14 +1182,20 @@ void RegisterCoreRuntimeKernels(KernelRegistry *registry) {
   registry->AddKernel("corert.op_attrs_set.str", TFRT_KERNEL(OpAttrsSetString));
   registry->AddKernel("corert.executeop", TFRT_KERNEL(ExecuteOp));
   registry->AddKernel("corert.executeop.seq", TFRT_KERNEL(ExecuteOpSeq));
+  registry->AddKernel("corert.executeop.seq_batch",
+                      TFRT_KERNEL(ExecuteOpSeqBatch));
   registry->AddKernel("corert.execute_crt_op",
                       TFRT_KERNEL(ExecuteCoreRuntimeOp));
   registry->AddKernel("corert.make_composite_op", TFRT_KERNEL(MakeCompositeOp));
   registry->AddKernel("corert.get_op_handler", TFRT_KERNEL(GetOpHandler));
   registry->AddKernel("corert.register_op_handler",
                       TFRT_KERNEL(RegisterOpHandler));
+  registry->AddSyncKernel("corert_sync.get_op_handler", SyncGetOpHandler);
+  registry->AddSyncKernel("corert_sync.executeop", SyncExecuteOp);
   registry->AddKernel("corert.create_logging_op_handler",
                       TFRT_KERNEL(CreateLoggingOpHandlerKernel));
+  registry->AddKernel("corert.create_async_logging_op_handler",
+                      TFRT_KERNEL(CreateAsyncLoggingOpHandlerKernel));
   registry->AddKernel("corert.const_dense_tensor",
                       TFRT_KERNEL(ConstDenseTensor));
   registry->AddKernel("corert.const_string_tensor",
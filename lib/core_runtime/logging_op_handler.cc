@@ -12,7 +12,8 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
-// This file implements the LoggingOpHandler class and the hooks to create it.
+// This file implements the LoggingOpHandler and AsyncLoggingOpHandler classes
+// and the hooks to create them.
 
 #if defined(_MSC_VER)
 #include <io.h>
@@ -32,8 +33,12 @@
 #endif
 
 #include <system_error>
+#include <thread>
+#include <unordered_map>
 
+#include "llvm/ADT/StringMap.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/LEB128.h"
 #include "llvm/Support/raw_ostream.h"
 #include "tfrt/core_runtime/core_runtime.h"
 #include "tfrt/core_runtime/kernels.h"
@@ -51,6 +56,7 @@
 #include "tfrt/tensor/host_tensor.h"
 #include "tfrt/tensor/string_host_tensor.h"
 #include "tfrt/tensor/tensor.h"
+#include "tfrt/tracing/trace_buffers.h"
 
 namespace tfrt {
 
@@ -307,4 +313,313 @@ llvm::Expected<tfrt::OpHandler *> CreateLoggingOpHandler(
   return op_handler_ptr;
 }
 
+//===----------------------------------------------------------------------===//
+// AsyncLoggingOpHandler
+//===----------------------------------------------------------------------===//
+
+// The log starts with kOpLogMagic followed by kOpLogVersion. Every entry then
+// starts with its OpLogTag. All integers are ULEB128 encoded:
+//
+//   kOpName:  op_id name_size name_bytes
+//   kOp:      op_id thread_index begin_ns duration_ns num_arguments
+//             num_results shape*
+//   kDropped: num_dropped
+//
+// An op name entry precedes the first op entry with its op_id. A shape is the
+// rank plus one, or zero if the shape is unknown, followed by the dimensions.
+// A dropped entry holds the total number of records dropped so far.
+static constexpr char kOpLogMagic[] = "TFOL";
+static constexpr uint64_t kOpLogVersion = 1;
+
+namespace {
+
+enum OpLogTag : uint64_t { kOpName = 0, kOp = 1, kDropped = 2 };
+
+// What the dispatching threads record. Kept small and free of allocations for
+// ops of low rank, since a buffer of them is allocated per thread.
+struct OpLogEvent {
+  uint32_t op_id = 0;
+  uint32_t num_arguments = 0;
+  uint32_t num_results = 0;
+  uint64_t begin_ns = 0;
+  uint64_t duration_ns = 0;
+  // The rank, or -1 if the shape is unknown, followed by the dimensions of
+  // every argument and then every result.
+  llvm::SmallVector<int64_t, 8> shapes;
+};
+
+void AppendShapes(ArrayRef<TensorHandle> tensor_handles,
+                  llvm::SmallVectorImpl<int64_t> *shapes) {
+  for (auto &th : tensor_handles) {
+    if (!th.IsValid() || !th.IsMetadataAvailable()) {
+      shapes->push_back(-1);
+      continue;
+    }
+    const TensorShape &shape = th.GetAvailableMetadata().shape;
+    const int rank = shape.GetRank();
+    shapes->push_back(rank);
+    for (int i = 0; i < rank; ++i)
+      shapes->push_back(shape.GetDimensionSize(i));
+  }
+}
+
+class AsyncLoggingOpHandler : public OpHandler {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  AsyncLoggingOpHandler(CoreRuntime *runtime, OpHandler *fallback,
+                        std::unique_ptr<llvm::raw_ostream> os,
+                        std::chrono::milliseconds flush_interval,
+                        size_t capacity_per_thread)
+      : OpHandler("async_logging", runtime, fallback),
+        start_(Clock::now()),
+        os_(std::move(os)),
+        buffers_(capacity_per_thread) {
+    *os_ << kOpLogMagic;
+    llvm::encodeULEB128(kOpLogVersion, *os_);
+    // Started last, as the collector thread writes to os_.
+    collector_ = std::make_unique<tracing::EventCollector<OpLogEvent>>(
+        &buffers_, flush_interval,
+        [this](std::thread::id tid, OpLogEvent &&event) { Write(tid, event); });
+  }
+
+  ~AsyncLoggingOpHandler() override {
+    // Joins the collector thread after it wrote the remaining records.
+    collector_.reset();
+    WriteDropped();
+    os_->flush();
+  }
+
+  Expected<CoreRuntimeOp> MakeOp(string_view op_name) override;
+
+ private:
+  uint32_t GetOrCreateOpId(string_view op_name) {
+    mutex_lock lock(mu_);
+    auto it = op_ids_.try_emplace(op_name, op_names_.size()).first;
+    if (it->second == op_names_.size()) op_names_.push_back(op_name.str());
+    return it->second;
+  }
+
+  // Only called on the collector thread, or after it stopped.
+  void Write(std::thread::id tid, const OpLogEvent &event) {
+    if (event.op_id >= op_name_written_.size())
+      op_name_written_.resize(event.op_id + 1);
+    if (!op_name_written_[event.op_id]) {
+      std::string op_name;
+      {
+        mutex_lock lock(mu_);
+        op_name = op_names_[event.op_id];
+      }
+      llvm::encodeULEB128(kOpName, *os_);
+      llvm::encodeULEB128(event.op_id, *os_);
+      llvm::encodeULEB128(op_name.size(), *os_);
+      *os_ << op_name;
+      op_name_written_[event.op_id] = true;
+    }
+
+    auto thread_index =
+        thread_indices_.emplace(tid, thread_indices_.size()).first->second;
+    llvm::encodeULEB128(kOp, *os_);
+    llvm::encodeULEB128(event.op_id, *os_);
+    llvm::encodeULEB128(thread_index, *os_);
+    llvm::encodeULEB128(event.begin_ns, *os_);
+    llvm::encodeULEB128(event.duration_ns, *os_);
+    llvm::encodeULEB128(event.num_arguments, *os_);
+    llvm::encodeULEB128(event.num_results, *os_);
+    // Ranks and dimensions are never less than -1, so just offset them.
+    for (int64_t value : event.shapes) llvm::encodeULEB128(value + 1, *os_);
+
+    WriteDropped();
+  }
+
+  void WriteDropped() {
+    uint64_t num_dropped = buffers_.dropped();
+    if (num_dropped == num_dropped_written_) return;
+    llvm::encodeULEB128(kDropped, *os_);
+    llvm::encodeULEB128(num_dropped, *os_);
+    num_dropped_written_ = num_dropped;
+  }
+
+  const Clock::time_point start_;
+  const std::unique_ptr<llvm::raw_ostream> os_;
+  tracing::ThreadEventBuffers<OpLogEvent> buffers_;
+  std::unique_ptr<tracing::EventCollector<OpLogEvent>> collector_;
+
+  mutex mu_;
+  llvm::StringMap<uint32_t> op_ids_ TFRT_GUARDED_BY(mu_);
+  std::vector<std::string> op_names_ TFRT_GUARDED_BY(mu_);
+
+  // State of the writer.
+  std::vector<bool> op_name_written_;
+  std::unordered_map<std::thread::id, uint32_t> thread_indices_;
+  uint64_t num_dropped_written_ = 0;
+};
+
+}  // namespace
+
+Expected<CoreRuntimeOp> AsyncLoggingOpHandler::MakeOp(string_view op_name) {
+  auto fallback_handle = GetFallback()->MakeOp(op_name);
+  if (!fallback_handle) return fallback_handle.takeError();
+  return CoreRuntimeOp(
+      [this, op_id = GetOrCreateOpId(op_name),
+       fallback_handle =
+           std::move(fallback_handle.get())](const OpInvocation &invocation) {
+        OpLogEvent event;
+        event.op_id = op_id;
+        event.num_arguments = invocation.arguments.size();
+        event.num_results = invocation.results.size();
+        AppendShapes(invocation.arguments, &event.shapes);
+
+        auto begin = Clock::now();
+        fallback_handle(invocation);
+        auto end = Clock::now();
+
+        // Results whose metadata is computed asynchronously are not waited
+        // for.
+        AppendShapes(invocation.results, &event.shapes);
+        event.begin_ns =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(begin - start_)
+                .count();
+        event.duration_ns =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin)
+                .count();
+        buffers_.Record(std::move(event));
+      },
+      /*is_fallback=*/false);
+}
+
+llvm::Expected<tfrt::OpHandler *> CreateAsyncLoggingOpHandler(
+    tfrt::CoreRuntime *runtime, OpHandler *fallback,
+    std::unique_ptr<llvm::raw_ostream> os,
+    std::chrono::milliseconds flush_interval, size_t capacity_per_thread) {
+  if (!os) return MakeStringError("no stream to write the op log to");
+  auto op_handler = std::make_unique<AsyncLoggingOpHandler>(
+      runtime, fallback, std::move(os), flush_interval, capacity_per_thread);
+  auto op_handler_ptr = op_handler.get();
+  runtime->TakeOpHandler(std::move(op_handler));
+  return op_handler_ptr;
+}
+
+namespace {
+
+// Reads the integers and bytes of an op log in order.
+class OpLogReader {
+ public:
+  explicit OpLogReader(string_view log)
+      : ptr_(reinterpret_cast<const uint8_t *>(log.data())),
+        end_(ptr_ + log.size()) {}
+
+  bool AtEnd() const { return ptr_ == end_; }
+
+  llvm::Expected<uint64_t> ReadInt() {
+    unsigned size = 0;
+    const char *error = nullptr;
+    uint64_t value = llvm::decodeULEB128(ptr_, &size, end_, &error);
+    if (error) return MakeStringError("malformed op log: ", error);
+    ptr_ += size;
+    return value;
+  }
+
+  llvm::Expected<string_view> ReadBytes(uint64_t size) {
+    if (size > static_cast<uint64_t>(end_ - ptr_))
+      return MakeStringError("malformed op log: truncated");
+    string_view bytes(reinterpret_cast<const char *>(ptr_), size);
+    ptr_ += size;
+    return bytes;
+  }
+
+  llvm::Error ReadShapes(uint64_t num_shapes,
+                         llvm::SmallVectorImpl<OpLogRecord::Shape> *shapes) {
+    shapes->clear();
+    for (uint64_t i = 0; i < num_shapes; ++i) {
+      auto rank = ReadInt();
+      if (!rank) return rank.takeError();
+      if (*rank == 0) {
+        shapes->emplace_back(std::nullopt);
+        continue;
+      }
+      auto &dims = shapes->emplace_back(std::in_place).value();
+      for (uint64_t j = 1; j < *rank; ++j) {
+        auto dim = ReadInt();
+        if (!dim) return dim.takeError();
+        dims.push_back(static_cast<int64_t>(*dim) - 1);
+      }
+    }
+    return llvm::Error::success();
+  }
+
+ private:
+  const uint8_t *ptr_;
+  const uint8_t *const end_;
+};
+
+}  // namespace
+
+llvm::Expected<uint64_t> DecodeOpLog(
+    string_view log, llvm::function_ref<void(const OpLogRecord &)> consume) {
+  OpLogReader reader(log);
+  auto magic = reader.ReadBytes(sizeof(kOpLogMagic) - 1);
+  if (!magic || *magic != kOpLogMagic) {
+    if (!magic) llvm::consumeError(magic.takeError());
+    return MakeStringError("not an op log");
+  }
+  auto version = reader.ReadInt();
+  if (!version) return version.takeError();
+  if (*version != kOpLogVersion)
+    return MakeStringError("unsupported op log version ", *version);
+
+  llvm::SmallVector<std::string, 16> op_names;
+  uint64_t num_dropped = 0;
+  OpLogRecord record;
+  while (!reader.AtEnd()) {
+    auto tag = reader.ReadInt();
+    if (!tag) return tag.takeError();
+
+    switch (*tag) {
+      case kOpName: {
+        auto op_id = reader.ReadInt();
+        if (!op_id) return op_id.takeError();
+        auto size = reader.ReadInt();
+        if (!size) return size.takeError();
+        auto name = reader.ReadBytes(*size);
+        if (!name) return name.takeError();
+        if (*op_id >= op_names.size()) op_names.resize(*op_id + 1);
+        op_names[*op_id] = name->str();
+        break;
+      }
+      case kOp: {
+        auto op_id = reader.ReadInt();
+        if (!op_id) return op_id.takeError();
+        if (*op_id >= op_names.size() || op_names[*op_id].empty())
+          return MakeStringError("malformed op log: unknown op id ", *op_id);
+        uint64_t fields[5];
+        for (uint64_t &field : fields) {
+          auto value = reader.ReadInt();
+          if (!value) return value.takeError();
+          field = *value;
+        }
+        record.op_name = op_names[*op_id];
+        record.thread_index = fields[0];
+        record.begin = std::chrono::nanoseconds(fields[1]);
+        record.duration = std::chrono::nanoseconds(fields[2]);
+        if (auto error = reader.ReadShapes(fields[3], &record.argument_shapes))
+          return std::move(error);
+        if (auto error = reader.ReadShapes(fields[4], &record.result_shapes))
+          return std::move(error);
+        consume(record);
+        break;
+      }
+      case kDropped: {
+        auto count = reader.ReadInt();
+        if (!count) return count.takeError();
+        num_dropped = *count;
+        break;
+      }
+      default:
+        return MakeStringError("malformed op log: unknown tag ", *tag);
+    }
+  }
+  return num_dropped;
+}
+
 }  // namespace tfrt
@@ -18,6 +18,7 @@
 
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/Support/Alignment.h"
 #include "llvm/Support/Allocator.h"
 #include "llvm/Support/MathExtras.h"
@@ -26,10 +27,22 @@
 #include "tfrt/core_runtime/op_attr_type.h"
 #include "tfrt/dtype/quantized_types.h"
 #include "tfrt/support/alloc.h"
+#include "tfrt/support/mutex.h"
 #include "tfrt/tensor/tensor_serialize_utils.h"
 
 namespace tfrt {
 
+OpAttrKey::OpAttrKey(string_view name) {
+  // The entries of a StringMap are allocated separately and hold a null
+  // terminated copy of their key, so the interned names never move.
+  static mutex *mu = new mutex;
+  static auto *names = new llvm::StringSet<>;
+
+  mutex_lock lock(*mu);
+  name_ = names->insert(name).first->getKeyData();
+  size_ = name.size();
+}
+
 OpAttrType GetOpAttrTypeFromDType(DType kind) {
   // TODO(tfrt-devs): Unify BEFAttributeType, OpAttrType and tfrt::DType.
   switch (kind) {
@@ -116,7 +129,7 @@ class ImmutableOpAttrs : public ReferenceCounted<ImmutableOpAttrs> {
  public:
   // Note: users should not directly interface with this class, they should
   // generally use OpAttrsRef instead.
-  const OpAttrsRawEntry *GetRaw(string_view attr_name) const;
+  const OpAttrsRawEntry *GetRaw(OpAttrName attr_name) const;
   size_t GetNumEntries() const { return num_entries_; }
   void IterateEntries(
       const std::function<void(const OpAttrsRawEntry &entry)> &fn) const;
@@ -126,13 +139,17 @@ class ImmutableOpAttrs : public ReferenceCounted<ImmutableOpAttrs> {
   friend class OpAttrs;
 
   static RCReference<ImmutableOpAttrs> create(const OpAttrs &attrs);
-  explicit ImmutableOpAttrs(size_t num_entries) : num_entries_(num_entries) {}
+  ImmutableOpAttrs(size_t num_entries, bool all_names_interned)
+      : num_entries_(num_entries), all_names_interned_(all_names_interned) {}
 
   void Destroy();
 
   // This is the number of entries in this set.
   size_t num_entries_;
 
+  // True if the names of all entries are interned names of OpAttrKeys.
+  bool all_names_interned_;
+
   // The entries_ array is tail allocated here, and followed by the payload
   // data for the attributes.
   OpAttrsRawEntry entries_[];
@@ -449,10 +466,19 @@ void OpAttrs::MoveOutOfLine() {
   out_of_line_representation_ = std::make_unique<OutOfLineRepresentation>(this);
 }
 
-const OpAttrsRawEntry *OpAttrs::GetRaw(string_view attr_name) const {
+const OpAttrsRawEntry *OpAttrs::GetRaw(OpAttrName attr_name) const {
   // If we are using an out of line representation, delegate to it.
   if (auto *out_of_line = out_of_line_representation_.get())
-    return out_of_line->GetRaw(attr_name);
+    return out_of_line->GetRaw(attr_name.str());
+
+  // The entries set with an OpAttrKey share the interned name of the key.
+  if (attr_name.IsInterned()) {
+    for (size_t i = 0, e = num_inline_entries_; i != e; ++i) {
+      auto &entry = inline_entries_[i];
+      if (entry.name == attr_name.data()) return &entry;
+    }
+    if (all_names_interned_) return nullptr;
+  }
 
   for (size_t i = 0, e = num_inline_entries_; i != e; ++i) {
     auto &entry = inline_entries_[i];
@@ -464,11 +490,12 @@ const OpAttrsRawEntry *OpAttrs::GetRaw(string_view attr_name) const {
 void OpAttrs::Reset() {
   inline_buffer_used_ = 0;
   num_inline_entries_ = 0;
+  all_names_interned_ = true;
   if (out_of_line_representation_) out_of_line_representation_.reset();
   frozen_representation_.reset();
 }
 
-bool OpAttrs::SetRaw(string_view attr_name, const void *data, OpAttrType type,
+bool OpAttrs::SetRaw(OpAttrName attr_name, const void *data, OpAttrType type,
                      uint32_t element_count, OpAttrsRawEntryType entry_type) {
   // If element_count > 1, the entry must be an array.
   assert(element_count <= 1 || entry_type == OpAttrsRawEntryType::kArray ||
@@ -480,40 +507,43 @@ bool OpAttrs::SetRaw(string_view attr_name, const void *data, OpAttrType type,
 
   // If we are using an out of line representation, delegate to it.
   if (auto *out_of_line = out_of_line_representation_.get())
-    return out_of_line->SetRaw(attr_name, data, type, element_count,
+    return out_of_line->SetRaw(attr_name.str(), data, type, element_count,
                                entry_type);
 
   // Otherwise, we need to find out if this entry has already been installed.
   // If so, we return failure.
-  for (size_t i = 0, e = num_inline_entries_; i != e; ++i) {
-    auto &entry = inline_entries_[i];
-    if (strcmp(attr_name.data(), entry.name) == 0) return false;
-  }
+  if (GetRaw(attr_name)) return false;
 
   // Ok, we're going to do an insertion.  If we are out of space in
   // inline_entries_  then we have to move out of line.
   if (num_inline_entries_ == kInlineEntriesSize) {
     MoveOutOfLine();
-    return out_of_line_representation_->SetRaw(attr_name, data, type,
+    return out_of_line_representation_->SetRaw(attr_name.str(), data, type,
                                                element_count, entry_type);
   }
 
-  // We also need space in inline_buffer_.
-  auto *name_pointer = inline_buffer_ + inline_buffer_used_;
-  auto attr_name_size = attr_name.size();
-  inline_buffer_used_ += attr_name_size + 1;
+  // Interned names live forever, so the entry can point to them. Other names
+  // need space in inline_buffer_.
+  const char *name_pointer = attr_name.data();
+  if (!attr_name.IsInterned()) {
+    auto *name_buffer = inline_buffer_ + inline_buffer_used_;
+    auto attr_name_size = attr_name.size();
+    inline_buffer_used_ += attr_name_size + 1;
+
+    // If we are out of space, then switch to an out-of-line representation.
+    if (inline_buffer_used_ > kInlineBufferSize) {
+      MoveOutOfLine();
+      return out_of_line_representation_->SetRaw(attr_name.str(), data, type,
+                                                 element_count, entry_type);
+    }
 
-  // If we are out of space, then switch to an out-of-line representation.
-  if (inline_buffer_used_ > kInlineBufferSize) {
-    MoveOutOfLine();
-    return out_of_line_representation_->SetRaw(attr_name, data, type,
-                                               element_count, entry_type);
+    // Otherwise, we have space, so copy over the string.
+    memcpy(name_buffer, attr_name.data(), attr_name_size);
+    name_buffer[attr_name_size] = 0;  // Null terminate C string.
+    name_pointer = name_buffer;
+    all_names_interned_ = false;
   }
 
-  // Otherwise, we have space, so copy over the string.
-  memcpy(name_pointer, attr_name.data(), attr_name_size);
-  name_pointer[attr_name_size] = 0;  // Null terminate C string.
-
   auto &entry = inline_entries_[num_inline_entries_++];
   entry.name = name_pointer;
   entry.type = type;
@@ -555,7 +585,7 @@ bool OpAttrs::SetRaw(string_view attr_name, const void *data, OpAttrType type,
   if (inline_buffer_used_ > kInlineBufferSize) {
     --num_inline_entries_;
     MoveOutOfLine();
-    return out_of_line_representation_->SetRaw(attr_name, data, type,
+    return out_of_line_representation_->SetRaw(attr_name.str(), data, type,
                                                element_count, entry_type);
   }
 
@@ -589,6 +619,10 @@ RCReference<ImmutableOpAttrs> ImmutableOpAttrs::create(const OpAttrs &attrs) {
   llvm::SmallVector<const OpAttrsRawEntry *, 16> sorted_attrs;
   GetSortedAttrs(OpAttrsRef(attrs), &sorted_attrs);
 
+  // Interned names are not copied.
+  const bool all_names_interned =
+      !attrs.IsOutOfLine() && attrs.all_names_interned_;
+
   // Figure out how much space we need to hold these attributes.
   size_t alloc_size =
       sizeof(ImmutableOpAttrs) + sizeof(OpAttrsRawEntry) * sorted_attrs.size();
@@ -603,7 +637,7 @@ RCReference<ImmutableOpAttrs> ImmutableOpAttrs::create(const OpAttrs &attrs) {
   // the name and the payload together:
   for (auto *entry : sorted_attrs) {
     // Space for the name and null terminator.
-    alloc_size += strlen(entry->name) + 1;
+    if (!all_names_interned) alloc_size += strlen(entry->name) + 1;
 
     if (entry->IsInternal()) {
       const auto type_size =
@@ -616,7 +650,8 @@ RCReference<ImmutableOpAttrs> ImmutableOpAttrs::create(const OpAttrs &attrs) {
 
   // Now that we know the size, create the result.
   auto *raw_memory = AlignedAlloc(alignof(ImmutableOpAttrs), alloc_size);
-  auto *result = new (raw_memory) ImmutableOpAttrs(sorted_attrs.size());
+  auto *result = new (raw_memory)
+      ImmutableOpAttrs(sorted_attrs.size(), all_names_interned);
 
   char *data_ptr = static_cast<char *>(raw_memory);
 
@@ -632,10 +667,14 @@ RCReference<ImmutableOpAttrs> ImmutableOpAttrs::create(const OpAttrs &attrs) {
     result_entry.type = src_entry.type;
 
     // Copy the name over.
-    result_entry.name = data_ptr + out_offset;
-    auto name_len = strlen(src_entry.name);
-    memcpy(data_ptr + out_offset, src_entry.name, name_len + 1);
-    out_offset += name_len + 1;
+    if (all_names_interned) {
+      result_entry.name = src_entry.name;
+    } else {
+      result_entry.name = data_ptr + out_offset;
+      auto name_len = strlen(src_entry.name);
+      memcpy(data_ptr + out_offset, src_entry.name, name_len + 1);
+      out_offset += name_len + 1;
+    }
 
     // For inlined buffer and externally allocated buffer,
     // copying buffer content is enough.
@@ -677,7 +716,15 @@ void ImmutableOpAttrs::Destroy() {
 
 // Look up an attribute by name, regardless of its underlying type.
 // On lookup failure, the result is null.
-const OpAttrsRawEntry *ImmutableOpAttrs::GetRaw(string_view attr_name) const {
+const OpAttrsRawEntry *ImmutableOpAttrs::GetRaw(OpAttrName attr_name) const {
+  // If all the names are interned, keys only need to compare pointers.
+  if (all_names_interned_ && attr_name.IsInterned()) {
+    for (size_t i = 0, e = num_entries_; i != e; ++i) {
+      if (entries_[i].name == attr_name.data()) return &entries_[i];
+    }
+    return nullptr;
+  }
+
   // If we only have a few entries, do a linear search for the name.
   // TODO(tf_runtime_team): implement a binary search for more elements.
   for (size_t i = 0, e = num_entries_; i != e; ++i) {
@@ -733,7 +780,7 @@ void OpAttrsRef::IterateEntries(
     return ptr->IterateEntries(fn);
 }
 
-const OpAttrsRawEntry *OpAttrsRef::GetRaw(string_view attr_name) const {
+const OpAttrsRawEntry *OpAttrsRef::GetRaw(OpAttrName attr_name) const {
   if (auto *ptr = attrs_.dyn_cast<const OpAttrs *>())
     return ptr->GetRaw(attr_name);
   if (auto *ptr = attrs_.dyn_cast<ImmutableOpAttrs *>())
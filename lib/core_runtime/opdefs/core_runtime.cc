@@ -336,6 +336,101 @@ LogicalResult ExecuteOp::fold(FoldAdaptor,
   return failure();
 }
 
+//===----------------------------------------------------------------------===//
+// ExecuteOpSeqBatch
+//===----------------------------------------------------------------------===//
+
+// Return the sum of the counts in `counts`, or -1 if one is negative.
+static int64_t SumOpCounts(ArrayAttr counts) {
+  int64_t sum = 0;
+  for (auto count : counts.getAsRange<IntegerAttr>()) {
+    if (count.getInt() < 0) return -1;
+    sum += count.getInt();
+  }
+  return sum;
+}
+
+LogicalResult ExecuteOpSeqBatch::verify() {
+  ExecuteOpSeqBatch op = *this;
+  size_t num_ops = op.getOpNames().size();
+  if (num_ops == 0) return op.emitOpError() << "requires at least one op";
+  if (op.getOpAttrs().size() != num_ops ||
+      op.getOpFuncAttrs().size() != num_ops ||
+      op.getOpNumArgs().size() != num_ops ||
+      op.getOpNumResults().size() != num_ops)
+    return op.emitOpError() << "requires op_attrs, op_func_attrs, op_num_args "
+                               "and op_num_results for each op";
+
+  for (auto attr : op.getOpAttrs()) {
+    auto op_attr_array = attr.dyn_cast<ArrayAttr>();
+    if (!op_attr_array)
+      return op.emitOpError() << "each op_attrs should be an array";
+    for (auto op_attr : op_attr_array) {
+      auto key_value = op_attr.dyn_cast<ArrayAttr>();
+      if (!key_value || key_value.size() != 2 ||
+          !key_value[0].isa<StringAttr>())
+        return op.emitOpError() << "each op_attr should be a key-value pair, "
+                                   "where the key is a string";
+    }
+  }
+  for (auto attr : op.getOpFuncAttrs()) {
+    if (!attr.isa<ArrayAttr>())
+      return op.emitOpError() << "each op_func_attrs should be an array";
+  }
+
+  if (SumOpCounts(op.getOpNumArgs()) !=
+      static_cast<int64_t>(op.getArguments().size()))
+    return op.emitOpError() << "op_num_args does not match the arguments";
+  if (SumOpCounts(op.getOpNumResults()) !=
+      static_cast<int64_t>(op.getResults().size()))
+    return op.emitOpError() << "op_num_results does not match the results";
+  return success();
+}
+
+ParseResult ExecuteOpSeqBatch::parse(OpAsmParser &parser,
+                                     OperationState &result) {
+  auto &builder = parser.getBuilder();
+  auto chain_type = builder.getType<compiler::ChainType>();
+  auto tensorhandle_type = builder.getType<TensorHandleType>();
+
+  SmallVector<OpAsmParser::UnresolvedOperand, 2> op_handler_and_in_chain;
+  SmallVector<OpAsmParser::UnresolvedOperand, 4> operands;
+  auto loc = parser.getNameLoc();
+  if (parser.parseOperandList(op_handler_and_in_chain,
+                              /*requiredOperandCount=*/2,
+                              OpAsmParser::Delimiter::Paren) ||
+      parser.parseOperandList(operands, OpAsmParser::Delimiter::Paren) ||
+      parser.parseOptionalAttrDict(result.attributes))
+    return failure();
+
+  int64_t num_results = 0;
+  if (succeeded(parser.parseOptionalColon())) {
+    IntegerAttr attr;
+    mlir::NamedAttrList attrs;
+    if (failed(parser.parseAttribute(attr, "num_results", attrs)))
+      return failure();
+    num_results = attr.getValue().getSExtValue();
+  }
+
+  SmallVector<Type, 2> operand_types{builder.getType<OpHandlerType>(),
+                                     chain_type};
+  if (parser.resolveOperands(op_handler_and_in_chain, operand_types, loc,
+                             result.operands) ||
+      parser.resolveOperands(operands, tensorhandle_type, result.operands))
+    return failure();
+
+  result.types.push_back(chain_type);
+  result.types.append(num_results, tensorhandle_type);
+  return success();
+}
+
+void ExecuteOpSeqBatch::print(OpAsmPrinter &p) {
+  p << "(" << getOpHandler() << ", " << getInOpChain() << ") ("
+    << getArguments() << ')';
+  p.printOptionalAttrDict((*this)->getAttrs());
+  if (!getResults().empty()) p << " : " << getResults().size();
+}
+
 //===----------------------------------------------------------------------===//
 // ConstDenseTensorOp
 //===----------------------------------------------------------------------===//
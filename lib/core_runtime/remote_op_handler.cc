@@ -0,0 +1,624 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements the remote op handler, RemoteOpServer and the loopback
+// RemoteOpTransport.
+
+#include "tfrt/core_runtime/remote_op_handler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "llvm/Support/raw_ostream.h"
+#include "tfrt/core_runtime/core_runtime.h"
+#include "tfrt/core_runtime/op_attrs.h"
+#include "tfrt/core_runtime/op_handler.h"
+#include "tfrt/core_runtime/op_invocation.h"
+#include "tfrt/host_context/async_dispatch.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/tensor/conversion_registry.h"
+#include "tfrt/tensor/conversion_utils.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+
+RemoteOpTransport::~RemoteOpTransport() = default;
+
+//===----------------------------------------------------------------------===//
+// RemoteTensor
+//===----------------------------------------------------------------------===//
+
+RemoteTensor::~RemoteTensor() {
+  // A moved-from tensor has no transport.
+  if (transport_) transport_->Release(remote_id_);
+}
+
+void RemoteTensor::Print(raw_ostream& os) const {
+  os << "RemoteTensor dtype = " << dtype() << ", shape = " << shape()
+     << ", remote_id = " << remote_id_;
+}
+
+static AsyncValueRef<DenseHostTensor> ConvertRemoteTensorToDenseHostTensor(
+    const RemoteTensor& tensor, const RemoteDevice& src, const CpuDevice& dst,
+    const ExecutionContext& exec_ctx) {
+  auto result = MakeUnconstructedAsyncValueRef<DenseHostTensor>();
+  tensor.transport()->Fetch(
+      tensor.remote_id(),
+      [result = result.CopyRef()](Expected<DenseHostTensorWireChunks> chunks) {
+        if (!chunks) {
+          result.SetError(absl::InternalError(toString(chunks.takeError())));
+          return;
+        }
+        auto dht = DeserializeDenseHostTensorFromWire(chunks->header,
+                                                      std::move(chunks->data));
+        if (!dht) {
+          result.SetError(absl::InternalError(toString(dht.takeError())));
+          return;
+        }
+        result.emplace(std::move(*dht));
+      });
+  return result;
+}
+
+void RegisterRemoteTensorConversionFn(TensorConversionFnRegistry* registry) {
+  registry->AddTensorConversionFn(
+      TFRT_CONVERSION(ConvertRemoteTensorToDenseHostTensor));
+}
+
+//===----------------------------------------------------------------------===//
+// Attribute serialization
+//===----------------------------------------------------------------------===//
+
+// Every attribute is serialized as its null-terminated name, its type, whether
+// it is an array, its element count and the size of its data in bytes,
+// followed by the data.
+bool SerializeOpAttrs(const OpAttrsRef& attrs, std::string* serialized) {
+  serialized->clear();
+  bool supported = true;
+  attrs.IterateEntries([&](const OpAttrsRawEntry& entry) {
+    switch (entry.type) {
+      case OpAttrType::UNSUPPORTED_RESOURCE:
+      case OpAttrType::UNSUPPORTED_VARIANT:
+      case OpAttrType::UNSUPPORTED_QUI8:
+      case OpAttrType::UNSUPPORTED_QUI16:
+      case OpAttrType::UNSUPPORTED_QI8:
+      case OpAttrType::UNSUPPORTED_QI16:
+      case OpAttrType::UNSUPPORTED_QI32:
+        supported = false;
+        return;
+      default:
+        break;
+    }
+
+    uint64_t num_bytes = 0;
+    if (entry.element_count > 0) {
+      num_bytes = GetHostSizeAndAlignment(entry.GetData(), entry.type).first;
+      // Dense, shape and aggregate attributes know their full size.
+      if (entry.IsArray()) num_bytes *= entry.element_count;
+    }
+
+    serialized->append(entry.name, std::strlen(entry.name) + 1);
+    serialized->push_back(static_cast<char>(entry.type));
+    serialized->push_back(entry.IsArray() ? 1 : 0);
+    serialized->append(reinterpret_cast<const char*>(&entry.element_count),
+                       sizeof(entry.element_count));
+    serialized->append(reinterpret_cast<const char*>(&num_bytes),
+                       sizeof(num_bytes));
+    serialized->append(static_cast<const char*>(entry.GetData()), num_bytes);
+  });
+  return supported;
+}
+
+// Reads a T from the front of `input`, and drops it from `input`.
+template <typename T>
+static bool ReadValue(string_view* input, T* value) {
+  if (input->size() < sizeof(T)) return false;
+  std::memcpy(value, input->data(), sizeof(T));
+  *input = input->drop_front(sizeof(T));
+  return true;
+}
+
+llvm::Error DeserializeOpAttrs(string_view serialized, OpAttrs* attrs) {
+  // The attribute data is read by the attribute decoders, so it is copied to
+  // an aligned buffer first.
+  std::vector<uint64_t> buffer;
+  while (!serialized.empty()) {
+    const size_t name_size = serialized.find('\0');
+    if (name_size == string_view::npos)
+      return MakeStringError("truncated op attributes");
+    const std::string name = serialized.take_front(name_size).str();
+    serialized = serialized.drop_front(name_size + 1);
+
+    uint8_t type, is_array;
+    uint32_t element_count;
+    uint64_t num_bytes;
+    if (!ReadValue(&serialized, &type) || !ReadValue(&serialized, &is_array) ||
+        !ReadValue(&serialized, &element_count) ||
+        !ReadValue(&serialized, &num_bytes) || serialized.size() < num_bytes)
+      return MakeStringError("truncated op attribute '", name, "'");
+
+    buffer.resize((num_bytes + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+    std::memcpy(buffer.data(), serialized.data(), num_bytes);
+    serialized = serialized.drop_front(num_bytes);
+
+    if (!attrs->SetRaw(name, buffer.data(), static_cast<OpAttrType>(type),
+                       element_count,
+                       is_array ? OpAttrsRawEntryType::kArray
+                                : OpAttrsRawEntryType::kScalar))
+      return MakeStringError("duplicate op attribute '", name, "'");
+  }
+  return llvm::Error::success();
+}
+
+//===----------------------------------------------------------------------===//
+// RemoteOpServer
+//===----------------------------------------------------------------------===//
+
+RemoteOpServer::RemoteOpServer(CoreRuntime* runtime, OpHandler* op_handler)
+    : runtime_(runtime), op_handler_(op_handler), chain_(GetReadyChain()) {}
+
+RemoteOpServer::~RemoteOpServer() = default;
+
+Expected<ExecutionContext> RemoteOpServer::CreateExecutionContext() {
+  auto req_ctx =
+      RequestContextBuilder(runtime_->GetHostContext(), &resource_context_)
+          .build();
+  if (!req_ctx) return req_ctx.takeError();
+  return ExecutionContext(std::move(*req_ctx));
+}
+
+Expected<const CoreRuntimeOp*> RemoteOpServer::GetOp(string_view op_name) {
+  auto it = ops_.find(op_name);
+  if (it != ops_.end()) return &it->second;
+  auto op = runtime_->MakeOp(op_name, op_handler_);
+  if (!op) return op.takeError();
+  return &ops_.try_emplace(op_name, std::move(*op)).first->second;
+}
+
+void RemoteOpServer::Handle(RemoteOpRequest request, RemoteOpDoneFn done) {
+  auto* host = runtime_->GetHostContext();
+  llvm::SmallVector<TensorHandle, 4> results(request.result_ids.size());
+
+  auto execute = [&]() -> llvm::Error {
+    auto op = GetOp(request.op_name);
+    if (!op) return op.takeError();
+    OpAttrs attrs;
+    if (auto error = DeserializeOpAttrs(request.attrs, &attrs)) return error;
+
+    llvm::SmallVector<TensorHandle, 4> arguments;
+    arguments.reserve(request.arguments.size());
+    for (auto& argument : request.arguments) {
+      if (argument.remote_id != RemoteOpArgument::kInlineTensor) {
+        mutex_lock lock(mu_);
+        auto it = tensors_.find(argument.remote_id);
+        if (it == tensors_.end())
+          return MakeStringError("unknown remote tensor ", argument.remote_id);
+        arguments.push_back(it->second.CopyRef());
+        continue;
+      }
+      auto dht = DeserializeDenseHostTensorFromWire(
+          argument.tensor.header, std::move(argument.tensor.data));
+      if (!dht) return dht.takeError();
+      auto metadata = dht->metadata();
+      arguments.emplace_back(
+          host->GetHostDeviceRef(), metadata,
+          MakeAvailableAsyncValueRef<DenseHostTensor>(std::move(*dht)));
+    }
+
+    auto exec_ctx = CreateExecutionContext();
+    if (!exec_ctx) return exec_ctx.takeError();
+    // An op that failed does not fail the ops after it.
+    if (chain_.IsError()) chain_ = GetReadyChain();
+    (**op)(*exec_ctx, arguments, attrs.freeze(), results, &chain_);
+    return llvm::Error::success();
+  };
+  if (auto error = execute()) {
+    RCReference<AsyncValue> error_value = MakeErrorAsyncValueRef(
+        absl::InternalError(toString(std::move(error))));
+    for (auto& result : results)
+      result = TensorHandle::CreateError(error_value);
+  }
+
+  // Keep the results for later requests, and respond once their metadata is
+  // available.
+  llvm::SmallVector<RCReference<AsyncValue>, 4> pending_metadata;
+  {
+    mutex_lock lock(mu_);
+    for (size_t i = 0, e = results.size(); i != e; ++i) {
+      if (!results[i].IsMetadataAvailable())
+        pending_metadata.push_back(results[i].GetAsyncMetadata().CopyRCRef());
+      tensors_.try_emplace(request.result_ids[i], results[i].CopyRef());
+    }
+  }
+
+  auto respond = [results = std::move(results),
+                  done = std::move(done)]() mutable {
+    llvm::SmallVector<RemoteOpResult, 4> remote_results(results.size());
+    for (size_t i = 0, e = results.size(); i != e; ++i) {
+      AsyncValue* tensor = results[i].GetAsyncTensor();
+      if (tensor->IsError()) {
+        remote_results[i].status = tensor->GetError();
+      } else if (results[i].IsMetadataAvailable()) {
+        remote_results[i].metadata = results[i].GetAvailableMetadata();
+      } else {
+        remote_results[i].status = results[i].GetAsyncMetadata().GetError();
+      }
+    }
+    done(std::move(remote_results));
+  };
+  if (pending_metadata.empty()) {
+    respond();
+  } else {
+    RunWhenReady(pending_metadata, std::move(respond));
+  }
+}
+
+void RemoteOpServer::Fetch(uint64_t remote_id, RemoteFetchDoneFn done) {
+  TensorHandle handle;
+  {
+    mutex_lock lock(mu_);
+    auto it = tensors_.find(remote_id);
+    if (it == tensors_.end()) {
+      done(MakeStringError("unknown remote tensor ", remote_id));
+      return;
+    }
+    handle = it->second.CopyRef();
+  }
+
+  auto exec_ctx = CreateExecutionContext();
+  if (!exec_ctx) {
+    done(exec_ctx.takeError());
+    return;
+  }
+  // This returns the tensor itself if it is a DenseHostTensor already, so the
+  // tensor data is not copied.
+  auto* host = runtime_->GetHostContext();
+  RCReference<AsyncValue> tensor =
+      handle
+          .TransferTo(*exec_ctx, host->GetHostDeviceRef(),
+                      DenseHostTensor::kTensorType)
+          .ReleaseTensorRef()
+          .ReleaseRCRef();
+  AsyncValue* tensor_ptr = tensor.get();
+  tensor_ptr->AndThen([tensor = std::move(tensor),
+                       done = std::move(done)]() mutable {
+    if (tensor->IsError()) {
+      done(MakeStringError(std::string(tensor->GetError().message())));
+      return;
+    }
+    done(SerializeDenseHostTensorToWire(tensor->get<DenseHostTensor>()));
+  });
+}
+
+void RemoteOpServer::Release(uint64_t remote_id) {
+  // Destroy the tensor after releasing the lock.
+  TensorHandle handle;
+  mutex_lock lock(mu_);
+  auto it = tensors_.find(remote_id);
+  if (it == tensors_.end()) return;
+  handle = std::move(it->second);
+  tensors_.erase(it);
+}
+
+size_t RemoteOpServer::GetNumTensors() const {
+  mutex_lock lock(mu_);
+  return tensors_.size();
+}
+
+//===----------------------------------------------------------------------===//
+// Loopback transport
+//===----------------------------------------------------------------------===//
+
+namespace {
+
+class LoopbackRemoteOpTransport : public RemoteOpTransport {
+ public:
+  LoopbackRemoteOpTransport(RemoteOpServer* server, HostContext* host)
+      : server_(server), host_(host) {}
+
+  void Send(RemoteOpRequest request, RemoteOpDoneFn done) override {
+    // The server handles one request at a time.
+    mutex_lock lock(mu_);
+    server_->Handle(
+        std::move(request),
+        [host = host_, done = std::move(done)](
+            llvm::SmallVector<RemoteOpResult, 4> results) mutable {
+          EnqueueWork(host, [done = std::move(done),
+                             results = std::move(results)]() mutable {
+            done(std::move(results));
+          });
+        });
+  }
+
+  void Fetch(uint64_t remote_id, RemoteFetchDoneFn done) override {
+    server_->Fetch(
+        remote_id, [host = host_, done = std::move(done)](
+                       Expected<DenseHostTensorWireChunks> chunks) mutable {
+          EnqueueWork(host, [done = std::move(done),
+                             chunks = std::move(chunks)]() mutable {
+            done(std::move(chunks));
+          });
+        });
+  }
+
+  void Release(uint64_t remote_id) override { server_->Release(remote_id); }
+
+ private:
+  RemoteOpServer* const server_;
+  HostContext* const host_;
+  mutex mu_;
+};
+
+}  // namespace
+
+std::unique_ptr<RemoteOpTransport> CreateLoopbackRemoteOpTransport(
+    RemoteOpServer* server, HostContext* host) {
+  return std::make_unique<LoopbackRemoteOpTransport>(server, host);
+}
+
+//===----------------------------------------------------------------------===//
+// RemoteOpHandler
+//===----------------------------------------------------------------------===//
+
+namespace {
+
+// An op whose request is not sent yet.
+struct PendingRemoteOp {
+  explicit PendingRemoteOp(const ExecutionContext& exec_ctx)
+      : exec_ctx(exec_ctx) {}
+
+  ExecutionContext exec_ctx;
+  RemoteOpRequest request;
+  llvm::SmallVector<TensorHandle, 4> arguments;
+  llvm::SmallVector<AsyncValueRef<TensorMetadata>, 4> result_metadata;
+  llvm::SmallVector<AsyncValueRef<RemoteTensor>, 4> result_tensors;
+  // The input chain and the result chain, or null if the op has no chain.
+  AsyncValueRef<Chain> chain;
+  AsyncValueRef<Chain> result_chain;
+};
+
+// Sends the requests of a RemoteOpHandler. It is shared with the callbacks of
+// the requests in flight, which may outlive the op handler.
+class RemoteOpClient : public std::enable_shared_from_this<RemoteOpClient> {
+ public:
+  RemoteOpClient(HostContext* host, RCReference<RemoteDevice> device,
+                 std::shared_ptr<RemoteOpTransport> transport)
+      : host_(host),
+        device_(std::move(device)),
+        transport_(std::move(transport)) {}
+
+  void Dispatch(string_view op_name, const OpInvocation& invocation);
+
+ private:
+  // Returns true if `tensor` can be sent as it is.
+  bool IsSendable(const Tensor& tensor) const;
+  // Sends `op` once its arguments and input chain are ready to be sent.
+  void TrySend(std::unique_ptr<PendingRemoteOp> op);
+  void SendLocked(std::unique_ptr<PendingRemoteOp> op) TFRT_REQUIRES(mu_);
+  void HandleResponse(const PendingRemoteOp& op,
+                      ArrayRef<uint64_t> result_ids,
+                      llvm::SmallVector<RemoteOpResult, 4> results);
+  void Fail(const PendingRemoteOp& op, const absl::Status& status);
+
+  HostContext* const host_;
+  const RCReference<RemoteDevice> device_;
+  const std::shared_ptr<RemoteOpTransport> transport_;
+
+  // Requests are sent while holding the lock, which keeps them in the order of
+  // their ids.
+  mutex mu_;
+  uint64_t next_id_ TFRT_GUARDED_BY(mu_) = RemoteOpArgument::kInlineTensor + 1;
+  // The ids of the results of the requests in flight. A result is available
+  // before it is removed, so that ops can always refer to it one way or the
+  // other.
+  llvm::DenseMap<AsyncValue*, uint64_t> sent_ids_ TFRT_GUARDED_BY(mu_);
+};
+
+void RemoteOpClient::Dispatch(string_view op_name,
+                              const OpInvocation& invocation) {
+  auto op = std::make_unique<PendingRemoteOp>(invocation.exec_ctx);
+  for (auto& result : invocation.results) {
+    auto metadata = MakeUnconstructedAsyncValueRef<TensorMetadata>();
+    auto tensor = MakeUnconstructedAsyncValueRef<RemoteTensor>();
+    result = TensorHandle(device_.CopyRef(), metadata.CopyRef(),
+                          AsyncValueRef<Tensor>(tensor.CopyRCRef()));
+    op->result_metadata.push_back(std::move(metadata));
+    op->result_tensors.push_back(std::move(tensor));
+  }
+  if (invocation.chain) {
+    op->chain = std::move(*invocation.chain);
+    op->result_chain = MakeUnconstructedAsyncValueRef<Chain>();
+    *invocation.chain = op->result_chain.CopyRef();
+  }
+
+  op->request.op_name = op_name.str();
+  if (!SerializeOpAttrs(invocation.attrs, &op->request.attrs)) {
+    Fail(*op, absl::InvalidArgumentError(StrCat(
+                  "op '", op_name, "' has attributes of unsupported types")));
+    return;
+  }
+  for (auto& argument : invocation.arguments)
+    op->arguments.push_back(std::move(argument));
+  TrySend(std::move(op));
+}
+
+bool RemoteOpClient::IsSendable(const Tensor& tensor) const {
+  if (auto* remote = llvm::dyn_cast<RemoteTensor>(&tensor))
+    return remote->transport() == transport_;
+  return llvm::isa<DenseHostTensor>(tensor);
+}
+
+void RemoteOpClient::TrySend(std::unique_ptr<PendingRemoteOp> op) {
+  if (op->chain && op->chain.IsError()) {
+    Fail(*op, op->chain.GetError());
+    return;
+  }
+  for (auto& argument : op->arguments) {
+    AsyncValue* tensor = argument.GetAsyncTensor();
+    if (!tensor->IsAvailable()) continue;
+    if (tensor->IsError()) {
+      Fail(*op, tensor->GetError());
+      return;
+    }
+    if (!IsSendable(tensor->get<Tensor>())) {
+      argument = argument.TransferTo(op->exec_ctx, host_->GetHostDeviceRef(),
+                                     DenseHostTensor::kTensorType);
+    }
+  }
+
+  llvm::SmallVector<RCReference<AsyncValue>, 4> pending;
+  if (op->chain && !op->chain.IsAvailable())
+    pending.push_back(op->chain.CopyRCRef());
+  {
+    mutex_lock lock(mu_);
+    // Retry once the arguments that are neither sendable nor results of the
+    // requests in flight are available. Arguments may have become available,
+    // or failed, since they were checked above.
+    for (auto& argument : op->arguments) {
+      AsyncValue* tensor = argument.GetAsyncTensor();
+      const bool ready = tensor->IsAvailable()
+                             ? !tensor->IsError() &&
+                                   IsSendable(tensor->get<Tensor>())
+                             : sent_ids_.count(tensor) > 0;
+      if (!ready) pending.push_back(FormRef(tensor));
+    }
+    if (pending.empty()) {
+      SendLocked(std::move(op));
+      return;
+    }
+  }
+  RunWhenReady(pending,
+               [self = shared_from_this(), op = std::move(op)]() mutable {
+                 self->TrySend(std::move(op));
+               });
+}
+
+void RemoteOpClient::SendLocked(std::unique_ptr<PendingRemoteOp> op) {
+  RemoteOpRequest request = std::move(op->request);
+  for (auto& argument : op->arguments) {
+    AsyncValue* tensor = argument.GetAsyncTensor();
+    RemoteOpArgument remote_argument;
+    if (!tensor->IsAvailable()) {
+      remote_argument.remote_id = sent_ids_.lookup(tensor);
+    } else if (auto* remote =
+                   llvm::dyn_cast<RemoteTensor>(&tensor->get<Tensor>())) {
+      remote_argument.remote_id = remote->remote_id();
+    } else {
+      remote_argument.tensor = SerializeDenseHostTensorToWire(
+          llvm::cast<DenseHostTensor>(tensor->get<Tensor>()));
+    }
+    request.arguments.push_back(std::move(remote_argument));
+  }
+  for (auto& tensor : op->result_tensors) {
+    const uint64_t id = next_id_++;
+    request.result_ids.push_back(id);
+    sent_ids_[tensor.GetAsyncValue()] = id;
+  }
+
+  // Destroying the arguments may release remote tensors, which must happen
+  // after the request that uses them is sent.
+  auto arguments = std::move(op->arguments);
+  llvm::SmallVector<uint64_t, 4> result_ids = request.result_ids;
+  transport_->Send(
+      std::move(request),
+      [self = shared_from_this(), op = std::move(op),
+       result_ids = std::move(result_ids)](
+          llvm::SmallVector<RemoteOpResult, 4> results) mutable {
+        self->HandleResponse(*op, result_ids, std::move(results));
+      });
+}
+
+void RemoteOpClient::HandleResponse(
+    const PendingRemoteOp& op, ArrayRef<uint64_t> result_ids,
+    llvm::SmallVector<RemoteOpResult, 4> results) {
+  if (results.size() != result_ids.size()) {
+    auto status = absl::InternalError(
+        StrCat("expected ", result_ids.size(),
+               " results from the remote op, but got ", results.size()));
+    results.assign(result_ids.size(), RemoteOpResult());
+    for (auto& result : results) result.status = status;
+  }
+
+  for (size_t i = 0, e = results.size(); i != e; ++i) {
+    const RemoteOpResult& result = results[i];
+    if (!result.status.ok()) {
+      op.result_metadata[i].SetError(result.status);
+      op.result_tensors[i].SetError(result.status);
+      transport_->Release(result_ids[i]);
+      continue;
+    }
+    op.result_metadata[i].emplace(result.metadata);
+    op.result_tensors[i].emplace(result.metadata, transport_, result_ids[i]);
+  }
+  if (op.result_chain) op.result_chain.emplace();
+
+  mutex_lock lock(mu_);
+  for (auto& tensor : op.result_tensors)
+    sent_ids_.erase(tensor.GetAsyncValue());
+}
+
+void RemoteOpClient::Fail(const PendingRemoteOp& op,
+                          const absl::Status& status) {
+  for (auto& metadata : op.result_metadata) metadata.SetError(status);
+  for (auto& tensor : op.result_tensors) tensor.SetError(status);
+  if (op.result_chain) op.result_chain.SetError(status);
+}
+
+class RemoteOpHandler : public OpHandler {
+ public:
+  RemoteOpHandler(CoreRuntime* runtime, RCReference<RemoteDevice> device,
+                  std::unique_ptr<RemoteOpTransport> transport)
+      : OpHandler("remote", runtime, /*fallback=*/nullptr),
+        device_(device.CopyRef()),
+        client_(std::make_shared<RemoteOpClient>(runtime->GetHostContext(),
+                                                 std::move(device),
+                                                 std::move(transport))) {}
+
+  Expected<CoreRuntimeOp> MakeOp(string_view op_name) override {
+    return CoreRuntimeOp(
+        [client = client_,
+         op_name = op_name.str()](const OpInvocation& invocation) {
+          client->Dispatch(op_name, invocation);
+        },
+        /*is_fallback=*/false, /*device=*/device_.CopyRef());
+  }
+
+ private:
+  RCReference<RemoteDevice> device_;
+  std::shared_ptr<RemoteOpClient> client_;
+};
+
+}  // namespace
+
+llvm::Expected<OpHandler*> CreateRemoteOpHandler(
+    CoreRuntime* runtime, string_view device_name,
+    std::unique_ptr<RemoteOpTransport> transport) {
+  if (!transport) return MakeStringError("invalid remote op transport");
+  auto device =
+      runtime->GetHostContext()->GetDeviceManager()->MaybeAddDevice(
+          TakeRef(new RemoteDevice(device_name)));
+  if (!device->IsDeviceType(RemoteDevice::kDeviceType))
+    return MakeStringError("device ", device_name, " is not a remote device");
+  auto op_handler = std::make_unique<RemoteOpHandler>(
+      runtime, std::move(device), std::move(transport));
+  auto* op_handler_ptr = op_handler.get();
+  runtime->TakeOpHandler(std::move(op_handler));
+  return op_handler_ptr;
+}
+
+}  // namespace tfrt
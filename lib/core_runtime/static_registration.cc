@@ -19,7 +19,9 @@
 #include "tfrt/core_runtime/kernels.h"
 #include "tfrt/core_runtime/logging_op_handler.h"
 #include "tfrt/core_runtime/op_handler.h"
+#include "tfrt/core_runtime/remote_op_handler.h"
 #include "tfrt/host_context/kernel_registry.h"
+#include "tfrt/tensor/conversion_registry.h"
 
 namespace tfrt {
 
@@ -31,4 +33,9 @@ static void RegisterKernels(KernelRegistry *registry) {
 
 TFRT_STATIC_KERNEL_REGISTRATION(RegisterKernels);
 
+static bool remote_conversion_fn_registration = []() {
+  AddStaticTensorConversionFn(RegisterRemoteTensorConversionFn);
+  return true;
+}();
+
 }  // namespace tfrt
@@ -22,7 +22,9 @@
 #include "tfrt/host_context/device.h"
 #include "tfrt/host_context/execution_context.h"
 #include "tfrt/host_context/host_context.h"
+#include "tfrt/support/error_util.h"
 #include "tfrt/tensor/conversion_registry.h"
+#include "tfrt/tensor/dense_host_tensor.h"
 #include "tfrt/tensor/tensor.h"
 #include "tfrt/tensor/tensor_type_registration.h"
 
@@ -157,6 +159,19 @@ TensorHandle TensorHandle::CreateError(RCReference<AsyncValue> error) {
   return TensorHandle(std::move(th));
 }
 
+Expected<TensorHandle> TensorHandle::CreateFromExternal(
+    HostContext* host, const TensorMetadata& metadata, void* ptr, size_t size,
+    HostBuffer::Deallocator deallocator) {
+  auto tensor = DenseHostTensor::CreateFromExternal(metadata, ptr, size,
+                                                    std::move(deallocator));
+  if (!tensor)
+    return MakeStringError("external buffer of ", size,
+                           " bytes is too small or misaligned for ", metadata);
+  return TensorHandle(
+      host->GetHostDeviceRef(), metadata,
+      MakeAvailableAsyncValueRef<DenseHostTensor>(std::move(*tensor)));
+}
+
 ErrorAsyncValue* TensorHandle::GetErrorAsyncValue() {
   assert(
       IsError() &&
@@ -0,0 +1,793 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements the kernels of the input pipeline stages. A stage pops
+// the values of its input channel, and pushes its own values to an output
+// channel whose capacity bounds how far it runs ahead of its consumer. Stages
+// resume on the work queue once their input has a value or their output has
+// room, so no thread is blocked while a stage waits.
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "tfrt/data/data_kernels.h"
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/async_dispatch.h"
+#include "tfrt/host_context/async_value.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/channel.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/function.h"
+#include "tfrt/host_context/kernel_utils.h"
+#include "tfrt/io/decompressing_input_stream.h"
+#include "tfrt/io/file_input_stream.h"
+#include "tfrt/io/file_system.h"
+#include "tfrt/io/record_reader.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/ref_count.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/string_host_tensor.h"
+#include "tfrt/tensor/tensor_shape.h"
+
+namespace tfrt {
+namespace data {
+namespace {
+
+using PoppedValue = std::optional<RCReference<AsyncValue>>;
+
+// Calls `run` on the work queue once `pushed` is available. A push fails if
+// the consumer closed the channel, and then the producer stops.
+void RunWhenPushed(HostContext* host, const AsyncValueRef<Chain>& pushed,
+                   llvm::unique_function<void()> run) {
+  pushed.AndThen([host, pushed = pushed.CopyRef(),
+                  run = std::move(run)]() mutable {
+    if (pushed.IsError()) return;
+    EnqueueWork(host, std::move(run));
+  });
+}
+
+// Returns a chain that is available once `a` and `b` are.
+AsyncValueRef<Chain> JoinChains(AsyncValueRef<Chain> a,
+                                AsyncValueRef<Chain> b) {
+  if (a.IsAvailable() && !a.IsError()) return b;
+  if (b.IsAvailable() && !b.IsError()) return a;
+  auto joined = MakeUnconstructedAsyncValueRef<Chain>();
+  AsyncValue* chains[] = {a.GetAsyncValue(), b.GetAsyncValue()};
+  RunWhenReady(chains, [a = std::move(a), b = std::move(b),
+                        joined = joined.CopyRef()] {
+    if (a.IsError())
+      joined.SetError(a.GetError());
+    else if (b.IsError())
+      joined.SetError(b.GetError());
+    else
+      joined.emplace();
+  });
+  return joined;
+}
+
+//===----------------------------------------------------------------------===//
+// Sources
+//===----------------------------------------------------------------------===//
+
+class RangeSource : public ReferenceCounted<RangeSource> {
+ public:
+  RangeSource(HostContext* host, int64_t start, int64_t stop, int64_t step,
+              int64_t buffer_size)
+      : host_(host),
+        output_(MakeRef<AsyncValueChannel>(buffer_size)),
+        next_(start),
+        stop_(stop),
+        step_(step) {}
+
+  const RCReference<AsyncValueChannel>& output() const { return output_; }
+
+  void Run() {
+    while (step_ > 0 ? next_ < stop_ : next_ > stop_) {
+      auto pushed = output_->Push(
+          MakeAvailableAsyncValueRef<int64_t>(next_).ReleaseRCRef());
+      next_ += step_;
+      if (!pushed.IsAvailable()) {
+        RunWhenPushed(host_, pushed,
+                      [source = FormRef(this)] { source->Run(); });
+        return;
+      }
+      if (pushed.IsError()) return;
+    }
+    output_->Close();
+  }
+
+ private:
+  HostContext* host_;
+  RCReference<AsyncValueChannel> output_;
+  int64_t next_;
+  const int64_t stop_;
+  const int64_t step_;
+};
+
+Expected<RCReference<AsyncValueChannel>> RangeSourceKernel(
+    int64_t start, int64_t stop, int64_t step, Attribute<int64_t> buffer_size,
+    const ExecutionContext& exec_ctx) {
+  if (step == 0)
+    return MakeStringError("tfrt_data.range_source step must not be zero");
+
+  auto source = MakeRef<RangeSource>(exec_ctx.host(), start, stop, step,
+                                     buffer_size.get());
+  auto output = source->output().CopyRef();
+  EnqueueWork(exec_ctx, [source = std::move(source)] { source->Run(); });
+  return std::move(output);
+}
+
+// Produces the lines of a file. The file is read in chunks of kReadSize bytes
+// with RandomAccessFile::ReadAsync(), and the lines of a chunk are pushed
+// before the next chunk is read.
+class TextLineSource : public ReferenceCounted<TextLineSource> {
+ public:
+  static constexpr size_t kReadSize = 256 * 1024;
+
+  TextLineSource(HostContext* host, std::unique_ptr<io::RandomAccessFile> file,
+                 int64_t buffer_size)
+      : host_(host),
+        file_(std::move(file)),
+        output_(MakeRef<AsyncValueChannel>(buffer_size)) {}
+
+  const RCReference<AsyncValueChannel>& output() const { return output_; }
+
+  void Run() {
+    while (true) {
+      size_t newline = data_.find('\n', pos_);
+      if (newline == std::string::npos) {
+        if (!eof_) {
+          Read();
+          return;
+        }
+        // The last line need not end with a line terminator.
+        if (pos_ < data_.size()) PushLine(data_.size());
+        output_->Close();
+        return;
+      }
+
+      auto pushed = PushLine(newline);
+      pos_ = newline + 1;
+      if (!pushed.IsAvailable()) {
+        RunWhenPushed(host_, pushed,
+                      [source = FormRef(this)] { source->Run(); });
+        return;
+      }
+      if (pushed.IsError()) return;
+    }
+  }
+
+ private:
+  // Pushes the bytes from `pos_` to `end`, without a trailing '\r'.
+  AsyncValueRef<Chain> PushLine(size_t end) {
+    if (end > pos_ && data_[end - 1] == '\r') --end;
+    return output_->Push(
+        MakeAvailableAsyncValueRef<std::string>(data_.substr(pos_, end - pos_))
+            .ReleaseRCRef());
+  }
+
+  // Appends the next chunk of the file to the unconsumed bytes, and resumes
+  // Run() once it is read.
+  void Read() {
+    data_.erase(0, pos_);
+    pos_ = 0;
+    size_t size = data_.size();
+    data_.resize(size + kReadSize);
+    auto count = file_->ReadAsync(&data_[size], kReadSize, offset_, host_);
+    count.AndThen([source = FormRef(this), count = count.CopyRef(), size] {
+      if (count.IsError()) {
+        // The error is an element, so that the consumer sees it after the lines
+        // read before it.
+        source->output_->Push(MakeErrorAsyncValueRef(count.GetError()));
+        source->output_->Close();
+        return;
+      }
+      source->data_.resize(size + *count);
+      source->offset_ += *count;
+      if (*count < kReadSize) source->eof_ = true;
+      source->Run();
+    });
+  }
+
+  HostContext* host_;
+  std::unique_ptr<io::RandomAccessFile> file_;
+  RCReference<AsyncValueChannel> output_;
+
+  // The bytes read from the file. The bytes before `pos_` are consumed.
+  std::string data_;
+  size_t pos_ = 0;
+  // The file offset of the next read.
+  size_t offset_ = 0;
+  bool eof_ = false;
+};
+
+Expected<RCReference<AsyncValueChannel>> TextLineSourceKernel(
+    const std::string& path, Attribute<int64_t> buffer_size,
+    const ExecutionContext& exec_ctx) {
+  io::FileSystem* file_system =
+      io::FileSystemRegistry::Default()->LookupForPath(path);
+  if (file_system == nullptr)
+    return MakeStringError("no file system registered for file ", path);
+
+  std::unique_ptr<io::RandomAccessFile> file;
+  if (auto error = file_system->NewRandomAccessFile(path, &file))
+    return std::move(error);
+
+  auto source = MakeRef<TextLineSource>(exec_ctx.host(), std::move(file),
+                                        buffer_size.get());
+  auto output = source->output().CopyRef();
+  EnqueueWork(exec_ctx, [source = std::move(source)] { source->Run(); });
+  return std::move(output);
+}
+
+// A file read by a RecordSource. Compressed files are read as a stream, the
+// others with positional reads.
+struct RecordShard {
+  std::unique_ptr<io::RecordReader> reader;
+  std::unique_ptr<io::SequentialRecordReader> stream_reader;
+  // The offset of the next record to read with `reader`.
+  uint64_t offset = 0;
+
+  Expected<size_t> ReadRecords(MutableArrayRef<std::string> records) {
+    if (stream_reader) return stream_reader->ReadRecords(records);
+    return reader->ReadRecords(&offset, records);
+  }
+};
+
+// Reads the records of several files into StringHostTensor batches. Every file
+// is read with blocking reads on its own blocking work queue thread, which
+// waits for room in the output after each batch.
+class RecordSource : public ReferenceCounted<RecordSource> {
+ public:
+  RecordSource(HostContext* host, std::vector<RecordShard> shards,
+               int64_t batch_size, int64_t buffer_size)
+      : host_(host),
+        output_(MakeRef<AsyncValueChannel>(buffer_size)),
+        batch_size_(batch_size),
+        shards_(std::move(shards)),
+        num_active_shards_(shards_.size()) {}
+
+  const RCReference<AsyncValueChannel>& output() const { return output_; }
+
+  void Start() {
+    if (shards_.empty()) output_->Close();
+    for (size_t i = 0; i < shards_.size(); ++i) ScheduleShard(i);
+  }
+
+ private:
+  void ScheduleShard(size_t index) {
+    bool enqueued = EnqueueBlockingWork(
+        host_, [source = FormRef(this), index] { source->ReadShard(index); });
+    if (!enqueued) {
+      EndShard(MakeErrorAsyncValueRef("failed to enqueue a record read"));
+    }
+  }
+
+  void ReadShard(size_t index) {
+    RecordShard& shard = shards_[index];
+    while (true) {
+      auto batch = StringHostTensor::CreateUninitialized(
+          TensorShape({static_cast<Index>(batch_size_)}), host_);
+      if (!batch) {
+        EndShard(MakeErrorAsyncValueRef("cannot allocate tensor"));
+        return;
+      }
+      auto count = shard.ReadRecords(batch->strings());
+      if (!count) {
+        EndShard(MakeErrorAsyncValueRef(
+            absl::InternalError(toString(count.takeError()))));
+        return;
+      }
+      if (*count == 0) {
+        EndShard({});
+        return;
+      }
+
+      if (*count < batch_size_) {
+        auto last_batch = StringHostTensor::CreateUninitialized(
+            TensorShape({static_cast<Index>(*count)}), host_);
+        if (!last_batch) {
+          EndShard(MakeErrorAsyncValueRef("cannot allocate tensor"));
+          return;
+        }
+        std::move(batch->strings().begin(), batch->strings().begin() + *count,
+                  last_batch->strings().begin());
+        EndShard(MakeAvailableAsyncValueRef<StringHostTensor>(
+                     std::move(*last_batch))
+                     .ReleaseRCRef());
+        return;
+      }
+
+      auto pushed = output_->Push(
+          MakeAvailableAsyncValueRef<StringHostTensor>(std::move(*batch))
+              .ReleaseRCRef());
+      if (!pushed.IsAvailable()) {
+        pushed.AndThen([source = FormRef(this), pushed = pushed.CopyRef(),
+                        index] {
+          if (pushed.IsError()) return;
+          source->ScheduleShard(index);
+        });
+        return;
+      }
+      if (pushed.IsError()) return;
+    }
+  }
+
+  // Pushes `last` unless it is null, and closes the output after the last
+  // shard.
+  void EndShard(RCReference<AsyncValue> last) {
+    if (last) output_->Push(std::move(last));
+    if (num_active_shards_.fetch_sub(1) == 1) output_->Close();
+  }
+
+  HostContext* host_;
+  RCReference<AsyncValueChannel> output_;
+  const size_t batch_size_;
+  std::vector<RecordShard> shards_;
+  std::atomic<size_t> num_active_shards_;
+};
+
+Expected<RCReference<AsyncValueChannel>> RecordSourceKernel(
+    RemainingArguments paths, Attribute<int64_t> batch_size,
+    Attribute<int64_t> buffer_size, const ExecutionContext& exec_ctx) {
+  std::vector<RecordShard> shards(paths.size());
+  for (int i = 0; i < paths.size(); ++i) {
+    const auto& path = paths[i]->get<std::string>();
+    io::FileSystem* file_system =
+        io::FileSystemRegistry::Default()->LookupForPath(path);
+    if (file_system == nullptr)
+      return MakeStringError("no file system registered for file ", path);
+
+    std::unique_ptr<io::RandomAccessFile> file;
+    if (auto error = file_system->NewRandomAccessFile(path, &file))
+      return std::move(error);
+    if (llvm::StringRef(path).ends_with(".gz")) {
+      shards[i].stream_reader = std::make_unique<io::SequentialRecordReader>(
+          std::make_unique<io::DecompressingInputStream>(
+              std::make_unique<io::FileInputStream>(std::move(file)),
+              exec_ctx.host()));
+    } else {
+      shards[i].reader = std::make_unique<io::RecordReader>(std::move(file));
+    }
+  }
+
+  auto source = MakeRef<RecordSource>(exec_ctx.host(), std::move(shards),
+                                      batch_size.get(), buffer_size.get());
+  source->Start();
+  return source->output().CopyRef();
+}
+
+//===----------------------------------------------------------------------===//
+// Transformations
+//===----------------------------------------------------------------------===//
+
+// A stage that transforms the values of an input channel. The stage pops the
+// next value once the chain returned by Process() for the previous one is
+// available, so that it is throttled by its output channel or by its own
+// limits. Only one Process() or Finish() call runs at a time.
+class PipelineStage : public ReferenceCounted<PipelineStage> {
+ public:
+  PipelineStage(HostContext* host, RCReference<AsyncValueChannel> input,
+                int64_t buffer_size)
+      : host_(host),
+        input_(std::move(input)),
+        output_(MakeRef<AsyncValueChannel>(buffer_size)) {}
+
+  virtual ~PipelineStage() = default;
+
+  const RCReference<AsyncValueChannel>& output() const { return output_; }
+
+  // Starts the stage on the work queue.
+  void Start() {
+    EnqueueWork(host_, [stage = FormRef(this)] { stage->Run(); });
+  }
+
+ protected:
+  // Processes a value of the input. Returns a chain that is available once
+  // the stage can take the next value, or an error to stop the stage.
+  virtual AsyncValueRef<Chain> Process(RCReference<AsyncValue> value) = 0;
+
+  // Called after the last value of the input, before the output is closed.
+  virtual void Finish() {}
+
+  AsyncValueRef<Chain> Emit(RCReference<AsyncValue> value) {
+    return output_->Push(std::move(value));
+  }
+
+  HostContext* host() const { return host_; }
+
+ private:
+  void Run() {
+    while (true) {
+      auto popped = input_->Pop();
+      if (!popped.IsAvailable()) {
+        popped.AndThen(
+            [stage = FormRef(this), popped = popped.CopyRef()]() mutable {
+              HostContext* host = stage->host_;
+              EnqueueWork(host, [stage = std::move(stage),
+                                 popped = std::move(popped)] {
+                if (stage->Step(popped)) stage->Run();
+              });
+            });
+        return;
+      }
+      if (!Step(popped)) return;
+    }
+  }
+
+  // Returns true if the stage can pop the next value right away.
+  bool Step(const AsyncValueRef<PoppedValue>& popped) {
+    if (popped.IsError()) {
+      Emit(MakeErrorAsyncValueRef(popped.GetError()));
+      output_->Close();
+      return false;
+    }
+    if (!popped->has_value()) {
+      Finish();
+      output_->Close();
+      return false;
+    }
+
+    auto ready = Process(std::move(**popped));
+    if (ready.IsAvailable()) return !ready.IsError();
+    RunWhenPushed(host_, ready, [stage = FormRef(this)] { stage->Run(); });
+    return false;
+  }
+
+  HostContext* host_;
+  RCReference<AsyncValueChannel> input_;
+  RCReference<AsyncValueChannel> output_;
+};
+
+template <typename StageT, typename... Args>
+RCReference<AsyncValueChannel> StartStage(Args&&... args) {
+  auto stage = MakeRef<StageT>(std::forward<Args>(args)...);
+  stage->Start();
+  return stage->output().CopyRef();
+}
+
+class MapStage : public PipelineStage {
+ public:
+  MapStage(const ExecutionContext& exec_ctx,
+           RCReference<AsyncValueChannel> input, const Function* fn,
+           int64_t parallelism, int64_t buffer_size)
+      : PipelineStage(exec_ctx.host(), std::move(input), buffer_size),
+        exec_ctx_(exec_ctx),
+        fn_(FormRef(fn)),
+        parallelism_(parallelism) {}
+
+ protected:
+  // The result is pushed before the call completes, so the results stay in the
+  // order of the input however long each call takes.
+  AsyncValueRef<Chain> Process(RCReference<AsyncValue> value) override {
+    auto result = MakeIndirectAsyncValue();
+    auto pushed = Emit(result);
+
+    AsyncValueRef<Chain> call_slot;
+    {
+      mutex_lock lock(mu_);
+      if (++num_calls_ == parallelism_)
+        call_slot_ = call_slot = MakeUnconstructedAsyncValueRef<Chain>();
+    }
+
+    EnqueueWork(exec_ctx_, [stage = FormRef(this), value = std::move(value),
+                            result = std::move(result)]() mutable {
+      RCReference<AsyncValue> fn_result;
+      stage->fn_->Execute(stage->exec_ctx_, value.get(), fn_result);
+      fn_result->AndThen([stage = std::move(stage)] { stage->EndCall(); });
+      result->ForwardTo(std::move(fn_result));
+    });
+
+    if (!call_slot) return pushed;
+    return JoinChains(std::move(pushed), std::move(call_slot));
+  }
+
+ private:
+  void EndCall() {
+    AsyncValueRef<Chain> call_slot;
+    {
+      mutex_lock lock(mu_);
+      --num_calls_;
+      call_slot = std::move(call_slot_);
+    }
+    if (call_slot) call_slot.emplace();
+  }
+
+  ExecutionContext exec_ctx_;
+  RCReference<const Function> fn_;
+  const int64_t parallelism_;
+
+  mutex mu_;
+  int64_t num_calls_ TFRT_GUARDED_BY(mu_) = 0;
+  // Available once a call ends while `parallelism_` calls are running.
+  AsyncValueRef<Chain> call_slot_ TFRT_GUARDED_BY(mu_);
+};
+
+void MapKernel(Argument<RCReference<AsyncValueChannel>> input,
+               Result<RCReference<AsyncValueChannel>> output,
+               Attribute<int64_t> buffer_size, Attribute<int64_t> parallelism,
+               Attribute<Function> fn, KernelErrorHandler handler,
+               const ExecutionContext& exec_ctx) {
+  if (fn->num_arguments() != 1 || fn->num_results() != 1) {
+    handler.ReportError("tfrt_data.map function must take a value and return "
+                        "a value");
+    return;
+  }
+  output.Emplace(StartStage<MapStage>(exec_ctx, *input, &(*fn),
+                                      parallelism.get(), buffer_size.get()));
+}
+
+// Copies the scalars of type T in `values` to a 1-D tensor.
+template <typename T>
+Expected<DenseHostTensor> StackScalars(ArrayRef<RCReference<AsyncValue>> values,
+                                       HostContext* host) {
+  auto batch = DenseHostTensor::CreateUninitialized<T>(
+      TensorShape({static_cast<Index>(values.size())}), host);
+  if (!batch) return MakeStringError("cannot allocate tensor");
+  T* data = batch->data<T>();
+  for (const auto& value : values) {
+    if (!value->IsType<T>())
+      return MakeStringError("tfrt_data.batch values must have the same type");
+    *data++ = value->get<T>();
+  }
+  return std::move(*batch);
+}
+
+Expected<DenseHostTensor> StackTensors(ArrayRef<RCReference<AsyncValue>> values,
+                                       HostContext* host) {
+  const auto& first = values.front()->get<DenseHostTensor>();
+  llvm::SmallVector<Index, 4> dims = {static_cast<Index>(values.size())};
+  llvm::SmallVector<Index, 4> element_dims;
+  first.shape().GetDimensions(&element_dims);
+  dims.append(element_dims.begin(), element_dims.end());
+
+  auto batch = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(first.dtype(), dims), host);
+  if (!batch) return MakeStringError("cannot allocate tensor");
+  auto* data = static_cast<char*>(batch->data());
+  for (const auto& value : values) {
+    if (!value->IsType<DenseHostTensor>())
+      return MakeStringError("tfrt_data.batch values must have the same type");
+    const auto& tensor = value->get<DenseHostTensor>();
+    if (tensor.metadata() != first.metadata())
+      return MakeStringError(
+          "tfrt_data.batch tensors must have the same dtype and shape, got ",
+          first.metadata(), " and ", tensor.metadata());
+    std::memcpy(data, tensor.data(), tensor.DataSizeInBytes());
+    data += tensor.DataSizeInBytes();
+  }
+  return std::move(*batch);
+}
+
+Expected<StringHostTensor> StackStrings(
+    ArrayRef<RCReference<AsyncValue>> values, HostContext* host) {
+  auto batch = StringHostTensor::CreateUninitialized(
+      TensorShape({static_cast<Index>(values.size())}), host);
+  if (!batch) return MakeStringError("cannot allocate tensor");
+  auto strings = batch->strings();
+  for (size_t i = 0; i < values.size(); ++i) {
+    if (!values[i]->IsType<std::string>())
+      return MakeStringError("tfrt_data.batch values must have the same type");
+    strings[i] = values[i]->get<std::string>();
+  }
+  return std::move(*batch);
+}
+
+template <typename T>
+void ForwardStacked(Expected<T> stacked, IndirectAsyncValue* batch) {
+  if (!stacked) {
+    batch->SetError(absl::InternalError(toString(stacked.takeError())));
+    return;
+  }
+  batch->ForwardTo(
+      MakeAvailableAsyncValueRef<T>(std::move(*stacked)).ReleaseRCRef());
+}
+
+// Sets `batch` to the stack of the available `values`.
+void StackValues(ArrayRef<RCReference<AsyncValue>> values,
+                 IndirectAsyncValue* batch, HostContext* host) {
+  for (const auto& value : values) {
+    if (value->IsError()) {
+      batch->ForwardTo(value.CopyRef());
+      return;
+    }
+  }
+
+  const AsyncValue& first = *values.front();
+  if (first.IsType<DenseHostTensor>())
+    ForwardStacked(StackTensors(values, host));
+  else if (first.IsType<std::string>())
+    ForwardStacked(StackStrings(values, host));
+  else if (first.IsType<int32_t>())
+    ForwardStacked(StackScalars<int32_t>(values, host));
+  else if (first.IsType<int64_t>())
+    ForwardStacked(StackScalars<int64_t>(values, host));
+  else if (first.IsType<float>())
+    ForwardStacked(StackScalars<float>(values, host));
+  else if (first.IsType<double>())
+    ForwardStacked(StackScalars<double>(values, host));
+  else
+    batch->SetError(
+        absl::InvalidArgumentError("unsupported tfrt_data.batch value type"));
+}
+
+class BatchStage : public PipelineStage {
+ public:
+  BatchStage(HostContext* host, RCReference<AsyncValueChannel> input,
+             int64_t batch_size, bool drop_remainder, int64_t buffer_size)
+      : PipelineStage(host, std::move(input), buffer_size),
+        batch_size_(batch_size),
+        drop_remainder_(drop_remainder) {
+    values_.reserve(batch_size_);
+  }
+
+ protected:
+  AsyncValueRef<Chain> Process(RCReference<AsyncValue> value) override {
+    values_.push_back(std::move(value));
+    if (values_.size() < batch_size_) return GetReadyChain();
+    return EmitBatch();
+  }
+
+  void Finish() override {
+    if (!values_.empty() && !drop_remainder_) EmitBatch();
+  }
+
+ private:
+  // Pushes the batch of `values_` right away, and stacks it on the work queue
+  // once the values are available.
+  AsyncValueRef<Chain> EmitBatch() {
+    auto batch = MakeIndirectAsyncValue();
+    auto pushed = Emit(batch);
+    std::vector<RCReference<AsyncValue>> values;
+    values.swap(values_);
+    values_.reserve(batch_size_);
+
+    llvm::SmallVector<AsyncValue*, 8> pending;
+    pending.reserve(values.size());
+    for (const auto& value : values) pending.push_back(value.get());
+    RunWhenReady(pending, [host = host(), values = std::move(values),
+                           batch = std::move(batch)]() mutable {
+      EnqueueWork(host, [host, values = std::move(values),
+                         batch = std::move(batch)] {
+        StackValues(values, batch.get(), host);
+      });
+    });
+    return pushed;
+  }
+
+  const size_t batch_size_;
+  const bool drop_remainder_;
+  std::vector<RCReference<AsyncValue>> values_;
+};
+
+void BatchKernel(Argument<RCReference<AsyncValueChannel>> input,
+                 Result<RCReference<AsyncValueChannel>> output,
+                 Attribute<int64_t> batch_size, Attribute<int64_t> buffer_size,
+                 Attribute<bool> drop_remainder,
+                 const ExecutionContext& exec_ctx) {
+  output.Emplace(StartStage<BatchStage>(exec_ctx.host(), *input,
+                                        batch_size.get(), drop_remainder.get(),
+                                        buffer_size.get()));
+}
+
+class ShuffleStage : public PipelineStage {
+ public:
+  ShuffleStage(HostContext* host, RCReference<AsyncValueChannel> input,
+               int64_t shuffle_size, int64_t seed, int64_t buffer_size)
+      : PipelineStage(host, std::move(input), buffer_size),
+        shuffle_size_(shuffle_size),
+        random_(seed) {
+    buffer_.reserve(shuffle_size_);
+  }
+
+ protected:
+  AsyncValueRef<Chain> Process(RCReference<AsyncValue> value) override {
+    if (buffer_.size() < shuffle_size_) {
+      buffer_.push_back(std::move(value));
+      return GetReadyChain();
+    }
+    std::swap(buffer_[PickIndex()], value);
+    return Emit(std::move(value));
+  }
+
+  void Finish() override {
+    while (!buffer_.empty()) {
+      std::swap(buffer_[PickIndex()], buffer_.back());
+      Emit(std::move(buffer_.back()));
+      buffer_.pop_back();
+    }
+  }
+
+ private:
+  size_t PickIndex() {
+    return std::uniform_int_distribution<size_t>(0, buffer_.size() - 1)(
+        random_);
+  }
+
+  const size_t shuffle_size_;
+  std::mt19937_64 random_;
+  std::vector<RCReference<AsyncValue>> buffer_;
+};
+
+void ShuffleKernel(Argument<RCReference<AsyncValueChannel>> input,
+                   Result<RCReference<AsyncValueChannel>> output,
+                   Attribute<int64_t> buffer_size, Attribute<int64_t> seed,
+                   Attribute<int64_t> shuffle_size,
+                   const ExecutionContext& exec_ctx) {
+  output.Emplace(StartStage<ShuffleStage>(exec_ctx.host(), *input,
+                                          shuffle_size.get(), seed.get(),
+                                          buffer_size.get()));
+}
+
+class PrefetchStage : public PipelineStage {
+ public:
+  using PipelineStage::PipelineStage;
+
+ protected:
+  // The value is pushed once it is available, so the output holds values the
+  // consumer can use right away.
+  AsyncValueRef<Chain> Process(RCReference<AsyncValue> value) override {
+    if (value->IsAvailable()) return Emit(std::move(value));
+    auto pushed = MakeUnconstructedAsyncValueRef<Chain>();
+    AsyncValue* value_ptr = value.get();
+    value_ptr->AndThen([stage = FormRef(this), value = std::move(value),
+                        pushed = pushed.CopyRef()]() mutable {
+      auto emitted = stage->Emit(std::move(value));
+      emitted.AndThen([emitted = emitted.CopyRef(),
+                       pushed = std::move(pushed)] {
+        if (emitted.IsError())
+          pushed.SetError(emitted.GetError());
+        else
+          pushed.emplace();
+      });
+    });
+    return pushed;
+  }
+};
+
+void PrefetchKernel(Argument<RCReference<AsyncValueChannel>> input,
+                    Result<RCReference<AsyncValueChannel>> output,
+                    Attribute<int64_t> buffer_size,
+                    const ExecutionContext& exec_ctx) {
+  output.Emplace(
+      StartStage<PrefetchStage>(exec_ctx.host(), *input, buffer_size.get()));
+}
+
+}  // namespace
+
+void RegisterDataKernels(KernelRegistry* registry) {
+  registry->AddKernel("tfrt_data.range_source",
+                      TFRT_KERNEL(RangeSourceKernel));
+  registry->AddKernel("tfrt_data.text_line_source",
+                      TFRT_KERNEL(TextLineSourceKernel));
+  registry->AddKernel("tfrt_data.record_source",
+                      TFRT_KERNEL(RecordSourceKernel));
+  registry->AddKernel("tfrt_data.map", TFRT_KERNEL(MapKernel));
+  registry->AddKernel("tfrt_data.batch", TFRT_KERNEL(BatchKernel));
+  registry->AddKernel("tfrt_data.shuffle", TFRT_KERNEL(ShuffleKernel));
+  registry->AddKernel("tfrt_data.prefetch", TFRT_KERNEL(PrefetchKernel));
+}
+
+}  // namespace data
+}  // namespace tfrt
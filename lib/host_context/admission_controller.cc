@@ -0,0 +1,81 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file implements AdmissionController.
+
+#include "tfrt/host_context/admission_controller.h"
+
+#include <algorithm>
+#include <string>
+#include <thread>
+
+#include "tfrt/support/error_util.h"
+#include "tfrt/support/string_util.h"
+
+namespace tfrt {
+
+std::string AdmissionController::GetOverload(const WorkQueueLoad& load) const {
+  if (options_.max_queued_tasks > 0 &&
+      load.num_queued_tasks > options_.max_queued_tasks) {
+    return StrCat(load.num_queued_tasks, " queued tasks, limit ",
+                  options_.max_queued_tasks);
+  }
+  // The latency is not updated while no task starts, so it is only current
+  // while tasks are queued.
+  if (options_.max_task_latency.count() > 0 && load.task_latency.has_value() &&
+      load.num_queued_tasks > 0 &&
+      *load.task_latency > options_.max_task_latency) {
+    const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+        *load.task_latency);
+    return StrCat("task latency ", latency.count(), "us, limit ",
+                  options_.max_task_latency.count(), "us");
+  }
+  return "";
+}
+
+Error AdmissionController::Admit(TaskPriority priority) {
+  using Clock = std::chrono::steady_clock;
+
+  if (priority == TaskPriority::kCritical) {
+    num_admitted_.fetch_add(1, std::memory_order_relaxed);
+    return Error::success();
+  }
+
+  const Clock::time_point deadline = Clock::now() + options_.max_delay;
+  bool delayed = false;
+  while (true) {
+    const std::string overload = GetOverload(work_queue_.GetLoad());
+    if (overload.empty()) {
+      num_admitted_.fetch_add(1, std::memory_order_relaxed);
+      if (delayed) num_delayed_.fetch_add(1, std::memory_order_relaxed);
+      return Error::success();
+    }
+
+    const Clock::time_point now = Clock::now();
+    if (now >= deadline || work_queue_.IsInWorkerThread()) {
+      num_rejected_.fetch_add(1, std::memory_order_relaxed);
+      return MakeStringError("Request rejected by admission control: ",
+                             work_queue_.name(), " is overloaded (", overload,
+                             ")");
+    }
+
+    delayed = true;
+    std::this_thread::sleep_for(std::min<Clock::duration>(
+        options_.poll_interval, deadline - now));
+  }
+}
+
+}  // namespace tfrt
@@ -18,46 +18,88 @@
 
 #include "tfrt/host_context/async_dispatch.h"
 
+#include <chrono>
 #include <utility>
 
 #include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/request_stats.h"
 #include "tfrt/host_context/task_function.h"
 
 namespace tfrt {
 
 void Await(const ExecutionContext& exec_ctx,
            ArrayRef<RCReference<AsyncValue>> values) {
+  RequestStats* stats = exec_ctx.request_ctx()->stats();
+  if (!stats) {
+    exec_ctx.work_queue().Await(values);
+    return;
+  }
+  const auto start_time = std::chrono::steady_clock::now();
   exec_ctx.work_queue().Await(values);
+  stats->AddAwaitTime(std::chrono::steady_clock::now() - start_time);
 }
 
 void Await(HostContext* host, ArrayRef<RCReference<AsyncValue>> values) {
   host->work_queue().Await(values);
 }
 
-void EnqueueWork(const ExecutionContext& exec_ctx,
-                 llvm::unique_function<void()> work) {
+void EnqueueWork(const ExecutionContext& exec_ctx, TaskFunction work) {
   auto& work_queue = exec_ctx.work_queue();
-  work_queue.AddTask(TaskFunction(std::move(work)));
+  RequestContext* req_ctx = exec_ctx.request_ctx();
+  const auto& deadline = req_ctx->deadline();
+  if (!deadline.has_value()) {
+    work_queue.AddTask(std::move(work), req_ctx->priority());
+    return;
+  }
+
+  // Shed requests that missed their deadline: cancel the request before the
+  // task runs, so that the kernels it would start see the cancellation.
+  auto shed_if_expired = [req_ctx = FormRef(req_ctx), deadline = *deadline,
+                          work = std::move(work)]() mutable {
+    if (std::chrono::system_clock::now() >= deadline) req_ctx->Cancel();
+    work();
+  };
+  work_queue.AddTask(TaskFunction(std::move(shed_if_expired)),
+                     req_ctx->priority(), *deadline);
+}
+
+void EnqueueWork(const ExecutionContext& exec_ctx, TaskAffinity affinity,
+                 TaskFunction work) {
+  RequestContext* req_ctx = exec_ctx.request_ctx();
+  if (req_ctx->deadline().has_value()) {
+    EnqueueWork(exec_ctx, std::move(work));
+    return;
+  }
+  exec_ctx.work_queue().AddTask(std::move(work), req_ctx->priority(),
+                                affinity);
+}
+
+void EnqueueWork(const ExecutionContext& exec_ctx,
+                 MutableArrayRef<TaskFunction> work) {
+  RequestContext* req_ctx = exec_ctx.request_ctx();
+  if (req_ctx->deadline().has_value()) {
+    for (TaskFunction& task : work) EnqueueWork(exec_ctx, std::move(task));
+    return;
+  }
+  exec_ctx.work_queue().AddTasks(work, req_ctx->priority());
 }
 
-void EnqueueWork(HostContext* host, llvm::unique_function<void()> work) {
+void EnqueueWork(HostContext* host, TaskFunction work) {
   auto& work_queue = host->work_queue();
-  work_queue.AddTask(TaskFunction(std::move(work)));
+  work_queue.AddTask(std::move(work));
 }
 
-[[nodiscard]] bool EnqueueBlockingWork(HostContext* host,
-                                       llvm::unique_function<void()> work) {
+[[nodiscard]] bool EnqueueBlockingWork(HostContext* host, TaskFunction work) {
   auto& work_queue = host->work_queue();
-  Optional<TaskFunction> task = work_queue.AddBlockingTask(
-      TaskFunction(std::move(work)), /*allow_queuing=*/true);
+  Optional<TaskFunction> task =
+      work_queue.AddBlockingTask(std::move(work), /*allow_queuing=*/true);
   return !task.has_value();
 }
 
-[[nodiscard]] bool RunBlockingWork(HostContext* host,
-                                   llvm::unique_function<void()> work) {
+[[nodiscard]] bool RunBlockingWork(HostContext* host, TaskFunction work) {
   auto& work_queue = host->work_queue();
-  Optional<TaskFunction> task = work_queue.AddBlockingTask(
-      TaskFunction(std::move(work)), /*allow_queuing=*/false);
+  Optional<TaskFunction> task =
+      work_queue.AddBlockingTask(std::move(work), /*allow_queuing=*/false);
   return !task.has_value();
 }
 
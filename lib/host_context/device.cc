@@ -17,9 +17,58 @@
 #include "tfrt/host_context/device.h"
 
 #include "llvm/ADT/FunctionExtras.h"
+#include "llvm/ADT/STLExtras.h"
 
 namespace tfrt {
 
+DeviceManager::NameHandle DeviceManager::InternDeviceName(
+    string_view device_name) {
+  if (const Entry* entry = FindEntry(device_name)) return NameHandle(entry);
+
+  mutex_lock l(mu_);
+  size_t num_entries = entries_.size();
+  Entry* entry = GetOrCreateEntry(device_name);
+  if (entries_.size() != num_entries) PublishIndex();
+  return NameHandle(entry);
+}
+
+const DeviceManager::Entry* DeviceManager::FindEntry(
+    string_view device_name) const {
+  return index_.Read([&](const Index* index) -> const Entry* {
+    if (index == nullptr) return nullptr;
+    auto it = index->entries.find(device_name);
+    return it == index->entries.end() ? nullptr : it->second;
+  });
+}
+
+DeviceManager::Entry* DeviceManager::GetOrCreateEntry(
+    string_view device_name) {
+  auto& entry = entries_[device_name];
+  if (!entry) entry = std::make_unique<Entry>(device_name);
+  return entry.get();
+}
+
+void DeviceManager::AddDeviceToIndex(Device* device) {
+  GetOrCreateEntry(device->name())
+      ->device.store(device, std::memory_order_release);
+  PublishIndex();
+}
+
+void DeviceManager::PublishIndex() {
+  auto index = std::make_unique<Index>();
+  for (const auto& it : entries_)
+    index->entries.try_emplace(it.getKey(), it.getValue().get());
+  // Same as the first device of the type found by iterating `device_map_`.
+  for (const auto& it : device_map_) {
+    Device* device = it.second.get();
+    if (llvm::none_of(index->default_devices, [&](const auto& type_device) {
+          return *type_device.first == device->type();
+        }))
+      index->default_devices.push_back({&device->type(), device});
+  }
+  index_.Publish(std::move(index));
+}
+
 const DeviceType& DeviceTypeRegistry::RegisterDeviceType(string_view type) {
   for (auto& dt : types_) {
     if (dt->name() == type) {
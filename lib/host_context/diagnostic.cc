@@ -49,18 +49,35 @@ DecodedDiagnostic EmitError(const ExecutionContext& exec_ctx,
   return diag;
 }
 
+ErrorAsyncValue* GetSharedError(const ExecutionContext& exec_ctx) {
+  return exec_ctx.request_ctx()->GetSharedError();
+}
+
 RCReference<ErrorAsyncValue> EmitErrorAsync(const ExecutionContext& exec_ctx,
                                             absl::Status status) {
-  return MakeErrorAsyncValueRef(EmitError(exec_ctx, status).status);
+  RequestContext* request_ctx = exec_ctx.request_ctx();
+  if (!request_ctx->share_errors())
+    return MakeErrorAsyncValueRef(EmitError(exec_ctx, status).status);
+
+  if (auto* shared_error = request_ctx->GetSharedError())
+    return FormRef(shared_error);
+  return request_ctx->ShareError(
+      MakeErrorAsyncValueRef(EmitError(exec_ctx, status).status));
 }
 
 RCReference<ErrorAsyncValue> EmitErrorAsync(const ExecutionContext& exec_ctx,
                                             std::string_view message) {
+  if (auto* shared_error = GetSharedError(exec_ctx))
+    return FormRef(shared_error);
   return EmitErrorAsync(exec_ctx, absl::InternalError(message));
 }
 
 RCReference<ErrorAsyncValue> EmitErrorAsync(const ExecutionContext& exec_ctx,
                                             Error error) {
+  if (auto* shared_error = GetSharedError(exec_ctx)) {
+    llvm::consumeError(std::move(error));
+    return FormRef(shared_error);
+  }
   return EmitErrorAsync(exec_ctx,
                         absl::InternalError(toString(std::move(error))));
 }
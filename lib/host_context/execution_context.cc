@@ -21,6 +21,7 @@
 #include <utility>
 
 #include "llvm/Support/Error.h"
+#include "tfrt/host_context/admission_controller.h"
 #include "tfrt/host_context/concurrent_work_queue.h"
 #include "tfrt/host_context/host_context.h"
 
@@ -49,17 +50,62 @@ void CancellationContext::Cancel() {
   }
 }
 
+RequestContext::~RequestContext() {
+  if (stats_) stats_->RecordMetrics();
+  if (auto shared_error = GetSharedError()) shared_error->DropRef();
+}
+
+RCReference<ErrorAsyncValue> RequestContext::ShareError(
+    RCReference<ErrorAsyncValue> error) {
+  assert(share_errors_);
+  ErrorAsyncValue* expected_value = nullptr;
+  // See CancellationContext::Cancel() for the memory orders. On failure,
+  // expected_value is the shared error, so it needs memory_order_acquire.
+  if (shared_error_.compare_exchange_strong(expected_value, error.get(),
+                                            std::memory_order_release,
+                                            std::memory_order_acquire)) {
+    // The request keeps the reference in `shared_error_`.
+    return FormRef(error.release());
+  }
+  return FormRef(expected_value);
+}
+
 void RequestContext::Cancel() { cancellation_->Cancel(); }
 
+HostAllocator* RequestContext::allocator() const {
+  if (arena_allocator_) return arena_allocator_.get();
+  return host_->allocator();
+}
+
 Expected<RCReference<RequestContext>> RequestContextBuilder::build() && {
+  if (request_options_.admission_controller != nullptr) {
+    if (auto error = request_options_.admission_controller->Admit(
+            request_options_.priority))
+      return std::move(error);
+  }
+
+  std::unique_ptr<HostAllocator> arena_allocator;
+  if (request_options_.use_arena_allocator)
+    arena_allocator = CreateRequestArenaAllocator(host_->allocator());
+  RequestTracker* resource_tracker = nullptr;
+  if (request_options_.track_in_resource_context && resource_context_)
+    resource_tracker = &resource_context_->request_tracker();
   return TakeRef(new RequestContext(host_, resource_context_,
-                                    std::move(context_data_), id_));
+                                    std::move(context_data_), id_,
+                                    request_options_.priority,
+                                    request_options_.deadline,
+                                    std::move(arena_allocator),
+                                    request_options_.stats, resource_tracker,
+                                    request_options_.request_tracker,
+                                    request_options_.share_errors));
 };
 
 ExecutionContext::ExecutionContext(RCReference<RequestContext> req_ctx,
                                    Location location)
     : request_ctx_{std::move(req_ctx)},
-      work_queue_(&host()->work_queue()),
+      host_(request_ctx_->host()),
+      allocator_(request_ctx_->allocator()),
+      work_queue_(&host_->work_queue()),
       location_{location} {}
 
 }  // namespace tfrt
@@ -0,0 +1,127 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements FunctionResultCache and EncodeMemoizationKey.
+
+#include "tfrt/host_context/function_result_cache.h"
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+#include "llvm/ADT/STLExtras.h"
+
+namespace tfrt {
+namespace {
+
+// Append the tag and the bytes of a scalar of type T.
+template <typename T>
+bool EncodeScalar(const AsyncValue& value, char tag, std::string* key) {
+  if (!value.IsType<T>()) return false;
+  const T& scalar = value.get<T>();
+  key->push_back(tag);
+  key->append(reinterpret_cast<const char*>(&scalar), sizeof(T));
+  return true;
+}
+
+bool EncodeBuiltinScalar(const AsyncValue& value, std::string* key) {
+  // Floating point values are compared bitwise, so 0.0 and -0.0 are distinct
+  // keys. This only causes cache misses.
+  return EncodeScalar<bool>(value, 'b', key) ||
+         EncodeScalar<int32_t>(value, 'i', key) ||
+         EncodeScalar<int64_t>(value, 'l', key) ||
+         EncodeScalar<float>(value, 'f', key) ||
+         EncodeScalar<double>(value, 'd', key);
+}
+
+std::vector<MemoizationKeyEncoder>* GetStaticMemoizationKeyEncoders() {
+  static std::vector<MemoizationKeyEncoder>* ret =
+      new std::vector<MemoizationKeyEncoder>{EncodeBuiltinScalar};
+  return ret;
+}
+
+}  // namespace
+
+void AddStaticMemoizationKeyEncoder(MemoizationKeyEncoder encoder) {
+  GetStaticMemoizationKeyEncoders()->push_back(encoder);
+}
+
+bool EncodeMemoizationKey(ArrayRef<AsyncValue*> arguments, std::string* key) {
+  const auto& encoders = *GetStaticMemoizationKeyEncoders();
+  for (AsyncValue* argument : arguments) {
+    if (!argument->IsAvailable() || argument->IsError()) return false;
+    if (llvm::none_of(encoders, [&](MemoizationKeyEncoder encoder) {
+          return encoder(*argument, key);
+        }))
+      return false;
+  }
+  return true;
+}
+
+std::string FunctionResultCache::MakeKey(const Function* fn, string_view key) {
+  const uint64_t id = fn->id();
+  std::string result(reinterpret_cast<const char*>(&id), sizeof(id));
+  result.append(key.begin(), key.end());
+  return result;
+}
+
+bool FunctionResultCache::Lookup(
+    const Function* fn, string_view key,
+    MutableArrayRef<RCReference<AsyncValue>> results) {
+  std::string full_key = MakeKey(fn, key);
+
+  mutex_lock lock(mu_);
+  auto it = index_.find(full_key);
+  if (it == index_.end()) return false;
+
+  // Move the entry to the front of the list. This does not invalidate the
+  // iterators or the keys in the index.
+  entries_.splice(entries_.begin(), entries_, it->second);
+
+  const Entry& entry = *it->second;
+  assert(entry.results.size() == results.size() && "result count mismatch");
+  for (auto pair : llvm::zip(entry.results, results))
+    std::get<1>(pair) = std::get<0>(pair).CopyRef();
+  return true;
+}
+
+void FunctionResultCache::Insert(const Function* fn, string_view key,
+                                 ArrayRef<RCReference<AsyncValue>> results) {
+  if (capacity_ == 0) return;
+
+  Entry entry;
+  entry.key = MakeKey(fn, key);
+  entry.results.reserve(results.size());
+  for (const auto& result : results) entry.results.push_back(result.CopyRef());
+
+  mutex_lock lock(mu_);
+  // Another call with the same arguments may have finished first. Keep its
+  // results, which are equivalent.
+  if (index_.count(entry.key)) return;
+
+  if (entries_.size() == capacity_) {
+    index_.erase(entries_.back().key);
+    entries_.pop_back();
+  }
+
+  entries_.push_front(std::move(entry));
+  index_.emplace(entries_.front().key, entries_.begin());
+}
+
+size_t FunctionResultCache::size() const {
+  mutex_lock lock(mu_);
+  return entries_.size();
+}
+
+}  // namespace tfrt
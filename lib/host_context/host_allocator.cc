@@ -18,12 +18,17 @@
 
 #include "tfrt/host_context/host_allocator.h"
 
+#include <algorithm>
 #include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <memory>
+#include <utility>
 
 #include "llvm/Support/MathExtras.h"
 #include "tfrt/support/alloc.h"
+#include "tfrt/support/mutex.h"
 
 namespace tfrt {
 
@@ -33,14 +38,133 @@ class MallocAllocator : public HostAllocator {
     return AlignedAlloc(alignment, size);
   }
 
+  void* AllocateZeroedBytes(size_t size, size_t alignment) override {
+    return AlignedZeroedAlloc(alignment, size);
+  }
+
   // Deallocate the specified pointer that has the specified size.
   void DeallocateBytes(void* ptr, size_t size) override { AlignedFree(ptr); }
 };
 
+// RequestArenaAllocator bump-allocates out of blocks obtained from the parent
+// allocator. Individual deallocations are ignored; all blocks are returned to
+// the parent when the allocator is destroyed.
+class RequestArenaAllocator : public HostAllocator {
+ public:
+  RequestArenaAllocator(HostAllocator* parent, size_t block_size)
+      : parent_(parent), block_size_(block_size) {}
+
+  ~RequestArenaAllocator() override {
+    Block* block = blocks_;
+    while (block != nullptr) {
+      Block* next = block->next;
+      parent_->DeallocateBytes(block, block->size);
+      block = next;
+    }
+  }
+
+  void* AllocateBytes(size_t size, size_t alignment) override {
+    mutex_lock lock(mu_);
+
+    uintptr_t ptr = llvm::alignTo(current_, alignment);
+    if (current_ == 0 || ptr + size > end_) {
+      // Allocations that are large relative to the block size get a dedicated
+      // block, so that they do not waste the tail of the current block.
+      size_t needed = sizeof(Block) + alignment + size;
+      if (needed > block_size_ / 4) {
+        Block* block = NewBlock(needed);
+        return reinterpret_cast<void*>(llvm::alignTo(
+            reinterpret_cast<uintptr_t>(block + 1), alignment));
+      }
+
+      Block* block = NewBlock(block_size_);
+      current_ = reinterpret_cast<uintptr_t>(block + 1);
+      end_ = reinterpret_cast<uintptr_t>(block) + block_size_;
+      ptr = llvm::alignTo(current_, alignment);
+    }
+
+    current_ = ptr + size;
+    return reinterpret_cast<void*>(ptr);
+  }
+
+  // Memory is released all at once when the arena is destroyed.
+  void DeallocateBytes(void* ptr, size_t size) override {}
+
+ private:
+  struct Block {
+    Block* next;
+    size_t size;
+  };
+
+  Block* NewBlock(size_t size) TFRT_REQUIRES(mu_) {
+    auto* block =
+        static_cast<Block*>(parent_->AllocateBytes(size, alignof(Block)));
+    block->next = blocks_;
+    block->size = size;
+    blocks_ = block;
+    return block;
+  }
+
+  HostAllocator* const parent_;
+  const size_t block_size_;
+
+  mutex mu_;
+  Block* blocks_ TFRT_GUARDED_BY(mu_) = nullptr;
+  // The free range of the most recent regular sized block.
+  uintptr_t current_ TFRT_GUARDED_BY(mu_) = 0;
+  uintptr_t end_ TFRT_GUARDED_BY(mu_) = 0;
+};
+
+class SharedAllocator : public HostAllocator {
+ public:
+  explicit SharedAllocator(std::shared_ptr<HostAllocator> allocator)
+      : allocator_(std::move(allocator)) {}
+
+  void* AllocateBytes(size_t size, size_t alignment) override {
+    return allocator_->AllocateBytes(size, alignment);
+  }
+
+  void* AllocateZeroedBytes(size_t size, size_t alignment) override {
+    return allocator_->AllocateZeroedBytes(size, alignment);
+  }
+
+  void DeallocateBytes(void* ptr, size_t size) override {
+    allocator_->DeallocateBytes(ptr, size);
+  }
+
+ private:
+  std::shared_ptr<HostAllocator> allocator_;
+};
+
+void* HostAllocator::AllocateZeroedBytes(size_t size, size_t alignment) {
+  void* ptr = AllocateBytes(size, alignment);
+  if (ptr != nullptr) std::memset(ptr, 0, size);
+  return ptr;
+}
+
 void HostAllocator::VtableAnchor() {}
 
+static thread_local int current_numa_node = -1;
+
+int GetCurrentNumaNode() { return current_numa_node; }
+
+void internal::SetCurrentNumaNode(int node) { current_numa_node = node; }
+
 std::unique_ptr<HostAllocator> CreateMallocAllocator() {
   return std::make_unique<MallocAllocator>();
 }
 
+std::unique_ptr<HostAllocator> CreateSharedAllocator(
+    std::shared_ptr<HostAllocator> allocator) {
+  assert(allocator != nullptr);
+  return std::make_unique<SharedAllocator>(std::move(allocator));
+}
+
+std::unique_ptr<HostAllocator> CreateRequestArenaAllocator(
+    HostAllocator* parent, size_t block_size) {
+  assert(parent != nullptr);
+  return std::make_unique<RequestArenaAllocator>(
+      parent, std::max<size_t>(block_size, 1024));
+}
+
 }  // namespace tfrt
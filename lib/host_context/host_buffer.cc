@@ -18,6 +18,8 @@
 
 #include "tfrt/host_context/host_buffer.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 
@@ -27,16 +29,49 @@
 
 namespace tfrt {
 
+uint64_t HostBuffer::NextId() {
+  static constexpr uint64_t kBlockSize = 1024;
+  static std::atomic<uint64_t> next_block{0};
+  thread_local uint64_t next_id = 0;
+  thread_local uint64_t end_id = 0;
+  if (next_id == end_id) {
+    next_id = next_block.fetch_add(kBlockSize, std::memory_order_relaxed);
+    end_id = next_id + kBlockSize;
+  }
+  return next_id++;
+}
+
 RCReference<HostBuffer> HostBuffer::CreateUninitialized(
     size_t size, size_t alignment, HostAllocator *allocator) {
+  return Create(size, alignment, /*zeroed=*/false, allocator);
+}
+
+RCReference<HostBuffer> HostBuffer::CreateZeroed(size_t size, size_t alignment,
+                                                 HostAllocator *allocator) {
+  return Create(size, alignment, /*zeroed=*/true, allocator);
+}
+
+RCReference<HostBuffer> HostBuffer::Create(size_t size, size_t alignment,
+                                           bool zeroed,
+                                           HostAllocator *allocator) {
   assert(llvm::isPowerOf2_32(alignment) &&
          "Only power of 2 aligments are supported");
 
+  if (size >= kLargeBufferSize)
+    alignment = std::max(alignment, kLargeBufferAlignment);
+
+  // The header of the buffer is constructed in the allocated memory, so only
+  // the data stays zeroed.
+  auto allocate = [&](size_t alloc_size) {
+    return zeroed ? allocator->AllocateZeroedBytes(alloc_size,
+                                                   alignof(HostBuffer))
+                  : allocator->AllocateBytes(alloc_size, alignof(HostBuffer));
+  };
+
   // If the requested alignment is not greater than the alignment of
   // unaligned_data_ field, we do not need to do additional adjustment.
   if (alignment <= alignof(std::max_align_t)) {
-    auto *buf = allocator->AllocateBytes(sizeof(HostBuffer) + size,
-                                         alignof(HostBuffer));
+    auto *buf = allocate(sizeof(HostBuffer) + size);
     if (!buf) return {};
 
     auto host_buffer = TakeRef(new (buf) HostBuffer(size, size, allocator));
@@ -49,8 +84,7 @@ RCReference<HostBuffer> HostBuffer::CreateUninitialized(
   // field, allocate (size + alignment) for the data so we have enough space to
   // adjust the buffer for alignment.
   size_t alloc_size = size + alignment;
-  auto *buf = allocator->AllocateBytes(sizeof(HostBuffer) + alloc_size,
-                                       alignof(HostBuffer));
+  auto *buf = allocate(sizeof(HostBuffer) + alloc_size);
   if (!buf) return {};
 
   auto host_buffer = TakeRef(new (buf) HostBuffer(size, alloc_size, allocator));
@@ -41,20 +41,7 @@ void HostContextPool::FreeHostContext(HostContext* host) {
   all_host_contexts_[host->instance_ptr().index()] = nullptr;
 }
 
-HostContext* HostContextPool::GetHostContextByIndex(int index) const {
-  // Note that we do not need to lock the mutex here as
-  // all_host_contexts_[index] is guranteed to filled when this function is
-  // called.
-  assert(index < all_host_contexts_.size());
-  assert(all_host_contexts_[index]);
-  return all_host_contexts_[index];
-}
-
 HostContextPtr::HostContextPtr(HostContext* host)
     : HostContextPtr{host->instance_ptr()} {}
 
-HostContext* HostContextPtr::get() const {
-  return HostContextPool::instance().GetHostContextByIndex(index_);
-}
-
 }  // namespace tfrt
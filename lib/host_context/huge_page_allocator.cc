@@ -0,0 +1,196 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//===- huge_page_allocator.cc - Huge Page Backed Memory Allocator ---------===//
+//
+// This file implements a host memory allocator that serves large allocations
+// from 2MB huge pages.
+//
+// Large allocations are rounded up to a multiple of kHugePageSize and mapped
+// aligned to kHugePageSize, so that every page of the allocation can be backed
+// by a huge page. Explicit huge pages (MAP_HUGETLB) are used while the system
+// has them reserved, and transparent huge pages (MADV_HUGEPAGE) otherwise.
+// Freed mappings are cached for reuse up to a byte limit, because mapping
+// fresh memory and faulting it in costs more than most uses of it.
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "llvm/Support/MathExtras.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/support/mutex.h"
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace tfrt {
+
+#if defined(__linux__)
+namespace {
+
+constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
+// Explicit huge pages of kHugePageSize, rather than of the default huge page
+// size of the system.
+#if defined(MAP_HUGE_2MB)
+constexpr int kHugeTlbFlags = MAP_HUGETLB | MAP_HUGE_2MB;
+#else
+constexpr int kHugeTlbFlags = MAP_HUGETLB;
+#endif
+
+class HugePageAllocator : public HostAllocator {
+ public:
+  HugePageAllocator(std::unique_ptr<HostAllocator> parent, size_t min_size,
+                    size_t max_cached_bytes)
+      : parent_(std::move(parent)),
+        min_size_(min_size),
+        max_cached_bytes_(max_cached_bytes) {}
+
+  ~HugePageAllocator() override {
+    for (const Mapping& mapping : cached_mappings_)
+      munmap(mapping.address, mapping.size);
+  }
+
+  void* AllocateBytes(size_t size, size_t alignment) override {
+    if (size < min_size_) return parent_->AllocateBytes(size, alignment);
+
+    size_t mapping_size = llvm::alignTo(size, kHugePageSize);
+    if (void* address = TakeCachedMapping(mapping_size, alignment))
+      return address;
+    return Map(mapping_size, std::max(alignment, kHugePageSize));
+  }
+
+  void* AllocateZeroedBytes(size_t size, size_t alignment) override {
+    if (size < min_size_) return parent_->AllocateZeroedBytes(size, alignment);
+
+    // Cached mappings hold the data of their last allocation, while new
+    // mappings are backed by zero pages until they are written.
+    size_t mapping_size = llvm::alignTo(size, kHugePageSize);
+    if (void* address = TakeCachedMapping(mapping_size, alignment)) {
+      std::memset(address, 0, size);
+      return address;
+    }
+    return Map(mapping_size, std::max(alignment, kHugePageSize));
+  }
+
+  void DeallocateBytes(void* ptr, size_t size) override {
+    if (size < min_size_) return parent_->DeallocateBytes(ptr, size);
+
+    size_t mapping_size = llvm::alignTo(size, kHugePageSize);
+    {
+      mutex_lock lock(mu_);
+      if (cached_bytes_ + mapping_size <= max_cached_bytes_) {
+        cached_mappings_.push_back({ptr, mapping_size});
+        cached_bytes_ += mapping_size;
+        return;
+      }
+    }
+    munmap(ptr, mapping_size);
+  }
+
+ private:
+  struct Mapping {
+    void* address;
+    size_t size;
+  };
+
+  // Remove a cached mapping of `mapping_size` bytes from the cache and return
+  // it, or return nullptr if the cache has none with `alignment`.
+  void* TakeCachedMapping(size_t mapping_size, size_t alignment) {
+    if (alignment > kHugePageSize) return nullptr;
+    mutex_lock lock(mu_);
+    auto it = std::find_if(
+        cached_mappings_.begin(), cached_mappings_.end(),
+        [&](const Mapping& mapping) { return mapping.size == mapping_size; });
+    if (it == cached_mappings_.end()) return nullptr;
+    void* address = it->address;
+    cached_bytes_ -= mapping_size;
+    *it = cached_mappings_.back();
+    cached_mappings_.pop_back();
+    return address;
+  }
+
+  // Map `size` bytes aligned to `alignment`. Return nullptr if the memory is
+  // exhausted.
+  void* Map(size_t size, size_t alignment) {
+    // Explicit huge pages are always aligned to kHugePageSize. Stop trying them
+    // once the reserved ones are used up, as every failed attempt is a syscall.
+    if (alignment == kHugePageSize &&
+        use_explicit_huge_pages_.load(std::memory_order_relaxed)) {
+      void* address =
+          mmap(nullptr, size, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS | kHugeTlbFlags, /*fd=*/-1, 0);
+      if (address != MAP_FAILED) return address;
+      use_explicit_huge_pages_.store(false, std::memory_order_relaxed);
+    }
+
+    // Over-map by `alignment` and unmap the unaligned head and the tail.
+    size_t mapped_size = size + alignment;
+    void* mapped = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, /*fd=*/-1, 0);
+    if (mapped == MAP_FAILED) return nullptr;
+
+    auto begin = reinterpret_cast<uintptr_t>(mapped);
+    uintptr_t aligned = llvm::alignTo(begin, alignment);
+    if (aligned != begin) munmap(mapped, aligned - begin);
+    if (size_t tail = begin + mapped_size - (aligned + size))
+      munmap(reinterpret_cast<void*>(aligned + size), tail);
+
+    // Transparent huge pages are a hint, so a failure is not an error.
+    auto* address = reinterpret_cast<void*>(aligned);
+    madvise(address, size, MADV_HUGEPAGE);
+    return address;
+  }
+
+  const std::unique_ptr<HostAllocator> parent_;
+  const size_t min_size_;
+  const size_t max_cached_bytes_;
+
+  std::atomic<bool> use_explicit_huge_pages_{true};
+
+  mutex mu_;
+  std::vector<Mapping> cached_mappings_ TFRT_GUARDED_BY(mu_);
+  size_t cached_bytes_ TFRT_GUARDED_BY(mu_) = 0;
+};
+
+}  // namespace
+
+std::unique_ptr<HostAllocator> CreateHugePageAllocator(
+    std::unique_ptr<HostAllocator> parent, size_t min_size,
+    size_t max_cached_bytes) {
+  assert(parent != nullptr);
+  return std::make_unique<HugePageAllocator>(
+      std::move(parent), std::max<size_t>(min_size, 1), max_cached_bytes);
+}
+
+#else  // defined(__linux__)
+
+std::unique_ptr<HostAllocator> CreateHugePageAllocator(
+    std::unique_ptr<HostAllocator> parent, size_t min_size,
+    size_t max_cached_bytes) {
+  // Huge pages are only supported on Linux.
+  return parent;
+}
+
+#endif  // defined(__linux__)
+
+}  // namespace tfrt
@@ -19,6 +19,8 @@
 
 #include "tfrt/host_context/kernel_frame.h"
 
+#include <cassert>
+
 #include "tfrt/host_context/diagnostic.h"
 #include "tfrt/support/ref_count.h"
 
@@ -46,4 +48,18 @@ void AsyncKernelFrame::ReportError(string_view msg) {
   assert(has_set_error && "ReportError must set at least one error");
 }
 
+RCReference<HostBuffer> AsyncKernelFrame::BorrowAttributeData(
+    const void* data, size_t size) const {
+  if (attribute_section_owner_ == nullptr) return {};
+  assert(static_cast<const uint8_t*>(data) >= attribute_section_.begin() &&
+         static_cast<const uint8_t*>(data) + size <= attribute_section_.end() &&
+         "data is not in the attribute section");
+
+  const AttributeSectionOwner* owner = attribute_section_owner_;
+  owner->AddAttributeSectionRef();
+  return HostBuffer::CreateFromExternal(
+      const_cast<void*>(data), size,
+      [owner](void*, size_t) { owner->DropAttributeSectionRef(); });
+}
+
 }  // namespace tfrt
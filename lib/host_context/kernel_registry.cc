@@ -16,11 +16,16 @@
 
 #include "tfrt/host_context/kernel_registry.h"
 
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
 #include <vector>
 
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/StringSet.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/xxhash.h"
 #include "tfrt/host_context/type_name.h"
 #include "tfrt/support/forward_decls.h"
 #include "tfrt/support/mutex.h"
@@ -31,7 +36,34 @@ using llvm::StringMap;
 using llvm::StringSet;
 
 struct KernelRegistry::Impl {
+  struct FrozenEntry {
+    uint64_t hash = 0;
+    // Points to the key of the entry in `implementations`. Null for an empty
+    // slot.
+    const char* name = nullptr;
+    size_t name_size = 0;
+    KernelImplementation implementation;
+  };
+
+  // Returns the entry of `name` in the frozen table, or null if there is none.
+  const FrozenEntry* FindFrozen(string_view name) const {
+    const uint64_t hash = llvm::xxHash64(name);
+    const size_t mask = frozen.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+      const FrozenEntry& entry = frozen[i];
+      if (entry.name == nullptr) return nullptr;
+      if (entry.hash == hash &&
+          string_view(entry.name, entry.name_size) == name)
+        return &entry;
+    }
+  }
+
   StringMap<KernelImplementation> implementations;
+  // The tables added by AddKernelTable(), which are not copied.
+  std::vector<ArrayRef<StaticKernel>> tables;
+  // A linear probing table of `implementations` that is at most half full, or
+  // empty if the registry is not frozen. See KernelRegistry::Freeze().
+  std::vector<FrozenEntry> frozen;
   StringSet<> type_names TFRT_GUARDED_BY(mu);
   mutex mu;
 };
@@ -47,6 +79,7 @@ void KernelRegistry::AddKernel(string_view kernel_name,
           .second;
   (void)added;
   assert(added && "Re-registered existing kernel_name for async kernel");
+  impl_->frozen.clear();
 }
 
 void KernelRegistry::AddSyncKernel(string_view kernel_name,
@@ -56,12 +89,55 @@ void KernelRegistry::AddSyncKernel(string_view kernel_name,
           .second;
   (void)added;
   assert(added && "Re-registered existing kernel_name for sync kernel");
+  impl_->frozen.clear();
+}
+
+void KernelRegistry::AddKernelTable(ArrayRef<StaticKernel> kernels) {
+  if (kernels.empty()) return;
+  impl_->tables.push_back(kernels);
+  impl_->frozen.clear();
 }
 
 KernelImplementation KernelRegistry::GetKernel(string_view kernel_name) const {
+  if (!impl_->frozen.empty()) {
+    const Impl::FrozenEntry* entry = impl_->FindFrozen(kernel_name);
+    return entry ? entry->implementation : KernelImplementation();
+  }
+
   auto it = impl_->implementations.find(kernel_name);
-  return it == impl_->implementations.end() ? KernelImplementation()
-                                            : it->second;
+  if (it != impl_->implementations.end()) return it->second;
+  for (ArrayRef<StaticKernel> table : impl_->tables) {
+    for (const StaticKernel& kernel : table)
+      if (kernel.name == kernel_name) return kernel.implementation();
+  }
+  return KernelImplementation();
+}
+
+void KernelRegistry::Freeze() {
+  size_t num_kernels = impl_->implementations.size();
+  for (ArrayRef<StaticKernel> table : impl_->tables)
+    num_kernels += table.size();
+
+  const size_t num_slots =
+      llvm::PowerOf2Ceil(std::max<size_t>(2 * num_kernels, 16));
+  std::vector<Impl::FrozenEntry> frozen(num_slots);
+  auto insert = [&](string_view name, KernelImplementation implementation) {
+    const uint64_t hash = llvm::xxHash64(name);
+    size_t i = hash & (num_slots - 1);
+    for (; frozen[i].name != nullptr; i = (i + 1) & (num_slots - 1)) {
+      assert((frozen[i].hash != hash ||
+              string_view(frozen[i].name, frozen[i].name_size) != name) &&
+             "Re-registered existing kernel_name");
+    }
+    frozen[i] = {hash, name.data(), name.size(), implementation};
+  };
+  for (const auto& kernel : impl_->implementations)
+    insert(kernel.getKey(), kernel.getValue());
+  for (ArrayRef<StaticKernel> table : impl_->tables) {
+    for (const StaticKernel& kernel : table)
+      insert(kernel.name, kernel.implementation());
+  }
+  impl_->frozen = std::move(frozen);
 }
 
 TypeName KernelRegistry::GetType(string_view type_name) const {
@@ -80,10 +156,24 @@ void AddStaticKernelRegistration(KernelRegistration func) {
   GetStaticKernelRegistrations()->push_back(func);
 }
 
+static std::vector<ArrayRef<StaticKernel>>* GetStaticKernelTables() {
+  static std::vector<ArrayRef<StaticKernel>>* ret =
+      new std::vector<ArrayRef<StaticKernel>>;
+  return ret;
+}
+
+void AddStaticKernelTable(ArrayRef<StaticKernel> kernels) {
+  GetStaticKernelTables()->push_back(kernels);
+}
+
 void RegisterStaticKernels(KernelRegistry* kernel_reg) {
+  for (ArrayRef<StaticKernel> table : *GetStaticKernelTables()) {
+    kernel_reg->AddKernelTable(table);
+  }
   for (auto func : *GetStaticKernelRegistrations()) {
     func(kernel_reg);
   }
+  kernel_reg->Freeze();
 }
 
 }  // namespace tfrt
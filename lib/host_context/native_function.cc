@@ -16,9 +16,11 @@
 
 #include "tfrt/host_context/native_function.h"
 
+#include "absl/status/status.h"  // from @com_google_absl
 #include "tfrt/host_context/async_dispatch.h"
 #include "tfrt/host_context/execution_context.h"
 #include "tfrt/host_context/host_context.h"
+#include "tfrt/support/error_util.h"
 
 namespace tfrt {
 
@@ -27,6 +29,14 @@ void NativeFunction::Execute(
     MutableArrayRef<RCReference<AsyncValue>> results) const {
   HostContext* host = exec_ctx.host();
 
+  if (callable_ == nullptr) {
+    for (auto& result : results) {
+      result = MakeErrorAsyncValueRef(absl::InternalError(
+          StrCat("native function ", name(), " has no async implementation")));
+    }
+    return;
+  }
+
   llvm::SmallVector<AsyncValue*, 4> unavailable_args;
   for (auto* av : arguments)
     if (!av->IsAvailable()) unavailable_args.push_back(av);
@@ -70,4 +80,16 @@ void NativeFunction::Execute(
                });
 }
 
+Error NativeFunction::SyncExecute(const ExecutionContext& exec_ctx,
+                                  ArrayRef<Value*> arguments,
+                                  ArrayRef<Value*> results) const {
+  assert(arguments.size() == num_arguments() && "argument count mismatch");
+  assert(results.size() == num_results() && "result count mismatch");
+  if (sync_callable_ == nullptr)
+    return MakeStringError("native function ", name(),
+                           " has no sync implementation");
+  return sync_callable_(arguments.data(), arguments.size(), results.data(),
+                        results.size(), exec_ctx);
+}
+
 }  // namespace tfrt
@@ -18,14 +18,21 @@
 
 #include "tfrt/host_context/parallel_for.h"
 
+#include <algorithm>
+#include <atomic>
+
+#include "llvm/ADT/SmallVector.h"
 #include "tfrt/host_context/async_dispatch.h"
 #include "tfrt/host_context/chain.h"
 #include "tfrt/host_context/host_context.h"
+#include "tfrt/host_context/task_function.h"
 
 namespace tfrt {
 
 using BlockSizes = ParallelFor::BlockSizes;
 
+thread_local int ParallelFor::RegionScope::depth_ = 0;
+
 //===----------------------------------------------------------------------===//
 // BlockSizes configures how a range is split into blocks executed in parallel.
 //===----------------------------------------------------------------------===//
@@ -39,6 +46,12 @@ BlockSizes ParallelFor::BlockSizes::Min(size_t min) {
       [min](size_t block_size) { return std::max(min, block_size); });
 }
 
+BlockSizes ParallelFor::BlockSizes::Adaptive(size_t min) {
+  BlockSizes block_sizes([min](size_t) { return min; });
+  block_sizes.adaptive_min_block_size_ = std::max<size_t>(1, min);
+  return block_sizes;
+}
+
 size_t ParallelFor::BlockSizes::GetBlockSize(size_t num_worker_threads,
                                              size_t total_size) const {
   // Do not create too many small blocks.
@@ -96,7 +109,11 @@ class ParallelForExecutionContext {
     assert(end_block - start_block == 1);
 
     // Call `compute` for a single block.
-    compute_(start_block * block_size_, std::min(n_, end_block * block_size_));
+    {
+      ParallelFor::RegionScope scope;
+      compute_(start_block * block_size_,
+               std::min(n_, end_block * block_size_));
+    }
 
     // Delete this context if it was the last block.
     if (pending_blocks_.fetch_sub(1) == 1) delete this;
@@ -135,6 +152,95 @@ class ParallelForExecutionContext {
   llvm::unique_function<void()> on_done_;
 };
 
+// The execution context of a parallel for with adaptive block sizes. Each
+// worker claims blocks from a shared cursor until the range is exhausted, and
+// the last worker to finish calls `on_done`.
+class AdaptiveParallelForExecutionContext {
+ public:
+  static AdaptiveParallelForExecutionContext* Allocate(
+      ExecutionContext exec_ctx, size_t n, size_t min_block_size,
+      size_t num_workers, llvm::unique_function<void(size_t, size_t)> compute,
+      llvm::unique_function<void()> on_done) {
+    return new AdaptiveParallelForExecutionContext(
+        std::move(exec_ctx), n, min_block_size, num_workers,
+        std::move(compute), std::move(on_done));
+  }
+
+  // RunWorkers() enqueues all workers but one as a single batch, and runs the
+  // remaining one in the caller thread. Unlike the blocks of EvalBlocks(), the
+  // workers are interchangeable, so there is nothing to split recursively.
+  void RunWorkers() {
+    llvm::SmallVector<TaskFunction, 16> workers;
+    for (size_t i = 1; i < num_workers_; ++i)
+      workers.push_back(TaskFunction([this]() { RunWorker(); }));
+    EnqueueWork(exec_ctx_, workers);
+    RunWorker();
+  }
+
+ private:
+  // Claims and computes blocks until the range is exhausted.
+  void RunWorker() {
+    {
+      ParallelFor::RegionScope scope;
+      size_t start, end;
+      while (ClaimBlock(&start, &end)) compute_(start, end);
+    }
+
+    // Delete this context if it was the last worker.
+    if (pending_workers_.fetch_sub(1) == 1) delete this;
+  }
+
+  // The number of blocks each worker would get if it claimed the rest of the
+  // range in blocks of the current size. Guided self-scheduling uses one;
+  // a larger value leaves more room to balance skewed costs.
+  static constexpr size_t kBlocksPerWorker = 2;
+
+  AdaptiveParallelForExecutionContext(
+      ExecutionContext exec_ctx, size_t n, size_t min_block_size,
+      size_t num_workers, llvm::unique_function<void(size_t, size_t)> compute,
+      llvm::unique_function<void()> on_done)
+      : exec_ctx_(std::move(exec_ctx)),
+        n_(n),
+        min_block_size_(min_block_size),
+        num_workers_(num_workers),
+        pending_workers_(num_workers),
+        compute_(std::move(compute)),
+        on_done_(std::move(on_done)) {}
+
+  ~AdaptiveParallelForExecutionContext() { on_done_(); }
+
+  // Claim the next block [start, end) of the range. Returns false if the range
+  // is exhausted.
+  bool ClaimBlock(size_t* start, size_t* end) {
+    size_t next = next_.load(std::memory_order_relaxed);
+    while (next < n_) {
+      const size_t remaining = n_ - next;
+      const size_t block_size = std::min(
+          remaining, std::max(min_block_size_,
+                              remaining / (kBlocksPerWorker * num_workers_)));
+      if (next_.compare_exchange_weak(next, next + block_size,
+                                      std::memory_order_relaxed)) {
+        *start = next;
+        *end = next + block_size;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  ExecutionContext exec_ctx_;  // The data in exec_ctx_ must stay alive before
+                               // the `on_done` is called
+
+  size_t n_;
+  size_t min_block_size_;
+  size_t num_workers_;
+  std::atomic<size_t> next_{0};
+  std::atomic<size_t> pending_workers_;
+
+  llvm::unique_function<void(size_t, size_t)> compute_;
+  llvm::unique_function<void()> on_done_;
+};
+
 }  // namespace
 
 void ParallelFor::Execute(size_t total_size, const BlockSizes& block_sizes,
@@ -143,9 +249,36 @@ void ParallelFor::Execute(size_t total_size, const BlockSizes& block_sizes,
   // Immediately call `on_done` if nothing to execute.
   if (total_size == 0) return on_done();
 
+  // The worker threads are already busy with the blocks of the enclosing
+  // parallel regions. Splitting a nested range for all of them again would
+  // multiply the number of tasks in the work queue at every level.
+  const int depth = RegionScope::Depth();
+  const size_t num_worker_threads =
+      depth > 0 ? 1 : std::max(1, exec_ctx_.host()->GetNumWorkerThreads());
+
+  if (size_t min_block_size = block_sizes.adaptive_min_block_size_) {
+    // There is no point in starting more workers than there are blocks. A
+    // nested region starts two workers, so that an idle thread can still help.
+    const size_t max_blocks = (total_size + min_block_size - 1) / min_block_size;
+    const size_t num_workers = std::min<size_t>(
+        max_blocks, depth > 0 ? 2 : num_worker_threads);
+
+    if (num_workers == 1 || depth >= kMaxNestingDepth) {
+      compute(0, total_size);
+      on_done();
+      return;
+    }
+
+    auto* ctx = AdaptiveParallelForExecutionContext::Allocate(
+        exec_ctx_, total_size, min_block_size, num_workers, std::move(compute),
+        std::move(on_done));
+    ctx->RunWorkers();
+    return;
+  }
+
   // Compute a parallel block size for the non-empty range [0, total_size).
-  const size_t block_size = block_sizes.GetBlockSize(
-      exec_ctx_.host()->GetNumWorkerThreads(), total_size);
+  const size_t block_size =
+      block_sizes.GetBlockSize(num_worker_threads, total_size);
   assert(block_size > 0 && "Illegal block size");
   assert(block_size <= total_size && "Illegal block size");
 
@@ -156,6 +289,16 @@ void ParallelFor::Execute(size_t total_size, const BlockSizes& block_sizes,
     return;
   }
 
+  // Deeply nested regions execute all blocks in the caller thread. Blocks are
+  // still passed to `compute` one at a time, because the caller may rely on
+  // their sizes (e.g. with fixed block sizes).
+  if (depth >= kMaxNestingDepth) {
+    for (size_t start = 0; start < total_size; start += block_size)
+      compute(start, std::min(total_size, start + block_size));
+    on_done();
+    return;
+  }
+
   // Allocate parallel for execution context on the heap.
   ParallelForExecutionContext* ctx = ParallelForExecutionContext::Allocate(
       exec_ctx_, total_size, block_size, std::move(compute),
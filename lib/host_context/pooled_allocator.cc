@@ -0,0 +1,331 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//===- pooled_allocator.cc - Size-Class Pooled Memory Allocator -----------===//
+//
+// This file implements a host memory allocator that serves small allocations
+// from size-class pools with per-thread free lists.
+//
+// Small chunks are carved out of slabs of kSlabSize bytes that are aligned to
+// kSlabSize, and each slab starts with a header recording its size class. This
+// lets DeallocateBytes() find the pool of a chunk from its address alone,
+// regardless of the alignment it was allocated with.
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "llvm/Support/MathExtras.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/support/mutex.h"
+
+namespace tfrt {
+namespace {
+
+constexpr size_t kSlabSize = 64 * 1024;
+
+// Allocations larger than this go directly to the parent allocator.
+constexpr size_t kMaxPooledSize = 4096;
+
+// Four size classes per power of two, all multiples of 16 bytes.
+constexpr std::array<uint32_t, 28> kSizeClasses = {
+    16,   32,   48,   64,   80,   96,   112,  128,  160,  192,
+    224,  256,  320,  384,  448,  512,  640,  768,  896,  1024,
+    1280, 1536, 1792, 2048, 2560, 3072, 3584, 4096};
+constexpr size_t kNumSizeClasses = kSizeClasses.size();
+
+// Slab header class index used for over-aligned small allocations that are
+// given a slab of their own.
+constexpr uint32_t kDedicatedSlab = kNumSizeClasses;
+
+struct SlabHeader {
+  uint32_t size_class;
+  // The number of bytes allocated from the parent for this slab.
+  size_t slab_size;
+};
+
+struct FreeChunk {
+  FreeChunk* next;
+};
+
+// A singly linked list of free chunks of one size class.
+struct FreeList {
+  FreeChunk* head = nullptr;
+  size_t size = 0;
+
+  void Push(void* ptr) {
+    auto* chunk = static_cast<FreeChunk*>(ptr);
+    chunk->next = head;
+    head = chunk;
+    ++size;
+  }
+
+  void* Pop() {
+    assert(head != nullptr);
+    FreeChunk* chunk = head;
+    head = chunk->next;
+    --size;
+    return chunk;
+  }
+
+  // Move up to `count` chunks from this list to `other`.
+  void MoveTo(FreeList* other, size_t count) {
+    while (count-- > 0 && head != nullptr) other->Push(Pop());
+  }
+};
+
+// The alignment every chunk of the size class is guaranteed to have.
+constexpr size_t ChunkAlignment(size_t class_size) {
+  return class_size & -class_size;
+}
+
+// The number of chunks moved between a thread cache and the shared pool at
+// once.
+size_t BatchSize(size_t class_size) {
+  return std::max<size_t>(1, std::min<size_t>(32, 16 * 1024 / class_size));
+}
+
+// Return the smallest size class that holds `size` bytes at `alignment`, or
+// kNumSizeClasses if there is none.
+size_t GetSizeClass(size_t size, size_t alignment) {
+  size = std::max<size_t>(size, 1);
+  size_t index = std::lower_bound(kSizeClasses.begin(), kSizeClasses.end(),
+                                  std::max(size, alignment)) -
+                 kSizeClasses.begin();
+  while (index < kNumSizeClasses &&
+         ChunkAlignment(kSizeClasses[index]) < alignment)
+    ++index;
+  return index;
+}
+
+// The state shared by all threads using one pooled allocator. It is kept alive
+// by the allocator, and weakly referenced by the thread caches so that a thread
+// exiting after the allocator is gone does not touch it.
+class SharedPool {
+ public:
+  explicit SharedPool(std::unique_ptr<HostAllocator> parent)
+      : parent_(std::move(parent)) {}
+
+  ~SharedPool() {
+    for (void* slab : slabs_) {
+      auto* header = static_cast<SlabHeader*>(slab);
+      parent_->DeallocateBytes(slab, header->slab_size);
+    }
+  }
+
+  HostAllocator* parent() const { return parent_.get(); }
+
+  // Fill `list` with a batch of chunks of `size_class`.
+  void Refill(size_t size_class, FreeList* list) {
+    size_t batch = BatchSize(kSizeClasses[size_class]);
+    {
+      ClassPool& pool = class_pools_[size_class];
+      mutex_lock lock(pool.mu);
+      pool.free_list.MoveTo(list, batch);
+    }
+    if (list->head == nullptr) CarveSlab(size_class, list);
+  }
+
+  // Return `count` chunks of `size_class` from `list` to the shared pool.
+  void Release(size_t size_class, FreeList* list, size_t count) {
+    ClassPool& pool = class_pools_[size_class];
+    mutex_lock lock(pool.mu);
+    list->MoveTo(&pool.free_list, count);
+  }
+
+  // Allocate a slab holding one chunk of `size` bytes at `alignment`, for
+  // alignments that none of the size classes satisfy.
+  void* AllocateDedicated(size_t size, size_t alignment) {
+    assert(alignment < kSlabSize && "alignment too large for pooled allocator");
+    size_t slab_size = alignment + size;
+    void* slab = NewSlab(kDedicatedSlab, slab_size);
+    return static_cast<char*>(slab) + alignment;
+  }
+
+  void DeallocateDedicated(SlabHeader* header) {
+    {
+      mutex_lock lock(slabs_mu_);
+      slabs_.erase(std::find(slabs_.begin(), slabs_.end(), header));
+    }
+    parent_->DeallocateBytes(header, header->slab_size);
+  }
+
+ private:
+  struct ClassPool {
+    mutex mu;
+    FreeList free_list TFRT_GUARDED_BY(mu);
+  };
+
+  void* NewSlab(uint32_t size_class, size_t slab_size) {
+    void* slab = parent_->AllocateBytes(slab_size, kSlabSize);
+    auto* header = static_cast<SlabHeader*>(slab);
+    header->size_class = size_class;
+    header->slab_size = slab_size;
+
+    mutex_lock lock(slabs_mu_);
+    slabs_.push_back(slab);
+    return slab;
+  }
+
+  // Carve a new slab into chunks of `size_class` and push them to `list`.
+  void CarveSlab(size_t size_class, FreeList* list) {
+    size_t class_size = kSizeClasses[size_class];
+    char* slab = static_cast<char*>(NewSlab(size_class, kSlabSize));
+
+    // The first chunk must keep the alignment of the size class.
+    size_t offset =
+        llvm::alignTo(sizeof(SlabHeader), ChunkAlignment(class_size));
+    for (; offset + class_size <= kSlabSize; offset += class_size)
+      list->Push(slab + offset);
+  }
+
+  std::unique_ptr<HostAllocator> parent_;
+  std::array<ClassPool, kNumSizeClasses> class_pools_;
+
+  mutex slabs_mu_;
+  std::vector<void*> slabs_ TFRT_GUARDED_BY(slabs_mu_);
+};
+
+// The free lists of one thread for one pooled allocator.
+struct ThreadCache {
+  uint64_t allocator_id;
+  std::weak_ptr<SharedPool> pool;
+  std::array<FreeList, kNumSizeClasses> free_lists;
+};
+
+// All thread caches of the current thread. Chunks left in the caches are
+// returned to their shared pool when the thread exits.
+class ThreadCaches {
+ public:
+  ~ThreadCaches() {
+    for (auto& cache : caches_) {
+      auto pool = cache->pool.lock();
+      if (!pool) continue;
+      for (size_t i = 0; i < kNumSizeClasses; ++i) {
+        FreeList& list = cache->free_lists[i];
+        pool->Release(i, &list, list.size);
+      }
+    }
+  }
+
+  ThreadCache* Get(uint64_t allocator_id,
+                   const std::shared_ptr<SharedPool>& pool) {
+    if (last_ != nullptr && last_->allocator_id == allocator_id) return last_;
+
+    // Forget the caches of allocators that are gone. Their chunks belonged to
+    // slabs that were released with the allocator.
+    caches_.erase(std::remove_if(caches_.begin(), caches_.end(),
+                                 [](const std::unique_ptr<ThreadCache>& c) {
+                                   return c->pool.expired();
+                                 }),
+                  caches_.end());
+
+    for (auto& cache : caches_) {
+      if (cache->allocator_id == allocator_id) return last_ = cache.get();
+    }
+
+    caches_.push_back(std::make_unique<ThreadCache>());
+    last_ = caches_.back().get();
+    last_->allocator_id = allocator_id;
+    last_->pool = pool;
+    return last_;
+  }
+
+ private:
+  ThreadCache* last_ = nullptr;
+  std::vector<std::unique_ptr<ThreadCache>> caches_;
+};
+
+class PooledAllocator : public HostAllocator {
+ public:
+  explicit PooledAllocator(std::unique_ptr<HostAllocator> parent)
+      : id_(next_id_.fetch_add(1, std::memory_order_relaxed)),
+        pool_(std::make_shared<SharedPool>(std::move(parent))) {}
+
+  void* AllocateBytes(size_t size, size_t alignment) override {
+    if (size > kMaxPooledSize)
+      return pool_->parent()->AllocateBytes(size, alignment);
+
+    size_t size_class = GetSizeClass(size, alignment);
+    if (size_class == kNumSizeClasses)
+      return pool_->AllocateDedicated(size, alignment);
+
+    FreeList& list = GetThreadCache()->free_lists[size_class];
+    if (list.head == nullptr) pool_->Refill(size_class, &list);
+    return list.Pop();
+  }
+
+  // Small chunks are recycled, so they are cleared. Large allocations may get
+  // fresh pages from the parent.
+  void* AllocateZeroedBytes(size_t size, size_t alignment) override {
+    if (size > kMaxPooledSize)
+      return pool_->parent()->AllocateZeroedBytes(size, alignment);
+    return HostAllocator::AllocateZeroedBytes(size, alignment);
+  }
+
+  void DeallocateBytes(void* ptr, size_t size) override {
+    if (size > kMaxPooledSize) {
+      pool_->parent()->DeallocateBytes(ptr, size);
+      return;
+    }
+
+    // Every small chunk lives in a kSlabSize aligned slab that starts with a
+    // header recording the size class.
+    auto* header = reinterpret_cast<SlabHeader*>(
+        reinterpret_cast<uintptr_t>(ptr) & ~(kSlabSize - 1));
+    size_t size_class = header->size_class;
+    if (size_class == kDedicatedSlab) {
+      pool_->DeallocateDedicated(header);
+      return;
+    }
+
+    FreeList& list = GetThreadCache()->free_lists[size_class];
+
+    // Give a batch back to the shared pool if this thread is mostly freeing
+    // memory allocated by other threads. This is done before pushing `ptr`,
+    // so that `ptr`, which is likely still in the CPU cache, is reused first.
+    size_t batch = BatchSize(kSizeClasses[size_class]);
+    if (list.size >= 2 * batch) pool_->Release(size_class, &list, batch);
+    list.Push(ptr);
+  }
+
+ private:
+  ThreadCache* GetThreadCache() {
+    static thread_local ThreadCaches thread_caches;
+    return thread_caches.Get(id_, pool_);
+  }
+
+  // Identifies the allocator in the thread caches. Unlike the address of the
+  // allocator, it is never reused.
+  static std::atomic<uint64_t> next_id_;
+
+  const uint64_t id_;
+  std::shared_ptr<SharedPool> pool_;
+};
+
+std::atomic<uint64_t> PooledAllocator::next_id_{0};
+
+}  // namespace
+
+std::unique_ptr<HostAllocator> CreatePooledAllocator(
+    std::unique_ptr<HostAllocator> parent) {
+  return std::make_unique<PooledAllocator>(std::move(parent));
+}
+
+}  // namespace tfrt
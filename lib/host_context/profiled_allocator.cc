@@ -15,15 +15,27 @@
 //===- profiled_allocator.cc - Profiled Memory Allocator ------------------===//
 //
 // This file implements a profiling host memory allocator that does a memory
-// leak check and prints allocation statistics when destroyed.
+// leak check and prints allocation statistics when destroyed, and a sampling
+// allocation profiler that attributes allocations to kernels.
 
 #include "tfrt/host_context/profiled_allocator.h"
 
+#include <algorithm>
 #include <atomic>
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
+#include <string>
+#include <vector>
 
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/raw_ostream.h"
+#include "tfrt/host_context/allocation_site.h"
 #include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/location.h"
+#include "tfrt/support/mutex.h"
 
 namespace tfrt {
 
@@ -116,6 +128,316 @@ class LeakCheckAllocator : public ProfiledAllocator {
   }
 };
 
+namespace {
+
+// Encodes a message in the protocol buffer wire format. This is all the
+// pprof profile.proto needs, without depending on the protobuf library.
+class ProtoEncoder {
+ public:
+  void AddVarint(int field, uint64_t value) {
+    AddTag(field, /*wire_type=*/0);
+    Varint(value);
+  }
+
+  void AddBytes(int field, string_view bytes) {
+    AddTag(field, /*wire_type=*/2);
+    Varint(bytes.size());
+    out_.append(bytes.data(), bytes.size());
+  }
+
+  void AddMessage(int field, const ProtoEncoder& message) {
+    AddBytes(field, message.out_);
+  }
+
+  void AddPacked(int field, llvm::ArrayRef<int64_t> values) {
+    ProtoEncoder packed;
+    for (int64_t value : values) packed.Varint(value);
+    AddBytes(field, packed.out_);
+  }
+
+  const std::string& str() const { return out_; }
+
+ private:
+  void AddTag(int field, int wire_type) { Varint(field << 3 | wire_type); }
+
+  void Varint(uint64_t value) {
+    while (value >= 0x80) {
+      out_.push_back(static_cast<char>(value | 0x80));
+      value >>= 7;
+    }
+    out_.push_back(static_cast<char>(value));
+  }
+
+  std::string out_;
+};
+
+class AllocationProfilerImpl : public AllocationProfiler {
+ public:
+  AllocationProfilerImpl(std::unique_ptr<HostAllocator> allocator,
+                         int64_t sample_period_bytes)
+      : allocator_(std::move(allocator)),
+        sample_period_bytes_(std::max<int64_t>(sample_period_bytes, 1)) {}
+
+  void* AllocateBytes(size_t size, size_t alignment) override {
+    void* ptr = allocator_->AllocateBytes(size, alignment);
+    if (ptr != nullptr && ShouldSample(size)) RecordAllocation(ptr, size);
+    return ptr;
+  }
+
+  void DeallocateBytes(void* ptr, size_t size) override {
+    // A sampled pointer is handed over to the deallocating thread after it is
+    // recorded, so the thread sees the count of its sample.
+    if (num_live_samples_.load(std::memory_order_relaxed) > 0)
+      RecordDeallocation(ptr);
+    allocator_->DeallocateBytes(ptr, size);
+  }
+
+  std::vector<SiteStats> GetSiteStats() const override;
+  void Print(raw_ostream& os) const override;
+  void WritePprofProfile(raw_ostream& os) const override;
+
+ private:
+  static constexpr int kNumShards = 16;
+
+  // The estimates of a site are kept as doubles, because every sample stands
+  // for a fractional number of allocations.
+  struct Site {
+    SiteStats stats;
+    double num_allocations = 0;
+    double bytes_allocated = 0;
+    double live_allocations = 0;
+    double live_bytes = 0;
+    double peak_live_bytes = 0;
+  };
+
+  struct LiveSample {
+    Site* site;
+    // The number of allocations the sample stands for.
+    double weight;
+    size_t size;
+  };
+
+  struct Shard {
+    mutex mu;
+    llvm::DenseMap<void*, LiveSample> live_samples TFRT_GUARDED_BY(mu);
+  };
+
+  // Returns true if the allocation of `size` bytes is sampled. The distances
+  // between sampled bytes are exponentially distributed, so that an allocation
+  // of `size` bytes is sampled with probability 1 - exp(-size / period).
+  bool ShouldSample(size_t size) {
+    struct ThreadState {
+      int64_t bytes_until_sample = -1;
+      uint64_t random = 0;
+    };
+    static thread_local ThreadState state;
+    state.bytes_until_sample -= size;
+    if (state.bytes_until_sample >= 0) return false;
+
+    // The first allocation of a thread only starts its countdown.
+    const bool first = state.random == 0;
+    if (first) {
+      state.random = reinterpret_cast<uintptr_t>(&state) * 0x9E3779B97F4A7C15u;
+      state.random |= 1;
+    }
+    // xorshift64.
+    state.random ^= state.random << 13;
+    state.random ^= state.random >> 7;
+    state.random ^= state.random << 17;
+    const double uniform = ((state.random >> 11) + 1) * 0x1.0p-53;
+    state.bytes_until_sample = static_cast<int64_t>(
+        -std::log(uniform) * static_cast<double>(sample_period_bytes_));
+    if (first) state.bytes_until_sample -= size;
+    return !first;
+  }
+
+  Shard& GetShard(void* ptr) {
+    return shards_[(reinterpret_cast<uintptr_t>(ptr) >> 4) % kNumShards];
+  }
+
+  void RecordAllocation(void* ptr, size_t size);
+  void RecordDeallocation(void* ptr);
+
+  std::unique_ptr<HostAllocator> allocator_;
+  const int64_t sample_period_bytes_;
+
+  std::atomic<int64_t> num_live_samples_{0};
+  Shard shards_[kNumShards];
+
+  mutable mutex mu_;
+  // Keyed by kernel name and location. StringMap entries do not move, so the
+  // live samples point to them.
+  llvm::StringMap<Site> sites_ TFRT_GUARDED_BY(mu_);
+};
+
+void AllocationProfilerImpl::RecordAllocation(void* ptr, size_t size) {
+  SiteStats site_stats;
+  site_stats.kernel_name = "<unattributed>";
+  if (const AllocationSite* site = AllocationSite::Current()) {
+    site_stats.kernel_name = site->kernel_name().str();
+    if (site->location()) {
+      DecodedLocation location = site->location().Decode();
+      llvm::raw_string_ostream(site_stats.location) << location;
+      if (location.is<FileLineColLocation>()) {
+        const auto& file_location = location.get<FileLineColLocation>();
+        site_stats.filename = file_location.filename;
+        site_stats.line = file_location.line;
+      }
+    }
+  }
+  std::string key = site_stats.kernel_name;
+  if (!site_stats.location.empty()) key += " at " + site_stats.location;
+
+  const double probability =
+      -std::expm1(-static_cast<double>(size) / sample_period_bytes_);
+  const double weight = 1 / probability;
+
+  Site* site;
+  {
+    mutex_lock lock(mu_);
+    auto it = sites_.find(key);
+    if (it == sites_.end())
+      it = sites_.try_emplace(key, Site{std::move(site_stats)}).first;
+    site = &it->second;
+    ++site->stats.num_samples;
+    site->num_allocations += weight;
+    site->bytes_allocated += weight * size;
+    site->live_allocations += weight;
+    site->live_bytes += weight * size;
+    site->peak_live_bytes = std::max(site->peak_live_bytes, site->live_bytes);
+  }
+
+  Shard& shard = GetShard(ptr);
+  mutex_lock lock(shard.mu);
+  shard.live_samples[ptr] = LiveSample{site, weight, size};
+  num_live_samples_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AllocationProfilerImpl::RecordDeallocation(void* ptr) {
+  LiveSample sample;
+  {
+    Shard& shard = GetShard(ptr);
+    mutex_lock lock(shard.mu);
+    auto it = shard.live_samples.find(ptr);
+    if (it == shard.live_samples.end()) return;
+    sample = it->second;
+    shard.live_samples.erase(it);
+    num_live_samples_.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  mutex_lock lock(mu_);
+  sample.site->live_allocations -= sample.weight;
+  sample.site->live_bytes -= sample.weight * sample.size;
+}
+
+std::vector<AllocationProfiler::SiteStats>
+AllocationProfilerImpl::GetSiteStats() const {
+  std::vector<SiteStats> result;
+  {
+    mutex_lock lock(mu_);
+    result.reserve(sites_.size());
+    for (const auto& entry : sites_) {
+      const Site& site = entry.getValue();
+      SiteStats stats = site.stats;
+      stats.num_allocations = std::llround(site.num_allocations);
+      stats.bytes_allocated = std::llround(site.bytes_allocated);
+      stats.live_allocations = std::llround(site.live_allocations);
+      stats.live_bytes = std::llround(site.live_bytes);
+      stats.peak_live_bytes = std::llround(site.peak_live_bytes);
+      result.push_back(std::move(stats));
+    }
+  }
+
+  std::sort(result.begin(), result.end(),
+            [](const SiteStats& a, const SiteStats& b) {
+              if (a.peak_live_bytes != b.peak_live_bytes)
+                return a.peak_live_bytes > b.peak_live_bytes;
+              if (a.kernel_name != b.kernel_name)
+                return a.kernel_name < b.kernel_name;
+              return a.location < b.location;
+            });
+  return result;
+}
+
+void AllocationProfilerImpl::Print(raw_ostream& os) const {
+  os << "# <peak live bytes> <live bytes> <bytes> <allocations> <kernel>\n";
+  for (const SiteStats& stats : GetSiteStats()) {
+    os << stats.peak_live_bytes << ' ' << stats.live_bytes << ' '
+       << stats.bytes_allocated << ' ' << stats.num_allocations << ' '
+       << stats.kernel_name;
+    if (!stats.location.empty()) os << " at " << stats.location;
+    os << '\n';
+  }
+}
+
+void AllocationProfilerImpl::WritePprofProfile(raw_ostream& os) const {
+  // Field numbers of profile.proto.
+  enum : int {
+    kProfileSampleType = 1,
+    kProfileSample = 2,
+    kProfileLocation = 4,
+    kProfileFunction = 5,
+    kProfileStringTable = 6,
+    kProfilePeriodType = 11,
+    kProfilePeriod = 12,
+  };
+
+  std::vector<std::string> strings = {""};
+  llvm::StringMap<int64_t> string_ids;
+  auto string_id = [&](const std::string& str) -> int64_t {
+    if (str.empty()) return 0;
+    auto inserted = string_ids.try_emplace(str, strings.size());
+    if (inserted.second) strings.push_back(str);
+    return inserted.first->second;
+  };
+  auto value_type = [&](const std::string& type, const std::string& unit) {
+    ProtoEncoder message;
+    message.AddVarint(1, string_id(type));
+    message.AddVarint(2, string_id(unit));
+    return message;
+  };
+
+  ProtoEncoder profile;
+  profile.AddMessage(kProfileSampleType, value_type("alloc_objects", "count"));
+  profile.AddMessage(kProfileSampleType, value_type("alloc_space", "bytes"));
+  profile.AddMessage(kProfileSampleType, value_type("inuse_objects", "count"));
+  profile.AddMessage(kProfileSampleType, value_type("inuse_space", "bytes"));
+
+  uint64_t id = 0;
+  for (const SiteStats& stats : GetSiteStats()) {
+    ++id;
+    ProtoEncoder function;
+    function.AddVarint(1, id);
+    function.AddVarint(2, string_id(stats.kernel_name));
+    function.AddVarint(3, string_id(stats.kernel_name));
+    function.AddVarint(4, string_id(stats.filename));
+    profile.AddMessage(kProfileFunction, function);
+
+    ProtoEncoder line;
+    line.AddVarint(1, id);
+    line.AddVarint(2, std::max(stats.line, 0));
+    ProtoEncoder location;
+    location.AddVarint(1, id);
+    location.AddMessage(4, line);
+    profile.AddMessage(kProfileLocation, location);
+
+    ProtoEncoder sample;
+    sample.AddPacked(1, {static_cast<int64_t>(id)});
+    sample.AddPacked(2, {stats.num_allocations, stats.bytes_allocated,
+                         stats.live_allocations, stats.live_bytes});
+    profile.AddMessage(kProfileSample, sample);
+  }
+
+  profile.AddMessage(kProfilePeriodType, value_type("space", "bytes"));
+  profile.AddVarint(kProfilePeriod, sample_period_bytes_);
+  for (const std::string& str : strings)
+    profile.AddBytes(kProfileStringTable, str);
+
+  os << profile.str();
+}
+
+}  // namespace
+
 std::unique_ptr<HostAllocator> CreateProfiledAllocator(
     std::unique_ptr<HostAllocator> allocator) {
   return std::make_unique<ProfiledAllocator>(std::move(allocator));
@@ -125,4 +447,11 @@ std::unique_ptr<HostAllocator> CreateLeakCheckAllocator(
     std::unique_ptr<HostAllocator> allocator) {
   return std::make_unique<LeakCheckAllocator>(std::move(allocator));
 }
+
+std::unique_ptr<AllocationProfiler> CreateAllocationProfiler(
+    std::unique_ptr<HostAllocator> allocator, int64_t sample_period_bytes) {
+  return std::make_unique<AllocationProfilerImpl>(std::move(allocator),
+                                                  sample_period_bytes);
+}
+
 }  // namespace tfrt
@@ -0,0 +1,86 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements InProcessRendezvous and the rendezvous of resource
+// contexts.
+
+#include "tfrt/host_context/rendezvous.h"
+
+#include <utility>
+
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/resource_context.h"
+
+namespace tfrt {
+namespace {
+
+constexpr char kRendezvousResourceName[] = "tfrt.rendezvous";
+
+}  // namespace
+
+Rendezvous::~Rendezvous() = default;
+
+InProcessRendezvous::InProcessRendezvous() = default;
+
+InProcessRendezvous::~InProcessRendezvous() = default;
+
+void InProcessRendezvous::Send(string_view key, RCReference<AsyncValue> value) {
+  RCReference<IndirectAsyncValue> receive;
+  {
+    mutex_lock lock(mu_);
+    Entry& entry = entries_[key];
+    if (entry.receives.empty()) {
+      entry.values.push_back(std::move(value));
+      return;
+    }
+    receive = std::move(entry.receives.front());
+    entry.receives.pop_front();
+    if (entry.receives.empty()) entries_.erase(key);
+  }
+  // Forward outside of the lock, as it may run the waiters of the receive.
+  receive->ForwardTo(std::move(value));
+}
+
+RCReference<AsyncValue> InProcessRendezvous::Recv(string_view key) {
+  mutex_lock lock(mu_);
+  Entry& entry = entries_[key];
+  if (entry.values.empty()) {
+    auto receive = MakeIndirectAsyncValue();
+    entry.receives.push_back(receive.CopyRef());
+    return receive;
+  }
+  auto value = std::move(entry.values.front());
+  entry.values.pop_front();
+  if (entry.values.empty()) entries_.erase(key);
+  return value;
+}
+
+void SetRendezvous(ResourceContext* resource_context,
+                   std::unique_ptr<Rendezvous> rendezvous) {
+  resource_context->CreateResource<std::unique_ptr<Rendezvous>>(
+      kRendezvousResourceName, std::move(rendezvous));
+}
+
+Rendezvous* GetOrCreateRendezvous(ResourceContext* resource_context) {
+  if (auto rendezvous =
+          resource_context->GetResource<std::unique_ptr<Rendezvous>>(
+              kRendezvousResourceName))
+    return (*rendezvous)->get();
+  return resource_context
+      ->GetOrCreateResource<std::unique_ptr<Rendezvous>>(
+          kRendezvousResourceName, std::make_unique<InProcessRendezvous>())
+      ->get();
+}
+
+}  // namespace tfrt
@@ -0,0 +1,119 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file implements RequestStats.
+
+#include "tfrt/host_context/request_stats.h"
+
+#include <time.h>
+
+#include <utility>
+#include <vector>
+
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/metrics/metrics.h"
+
+namespace tfrt {
+
+thread_local RequestStats* RequestStats::current_ = nullptr;
+
+void RequestStats::Scope::Enter(RequestStats* stats) {
+  stats_ = stats;
+  current_ = stats;
+  start_cpu_time_ = ThreadCpuTime();
+}
+
+void RequestStats::Scope::Exit() {
+  stats_->AddCpuTime(ThreadCpuTime() - start_cpu_time_);
+  current_ = nullptr;
+}
+
+std::chrono::nanoseconds RequestStats::ThreadCpuTime() {
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+  timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+#else
+  // Approximate the CPU time with the wall time.
+  return std::chrono::steady_clock::now().time_since_epoch();
+#endif
+}
+
+RequestStats::Snapshot RequestStats::snapshot() const {
+  Snapshot snapshot;
+  snapshot.cpu_time =
+      std::chrono::nanoseconds(cpu_time_ns_.load(std::memory_order_relaxed));
+  snapshot.bytes_allocated = bytes_allocated_.load(std::memory_order_relaxed);
+  snapshot.kernels_executed = kernels_executed_.load(std::memory_order_relaxed);
+  snapshot.await_time =
+      std::chrono::nanoseconds(await_time_ns_.load(std::memory_order_relaxed));
+  return snapshot;
+}
+
+// Returns bounds `first`, `first * 4`, ... up to `last`.
+static metrics::Buckets PowersOfFour(double first, double last) {
+  std::vector<double> bounds;
+  for (double bound = first; bound <= last; bound *= 4) bounds.push_back(bound);
+  return metrics::Buckets::Explicit(std::move(bounds));
+}
+
+void RequestStats::RecordMetrics() const {
+  static auto* cpu_time_us = metrics::NewHistogram(
+      "/tfrt/request/cpu_time_us", PowersOfFour(1, 1 << 30));
+  static auto* bytes_allocated = metrics::NewHistogram(
+      "/tfrt/request/bytes_allocated", PowersOfFour(64, 1ull << 36));
+  static auto* kernels_executed = metrics::NewHistogram(
+      "/tfrt/request/kernels_executed", PowersOfFour(1, 1 << 24));
+  static auto* await_time_us = metrics::NewHistogram(
+      "/tfrt/request/await_time_us", PowersOfFour(1, 1 << 30));
+
+  using Microseconds = std::chrono::duration<double, std::micro>;
+  const Snapshot values = snapshot();
+  cpu_time_us->Record(Microseconds(values.cpu_time).count());
+  bytes_allocated->Record(values.bytes_allocated);
+  kernels_executed->Record(values.kernels_executed);
+  await_time_us->Record(Microseconds(values.await_time).count());
+}
+
+namespace {
+
+class RequestAccountingAllocator : public HostAllocator {
+ public:
+  explicit RequestAccountingAllocator(std::unique_ptr<HostAllocator> parent)
+      : parent_(std::move(parent)) {}
+
+  void* AllocateBytes(size_t size, size_t alignment) override {
+    if (RequestStats* stats = RequestStats::Current())
+      stats->AddBytesAllocated(size);
+    return parent_->AllocateBytes(size, alignment);
+  }
+
+  void DeallocateBytes(void* ptr, size_t size) override {
+    parent_->DeallocateBytes(ptr, size);
+  }
+
+ private:
+  std::unique_ptr<HostAllocator> parent_;
+};
+
+}  // namespace
+
+std::unique_ptr<HostAllocator> CreateRequestAccountingAllocator(
+    std::unique_ptr<HostAllocator> parent) {
+  return std::make_unique<RequestAccountingAllocator>(std::move(parent));
+}
+
+}  // namespace tfrt
@@ -0,0 +1,107 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file implements RequestTracker.
+
+#include "tfrt/host_context/request_tracker.h"
+
+#include <cassert>
+#include <utility>
+
+#include "tfrt/host_context/execution_context.h"
+
+namespace tfrt {
+
+RequestTracker::Registration::Registration(
+    RequestTracker* tracker,
+    const RCReference<CancellationContext>& cancellation)
+    : tracker_(tracker) {
+  if (tracker_ == nullptr) return;
+  cancellation_ = cancellation;
+  tracker_->Add(this);
+}
+
+RequestTracker::Registration::~Registration() {
+  if (tracker_ != nullptr) tracker_->Remove(this);
+}
+
+RequestTracker::~RequestTracker() {
+  mutex_lock lock(mu_);
+  assert(pending_.empty() && "RequestTracker destroyed with pending requests");
+}
+
+size_t RequestTracker::GetNumPendingRequests() const {
+  mutex_lock lock(mu_);
+  return pending_.size();
+}
+
+void RequestTracker::CancelPendingRequests() {
+  // Cancel outside of the lock, as cancelling may complete requests.
+  llvm::SmallVector<RCReference<CancellationContext>, 8> pending;
+  {
+    mutex_lock lock(mu_);
+    pending.reserve(pending_.size());
+    for (Registration* registration : pending_)
+      pending.push_back(registration->cancellation_);
+  }
+  for (auto& cancellation : pending) cancellation->Cancel();
+}
+
+void RequestTracker::Drain() {
+  mutex_lock lock(mu_);
+  while (!pending_.empty()) drained_.wait(lock);
+}
+
+bool RequestTracker::DrainFor(std::chrono::steady_clock::duration timeout) {
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  mutex_lock lock(mu_);
+  while (!pending_.empty()) {
+    if (drained_.wait_until(lock, deadline) == std::cv_status::timeout)
+      return pending_.empty();
+  }
+  return true;
+}
+
+void RequestTracker::OnDrained(llvm::unique_function<void()> callback) {
+  {
+    mutex_lock lock(mu_);
+    if (!pending_.empty()) {
+      on_drained_.push_back(std::move(callback));
+      return;
+    }
+  }
+  callback();
+}
+
+void RequestTracker::Add(Registration* registration) {
+  mutex_lock lock(mu_);
+  pending_.insert(registration);
+}
+
+void RequestTracker::Remove(Registration* registration) {
+  llvm::SmallVector<llvm::unique_function<void()>, 2> on_drained;
+  {
+    mutex_lock lock(mu_);
+    pending_.erase(registration);
+    if (!pending_.empty()) return;
+    on_drained.swap(on_drained_);
+    drained_.notify_all();
+  }
+  // The callbacks may start new requests, or destroy the tracker.
+  for (auto& callback : on_drained) callback();
+}
+
+}  // namespace tfrt
@@ -0,0 +1,239 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//===- shared_memory_allocator.cc - Shared Memory Host Allocator ----------===//
+//
+// This file implements SharedMemoryAllocator.
+//
+// The segment starts with a header that identifies it as a segment of this
+// allocator and records its capacity, followed by the allocations. Every free
+// range starts and ends at a multiple of kMinAlignment from the base of the
+// segment, which is page aligned, so alignment padding in front of an
+// allocation can always go back to the free list as a range of its own.
+
+#include "tfrt/host_context/shared_memory_allocator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <utility>
+
+#include "llvm/Support/MathExtras.h"
+#include "tfrt/support/error_util.h"
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace tfrt {
+namespace {
+
+constexpr size_t kMinAlignment = 64;
+constexpr uint64_t kSegmentMagic = 0x5446525453484d31;  // "TFRTSHM1"
+
+struct SegmentHeader {
+  uint64_t magic;
+  uint64_t capacity;
+};
+
+constexpr size_t kHeaderSize = 64;
+static_assert(sizeof(SegmentHeader) <= kHeaderSize, "segment header too large");
+
+}  // namespace
+
+SharedMemoryAllocator::SharedMemoryAllocator(std::string name, char* base,
+                                             size_t mapped_size,
+                                             bool owns_segment)
+    : name_(std::move(name)),
+      base_(base),
+      mapped_size_(mapped_size),
+      owns_segment_(owns_segment) {
+  if (owns_segment_) free_ranges_[kHeaderSize] = mapped_size_ - kHeaderSize;
+}
+
+#if !defined(_WIN32)
+
+Expected<std::unique_ptr<SharedMemoryAllocator>> SharedMemoryAllocator::Create(
+    string_view name, size_t capacity) {
+  if (name.empty() || name.front() != '/')
+    return MakeStringError("shared memory segment name must start with '/': ",
+                           name);
+
+  std::string name_str = name.str();
+  size_t mapped_size = kHeaderSize + llvm::alignTo(capacity, kMinAlignment);
+  int fd = shm_open(name_str.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0)
+    return MakeStringError("cannot create shared memory segment ", name, ": ",
+                           std::strerror(errno));
+  if (ftruncate(fd, mapped_size) != 0) {
+    int error = errno;
+    close(fd);
+    shm_unlink(name_str.c_str());
+    return MakeStringError("cannot resize shared memory segment ", name, ": ",
+                           std::strerror(error));
+  }
+  void* base = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                    fd, /*offset=*/0);
+  int error = errno;
+  close(fd);
+  if (base == MAP_FAILED) {
+    shm_unlink(name_str.c_str());
+    return MakeStringError("cannot map shared memory segment ", name, ": ",
+                           std::strerror(error));
+  }
+
+  auto* header = static_cast<SegmentHeader*>(base);
+  header->capacity = mapped_size - kHeaderSize;
+  header->magic = kSegmentMagic;
+  return std::unique_ptr<SharedMemoryAllocator>(new SharedMemoryAllocator(
+      std::move(name_str), static_cast<char*>(base), mapped_size,
+      /*owns_segment=*/true));
+}
+
+Expected<std::unique_ptr<SharedMemoryAllocator>> SharedMemoryAllocator::Open(
+    string_view name) {
+  std::string name_str = name.str();
+  int fd = shm_open(name_str.c_str(), O_RDWR, 0);
+  if (fd < 0)
+    return MakeStringError("cannot open shared memory segment ", name, ": ",
+                           std::strerror(errno));
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    int error = errno;
+    close(fd);
+    return MakeStringError("cannot stat shared memory segment ", name, ": ",
+                           std::strerror(error));
+  }
+  auto mapped_size = static_cast<size_t>(st.st_size);
+  if (mapped_size < kHeaderSize) {
+    close(fd);
+    return MakeStringError("invalid shared memory segment ", name);
+  }
+  void* base = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                    fd, /*offset=*/0);
+  int error = errno;
+  close(fd);
+  if (base == MAP_FAILED)
+    return MakeStringError("cannot map shared memory segment ", name, ": ",
+                           std::strerror(error));
+
+  auto* header = static_cast<const SegmentHeader*>(base);
+  if (header->magic != kSegmentMagic ||
+      header->capacity != mapped_size - kHeaderSize) {
+    munmap(base, mapped_size);
+    return MakeStringError("invalid shared memory segment ", name);
+  }
+  return std::unique_ptr<SharedMemoryAllocator>(new SharedMemoryAllocator(
+      std::move(name_str), static_cast<char*>(base), mapped_size,
+      /*owns_segment=*/false));
+}
+
+SharedMemoryAllocator::~SharedMemoryAllocator() {
+  munmap(base_, mapped_size_);
+  if (owns_segment_) shm_unlink(name_.c_str());
+}
+
+#else  // !defined(_WIN32)
+
+Expected<std::unique_ptr<SharedMemoryAllocator>> SharedMemoryAllocator::Create(
+    string_view name, size_t capacity) {
+  return MakeStringError("shared memory segments are not supported");
+}
+
+Expected<std::unique_ptr<SharedMemoryAllocator>> SharedMemoryAllocator::Open(
+    string_view name) {
+  return MakeStringError("shared memory segments are not supported");
+}
+
+SharedMemoryAllocator::~SharedMemoryAllocator() {}
+
+#endif  // !defined(_WIN32)
+
+void* SharedMemoryAllocator::AllocateBytes(size_t size, size_t alignment) {
+  size = llvm::alignTo(std::max<size_t>(size, 1), kMinAlignment);
+  alignment = std::max(alignment, kMinAlignment);
+
+  mutex_lock lock(mu_);
+  for (auto it = free_ranges_.begin(); it != free_ranges_.end(); ++it) {
+    auto [offset, range_size] = *it;
+    auto begin = reinterpret_cast<uintptr_t>(base_ + offset);
+    size_t padding = llvm::alignTo(begin, alignment) - begin;
+    if (padding + size > range_size) continue;
+
+    // Keep the padding in front and the remainder behind the allocation free.
+    if (padding == 0)
+      free_ranges_.erase(it);
+    else
+      it->second = padding;
+    if (size_t tail = range_size - padding - size)
+      free_ranges_[offset + padding + size] = tail;
+    return base_ + offset + padding;
+  }
+  return nullptr;
+}
+
+void SharedMemoryAllocator::DeallocateBytes(void* ptr, size_t size) {
+  size = llvm::alignTo(std::max<size_t>(size, 1), kMinAlignment);
+  size_t offset = static_cast<char*>(ptr) - base_;
+  assert(offset >= kHeaderSize && offset + size <= mapped_size_ &&
+         "pointer is not in the shared memory segment");
+
+  mutex_lock lock(mu_);
+  auto next = free_ranges_.lower_bound(offset);
+  if (next != free_ranges_.end() && offset + size == next->first) {
+    size += next->second;
+    next = free_ranges_.erase(next);
+  }
+  if (next != free_ranges_.begin()) {
+    auto prev = std::prev(next);
+    if (prev->first + prev->second == offset) {
+      prev->second += size;
+      return;
+    }
+  }
+  free_ranges_.emplace_hint(next, offset, size);
+}
+
+Expected<SharedMemoryDescriptor> SharedMemoryAllocator::GetDescriptor(
+    const HostBuffer& buffer) const {
+  auto* data = static_cast<const char*>(buffer.data());
+  if (data < base_ + kHeaderSize || data + buffer.size() > base_ + mapped_size_)
+    return MakeStringError("buffer is not in shared memory segment ", name_);
+  return SharedMemoryDescriptor{name_, static_cast<size_t>(data - base_),
+                                buffer.size()};
+}
+
+Expected<RCReference<HostBuffer>> SharedMemoryAllocator::CreateHostBuffer(
+    const SharedMemoryDescriptor& descriptor) {
+  if (descriptor.segment_name != name_)
+    return MakeStringError("descriptor of shared memory segment ",
+                           descriptor.segment_name, " used with segment ",
+                           name_);
+  if (descriptor.offset < kHeaderSize || descriptor.offset > mapped_size_ ||
+      descriptor.size > mapped_size_ - descriptor.offset)
+    return MakeStringError("descriptor out of bounds of shared memory segment ",
+                           name_);
+  // The creator of the segment owns the data, so there is nothing to free.
+  return HostBuffer::CreateFromExternal(base_ + descriptor.offset,
+                                        descriptor.size,
+                                        [](void* ptr, size_t size) {});
+}
+
+}  // namespace tfrt
@@ -0,0 +1,309 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file implements SharedWorkQueue.
+
+#include "tfrt/host_context/shared_work_queue.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "llvm/ADT/SmallVector.h"
+#include "tfrt/support/mutex.h"
+
+namespace tfrt {
+namespace {
+
+// The tenants are scheduled with stride scheduling: each dispatched task
+// advances the pass of its tenant by kStrideScale / weight, and the runnable
+// tenant with the lowest pass is dispatched next.
+constexpr uint64_t kStrideScale = uint64_t{1} << 20;
+
+constexpr int kNumPriorities = static_cast<int>(TaskPriority::kLow) + 1;
+
+struct Tenant {
+  Tenant(string_view name, int weight)
+      : name(name), stride(kStrideScale / std::max(weight, 1)) {}
+
+  const std::string name;
+  const uint64_t stride;
+
+  // The fields below are guarded by the mutex of the scheduler.
+  uint64_t pass = 0;
+  // The pending non-blocking tasks, indexed by priority.
+  std::array<std::deque<TaskFunction>, kNumPriorities> pending;
+  int num_pending = 0;
+  // The pending, running and blocking tasks of the tenant.
+  int num_outstanding = 0;
+};
+
+}  // namespace
+
+class SharedWorkQueue::Scheduler {
+ public:
+  Scheduler(std::unique_ptr<ConcurrentWorkQueue> work_queue, int max_in_flight)
+      : work_queue_(std::move(work_queue)),
+        max_in_flight_(max_in_flight > 0
+                           ? max_in_flight
+                           : work_queue_->GetParallelismLevel()) {
+    assert(work_queue_->GetParallelismLevel() > 0 &&
+           "SharedWorkQueue requires a work queue with worker threads");
+  }
+
+  // The tasks refer to the scheduler, so they have to finish before it is
+  // destroyed.
+  ~Scheduler() { work_queue_->Quiesce(); }
+
+  ConcurrentWorkQueue* work_queue() const { return work_queue_.get(); }
+
+  void AddTask(const std::shared_ptr<Tenant>& tenant, TaskFunction work,
+               TaskPriority priority);
+
+  std::optional<TaskFunction> AddBlockingTask(
+      const std::shared_ptr<Tenant>& tenant, TaskFunction work,
+      bool allow_queuing);
+
+  void Await(ArrayRef<RCReference<AsyncValue>> values);
+
+  void Quiesce(const Tenant& tenant);
+
+ private:
+  struct CompareTenantPass {
+    bool operator()(const std::shared_ptr<Tenant>& a,
+                    const std::shared_ptr<Tenant>& b) const {
+      return a->pass > b->pass;
+    }
+  };
+
+  // Takes the task of the tenant with the lowest pass off the runnable queue.
+  TaskFunction NextTaskLocked(TaskPriority* priority) TFRT_REQUIRES(mu_);
+
+  // Submits pending tasks to the work queue while there are free slots.
+  void Dispatch();
+
+  // Called when a task of `tenant` has finished. Frees the slot of the task
+  // if `in_flight` is true.
+  void OnTaskDone(Tenant* tenant, bool in_flight);
+
+  // The scheduler whose task the calling thread is running, if any.
+  static thread_local const Scheduler* running_;
+
+  const std::unique_ptr<ConcurrentWorkQueue> work_queue_;
+  const int max_in_flight_;
+
+  mutex mu_;
+  condition_variable quiesce_cv_;
+  int num_in_flight_ TFRT_GUARDED_BY(mu_) = 0;
+  // The pass of the most recently dispatched tenant. Tenants that become
+  // runnable start from it, so that idle tenants do not accumulate credit.
+  uint64_t global_pass_ TFRT_GUARDED_BY(mu_) = 0;
+  // The tenants with pending tasks.
+  std::priority_queue<std::shared_ptr<Tenant>,
+                      std::vector<std::shared_ptr<Tenant>>, CompareTenantPass>
+      runnable_ TFRT_GUARDED_BY(mu_);
+};
+
+thread_local const SharedWorkQueue::Scheduler*
+    SharedWorkQueue::Scheduler::running_ = nullptr;
+
+void SharedWorkQueue::Scheduler::AddTask(const std::shared_ptr<Tenant>& tenant,
+                                         TaskFunction work,
+                                         TaskPriority priority) {
+  TaskFunction task([this, tenant, work = std::move(work)]() mutable {
+    const Scheduler* running = running_;
+    running_ = this;
+    work();
+    running_ = running;
+    OnTaskDone(tenant.get(), /*in_flight=*/true);
+  });
+
+  {
+    mutex_lock lock(mu_);
+    ++tenant->num_outstanding;
+    if (tenant->num_pending++ == 0) {
+      tenant->pass = std::max(tenant->pass, global_pass_);
+      runnable_.push(tenant);
+    }
+    tenant->pending[static_cast<int>(priority)].push_back(std::move(task));
+    if (num_in_flight_ >= max_in_flight_) return;
+  }
+  Dispatch();
+}
+
+std::optional<TaskFunction> SharedWorkQueue::Scheduler::AddBlockingTask(
+    const std::shared_ptr<Tenant>& tenant, TaskFunction work,
+    bool allow_queuing) {
+  {
+    mutex_lock lock(mu_);
+    ++tenant->num_outstanding;
+  }
+
+  // Keep `work` accessible, so that it can be handed back to the caller if the
+  // work queue rejects the task.
+  auto shared_work = std::make_shared<TaskFunction>(std::move(work));
+  std::optional<TaskFunction> rejected = work_queue_->AddBlockingTask(
+      TaskFunction([this, tenant, shared_work] {
+        (*shared_work)();
+        OnTaskDone(tenant.get(), /*in_flight=*/false);
+      }),
+      allow_queuing);
+  if (!rejected) return std::nullopt;
+
+  OnTaskDone(tenant.get(), /*in_flight=*/false);
+  return std::move(*shared_work);
+}
+
+void SharedWorkQueue::Scheduler::Await(
+    ArrayRef<RCReference<AsyncValue>> values) {
+  if (running_ != this) {
+    work_queue_->Await(values);
+    return;
+  }
+
+  // The values may depend on tasks that are still pending in the scheduler, so
+  // give up the slot of the awaiting task until the values are available.
+  {
+    mutex_lock lock(mu_);
+    --num_in_flight_;
+  }
+  Dispatch();
+  work_queue_->Await(values);
+  mutex_lock lock(mu_);
+  ++num_in_flight_;
+}
+
+void SharedWorkQueue::Scheduler::Quiesce(const Tenant& tenant) {
+  mutex_lock lock(mu_);
+  while (tenant.num_outstanding > 0) quiesce_cv_.wait(lock);
+}
+
+TaskFunction SharedWorkQueue::Scheduler::NextTaskLocked(
+    TaskPriority* priority) {
+  std::shared_ptr<Tenant> tenant = runnable_.top();
+  runnable_.pop();
+
+  global_pass_ = tenant->pass;
+  tenant->pass += tenant->stride;
+
+  auto it = std::find_if(tenant->pending.begin(), tenant->pending.end(),
+                         [](const auto& tasks) { return !tasks.empty(); });
+  assert(it != tenant->pending.end());
+  *priority = static_cast<TaskPriority>(it - tenant->pending.begin());
+  TaskFunction task = std::move(it->front());
+  it->pop_front();
+
+  if (--tenant->num_pending > 0) runnable_.push(std::move(tenant));
+  return task;
+}
+
+void SharedWorkQueue::Scheduler::Dispatch() {
+  llvm::SmallVector<std::pair<TaskFunction, TaskPriority>, 4> tasks;
+  {
+    mutex_lock lock(mu_);
+    while (num_in_flight_ < max_in_flight_ && !runnable_.empty()) {
+      ++num_in_flight_;
+      TaskPriority priority;
+      TaskFunction task = NextTaskLocked(&priority);
+      tasks.emplace_back(std::move(task), priority);
+    }
+  }
+
+  // The work queue may run the tasks in the caller thread, so submit them
+  // without holding the lock.
+  for (auto& task : tasks)
+    work_queue_->AddTask(std::move(task.first), task.second);
+}
+
+void SharedWorkQueue::Scheduler::OnTaskDone(Tenant* tenant, bool in_flight) {
+  {
+    mutex_lock lock(mu_);
+    if (--tenant->num_outstanding == 0) quiesce_cv_.notify_all();
+    if (!in_flight) return;
+    --num_in_flight_;
+    if (runnable_.empty()) return;
+  }
+  Dispatch();
+}
+
+class SharedWorkQueue::TenantWorkQueue : public ConcurrentWorkQueue {
+ public:
+  TenantWorkQueue(std::shared_ptr<Scheduler> scheduler,
+                  string_view name, int weight)
+      : scheduler_(std::move(scheduler)),
+        tenant_(std::make_shared<Tenant>(name, weight)) {}
+
+  std::string name() const override {
+    return tenant_->name + " on " + scheduler_->work_queue()->name();
+  }
+
+  void AddTask(TaskFunction work) override {
+    scheduler_->AddTask(tenant_, std::move(work), TaskPriority::kDefault);
+  }
+
+  void AddTask(TaskFunction work, TaskPriority priority) override {
+    scheduler_->AddTask(tenant_, std::move(work), priority);
+  }
+
+  std::optional<TaskFunction> AddBlockingTask(TaskFunction work,
+                                              bool allow_queuing) override {
+    return scheduler_->AddBlockingTask(tenant_, std::move(work),
+                                       allow_queuing);
+  }
+
+  void Await(ArrayRef<RCReference<AsyncValue>> values) override {
+    scheduler_->Await(values);
+  }
+
+  void Quiesce() override { scheduler_->Quiesce(*tenant_); }
+
+  int GetParallelismLevel() const override {
+    return scheduler_->work_queue()->GetParallelismLevel();
+  }
+
+  bool IsInWorkerThread() const override {
+    return scheduler_->work_queue()->IsInWorkerThread();
+  }
+
+ private:
+  const std::shared_ptr<Scheduler> scheduler_;
+  const std::shared_ptr<Tenant> tenant_;
+};
+
+SharedWorkQueue::SharedWorkQueue(
+    std::unique_ptr<ConcurrentWorkQueue> work_queue, int max_in_flight)
+    : scheduler_(
+          std::make_shared<Scheduler>(std::move(work_queue), max_in_flight)) {}
+
+SharedWorkQueue::~SharedWorkQueue() = default;
+
+std::unique_ptr<ConcurrentWorkQueue> SharedWorkQueue::CreateTenantWorkQueue(
+    string_view name, int weight) {
+  return std::make_unique<TenantWorkQueue>(scheduler_, name, weight);
+}
+
+ConcurrentWorkQueue* SharedWorkQueue::work_queue() const {
+  return scheduler_->work_queue();
+}
+
+}  // namespace tfrt
@@ -46,6 +46,41 @@ struct MakeMultiThreadedWorkQueue {
   }
 };
 
+struct MakeNumaWorkQueue {
+  static std::unique_ptr<ConcurrentWorkQueue> make(int num_nonblocking_threads,
+                                                   int num_blocking_threads) {
+    MultiThreadedWorkQueueOptions options;
+    options.numa_aware = true;
+    return CreateMultiThreadedWorkQueue(num_nonblocking_threads,
+                                        num_blocking_threads, options);
+  }
+};
+
+struct MakeInstrumentedWorkQueue {
+  static std::unique_ptr<ConcurrentWorkQueue> make(int num_nonblocking_threads,
+                                                   int num_blocking_threads) {
+    MultiThreadedWorkQueueOptions options;
+    options.collect_stats = true;
+    return CreateMultiThreadedWorkQueue(num_nonblocking_threads,
+                                        num_blocking_threads, options);
+  }
+};
+
+// Idle workers spin and yield for longer, trading idle CPU cycles for lower
+// wakeup latency, and with less spinning while tasks arrive rarely.
+struct MakeLowLatencyWorkQueue {
+  static std::unique_ptr<ConcurrentWorkQueue> make(int num_nonblocking_threads,
+                                                   int num_blocking_threads) {
+    MultiThreadedWorkQueueOptions options;
+    options.idle_policy.max_spinning_threads = 2;
+    options.idle_policy.spin_count = 20000;
+    options.idle_policy.yield_count = 5000;
+    options.idle_policy.adaptive = true;
+    return CreateMultiThreadedWorkQueue(num_nonblocking_threads,
+                                        num_blocking_threads, options);
+  }
+};
+
 // Factory function for a multi-threaded thread pool.  Parses the given argument
 // to determine the construction parameters.  The argument must be either "X" or
 // "X,Y", where X and Y are integers. X will determine the number of threads to
@@ -98,5 +133,11 @@ std::unique_ptr<ConcurrentWorkQueue> MultiThreadedWorkQueueFactory(
 TFRT_WORK_QUEUE_FACTORY("s", SingleThreadedWorkQueueFactory);
 TFRT_WORK_QUEUE_FACTORY(
     "mstd", MultiThreadedWorkQueueFactory<MakeMultiThreadedWorkQueue>);
+TFRT_WORK_QUEUE_FACTORY("mnuma",
+                        MultiThreadedWorkQueueFactory<MakeNumaWorkQueue>);
+TFRT_WORK_QUEUE_FACTORY(
+    "mstats", MultiThreadedWorkQueueFactory<MakeInstrumentedWorkQueue>);
+TFRT_WORK_QUEUE_FACTORY(
+    "mlowlatency", MultiThreadedWorkQueueFactory<MakeLowLatencyWorkQueue>);
 
 }  // namespace tfrt
@@ -18,9 +18,213 @@
 
 #include "tfrt/host_context/timer_queue.h"
 
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <vector>
+
+#include "llvm/Support/MathExtras.h"
+
 namespace tfrt {
+namespace {
+
+constexpr int64_t kMaxTick = std::numeric_limits<int64_t>::max();
+
+// Timers expire at the first tick (millisecond) at or after their deadline.
+template <typename TimePoint>
+int64_t DeadlineToTick(TimePoint deadline) {
+  return std::chrono::ceil<std::chrono::milliseconds>(
+             deadline.time_since_epoch())
+      .count();
+}
+
+template <typename Clock>
+int64_t NowTick() {
+  return std::chrono::floor<std::chrono::milliseconds>(
+             Clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace
 
-TimerQueue::TimerQueue() {
+// A hierarchical timing wheel. Level 0 has one slot per tick, and each slot of
+// level L covers kWheelSize^L ticks. When the ticks of a level L slot start,
+// its timers are cascaded to the lower levels, and level 0 timers expire when
+// their tick is reached. Timers beyond the last level are parked in its last
+// slot and cascaded again.
+class TimerQueue::TimerWheel {
+ public:
+  static constexpr int kWheelBits = 8;
+  static constexpr int kWheelSize = 1 << kWheelBits;
+  static constexpr int kNumLevels = 4;
+
+  TimerWheel() : current_tick_(NowTick<Clock>()) {}
+
+  ~TimerWheel() {
+    mutex_lock lock(mu_);
+    for (auto& level : slots_) {
+      for (TimerEntry*& head : level) {
+        while (head) {
+          TimerEntry* entry = head;
+          head = entry->next_;
+          entry->linked_ = false;
+          entry->DropRef();
+        }
+      }
+    }
+  }
+
+  // Adds a reference to `entry` to the wheel. Returns the tick at which the
+  // entry expires.
+  int64_t Add(TimerEntry* entry) {
+    mutex_lock lock(mu_);
+    entry->AddRef();
+    Link(entry);
+    ++num_timers_;
+    return std::max(entry->tick_, current_tick_);
+  }
+
+  // Removes `entry` from the wheel, unless it already expired.
+  void Remove(TimerEntry* entry) {
+    mutex_lock lock(mu_);
+    if (!entry->linked_) return;
+    Unlink(entry);
+    --num_timers_;
+    // The caller holds another reference.
+    entry->DropRef();
+  }
+
+  // Moves the timers expired at `now_tick` to `expired`, in tick order.
+  // Returns the tick of the next wheel event, or kMaxTick if it is empty.
+  int64_t Advance(int64_t now_tick,
+                  std::vector<RCReference<TimerEntry>>* expired) {
+    mutex_lock lock(mu_);
+    while (num_timers_ > 0) {
+      const int64_t next_tick = NextEventTick();
+      if (next_tick > now_tick) {
+        current_tick_ = std::max(current_tick_, now_tick + 1);
+        return next_tick;
+      }
+      current_tick_ = next_tick;
+
+      // Cascade the levels whose slot starts at this tick, outermost first.
+      for (int level = kNumLevels - 1; level > 0; --level) {
+        if (current_tick_ & (LevelTicks(level) - 1)) continue;
+        for (TimerEntry* entry = TakeSlot(level, SlotAt(level, current_tick_));
+             entry;) {
+          TimerEntry* next = entry->next_;
+          Link(entry);
+          entry = next;
+        }
+      }
+
+      for (TimerEntry* entry = TakeSlot(0, SlotAt(0, current_tick_)); entry;) {
+        TimerEntry* next = entry->next_;
+        entry->linked_ = false;
+        expired->push_back(TakeRef(entry));
+        --num_timers_;
+        entry = next;
+      }
+      ++current_tick_;
+    }
+    current_tick_ = std::max(current_tick_, now_tick + 1);
+    return kMaxTick;
+  }
+
+ private:
+  static int64_t LevelTicks(int level) {
+    return int64_t{1} << (kWheelBits * level);
+  }
+
+  static int SlotAt(int level, int64_t tick) {
+    return (tick >> (kWheelBits * level)) & (kWheelSize - 1);
+  }
+
+  // Returns the distance from `start` to the first occupied slot of `level`,
+  // wrapping around, or -1 if the level is empty.
+  int FindOccupiedSlot(int level, int start) const TFRT_REQUIRES(mu_) {
+    constexpr int kNumWords = kWheelSize / 64;
+    const uint64_t* words = occupied_[level];
+    for (int i = 0; i <= kNumWords; ++i) {
+      const int word = ((start >> 6) + i) % kNumWords;
+      uint64_t bits = words[word];
+      if (i == 0) bits &= ~uint64_t{0} << (start & 63);
+      if (i == kNumWords) bits &= ~(~uint64_t{0} << (start & 63));
+      if (bits) {
+        const int slot = word * 64 + llvm::countTrailingZeros(bits);
+        return (slot - start + kWheelSize) % kWheelSize;
+      }
+    }
+    return -1;
+  }
+
+  // Returns the first tick at or after `current_tick_` at which a level 0 slot
+  // expires or a higher level slot is cascaded.
+  int64_t NextEventTick() const TFRT_REQUIRES(mu_) {
+    int64_t next_tick = kMaxTick;
+    for (int level = 0; level < kNumLevels; ++level) {
+      // The first index of a level slot starting at or after the current tick.
+      const int64_t index =
+          (current_tick_ + LevelTicks(level) - 1) >> (kWheelBits * level);
+      const int distance = FindOccupiedSlot(level, index & (kWheelSize - 1));
+      if (distance < 0) continue;
+      next_tick = std::min(next_tick, (index + distance) * LevelTicks(level));
+    }
+    return next_tick;
+  }
+
+  void Link(TimerEntry* entry) TFRT_REQUIRES(mu_) {
+    int64_t tick = std::max(entry->tick_, current_tick_);
+    const int64_t delta = tick - current_tick_;
+    int level = 0;
+    while (level + 1 < kNumLevels && delta >= LevelTicks(level + 1)) ++level;
+    if (delta >= LevelTicks(kNumLevels))
+      tick = current_tick_ + LevelTicks(kNumLevels) - 1;
+    const int slot = SlotAt(level, tick);
+
+    TimerEntry*& head = slots_[level][slot];
+    entry->slot_ = level * kWheelSize + slot;
+    entry->linked_ = true;
+    entry->prev_ = nullptr;
+    entry->next_ = head;
+    if (head) head->prev_ = entry;
+    head = entry;
+    occupied_[level][slot / 64] |= uint64_t{1} << (slot % 64);
+  }
+
+  void Unlink(TimerEntry* entry) TFRT_REQUIRES(mu_) {
+    const int level = entry->slot_ / kWheelSize;
+    const int slot = entry->slot_ % kWheelSize;
+    if (entry->prev_) {
+      entry->prev_->next_ = entry->next_;
+    } else {
+      slots_[level][slot] = entry->next_;
+    }
+    if (entry->next_) entry->next_->prev_ = entry->prev_;
+    if (!slots_[level][slot])
+      occupied_[level][slot / 64] &= ~(uint64_t{1} << (slot % 64));
+    entry->linked_ = false;
+    entry->prev_ = entry->next_ = nullptr;
+  }
+
+  // Empties a slot and returns its list of timers.
+  TimerEntry* TakeSlot(int level, int slot) TFRT_REQUIRES(mu_) {
+    TimerEntry* head = slots_[level][slot];
+    slots_[level][slot] = nullptr;
+    occupied_[level][slot / 64] &= ~(uint64_t{1} << (slot % 64));
+    return head;
+  }
+
+  mutex mu_;
+  // The first tick that has not been processed yet.
+  int64_t current_tick_ TFRT_GUARDED_BY(mu_);
+  int64_t num_timers_ TFRT_GUARDED_BY(mu_) = 0;
+  TimerEntry* slots_[kNumLevels][kWheelSize] TFRT_GUARDED_BY(mu_) = {};
+  uint64_t occupied_[kNumLevels][kWheelSize / 64] TFRT_GUARDED_BY(mu_) = {};
+};
+
+TimerQueue::TimerQueue()
+    : wakeup_tick_(kMaxTick), wheels_(new TimerWheel[kNumShards]) {
   // Start the timer thread.
   // TODO(tfrt-devs): use alternative to std::thread in google-internal build.
   timer_thread_ = std::thread([this]() { TimerThreadRun(); });
@@ -28,67 +232,67 @@ TimerQueue::TimerQueue() {
 
 TimerQueue::~TimerQueue() {
   mu_.lock();
-  // Cancel every timer in the queue.
-  while (!timers_.empty()) {
-    timers_.pop();
-  }
-  stop_.store(true, std::memory_order_release);
-  // Notify the timer thread we are done cleaning up.
+  stop_ = true;
+  // Notify the timer thread we are done.
   cv_.notify_one();
   mu_.unlock();
   assert(timer_thread_.joinable());
   timer_thread_.join();
+  // The wheels drop the timers that did not expire yet.
+  wheels_.reset();
 }
 
 void TimerQueue::TimerThreadRun() {
+  std::vector<RCReference<TimerEntry>> expired;
   mutex_lock lock(mu_);
-  while (!stop_.load(std::memory_order_acquire)) {
-    const TimerEntry* top_entry = getTopTimer();
-    if (!top_entry) {
-      cv_.wait(lock);
-    } else {
-      // Wait till the timer expires.
-      cv_.wait_until(lock, top_entry->deadline_);
-    }
-    while (!timers_.empty() && timers_.top()->deadline_ <= Clock::now()) {
-      const auto top_entry = timers_.top();
-      timers_.pop();
-      mu_.unlock();
-      // If timer is not cancelled, run the callback.
-      if (!top_entry->cancelled_) {
-        top_entry->timer_callback_();
-      }
-      mu_.lock();
+  while (!stop_) {
+    // Timers scheduled while the wheels are advanced set `pending_`, so that
+    // they are found by the next iteration.
+    pending_ = false;
+    wakeup_tick_.store(kMaxTick);
+    mu_.unlock();
+
+    const int64_t now_tick = NowTick<Clock>();
+    int64_t next_tick = kMaxTick;
+    for (int i = 0; i < kNumShards; ++i)
+      next_tick = std::min(next_tick, wheels_[i].Advance(now_tick, &expired));
+
+    // Run the callbacks of timers that are not cancelled, by deadline.
+    std::stable_sort(expired.begin(), expired.end(),
+                     [](const RCReference<TimerEntry>& a,
+                        const RCReference<TimerEntry>& b) {
+                       return a->deadline_ < b->deadline_;
+                     });
+    for (auto& entry : expired) {
+      if (!entry->cancelled_.load(std::memory_order_acquire))
+        entry->timer_callback_();
     }
-  }
-}
+    expired.clear();
 
-TimerQueue::TimerEntry* TimerQueue::getTopTimer() TFRT_REQUIRES(mu_) {
-  while (!timers_.empty()) {
-    if (timers_.top()->cancelled_) {
-      // Timer is cancelled, discard.
-      timers_.pop();
+    mu_.lock();
+    if (pending_ || stop_) continue;
+    wakeup_tick_.store(next_tick);
+    if (next_tick == kMaxTick) {
+      cv_.wait(lock);
     } else {
-      return timers_.top().get();
+      cv_.wait_until(lock, TimePoint(std::chrono::milliseconds(next_tick)));
     }
   }
-  // No active timer found. Return a nullptr.
-  return nullptr;
 }
 
 TimerQueue::TimerHandle TimerQueue::ScheduleTimerAt(TimePoint deadline,
                                                     TimerCallback callback) {
   TimerHandle th = TimerEntry::Create(deadline, std::move(callback));
-  bool notify = false;
-  {
+  th->shard_ =
+      std::hash<std::thread::id>()(std::this_thread::get_id()) % kNumShards;
+  th->tick_ = DeadlineToTick(deadline);
+  const int64_t tick = wheels_[th->shard_].Add(th.get());
+  // Only notify the timer thread when the new timer expires before it wakes up.
+  if (tick < wakeup_tick_.load()) {
     mutex_lock lock(mu_);
-    // Only notify timer thread when the queue is empty, or when the newly added
-    // timer's deadline is shorter.
-    notify = timers_.empty() || timers_.top()->deadline_ > deadline;
-    timers_.push(th);
+    pending_ = true;
+    cv_.notify_one();
   }
-  // Notify the timer thread that a new timer is added.
-  if (notify) cv_.notify_one();
   return th;
 }
 
@@ -103,6 +307,7 @@ void TimerQueue::CancelTimer(const TimerQueue::TimerHandle& timer_handle) {
   // callback has started execution, the CancelTimer() will block until
   // the execution finishes.
   timer_handle->cancelled_.store(true, std::memory_order_release);
+  wheels_[timer_handle->shard_].Remove(timer_handle.get());
 }
 
 }  // namespace tfrt
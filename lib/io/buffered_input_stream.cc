@@ -16,33 +16,54 @@
 
 #include "tfrt/io/buffered_input_stream.h"
 
+#include <cstdint>
+#include <cstring>
+
 namespace tfrt {
 namespace io {
 
-llvm::Expected<size_t> BufferedInputStream::Read(char* buf, size_t max_count) {
-  if (max_count < 0) return MakeStringError("max_count should not be negative");
-
-  if (!buffer_limit_) {
-    auto error = buffer_limit_.takeError();
-    buffer_limit_ = 0;
-    return std::move(error);
+llvm::Error BufferedInputStream::FillBuffer() {
+  const size_t unread = BufferedCount();
+  char* data = static_cast<char*>(buffer_->data());
+  if (buffer_->IsUnique()) {
+    std::memmove(data, data + buffer_pos_, unread);
+  } else {
+    // Chunks returned by ReadChunk() still refer to the buffer, so leave it to
+    // them and continue with a new one.
+    auto buffer = HostBuffer::CreateUninitialized(buffer_size_,
+                                                  kBufferAlignment, allocator_);
+    if (!buffer) return MakeStringError("failed to allocate stream buffer");
+    std::memcpy(buffer->data(), data + buffer_pos_, unread);
+    buffer_ = std::move(buffer);
   }
+  buffer_pos_ = 0;
+  buffer_limit_ = unread;
 
+  auto count = input_stream_->Read(
+      static_cast<char*>(buffer_->data()) + unread, buffer_size_ - unread);
+  if (!count) return count.takeError();
+  buffer_limit_ += *count;
+  return llvm::Error::success();
+}
+
+llvm::Expected<size_t> BufferedInputStream::Read(char* buf, size_t max_count) {
   size_t actual_count = 0;
   while (actual_count < max_count) {
-    if (buffer_pos_ == *buffer_limit_) {
-      buffer_limit_ = input_stream_->Read(buffer_, buffer_size_);
-      buffer_pos_ = 0;
-      if (!buffer_limit_) {
-        auto error = buffer_limit_.takeError();
-        buffer_limit_ = 0;
-        return std::move(error);
+    if (buffer_pos_ == buffer_limit_) {
+      // Reads larger than the buffer bypass it, which would only add a copy.
+      const size_t remaining = max_count - actual_count;
+      if (remaining >= buffer_size_) {
+        auto count = input_stream_->Read(buf + actual_count, remaining);
+        if (!count) return count.takeError();
+        actual_count += *count;
+        break;
       }
-      if (*buffer_limit_ == 0) break;
+      if (auto error = FillBuffer()) return std::move(error);
+      if (buffer_limit_ == 0) break;
     }
-    size_t read_cnt =
-        std::min(*buffer_limit_ - buffer_pos_, max_count - actual_count);
-    std::memcpy(buf + actual_count, buffer_ + buffer_pos_, read_cnt);
+    size_t read_cnt = std::min(BufferedCount(), max_count - actual_count);
+    std::memcpy(buf + actual_count,
+                static_cast<char*>(buffer_->data()) + buffer_pos_, read_cnt);
     buffer_pos_ += read_cnt;
     actual_count += read_cnt;
   }
@@ -50,6 +71,42 @@ llvm::Expected<size_t> BufferedInputStream::Read(char* buf, size_t max_count) {
   return actual_count;
 }
 
+llvm::Expected<RCReference<HostBuffer>> BufferedInputStream::ReadChunk(
+    size_t count, size_t alignment) {
+  assert(alignment > 0 && (alignment & (alignment - 1)) == 0 &&
+         "alignment must be a power of two");
+
+  if (count <= buffer_size_ && alignment <= kBufferAlignment) {
+    const auto is_aligned = [&]() {
+      auto address = reinterpret_cast<std::uintptr_t>(
+          static_cast<char*>(buffer_->data()) + buffer_pos_);
+      return address % alignment == 0;
+    };
+    // Moving the unread bytes to the front of the buffer also aligns them,
+    // because the buffer itself is aligned.
+    if (BufferedCount() < count || !is_aligned()) {
+      if (auto error = FillBuffer()) return std::move(error);
+    }
+
+    const size_t chunk_size = std::min(count, BufferedCount());
+    auto chunk = HostBuffer::CreateFromExternal(buffer_.CopyRef(),
+                                                buffer_pos_, chunk_size);
+    buffer_pos_ += chunk_size;
+    stream_pos_ += chunk_size;
+    return std::move(chunk);
+  }
+
+  // The chunk does not fit into the buffer. Read it into its own buffer, which
+  // only copies the bytes that are buffered already.
+  auto chunk = HostBuffer::CreateUninitialized(count, alignment, allocator_);
+  if (!chunk)
+    return MakeStringError("failed to allocate chunk of ", count, " bytes");
+  auto actual_count = Read(static_cast<char*>(chunk->data()), count);
+  if (!actual_count) return actual_count.takeError();
+  if (*actual_count == count) return std::move(chunk);
+  return HostBuffer::CreateFromExternal(std::move(chunk), 0, *actual_count);
+}
+
 llvm::Expected<size_t> BufferedInputStream::Tell() { return stream_pos_; }
 
 }  // namespace io
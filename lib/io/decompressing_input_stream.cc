@@ -0,0 +1,318 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements the DecompressingInputStream class.
+
+#include "tfrt/io/decompressing_input_stream.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "absl/status/status.h"
+#include "tfrt/host_context/async_dispatch.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/support/byte_order.h"
+#include "zlib.h"
+
+namespace tfrt {
+namespace io {
+namespace {
+
+// A BGZF frame is a gzip member with an extra field of 6 bytes that holds the
+// size of the member minus one.
+constexpr size_t kFrameHeaderSize = 18;
+constexpr size_t kFrameFooterSize = 8;
+// The most data a BGZF frame holds, which is the size of the output buffers.
+constexpr size_t kMaxFrameDataSize = 64 * 1024;
+constexpr size_t kFrameBufferAlignment = 64;
+
+uint16_t DecodeUint16(const char* data) {
+  ASSERT_LITTLE_ENDIAN();
+  uint16_t value;
+  std::memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+uint32_t DecodeUint32(const char* data) {
+  ASSERT_LITTLE_ENDIAN();
+  uint32_t value;
+  std::memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+bool IsFrameHeader(const char* header) {
+  const auto* bytes = reinterpret_cast<const uint8_t*>(header);
+  return bytes[0] == 0x1f && bytes[1] == 0x8b && bytes[2] == Z_DEFLATED &&
+         (bytes[3] & 0x04) != 0 && DecodeUint16(header + 10) == 6 &&
+         bytes[12] == 'B' && bytes[13] == 'C' &&
+         DecodeUint16(header + 14) == 2;
+}
+
+// Decompresses the BGZF frame `frame` into the `size` bytes at `output`, where
+// `size` is the data size stored in the footer of the frame.
+llvm::Error InflateFrame(const std::string& frame, char* output, size_t size) {
+  z_stream stream;
+  std::memset(&stream, 0, sizeof(stream));
+  // The frame data is a raw deflate stream between the header and the footer.
+  if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+    return MakeStringError("failed to initialize inflater");
+  stream.next_in = reinterpret_cast<Bytef*>(
+      const_cast<char*>(frame.data() + kFrameHeaderSize));
+  stream.avail_in = frame.size() - kFrameHeaderSize - kFrameFooterSize;
+  stream.next_out = reinterpret_cast<Bytef*>(output);
+  stream.avail_out = size;
+  const int status = inflate(&stream, Z_FINISH);
+  const size_t count = stream.total_out;
+  inflateEnd(&stream);
+  if (status != Z_STREAM_END || count != size)
+    return MakeStringError("corrupted gzip frame");
+
+  const char* footer = frame.data() + frame.size() - kFrameFooterSize;
+  const uLong crc =
+      crc32(crc32(0, Z_NULL, 0), reinterpret_cast<Bytef*>(output), count);
+  if (crc != DecodeUint32(footer))
+    return MakeStringError("gzip frame checksum mismatch");
+  return llvm::Error::success();
+}
+
+}  // namespace
+
+DecompressingInputStream::DecompressingInputStream(
+    std::unique_ptr<InputStream> input, HostContext* host, Options options)
+    : input_stream_(std::move(input)), host_(host), options_(options) {
+  assert(options_.num_frames_in_flight > 0);
+  assert(options_.input_buffer_size > 0);
+}
+
+// The frames in flight hold their own references to their buffers, so they
+// need not be waited for.
+DecompressingInputStream::~DecompressingInputStream() {
+  if (inflater_) inflateEnd(inflater_.get());
+}
+
+llvm::Error DecompressingInputStream::FillInput(size_t count) {
+  if (BufferedInputCount() >= count || input_done_)
+    return llvm::Error::success();
+
+  input_.erase(0, input_pos_);
+  input_pos_ = 0;
+  while (input_.size() < count) {
+    const size_t size = input_.size();
+    const size_t read_size = std::max(count - size, options_.input_buffer_size);
+    input_.resize(size + read_size);
+    auto read_count = input_stream_->Read(&input_[size], read_size);
+    if (!read_count) {
+      input_.resize(size);
+      return read_count.takeError();
+    }
+    input_.resize(size + *read_count);
+    if (*read_count < read_size) {
+      input_done_ = true;
+      break;
+    }
+  }
+  return llvm::Error::success();
+}
+
+llvm::Error DecompressingInputStream::DetectFormat() {
+  if (auto error = FillInput(kFrameHeaderSize)) return error;
+  format_ = BufferedInputCount() >= kFrameHeaderSize &&
+                    IsFrameHeader(input_.data() + input_pos_)
+                ? Format::kFramed
+                : Format::kStream;
+  return llvm::Error::success();
+}
+
+void DecompressingInputStream::ScheduleFrames() {
+  while (frames_.size() < options_.num_frames_in_flight) {
+    if (auto error = FillInput(kFrameHeaderSize)) {
+      ScheduleError(std::move(error));
+      return;
+    }
+    if (BufferedInputCount() == 0) return;
+
+    const char* header = input_.data() + input_pos_;
+    if (BufferedInputCount() < kFrameHeaderSize || !IsFrameHeader(header)) {
+      // The rest of the stream is not framed. Switch to the kStream format once
+      // the consumer has read the frames in flight.
+      if (frames_.empty()) format_ = Format::kStream;
+      return;
+    }
+
+    const size_t frame_size = DecodeUint16(header + 16) + 1;
+    if (frame_size < kFrameHeaderSize + kFrameFooterSize) {
+      ScheduleError(MakeStringError("invalid gzip frame size ", frame_size));
+      return;
+    }
+    if (auto error = FillInput(frame_size)) {
+      ScheduleError(std::move(error));
+      return;
+    }
+    if (BufferedInputCount() < frame_size) {
+      ScheduleError(MakeStringError("truncated gzip frame"));
+      return;
+    }
+    ScheduleFrame(frame_size);
+  }
+}
+
+void DecompressingInputStream::ScheduleFrame(size_t frame_size) {
+  std::string frame = input_.substr(input_pos_, frame_size);
+  input_pos_ += frame_size;
+
+  const size_t data_size =
+      DecodeUint32(frame.data() + frame_size - kFrameFooterSize + 4);
+  RCReference<HostBuffer> data;
+  if (data_size <= kMaxFrameDataSize && !free_buffers_.empty()) {
+    data = std::move(free_buffers_.back());
+    free_buffers_.pop_back();
+  } else {
+    data = HostBuffer::CreateUninitialized(
+        std::max(data_size, kMaxFrameDataSize), kFrameBufferAlignment,
+        host_->allocator());
+    if (!data) {
+      ScheduleError(MakeStringError("failed to allocate frame buffer"));
+      return;
+    }
+  }
+
+  Frame result;
+  result.data = data.CopyRef();
+  result.count = MakeUnconstructedAsyncValueRef<size_t>();
+  EnqueueWork(host_, [frame = std::move(frame), data = std::move(data),
+                      data_size, count = result.count.CopyRef()]() mutable {
+    if (auto error = InflateFrame(frame, static_cast<char*>(data->data()),
+                                  data_size)) {
+      count.SetError(absl::DataLossError(toString(std::move(error))));
+    } else {
+      count.emplace(data_size);
+    }
+  });
+  frames_.push_back(std::move(result));
+}
+
+void DecompressingInputStream::ScheduleError(llvm::Error error) {
+  Frame frame;
+  frame.count = MakeUnconstructedAsyncValueRef<size_t>();
+  frame.count.SetError(absl::DataLossError(toString(std::move(error))));
+  frames_.push_back(std::move(frame));
+  // No frames are decompressed after the failed one.
+  input_done_ = true;
+  input_pos_ = input_.size();
+}
+
+llvm::Expected<size_t> DecompressingInputStream::ReadFrames(char* buf,
+                                                            size_t max_count) {
+  size_t actual_count = 0;
+  while (actual_count < max_count) {
+    ScheduleFrames();
+    if (frames_.empty()) break;
+
+    Frame& frame = frames_.front();
+    if (!frame.count.IsAvailable()) Await(host_, frame.count);
+    // Keep the failed frame at the front, so that further reads fail too.
+    // Bytes of the frames before it are returned first.
+    if (frame.count.IsError()) {
+      if (actual_count > 0) break;
+      return MakeStringError("failed to decompress stream: ",
+                             std::string(frame.count.GetError().message()));
+    }
+
+    const size_t read_cnt =
+        std::min(frame.count.get() - frame.pos, max_count - actual_count);
+    std::memcpy(buf + actual_count,
+                static_cast<char*>(frame.data->data()) + frame.pos, read_cnt);
+    frame.pos += read_cnt;
+    actual_count += read_cnt;
+
+    if (frame.pos == frame.count.get()) {
+      // Reuse the buffer if the decompression task has released it.
+      auto buffer = std::move(frame.data);
+      frames_.pop_front();
+      if (buffer->IsUnique() && buffer->size() == kMaxFrameDataSize)
+        free_buffers_.push_back(std::move(buffer));
+    }
+  }
+  return actual_count;
+}
+
+llvm::Expected<size_t> DecompressingInputStream::ReadStream(char* buf,
+                                                            size_t max_count) {
+  if (!inflater_) {
+    inflater_ = std::make_unique<z_stream>();
+    std::memset(inflater_.get(), 0, sizeof(z_stream));
+    // Detect gzip and zlib headers.
+    if (inflateInit2(inflater_.get(), MAX_WBITS + 32) != Z_OK) {
+      inflater_.reset();
+      return MakeStringError("failed to initialize inflater");
+    }
+  }
+
+  size_t actual_count = 0;
+  while (actual_count < max_count) {
+    if (auto error = FillInput(1)) return std::move(error);
+    if (BufferedInputCount() == 0) {
+      if (in_member_) return MakeStringError("truncated compressed stream");
+      break;
+    }
+
+    z_stream* stream = inflater_.get();
+    stream->next_in = reinterpret_cast<Bytef*>(&input_[input_pos_]);
+    stream->avail_in = BufferedInputCount();
+    stream->next_out = reinterpret_cast<Bytef*>(buf + actual_count);
+    stream->avail_out = max_count - actual_count;
+    const int status = inflate(stream, Z_NO_FLUSH);
+    input_pos_ = input_.size() - stream->avail_in;
+    actual_count = max_count - stream->avail_out;
+
+    if (status == Z_STREAM_END) {
+      // Another member may follow.
+      inflateReset(stream);
+      in_member_ = false;
+    } else if (status == Z_OK) {
+      in_member_ = true;
+    } else {
+      return MakeStringError("failed to decompress stream: ",
+                             stream->msg ? stream->msg : "invalid data");
+    }
+  }
+  return actual_count;
+}
+
+llvm::Expected<size_t> DecompressingInputStream::Read(char* buf,
+                                                      size_t max_count) {
+  if (format_ == Format::kUnknown) {
+    if (auto error = DetectFormat()) return std::move(error);
+  }
+
+  size_t actual_count = 0;
+  while (actual_count < max_count) {
+    const Format format = format_;
+    auto count = format == Format::kFramed
+                     ? ReadFrames(buf + actual_count, max_count - actual_count)
+                     : ReadStream(buf + actual_count, max_count - actual_count);
+    if (!count) return count.takeError();
+    actual_count += *count;
+    // Continue only if the rest of the stream is in another format.
+    if (format_ == format) break;
+  }
+  stream_pos_ += actual_count;
+  return actual_count;
+}
+
+llvm::Expected<size_t> DecompressingInputStream::Tell() { return stream_pos_; }
+
+}  // namespace io
+}  // namespace tfrt
@@ -25,6 +25,20 @@ llvm::Expected<size_t> FileInputStream::Read(char* buf, size_t max_count) {
   return result;
 }
 
+AsyncValueRef<size_t> FileInputStream::ReadAsync(char* buf, size_t max_count,
+                                                 HostContext* host) {
+  auto count = file_->ReadAsync(buf, max_count, offset_, host);
+
+  // Advance the position before the caller observes the result.
+  auto result = MakeUnconstructedAsyncValueRef<size_t>();
+  count.AndThen([this, count = count.CopyRef(), result = result.CopyRef()]() {
+    if (count.IsError()) return result.SetError(count.GetError());
+    offset_ += count.get();
+    result.emplace(count.get());
+  });
+  return result;
+}
+
 llvm::Expected<size_t> FileInputStream::Tell() { return offset_; }
 
 }  // namespace io
@@ -18,9 +18,30 @@
 
 #include "tfrt/io/file_system.h"
 
+#include "tfrt/host_context/async_dispatch.h"
+
 namespace tfrt {
 namespace io {
 
+AsyncValueRef<size_t> RandomAccessFile::ReadAsync(char* buf, size_t max_count,
+                                                  size_t offset,
+                                                  HostContext* host) const {
+  auto result = MakeUnconstructedAsyncValueRef<size_t>();
+  bool enqueued = EnqueueBlockingWork(
+      host, [this, buf, max_count, offset, result = result.CopyRef()]() {
+        auto count = Read(buf, max_count, offset);
+        if (count) {
+          result.emplace(*count);
+        } else {
+          result.SetError(absl::InternalError(toString(count.takeError())));
+        }
+      });
+  if (!enqueued) {
+    result.SetError(absl::InternalError("failed to enqueue blocking read"));
+  }
+  return result;
+}
+
 void FileSystemRegistry::Register(const std::string& scheme,
                                   std::unique_ptr<FileSystem> file_system) {
   assert(file_system);
@@ -36,5 +57,11 @@ FileSystem* FileSystemRegistry::Lookup(const std::string& scheme) {
   return file_systems_[scheme].get();
 }
 
+FileSystem* FileSystemRegistry::LookupForPath(string_view path) {
+  size_t scheme_end = path.find("://");
+  if (scheme_end == string_view::npos) return Lookup("");
+  return Lookup(std::string(path.substr(0, scheme_end)));
+}
+
 }  // namespace io
 }  // namespace tfrt
@@ -0,0 +1,321 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements the IoUring class with raw io_uring system calls, so
+// that it does not depend on liburing.
+
+#include "io_uring.h"
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define TFRT_HAS_IO_URING 1
+#endif
+#endif
+
+#ifdef TFRT_HAS_IO_URING
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <thread>
+#include <utility>
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm_derived/Support/raw_ostream.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+#endif
+
+namespace tfrt {
+namespace io {
+
+#ifdef TFRT_HAS_IO_URING
+namespace {
+
+// The number of submission queue entries, which bounds the number of reads in
+// flight. Further reads wait in a queue until an earlier read completes.
+constexpr unsigned kQueueDepth = 256;
+
+int IoUringSetup(unsigned entries, io_uring_params* params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int IoUringEnter(int fd, unsigned to_submit, unsigned min_complete,
+                 unsigned flags) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit,
+                                  min_complete, flags, nullptr, 0));
+}
+
+// The ring head and tail indices are shared with the kernel.
+unsigned LoadAcquire(const unsigned* ptr) {
+  return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+void StoreRelease(unsigned* ptr, unsigned value) {
+  __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+}
+
+struct ReadRequest {
+  int fd;
+  char* buf;
+  size_t max_count;
+  size_t offset;
+  // The number of bytes read so far. Short reads are resubmitted for the rest.
+  size_t count = 0;
+  IoUring::ReadCallback done;
+  // The kernel reads the vector asynchronously, so it lives with the request.
+  struct iovec iov;
+};
+
+class LinuxIoUring : public IoUring {
+ public:
+  // Returns nullptr if the kernel does not support io_uring.
+  static LinuxIoUring* Create();
+
+  void Read(int fd, char* buf, size_t max_count, size_t offset,
+            ReadCallback done) override;
+
+ private:
+  LinuxIoUring() = default;
+
+  // Sets up the ring and maps its queues. Returns false on failure.
+  bool Init();
+
+  // Submits `request`, or queues it if the submission queue is full.
+  void Submit(ReadRequest* request) TFRT_REQUIRES(mu_);
+
+  // Resubmits `request` for the rest of the bytes, or calls its callback.
+  void HandleCompletion(ReadRequest* request, int result);
+
+  void CompletionThreadRun();
+
+  int ring_fd_ = -1;
+
+  // Submission queue. Only written by Submit() under `mu_`.
+  unsigned* sq_head_ = nullptr;
+  unsigned* sq_tail_ = nullptr;
+  unsigned* sq_mask_ = nullptr;
+  unsigned* sq_array_ = nullptr;
+  io_uring_sqe* sqes_ = nullptr;
+  unsigned sq_entries_ = 0;
+
+  // Completion queue. Only read by the completion thread.
+  unsigned* cq_head_ = nullptr;
+  unsigned* cq_tail_ = nullptr;
+  unsigned* cq_mask_ = nullptr;
+  io_uring_cqe* cqes_ = nullptr;
+
+  mutex mu_;
+  // The number of requests submitted to the kernel and not yet completed. It
+  // never exceeds `sq_entries_`, so the completion queue, which is at least as
+  // large as the submission queue, never overflows.
+  unsigned in_flight_ TFRT_GUARDED_BY(mu_) = 0;
+  std::deque<ReadRequest*> pending_ TFRT_GUARDED_BY(mu_);
+};
+
+LinuxIoUring* LinuxIoUring::Create() {
+  auto* io_uring = new LinuxIoUring();
+  if (!io_uring->Init()) {
+    delete io_uring;
+    return nullptr;
+  }
+
+  // The instance lives until the process exits, and so does its thread.
+  std::thread([io_uring]() { io_uring->CompletionThreadRun(); }).detach();
+  return io_uring;
+}
+
+bool LinuxIoUring::Init() {
+  io_uring_params params;
+  std::memset(&params, 0, sizeof(params));
+  ring_fd_ = IoUringSetup(kQueueDepth, &params);
+  if (ring_fd_ < 0) return false;
+
+  size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  size_t cq_size =
+      params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mmap) sq_size = cq_size = std::max(sq_size, cq_size);
+  const size_t sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+
+  void* sq = mmap(nullptr, sq_size, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  void* cq = single_mmap ? sq
+                         : mmap(nullptr, cq_size, PROT_READ | PROT_WRITE,
+                                MAP_SHARED | MAP_POPULATE, ring_fd_,
+                                IORING_OFF_CQ_RING);
+  void* sqes = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+
+  if (sq == MAP_FAILED || cq == MAP_FAILED || sqes == MAP_FAILED) {
+    if (sq != MAP_FAILED) munmap(sq, sq_size);
+    if (cq != MAP_FAILED && !single_mmap) munmap(cq, cq_size);
+    if (sqes != MAP_FAILED) munmap(sqes, sqes_size);
+    close(ring_fd_);
+    return false;
+  }
+
+  char* sq_ptr = static_cast<char*>(sq);
+  sq_head_ = reinterpret_cast<unsigned*>(sq_ptr + params.sq_off.head);
+  sq_tail_ = reinterpret_cast<unsigned*>(sq_ptr + params.sq_off.tail);
+  sq_mask_ = reinterpret_cast<unsigned*>(sq_ptr + params.sq_off.ring_mask);
+  sq_array_ = reinterpret_cast<unsigned*>(sq_ptr + params.sq_off.array);
+  sqes_ = static_cast<io_uring_sqe*>(sqes);
+  sq_entries_ = params.sq_entries;
+
+  char* cq_ptr = static_cast<char*>(cq);
+  cq_head_ = reinterpret_cast<unsigned*>(cq_ptr + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned*>(cq_ptr + params.cq_off.tail);
+  cq_mask_ = reinterpret_cast<unsigned*>(cq_ptr + params.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<io_uring_cqe*>(cq_ptr + params.cq_off.cqes);
+
+  return true;
+}
+
+void LinuxIoUring::Read(int fd, char* buf, size_t max_count, size_t offset,
+                        ReadCallback done) {
+  if (max_count == 0) return done(0);
+
+  auto* request = new ReadRequest();
+  request->fd = fd;
+  request->buf = buf;
+  request->max_count = max_count;
+  request->offset = offset;
+  request->done = std::move(done);
+
+  mutex_lock lock(mu_);
+  Submit(request);
+}
+
+void LinuxIoUring::Submit(ReadRequest* request) {
+  if (in_flight_ == sq_entries_) {
+    pending_.push_back(request);
+    return;
+  }
+
+  // Some kernels reject reads of more than fits in a 32-bit integer, like
+  // pread does on some platforms.
+  request->iov.iov_base = request->buf + request->count;
+  request->iov.iov_len =
+      std::min<size_t>(request->max_count - request->count,
+                       std::numeric_limits<std::int32_t>::max());
+
+  // IORING_OP_READV is supported by all io_uring kernels, unlike
+  // IORING_OP_READ.
+  const unsigned tail = *sq_tail_;
+  const unsigned index = tail & *sq_mask_;
+  io_uring_sqe* sqe = &sqes_[index];
+  std::memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = IORING_OP_READV;
+  sqe->fd = request->fd;
+  sqe->addr = reinterpret_cast<std::uint64_t>(&request->iov);
+  sqe->len = 1;
+  sqe->off = request->offset + request->count;
+  sqe->user_data = reinterpret_cast<std::uint64_t>(request);
+  sq_array_[index] = index;
+  StoreRelease(sq_tail_, tail + 1);
+  ++in_flight_;
+
+  // Submit every entry the kernel has not consumed yet, in case an earlier
+  // submission failed transiently.
+  for (;;) {
+    const unsigned to_submit = tail + 1 - LoadAcquire(sq_head_);
+    if (to_submit == 0 || IoUringEnter(ring_fd_, to_submit, 0, 0) >= 0) break;
+    if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+      tfrt::errs() << "failed to submit io_uring read due to error: "
+                   << strerror(errno) << "\n";
+      break;
+    }
+    std::this_thread::yield();
+  }
+}
+
+void LinuxIoUring::HandleCompletion(ReadRequest* request, int result) {
+  bool finished = true;
+  if (result == -EINTR || result == -EAGAIN) {
+    finished = false;
+  } else if (result > 0) {
+    request->count += result;
+    finished = request->count == request->max_count;
+  }
+
+  {
+    mutex_lock lock(mu_);
+    --in_flight_;
+    if (!finished) {
+      Submit(request);
+      return;
+    }
+    if (!pending_.empty()) {
+      ReadRequest* next = pending_.front();
+      pending_.pop_front();
+      Submit(next);
+    }
+  }
+
+  request->done(result < 0 ? static_cast<ssize_t>(result)
+                           : static_cast<ssize_t>(request->count));
+  delete request;
+}
+
+void LinuxIoUring::CompletionThreadRun() {
+  llvm::SmallVector<std::pair<ReadRequest*, int>, 32> completions;
+
+  for (;;) {
+    if (IoUringEnter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS) < 0 &&
+        errno != EINTR) {
+      tfrt::errs() << "failed to wait for io_uring completions due to error: "
+                   << strerror(errno) << "\n";
+      continue;
+    }
+
+    // Copy the completions out of the ring before handling them, because
+    // handling a completion may submit new requests.
+    unsigned head = *cq_head_;
+    const unsigned tail = LoadAcquire(cq_tail_);
+    for (; head != tail; ++head) {
+      const io_uring_cqe& cqe = cqes_[head & *cq_mask_];
+      completions.emplace_back(reinterpret_cast<ReadRequest*>(cqe.user_data),
+                               cqe.res);
+    }
+    StoreRelease(cq_head_, head);
+
+    for (auto& completion : completions)
+      HandleCompletion(completion.first, completion.second);
+    completions.clear();
+  }
+}
+
+}  // namespace
+#endif  // TFRT_HAS_IO_URING
+
+IoUring* IoUring::Get() {
+#ifdef TFRT_HAS_IO_URING
+  static IoUring* io_uring = LinuxIoUring::Create();
+  return io_uring;
+#else
+  return nullptr;
+#endif
+}
+
+}  // namespace io
+}  // namespace tfrt
@@ -0,0 +1,57 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file declares the IoUring class, which submits asynchronous reads to a
+// Linux io_uring instance.
+
+#ifndef TFRT_LIB_IO_IO_URING_H_
+#define TFRT_LIB_IO_IO_URING_H_
+
+#include <sys/types.h>
+
+#include <cstddef>
+
+#include "llvm/ADT/FunctionExtras.h"
+
+namespace tfrt {
+namespace io {
+
+// A process-wide io_uring instance with a dedicated thread that reaps the
+// completions. This class is thread-safe.
+class IoUring {
+ public:
+  // Called with the number of bytes read, or with a negative errno value.
+  using ReadCallback = llvm::unique_function<void(ssize_t)>;
+
+  // Returns the process-wide instance, or nullptr if io_uring is not supported
+  // by the kernel or by the platform this library was built for.
+  static IoUring* Get();
+
+  // Reads up to `max_count` bytes from `fd` starting at `offset` into `buf`.
+  // Like PosixRandomAccessFile::Read, the read only returns less than
+  // `max_count` bytes at EOF. `done` is typically called on the completion
+  // thread, so it must not block. `fd` and `buf` must stay valid until `done`
+  // is called.
+  virtual void Read(int fd, char* buf, size_t max_count, size_t offset,
+                    ReadCallback done) = 0;
+
+ protected:
+  IoUring() = default;
+  virtual ~IoUring() = default;
+};
+
+}  // namespace io
+}  // namespace tfrt
+
+#endif  // TFRT_LIB_IO_IO_URING_H_
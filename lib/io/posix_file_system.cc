@@ -20,11 +20,20 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <limits>
 
+#include "io_uring.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm_derived/Support/raw_ostream.h"
+#include "tfrt/host_context/async_dispatch.h"
+#include "tfrt/support/string_util.h"
 
 namespace tfrt {
 namespace io {
@@ -45,6 +54,10 @@ class PosixRandomAccessFile : public RandomAccessFile {
   llvm::Expected<size_t> Read(char* buf, size_t max_count,
                               size_t offset) const override;
 
+  // Submits the read to io_uring if the kernel supports it.
+  AsyncValueRef<size_t> ReadAsync(char* buf, size_t max_count, size_t offset,
+                                  HostContext* host) const override;
+
  private:
   int fd_;
   const std::string path_;
@@ -81,6 +94,137 @@ llvm::Expected<size_t> PosixRandomAccessFile::Read(char* buf, size_t max_count,
 
   return actual_count;
 }
+
+AsyncValueRef<size_t> PosixRandomAccessFile::ReadAsync(
+    char* buf, size_t max_count, size_t offset, HostContext* host) const {
+  IoUring* io_uring = IoUring::Get();
+  if (fd_ < 0 || !io_uring)
+    return RandomAccessFile::ReadAsync(buf, max_count, offset, host);
+
+  auto result = MakeUnconstructedAsyncValueRef<size_t>();
+  io_uring->Read(
+      fd_, buf, max_count, offset,
+      [this, host, result = result.CopyRef()](ssize_t count) mutable {
+        // Do not run the waiters of `result` on the io_uring completion
+        // thread.
+        EnqueueWork(host, [this, count, result = std::move(result)]() {
+          if (count < 0) {
+            result.SetError(absl::InternalError(
+                StrCat("failed to read file ", path_,
+                       " due to error: ", strerror(-count))));
+          } else {
+            result.emplace(static_cast<size_t>(count));
+          }
+        });
+      });
+  return result;
+}
+
+// This class is used to append data to a file.
+class PosixWritableFile : public WritableFile {
+ public:
+  explicit PosixWritableFile(int fd, const std::string& path)
+      : fd_(fd), path_(path) {}
+
+  ~PosixWritableFile() override;
+
+  // This class is not copyable or movable.
+  PosixWritableFile(const PosixWritableFile&) = delete;
+  PosixWritableFile operator=(const PosixWritableFile&) = delete;
+
+  llvm::Error Append(ArrayRef<string_view> chunks) override;
+
+  llvm::Error Close() override;
+
+ private:
+  int fd_;
+  const std::string path_;
+};
+
+PosixWritableFile::~PosixWritableFile() {
+  if (auto error = Close()) {
+    tfrt::errs() << toString(std::move(error)) << "\n";
+  }
+}
+
+llvm::Error PosixWritableFile::Append(ArrayRef<string_view> chunks) {
+  if (fd_ < 0) return MakeStringError("failed to write file ", path_);
+
+  llvm::SmallVector<struct iovec, 16> iovs;
+  iovs.reserve(chunks.size());
+  for (string_view chunk : chunks) {
+    if (chunk.empty()) continue;
+    iovs.push_back({const_cast<char*>(chunk.data()), chunk.size()});
+  }
+
+  size_t next = 0;
+  while (next < iovs.size()) {
+    const int count = std::min<size_t>(iovs.size() - next, IOV_MAX);
+    ssize_t written = writev(fd_, &iovs[next], count);
+    if (written < 0) {
+      if (errno == EINTR || errno == EAGAIN) continue;
+      return MakeStringError("failed to write file ", path_,
+                             " due to error: ", strerror(errno));
+    }
+
+    // Skip the chunks that were written completely, and advance into the first
+    // one that was not.
+    while (written > 0) {
+      struct iovec& iov = iovs[next];
+      if (static_cast<size_t>(written) >= iov.iov_len) {
+        written -= iov.iov_len;
+        ++next;
+      } else {
+        iov.iov_base = static_cast<char*>(iov.iov_base) + written;
+        iov.iov_len -= written;
+        written = 0;
+      }
+    }
+  }
+
+  return llvm::Error::success();
+}
+
+llvm::Error PosixWritableFile::Close() {
+  if (fd_ < 0) return llvm::Error::success();
+  int result = close(fd_);
+  fd_ = -1;
+  if (result < 0) {
+    return MakeStringError("failed to close file ", path_,
+                           " due to error: ", strerror(errno));
+  }
+  return llvm::Error::success();
+}
+
+// This class owns a read-only shared memory mapping of a file.
+class PosixReadOnlyMemoryRegion : public ReadOnlyMemoryRegion {
+ public:
+  explicit PosixReadOnlyMemoryRegion(void* address, size_t length,
+                                     const std::string& path)
+      : address_(address), length_(length), path_(path) {}
+
+  ~PosixReadOnlyMemoryRegion() override;
+
+  // This class is not copyable or movable.
+  PosixReadOnlyMemoryRegion(const PosixReadOnlyMemoryRegion&) = delete;
+  PosixReadOnlyMemoryRegion operator=(const PosixReadOnlyMemoryRegion&) =
+      delete;
+
+  const void* data() const override { return address_; }
+  size_t length() const override { return length_; }
+
+ private:
+  void* address_;
+  size_t length_;
+  const std::string path_;
+};
+
+PosixReadOnlyMemoryRegion::~PosixReadOnlyMemoryRegion() {
+  if (munmap(address_, length_) < 0) {
+    tfrt::errs() << "failed to unmap file " << path_
+                 << " due to error: " << strerror(errno) << "\n";
+  }
+}
 }  // namespace
 
 llvm::Error PosixFileSystem::NewRandomAccessFile(
@@ -95,6 +239,57 @@ llvm::Error PosixFileSystem::NewRandomAccessFile(
   return llvm::Error::success();
 }
 
+llvm::Error PosixFileSystem::NewWritableFile(
+    const std::string& path, std::unique_ptr<WritableFile>* file) {
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    file->reset();
+    return MakeStringError("failed to open file ", path,
+                           " for writing due to error: ", strerror(errno));
+  }
+  *file = std::make_unique<PosixWritableFile>(fd, path);
+  return llvm::Error::success();
+}
+
+llvm::Error PosixFileSystem::NewReadOnlyMemoryRegion(
+    const std::string& path, std::unique_ptr<ReadOnlyMemoryRegion>* region) {
+  region->reset();
+
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return MakeStringError("failed to open file ", path,
+                           " due to error: ", strerror(errno));
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    int error = errno;
+    close(fd);
+    return MakeStringError("failed to stat file ", path,
+                           " due to error: ", strerror(error));
+  }
+
+  // mmap() rejects empty mappings.
+  if (st.st_size == 0) {
+    close(fd);
+    return MakeStringError("failed to map empty file ", path);
+  }
+
+  size_t length = static_cast<size_t>(st.st_size);
+  void* address = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+  // The mapping keeps its own reference to the file, so the descriptor can be
+  // closed right away.
+  int mmap_error = errno;
+  close(fd);
+  if (address == MAP_FAILED) {
+    return MakeStringError("failed to map file ", path,
+                           " due to error: ", strerror(mmap_error));
+  }
+
+  *region = std::make_unique<PosixReadOnlyMemoryRegion>(address, length, path);
+  return llvm::Error::success();
+}
+
 void RegisterFileSystem(FileSystemRegistry* registry) {
   auto file_system = std::make_unique<PosixFileSystem>();
   // The scheme is an empty string to be backward-compatible with TF.
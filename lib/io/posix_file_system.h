@@ -36,6 +36,13 @@ class PosixFileSystem : public FileSystem {
   llvm::Error NewRandomAccessFile(
       const std::string& path,
       std::unique_ptr<RandomAccessFile>* file) override;
+
+  llvm::Error NewWritableFile(const std::string& path,
+                              std::unique_ptr<WritableFile>* file) override;
+
+  llvm::Error NewReadOnlyMemoryRegion(
+      const std::string& path,
+      std::unique_ptr<ReadOnlyMemoryRegion>* region) override;
 };
 
 }  // namespace io
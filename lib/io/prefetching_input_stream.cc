@@ -0,0 +1,130 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements the PrefetchingInputStream class.
+
+#include "tfrt/io/prefetching_input_stream.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include "tfrt/host_context/async_dispatch.h"
+#include "tfrt/host_context/host_context.h"
+
+namespace tfrt {
+namespace io {
+
+// The alignment of the prefetch buffers, which suits direct I/O.
+static constexpr size_t kPrefetchBufferAlignment = 4096;
+
+PrefetchingInputStream::PrefetchingInputStream(
+    std::unique_ptr<RandomAccessFile> file, HostContext* host, Options options)
+    : file_(std::move(file)),
+      host_(host),
+      options_(options),
+      readahead_(options.min_readahead) {
+  assert(options_.num_buffers > 0);
+  assert(options_.min_readahead > 0);
+  assert(options_.min_readahead <= options_.max_readahead);
+  Prefetch();
+}
+
+PrefetchingInputStream::~PrefetchingInputStream() { DropSegments(); }
+
+void PrefetchingInputStream::Prefetch() {
+  if (prefetch_done_) return;
+
+  while (segments_.size() < options_.num_buffers) {
+    Segment segment;
+    segment.data = HostBuffer::CreateUninitialized(
+        readahead_, kPrefetchBufferAlignment, host_->allocator());
+    if (segment.data) {
+      segment.count =
+          file_->ReadAsync(static_cast<char*>(segment.data->data()),
+                           segment.data->size(), prefetch_offset_, host_);
+    } else {
+      segment.count = MakeUnconstructedAsyncValueRef<size_t>();
+      segment.count.SetError(
+          absl::InternalError("failed to allocate prefetch buffer"));
+    }
+    prefetch_offset_ += readahead_;
+    segments_.push_back(std::move(segment));
+  }
+}
+
+void PrefetchingInputStream::DropSegments() {
+  // The buffers must outlive the reads into them.
+  for (const Segment& segment : segments_) Await(host_, segment.count);
+  segments_.clear();
+}
+
+llvm::Expected<size_t> PrefetchingInputStream::Read(char* buf,
+                                                    size_t max_count) {
+  size_t actual_count = 0;
+  while (actual_count < max_count) {
+    Prefetch();
+    if (segments_.empty()) break;
+
+    Segment& segment = segments_.front();
+    if (!segment.count.IsAvailable()) {
+      // The consumer is faster than the file system, so amortize the latency
+      // of the reads over more bytes.
+      readahead_ = std::min(readahead_ * 2, options_.max_readahead);
+      ready_streak_ = 0;
+      Await(host_, segment.count);
+    } else if (segment.pos == 0 && ++ready_streak_ >= options_.num_buffers) {
+      // The reads stay ahead of the consumer with fewer bytes in flight.
+      readahead_ = std::max(readahead_ / 2, options_.min_readahead);
+      ready_streak_ = 0;
+    }
+
+    // Keep the failed segment at the front, so that further reads fail too.
+    // Bytes read before the failure are returned first.
+    if (segment.count.IsError()) {
+      prefetch_done_ = true;
+      if (actual_count > 0) break;
+      return MakeStringError(
+          "failed to prefetch file: ",
+          std::string(segment.count.GetError().message()));
+    }
+
+    const size_t count = segment.count.get();
+    const size_t read_cnt =
+        std::min(count - segment.pos, max_count - actual_count);
+    std::memcpy(buf + actual_count,
+                static_cast<char*>(segment.data->data()) + segment.pos,
+                read_cnt);
+    segment.pos += read_cnt;
+    actual_count += read_cnt;
+
+    if (segment.pos == count) {
+      const bool eof = count < segment.data->size();
+      segments_.pop_front();
+      if (eof) {
+        // The reads behind this one are past EOF.
+        prefetch_done_ = true;
+        DropSegments();
+        break;
+      }
+    }
+  }
+  stream_pos_ += actual_count;
+  return actual_count;
+}
+
+llvm::Expected<size_t> PrefetchingInputStream::Tell() { return stream_pos_; }
+
+}  // namespace io
+}  // namespace tfrt
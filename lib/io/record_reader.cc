@@ -0,0 +1,166 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements the FileInputStream class.
+
+
+// This file implements the RecordReader class.
+
+#include "tfrt/io/record_reader.h"
+
+#include <cstring>
+
+#include "tfrt/support/byte_order.h"
+#include "tfrt/support/crc32c.h"
+#include "tfrt/support/error_util.h"
+
+namespace tfrt {
+namespace io {
+namespace {
+
+uint64_t DecodeUint64(const char* data) {
+  ASSERT_LITTLE_ENDIAN();
+  uint64_t value;
+  std::memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+uint32_t DecodeUint32(const char* data) {
+  ASSERT_LITTLE_ENDIAN();
+  uint32_t value;
+  std::memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+// Returns the record length in `header` after verifying its checksum.
+llvm::Expected<uint64_t> DecodeLength(const char* header, uint64_t offset) {
+  const uint64_t length = DecodeUint64(header);
+  if (crc32c::Unmask(DecodeUint32(header + sizeof(uint64_t))) !=
+      crc32c::Value(header, sizeof(uint64_t)))
+    return MakeStringError("corrupted record length at offset ", offset);
+  return length;
+}
+
+// Returns whether the `length` bytes of record data at `data` match the
+// checksum that follows them.
+bool IsCorrupted(const char* data, uint64_t length) {
+  return crc32c::Unmask(DecodeUint32(data + length)) !=
+         crc32c::Value(data, length);
+}
+
+}  // namespace
+
+llvm::Expected<std::optional<uint64_t>> RecordReader::ReadLength(
+    uint64_t offset) const {
+  char header[kHeaderSize];
+  auto count = file_->Read(header, kHeaderSize, offset);
+  if (!count) return count.takeError();
+  if (*count == 0) return std::nullopt;
+  if (*count < kHeaderSize)
+    return MakeStringError("truncated record header at offset ", offset);
+  return DecodeLength(header, offset);
+}
+
+llvm::Expected<bool> RecordReader::ReadRecord(uint64_t* offset,
+                                              std::string* record) const {
+  auto length = ReadLength(*offset);
+  if (!length) return length.takeError();
+  if (!length->has_value()) return false;
+
+  // Read the data and the footer with one read, directly into the record.
+  const size_t size = **length + kFooterSize;
+  record->resize(size);
+  auto count = file_->Read(&(*record)[0], size, *offset + kHeaderSize);
+  if (!count) return count.takeError();
+  if (*count < size)
+    return MakeStringError("truncated record at offset ", *offset);
+
+  if (options_.verify_checksums && IsCorrupted(record->data(), **length))
+    return MakeStringError("corrupted record at offset ", *offset);
+
+  record->resize(**length);
+  *offset += kHeaderSize + size;
+  return true;
+}
+
+llvm::Expected<size_t> RecordReader::ReadRecords(
+    uint64_t* offset, MutableArrayRef<std::string> records) const {
+  for (size_t i = 0; i < records.size(); ++i) {
+    auto read = ReadRecord(offset, &records[i]);
+    if (!read) return read.takeError();
+    if (!*read) return i;
+  }
+  return records.size();
+}
+
+llvm::Error RecordReader::ReadRecordsAt(
+    ArrayRef<uint64_t> offsets, MutableArrayRef<std::string> records) const {
+  assert(offsets.size() == records.size());
+  for (size_t i = 0; i < offsets.size(); ++i) {
+    uint64_t offset = offsets[i];
+    auto read = ReadRecord(&offset, &records[i]);
+    if (!read) return read.takeError();
+    if (!*read) return MakeStringError("no record at offset ", offsets[i]);
+  }
+  return llvm::Error::success();
+}
+
+llvm::Expected<std::vector<uint64_t>> RecordReader::BuildIndex() const {
+  std::vector<uint64_t> offsets;
+  uint64_t offset = 0;
+  while (true) {
+    auto length = ReadLength(offset);
+    if (!length) return length.takeError();
+    if (!length->has_value()) return std::move(offsets);
+    offsets.push_back(offset);
+    offset += kHeaderSize + **length + kFooterSize;
+  }
+}
+
+llvm::Expected<bool> SequentialRecordReader::ReadRecord(std::string* record) {
+  char header[RecordReader::kHeaderSize];
+  auto count = stream_->Read(header, sizeof(header));
+  if (!count) return count.takeError();
+  if (*count == 0) return false;
+  if (*count < sizeof(header))
+    return MakeStringError("truncated record header at offset ", offset_);
+  auto length = DecodeLength(header, offset_);
+  if (!length) return length.takeError();
+
+  const size_t size = *length + RecordReader::kFooterSize;
+  record->resize(size);
+  count = stream_->Read(&(*record)[0], size);
+  if (!count) return count.takeError();
+  if (*count < size)
+    return MakeStringError("truncated record at offset ", offset_);
+  if (options_.verify_checksums && IsCorrupted(record->data(), *length))
+    return MakeStringError("corrupted record at offset ", offset_);
+
+  record->resize(*length);
+  offset_ += sizeof(header) + size;
+  return true;
+}
+
+llvm::Expected<size_t> SequentialRecordReader::ReadRecords(
+    MutableArrayRef<std::string> records) {
+  for (size_t i = 0; i < records.size(); ++i) {
+    auto read = ReadRecord(&records[i]);
+    if (!read) return read.takeError();
+    if (!*read) return i;
+  }
+  return records.size();
+}
+
+}  // namespace io
+}  // namespace tfrt
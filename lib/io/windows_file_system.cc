@@ -84,6 +84,36 @@ llvm::Expected<size_t> WindowsRandomAccessFile::Read(char* buf,
   }
   return actual_count;
 }
+
+// This class owns a read-only view of a file mapping.
+class WindowsReadOnlyMemoryRegion : public ReadOnlyMemoryRegion {
+ public:
+  explicit WindowsReadOnlyMemoryRegion(const void* address, size_t length,
+                                       const std::string& path)
+      : address_(address), length_(length), path_(path) {}
+
+  ~WindowsReadOnlyMemoryRegion() override;
+
+  // This class is not copyable or movable.
+  WindowsReadOnlyMemoryRegion(const WindowsReadOnlyMemoryRegion&) = delete;
+  WindowsReadOnlyMemoryRegion operator=(const WindowsReadOnlyMemoryRegion&) =
+      delete;
+
+  const void* data() const override { return address_; }
+  size_t length() const override { return length_; }
+
+ private:
+  const void* address_;
+  size_t length_;
+  const std::string path_;
+};
+
+WindowsReadOnlyMemoryRegion::~WindowsReadOnlyMemoryRegion() {
+  if (!::UnmapViewOfFile(address_)) {
+    tfrt::errs() << "failed to unmap file " << path_
+                 << " due to error: " << ::GetLastError() << "\n";
+  }
+}
 }  // namespace
 
 llvm::Error WindowsFileSystem::NewRandomAccessFile(
@@ -100,6 +130,46 @@ llvm::Error WindowsFileSystem::NewRandomAccessFile(
   return llvm::Error::success();
 }
 
+llvm::Error WindowsFileSystem::NewReadOnlyMemoryRegion(
+    const std::string& path, std::unique_ptr<ReadOnlyMemoryRegion>* region) {
+  region->reset();
+
+  HANDLE hfile = ::CreateFileA(path.c_str(), GENERIC_READ,
+                               FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+                               OPEN_EXISTING, FILE_ATTRIBUTE_READONLY, NULL);
+  if (hfile == INVALID_HANDLE_VALUE) {
+    return MakeStringError("failed to open file ", path,
+                           " due to error: ", ::GetLastError());
+  }
+
+  LARGE_INTEGER file_size;
+  if (!::GetFileSizeEx(hfile, &file_size) || file_size.QuadPart == 0) {
+    ::CloseHandle(hfile);
+    return MakeStringError("failed to map empty or unreadable file ", path);
+  }
+
+  HANDLE hmapping =
+      ::CreateFileMappingA(hfile, NULL, PAGE_READONLY, 0, 0, NULL);
+  // The mapping object keeps the file open.
+  ::CloseHandle(hfile);
+  if (hmapping == NULL) {
+    return MakeStringError("failed to create file mapping for ", path,
+                           " due to error: ", ::GetLastError());
+  }
+
+  const void* address = ::MapViewOfFile(hmapping, FILE_MAP_READ, 0, 0, 0);
+  // The view keeps the mapping object alive.
+  ::CloseHandle(hmapping);
+  if (address == NULL) {
+    return MakeStringError("failed to map file ", path,
+                           " due to error: ", ::GetLastError());
+  }
+
+  *region = std::make_unique<WindowsReadOnlyMemoryRegion>(
+      address, static_cast<size_t>(file_size.QuadPart), path);
+  return llvm::Error::success();
+}
+
 void RegisterFileSystem(FileSystemRegistry* registry) {
   auto file_system = std::make_unique<WindowsFileSystem>();
   // The scheme is an empty string to be backward-compatible with TF.
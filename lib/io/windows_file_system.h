@@ -36,6 +36,10 @@ class WindowsFileSystem : public FileSystem {
   llvm::Error NewRandomAccessFile(
       const std::string& path,
       std::unique_ptr<RandomAccessFile>* file) override;
+
+  llvm::Error NewReadOnlyMemoryRegion(
+      const std::string& path,
+      std::unique_ptr<ReadOnlyMemoryRegion>* region) override;
 };
 
 }  // namespace io
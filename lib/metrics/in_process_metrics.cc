@@ -0,0 +1,251 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements the in-process MetricsRegistry.
+
+#include "tfrt/metrics/in_process_metrics.h"
+
+#include <functional>
+#include <queue>
+#include <thread>
+#include <utility>
+
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace tfrt {
+namespace metrics {
+
+namespace {
+struct ShardPool {
+  mutex mu;
+  // The shards released by exited threads, smallest on top.
+  std::priority_queue<unsigned, std::vector<unsigned>, std::greater<unsigned>>
+      free TFRT_GUARDED_BY(mu);
+  unsigned next TFRT_GUARDED_BY(mu) = 0;
+};
+
+// Returns the shard of a thread to the pool when the thread exits. The lock
+// also makes the last updates of the thread visible to the next owner.
+struct ThreadShardReleaser {
+  ~ThreadShardReleaser();
+  unsigned shard;
+};
+}  // namespace
+
+static ShardPool& GetShardPool() {
+  static auto* pool = new ShardPool;
+  return *pool;
+}
+
+ThreadShardReleaser::~ThreadShardReleaser() {
+  ShardPool& pool = GetShardPool();
+  mutex_lock lock(pool.mu);
+  pool.free.push(shard);
+}
+
+unsigned internal::AcquireThreadShard() {
+  ShardPool& pool = GetShardPool();
+  unsigned shard;
+  {
+    mutex_lock lock(pool.mu);
+    if (pool.free.empty()) {
+      shard = pool.next++;
+    } else {
+      shard = pool.free.top();
+      pool.free.pop();
+    }
+  }
+  static thread_local ThreadShardReleaser releaser;
+  releaser.shard = shard;
+  return shard;
+}
+
+unsigned GetNumMetricShards() {
+  static const unsigned num_shards = [] {
+    const unsigned num_threads =
+        std::max(1u, std::thread::hardware_concurrency());
+    return std::min(2 * num_threads, 128u);
+  }();
+  return num_shards;
+}
+
+//===----------------------------------------------------------------------===//
+// Metrics
+//===----------------------------------------------------------------------===//
+
+ShardedCounter::ShardedCounter()
+    : num_shards_(GetNumMetricShards()), shards_(new Shard[num_shards_ + 1]) {}
+
+int64_t ShardedCounter::value() const {
+  int64_t value = 0;
+  for (unsigned i = 0; i <= num_shards_; ++i)
+    value += shards_[i].value.load(std::memory_order_relaxed);
+  return value;
+}
+
+// The number of atomic slots in a cache line.
+static constexpr size_t kSlotsPerCacheLine = 64 / sizeof(std::atomic<uint64_t>);
+
+ShardedHistogram::ShardedHistogram(const Buckets& buckets)
+    : bounds_(buckets.explicit_bounds()),
+      num_shards_(GetNumMetricShards()),
+      stride_(llvm::alignTo(kFirstBucketSlot + bounds_.size() + 1,
+                            kSlotsPerCacheLine)),
+      slots_(new std::atomic<uint64_t>[(num_shards_ + 1) * stride_]) {
+  for (size_t i = 0, e = (num_shards_ + 1) * stride_; i != e; ++i)
+    slots_[i].store(i % stride_ == kSumSlot ? ToBits(0.0) : 0,
+                    std::memory_order_relaxed);
+}
+
+HistogramSnapshot ShardedHistogram::snapshot() const {
+  HistogramSnapshot snapshot;
+  snapshot.bounds = bounds_;
+  snapshot.counts.resize(bounds_.size() + 1);
+  for (unsigned i = 0; i <= num_shards_; ++i) {
+    const std::atomic<uint64_t>* shard = &slots_[i * stride_];
+    snapshot.sum += FromBits(shard[kSumSlot].load(std::memory_order_relaxed));
+    for (size_t b = 0; b != snapshot.counts.size(); ++b) {
+      const uint64_t count =
+          shard[kFirstBucketSlot + b].load(std::memory_order_relaxed);
+      snapshot.counts[b] += count;
+      snapshot.count += count;
+    }
+  }
+  return snapshot;
+}
+
+void StringGauge::Set(std::string value) {
+  mutex_lock lock(mu_);
+  value_ = std::move(value);
+}
+
+std::string StringGauge::value() const {
+  mutex_lock lock(mu_);
+  return value_;
+}
+
+//===----------------------------------------------------------------------===//
+// InProcessMetricsRegistry
+//===----------------------------------------------------------------------===//
+
+Gauge<std::string>* InProcessMetricsRegistry::NewStringGauge(
+    std::string name) {
+  mutex_lock lock(mu_);
+  auto& gauge = string_gauges_[name];
+  if (!gauge) gauge = std::make_unique<StringGauge>();
+  return gauge.get();
+}
+
+Histogram* InProcessMetricsRegistry::NewHistogram(std::string name,
+                                                  const Buckets& buckets) {
+  mutex_lock lock(mu_);
+  auto& histogram = histograms_[name];
+  if (!histogram) histogram = std::make_unique<ShardedHistogram>(buckets);
+  return histogram.get();
+}
+
+Counter* InProcessMetricsRegistry::NewCounter(std::string name) {
+  mutex_lock lock(mu_);
+  auto& counter = counters_[name];
+  if (!counter) counter = std::make_unique<ShardedCounter>();
+  return counter.get();
+}
+
+MetricsSnapshot InProcessMetricsRegistry::Snapshot() const {
+  MetricsSnapshot snapshot;
+  mutex_lock lock(mu_);
+  for (const auto& entry : counters_)
+    snapshot.counters.emplace(entry.getKey().str(), entry.getValue()->value());
+  for (const auto& entry : string_gauges_) {
+    snapshot.string_gauges.emplace(entry.getKey().str(),
+                                   entry.getValue()->value());
+  }
+  for (const auto& entry : histograms_) {
+    snapshot.histograms.emplace(entry.getKey().str(),
+                                entry.getValue()->snapshot());
+  }
+  return snapshot;
+}
+
+// Converts `name` to match [a-zA-Z_:][a-zA-Z0-9_:]*.
+static std::string GetPrometheusName(string_view name) {
+  name.consume_front("/");
+  std::string result;
+  result.reserve(name.size() + 1);
+  if (name.empty() || llvm::isDigit(name.front())) result.push_back('_');
+  for (char c : name)
+    result.push_back(llvm::isAlnum(c) || c == ':' ? c : '_');
+  return result;
+}
+
+static void WriteLabelValue(raw_ostream& os, string_view value) {
+  os << '"';
+  for (char c : value) {
+    if (c == '\\' || c == '"') {
+      os << '\\' << c;
+    } else if (c == '\n') {
+      os << "\\n";
+    } else {
+      os << c;
+    }
+  }
+  os << '"';
+}
+
+// Writes `value` with enough digits to read it back exactly.
+static void WriteValue(raw_ostream& os, double value) {
+  os << llvm::format("%.17g", value);
+}
+
+void InProcessMetricsRegistry::WritePrometheusText(raw_ostream& os) const {
+  const MetricsSnapshot snapshot = Snapshot();
+
+  for (const auto& [name, value] : snapshot.counters) {
+    const std::string prometheus_name = GetPrometheusName(name);
+    os << "# TYPE " << prometheus_name << " counter\n"
+       << prometheus_name << ' ' << value << '\n';
+  }
+
+  for (const auto& [name, value] : snapshot.string_gauges) {
+    const std::string prometheus_name = GetPrometheusName(name);
+    os << "# TYPE " << prometheus_name << " gauge\n"
+       << prometheus_name << "{value=";
+    WriteLabelValue(os, value);
+    os << "} 1\n";
+  }
+
+  for (const auto& [name, histogram] : snapshot.histograms) {
+    const std::string prometheus_name = GetPrometheusName(name);
+    os << "# TYPE " << prometheus_name << " histogram\n";
+    // Prometheus buckets are cumulative, and the underflow bucket is counted
+    // in the first one.
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i != histogram.bounds.size(); ++i) {
+      cumulative += histogram.counts[i];
+      os << prometheus_name << "_bucket{le=\"";
+      WriteValue(os, histogram.bounds[i]);
+      os << "\"} " << cumulative << '\n';
+    }
+    os << prometheus_name << "_bucket{le=\"+Inf\"} " << histogram.count << '\n'
+       << prometheus_name << "_sum ";
+    WriteValue(os, histogram.sum);
+    os << '\n' << prometheus_name << "_count " << histogram.count << '\n';
+  }
+}
+
+}  // namespace metrics
+}  // namespace tfrt
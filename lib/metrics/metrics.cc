@@ -40,6 +40,14 @@ class DummyHistogram : public Histogram {
   void Record(double value) override {}
 };
 
+// A dummy implementation of the Counter metric interface.
+class DummyCounter : public Counter {
+ public:
+  DummyCounter() {}
+
+  void IncrementBy(int64_t value) override {}
+};
+
 template <>
 Gauge<std::string>* NewGauge(std::string name) {
   if (internal::kMetricsRegistry != nullptr)
@@ -47,6 +55,14 @@ Gauge<std::string>* NewGauge(std::string name) {
   return new DummyGauge<std::string>();
 }
 
+Counter* NewCounter(std::string name) {
+  if (internal::kMetricsRegistry != nullptr) {
+    if (auto* counter = internal::kMetricsRegistry->NewCounter(name))
+      return counter;
+  }
+  return new DummyCounter();
+}
+
 Histogram* NewHistogram(std::string name, const Buckets& buckets) {
   if (internal::kMetricsRegistry != nullptr)
     return internal::kMetricsRegistry->NewHistogram(name, buckets);
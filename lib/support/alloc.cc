@@ -18,6 +18,7 @@
 #include "tfrt/support/alloc.h"
 
 #include <cstdlib>
+#include <cstring>
 
 namespace tfrt {
 
@@ -42,6 +43,20 @@ void* AlignedAlloc(size_t alignment, size_t size) {
 #endif
 }
 
+void* AlignedZeroedAlloc(size_t alignment, size_t size) {
+#if !defined(_WIN32)
+  // calloc returns memory aligned to at least alignof(std::max_align_t), and
+  // its memory may be freed with free() like the memory of AlignedAlloc().
+  if (alignment <= alignof(std::max_align_t)) {
+    size = (size + alignment - 1) / alignment * alignment;
+    return std::calloc(1, size);
+  }
+#endif
+  void* ptr = AlignedAlloc(alignment, size);
+  if (ptr != nullptr) std::memset(ptr, 0, size);
+  return ptr;
+}
+
 void AlignedFree(void* ptr) {
 #ifdef _WIN32
   // _aligned_alloc() must be paired with _aligned_free().
@@ -16,17 +16,251 @@
 
 #include "tfrt/support/logging.h"
 
+#include <atomic>
 #include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <sstream>
+#include <string>
 #include <thread>
+#include <utility>
+#include <vector>
 
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/Format.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
 
 namespace tfrt {
+namespace {
+
+// The lines logged by one thread and not yet written to stderr. The buffer is
+// shared with the logger, so that the lines of exited threads are written.
+struct ThreadBuffer {
+  mutex mu;
+  std::string lines TFRT_GUARDED_BY(mu);
+  bool exited TFRT_GUARDED_BY(mu) = false;
+};
+
+class AsyncLogger {
+ public:
+  explicit AsyncLogger(const AsyncLoggingOptions& options);
+
+  // Buffers `line` logged at the call site `fname`:`line_number`.
+  void Write(llvm::StringRef line, const char* fname, int line_number,
+             Severity severity);
+
+  // Writes the buffered lines of all threads to stderr.
+  void Flush();
+
+  // Flushes and stops the background thread. Called at exit.
+  void Shutdown();
+
+ private:
+  // Rate limit of the call sites that hash to one slot.
+  struct RateLimitSlot {
+    std::atomic<int64_t> second{-1};
+    std::atomic<int> count{0};
+  };
+  static constexpr size_t kNumRateLimitSlots = 1024;
+
+  // Returns true if a line of the call site may be logged now.
+  bool Admit(const char* fname, int line_number);
+
+  ThreadBuffer* GetThreadBuffer();
+
+  void FlushLoop();
+
+  const AsyncLoggingOptions options_;
+  RateLimitSlot rate_limits_[kNumRateLimitSlots];
+  std::atomic<uint64_t> num_suppressed_{0};
+  std::atomic<uint64_t> num_dropped_{0};
+
+  mutex buffers_mu_;
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers_
+      TFRT_GUARDED_BY(buffers_mu_);
+
+  // Serializes the writes to stderr, so that the lines of one thread are
+  // written in order.
+  mutex write_mu_;
+  bool shutdown_ TFRT_GUARDED_BY(write_mu_) = false;
+
+  mutex wakeup_mu_;
+  condition_variable wakeup_;
+  bool wakeup_requested_ TFRT_GUARDED_BY(wakeup_mu_) = false;
+};
+
+AsyncLogger::AsyncLogger(const AsyncLoggingOptions& options)
+    : options_(options) {
+  // The flusher thread is never joined, the logger is leaked and flushed at
+  // exit instead.
+  std::thread([this] { FlushLoop(); }).detach();
+}
+
+bool AsyncLogger::Admit(const char* fname, int line_number) {
+  if (options_.max_lines_per_second_per_site <= 0) return true;
+
+  // Call sites are identified by the address of their file name literal. Sites
+  // that collide share a limit.
+  size_t hash = std::hash<const void*>()(fname) * 31 + line_number;
+  RateLimitSlot& slot = rate_limits_[hash % kNumRateLimitSlots];
+
+  int64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+                    std::chrono::steady_clock::now().time_since_epoch())
+                    .count();
+  int64_t second = slot.second.load(std::memory_order_relaxed);
+  if (second != now &&
+      slot.second.compare_exchange_strong(second, now,
+                                          std::memory_order_relaxed))
+    slot.count.store(0, std::memory_order_relaxed);
+
+  return slot.count.fetch_add(1, std::memory_order_relaxed) <
+         options_.max_lines_per_second_per_site;
+}
+
+ThreadBuffer* AsyncLogger::GetThreadBuffer() {
+  // Marks the buffer of the thread as exited when the thread exits. The
+  // buffer is released by the logger once it is flushed.
+  struct Holder {
+    ~Holder() {
+      if (!buffer) return;
+      mutex_lock lock(buffer->mu);
+      buffer->exited = true;
+    }
+    std::shared_ptr<ThreadBuffer> buffer;
+  };
+  thread_local Holder holder;
+
+  if (!holder.buffer) {
+    holder.buffer = std::make_shared<ThreadBuffer>();
+    mutex_lock lock(buffers_mu_);
+    buffers_.push_back(holder.buffer);
+  }
+  return holder.buffer.get();
+}
+
+void AsyncLogger::Write(llvm::StringRef line, const char* fname,
+                        int line_number, Severity severity) {
+  if (severity != Severity::FATAL && !Admit(fname, line_number)) {
+    num_suppressed_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  ThreadBuffer* buffer = GetThreadBuffer();
+  bool request_flush;
+  {
+    mutex_lock lock(buffer->mu);
+    size_t size = buffer->lines.size() + line.size();
+    if (size > options_.max_buffered_bytes_per_thread &&
+        severity != Severity::FATAL) {
+      num_dropped_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    buffer->lines.append(line.data(), line.size());
+    request_flush = size > options_.max_buffered_bytes_per_thread / 2;
+  }
+
+  // Flush early rather than drop lines of a thread that logs a lot.
+  if (request_flush) {
+    mutex_lock lock(wakeup_mu_);
+    wakeup_requested_ = true;
+    wakeup_.notify_one();
+  }
+}
+
+void AsyncLogger::Flush() {
+  mutex_lock write_lock(write_mu_);
+  if (shutdown_) return;
+
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+  {
+    mutex_lock lock(buffers_mu_);
+    buffers = buffers_;
+  }
+
+  std::string lines;
+  bool has_exited = false;
+  for (const auto& buffer : buffers) {
+    mutex_lock lock(buffer->mu);
+    if (lines.empty()) {
+      lines.swap(buffer->lines);
+    } else {
+      lines.append(buffer->lines);
+      buffer->lines.clear();
+    }
+    has_exited |= buffer->exited;
+  }
+
+  if (has_exited) {
+    mutex_lock lock(buffers_mu_);
+    llvm::erase_if(buffers_, [](const std::shared_ptr<ThreadBuffer>& buffer) {
+      mutex_lock lock(buffer->mu);
+      return buffer->exited && buffer->lines.empty();
+    });
+  }
+
+  if (uint64_t n = num_suppressed_.exchange(0, std::memory_order_relaxed))
+    lines += "W Suppressed " + std::to_string(n) +
+             " log lines over the per call site rate limit\n";
+  if (uint64_t n = num_dropped_.exchange(0, std::memory_order_relaxed))
+    lines += "W Dropped " + std::to_string(n) +
+             " log lines over the per thread buffer limit\n";
+
+  llvm::errs().write(lines.data(), lines.size());
+}
+
+void AsyncLogger::Shutdown() {
+  Flush();
+  mutex_lock lock(write_mu_);
+  shutdown_ = true;
+}
+
+void AsyncLogger::FlushLoop() {
+  while (true) {
+    {
+      mutex_lock lock(wakeup_mu_);
+      wakeup_.wait_until(
+          lock, std::chrono::steady_clock::now() + options_.flush_interval,
+          [this]() TFRT_REQUIRES(wakeup_mu_) { return wakeup_requested_; });
+      wakeup_requested_ = false;
+    }
+    Flush();
+
+    mutex_lock lock(write_mu_);
+    if (shutdown_) return;
+  }
+}
+
+std::atomic<AsyncLogger*> async_logger{nullptr};
+
+}  // namespace
+
+void EnableAsyncLogging(const AsyncLoggingOptions& options) {
+  static std::once_flag enable_once;
+  std::call_once(enable_once, [&]() {
+    // Make sure stderr outlives the logger, which is flushed by the exit
+    // handler registered after it.
+    llvm::errs();
+    async_logger.store(new AsyncLogger(options), std::memory_order_release);
+    std::atexit([] { async_logger.load()->Shutdown(); });
+  });
+}
+
+void FlushLogs() {
+  if (auto* logger = async_logger.load(std::memory_order_acquire))
+    logger->Flush();
+}
+
 namespace internal {
 
 LogStream::LogStream(const char* fname, int line, Severity severity)
-    : severity_(severity) {
+    : fname_(fname), line_(line), severity_(severity) {
+  // The line is written to buffer_, and emitted at once by the destructor.
+  SetUnbuffered();
+
   uint64_t now_usec = std::chrono::duration_cast<std::chrono::microseconds>(
                           std::chrono::system_clock::now().time_since_epoch())
                           .count();
@@ -35,8 +269,14 @@ LogStream::LogStream(const char* fname, int line, Severity severity)
   int32_t remainder_usec = static_cast<int32_t>(now_usec % kUsecPerSec);
   static constexpr size_t kTimeBufferSize = 30;
   char time_buffer[kTimeBufferSize];
-  strftime(time_buffer, kTimeBufferSize, "%Y-%m-%d %H:%M:%S",
-           localtime(&now_sec));
+  // localtime() is not thread-safe, and lines are logged concurrently.
+  struct tm now_tm;
+#ifdef _WIN32
+  localtime_s(&now_tm, &now_sec);
+#else
+  localtime_r(&now_sec, &now_tm);
+#endif
+  strftime(time_buffer, kTimeBufferSize, "%Y-%m-%d %H:%M:%S", &now_tm);
 
   std::ostringstream tid_oss;
   tid_oss << std::this_thread::get_id();
@@ -50,16 +290,20 @@ LogStream::LogStream(const char* fname, int line, Severity severity)
 
 LogStream::~LogStream() {
   *this << "\n";
-  flush();
+  if (auto* logger = async_logger.load(std::memory_order_acquire)) {
+    logger->Write(buffer_, fname_, line_, severity_);
+    if (severity_ == Severity::FATAL) logger->Flush();
+  } else {
+    llvm::errs().write(buffer_.data(), buffer_.size());
+  }
   if (severity_ == Severity::FATAL) abort();
 }
 
 void LogStream::write_impl(const char* ptr, size_t size) {
-  llvm::errs().write(ptr, size);
-  pos_ += size;
+  buffer_.append(ptr, ptr + size);
 }
 
-uint64_t LogStream::current_pos() const { return pos_; }
+uint64_t LogStream::current_pos() const { return buffer_.size(); }
 
 LogStreamFatal::LogStreamFatal(const char* file, int line)
     : LogStream(file, line, Severity::FATAL) {}
@@ -44,6 +44,8 @@ DType ToDTypeKind(TensorDType type) {
       return DType::UI32;
     case TensorDType::kUInt64:
       return DType::UI64;
+    case TensorDType::kQInt8:
+      return DType::QI8;
   }
 }
 
@@ -69,6 +71,8 @@ Expected<TensorDType> ToTensorDType(DType type) {
       return TensorDType::kUInt32;
     case DType::UI64:
       return TensorDType::kUInt64;
+    case DType::QI8:
+      return TensorDType::kQInt8;
     default:
       return MakeStringError("failed to cast DType to TensorDType");
   }
@@ -96,6 +100,8 @@ raw_ostream& operator<<(raw_ostream& os, const TensorDType& dtype) {
       return os << "ui32";
     case TensorDType::kUInt64:
       return os << "ui64";
+    case TensorDType::kQInt8:
+      return os << "qi8";
   }
   return os << "BadDtype(" << static_cast<uint64_t>(dtype) << ')';
 }
@@ -0,0 +1,118 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements MappedBTFFile.
+
+#include "tfrt/tensor/btf_mapped_file.h"
+
+#include <cstring>
+
+#include "llvm/ADT/SmallVector.h"
+#include "tfrt/host_context/host_buffer.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/support/string_util.h"
+#include "tfrt/tensor/btf.h"
+#include "tfrt/tensor/tensor_shape.h"
+
+namespace tfrt {
+
+Expected<RCReference<MappedBTFFile>> MappedBTFFile::Open(string_view path) {
+  io::FileSystem* file_system =
+      io::FileSystemRegistry::Default()->LookupForPath(path);
+  if (file_system == nullptr)
+    return MakeStringError("no file system registered for BTF file ", path);
+
+  std::unique_ptr<io::ReadOnlyMemoryRegion> region;
+  if (auto error =
+          file_system->NewReadOnlyMemoryRegion(std::string(path), &region))
+    return std::move(error);
+
+  // The mapping is page aligned, so the offset table is aligned too.
+  const auto* data = static_cast<const uint8_t*>(region->data());
+  const size_t length = region->length();
+  if (length < sizeof(uint64_t))
+    return MakeStringError("failed to read num_tensors from BTF file ", path);
+
+  uint64_t num_tensors;
+  std::memcpy(&num_tensors, data, sizeof(uint64_t));
+  if (num_tensors > length / sizeof(uint64_t) - 1)
+    return MakeStringError("failed to read tensor record offsets from BTF "
+                           "file ",
+                           path);
+
+  ArrayRef<uint64_t> offsets(
+      reinterpret_cast<const uint64_t*>(data + sizeof(uint64_t)),
+      num_tensors);
+  for (uint64_t offset : offsets) {
+    if (offset > length || length - offset < sizeof(btf::TensorHeader))
+      return MakeStringError("invalid tensor record offset ", offset,
+                             " in BTF file ", path);
+  }
+
+  return TakeRef(new MappedBTFFile(std::string(path), std::move(region),
+                                   offsets));
+}
+
+Expected<DenseHostTensor> MappedBTFFile::GetDenseHostTensor(
+    size_t index, HostContext* host) const {
+  if (index >= num_tensors())
+    return MakeStringError("invalid tensor index ", index, " in BTF file ",
+                           path_, " which contains ", num_tensors(),
+                           " tensors");
+
+  // Open() checked that the header is within the mapping.
+  const uint64_t offset = offsets_[index];
+  const size_t length = region_->length();
+  btf::TensorHeader header;
+  std::memcpy(&header, data() + offset, sizeof(header));
+
+  if (header.layout != btf::TensorLayout::kRMD)
+    return MakeStringError("unexpected tensor layout ", header.layout);
+  if (header.dtype > btf::TensorDType::kUInt64)
+    return MakeStringError("unexpected tensor dtype ",
+                           static_cast<int>(header.dtype));
+
+  const size_t dims_offset = offset + sizeof(btf::TensorHeader);
+  if (header.rank > (length - dims_offset) / sizeof(uint64_t))
+    return MakeStringError("failed to read tensor dims at offset ", offset);
+  llvm::SmallVector<Index, 4> dims;
+  dims.resize(header.rank);
+  std::memcpy(dims.data(), data() + dims_offset, header.rank * sizeof(Index));
+
+  const TensorMetadata metadata(DType(btf::ToDTypeKind(header.dtype)),
+                                TensorShape(dims));
+  const size_t data_offset = dims_offset + header.rank * sizeof(uint64_t);
+  const size_t nbytes = metadata.GetHostSizeInBytes();
+  if (nbytes > length - data_offset)
+    return MakeStringError("failed to read tensor data at offset ", offset);
+
+  const uint8_t* tensor_data = data() + data_offset;
+  if (reinterpret_cast<uintptr_t>(tensor_data) %
+          GetHostAlignment(metadata.dtype) !=
+      0) {
+    auto dht = DenseHostTensor::CreateUninitialized(metadata, host);
+    if (!dht) return MakeStringError("cannot allocate result tensor");
+    std::memcpy(dht->data(), tensor_data, nbytes);
+    return std::move(*dht);
+  }
+
+  // The buffer keeps this file, and so the mapping, alive.
+  auto buffer = HostBuffer::CreateFromExternal(
+      const_cast<uint8_t*>(tensor_data), nbytes,
+      [file = FormRef(const_cast<MappedBTFFile*>(this))](void*, size_t) {});
+  return DenseHostTensor(metadata, std::move(buffer));
+}
+
+}  // namespace tfrt
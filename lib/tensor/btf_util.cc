@@ -16,8 +16,15 @@
 
 #include "tfrt/tensor/btf_util.h"
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
 #include <iostream>
 
+#include "tfrt/io/buffered_input_stream.h"
+#include "tfrt/io/file_system.h"
+#include "tfrt/support/crc32c.h"
+
 namespace tfrt {
 namespace {
 
@@ -29,6 +36,33 @@ size_t Pad(size_t n) {
   return kBtfAlignment - remainder;
 }
 
+// Returns the size of the checksum section for `num_tensors` tensors.
+size_t ChecksumSectionSize(size_t num_tensors) {
+  const size_t size = sizeof(uint64_t) + num_tensors * sizeof(uint32_t);
+  return size + Pad(size);
+}
+
+// Reads exactly `n` elements of type T from `stream`.
+template <typename T>
+Error ReadInputStream(io::InputStream* stream, T* value, size_t n = 1) {
+  const size_t size = n * sizeof(T);
+  auto count = stream->Read(reinterpret_cast<char*>(value), size);
+  if (!count) return count.takeError();
+  if (*count != size) return MakeStringError("unexpected end of stream");
+  return Error::success();
+}
+
+// Reads exactly `n` elements of type T from `file` at `offset`.
+template <typename T>
+Error ReadFile(const io::RandomAccessFile& file, uint64_t offset, T* value,
+               size_t n = 1) {
+  const size_t size = n * sizeof(T);
+  auto count = file.Read(reinterpret_cast<char*>(value), size, offset);
+  if (!count) return count.takeError();
+  if (*count != size) return MakeStringError("unexpected end of file");
+  return Error::success();
+}
+
 Error WriteDHTToBTF(std::ostream* stream, const DenseHostTensor& dht) {
   std::vector<uint64_t> dims;
   dims.reserve(dht.shape().GetRank());
@@ -98,6 +132,190 @@ Expected<DenseHostTensor> ReadDHTFromBTF(std::istream* stream, uint64_t offset,
   return std::move(dht);
 }
 
+Expected<std::vector<uint64_t>> ReadBTFOffsets(
+    const io::RandomAccessFile& file) {
+  uint64_t num_tensors;
+  if (auto error = ReadFile(file, 0, &num_tensors)) {
+    return MakeStringError("failed to read num_tensors: ",
+                           toString(std::move(error)));
+  }
+  std::vector<uint64_t> offsets;
+  offsets.resize(num_tensors);
+  if (auto error =
+          ReadFile(file, sizeof(uint64_t), offsets.data(), num_tensors)) {
+    return MakeStringError("failed to read tensor record offsets: ",
+                           toString(std::move(error)));
+  }
+  return offsets;
+}
+
+Expected<DenseHostTensor> ReadDHTFromBTF(const io::RandomAccessFile& file,
+                                         uint64_t offset, HostContext* host) {
+  btf::TensorHeader header;
+  if (auto error = ReadFile(file, offset, &header)) {
+    return MakeStringError("failed to read tensor header at offset ", offset,
+                           ": ", toString(std::move(error)));
+  }
+  if (header.layout != btf::TensorLayout::kRMD) {
+    return MakeStringError("unexpected tensor layout ", header.layout);
+  }
+  const uint64_t dims_offset = offset + sizeof(btf::TensorHeader);
+  llvm::SmallVector<Index, 4> dims;
+  dims.resize(header.rank);
+  if (auto error = ReadFile(file, dims_offset, dims.data(), header.rank)) {
+    return MakeStringError("failed to read tensor dims at offset ", offset,
+                           ": ", toString(std::move(error)));
+  }
+  const TensorMetadata metadata(DType(ToDTypeKind(header.dtype)),
+                                TensorShape(dims));
+  auto dht = DenseHostTensor::CreateUninitialized(metadata, host);
+  if (!dht.has_value()) {
+    return MakeStringError("cannot allocate result tensor");
+  }
+  const uint64_t data_offset = dims_offset + header.rank * sizeof(uint64_t);
+  if (auto error = ReadFile(file, data_offset,
+                            reinterpret_cast<uint8_t*>(dht->data()),
+                            dht->DataSizeInBytes())) {
+    return MakeStringError("failed to read tensor data at offset ", offset,
+                           ": ", toString(std::move(error)));
+  }
+  return std::move(*dht);
+}
+
+Expected<DenseHostTensor> ReadDHTFromBTF(io::BufferedInputStream* stream,
+                                         HostContext* host) {
+  btf::TensorHeader header;
+  if (auto error = ReadInputStream(stream, &header)) {
+    return MakeStringError("failed to read tensor header: ",
+                           toString(std::move(error)));
+  }
+  if (header.layout != btf::TensorLayout::kRMD) {
+    return MakeStringError("unexpected tensor layout ", header.layout);
+  }
+  llvm::SmallVector<Index, 4> dims;
+  dims.resize(header.rank);
+  if (auto error = ReadInputStream(stream, dims.data(), header.rank)) {
+    return MakeStringError("failed to read tensor dims: ",
+                           toString(std::move(error)));
+  }
+  const TensorMetadata metadata(DType(ToDTypeKind(header.dtype)),
+                                TensorShape(dims));
+
+  const size_t nbytes = metadata.GetHostSizeInBytes();
+  auto data = stream->ReadChunk(
+      nbytes,
+      std::max(GetHostAlignment(metadata.dtype), alignof(std::max_align_t)));
+  if (!data) return data.takeError();
+  if ((*data)->size() != nbytes) {
+    return MakeStringError("failed to read tensor data: unexpected end of "
+                           "stream");
+  }
+
+  // Skip the padding of the tensor data.
+  std::array<uint8_t, kBtfAlignment> padding;
+  if (auto error = ReadInputStream(stream, padding.data(), Pad(nbytes))) {
+    return MakeStringError("failed to read tensor padding: ",
+                           toString(std::move(error)));
+  }
+
+  return DenseHostTensor(metadata, std::move(*data));
+}
+
+Error WriteTensorsToBTF(io::WritableFile* file,
+                        ArrayRef<const DenseHostTensor*> tensors) {
+  static constexpr std::array<char, 7> kPadValue{0, 0, 0, 0, 0, 0, 0};
+  const uint64_t num_tensors = tensors.size();
+
+  // The file header holds the offsets and checksums of all tensors, so the
+  // records are sized and checksummed before any of them is written.
+  std::vector<uint64_t> offsets;
+  offsets.reserve(num_tensors);
+  std::vector<uint32_t> checksums;
+  checksums.reserve(num_tensors);
+  uint64_t offset =
+      (1 + num_tensors) * sizeof(uint64_t) + ChecksumSectionSize(num_tensors);
+  for (const DenseHostTensor* dht : tensors) {
+    offsets.push_back(offset);
+    checksums.push_back(ComputeBTFChecksum(*dht));
+    const size_t nbytes = dht->DataSizeInBytes();
+    offset += sizeof(btf::TensorHeader) +
+              dht->shape().GetRank() * sizeof(uint64_t) + nbytes + Pad(nbytes);
+  }
+
+  const uint64_t magic = btf::kChecksumMagic;
+  const size_t checksums_size = num_tensors * sizeof(uint32_t);
+  auto as_chunk = [](const void* data, size_t size) {
+    return string_view(static_cast<const char*>(data), size);
+  };
+  if (auto error = file->Append(
+          {as_chunk(&num_tensors, sizeof(num_tensors)),
+           as_chunk(offsets.data(), offsets.size() * sizeof(uint64_t)),
+           as_chunk(&magic, sizeof(magic)),
+           as_chunk(checksums.data(), checksums_size),
+           as_chunk(kPadValue.data(), Pad(sizeof(magic) + checksums_size))})) {
+    return MakeStringError("failed to write BTF header: ",
+                           toString(std::move(error)));
+  }
+
+  for (const DenseHostTensor* dht : tensors) {
+    auto dtype_or = btf::ToTensorDType(dht->dtype());
+    if (!dtype_or) return dtype_or.takeError();
+    btf::TensorHeader header{};
+    header.rank = static_cast<uint64_t>(dht->shape().GetRank());
+    header.dtype = *dtype_or;
+    header.layout = btf::TensorLayout::kRMD;
+
+    llvm::SmallVector<uint64_t, 4> dims;
+    for (int i = 0; i < dht->shape().GetRank(); i++)
+      dims.push_back(dht->shape().GetDimensionSize(i));
+
+    const size_t nbytes = dht->DataSizeInBytes();
+    if (auto error = file->Append(
+            {as_chunk(&header, sizeof(header)),
+             as_chunk(dims.data(), dims.size() * sizeof(uint64_t)),
+             as_chunk(dht->data(), nbytes),
+             as_chunk(kPadValue.data(), Pad(nbytes))})) {
+      return MakeStringError("failed to write tensor record: ",
+                             toString(std::move(error)));
+    }
+  }
+  return Error::success();
+}
+
+Expected<std::vector<uint32_t>> ReadBTFChecksums(
+    const io::RandomAccessFile& file, ArrayRef<uint64_t> offsets) {
+  const uint64_t section_offset = (1 + offsets.size()) * sizeof(uint64_t);
+  const uint64_t section_end =
+      section_offset + ChecksumSectionSize(offsets.size());
+
+  // Files without a checksum section may have their first record right after
+  // the offsets.
+  std::vector<uint32_t> checksums;
+  if (offsets.empty() ||
+      *std::min_element(offsets.begin(), offsets.end()) < section_end)
+    return checksums;
+
+  uint64_t magic;
+  if (auto error = ReadFile(file, section_offset, &magic)) {
+    return MakeStringError("failed to read checksum magic: ",
+                           toString(std::move(error)));
+  }
+  if (magic != btf::kChecksumMagic) return checksums;
+
+  checksums.resize(offsets.size());
+  if (auto error = ReadFile(file, section_offset + sizeof(magic),
+                            checksums.data(), checksums.size())) {
+    return MakeStringError("failed to read tensor checksums: ",
+                           toString(std::move(error)));
+  }
+  return checksums;
+}
+
+uint32_t ComputeBTFChecksum(const DenseHostTensor& dht) {
+  return crc32c::Mask(crc32c::Value(static_cast<const char*>(dht.data()),
+                                    dht.DataSizeInBytes()));
+}
+
 Error WriteTensorsToBTF(std::ostream* stream, ArrayRef<const Tensor*> tensors) {
   const uint64_t num_tensors = tensors.size();
   if (!WriteStream(stream, &num_tensors, 1)) {
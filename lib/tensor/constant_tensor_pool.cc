@@ -0,0 +1,143 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements ConstantTensorPool.
+
+#include "tfrt/tensor/constant_tensor_pool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <utility>
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/xxhash.h"
+#include "tfrt/support/alloc.h"
+
+namespace tfrt {
+
+static void* CopyAligned(ArrayRef<uint8_t> data, size_t alignment) {
+  // AlignedAlloc requires a multiple of the alignment.
+  size_t allocated_size = (data.size() + alignment - 1) / alignment * alignment;
+  void* ptr = AlignedAlloc(alignment, std::max(allocated_size, alignment));
+  if (ptr != nullptr) std::memcpy(ptr, data.data(), data.size());
+  return ptr;
+}
+
+ConstantTensorPool::~ConstantTensorPool() {
+  mutex_lock lock(mu_);
+  assert(entries_.empty() && "ConstantTensorPool destroyed while in use");
+}
+
+ConstantTensorPool* ConstantTensorPool::Global() {
+  // Never destroyed, so that constants may outlive static destructors.
+  static ConstantTensorPool* pool = new ConstantTensorPool();
+  return pool;
+}
+
+RCReference<HostBuffer> ConstantTensorPool::GetOrCreate(ArrayRef<uint8_t> data,
+                                                        size_t alignment) {
+  if (data.size() < min_pooled_size_) {
+    void* ptr = CopyAligned(data, alignment);
+    if (ptr == nullptr) return {};
+    return HostBuffer::CreateFromExternal(
+        ptr, data.size(), [](void* ptr, size_t) { AlignedFree(ptr); });
+  }
+
+  // Hash and copy outside of the lock, so that constants are materialized in
+  // parallel.
+  const uint64_t hash = llvm::xxHash64(
+      llvm::StringRef(reinterpret_cast<const char*>(data.data()), data.size()));
+  {
+    mutex_lock lock(mu_);
+    if (Entry* entry = Find(hash, data, alignment)) {
+      stats_.saved_bytes += data.size();
+      return MakeBuffer(entry);
+    }
+  }
+
+  void* ptr = CopyAligned(data, alignment);
+  if (ptr == nullptr) return {};
+
+  mutex_lock lock(mu_);
+  // Another thread may have pooled the same constant in the meantime.
+  if (Entry* entry = Find(hash, data, alignment)) {
+    AlignedFree(ptr);
+    stats_.saved_bytes += data.size();
+    return MakeBuffer(entry);
+  }
+  auto& bucket = entries_[hash];
+  bucket.push_back(std::make_unique<Entry>(Entry{hash, ptr, data.size(), 0}));
+  ++stats_.num_entries;
+  stats_.pooled_bytes += data.size();
+  return MakeBuffer(bucket.back().get());
+}
+
+std::optional<DenseHostTensor> ConstantTensorPool::GetOrCreateDenseHostTensor(
+    const TensorMetadata& metadata, ArrayRef<uint8_t> data) {
+  assert(data.size() ==
+         GetHostSize(metadata.dtype) * metadata.shape.GetNumElements());
+  auto buffer =
+      GetOrCreate(data, DenseHostTensor::GetBufferAlignment(metadata.dtype));
+  if (!buffer) return std::nullopt;
+  return DenseHostTensor(metadata, std::move(buffer));
+}
+
+ConstantTensorPool::Stats ConstantTensorPool::GetStats() const {
+  mutex_lock lock(mu_);
+  return stats_;
+}
+
+RCReference<HostBuffer> ConstantTensorPool::MakeBuffer(Entry* entry) {
+  ++entry->num_buffers;
+  // Every tensor gets a buffer of its own that refers to the pooled data, so
+  // that the entry is released by the pool with the last of them.
+  return HostBuffer::CreateFromExternal(
+      entry->data, entry->size,
+      [this, entry](void*, size_t) { ReleaseBuffer(entry); });
+}
+
+void ConstantTensorPool::ReleaseBuffer(Entry* entry) {
+  mutex_lock lock(mu_);
+  if (--entry->num_buffers > 0) return;
+
+  auto iter = entries_.find(entry->hash);
+  assert(iter != entries_.end());
+  auto& bucket = iter->second;
+  --stats_.num_entries;
+  stats_.pooled_bytes -= entry->size;
+  AlignedFree(entry->data);
+  bucket.erase(std::find_if(bucket.begin(), bucket.end(),
+                            [entry](const std::unique_ptr<Entry>& candidate) {
+                              return candidate.get() == entry;
+                            }));
+  if (bucket.empty()) entries_.erase(iter);
+}
+
+ConstantTensorPool::Entry* ConstantTensorPool::Find(uint64_t hash,
+                                                    ArrayRef<uint8_t> data,
+                                                    size_t alignment) {
+  auto iter = entries_.find(hash);
+  if (iter == entries_.end()) return nullptr;
+  for (const std::unique_ptr<Entry>& entry : iter->second) {
+    if (entry->size == data.size() &&
+        reinterpret_cast<uintptr_t>(entry->data) % alignment == 0 &&
+        std::memcmp(entry->data, data.data(), data.size()) == 0) {
+      return entry.get();
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace tfrt
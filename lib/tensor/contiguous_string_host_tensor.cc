@@ -0,0 +1,133 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file implements ContiguousStringHostTensor.
+
+#include "tfrt/tensor/contiguous_string_host_tensor.h"
+
+#include <algorithm>
+#include <cstring>
+#include <optional>
+#include <utility>
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/raw_ostream.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/tensor/conversion_registry.h"
+#include "tfrt/tensor/conversion_utils.h"
+#include "tfrt/tensor/string_host_tensor.h"
+
+namespace tfrt {
+
+std::optional<ContiguousStringHostTensor> ContiguousStringHostTensor::Create(
+    const TensorShape& shape, ArrayRef<string_view> strings,
+    HostContext* host) {
+  assert(strings.size() == shape.GetNumElements());
+  auto offsets = HostBuffer::CreateUninitialized(
+      (strings.size() + 1) * sizeof(uint64_t), alignof(uint64_t),
+      host->allocator());
+  if (!offsets) return std::nullopt;
+
+  auto* offsets_data = static_cast<uint64_t*>(offsets->data());
+  uint64_t size = 0;
+  for (size_t i = 0; i < strings.size(); ++i) {
+    offsets_data[i] = size;
+    size += strings[i].size();
+  }
+  offsets_data[strings.size()] = size;
+
+  // Keep the bytes buffer non-empty, so that its data pointer is valid.
+  auto bytes = HostBuffer::CreateUninitialized(
+      std::max<uint64_t>(size, 1), alignof(char), host->allocator());
+  if (!bytes) return std::nullopt;
+  auto* bytes_data = static_cast<char*>(bytes->data());
+  for (size_t i = 0; i < strings.size(); ++i) {
+    if (!strings[i].empty())
+      std::memcpy(bytes_data + offsets_data[i], strings[i].data(),
+                  strings[i].size());
+  }
+
+  return ContiguousStringHostTensor(shape, std::move(bytes),
+                                    std::move(offsets));
+}
+
+void ContiguousStringHostTensor::Print(raw_ostream& os) const {
+  const auto& shape = this->shape();
+  os << "ContiguousStringHostTensor shape = " << shape;
+
+  static constexpr size_t kThreshold = 16;
+
+  os << ", values = [";
+  const size_t num_elements = NumElements();
+  for (size_t i = 0, e = std::min(kThreshold, num_elements); i != e; ++i) {
+    if (i != 0) os << ", ";
+    os << '"' << GetString(i) << '"';
+  }
+
+  if (num_elements > kThreshold) {
+    os << ", ... ";
+  }
+
+  os << ']';
+}
+
+static AsyncValueRef<ContiguousStringHostTensor>
+ConvertStringHostTensorToContiguousStringHostTensor(
+    const StringHostTensor& tensor, const CpuDevice& src, const CpuDevice& dst,
+    const ExecutionContext& exec_ctx) {
+  auto strings = tensor.strings();
+  llvm::SmallVector<string_view, 16> views(strings.begin(), strings.end());
+  auto result = ContiguousStringHostTensor::Create(tensor.shape(), views,
+                                                  exec_ctx.host());
+  if (!result) return MakeErrorAsyncValueRef("out of memory converting tensor");
+  return MakeAvailableAsyncValueRef<ContiguousStringHostTensor>(
+      std::move(*result));
+}
+
+static AsyncValueRef<StringHostTensor>
+ConvertContiguousStringHostTensorToStringHostTensor(
+    const ContiguousStringHostTensor& tensor, const CpuDevice& src,
+    const CpuDevice& dst, const ExecutionContext& exec_ctx) {
+  auto result =
+      StringHostTensor::CreateUninitialized(tensor.shape(), exec_ctx.host());
+  if (!result) return MakeErrorAsyncValueRef("out of memory converting tensor");
+
+  auto strings = result->strings();
+  for (size_t i = 0, e = strings.size(); i != e; ++i)
+    strings[i] = tensor.GetString(i).str();
+  return MakeAvailableAsyncValueRef<StringHostTensor>(std::move(*result));
+}
+
+static AsyncValueRef<ContiguousStringHostTensor>
+ConvertContiguousStringHostTensorToContiguousStringHostTensor(
+    const ContiguousStringHostTensor& tensor, const CpuDevice& src,
+    const CpuDevice& dst, const ExecutionContext& exec_ctx) {
+  // The buffers are immutable, so the result can share them.
+  return MakeAvailableAsyncValueRef<ContiguousStringHostTensor>(
+      tensor.CopyRef());
+}
+
+void RegisterContiguousStringHostTensorConversionFn(
+    TensorConversionFnRegistry* registry) {
+  registry->AddTensorConversionFn(
+      TFRT_CONVERSION(ConvertStringHostTensorToContiguousStringHostTensor));
+  registry->AddTensorConversionFn(
+      TFRT_CONVERSION(ConvertContiguousStringHostTensorToStringHostTensor));
+  registry->AddTensorConversionFn(TFRT_CONVERSION(
+      ConvertContiguousStringHostTensorToContiguousStringHostTensor));
+}
+
+}  // namespace tfrt
@@ -16,6 +16,9 @@
 
 #include "tfrt/tensor/conversion_registry.h"
 
+#include <algorithm>
+
+#include "llvm/ADT/SmallVector.h"
 #include "tfrt/host_context/async_value_ref.h"
 #include "tfrt/host_context/diagnostic.h"
 #include "tfrt/host_context/execution_context.h"
@@ -42,6 +45,10 @@ void TensorConversionFnRegistry::AddTensorConversionFn(ConversionKey key,
   TFRT_DLOG_IF(FATAL, !added)
       << "Re-registered existing TensorConversionFn for key "
       << key.src_tensor_type << " -> " << key.dst_tensor_type;
+
+  // A new conversion can shorten or create paths.
+  mutex_lock lock(mu_);
+  conversion_path_cache_.clear();
 }
 
 TensorConversionFn TensorConversionFnRegistry::GetTensorConversionFn(
@@ -50,6 +57,84 @@ TensorConversionFn TensorConversionFnRegistry::GetTensorConversionFn(
   return it == conversion_fn_map_.end() ? nullptr : it->second;
 }
 
+ArrayRef<TensorConversionFn>
+TensorConversionFnRegistry::GetTensorConversionPath(ConversionKey key) const {
+  mutex_lock lock(mu_);
+  auto& path = conversion_path_cache_[key];
+  if (!path)
+    path = std::make_unique<ConversionPath>(FindTensorConversionPath(key));
+  return *path;
+}
+
+// Breadth first search over the registered conversions. There are only a
+// handful of tensor types, so the edges are scanned for every visited type.
+TensorConversionFnRegistry::ConversionPath
+TensorConversionFnRegistry::FindTensorConversionPath(ConversionKey key) const {
+  // The conversion used to reach each visited tensor type, by type id.
+  llvm::SmallDenseMap<int8_t, ConversionKey, 8> reached_by;
+  llvm::SmallVector<TensorType, 8> queue = {key.src_tensor_type};
+  reached_by.try_emplace(key.src_tensor_type.id(), key);
+
+  for (size_t i = 0; i < queue.size(); ++i) {
+    TensorType type = queue[i];
+    if (type == key.dst_tensor_type) break;
+    for (const auto& it : conversion_fn_map_) {
+      const ConversionKey& edge = it.first;
+      if (edge.src_tensor_type != type) continue;
+      if (reached_by.try_emplace(edge.dst_tensor_type.id(), edge).second)
+        queue.push_back(edge.dst_tensor_type);
+    }
+  }
+
+  ConversionPath path;
+  if (key.src_tensor_type == key.dst_tensor_type ||
+      reached_by.count(key.dst_tensor_type.id()) == 0)
+    return path;
+
+  for (TensorType type = key.dst_tensor_type; type != key.src_tensor_type;) {
+    const ConversionKey& edge = reached_by.find(type.id())->second;
+    path.push_back(conversion_fn_map_.find(edge)->second);
+    type = edge.src_tensor_type;
+  }
+  std::reverse(path.begin(), path.end());
+  return path;
+}
+
+// Applies the conversions of `path` in order. All but the last conversion
+// convert on the `src` device.
+static AsyncValueRef<Tensor> ConvertTensorAlongPath(
+    const ExecutionContext& exec_ctx, const Tensor& tensor, const Device& src,
+    const Device& dst, ArrayRef<TensorConversionFn> path) {
+  assert(!path.empty());
+  if (path.size() == 1) return path.front()(tensor, src, dst, exec_ctx);
+
+  AsyncValueRef<Tensor> intermediate = path.front()(tensor, src, src, exec_ctx);
+  if (intermediate.IsError()) return intermediate;
+
+  if (intermediate.IsAvailable()) {
+    auto result = ConvertTensorAlongPath(exec_ctx, intermediate.get(), src, dst,
+                                         path.drop_front());
+    // Keep the intermediate tensor alive until the next conversion is done.
+    result.AndThen([intermediate = std::move(intermediate)] {});
+    return result;
+  }
+
+  RCReference<IndirectAsyncValue> result = MakeIndirectAsyncValue();
+  intermediate.AndThen([exec_ctx, intermediate = intermediate.CopyRef(),
+                        src = FormRef(&src), dst = FormRef(&dst),
+                        path = path.drop_front(), result = result]() mutable {
+    if (intermediate.IsError()) {
+      result->ForwardTo(intermediate.ReleaseRCRef());
+      return;
+    }
+    auto converted = ConvertTensorAlongPath(exec_ctx, intermediate.get(), *src,
+                                            *dst, path);
+    converted.AndThen([intermediate = std::move(intermediate)] {});
+    result->ForwardTo(converted.ReleaseRCRef());
+  });
+  return AsyncValueRef<Tensor>(std::move(result));
+}
+
 AsyncValueRef<Tensor> ConvertTensor(const ExecutionContext& exec_ctx,
                                     const Tensor& tensor, const Device& src,
                                     const Device& dst,
@@ -58,17 +143,20 @@ AsyncValueRef<Tensor> ConvertTensor(const ExecutionContext& exec_ctx,
   auto& shared_ctx =
       host->GetOrCreateSharedContext<TensorConversionFnRegistryContext>();
   assert(shared_ctx.registry && "does not have a TensorConversionFnRegistry");
-  auto conversion_fn = shared_ctx.registry->GetTensorConversionFn(
-      {tensor.tensor_type(), dst_tensor_type});
+  TensorConversionFnRegistry::ConversionKey key = {tensor.tensor_type(),
+                                                   dst_tensor_type};
+  if (auto conversion_fn = shared_ctx.registry->GetTensorConversionFn(key))
+    return conversion_fn(tensor, src, dst, exec_ctx);
 
-  if (!conversion_fn) {
+  auto path = shared_ctx.registry->GetTensorConversionPath(key);
+  if (path.empty()) {
     return EmitErrorAsync(exec_ctx,
                           StrCat("cannot find conversion function for [",
                                  tensor.tensor_type().name(), "]->[",
                                  dst_tensor_type.name(), "]"));
   }
 
-  return conversion_fn(tensor, src, dst, exec_ctx);
+  return ConvertTensorAlongPath(exec_ctx, tensor, src, dst, path);
 }
 
 AsyncValueRef<HostTensor> ConvertTensorOnHost(const ExecutionContext& exec_ctx,
@@ -16,6 +16,10 @@
 
 #include "tfrt/tensor/coo_host_tensor.h"
 
+#include <algorithm>
+#include <memory>
+
+#include "llvm/ADT/FunctionExtras.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/raw_ostream.h"
 #include "tfrt/dtype/dtype_formatter.h"
@@ -23,6 +27,7 @@
 #include "tfrt/host_context/device.h"
 #include "tfrt/host_context/execution_context.h"
 #include "tfrt/host_context/host_context.h"
+#include "tfrt/host_context/parallel_for.h"
 #include "tfrt/tensor/conversion_registry.h"
 #include "tfrt/tensor/conversion_utils.h"
 #include "tfrt/tensor/dense_host_tensor_view.h"
@@ -31,26 +36,82 @@
 namespace tfrt {
 
 namespace {
+// The minimum number of elements of the parallel blocks that zero the dense
+// tensor, and of the parallel blocks that scatter the sparse elements into it.
+constexpr size_t kMinFillBlockSize = 64 * 1024;
+constexpr size_t kMinScatterBlockSize = 16 * 1024;
+
+// The state shared by the parallel blocks of a CooHostTensor to
+// DenseHostTensor conversion.
+struct CooToDenseConversion {
+  DenseHostTensor indices;
+  DenseHostTensor values;
+  DenseHostTensor result;
+};
+
+// Runs `compute` in parallel on [0, size) and then `on_done`, or only
+// `on_done` if the range is empty.
+void ExecuteParallelFor(const ExecutionContext &exec_ctx, size_t size,
+                        size_t min_block_size,
+                        llvm::unique_function<void(size_t, size_t)> compute,
+                        llvm::unique_function<void()> on_done) {
+  if (size == 0) {
+    on_done();
+    return;
+  }
+  ParallelFor(exec_ctx).Execute(size,
+                                ParallelFor::BlockSizes::Min(min_block_size),
+                                std::move(compute), std::move(on_done));
+}
+
+// Zeros `result_tensor` and scatters the elements of the COO tensor into it in
+// parallel, then sets `result` to it. The indices of the COO tensor must be
+// unique, so the parallel blocks never write the same element.
 template <typename DType>
 void ConvertToDHTTensorHelper(const DenseHostTensor &indices,
                               const DenseHostTensor &values,
-                              DenseHostTensor *result_tensor) {
-  auto result_tensor_view = MutableDHTArrayView<DType>(result_tensor);
-  const TensorMetadata &result_metadata = result_tensor->metadata();
-  const auto &result_shape = result_metadata.shape;
-  result_tensor_view.Fill(DType(0));
-  auto indices_view = DHTIndexableView<int64_t, 2>(&indices);
-  auto values_view = DHTIndexableView<DType, 1>(&values);
-  for (int i = 0, e = values_view.FixedShape().GetNumElements(); i != e; ++i) {
-    size_t offset = 0;
-    size_t stride = 1;
-    for (int j = result_shape.GetRank() - 1; j >= 0; --j) {
-      assert(indices_view.ElementAt(i, j) < result_shape.GetDimensionSize(j));
-      offset += stride * indices_view.ElementAt(i, j);
-      stride *= result_shape.GetDimensionSize(j);
+                              DenseHostTensor result_tensor,
+                              AsyncValueRef<DenseHostTensor> result,
+                              const ExecutionContext &exec_ctx) {
+  auto conversion = std::make_shared<CooToDenseConversion>();
+  conversion->indices = indices.CopyRef();
+  conversion->values = values.CopyRef();
+  conversion->result = std::move(result_tensor);
+
+  auto scatter = [conversion](size_t begin, size_t end) {
+    auto result_tensor_view = MutableDHTArrayView<DType>(&conversion->result);
+    const auto &result_shape = conversion->result.shape();
+    auto indices_view = DHTIndexableView<int64_t, 2>(&conversion->indices);
+    auto values_view = DHTIndexableView<DType, 1>(&conversion->values);
+    for (size_t i = begin; i != end; ++i) {
+      size_t offset = 0;
+      size_t stride = 1;
+      for (int j = result_shape.GetRank() - 1; j >= 0; --j) {
+        assert(indices_view.ElementAt(i, j) <
+               result_shape.GetDimensionSize(j));
+        offset += stride * indices_view.ElementAt(i, j);
+        stride *= result_shape.GetDimensionSize(j);
+      }
+      result_tensor_view[offset] = values_view.ElementAt(i);
     }
-    result_tensor_view[offset] = values_view.ElementAt(i);
-  }
+  };
+
+  auto on_filled = [exec_ctx, conversion, scatter = std::move(scatter),
+                    result = result.CopyRef()]() mutable {
+    ExecuteParallelFor(exec_ctx, conversion->values.NumElements(),
+                       kMinScatterBlockSize, std::move(scatter),
+                       [conversion, result = result.CopyRef()]() {
+                         result.emplace(std::move(conversion->result));
+                       });
+  };
+
+  ExecuteParallelFor(
+      exec_ctx, conversion->result.NumElements(), kMinFillBlockSize,
+      [conversion](size_t begin, size_t end) {
+        DType *data = conversion->result.data<DType>();
+        std::fill(data + begin, data + end, DType(0));
+      },
+      std::move(on_filled));
 }
 }  // namespace
 
@@ -114,19 +175,18 @@ static AsyncValueRef<DenseHostTensor> ConvertCooHostTensorToDenseHostTensor(
     return MakeErrorAsyncValueRef(
         "out of memory converting coo tensor to dht tensor");
   }
-  auto &result_tensor = result_alloc.value();
 
   switch (tensor.dtype()) {
     default:
       llvm_unreachable("can't happen");
-#define DTYPE_NUMERIC(ENUM)                                   \
-  case DType::ENUM:                                           \
-    ConvertToDHTTensorHelper<TypeForDTypeKind<DType::ENUM>>(  \
-        *tensor.Indices(), *tensor.Values(), &result_tensor); \
+#define DTYPE_NUMERIC(ENUM)                                                   \
+  case DType::ENUM:                                                           \
+    ConvertToDHTTensorHelper<TypeForDTypeKind<DType::ENUM>>(                  \
+        *tensor.Indices(), *tensor.Values(), std::move(*result_alloc),        \
+        result.CopyRef(), exec_ctx);                                          \
     break;
 #include "tfrt/dtype/dtype.def"  // NOLINT
   }
-  result.emplace(std::move(result_tensor));
   return result;
 }
 
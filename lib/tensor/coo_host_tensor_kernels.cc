@@ -14,7 +14,16 @@
 
 // This file defines the kernels for COO sparse host tensors.
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "llvm/Support/MathExtras.h"
+#include "tfrt/host_context/diagnostic.h"
 #include "tfrt/host_context/kernel_utils.h"
+#include "tfrt/host_context/parallel_for.h"
 #include "tfrt/tensor/coo_host_tensor.h"
 #include "tfrt/tensor/dense_tensor_utils.h"
 
@@ -44,58 +53,168 @@ static void ConvertToDHT(Argument<CooHostTensor> in, Argument<Chain> in_chain,
   out_chain.Set(in_chain);
 }
 
+// The minimum number of elements of the parallel blocks of a DenseHostTensor
+// to CooHostTensor conversion.
+static constexpr size_t kMinConversionBlockSize = 16 * 1024;
+// The number of elements whose nonzero bits are collected into one mask. The
+// mask is computed without branches, and only the nonzero elements are
+// visited when they are copied to the sparse tensor.
+static constexpr size_t kConversionChunkSize = 64;
+
+// The state shared by the parallel blocks of a DenseHostTensor to
+// CooHostTensor conversion.
+template <typename T, size_t Rank>
+struct DenseToCooConversion {
+  DenseHostTensor input;
+  std::array<Index, Rank> dims;
+  size_t block_size = 0;
+  // The number of nonzero elements of every block, and then the index of the
+  // first nonzero element of every block in the sparse tensor.
+  std::vector<size_t> block_offsets;
+  DenseHostTensor values;
+  DenseHostTensor indices;
+};
+
+// Returns the mask of the nonzero elements of `data[0, size)`, size <= 64.
+template <typename T>
+static uint64_t NonZeroMask(const T* data, size_t size) {
+  uint64_t mask = 0;
+  for (size_t i = 0; i < size; ++i)
+    mask |= static_cast<uint64_t>(data[i] != T(0)) << i;
+  return mask;
+}
+
+// Copies the nonzero elements of the block starting at `begin` to the sparse
+// tensor, starting at its element `sparse_index`.
+template <typename T, size_t Rank>
+static void ScatterNonZeros(DenseToCooConversion<T, Rank>& conversion,
+                            size_t begin, size_t sparse_index) {
+  const T* data = conversion.input.template data<T>();
+  T* values = conversion.values.template data<T>();
+  int64_t* indices = conversion.indices.template data<int64_t>();
+  const size_t end =
+      std::min<size_t>(begin + conversion.block_size,
+                       conversion.input.NumElements());
+
+  for (size_t chunk = begin; chunk < end; chunk += kConversionChunkSize) {
+    const size_t chunk_size = std::min(kConversionChunkSize, end - chunk);
+    for (uint64_t mask = NonZeroMask(data + chunk, chunk_size); mask != 0;
+         mask &= mask - 1, ++sparse_index) {
+      const size_t i = chunk + llvm::countTrailingZeros(mask);
+      values[sparse_index] = data[i];
+      // In a row-major layout, the linear index is:
+      //   linear_index = x_{n-1} + x_{n-2} * dims[n-1] + ...
+      // so the coordinates are decomposed starting from the innermost one.
+      size_t idx = i;
+      for (size_t r = Rank; r-- > 0;) {
+        indices[sparse_index * Rank + r] = idx % conversion.dims[r];
+        idx /= conversion.dims[r];
+      }
+    }
+  }
+}
+
 // Converts a DenseHostTensor into a CooHostTensor.
-// The conversion consists of two passes: One to count how many non-zero
-// elements there are in the tensor and another one copy these elements to the
-// newly allocated buffer.
+// The conversion consists of two parallel passes over blocks of the tensor: One
+// to count how many non-zero elements there are in every block and another one
+// to copy these elements to the newly allocated buffers, at the offsets given
+// by the prefix sum of the counts.
 template <typename T, size_t Rank>
-static void ConvertFromDHT(ArgumentView<MutableDHTIndexableView<T, Rank>> in,
+static void ConvertFromDHT(Argument<DenseHostTensor> in,
                            Argument<Chain> in_chain, Result<CooHostTensor> out,
-                           Result<Chain> out_chain, KernelErrorHandler handler,
-                           AsyncKernelFrame* frame) {
-  Index num_non_zero_values = 0;
-  for (const auto& element : in->Elements()) {
-    if (element != 0) {
-      num_non_zero_values++;
+                           Result<Chain> out_chain, AsyncKernelFrame* frame) {
+  const ExecutionContext& exec_ctx = frame->GetExecutionContext();
+  auto result = out.AllocateIndirect();
+  out_chain.Set(in_chain);
+
+  auto conversion = std::make_shared<DenseToCooConversion<T, Rank>>();
+  conversion->input = in->CopyRef();
+  for (size_t r = 0; r < Rank; ++r)
+    conversion->dims[r] = in->shape().GetDimensionSize(r);
+
+  const size_t size = in->NumElements();
+  const size_t num_blocks_per_thread = 4;
+  const size_t max_num_blocks =
+      num_blocks_per_thread *
+      std::max(1, exec_ctx.host()->GetNumWorkerThreads());
+  size_t block_size = std::max(kMinConversionBlockSize,
+                               (size + max_num_blocks - 1) / max_num_blocks);
+  block_size = llvm::alignTo(block_size, kConversionChunkSize);
+  conversion->block_size = block_size;
+  conversion->block_offsets.resize((size + block_size - 1) / block_size);
+
+  // Copies the nonzero elements once all of them have been counted.
+  auto scatter = [exec_ctx, conversion, result = result.CopyRef()]() {
+    auto& offsets = conversion->block_offsets;
+    size_t num_non_zero_values = 0;
+    for (size_t& offset : offsets) {
+      size_t count = offset;
+      offset = num_non_zero_values;
+      num_non_zero_values += count;
     }
-  }
-  auto values = DenseHostTensor::CreateUninitialized<T>(
-      TensorShape(num_non_zero_values), frame->GetHostContext());
-  if (!values.has_value()) {
-    handler.ReportError("Cannot allocate value tensor");
-    return;
-  }
-  auto indices = DenseHostTensor::CreateUninitialized<int64_t>(
-      TensorShape({num_non_zero_values, Rank}), frame->GetHostContext());
-  if (!indices.has_value()) {
-    handler.ReportError("Cannot allocate index tensor");
-    return;
-  }
-  auto values_view = MutableDHTIndexableView<T, 1>(&*values);
-  auto indices_view = MutableDHTIndexableView<int64_t, 2>(&*indices);
-  const auto elements = in->Elements();
-  // Index of the next element in the sparse tensor to be filled.
-  int sparse_index = 0;
-  for (size_t i = 0; i < in->Elements().size(); i++) {
-    if (elements[i] != 0) {
-      values_view.ElementAt(sparse_index) = elements[i];
-      // Make a copy of the index so we can decompose it into its coordinates.
-      size_t idx = i;
-      // In a row-major layout, the linear index can be calculated as:
-      //   linear_index = x_0 + x_1 * dims[0] + x_2 * dims[1] * dims[0] + ...
-      // In other words:
-      //   linear_index = x_0 + sum_{i=1} (x_i * prod_{j=0}^{i-1} dims[j])
-      for (uint64_t r = 0; r < Rank; r++) {
-        indices_view.ElementAt(sparse_index, Rank - r - 1) =
-            idx % in->FixedShape()[r];
-        idx /= in->FixedShape()[r];
+
+    auto values = DenseHostTensor::CreateUninitialized<T>(
+        TensorShape(num_non_zero_values), exec_ctx.host());
+    if (!values.has_value()) {
+      result->ForwardTo(
+          EmitErrorAsync(exec_ctx, "cannot allocate value tensor"));
+      return;
+    }
+    auto indices = DenseHostTensor::CreateUninitialized<int64_t>(
+        TensorShape({static_cast<Index>(num_non_zero_values), Rank}),
+        exec_ctx.host());
+    if (!indices.has_value()) {
+      result->ForwardTo(
+          EmitErrorAsync(exec_ctx, "cannot allocate index tensor"));
+      return;
+    }
+    conversion->values = std::move(*values);
+    conversion->indices = std::move(*indices);
+
+    auto compute = [conversion](size_t begin, size_t end) {
+      const size_t block_size = conversion->block_size;
+      for (size_t block = begin; block < end; block += block_size) {
+        ScatterNonZeros(*conversion, block,
+                        conversion->block_offsets[block / block_size]);
       }
-      sparse_index++;
+    };
+    auto on_done = [conversion, result = result.CopyRef()]() {
+      result->ForwardTo(
+          MakeAvailableAsyncValueRef<CooHostTensor>(
+              conversion->input.shape(), GetDType<T>(),
+              std::move(conversion->indices), std::move(conversion->values))
+              .ReleaseRCRef());
+    };
+    if (conversion->input.NumElements() == 0) {
+      on_done();
+      return;
+    }
+    ParallelFor(exec_ctx).Execute(
+        conversion->input.NumElements(),
+        ParallelFor::BlockSizes::Fixed(conversion->block_size),
+        std::move(compute), std::move(on_done));
+  };
+
+  // Counts the nonzero elements of every block.
+  auto count = [conversion](size_t begin, size_t end) {
+    const T* data = conversion->input.template data<T>();
+    const size_t block_size = conversion->block_size;
+    for (size_t block = begin; block < end; block += block_size) {
+      const size_t block_end = std::min(block + block_size, end);
+      size_t num_non_zero_values = 0;
+      for (size_t i = block; i < block_end; ++i)
+        num_non_zero_values += data[i] != T(0);
+      conversion->block_offsets[block / block_size] = num_non_zero_values;
     }
+  };
+
+  if (size == 0) {
+    scatter();
+    return;
   }
-  out.Emplace(CooHostTensor(in->FixedShape().ToTensorShape(), GetDType<T>(),
-                            std::move(*indices), std::move(*values)));
-  out_chain.Set(in_chain);
+  ParallelFor(exec_ctx).Execute(size,
+                                ParallelFor::BlockSizes::Fixed(block_size),
+                                std::move(count), std::move(scatter));
 }
 
 template <typename T, size_t Rank>
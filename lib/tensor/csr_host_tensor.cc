@@ -0,0 +1,185 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file implements the CsrHostTensor class.
+
+#include "tfrt/tensor/csr_host_tensor.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/raw_ostream.h"
+#include "tfrt/dtype/dtype_formatter.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/device.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/tensor/conversion_registry.h"
+#include "tfrt/tensor/conversion_utils.h"
+#include "tfrt/tensor/coo_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor_view.h"
+
+namespace tfrt {
+
+void CsrHostTensor::Print(raw_ostream &os) const {
+  os << "CsrHostTensor dtype = " << dtype() << ", shape = " << shape();
+  os << ", row_ptrs = [";
+  llvm::interleaveComma(llvm::makeArrayRef(RowPtrs(), NumRows() + 1), os);
+  os << "], col_indices = [";
+  llvm::interleaveComma(llvm::makeArrayRef(ColIndices(), NumNonZeros()), os);
+  os << "], values = [";
+
+  auto element_size = GetHostSize(dtype());
+  auto *data_ptr = static_cast<const char *>(Values()->data());
+  for (Index i = 0, e = NumNonZeros(); i != e; ++i) {
+    if (i != 0) os << ", ";
+    os << FormatDType(dtype(), data_ptr + i * element_size);
+  }
+  os << "]\n";
+}
+
+// The COO indices need not be sorted. Elements are bucketed by row with a
+// counting sort and then sorted by column within each row. Like the COO to
+// dense conversion, the last of several elements with the same coordinates
+// wins.
+static AsyncValueRef<CsrHostTensor> ConvertCooHostTensorToCsrHostTensor(
+    const CooHostTensor &coo, const CpuDevice &src, const CpuDevice &dst,
+    const ExecutionContext &exec_ctx) {
+  if (coo.shape().GetRank() != 2) {
+    return MakeErrorAsyncValueRef(
+        StrCat("cannot convert rank ", coo.shape().GetRank(),
+               " coo tensor to csr tensor"));
+  }
+
+  const Index num_rows = coo.shape().GetDimensionSize(0);
+  const Index num_cols = coo.shape().GetDimensionSize(1);
+  const Index coo_nnz = coo.Values()->NumElements();
+  const auto *coo_indices = static_cast<const int64_t *>(coo.Indices()->data());
+
+  std::vector<int64_t> row_starts(num_rows + 1, 0);
+  for (Index i = 0; i != coo_nnz; ++i) {
+    const int64_t row = coo_indices[2 * i];
+    const int64_t col = coo_indices[2 * i + 1];
+    if (row < 0 || row >= num_rows || col < 0 || col >= num_cols) {
+      return MakeErrorAsyncValueRef(StrCat("coo index (", row, ", ", col,
+                                           ") is out of bounds for shape ",
+                                           coo.shape()));
+    }
+    ++row_starts[row + 1];
+  }
+  for (Index r = 0; r != num_rows; ++r) row_starts[r + 1] += row_starts[r];
+
+  // The COO element of each CSR element, in row order.
+  std::vector<int64_t> order(coo_nnz);
+  {
+    std::vector<int64_t> next(row_starts.begin(), row_starts.end() - 1);
+    for (Index i = 0; i != coo_nnz; ++i)
+      order[next[coo_indices[2 * i]]++] = i;
+  }
+
+  auto *host = exec_ctx.host();
+  auto row_ptrs =
+      DenseHostTensor::CreateUninitialized<int64_t>(TensorShape{num_rows + 1},
+                                                    host);
+  if (!row_ptrs) {
+    return MakeErrorAsyncValueRef(
+        "out of memory converting coo tensor to csr tensor");
+  }
+  auto *row_ptrs_data = static_cast<int64_t *>(row_ptrs->data());
+
+  // Sorts each row by column, and compacts `order` in place as duplicates are
+  // dropped.
+  auto col_of = [&](int64_t i) { return coo_indices[2 * i + 1]; };
+  int64_t nnz = 0;
+  row_ptrs_data[0] = 0;
+  for (Index r = 0; r != num_rows; ++r) {
+    auto row_begin = order.begin() + row_starts[r];
+    auto row_end = order.begin() + row_starts[r + 1];
+    std::stable_sort(row_begin, row_end, [&](int64_t lhs, int64_t rhs) {
+      return col_of(lhs) < col_of(rhs);
+    });
+    for (auto it = row_begin; it != row_end; ++it) {
+      if (std::next(it) != row_end && col_of(*std::next(it)) == col_of(*it))
+        continue;
+      order[nnz++] = *it;
+    }
+    row_ptrs_data[r + 1] = nnz;
+  }
+
+  auto col_indices =
+      DenseHostTensor::CreateUninitialized<int64_t>(TensorShape{nnz}, host);
+  auto values = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(coo.dtype(), TensorShape{nnz}), host);
+  if (!col_indices || !values) {
+    return MakeErrorAsyncValueRef(
+        "out of memory converting coo tensor to csr tensor");
+  }
+
+  // The gather only moves bytes, so it is independent of the dtype.
+  auto *col_indices_data = static_cast<int64_t *>(col_indices->data());
+  const auto element_size = GetHostSize(coo.dtype());
+  const auto *coo_values = static_cast<const char *>(coo.Values()->data());
+  auto *values_data = static_cast<char *>(values->data());
+  for (int64_t k = 0; k != nnz; ++k) {
+    col_indices_data[k] = col_of(order[k]);
+    std::memcpy(values_data + k * element_size,
+                coo_values + order[k] * element_size, element_size);
+  }
+
+  return MakeAvailableAsyncValueRef<CsrHostTensor>(
+      coo.shape(), coo.dtype(), std::move(*row_ptrs), std::move(*col_indices),
+      std::move(*values));
+}
+
+static AsyncValueRef<DenseHostTensor> ConvertCsrHostTensorToDenseHostTensor(
+    const CsrHostTensor &tensor, const CpuDevice &src, const CpuDevice &dst,
+    const ExecutionContext &exec_ctx) {
+  auto *host = exec_ctx.host();
+  auto result = DenseHostTensor::CreateUninitialized(tensor.metadata(), host);
+  if (!result) {
+    return MakeErrorAsyncValueRef(
+        "out of memory converting csr tensor to dht tensor");
+  }
+
+  // All numeric dtypes represent zero with zero bytes.
+  const auto element_size = GetHostSize(tensor.dtype());
+  auto *result_data = static_cast<char *>(result->data());
+  std::memset(result_data, 0, result->DataSizeInBytes());
+
+  const int64_t *row_ptrs = tensor.RowPtrs();
+  const int64_t *col_indices = tensor.ColIndices();
+  const auto *values = static_cast<const char *>(tensor.Values()->data());
+  for (Index r = 0, e = tensor.NumRows(); r != e; ++r) {
+    for (int64_t k = row_ptrs[r]; k != row_ptrs[r + 1]; ++k) {
+      const Index offset = r * tensor.NumCols() + col_indices[k];
+      std::memcpy(result_data + offset * element_size,
+                  values + k * element_size, element_size);
+    }
+  }
+  return MakeAvailableAsyncValueRef<DenseHostTensor>(std::move(*result));
+}
+
+void RegisterCsrHostTensorConversionFn(TensorConversionFnRegistry *registry) {
+  registry->AddTensorConversionFn(
+      TFRT_CONVERSION(ConvertCooHostTensorToCsrHostTensor));
+  registry->AddTensorConversionFn(
+      TFRT_CONVERSION(ConvertCsrHostTensorToDenseHostTensor));
+}
+
+}  // namespace tfrt
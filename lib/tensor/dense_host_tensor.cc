@@ -17,6 +17,7 @@
 #include "tfrt/tensor/dense_host_tensor.h"
 
 #include <cstddef>
+#include <cstdint>
 #include <cstring>
 #include <optional>
 #include <utility>
@@ -40,14 +41,16 @@ namespace tfrt {
 // larger than or equals to EIGEN_DEFAULT_ALIGN_BYTES (16).
 static constexpr size_t kTensorBufferAlignment = 16;
 
+size_t DenseHostTensor::GetBufferAlignment(DType dtype) {
+  return std::max(GetHostAlignment(dtype), kTensorBufferAlignment);
+}
+
 std::optional<DenseHostTensor> DenseHostTensor::CreateUninitialized(
     const TensorMetadata& metadata, HostAllocator* allocator) {
-  size_t alignment =
-      std::max(GetHostAlignment(metadata.dtype), kTensorBufferAlignment);
   auto& shape = metadata.shape;
   auto data = HostBuffer::CreateUninitialized(
-      GetHostSize(metadata.dtype) * shape.GetNumElements(), alignment,
-      allocator);
+      GetHostSize(metadata.dtype) * shape.GetNumElements(),
+      GetBufferAlignment(metadata.dtype), allocator);
   if (!data) return std::nullopt;
   return DenseHostTensor(metadata, std::move(data));
 }
@@ -57,6 +60,26 @@ std::optional<DenseHostTensor> DenseHostTensor::CreateUninitialized(
   return CreateUninitialized(metadata, host->allocator());
 }
 
+std::optional<DenseHostTensor> DenseHostTensor::CreateZeroed(
+    const TensorMetadata& metadata, HostContext* host) {
+  auto data = HostBuffer::CreateZeroed(metadata.GetHostSizeInBytes(),
+                                       GetBufferAlignment(metadata.dtype),
+                                       host->allocator());
+  if (!data) return std::nullopt;
+  return DenseHostTensor(metadata, std::move(data));
+}
+
+std::optional<DenseHostTensor> DenseHostTensor::CreateFromExternal(
+    const TensorMetadata& metadata, void* ptr, size_t size,
+    HostBuffer::Deallocator deallocator) {
+  if (size < metadata.GetHostSizeInBytes() ||
+      reinterpret_cast<uintptr_t>(ptr) % GetBufferAlignment(metadata.dtype))
+    return std::nullopt;
+  return DenseHostTensor(
+      metadata,
+      HostBuffer::CreateFromExternal(ptr, size, std::move(deallocator)));
+}
+
 AsyncValueRef<DenseHostTensor> DenseHostTensor::MakeConstructedAsyncValueRef(
     const TensorMetadata& metadata, HostContext* host) {
   auto dht = CreateUninitialized(metadata, host);
@@ -105,6 +128,24 @@ bool operator==(const DenseHostTensor& a, const DenseHostTensor& b) {
              0;
 }
 
+bool EncodeDenseHostTensorMemoizationKey(const AsyncValue& value,
+                                         std::string* key) {
+  if (!value.IsType<DenseHostTensor>()) return false;
+  const auto& tensor = value.get<DenseHostTensor>();
+
+  llvm::SmallVector<Index, 4> dims;
+  tensor.shape().GetDimensions(&dims);
+
+  key->push_back('T');
+  key->push_back(static_cast<char>(tensor.dtype()));
+  key->push_back(static_cast<char>(dims.size()));
+  key->append(reinterpret_cast<const char*>(dims.data()),
+              dims.size() * sizeof(Index));
+  key->append(static_cast<const char*>(tensor.data()),
+              tensor.DataSizeInBytes());
+  return true;
+}
+
 static AsyncValueRef<DenseHostTensor> ConvertDenseHostTensorToDenseHostTensor(
     const DenseHostTensor& tensor, const CpuDevice& src, const CpuDevice& dst,
     const ExecutionContext& exec_ctx) {
@@ -17,14 +17,22 @@
 #include "tfrt/tensor/dense_host_tensor_kernels.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <complex>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
 
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm_derived/Support/raw_ostream.h"
 #include "tfrt/host_context/kernel_utils.h"
+#include "tfrt/host_context/parallel_for.h"
 #include "tfrt/host_context/sync_kernel_utils.h"
 #include "tfrt/support/error_util.h"
+#include "tfrt/support/mutex.h"
 #include "tfrt/support/ref_count.h"
 #include "tfrt/support/string_util.h"
 #include "tfrt/tensor/dense_host_tensor.h"
@@ -33,6 +41,10 @@
 #include "tfrt/tensor/scalar_host_tensor.h"
 #include "tfrt/tensor/tensor_shape.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 namespace tfrt {
 
 template <typename T, size_t Rank>
@@ -108,11 +120,95 @@ static ScalarHostTensor<T> CreateFromScalar(ArrayAttribute<Index> shape,
   return ScalarHostTensor<T>{TensorShape{shape.data()}, *value};
 }
 
+template <typename T, size_t Rank>
+static Expected<DenseHostTensor> CreateZeroedDenseTensor(
+    ArrayAttribute<Index> shape_in, const ExecutionContext& exec_ctx) {
+  auto result = DenseHostTensor::CreateZeroed(
+      TensorMetadata(GetDType<T>(), TensorShape(shape_in.data())),
+      exec_ctx.host());
+  if (!result.has_value()) {
+    return MakeStringError("Cannot allocate tensor");
+  }
+  return std::move(*result);
+}
+
+// The minimum number of bytes filled by a parallel block.
+static constexpr size_t kMinFillBlockSize = 256 * 1024;
+// Tensors of at least this many bytes are filled with non-temporal stores,
+// which write to memory without first reading the cache lines they fill, and
+// do not evict the data of other kernels from the caches. Smaller tensors are
+// likely read again soon, while they are still cached.
+static constexpr size_t kMinNonTemporalFillSize = 4 * 1024 * 1024;
+
+// Sets the elements [begin, end) of `data` to `value`, with non-temporal
+// stores if `non_temporal` is true and the target supports them.
 template <typename T>
-static Chain FillDenseTensorWithConstantValue(
-    ArgumentView<MutableDHTArrayView<T>> in, Attribute<T> value) {
-  in->Fill(*value);
-  return Chain();
+static void FillElements(T* data, size_t begin, size_t end, const T& value,
+                         bool non_temporal) {
+  T* first = data + begin;
+  T* last = data + end;
+#if defined(__SSE2__)
+  if constexpr (16 % sizeof(T) == 0 && std::is_trivially_copyable<T>::value) {
+    if (non_temporal) {
+      constexpr ptrdiff_t kElementsPerStore = 16 / sizeof(T);
+      while (first != last && reinterpret_cast<uintptr_t>(first) % 16 != 0)
+        *first++ = value;
+      char pattern[16];
+      for (size_t i = 0; i < 16; i += sizeof(T))
+        std::memcpy(pattern + i, &value, sizeof(T));
+      const __m128i vector =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern));
+      for (; last - first >= kElementsPerStore; first += kElementsPerStore)
+        _mm_stream_si128(reinterpret_cast<__m128i*>(first), vector);
+      // Non-temporal stores are weakly ordered. Complete them before the
+      // block is reported done.
+      _mm_sfence();
+    }
+  }
+#endif
+  std::fill(first, last, value);
+}
+
+// Fills the tensor with `value` in parallel blocks. The returned chain becomes
+// available once all blocks are done.
+template <typename T>
+static AsyncValueRef<Chain> FillDenseTensorWithConstantValue(
+    Argument<DenseHostTensor> in, Argument<Chain> in_chain, Attribute<T> value,
+    const ExecutionContext& exec_ctx) {
+  const size_t size = in->NumElements();
+  const bool non_temporal = size * sizeof(T) >= kMinNonTemporalFillSize;
+  auto result = MakeUnconstructedAsyncValueRef<Chain>();
+  ParallelFor(exec_ctx).Execute(
+      size,
+      ParallelFor::BlockSizes::Min(kMinFillBlockSize / sizeof(T)),
+      [tensor = in.ValueRef(), value = *value, non_temporal](size_t begin,
+                                                             size_t end) {
+        FillElements(tensor->data<T>(), begin, end, value, non_temporal);
+      },
+      [result = result.CopyRef()]() { result.emplace(); });
+  return result;
+}
+
+// Sets element i of the tensor to `start + i * step`, in parallel blocks.
+template <typename T>
+static AsyncValueRef<Chain> FillDenseTensorWithIota(
+    Argument<DenseHostTensor> in, Argument<Chain> in_chain, Attribute<T> start,
+    Attribute<T> step, const ExecutionContext& exec_ctx) {
+  auto result = MakeUnconstructedAsyncValueRef<Chain>();
+  ParallelFor(exec_ctx).Execute(
+      in->NumElements(),
+      ParallelFor::BlockSizes::Min(kMinFillBlockSize / sizeof(T)),
+      [tensor = in.ValueRef(), start = *start, step = *step](size_t begin,
+                                                             size_t end) {
+        // Each element is computed from its index rather than from the
+        // previous one, so that blocks are independent and floating point
+        // errors do not accumulate.
+        T* data = tensor->data<T>();
+        for (size_t i = begin; i < end; ++i)
+          data[i] = static_cast<T>(start + static_cast<T>(i) * step);
+      },
+      [result = result.CopyRef()]() { result.emplace(); });
+  return result;
 }
 
 template <typename T>
@@ -235,12 +331,106 @@ static TensorShape GetDenseTensorShape(const DenseHostTensor& t) {
   return t.shape();
 }
 
+// The minimum number of elements compared by a parallel block.
+static constexpr size_t kMinComparisonBlockSize = 64 * 1024;
+// The number of elements compared between checks for a mismatch found by
+// another block. The elements of a chunk are compared without branches, so
+// the comparison loop can be vectorized.
+static constexpr size_t kComparisonChunkSize = 1024;
+
+template <typename T>
+static double ElementError(T x, T y) {
+  if constexpr (is_complex_t<T>::value) {
+    return std::abs(x - y);
+  } else {
+    return std::abs(static_cast<double>(x) - static_cast<double>(y));
+  }
+}
+
+// The state shared by the parallel blocks of a tensor comparison.
+struct TensorComparison {
+  std::atomic<bool> mismatch{false};
+
+  mutex mu;
+  // The lowest index of a mismatching element found by any block. Blocks stop
+  // at their first mismatch and skip the rest of the tensor once any block
+  // found one, so this is not necessarily the first mismatch in the tensor.
+  size_t mismatch_index TFRT_GUARDED_BY(mu) = SIZE_MAX;
+  // The maximum absolute difference of the compared elements.
+  double max_error TFRT_GUARDED_BY(mu) = 0.0;
+};
+
+// Compares two tensors element wise with `close` in parallel blocks, and
+// prints a summary of the comparison to `errs()` if they differ.
+template <typename T, typename Close>
+static AsyncValueRef<bool> CompareTensors(const char* name,
+                                          AsyncValueRef<DenseHostTensor> lhs,
+                                          AsyncValueRef<DenseHostTensor> rhs,
+                                          Close close,
+                                          const ExecutionContext& exec_ctx) {
+  if (lhs->metadata() != rhs->metadata()) {
+    tfrt::errs() << name << ": metadata mismatch: " << lhs->metadata()
+                 << " vs " << rhs->metadata() << "\n";
+    return MakeAvailableAsyncValueRef<bool>(false);
+  }
+
+  const size_t size = lhs->NumElements();
+  auto comparison = std::make_shared<TensorComparison>();
+  auto result = MakeUnconstructedAsyncValueRef<bool>();
+
+  auto compute = [lhs = lhs.CopyRef(), rhs = rhs.CopyRef(), close,
+                  comparison](size_t begin, size_t end) {
+    const T* x = lhs->data<T>();
+    const T* y = rhs->data<T>();
+    double max_error = 0.0;
+    for (size_t chunk = begin; chunk < end; chunk += kComparisonChunkSize) {
+      if (comparison->mismatch.load(std::memory_order_relaxed)) break;
+      const size_t chunk_end = std::min(chunk + kComparisonChunkSize, end);
+
+      bool all_close = true;
+      for (size_t i = chunk; i < chunk_end; ++i) {
+        all_close &= close(x[i], y[i]);
+        max_error = std::max(max_error, ElementError(x[i], y[i]));
+      }
+      if (all_close) continue;
+
+      size_t index = chunk;
+      while (close(x[index], y[index])) ++index;
+      comparison->mismatch.store(true, std::memory_order_relaxed);
+      mutex_lock lock(comparison->mu);
+      comparison->mismatch_index = std::min(comparison->mismatch_index, index);
+      break;
+    }
+    mutex_lock lock(comparison->mu);
+    comparison->max_error = std::max(comparison->max_error, max_error);
+  };
+
+  auto on_done = [name, comparison, result = result.CopyRef()]() {
+    if (!comparison->mismatch.load(std::memory_order_relaxed)) {
+      result.emplace(true);
+      return;
+    }
+    mutex_lock lock(comparison->mu);
+    tfrt::errs() << name << ": element " << comparison->mismatch_index
+                 << " differs, max error: " << comparison->max_error << "\n";
+    result.emplace(false);
+  };
+
+  ParallelFor(exec_ctx).Execute(
+      size, ParallelFor::BlockSizes::Min(kMinComparisonBlockSize),
+      std::move(compute), std::move(on_done));
+  return result;
+}
+
 template <typename T>
 static void DenseTensorEqual(Argument<DenseHostTensor> t1,
                              Argument<DenseHostTensor> t2,
                              Argument<Chain> chain, Result<bool> output1,
-                             Result<Chain> output2) {
-  output1.Emplace(TensorEqual<T>(*t1, *t2));
+                             Result<Chain> output2,
+                             const ExecutionContext& exec_ctx) {
+  output1.Set(CompareTensors<T>(
+      "tfrt_dht.tensor_equal", t1.ValueRef(), t2.ValueRef(),
+      [](T x, T y) { return x == y; }, exec_ctx));
   // Reuse input chain.
   output2.Set(chain);
 }
@@ -250,8 +440,11 @@ template <typename T, int ULP = 2>
 static void DenseTensorAllClose(Argument<DenseHostTensor> t1,
                                 Argument<DenseHostTensor> t2,
                                 Argument<Chain> chain, Result<bool> output1,
-                                Result<Chain> output2) {
-  output1.Emplace(TensorApproxEqual<T, ULP>(*t1, *t2));
+                                Result<Chain> output2,
+                                const ExecutionContext& exec_ctx) {
+  output1.Set(CompareTensors<T>(
+      "tfrt_dht.tensor_allclose", t1.ValueRef(), t2.ValueRef(),
+      [](T x, T y) { return TensorElementsClose<T, ULP>(x, y); }, exec_ctx));
   // Reuse input chain.
   output2.Set(chain);
 }
@@ -285,6 +478,8 @@ static void RegisterDhtCreationKernelsForTypeAndRank(
   std::string suffix = t_name + "." + std::to_string(Rank);
   registry->AddKernel("tfrt_dht.create_uninitialized_tensor." + suffix,
                       TFRT_KERNEL(CreateUninitializedDenseTensor<T, Rank>));
+  registry->AddKernel("tfrt_dht.create_zeroed_tensor." + suffix,
+                      TFRT_KERNEL(CreateZeroedDenseTensor<T, Rank>));
 }
 
 template <typename T>
@@ -295,6 +490,11 @@ static void RegisterDhtCreationKernelsForType(KernelRegistry* registry,
   // uses a variable.
   registry->AddKernel("tfrt_dht.fill_tensor_with_constant." + suffix,
                       TFRT_KERNEL(FillDenseTensorWithConstantValue<T>));
+  // Only for the types with arithmetic, i.e. not for bool and the complex and
+  // half precision types.
+  if constexpr (std::is_arithmetic<T>::value && !std::is_same<T, bool>::value)
+    registry->AddKernel("tfrt_dht.fill_tensor_with_iota." + suffix,
+                        TFRT_KERNEL(FillDenseTensorWithIota<T>));
   registry->AddKernel("tfrt_dht.make_tensor." + suffix,
                       TFRT_KERNEL(MakeTensor<T>));
   registry->AddKernel("tfrt_dht.set_tensor_with_constant_values." + suffix,
@@ -0,0 +1,552 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements LookupTable.
+
+#include "tfrt/tensor/lookup_table.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/STLFunctionalExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/xxhash.h"
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/tensor/btf_mapped_file.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+namespace {
+
+// The header of a saved table. It is followed by:
+//   uint32_t seeds[num_buckets], padded to a multiple of 8 bytes,
+//   int64_t values[num_keys],
+// and for int64 keys by:
+//   int64_t keys[num_keys],
+// or for string keys by:
+//   uint64_t key_offsets[num_keys + 1],
+//   char key_bytes[num_key_bytes].
+// The values and keys are in slot order. All integers are little endian.
+struct TableHeader {
+  uint64_t magic;
+  uint32_t version;
+  LookupTable::KeyType key_type;
+  uint64_t num_keys;
+  uint64_t num_buckets;
+  uint64_t num_key_bytes;
+};
+
+constexpr uint64_t kTableMagic = 0x3154554c54524654;  // "TFRTLUT1"
+constexpr uint32_t kTableVersion = 1;
+
+// The average number of keys per bucket. Larger buckets take fewer seeds, but
+// more attempts to find seeds that send all of their keys to free slots.
+constexpr uint64_t kKeysPerBucket = 4;
+
+// The maximum number of seeds tried for one bucket. The last buckets need
+// about num_keys attempts, as only a few slots are still free.
+constexpr uint64_t kMaxSeedAttempts = std::numeric_limits<uint32_t>::max();
+
+// The number of keys whose lookups are interleaved in a batch.
+constexpr size_t kLookupGroupSize = 16;
+
+// The byte offsets of the sections of a table.
+struct TableLayout {
+  size_t seeds;
+  size_t values;
+  // The int64 keys, or the key offsets of string keys.
+  size_t keys;
+  size_t key_bytes;
+  size_t size;
+};
+
+TableLayout GetTableLayout(const TableHeader& header) {
+  TableLayout layout;
+  layout.seeds = sizeof(TableHeader);
+  layout.values =
+      layout.seeds + llvm::alignTo(header.num_buckets * sizeof(uint32_t), 8);
+  layout.keys = layout.values + header.num_keys * sizeof(int64_t);
+  if (header.key_type == LookupTable::KeyType::kInt64) {
+    layout.key_bytes = layout.keys + header.num_keys * sizeof(int64_t);
+    layout.size = layout.key_bytes;
+  } else {
+    layout.key_bytes = layout.keys + (header.num_keys + 1) * sizeof(uint64_t);
+    layout.size = layout.key_bytes + header.num_key_bytes;
+  }
+  return layout;
+}
+
+// The region of a table built in memory.
+class TableBuffer : public io::ReadOnlyMemoryRegion {
+ public:
+  explicit TableBuffer(size_t size)
+      : data_((size + sizeof(uint64_t) - 1) / sizeof(uint64_t)), size_(size) {}
+
+  const void* data() const override { return data_.data(); }
+  size_t length() const override { return size_; }
+
+  char* mutable_data() { return reinterpret_cast<char*>(data_.data()); }
+
+ private:
+  // Keeps the sections of the table 8 byte aligned.
+  std::vector<uint64_t> data_;
+  size_t size_;
+};
+
+// The finalizer of SplitMix64, a bijection on 64 bit values.
+uint64_t Mix(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111eb;
+  x ^= x >> 31;
+  return x;
+}
+
+// The hashes are part of the saved format, so they must not depend on the
+// process.
+uint64_t HashKey(string_view key) { return llvm::xxHash64(key); }
+uint64_t HashKey(int64_t key) { return Mix(static_cast<uint64_t>(key)); }
+
+// Maps `x` to [0, n) without a division.
+uint64_t Reduce(uint32_t x, uint64_t n) {
+  return (static_cast<uint64_t>(x) * n) >> 32;
+}
+
+uint64_t BucketOf(uint64_t hash, uint64_t num_buckets) {
+  return Reduce(static_cast<uint32_t>(hash), num_buckets);
+}
+
+uint64_t SlotOf(uint64_t hash, uint32_t seed, uint64_t num_slots) {
+  return Reduce(Mix(hash ^ (seed * 0x9e3779b97f4a7c15)) >> 32, num_slots);
+}
+
+void Prefetch(const void* address) {
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_prefetch(address);
+#endif
+}
+
+// Finds the seed of every bucket such that the keys of `hashes` go to distinct
+// slots, and stores the slot of every key in `slots`. `same_key(i, j)` tells
+// whether keys i and j, which have the same hash, are equal.
+Error BuildPerfectHash(ArrayRef<uint64_t> hashes,
+                       llvm::function_ref<bool(size_t, size_t)> same_key,
+                       MutableArrayRef<uint32_t> seeds,
+                       MutableArrayRef<uint64_t> slots) {
+  const size_t num_keys = hashes.size();
+  const size_t num_buckets = seeds.size();
+
+  // Sort the keys by bucket.
+  std::vector<uint32_t> bucket_begin(num_buckets + 1, 0);
+  for (uint64_t hash : hashes) ++bucket_begin[BucketOf(hash, num_buckets) + 1];
+  std::partial_sum(bucket_begin.begin(), bucket_begin.end(),
+                   bucket_begin.begin());
+  std::vector<uint32_t> keys(num_keys);
+  {
+    std::vector<uint32_t> next(bucket_begin.begin(), bucket_begin.end() - 1);
+    for (size_t i = 0; i < num_keys; ++i)
+      keys[next[BucketOf(hashes[i], num_buckets)]++] = i;
+  }
+
+  // Place the largest buckets first, while most slots are free.
+  std::vector<uint32_t> buckets(num_buckets);
+  std::iota(buckets.begin(), buckets.end(), 0);
+  auto bucket_size = [&](uint32_t bucket) {
+    return bucket_begin[bucket + 1] - bucket_begin[bucket];
+  };
+  std::stable_sort(buckets.begin(), buckets.end(), [&](uint32_t a, uint32_t b) {
+    return bucket_size(a) > bucket_size(b);
+  });
+
+  std::vector<bool> taken(num_keys, false);
+  llvm::SmallVector<uint64_t, 8> bucket_slots;
+  for (uint32_t bucket : buckets) {
+    ArrayRef<uint32_t> bucket_keys(keys.data() + bucket_begin[bucket],
+                                   bucket_size(bucket));
+    seeds[bucket] = 0;
+    if (bucket_keys.empty()) continue;
+
+    // Keys with the same hash would always go to the same slot.
+    for (size_t i = 0; i < bucket_keys.size(); ++i) {
+      for (size_t j = 0; j < i; ++j) {
+        if (hashes[bucket_keys[i]] != hashes[bucket_keys[j]]) continue;
+        if (same_key(bucket_keys[i], bucket_keys[j]))
+          return MakeStringError("duplicate key at index ", bucket_keys[i],
+                                 " of lookup table");
+        return MakeStringError("keys ", bucket_keys[j], " and ",
+                               bucket_keys[i], " of lookup table have the ",
+                               "same hash");
+      }
+    }
+
+    bool placed = false;
+    for (uint64_t seed = 0; seed < kMaxSeedAttempts && !placed; ++seed) {
+      bucket_slots.clear();
+      placed = true;
+      for (uint32_t key : bucket_keys) {
+        const uint64_t slot = SlotOf(hashes[key], seed, num_keys);
+        if (taken[slot] || llvm::is_contained(bucket_slots, slot)) {
+          placed = false;
+          break;
+        }
+        bucket_slots.push_back(slot);
+      }
+      if (!placed) continue;
+      seeds[bucket] = seed;
+      for (size_t i = 0; i < bucket_keys.size(); ++i) {
+        taken[bucket_slots[i]] = true;
+        slots[bucket_keys[i]] = bucket_slots[i];
+      }
+    }
+    if (!placed)
+      return MakeStringError("cannot find a perfect hash for lookup table");
+  }
+  return Error::success();
+}
+
+// Returns a table in which the key and value of every slot are still to be
+// written, and the slot of every key in `slots`.
+Expected<std::unique_ptr<TableBuffer>> BuildTable(
+    LookupTable::KeyType key_type, ArrayRef<uint64_t> hashes,
+    uint64_t num_key_bytes, llvm::function_ref<bool(size_t, size_t)> same_key,
+    std::vector<uint64_t>* slots) {
+  const size_t num_keys = hashes.size();
+  if (num_keys >= std::numeric_limits<uint32_t>::max())
+    return MakeStringError("too many keys for lookup table: ", num_keys);
+
+  TableHeader header;
+  header.magic = kTableMagic;
+  header.version = kTableVersion;
+  header.key_type = key_type;
+  header.num_keys = num_keys;
+  header.num_buckets =
+      std::max<uint64_t>(1, (num_keys + kKeysPerBucket - 1) / kKeysPerBucket);
+  header.num_key_bytes = num_key_bytes;
+  const TableLayout layout = GetTableLayout(header);
+
+  auto buffer = std::make_unique<TableBuffer>(layout.size);
+  char* data = buffer->mutable_data();
+  std::memcpy(data, &header, sizeof(header));
+  slots->resize(num_keys);
+  if (auto error = BuildPerfectHash(
+          hashes, same_key,
+          MutableArrayRef<uint32_t>(
+              reinterpret_cast<uint32_t*>(data + layout.seeds),
+              header.num_buckets),
+          *slots))
+    return std::move(error);
+  return std::move(buffer);
+}
+
+// Maps the file at `path` with the file system registered for its scheme.
+Expected<std::unique_ptr<io::ReadOnlyMemoryRegion>> MapFile(string_view path) {
+  io::FileSystem* file_system =
+      io::FileSystemRegistry::Default()->LookupForPath(path);
+  if (file_system == nullptr)
+    return MakeStringError("no file system registered for file ", path);
+
+  std::unique_ptr<io::ReadOnlyMemoryRegion> region;
+  if (auto error =
+          file_system->NewReadOnlyMemoryRegion(std::string(path), &region))
+    return std::move(error);
+  return std::move(region);
+}
+
+}  // namespace
+
+Expected<RCReference<LookupTable>> LookupTable::Create(
+    ArrayRef<string_view> keys, ArrayRef<int64_t> values) {
+  if (keys.size() != values.size())
+    return MakeStringError("lookup table has ", keys.size(), " keys but ",
+                           values.size(), " values");
+
+  std::vector<uint64_t> hashes(keys.size());
+  uint64_t num_key_bytes = 0;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    hashes[i] = HashKey(keys[i]);
+    num_key_bytes += keys[i].size();
+  }
+
+  std::vector<uint64_t> slots;
+  auto buffer = BuildTable(
+      KeyType::kString, hashes, num_key_bytes,
+      [&](size_t i, size_t j) { return keys[i] == keys[j]; }, &slots);
+  if (!buffer) return buffer.takeError();
+
+  // Write the keys in slot order.
+  const TableLayout layout = GetTableLayout(
+      *reinterpret_cast<const TableHeader*>((*buffer)->data()));
+  char* data = (*buffer)->mutable_data();
+  auto* table_values = reinterpret_cast<int64_t*>(data + layout.values);
+  auto* key_offsets = reinterpret_cast<uint64_t*>(data + layout.keys);
+  std::vector<uint32_t> slot_keys(keys.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    table_values[slots[i]] = values[i];
+    slot_keys[slots[i]] = i;
+  }
+  uint64_t offset = 0;
+  for (size_t slot = 0; slot < keys.size(); ++slot) {
+    string_view key = keys[slot_keys[slot]];
+    key_offsets[slot] = offset;
+    if (!key.empty())
+      std::memcpy(data + layout.key_bytes + offset, key.data(), key.size());
+    offset += key.size();
+  }
+  key_offsets[keys.size()] = offset;
+
+  return Parse(std::move(*buffer), "<memory>");
+}
+
+Expected<RCReference<LookupTable>> LookupTable::Create(
+    ArrayRef<int64_t> keys, ArrayRef<int64_t> values) {
+  if (keys.size() != values.size())
+    return MakeStringError("lookup table has ", keys.size(), " keys but ",
+                           values.size(), " values");
+
+  std::vector<uint64_t> hashes(keys.size());
+  for (size_t i = 0; i < keys.size(); ++i) hashes[i] = HashKey(keys[i]);
+
+  // The hash of int64 keys is a bijection, so keys with the same hash are
+  // equal.
+  std::vector<uint64_t> slots;
+  auto buffer = BuildTable(
+      KeyType::kInt64, hashes, /*num_key_bytes=*/0,
+      [](size_t, size_t) { return true; }, &slots);
+  if (!buffer) return buffer.takeError();
+
+  const TableLayout layout = GetTableLayout(
+      *reinterpret_cast<const TableHeader*>((*buffer)->data()));
+  char* data = (*buffer)->mutable_data();
+  auto* table_values = reinterpret_cast<int64_t*>(data + layout.values);
+  auto* table_keys = reinterpret_cast<int64_t*>(data + layout.keys);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    table_values[slots[i]] = values[i];
+    table_keys[slots[i]] = keys[i];
+  }
+
+  return Parse(std::move(*buffer), "<memory>");
+}
+
+Expected<RCReference<LookupTable>> LookupTable::CreateFromTextFile(
+    string_view path) {
+  auto region = MapFile(path);
+  if (!region) return region.takeError();
+  string_view text(static_cast<const char*>((*region)->data()),
+                   (*region)->length());
+  llvm::SmallVector<string_view, 0> lines;
+  if (!text.empty()) {
+    // A final line break does not start another key.
+    if (text.ends_with("\n")) text = text.drop_back();
+    text.split(lines, '\n');
+  }
+
+  std::vector<string_view> keys;
+  std::vector<int64_t> values;
+  for (string_view line : lines) {
+    if (line.ends_with("\r")) line = line.drop_back();
+
+    string_view key, value;
+    std::tie(key, value) = line.split('\t');
+    int64_t id = keys.size();
+    if (key.size() != line.size() && value.getAsInteger(10, id))
+      return MakeStringError("invalid value '", value, "' on line ",
+                             keys.size() + 1, " of lookup table file ", path);
+    keys.push_back(key);
+    values.push_back(id);
+  }
+
+  // The keys are copied into the table, so the file can be unmapped.
+  return Create(keys, values);
+}
+
+Expected<RCReference<LookupTable>> LookupTable::CreateFromBTFFile(
+    string_view path, HostContext* host) {
+  auto file = MappedBTFFile::Open(path);
+  if (!file) return file.takeError();
+  if ((*file)->num_tensors() < 2)
+    return MakeStringError("lookup table file ", path,
+                           " must have a key and a value tensor");
+
+  auto keys = (*file)->GetDenseHostTensor(0, host);
+  if (!keys) return keys.takeError();
+  auto values = (*file)->GetDenseHostTensor(1, host);
+  if (!values) return values.takeError();
+  for (const DenseHostTensor* tensor : {&*keys, &*values}) {
+    if (tensor->dtype() != DType(DType::I64) || tensor->shape().GetRank() != 1)
+      return MakeStringError("lookup table file ", path,
+                             " must have rank 1 i64 tensors, got ",
+                             tensor->metadata());
+  }
+
+  return Create(ArrayRef<int64_t>(keys->data<int64_t>(), keys->NumElements()),
+                ArrayRef<int64_t>(values->data<int64_t>(),
+                                  values->NumElements()));
+}
+
+Expected<RCReference<LookupTable>> LookupTable::Open(string_view path) {
+  auto region = MapFile(path);
+  if (!region) return region.takeError();
+  return Parse(std::move(*region), path);
+}
+
+Expected<RCReference<LookupTable>> LookupTable::Parse(
+    std::unique_ptr<io::ReadOnlyMemoryRegion> region, string_view source) {
+  const char* data = static_cast<const char*>(region->data());
+  const size_t length = region->length();
+  TableHeader header;
+  if (length < sizeof(header))
+    return MakeStringError("lookup table ", source, " is truncated");
+  std::memcpy(&header, data, sizeof(header));
+  if (header.magic != kTableMagic || header.version != kTableVersion ||
+      (header.key_type != KeyType::kString &&
+       header.key_type != KeyType::kInt64))
+    return MakeStringError(source, " is not a lookup table");
+
+  // Bound the counts before computing the layout, so that it cannot overflow.
+  if (header.num_keys >= std::numeric_limits<uint32_t>::max() ||
+      header.num_buckets == 0 ||
+      header.num_buckets >= std::numeric_limits<uint32_t>::max() ||
+      header.num_key_bytes > length)
+    return MakeStringError("lookup table ", source, " is corrupted");
+  const TableLayout layout = GetTableLayout(header);
+  if (layout.size > length)
+    return MakeStringError("lookup table ", source, " is truncated");
+
+  auto table = TakeRef(new LookupTable(std::move(region)));
+  table->key_type_ = header.key_type;
+  table->seeds_ = ArrayRef<uint32_t>(
+      reinterpret_cast<const uint32_t*>(data + layout.seeds),
+      header.num_buckets);
+  table->values_ = ArrayRef<int64_t>(
+      reinterpret_cast<const int64_t*>(data + layout.values), header.num_keys);
+  if (header.key_type == KeyType::kInt64) {
+    table->int_keys_ = ArrayRef<int64_t>(
+        reinterpret_cast<const int64_t*>(data + layout.keys), header.num_keys);
+    return std::move(table);
+  }
+
+  table->key_offsets_ = ArrayRef<uint64_t>(
+      reinterpret_cast<const uint64_t*>(data + layout.keys),
+      header.num_keys + 1);
+  table->key_bytes_ = data + layout.key_bytes;
+  // Lookups read the key bytes at these offsets.
+  uint64_t offset = 0;
+  for (uint64_t next : table->key_offsets_) {
+    if (next < offset || next > header.num_key_bytes)
+      return MakeStringError("lookup table ", source, " is corrupted");
+    offset = next;
+  }
+  if (table->key_offsets_.front() != 0 || offset != header.num_key_bytes)
+    return MakeStringError("lookup table ", source, " is corrupted");
+  return std::move(table);
+}
+
+Error LookupTable::Save(string_view path) const {
+  io::FileSystem* file_system =
+      io::FileSystemRegistry::Default()->LookupForPath(path);
+  if (file_system == nullptr)
+    return MakeStringError("no file system registered for file ", path);
+
+  std::unique_ptr<io::WritableFile> file;
+  if (auto error = file_system->NewWritableFile(std::string(path), &file))
+    return error;
+  if (auto error = file->Append({string_view(
+          static_cast<const char*>(region_->data()), region_->length())}))
+    return error;
+  return file->Close();
+}
+
+uint64_t LookupTable::GetSlot(uint64_t hash) const {
+  const uint32_t seed = seeds_[BucketOf(hash, seeds_.size())];
+  return SlotOf(hash, seed, values_.size());
+}
+
+int64_t LookupTable::Lookup(string_view key, int64_t default_value) const {
+  assert(key_type_ == KeyType::kString);
+  if (values_.empty()) return default_value;
+  const uint64_t slot = GetSlot(HashKey(key));
+  return HasKeyAt(slot, key) ? values_[slot] : default_value;
+}
+
+int64_t LookupTable::Lookup(int64_t key, int64_t default_value) const {
+  assert(key_type_ == KeyType::kInt64);
+  if (values_.empty()) return default_value;
+  const uint64_t slot = GetSlot(HashKey(key));
+  return int_keys_[slot] == key ? values_[slot] : default_value;
+}
+
+template <typename Key>
+void LookupTable::LookupBatch(ArrayRef<Key> keys, int64_t default_value,
+                              MutableArrayRef<int64_t> values) const {
+  assert(keys.size() == values.size());
+  if (values_.empty()) {
+    std::fill(values.begin(), values.end(), default_value);
+    return;
+  }
+
+  // Every lookup reads the seed of its bucket, and then the key and value of
+  // its slot. The keys of a group go through each step together, so that the
+  // reads of one step are prefetched for all keys before any is used.
+  uint64_t hashes[kLookupGroupSize];
+  uint64_t slots[kLookupGroupSize];
+  for (size_t begin = 0; begin < keys.size(); begin += kLookupGroupSize) {
+    const size_t size = std::min(kLookupGroupSize, keys.size() - begin);
+    for (size_t i = 0; i < size; ++i) {
+      hashes[i] = HashKey(keys[begin + i]);
+      Prefetch(&seeds_[BucketOf(hashes[i], seeds_.size())]);
+    }
+    for (size_t i = 0; i < size; ++i) {
+      slots[i] = GetSlot(hashes[i]);
+      Prefetch(&values_[slots[i]]);
+      if (key_type_ == KeyType::kInt64) {
+        Prefetch(&int_keys_[slots[i]]);
+      } else {
+        Prefetch(&key_offsets_[slots[i]]);
+      }
+    }
+    for (size_t i = 0; i < size; ++i) {
+      const Key& key = keys[begin + i];
+      bool found;
+      if constexpr (std::is_same<Key, int64_t>::value) {
+        found = int_keys_[slots[i]] == key;
+      } else {
+        found = HasKeyAt(slots[i], key);
+      }
+      values[begin + i] = found ? values_[slots[i]] : default_value;
+    }
+  }
+}
+
+void LookupTable::Lookup(ArrayRef<std::string> keys, int64_t default_value,
+                         MutableArrayRef<int64_t> values) const {
+  assert(key_type_ == KeyType::kString);
+  LookupBatch(keys, default_value, values);
+}
+
+void LookupTable::Lookup(ArrayRef<int64_t> keys, int64_t default_value,
+                         MutableArrayRef<int64_t> values) const {
+  assert(key_type_ == KeyType::kInt64);
+  LookupBatch(keys, default_value, values);
+}
+
+}  // namespace tfrt
@@ -0,0 +1,157 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements kernels for lookup tables.
+
+#include "tfrt/tensor/lookup_table_kernels.h"
+
+#include <string>
+
+#include "tfrt/host_context/async_dispatch.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/kernel_utils.h"
+#include "tfrt/host_context/resource_context.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/support/string_util.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/lookup_table.h"
+#include "tfrt/tensor/string_host_tensor.h"
+
+namespace tfrt {
+
+std::string GetLookupTableResourceName(string_view name) {
+  return StrCat("tfrt_lut.table.", name);
+}
+
+namespace {
+
+// Reads a table in `format`: "text" or "btf" to build it from a text or BTF
+// file (see LookupTable), or "table" to map a table saved by
+// LookupTable::Save().
+Expected<RCReference<LookupTable>> ReadLookupTable(string_view format,
+                                                   string_view path,
+                                                   HostContext* host) {
+  if (format == "text") return LookupTable::CreateFromTextFile(path);
+  if (format == "btf") return LookupTable::CreateFromBTFFile(path, host);
+  if (format == "table") return LookupTable::Open(path);
+  return MakeStringError("unknown lookup table format: ", format);
+}
+
+// Loads the table at `path` as `name` into the ResourceContext, unless it has
+// a table of that name already. The file is read in a blocking work thread.
+AsyncValueRef<Chain> LoadTable(Argument<Chain> in_chain,
+                               StringAttribute format, StringAttribute name,
+                               StringAttribute path,
+                               const ExecutionContext& exec_ctx) {
+  ResourceContext* resource_context = exec_ctx.resource_context();
+  if (resource_context == nullptr)
+    return EmitErrorAsync(exec_ctx,
+                          "tfrt_lut.load_table requires a ResourceContext");
+
+  std::string resource_name = GetLookupTableResourceName(name);
+  if (resource_context->GetResource<RCReference<LookupTable>>(resource_name))
+    return in_chain.ValueRef();
+
+  auto result = MakeUnconstructedAsyncValueRef<Chain>();
+  bool enqueued = EnqueueBlockingWork(
+      exec_ctx.host(),
+      [exec_ctx, result = result.CopyRef(),
+       resource_name = std::move(resource_name), format = format.str(),
+       path = path.str()]() {
+        auto table = ReadLookupTable(format, path, exec_ctx.host());
+        if (!table) {
+          result.SetError(absl::InternalError(toString(table.takeError())));
+          return;
+        }
+        // Concurrent loads of the same table keep the first one.
+        exec_ctx.resource_context()
+            ->GetOrCreateResource<RCReference<LookupTable>>(
+                resource_name, std::move(*table));
+        result.emplace();
+      });
+  if (!enqueued)
+    return EmitErrorAsync(exec_ctx, "failed to enqueue a lookup table load");
+  return result;
+}
+
+// Returns the table `name` of the ResourceContext, whose keys must have
+// `key_type`.
+Expected<const LookupTable*> GetLookupTable(string_view name,
+                                            LookupTable::KeyType key_type,
+                                            const ExecutionContext& exec_ctx) {
+  ResourceContext* resource_context = exec_ctx.resource_context();
+  if (resource_context == nullptr)
+    return MakeStringError("lookup tables require a ResourceContext");
+  auto table = resource_context->GetResource<RCReference<LookupTable>>(
+      GetLookupTableResourceName(name));
+  if (!table) return MakeStringError("no lookup table named ", name);
+  if ((**table)->key_type() != key_type)
+    return MakeStringError("lookup table ", name, " has other key types");
+  return (*table)->get();
+}
+
+// Returns the values of the string `keys` in the table `table`, or
+// `default_value` for keys the table does not have.
+Expected<DenseHostTensor> LookupStrings(const StringHostTensor& keys,
+                                        Argument<Chain> chain,
+                                        Attribute<int64_t> default_value,
+                                        StringAttribute table,
+                                        const ExecutionContext& exec_ctx) {
+  auto lookup_table =
+      GetLookupTable(table, LookupTable::KeyType::kString, exec_ctx);
+  if (!lookup_table) return lookup_table.takeError();
+
+  auto values = DenseHostTensor::CreateUninitialized<int64_t>(keys.shape(),
+                                                              exec_ctx.host());
+  if (!values) return MakeStringError("cannot allocate tensor");
+  (*lookup_table)
+      ->Lookup(keys.strings(), *default_value,
+               MutableArrayRef<int64_t>(values->data<int64_t>(),
+                                        values->NumElements()));
+  return std::move(*values);
+}
+
+// Same as above, for a DenseHostTensor of int64 keys.
+Expected<DenseHostTensor> LookupInt64s(const DenseHostTensor& keys,
+                                       Argument<Chain> chain,
+                                       Attribute<int64_t> default_value,
+                                       StringAttribute table,
+                                       const ExecutionContext& exec_ctx) {
+  if (keys.dtype() != DType(DType::I64))
+    return MakeStringError("tfrt_lut.lookup.i64 expects i64 keys, got ",
+                           keys.dtype());
+  auto lookup_table =
+      GetLookupTable(table, LookupTable::KeyType::kInt64, exec_ctx);
+  if (!lookup_table) return lookup_table.takeError();
+
+  auto values = DenseHostTensor::CreateUninitialized<int64_t>(keys.shape(),
+                                                              exec_ctx.host());
+  if (!values) return MakeStringError("cannot allocate tensor");
+  (*lookup_table)
+      ->Lookup(ArrayRef<int64_t>(keys.data<int64_t>(), keys.NumElements()),
+               *default_value,
+               MutableArrayRef<int64_t>(values->data<int64_t>(),
+                                        values->NumElements()));
+  return std::move(*values);
+}
+
+}  // namespace
+
+void RegisterLookupTableKernels(KernelRegistry* registry) {
+  registry->AddKernel("tfrt_lut.load_table", TFRT_KERNEL(LoadTable));
+  registry->AddKernel("tfrt_lut.lookup.str", TFRT_KERNEL(LookupStrings));
+  registry->AddKernel("tfrt_lut.lookup.i64", TFRT_KERNEL(LookupInt64s));
+}
+
+}  // namespace tfrt
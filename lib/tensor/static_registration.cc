@@ -16,11 +16,15 @@
 // kernels in this directory.  This can be used to simplify clients that don't
 // care about selective registration of kernels.
 
+#include "tfrt/host_context/function_result_cache.h"
 #include "tfrt/host_context/kernel_registry.h"
+#include "tfrt/tensor/contiguous_string_host_tensor.h"
 #include "tfrt/tensor/conversion_registry.h"
 #include "tfrt/tensor/coo_host_tensor.h"
+#include "tfrt/tensor/csr_host_tensor.h"
 #include "tfrt/tensor/dense_host_tensor.h"
 #include "tfrt/tensor/dense_host_tensor_kernels.h"
+#include "tfrt/tensor/lookup_table_kernels.h"
 #include "tfrt/tensor/scalar_host_tensor.h"
 #include "tfrt/tensor/string_host_tensor.h"
 #include "tfrt/tensor/string_host_tensor_kernels.h"
@@ -34,6 +38,7 @@ static void Register(KernelRegistry* registry) {
   RegisterDenseHostTensorKernels(registry);
   RegisterCooHostTensorKernels(registry);
   RegisterStringHostTensorKernels(registry);
+  RegisterLookupTableKernels(registry);
 }
 
 TFRT_STATIC_KERNEL_REGISTRATION(Register);
@@ -41,10 +46,17 @@ TFRT_STATIC_KERNEL_REGISTRATION(Register);
 // TODO(fishx): Create a macro for this registration.
 static bool host_conversion_fn_registration = []() {
   AddStaticTensorConversionFn(RegisterCooHostTensorConversionFn);
+  AddStaticTensorConversionFn(RegisterCsrHostTensorConversionFn);
   AddStaticTensorConversionFn(RegisterDenseHostTensorConversionFn);
   AddStaticTensorConversionFn(RegisterStringHostTensorConversionFn);
+  AddStaticTensorConversionFn(RegisterContiguousStringHostTensorConversionFn);
   AddStaticTensorConversionFn(RegisterScalarHostTensorConversionFn);
   return true;
 }();
 
+static bool memoization_key_encoder_registration = []() {
+  AddStaticMemoizationKeyEncoder(EncodeDenseHostTensorMemoizationKey);
+  return true;
+}();
+
 }  // namespace tfrt
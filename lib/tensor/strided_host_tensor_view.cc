@@ -0,0 +1,173 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file implements StridedHostTensorView.
+
+#include "tfrt/tensor/strided_host_tensor_view.h"
+
+#include <cstring>
+#include <optional>
+#include <utility>
+
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/tensor/tensor_shape.h"
+
+namespace tfrt {
+namespace {
+
+// Copies the elements of dimension `dim` and all the inner dimensions from the
+// strided `src` to the contiguous `dst`, and returns the end of `dst`.
+char* CopyStrided(const char* src, char* dst, ArrayRef<Index> dims,
+                  ArrayRef<Index> strides, size_t element_size, size_t dim) {
+  const ptrdiff_t stride = strides[dim] * static_cast<ptrdiff_t>(element_size);
+  if (dim + 1 == dims.size()) {
+    if (strides[dim] == 1) {
+      std::memcpy(dst, src, dims[dim] * element_size);
+      return dst + dims[dim] * element_size;
+    }
+    for (Index i = 0; i < dims[dim]; ++i, src += stride, dst += element_size)
+      std::memcpy(dst, src, element_size);
+    return dst;
+  }
+  for (Index i = 0; i < dims[dim]; ++i, src += stride)
+    dst = CopyStrided(src, dst, dims, strides, element_size, dim + 1);
+  return dst;
+}
+
+}  // namespace
+
+StridedHostTensorView::StridedHostTensorView(const DenseHostTensor& dht)
+    : metadata_(dht.metadata()), buffer_(dht.buffer()) {
+  dht.shape().GetStrides(&strides_);
+}
+
+StridedHostTensorView::StridedHostTensorView(const TensorMetadata& metadata,
+                                             RCReference<HostBuffer> buffer,
+                                             Index offset,
+                                             ArrayRef<Index> strides)
+    : metadata_(metadata),
+      buffer_(std::move(buffer)),
+      offset_(offset),
+      strides_(strides.begin(), strides.end()) {
+  assert(strides_.size() == metadata_.shape.GetRank());
+}
+
+bool StridedHostTensorView::IsContiguous() const {
+  if (NumElements() == 0) return true;
+  Index expected_stride = 1;
+  for (int i = shape().GetRank() - 1; i >= 0; --i) {
+    const Index dim = shape().GetDimensionSize(i);
+    // The stride of a dimension with a single element is never used.
+    if (dim == 1) continue;
+    if (strides_[i] != expected_stride) return false;
+    expected_stride *= dim;
+  }
+  return true;
+}
+
+StridedHostTensorView StridedHostTensorView::Slice(ArrayRef<Index> begin,
+                                                   ArrayRef<Index> size) const {
+  assert(begin.size() == strides_.size() && size.size() == strides_.size());
+  Index offset = offset_;
+  for (int i = 0; i < strides_.size(); ++i) {
+    assert(begin[i] >= 0 && size[i] >= 0);
+    assert(begin[i] + size[i] <= shape().GetDimensionSize(i));
+    offset += begin[i] * strides_[i];
+  }
+  return StridedHostTensorView(TensorMetadata(dtype(), size), buffer_, offset,
+                               strides_);
+}
+
+StridedHostTensorView StridedHostTensorView::StridedSlice(
+    ArrayRef<Index> begin, ArrayRef<Index> end, ArrayRef<Index> strides) const {
+  assert(begin.size() == strides_.size() && end.size() == strides_.size() &&
+         strides.size() == strides_.size());
+  llvm::SmallVector<Index, 4> dims(strides_.size());
+  llvm::SmallVector<Index, 4> new_strides(strides_.size());
+  Index offset = offset_;
+  for (int i = 0; i < strides_.size(); ++i) {
+    assert(strides[i] != 0);
+    const Index distance = strides[i] > 0 ? end[i] - begin[i]
+                                          : begin[i] - end[i];
+    const Index step = strides[i] > 0 ? strides[i] : -strides[i];
+    dims[i] = distance > 0 ? (distance + step - 1) / step : 0;
+    if (dims[i] > 0) {
+      assert(begin[i] >= 0 && begin[i] < shape().GetDimensionSize(i));
+      offset += begin[i] * strides_[i];
+    }
+    new_strides[i] = strides_[i] * strides[i];
+  }
+  return StridedHostTensorView(TensorMetadata(dtype(), dims), buffer_, offset,
+                               new_strides);
+}
+
+StridedHostTensorView StridedHostTensorView::Transpose(
+    ArrayRef<Index> perm) const {
+  assert(perm.size() == strides_.size());
+  llvm::SmallVector<Index, 4> dims(strides_.size());
+  llvm::SmallVector<Index, 4> new_strides(strides_.size());
+  for (int i = 0; i < strides_.size(); ++i) {
+    assert(perm[i] >= 0 && perm[i] < strides_.size());
+    dims[i] = shape().GetDimensionSize(perm[i]);
+    new_strides[i] = strides_[perm[i]];
+  }
+  return StridedHostTensorView(TensorMetadata(dtype(), dims), buffer_, offset_,
+                               new_strides);
+}
+
+Index StridedHostTensorView::OffsetOf(ArrayRef<Index> coord) const {
+  assert(coord.size() == strides_.size());
+  Index offset = offset_;
+  for (int i = 0; i < strides_.size(); ++i) {
+    assert(coord[i] >= 0 && coord[i] < shape().GetDimensionSize(i));
+    offset += coord[i] * strides_[i];
+  }
+  return offset;
+}
+
+std::optional<DenseHostTensor> StridedHostTensorView::ToDenseHostTensor(
+    HostContext* host) const {
+  return ToDenseHostTensor(host->allocator());
+}
+
+std::optional<DenseHostTensor> StridedHostTensorView::ToDenseHostTensor(
+    HostAllocator* allocator) const {
+  const size_t element_size = GetHostSize(dtype());
+
+  if (NumElements() == 0)
+    return DenseHostTensor(metadata_,
+                           HostBuffer::CreateFromExternal(buffer_, 0, 0));
+
+  if (IsContiguous())
+    return DenseHostTensor(
+        metadata_,
+        HostBuffer::CreateFromExternal(buffer_, offset_ * element_size,
+                                       metadata_.GetHostSizeInBytes()));
+
+  auto dht = DenseHostTensor::CreateUninitialized(metadata_, allocator);
+  if (!dht) return std::nullopt;
+
+  // A scalar view is always contiguous, so the rank is at least 1 here.
+  llvm::SmallVector<Index, 4> dims;
+  shape().GetDimensions(&dims);
+  CopyStrided(static_cast<const char*>(buffer_->data()) +
+                  offset_ * static_cast<ptrdiff_t>(element_size),
+              static_cast<char*>(dht->data()), dims, strides_, element_size,
+              /*dim=*/0);
+  return dht;
+}
+
+}  // namespace tfrt
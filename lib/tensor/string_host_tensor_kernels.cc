@@ -16,10 +16,23 @@
 
 #include "tfrt/tensor/string_host_tensor_kernels.h"
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "tfrt/host_context/diagnostic.h"
 #include "tfrt/host_context/kernel_utils.h"
+#include "tfrt/host_context/parallel_for.h"
 #include "tfrt/host_context/sync_kernel_utils.h"
 #include "tfrt/support/error_util.h"
+#include "tfrt/support/string_util.h"
+#include "tfrt/tensor/contiguous_string_host_tensor.h"
+#include "tfrt/tensor/dense_host_tensor.h"
 #include "tfrt/tensor/string_host_tensor.h"
+#include "tfrt/tensor/tensor_serialize_utils.h"
 
 namespace tfrt {
 namespace {
@@ -54,11 +67,268 @@ static Expected<StringHostTensor> CreateUninitializedStringTensor(
   return std::move(*result);
 }
 
+//===----------------------------------------------------------------------===//
+// ContiguousStringHostTensor kernels
+//
+// The kernels below compute the offsets of their result first, and then fill
+// the bytes of all elements in parallel blocks. Each result takes one buffer
+// for the bytes and one for the offsets, instead of a std::string per element.
+//===----------------------------------------------------------------------===//
+
+// The minimum number of elements, and of bytes, of the parallel blocks of the
+// string kernels. Smaller blocks cost more to schedule than to process.
+constexpr size_t kMinStringBlockSize = 1024;
+constexpr size_t kMinByteBlockSize = 64 * 1024;
+
+Expected<ContiguousStringHostTensor> CreateContiguousStringTensor(
+    ArrayAttribute<Index> shape, AggregateAttr values,
+    AsyncKernelFrame* frame) {
+  return CreateConstantContiguousStringHostTensor(TensorShape(shape.data()),
+                                                  values, *frame);
+}
+
+// Returns the uninitialized offsets of a tensor with `num_elements` elements.
+RCReference<HostBuffer> AllocateOffsets(size_t num_elements,
+                                        HostContext* host) {
+  return HostBuffer::CreateUninitialized(
+      (num_elements + 1) * sizeof(uint64_t), alignof(uint64_t),
+      host->allocator());
+}
+
+// Returns the uninitialized bytes of a tensor. The buffer is kept non-empty,
+// so that its data pointer is valid.
+RCReference<HostBuffer> AllocateBytes(size_t size, HostContext* host) {
+  return HostBuffer::CreateUninitialized(std::max<size_t>(size, 1),
+                                         alignof(char), host->allocator());
+}
+
+// Concatenates the elements of `lhs` and `rhs` element wise.
+AsyncValueRef<ContiguousStringHostTensor> ConcatStrings(
+    Argument<ContiguousStringHostTensor> lhs,
+    Argument<ContiguousStringHostTensor> rhs,
+    const ExecutionContext& exec_ctx) {
+  if (lhs->shape() != rhs->shape()) {
+    return EmitErrorAsync(exec_ctx, StrCat("tfrt_sht.concat: shape mismatch: ",
+                                           lhs->shape(), " vs ",
+                                           rhs->shape()));
+  }
+
+  const size_t num_elements = lhs->NumElements();
+  auto offsets = AllocateOffsets(num_elements, exec_ctx.host());
+  if (!offsets) return EmitErrorAsync(exec_ctx, "cannot allocate offsets");
+  auto* offsets_data = static_cast<uint64_t*>(offsets->data());
+  ArrayRef<uint64_t> lhs_offsets = lhs->offsets();
+  ArrayRef<uint64_t> rhs_offsets = rhs->offsets();
+  for (size_t i = 0; i <= num_elements; ++i)
+    offsets_data[i] = lhs_offsets[i] + rhs_offsets[i];
+
+  auto bytes = AllocateBytes(offsets_data[num_elements], exec_ctx.host());
+  if (!bytes) return EmitErrorAsync(exec_ctx, "cannot allocate bytes");
+
+  auto result = MakeUnconstructedAsyncValueRef<ContiguousStringHostTensor>();
+  auto compute = [lhs = lhs.ValueRef(), rhs = rhs.ValueRef(),
+                  offsets = offsets.CopyRef(),
+                  bytes = bytes.CopyRef()](size_t begin, size_t end) {
+    const auto* offsets_data = static_cast<const uint64_t*>(offsets->data());
+    auto* bytes_data = static_cast<char*>(bytes->data());
+    for (size_t i = begin; i < end; ++i) {
+      string_view x = lhs->GetString(i);
+      string_view y = rhs->GetString(i);
+      char* out = bytes_data + offsets_data[i];
+      if (!x.empty()) std::memcpy(out, x.data(), x.size());
+      if (!y.empty()) std::memcpy(out + x.size(), y.data(), y.size());
+    }
+  };
+  auto on_done = [shape = lhs->shape(), offsets = std::move(offsets),
+                  bytes = std::move(bytes), result = result.CopyRef()]() {
+    result.emplace(shape, bytes.CopyRef(), offsets.CopyRef());
+  };
+  ParallelFor(exec_ctx).Execute(
+      num_elements, ParallelFor::BlockSizes::Adaptive(kMinStringBlockSize),
+      std::move(compute), std::move(on_done));
+  return result;
+}
+
+// Converts the ASCII upper case letters of the elements to lower case. The
+// element sizes do not change, so the result shares the offsets of the input
+// and the bytes are converted in blocks regardless of element boundaries.
+AsyncValueRef<ContiguousStringHostTensor> LowerStrings(
+    Argument<ContiguousStringHostTensor> input,
+    const ExecutionContext& exec_ctx) {
+  const size_t size = input->bytes().size();
+  auto bytes = AllocateBytes(size, exec_ctx.host());
+  if (!bytes) return EmitErrorAsync(exec_ctx, "cannot allocate bytes");
+
+  auto result = MakeUnconstructedAsyncValueRef<ContiguousStringHostTensor>();
+  auto compute = [input = input.ValueRef(), bytes = bytes.CopyRef()](
+                     size_t begin, size_t end) {
+    const char* in = input->bytes().data();
+    auto* out = static_cast<char*>(bytes->data());
+    for (size_t i = begin; i < end; ++i) {
+      const char c = in[i];
+      out[i] = c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+    }
+  };
+  auto on_done = [input = input.ValueRef(), bytes = std::move(bytes),
+                  result = result.CopyRef()]() {
+    result.emplace(input->shape(), bytes.CopyRef(),
+                   input->offsets_buffer().CopyRef());
+  };
+  ParallelFor(exec_ctx).Execute(
+      size, ParallelFor::BlockSizes::Min(kMinByteBlockSize),
+      std::move(compute), std::move(on_done));
+  return result;
+}
+
+// The state shared by the parallel passes of tfrt_sht.split.
+struct StringSplit {
+  AsyncValueRef<ContiguousStringHostTensor> input;
+  std::array<bool, 256> is_delimiter = {};
+  // The number of tokens of every element, and then the index of the first
+  // token of every element. Holds NumElements() + 1 int64_t values.
+  DenseHostTensor row_splits;
+  // The number of token bytes of every element, and then the offset of the
+  // first token byte of every element.
+  std::vector<uint64_t> byte_offsets;
+  RCReference<HostBuffer> offsets;
+  RCReference<HostBuffer> bytes;
+
+  // Calls `fn(token)` for the maximal delimiter-free ranges of `str`.
+  template <typename F>
+  void ForEachToken(string_view str, F fn) const {
+    size_t begin = 0;
+    for (size_t i = 0; i <= str.size(); ++i) {
+      if (i < str.size() && !is_delimiter[static_cast<uint8_t>(str[i])])
+        continue;
+      if (i > begin) fn(str.slice(begin, i));
+      begin = i + 1;
+    }
+  }
+};
+
+// Splits every element into the ranges between the bytes of `delimiters`, and
+// skips empty tokens, e.g. to tokenize by white space. Returns the tokens of
+// all elements as a vector, and the row splits: the tokens of element i are
+// tokens[row_splits[i], row_splits[i + 1]).
+//
+// The tokens and their bytes are counted per element in a first parallel pass.
+// A second parallel pass copies the tokens to the offsets given by the prefix
+// sums of the counts.
+void SplitStrings(Argument<ContiguousStringHostTensor> input,
+                  StringAttribute delimiters,
+                  Result<ContiguousStringHostTensor> tokens,
+                  Result<DenseHostTensor> row_splits,
+                  const ExecutionContext& exec_ctx) {
+  auto tokens_result = tokens.AllocateIndirect();
+  auto row_splits_result = row_splits.AllocateIndirect();
+  auto set_error = [&](string_view message) {
+    auto error = EmitErrorAsync(exec_ctx, message);
+    tokens_result->ForwardTo(error.CopyRef());
+    row_splits_result->ForwardTo(std::move(error));
+  };
+
+  const size_t num_elements = input->NumElements();
+  auto split = std::make_shared<StringSplit>();
+  split->input = input.ValueRef();
+  for (char c : delimiters.get())
+    split->is_delimiter[static_cast<uint8_t>(c)] = true;
+  auto splits = DenseHostTensor::CreateUninitialized<int64_t>(
+      TensorShape({static_cast<Index>(num_elements + 1)}), exec_ctx.host());
+  if (!splits) return set_error("cannot allocate row splits");
+  split->row_splits = std::move(*splits);
+  split->byte_offsets.resize(num_elements + 1);
+
+  // Copies the tokens once all of them have been counted.
+  auto copy = [exec_ctx, split, tokens_result = tokens_result.CopyRef(),
+               row_splits_result = row_splits_result.CopyRef()]() {
+    const size_t num_elements = split->input->NumElements();
+    auto* row_splits = split->row_splits.data<int64_t>();
+    auto& byte_offsets = split->byte_offsets;
+    int64_t num_tokens = 0;
+    uint64_t num_bytes = 0;
+    for (size_t i = 0; i <= num_elements; ++i) {
+      const int64_t element_tokens = row_splits[i];
+      const uint64_t element_bytes = byte_offsets[i];
+      row_splits[i] = num_tokens;
+      byte_offsets[i] = num_bytes;
+      num_tokens += element_tokens;
+      num_bytes += element_bytes;
+    }
+
+    split->offsets = AllocateOffsets(num_tokens, exec_ctx.host());
+    split->bytes = AllocateBytes(num_bytes, exec_ctx.host());
+    if (!split->offsets || !split->bytes) {
+      auto error = EmitErrorAsync(exec_ctx, "cannot allocate tokens");
+      tokens_result->ForwardTo(error.CopyRef());
+      row_splits_result->ForwardTo(std::move(error));
+      return;
+    }
+    static_cast<uint64_t*>(split->offsets->data())[num_tokens] = num_bytes;
+
+    auto compute = [split](size_t begin, size_t end) {
+      const auto* row_splits = split->row_splits.data<int64_t>();
+      auto* offsets = static_cast<uint64_t*>(split->offsets->data());
+      auto* bytes = static_cast<char*>(split->bytes->data());
+      for (size_t i = begin; i < end; ++i) {
+        int64_t token = row_splits[i];
+        uint64_t offset = split->byte_offsets[i];
+        split->ForEachToken(split->input->GetString(i), [&](string_view str) {
+          offsets[token++] = offset;
+          std::memcpy(bytes + offset, str.data(), str.size());
+          offset += str.size();
+        });
+      }
+    };
+    auto on_done = [split, num_tokens, tokens_result = tokens_result.CopyRef(),
+                    row_splits_result = row_splits_result.CopyRef()]() {
+      tokens_result->ForwardTo(
+          MakeAvailableAsyncValueRef<ContiguousStringHostTensor>(
+              TensorShape({num_tokens}), std::move(split->bytes),
+              std::move(split->offsets))
+              .ReleaseRCRef());
+      row_splits_result->ForwardTo(
+          MakeAvailableAsyncValueRef<DenseHostTensor>(
+              std::move(split->row_splits))
+              .ReleaseRCRef());
+    };
+    ParallelFor(exec_ctx).Execute(
+        num_elements, ParallelFor::BlockSizes::Adaptive(kMinStringBlockSize),
+        std::move(compute), std::move(on_done));
+  };
+
+  // Counts the tokens and token bytes of every element.
+  auto count = [split](size_t begin, size_t end) {
+    auto* row_splits = split->row_splits.data<int64_t>();
+    for (size_t i = begin; i < end; ++i) {
+      int64_t num_tokens = 0;
+      uint64_t num_bytes = 0;
+      split->ForEachToken(split->input->GetString(i), [&](string_view str) {
+        ++num_tokens;
+        num_bytes += str.size();
+      });
+      row_splits[i] = num_tokens;
+      split->byte_offsets[i] = num_bytes;
+    }
+  };
+
+  // The last entries are the totals after the prefix sums.
+  split->row_splits.data<int64_t>()[num_elements] = 0;
+  split->byte_offsets[num_elements] = 0;
+  ParallelFor(exec_ctx).Execute(
+      num_elements, ParallelFor::BlockSizes::Adaptive(kMinStringBlockSize),
+      std::move(count), std::move(copy));
+}
+
 }  // namespace
 
 void RegisterStringHostTensorKernels(KernelRegistry* registry) {
   registry->AddKernel("tfrt_sht.create_tensor",
                       TFRT_KERNEL(CreateStringTensor));
+  registry->AddKernel("tfrt_sht.create_contiguous_tensor",
+                      TFRT_KERNEL(CreateContiguousStringTensor));
+  registry->AddKernel("tfrt_sht.concat", TFRT_KERNEL(ConcatStrings));
+  registry->AddKernel("tfrt_sht.lower", TFRT_KERNEL(LowerStrings));
+  registry->AddKernel("tfrt_sht.split", TFRT_KERNEL(SplitStrings));
 }
 
 }  // namespace tfrt
@@ -17,12 +17,17 @@
 
 #include "tfrt/tensor/tensor_serialize_utils.h"
 
+#include <cstring>
+
 #include "tfrt/bef_converter/bef_attr_encoder.h"
 #include "tfrt/dtype/dtype.h"
 #include "tfrt/host_context/attribute_utils.h"
 #include "tfrt/host_context/host_context.h"
+#include "tfrt/host_context/kernel_frame.h"
 #include "tfrt/support/byte_order.h"
 #include "tfrt/support/error_util.h"
+#include "tfrt/tensor/constant_tensor_pool.h"
+#include "tfrt/tensor/contiguous_string_host_tensor.h"
 #include "tfrt/tensor/dense_host_tensor.h"
 #include "tfrt/tensor/dense_view.h"
 #include "tfrt/tensor/tensor_metadata.h"
@@ -62,6 +67,70 @@ llvm::Expected<DenseHostTensor> DeserializeDenseHostTensorFromDenseAttr(
   return std::move(result_tensor);
 }
 
+llvm::Expected<DenseHostTensor> CreateConstantDenseHostTensor(
+    const TensorMetadata& md, ArrayRef<uint8_t> data,
+    const AsyncKernelFrame& frame) {
+  assert(data.size() == GetHostSize(md.dtype) * md.shape.GetNumElements());
+  if (reinterpret_cast<uintptr_t>(data.data()) %
+          DenseHostTensor::GetBufferAlignment(md.dtype) ==
+      0) {
+    if (auto buffer = frame.BorrowAttributeData(data.data(), data.size()))
+      return DenseHostTensor(md, std::move(buffer));
+  }
+
+  auto dht = ConstantTensorPool::Global()->GetOrCreateDenseHostTensor(md, data);
+  if (!dht) return MakeStringError("error creating DenseHostTensor");
+  return std::move(*dht);
+}
+
+llvm::Expected<DenseHostTensor> CreateConstantDenseHostTensor(
+    DenseAttr attr, const AsyncKernelFrame& frame) {
+  TensorMetadata md(DType(attr.dtype()), attr.shape());
+  return CreateConstantDenseHostTensor(
+      md,
+      llvm::ArrayRef(static_cast<const uint8_t*>(attr.GetElements()),
+                     GetHostSize(md.dtype) * attr.GetNumElements()),
+      frame);
+}
+
+llvm::Expected<ContiguousStringHostTensor>
+CreateConstantContiguousStringHostTensor(const TensorShape& shape,
+                                         AggregateAttr values,
+                                         const AsyncKernelFrame& frame) {
+  const size_t num_elements = shape.GetNumElements();
+  const size_t num_values = values.GetNumElements();
+  if (num_values != num_elements && num_values != 1) {
+    return MakeStringError("expected ", num_elements,
+                           " string values or a single one, got ", num_values);
+  }
+  auto get_value = [&](size_t index) {
+    return values.GetAttributeOfType<StringAttr>(num_values == 1 ? 0 : index)
+        .GetValue();
+  };
+
+  HostContext* host = frame.GetHostContext();
+  if (num_elements == 1 && !get_value(0).empty()) {
+    string_view value = get_value(0);
+    if (auto bytes = frame.BorrowAttributeData(value.data(), value.size())) {
+      auto offsets = HostBuffer::CreateUninitialized(
+          2 * sizeof(uint64_t), alignof(uint64_t), host->allocator());
+      if (!offsets) return MakeStringError("error creating string tensor");
+      auto* offsets_data = static_cast<uint64_t*>(offsets->data());
+      offsets_data[0] = 0;
+      offsets_data[1] = value.size();
+      return ContiguousStringHostTensor(shape, std::move(bytes),
+                                        std::move(offsets));
+    }
+  }
+
+  llvm::SmallVector<string_view, 16> strings;
+  strings.reserve(num_elements);
+  for (size_t i = 0; i < num_elements; ++i) strings.push_back(get_value(i));
+  auto tensor = ContiguousStringHostTensor::Create(shape, strings, host);
+  if (!tensor) return MakeStringError("error creating string tensor");
+  return std::move(*tensor);
+}
+
 TensorMetadata CreateTensorMetadata(const DenseAttr& attr) {
   return CreateDenseView(attr).metadata();
 }
@@ -100,20 +169,28 @@ std::string SerializeTensorMetadata(const TensorMetadata& md) {
   return buffer;
 }
 
+// Read a little endian value from location, which may be unaligned, e.g. in a
+// received message.
+const char* ReadUint64(const char* location, uint64_t* value) {
+  ASSERT_LITTLE_ENDIAN();
+  memcpy(value, location, sizeof(uint64_t));
+  return location + sizeof(uint64_t);
+}
+
 llvm::Expected<TensorMetadata> DeserializeTensorMetadataInternal(
     const char* pos, size_t size) {
-  ASSERT_LITTLE_ENDIAN();
-  DType kind = static_cast<DType>(*reinterpret_cast<const uint64_t*>(pos));
-  pos += sizeof(uint64_t);
+  uint64_t kind;
+  pos = ReadUint64(pos, &kind);
   const int num_dimensions = size / 8 - 1;
   llvm::SmallVector<Index, 4> dimensions;
   dimensions.reserve(num_dimensions);
   for (int i = 0; i < num_dimensions; ++i) {
-    dimensions.push_back(*reinterpret_cast<const uint64_t*>(pos));
-    pos += sizeof(uint64_t);
+    uint64_t dimension;
+    pos = ReadUint64(pos, &dimension);
+    dimensions.push_back(dimension);
   }
   TensorShape shape(dimensions);
-  TensorMetadata md(DType(kind), shape);
+  TensorMetadata md(static_cast<DType>(kind), shape);
   return md;
 }
 
@@ -155,4 +232,58 @@ llvm::Expected<DenseHostTensor> DeserializeDenseHostTensor(
   auto dht = DenseHostTensor(md, serialized[1]);
   return std::move(dht);
 }
+
+llvm::SmallVector<ArrayRef<uint8_t>, 2> DenseHostTensorWireChunks::GetChunks()
+    const {
+  llvm::SmallVector<ArrayRef<uint8_t>, 2> chunks;
+  chunks.emplace_back(reinterpret_cast<const uint8_t*>(header.data()),
+                      header.size());
+  if (data_size != 0)
+    chunks.emplace_back(static_cast<const uint8_t*>(data->data()), data_size);
+  return chunks;
+}
+
+DenseHostTensorWireChunks SerializeDenseHostTensorToWire(
+    const DenseHostTensor& dht) {
+  DenseHostTensorWireChunks result;
+  result.header = SerializeTensorMetadata(dht.metadata());
+  result.data = dht.buffer();
+  // The buffer may be larger than the tensor, e.g. if it was rounded up by the
+  // allocator, and only the tensor is sent.
+  result.data_size = dht.metadata().GetHostSizeInBytes();
+  return result;
+}
+
+llvm::Expected<TensorMetadata> DeserializeDenseHostTensorWireHeader(
+    string_view header) {
+  if (header.size() < sizeof(uint64_t) || header.size() % sizeof(uint64_t))
+    return MakeStringError("invalid DenseHostTensor header size ",
+                           header.size());
+  uint64_t kind;
+  ReadUint64(header.data(), &kind);
+  if (kind < static_cast<uint64_t>(DType::FirstDType) ||
+      kind >= static_cast<uint64_t>(DType::LastDType))
+    return MakeStringError("invalid DenseHostTensor dtype ", kind);
+  return DeserializeTensorMetadataInternal(header.data(), header.size());
+}
+
+llvm::Expected<DenseHostTensor> DeserializeDenseHostTensorFromWire(
+    string_view header, RCReference<HostBuffer> data) {
+  auto md = DeserializeDenseHostTensorWireHeader(header);
+  if (!md) return md.takeError();
+
+  size_t data_size = md->GetHostSizeInBytes();
+  if (data_size == 0) return DenseHostTensor(*md, std::move(data));
+  if (!data || data->size() < data_size)
+    return MakeStringError("DenseHostTensor data of ",
+                           data ? data->size() : 0, " bytes, expected ",
+                           data_size);
+  if (reinterpret_cast<uintptr_t>(data->data()) %
+      DenseHostTensor::GetBufferAlignment(md->dtype))
+    return MakeStringError("misaligned DenseHostTensor data");
+  if (data->size() > data_size)
+    data = HostBuffer::CreateFromExternal(std::move(data), /*offset=*/0,
+                                          data_size);
+  return DenseHostTensor(*md, std::move(data));
+}
 }  // namespace tfrt
@@ -55,60 +55,11 @@ raw_ostream& operator<<(raw_ostream& os, const TensorShape& value) {
   return os << ']';
 }
 
-bool TensorShape::operator==(const TensorShape& other) const {
-  // We assume that two identical shapes have the same representation kind.
-  if (GetRepresentationKind() != other.GetRepresentationKind()) return false;
-  if (!IsRepresentationExternal()) {
-    // Both rep16 and rep32 have the same size and share the same memory, so
-    // either representation is sufficient when comparing the block of memory.
-    return memcmp(&representation_, &other.representation_,
-                  sizeof(representation_)) == 0;
-  }
+bool TensorShape::EqualsExternal(const TensorShape& other) const {
   if (GetRank() != other.GetRank()) return false;
   return std::equal(representation_.rep_external.dims,
                     representation_.rep_external.dims + GetRank(),
                     other.representation_.rep_external.dims);
-  return true;
-}
-
-bool TensorShape::operator!=(const TensorShape& other) const {
-  return !(*this == other);
-}
-
-// Return the total number of elements in this TensorShape.  This is all of
-// the dimensions multiplied together.
-Index TensorShape::GetNumElements() const {
-  Index result = 1;
-  switch (GetRepresentationKind()) {
-    case RepKind::kRep16:
-      for (size_t i = 0, e = GetRank(); i != e; ++i)
-        result *= representation_.rep16.dims[i];
-      return result;
-
-    case RepKind::kRep32:
-      switch (GetRank()) {
-        case 4:
-          result = representation_.rep32.dim3;
-          [[fallthrough]];
-        case 3:
-          result *= representation_.rep32.dims[2];
-          [[fallthrough]];
-        case 2:
-          result *= representation_.rep32.dims[1];
-          [[fallthrough]];
-        case 1:
-          result *= representation_.rep32.dims[0];
-          return result;
-        default:
-          assert(0 && "unreachable");
-          return result;
-      }
-
-    case RepKind::kRepExternal:
-      for (size_t i = 0, e = GetRank(); i != e; ++i)
-        result *= representation_.rep_external.dims[i];
-      return result;
-  }
 }
 
 void TensorShape::GetDimensions(MutableArrayRef<Index> result) const {
@@ -169,32 +120,6 @@ void TensorShape::GetStrides(llvm::SmallVectorImpl<Index>* result) const {
   GetStrides(*result);
 }
 
-Index TensorShape::GetDimensionSize(int dim_idx) const {
-  assert(dim_idx < GetRank());
-  switch (GetRepresentationKind()) {
-    case RepKind::kRep16:
-      return representation_.rep16.dims[dim_idx];
-
-    case RepKind::kRep32:
-      switch (dim_idx) {
-        case 3:
-          return representation_.rep32.dim3;
-        case 2:
-          return representation_.rep32.dims[2];
-        case 1:
-          return representation_.rep32.dims[1];
-        case 0:
-          return representation_.rep32.dims[0];
-        default:
-          assert(0 && "unreachable");
-          return 0;
-      }
-
-    case RepKind::kRepExternal:
-      return representation_.rep_external.dims[dim_idx];
-  }
-}
-
 raw_ostream& operator<<(raw_ostream& os, const PartialTensorShape& value) {
   if (value.IsUnranked()) {
     return os << "Unknown rank";
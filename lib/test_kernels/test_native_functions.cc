@@ -18,6 +18,7 @@
 #include "tfrt/host_context/chain.h"
 #include "tfrt/host_context/host_context.h"
 #include "tfrt/host_context/native_function.h"
+#include "tfrt/support/error_util.h"
 #include "tfrt/test_kernels.h"
 
 namespace tfrt {
@@ -68,6 +69,16 @@ void NativeError(AsyncValue* const* arguments, int num_arguments,
   results[0] = MakeErrorAsyncValueRef("something bad happened");
 }
 
+// The sync implementation of native_add, which the BEFInterpreter runs on the
+// Values of its caller.
+int32_t SyncNativeAdd(int32_t a, int32_t b) { return a + b; }
+
+// A native function that only has a sync implementation.
+Expected<int32_t> SyncNativeDiv(int32_t a, int32_t b) {
+  if (b == 0) return MakeStringError("division by zero");
+  return a / b;
+}
+
 }  // namespace
 
 void RegisterTestNativeFunctions(NativeFunctionRegistry* registry) {
@@ -76,6 +87,9 @@ void RegisterTestNativeFunctions(NativeFunctionRegistry* registry) {
   registry->Add("native_add", NativeAdd);
   registry->Add("native_async_add", NativeAsyncAdd);
   registry->Add("native_error", NativeError);
+  registry->AddSync("native_add", TFRT_SYNC_NATIVE_FUNCTION(SyncNativeAdd));
+  registry->AddSync("native_sync_div",
+                    TFRT_SYNC_NATIVE_FUNCTION(SyncNativeDiv));
 }
 
 }  // namespace tfrt
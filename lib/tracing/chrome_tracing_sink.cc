@@ -20,13 +20,21 @@
 #include <string>
 #include <thread>
 #include <utility>
+#include <vector>
 
 #include "tfrt/support/error_util.h"
+#include "tfrt/support/logging.h"
+#include "tfrt/tracing/perf_counters.h"
+#include "tfrt/tracing/trace_buffers.h"
 #include "tfrt/tracing/tracing.h"
 
 // This file implements a tracing sink which produces activities that can be
 // loaded in chrome://tracing. If run as part of a test, a trace.json file
 // is written as undeclared test output. Otherwise it is written to stdout.
+// Threads record activities into their own TraceBuffers ring buffer, which a
+// collector thread drains, so recording takes no locks.
+//
+// Scopes with hardware counters (see perf_counters.h) carry them as arguments.
 //
 // Usage: replace simple_tracing_sink dependency of bef_executor target with
 // chrome_tracing_sink and run with --enable_tracing.
@@ -35,16 +43,16 @@ namespace tfrt {
 namespace tracing {
 
 class ChromeTracingSink : public TracingSink {
-  using Clock = std::chrono::high_resolution_clock;
-  using Start = std::pair<std::string, Clock::time_point>;
-
-  struct Entry {
+  using Clock = TraceEvent::Clock;
+  struct Start {
     std::string name;
-    Clock::time_point begin, end;
-    std::thread::id tid;
-    std::unique_ptr<Entry> next;
+    Clock::time_point time;
+    PerfCounterStart counters;
   };
 
+  // The events collected while tracing is enabled are bounded too.
+  static constexpr size_t kMaxEvents = 1 << 22;
+
   class Duration {
    public:
     explicit Duration(const Clock::duration& duration)
@@ -64,53 +72,94 @@ class ChromeTracingSink : public TracingSink {
   };
 
  public:
-  ~ChromeTracingSink() override { delete head_.exchange(nullptr); }
-
   Error RequestTracing(bool enable) override {
-    if (enable) return Error::success();
-    std::unique_ptr<Entry> head(head_.exchange(nullptr));
+    if (enable) {
+      // Discard scopes popped after the previous trace ended.
+      buffers_.Drain([](std::thread::id, TraceEvent&&) {});
+      events_.clear();
+      buffer_drops_ = buffers_.dropped();
+      collector_drops_ = 0;
+      collector_ = std::make_unique<TraceCollector>(
+          &buffers_, std::chrono::milliseconds(10),
+          [this](std::thread::id tid, TraceEvent&& event) {
+            if (events_.size() < kMaxEvents)
+              events_.emplace_back(tid, std::move(event));
+            else
+              ++collector_drops_;
+          });
+      return Error::success();
+    }
+    // Joins the collector thread after a final drain.
+    collector_.reset();
+    if (auto dropped =
+            buffers_.dropped() - buffer_drops_ + collector_drops_) {
+      TFRT_LOG(WARNING) << "Dropped " << dropped << " trace events";
+    }
     std::ofstream ofs;
     if (const char* dir = std::getenv("TEST_UNDECLARED_OUTPUTS_DIR"))
       ofs.open(dir + std::string("/trace.json"));
-    std::ostream& os = ofs ? ofs : std::cout;
+    std::ostream& os = ofs.is_open() ? ofs : std::cout;
     os << "{\n  \"traceEvents\": [\n";
-    for (; head; head = std::move(head->next)) {
-      os << R"(    {"ph": "X", "name": ")" << head->name;
-      os << R"(", "pid": 0, "tid": )" << head->tid;
-      os << R"(, "ts": )" << Duration(head->begin - start_);
-      os << R"(, "dur": )" << Duration(head->end - head->begin) << "},\n";
+    for (const auto& [tid, event] : events_) {
+      os << R"(    {"ph": "X", "name": ")" << event.name;
+      os << R"(", "pid": 0, "tid": )" << tid;
+      os << R"(, "ts": )" << Duration(event.begin - start_);
+      os << R"(, "dur": )" << Duration(event.end - event.begin);
+      if (event.counters) {
+        os << R"(, "args": {)";
+        for (int i = 0; i < kNumPerfCounters; ++i) {
+          os << (i ? ", " : "") << '"'
+             << GetPerfCounterName(static_cast<PerfCounter>(i)).str()
+             << R"(": )" << (*event.counters)[i];
+        }
+        os << "}";
+      }
+      os << "},\n";
     }
     os << "    {}\n  ],\n  \"displayTimeUnit\": \"ns\"\n}\n";
+    events_.clear();
     return Error::success();
   }
 
   void RecordTracingEvent(TracingSink::NameGenerator name_gen) override {
     auto now = Clock::now();
-    auto entry = new Entry{name_gen(), now, now, std::this_thread::get_id()};
-    entry->next.reset(head_.exchange(entry));
+    buffers_.Record(TraceEvent{name_gen(), now, now});
   }
 
   void PushTracingScope(TracingSink::NameGenerator name_gen) override {
-    stack_.emplace_back(name_gen(), Clock::now());
+    std::string name = name_gen();
+    PerfCounterStart counters = StartPerfCounters(name);
+    // Read the clock last, so that reading the counters is not timed.
+    stack_.push_back(Start{std::move(name), Clock::now(), counters});
   }
 
   void PopTracingScope() override {
     auto now = Clock::now();
-    auto entry = new Entry{std::move(stack_.back().first), stack_.back().second,
-                           now, std::this_thread::get_id()};
-    entry->next.reset(head_.exchange(entry));
+    Start& start = stack_.back();
+    auto counters = StopPerfCounters(start.name, start.counters);
+    buffers_.Record(
+        TraceEvent{std::move(start.name), start.time, now, counters});
     stack_.pop_back();
   }
 
   const Clock::time_point start_ = Clock::now();
   static thread_local std::vector<Start> stack_;
-  std::atomic<Entry*> head_ = {nullptr};
+  // Each recording thread appends to its own buffer without locking, and the
+  // collector moves the events to `events_`.
+  TraceBuffers buffers_;
+  std::unique_ptr<TraceCollector> collector_;
+  // Only accessed by the collector thread while tracing is enabled.
+  std::vector<std::pair<std::thread::id, TraceEvent>> events_;
+  // The events dropped by `buffers_` before tracing was enabled, and the
+  // events dropped because `events_` was full.
+  uint64_t buffer_drops_ = 0;
+  uint64_t collector_drops_ = 0;
 };
 
 thread_local std::vector<ChromeTracingSink::Start> ChromeTracingSink::stack_;
 
 static const bool kRegisterTracingSink = []() {
-  RegisterTracingSink(new ChromeTracingSink);
+  AddNamedTracingSink("chrome", new ChromeTracingSink);
   return true;
 }();
 
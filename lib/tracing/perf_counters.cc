@@ -0,0 +1,234 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements the hardware performance counters of tracing scopes.
+
+#include "tfrt/tracing/perf_counters.h"
+
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
+#include "tfrt/metrics/counter.h"
+#include "tfrt/metrics/metrics.h"
+#include "tfrt/support/error_util.h"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace tfrt {
+namespace tracing {
+
+namespace internal {
+std::atomic<bool> kPerfCountersEnabled{false};
+}  // namespace internal
+
+namespace {
+
+// The names of the counted scopes. Sets are replaced, not modified, so that
+// recording threads read them without locking. Replaced sets may still be
+// read, so they are never released.
+struct ScopeNames {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<const llvm::StringSet<>>> sets;
+  std::atomic<const llvm::StringSet<>*> current{nullptr};
+};
+
+ScopeNames& GetScopeNames() {
+  static auto* names = new ScopeNames;
+  return *names;
+}
+
+// The group of counters of one thread. Counters the CPU does not support, e.g.
+// the TLB misses in some virtual machines, are left out and count zero.
+class ThreadCounters {
+ public:
+  ThreadCounters() {
+#if defined(__linux__)
+    static constexpr struct {
+      PerfCounter counter;
+      uint32_t type;
+      uint64_t config;
+    } kEvents[] = {
+        {PerfCounter::kCycles, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PerfCounter::kInstructions, PERF_TYPE_HARDWARE,
+         PERF_COUNT_HW_INSTRUCTIONS},
+        {PerfCounter::kCacheMisses, PERF_TYPE_HARDWARE,
+         PERF_COUNT_HW_CACHE_MISSES},
+        {PerfCounter::kDtlbMisses, PERF_TYPE_HW_CACHE,
+         PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+             (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    };
+    for (const auto& event : kEvents) {
+      perf_event_attr attr;
+      std::memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = event.type;
+      attr.config = event.config;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_GROUP;
+      // Count the calling thread on any CPU.
+      const int fd = syscall(__NR_perf_event_open, &attr, /*pid=*/0,
+                             /*cpu=*/-1, /*group_fd=*/leader_fd(), /*flags=*/0);
+      if (fd < 0) {
+        if (fds_.empty()) {
+          error_ = std::strerror(errno);
+          return;
+        }
+        continue;
+      }
+      fds_.push_back(fd);
+      counters_.push_back(event.counter);
+    }
+#else
+    error_ = "not supported on this platform";
+#endif
+  }
+
+  ~ThreadCounters() {
+#if defined(__linux__)
+    for (int fd : fds_) close(fd);
+#endif
+  }
+
+  ThreadCounters(const ThreadCounters&) = delete;
+  ThreadCounters& operator=(const ThreadCounters&) = delete;
+
+  // The reason why the counters could not be opened, or empty.
+  const std::string& error() const { return error_; }
+
+  bool Read(PerfCounterValues* values) const {
+#if defined(__linux__)
+    if (fds_.empty()) return false;
+    // The number of counters, followed by their values in opening order.
+    uint64_t buffer[1 + kNumPerfCounters];
+    const size_t size = sizeof(uint64_t) * (1 + counters_.size());
+    if (read(leader_fd(), buffer, size) != static_cast<ssize_t>(size))
+      return false;
+    values->fill(0);
+    for (size_t i = 0; i < counters_.size(); ++i)
+      (*values)[static_cast<int>(counters_[i])] = buffer[1 + i];
+    return true;
+#else
+    return false;
+#endif
+  }
+
+ private:
+  int leader_fd() const { return fds_.empty() ? -1 : fds_.front(); }
+
+  std::vector<int> fds_;
+  std::vector<PerfCounter> counters_;
+  std::string error_;
+};
+
+const ThreadCounters& GetThreadCounters() {
+  static thread_local ThreadCounters counters;
+  return counters;
+}
+
+// Metrics are process-wide, so each one is only created once.
+const std::array<metrics::Counter*, kNumPerfCounters>& GetCounterMetrics(
+    llvm::StringRef scope_name) {
+  static auto* mutex = new std::mutex;
+  static auto* metrics =
+      new llvm::StringMap<std::array<metrics::Counter*, kNumPerfCounters>>;
+  std::lock_guard<std::mutex> lock(*mutex);
+  auto [it, inserted] = metrics->try_emplace(scope_name);
+  if (inserted) {
+    for (int i = 0; i < kNumPerfCounters; ++i) {
+      it->second[i] = metrics::NewCounter(
+          ("/tfrt/perf_counters/" +
+           GetPerfCounterName(static_cast<PerfCounter>(i)) + "/" + scope_name)
+              .str());
+    }
+  }
+  return it->second;
+}
+
+}  // namespace
+
+llvm::StringRef GetPerfCounterName(PerfCounter counter) {
+  switch (counter) {
+    case PerfCounter::kCycles:
+      return "cycles";
+    case PerfCounter::kInstructions:
+      return "instructions";
+    case PerfCounter::kCacheMisses:
+      return "cache_misses";
+    case PerfCounter::kDtlbMisses:
+      return "dtlb_misses";
+  }
+  return "unknown";
+}
+
+llvm::Error EnablePerfCounters(llvm::ArrayRef<std::string> scope_names) {
+  // The counters of the other threads are opened when they first enter a
+  // counted scope, and are assumed to behave like the ones of this thread.
+  const ThreadCounters& counters = GetThreadCounters();
+  if (!counters.error().empty())
+    return MakeStringError("Failed to open perf counters: ", counters.error());
+
+  auto set = std::make_unique<llvm::StringSet<>>();
+  for (const std::string& name : scope_names) set->insert(name);
+  ScopeNames& names = GetScopeNames();
+  {
+    std::lock_guard<std::mutex> lock(names.mutex);
+    names.current.store(set.get(), std::memory_order_release);
+    names.sets.push_back(std::move(set));
+  }
+  internal::kPerfCountersEnabled.store(true, std::memory_order_release);
+  return llvm::Error::success();
+}
+
+void DisablePerfCounters() {
+  internal::kPerfCountersEnabled.store(false, std::memory_order_release);
+}
+
+namespace internal {
+
+bool IsPerfCounterScope(llvm::StringRef scope_name) {
+  const llvm::StringSet<>* names =
+      GetScopeNames().current.load(std::memory_order_acquire);
+  return names != nullptr && names->contains(scope_name);
+}
+
+bool ReadPerfCounters(PerfCounterValues* values) {
+  return GetThreadCounters().Read(values);
+}
+
+PerfCounterValues StopPerfCounters(llvm::StringRef scope_name,
+                                   const PerfCounterValues& start) {
+  PerfCounterValues values;
+  if (!ReadPerfCounters(&values)) values = start;
+  const auto& metrics = GetCounterMetrics(scope_name);
+  for (int i = 0; i < kNumPerfCounters; ++i) {
+    values[i] -= start[i];
+    metrics[i]->IncrementBy(values[i]);
+  }
+  return values;
+}
+
+}  // namespace internal
+}  // namespace tracing
+}  // namespace tfrt
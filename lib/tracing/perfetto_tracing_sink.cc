@@ -0,0 +1,327 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Process.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/support/logging.h"
+#include "tfrt/tracing/perf_counters.h"
+#include "tfrt/tracing/trace_buffers.h"
+#include "tfrt/tracing/tracing.h"
+
+// This file implements a tracing sink which writes activities in the binary
+// Perfetto trace format, which can be loaded in https://ui.perfetto.dev. Each
+// thread is a track, and activity names are interned per thread, so repeated
+// kernel names are written once. Activities are streamed to the file by the
+// collector thread while tracing is enabled. If run as part of a test, a
+// trace.perfetto-trace file is written as undeclared test output. Otherwise it
+// is written to the current directory. Scopes with hardware counters (see
+// perf_counters.h) carry them as debug annotations of their slice.
+//
+// Usage: add the perfetto_tracing_sink dependency to a bef_executor target and
+// run with --enable_tracing --tracing_sink=perfetto.
+
+namespace tfrt {
+namespace tracing {
+namespace {
+
+// Appends protobuf wire format fields to a string. Only the field types used by
+// the Perfetto trace messages below are supported.
+class ProtoWriter {
+ public:
+  explicit ProtoWriter(std::string* out) : out_(*out) {}
+
+  void AppendVarInt(uint32_t field, uint64_t value) {
+    AppendTag(field, kVarInt);
+    AppendRawVarInt(value);
+  }
+
+  void AppendString(uint32_t field, llvm::StringRef value) {
+    AppendTag(field, kLengthDelimited);
+    AppendRawVarInt(value.size());
+    out_.append(value.data(), value.size());
+  }
+
+  // Appends a nested message whose fields `write` appends.
+  template <typename F>
+  void AppendMessage(uint32_t field, F write) {
+    std::string message;
+    ProtoWriter writer(&message);
+    write(writer);
+    AppendString(field, message);
+  }
+
+ private:
+  enum WireType : uint32_t { kVarInt = 0, kLengthDelimited = 2 };
+
+  void AppendTag(uint32_t field, WireType type) {
+    AppendRawVarInt((field << 3) | type);
+  }
+
+  void AppendRawVarInt(uint64_t value) {
+    while (value >= 0x80) {
+      out_.push_back(static_cast<char>(value | 0x80));
+      value >>= 7;
+    }
+    out_.push_back(static_cast<char>(value));
+  }
+
+  std::string& out_;
+};
+
+// Field numbers of perfetto/trace/trace_packet.proto and the messages it
+// references.
+namespace trace {
+constexpr uint32_t kPacket = 1;
+}  // namespace trace
+namespace trace_packet {
+constexpr uint32_t kTimestamp = 8;
+constexpr uint32_t kTrustedPacketSequenceId = 10;
+constexpr uint32_t kTrackEvent = 11;
+constexpr uint32_t kInternedData = 12;
+constexpr uint32_t kSequenceFlags = 13;
+constexpr uint32_t kTimestampClockId = 58;
+constexpr uint32_t kTrackDescriptor = 60;
+constexpr uint32_t kSeqIncrementalStateCleared = 1;
+constexpr uint32_t kSeqNeedsIncrementalState = 2;
+constexpr uint32_t kBuiltinClockMonotonic = 3;
+}  // namespace trace_packet
+namespace track_event {
+constexpr uint32_t kDebugAnnotations = 4;
+constexpr uint32_t kType = 9;
+constexpr uint32_t kNameIid = 10;
+constexpr uint32_t kTrackUuid = 11;
+constexpr uint32_t kTypeSliceBegin = 1;
+constexpr uint32_t kTypeSliceEnd = 2;
+constexpr uint32_t kTypeInstant = 3;
+}  // namespace track_event
+namespace track_descriptor {
+constexpr uint32_t kUuid = 1;
+constexpr uint32_t kThread = 4;
+}  // namespace track_descriptor
+namespace thread_descriptor {
+constexpr uint32_t kPid = 1;
+constexpr uint32_t kTid = 2;
+}  // namespace thread_descriptor
+namespace debug_annotation {
+constexpr uint32_t kUintValue = 3;
+constexpr uint32_t kName = 10;
+}  // namespace debug_annotation
+namespace interned_data {
+constexpr uint32_t kEventNames = 2;
+}  // namespace interned_data
+namespace event_name {
+constexpr uint32_t kIid = 1;
+constexpr uint32_t kName = 2;
+}  // namespace event_name
+
+class PerfettoTracingSink : public TracingSink {
+  using Clock = TraceEvent::Clock;
+  struct Start {
+    std::string name;
+    Clock::time_point time;
+    PerfCounterStart counters;
+  };
+
+  // Interning state of the packet sequence of one thread.
+  struct Sequence {
+    uint32_t id;
+    llvm::StringMap<uint64_t> name_iids;
+  };
+
+ public:
+  Error RequestTracing(bool enable) override {
+    if (enable) {
+      std::string path = "trace.perfetto-trace";
+      if (const char* dir = std::getenv("TEST_UNDECLARED_OUTPUTS_DIR"))
+        path = dir + std::string("/") + path;
+      file_ = std::fopen(path.c_str(), "wb");
+      if (file_ == nullptr)
+        return MakeStringError("failed to open trace file ", path);
+      // Discard scopes popped after the previous trace ended.
+      buffers_.Drain([](std::thread::id, TraceEvent&&) {});
+      buffer_drops_ = buffers_.dropped();
+      sequences_.clear();
+      collector_ = std::make_unique<TraceCollector>(
+          &buffers_, std::chrono::milliseconds(10),
+          [this](std::thread::id tid, TraceEvent&& event) {
+            WriteEvent(tid, event);
+          });
+      return Error::success();
+    }
+    // Joins the collector thread after a final drain.
+    collector_.reset();
+    Flush();
+    std::fclose(file_);
+    file_ = nullptr;
+    if (auto dropped = buffers_.dropped() - buffer_drops_)
+      TFRT_LOG(WARNING) << "Dropped " << dropped << " trace events";
+    return Error::success();
+  }
+
+  void RecordTracingEvent(TracingSink::NameGenerator name_gen) override {
+    auto now = Clock::now();
+    buffers_.Record(TraceEvent{name_gen(), now, now});
+  }
+
+  void PushTracingScope(TracingSink::NameGenerator name_gen) override {
+    std::string name = name_gen();
+    PerfCounterStart counters = StartPerfCounters(name);
+    // Read the clock last, so that reading the counters is not timed.
+    stack_.push_back(Start{std::move(name), Clock::now(), counters});
+  }
+
+  void PopTracingScope() override {
+    auto now = Clock::now();
+    Start& start = stack_.back();
+    auto counters = StopPerfCounters(start.name, start.counters);
+    buffers_.Record(
+        TraceEvent{std::move(start.name), start.time, now, counters});
+    stack_.pop_back();
+  }
+
+ private:
+  // The size of the encoded packets written to the file at once.
+  static constexpr size_t kFlushSize = 1 << 20;
+
+  // Called on the collector thread only.
+  void WriteEvent(std::thread::id tid, const TraceEvent& event) {
+    ProtoWriter writer(&pending_);
+    auto [it, inserted] = sequences_.try_emplace(tid);
+    Sequence& sequence = it->second;
+    if (inserted) {
+      sequence.id = sequences_.size();
+      writer.AppendMessage(trace::kPacket, [&](ProtoWriter& packet) {
+        packet.AppendVarInt(trace_packet::kTrustedPacketSequenceId,
+                            sequence.id);
+        packet.AppendVarInt(trace_packet::kSequenceFlags,
+                            trace_packet::kSeqIncrementalStateCleared);
+        packet.AppendMessage(
+            trace_packet::kTrackDescriptor, [&](ProtoWriter& descriptor) {
+              descriptor.AppendVarInt(track_descriptor::kUuid, sequence.id);
+              descriptor.AppendMessage(
+                  track_descriptor::kThread, [&](ProtoWriter& thread) {
+                    thread.AppendVarInt(thread_descriptor::kPid, pid_);
+                    thread.AppendVarInt(thread_descriptor::kTid, sequence.id);
+                  });
+            });
+      });
+    }
+
+    auto [iid_it, new_name] =
+        sequence.name_iids.try_emplace(event.name, sequence.name_iids.size());
+    const uint64_t name_iid = iid_it->second + 1;
+    const bool instant = event.begin == event.end;
+    WritePacket(writer, sequence, event.begin, [&](ProtoWriter& packet) {
+      packet.AppendMessage(trace_packet::kTrackEvent, [&](ProtoWriter& track) {
+        track.AppendVarInt(track_event::kType,
+                           instant ? track_event::kTypeInstant
+                                   : track_event::kTypeSliceBegin);
+        track.AppendVarInt(track_event::kTrackUuid, sequence.id);
+        track.AppendVarInt(track_event::kNameIid, name_iid);
+        if (!event.counters) return;
+        for (int i = 0; i < kNumPerfCounters; ++i) {
+          track.AppendMessage(
+              track_event::kDebugAnnotations, [&](ProtoWriter& annotation) {
+                annotation.AppendString(
+                    debug_annotation::kName,
+                    GetPerfCounterName(static_cast<PerfCounter>(i)));
+                annotation.AppendVarInt(debug_annotation::kUintValue,
+                                        (*event.counters)[i]);
+              });
+        }
+      });
+      if (!new_name) return;
+      packet.AppendMessage(
+          trace_packet::kInternedData, [&](ProtoWriter& interned) {
+            interned.AppendMessage(
+                interned_data::kEventNames, [&](ProtoWriter& name) {
+                  name.AppendVarInt(event_name::kIid, name_iid);
+                  name.AppendString(event_name::kName, event.name);
+                });
+          });
+    });
+    if (!instant) {
+      WritePacket(writer, sequence, event.end, [&](ProtoWriter& packet) {
+        packet.AppendMessage(trace_packet::kTrackEvent,
+                             [&](ProtoWriter& track) {
+                               track.AppendVarInt(track_event::kType,
+                                                  track_event::kTypeSliceEnd);
+                               track.AppendVarInt(track_event::kTrackUuid,
+                                                  sequence.id);
+                             });
+      });
+    }
+
+    if (pending_.size() >= kFlushSize) Flush();
+  }
+
+  template <typename F>
+  void WritePacket(ProtoWriter& writer, const Sequence& sequence,
+                   Clock::time_point time, F write) {
+    writer.AppendMessage(trace::kPacket, [&](ProtoWriter& packet) {
+      packet.AppendVarInt(
+          trace_packet::kTimestamp,
+          std::chrono::duration_cast<std::chrono::nanoseconds>(
+              time.time_since_epoch())
+              .count());
+      packet.AppendVarInt(trace_packet::kTimestampClockId,
+                          trace_packet::kBuiltinClockMonotonic);
+      packet.AppendVarInt(trace_packet::kTrustedPacketSequenceId, sequence.id);
+      packet.AppendVarInt(trace_packet::kSequenceFlags,
+                          trace_packet::kSeqNeedsIncrementalState);
+      write(packet);
+    });
+  }
+
+  void Flush() {
+    std::fwrite(pending_.data(), 1, pending_.size(), file_);
+    pending_.clear();
+  }
+
+  const uint32_t pid_ = llvm::sys::Process::getProcessId();
+  static thread_local std::vector<Start> stack_;
+  TraceBuffers buffers_;
+  std::unique_ptr<TraceCollector> collector_;
+  uint64_t buffer_drops_ = 0;
+
+  // Only accessed by the collector thread while tracing is enabled.
+  std::FILE* file_ = nullptr;
+  std::string pending_;
+  std::unordered_map<std::thread::id, Sequence> sequences_;
+};
+
+thread_local std::vector<PerfettoTracingSink::Start>
+    PerfettoTracingSink::stack_;
+
+}  // namespace
+
+static const bool kRegisterTracingSink = []() {
+  AddNamedTracingSink("perfetto", new PerfettoTracingSink);
+  return true;
+}();
+
+}  // namespace tracing
+}  // namespace tfrt
@@ -123,7 +123,10 @@ void SimpleTracingSink::PushTracingScope(TracingSink::NameGenerator gen_name) {
 void SimpleTracingSink::PopTracingScope() { GetTracingStorage().PopScope(); }
 
 static const bool kRegisterTracingSink = [] {
-  RegisterTracingSink(new SimpleTracingSink);
+  auto* tracing_sink = new SimpleTracingSink;
+  AddNamedTracingSink("simple", tracing_sink);
+  // Takes precedence over other sinks linked into the same binary.
+  RegisterTracingSink(tracing_sink);
   return true;
 }();
 
@@ -0,0 +1,31 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements the parts of the per-thread event buffers that are
+// shared by all event types.
+
+#include "tfrt/tracing/trace_buffers.h"
+
+namespace tfrt {
+namespace tracing {
+namespace internal {
+
+uint64_t NextThreadEventBuffersId() {
+  static std::atomic<uint64_t> next_id{1};
+  return next_id.fetch_add(1, std::memory_order_relaxed);
+}
+
+}  // namespace internal
+}  // namespace tracing
+}  // namespace tfrt
@@ -23,6 +23,7 @@
 #include <mutex>
 #include <utility>
 
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/Support/Error.h"
 #include "tfrt/support/error_util.h"
@@ -75,6 +76,31 @@ void RegisterTracingSink(TracingSink* tracing_sink) {
   internal::kTracingSink = tracing_sink;
 }
 
+static llvm::StringMap<TracingSink*>& GetNamedTracingSinks() {
+  static auto sinks = new llvm::StringMap<TracingSink*>;
+  return *sinks;
+}
+
+void AddNamedTracingSink(llvm::StringRef name, TracingSink* tracing_sink) {
+  std::lock_guard<std::mutex> lock(GetTracingMutex());
+  assert(tracing_sink);
+  GetNamedTracingSinks()[name] = tracing_sink;
+  if (internal::kTracingSink == nullptr) internal::kTracingSink = tracing_sink;
+}
+
+Error SelectTracingSink(llvm::StringRef name) {
+  TracingSink* tracing_sink;
+  {
+    std::lock_guard<std::mutex> lock(GetTracingMutex());
+    tracing_sink = GetNamedTracingSinks().lookup(name);
+  }
+  if (tracing_sink == nullptr)
+    return MakeStringError("No tfrt::TracingSink named '", name,
+                           "' linked in");
+  RegisterTracingSink(tracing_sink);
+  return Error::success();
+}
+
 void RequestTracing(bool enable) {
   std::lock_guard<std::mutex> lock(GetTracingMutex());
   if (internal::kTracingSink == nullptr) {
@@ -0,0 +1,309 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This file implements the KernelRunner based kernel benchmarks.
+
+#include "tfrt/utils/kernel_benchmark.h"
+
+#include <atomic>
+#include <optional>
+#include <random>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "tfrt/dtype/dtype.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/kernel_registry.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/support/variant.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/tensor_metadata.h"
+
+namespace tfrt {
+namespace {
+
+// A parsed argument spec. `dtype` is invalid for a chain, and `shape` is
+// unset for a scalar.
+struct ArgumentSpec {
+  DType dtype = DType::Invalid;
+  std::optional<llvm::SmallVector<Index, 4>> shape;
+};
+
+Expected<DType> ParseDType(string_view name) {
+  for (uint8_t i = static_cast<uint8_t>(DType::FirstDType);
+       i != static_cast<uint8_t>(DType::LastDType); ++i) {
+    DType dtype = static_cast<DType>(i);
+    if (DispatchByDType(dtype, [](auto d) { return d.kName; }) == name)
+      return dtype;
+  }
+  return MakeStringError("unknown dtype '", name, "'");
+}
+
+bool IsArithmetic(DType dtype) {
+  return DispatchByDType(dtype, [](auto d) {
+    return std::is_arithmetic<typename decltype(d)::Type>::value;
+  });
+}
+
+Expected<ArgumentSpec> ParseArgumentSpec(string_view spec) {
+  ArgumentSpec result;
+  if (spec == "chain") return result;
+
+  auto [name, dims] = spec.split('[');
+  auto dtype = ParseDType(name);
+  if (!dtype) return dtype.takeError();
+  if (!IsArithmetic(*dtype))
+    return MakeStringError("unsupported argument dtype in '", spec, "'");
+  result.dtype = *dtype;
+  if (name.size() == spec.size()) return result;
+
+  if (!dims.consume_back("]"))
+    return MakeStringError("missing ']' in argument '", spec, "'");
+  auto& shape = result.shape.emplace();
+  if (dims.empty()) return result;
+  llvm::SmallVector<string_view, 4> dim_strs;
+  dims.split(dim_strs, ',');
+  for (string_view dim_str : dim_strs) {
+    Index dim;
+    if (dim_str.trim().getAsInteger(10, dim) || dim < 0)
+      return MakeStringError("invalid dimension in argument '", spec, "'");
+    shape.push_back(dim);
+  }
+  return result;
+}
+
+size_t GetArgumentBytes(const ArgumentSpec& spec) {
+  if (IsInvalid(spec.dtype)) return 0;
+  size_t num_elements = 1;
+  if (spec.shape) {
+    for (Index dim : *spec.shape) num_elements *= dim;
+  }
+  return num_elements * GetHostSize(spec.dtype);
+}
+
+// Fill `data` with `num_elements` random values of `dtype` in [-1, 1) for
+// floating point types and in [0, 10) for integer types.
+void FillRandom(DType dtype, void* data, size_t num_elements,
+                std::mt19937* engine) {
+  DispatchByDType(dtype, [&](auto d) {
+    using T = typename decltype(d)::Type;
+    if constexpr (std::is_floating_point<T>::value) {
+      std::uniform_real_distribution<T> distribution(-1, 1);
+      for (size_t i = 0; i < num_elements; ++i)
+        static_cast<T*>(data)[i] = distribution(*engine);
+    } else if constexpr (std::is_arithmetic<T>::value) {
+      std::uniform_int_distribution<int> distribution(0, 9);
+      for (size_t i = 0; i < num_elements; ++i)
+        static_cast<T*>(data)[i] = static_cast<T>(distribution(*engine));
+    }
+  });
+}
+
+Error AddArgument(const ArgumentSpec& spec, std::mt19937* engine,
+                  HostContext* host, KernelRunner* runner) {
+  if (IsInvalid(spec.dtype)) {
+    runner->SetArgs(Chain());
+    return Error::success();
+  }
+
+  if (!spec.shape) {
+    DispatchByDType(spec.dtype, [&](auto d) {
+      using T = typename decltype(d)::Type;
+      if constexpr (std::is_arithmetic<T>::value) {
+        T value;
+        FillRandom(spec.dtype, &value, 1, engine);
+        runner->SetArgs(value);
+      }
+    });
+    return Error::success();
+  }
+
+  auto tensor = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(spec.dtype, *spec.shape), host);
+  if (!tensor) return MakeStringError("cannot allocate argument tensor");
+  FillRandom(spec.dtype, tensor->data(), tensor->NumElements(), engine);
+  runner->SetArgs(std::move(*tensor));
+  return Error::success();
+}
+
+template <typename T>
+Expected<T> ParseValue(string_view str) {
+  if constexpr (std::is_floating_point<T>::value) {
+    double value;
+    if (str.trim().getAsDouble(value))
+      return MakeStringError("invalid attribute value '", str, "'");
+    return static_cast<T>(value);
+  } else {
+    T value;
+    if (str.trim().getAsInteger(10, value))
+      return MakeStringError("invalid attribute value '", str, "'");
+    return value;
+  }
+}
+
+template <typename T>
+Error AddAttribute(string_view value, bool is_array, KernelRunner* runner) {
+  if (!is_array) {
+    auto parsed = ParseValue<T>(value);
+    if (!parsed) return parsed.takeError();
+    runner->AddAttribute(*parsed);
+    return Error::success();
+  }
+
+  llvm::SmallVector<T, 4> values;
+  if (!value.empty()) {
+    llvm::SmallVector<string_view, 4> value_strs;
+    value.split(value_strs, ',');
+    for (string_view value_str : value_strs) {
+      auto parsed = ParseValue<T>(value_str);
+      if (!parsed) return parsed.takeError();
+      values.push_back(*parsed);
+    }
+  }
+  runner->AddArrayAttribute<T>(values);
+  return Error::success();
+}
+
+Error AddAttribute(string_view spec, KernelRunner* runner) {
+  auto [type, value] = spec.split(':');
+  if (type.size() == spec.size())
+    return MakeStringError("missing ':' in attribute '", spec, "'");
+  if (type == "str") {
+    runner->AddStringAttribute(value);
+    return Error::success();
+  }
+
+  bool is_array = type.consume_back("[]");
+  if (type == "i32") return AddAttribute<int32_t>(value, is_array, runner);
+  if (type == "i64") return AddAttribute<int64_t>(value, is_array, runner);
+  if (type == "f32") return AddAttribute<float>(value, is_array, runner);
+  if (type == "f64") return AddAttribute<double>(value, is_array, runner);
+  return MakeStringError("unsupported attribute type in '", spec, "'");
+}
+
+Expected<llvm::SmallVector<ArgumentSpec, 4>> ParseArgumentSpecs(
+    const KernelBenchmarkOptions& options) {
+  llvm::SmallVector<ArgumentSpec, 4> specs;
+  for (const std::string& argument : options.arguments) {
+    auto spec = ParseArgumentSpec(argument);
+    if (!spec) return spec.takeError();
+    specs.push_back(std::move(*spec));
+  }
+  return specs;
+}
+
+}  // namespace
+
+Expected<std::unique_ptr<KernelRunner>> CreateKernelBenchmarkRunner(
+    const KernelBenchmarkOptions& options, HostContext* host) {
+  if (host->GetKernelRegistry().GetKernel(options.kernel_name).is<Monostate>())
+    return MakeStringError("kernel not found: ", options.kernel_name);
+
+  auto specs = ParseArgumentSpecs(options);
+  if (!specs) return specs.takeError();
+
+  auto runner = std::make_unique<KernelRunner>(options.kernel_name, host);
+  std::mt19937 engine(std::random_device{}());
+  for (const ArgumentSpec& spec : *specs) {
+    if (auto error = AddArgument(spec, &engine, host, runner.get()))
+      return std::move(error);
+  }
+  for (const std::string& attribute : options.attributes) {
+    if (auto error = AddAttribute(attribute, runner.get()))
+      return std::move(error);
+  }
+  return std::move(runner);
+}
+
+Expected<size_t> GetKernelBenchmarkArgumentBytes(
+    const KernelBenchmarkOptions& options) {
+  auto specs = ParseArgumentSpecs(options);
+  if (!specs) return specs.takeError();
+  size_t bytes = 0;
+  for (const ArgumentSpec& spec : *specs) bytes += GetArgumentBytes(spec);
+  return bytes;
+}
+
+Expected<KernelBenchmarkStats> RunKernelBenchmark(
+    const KernelBenchmarkOptions& options, int num_threads,
+    std::chrono::milliseconds min_time, HostContext* host) {
+  auto bytes_per_run = GetKernelBenchmarkArgumentBytes(options);
+  if (!bytes_per_run) return bytes_per_run.takeError();
+
+  // The runners are set up and warmed up before the threads start, so that
+  // the threads only measure the runs.
+  llvm::SmallVector<std::unique_ptr<KernelRunner>, 8> runners;
+  for (int i = 0; i < num_threads; ++i) {
+    auto runner = CreateKernelBenchmarkRunner(options, host);
+    if (!runner) return runner.takeError();
+    (*runner)->Run(options.num_results);
+    if (auto error = (*runner)->GetRunError()) return std::move(error);
+    runners.push_back(std::move(*runner));
+  }
+
+  using Clock = std::chrono::steady_clock;
+  std::atomic<int64_t> num_runs{0};
+  Clock::time_point start = Clock::now();
+  Clock::time_point deadline = start + min_time;
+  {
+    llvm::SmallVector<std::thread, 8> threads;
+    for (auto& runner : runners) {
+      threads.emplace_back([&, runner = runner.get()] {
+        int64_t thread_runs = 0;
+        do {
+          runner->Run(options.num_results);
+          ++thread_runs;
+        } while (Clock::now() < deadline);
+        num_runs.fetch_add(thread_runs, std::memory_order_relaxed);
+      });
+    }
+    for (auto& thread : threads) thread.join();
+  }
+  double elapsed_ns =
+      std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+  KernelBenchmarkStats stats;
+  stats.num_threads = num_threads;
+  stats.num_runs = num_runs.load();
+  stats.ns_per_run = elapsed_ns * num_threads / stats.num_runs;
+  stats.bytes_per_second = 1e9 * stats.num_runs * *bytes_per_run / elapsed_ns;
+  return stats;
+}
+
+void BenchmarkKernel(benchmark::State& state,
+                     const KernelBenchmarkOptions& options, HostContext* host) {
+  // Every thread of the benchmark gets a runner of its own.
+  auto runner = CreateKernelBenchmarkRunner(options, host);
+  if (!runner) {
+    state.SkipWithError(toString(runner.takeError()).c_str());
+    return;
+  }
+  // The arguments are valid, as the runner was created.
+  size_t bytes_per_run = cantFail(GetKernelBenchmarkArgumentBytes(options));
+
+  (*runner)->Run(options.num_results);
+  if (auto error = (*runner)->GetRunError()) {
+    state.SkipWithError(toString(std::move(error)).c_str());
+    return;
+  }
+
+  for (auto _ : state) (*runner)->Run(options.num_results);
+  state.SetBytesProcessed(state.iterations() * bytes_per_run);
+  state.SetItemsProcessed(state.iterations());
+}
+
+}  // namespace tfrt
@@ -29,6 +29,8 @@
 #include "tfrt/host_context/kernel_registry.h"
 #include "tfrt/host_context/resource_context.h"
 #include "tfrt/host_context/sync_kernel_frame.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/support/logging.h"
 #include "tfrt/support/variant.h"
 #include "tfrt/tensor/dense_host_tensor.h"
 #include "tfrt/tensor/tensor_serialize_utils.h"
@@ -39,7 +41,7 @@ namespace {
 std::unique_ptr<HostContext> CreateDefaultHostContext() {
   auto host = std::make_unique<HostContext>(
       [&](const DecodedDiagnostic& diag) {
-        llvm::errs() << "Diagnostic: " << diag << "\n";
+        TFRT_LOG(ERROR) << "Diagnostic: " << diag;
       },
       CreateMallocAllocator(), CreateMultiThreadedWorkQueue(4, 4));
 
@@ -73,6 +75,7 @@ void KernelRunner::Run(size_t num_results) {
   // First clear the previous results if any.
   results_.clear();
   sync_results_.clear();
+  sync_error_.clear();
   if (!req_ctx_) {
     Expected<RCReference<RequestContext>> req_ctx =
         std::move(req_ctx_builder_).build();
@@ -86,6 +89,15 @@ void KernelRunner::Run(size_t num_results) {
   }
 }
 
+Error KernelRunner::GetRunError() const {
+  if (!sync_error_.empty()) return MakeStringError(sync_error_);
+  for (const auto& result : results_) {
+    if (const auto* error = result->GetErrorIfPresent())
+      return MakeStringError(error->message());
+  }
+  return Error::success();
+}
+
 KernelRunner& KernelRunner::AddDenseAttribute(const DenseHostTensor& dht) {
   attr_offsets_.emplace_back(
       SerializeDenseHostTensorToDenseAttr(dht, &bef_attr_encoder_));
@@ -144,6 +156,7 @@ void KernelRunner::RunSyncInternal(size_t num_results) {
   frame.SetResults(result_indices);
   frame.SetAttributes(attributes);
   kernel_fn_.get<SyncKernelImplementation>()(&frame);
+  if (auto error = frame.TakeError()) sync_error_ = toString(std::move(error));
 }
 
 }  // namespace tfrt
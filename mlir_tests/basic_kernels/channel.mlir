@@ -0,0 +1,102 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// RUN: bef_executor %s.bef | FileCheck %s
+// RUN: bef_executor -work_queue_type=mstd %s.bef | FileCheck %s
+
+// CHECK-LABEL: --- Running 'channel_push_pop_test'
+func.func @channel_push_pop_test() -> !tfrt.chain {
+  %ch0 = tfrt.new.chain
+  %one = tfrt.constant.i32 1
+  %two = tfrt.constant.i32 2
+
+  %channel = tfrt.channel.create capacity(2)
+  %ch1 = tfrt.channel.push %channel, %one, %ch0 : i32
+  %ch2 = tfrt.channel.push %channel, %two, %ch1 : i32
+
+  %a, %a_valid, %ch3 = tfrt.channel.pop %channel, %ch2 : i32
+  %b, %b_valid, %ch4 = tfrt.channel.pop %channel, %ch3 : i32
+
+  // CHECK: int32 = 1
+  %ch5 = tfrt.print.i32 %a, %ch4
+  // CHECK: int32 = 2
+  %ch6 = tfrt.print.i32 %b, %ch5
+  // CHECK: int1 = 1
+  %ch7 = tfrt.print.i1 %b_valid, %ch6
+
+  tfrt.return %ch7 : !tfrt.chain
+}
+
+func.func @channel_producer(%channel: !tfrt.channel, %ch0: !tfrt.chain) -> !tfrt.chain {
+  %one = tfrt.constant.i32 1
+  %two = tfrt.constant.i32 2
+  %three = tfrt.constant.i32 3
+
+  %ch1 = tfrt.channel.push %channel, %one, %ch0 : i32
+  %ch2 = tfrt.channel.push %channel, %two, %ch1 : i32
+  %ch3 = tfrt.channel.push %channel, %three, %ch2 : i32
+  %ch4 = tfrt.channel.close %channel, %ch3
+  tfrt.return %ch4 : !tfrt.chain
+}
+
+// The pops are issued before the producer runs, and the producer waits for
+// the consumer once the channel is full.
+// CHECK-LABEL: --- Running 'channel_pipeline_test'
+func.func @channel_pipeline_test() -> i1 {
+  %ch0 = tfrt.new.chain
+
+  %channel = tfrt.channel.create capacity(1)
+  %a, %a_valid, %ch1 = tfrt.channel.pop %channel, %ch0 : i32
+  %b, %b_valid, %ch2 = tfrt.channel.pop %channel, %ch1 : i32
+  %c, %c_valid, %ch3 = tfrt.channel.pop %channel, %ch2 : i32
+  %d, %d_valid, %ch4 = tfrt.channel.pop %channel, %ch3 : i32
+
+  %ch5 = tfrt.call @channel_producer(%channel, %ch0) : (!tfrt.channel, !tfrt.chain) -> !tfrt.chain
+
+  %sum0 = tfrt.add.i32 %a, %b
+  %sum1 = tfrt.add.i32 %sum0, %c
+  // CHECK: int32 = 6
+  %ch6 = tfrt.print.i32 %sum1, %ch5
+
+  // CHECK: 'channel_pipeline_test' returned 0
+  tfrt.return %d_valid : i1
+}
+
+// CHECK-LABEL: --- Running 'channel_pop_after_close_test'
+func.func @channel_pop_after_close_test() -> i32 {
+  %ch0 = tfrt.new.chain
+
+  %channel = tfrt.channel.create capacity(1)
+  %ch1 = tfrt.channel.close %channel, %ch0
+  %value, %valid, %ch2 = tfrt.channel.pop %channel, %ch1 : i32
+
+  // CHECK: int1 = 0
+  %ch3 = tfrt.print.i1 %valid, %ch2
+
+  // CHECK: 'channel_pop_after_close_test' returned <<error: pop from a closed channel>>
+  tfrt.return %value : i32
+}
+
+// CHECK-LABEL: --- Running 'channel_push_after_close_test'
+func.func @channel_push_after_close_test() -> !tfrt.chain {
+  %ch0 = tfrt.new.chain
+  %one = tfrt.constant.i32 1
+
+  %channel = tfrt.channel.create capacity(1)
+  %ch1 = tfrt.channel.close %channel, %ch0
+  %ch2 = tfrt.channel.push %channel, %one, %ch1 : i32
+
+  // CHECK: 'channel_push_after_close_test' returned <<error: push to a closed channel>>
+  tfrt.return %ch2 : !tfrt.chain
+}
@@ -14,6 +14,7 @@
 
 // RUN: bef_executor %s.bef | FileCheck %s
 // RUN: bef_executor -work_queue_type=mstd %s.bef | FileCheck %s
+// RUN: bef_executor -work_queue_type=mstd -parallel_open %s.bef | FileCheck %s
 
 // This function is just a select: "cond ? v1 : v2", exercising tfrt.if with
 // result values.
@@ -223,6 +224,71 @@ func.func @if_test_with_func() {
   tfrt.return
 }
 
+func.func @speculative_cond_site(%cond: i1, %x: i32) -> i32 {
+  %res = tfrt.cond.speculative %cond @identity @double (%x) : (i32) -> (i32)
+  tfrt.return %res : i32
+}
+
+// The call site predicts the true function after a few executions. The
+// results are the same whether the prediction is right or wrong.
+// CHECK-LABEL: --- Running 'speculative_cond_test'
+func.func @speculative_cond_test() {
+  %ch0 = tfrt.new.chain
+  %a = tfrt.constant.i32 41
+
+  %true = "tfrt_test.async_constant.i1"() { value = 1 : i1 } : () -> i1
+  %r0 = tfrt.call @speculative_cond_site(%true, %a) : (i1, i32) -> i32
+  %r1 = tfrt.call @speculative_cond_site(%true, %r0) : (i1, i32) -> i32
+  %r2 = tfrt.call @speculative_cond_site(%true, %r1) : (i1, i32) -> i32
+  %r3 = tfrt.call @speculative_cond_site(%true, %r2) : (i1, i32) -> i32
+  %r4 = tfrt.call @speculative_cond_site(%true, %r3) : (i1, i32) -> i32
+
+  // CHECK-NEXT: int32 = 41
+  %ch1 = tfrt.print.i32 %r4, %ch0
+
+  %false = "tfrt_test.async_constant.i1"() { value = 0 : i1 } : () -> i1
+  %r5 = tfrt.call @speculative_cond_site(%false, %r4) : (i1, i32) -> i32
+
+  // CHECK-NEXT: int32 = 82
+  %ch2 = tfrt.print.i32 %r5, %ch1
+
+  tfrt.return
+}
+
+func.func @speculative_case_site(%index: i32, %x: i32) -> i32 {
+  %res = tfrt.case.speculative %index [@identity, @double] (%x) : (i32) -> (i32)
+  tfrt.return %res : i32
+}
+
+// CHECK-LABEL: --- Running 'speculative_case_test'
+func.func @speculative_case_test() {
+  %ch0 = tfrt.new.chain
+  %a = tfrt.constant.i32 5
+
+  %one = "tfrt_test.async_constant.i32"() { value = 1 : i32 } : () -> i32
+  %r0 = tfrt.call @speculative_case_site(%one, %a) : (i32, i32) -> i32
+  %r1 = tfrt.call @speculative_case_site(%one, %r0) : (i32, i32) -> i32
+  %r2 = tfrt.call @speculative_case_site(%one, %r1) : (i32, i32) -> i32
+  %r3 = tfrt.call @speculative_case_site(%one, %r2) : (i32, i32) -> i32
+  %r4 = tfrt.call @speculative_case_site(%one, %r3) : (i32, i32) -> i32
+
+  // CHECK-NEXT: int32 = 160
+  %ch1 = tfrt.print.i32 %r4, %ch0
+
+  // An invalid index selects the last branch.
+  %zero = "tfrt_test.async_constant.i32"() { value = 0 : i32 } : () -> i32
+  %r5 = tfrt.call @speculative_case_site(%zero, %r4) : (i32, i32) -> i32
+  %seven = "tfrt_test.async_constant.i32"() { value = 7 : i32 } : () -> i32
+  %r6 = tfrt.call @speculative_case_site(%seven, %r5) : (i32, i32) -> i32
+
+  // CHECK-NEXT: int32 = 160
+  %ch2 = tfrt.print.i32 %r5, %ch1
+  // CHECK-NEXT: int32 = 320
+  %ch3 = tfrt.print.i32 %r6, %ch2
+
+  tfrt.return
+}
+
 func.func @branch0(%ch: !tfrt.chain, %arg: i32) -> (!tfrt.chain, i32) {
   %one = tfrt.constant.i32 2
   %res = tfrt.add.i32 %arg, %one
@@ -305,6 +371,36 @@ func.func @tfrt_parallel_while_test() -> !tfrt.chain {
   tfrt.return %ch3 : !tfrt.chain
 }
 
+// The condition only depends on %iteration, so the next iteration can start
+// while %arg of the previous one is still being computed asynchronously.
+func.func @tfrt_pipelined_while_body(%iteration: i32, %arg: i32) -> (i32, i32, i1) {
+  %one = tfrt.constant.i32 1
+  %five = tfrt.constant.i32 5
+  %next_iteration = tfrt.add.i32 %iteration, %one
+  %next_arg = "tfrt_test.async_add.i32"(%arg, %five) : (i32, i32) -> i32
+  %next_cond = "tfrt.lessequal.i32"(%next_iteration, %five) : (i32, i32) -> (i1)
+
+  tfrt.return %next_iteration, %next_arg, %next_cond : i32, i32, i1
+}
+
+// CHECK-LABEL: --- Running 'tfrt_pipelined_while_test'
+func.func @tfrt_pipelined_while_test() -> !tfrt.chain {
+  %ch0 = tfrt.new.chain
+
+  %cond = tfrt.constant.i1 true
+  %iteration = tfrt.constant.i32 0
+  %arg = tfrt.constant.i32 0
+
+  %final_iteration, %final_arg = tfrt.while %cond @tfrt_pipelined_while_body(%iteration, %arg) parallel_iterations(2) : (i32, i32) -> (i32, i32)
+
+  // CHECK: int32 = 30
+  %ch1 = tfrt.print.i32 %final_arg, %ch0
+  // CHECK: int32 = 6
+  %ch2 = tfrt.print.i32 %final_iteration, %ch1
+
+  tfrt.return %ch2 : !tfrt.chain
+}
+
 func.func @tfrt_while_error_body(%ch: !tfrt.chain, %iteration: i32, %arg: i32) -> (!tfrt.chain, i32, i32, i1) {
   %one = tfrt.constant.i32 1
   %five = tfrt.constant.i32 5
@@ -365,6 +461,42 @@ func.func @tfrt_once_test() {
   tfrt.return
 }
 
+func.func @tfrt_once_site(%arg : i32) -> i32 {
+  %result = tfrt.once @tfrt_once_function(%arg) : (i32) -> (i32)
+  tfrt.return %result : i32
+}
+
+// The second execution of the tfrt.once call site finds the results cached at
+// the call site.
+// CHECK-LABEL: --- Running 'tfrt_once_call_site_test'
+func.func @tfrt_once_call_site_test() {
+  %0 = tfrt.constant.i32 10
+  %1 = tfrt.call @tfrt_once_site(%0) : (i32) -> (i32)
+  %2 = tfrt.call @tfrt_once_site(%1) : (i32) -> (i32)
+
+  %ch0 = tfrt.new.chain
+  // CHECK-NEXT: int32 = 11
+  %ch1 = tfrt.print.i32 %1, %ch0
+  // CHECK-NEXT: int32 = 11
+  %ch2 = tfrt.print.i32 %2, %ch1
+
+  tfrt.return
+}
+
+// Every function runs with a new resource context, in which the call site runs
+// the function again.
+// CHECK-LABEL: --- Running 'tfrt_once_new_resource_context_test'
+func.func @tfrt_once_new_resource_context_test() {
+  %0 = tfrt.constant.i32 20
+  %1 = tfrt.call @tfrt_once_site(%0) : (i32) -> (i32)
+
+  %ch0 = tfrt.new.chain
+  // CHECK-NEXT: int32 = 21
+  %ch1 = tfrt.print.i32 %1, %ch0
+
+  tfrt.return
+}
+
 // CHECK-LABEL: --- Running 'tfrt_merge_chain_test'
 func.func @tfrt_merge_chain_test() -> !tfrt.chain {
   %v = tfrt.constant.i32 0
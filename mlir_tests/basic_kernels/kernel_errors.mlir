@@ -39,3 +39,28 @@ func.func @if_mismatch(%cond: i1, %v1: i32, %v2: i32) -> i32 {
   }
   tfrt.return %v1 : i32
 }
+
+// -----
+
+func.func @not_memoizable(%x: i32) -> i32 {
+  tfrt.return %x : i32
+}
+
+func.func @memoized_call_unmarked(%x: i32) -> i32 {
+  // expected-error @+1 {{'tfrt.memoized_call' op callee 'not_memoizable' is not marked with 'tfrt.memoize'}}
+  %y = tfrt.memoized_call @not_memoizable(%x) : (i32) -> i32
+  tfrt.return %y : i32
+}
+
+// -----
+
+func.func @memoizable_with_chain(%ch: !tfrt.chain) -> !tfrt.chain
+    attributes {tfrt.memoize} {
+  tfrt.return %ch : !tfrt.chain
+}
+
+func.func @memoized_call_chain(%ch: !tfrt.chain) -> !tfrt.chain {
+  // expected-error @+1 {{'tfrt.memoized_call' op memoized callee must not take or return a chain}}
+  %ch1 = tfrt.memoized_call @memoizable_with_chain(%ch) : (!tfrt.chain) -> !tfrt.chain
+  tfrt.return %ch1 : !tfrt.chain
+}
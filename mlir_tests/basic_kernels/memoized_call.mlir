@@ -0,0 +1,44 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// RUN: bef_executor %s.bef | FileCheck %s
+
+// The print makes every execution of the body visible. It breaks the promise
+// made by tfrt.memoize, which is what lets the test tell hits from misses.
+func.func @double(%x: i32) -> i32 attributes {tfrt.memoize} {
+  %ch0 = tfrt.new.chain
+  %ch1 = tfrt.print.i32 %x, %ch0
+  %y = tfrt.add.i32 %x, %x
+  tfrt.return %y : i32
+}
+
+// CHECK-LABEL: --- Running 'memoized_call_test'
+func.func @memoized_call_test() -> i32 {
+  %two = tfrt.constant.i32 2
+  %minus_two = tfrt.constant.i32 -2
+
+  // CHECK-NEXT: int32 = 2
+  %a = tfrt.memoized_call @double(%two) : (i32) -> i32
+
+  // Compute 2 again so that the second call runs after the first one, and is
+  // served from the cache.
+  %b = tfrt.add.i32 %a, %minus_two
+  %c = tfrt.memoized_call @double(%b) : (i32) -> i32
+
+  // CHECK-NEXT: int32 = 4
+  %d = tfrt.memoized_call @double(%c) : (i32) -> i32
+
+  // CHECK-NEXT: 'memoized_call_test' returned 8
+  tfrt.return %d : i32
+}
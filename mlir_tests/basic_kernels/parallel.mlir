@@ -50,6 +50,37 @@ func.func @parallel_for.fixed_block_size.async() -> !tfrt.chain {
   tfrt.return %ch3 : !tfrt.chain
 }
 
+// CHECK-LABEL: --- Running 'parallel_for.adaptive_block_size.sync'
+func.func @parallel_for.adaptive_block_size.sync() -> !tfrt.chain {
+  %start      = tfrt.constant.i32 0
+  %end        = tfrt.constant.i32 100
+  %block_size = tfrt.constant.i32 4
+
+  %cnt = "tfrt_test.atomic.create.i32"() : () -> !test.atomic.i32
+
+  // The blocks vary from run to run, but their sizes add up to the range.
+  %done = tfrt.parallel_for.i32 %start to %end adaptive %block_size, %cnt
+          : !test.atomic.i32 {
+    %ch0 = tfrt.new.chain
+    %minus_one = tfrt.constant.i32 -1
+    %neg_start = tfrt.mul.i32 %start, %minus_one
+    %size = tfrt.add.i32 %end, %neg_start
+
+    %ch1 = "tfrt_test.atomic.add.i32"(%cnt, %size, %ch0)
+           : (!test.atomic.i32, i32, !tfrt.chain) -> !tfrt.chain
+
+    tfrt.return
+  }
+
+  %v, %ch0 = "tfrt_test.atomic.get.i32"(%cnt, %done)
+     : (!test.atomic.i32, !tfrt.chain) -> (i32, !tfrt.chain)
+
+  // CHECK: int32 = 100
+  %ch1 = tfrt.print.i32 %v, %ch0
+
+  tfrt.return %ch1 : !tfrt.chain
+}
+
 // Asynchronous function signals its completion using result chain.
 func.func @async_fn(%start : i32, %end : i32,
                %cnt0 : !test.atomic.i32,
@@ -89,3 +120,27 @@ func.func @parallel_call.fixed_block_size.async() -> !tfrt.chain {
 
   tfrt.return %ch3 : !tfrt.chain
 }
+
+// CHECK-LABEL: --- Running 'parallel_for.i64.fixed_block_size.sync'
+func.func @parallel_for.i64.fixed_block_size.sync() -> !tfrt.chain {
+  // The range does not fit into 32 bits.
+  %start      = tfrt.constant.i64 4294967296
+  %end        = tfrt.constant.i64 4294967306
+  %block_size = tfrt.constant.i64 2
+
+  %cnt = "tfrt_test.atomic.create.i32"() : () -> !test.atomic.i32
+
+  %done = tfrt.parallel_for.i64 %start to %end fixed %block_size, %cnt
+          : !test.atomic.i32 {
+    %ch0 = "tfrt_test.atomic.inc.i32"(%cnt) : (!test.atomic.i32) -> !tfrt.chain
+    tfrt.return
+  }
+
+  %v, %ch0 = "tfrt_test.atomic.get.i32"(%cnt, %done)
+     : (!test.atomic.i32, !tfrt.chain) -> (i32, !tfrt.chain)
+
+  // CHECK: int32 = 5
+  %ch1 = tfrt.print.i32 %v, %ch0
+
+  tfrt.return %ch1 : !tfrt.chain
+}
@@ -0,0 +1,62 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// RUN: bef_executor %s.bef | FileCheck %s
+// RUN: bef_executor -work_queue_type=mstd %s.bef | FileCheck %s
+
+// The partitions of a function, as produced by tfrt-partition-function.
+func.func @add(%x: i32) -> i32 {
+  %ch0 = tfrt.new.chain
+  %y, %ch1 = tfrt.recv %ch0 key("add:0") : i32
+  %z = tfrt.add.i32 %y, %x
+  tfrt.return %z : i32
+}
+
+func.func @"add@/job:worker/task:1"(%x: i32) -> !tfrt.chain {
+  %ch0 = tfrt.new.chain
+  %y = tfrt.add.i32 %x, %x
+  %ch1 = tfrt.send %y, %ch0 key("add:0") : i32
+  tfrt.return %ch1 : !tfrt.chain
+}
+
+// CHECK-LABEL: --- Running 'send_recv_test'
+func.func @send_recv_test() -> i32 {
+  %one = tfrt.constant.i32 1
+
+  // The value is received before it is sent.
+  %z = tfrt.call @add(%one) : (i32) -> i32
+  %ch = tfrt.call @"add@/job:worker/task:1"(%one) : (i32) -> !tfrt.chain
+
+  tfrt.return %z : i32
+}
+// CHECK: 'send_recv_test' returned 3
+
+// CHECK-LABEL: --- Running 'send_recv_in_order_test'
+func.func @send_recv_in_order_test() -> !tfrt.chain {
+  %ch0 = tfrt.new.chain
+  %one = tfrt.constant.i32 1
+  %two = tfrt.constant.i32 2
+
+  %ch1 = tfrt.send %one, %ch0 key("x") : i32
+  %ch2 = tfrt.send %two, %ch1 key("x") : i32
+  %a, %ch3 = tfrt.recv %ch2 key("x") : i32
+  %b, %ch4 = tfrt.recv %ch3 key("x") : i32
+
+  // CHECK: int32 = 1
+  %ch5 = tfrt.print.i32 %a, %ch4
+  // CHECK: int32 = 2
+  %ch6 = tfrt.print.i32 %b, %ch5
+
+  tfrt.return %ch6 : !tfrt.chain
+}
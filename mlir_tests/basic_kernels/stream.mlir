@@ -0,0 +1,86 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// RUN: bef_executor %s.bef | FileCheck %s
+// RUN: bef_executor -work_queue_type=mstd %s.bef | FileCheck %s
+
+func.func @stream_sum_body(%element: i32, %count: i32, %sum: i32) -> (i32, i32) {
+  %one = tfrt.constant.i32 1
+  %next_count = tfrt.add.i32 %count, %one
+  %next_sum = tfrt.add.i32 %sum, %element
+  tfrt.return %next_count, %next_sum : i32, i32
+}
+
+// CHECK-LABEL: --- Running 'stream_for_test'
+func.func @stream_for_test() -> !tfrt.chain {
+  %ch0 = tfrt.new.chain
+  %zero = tfrt.constant.i32 0
+  %one = tfrt.constant.i32 1
+  %two = tfrt.constant.i32 2
+  %three = tfrt.constant.i32 3
+
+  // The third push waits for the loop to consume the first element.
+  %channel = tfrt.channel.create capacity(2)
+  %ch1 = tfrt.channel.push %channel, %one, %ch0 : i32
+  %ch2 = tfrt.channel.push %channel, %two, %ch1 : i32
+  %ch3 = tfrt.channel.push %channel, %three, %ch2 : i32
+  %ch4 = tfrt.channel.close %channel, %ch3
+
+  %count, %sum = tfrt.stream.for %channel @stream_sum_body(%zero, %zero) : (i32, i32) -> (i32, i32)
+
+  // CHECK: int32 = 3
+  %ch5 = tfrt.print.i32 %count, %ch4
+  // CHECK: int32 = 6
+  %ch6 = tfrt.print.i32 %sum, %ch5
+
+  tfrt.return %ch6 : !tfrt.chain
+}
+
+// The elements may still be computed when they are pushed, and the loop calls
+// the body on them as they become available.
+// CHECK-LABEL: --- Running 'stream_for_async_elements_test'
+func.func @stream_for_async_elements_test() -> !tfrt.chain {
+  %ch0 = tfrt.new.chain
+  %zero = tfrt.constant.i32 0
+  %one = tfrt.constant.i32 1
+  %two = tfrt.constant.i32 2
+
+  %channel = tfrt.channel.create capacity(1)
+  %count, %sum = tfrt.stream.for %channel @stream_sum_body(%zero, %zero) : (i32, i32) -> (i32, i32)
+
+  %three = "tfrt_test.async_add.i32"(%one, %two) : (i32, i32) -> i32
+  %ch1 = tfrt.channel.push %channel, %three, %ch0 : i32
+  %ch2 = tfrt.channel.push %channel, %two, %ch1 : i32
+  %ch3 = tfrt.channel.close %channel, %ch2
+
+  // CHECK: int32 = 2
+  %ch4 = tfrt.print.i32 %count, %ch3
+  // CHECK: int32 = 5
+  %ch5 = tfrt.print.i32 %sum, %ch4
+
+  tfrt.return %ch5 : !tfrt.chain
+}
+
+// CHECK-LABEL: --- Running 'stream_for_empty_test'
+func.func @stream_for_empty_test() -> i32 {
+  %ch0 = tfrt.new.chain
+  %zero = tfrt.constant.i32 0
+
+  %channel = tfrt.channel.create capacity(1)
+  %ch1 = tfrt.channel.close %channel, %ch0
+  %count, %sum = tfrt.stream.for %channel @stream_sum_body(%zero, %zero) : (i32, i32) -> (i32, i32)
+
+  // CHECK: 'stream_for_empty_test' returned 0
+  tfrt.return %sum : i32
+}
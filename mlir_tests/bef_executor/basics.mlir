@@ -293,6 +293,32 @@ func.func @test_cancel() -> !tfrt.chain {
 
 // CHECK-NEXT: 'test_cancel' returned <<error: Cancelled>>
 
+func.func @print_twice(%x: i32, %ch0: !tfrt.chain) -> !tfrt.chain {
+  %ch1 = tfrt.print.i32 %x, %ch0
+  %ch2 = tfrt.print.i32 %x, %ch1
+  tfrt.return %ch2 : !tfrt.chain
+}
+
+// CHECK-LABEL: --- Running 'test_cancel_prunes_subgraphs'
+func.func @test_cancel_prunes_subgraphs() -> (!tfrt.chain, i32) {
+  %ch0 = tfrt.new.chain
+  %x, %ch1 = "tfrt_test.cancel"(%ch0) : (!tfrt.chain) -> (i32, !tfrt.chain)
+
+  // Neither the calls nor the kernels waiting for the async value are run.
+  // CHECK-NOT: int32 = 0
+  %ch2 = tfrt.call @print_twice(%x, %ch1) : (i32, !tfrt.chain) -> !tfrt.chain
+  %ch3 = tfrt.call @print_twice(%x, %ch1) : (i32, !tfrt.chain) -> !tfrt.chain
+  %ch4 = tfrt.merge.chains %ch2, %ch3 : !tfrt.chain, !tfrt.chain
+
+  %y = "tfrt_test.async_constant.i32"() { value = 1 : i32 } : () -> i32
+  %z = tfrt.add.i32 %x, %y
+  %ch5 = tfrt.print.i32 %z, %ch4
+
+  tfrt.return %ch5, %z : !tfrt.chain, i32
+}
+
+// CHECK-NEXT: 'test_cancel_prunes_subgraphs' returned <<error: Cancelled>>,<<error: Cancelled>>
+
 // CHECK-LABEL: --- Running 'test_async_value_get'
 func.func @test_async_value_get() -> () {
   %x = "tfrt_test.async_value_get"() : () -> !tfrt.string
@@ -0,0 +1,70 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// RUN: bef_executor_lite %s.bef 2>&1 | FileCheck %s
+
+// Functions marked tfrt.fused are normally produced by tfrt-fuse-kernels. Their
+// kernels run in program order within the calling kernel.
+
+// CHECK-LABEL: --- Not running 'add_twice' because it has arguments
+func.func @add_twice(%x: i32, %y: i32) -> i32 attributes {tfrt.fused} {
+  %a = tfrt.add.i32 %x, %y
+  %b = tfrt.add.i32 %a, %y
+  tfrt.return %b : i32
+}
+
+// CHECK-LABEL: --- Running 'call_add_twice'
+func.func @call_add_twice() -> i32 {
+  %x = tfrt.constant.i32 1
+  %y = tfrt.constant.i32 2
+  %z = tfrt.call @add_twice(%x, %y) : (i32, i32) -> i32
+  tfrt.return %z : i32
+}
+// CHECK: 'call_add_twice' returned 5
+
+// The second kernel waits for the asynchronous result of the first one.
+// CHECK-LABEL: --- Not running 'async_add_twice' because it has arguments
+func.func @async_add_twice(%x: i32, %y: i32) -> i32 attributes {tfrt.fused} {
+  %a = "tfrt_test.async_add.i32"(%x, %y) : (i32, i32) -> i32
+  %b = tfrt.add.i32 %a, %y
+  tfrt.return %b : i32
+}
+
+// CHECK-LABEL: --- Running 'call_async_add_twice'
+func.func @call_async_add_twice() -> i32 {
+  %x = tfrt.constant.i32 40
+  %y = tfrt.constant.i32 1
+  %z = tfrt.call @async_add_twice(%x, %y) : (i32, i32) -> i32
+  tfrt.return %z : i32
+}
+// CHECK: 'call_async_add_twice' returned 42
+
+// Errors are propagated to the results without running the remaining kernels.
+// CHECK-LABEL: --- Not running 'fail_then_print' because it has arguments
+func.func @fail_then_print(%ch: !tfrt.chain) -> !tfrt.chain
+    attributes {tfrt.fused} {
+  %x = "tfrt_test.fail"() : () -> i32 // expected-error {{something bad happened}}
+  %ch1 = tfrt.print.i32 %x, %ch
+  tfrt.return %ch1 : !tfrt.chain
+}
+
+// CHECK-LABEL: --- Running 'call_fail_then_print'
+func.func @call_fail_then_print() -> !tfrt.chain {
+  %ch0 = tfrt.new.chain
+  %ch1 = tfrt.call @fail_then_print(%ch0) : (!tfrt.chain) -> !tfrt.chain
+  tfrt.return %ch1 : !tfrt.chain
+}
+// CHECK-NOT: int32 =
+// CHECK: 'call_fail_then_print' returned <<error: something bad happened>>
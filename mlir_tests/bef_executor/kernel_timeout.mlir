@@ -0,0 +1,43 @@
+// Copyright 2021 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// RUN: bef_executor_lite %s.bef 2>&1 | FileCheck %s
+// RUN: bef_executor_lite -work_queue_type=mstd %s.bef 2>&1 | FileCheck %s
+// RUN: tfrt_opt %s | tfrt_opt
+
+// A kernel that finishes in time is not affected by its timeout.
+// CHECK-LABEL: --- Running 'kernel_in_time'
+func.func @kernel_in_time() -> i32 {
+  %a = tfrt.constant.i32 42
+  %b = "tfrt_test.async_copy.i32"(%a) {_tfrt_timeout_ms = 60000 : i64} : (i32) -> i32
+  tfrt.return %b : i32
+}
+// CHECK: 'kernel_in_time' returned 42
+
+// The results of a kernel that times out are errors, which skip the kernels
+// downstream of it but not the others.
+// CHECK-LABEL: --- Running 'kernel_timed_out'
+func.func @kernel_timed_out() -> (!tfrt.chain, i32) {
+  %ch0 = tfrt.new.chain
+  %a = tfrt.constant.i32 1000000
+  %ch1 = "tfrt_test.blocking.usleep"(%a) {_tfrt_timeout_ms = 10 : i64} : (i32) -> (!tfrt.chain)
+  %ch2 = tfrt.print.i32 %a, %ch1
+
+  %b = tfrt.constant.i32 7
+  // CHECK: int32 = 7
+  %ch3 = tfrt.print.i32 %b, %ch0
+  tfrt.return %ch2, %b : !tfrt.chain, i32
+}
+// CHECK-NOT: int32 = 1000000
+// CHECK: 'kernel_timed_out' returned <<error: kernel tfrt_test.blocking.usleep timed out after 10 ms>>,7
@@ -0,0 +1,29 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// RUN: bef_executor_lite -work_queue_type=mstd -load_function=add -load_clients=2 -load_duration_s=0.2 %s.bef | FileCheck %s
+// RUN: tfrt_opt %s | tfrt_opt
+
+// The functions are not run as test cases in the load generation mode.
+// CHECK-NOT: --- Running
+// CHECK: --- Generating load with 'add': 2 clients for 0.2 s, 1 distinct inputs
+// CHECK-NEXT: requests: {{[1-9][0-9]*}} (0 errors)
+// CHECK-NEXT: throughput: {{.*}} requests/s
+// CHECK-NEXT: latency (us): mean {{.*}} p50 {{.*}} p99 {{.*}} max
+func.func @add(%ch0: !tfrt.chain) -> i32 {
+  %x = tfrt.constant.i32 40
+  %y = tfrt.constant.i32 2
+  %z = tfrt.add.i32 %x, %y
+  tfrt.return %z : i32
+}
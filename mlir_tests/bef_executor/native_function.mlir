@@ -66,3 +66,81 @@ func.func @call_native_add_with_unavailable_input() {
 // CHECK-LABEL: --- Running 'native_error'
 // CHECK: something bad happened
 func.func private @native_error() -> i32 attributes {tfrt.native}
+
+func.func private @native_sync_div(%a: i32, %b: i32) -> i32 attributes {tfrt.native}
+
+// A sync function calls native functions on its own Values.
+func.func @sync_add_then_div(%a: i32, %b: i32) -> i32 attributes {tfrt.sync} {
+  %sum = "tfrt_sync.call"(%a, %b) {callee = @native_add} : (i32, i32) -> i32
+  %r = "tfrt_sync.call"(%sum, %b) {callee = @native_sync_div} : (i32, i32) -> i32
+  tfrt.return %r : i32
+}
+
+// CHECK-LABEL: --- Running 'call_sync_native_functions'
+func.func @call_sync_native_functions() -> i32 {
+  %a = tfrt.constant.i32 4
+  %b = tfrt.constant.i32 2
+
+  %r = "tfrt_test.invoke_sync_function.i32_i32.i32"(%a, %b) {fn = @sync_add_then_div} : (i32, i32) -> i32
+
+  // CHECK: 'call_sync_native_functions' returned 3
+  tfrt.return %r : i32
+}
+
+// CHECK-LABEL: --- Running 'invoke_sync_native_function'
+func.func @invoke_sync_native_function() -> i32 {
+  %a = tfrt.constant.i32 1
+  %b = tfrt.constant.i32 2
+
+  %r = "tfrt_test.invoke_sync_function.i32_i32.i32"(%a, %b) {fn = @native_add} : (i32, i32) -> i32
+
+  // CHECK: 'invoke_sync_native_function' returned 3
+  tfrt.return %r : i32
+}
+
+// CHECK-LABEL: --- Running 'sync_native_function_error'
+func.func @sync_native_function_error() -> i32 {
+  %a = tfrt.constant.i32 1
+  %b = tfrt.constant.i32 0
+
+  %r = "tfrt_test.invoke_sync_function.i32_i32.i32"(%a, %b) {fn = @sync_add_then_div} : (i32, i32) -> i32
+
+  // CHECK: 'sync_native_function_error' returned <<error: division by zero>>
+  tfrt.return %r : i32
+}
+
+// A sync parallel body runs on unboxed block indices. It fails for the block
+// starting at 0.
+func.func @sync_div_body(%start: i32, %end: i32) attributes {tfrt.sync} {
+  %r = "tfrt_sync.call"(%end, %start) {callee = @native_sync_div} : (i32, i32) -> i32
+  tfrt.return
+}
+
+// CHECK-LABEL: --- Running 'parallel_call_sync_body'
+func.func @parallel_call_sync_body() -> !tfrt.chain {
+  %start      = tfrt.constant.i32 1
+  %end        = tfrt.constant.i32 9
+  %block_size = tfrt.constant.i32 2
+
+  %done = tfrt.parallel_call.i32 %start to %end fixed %block_size
+          @sync_div_body()
+
+  %one = tfrt.constant.i32 1
+  // CHECK: int32 = 1
+  %ch = tfrt.print.i32 %one, %done
+
+  tfrt.return %ch : !tfrt.chain
+}
+
+// CHECK-LABEL: --- Running 'parallel_call_sync_body_error'
+func.func @parallel_call_sync_body_error() -> !tfrt.chain {
+  %start      = tfrt.constant.i32 0
+  %end        = tfrt.constant.i32 8
+  %block_size = tfrt.constant.i32 2
+
+  %done = tfrt.parallel_call.i32 %start to %end fixed %block_size
+          @sync_div_body()
+
+  // CHECK: 'parallel_call_sync_body_error' returned <<error: {{.*}}division by zero
+  tfrt.return %done : !tfrt.chain
+}
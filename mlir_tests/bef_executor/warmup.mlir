@@ -0,0 +1,30 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// RUN: bef_executor_lite -warmup -warmup_runs=2 %s.bef | FileCheck %s
+// RUN: tfrt_opt %s | tfrt_opt
+
+// The warm-up runs come before the test case, and their results are not
+// printed.
+// CHECK-COUNT-2: int32 = 42
+// CHECK-NOT: returned
+// CHECK-LABEL: --- Running 'print_constant'
+// CHECK-NEXT: int32 = 42
+// CHECK-NEXT: 'print_constant' returned 42
+func.func @print_constant() -> i32 {
+  %ch0 = tfrt.new.chain
+  %x = tfrt.constant.i32 42
+  %ch1 = tfrt.print.i32 %x, %ch0
+  tfrt.return %x : i32
+}
@@ -13,6 +13,7 @@
 // limitations under the License.
 
 // RUN: tfrt_translate -bef-to-mlir %s.bef | tfrt_opt -allow-unregistered-dialect | FileCheck %s
+// RUN: tfrt_translate -mlir-to-bef --compress-debug-sections=zlib %s | tfrt_translate -bef-to-mlir | tfrt_opt -allow-unregistered-dialect | FileCheck %s
 
 // CHECK-LABEL: func @integer1.constant() -> i1
 func.func @integer1.constant() -> i1 {
@@ -0,0 +1,131 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmarks for the scheduling overhead of BEFExecutor on functions with many
+// kernels, which stress the register file and the kernel ready counts.
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "llvm/Support/raw_ostream.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/Parser/Parser.h"
+#include "tfrt/basic_kernels/opdefs/tfrt_base.h"
+#include "tfrt/bef_converter/mlir_to_bef.h"
+#include "tfrt/bef_executor/bef_file.h"
+#include "tfrt/host_context/async_value.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/function.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/host_context/kernel_registry.h"
+
+namespace tfrt {
+namespace {
+
+// Return a function with `num_chains` independent chains of `chain_length`
+// tfrt.add.i32 kernels, whose results are merged by one kernel at the end. The
+// cost threshold makes stream analysis put every chain in a stream of its own,
+// so that the chains are run on different threads.
+std::string WideFunction(int num_chains, int chain_length) {
+  std::string mlir;
+  llvm::raw_string_ostream os(mlir);
+  os << "module attributes {tfrt.cost_threshold = 1 : i64} {\n"
+     << "func.func @wide(%a: i32) -> !tfrt.chain {\n";
+  for (int i = 0; i < num_chains; ++i) {
+    os << "  %x" << i << "_0 = tfrt.add.i32 %a, %a\n";
+    for (int j = 1; j < chain_length; ++j) {
+      os << "  %x" << i << '_' << j << " = tfrt.add.i32 %x" << i << '_'
+         << j - 1 << ", %a\n";
+    }
+  }
+  os << "  %ch = tfrt.merge.chains ";
+  for (int i = 0; i < num_chains; ++i)
+    os << (i ? ", " : "") << "%x" << i << '_' << chain_length - 1;
+  os << " : ";
+  for (int i = 0; i < num_chains; ++i) os << (i ? ", " : "") << "i32";
+  os << "\n  tfrt.return %ch : !tfrt.chain\n}\n}\n";
+  return os.str();
+}
+
+class WideFunctionRunner {
+ public:
+  WideFunctionRunner(int num_chains, int chain_length, int num_threads)
+      : host_([](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+              CreateMultiThreadedWorkQueue(num_threads, num_threads)) {
+    RegisterStaticKernels(host_.GetMutableRegistry());
+
+    mlir::MLIRContext context;
+    mlir::DialectRegistry registry;
+    registry.insert<compiler::TFRTDialect, mlir::func::FuncDialect>();
+    context.appendDialectRegistry(registry);
+    mlir::OwningOpRef<mlir::ModuleOp> module =
+        mlir::parseSourceString<mlir::ModuleOp>(
+            WideFunction(num_chains, chain_length), &context);
+    bef_buffer_ =
+        ConvertMLIRToBEF(module.get(), /*disable_optional_sections=*/true);
+    bef_file_ = BEFFile::Open(bef_buffer_, host_.GetKernelRegistry(),
+                              host_.diag_handler(), host_.allocator());
+    func_ = bef_file_->GetFunction("wide");
+
+    auto req_ctx =
+        RequestContextBuilder(&host_, /*resource_context=*/nullptr).build();
+    exec_ctx_ = std::make_unique<ExecutionContext>(std::move(*req_ctx));
+  }
+
+  void Run() {
+    RCReference<AsyncValue> results[1];
+    func_->Execute(*exec_ctx_, {arg_.GetAsyncValue()}, results);
+    host_.Await(results);
+    ASSERT_FALSE(results[0]->IsError());
+  }
+
+ private:
+  HostContext host_;
+  BefBuffer bef_buffer_;
+  RCReference<BEFFile> bef_file_;
+  const Function* func_ = nullptr;
+  std::unique_ptr<ExecutionContext> exec_ctx_;
+  AsyncValueRef<int32_t> arg_ = MakeAvailableAsyncValueRef<int32_t>(1);
+};
+
+// Arguments are the number of chains and the length of each chain.
+void BM_WideFunction(benchmark::State& state) {
+  int num_chains = state.range(0);
+  int chain_length = state.range(1);
+  WideFunctionRunner runner(num_chains, chain_length, /*num_threads=*/4);
+
+  for (auto _ : state) runner.Run();
+  state.SetItemsProcessed(state.iterations() * (num_chains * chain_length + 1));
+}
+BENCHMARK(BM_WideFunction)
+    ->Args({1, 256})
+    ->Args({4, 64})
+    ->Args({16, 16})
+    ->Args({64, 4})
+    ->Args({256, 1})
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace tfrt
@@ -0,0 +1,366 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Op dispatch overhead benchmarks. Ops are executed on the forwarding
+// NullOpHandler, whose ops do no work and return copies of their arguments, so
+// the measured time is the cost of the dispatch itself: building the OpAttrs,
+// copying the TensorHandles and going through CoreRuntime. The matrix covers:
+//
+//   entry point:  CoreRuntime::Execute, a prepared CoreRuntimeOp, and the
+//                 corert.executeop kernel of a BEF function.
+//   arguments:    the number of TensorHandle arguments of every op.
+//   attributes:   the number of scalar attributes, and the size of one array
+//                 attribute of every op.
+//
+// Every benchmark reports the time per op in nanoseconds as `op_ns`, next to a
+// budget `budget_ns` for its configuration, and `over_budget` is 1 if the op
+// time exceeds the budget. The budgets are generous bounds for a server class
+// core, so `over_budget` flags regressions of dispatch_utils.h, OpAttrs and
+// TensorHandle in the benchmark output itself, without a baseline. Run with
+// --benchmark_format=json for machine readable results.
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/raw_ostream.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/Parser/Parser.h"
+#include "tfrt/bef_converter/mlir_to_bef.h"
+#include "tfrt/bef_executor/bef_file.h"
+#include "tfrt/core_runtime/core_runtime.h"
+#include "tfrt/core_runtime/core_runtime_op.h"
+#include "tfrt/core_runtime/op_attrs.h"
+#include "tfrt/core_runtime/tensor_handle.h"
+#include "tfrt/cpu/core_runtime/null_op_handler.h"
+#include "tfrt/host_context/async_value.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/chain.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/function.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/init_tfrt_dialects.h"
+#include "tfrt/support/logging.h"
+#include "tfrt/tensor/scalar_host_tensor.h"
+
+namespace tfrt {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// The name of the forwarding NullOpHandler in the CoreRuntime.
+constexpr char kOpHandlerName[] = "null";
+
+// The number of ops of the BEF function of BM_ExecuteOpKernel.
+constexpr int kOpsPerFunction = 64;
+
+struct DispatchSpec {
+  // Number of TensorHandle arguments of every op.
+  int num_args;
+  // Number of i32 attributes of every op.
+  int num_attrs;
+  // Number of elements of the i64 array attribute of every op, which is absent
+  // if zero.
+  int array_size;
+
+  // Every op with arguments returns one of them. Ops without arguments have
+  // no results and only take a chain.
+  int num_results() const { return num_args > 0 ? 1 : 0; }
+};
+
+enum class EntryPoint { kExecute, kPreparedOp, kExecuteOpKernel };
+
+// Returns the dispatch time budget in nanoseconds of an op of `spec`.
+double BudgetNs(EntryPoint entry_point, const DispatchSpec& spec) {
+  double base = 0;
+  switch (entry_point) {
+    case EntryPoint::kExecute:
+      base = 1000;
+      break;
+    case EntryPoint::kPreparedOp:
+      base = 300;
+      break;
+    case EntryPoint::kExecuteOpKernel:
+      base = 1500;
+      break;
+  }
+  return base + 50 * spec.num_args + 50 * spec.num_attrs +
+         2 * spec.array_size;
+}
+
+// Reports the time per op and the budget counters of a benchmark that
+// dispatched `ops_per_iteration` ops per iteration over `elapsed`.
+void ReportBudget(benchmark::State& state, EntryPoint entry_point,
+                  const DispatchSpec& spec, int ops_per_iteration,
+                  Clock::duration elapsed) {
+  const double num_ops =
+      static_cast<double>(state.iterations()) * ops_per_iteration;
+  const double op_ns =
+      num_ops > 0
+          ? std::chrono::duration<double, std::nano>(elapsed).count() / num_ops
+          : 0;
+  const double budget_ns = BudgetNs(entry_point, spec);
+
+  state.SetItemsProcessed(state.iterations() * ops_per_iteration);
+  state.counters["op_ns"] = op_ns;
+  state.counters["budget_ns"] = budget_ns;
+  state.counters["over_budget"] = op_ns > budget_ns ? 1 : 0;
+}
+
+class DispatchRunner {
+ public:
+  explicit DispatchRunner(const DispatchSpec& spec) : spec_(spec) {
+    auto corert = CoreRuntime::Create(
+        [](const DecodedDiagnostic& diag) {
+          TFRT_LOG(ERROR) << "Encountered runtime error: " << diag.message();
+        },
+        CreateMallocAllocator(),
+        CreateMultiThreadedWorkQueue(/*num_threads=*/1,
+                                     /*num_blocking_threads=*/1));
+    if (!corert) TFRT_LOG(FATAL) << corert.takeError();
+    corert_ = std::move(*corert);
+    host_ = corert_->GetHostContext();
+
+    auto op_handler = CreateForwardingNullOpHandler(corert_.get());
+    if (!op_handler) TFRT_LOG(FATAL) << op_handler.takeError();
+    op_handler_ = *op_handler;
+    corert_->RegisterOpHandler(kOpHandlerName, op_handler_);
+
+    auto req_ctx =
+        RequestContextBuilder(host_, /*resource_context=*/nullptr).build();
+    if (!req_ctx) TFRT_LOG(FATAL) << req_ctx.takeError();
+    exec_ctx_ = std::make_unique<ExecutionContext>(std::move(*req_ctx));
+
+    TensorMetadata md(DType::F32, TensorShape({}));
+    for (int i = 0; i < spec.num_args; ++i) {
+      args_.emplace_back(host_->GetHostDeviceRef(), md,
+                         MakeAvailableAsyncValueRef<ScalarHostTensor<float>>(
+                             md, static_cast<float>(i)));
+    }
+    results_.resize(spec.num_results());
+
+    for (int i = 0; i < spec.num_attrs; ++i)
+      attr_names_.push_back("attr" + std::to_string(i));
+    array_.assign(spec.array_size, 1);
+  }
+
+  // Builds the attributes of one op into `attrs`.
+  void SetAttrs(OpAttrs* attrs) const {
+    for (int i = 0; i < spec_.num_attrs; ++i)
+      attrs->Set<int32_t>(attr_names_[i], i);
+    if (!array_.empty()) attrs->SetArray<int64_t>("array", array_);
+  }
+
+  // Dispatches one op through CoreRuntime::Execute, building its attributes.
+  void Execute() {
+    OpAttrs attrs;
+    SetAttrs(&attrs);
+    corert_->Execute(*exec_ctx_, "null.op", op_handler_, args_, attrs.freeze(),
+                     results_, &chain_);
+  }
+
+  // Dispatches one op through the prepared `op` with the attributes `attrs`.
+  void Execute(const CoreRuntimeOp& op, const OpAttrsRef& attrs) {
+    op(*exec_ctx_, args_, attrs, results_, &chain_);
+  }
+
+  Expected<CoreRuntimeOp> MakeOp() {
+    return corert_->MakeOp("null.op", op_handler_);
+  }
+
+  // Prepares a BEF function of `kOpsPerFunction` corert.executeop ops, each of
+  // which takes the result of the previous one and the function arguments.
+  // Returns false on failure.
+  bool PrepareFunction() {
+    if (spec_.num_args == 0) return false;
+
+    std::string attrs;
+    llvm::raw_string_ostream attrs_os(attrs);
+    for (int i = 0; i < spec_.num_attrs; ++i)
+      attrs_os << (i ? ", " : "") << "attr" << i << " = " << i << " : i32";
+    if (!array_.empty()) {
+      attrs_os << (spec_.num_attrs ? ", " : "") << "array = [";
+      for (int i = 0; i < spec_.array_size; ++i)
+        attrs_os << (i ? ", " : "") << "1";
+      attrs_os << "]";
+    }
+    const std::string op_attrs =
+        attrs_os.str().empty() ? "" : " {" + attrs_os.str() + "}";
+
+    std::string mlir;
+    llvm::raw_string_ostream os(mlir);
+    os << "func.func @dispatch(";
+    for (int i = 0; i < spec_.num_args; ++i)
+      os << (i ? ", " : "") << "%a" << i << ": !corert.tensorhandle";
+    os << ") -> !corert.tensorhandle {\n"
+       << "  %ch0 = tfrt.new.chain\n"
+       << "  %null = corert.get_op_handler %ch0 \"" << kOpHandlerName << "\"\n";
+    for (int op = 0; op < kOpsPerFunction; ++op) {
+      os << "  %h" << op << " = corert.executeop(%null) \"null.op\"(";
+      for (int i = 0; i < spec_.num_args; ++i) {
+        os << (i ? ", " : "");
+        if (i == 0 && op > 0) {
+          os << "%h" << op - 1;
+        } else {
+          os << "%a" << i;
+        }
+      }
+      os << ")" << op_attrs << " : 1\n";
+    }
+    os << "  tfrt.return %h" << kOpsPerFunction - 1
+       << " : !corert.tensorhandle\n}\n";
+
+    mlir::DialectRegistry registry;
+    RegisterTFRTDialects(registry);
+    mlir::MLIRContext context(registry);
+    mlir::OwningOpRef<mlir::ModuleOp> module =
+        mlir::parseSourceString<mlir::ModuleOp>(os.str(), &context);
+    if (!module) return false;
+    bef_buffer_ =
+        ConvertMLIRToBEF(module.get(), /*disable_optional_sections=*/true);
+    bef_file_ = BEFFile::Open(bef_buffer_, host_->GetKernelRegistry(),
+                              host_->diag_handler(), host_->allocator());
+    if (!bef_file_) return false;
+    func_ = bef_file_->GetFunction("dispatch");
+    if (!func_) return false;
+
+    for (auto& arg : args_) {
+      function_args_.push_back(
+          MakeAvailableAsyncValueRef<TensorHandle>(arg.CopyRef())
+              .ReleaseRCRef());
+    }
+    return true;
+  }
+
+  // Runs the BEF function once. Returns false if it failed.
+  bool RunFunction() {
+    llvm::SmallVector<AsyncValue*, 4> args;
+    for (auto& arg : function_args_) args.push_back(arg.get());
+    RCReference<AsyncValue> results[1];
+    func_->Execute(*exec_ctx_, args, results);
+    host_->Await(results);
+    return !results[0]->IsError();
+  }
+
+ private:
+  DispatchSpec spec_;
+  std::unique_ptr<CoreRuntime> corert_;
+  HostContext* host_ = nullptr;
+  OpHandler* op_handler_ = nullptr;
+  std::unique_ptr<ExecutionContext> exec_ctx_;
+
+  llvm::SmallVector<TensorHandle, 4> args_;
+  llvm::SmallVector<TensorHandle, 1> results_;
+  AsyncValueRef<Chain> chain_ = MakeAvailableAsyncValueRef<Chain>();
+  std::vector<std::string> attr_names_;
+  std::vector<int64_t> array_;
+
+  BefBuffer bef_buffer_;
+  RCReference<BEFFile> bef_file_;
+  const Function* func_ = nullptr;
+  llvm::SmallVector<RCReference<AsyncValue>, 4> function_args_;
+};
+
+DispatchSpec GetDispatchSpec(const benchmark::State& state) {
+  DispatchSpec spec;
+  spec.num_args = state.range(0);
+  spec.num_attrs = state.range(1);
+  spec.array_size = state.range(2);
+  return spec;
+}
+
+// Arguments are the number of arguments, the number of scalar attributes and
+// the size of the array attribute of the op.
+void BM_CoreRuntimeExecute(benchmark::State& state) {
+  const DispatchSpec spec = GetDispatchSpec(state);
+  DispatchRunner runner(spec);
+
+  const Clock::time_point start = Clock::now();
+  for (auto _ : state) runner.Execute();
+  ReportBudget(state, EntryPoint::kExecute, spec, 1, Clock::now() - start);
+}
+
+void BM_PreparedOp(benchmark::State& state) {
+  const DispatchSpec spec = GetDispatchSpec(state);
+  DispatchRunner runner(spec);
+  auto op = runner.MakeOp();
+  if (!op) {
+    state.SkipWithError("the forwarding NullOpHandler rejected the op");
+    llvm::consumeError(op.takeError());
+    return;
+  }
+  OpAttrs attrs;
+  runner.SetAttrs(&attrs);
+  OpAttrsRef frozen_attrs = attrs.freeze();
+
+  const Clock::time_point start = Clock::now();
+  for (auto _ : state) runner.Execute(*op, frozen_attrs);
+  ReportBudget(state, EntryPoint::kPreparedOp, spec, 1, Clock::now() - start);
+}
+
+// The ops of the BEF function need at least one argument to chain them.
+void BM_ExecuteOpKernel(benchmark::State& state) {
+  const DispatchSpec spec = GetDispatchSpec(state);
+  DispatchRunner runner(spec);
+  if (!runner.PrepareFunction()) {
+    state.SkipWithError("failed to prepare the BEF function");
+    return;
+  }
+
+  const Clock::time_point start = Clock::now();
+  for (auto _ : state) {
+    if (!runner.RunFunction()) {
+      state.SkipWithError("the BEF function failed");
+      break;
+    }
+  }
+  ReportBudget(state, EntryPoint::kExecuteOpKernel, spec, kOpsPerFunction,
+               Clock::now() - start);
+}
+
+void DispatchMatrix(benchmark::internal::Benchmark* benchmark, int min_args) {
+  benchmark->ArgNames({"args", "attrs", "array"});
+  for (int64_t num_args : {0, 1, 4, 16}) {
+    if (num_args < min_args) continue;
+    for (int64_t num_attrs : {0, 4, 16})
+      benchmark->Args({num_args, num_attrs, 0});
+    benchmark->Args({num_args, 0, 1024});
+  }
+}
+
+void AllArgs(benchmark::internal::Benchmark* benchmark) {
+  DispatchMatrix(benchmark, /*min_args=*/0);
+}
+
+void WithArgs(benchmark::internal::Benchmark* benchmark) {
+  DispatchMatrix(benchmark, /*min_args=*/1);
+}
+
+BENCHMARK(BM_CoreRuntimeExecute)->Apply(AllArgs);
+BENCHMARK(BM_PreparedOp)->Apply(AllArgs);
+BENCHMARK(BM_ExecuteOpKernel)->Apply(WithArgs);
+
+}  // namespace
+}  // namespace tfrt
@@ -0,0 +1,474 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// End-to-end serving benchmarks. Requests for a BEF function with a realistic
+// workload are sent through BEFExecutor at a fixed rate, whether or not the
+// earlier requests completed (open loop). The latency of a request is measured
+// from the time it was scheduled to be sent, so that a backlog shows up in the
+// latencies. The achieved throughput and the latency percentiles are reported
+// as counters, run with --benchmark_format=json for machine readable results.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/raw_ostream.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/Parser/Parser.h"
+#include "tfrt/bef_converter/mlir_to_bef.h"
+#include "tfrt/bef_executor/bef_file.h"
+#include "tfrt/core_runtime/core_runtime.h"
+#include "tfrt/core_runtime/tensor_handle.h"
+#include "tfrt/host_context/async_dispatch.h"
+#include "tfrt/host_context/async_value.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/function.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/init_tfrt_dialects.h"
+#include "tfrt/support/latch.h"
+#include "tfrt/support/logging.h"
+
+namespace tfrt {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// How long requests are sent for, for each benchmark run.
+constexpr std::chrono::seconds kRunDuration(2);
+
+// Every workload module registers the CPU op handler in its
+// `register_op_handlers_cpu` function, creates the request independent
+// tensors in its `setup` function, and serves one request in its `run`
+// function, which takes the results of `setup` and returns one tensor.
+constexpr char kRegisterOpHandlers[] = R"(
+func.func @register_op_handlers_cpu() {
+  %null = "corert.create_null_op_handler"() : () -> !corert.ophandler
+  %cpu = "corert.create_cpu_op_handler"(%null) : (!corert.ophandler) -> !corert.ophandler
+  corert.register_op_handler %cpu "cpu"
+  tfrt.return
+}
+)";
+
+// Returns a comma separated list of `n` tensor handle types.
+std::string TensorHandleTypes(int n) {
+  std::string types;
+  for (int i = 0; i < n; ++i) {
+    if (i) types += ", ";
+    types += "!corert.tensorhandle";
+  }
+  return types;
+}
+
+// A two layer perceptron with a batch of 32 inputs of 512 features.
+std::string MlpModule() {
+  return std::string(kRegisterOpHandlers) + R"(
+func.func @setup() -> ()" + TensorHandleTypes(5) + R"() {
+  %x = corert.const_dense_tensor dense<0.5> : tensor<32x512xf32>
+  %w0 = corert.const_dense_tensor dense<0.01> : tensor<512x256xf32>
+  %b0 = corert.const_dense_tensor dense<0.1> : tensor<256xf32>
+  %w1 = corert.const_dense_tensor dense<0.02> : tensor<256x10xf32>
+  %b1 = corert.const_dense_tensor dense<0.1> : tensor<10xf32>
+  tfrt.return %x, %w0, %b0, %w1, %b1 : )" + TensorHandleTypes(5) + R"(
+}
+
+func.func @run(%x: !corert.tensorhandle, %w0: !corert.tensorhandle,
+               %b0: !corert.tensorhandle, %w1: !corert.tensorhandle,
+               %b1: !corert.tensorhandle) -> !corert.tensorhandle {
+  %ch0 = tfrt.new.chain
+  %cpu = corert.get_op_handler %ch0 "cpu"
+  %h0 = corert.executeop(%cpu) "tf.MatMul"(%x, %w0)
+    { transpose_a = false, transpose_b = false } : 1
+  %h1 = corert.executeop(%cpu) "tf.BiasAdd"(%h0, %b0) : 1
+  %h2 = corert.executeop(%cpu) "tf.Relu"(%h1) : 1
+  %h3 = corert.executeop(%cpu) "tf.MatMul"(%h2, %w1)
+    { transpose_a = false, transpose_b = false } : 1
+  %h4 = corert.executeop(%cpu) "tf.BiasAdd"(%h3, %b1) : 1
+  %y = corert.executeop(%cpu) "tf.Softmax"(%h4) : 1
+  tfrt.return %y : !corert.tensorhandle
+}
+)";
+}
+
+// A ResNet basic block: two 3x3 convolutions with batch normalization, and a
+// residual connection, on a 14x14x64 NHWC image.
+std::string ResNetBlockModule() {
+  return std::string(kRegisterOpHandlers) + R"(
+func.func @setup() -> ()" + TensorHandleTypes(7) + R"() {
+  %x = corert.const_dense_tensor dense<0.5> : tensor<1x14x14x64xf32>
+  %f0 = corert.const_dense_tensor dense<0.01> : tensor<3x3x64x64xf32>
+  %f1 = corert.const_dense_tensor dense<0.02> : tensor<3x3x64x64xf32>
+  %scale = corert.const_dense_tensor dense<1.0> : tensor<64xf32>
+  %offset = corert.const_dense_tensor dense<0.1> : tensor<64xf32>
+  %mean = corert.const_dense_tensor dense<0.2> : tensor<64xf32>
+  %variance = corert.const_dense_tensor dense<1.5> : tensor<64xf32>
+  tfrt.return %x, %f0, %f1, %scale, %offset, %mean, %variance
+    : )" + TensorHandleTypes(7) + R"(
+}
+
+func.func @run(%x: !corert.tensorhandle, %f0: !corert.tensorhandle,
+               %f1: !corert.tensorhandle, %scale: !corert.tensorhandle,
+               %offset: !corert.tensorhandle, %mean: !corert.tensorhandle,
+               %variance: !corert.tensorhandle) -> !corert.tensorhandle {
+  %ch0 = tfrt.new.chain
+  %cpu = corert.get_op_handler %ch0 "cpu"
+  %c0 = corert.executeop(%cpu) "tf.Conv2D"(%x, %f0)
+    { padding = "SAME", data_format = "NHWC", strides = [1, 1, 1, 1],
+      dilations = [1, 1, 1, 1] } : 1
+  %bn0:6 = corert.executeop(%cpu)
+    "tf.FusedBatchNormV3"(%c0, %scale, %offset, %mean, %variance)
+    { epsilon = 0.001 : f32, data_format = "NHWC" } : 6
+  %r0 = corert.executeop(%cpu) "tf.Relu"(%bn0#0) : 1
+  %c1 = corert.executeop(%cpu) "tf.Conv2D"(%r0, %f1)
+    { padding = "SAME", data_format = "NHWC", strides = [1, 1, 1, 1],
+      dilations = [1, 1, 1, 1] } : 1
+  %bn1:6 = corert.executeop(%cpu)
+    "tf.FusedBatchNormV3"(%c1, %scale, %offset, %mean, %variance)
+    { epsilon = 0.001 : f32, data_format = "NHWC" } : 6
+  %sum = corert.executeop(%cpu) "tf.AddV2"(%bn1#0, %x) : 1
+  %y = corert.executeop(%cpu) "tf.Relu"(%sum) : 1
+  tfrt.return %y : !corert.tensorhandle
+}
+)";
+}
+
+// Mean embedding lookup of 8 sparse ids for each of 32 examples, in a table of
+// 10000 embeddings of 64 features.
+std::string EmbeddingLookupModule() {
+  constexpr int kBatchSize = 32;
+  constexpr int kIdsPerExample = 8;
+  constexpr int kVocabularySize = 10000;
+
+  std::string indices, ids;
+  llvm::raw_string_ostream indices_os(indices), ids_os(ids);
+  for (int i = 0; i < kBatchSize * kIdsPerExample; ++i) {
+    indices_os << (i ? ", " : "") << '[' << i / kIdsPerExample << ", "
+               << i % kIdsPerExample << ']';
+    ids_os << (i ? ", " : "") << (i * 7919) % kVocabularySize;
+  }
+
+  std::string mlir = std::string(kRegisterOpHandlers);
+  llvm::raw_string_ostream os(mlir);
+  os << R"(
+func.func @setup() -> ()" << TensorHandleTypes(2) << R"() {
+  %ch0 = tfrt.new.chain
+  %cpu = corert.get_op_handler %ch0 "cpu"
+  %indices = corert.const_dense_tensor dense<[)"
+     << indices_os.str() << "]> : tensor<" << kBatchSize * kIdsPerExample
+     << R"(x2xi64>
+  %ids = corert.const_dense_tensor dense<[)"
+     << ids_os.str() << "]> : tensor<" << kBatchSize * kIdsPerExample
+     << R"(xi64>
+  %sp_ids = corert.executeop(%cpu) "tfrt_test.create_coo_tensor"(%indices, %ids)
+    { shape = [)"
+     << kBatchSize << ", " << kIdsPerExample << R"(] } : 1
+  %params = corert.const_dense_tensor dense<0.5> : tensor<)"
+     << kVocabularySize << R"(x64xf32>
+  tfrt.return %sp_ids, %params : )"
+     << TensorHandleTypes(2) << R"(
+}
+
+func.func @run(%sp_ids: !corert.tensorhandle, %params: !corert.tensorhandle)
+    -> !corert.tensorhandle {
+  %ch0 = tfrt.new.chain
+  %cpu = corert.get_op_handler %ch0 "cpu"
+  %y = corert.executeop(%cpu) "tf.SparseEmbeddingLookup"(%sp_ids, %params)
+    { combiner = "mean" } : 1
+  tfrt.return %y : !corert.tensorhandle
+}
+)";
+  return os.str();
+}
+
+// Hashes a batch of 256 feature strings to buckets.
+std::string StringHashingModule() {
+  constexpr int kBatchSize = 256;
+
+  std::string strings;
+  llvm::raw_string_ostream strings_os(strings);
+  for (int i = 0; i < kBatchSize; ++i)
+    strings_os << (i ? ", " : "") << "\"user_" << i * 31 << "_item_" << i * 17
+               << '"';
+
+  std::string mlir = std::string(kRegisterOpHandlers);
+  llvm::raw_string_ostream os(mlir);
+  os << R"(
+func.func @setup() -> !corert.tensorhandle {
+  %strings = corert.const_string_tensor { shape = [)"
+     << kBatchSize << "], value = [" << strings_os.str() << R"(] }
+  tfrt.return %strings : !corert.tensorhandle
+}
+
+func.func @run(%strings: !corert.tensorhandle) -> !corert.tensorhandle {
+  %ch0 = tfrt.new.chain
+  %cpu = corert.get_op_handler %ch0 "cpu"
+  %y = corert.executeop(%cpu) "tf.StringToHashBucketFast"(%strings)
+    { num_buckets = 100000 : i64 } : 1
+  tfrt.return %y : !corert.tensorhandle
+}
+)";
+  return os.str();
+}
+
+struct ServingStats {
+  int64_t num_requests = 0;
+  int64_t num_errors = 0;
+  // Completed requests per second.
+  double throughput = 0;
+  // Latency percentiles in milliseconds.
+  double p50 = 0;
+  double p99 = 0;
+  double p999 = 0;
+};
+
+class ServingRunner {
+ public:
+  ServingRunner(const std::string& mlir, int num_threads) {
+    auto corert = CoreRuntime::Create(
+        [](const DecodedDiagnostic& diag) {
+          TFRT_LOG(ERROR) << "Encountered runtime error: " << diag.message();
+        },
+        CreateMallocAllocator(),
+        CreateMultiThreadedWorkQueue(num_threads,
+                                     /*num_blocking_threads=*/num_threads));
+    if (!corert) TFRT_LOG(FATAL) << corert.takeError();
+    corert_ = std::move(*corert);
+    host_ = corert_->GetHostContext();
+
+    mlir::DialectRegistry registry;
+    RegisterTFRTDialects(registry);
+    mlir::MLIRContext context(registry);
+    mlir::OwningOpRef<mlir::ModuleOp> module =
+        mlir::parseSourceString<mlir::ModuleOp>(mlir, &context);
+    if (!module) TFRT_LOG(FATAL) << "failed to parse the workload module";
+    bef_buffer_ =
+        ConvertMLIRToBEF(module.get(), /*disable_optional_sections=*/true);
+    bef_file_ = BEFFile::Open(bef_buffer_, host_->GetKernelRegistry(),
+                              host_->diag_handler(), host_->allocator());
+    if (!bef_file_) TFRT_LOG(FATAL) << "failed to open the workload BEF file";
+
+    RunSync("register_op_handlers_cpu", {});
+    setup_results_ = RunSync("setup", {});
+    for (auto& result : setup_results_) args_.push_back(result.get());
+    run_ = bef_file_->GetFunction("run");
+    if (!run_) TFRT_LOG(FATAL) << "the workload has no 'run' function";
+  }
+
+  // Sends requests at `qps` for `duration`, and returns once they completed.
+  ServingStats RunOpenLoop(double qps, Clock::duration duration) {
+    const double seconds = std::chrono::duration<double>(duration).count();
+    const int64_t num_requests =
+        std::max<int64_t>(1, static_cast<int64_t>(qps * seconds));
+    std::vector<double> latencies(num_requests);
+    std::atomic<int64_t> num_errors{0};
+    // The time the last request completed.
+    std::atomic<Clock::rep> end_time{0};
+    latch done(num_requests);
+
+    const auto interval = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(1.0 / qps));
+    const Clock::time_point start = Clock::now();
+    for (int64_t i = 0; i < num_requests; ++i) {
+      const Clock::time_point scheduled = start + i * interval;
+      std::this_thread::sleep_until(scheduled);
+
+      // Send the request from the work queue, so that requests that run
+      // inline do not delay the next ones.
+      EnqueueWork(host_, [this, i, scheduled, &latencies, &num_errors,
+                          &end_time, &done] {
+        auto on_done = [i, scheduled, &latencies, &num_errors, &end_time,
+                        &done](bool is_error) {
+          const Clock::time_point now = Clock::now();
+          latencies[i] =
+              std::chrono::duration<double, std::milli>(now - scheduled)
+                  .count();
+          if (is_error) num_errors.fetch_add(1);
+          Clock::rep time = now.time_since_epoch().count();
+          Clock::rep last = end_time.load();
+          while (last < time && !end_time.compare_exchange_weak(last, time)) {
+          }
+          done.count_down();
+        };
+
+        auto req_ctx =
+            RequestContextBuilder(host_, /*resource_context=*/nullptr).build();
+        if (!req_ctx) {
+          llvm::consumeError(req_ctx.takeError());
+          on_done(/*is_error=*/true);
+          return;
+        }
+        ExecutionContext exec_ctx(std::move(*req_ctx));
+        RCReference<AsyncValue> results[1];
+        run_->Execute(exec_ctx, args_, results);
+
+        // The request is done when the tensor of the returned handle is.
+        results[0]->AndThen([result = results[0].CopyRef(),
+                             on_done = std::move(on_done)]() mutable {
+          if (result->IsError()) {
+            on_done(/*is_error=*/true);
+            return;
+          }
+          AsyncValue* tensor = result->get<TensorHandle>().GetAsyncTensor();
+          tensor->AndThen([result = std::move(result), tensor,
+                           on_done = std::move(on_done)] {
+            on_done(tensor->IsError());
+          });
+        });
+      });
+    }
+    done.wait();
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double q) {
+      return latencies[std::min(num_requests - 1,
+                                static_cast<int64_t>(q * num_requests))];
+    };
+
+    ServingStats stats;
+    stats.num_requests = num_requests;
+    stats.num_errors = num_errors.load();
+    const auto elapsed =
+        Clock::time_point(Clock::duration(end_time.load())) - start;
+    stats.throughput =
+        num_requests / std::chrono::duration<double>(elapsed).count();
+    stats.p50 = percentile(0.5);
+    stats.p99 = percentile(0.99);
+    stats.p999 = percentile(0.999);
+    return stats;
+  }
+
+ private:
+  // Runs the function `name` and waits for its results.
+  llvm::SmallVector<RCReference<AsyncValue>, 8> RunSync(
+      string_view name, ArrayRef<AsyncValue*> args) {
+    const Function* function = bef_file_->GetFunction(name);
+    if (!function) TFRT_LOG(FATAL) << "the workload has no '" << name << "'";
+    auto req_ctx =
+        RequestContextBuilder(host_, /*resource_context=*/nullptr).build();
+    if (!req_ctx) TFRT_LOG(FATAL) << req_ctx.takeError();
+    ExecutionContext exec_ctx(std::move(*req_ctx));
+
+    llvm::SmallVector<RCReference<AsyncValue>, 8> results(
+        function->num_results());
+    function->Execute(exec_ctx, args, results);
+    host_->Await(results);
+    for (auto& result : results) {
+      if (result->IsError())
+        TFRT_LOG(FATAL) << "'" << name
+                        << "' failed: " << result->GetError().ToString();
+      // Wait for the tensors of the setup results as well.
+      if (result->IsType<TensorHandle>()) {
+        RCReference<AsyncValue> tensor =
+            FormRef(result->get<TensorHandle>().GetAsyncTensor());
+        host_->Await(tensor);
+        if (tensor->IsError())
+          TFRT_LOG(FATAL) << "'" << name
+                          << "' failed: " << tensor->GetError().ToString();
+      }
+    }
+    return results;
+  }
+
+  std::unique_ptr<CoreRuntime> corert_;
+  HostContext* host_ = nullptr;
+  BefBuffer bef_buffer_;
+  RCReference<BEFFile> bef_file_;
+  llvm::SmallVector<RCReference<AsyncValue>, 8> setup_results_;
+  llvm::SmallVector<AsyncValue*, 8> args_;
+  const Function* run_ = nullptr;
+};
+
+// Arguments are the offered load in requests per second, and the number of
+// work queue threads.
+void RunServingBenchmark(benchmark::State& state, const std::string& mlir) {
+  const double qps = state.range(0);
+  ServingRunner runner(mlir, /*num_threads=*/state.range(1));
+
+  ServingStats stats;
+  for (auto _ : state) {
+    auto start = Clock::now();
+    stats = runner.RunOpenLoop(qps, kRunDuration);
+    state.SetIterationTime(
+        std::chrono::duration<double>(Clock::now() - start).count());
+  }
+
+  state.SetItemsProcessed(state.iterations() * stats.num_requests);
+  state.counters["offered_qps"] = qps;
+  state.counters["throughput_qps"] = stats.throughput;
+  state.counters["p50_ms"] = stats.p50;
+  state.counters["p99_ms"] = stats.p99;
+  state.counters["p999_ms"] = stats.p999;
+  state.counters["errors"] = stats.num_errors;
+  if (stats.num_errors > 0) state.SkipWithError("some requests failed");
+}
+
+void BM_ServingMlp(benchmark::State& state) {
+  RunServingBenchmark(state, MlpModule());
+}
+BENCHMARK(BM_ServingMlp)
+    ->Args({500, 4})
+    ->Args({2000, 4})
+    ->Args({4000, 8})
+    ->Iterations(1)
+    ->UseManualTime()
+    ->Unit(benchmark::kMillisecond);
+
+void BM_ServingResNetBlock(benchmark::State& state) {
+  RunServingBenchmark(state, ResNetBlockModule());
+}
+BENCHMARK(BM_ServingResNetBlock)
+    ->Args({50, 4})
+    ->Args({200, 4})
+    ->Args({400, 8})
+    ->Iterations(1)
+    ->UseManualTime()
+    ->Unit(benchmark::kMillisecond);
+
+void BM_ServingEmbeddingLookup(benchmark::State& state) {
+  RunServingBenchmark(state, EmbeddingLookupModule());
+}
+BENCHMARK(BM_ServingEmbeddingLookup)
+    ->Args({1000, 4})
+    ->Args({5000, 4})
+    ->Args({10000, 8})
+    ->Iterations(1)
+    ->UseManualTime()
+    ->Unit(benchmark::kMillisecond);
+
+void BM_ServingStringHashing(benchmark::State& state) {
+  RunServingBenchmark(state, StringHashingModule());
+}
+BENCHMARK(BM_ServingStringHashing)
+    ->Args({1000, 4})
+    ->Args({10000, 4})
+    ->Args({20000, 8})
+    ->Iterations(1)
+    ->UseManualTime()
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+}  // namespace tfrt
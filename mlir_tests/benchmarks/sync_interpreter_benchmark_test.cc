@@ -0,0 +1,133 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmarks for the dispatch overhead of the sync BEF interpreter, using a
+// function made of scalar kernels that do very little work.
+
+#include <cstdint>
+#include <memory>
+
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/Parser/Parser.h"
+#include "tfrt/basic_kernels/opdefs/tfrt_base.h"
+#include "tfrt/bef_converter/mlir_to_bef.h"
+#include "tfrt/bef_executor/bef_file.h"
+#include "tfrt/bef_executor/bef_interpreter.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/function.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/host_context/kernel_registry.h"
+#include "tfrt/host_context/sync_kernel_frame.h"
+#include "tfrt/host_context/value.h"
+
+namespace tfrt {
+namespace {
+
+constexpr char kScalarChain[] = R"mlir(
+func.func @scalar_chain(%a: i32) attributes {tfrt.sync} {
+  %x0 = "bm.sync_add.i32"(%a, %a) : (i32, i32) -> i32
+  %x1 = "bm.sync_add.i32"(%x0, %a) : (i32, i32) -> i32
+  %x2 = "bm.sync_add.i32"(%x1, %x0) : (i32, i32) -> i32
+  %x3 = "bm.sync_add.i32"(%x2, %x1) : (i32, i32) -> i32
+  %x4 = "bm.sync_add.i32"(%x3, %x2) : (i32, i32) -> i32
+  %x5 = "bm.sync_add.i32"(%x4, %x3) : (i32, i32) -> i32
+  %x6 = "bm.sync_add.i32"(%x5, %x4) : (i32, i32) -> i32
+  %x7 = "bm.sync_add.i32"(%x6, %x5) : (i32, i32) -> i32
+  tfrt.return
+}
+)mlir";
+
+void SyncAddI32(SyncKernelFrame* frame) {
+  frame->EmplaceResultAt<int32_t>(
+      0, frame->GetArgAt<int32_t>(0) + frame->GetArgAt<int32_t>(1));
+}
+
+class ScalarChain {
+ public:
+  ScalarChain()
+      : host_([](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+              CreateSingleThreadedWorkQueue()) {
+    host_.GetMutableRegistry()->AddSyncKernel("bm.sync_add.i32", SyncAddI32);
+
+    mlir::MLIRContext context;
+    context.allowUnregisteredDialects();
+    mlir::DialectRegistry registry;
+    registry.insert<compiler::TFRTDialect, mlir::func::FuncDialect>();
+    context.appendDialectRegistry(registry);
+    mlir::OwningOpRef<mlir::ModuleOp> module =
+        mlir::parseSourceString<mlir::ModuleOp>(kScalarChain, &context);
+    bef_buffer_ =
+        ConvertMLIRToBEF(module.get(), /*disable_optional_sections=*/true);
+    bef_file_ = BEFFile::Open(bef_buffer_, host_.GetKernelRegistry(),
+                              host_.diag_handler(), host_.allocator());
+    func_ = bef_file_->GetFunction("scalar_chain");
+
+    auto req_ctx =
+        RequestContextBuilder(&host_, /*resource_context=*/nullptr).build();
+    exec_ctx_ = std::make_unique<ExecutionContext>(std::move(*req_ctx));
+  }
+
+  const Function& func() const { return *func_; }
+  const ExecutionContext& exec_ctx() const { return *exec_ctx_; }
+
+ private:
+  HostContext host_;
+  BefBuffer bef_buffer_;
+  RCReference<BEFFile> bef_file_;
+  const Function* func_ = nullptr;
+  std::unique_ptr<ExecutionContext> exec_ctx_;
+};
+
+// Each call sets up a new interpreter for the function, as the sync function
+// call kernels do.
+void BM_SyncExecuteScalarChain(benchmark::State& state) {
+  ScalarChain chain;
+  Value arg(int32_t{1});
+  Value* args[] = {&arg};
+
+  for (auto _ : state) {
+    auto error = ExecuteSyncBEFFunction(chain.func(), chain.exec_ctx(), args,
+                                        /*results=*/{});
+    ASSERT_FALSE(error);
+  }
+  state.SetItemsProcessed(state.iterations() * 8);
+}
+BENCHMARK(BM_SyncExecuteScalarChain);
+
+// The interpreter is reused across calls, as the sync benchmark kernel does.
+void BM_BEFInterpreterScalarChain(benchmark::State& state) {
+  ScalarChain chain;
+  BEFInterpreter interpreter(chain.func());
+  Value arg(int32_t{1});
+  Value* args[] = {&arg};
+
+  for (auto _ : state) {
+    auto error = interpreter.Execute(chain.exec_ctx(), args, /*results=*/{});
+    ASSERT_FALSE(error);
+  }
+  state.SetItemsProcessed(state.iterations() * 8);
+}
+BENCHMARK(BM_BEFInterpreterScalarChain);
+
+}  // namespace
+}  // namespace tfrt
@@ -0,0 +1,36 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// RUN: echo "# <number of calls> <total nanoseconds> <location>" > %t.profile
+// RUN: echo "4 40 %s:%(line+11):3" >> %t.profile
+// RUN: echo "2 2000 %s:%(line+12):3" >> %t.profile
+// RUN: echo "1 50 %s:%(line+13):3" >> %t.profile
+// RUN: tfrt_opt -tfrt-apply-kernel-profile=profile=%t.profile %s | FileCheck %s
+
+// The median kernel cost is 50ns, so the threshold is 4 * 50.
+// CHECK: module attributes {tfrt.cost_threshold = 200 : i64}
+
+// CHECK-LABEL: func @profiled
+func.func @profiled(%a: i32) -> i32 {
+  // CHECK: tfrt.add.i32{{.*}}_tfrt_cost = 10 : i64
+  %a0 = tfrt.add.i32 %a, %a
+  // CHECK: tfrt.add.i32{{.*}}_tfrt_cost = 1000 : i64
+  %b0 = tfrt.add.i32 %a, %a
+  // CHECK: tfrt.add.i32{{.*}}_tfrt_cost = 50 : i64
+  %r = tfrt.add.i32 %a0, %b0
+  // CHECK: tfrt.add.i32
+  // CHECK-NOT: _tfrt_cost
+  %s = tfrt.add.i32 %r, %r
+  tfrt.return %s : i32
+}
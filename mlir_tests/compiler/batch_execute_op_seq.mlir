@@ -0,0 +1,73 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// RUN: tfrt_opt -tfrt-batch-execute-op-seq %s | FileCheck %s
+
+// CHECK-LABEL: func @chain
+func.func @chain(%cpu: !corert.ophandler, %ch0: !tfrt.chain, %a: !corert.tensorhandle) -> (!tfrt.chain, !corert.tensorhandle) {
+  // CHECK-NEXT: [[batch:%[0-9]+]]:2 = corert.executeop.seq_batch(%arg0, %arg1) (%arg2, %arg2, %arg2, %arg2)
+  // CHECK-SAME: op_attrs = {{\[\[\], \[\], \[\["shape", \[1, 2\]\]\]\]}}
+  // CHECK-SAME: op_func_attrs = {{\[\[\], \[\], \[\]\]}}
+  // CHECK-SAME: op_names = ["tfrt_test.print", "tfrt_test.add", "tfrt_test.reshape"]
+  // CHECK-SAME: op_num_args = [1 : i32, 2 : i32, 1 : i32]
+  // CHECK-SAME: op_num_results = [0 : i32, 1 : i32, 0 : i32]} : 1
+  %ch1 = corert.executeop.seq(%cpu, %ch0) "tfrt_test.print"(%a) : 0
+  %ch2, %b = corert.executeop.seq(%cpu, %ch1) "tfrt_test.add"(%a, %a) : 1
+  %ch3 = corert.executeop.seq(%cpu, %ch2) "tfrt_test.reshape"(%a) {shape = [1, 2]} : 0
+  // CHECK-NEXT: tfrt.return [[batch]]#0, [[batch]]#1 : !tfrt.chain, !corert.tensorhandle
+  tfrt.return %ch3, %b : !tfrt.chain, !corert.tensorhandle
+}
+
+// CHECK-LABEL: func @intermediate_chain_used
+func.func @intermediate_chain_used(%cpu: !corert.ophandler, %ch0: !tfrt.chain, %a: !corert.tensorhandle) -> (!tfrt.chain, !tfrt.chain) {
+  // %ch1 is also returned, so the ops are not batched.
+  // CHECK-NOT: corert.executeop.seq_batch
+  %ch1 = corert.executeop.seq(%cpu, %ch0) "tfrt_test.print"(%a) : 0
+  %ch2 = corert.executeop.seq(%cpu, %ch1) "tfrt_test.print"(%a) : 0
+  tfrt.return %ch1, %ch2 : !tfrt.chain, !tfrt.chain
+}
+
+// CHECK-LABEL: func @other_op_handler
+func.func @other_op_handler(%cpu: !corert.ophandler, %gpu: !corert.ophandler, %ch0: !tfrt.chain, %a: !corert.tensorhandle) -> !tfrt.chain {
+  // CHECK-NOT: corert.executeop.seq_batch
+  %ch1 = corert.executeop.seq(%cpu, %ch0) "tfrt_test.print"(%a) : 0
+  %ch2 = corert.executeop.seq(%gpu, %ch1) "tfrt_test.print"(%a) : 0
+  tfrt.return %ch2 : !tfrt.chain
+}
+
+// CHECK-LABEL: func @argument_defined_in_chain
+func.func @argument_defined_in_chain(%cpu: !corert.ophandler, %ch0: !tfrt.chain, %a: !corert.tensorhandle) -> !tfrt.chain {
+  // The second op waits for %b, so it starts a new chain with the third op.
+  // CHECK-NEXT: [[ch1:%[0-9]+]] = corert.executeop.seq(%arg0, %arg1) "tfrt_test.print"(%arg2) : 0
+  // CHECK-NEXT: [[b:%[0-9]+]] = corert.executeop(%arg0) "tfrt_test.add"(%arg2, %arg2) : 1
+  // CHECK-NEXT: [[ch3:%[0-9]+]] = corert.executeop.seq_batch(%arg0, [[ch1]]) ([[b]], [[b]])
+  // CHECK-SAME: op_names = ["tfrt_test.print", "tfrt_test.print"]
+  %ch1 = corert.executeop.seq(%cpu, %ch0) "tfrt_test.print"(%a) : 0
+  %b = corert.executeop(%cpu) "tfrt_test.add"(%a, %a) : 1
+  %ch2 = corert.executeop.seq(%cpu, %ch1) "tfrt_test.print"(%b) : 0
+  %ch3 = corert.executeop.seq(%cpu, %ch2) "tfrt_test.print"(%b) : 0
+  // CHECK-NEXT: tfrt.return [[ch3]] : !tfrt.chain
+  tfrt.return %ch3 : !tfrt.chain
+}
+
+// CHECK-LABEL: func @argument_not_used_by_head
+func.func @argument_not_used_by_head(%cpu: !corert.ophandler, %ch0: !tfrt.chain, %a: !corert.tensorhandle, %b: !corert.tensorhandle) -> !tfrt.chain {
+  // %b is defined before the chain, but the first op does not wait for it, so
+  // the ops are not batched.
+  // CHECK-NOT: corert.executeop.seq_batch
+  %ch1 = corert.executeop.seq(%cpu, %ch0) "tfrt_test.print"(%a) : 0
+  %ch2 = corert.executeop.seq(%cpu, %ch1) "tfrt_test.print"(%b) : 0
+  tfrt.return %ch2 : !tfrt.chain
+}
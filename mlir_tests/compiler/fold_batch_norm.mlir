@@ -0,0 +1,60 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// RUN: tfrt_opt -allow-unregistered-dialect -tfrt-fold-batch-norm %s | FileCheck %s
+
+// CHECK-LABEL: func @constant_params
+func.func @constant_params(%input: !t.tensor, %output: !t.tensor) -> !tfrt.chain {
+  %ch0 = tfrt.new.chain
+  %filter = tfrt_dht.create_uninitialized_tensor.f32.4 [3 : i64, 3 : i64, 2 : i64, 4 : i64]
+  %ch1 = tfrt_dht.fill_tensor_with_constant.f32 %filter, %ch0 1.0 : f32
+  %param = tfrt_dht.create_uninitialized_tensor.f32.1 [4 : i64]
+  %ch2 = tfrt_dht.fill_tensor_with_constant.f32 %param, %ch1 0.5 : f32
+
+  // The constants are only computed by the fold function.
+  // CHECK-NOT: tfrt_dht
+  // CHECK: [[folded:%[0-9]+]]:3 = tfrt.once @constant_params_fold_batch_norm_0() : () -> (!t.tensor, !t.tensor, !tfrt.chain)
+  // CHECK-NEXT: [[ch:%[0-9]+]] = "eigen.conv2d.bias.relu.f32"(%arg0, [[folded]]#0, [[folded]]#1, %arg1, [[folded]]#2)
+  // CHECK-SAME: {padding = "same", strides = [1, 1]}
+  %ch3 = "eigen.conv2d.batch_norm.relu.f32"(%input, %filter, %param, %param, %param, %param, %output, %ch2)
+    {epsilon = 0.001 : f32, padding = "same", strides = [1, 1]}
+    : (!t.tensor, !t.tensor, !t.tensor, !t.tensor, !t.tensor, !t.tensor, !t.tensor, !tfrt.chain) -> !tfrt.chain
+  // CHECK-NEXT: tfrt.return [[ch]] : !tfrt.chain
+  tfrt.return %ch3 : !tfrt.chain
+}
+
+// CHECK-LABEL: func @filter_argument
+func.func @filter_argument(%input: !t.tensor, %filter: !t.tensor, %output: !t.tensor) -> !tfrt.chain {
+  %ch0 = tfrt.new.chain
+  %param = tfrt_dht.create_uninitialized_tensor.f32.1 [4 : i64]
+  %ch1 = tfrt_dht.fill_tensor_with_constant.f32 %param, %ch0 0.5 : f32
+
+  // The filter is not a constant, so the kernel is unchanged.
+  // CHECK-NOT: tfrt.once
+  // CHECK: "eigen.conv2d.batch_norm.f32"
+  %ch2 = "eigen.conv2d.batch_norm.f32"(%input, %filter, %param, %param, %param, %param, %output, %ch1)
+    {epsilon = 0.001 : f32, padding = "valid", strides = [1, 1]}
+    : (!t.tensor, !t.tensor, !t.tensor, !t.tensor, !t.tensor, !t.tensor, !t.tensor, !tfrt.chain) -> !tfrt.chain
+  tfrt.return %ch2 : !tfrt.chain
+}
+
+// CHECK: func private @constant_params_fold_batch_norm_0() -> (!t.tensor, !t.tensor, !tfrt.chain)
+// CHECK-NEXT: [[ch0:%[0-9]+]] = tfrt.new.chain
+// CHECK-NEXT: [[filter:%[0-9]+]] = tfrt_dht.create_uninitialized_tensor.f32.4
+// CHECK-NEXT: [[ch1:%[0-9]+]] = tfrt_dht.fill_tensor_with_constant.f32 [[filter]], [[ch0]]
+// CHECK-NEXT: [[param:%[0-9]+]] = tfrt_dht.create_uninitialized_tensor.f32.1
+// CHECK-NEXT: [[ch2:%[0-9]+]] = tfrt_dht.fill_tensor_with_constant.f32 [[param]], [[ch1]]
+// CHECK-NEXT: [[fold:%[0-9]+]]:3 = "eigen.fold_batch_norm.f32"([[filter]], [[param]], [[param]], [[param]], [[param]], [[ch2]]) {epsilon = 1.000000e-03 : f32}
+// CHECK-NEXT: tfrt.return [[fold]]#0, [[fold]]#1, [[fold]]#2 : !t.tensor, !t.tensor, !tfrt.chain
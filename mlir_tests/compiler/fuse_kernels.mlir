@@ -0,0 +1,61 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// RUN: tfrt_opt -tfrt-fuse-kernels %s | FileCheck %s
+
+// CHECK-LABEL: func @chain
+func.func @chain(%ch0: !tfrt.chain) -> !tfrt.chain {
+  // %t is used by both kernels below, so it is not fused with them.
+  // CHECK: [[t:%[0-9]+]] = tfrt_dht.create_uninitialized_tensor.i32.2
+  %t = tfrt_dht.create_uninitialized_tensor.i32.2 [2 : i64, 2 : i64]
+  // CHECK-NEXT: [[ch:%[0-9]+]] = tfrt.call @chain_fused_0([[t]], %arg0)
+  %ch1 = tfrt_dht.fill_tensor_with_constant.i32 %t, %ch0 1 : i32
+  %ch2 = tfrt_dht.print_tensor %t, %ch1
+  // CHECK-NEXT: tfrt.return [[ch]] : !tfrt.chain
+  tfrt.return %ch2 : !tfrt.chain
+}
+
+// CHECK-LABEL: func @not_straight_line
+func.func @not_straight_line(%ch0: !tfrt.chain) -> (!tfrt.chain, !tfrt.chain) {
+  // %ch1 is also returned, so it has to be published to the caller.
+  // CHECK-NOT: tfrt.call
+  %t = tfrt_dht.create_uninitialized_tensor.i32.2 [2 : i64, 2 : i64]
+  %ch1 = tfrt_dht.fill_tensor_with_constant.i32 %t, %ch0 1 : i32
+  %ch2 = tfrt_dht.print_tensor %t, %ch1
+  tfrt.return %ch1, %ch2 : !tfrt.chain, !tfrt.chain
+}
+
+// CHECK-LABEL: func @other_dialect
+func.func @other_dialect(%a: i32) -> i32 {
+  // CHECK-NOT: tfrt.call
+  %b = tfrt.add.i32 %a, %a
+  %c = tfrt.add.i32 %b, %b
+  tfrt.return %c : i32
+}
+
+// CHECK-LABEL: func @timeout
+func.func @timeout(%ch0: !tfrt.chain) -> !tfrt.chain {
+  // A kernel with a timeout is not fused, so that the executor enforces it.
+  // CHECK-NOT: tfrt.call
+  %t = tfrt_dht.create_uninitialized_tensor.i32.2 [2 : i64, 2 : i64]
+  %ch1 = tfrt_dht.fill_tensor_with_constant.i32 %t, %ch0 1 : i32
+  %ch2 = "tfrt_dht.print_tensor"(%t, %ch1) {_tfrt_timeout_ms = 10 : i64} : (!t.tensor, !tfrt.chain) -> !tfrt.chain
+  tfrt.return %ch2 : !tfrt.chain
+}
+
+// CHECK: func private @chain_fused_0(%arg0: !t.tensor, %arg1: !tfrt.chain) -> !tfrt.chain attributes {tfrt.fused}
+// CHECK-NEXT: [[ch1:%[0-9]+]] = tfrt_dht.fill_tensor_with_constant.i32 %arg0, %arg1 1 : i32
+// CHECK-NEXT: [[ch2:%[0-9]+]] = tfrt_dht.print_tensor %arg0, [[ch1]]
+// CHECK-NEXT: tfrt.return [[ch2]] : !tfrt.chain
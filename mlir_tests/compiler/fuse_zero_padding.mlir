@@ -0,0 +1,77 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// RUN: tfrt_opt -allow-unregistered-dialect -tfrt-fuse-zero-padding %s | FileCheck %s
+
+// CHECK-LABEL: func @conv2d
+func.func @conv2d(%input: !t.tensor, %filter: !t.tensor, %output: !t.tensor,
+                  %ch0: !tfrt.chain) -> !tfrt.chain {
+  // CHECK-NOT: tfrt_dht.create_uninitialized_tensor
+  // CHECK-NOT: "eigen.zero_padding.f32"
+  // CHECK: [[ch:%[0-9]+]] = "eigen.zero_padding.conv2d.f32"(%arg0, %arg1, %arg2, %arg3)
+  // CHECK-SAME: padding = "valid"
+  // CHECK-SAME: zero_padding = [3, 3]
+  // CHECK-NEXT: tfrt.return [[ch]]
+  %padded = tfrt_dht.create_uninitialized_tensor.f32.4 [1 : i64, 230 : i64, 230 : i64, 3 : i64]
+  %ch1 = "eigen.zero_padding.f32"(%input, %padded, %ch0) {padding = [3, 3]}
+    : (!t.tensor, !t.tensor, !tfrt.chain) -> !tfrt.chain
+  %ch2 = "eigen.conv2d.f32"(%padded, %filter, %output, %ch1)
+    {padding = "valid", strides = [2, 2]}
+    : (!t.tensor, !t.tensor, !t.tensor, !tfrt.chain) -> !tfrt.chain
+  tfrt.return %ch2 : !tfrt.chain
+}
+
+// CHECK-LABEL: func @max_pooling
+func.func @max_pooling(%input: !t.tensor, %padded: !t.tensor,
+                       %output: !t.tensor, %ch0: !tfrt.chain) -> !tfrt.chain {
+  // CHECK: [[ch:%[0-9]+]] = "eigen.zero_padding.max_pooling_2d.f32"(%arg0, %arg2, %arg3)
+  // CHECK-SAME: zero_padding = [1, 1]
+  // CHECK-NEXT: tfrt.return [[ch]]
+  %ch1 = "eigen.zero_padding.f32"(%input, %padded, %ch0) {padding = [1, 1]}
+    : (!t.tensor, !t.tensor, !tfrt.chain) -> !tfrt.chain
+  %ch2 = "eigen.max_pooling_2d.f32"(%padded, %output, %ch1)
+    {ksize = [3, 3], padding = "valid", strides = [2, 2]}
+    : (!t.tensor, !t.tensor, !tfrt.chain) -> !tfrt.chain
+  tfrt.return %ch2 : !tfrt.chain
+}
+
+// The padded tensor is read by another kernel, so it is still needed.
+// CHECK-LABEL: func @padded_tensor_used
+func.func @padded_tensor_used(%input: !t.tensor, %padded: !t.tensor,
+                              %output: !t.tensor, %ch0: !tfrt.chain)
+    -> (!t.tensor, !tfrt.chain) {
+  // CHECK: "eigen.zero_padding.f32"
+  // CHECK: "eigen.max_pooling_2d.f32"
+  %ch1 = "eigen.zero_padding.f32"(%input, %padded, %ch0) {padding = [1, 1]}
+    : (!t.tensor, !t.tensor, !tfrt.chain) -> !tfrt.chain
+  %ch2 = "eigen.max_pooling_2d.f32"(%padded, %output, %ch1)
+    {ksize = [3, 3], padding = "valid", strides = [2, 2]}
+    : (!t.tensor, !t.tensor, !tfrt.chain) -> !tfrt.chain
+  tfrt.return %padded, %ch2 : !t.tensor, !tfrt.chain
+}
+
+// The "same" padding of the consumer can not be combined with zeros.
+// CHECK-LABEL: func @same_padding
+func.func @same_padding(%input: !t.tensor, %padded: !t.tensor,
+                        %filter: !t.tensor, %output: !t.tensor,
+                        %ch0: !tfrt.chain) -> !tfrt.chain {
+  // CHECK: "eigen.zero_padding.f32"
+  // CHECK: "eigen.conv2d.f32"
+  %ch1 = "eigen.zero_padding.f32"(%input, %padded, %ch0) {padding = [1, 1]}
+    : (!t.tensor, !t.tensor, !tfrt.chain) -> !tfrt.chain
+  %ch2 = "eigen.conv2d.f32"(%padded, %filter, %output, %ch1)
+    {padding = "same", strides = [1, 1]}
+    : (!t.tensor, !t.tensor, !t.tensor, !tfrt.chain) -> !tfrt.chain
+  tfrt.return %ch2 : !tfrt.chain
+}
@@ -0,0 +1,54 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// RUN: tfrt_opt -allow-unregistered-dialect -tfrt-print-memory-plan -verify-diagnostics %s
+
+// expected-remark@+1 {{slab size: 192, total buffer size: 256}}
+func.func @chain(%arg: tensor<4x4xf32>) -> tensor<4x4xf32> {
+  // %a is dead when %c is defined, so they share memory. %b is live while
+  // both of them are accessed.
+  // expected-remark@+1 {{buffer offset: 128, size: 64}}
+  %a = "test.op"(%arg) : (tensor<4x4xf32>) -> tensor<4x4xf32>
+  // expected-remark@+1 {{buffer offset: 0, size: 128}}
+  %b = "test.op"(%a) : (tensor<4x4xf32>) -> tensor<8x4xf32>
+  // expected-remark@+1 {{buffer offset: 128, size: 64}}
+  %c = "test.op"(%b) : (tensor<8x4xf32>) -> tensor<4x4xf32>
+
+  // Returned values are not planned.
+  %d = "test.op"(%c) : (tensor<4x4xf32>) -> tensor<4x4xf32>
+  tfrt.return %d : tensor<4x4xf32>
+}
+
+// expected-remark@+1 {{slab size: 128, total buffer size: 128}}
+func.func @independent(%arg: tensor<16xf32>) -> tensor<16xf32> {
+  // %a and %b might be computed concurrently, so they can't share memory even
+  // though %a has no user after %b in program order.
+  // expected-remark@+1 {{buffer offset: 0, size: 64}}
+  %a = "test.op"(%arg) : (tensor<16xf32>) -> tensor<16xf32>
+  %a0 = "test.op"(%a) : (tensor<16xf32>) -> tensor<?xf32>
+  // expected-remark@+1 {{buffer offset: 64, size: 64}}
+  %b = "test.op"(%arg) : (tensor<16xf32>) -> tensor<16xf32>
+  %c = "test.op"(%a0, %b) : (tensor<?xf32>, tensor<16xf32>) -> tensor<16xf32>
+  tfrt.return %c : tensor<16xf32>
+}
+
+// expected-remark@+1 {{slab size: 64, total buffer size: 10}}
+func.func @unplanned(%arg: tensor<?xf32>) -> tensor<?xf32> {
+  // Dynamically shaped values are not planned.
+  %a = "test.op"(%arg) : (tensor<?xf32>) -> tensor<?xf32>
+  // Values without users are planned, as their buffers are still allocated.
+  // expected-remark@+1 {{buffer offset: 0, size: 10}}
+  %b = "test.op"(%arg) : (tensor<?xf32>) -> tensor<5xi16>
+  tfrt.return %a : tensor<?xf32>
+}
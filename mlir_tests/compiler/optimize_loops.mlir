@@ -0,0 +1,77 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// RUN: tfrt_opt -tfrt-optimize-loops %s | FileCheck %s
+
+// CHECK-LABEL: func @hoist
+func.func @hoist(%n: i32, %x: i32) -> i32 {
+  // CHECK: [[one:%[0-9]+]] = tfrt.constant.i32 1
+  // CHECK-NEXT: [[two:%[0-9]+]] = tfrt.constant.i32 2
+  // CHECK-NEXT: [[three:%[0-9]+]] = tfrt.add.i32 [[one]], [[two]]
+  // CHECK-NEXT: [[r:%[0-9]+]]:2 = tfrt.repeat.i32 %arg0, %arg1, [[three]] : i32, i32 {
+  %r = tfrt.repeat.i32 %n, %x : i32 {
+    %one = tfrt.constant.i32 1
+    %two = tfrt.constant.i32 2
+    %three = tfrt.add.i32 %one, %two
+    // CHECK-NEXT: [[y:%[0-9]+]] = tfrt.add.i32 %arg1, [[three]]
+    %y = tfrt.add.i32 %x, %three
+    // CHECK-NEXT: tfrt.return [[y]], [[three]] : i32, i32
+    tfrt.return %y : i32
+  }
+  // CHECK: tfrt.return [[r]]#0 : i32
+  tfrt.return %r : i32
+}
+
+// CHECK-LABEL: func @constants_stay
+func.func @constants_stay(%n: i32, %x: i32) -> i32 {
+  // Constants alone are cheaper to recompute than to pass in.
+  // CHECK-NEXT: tfrt.repeat.i32 %arg0, %arg1 : i32 {
+  // CHECK-NEXT: tfrt.constant.i32 1
+  %r = tfrt.repeat.i32 %n, %x : i32 {
+    %one = tfrt.constant.i32 1
+    %y = tfrt.add.i32 %x, %one
+    tfrt.return %y : i32
+  }
+  tfrt.return %r : i32
+}
+
+// CHECK-LABEL: func @unroll
+func.func @unroll(%x: i32) -> i32 {
+  // CHECK-NEXT: [[n:%[0-9]+]] = tfrt.constant.i32 2
+  // CHECK-NEXT: tfrt.repeat.i32 [[n]], %arg0 : i32 {
+  // CHECK-COUNT-4: tfrt.add.i32
+  // CHECK-NOT: tfrt.add.i32
+  // CHECK: tfrt.return
+  %n = tfrt.constant.i32 8
+  %r = tfrt.repeat.i32 %n, %x : i32 {
+    %one = tfrt.constant.i32 1
+    %y = tfrt.add.i32 %x, %one
+    tfrt.return %y : i32
+  }
+  tfrt.return %r : i32
+}
+
+// CHECK-LABEL: func @no_unroll_remainder
+func.func @no_unroll_remainder(%x: i32) -> i32 {
+  // CHECK-NEXT: tfrt.constant.i32 6
+  // CHECK-COUNT-1: tfrt.add.i32
+  // CHECK-NOT: tfrt.add.i32
+  %n = tfrt.constant.i32 6
+  %r = tfrt.repeat.i32 %n, %x : i32 {
+    %one = tfrt.constant.i32 1
+    %y = tfrt.add.i32 %x, %one
+    tfrt.return %y : i32
+  }
+  tfrt.return %r : i32
+}
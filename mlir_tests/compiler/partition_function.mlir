@@ -0,0 +1,74 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// RUN: tfrt_opt -tfrt-partition-function %s | FileCheck %s
+
+// CHECK-LABEL: func @two_hosts(%arg0: i32) -> i32
+func.func @two_hosts(%x: i32) -> i32 {
+  // CHECK-NEXT: [[ch:%[0-9]+]] = tfrt.new.chain
+  // CHECK-NEXT: [[y:%[0-9]+]]:2 = tfrt.recv [[ch]] key("two_hosts:0") : i32
+  // CHECK-NEXT: [[z:%[0-9]+]] = tfrt.add.i32 [[y]]#0, %arg0
+  // CHECK-NEXT: tfrt.return [[z]] : i32
+  %y = tfrt.add.i32 %x, %x {device = "/job:worker/task:1/device:CPU:0"}
+  %z = tfrt.add.i32 %y, %x
+  tfrt.return %z : i32
+}
+
+// CHECK-LABEL: func @"two_hosts@/job:worker/task:1"(%arg0: i32) -> !tfrt.chain
+// CHECK-NEXT: [[ch:%[0-9]+]] = tfrt.new.chain
+// CHECK-NEXT: [[y:%[0-9]+]] = tfrt.add.i32 %arg0, %arg0 {device = "/job:worker/task:1/device:CPU:0"}
+// CHECK-NEXT: [[sent:%[0-9]+]] = tfrt.send [[y]], [[ch]] key("two_hosts:0") : i32
+// CHECK-NEXT: tfrt.return [[sent]] : !tfrt.chain
+
+// CHECK-LABEL: func @three_hosts(%arg0: !tfrt.chain, %arg1: i32) -> !tfrt.chain
+func.func @three_hosts(%ch0: !tfrt.chain, %x: i32) -> !tfrt.chain {
+  // The value of task 1 is sent once to each of the other hosts, and the chain
+  // of task 2 is sent back to the default host.
+  // CHECK-NEXT: [[ch:%[0-9]+]] = tfrt.new.chain
+  // CHECK-NEXT: [[y:%[0-9]+]]:2 = tfrt.recv [[ch]] key("three_hosts:1") : i32
+  // CHECK-NEXT: [[z:%[0-9]+]] = tfrt.add.i32 [[y]]#0, [[y]]#0
+  // CHECK-NEXT: [[ch2:%[0-9]+]]:2 = tfrt.recv [[ch]] key("three_hosts:2") : !tfrt.chain
+  // CHECK-NEXT: [[ch3:%[0-9]+]] = tfrt.print.i32 [[z]], [[ch2]]#0
+  // CHECK-NEXT: tfrt.return [[ch3]] : !tfrt.chain
+  %y = tfrt.add.i32 %x, %x {device = "/job:worker/task:1/device:CPU:0"}
+  %ch1 = tfrt.print.i32 %y, %ch0 {device = "/job:worker/task:2/device:CPU:0"}
+  %z = tfrt.add.i32 %y, %y
+  %ch2 = tfrt.print.i32 %y, %ch1 {device = "/job:worker/task:2/device:CPU:1"}
+  %ch3 = tfrt.print.i32 %z, %ch2
+  tfrt.return %ch3 : !tfrt.chain
+}
+
+// CHECK-LABEL: func @"three_hosts@/job:worker/task:1"(%arg0: !tfrt.chain, %arg1: i32) -> !tfrt.chain
+// CHECK-NEXT: [[ch:%[0-9]+]] = tfrt.new.chain
+// CHECK-NEXT: [[y:%[0-9]+]] = tfrt.add.i32 %arg1, %arg1
+// CHECK-NEXT: [[sent0:%[0-9]+]] = tfrt.send [[y]], [[ch]] key("three_hosts:0") : i32
+// CHECK-NEXT: [[sent1:%[0-9]+]] = tfrt.send [[y]], [[ch]] key("three_hosts:1") : i32
+// CHECK-NEXT: [[done:%[0-9]+]] = tfrt.merge.chains [[sent0]], [[sent1]] : !tfrt.chain, !tfrt.chain
+// CHECK-NEXT: tfrt.return [[done]] : !tfrt.chain
+
+// CHECK-LABEL: func @"three_hosts@/job:worker/task:2"(%arg0: !tfrt.chain, %arg1: i32) -> !tfrt.chain
+// CHECK-NEXT: [[ch:%[0-9]+]] = tfrt.new.chain
+// CHECK-NEXT: [[y:%[0-9]+]]:2 = tfrt.recv [[ch]] key("three_hosts:0") : i32
+// CHECK-NEXT: [[ch1:%[0-9]+]] = tfrt.print.i32 [[y]]#0, %arg0
+// CHECK-NEXT: [[ch2:%[0-9]+]] = tfrt.print.i32 [[y]]#0, [[ch1]]
+// CHECK-NEXT: [[sent:%[0-9]+]] = tfrt.send [[ch2]], [[ch]] key("three_hosts:2") : !tfrt.chain
+// CHECK-NEXT: tfrt.return [[sent]] : !tfrt.chain
+
+// CHECK-LABEL: func @one_host
+func.func @one_host(%x: i32) -> i32 {
+  // CHECK-NEXT: tfrt.add.i32 %arg0, %arg0
+  // CHECK-NEXT: tfrt.return
+  %y = tfrt.add.i32 %x, %x
+  tfrt.return %y : i32
+}
@@ -0,0 +1,70 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// RUN: bef_executor --test_init_function=register_op_handlers_cpu %s.bef | FileCheck %s
+
+// corert.executeop.seq_batch is normally produced by tfrt-batch-execute-op-seq.
+
+func.func @register_op_handlers_cpu() {
+  %null = "corert.create_null_op_handler"() : () -> !corert.ophandler
+  %cpu = "corert.create_cpu_op_handler"(%null) : (!corert.ophandler) -> !corert.ophandler
+  corert.register_op_handler %cpu "cpu"
+  tfrt.return
+}
+
+// CHECK-LABEL: --- Running 'seq_batch'
+func.func @seq_batch() -> !tfrt.chain {
+  %ch0 = tfrt.new.chain
+  %cpu = corert.get_op_handler %ch0 "cpu"
+
+  %a_handle = corert.executeop(%cpu)
+    "tfrt_test.create_dense_tensor"() { shape = [1, 3], values = [1 : i32, 2 : i32, 3 : i32] } : 1
+
+  // The ops run in order, before the ops sequenced after the batch.
+  // CHECK: DenseHostTensor dtype = i32, shape = [1, 3], values = [1, 2, 3]
+  // CHECK-NEXT: DenseHostTensor dtype = i32, shape = [1, 3], values = [1, 2, 3]
+  // CHECK-NEXT: DenseHostTensor dtype = i32, shape = [1, 3], values = [4, 5, 6]
+  // CHECK-NEXT: DenseHostTensor dtype = i32, shape = [1, 3], values = [2, 4, 6]
+  %ch1, %b_handle, %c_handle = corert.executeop.seq_batch(%cpu, %ch0) (%a_handle, %a_handle, %a_handle, %a_handle)
+    {op_attrs = [[], [["shape", [1, 3]], ["values", [4 : i32, 5 : i32, 6 : i32]]], [], []],
+     op_func_attrs = [[], [], [], []],
+     op_names = ["tfrt_test.print", "tfrt_test.create_dense_tensor", "tfrt_test.add", "tfrt_test.print"],
+     op_num_args = [1 : i32, 0 : i32, 2 : i32, 1 : i32],
+     op_num_results = [0 : i32, 1 : i32, 1 : i32, 0 : i32]} : 2
+
+  %ch2 = corert.executeop.seq(%cpu, %ch1) "tfrt_test.print"(%b_handle) : 0
+  %ch3 = corert.executeop.seq(%cpu, %ch2) "tfrt_test.print"(%c_handle) : 0
+  tfrt.return %ch3 : !tfrt.chain
+}
+
+// CHECK-LABEL: --- Running 'seq_batch_error'
+func.func @seq_batch_error() -> !tfrt.chain {
+  %ch0 = tfrt.new.chain
+  %cpu = corert.get_op_handler %ch0 "cpu"
+
+  %a_handle = corert.executeop(%cpu)
+    "tfrt_test.create_dense_tensor"() { shape = [1], values = [1 : i32] } : 1
+
+  // The ops after a failing op are not executed.
+  // CHECK: DenseHostTensor dtype = i32, shape = [1], values = [1]
+  // CHECK-NOT: DenseHostTensor
+  // expected-error @+1 {{tf.invalidop was not supported by NullOpHandler}}
+  %ch1 = corert.executeop.seq_batch(%cpu, %ch0) (%a_handle, %a_handle)
+    {op_attrs = [[], [], []], op_func_attrs = [[], [], []],
+     op_names = ["tfrt_test.print", "tf.invalidop", "tfrt_test.print"],
+     op_num_args = [1 : i32, 0 : i32, 1 : i32],
+     op_num_results = [0 : i32, 0 : i32, 0 : i32]}
+  tfrt.return %ch1 : !tfrt.chain
+}
@@ -0,0 +1,49 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// RUN: bef_executor --test_init_function=register_op_handlers_cpu %s.bef | FileCheck %s
+
+func.func @register_op_handlers_cpu() {
+  %null = "corert.create_null_op_handler"() : () -> !corert.ophandler
+  %cpu = "corert.create_cpu_op_handler"(%null) : (!corert.ophandler) -> !corert.ophandler
+  corert.register_op_handler %cpu "cpu"
+  tfrt.return
+}
+
+// A sync body is run by the BEFInterpreter on the TensorHandles of the call.
+func.func @sync_relu_add(%x: !corert.tensorhandle, %y: !corert.tensorhandle) -> !corert.tensorhandle attributes {tfrt.sync} {
+  %cpu = corert_sync.get_op_handler "cpu"
+  %relu = corert_sync.executeop(%cpu) "tfrt_test.relu"(%x) : 1
+  %sum = corert_sync.executeop(%cpu) "tfrt_test.add"(%relu, %y) : 1
+  tfrt.return %sum : !corert.tensorhandle
+}
+
+// CHECK-LABEL: --- Running 'corert.composite_op_sync_body'
+func.func @corert.composite_op_sync_body() -> !tfrt.chain {
+  %ch0 = tfrt.new.chain
+  %cpu = corert.get_op_handler %ch0 "cpu"
+  %a_handle = corert.executeop(%cpu)
+    "tfrt_test.create_dense_tensor"() { shape = [2], values = [-1.0 : f32, 2.0 : f32] } : 1
+  %b_handle = corert.executeop(%cpu)
+    "tfrt_test.create_dense_tensor"() { shape = [2], values = [1.0 : f32] } : 1
+
+  %fn_op = "corert.make_composite_op" () {fn=@sync_relu_add} : () -> !corert.op
+
+  %result = "corert.execute_crt_op" (%fn_op, %a_handle, %b_handle) {op_attrs =[], op_func_attrs = []} : (!corert.op, !corert.tensorhandle, !corert.tensorhandle) -> (!corert.tensorhandle)
+
+  // CHECK: DenseHostTensor dtype = f32, shape = [2], values = [1.000000e+00, 3.000000e+00]
+  %ch1 = "corert.print_tensorhandle"(%result, %ch0) : (!corert.tensorhandle, !tfrt.chain) -> !tfrt.chain
+
+  tfrt.return %ch1 : !tfrt.chain
+}
@@ -0,0 +1,130 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// RUN: bef_executor %s.bef | FileCheck %s
+// RUN: bef_executor -work_queue_type=mstd %s.bef | FileCheck %s
+
+func.func @times_ten(%value: i64) -> i64 {
+  %ten = tfrt.constant.i64 10
+  %result = tfrt.mul.i64 %value, %ten
+  tfrt.return %result : i64
+}
+
+func.func @print_batch(%batch: !tfrt_tensor.tensor, %ch0: !tfrt.chain) -> !tfrt.chain {
+  %ch1 = tfrt_dht.print_tensor %batch, %ch0
+  tfrt.return %ch1 : !tfrt.chain
+}
+
+func.func @count(%value: !tfrt_tensor.tensor, %count: i64) -> i64 {
+  %one = tfrt.constant.i64 1
+  %next = tfrt.add.i64 %count, %one
+  tfrt.return %next : i64
+}
+
+func.func @sum(%value: i64, %sum: i64) -> i64 {
+  %next = tfrt.add.i64 %sum, %value
+  tfrt.return %next : i64
+}
+
+// CHECK-LABEL: --- Running 'data_pipeline_test'
+func.func @data_pipeline_test() -> !tfrt.chain {
+  %ch0 = tfrt.new.chain
+  %start = tfrt.constant.i64 0
+  %stop = tfrt.constant.i64 5
+  %step = tfrt.constant.i64 1
+
+  %range = tfrt_data.range_source %start, %stop, %step buffer_size(2)
+  %mapped = tfrt_data.map %range @times_ten parallelism(2) buffer_size(2)
+  %batches = tfrt_data.batch %mapped batch_size(2) drop_remainder(false) buffer_size(1)
+  %prefetched = tfrt_data.prefetch %batches buffer_size(2)
+
+  // CHECK: DenseHostTensor dtype = i64, shape = [2], values = [0, 10]
+  // CHECK: DenseHostTensor dtype = i64, shape = [2], values = [20, 30]
+  // CHECK: DenseHostTensor dtype = i64, shape = [1], values = [40]
+  %ch1 = tfrt.stream.for %prefetched @print_batch(%ch0) : (!tfrt.chain) -> (!tfrt.chain)
+
+  tfrt.return %ch1 : !tfrt.chain
+}
+
+// CHECK-LABEL: --- Running 'data_batch_drop_remainder_test'
+func.func @data_batch_drop_remainder_test() -> i64 {
+  %zero = tfrt.constant.i64 0
+  %five = tfrt.constant.i64 5
+  %one = tfrt.constant.i64 1
+
+  %range = tfrt_data.range_source %zero, %five, %one buffer_size(1)
+  %batches = tfrt_data.batch %range batch_size(2) drop_remainder(true) buffer_size(1)
+  %count = tfrt.stream.for %batches @count(%zero) : (i64) -> (i64)
+
+  // CHECK: 'data_batch_drop_remainder_test' returned 2
+  tfrt.return %count : i64
+}
+
+// The shuffled values are a permutation of the input.
+// CHECK-LABEL: --- Running 'data_shuffle_test'
+func.func @data_shuffle_test() -> i64 {
+  %zero = tfrt.constant.i64 0
+  %ten = tfrt.constant.i64 10
+  %one = tfrt.constant.i64 1
+
+  %range = tfrt_data.range_source %zero, %ten, %one buffer_size(2)
+  %shuffled = tfrt_data.shuffle %range shuffle_size(4) seed(7) buffer_size(2)
+  %sum = tfrt.stream.for %shuffled @sum(%zero) : (i64) -> (i64)
+
+  // CHECK: 'data_shuffle_test' returned 45
+  tfrt.return %sum : i64
+}
+
+// CHECK-LABEL: --- Running 'data_range_zero_step_test'
+func.func @data_range_zero_step_test() -> i64 {
+  %zero = tfrt.constant.i64 0
+  %one = tfrt.constant.i64 1
+
+  %range = tfrt_data.range_source %zero, %one, %zero buffer_size(1)
+  %sum = tfrt.stream.for %range @sum(%zero) : (i64) -> (i64)
+
+  // CHECK: 'data_range_zero_step_test' returned <<error: tfrt_data.range_source step must not be zero>>
+  tfrt.return %sum : i64
+}
+
+// CHECK-LABEL: --- Running 'data_text_line_missing_file_test'
+func.func @data_text_line_missing_file_test() -> !tfrt.channel {
+  %path = "tfrt_test.get_string"() { value = "/nonexistent/lines.txt" } : () -> !tfrt.string
+
+  %lines = tfrt_data.text_line_source %path buffer_size(1)
+
+  // CHECK: 'data_text_line_missing_file_test' returned <<error:
+  tfrt.return %lines : !tfrt.channel
+}
+
+// CHECK-LABEL: --- Running 'data_record_missing_file_test'
+func.func @data_record_missing_file_test() -> !tfrt.channel {
+  %path = "tfrt_test.get_string"() { value = "/nonexistent/records.tfrecord" } : () -> !tfrt.string
+
+  %batches = tfrt_data.record_source %path batch_size(2) buffer_size(1)
+
+  // CHECK: 'data_record_missing_file_test' returned <<error:
+  tfrt.return %batches : !tfrt.channel
+}
+
+// CHECK-LABEL: --- Running 'data_record_no_files_test'
+func.func @data_record_no_files_test() -> i64 {
+  %zero = tfrt.constant.i64 0
+
+  %batches = tfrt_data.record_source batch_size(2) buffer_size(1)
+  %count = tfrt.stream.for %batches @count(%zero) : (i64) -> (i64)
+
+  // CHECK: 'data_record_no_files_test' returned 0
+  tfrt.return %count : i64
+}
@@ -64,3 +64,11 @@ func.func @sync_fn_return_duplicated(%1: i32) -> (i32, i32) attributes {tfrt.syn
   // expected-error @+1 {{return value 1 is duplicated in a sync function}}
   tfrt.return %c1, %c1 : i32, i32
 }
+
+// -----
+
+func.func @fused_fn_timeout(%a: i32) -> i32 attributes {tfrt.fused} {
+  // expected-error @+1 {{'_tfrt_timeout_ms' is not supported in a fused function}}
+  %b = "tfrt_test.async_copy.i32"(%a) {_tfrt_timeout_ms = 10 : i64} : (i32) -> i32
+  tfrt.return %b : i32
+}
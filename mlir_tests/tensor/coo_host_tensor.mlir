@@ -23,7 +23,7 @@ func.func @basic_tensor() {
   %c1 = tfrt_dht.fill_tensor_with_constant.i32 %a, %c0 4 : i32
   %s1, %c2 = coo.convert_dht_to_coo.i32.2 %a, %c1
 
-  // CHECK: dtype = i32, shape = [3, 2], indices = [0, 0, 0, 1, 0, 2, 1, 0, 1, 1, 1, 2], values = [4, 4, 4, 4, 4, 4]
+  // CHECK: dtype = i32, shape = [3, 2], indices = [0, 0, 0, 1, 1, 0, 1, 1, 2, 0, 2, 1], values = [4, 4, 4, 4, 4, 4]
   %c3 = tfrt_dht.print_tensor %s1, %c2
 
   %z = tfrt_dht.create_uninitialized_tensor.i32.2 [2 : i64, 3 : i64]
@@ -59,6 +59,22 @@ func.func @tensor_roundtrip() {
   tfrt.return
 }
 
+// CHECK-LABEL: --- Running 'non_square_tensor_roundtrip'
+func.func @non_square_tensor_roundtrip() {
+  %c1 = tfrt.new.chain
+
+  %a = tfrt_dht.create_uninitialized_tensor.i32.3 [3 : i64, 5 : i64, 2 : i64]
+  %s, %c2 = coo.convert_dht_to_coo.i32.3 %a, %c1
+  %d, %c3 = coo.convert_coo_to_dht.i32.3 %s, %c2
+
+  %cmp, %c4 = tfrt_dht.tensor_equal.i32 %a, %d, %c3
+
+  // CHECK: int1 = 1
+  "tfrt.print.i1"(%cmp, %c4) : (i1, !tfrt.chain) -> (!tfrt.chain)
+
+  tfrt.return
+}
+
 // Testing tensor_equal.
 // CHECK-LABEL: --- Running 'tensor_equal'
 func.func @tensor_equal() {
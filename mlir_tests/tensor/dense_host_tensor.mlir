@@ -0,0 +1,72 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// RUN: bef_executor %s.bef | FileCheck %s
+// RUN: tfrt_opt %s | tfrt_opt
+
+// CHECK-LABEL: --- Running 'zeroed_tensor'
+func.func @zeroed_tensor() {
+  %c0 = tfrt.new.chain
+
+  %a = tfrt_dht.create_zeroed_tensor.f32.2 [2 : i64, 2 : i64]
+  // CHECK: DenseHostTensor dtype = f32, shape = [2, 2], values = [0.000000e+00, 0.000000e+00, 0.000000e+00, 0.000000e+00]
+  %c1 = tfrt_dht.print_tensor %a, %c0
+
+  %b = tfrt_dht.create_zeroed_tensor.bool.1 [3 : i64]
+  // CHECK: DenseHostTensor dtype = i1, shape = [3], values = [0, 0, 0]
+  %c2 = tfrt_dht.print_tensor %b, %c1
+
+  tfrt.return
+}
+
+// CHECK-LABEL: --- Running 'iota_tensor'
+func.func @iota_tensor() {
+  %c0 = tfrt.new.chain
+
+  %a = tfrt_dht.create_uninitialized_tensor.i32.2 [2 : i64, 3 : i64]
+  %c1 = tfrt_dht.fill_tensor_with_iota.i32 %a, %c0 {start = 5 : i32, step = -2 : i32}
+  // CHECK: DenseHostTensor dtype = i32, shape = [2, 3], values = [5, 3, 1, -1, -3, -5]
+  %c2 = tfrt_dht.print_tensor %a, %c1
+
+  %b = tfrt_dht.create_uninitialized_tensor.f32.1 [3 : i64]
+  %c3 = tfrt_dht.fill_tensor_with_iota.f32 %b, %c2 {start = 1.0 : f32, step = 0.5 : f32}
+  // CHECK: DenseHostTensor dtype = f32, shape = [3], values = [1.000000e+00, 1.500000e+00, 2.000000e+00]
+  %c4 = tfrt_dht.print_tensor %b, %c3
+
+  tfrt.return
+}
+
+// Tensors of 4MB and more are filled in parallel with non-temporal stores.
+// CHECK-LABEL: --- Running 'fill_large_tensor'
+func.func @fill_large_tensor() {
+  %c0 = tfrt.new.chain
+
+  %a = tfrt_dht.create_uninitialized_tensor.f32.1 [3000001 : i64]
+  %c1 = tfrt_dht.fill_tensor_with_constant.f32 %a, %c0 2.0 : f32
+
+  %b = tfrt_dht.create_uninitialized_tensor.f32.1 [3000001 : i64]
+  %c2 = tfrt_dht.fill_tensor_with_iota.f32 %b, %c1 {start = 2.0 : f32, step = 0.0 : f32}
+
+  %cmp, %c3 = tfrt_dht.tensor_equal.f32 %a, %b, %c2
+  // CHECK: int1 = 1
+  %c4 = "tfrt.print.i1"(%cmp, %c3) : (i1, !tfrt.chain) -> (!tfrt.chain)
+
+  %z = tfrt_dht.create_zeroed_tensor.f32.1 [3000001 : i64]
+  %c5 = tfrt_dht.fill_tensor_with_constant.f32 %b, %c4 0.0 : f32
+  %cmp2, %c6 = tfrt_dht.tensor_equal.f32 %z, %b, %c5
+  // CHECK: int1 = 1
+  %c7 = "tfrt.print.i1"(%cmp2, %c6) : (i1, !tfrt.chain) -> (!tfrt.chain)
+
+  tfrt.return
+}
@@ -26,3 +26,55 @@ func.func @basic() {
 
   tfrt.return
 }
+
+// CHECK-LABEL: --- Running 'contiguous'
+func.func @contiguous() {
+  %c0 = tfrt.new.chain
+
+  %a = "tfrt_sht.create_contiguous_tensor"()
+    {shape = [2], values = ["Hello ", "Tensor"]} : () -> !tfrt_tensor.tensor
+
+  // CHECK: ContiguousStringHostTensor shape = [2], values = ["Hello ", "Tensor"]
+  %c1 = tfrt_dht.print_tensor %a, %c0
+
+  %b = "tfrt_sht.create_contiguous_tensor"()
+    {shape = [2], values = ["World"]} : () -> !tfrt_tensor.tensor
+
+  // CHECK: ContiguousStringHostTensor shape = [2], values = ["Hello World", "TensorWorld"]
+  %concat = "tfrt_sht.concat"(%a, %b)
+    : (!tfrt_tensor.tensor, !tfrt_tensor.tensor) -> !tfrt_tensor.tensor
+  %c2 = tfrt_dht.print_tensor %concat, %c1
+
+  // CHECK: ContiguousStringHostTensor shape = [2], values = ["hello world", "tensorworld"]
+  %lower = "tfrt_sht.lower"(%concat)
+    : (!tfrt_tensor.tensor) -> !tfrt_tensor.tensor
+  %c3 = tfrt_dht.print_tensor %lower, %c2
+
+  %tokens, %row_splits = "tfrt_sht.split"(%lower) {delimiters = " "}
+    : (!tfrt_tensor.tensor) -> (!tfrt_tensor.tensor, !tfrt_tensor.tensor)
+
+  // CHECK: ContiguousStringHostTensor shape = [3], values = ["hello", "world", "tensorworld"]
+  %c4 = tfrt_dht.print_tensor %tokens, %c3
+  // CHECK: DenseHostTensor dtype = i64, shape = [3], values = [0, 2, 3]
+  %c5 = tfrt_dht.print_tensor %row_splits, %c4
+
+  tfrt.return
+}
+
+// CHECK-LABEL: --- Running 'split_skips_empty_tokens'
+func.func @split_skips_empty_tokens() {
+  %c0 = tfrt.new.chain
+
+  %a = "tfrt_sht.create_contiguous_tensor"()
+    {shape = [3], values = ["  a,b ", "", ",,"]} : () -> !tfrt_tensor.tensor
+
+  %tokens, %row_splits = "tfrt_sht.split"(%a) {delimiters = " ,"}
+    : (!tfrt_tensor.tensor) -> (!tfrt_tensor.tensor, !tfrt_tensor.tensor)
+
+  // CHECK: ContiguousStringHostTensor shape = [2], values = ["a", "b"]
+  %c1 = tfrt_dht.print_tensor %tokens, %c0
+  // CHECK: DenseHostTensor dtype = i64, shape = [4], values = [0, 2, 2, 2]
+  %c2 = tfrt_dht.print_tensor %row_splits, %c1
+
+  tfrt.return
+}
@@ -5,13 +5,19 @@
 // Unit tests and benchmarks for MultiThreadedWorkQueue.
 
 #include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
 
 #include "gtest/gtest.h"
+#include "numa_topology.h"
 #include "tfrt/host_context/async_dispatch.h"
 #include "tfrt/host_context/concurrent_work_queue.h"
 #include "tfrt/host_context/diagnostic.h"
 #include "tfrt/host_context/host_allocator.h"
 #include "tfrt/host_context/host_context.h"
+#include "tfrt/metrics/in_process_metrics.h"
+#include "tfrt/support/string_util.h"
 
 namespace tfrt {
 namespace {
@@ -50,5 +56,192 @@ TEST(MultiThreadedWorkQueueTest, PingPong) {
   ASSERT_EQ(last_executed_task, num_tasks - 1);
 }
 
+TEST(MultiThreadedWorkQueueTest, RunsTasksOfAllPriorities) {
+  auto host = CreateTestHostContext(4);
+
+  std::atomic<int> num_executed{0};
+  const int num_tasks = 1000;
+  const TaskPriority priorities[] = {TaskPriority::kCritical,
+                                     TaskPriority::kHigh,
+                                     TaskPriority::kDefault, TaskPriority::kLow};
+  for (int i = 0; i < num_tasks; ++i) {
+    host->work_queue().AddTask(TaskFunction([&]() { ++num_executed; }),
+                               priorities[i % 4]);
+  }
+
+  host->Quiesce();
+  ASSERT_EQ(num_executed, num_tasks);
+}
+
+TEST(MultiThreadedWorkQueueTest, RunsTasksWithAffinity) {
+  auto host = CreateTestHostContext(4);
+
+  // Tasks added from outside the pool and from its workers, which push the
+  // tasks with other affinities to the queues of other workers.
+  std::atomic<int> num_executed{0};
+  const int num_tasks = 1000;
+  for (int i = 0; i < num_tasks; ++i) {
+    host->work_queue().AddTask(
+        TaskFunction([&, i]() {
+          ++num_executed;
+          host->work_queue().AddTask(TaskFunction([&]() { ++num_executed; }),
+                                     TaskPriority::kDefault,
+                                     TaskAffinity{static_cast<uint64_t>(i)});
+        }),
+        TaskPriority::kDefault, TaskAffinity{static_cast<uint64_t>(i % 8)});
+  }
+
+  host->Quiesce();
+  ASSERT_EQ(num_executed, 2 * num_tasks);
+}
+
+TEST(MultiThreadedWorkQueueTest, EarliestDeadlineFirst) {
+  MultiThreadedWorkQueueOptions options;
+  options.earliest_deadline_first = true;
+  auto work_queue = CreateMultiThreadedWorkQueue(1, 1, options);
+
+  // Keep the only worker thread busy while the deadline tasks are added.
+  std::atomic<bool> started{false};
+  std::atomic<bool> release{false};
+  work_queue->AddTask(TaskFunction([&]() {
+    started = true;
+    while (!release) std::this_thread::yield();
+  }));
+  while (!started) std::this_thread::yield();
+
+  auto now = std::chrono::system_clock::now();
+  std::vector<int> order;
+  for (int i : {3, 1, 2}) {
+    work_queue->AddTask(TaskFunction([&order, i]() { order.push_back(i); }),
+                        TaskPriority::kDefault,
+                        now + std::chrono::seconds(i));
+  }
+
+  release = true;
+  work_queue->Quiesce();
+  EXPECT_EQ(order, std::vector<int>({1, 2, 3}));
+}
+
+TEST(MultiThreadedWorkQueueTest, NumaAwareRunsAllTasks) {
+  MultiThreadedWorkQueueOptions options;
+  options.numa_aware = true;
+  auto host = std::make_unique<HostContext>(
+      [](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+      CreateMultiThreadedWorkQueue(4, 4, options));
+
+  std::atomic<int> num_executed{0};
+  const int num_tasks = 1000;
+  for (int i = 0; i < num_tasks; ++i)
+    EnqueueWork(host.get(), [&]() { ++num_executed; });
+
+  host->Quiesce();
+  ASSERT_EQ(num_executed, num_tasks);
+}
+
+TEST(MultiThreadedWorkQueueTest, RunsTaskBatches) {
+  auto work_queue = CreateMultiThreadedWorkQueue(4, 1);
+
+  // Batches are submitted both by an external thread and by a worker thread,
+  // and larger than the number of workers.
+  std::atomic<int> num_executed{0};
+  auto make_batch = [&](int size) {
+    std::vector<TaskFunction> tasks;
+    for (int i = 0; i < size; ++i)
+      tasks.push_back(TaskFunction([&]() { ++num_executed; }));
+    return tasks;
+  };
+  std::vector<TaskFunction> tasks = make_batch(100);
+  work_queue->AddTasks(tasks, TaskPriority::kDefault);
+  work_queue->AddTask(TaskFunction([&]() {
+    std::vector<TaskFunction> tasks = make_batch(100);
+    work_queue->AddTasks(tasks, TaskPriority::kHigh);
+  }));
+  work_queue->AddTasks({}, TaskPriority::kDefault);
+
+  work_queue->Quiesce();
+  ASSERT_EQ(num_executed, 200);
+}
+
+TEST(MultiThreadedWorkQueueTest, RunsTasksWithIdlePolicies) {
+  for (bool adaptive : {false, true}) {
+    MultiThreadedWorkQueueOptions options;
+    options.idle_policy.max_spinning_threads = 4;
+    options.idle_policy.spin_count = adaptive ? 20000 : 0;
+    options.idle_policy.yield_count = 1000;
+    options.idle_policy.adaptive = adaptive;
+    auto work_queue = CreateMultiThreadedWorkQueue(4, 1, options);
+
+    // Tasks arrive in bursts separated by idle gaps, so that the workers
+    // spin, yield and park in between.
+    std::atomic<int> num_executed{0};
+    const int num_tasks = 1000;
+    for (int i = 0; i < num_tasks; ++i) {
+      if (i % 100 == 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      work_queue->AddTask(TaskFunction([&]() { ++num_executed; }));
+    }
+    work_queue->Quiesce();
+    ASSERT_EQ(num_executed, num_tasks);
+  }
+}
+
+TEST(MultiThreadedWorkQueueTest, CollectsStats) {
+  auto* registry = new metrics::InProcessMetricsRegistry;
+  metrics::RegisterMetricsRegistry(registry);
+
+  MultiThreadedWorkQueueOptions options;
+  options.thread_name_prefix = "stats-test";
+  options.collect_stats = true;
+  constexpr int kNumThreads = 2;
+  auto work_queue = CreateMultiThreadedWorkQueue(kNumThreads, 1, options);
+
+  std::atomic<int> num_executed{0};
+  const int num_tasks = 1000;
+  for (int i = 0; i < num_tasks; ++i)
+    work_queue->AddTask(TaskFunction([&]() { ++num_executed; }));
+  work_queue->Quiesce();
+  ASSERT_EQ(num_executed, num_tasks);
+
+  metrics::MetricsSnapshot snapshot = registry->Snapshot();
+  const std::string prefix = "/tfrt/work_queue/stats-test/";
+  int64_t num_enqueued = 0;
+  for (int i = 0; i < kNumThreads; ++i)
+    num_enqueued += snapshot.counters[StrCat(prefix, "tasks_enqueued/", i)];
+  EXPECT_EQ(num_enqueued, num_tasks);
+  EXPECT_EQ(snapshot.histograms[prefix + "queue_depth"].count, num_tasks);
+  EXPECT_EQ(snapshot.histograms[prefix + "task_latency_us"].count, num_tasks);
+  EXPECT_GE(snapshot.counters[prefix + "steals_attempted"],
+            snapshot.counters[prefix + "steals_succeeded"]);
+}
+
+TEST(MultiThreadedWorkQueueTest, AwaitInWorkerThreadRunsPendingTasks) {
+  // With a single worker thread, the value can only become available if the
+  // awaiting worker runs the task that sets it.
+  auto host = CreateTestHostContext(1);
+
+  std::atomic<bool> awaited{false};
+  EnqueueWork(host.get(), [&]() {
+    auto value = MakeUnconstructedAsyncValueRef<int>();
+    EnqueueWork(host.get(), [value = value.CopyRef()]() { value.emplace(42); });
+    host->Await(value.CopyRCRef());
+    awaited = value.IsAvailable() && value.get() == 42;
+  });
+
+  host->Quiesce();
+  EXPECT_TRUE(awaited);
+}
+
+TEST(NumaTopologyTest, AssignThreadsProportionally) {
+  std::vector<std::vector<int>> node_cpus = {{0, 1, 2, 3}, {4, 5}};
+  EXPECT_EQ(internal::AssignThreadsToNumaNodes(6, node_cpus),
+            std::vector<int>({0, 0, 0, 0, 1, 1}));
+  EXPECT_EQ(internal::AssignThreadsToNumaNodes(3, node_cpus),
+            std::vector<int>({0, 0, 1}));
+}
+
+TEST(NumaTopologyTest, SingleNodeHasNoPlacement) {
+  EXPECT_TRUE(internal::AssignThreadsToNumaNodes(4, {{0, 1, 2, 3}}).empty());
+}
+
 }  // namespace
 }  // namespace tfrt
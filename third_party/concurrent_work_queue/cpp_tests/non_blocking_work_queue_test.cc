@@ -6,6 +6,8 @@
 
 #include "non_blocking_work_queue.h"
 
+#include <vector>
+
 #include "benchmark/benchmark.h"
 #include "tfrt/host_context/task_function.h"
 #include "tfrt/support/latch.h"
@@ -52,6 +54,40 @@ void NoOp(WorkQueue& producer, WorkQueue& worker, benchmark::State& state) {
   state.SetItemsProcessed(num_producers * num_tasks * state.iterations());
 }
 
+// Same as NoOp, but every producer submits its `num_tasks` tasks as a single
+// batch.
+void NoOpBatch(WorkQueue& producer, WorkQueue& worker,
+               benchmark::State& state) {
+  const int num_producers = state.range(0);
+  const int num_tasks = state.range(1);
+
+  for (auto _ : state) {
+    ::tfrt::latch latch(2 * num_producers);
+
+    std::atomic<int>* counters = new std::atomic<int>[num_producers];
+    for (int i = 0; i < num_producers; ++i) counters[i] = num_tasks;
+
+    for (int i = 0; i < num_producers; ++i) {
+      producer.AddTask(TaskFunction([&, i] {
+        std::vector<TaskFunction> tasks;
+        tasks.reserve(num_tasks);
+        for (int j = 0; j < num_tasks; ++j) {
+          tasks.push_back(TaskFunction([&, i]() {
+            if (counters[i].fetch_sub(1) == 1) latch.count_down();
+          }));
+        }
+        worker.AddTasks(tasks, TaskPriority::kDefault);
+        latch.count_down();
+      }));
+    }
+
+    latch.wait();
+    delete[] counters;
+  }
+
+  state.SetItemsProcessed(num_producers * num_tasks * state.iterations());
+}
+
 #define BM_Run(FN, producer_threads, worker_threads)                 \
   static void BM_##FN##_tpool_##producer_threads##x##worker_threads( \
       benchmark::State& state) {                                     \
@@ -73,10 +109,25 @@ void NoOp(WorkQueue& producer, WorkQueue& worker, benchmark::State& state) {
       ->ArgPair(100, 100)                         \
       ->ArgPair(100, 1000)
 
+#define BM_NoOpBatch(producer_threads, worker_threads)  \
+  BM_Run(NoOpBatch, producer_threads, worker_threads) \
+      ->ArgPair(10, 10)                               \
+      ->ArgPair(10, 100)                              \
+      ->ArgPair(10, 1000)                             \
+      ->ArgPair(10, 10000)                            \
+      ->ArgPair(100, 10)                              \
+      ->ArgPair(100, 100)                             \
+      ->ArgPair(100, 1000)
+
 BM_NoOp(4, 4);
 BM_NoOp(8, 8);
 BM_NoOp(16, 16);
 BM_NoOp(32, 32);
 
+BM_NoOpBatch(4, 4);
+BM_NoOpBatch(8, 8);
+BM_NoOpBatch(16, 16);
+BM_NoOpBatch(32, 32);
+
 }  // namespace
 }  // namespace tfrt
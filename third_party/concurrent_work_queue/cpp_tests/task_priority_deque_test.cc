@@ -82,6 +82,21 @@ TEST(TaskPriorityDequeTest, PushAndPopFrontWithPriority) {
   ASSERT_EQ(queue.Size(), 0);
 }
 
+TEST(TaskPriorityDequeTest, PopFrontLowestPriorityFirst) {
+  TaskFunctions fn;
+  TaskPriorityDeque queue;
+
+  ASSERT_EQ(queue.PushFront(fn.Next(1), TaskPriority::kLow), std::nullopt);
+  ASSERT_EQ(queue.PushFront(fn.Next(2), TaskPriority::kDefault), std::nullopt);
+  ASSERT_EQ(queue.PushFront(fn.Next(3), TaskPriority::kCritical), std::nullopt);
+  ASSERT_EQ(queue.Size(), 3);
+
+  ASSERT_EQ(fn.Run(queue.PopFrontLowestPriorityFirst()), 1);
+  ASSERT_EQ(fn.Run(queue.PopFrontLowestPriorityFirst()), 2);
+  ASSERT_EQ(fn.Run(queue.PopFrontLowestPriorityFirst()), 3);
+  ASSERT_EQ(queue.PopFrontLowestPriorityFirst(), std::nullopt);
+}
+
 TEST(TaskPriorityDequeTest, PushAndPopBackDefaultPriority) {
   TaskFunctions fn;
   TaskPriorityDeque queue;
@@ -0,0 +1,241 @@
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+// Contention benchmarks for the multi-threaded work queue.
+//
+// Every benchmark runs `kNumProducers` producers, each submitting tasks that
+// spin for a fixed time, at an offered load of half the capacity of the
+// worker threads. The matrix covers:
+//
+//   queue:    the non-blocking queue, the blocking queue, and the alternative
+//             configurations of the non-blocking queue (NUMA-aware placement,
+//             mixed task priorities, earliest deadline first).
+//   producer: external threads, or tasks running on the worker threads of the
+//             queue under test.
+//   task:     50ns to 1ms of work per task.
+//   arrival:  steady arrivals, or bursts of tasks at the same average rate.
+//
+// Besides the throughput, the benchmarks report percentiles of the wakeup
+// latency (from enqueue to the start of the task) and of the task latency
+// (from enqueue to the end of the task), in microseconds.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/task_function.h"
+#include "tfrt/support/latch.h"
+
+namespace tfrt {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+enum class QueueKind : int {
+  kNonBlocking = 0,
+  kBlocking = 1,
+  kNumaAware = 2,
+  kPriority = 3,
+  kEarliestDeadlineFirst = 4,
+};
+
+enum class ProducerKind : int { kExternal = 0, kWorker = 1 };
+
+enum class ArrivalKind : int { kSteady = 0, kBurst = 1 };
+
+constexpr int kNumWorkers = 8;
+constexpr int kNumProducers = 4;
+// Number of tasks a producer submits back to back in burst mode.
+constexpr int kBurstSize = 2 * kNumWorkers;
+// Approximate amount of work submitted per benchmark iteration.
+constexpr std::chrono::nanoseconds kWorkPerIteration =
+    std::chrono::milliseconds(50);
+
+void SpinFor(std::chrono::nanoseconds duration) {
+  const auto end = Clock::now() + duration;
+  while (Clock::now() < end) {
+  }
+}
+
+void SpinUntil(Clock::time_point time) {
+  while (Clock::now() < time) {
+  }
+}
+
+// The enqueue, start and end times of a task.
+struct TaskTimes {
+  Clock::time_point enqueued;
+  Clock::time_point started;
+  Clock::time_point finished;
+};
+
+class ContentionBenchmark {
+ public:
+  ContentionBenchmark(QueueKind queue_kind, ProducerKind producer_kind,
+                      std::chrono::nanoseconds task_duration,
+                      ArrivalKind arrival_kind)
+      : queue_kind_(queue_kind),
+        producer_kind_(producer_kind),
+        arrival_kind_(arrival_kind),
+        task_duration_(task_duration),
+        tasks_per_producer_(std::clamp<int64_t>(
+            kWorkPerIteration / task_duration / kNumProducers, 64, 4096)),
+        // Half of the capacity of the workers, split among the producers.
+        interval_(task_duration * kNumProducers * 2 / kNumWorkers),
+        times_(kNumProducers * tasks_per_producer_) {
+    MultiThreadedWorkQueueOptions options;
+    options.numa_aware = queue_kind == QueueKind::kNumaAware;
+    options.earliest_deadline_first =
+        queue_kind == QueueKind::kEarliestDeadlineFirst;
+    // Producers running on the workers must not take worker capacity away
+    // from the tasks.
+    int num_threads = kNumWorkers;
+    if (producer_kind == ProducerKind::kWorker) num_threads += kNumProducers;
+    work_queue_ =
+        CreateMultiThreadedWorkQueue(num_threads, num_threads, options);
+  }
+
+  int64_t num_tasks() const { return times_.size(); }
+
+  // Runs all producers to completion and appends the latencies of their tasks
+  // to `wakeup_latencies` and `task_latencies`.
+  void Run(std::vector<double>* wakeup_latencies,
+           std::vector<double>* task_latencies) {
+    latch done(num_tasks());
+
+    const auto start = Clock::now();
+    if (producer_kind_ == ProducerKind::kExternal) {
+      std::vector<std::thread> producers;
+      for (int i = 0; i < kNumProducers; ++i)
+        producers.emplace_back([&, i] { Produce(i, start, done); });
+      for (auto& producer : producers) producer.join();
+    } else {
+      for (int i = 0; i < kNumProducers; ++i)
+        Submit(TaskFunction([&, i] { Produce(i, start, done); }), i);
+    }
+    done.wait();
+
+    for (const TaskTimes& times : times_) {
+      wakeup_latencies->push_back(
+          std::chrono::duration<double, std::micro>(times.started -
+                                                    times.enqueued)
+              .count());
+      task_latencies->push_back(
+          std::chrono::duration<double, std::micro>(times.finished -
+                                                    times.enqueued)
+              .count());
+    }
+  }
+
+ private:
+  void Produce(int producer, Clock::time_point start, latch& done) {
+    // Stagger the producers over one interval.
+    auto next = start + interval_ * producer / kNumProducers;
+    for (int64_t i = 0; i < tasks_per_producer_; ++i) {
+      if (arrival_kind_ == ArrivalKind::kSteady || i % kBurstSize == 0) {
+        SpinUntil(next);
+        next += arrival_kind_ == ArrivalKind::kSteady ? interval_
+                                                      : interval_ * kBurstSize;
+      }
+
+      const int64_t index = producer * tasks_per_producer_ + i;
+      TaskTimes* times = &times_[index];
+      times->enqueued = Clock::now();
+      Submit(TaskFunction([this, times, &done] {
+               times->started = Clock::now();
+               SpinFor(task_duration_);
+               times->finished = Clock::now();
+               done.count_down();
+             }),
+             index);
+    }
+  }
+
+  void Submit(TaskFunction task, int64_t index) {
+    switch (queue_kind_) {
+      case QueueKind::kNonBlocking:
+      case QueueKind::kNumaAware:
+        work_queue_->AddTask(std::move(task));
+        break;
+      case QueueKind::kBlocking:
+        // Run the task in the caller thread if the queue is full.
+        if (auto rejected = work_queue_->AddBlockingTask(
+                std::move(task), /*allow_queuing=*/true))
+          (*rejected)();
+        break;
+      case QueueKind::kPriority:
+        work_queue_->AddTask(std::move(task),
+                             static_cast<TaskPriority>(index % 4));
+        break;
+      case QueueKind::kEarliestDeadlineFirst:
+        // Deadlines between one and four task durations from now, so that
+        // later tasks are regularly due before earlier ones.
+        work_queue_->AddTask(
+            std::move(task), TaskPriority::kDefault,
+            std::chrono::system_clock::now() +
+                std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                    task_duration_ * (1 + index % 4)));
+        break;
+    }
+  }
+
+  const QueueKind queue_kind_;
+  const ProducerKind producer_kind_;
+  const ArrivalKind arrival_kind_;
+  const std::chrono::nanoseconds task_duration_;
+  const int64_t tasks_per_producer_;
+  // Time between two tasks of the same producer.
+  const std::chrono::nanoseconds interval_;
+
+  std::vector<TaskTimes> times_;
+  std::unique_ptr<ConcurrentWorkQueue> work_queue_;
+};
+
+double Percentile(std::vector<double>& values, double percentile) {
+  if (values.empty()) return 0;
+  auto nth = values.begin() + static_cast<size_t>(percentile *
+                                                   (values.size() - 1));
+  std::nth_element(values.begin(), nth, values.end());
+  return *nth;
+}
+
+// Arguments are the queue kind, the producer kind, the task duration in
+// nanoseconds and the arrival kind.
+void BM_WorkQueueContention(benchmark::State& state) {
+  ContentionBenchmark benchmark(static_cast<QueueKind>(state.range(0)),
+                                static_cast<ProducerKind>(state.range(1)),
+                                std::chrono::nanoseconds(state.range(2)),
+                                static_cast<ArrivalKind>(state.range(3)));
+
+  std::vector<double> wakeup_latencies;
+  std::vector<double> task_latencies;
+  for (auto _ : state) benchmark.Run(&wakeup_latencies, &task_latencies);
+
+  state.SetItemsProcessed(benchmark.num_tasks() * state.iterations());
+  state.counters["wakeup_p50_us"] = Percentile(wakeup_latencies, 0.5);
+  state.counters["wakeup_p99_us"] = Percentile(wakeup_latencies, 0.99);
+  state.counters["latency_p50_us"] = Percentile(task_latencies, 0.5);
+  state.counters["latency_p99_us"] = Percentile(task_latencies, 0.99);
+  state.counters["latency_p999_us"] = Percentile(task_latencies, 0.999);
+}
+
+void ContentionMatrix(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgNames({"queue", "producer", "task_ns", "arrival"});
+  for (int queue = 0; queue <= 4; ++queue)
+    for (int producer = 0; producer <= 1; ++producer)
+      for (int64_t task_ns : {50, 1000, 10000, 100000, 1000000})
+        for (int arrival = 0; arrival <= 1; ++arrival)
+          benchmark->Args({queue, producer, task_ns, arrival});
+}
+
+BENCHMARK(BM_WorkQueueContention)->Apply(ContentionMatrix)->UseRealTime();
+
+}  // namespace
+}  // namespace tfrt
@@ -0,0 +1,125 @@
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+// Idle benchmarks for the worker idle policies of the multi-threaded work
+// queue.
+//
+// Every benchmark submits tasks one at a time from an external thread, which
+// sleeps for a fixed gap after every task completes, so that the workers run
+// out of work before each task. The matrix covers:
+//
+//   policy:   parking right away, the default spin loop, spinning and then
+//             yielding, and the adaptive policy of the "mlowlatency" queue.
+//   gap:      10us to 10ms between a task completing and the next one.
+//
+// The benchmarks report percentiles of the wakeup latency (from enqueue to the
+// start of the task) in microseconds, and the CPU time burned by the process
+// per second of wall time while the workers are mostly idle.
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/task_function.h"
+#include "tfrt/support/latch.h"
+
+namespace tfrt {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+enum class PolicyKind : int {
+  kPark = 0,
+  kSpin = 1,
+  kSpinThenYield = 2,
+  kAdaptive = 3,
+};
+
+constexpr int kNumWorkers = 8;
+// Number of tasks submitted per benchmark iteration.
+constexpr int kTasksPerIteration = 64;
+
+WorkerIdlePolicy GetIdlePolicy(PolicyKind kind) {
+  WorkerIdlePolicy policy;
+  switch (kind) {
+    case PolicyKind::kPark:
+      policy.spin_count = 0;
+      break;
+    case PolicyKind::kSpin:
+      break;
+    case PolicyKind::kSpinThenYield:
+      policy.yield_count = 5000;
+      break;
+    case PolicyKind::kAdaptive:
+      policy.max_spinning_threads = 2;
+      policy.spin_count = 20000;
+      policy.yield_count = 5000;
+      policy.adaptive = true;
+      break;
+  }
+  return policy;
+}
+
+double Percentile(std::vector<double>& values, double percentile) {
+  if (values.empty()) return 0;
+  auto nth = values.begin() + static_cast<size_t>(percentile *
+                                                   (values.size() - 1));
+  std::nth_element(values.begin(), nth, values.end());
+  return *nth;
+}
+
+// Arguments are the policy kind and the gap between tasks in microseconds.
+void BM_WorkQueueIdle(benchmark::State& state) {
+  MultiThreadedWorkQueueOptions options;
+  options.idle_policy = GetIdlePolicy(static_cast<PolicyKind>(state.range(0)));
+  std::unique_ptr<ConcurrentWorkQueue> work_queue =
+      CreateMultiThreadedWorkQueue(kNumWorkers, kNumWorkers, options);
+  const std::chrono::microseconds gap(state.range(1));
+
+  std::vector<double> wakeup_latencies;
+  const std::clock_t cpu_start = std::clock();
+  const auto wall_start = Clock::now();
+  for (auto _ : state) {
+    for (int i = 0; i < kTasksPerIteration; ++i) {
+      std::this_thread::sleep_for(gap);
+      latch done(1);
+      Clock::time_point started;
+      const auto enqueued = Clock::now();
+      work_queue->AddTask(TaskFunction([&] {
+        started = Clock::now();
+        done.count_down();
+      }));
+      done.wait();
+      wakeup_latencies.push_back(
+          std::chrono::duration<double, std::micro>(started - enqueued)
+              .count());
+    }
+  }
+  const double cpu_seconds =
+      static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+  const double wall_seconds =
+      std::chrono::duration<double>(Clock::now() - wall_start).count();
+
+  state.SetItemsProcessed(kTasksPerIteration * state.iterations());
+  state.counters["wakeup_p50_us"] = Percentile(wakeup_latencies, 0.5);
+  state.counters["wakeup_p99_us"] = Percentile(wakeup_latencies, 0.99);
+  state.counters["cpu_per_wall"] = cpu_seconds / wall_seconds;
+}
+
+void IdleMatrix(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgNames({"policy", "gap_us"});
+  for (int policy = 0; policy <= 3; ++policy)
+    for (int64_t gap_us : {10, 100, 1000, 10000})
+      benchmark->Args({policy, gap_us});
+}
+
+BENCHMARK(BM_WorkQueueIdle)->Apply(IdleMatrix)->UseRealTime();
+
+}  // namespace
+}  // namespace tfrt
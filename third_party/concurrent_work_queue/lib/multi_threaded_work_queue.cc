@@ -5,6 +5,8 @@
 // Concurrent Work Queue implementation composed from a blocking and
 // non-blocking work queues.
 
+#include <atomic>
+#include <chrono>
 #include <memory>
 #include <optional>
 #include <string>
@@ -13,10 +15,12 @@
 #include "blocking_work_queue.h"
 #include "llvm/ADT/ArrayRef.h"
 #include "non_blocking_work_queue.h"
+#include "numa_topology.h"
 #include "tfrt/host_context/async_value.h"
 #include "tfrt/host_context/concurrent_work_queue.h"
 #include "tfrt/host_context/task_function.h"
 #include "tfrt/support/latch.h"
+#include "tfrt/support/mutex.h"
 #include "tfrt/support/ref_count.h"
 #include "tfrt/support/string_util.h"
 #include "tfrt/support/thread_environment.h"
@@ -31,12 +35,21 @@ class MultiThreadedWorkQueue : public ConcurrentWorkQueue {
 
   std::string name() const override {
     return StrCat("Multi-threaded C++ work queue (", num_threads_, " threads, ",
-                  num_blocking_threads_, " blocking threads)");
+                  num_blocking_threads_, " blocking threads",
+                  numa_aware_ ? ", NUMA-aware" : "",
+                  collect_stats_ ? ", collecting stats" : "", ")");
   }
 
   int GetParallelismLevel() const final { return num_threads_; }
 
   void AddTask(TaskFunction task) final;
+  void AddTask(TaskFunction task, TaskPriority priority) final;
+  void AddTask(TaskFunction task, TaskPriority priority,
+               std::chrono::system_clock::time_point deadline) final;
+  void AddTask(TaskFunction task, TaskPriority priority,
+               TaskAffinity affinity) final;
+  void AddTasks(MutableArrayRef<TaskFunction> tasks,
+                TaskPriority priority) final;
   std::optional<TaskFunction> AddBlockingTask(TaskFunction task,
                                               bool allow_queuing) final;
   void Quiesce() final;
@@ -44,9 +57,22 @@ class MultiThreadedWorkQueue : public ConcurrentWorkQueue {
 
   bool IsInWorkerThread() const final;
 
+  WorkQueueLoad GetLoad() const final;
+
  private:
+  // How long Await() on a worker thread waits before it looks for new tasks
+  // to run again.
+  static constexpr std::chrono::microseconds kAwaitPollInterval{100};
+
+  // Implements Await() on a non-blocking worker thread, which runs pending
+  // tasks until the values are available.
+  void AwaitInWorkerThread(ArrayRef<RCReference<AsyncValue>> values);
+
   const int num_threads_;
   const int num_blocking_threads_;
+  const bool numa_aware_;
+  const bool earliest_deadline_first_;
+  const bool collect_stats_;
 
   std::unique_ptr<internal::QuiescingState> quiescing_state_;
   internal::NonBlockingWorkQueue<ThreadingEnvironment> non_blocking_work_queue_;
@@ -58,9 +84,15 @@ MultiThreadedWorkQueue::MultiThreadedWorkQueue(
     const MultiThreadedWorkQueueOptions& options)
     : num_threads_(num_threads),
       num_blocking_threads_(num_blocking_threads),
+      numa_aware_(options.numa_aware),
+      earliest_deadline_first_(options.earliest_deadline_first),
+      collect_stats_(options.collect_stats),
       quiescing_state_(std::make_unique<internal::QuiescingState>()),
-      non_blocking_work_queue_(quiescing_state_.get(), num_threads,
-                               options.thread_name_prefix),
+      non_blocking_work_queue_(
+          quiescing_state_.get(), num_threads, options.thread_name_prefix,
+          options.numa_aware ? internal::GetNumaPlacement(num_threads)
+                             : internal::NumaPlacement(),
+          options.collect_stats, options.idle_policy),
       blocking_work_queue_(quiescing_state_.get(), num_blocking_threads,
                            options.blocking_thread_name_prefix,
                            options.dynamic_thread_name_prefix) {}
@@ -75,6 +107,34 @@ void MultiThreadedWorkQueue::AddTask(TaskFunction task) {
   non_blocking_work_queue_.AddTask(std::move(task));
 }
 
+void MultiThreadedWorkQueue::AddTask(TaskFunction task,
+                                     TaskPriority priority) {
+  non_blocking_work_queue_.AddTask(std::move(task), priority);
+}
+
+void MultiThreadedWorkQueue::AddTask(
+    TaskFunction task, TaskPriority priority,
+    std::chrono::system_clock::time_point deadline) {
+  if (earliest_deadline_first_) {
+    non_blocking_work_queue_.AddTaskWithDeadline(std::move(task), priority,
+                                                 deadline);
+  } else {
+    non_blocking_work_queue_.AddTask(std::move(task), priority);
+  }
+}
+
+void MultiThreadedWorkQueue::AddTask(TaskFunction task,
+                                     TaskPriority priority,
+                                     TaskAffinity affinity) {
+  non_blocking_work_queue_.AddTaskWithAffinity(std::move(task), priority,
+                                               affinity.key);
+}
+
+void MultiThreadedWorkQueue::AddTasks(MutableArrayRef<TaskFunction> tasks,
+                                      TaskPriority priority) {
+  non_blocking_work_queue_.AddTasks(tasks, priority);
+}
+
 std::optional<TaskFunction> MultiThreadedWorkQueue::AddBlockingTask(
     TaskFunction task, bool allow_queuing) {
   if (allow_queuing) {
@@ -84,6 +144,14 @@ std::optional<TaskFunction> MultiThreadedWorkQueue::AddBlockingTask(
   }
 }
 
+WorkQueueLoad MultiThreadedWorkQueue::GetLoad() const {
+  WorkQueueLoad load;
+  load.num_queued_tasks = non_blocking_work_queue_.NumQueuedTasks();
+  // The latency is only measured if the work queue collects stats.
+  load.task_latency = non_blocking_work_queue_.RecentTaskLatency();
+  return load;
+}
+
 void MultiThreadedWorkQueue::Quiesce() {
   // Turn on pending tasks counter inside both work queues.
   auto quiescing = internal::Quiescing::Start(quiescing_state_.get());
@@ -105,10 +173,13 @@ void MultiThreadedWorkQueue::Quiesce() {
 }
 
 void MultiThreadedWorkQueue::Await(ArrayRef<RCReference<AsyncValue>> values) {
-  // We might block on a latch waiting for the completion of all tasks, and
-  // this is not allowed to do inside non blocking work queue.
-  non_blocking_work_queue_.CheckCallerThread("MultiThreadedWorkQueue::Await",
-                                             /*is_fatal=*/false);
+  // Blocking a non-blocking worker thread on a latch would take it away from
+  // the tasks that make the values available, and can deadlock if all workers
+  // do so. Instead, the worker keeps running pending tasks until it is done.
+  if (non_blocking_work_queue_.IsInWorkerThread()) {
+    AwaitInWorkerThread(values);
+    return;
+  }
 
   // We are done when values_remaining drops to zero.
   tfrt::latch values_remaining(values.size());
@@ -122,6 +193,43 @@ void MultiThreadedWorkQueue::Await(ArrayRef<RCReference<AsyncValue>> values) {
   values_remaining.wait();
 }
 
+void MultiThreadedWorkQueue::AwaitInWorkerThread(
+    ArrayRef<RCReference<AsyncValue>> values) {
+  // The state is shared with the callbacks, because the last callback may
+  // still notify the condition variable after this function returned.
+  struct State {
+    explicit State(size_t count) : values_remaining(count) {}
+    std::atomic<size_t> values_remaining;
+    mutex mu;
+    condition_variable cv;
+  };
+  auto state = std::make_shared<State>(values.size());
+
+  for (auto& value : values) {
+    value->AndThen([state]() {
+      if (state->values_remaining.fetch_sub(1, std::memory_order_acq_rel) ==
+          1) {
+        mutex_lock lock(state->mu);
+        state->cv.notify_all();
+      }
+    });
+  }
+
+  auto done = [&state]() {
+    return state->values_remaining.load(std::memory_order_acquire) == 0;
+  };
+  while (!done()) {
+    if (non_blocking_work_queue_.RunPendingTask()) continue;
+
+    // There is nothing to run right now. Wait for the values, but wake up
+    // periodically to pick up tasks added in the meantime, since a parked
+    // caller is not notified about new tasks.
+    mutex_lock lock(state->mu);
+    state->cv.wait_until(
+        lock, std::chrono::steady_clock::now() + kAwaitPollInterval, done);
+  }
+}
+
 bool MultiThreadedWorkQueue::IsInWorkerThread() const {
   return non_blocking_work_queue_.IsInWorkerThread();
 }
@@ -10,11 +10,12 @@
 // Work queue implementation based on non-blocking concurrency primitives
 // optimized for CPU intensive non-blocking compute tasks.
 //
-// This work queue uses TaskDeque for storing pending tasks. Thread tries to
-// pop a task from the front of its own queue, and in a steal loop it tries to
-// steal a task from the back of another thread pending tasks queue. This gives
-// mostly LIFO task execution order, which is optimal for cache locality for
-// compute intensive tasks.
+// This work queue uses TaskPriorityDeque for storing pending tasks. Thread
+// tries to pop a task from the front of its own queue, and in a steal loop it
+// tries to steal a task from the back of another thread pending tasks queue.
+// This gives mostly LIFO task execution order, which is optimal for cache
+// locality for compute intensive tasks. Within a queue tasks of a higher
+// priority are popped first.
 //
 // Work stealing algorithm is based on:
 //
@@ -24,11 +25,18 @@
 #ifndef TFRT_THIRD_PARTY_CONCURRENT_WORK_QUEUE_NON_BLOCKING_WORK_QUEUE_H_
 #define TFRT_THIRD_PARTY_CONCURRENT_WORK_QUEUE_NON_BLOCKING_WORK_QUEUE_H_
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <memory>
 #include <optional>
 #include <string_view>
+#include <vector>
 
-#include "task_deque.h"
+#include "llvm/ADT/SmallVector.h"
+#include "task_priority_deque.h"
 #include "tfrt/host_context/task_function.h"
+#include "tfrt/support/mutex.h"
 #include "work_queue_base.h"
 
 namespace tfrt {
@@ -41,7 +49,7 @@ template <typename ThreadingEnvironmentTy>
 struct WorkQueueTraits<NonBlockingWorkQueue<ThreadingEnvironmentTy>> {
   using ThreadingEnvironment = ThreadingEnvironmentTy;
   using Thread = typename ThreadingEnvironment::Thread;
-  using Queue = ::tfrt::internal::TaskDeque;
+  using Queue = ::tfrt::internal::TaskPriorityDeque;
 };
 
 template <typename ThreadingEnvironment>
@@ -55,53 +63,122 @@ class NonBlockingWorkQueue
   using ThreadData = typename Base::ThreadData;
 
  public:
+  // If `collect_stats` is true, the queue records the statistics described in
+  // work_queue_stats.h, named after the thread name prefix.
   explicit NonBlockingWorkQueue(QuiescingState* quiescing_state,
                                 int num_threads,
-                                std::string_view thread_name_prefix = "");
+                                std::string_view thread_name_prefix = "",
+                                NumaPlacement numa_placement = {},
+                                bool collect_stats = false,
+                                WorkerIdlePolicy idle_policy = {});
   ~NonBlockingWorkQueue() = default;
 
-  void AddTask(TaskFunction task);
+  void AddTask(TaskFunction task,
+               TaskPriority priority = TaskPriority::kDefault);
+
+  // Adds the tasks to the queues of consecutive workers, starting from the
+  // caller if it is a worker, and notifies parked workers once for the batch.
+  void AddTasks(MutableArrayRef<TaskFunction> tasks, TaskPriority priority);
+
+  // Adds a task to the queue of the worker that `affinity_key` maps to, so
+  // that the tasks with the same key are run by the same worker unless they
+  // are stolen by idle workers.
+  void AddTaskWithAffinity(TaskFunction task, TaskPriority priority,
+                           uint64_t affinity_key);
+
+  // Adds a task that should run by `deadline`. Tasks added with a deadline are
+  // kept in a shared queue ordered by deadline, and every time a worker picks
+  // up one of them it runs the pending task with the earliest deadline.
+  void AddTaskWithDeadline(TaskFunction task, TaskPriority priority,
+                           std::chrono::system_clock::time_point deadline);
+
+  // Returns an estimate of the number of tasks waiting in the worker queues.
+  uint64_t NumQueuedTasks() const;
+
+  // Returns a moving average of the time from enqueueing a task to starting
+  // it, if the queue collects stats.
+  std::optional<std::chrono::nanoseconds> RecentTaskLatency() const;
 
   using Base::Steal;
 
  private:
   static constexpr char const* kThreadNamePrefix = "tfrt-non-blocking-queue";
 
+  // On average once in this many tasks a worker thread takes the next task
+  // from its own queue lowest priority first, so that low priority tasks make
+  // progress under a sustained load of higher priority tasks.
+  static constexpr unsigned kLowPriorityFirstInterval = 16;
+
   template <typename WorkQueue>
   friend class WorkQueueBase;
 
   using Base::GetPerThread;
   using Base::IsNotifyParkedThreadRequired;
+  using Base::NumParkedThreadsToNotify;
   using Base::IsQuiescing;
   using Base::WithPendingTaskCounter;
 
   using Base::coprimes_;
   using Base::event_count_;
   using Base::num_threads_;
+  using Base::stats_;
   using Base::thread_data_;
 
+  struct DeadlineTask {
+    std::chrono::system_clock::time_point deadline;
+    // Breaks ties between equal deadlines in FIFO order.
+    uint64_t sequence_number;
+    TaskFunction task;
+  };
+
+  // Orders `deadline_tasks_` as a min-heap on (deadline, sequence number).
+  static bool LaterDeadline(const DeadlineTask& a, const DeadlineTask& b) {
+    if (a.deadline != b.deadline) return a.deadline > b.deadline;
+    return a.sequence_number > b.sequence_number;
+  }
+
+  // Pops and runs the pending task with the earliest deadline.
+  void RunEarliestDeadlineTask();
+
+  // Pushes `task` to the queue of the worker `thread_id`: to its front if the
+  // caller is that worker, and to its back otherwise.
+  void PushTask(TaskFunction task, TaskPriority priority, unsigned thread_id);
+
+  // Implements PushTask() without notifying parked threads. Returns `task` if
+  // the queue is full.
+  [[nodiscard]] std::optional<TaskFunction> PushToQueue(TaskFunction task,
+                                                        TaskPriority priority,
+                                                        unsigned thread_id);
+
   [[nodiscard]] std::optional<TaskFunction> NextTask(Queue* queue);
   [[nodiscard]] std::optional<TaskFunction> Steal(Queue* queue);
   [[nodiscard]] bool Empty(Queue* queue);
+
+  mutex deadline_mu_;
+  uint64_t next_sequence_number_ TFRT_GUARDED_BY(deadline_mu_) = 0;
+  std::vector<DeadlineTask> deadline_tasks_ TFRT_GUARDED_BY(deadline_mu_);
 };
 
 template <typename ThreadingEnvironment>
 NonBlockingWorkQueue<ThreadingEnvironment>::NonBlockingWorkQueue(
     QuiescingState* quiescing_state, int num_threads,
-    std::string_view thread_name_prefix)
+    std::string_view thread_name_prefix, NumaPlacement numa_placement,
+    bool collect_stats, WorkerIdlePolicy idle_policy)
     : WorkQueueBase<NonBlockingWorkQueue>(
           quiescing_state,
           thread_name_prefix.empty() ? kThreadNamePrefix : thread_name_prefix,
-          num_threads) {}
+          num_threads, std::move(numa_placement),
+          collect_stats
+              ? std::make_unique<WorkQueueStats>(
+                    thread_name_prefix.empty() ? kThreadNamePrefix
+                                               : thread_name_prefix,
+                    num_threads)
+              : nullptr,
+          idle_policy) {}
 
 template <typename ThreadingEnvironment>
-void NonBlockingWorkQueue<ThreadingEnvironment>::AddTask(TaskFunction task) {
-  // Keep track of the number of pending tasks.
-  if (IsQuiescing()) task = WithPendingTaskCounter(std::move(task));
-
-  // If the worker queue is full, we will execute `task` in the current thread.
-  std::optional<TaskFunction> inline_task;
-
+void NonBlockingWorkQueue<ThreadingEnvironment>::AddTask(
+    TaskFunction task, TaskPriority priority) {
   // If a caller thread is managed by `this` we push the new task into the front
   // of thread own queue (LIFO execution order). PushFront is completely lock
   // free (PushBack requires a mutex lock), and improves data locality (in
@@ -110,18 +187,87 @@ void NonBlockingWorkQueue<ThreadingEnvironment>::AddTask(TaskFunction task) {
   // If a caller is a free-standing thread (or worker of another pool), we push
   // the new task into a random queue (FIFO execution order). Tasks still could
   // be executed in LIFO order, if they would be stolen by other workers.
+  PerThread* pt = GetPerThread();
+  const unsigned thread_id = pt->parent == this
+                                 ? pt->thread_id
+                                 : FastReduce(pt->rng(), num_threads_);
+  PushTask(std::move(task), priority, thread_id);
+}
 
+template <typename ThreadingEnvironment>
+void NonBlockingWorkQueue<ThreadingEnvironment>::AddTaskWithAffinity(
+    TaskFunction task, TaskPriority priority, uint64_t affinity_key) {
+  // Mix the key, as affinity keys are often pointers or small integers.
+  const uint64_t hash = (affinity_key ^ (affinity_key >> 29)) *
+                        uint64_t{0x9E3779B97F4A7C15};
+  PushTask(std::move(task), priority,
+           FastReduce(static_cast<uint32_t>(hash >> 32), num_threads_));
+}
+
+template <typename ThreadingEnvironment>
+void NonBlockingWorkQueue<ThreadingEnvironment>::AddTasks(
+    MutableArrayRef<TaskFunction> tasks, TaskPriority priority) {
+  if (tasks.empty()) return;
+
+  // The first task goes where AddTask() would put it, and the others to the
+  // queues of the following workers, so that each parked worker that is
+  // woken up finds a task in its own queue.
   PerThread* pt = GetPerThread();
-  if (pt->parent == this) {
-    // Worker thread of this pool, push onto the thread's queue.
-    Queue& q = thread_data_[pt->thread_id].queue;
-    inline_task = q.PushFront(std::move(task));
+  const unsigned start = pt->parent == this
+                             ? pt->thread_id
+                             : FastReduce(pt->rng(), num_threads_);
+
+  // Tasks that did not fit into full queues are executed in the caller thread
+  // after the others are made available to the workers.
+  llvm::SmallVector<TaskFunction, 4> inline_tasks;
+  unsigned thread_id = start;
+  for (TaskFunction& task : tasks) {
+    if (auto inline_task = PushToQueue(std::move(task), priority, thread_id))
+      inline_tasks.push_back(std::move(*inline_task));
+    if (++thread_id == static_cast<unsigned>(num_threads_)) thread_id = 0;
+  }
+
+  // See the note on touching `*this` in PushTask().
+  const unsigned num_queued = tasks.size() - inline_tasks.size();
+  const unsigned num_notify = NumParkedThreadsToNotify(
+      std::min(num_queued, static_cast<unsigned>(num_threads_)));
+  for (unsigned i = 0; i < num_notify; ++i)
+    event_count_.Notify(/*notify_all=*/false);
+
+  for (TaskFunction& task : inline_tasks) task();
+}
+
+template <typename ThreadingEnvironment>
+std::optional<TaskFunction>
+NonBlockingWorkQueue<ThreadingEnvironment>::PushToQueue(TaskFunction task,
+                                                        TaskPriority priority,
+                                                        unsigned thread_id) {
+  // Keep track of the number of pending tasks.
+  if (IsQuiescing()) task = WithPendingTaskCounter(std::move(task));
+  if (stats_) task = stats_->WithLatency(std::move(task));
+
+  // If the worker queue is full, the caller executes the task itself.
+  std::optional<TaskFunction> inline_task;
+
+  PerThread* pt = GetPerThread();
+  Queue& q = thread_data_[thread_id].queue;
+  if (pt->parent == this && pt->thread_id == thread_id) {
+    inline_task = q.PushFront(std::move(task), priority);
   } else {
-    // A free-standing thread (or worker of another pool).
-    unsigned rnd = FastReduce(pt->rng(), num_threads_);
-    Queue& q = thread_data_[rnd].queue;
-    inline_task = q.PushBack(std::move(task));
+    inline_task = q.PushBack(std::move(task), priority);
   }
+  if (stats_ && !inline_task.has_value())
+    stats_->RecordEnqueue(thread_id, thread_data_[thread_id].queue.Size());
+  return inline_task;
+}
+
+template <typename ThreadingEnvironment>
+void NonBlockingWorkQueue<ThreadingEnvironment>::PushTask(
+    TaskFunction task, TaskPriority priority, unsigned thread_id) {
+  // If the worker queue is full, we will execute `task` in the current thread.
+  std::optional<TaskFunction> inline_task =
+      PushToQueue(std::move(task), priority, thread_id);
+
   // Note: below we touch `*this` after making `task` available to worker
   // threads. Strictly speaking, this can lead to a racy-use-after-free.
   // Consider that Schedule is called from a thread that is neither main thread
@@ -138,9 +284,60 @@ void NonBlockingWorkQueue<ThreadingEnvironment>::AddTask(TaskFunction task) {
   }
 }
 
+template <typename ThreadingEnvironment>
+uint64_t NonBlockingWorkQueue<ThreadingEnvironment>::NumQueuedTasks() const {
+  uint64_t num_tasks = 0;
+  for (const ThreadData& thread_data : thread_data_)
+    num_tasks += thread_data.queue.Size();
+  return num_tasks;
+}
+
+template <typename ThreadingEnvironment>
+std::optional<std::chrono::nanoseconds>
+NonBlockingWorkQueue<ThreadingEnvironment>::RecentTaskLatency() const {
+  if (!stats_) return std::nullopt;
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      stats_->recent_task_latency());
+}
+
+template <typename ThreadingEnvironment>
+void NonBlockingWorkQueue<ThreadingEnvironment>::AddTaskWithDeadline(
+    TaskFunction task, TaskPriority priority,
+    std::chrono::system_clock::time_point deadline) {
+  {
+    mutex_lock lock(deadline_mu_);
+    deadline_tasks_.push_back(
+        DeadlineTask{deadline, next_sequence_number_++, std::move(task)});
+    std::push_heap(deadline_tasks_.begin(), deadline_tasks_.end(),
+                   LaterDeadline);
+  }
+
+  // Every deadline task is matched by exactly one runner task in the regular
+  // queues, so the existing wake up, stealing and quiescing logic applies to
+  // deadline tasks unchanged. A runner does not necessarily run the task it
+  // was added for, but the most urgent one at the time it executes.
+  AddTask(TaskFunction([this]() { RunEarliestDeadlineTask(); }), priority);
+}
+
+template <typename ThreadingEnvironment>
+void NonBlockingWorkQueue<ThreadingEnvironment>::RunEarliestDeadlineTask() {
+  TaskFunction task;
+  {
+    mutex_lock lock(deadline_mu_);
+    assert(!deadline_tasks_.empty());
+    std::pop_heap(deadline_tasks_.begin(), deadline_tasks_.end(),
+                  LaterDeadline);
+    task = std::move(deadline_tasks_.back().task);
+    deadline_tasks_.pop_back();
+  }
+  task();
+}
+
 template <typename ThreadingEnvironment>
 [[nodiscard]] std::optional<TaskFunction>
 NonBlockingWorkQueue<ThreadingEnvironment>::NextTask(Queue* queue) {
+  if (FastReduce(GetPerThread()->rng(), kLowPriorityFirstInterval) == 0)
+    return queue->PopFrontLowestPriorityFirst();
   return queue->PopFront();
 }
 
@@ -0,0 +1,111 @@
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+// NUMA topology discovery and thread pinning for NUMA-aware work queues.
+
+#include "numa_topology.h"
+
+#include <fstream>
+#include <string>
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace tfrt {
+namespace internal {
+
+namespace {
+
+// Parses a sysfs cpulist such as "0-3,8-11" into a list of CPU ids. Returns an
+// empty list on malformed input.
+std::vector<int> ParseCpuList(llvm::StringRef cpu_list) {
+  std::vector<int> cpus;
+  llvm::SmallVector<llvm::StringRef, 4> ranges;
+  cpu_list.trim().split(ranges, ',', /*MaxSplit=*/-1, /*KeepEmpty=*/false);
+  for (llvm::StringRef range : ranges) {
+    auto bounds = range.split('-');
+    int first, last;
+    if (bounds.first.trim().getAsInteger(10, first)) return {};
+    if (bounds.second.empty())
+      last = first;
+    else if (bounds.second.trim().getAsInteger(10, last))
+      return {};
+    for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+  }
+  return cpus;
+}
+
+}  // namespace
+
+std::vector<std::vector<int>> GetNumaNodeCpus() {
+  std::vector<std::vector<int>> node_cpus;
+#if defined(__linux__)
+  // Node ids are dense in practice; stop at the first missing node.
+  for (int node = 0;; ++node) {
+    std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) +
+                       "/cpulist");
+    if (!file.is_open()) break;
+
+    std::string cpu_list;
+    std::getline(file, cpu_list);
+    std::vector<int> cpus = ParseCpuList(cpu_list);
+    // Memory-only nodes have no CPUs to run workers on.
+    if (!cpus.empty()) node_cpus.push_back(std::move(cpus));
+  }
+#endif
+  return node_cpus;
+}
+
+std::vector<int> AssignThreadsToNumaNodes(
+    int num_threads, const std::vector<std::vector<int>>& node_cpus) {
+  if (node_cpus.size() < 2) return {};
+
+  size_t total_cpus = 0;
+  for (const auto& cpus : node_cpus) total_cpus += cpus.size();
+
+  std::vector<int> thread_nodes;
+  thread_nodes.reserve(num_threads);
+  size_t node = 0;
+  size_t cpus_before_next_node = node_cpus[0].size();
+  for (int i = 0; i < num_threads; ++i) {
+    // Map the thread to the CPU it would take if threads were spread evenly
+    // over all CPUs, and use the node of that CPU.
+    size_t cpu = static_cast<size_t>(i) * total_cpus / num_threads;
+    while (cpu >= cpus_before_next_node && node + 1 < node_cpus.size())
+      cpus_before_next_node += node_cpus[++node].size();
+    thread_nodes.push_back(static_cast<int>(node));
+  }
+  return thread_nodes;
+}
+
+NumaPlacement GetNumaPlacement(int num_threads) {
+  NumaPlacement placement;
+  placement.node_cpus = GetNumaNodeCpus();
+  placement.thread_nodes =
+      AssignThreadsToNumaNodes(num_threads, placement.node_cpus);
+  if (placement.thread_nodes.empty()) placement.node_cpus.clear();
+  return placement;
+}
+
+bool PinCurrentThreadToCpus(llvm::ArrayRef<int> cpus) {
+#if defined(__linux__)
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (int cpu : cpus) {
+    if (cpu >= 0 && cpu < CPU_SETSIZE) CPU_SET(cpu, &cpu_set);
+  }
+  return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) ==
+         0;
+#else
+  return false;
+#endif
+}
+
+}  // namespace internal
+}  // namespace tfrt
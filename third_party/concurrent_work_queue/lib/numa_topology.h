@@ -0,0 +1,51 @@
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+// NUMA topology discovery and thread pinning for NUMA-aware work queues.
+//
+// The topology is read from sysfs on Linux. On other platforms, or when sysfs
+// is not available, no NUMA nodes are reported and work queues fall back to
+// flat thread placement.
+
+#ifndef TFRT_THIRD_PARTY_CONCURRENT_WORK_QUEUE_NUMA_TOPOLOGY_H_
+#define TFRT_THIRD_PARTY_CONCURRENT_WORK_QUEUE_NUMA_TOPOLOGY_H_
+
+#include <vector>
+
+#include "llvm/ADT/ArrayRef.h"
+
+namespace tfrt {
+namespace internal {
+
+// Placement of the worker threads of a work queue on NUMA nodes.
+struct NumaPlacement {
+  // The NUMA node of each worker thread, indexed by thread id. Empty if the
+  // workers are not NUMA-aware.
+  std::vector<int> thread_nodes;
+  // The CPUs of each NUMA node, indexed by node.
+  std::vector<std::vector<int>> node_cpus;
+};
+
+// Returns a placement for `num_threads` workers on the NUMA nodes of this
+// host. The placement is empty if the host has fewer than two NUMA nodes.
+NumaPlacement GetNumaPlacement(int num_threads);
+
+// Returns the CPUs of each NUMA node with at least one online CPU, indexed by
+// node. Returns an empty vector if the topology is unknown.
+std::vector<std::vector<int>> GetNumaNodeCpus();
+
+// Assigns each of `num_threads` workers to a NUMA node, in contiguous blocks
+// proportional to the number of CPUs of each node. Returns an empty vector if
+// there are fewer than two NUMA nodes.
+std::vector<int> AssignThreadsToNumaNodes(
+    int num_threads, const std::vector<std::vector<int>>& node_cpus);
+
+// Restricts the calling thread to `cpus`. Returns false if pinning is not
+// supported or failed.
+bool PinCurrentThreadToCpus(llvm::ArrayRef<int> cpus);
+
+}  // namespace internal
+}  // namespace tfrt
+
+#endif  // TFRT_THIRD_PARTY_CONCURRENT_WORK_QUEUE_NUMA_TOPOLOGY_H_
@@ -34,18 +34,14 @@
 
 #include "llvm/ADT/FunctionExtras.h"
 #include "llvm/Support/Compiler.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
 #include "tfrt/host_context/task_function.h"
 #include "tfrt/support/mutex.h"
 
 namespace tfrt {
 namespace internal {
 
-enum class TaskPriority : int8_t {
-  kCritical = 0,
-  kHigh = 1,
-  kDefault = 2,
-  kLow = 3
-};
+using TaskPriority = ::tfrt::TaskPriority;
 
 class TaskPriorityDeque {
   static constexpr uint64_t kCounterBits = 10;  // capacity = 1024
@@ -60,6 +56,14 @@ class TaskPriorityDeque {
           TaskPriority::kLow,
   };
 
+  static constexpr std::array<TaskPriority, kNumTaskPriorities>
+      kReversedTaskPriorities = {
+          TaskPriority::kLow,
+          TaskPriority::kDefault,
+          TaskPriority::kHigh,
+          TaskPriority::kCritical,
+  };
+
   static_assert(static_cast<int>(kTaskPriorities[0]) == 0,
                 "Unexpected TaskPriority value");
   static_assert(static_cast<int>(kTaskPriorities[1]) == 1,
@@ -124,30 +128,15 @@ class TaskPriorityDeque {
   //
   // If all queues are empty returns empty optional.
   [[nodiscard]] std::optional<TaskFunction> PopFront() {
-    PointerState front(front_.load(std::memory_order_relaxed));
-
-    for (TaskPriority priority : kTaskPriorities) {
-      uint64_t index = front.IndexExt(priority);
-
-      Elem* e = elem(priority, (index - 1) & kIndexMask);
-      uint8_t s = e->state.load(std::memory_order_relaxed);
-
-      if (s != kReady) continue;
-      if (!e->state.compare_exchange_strong(s, kBusy,
-                                            std::memory_order_acquire)) {
-        return std::nullopt;
-      }
-
-      TaskFunction task = std::move(e->task);
-      e->state.store(kEmpty, std::memory_order_release);
-      front_.store(front.WithIndexExt((index - 1) & kIndexMaskExt, priority),
-                   std::memory_order_relaxed);
-
-      return std::optional<TaskFunction>(std::move(task));
-    }
+    return PopFront(kTaskPriorities);
+  }
 
-    // No tasks found at any priority level.
-    return std::nullopt;
+  // PopFrontLowestPriorityFirst() is the same as PopFront(), but iterates
+  // through the queues in the reverse priority order. Owner threads call it
+  // once in a while so that a steady stream of high priority tasks can't
+  // starve low priority ones.
+  [[nodiscard]] std::optional<TaskFunction> PopFrontLowestPriorityFirst() {
+    return PopFront(kReversedTaskPriorities);
   }
 
   // PushBack() inserts task `w` at the end of the queue for the specified
@@ -229,6 +218,36 @@ class TaskPriorityDeque {
   }
 
  private:
+  // Pops the first element of the first non-empty queue, visiting the queues
+  // in the given order.
+  [[nodiscard]] std::optional<TaskFunction> PopFront(
+      const std::array<TaskPriority, kNumTaskPriorities>& priorities) {
+    PointerState front(front_.load(std::memory_order_relaxed));
+
+    for (TaskPriority priority : priorities) {
+      uint64_t index = front.IndexExt(priority);
+
+      Elem* e = elem(priority, (index - 1) & kIndexMask);
+      uint8_t s = e->state.load(std::memory_order_relaxed);
+
+      if (s != kReady) continue;
+      if (!e->state.compare_exchange_strong(s, kBusy,
+                                            std::memory_order_acquire)) {
+        return std::nullopt;
+      }
+
+      TaskFunction task = std::move(e->task);
+      e->state.store(kEmpty, std::memory_order_release);
+      front_.store(front.WithIndexExt((index - 1) & kIndexMaskExt, priority),
+                   std::memory_order_relaxed);
+
+      return std::optional<TaskFunction>(std::move(task));
+    }
+
+    // No tasks found at any priority level.
+    return std::nullopt;
+  }
+
   // We use log2(kCapacity) + 1 bits to store rolling index of front/back
   // elements for all priority levels.
   //
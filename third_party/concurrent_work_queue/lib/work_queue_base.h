@@ -20,10 +20,13 @@
 // new task added to the queue.
 //
 // Before parking on a conditional variable, thread might go into a spin loop
-// (controlled by `kMaxSpinningThreads` constant), and execute steal loop for a
-// fixed number of iterations. This allows to skip expensive park/unpark
-// operations, and reduces latency. Increasing `kMaxSpinningThreads` improves
-// latency at the cost of burned CPU cycles.
+// (controlled by `WorkerIdlePolicy::max_spinning_threads`), and execute steal
+// loop for a fixed number of iterations, and then for a fixed number of
+// iterations yielding the CPU after every steal attempt. This allows to skip
+// expensive park/unpark operations, and reduces latency. Increasing the number
+// of spinning threads improves latency at the cost of burned CPU cycles. With
+// an adaptive policy every thread shortens its spin loop while tasks arrive
+// rarely, and restores it once they arrive frequently again.
 //
 // See derived work queue implementation for more details about work stealing.
 //
@@ -49,7 +52,9 @@
 #ifndef TFRT_THIRD_PARTY_CONCURRENT_WORK_QUEUE_WORK_QUEUE_BASE_H_
 #define TFRT_THIRD_PARTY_CONCURRENT_WORK_QUEUE_WORK_QUEUE_BASE_H_
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <memory>
 #include <optional>
 #include <string>
@@ -57,12 +62,16 @@
 
 #include "event_count.h"
 #include "llvm/Support/Compiler.h"
+#include "numa_topology.h"
 #include "task_queue.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/host_allocator.h"
 #include "tfrt/host_context/task_function.h"
 #include "tfrt/support/forward_decls.h"
 #include "tfrt/support/logging.h"
 #include "tfrt/support/mutex.h"
 #include "tfrt/support/string_util.h"
+#include "work_queue_stats.h"
 
 namespace tfrt {
 namespace internal {
@@ -223,6 +232,11 @@ class WorkQueueBase {
   // std::nullopt if it was not able to find task to steal.
   [[nodiscard]] std::optional<TaskFunction> Steal();
 
+  // RunPendingTask() runs one pending task in the caller thread, which must be
+  // a worker thread managed by `this`: the next task from its own queue, or a
+  // task stolen from another worker. Returns false if there was no task to run.
+  [[nodiscard]] bool RunPendingTask();
+
   // Returns `true` if all worker threads are parked. This is a weak signal of
   // work queue emptyness, because worker thread might be notified, but not
   // yet unparked and running. For strong guarantee must use use Quiesce.
@@ -271,13 +285,9 @@ class WorkQueueBase {
         });
   }
 
-  // TODO(ezhulenev): Make this a runtime parameter? More spinning threads help
-  // to reduce latency at the cost of wasted CPU cycles.
-  static constexpr int kMaxSpinningThreads = 1;
-
-  // The number of steal loop spin iterations before parking (this number is
-  // divided by the number of threads, to get spin count for each thread).
-  static constexpr int kSpinCount = 5000;
+  // With an adaptive idle policy the spin and yield counts of a thread are
+  // divided by up to 2^kMaxIdleShift while tasks arrive rarely.
+  static constexpr int kMaxIdleShift = 4;
 
   // If there are enough active threads with an empty pending task queues, there
   // is no need for spinning before parking a thread that is out of work to do,
@@ -289,8 +299,14 @@ class WorkQueueBase {
   // will be unparked, however this should be very rare in practice.
   static constexpr int kMinActiveThreadsToStartSpinning = 4;
 
+  // If `numa_placement` is not empty, each worker thread is pinned to the CPUs
+  // of its NUMA node, and prefers victims on the same node when stealing. If
+  // `stats` is not null, steals and parked time are recorded into it.
   explicit WorkQueueBase(QuiescingState* quiescing_state,
-                         string_view name_prefix, int num_threads);
+                         string_view name_prefix, int num_threads,
+                         NumaPlacement numa_placement = {},
+                         std::unique_ptr<WorkQueueStats> stats = nullptr,
+                         WorkerIdlePolicy idle_policy = {});
   ~WorkQueueBase();
 
   // Main worker thread loop.
@@ -321,6 +337,12 @@ class WorkQueueBase {
   // be picked up by one of the spinning threads.
   [[nodiscard]] bool IsNotifyParkedThreadRequired();
 
+  // NumParkedThreadsToNotify() is IsNotifyParkedThreadRequired() for a batch
+  // of `num_tasks` new tasks. It returns the number of tasks that parked
+  // threads must be notified about, after handing off as many tasks as
+  // possible to the spinning threads.
+  [[nodiscard]] unsigned NumParkedThreadsToNotify(unsigned num_tasks);
+
   void Notify() { event_count_.Notify(false); }
 
   // Returns current thread id if the caller thread is managed by `this`,
@@ -340,11 +362,23 @@ class WorkQueueBase {
   unsigned NumBlockedThreads() const { return blocked_.load(); }
   unsigned NumActiveThreads() const { return num_threads_ - blocked_.load(); }
 
+  // TrySteal() implements Steal(), without recording statistics.
+  [[nodiscard]] std::optional<TaskFunction> TrySteal();
+
+  // StealFromNode() tries to steal a task from the workers on `node`.
+  [[nodiscard]] std::optional<TaskFunction> StealFromNode(int node,
+                                                          unsigned r);
+
   const int num_threads_;
 
   std::vector<ThreadData> thread_data_;
   std::vector<unsigned> coprimes_;
 
+  // NUMA placement of the worker threads, and the worker thread ids grouped by
+  // their NUMA node. Both are empty if the workers are not NUMA-aware.
+  NumaPlacement numa_placement_;
+  std::vector<std::vector<unsigned>> node_threads_;
+
   std::atomic<unsigned> blocked_;
   std::atomic<bool> done_;
   std::atomic<bool> cancelled_;
@@ -399,6 +433,11 @@ class WorkQueueBase {
 
   EventCount event_count_;
   Derived& derived_;
+
+  // Null unless the work queue collects statistics.
+  const std::unique_ptr<WorkQueueStats> stats_;
+
+  const WorkerIdlePolicy idle_policy_;
 };
 
 // Calculate coprimes of all numbers [1, n].
@@ -427,18 +466,32 @@ inline std::vector<unsigned> ComputeCoprimes(int n) {
 
 template <typename Derived>
 WorkQueueBase<Derived>::WorkQueueBase(QuiescingState* quiescing_state,
-                                      string_view name_prefix, int num_threads)
+                                      string_view name_prefix, int num_threads,
+                                      NumaPlacement numa_placement,
+                                      std::unique_ptr<WorkQueueStats> stats,
+                                      WorkerIdlePolicy idle_policy)
     : num_threads_(num_threads),
       thread_data_(num_threads),
       coprimes_(ComputeCoprimes(num_threads)),
+      numa_placement_(std::move(numa_placement)),
       blocked_(0),
       done_(false),
       cancelled_(false),
       quiescing_state_(quiescing_state),
       spinning_state_(0),
       event_count_(num_threads),
-      derived_(static_cast<Derived&>(*this)) {
+      derived_(static_cast<Derived&>(*this)),
+      stats_(std::move(stats)),
+      idle_policy_(idle_policy) {
   assert(num_threads >= 1);
+  assert(numa_placement_.thread_nodes.empty() ||
+         numa_placement_.thread_nodes.size() ==
+             static_cast<size_t>(num_threads));
+  node_threads_.resize(numa_placement_.node_cpus.size());
+  for (unsigned i = 0; i < numa_placement_.thread_nodes.size(); i++) {
+    node_threads_[numa_placement_.thread_nodes[i]].push_back(i);
+  }
+
   for (int i = 0; i < num_threads; i++) {
     thread_data_[i].thread = ThreadingEnvironment::StartThread(
         name_prefix, [this, i]() { WorkerLoop(i); });
@@ -510,10 +563,43 @@ void WorkQueueBase<Derived>::Quiesce() {
   }
 }
 
+template <typename Derived>
+[[nodiscard]] std::optional<TaskFunction> WorkQueueBase<Derived>::StealFromNode(
+    int node, unsigned r) {
+  const std::vector<unsigned>& threads = node_threads_[node];
+  if (threads.empty()) return std::nullopt;
+
+  unsigned index = FastReduce(r, threads.size());
+  for (unsigned i = 0; i < threads.size(); i++) {
+    std::optional<TaskFunction> t =
+        derived_.Steal(&(thread_data_[threads[index]].queue));
+    if (t.has_value()) return t;
+
+    if (++index == threads.size()) index = 0;
+  }
+  return std::nullopt;
+}
+
 template <typename Derived>
 [[nodiscard]] std::optional<TaskFunction> WorkQueueBase<Derived>::Steal() {
+  std::optional<TaskFunction> t = TrySteal();
+  if (stats_) stats_->RecordSteal(t.has_value());
+  return t;
+}
+
+template <typename Derived>
+[[nodiscard]] std::optional<TaskFunction> WorkQueueBase<Derived>::TrySteal() {
   PerThread* pt = GetPerThread();
   unsigned r = pt->rng();
+
+  // Worker threads of a NUMA-aware queue first try victims on their own node,
+  // to avoid touching remote memory of tasks stolen across sockets.
+  if (!node_threads_.empty() && pt->parent == &derived_) {
+    std::optional<TaskFunction> t =
+        StealFromNode(numa_placement_.thread_nodes[pt->thread_id], r);
+    if (t.has_value()) return t;
+  }
+
   unsigned victim = FastReduce(r, num_threads_);
   unsigned inc = coprimes_[FastReduce(r, coprimes_.size())];
 
@@ -530,6 +616,20 @@ template <typename Derived>
   return std::nullopt;
 }
 
+template <typename Derived>
+[[nodiscard]] bool WorkQueueBase<Derived>::RunPendingTask() {
+  PerThread* pt = GetPerThread();
+  assert(pt->parent == &derived_ && "must be called from a worker thread");
+
+  std::optional<TaskFunction> t =
+      derived_.NextTask(&(thread_data_[pt->thread_id].queue));
+  if (!t.has_value()) t = Steal();
+  if (!t.has_value()) return false;
+
+  (*t)();
+  return true;
+}
+
 template <typename Derived>
 void WorkQueueBase<Derived>::WorkerLoop(int thread_id) {
   PerThread* pt = GetPerThread();
@@ -537,14 +637,29 @@ void WorkQueueBase<Derived>::WorkerLoop(int thread_id) {
   pt->rng = FastRng(ThreadingEnvironment::ThisThreadIdHash());
   pt->thread_id = thread_id;
 
+  if (!numa_placement_.thread_nodes.empty()) {
+    int node = numa_placement_.thread_nodes[thread_id];
+    if (!PinCurrentThreadToCpus(numa_placement_.node_cpus[node])) {
+      TFRT_LOG(WARNING) << "Failed to pin worker thread " << thread_id
+                        << " to NUMA node " << node;
+    }
+    SetCurrentNumaNode(node);
+  }
+
   Queue* q = &(thread_data_[thread_id].queue);
   EventCount::Waiter* waiter = event_count_.waiter(thread_id);
 
   // TODO(dvyukov,rmlarsen): The time spent in NonEmptyQueueIndex() is
   // proportional to num_threads_ and we assume that new work is scheduled at
-  // a constant rate, so we set spin_count to 5000 / num_threads_. The
-  // constant was picked based on a fair dice roll, tune it.
-  const int spin_count = num_threads_ > 0 ? kSpinCount / num_threads_ : 0;
+  // a constant rate, so we divide the spin and yield counts by num_threads_.
+  const int spin_count =
+      num_threads_ > 0 ? idle_policy_.spin_count / num_threads_ : 0;
+  const int yield_count =
+      num_threads_ > 0 ? idle_policy_.yield_count / num_threads_ : 0;
+
+  // With an adaptive idle policy, the spin and yield counts are divided by
+  // 2^idle_shift, which grows every time the thread parks for long.
+  int idle_shift = 0;
 
   while (!cancelled_) {
     std::optional<TaskFunction> t = derived_.NextTask(q);
@@ -554,9 +669,16 @@ void WorkQueueBase<Derived>::WorkerLoop(int thread_id) {
         // Maybe leave thread spinning. This reduces latency.
         const bool start_spinning = StartSpinning();
         if (start_spinning) {
-          for (int i = 0; i < spin_count && !t.has_value(); ++i) {
+          for (int i = 0; i < (spin_count >> idle_shift) && !t.has_value();
+               ++i) {
             t = Steal();
           }
+          for (int i = 0; i < (yield_count >> idle_shift) && !t.has_value();
+               ++i) {
+            std::this_thread::yield();
+            t = Steal();
+          }
+          if (t.has_value()) idle_shift = 0;
 
           const bool stopped_spinning = StopSpinning();
           // If a task was submitted to the queue without a call to
@@ -570,8 +692,15 @@ void WorkQueueBase<Derived>::WorkerLoop(int thread_id) {
         }
 
         if (!t.has_value()) {
-          if (!WaitForWork(waiter, &t)) {
-            return;
+          if (!idle_policy_.adaptive) {
+            if (!WaitForWork(waiter, &t)) return;
+          } else {
+            const auto start = std::chrono::steady_clock::now();
+            if (!WaitForWork(waiter, &t)) return;
+            const bool short_park = std::chrono::steady_clock::now() - start <
+                                    idle_policy_.short_park;
+            idle_shift =
+                short_park ? 0 : std::min(idle_shift + 1, kMaxIdleShift);
           }
           if (!t.has_value()) {
             continue;
@@ -641,7 +770,13 @@ bool WorkQueueBase<Derived>::WaitForWork(EventCount::Waiter* waiter,
     return false;
   }
 
-  event_count_.CommitWait(waiter);
+  if (stats_) {
+    const auto start = WorkQueueStats::Clock::now();
+    event_count_.CommitWait(waiter);
+    stats_->RecordParked(WorkQueueStats::Clock::now() - start);
+  } else {
+    event_count_.CommitWait(waiter);
+  }
   blocked_.fetch_sub(1);
   return true;
 }
@@ -654,7 +789,8 @@ bool WorkQueueBase<Derived>::StartSpinning() {
   for (;;) {
     SpinningState state = SpinningState::Decode(spinning);
 
-    if ((state.num_spinning - state.num_no_notification) >= kMaxSpinningThreads)
+    if ((state.num_spinning - state.num_no_notification) >=
+        idle_policy_.max_spinning_threads)
       return false;
 
     // Increment the number of spinning threads.
@@ -708,6 +844,28 @@ bool WorkQueueBase<Derived>::IsNotifyParkedThreadRequired() {
   }
 }
 
+template <typename Derived>
+unsigned WorkQueueBase<Derived>::NumParkedThreadsToNotify(unsigned num_tasks) {
+  uint64_t spinning = spinning_state_.load(std::memory_order_relaxed);
+  for (;;) {
+    SpinningState state = SpinningState::Decode(spinning);
+
+    // Every spinning thread that is not yet accounted for by a task submitted
+    // without notification picks up one of the tasks.
+    const uint64_t num_no_notify = std::min<uint64_t>(
+        num_tasks, state.num_spinning - state.num_no_notification);
+    if (num_no_notify == 0) return num_tasks;
+
+    // Increment the number of tasks submitted without notification.
+    state.num_no_notification += num_no_notify;
+
+    if (spinning_state_.compare_exchange_weak(spinning, state.Encode(),
+                                              std::memory_order_relaxed)) {
+      return num_tasks - static_cast<unsigned>(num_no_notify);
+    }
+  }
+}
+
 template <typename Derived>
 int WorkQueueBase<Derived>::NonEmptyQueueIndex() {
   PerThread* pt = GetPerThread();
@@ -0,0 +1,81 @@
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+// Opt-in statistics of a work queue, exported through tfrt::metrics.
+
+#include "work_queue_stats.h"
+
+#include <string>
+
+#include "llvm/ADT/StringMap.h"
+#include "tfrt/metrics/metrics.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/string_util.h"
+
+namespace tfrt {
+namespace internal {
+
+namespace {
+
+// Metrics live for the whole process, and work queues may be created many
+// times, so each metric is only created once.
+struct MetricsCache {
+  mutex mu;
+  llvm::StringMap<metrics::Counter*> counters TFRT_GUARDED_BY(mu);
+  llvm::StringMap<metrics::Histogram*> histograms TFRT_GUARDED_BY(mu);
+};
+
+MetricsCache& GetMetricsCache() {
+  static auto* cache = new MetricsCache;
+  return *cache;
+}
+
+metrics::Counter* GetCounter(std::string name) {
+  MetricsCache& cache = GetMetricsCache();
+  mutex_lock lock(cache.mu);
+  metrics::Counter*& counter = cache.counters[name];
+  if (counter == nullptr) counter = metrics::NewCounter(std::move(name));
+  return counter;
+}
+
+metrics::Histogram* GetHistogram(std::string name, std::vector<double> bounds) {
+  MetricsCache& cache = GetMetricsCache();
+  mutex_lock lock(cache.mu);
+  metrics::Histogram*& histogram = cache.histograms[name];
+  if (histogram == nullptr) {
+    histogram = metrics::NewHistogram(
+        std::move(name), metrics::Buckets::Explicit(std::move(bounds)));
+  }
+  return histogram;
+}
+
+// Returns `first`, `first * factor`, ... up to `last`.
+std::vector<double> ExponentialBounds(double first, double factor,
+                                      double last) {
+  std::vector<double> bounds;
+  for (double bound = first; bound <= last; bound *= factor)
+    bounds.push_back(bound);
+  return bounds;
+}
+
+}  // namespace
+
+WorkQueueStats::WorkQueueStats(string_view name, int num_threads) {
+  const std::string prefix = StrCat("/tfrt/work_queue/", name, "/");
+  tasks_enqueued_.reserve(num_threads);
+  for (int i = 0; i < num_threads; ++i)
+    tasks_enqueued_.push_back(GetCounter(StrCat(prefix, "tasks_enqueued/", i)));
+  // Worker queues hold up to 1024 tasks of each priority.
+  queue_depth_ = GetHistogram(StrCat(prefix, "queue_depth"),
+                              ExponentialBounds(1, 2, 4096));
+  task_latency_us_ = GetHistogram(StrCat(prefix, "task_latency_us"),
+                                  ExponentialBounds(1, 4, 1 << 24));
+  steals_attempted_ = GetCounter(StrCat(prefix, "steals_attempted"));
+  steals_succeeded_ = GetCounter(StrCat(prefix, "steals_succeeded"));
+  parked_us_ = GetHistogram(StrCat(prefix, "parked_us"),
+                            ExponentialBounds(1, 4, 1 << 24));
+}
+
+}  // namespace internal
+}  // namespace tfrt
@@ -0,0 +1,101 @@
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+// Opt-in statistics of a work queue, exported through tfrt::metrics.
+//
+// For a work queue named <name>, the following metrics are recorded:
+//
+//   /tfrt/work_queue/<name>/tasks_enqueued/<thread id>  (counter)
+//   /tfrt/work_queue/<name>/queue_depth                 (histogram)
+//   /tfrt/work_queue/<name>/task_latency_us             (histogram)
+//   /tfrt/work_queue/<name>/steals_attempted            (counter)
+//   /tfrt/work_queue/<name>/steals_succeeded            (counter)
+//   /tfrt/work_queue/<name>/parked_us                   (histogram)
+//
+// The queue depth is the size of the queue of a worker after a task was pushed
+// to it, the task latency is the time between enqueueing a task and starting
+// it, and parked time is the time a worker thread spends blocked in the
+// EventCount waiting for work. Work queues with the same name share metrics.
+
+#ifndef TFRT_THIRD_PARTY_CONCURRENT_WORK_QUEUE_WORK_QUEUE_STATS_H_
+#define TFRT_THIRD_PARTY_CONCURRENT_WORK_QUEUE_WORK_QUEUE_STATS_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "tfrt/host_context/task_function.h"
+#include "tfrt/metrics/counter.h"
+#include "tfrt/metrics/histogram.h"
+#include "tfrt/support/forward_decls.h"
+
+namespace tfrt {
+namespace internal {
+
+class WorkQueueStats {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  WorkQueueStats(string_view name, int num_threads);
+
+  // Records a task pushed to the queue of worker `thread_id`, which holds
+  // `queue_depth` tasks after the push.
+  void RecordEnqueue(int thread_id, uint64_t queue_depth) {
+    tasks_enqueued_[thread_id]->Increment();
+    queue_depth_->Record(queue_depth);
+  }
+
+  // Returns a task that records its latency and then runs `task`.
+  TaskFunction WithLatency(TaskFunction task) {
+    return TaskFunction(
+        [this, task = std::move(task), enqueued = Clock::now()]() mutable {
+          const Clock::duration latency = Clock::now() - enqueued;
+          task_latency_us_->Record(ToMicroseconds(latency));
+          RecordRecentLatency(latency);
+          task();
+        });
+  }
+
+  // Returns a moving average of the latency of the recently started tasks.
+  // It is not updated while no task starts.
+  Clock::duration recent_task_latency() const {
+    return Clock::duration(recent_latency_.load(std::memory_order_relaxed));
+  }
+
+  void RecordSteal(bool succeeded) {
+    steals_attempted_->Increment();
+    if (succeeded) steals_succeeded_->Increment();
+  }
+
+  void RecordParked(Clock::duration duration) {
+    parked_us_->Record(ToMicroseconds(duration));
+  }
+
+ private:
+  // Moves the average 1/8 of the way to `latency`. Concurrent updates may
+  // drop samples, which does not matter for an average.
+  void RecordRecentLatency(Clock::duration latency) {
+    const int64_t average = recent_latency_.load(std::memory_order_relaxed);
+    recent_latency_.store(average + (latency.count() - average) / 8,
+                          std::memory_order_relaxed);
+  }
+
+  static double ToMicroseconds(Clock::duration duration) {
+    return std::chrono::duration<double, std::micro>(duration).count();
+  }
+
+  std::vector<metrics::Counter*> tasks_enqueued_;
+  metrics::Histogram* queue_depth_;
+  metrics::Histogram* task_latency_us_;
+  metrics::Counter* steals_attempted_;
+  metrics::Counter* steals_succeeded_;
+  metrics::Histogram* parked_us_;
+  std::atomic<int64_t> recent_latency_{0};
+};
+
+}  // namespace internal
+}  // namespace tfrt
+
+#endif  // TFRT_THIRD_PARTY_CONCURRENT_WORK_QUEUE_WORK_QUEUE_STATS_H_
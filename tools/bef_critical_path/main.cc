@@ -0,0 +1,112 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//===- Critical Path Analysis ---------------------------------------------===//
+//
+// This file reads the execution traces written by bef_executor --critical_path
+// and prints the critical path and the slack per stream of the executions.
+//
+// Functions that run many times, e.g. loop bodies, only have their slowest
+// execution printed unless --all_executions is given.
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "tfrt/bef_executor/critical_path.h"
+
+static llvm::cl::opt<std::string> cl_input_filename(  // NOLINT
+    llvm::cl::Positional, llvm::cl::desc("<trace file>"), llvm::cl::init("-"));
+
+static llvm::cl::list<std::string> cl_functions(  // NOLINT
+    "functions", llvm::cl::desc("Only analyze the given functions"),
+    llvm::cl::ZeroOrMore, llvm::cl::MiscFlags::CommaSeparated);
+
+static llvm::cl::opt<bool> cl_all_executions(  // NOLINT
+    "all_executions",
+    llvm::cl::desc("Print every execution of a function, not only the slowest "
+                   "one."),
+    llvm::cl::Optional, llvm::cl::ValueDisallowed);
+
+int main(int argc, char** argv) {
+  llvm::cl::ParseCommandLineOptions(argc, argv,
+                                    "BEF execution critical path analysis\n");
+
+  auto file = llvm::MemoryBuffer::getFileOrSTDIN(cl_input_filename);
+  if (!file) {
+    llvm::errs() << argv[0] << ": couldn't read " << cl_input_filename << ": "
+                 << file.getError().message() << "\n";
+    return 1;
+  }
+
+  auto traces = tfrt::ParseExecutionTraces((*file)->getBuffer());
+  if (!traces) {
+    llvm::errs() << argv[0] << ": " << cl_input_filename << ": "
+                 << llvm::toString(traces.takeError()) << "\n";
+    return 1;
+  }
+
+  llvm::StringSet<> functions;
+  for (const std::string& function : cl_functions) functions.insert(function);
+
+  // The executions to print and the analysis of each, grouped by function.
+  struct Execution {
+    const tfrt::ExecutionTrace* trace;
+    tfrt::CriticalPath path;
+  };
+  std::map<std::string, std::vector<Execution>> executions;
+  for (const tfrt::ExecutionTrace& trace : *traces) {
+    if (!functions.empty() && !functions.contains(trace.function_name))
+      continue;
+    executions[trace.function_name].push_back(
+        {&trace, tfrt::AnalyzeCriticalPath(trace)});
+  }
+
+  for (auto& iter : executions) {
+    std::vector<Execution>& function_executions = iter.second;
+    if (function_executions.size() > 1) {
+      int64_t total_ns = 0;
+      for (const Execution& execution : function_executions)
+        total_ns += execution.path.latency_ns;
+      llvm::outs() << "function "
+                   << (iter.first.empty() ? "(unknown)" : iter.first) << ": "
+                   << function_executions.size() << " executions, "
+                   << llvm::format("%.3f", total_ns * 1e-3 /
+                                               function_executions.size())
+                   << " us on average\n";
+    }
+
+    if (cl_all_executions) {
+      for (const Execution& execution : function_executions)
+        tfrt::PrintCriticalPath(*execution.trace, execution.path,
+                                llvm::outs());
+      continue;
+    }
+
+    const Execution* slowest = &function_executions.front();
+    for (const Execution& execution : function_executions) {
+      if (execution.path.latency_ns > slowest->path.latency_ns)
+        slowest = &execution;
+    }
+    tfrt::PrintCriticalPath(*slowest->trace, slowest->path, llvm::outs());
+  }
+
+  return 0;
+}
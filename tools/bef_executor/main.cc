@@ -19,10 +19,15 @@
 
 #include <optional>
 #include <string>
+#include <vector>
 
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/raw_ostream.h"
 #include "tfrt/bef_executor_driver/bef_executor_driver.h"
 #include "tfrt/host_context/host_allocator.h"
+#include "tfrt/metrics/in_process_metrics.h"
+#include "tfrt/tracing/perf_counters.h"
 #include "tfrt/tracing/tracing.h"
 
 static llvm::cl::opt<std::string> cl_input_filename(  // NOLINT
@@ -61,7 +66,17 @@ static llvm::cl::opt<tfrt::HostAllocatorType> cl_host_allocator_type(  // NOLINT
         clEnumValN(tfrt::HostAllocatorType::kProfiledMalloc,
                    "profiled_allocator", "Malloc with metric profiling."),
         clEnumValN(tfrt::HostAllocatorType::kLeakCheckMalloc,
-                   "leak_check_allocator", "Malloc with memory leak check.")),
+                   "leak_check_allocator", "Malloc with memory leak check."),
+        clEnumValN(tfrt::HostAllocatorType::kPooledMalloc, "pooled_allocator",
+                   "Size-class pooled malloc with thread-local caches."),
+        clEnumValN(tfrt::HostAllocatorType::kHugePageMalloc,
+                   "huge_page_allocator",
+                   "Pooled malloc with huge pages for large allocations."),
+        clEnumValN(tfrt::HostAllocatorType::kRequestArena, "request_arena",
+                   "Malloc with a per-request arena for executor state."),
+        clEnumValN(tfrt::HostAllocatorType::kAllocationProfiler,
+                   "allocation_profiler",
+                   "Malloc with sampled per-kernel allocation profiling.")),
     llvm::cl::init(tfrt::HostAllocatorType::kLeakCheckMalloc));
 
 // Enable aggregate op handler types to be specified on the command line.
@@ -77,12 +92,105 @@ static llvm::cl::opt<tfrt::tracing::TracingLevel> cl_tracing_level(  // NOLINT
         clEnumValN(tfrt::tracing::TracingLevel::Debug, "debug", "debug")),
     llvm::cl::init(tfrt::tracing::TracingLevel::Default));
 
+static llvm::cl::opt<std::string> cl_tracing_sink(  // NOLINT
+    "tracing_sink",
+    llvm::cl::desc("Name of the tracing sink to use with --enable_tracing, "
+                   "e.g. 'perfetto'. Defaults to the sink linked in."),
+    llvm::cl::init(""));
+
+static llvm::cl::list<std::string> cl_perf_counter_scopes(  // NOLINT
+    "perf_counter_scopes",
+    llvm::cl::desc("Comma-separated names of the tracing scopes, e.g. kernel "
+                   "names, to count cycles, instructions, cache misses and "
+                   "TLB misses of with the Linux perf_event interface."),
+    llvm::cl::ZeroOrMore, llvm::cl::MiscFlags::CommaSeparated);
+
 // Print error code if there's any error.
 static llvm::cl::opt<bool> cl_print_error_code(  // NOLINT
     "print_error_code",
     llvm::cl::desc("Print error code if there's any error."),
     llvm::cl::Optional, llvm::cl::ValueDisallowed);
 
+// Record the wall time of each kernel into a profile file.
+static llvm::cl::opt<std::string> cl_kernel_profile(  // NOLINT
+    "kernel_profile",
+    llvm::cl::desc("Write per-kernel wall times to the given file, for use "
+                   "with tfrt_opt -tfrt-apply-kernel-profile."),
+    llvm::cl::init(""));
+
+// Write the allocations sampled by --host_allocator_type=allocation_profiler.
+static llvm::cl::opt<std::string> cl_allocation_profile(  // NOLINT
+    "allocation_profile",
+    llvm::cl::desc("Write the allocations sampled by the allocation profiler "
+                   "to the given file in the pprof format."),
+    llvm::cl::init(""));
+
+// Record the critical path traces of all executions.
+static llvm::cl::opt<std::string> cl_critical_path(  // NOLINT
+    "critical_path",
+    llvm::cl::desc("Write the kernel timings of every execution to the given "
+                   "file, for analysis with bef_critical_path."),
+    llvm::cl::init(""));
+
+static llvm::cl::opt<bool> cl_warmup(  // NOLINT
+    "warmup",
+    llvm::cl::desc("Warm up the BEF file before running the functions: fault "
+                   "in its pages, decode all functions, and run the functions "
+                   "without arguments --warmup_runs times."),
+    llvm::cl::Optional, llvm::cl::ValueDisallowed);
+
+static llvm::cl::opt<int> cl_warmup_runs(  // NOLINT
+    "warmup_runs",
+    llvm::cl::desc("Number of warm-up runs of each function with --warmup."),
+    llvm::cl::init(1));
+
+static llvm::cl::opt<bool> cl_parallel_open(  // NOLINT
+    "parallel_open",
+    llvm::cl::desc("Decode the kernels and functions of the BEF file in "
+                   "parallel on the work queue before running it."),
+    llvm::cl::Optional, llvm::cl::ValueDisallowed);
+
+// Print the metrics recorded during the run, e.g. by --work_queue_type=mstats.
+static llvm::cl::opt<bool> cl_print_metrics(  // NOLINT
+    "print_metrics",
+    llvm::cl::desc("Print the recorded metrics in the Prometheus text format "
+                   "to stderr at exit."),
+    llvm::cl::Optional, llvm::cl::ValueDisallowed);
+
+// Generate load with a function instead of running the functions once.
+static llvm::cl::opt<std::string> cl_load_function(  // NOLINT
+    "load_function",
+    llvm::cl::desc("Generate load with the given function for "
+                   "--load_duration_s, and print its throughput, latency "
+                   "percentiles, allocations and metrics. Use "
+                   "--work_queue_type=mstats for the work queue metrics."),
+    llvm::cl::init(""));
+
+static llvm::cl::opt<std::string> cl_load_inputs(  // NOLINT
+    "load_inputs",
+    llvm::cl::desc("BTF file with the tensor arguments of --load_function, "
+                   "one group of tensors per request, replayed in order."),
+    llvm::cl::init(""));
+
+static llvm::cl::opt<int> cl_load_clients(  // NOLINT
+    "load_clients",
+    llvm::cl::desc("Number of client threads that run one request of "
+                   "--load_function at a time."),
+    llvm::cl::init(1));
+
+static llvm::cl::opt<double> cl_load_rate(  // NOLINT
+    "load_rate",
+    llvm::cl::desc("If positive, start requests of --load_function at this "
+                   "rate per second (open loop) instead of from "
+                   "--load_clients threads."),
+    llvm::cl::init(0));
+
+static llvm::cl::opt<double> cl_load_duration_s(  // NOLINT
+    "load_duration_s",
+    llvm::cl::desc("Duration of the load generated with --load_function, in "
+                   "seconds."),
+    llvm::cl::init(10));
+
 //===----------------------------------------------------------------------===//
 // Driver main
 //===----------------------------------------------------------------------===//
@@ -99,10 +207,45 @@ int main(int argc, char** argv) {
   run_config.work_queue_type = cl_work_queue_type;
   run_config.host_allocator_type = cl_host_allocator_type;
   run_config.print_error_code = cl_print_error_code;
-
+  run_config.kernel_profile_filename = cl_kernel_profile;
+  run_config.allocation_profile_filename = cl_allocation_profile;
+  run_config.critical_path_filename = cl_critical_path;
+  run_config.parallel_open = cl_parallel_open;
+  run_config.warmup = cl_warmup;
+  run_config.warmup_runs = cl_warmup_runs;
+  run_config.load_function = cl_load_function;
+  run_config.load_inputs_filename = cl_load_inputs;
+  run_config.load_clients = cl_load_clients;
+  run_config.load_rate = cl_load_rate;
+  run_config.load_duration_seconds = cl_load_duration_s;
+
+  if (!cl_tracing_sink.empty()) {
+    if (auto error = tfrt::tracing::SelectTracingSink(cl_tracing_sink)) {
+      llvm::errs() << llvm::toString(std::move(error)) << "\n";
+      return 1;
+    }
+  }
+  if (!cl_perf_counter_scopes.empty()) {
+    std::vector<std::string> scopes(cl_perf_counter_scopes.begin(),
+                                    cl_perf_counter_scopes.end());
+    if (auto error = tfrt::tracing::EnablePerfCounters(scopes)) {
+      llvm::errs() << llvm::toString(std::move(error)) << "\n";
+      return 1;
+    }
+  }
   std::optional<tfrt::tracing::TracingRequester> tracing;
   if (cl_enable_tracing) tracing.emplace();
   tfrt::tracing::SetTracingLevel(cl_tracing_level);
 
-  return RunBefExecutor(run_config);
+  tfrt::metrics::InProcessMetricsRegistry* metrics_registry = nullptr;
+  // The metrics of the work queue are part of the load report.
+  if (cl_print_metrics || !cl_load_function.empty()) {
+    metrics_registry = new tfrt::metrics::InProcessMetricsRegistry;
+    tfrt::metrics::RegisterMetricsRegistry(metrics_registry);
+  }
+
+  int exit_code = RunBefExecutor(run_config);
+  if (metrics_registry != nullptr)
+    metrics_registry->WritePrometheusText(llvm::errs());
+  return exit_code;
 }
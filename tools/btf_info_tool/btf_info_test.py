@@ -31,10 +31,21 @@ EXPECTED = (
     ' values = [1, 2, 3, 5, 6, 7]\n'
 )
 
+EXPECTED_STATS = (
+    '[0] DenseHostTensor dtype = i8,'
+    ' shape = [3, 5],'
+    ' values = [0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14],'
+    ' min = 0, max = 14, mean = 7, nans = 0\n'
+    '[1] CooHostTensor dtype = i64,'
+    ' shape = [2, 4],'
+    ' indices = [0, 1, 0, 2, 0, 3, 1, 1, 1, 2, 1, 3],'
+    ' values = [1, 2, 3, 5, 6, 7]\n'
+)
+
 
 class BtfInfoTest(unittest.TestCase):
 
-  def test_prints_btf_info(self):
+  def _run_btf_info(self, *flags):
     try:
       btf_fd, btf_path = tempfile.mkstemp('test-btf')
 
@@ -46,18 +57,25 @@ class BtfInfoTest(unittest.TestCase):
         tensor2[1, 0] = 0
         writer.add_tensors(tensor2, tensor_type=btf_writer.TensorLayout.COO)
 
-      result = subprocess.run(
-          ['third_party/tf_runtime/tools/btf_info', btf_path],
+      return subprocess.run(
+          ['third_party/tf_runtime/tools/btf_info', *flags, btf_path],
           stdout=subprocess.PIPE,
           stderr=subprocess.PIPE,
       )
 
-      self.assertEqual(result.stdout.decode('utf-8'), EXPECTED)
-      self.assertEqual(result.stderr.decode('utf-8'), '')
-
     finally:
       os.remove(btf_path)
 
+  def test_prints_btf_info(self):
+    result = self._run_btf_info()
+    self.assertEqual(result.stdout.decode('utf-8'), EXPECTED)
+    self.assertEqual(result.stderr.decode('utf-8'), '')
+
+  def test_prints_stats(self):
+    result = self._run_btf_info('--stats', '--num_threads=2')
+    self.assertEqual(result.stdout.decode('utf-8'), EXPECTED_STATS)
+    self.assertEqual(result.stderr.decode('utf-8'), '')
+
 
 if __name__ == '__main__':
   unittest.main()
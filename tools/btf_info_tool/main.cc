@@ -17,20 +17,40 @@
 //===- BTF Inspector Utility ----------------------------------------------===//
 //
 // This file prints the contents of a BTF file to stdout.
+//
+// With --stats it also prints the minimum, maximum, mean and NaN count of
+// every dense tensor, and with --verify_checksums it checks the tensors
+// against the checksum section of the file. Both read the tensor data from
+// the mapping in parallel, with large tensors split into blocks.
 
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <functional>
 #include <iostream>
+#include <limits>
 #include <optional>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
+#include "Eigen/Core"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Error.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MathExtras.h"
 #include "tfrt/host_context/host_buffer.h"
 #include "tfrt/support/forward_decls.h"
 #include "tfrt/tensor/btf.h"
+#include "tfrt/tensor/btf_util.h"
 #include "tfrt/tensor/coo_host_tensor.h"
 #include "tfrt/tensor/dense_host_tensor.h"
 #include "tfrt/tensor/tensor_metadata.h"
@@ -50,6 +70,23 @@ namespace {
 llvm::cl::opt<std::string> cl_input_filename(  // NOLINT
     llvm::cl::Positional, llvm::cl::desc("<input file>"), llvm::cl::Required);
 
+llvm::cl::opt<bool> cl_stats(  // NOLINT
+    "stats",
+    llvm::cl::desc("Print the min, max, mean and NaN count of dense tensors."),
+    llvm::cl::init(false));
+
+llvm::cl::opt<bool> cl_verify_checksums(  // NOLINT
+    "verify_checksums",
+    llvm::cl::desc("Verify dense tensors against the checksums of the file, "
+                   "and fail if any does not match."),
+    llvm::cl::init(false));
+
+llvm::cl::opt<int> cl_num_threads(  // NOLINT
+    "num_threads",
+    llvm::cl::desc("Number of threads for --stats and --verify_checksums, "
+                   "or 0 for one per core."),
+    llvm::cl::init(0));
+
 class BtfFile {
  public:
   // Open the given file.
@@ -113,6 +150,31 @@ class BtfFile {
     return Read<TensorHeader>(payload_pos);
   }
 
+  // Returns the checksums of the tensors, or an empty vector if the file does
+  // not have a checksum section (see btf::kChecksumMagic).
+  std::vector<uint32_t> ReadChecksums() const {
+    const size_t num_tensors = NumTensors();
+    size_t pos = sizeof(int64_t) * (num_tensors + 1);
+    const size_t section_offset = pos;
+    const uint64_t* magic = Read<uint64_t>(&pos);
+    const uint32_t* checksums = Read<uint32_t>(&pos, num_tensors);
+    if (num_tensors == 0 || !magic || !checksums ||
+        *magic != tfrt::btf::kChecksumMagic)
+      return {};
+
+    // Files without a checksum section may have their first record right
+    // after the offsets, where the section would be.
+    const int64_t* offsets =
+        reinterpret_cast<const int64_t*>(static_cast<const char*>(buffer_) +
+                                         sizeof(int64_t));
+    const size_t section_end = section_offset + sizeof(uint64_t) +
+                               llvm::alignTo(num_tensors * sizeof(uint32_t),
+                                             sizeof(uint64_t));
+    for (size_t i = 0; i < num_tensors; ++i)
+      if (static_cast<size_t>(offsets[i]) < section_end) return {};
+    return std::vector<uint32_t>(checksums, checksums + num_tensors);
+  }
+
   // Read an array of objects of type T located at the byte offset given by
   // `pos`, checking to ensure the buffer is large enough to contain this array.
   // The offset `pos` is updated to point past the end of the array.
@@ -189,6 +251,150 @@ class BtfFile {
   size_t size_ = 0;
 };
 
+
+// The statistics of the elements of a tensor, or of a block of them. NaNs are
+// counted, and are not part of the other statistics.
+struct TensorStats {
+  double min = std::numeric_limits<double>::infinity();
+  double max = -std::numeric_limits<double>::infinity();
+  double sum = 0;
+  int64_t count = 0;
+  int64_t nans = 0;
+
+  void Merge(const TensorStats& other) {
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+    sum += other.sum;
+    count += other.count;
+    nans += other.nans;
+  }
+
+  void Print(llvm::raw_ostream& os) const {
+    if (count == 0) {
+      os << ", nans = " << nans;
+      return;
+    }
+    os << ", min = " << llvm::format("%g", min)
+       << ", max = " << llvm::format("%g", max)
+       << ", mean = " << llvm::format("%g", sum / count)
+       << ", nans = " << nans;
+  }
+};
+
+// The type that the statistics of elements of type T are computed in.
+template <typename T>
+using StatsValueType =
+    std::conditional_t<std::is_same<T, Eigen::half>::value ||
+                           std::is_same<T, Eigen::bfloat16>::value,
+                       float, T>;
+
+// Returns the statistics of `data[0, size)`. The elements are processed in
+// independent lanes, so that the loop is vectorized.
+template <typename T>
+TensorStats ComputeBlockStats(const T* data, size_t size) {
+  using Value = StatsValueType<T>;
+  constexpr int kLanes = 16;
+  constexpr Value kMaxValue = std::numeric_limits<Value>::has_infinity
+                                  ? std::numeric_limits<Value>::infinity()
+                                  : std::numeric_limits<Value>::max();
+  constexpr Value kLowestValue = std::numeric_limits<Value>::has_infinity
+                                     ? -std::numeric_limits<Value>::infinity()
+                                     : std::numeric_limits<Value>::lowest();
+
+  Value min[kLanes], max[kLanes];
+  double sum[kLanes];
+  int64_t nans[kLanes];
+  std::fill_n(min, kLanes, kMaxValue);
+  std::fill_n(max, kLanes, kLowestValue);
+  std::fill_n(sum, kLanes, 0.0);
+  std::fill_n(nans, kLanes, 0);
+
+  auto accumulate = [&](int lane, Value x) {
+    const bool nan = x != x;
+    nans[lane] += nan;
+    min[lane] = x < min[lane] ? x : min[lane];
+    max[lane] = x > max[lane] ? x : max[lane];
+    sum[lane] += nan ? 0.0 : static_cast<double>(x);
+  };
+
+  size_t i = 0;
+  for (; i + kLanes <= size; i += kLanes)
+    for (int lane = 0; lane < kLanes; ++lane)
+      accumulate(lane, static_cast<Value>(data[i + lane]));
+  for (int lane = 0; i < size; ++i, ++lane)
+    accumulate(lane, static_cast<Value>(data[i]));
+
+  TensorStats stats;
+  for (int lane = 0; lane < kLanes; ++lane) {
+    stats.min = std::min(stats.min, static_cast<double>(min[lane]));
+    stats.max = std::max(stats.max, static_cast<double>(max[lane]));
+    stats.sum += sum[lane];
+    stats.nans += nans[lane];
+  }
+  stats.count = size - stats.nans;
+  return stats;
+}
+
+// Returns the statistics of the elements [begin, end) of `tensor`, or nullopt
+// if the dtype is not numeric.
+std::optional<TensorStats> ComputeStats(const DenseHostTensor& tensor,
+                                        size_t begin, size_t end) {
+  auto compute = [&](auto type_tag) {
+    using T = decltype(type_tag);
+    return ComputeBlockStats(static_cast<const T*>(tensor.data()) + begin,
+                             end - begin);
+  };
+  switch (tensor.dtype()) {
+    case DType::I1:
+      return compute(bool{});
+    case DType::UI8:
+      return compute(uint8_t{});
+    case DType::UI16:
+      return compute(uint16_t{});
+    case DType::UI32:
+      return compute(uint32_t{});
+    case DType::UI64:
+      return compute(uint64_t{});
+    case DType::I8:
+      return compute(int8_t{});
+    case DType::I16:
+      return compute(int16_t{});
+    case DType::I32:
+      return compute(int32_t{});
+    case DType::I64:
+      return compute(int64_t{});
+    case DType::F16:
+      return compute(Eigen::half{});
+    case DType::BF16:
+      return compute(Eigen::bfloat16{});
+    case DType::F32:
+      return compute(float{});
+    case DType::F64:
+      return compute(double{});
+    default:
+      return std::nullopt;
+  }
+}
+
+// The tensors are split into blocks of this many bytes for --stats.
+constexpr size_t kStatsBlockBytes = 16 << 20;
+
+// Runs `tasks` on `num_threads` threads, largest first.
+void RunTasks(std::vector<std::pair<size_t, std::function<void()>>> tasks,
+              int num_threads) {
+  std::sort(tasks.begin(), tasks.end(),
+            [](const auto& a, const auto& b) { return a.first > b.first; });
+  std::atomic<size_t> next_task{0};
+  auto worker = [&]() {
+    for (size_t i = next_task++; i < tasks.size(); i = next_task++)
+      tasks[i].second();
+  };
+  std::vector<std::thread> threads;
+  for (int i = 1; i < num_threads; ++i) threads.emplace_back(worker);
+  worker();
+  for (auto& thread : threads) thread.join();
+}
+
 }  // namespace
 
 int main(int argc, char* argv[]) {
@@ -201,45 +407,132 @@ int main(int argc, char* argv[]) {
     return 1;
   }
 
-  std::vector<tfrt::Index> dims_vec;
+  // The tensors of a malformed record are left empty, and an error is printed
+  // in their place.
+  struct Entry {
+    std::optional<DenseHostTensor> dense;
+    std::optional<CooHostTensor> coo;
+    std::string error;
+    std::optional<TensorStats> stats;
+    std::vector<TensorStats> block_stats;
+    bool checksum_mismatch = false;
+  };
+
+  // Parse the records first. Only their headers are read here, the tensor
+  // data is only touched by --stats and --verify_checksums.
+  std::vector<Entry> entries(file.NumTensors());
   for (int i = 0; i < file.NumTensors(); i++) {
+    Entry& entry = entries[i];
     size_t payload_pos;
     const TensorHeader* header = file.ReadTensorHeader(i, &payload_pos);
     if (!header) {
-      llvm::errs() << "Could not parse header for tensor " << i << "\n";
+      entry.error = "Could not parse header for tensor ";
       continue;
     }
 
     DType type(ToDTypeKind(header->dtype));
 
     switch (header->layout) {
-      case TensorLayout::kRMD: {
-        std::optional<DenseHostTensor> tensor =
+      case TensorLayout::kRMD:
+        entry.dense =
             file.ReadDenseHostTensorPayload(&payload_pos, type, header->rank);
-        if (!tensor) {
-          llvm::errs() << "Could not parse dense payload for tensor " << i
-                       << "\n";
-          continue;
-        }
-
-        llvm::outs() << "[" << i << "] ";
-        tensor->Print(llvm::outs());
-        llvm::outs() << "\n";
-      } break;
-
-      case TensorLayout::kCOO_EXPERIMENTAL: {
-        std::optional<CooHostTensor> tensor =
+        if (!entry.dense)
+          entry.error = "Could not parse dense payload for tensor ";
+        break;
+
+      case TensorLayout::kCOO_EXPERIMENTAL:
+        entry.coo =
             file.ReadCooHostTensorPayload(&payload_pos, type, header->rank);
-        if (!tensor) {
-          llvm::errs() << "Could not parse COO payload for tensor " << i
-                       << "\n";
-          continue;
-        }
-
-        llvm::outs() << "[" << i << "] ";
-        tensor->Print(llvm::outs());
-        // Newline already printed by CooHostTensor::Print
-      } break;
+        if (!entry.coo) entry.error = "Could not parse COO payload for tensor ";
+        break;
+    }
+  }
+
+  std::vector<uint32_t> checksums;
+  if (cl_verify_checksums) {
+    checksums = file.ReadChecksums();
+    if (checksums.empty()) {
+      llvm::errs() << "The file does not have checksums\n";
+      return 1;
+    }
+  }
+
+  // Compute the statistics and the checksums of the dense tensors in
+  // parallel. The checksum of a tensor is computed by a single task, and the
+  // statistics of every block of a tensor by its own task.
+  if (cl_stats || !checksums.empty()) {
+    std::vector<std::pair<size_t, std::function<void()>>> tasks;
+    for (size_t i = 0; i < entries.size(); ++i) {
+      Entry& entry = entries[i];
+      if (!entry.dense) continue;
+      const DenseHostTensor& tensor = *entry.dense;
+
+      if (!checksums.empty()) {
+        tasks.emplace_back(tensor.DataSizeInBytes(),
+                           [&entry, &tensor, checksum = checksums[i]] {
+                             entry.checksum_mismatch =
+                                 tfrt::ComputeBTFChecksum(tensor) != checksum;
+                           });
+      }
+
+      if (!cl_stats) continue;
+      entry.stats = ComputeStats(tensor, 0, 0);
+      if (!entry.stats) continue;
+      const size_t element_size = tfrt::GetHostSize(tensor.dtype());
+      const size_t num_elements = tensor.NumElements();
+      const size_t block_size = std::max<size_t>(
+          1, kStatsBlockBytes / std::max<size_t>(1, element_size));
+      entry.block_stats.resize((num_elements + block_size - 1) / block_size);
+      for (size_t b = 0; b < entry.block_stats.size(); ++b) {
+        const size_t begin = b * block_size;
+        const size_t end = std::min(num_elements, begin + block_size);
+        tasks.emplace_back((end - begin) * element_size,
+                           [&entry, &tensor, b, begin, end] {
+                             entry.block_stats[b] =
+                                 *ComputeStats(tensor, begin, end);
+                           });
+      }
+    }
+
+    int num_threads = cl_num_threads;
+    if (num_threads <= 0)
+      num_threads = std::max(1u, std::thread::hardware_concurrency());
+    RunTasks(std::move(tasks), num_threads);
+
+    for (Entry& entry : entries) {
+      for (const TensorStats& block : entry.block_stats)
+        entry.stats->Merge(block);
+    }
+  }
+
+  bool checksums_match = true;
+  for (size_t i = 0; i < entries.size(); i++) {
+    const Entry& entry = entries[i];
+    if (!entry.error.empty()) {
+      llvm::errs() << entry.error << i << "\n";
+      continue;
+    }
+    if (!entry.dense && !entry.coo) continue;
+
+    llvm::outs() << "[" << i << "] ";
+    if (entry.dense) {
+      entry.dense->Print(llvm::outs());
+      if (entry.stats) entry.stats->Print(llvm::outs());
+      if (!checksums.empty()) {
+        llvm::outs() << (entry.checksum_mismatch ? ", checksum mismatch"
+                                                 : ", checksum ok");
+        checksums_match &= !entry.checksum_mismatch;
+      }
+      llvm::outs() << "\n";
+    } else {
+      entry.coo->Print(llvm::outs());
+      // Newline already printed by CooHostTensor::Print
     }
   }
+
+  if (!checksums_match) {
+    llvm::errs() << "Some tensors do not match their checksums\n";
+    return 1;
+  }
+  return 0;
 }
@@ -0,0 +1,120 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//===- Kernel Benchmark ---------------------------------------------------===//
+//
+// This file runs a registered kernel on generated arguments across thread
+// counts and prints the time per run and the argument bytes per second, e.g.
+//
+//   kernel_benchmark --kernel=eigen.conv2d.f32 --arg=f32[8,32,32,3] \
+//     --arg=f32[3,3,3,16] --arg=f32[8,32,32,16] --arg=chain \
+//     --attr=str:same --attr=i64[]:1,1 --threads=1,2,4
+//
+// See KernelBenchmarkOptions for the syntax of --arg and --attr.
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/host_context/kernel_registry.h"
+#include "tfrt/support/logging.h"
+#include "tfrt/utils/kernel_benchmark.h"
+
+static llvm::cl::opt<std::string> cl_kernel(  // NOLINT
+    "kernel", llvm::cl::desc("The kernel to benchmark"), llvm::cl::Required);
+
+// Argument and attribute specs contain commas, so they are given one per flag.
+static llvm::cl::list<std::string> cl_args(  // NOLINT
+    "arg", llvm::cl::desc("An argument of the kernel, in order"),
+    llvm::cl::ZeroOrMore);
+
+static llvm::cl::list<std::string> cl_attrs(  // NOLINT
+    "attr", llvm::cl::desc("An attribute of the kernel, in order"),
+    llvm::cl::ZeroOrMore);
+
+static llvm::cl::opt<unsigned> cl_num_results(  // NOLINT
+    "num_results", llvm::cl::desc("The number of results of the kernel"),
+    llvm::cl::init(1));
+
+static llvm::cl::list<int> cl_threads(  // NOLINT
+    "threads", llvm::cl::desc("The numbers of threads to run the kernel on"),
+    llvm::cl::ZeroOrMore, llvm::cl::MiscFlags::CommaSeparated);
+
+static llvm::cl::opt<unsigned> cl_min_time_ms(  // NOLINT
+    "min_time_ms",
+    llvm::cl::desc("The minimum time to run the kernel for per thread count"),
+    llvm::cl::init(1000));
+
+static llvm::cl::opt<std::string> cl_work_queue_type(  // NOLINT
+    "work_queue_type",
+    llvm::cl::desc("Specify concurrent work queue type (s, mstd, ...):"),
+    llvm::cl::init("mstd"));
+
+int main(int argc, char** argv) {
+  llvm::cl::ParseCommandLineOptions(argc, argv, "TFRT kernel benchmark\n");
+
+  auto work_queue = tfrt::CreateWorkQueue(cl_work_queue_type);
+  if (work_queue == nullptr) {
+    llvm::errs() << argv[0] << ": invalid work queue type "
+                 << cl_work_queue_type << "\n";
+    return 1;
+  }
+  // A failing kernel emits an error on every run, from all the threads.
+  tfrt::EnableAsyncLogging();
+  tfrt::HostContext host(
+      [](const tfrt::DecodedDiagnostic& diag) {
+        TFRT_LOG(ERROR) << "Diagnostic: " << diag;
+      },
+      tfrt::CreateMallocAllocator(), std::move(work_queue));
+  tfrt::RegisterStaticKernels(host.GetMutableRegistry());
+
+  tfrt::KernelBenchmarkOptions options;
+  options.kernel_name = cl_kernel;
+  options.arguments.assign(cl_args.begin(), cl_args.end());
+  options.attributes.assign(cl_attrs.begin(), cl_attrs.end());
+  options.num_results = cl_num_results;
+
+  llvm::SmallVector<int, 4> thread_counts(cl_threads.begin(), cl_threads.end());
+  if (thread_counts.empty()) thread_counts.push_back(1);
+
+  llvm::outs() << llvm::format("%8s %12s %14s %12s\n", "threads", "runs",
+                               "ns/run", "MB/s");
+  for (int num_threads : thread_counts) {
+    auto stats = tfrt::RunKernelBenchmark(
+        options, num_threads, std::chrono::milliseconds(cl_min_time_ms),
+        &host);
+    if (!stats) {
+      llvm::errs() << argv[0] << ": " << cl_kernel << ": "
+                   << llvm::toString(stats.takeError()) << "\n";
+      return 1;
+    }
+    llvm::outs() << llvm::format("%8d %12lld %14.1f %12.1f\n",
+                                 stats->num_threads,
+                                 static_cast<long long>(stats->num_runs),
+                                 stats->ns_per_run,
+                                 stats->bytes_per_second * 1e-6);
+  }
+
+  return 0;
+}